@@ -143,6 +143,8 @@ SH = 'Simon Heumos'
 man_pages = [
     ('man/odgi', 'odgi', u'Dynamic succinct variation graph tool.',
      [author], 1),
+    ('man/odgi_batch', 'odgi_batch', u'Run read-only commands against graphs loaded once.',
+     [EG], 1),
     ('man/odgi_bin', 'odgi_bin', u'Binning of pangenome sequence and path information in the graph.',
      [EG, SH], 1),
     ('man/odgi_break', 'odgi_break', u'Break cycles in the graph and drop its paths.',
@@ -151,6 +153,8 @@ man_pages = [
      [EG], 1),
     ('man/odgi_chop', 'odgi_chop', u'Divide nodes into smaller pieces preserving node topology and order.',
      [EG, AG], 1),
+    ('man/odgi_compact', 'odgi_compact', u'Apply a chain of deltas to their base graph and write the result in full.',
+     [EG], 1),
     ('man/odgi_cover', 'odgi_cover', u'Cover the graph with paths.',
      [AG], 1),
     ('man/odgi_pav', 'odgi_pav', u'Presence/absence variants (PAVs).',
@@ -0,0 +1,43 @@
+#!/bin/bash
+
+# Time odgi draw on the chr6.C4 layout with one thread and with N threads,
+# and check that the tiled renderer gives the same image with both.
+#
+# usage: draw_benchmark.sh <odgi executable> <odgi test folder> [threads] [png height]
+
+# path to the ODGI executable
+OG=$1
+# path to the ODGI test folder
+TEST=$2
+THREADS=${3:-8}
+HEIGHT=${4:-4000}
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+echo " [draw_benchmark] INFO: Building and laying out chr6.C4."
+"$OG" build -g "$TEST"/chr6.C4.gfa -o "$WORK"/chr6.C4.og -t "$THREADS" || exit 1
+"$OG" layout -i "$WORK"/chr6.C4.og -o "$WORK"/chr6.C4.lay -t "$THREADS" || exit 1
+
+draw() {
+    local threads=$1
+    local png=$2
+    shift 2
+    local start
+    start=$(date +%s.%N)
+    "$OG" draw -i "$WORK"/chr6.C4.og -c "$WORK"/chr6.C4.lay -p "$png" -H "$HEIGHT" -t "$threads" "$@" || exit 1
+    echo "$(date +%s.%N) - $start" | bc
+}
+
+for mode in "" "-C"; do
+    name=${mode:-default}
+    serial=$(draw 1 "$WORK"/serial.png $mode)
+    parallel=$(draw "$THREADS" "$WORK"/parallel.png $mode)
+    echo " [draw_benchmark] INFO: draw $name -H $HEIGHT: ${serial}s with 1 thread, ${parallel}s with $THREADS threads."
+    if cmp -s "$WORK"/serial.png "$WORK"/parallel.png; then
+        echo " [draw_benchmark] SUCCESS: draw $name gives the same image with 1 and $THREADS threads."
+    else
+        echo " [draw_benchmark] FAILED: draw $name gives different images with 1 and $THREADS threads."
+        exit 1
+    fi
+done
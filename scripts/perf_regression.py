@@ -0,0 +1,209 @@
+#!/usr/bin/env python3
+"""End-to-end performance runs of odgi subcommands, against a JSON baseline.
+
+Runs a fixed matrix of subcommands (build, sort -p Ygs, layout, viz, extract -b, depth,
+untangle, position) on each graph and records, for each run, the wall time, the CPU time
+(user + system, over all threads), the peak resident set size and the throughput in MB of
+input per second of wall time. The median of --repeat runs is kept.
+
+    perf_regression.py --odgi bin/odgi --out perf.json
+    perf_regression.py --odgi bin/odgi --out perf.json --baseline baseline.json --threshold 0.1
+
+With --baseline, each metric is compared to the baseline; a run slower or larger by more than
+the threshold is a regression, and the script then exits with status 1. Graphs are the GFAs
+of the test folder by default; --graph adds a GFA by path or by http(s) URL, downloaded once
+into the --cache folder. This is what `make perf_regression` runs.
+"""
+
+import argparse
+import json
+import os
+import platform
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+import urllib.request
+
+# the GFAs of the test folder the matrix runs on by default
+DEFAULT_GRAPHS = ["DRB1-3123.gfa", "chr6.C4.gfa", "LPA.gfa"]
+
+# the metrics compared against a baseline, all of them lower is better
+COMPARED = ["wall_s", "cpu_s", "max_rss_kib"]
+
+
+def run_measured(args, stdout):
+    """Run the command, returning its wall time, CPU time and peak RSS, or None if it failed"""
+    # stderr goes to a file, as a pipe nobody reads until the end could fill up and block the command
+    with tempfile.TemporaryFile() as err:
+        start = time.monotonic()
+        proc = subprocess.Popen(args, stdout=stdout, stderr=err)
+        # wait4 gives the resources of this child alone, unlike getrusage(RUSAGE_CHILDREN)
+        _, status, usage = os.wait4(proc.pid, 0)
+        wall = time.monotonic() - start
+        proc.returncode = os.waitstatus_to_exitcode(status)
+        if proc.returncode != 0:
+            err.seek(0)
+            sys.stderr.write("[perf_regression] error: %s exited with %d\n%s\n"
+                             % (" ".join(args), proc.returncode, err.read().decode(errors="replace")[-2000:]))
+            return None
+    return {
+        "wall_s": wall,
+        "cpu_s": usage.ru_utime + usage.ru_stime,
+        # ru_maxrss is in KiB on Linux, in bytes on macOS
+        "max_rss_kib": usage.ru_maxrss // 1024 if sys.platform == "darwin" else usage.ru_maxrss,
+    }
+
+
+def fetch_graph(graph, test_dir, cache):
+    """The local path of a graph given by name in the test folder, by path, or by URL"""
+    if graph.startswith("http://") or graph.startswith("https://"):
+        os.makedirs(cache, exist_ok=True)
+        local = os.path.join(cache, os.path.basename(graph.split("?")[0]))
+        if not os.path.exists(local):
+            sys.stderr.write("[perf_regression] downloading %s\n" % graph)
+            with urllib.request.urlopen(graph) as response, open(local + ".part", "wb") as out:
+                shutil.copyfileobj(response, out)
+            os.rename(local + ".part", local)
+        return local
+    if os.path.exists(graph):
+        return graph
+    return os.path.join(test_dir, graph)
+
+
+def graph_name(path):
+    name = os.path.basename(path)
+    for ext in [".gz", ".bgz", ".gfa"]:
+        if name.endswith(ext):
+            name = name[:-len(ext)]
+    return name
+
+
+def first_path(odgi, og):
+    out = subprocess.run([odgi, "paths", "-i", og, "-L"], check=True, capture_output=True, text=True).stdout
+    return out.split("\n", 1)[0].strip()
+
+
+def matrix(odgi, gfa, work, threads):
+    """The (name, input, arguments, stdout file) of each run on the graph, in the order they depend on each other"""
+    og = os.path.join(work, "graph.og")
+    sorted_og = os.path.join(work, "graph.sorted.og")
+    bed = os.path.join(work, "region.bed")
+    t = ["-t", str(threads)]
+    # the runs after build need the graph, and a path and a region on it, made once build has run
+    yield "build", gfa, [odgi, "build", "-g", gfa, "-o", og] + t, None
+    path = first_path(odgi, og)
+    with open(bed, "w") as f:
+        f.write("%s\t0\t5000\n" % path)
+    yield "sort -p Ygs", og, [odgi, "sort", "-i", og, "-o", sorted_og, "-p", "Ygs"] + t, None
+    yield "layout", sorted_og, [odgi, "layout", "-i", sorted_og, "-o", os.path.join(work, "graph.lay")] + t, None
+    yield "viz", sorted_og, [odgi, "viz", "-i", sorted_og, "-o", os.path.join(work, "graph.png"), "-x", "1500"] + t, None
+    yield "extract -b", sorted_og, [odgi, "extract", "-i", sorted_og, "-b", bed,
+                                     "-o", os.path.join(work, "region.og")] + t, None
+    yield "depth", sorted_og, [odgi, "depth", "-i", sorted_og, "-d"] + t, os.devnull
+    yield "untangle", sorted_og, [odgi, "untangle", "-i", sorted_og, "-r", path] + t, os.devnull
+    yield "position", sorted_og, [odgi, "position", "-i", sorted_og, "-b", bed, "-r", path] + t, os.devnull
+
+
+def measure(opts):
+    results = []
+    for graph in (opts.graph or DEFAULT_GRAPHS):
+        gfa = fetch_graph(graph, opts.test_dir, opts.cache)
+        if not os.path.exists(gfa):
+            sys.stderr.write("[perf_regression] error: no graph %s\n" % gfa)
+            sys.exit(2)
+        work = tempfile.mkdtemp(prefix="odgi_perf_", dir=opts.work_dir)
+        try:
+            for name, source, args, stdout in matrix(opts.odgi, gfa, work, opts.threads):
+                runs = []
+                for _ in range(opts.repeat):
+                    with open(stdout or os.devnull, "w") as out:
+                        r = run_measured(args, out)
+                    if r is None:
+                        sys.exit(2)
+                    runs.append(r)
+                input_bytes = os.path.getsize(source)
+                result = {
+                    "graph": graph_name(gfa),
+                    "command": name,
+                    "input_bytes": input_bytes,
+                }
+                for metric in COMPARED:
+                    result[metric] = statistics.median(r[metric] for r in runs)
+                result["throughput_mb_s"] = input_bytes / 1e6 / max(result["wall_s"], 1e-9)
+                results.append(result)
+                sys.stderr.write("[perf_regression] %-10s %-12s %8.3fs wall %8.3fs cpu %9d KiB %8.2f MB/s\n"
+                                 % (result["graph"], name, result["wall_s"], result["cpu_s"],
+                                    result["max_rss_kib"], result["throughput_mb_s"]))
+        finally:
+            shutil.rmtree(work, ignore_errors=True)
+    return {
+        "host": platform.node(),
+        "platform": platform.platform(),
+        "threads": opts.threads,
+        "repeat": opts.repeat,
+        "results": results,
+    }
+
+
+def compare(current, baseline, threshold):
+    """Print the changes beyond the threshold, and return the number of regressions"""
+    before = {(r["graph"], r["command"]): r for r in baseline["results"]}
+    regressions = 0
+    for r in current["results"]:
+        b = before.get((r["graph"], r["command"]))
+        if b is None:
+            print("%-10s %-12s new, no baseline" % (r["graph"], r["command"]))
+            continue
+        for metric in COMPARED:
+            if not b.get(metric):
+                continue
+            change = r[metric] / b[metric] - 1
+            if abs(change) <= threshold:
+                continue
+            verdict = "REGRESSION" if change > 0 else "improved"
+            regressions += change > 0
+            print("%-10s %-12s %-11s %12.3f -> %12.3f %+7.1f%% %s"
+                  % (r["graph"], r["command"], metric, b[metric], r[metric], 100 * change, verdict))
+    if baseline.get("threads") != current.get("threads") or baseline.get("host") != current.get("host"):
+        print("note: the baseline was taken with %s threads on %s, this run with %s threads on %s"
+              % (baseline.get("threads"), baseline.get("host"), current.get("threads"), current.get("host")))
+    print("%d regression(s) beyond %.0f%%" % (regressions, 100 * threshold))
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--odgi", default="bin/odgi", help="the odgi executable (default: bin/odgi)")
+    parser.add_argument("--test-dir", default="test", help="the folder of the default graphs (default: test)")
+    parser.add_argument("--graph", action="append", help="a GFA to run on, by name in the test folder, path or URL;"
+                                                         " may be repeated (default: %s)" % " ".join(DEFAULT_GRAPHS))
+    parser.add_argument("--cache", default=os.path.join(tempfile.gettempdir(), "odgi_perf_graphs"),
+                        help="where downloaded graphs are kept between runs")
+    parser.add_argument("--work-dir", default=None, help="where the outputs of the runs go (default: a temporary folder)")
+    parser.add_argument("-t", "--threads", type=int, default=4, help="threads for each subcommand (default: 4)")
+    parser.add_argument("--repeat", type=int, default=3, help="runs of each subcommand, the median is kept (default: 3)")
+    parser.add_argument("--out", help="write the measurements to this JSON file")
+    parser.add_argument("--baseline", help="compare the measurements to this JSON file, from an earlier --out")
+    parser.add_argument("--threshold", type=float, default=0.1,
+                        help="the relative change beyond which a metric is flagged (default: 0.1)")
+    opts = parser.parse_args()
+    if opts.repeat < 1 or opts.threads < 1 or opts.threshold < 0:
+        parser.error("--repeat and --threads must be at least 1, --threshold must not be negative")
+
+    current = measure(opts)
+    if opts.out:
+        with open(opts.out, "w") as f:
+            json.dump(current, f, indent=2)
+            f.write("\n")
+    if opts.baseline:
+        with open(opts.baseline) as f:
+            baseline = json.load(f)
+        if compare(current, baseline, opts.threshold) > 0:
+            sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -9,9 +9,11 @@
 #include <atomic>
 #include <cmath>
 #include <memory>
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
 #include "picosha2.h"
+#include "huge_pages.hpp"
 
 namespace odgi {
 
@@ -113,8 +115,15 @@ const color_t COLOR_WHITE = { 0xffffffff };
 
 struct atomic_image_buf_t {
     std::unique_ptr<std::vector<std::atomic<uint32_t>>> image;
+    // the pixels, owned by image or by the image this is a clipped view of
+    std::atomic<uint32_t>* pixels = nullptr;
     uint64_t height = 0;
     uint64_t width = 0;
+    // only pixels in [clip_min_x, clip_max_x) x [clip_min_y, clip_max_y) are drawn
+    uint64_t clip_min_x = 0;
+    uint64_t clip_min_y = 0;
+    uint64_t clip_max_x = 0;
+    uint64_t clip_max_y = 0;
     double source_width = 0;
     double source_height = 0;
     double source_per_px_x = 0;
@@ -140,9 +149,38 @@ struct atomic_image_buf_t {
             //std::cerr << "coloring " << COLOR_WHITE.hex << std::endl;
             (*image)[i] = COLOR_WHITE.hex; // atomic assignment
         }
+        pixels = image->data();
+        // the pixels are drawn in the order of the layout, which is all over the image
+        odgi::algorithms::huge_pages::advise(*image);
+        clip_max_x = width;
+        clip_max_y = height;
         source_per_px_x = source_width / width;
         source_per_px_y = source_height / height;
     }
+    // a view of the pixels of base that only draws into the given rectangle
+    atomic_image_buf_t(const atomic_image_buf_t& base,
+                       const uint64_t& min_x,
+                       const uint64_t& min_y,
+                       const uint64_t& max_x,
+                       const uint64_t& max_y)
+        : pixels(base.pixels)
+        , height(base.height)
+        , width(base.width)
+        , clip_min_x(min_x)
+        , clip_min_y(min_y)
+        , clip_max_x(std::min(max_x, base.width))
+        , clip_max_y(std::min(max_y, base.height))
+        , source_width(base.source_width)
+        , source_height(base.source_height)
+        , source_per_px_x(base.source_per_px_x)
+        , source_per_px_y(base.source_per_px_y)
+        , source_min_x(base.source_min_x)
+        , source_min_y(base.source_min_y)
+        {
+    }
+    bool in_clip(const uint64_t& x, const uint64_t& y) const {
+        return x >= clip_min_x && x < clip_max_x && y >= clip_min_y && y < clip_max_y;
+    }
     std::vector<uint8_t> to_bytes() {
         std::vector<uint8_t> bytes(4 * height * width);
         for (uint64_t i = 0; i < image->size(); ++i) {
@@ -161,27 +199,29 @@ struct atomic_image_buf_t {
                    const color_t& c) {
         //size_t i = width * y + x;
         //std::cerr << "setting color with intensity " << f << std::endl;
-        (*image)[width * y + x] = c.hex;
+        if (!in_clip(x, y)) {
+            return;
+        }
+        pixels[width * y + x].store(c.hex, std::memory_order_relaxed);
     }
     // layering
     void layer_pixel(const uint64_t& x,
                      const uint64_t& y,
                      const color_t& c) {
-        if (x >= width || y >= height) {
+        if (!in_clip(x, y)) {
             return; // bail out
         }
         size_t i = width * y + x;
         //std::cerr << "getting i=" << i << " " << y << " " << x << " " << " in image " << height << "x" << width << std::endl;
         color_t v;
-        v.hex = (*image)[i].load();
+        v.hex = pixels[i].load(std::memory_order_relaxed);
         //std::cerr << "got " << v.hex << " " << (int)v.c.r << "," << (int)v.c.g << "," << (int)v.c.b << std::endl;
         //std::cerr << "layer " << c.hex << " " << (int)c.c.r << "," << (int)c.c.g << "," << (int)c.c.b << std::endl;
         v = mix(c, v, 0.5);
         //v = layer(c, v, f);
         //std::cerr << "assigned " << v.hex << " " << (int)v.c.r << "," << (int)v.c.g << "," << (int)v.c.b << std::endl;
-        // there is the possibility of a race decreasing how bright pixels get
-        // but, at least we won't overflow
-        (*image)[i] = v.hex; // atomic assignment
+        // each pixel is only drawn by the thread of its tile, so this load and store do not race
+        pixels[i].store(v.hex, std::memory_order_relaxed);
     }
 };
 
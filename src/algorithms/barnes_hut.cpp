@@ -0,0 +1,136 @@
+#include "barnes_hut.hpp"
+#include <algorithm>
+#include <limits>
+
+namespace odgi {
+namespace algorithms {
+
+// leaves are cut at this many points, or at this depth for clusters of (nearly) identical points
+const uint64_t barnes_hut_leaf_size = 8;
+const uint64_t barnes_hut_max_depth = 48;
+
+void barnes_hut_quadtree_t::build(const std::vector<double>& X, const std::vector<double>& Y) {
+    px = &X;
+    py = &Y;
+    cells.clear();
+    order.resize(X.size());
+    for (uint64_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    if (order.empty()) {
+        return;
+    }
+    double min_x = std::numeric_limits<double>::max();
+    double min_y = std::numeric_limits<double>::max();
+    double max_x = std::numeric_limits<double>::lowest();
+    double max_y = std::numeric_limits<double>::lowest();
+    for (uint64_t i = 0; i < X.size(); ++i) {
+        min_x = std::min(min_x, X[i]);
+        max_x = std::max(max_x, X[i]);
+        min_y = std::min(min_y, Y[i]);
+        max_y = std::max(max_y, Y[i]);
+    }
+    const double size = std::max(std::max(max_x - min_x, max_y - min_y), 1e-9);
+    cells.reserve(2 * order.size() / barnes_hut_leaf_size + 1);
+    build_cell(0, order.size(), min_x, min_y, size, 0);
+}
+
+uint64_t barnes_hut_quadtree_t::build_cell(const uint64_t& begin, const uint64_t& end,
+                                           const double& min_x, const double& min_y, const double& size,
+                                           const uint64_t& depth) {
+    const uint64_t id = cells.size();
+    cells.emplace_back();
+    cells[id].size = size;
+    if (end - begin <= barnes_hut_leaf_size || depth >= barnes_hut_max_depth) {
+        double x = 0, y = 0;
+        for (uint64_t k = begin; k < end; ++k) {
+            x += (*px)[order[k]];
+            y += (*py)[order[k]];
+        }
+        auto& cell = cells[id];
+        cell.begin = begin;
+        cell.end = end;
+        cell.mass = end - begin;
+        cell.x = x / cell.mass;
+        cell.y = y / cell.mass;
+        return id;
+    }
+    // group the points by quadrant: x split first, then y within each half
+    const double half = size / 2;
+    const double mid_x = min_x + half;
+    const double mid_y = min_y + half;
+    auto first = order.begin() + begin;
+    auto last = order.begin() + end;
+    auto x_split = std::partition(first, last, [&](const uint64_t& i) { return (*px)[i] < mid_x; });
+    auto low_split = std::partition(first, x_split, [&](const uint64_t& i) { return (*py)[i] < mid_y; });
+    auto high_split = std::partition(x_split, last, [&](const uint64_t& i) { return (*py)[i] < mid_y; });
+    const uint64_t bounds[5] = {begin,
+                                (uint64_t)(low_split - order.begin()),
+                                (uint64_t)(x_split - order.begin()),
+                                (uint64_t)(high_split - order.begin()),
+                                end};
+    const double corner_x[4] = {min_x, min_x, mid_x, mid_x};
+    const double corner_y[4] = {min_y, mid_y, min_y, mid_y};
+    double x = 0, y = 0, mass = 0;
+    for (uint64_t q = 0; q < 4; ++q) {
+        if (bounds[q] < bounds[q + 1]) {
+            const uint64_t c = build_cell(bounds[q], bounds[q + 1], corner_x[q], corner_y[q], half, depth + 1);
+            // cells may have been reallocated
+            cells[id].child[q] = c;
+            x += cells[c].x * cells[c].mass;
+            y += cells[c].y * cells[c].mass;
+            mass += cells[c].mass;
+        }
+    }
+    auto& cell = cells[id];
+    cell.leaf = false;
+    cell.mass = mass;
+    cell.x = x / mass;
+    cell.y = y / mass;
+    return id;
+}
+
+void barnes_hut_quadtree_t::repulsion(const uint64_t& i, const double& theta, double& fx, double& fy) const {
+    fx = 0;
+    fy = 0;
+    if (cells.empty()) {
+        return;
+    }
+    const double x = (*px)[i];
+    const double y = (*py)[i];
+    const double theta2 = theta * theta;
+    std::vector<uint64_t> todo = {0};
+    while (!todo.empty()) {
+        const cell_t& cell = cells[todo.back()];
+        todo.pop_back();
+        if (cell.leaf) {
+            for (uint64_t k = cell.begin; k < cell.end; ++k) {
+                const uint64_t j = order[k];
+                const double dx = x - (*px)[j];
+                const double dy = y - (*py)[j];
+                const double d2 = dx * dx + dy * dy;
+                if (j != i && d2 > 0) {
+                    fx += dx / d2;
+                    fy += dy / d2;
+                }
+            }
+            continue;
+        }
+        const double dx = x - cell.x;
+        const double dy = y - cell.y;
+        const double d2 = dx * dx + dy * dy;
+        if (d2 > 0 && cell.size * cell.size < theta2 * d2) {
+            fx += cell.mass * dx / d2;
+            fy += cell.mass * dy / d2;
+        } else {
+            for (auto& c : cell.child) {
+                if (c) {
+                    todo.push_back(c);
+                }
+            }
+        }
+    }
+}
+
+}
+}
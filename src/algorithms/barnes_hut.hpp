@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+
+namespace odgi {
+namespace algorithms {
+
+/// A quadtree over a set of 2D points, to approximate sums of pairwise repulsive terms in O(log n) per point.
+class barnes_hut_quadtree_t {
+public:
+    /// index the points (X[i], Y[i])
+    void build(const std::vector<double>& X, const std::vector<double>& Y);
+    /// the sum over all other points j of (p_i - p_j) / |p_i - p_j|^2, approximating by their center of mass
+    /// the cells of size s seen at distance d from p_i with s / d < theta
+    void repulsion(const uint64_t& i, const double& theta, double& fx, double& fy) const;
+private:
+    struct cell_t {
+        double x = 0; // center of mass
+        double y = 0;
+        double mass = 0;
+        double size = 0; // side length
+        uint64_t begin = 0; // range of points in a leaf
+        uint64_t end = 0;
+        uint64_t child[4] = {0, 0, 0, 0}; // 0 if none, the root is never a child
+        bool leaf = true;
+    };
+    std::vector<cell_t> cells;
+    std::vector<uint64_t> order; // point ids grouped by cell
+    const std::vector<double>* px = nullptr;
+    const std::vector<double>* py = nullptr;
+    uint64_t build_cell(const uint64_t& begin, const uint64_t& end,
+                        const double& min_x, const double& min_y, const double& size,
+                        const uint64_t& depth);
+};
+
+}
+}
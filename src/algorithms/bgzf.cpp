@@ -0,0 +1,117 @@
+#include "bgzf.hpp"
+
+#include <zlib.h>
+#include <stdexcept>
+#include <algorithm>
+
+namespace odgi {
+namespace algorithms {
+
+namespace {
+
+const uint8_t bgzf_header[18] = {
+    0x1f, 0x8b, 0x08, 0x04, 0, 0, 0, 0, 0, 0xff, // gzip with the extra field, no mtime, unknown OS
+    0x06, 0x00, 'B', 'C', 0x02, 0x00,           // the BC subfield, which holds the block size - 1
+    0, 0
+};
+
+void put_le(std::string& out, const uint64_t& value, const uint64_t& bytes) {
+    for (uint64_t b = 0; b < bytes; ++b) {
+        out.push_back((char) ((value >> (8 * b)) & 0xff));
+    }
+}
+
+void compress_block(const char* data, const uint64_t& size, std::string& out) {
+    z_stream zs{};
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw std::runtime_error("[odgi::bgzf] error: could not initialize deflate");
+    }
+    const uint64_t start = out.size();
+    out.append((const char*) bgzf_header, sizeof(bgzf_header));
+    const uint64_t bound = deflateBound(&zs, size);
+    out.resize(start + sizeof(bgzf_header) + bound);
+    zs.next_in = (Bytef*) data;
+    zs.avail_in = size;
+    zs.next_out = (Bytef*) &out[start + sizeof(bgzf_header)];
+    zs.avail_out = bound;
+    if (deflate(&zs, Z_FINISH) != Z_STREAM_END) {
+        deflateEnd(&zs);
+        throw std::runtime_error("[odgi::bgzf] error: could not deflate a block");
+    }
+    out.resize(start + sizeof(bgzf_header) + zs.total_out);
+    deflateEnd(&zs);
+    put_le(out, crc32(crc32(0L, Z_NULL, 0), (const Bytef*) data, size), 4);
+    put_le(out, size, 4);
+    // the total block size - 1 goes into the BC subfield
+    const uint64_t block_size = out.size() - start - 1;
+    out[start + 16] = (char) (block_size & 0xff);
+    out[start + 17] = (char) ((block_size >> 8) & 0xff);
+}
+
+}
+
+void bgzf_compress(const std::string& text, std::string& out) {
+    bgzf_compress(text.data(), text.size(), out);
+}
+
+void bgzf_compress(const char* data, const uint64_t& size, std::string& out) {
+    for (uint64_t offset = 0; offset < size; offset += bgzf_block_input_size) {
+        compress_block(data + offset, std::min(bgzf_block_input_size, size - offset), out);
+    }
+}
+
+void deflate_raw(const char* data, const uint64_t& size, std::string& out) {
+    z_stream zs{};
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw std::runtime_error("[odgi::bgzf] error: could not initialize deflate");
+    }
+    const uint64_t start = out.size();
+    const uint64_t bound = deflateBound(&zs, size);
+    out.resize(start + bound);
+    zs.next_in = (Bytef*) data;
+    zs.next_out = (Bytef*) &out[start];
+    // zlib counts in 32 bits, so large inputs are fed in pieces
+    uint64_t fed = 0;
+    int ret = Z_OK;
+    while (ret != Z_STREAM_END) {
+        const uint64_t piece = std::min(size - fed, (uint64_t) 1 << 30);
+        zs.avail_in = piece;
+        zs.avail_out = std::min(start + bound - (uint64_t) ((char*) zs.next_out - &out[0]), (uint64_t) 1 << 30);
+        ret = deflate(&zs, fed + piece == size ? Z_FINISH : Z_NO_FLUSH);
+        if (ret == Z_STREAM_ERROR) {
+            deflateEnd(&zs);
+            throw std::runtime_error("[odgi::bgzf] error: could not deflate a block");
+        }
+        fed += piece - zs.avail_in;
+    }
+    out.resize((char*) zs.next_out - &out[0]);
+    deflateEnd(&zs);
+}
+
+void inflate_raw(const char* data, const uint64_t& size, char* out, const uint64_t& raw_size) {
+    z_stream zs{};
+    if (inflateInit2(&zs, -15) != Z_OK) {
+        throw std::runtime_error("[odgi::bgzf] error: could not initialize inflate");
+    }
+    zs.next_in = (Bytef*) data;
+    zs.next_out = (Bytef*) out;
+    int ret = Z_OK;
+    while (ret == Z_OK) {
+        zs.avail_in = std::min(size - (uint64_t) ((const char*) zs.next_in - data), (uint64_t) 1 << 30);
+        zs.avail_out = std::min(raw_size - (uint64_t) ((char*) zs.next_out - out), (uint64_t) 1 << 30);
+        ret = inflate(&zs, Z_NO_FLUSH);
+    }
+    const uint64_t inflated = (char*) zs.next_out - out;
+    inflateEnd(&zs);
+    if (ret != Z_STREAM_END || inflated != raw_size) {
+        throw std::runtime_error("[odgi::bgzf] error: corrupt or truncated deflate block");
+    }
+}
+
+const std::string& bgzf_eof(void) {
+    static const std::string eof("\x1f\x8b\x08\x04\x00\x00\x00\x00\x00\xff\x06\x00\x42\x43\x02\x00\x1b\x00\x03\x00\x00\x00\x00\x00\x00\x00\x00\x00", 28);
+    return eof;
+}
+
+}
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+/**
+ * \file bgzf.hpp
+ *
+ * Defines the compression of text into BGZF blocks, the blocked gzip of bgzip and htslib,
+ * and of bare deflate blocks.
+ */
+
+#include <string>
+#include <cstdint>
+
+namespace odgi {
+namespace algorithms {
+
+/// The most uncompressed bytes in one BGZF block, as bgzip uses
+const uint64_t bgzf_block_input_size = 0xff00;
+
+/// Append the text to out as BGZF blocks. The blocks are self-contained, so the chunks of a
+/// file can be compressed in parallel and simply concatenated, ending with bgzf_eof().
+void bgzf_compress(const std::string& text, std::string& out);
+
+/// The same, for the size bytes at data
+void bgzf_compress(const char* data, const uint64_t& size, std::string& out);
+
+/// The empty block that marks the end of a BGZF file
+const std::string& bgzf_eof(void);
+
+/// Append the data to out as a single raw deflate stream, without any header
+void deflate_raw(const char* data, const uint64_t& size, std::string& out);
+
+/// Inflate a raw deflate stream written by deflate_raw into out, which must hold exactly the raw_size
+/// bytes it holds uncompressed
+void inflate_raw(const char* data, const uint64_t& size, char* out, const uint64_t& raw_size);
+
+}
+}
@@ -0,0 +1,244 @@
+#include "bin_index.hpp"
+#include "progress.hpp"
+
+#include <algorithm>
+#include <memory>
+
+namespace odgi {
+namespace algorithms {
+
+static const char BIN_INDEX_MAGIC[8] = {'O', 'D', 'G', 'I', 'B', 'I', 'N', 'X'};
+static const uint64_t BIN_INDEX_VERSION = 1;
+
+template<typename T>
+static void write_value(std::ostream &out, const T &v) {
+    out.write((const char *) &v, sizeof(T));
+}
+
+template<typename T>
+static bool read_value(std::istream &in, T &v) {
+    return (bool) in.read((char *) &v, sizeof(T));
+}
+
+static void write_pairs(std::ostream &out, const std::vector<std::pair<uint64_t, uint64_t>> &pairs) {
+    write_value(out, (uint64_t) pairs.size());
+    for (auto &p : pairs) {
+        write_value(out, p.first);
+        write_value(out, p.second);
+    }
+}
+
+static bool read_pairs(std::istream &in, std::vector<std::pair<uint64_t, uint64_t>> &pairs) {
+    uint64_t n = 0;
+    if (!read_value(in, n)) {
+        return false;
+    }
+    pairs.resize(n);
+    for (auto &p : pairs) {
+        if (!read_value(in, p.first) || !read_value(in, p.second)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool read_string(std::istream &in, std::string &s) {
+    uint64_t n = 0;
+    if (!read_value(in, n)) {
+        return false;
+    }
+    s.resize(n);
+    return n == 0 || (bool) in.read(&s[0], n);
+}
+
+void bin_index_t::build(const PathHandleGraph &graph,
+                        const uint64_t &bin_width,
+                        const uint64_t &nthreads,
+                        const bool &progress) {
+    this->bin_width = bin_width;
+    uint64_t len = 0;
+    sequence.clear();
+    const std::vector<uint64_t> position_map = bin_position_map(graph, len, &sequence);
+    std::vector<path_handle_t> path_handles;
+    graph.for_each_path_handle([&](const path_handle_t &path) {
+        path_handles.push_back(path);
+    });
+    paths.clear();
+    paths.resize(path_handles.size());
+    path_ranks.clear();
+    std::unique_ptr<progress_meter::ProgressMeter> progress_meter;
+    if (progress) {
+        progress_meter = std::make_unique<progress_meter::ProgressMeter>(
+                path_handles.size(), "[odgi::bin] building bin index:");
+    }
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+    for (uint64_t i = 0; i < path_handles.size(); ++i) {
+        std::map<uint64_t, path_info_t> bins;
+        indexed_path_t &path = paths[i];
+        path.name = graph.get_path_name(path_handles[i]);
+        collect_path_bins(graph, path_handles[i], position_map, bin_width, bins, path.links, path.length);
+        path.bins.reserve(bins.size());
+        for (auto &entry : bins) {
+            auto &v = entry.second;
+            path.bins.push_back({entry.first, (uint64_t) v.mean_depth, (uint64_t) v.mean_inv, v.mean_pos,
+                                 std::move(v.ranges)});
+        }
+        if (progress) {
+            progress_meter->increment(1);
+        }
+    }
+    if (progress) {
+        progress_meter->finish();
+    }
+    for (uint64_t i = 0; i < paths.size(); ++i) {
+        path_ranks[paths[i].name] = i;
+    }
+}
+
+void bin_index_t::serialize(std::ostream &out) const {
+    out.write(BIN_INDEX_MAGIC, sizeof(BIN_INDEX_MAGIC));
+    write_value(out, BIN_INDEX_VERSION);
+    write_value(out, bin_width);
+    write_value(out, (uint64_t) sequence.size());
+    out.write(sequence.data(), sequence.size());
+    write_value(out, (uint64_t) paths.size());
+    for (auto &path : paths) {
+        write_value(out, (uint64_t) path.name.size());
+        out.write(path.name.data(), path.name.size());
+        write_value(out, path.length);
+        write_value(out, (uint64_t) path.bins.size());
+        for (auto &b : path.bins) {
+            write_value(out, b.bin);
+            write_value(out, b.depth);
+            write_value(out, b.inv);
+            write_value(out, b.pos);
+            write_pairs(out, b.ranges);
+        }
+        write_pairs(out, path.links);
+    }
+}
+
+bool bin_index_t::load(std::istream &in) {
+    char magic[sizeof(BIN_INDEX_MAGIC)];
+    uint64_t version = 0;
+    if (!in.read(magic, sizeof(magic))
+        || !std::equal(magic, magic + sizeof(magic), BIN_INDEX_MAGIC)
+        || !read_value(in, version) || version != BIN_INDEX_VERSION
+        || !read_value(in, bin_width) || bin_width == 0
+        || !read_string(in, sequence)) {
+        return false;
+    }
+    uint64_t path_count = 0;
+    if (!read_value(in, path_count)) {
+        return false;
+    }
+    paths.clear();
+    paths.resize(path_count);
+    path_ranks.clear();
+    for (uint64_t i = 0; i < path_count; ++i) {
+        indexed_path_t &path = paths[i];
+        uint64_t bin_count = 0;
+        if (!read_string(in, path.name) || !read_value(in, path.length) || !read_value(in, bin_count)) {
+            return false;
+        }
+        path.bins.resize(bin_count);
+        for (auto &b : path.bins) {
+            if (!read_value(in, b.bin) || !read_value(in, b.depth) || !read_value(in, b.inv)
+                || !read_value(in, b.pos) || !read_pairs(in, b.ranges)) {
+                return false;
+            }
+        }
+        if (!read_pairs(in, path.links)) {
+            return false;
+        }
+        path_ranks[path.name] = i;
+    }
+    return true;
+}
+
+uint64_t bin_index_t::get_path_rank(const std::string &name) const {
+    auto f = path_ranks.find(name);
+    return f == path_ranks.end() ? paths.size() : f->second;
+}
+
+void bin_index_t::get_total_depth(const uint64_t &factor, std::map<uint64_t, uint64_t> &depth) const {
+    for (auto &path : paths) {
+        for (auto &b : path.bins) {
+            depth[b.bin == 0 ? 0 : (b.bin - 1) / factor + 1] += b.depth;
+        }
+    }
+}
+
+void bin_index_t::get_path_bins(const uint64_t &i,
+                                const uint64_t &factor,
+                                std::map<uint64_t, path_info_t> &bins,
+                                std::vector<std::pair<uint64_t, uint64_t>> *links) const {
+    const indexed_path_t &path = paths[i];
+    auto merged_bin = [&](const uint64_t &b) -> uint64_t {
+        return b == 0 ? 0 : (b - 1) / factor + 1;
+    };
+    for (auto &b : path.bins) {
+        path_info_t &info = bins[merged_bin(b.bin)];
+        info.mean_depth += b.depth;
+        info.mean_inv += b.inv;
+        info.mean_pos += b.pos;
+        info.ranges.insert(info.ranges.end(), b.ranges.begin(), b.ranges.end());
+    }
+    if (factor > 1) {
+        // a range is a run of consecutive path nucleotides on one strand, forward ones are <first, last>
+        // and reverse ones <last, first>, with a 0 on the other side for a single nucleotide
+        auto is_rev = [](const std::pair<uint64_t, uint64_t> &r) -> bool {
+            return r.second == 0 || (r.first != 0 && r.first > r.second);
+        };
+        auto begin_of = [](const std::pair<uint64_t, uint64_t> &r) -> uint64_t {
+            return r.first == 0 || r.second == 0 ? std::max(r.first, r.second) : std::min(r.first, r.second);
+        };
+        auto end_of = [](const std::pair<uint64_t, uint64_t> &r) -> uint64_t {
+            return std::max(r.first, r.second);
+        };
+        for (auto &entry : bins) {
+            auto &ranges = entry.second.ranges;
+            // the runs of each base bin are in path order already, put those of the merged bin in path order
+            // and join the ones a walk at the merged width would not have split
+            std::sort(ranges.begin(), ranges.end(), [&](const std::pair<uint64_t, uint64_t> &x,
+                                                        const std::pair<uint64_t, uint64_t> &y) {
+                return begin_of(x) < begin_of(y);
+            });
+            uint64_t fill_pos = 0;
+            for (uint64_t j = 0; j < ranges.size(); ++j) {
+                if (fill_pos > 0) {
+                    auto &last = ranges[fill_pos - 1];
+                    const bool rev = is_rev(last);
+                    if (rev == is_rev(ranges[j]) && end_of(last) + 1 == begin_of(ranges[j])) {
+                        const uint64_t begin = begin_of(last);
+                        const uint64_t end = end_of(ranges[j]);
+                        last = rev ? std::make_pair(end, begin) : std::make_pair(begin, end);
+                        continue;
+                    }
+                }
+                ranges[fill_pos++] = ranges[j];
+            }
+            ranges.resize(fill_pos);
+        }
+    }
+    const uint64_t width = factor * bin_width;
+    for (auto &entry : bins) {
+        auto &v = entry.second;
+        v.mean_inv /= (v.mean_depth ? v.mean_depth : 1);
+        v.mean_depth /= width;
+        v.mean_pos /= width * path.length * v.mean_depth;
+    }
+    if (links != nullptr) {
+        for (auto &link : path.links) {
+            const uint64_t a = merged_bin(link.first);
+            const uint64_t b = merged_bin(link.second);
+            // links within or between neighboring merged bins are not jumps any more, as in odgi bin
+            if (a == 0 || b == 0 || (a > b ? a - b : b - a) > 1) {
+                links->emplace_back(a, b);
+            }
+        }
+    }
+}
+
+}
+}
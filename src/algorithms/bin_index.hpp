@@ -0,0 +1,105 @@
+#pragma once
+
+/**
+ * \file bin_index.hpp
+ *
+ * Defines a file of per path bin sums of a sorted graph, that can be read back at any multiple of its bin width.
+ */
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <unordered_map>
+#include <handlegraph/path_handle_graph.hpp>
+#include <handlegraph/util.hpp>
+#include "bin_path_info.hpp"
+
+namespace odgi {
+namespace algorithms {
+
+using namespace handlegraph;
+
+/// The bins of every path of a graph at a base bin width, together with the pangenome sequence.
+/// Each bin keeps the sums the means of odgi bin are taken of, the ranges of path nucleotides in it
+/// and the links that leave it, so that the bins at a width of any multiple of the base width can be
+/// merged from it without walking the paths again. The node order of the graph gives the bins, so the
+/// index is only valid for the graph, in its current order, it was built from.
+class bin_index_t {
+public:
+
+    /// Bin the paths of a compacted graph in bins of bin_width bp, one path per thread
+    void build(const PathHandleGraph &graph,
+               const uint64_t &bin_width,
+               const uint64_t &nthreads,
+               const bool &progress);
+
+    void serialize(std::ostream &out) const;
+
+    /// Read an index written by serialize, false if the stream does not hold one
+    bool load(std::istream &in);
+
+    uint64_t get_bin_width(void) const {
+        return bin_width;
+    }
+
+    uint64_t get_pangenome_length(void) const {
+        return sequence.size();
+    }
+
+    const std::string &get_sequence(void) const {
+        return sequence;
+    }
+
+    uint64_t get_path_count(void) const {
+        return paths.size();
+    }
+
+    const std::string &get_path_name(const uint64_t &i) const {
+        return paths[i].name;
+    }
+
+    uint64_t get_path_length(const uint64_t &i) const {
+        return paths[i].length;
+    }
+
+    /// The rank of the path with this name, or the path count if there is none
+    uint64_t get_path_rank(const std::string &name) const;
+
+    /// The bins of the i-th path at factor times the base bin width, with their means, as odgi bin
+    /// reports them. The links between the bins are added to links if it is given.
+    void get_path_bins(const uint64_t &i,
+                       const uint64_t &factor,
+                       std::map<uint64_t, path_info_t> &bins,
+                       std::vector<std::pair<uint64_t, uint64_t>> *links = nullptr) const;
+
+    /// The nucleotides of all the paths in each bin at factor times the base bin width, summed over the
+    /// paths, as the compressed mode of odgi viz draws them
+    void get_total_depth(const uint64_t &factor, std::map<uint64_t, uint64_t> &depth) const;
+
+private:
+
+    struct indexed_bin_t {
+        uint64_t bin;
+        uint64_t depth;
+        uint64_t inv;
+        double pos;
+        std::vector<std::pair<uint64_t, uint64_t>> ranges;
+    };
+
+    struct indexed_path_t {
+        std::string name;
+        uint64_t length = 0;
+        std::vector<indexed_bin_t> bins;
+        std::vector<std::pair<uint64_t, uint64_t>> links;
+    };
+
+    uint64_t bin_width = 0;
+    std::string sequence;
+    std::vector<indexed_path_t> paths;
+    std::unordered_map<std::string, uint64_t> path_ranks;
+};
+
+}
+}
@@ -8,7 +8,8 @@ namespace odgi {
         void bin_path_depth(const PathHandleGraph &graph,
                            const bool progress,
                            const uint64_t min_paths,
-                           const uint64_t min_depth) {
+                           const uint64_t min_depth,
+                           const uint64_t nthreads) {
             std::unique_ptr<progress_meter::ProgressMeter> progress_meter;
             if (progress) {
                 progress_meter = std::make_unique<progress_meter::ProgressMeter>(
@@ -22,34 +23,50 @@ namespace odgi {
             });
             std::cout << std::endl;
             // the graph must be compacted for this to work
+            std::vector<handle_t> handles;
+            handles.reserve(graph.get_node_count());
             graph.for_each_handle([&](const handle_t &h) {
-                vector<uint64_t> p_i = vector<uint64_t>(path_count);
-                graph.for_each_step_on_handle(h, [&](const step_handle_t &occ) {
-                    const path_handle_t p_h = graph.get_path_handle_of_step(occ);
-                    p_i[as_integer(p_h) - 1] += 1;
-                });
+                handles.push_back(h);
+            });
+            // the rows of a batch of nodes are made in parallel, each thread on its own nodes, and written in node order
+            const uint64_t threads = std::max((uint64_t) 1, nthreads);
+            const uint64_t batch_size = threads * 1024;
+            std::vector<std::string> rows;
+            for (uint64_t first = 0; first < handles.size(); first += batch_size) {
+                const uint64_t count = std::min(batch_size, handles.size() - first);
+                rows.assign(count, std::string());
+#pragma omp parallel for schedule(dynamic,64) num_threads(threads)
+                for (uint64_t i = 0; i < count; ++i) {
+                    const handle_t &h = handles[first + i];
+                    vector<uint64_t> p_i = vector<uint64_t>(path_count);
+                    graph.for_each_step_on_handle(h, [&](const step_handle_t &occ) {
+                        const path_handle_t p_h = graph.get_path_handle_of_step(occ);
+                        p_i[as_integer(p_h) - 1] += 1;
+                    });
 
-                if (progress) {
-                    progress_meter->increment(1);
-                }
-                std::string row = std::to_string(number_bool_packing::unpack_number(h) + 1);
-                uint64_t paths_with_cov = 0;
-                uint64_t idx = 0;
-                for (const auto& path_cov : p_i) {
-                    row += "\t";
-                    if (path_cov < min_depth) {
-                        row += std::to_string(0);
-                    } else {
-                        paths_with_cov++;
-                        row += std::to_string(path_cov);
+                    if (progress) {
+                        progress_meter->increment(1);
+                    }
+                    std::string row = std::to_string(number_bool_packing::unpack_number(h) + 1);
+                    uint64_t paths_with_cov = 0;
+                    for (const auto& path_cov : p_i) {
+                        row += "\t";
+                        if (path_cov < min_depth) {
+                            row += std::to_string(0);
+                        } else {
+                            paths_with_cov++;
+                            row += std::to_string(path_cov);
+                        }
+                    }
+                    row += "\n";
+                    if ((!(paths_with_cov == path_count)) && (paths_with_cov >= min_paths)) {
+                        rows[i] = std::move(row);
                     }
-                    idx++;
                 }
-                row += "\n";
-                if ((!(paths_with_cov == path_count)) && (paths_with_cov >= min_paths)) {
+                for (const auto &row : rows) {
                     std::cout << row;
                 }
-            });
+            }
             if (progress) {
                 progress_meter->finish();
             }
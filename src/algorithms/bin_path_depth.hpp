@@ -19,9 +19,12 @@ namespace odgi {
         using namespace std;
         using namespace handlegraph;
 
+        /// Write the depth of each path on each node as a row of a table, for the nodes that some but not all
+        /// of the paths cover; the nodes are scanned on nthreads threads and their rows written in node order
         void bin_path_depth(const PathHandleGraph &graph,
                            const bool progress = false,
                            const uint64_t min_paths = 1,
-                           const uint64_t min_depth = 1);
+                           const uint64_t min_depth = 1,
+                           const uint64_t nthreads = 1);
     }
 }
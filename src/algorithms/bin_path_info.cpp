@@ -1,4 +1,5 @@
 #include "bin_path_info.hpp"
+#include "bin_index.hpp"
 
 // #define  debug_bin_path_info
 
@@ -22,6 +23,175 @@ namespace odgi {
 #endif
         }
 
+        void collect_path_bins(const PathHandleGraph &graph,
+                               const path_handle_t &path,
+                               const std::vector<uint64_t> &position_map,
+                               const uint64_t &bin_width,
+                               std::map<uint64_t, path_info_t> &bins,
+                               std::vector<std::pair<uint64_t, uint64_t>> &links,
+                               uint64_t &path_length) {
+            // walk the path and aggregate
+            uint64_t path_pos = 0;
+            int64_t last_bin = 0; // flag meaning "null bin"
+            uint64_t last_pos_in_bin = 0;
+            uint64_t nucleotide_count = 0;
+            bool last_is_rev = false;
+            // the bin of the last nucleotide, looked up in the map only when the path crosses into another one
+            int64_t info_bin = 0;
+            path_info_t *info = nullptr;
+            graph.for_each_step_in_path(path, [&](const step_handle_t &occ) {
+                handle_t h = graph.get_handle_of_step(occ);
+                bool is_rev = graph.get_is_reverse(h);
+                uint64_t p = position_map[number_bool_packing::unpack_number(h)];
+                uint64_t hl = graph.get_length(h);
+                // detect bin crossings
+                // make contects for the bases in the node
+                for (uint64_t k = 0; k < hl; ++k) {
+                    int64_t curr_bin = (p + k) / bin_width + 1;
+                    uint64_t curr_pos_in_bin = (p + k) - (curr_bin * bin_width);
+                    if (curr_bin != last_bin && std::abs(curr_bin - last_bin) > 1 || last_bin == 0) {
+                        // bin cross!
+                        links.push_back(std::make_pair(last_bin, curr_bin));
+                    }
+                    if (info == nullptr || curr_bin != info_bin) {
+                        info = &bins[curr_bin];
+                        info_bin = curr_bin;
+                    }
+                    ++info->mean_depth;
+                    if (is_rev) {
+                        ++info->mean_inv;
+                    }
+                    info->mean_pos += path_pos++;
+                    nucleotide_count += 1;
+                    if ((info->ranges.size() == 0) ||
+                        ((nucleotide_count - info->ranges.back().second) > 1 &&
+                         (nucleotide_count - info->ranges.back().first) > 1) ||
+                        (is_rev != last_is_rev)) {
+                        std::pair<uint64_t, uint64_t> p = std::make_pair(0, 0);
+                        if (is_rev) {
+                            std::get<0>(p) = nucleotide_count;
+                        } else {
+                            std::get<1>(p) = nucleotide_count;
+                        }
+                        info->ranges.push_back(p);
+#ifdef debug_bin_path_info
+                        std::cerr << "PUSHED PAIR: " << "<" << std::get<0>(p) << "," << std::get<1>(p) << ">"
+                                  << std::endl;
+#endif
+                    } else {
+                        std::pair<uint64_t, uint64_t> &p = info->ranges.back();
+                        if (is_rev) {
+                            updatePair<0, 1>(p, nucleotide_count);
+                        }
+                        else {
+                            updatePair<1, 0>(p, nucleotide_count);
+                        }
+                    }
+                    last_bin = curr_bin;
+                    last_is_rev = is_rev;
+                    last_pos_in_bin = curr_pos_in_bin;
+                }
+            });
+            links.push_back(std::make_pair(last_bin, 0));
+            path_length = path_pos;
+        }
+
+        uint64_t drop_path_gap_links(const std::map<uint64_t, path_info_t> &bins,
+                                     std::vector<std::pair<uint64_t, uint64_t>> &links) {
+            std::vector<uint64_t> bin_ids;
+            for (const auto &entry: bins) {
+                bin_ids.push_back(entry.first);
+            }
+            std::sort(bin_ids.begin(), bin_ids.end());
+
+            uint64_t fill_pos = 0;
+
+            for (uint64_t i = 0; i < links.size(); ++i) {
+                auto link = links[i];
+
+                if (link.first == 0 || link.second == 0)
+                    continue;
+
+                if (link.first > link.second) {
+                    links[fill_pos++] = link;
+                    continue;
+                }
+
+                auto left_it = std::lower_bound(bin_ids.begin(), bin_ids.end(), link.first + 1);
+                auto right_it = std::lower_bound(bin_ids.begin(), bin_ids.end(), link.second);
+                if (right_it > left_it) {
+                    links[fill_pos++] = link;
+                }
+            }
+
+            const uint64_t removed = links.size() - fill_pos;
+            links.resize(fill_pos);
+            return removed;
+        }
+
+        std::vector<uint64_t> bin_position_map(const PathHandleGraph &graph, uint64_t &len, std::string *graph_seq) {
+            // indexed by handle number, the numbers left by deleted nodes starting where the next node does,
+            // so that the ids need not be compacted
+            std::vector<uint64_t> position_map(
+                    graph.get_node_count() ? number_bool_packing::unpack_number(graph.get_handle(graph.max_node_id())) + 2 : 1);
+            len = 0;
+            uint64_t next_number = 0;
+            graph.for_each_handle([&](const handle_t &h) {
+                const uint64_t number = number_bool_packing::unpack_number(h);
+                while (next_number <= number) {
+                    position_map[next_number++] = len;
+                }
+                uint64_t hl = graph.get_length(h);
+                if (graph_seq != nullptr) {
+                    graph_seq->append(graph.get_sequence(h));
+                }
+                len += hl;
+            });
+            while (next_number < position_map.size()) {
+                position_map[next_number++] = len;
+            }
+            return position_map;
+        }
+
+        /// The bins and links of one path, as they are handed to handle_path
+        struct binned_path_t {
+            std::vector<std::pair<uint64_t, uint64_t>> links;
+            std::map<uint64_t, path_info_t> bins;
+            uint64_t links_before_drop = 0;
+        };
+
+        /// Bin the paths in batches of a few per thread, each path on one thread into its own bins, and hand the
+        /// batch over in path order before binning the next one, so that the bins of only one batch are held at once
+        static void for_each_binned_path(const uint64_t &path_count,
+                                         const uint64_t &nthreads,
+                                         const std::function<void(const uint64_t &, binned_path_t &)> &bin_path,
+                                         const std::function<void(const uint64_t &, binned_path_t &)> &handle_binned) {
+            const uint64_t threads = std::max((uint64_t) 1, nthreads);
+            const uint64_t batch_size = threads * 4;
+            std::vector<binned_path_t> batch;
+            for (uint64_t first = 0; first < path_count; first += batch_size) {
+                const uint64_t count = std::min(batch_size, path_count - first);
+                batch.clear();
+                batch.resize(count);
+#pragma omp parallel for schedule(dynamic,1) num_threads(threads)
+                for (uint64_t i = 0; i < count; ++i) {
+                    bin_path(first + i, batch[i]);
+                }
+                for (uint64_t i = 0; i < count; ++i) {
+                    handle_binned(first + i, batch[i]);
+                }
+            }
+        }
+
+        static void report_gap_links(const uint64_t &path_count,
+                                     const uint64_t &gap_links_removed,
+                                     const uint64_t &total_links) {
+            std::cerr << std::setprecision(4) << "[odgi::bin_path_info] Gap links removed: " << (100.0 *  ((double)gap_links_removed / (double)total_links))
+                      << "%, that is " << gap_links_removed << " gap links (" << path_count << " path start links + "
+                      << path_count << " path end links + " << (gap_links_removed - path_count * 2) << " inner gap links) of "
+                      << total_links << " total links" << std::endl;
+        }
+
         void bin_path_info(const PathHandleGraph &graph,
                            const std::string &prefix_delimiter,
                            const std::function<void(const uint64_t &, const uint64_t &)> &handle_header,
@@ -32,24 +202,17 @@ namespace odgi {
                            uint64_t num_bins,
                            uint64_t bin_width,
                            bool drop_gap_links,
-                           bool progress) {
-            // the graph must be compacted for this to work
-            std::vector<uint64_t> position_map(graph.get_node_count() + 1);
+                           bool progress,
+                           uint64_t nthreads) {
             uint64_t len = 0;
             std::string graph_seq;
-            graph.for_each_handle([&](const handle_t &h) {
-                position_map[number_bool_packing::unpack_number(h)] = len;
-                uint64_t hl = graph.get_length(h);
-                graph_seq.append(graph.get_sequence(h));
-                len += hl;
-            });
+            const std::vector<uint64_t> position_map = bin_position_map(graph, len, &graph_seq);
             if (!num_bins) {
                 num_bins = len / bin_width + (len % bin_width ? 1 : 0);
             } else if (!bin_width) {
                 bin_width = len / num_bins;
                 num_bins = len / bin_width + (len % bin_width ? 1 : 0);
             }
-            position_map[position_map.size() - 1] = len;
             // write header
             handle_header(len, bin_width);
             // collect bin sequences
@@ -57,7 +220,6 @@ namespace odgi {
                 handle_sequence(i + 1, graph_seq.substr(i * bin_width, bin_width));
             }
             graph_seq.clear(); // clean up
-            std::unordered_map<path_handle_t, uint64_t> path_length;
             uint64_t gap_links_removed = 0;
             uint64_t total_links = 0;
             std::unique_ptr<progress_meter::ProgressMeter> progress_meter;
@@ -65,111 +227,31 @@ namespace odgi {
                 progress_meter = std::make_unique<progress_meter::ProgressMeter>(
                         graph.get_path_count(), "[odgi::bin] bin_path_info:");
             }
+            std::vector<path_handle_t> paths;
+            paths.reserve(graph.get_path_count());
             graph.for_each_path_handle([&](const path_handle_t &path) {
-                std::vector<std::pair<uint64_t, uint64_t>> links;
-                std::map<uint64_t, path_info_t> bins;
-                // walk the path and aggregate
-                uint64_t path_pos = 0;
-                int64_t last_bin = 0; // flag meaning "null bin"
-                uint64_t last_pos_in_bin = 0;
-                uint64_t nucleotide_count = 0;
-                bool last_is_rev = false;
-                graph.for_each_step_in_path(path, [&](const step_handle_t &occ) {
-                    handle_t h = graph.get_handle_of_step(occ);
-                    bool is_rev = graph.get_is_reverse(h);
-                    uint64_t p = position_map[number_bool_packing::unpack_number(h)];
-                    uint64_t hl = graph.get_length(h);
-                    // detect bin crossings
-                    // make contects for the bases in the node
-                    for (uint64_t k = 0; k < hl; ++k) {
-                        int64_t curr_bin = (p + k) / bin_width + 1;
-                        uint64_t curr_pos_in_bin = (p + k) - (curr_bin * bin_width);
-                        if (curr_bin != last_bin && std::abs(curr_bin - last_bin) > 1 || last_bin == 0) {
-                            // bin cross!
-                            links.push_back(std::make_pair(last_bin, curr_bin));
-                        }
-                        ++bins[curr_bin].mean_depth;
-                        if (is_rev) {
-                            ++bins[curr_bin].mean_inv;
-                        }
-                        bins[curr_bin].mean_pos += path_pos++;
-                        nucleotide_count += 1;
-                        if ((bins[curr_bin].ranges.size() == 0) ||
-                            ((nucleotide_count - bins[curr_bin].ranges.back().second) > 1 &&
-                             (nucleotide_count - bins[curr_bin].ranges.back().first) > 1) ||
-                            (is_rev != last_is_rev)) {
-                            std::pair<uint64_t, uint64_t> p = std::make_pair(0, 0);
-                            if (is_rev) {
-                                std::get<0>(p) = nucleotide_count;
-                            } else {
-                                std::get<1>(p) = nucleotide_count;
-                            }
-                            bins[curr_bin].ranges.push_back(p);
-#ifdef debug_bin_path_info
-                            std::cerr << "PUSHED PAIR: " << "<" << std::get<0>(p) << "," << std::get<1>(p) << ">"
-                                      << std::endl;
-#endif
-                        } else {
-                            std::pair<uint64_t, uint64_t> &p = bins[curr_bin].ranges.back();
-                            if (is_rev) {
-                                updatePair<0, 1>(p, nucleotide_count);
-                            }
-                            else {
-                                updatePair<1, 0>(p, nucleotide_count);
-                            }
-                        }
-                        last_bin = curr_bin;
-                        last_is_rev = is_rev;
-                        last_pos_in_bin = curr_pos_in_bin;
-                    }
-                });
-                links.push_back(std::make_pair(last_bin, 0));
-                uint64_t path_length = path_pos;
-                uint64_t end_nucleotide = nucleotide_count;
-                for (auto &entry : bins) {
+                paths.push_back(path);
+            });
+            for_each_binned_path(paths.size(), nthreads, [&](const uint64_t &i, binned_path_t &binned) {
+                uint64_t path_length = 0;
+                collect_path_bins(graph, paths[i], position_map, bin_width, binned.bins, binned.links, path_length);
+                for (auto &entry : binned.bins) {
                     auto &v = entry.second;
                     v.mean_inv /= (v.mean_depth ? v.mean_depth : 1);
                     v.mean_depth /= bin_width;
                     v.mean_pos /= bin_width * path_length * v.mean_depth;
                 }
-
+                binned.links_before_drop = binned.links.size();
                 if (drop_gap_links) {
-                    std::vector<uint64_t> bin_ids;
-                    for (const auto &entry: bins) {
-                        bin_ids.push_back(entry.first);
-                    }
-                    std::sort(bin_ids.begin(), bin_ids.end());
-                    total_links += links.size();
-
-                    uint64_t fill_pos = 0;
-
-                    for (uint64_t i = 0; i < links.size(); ++i) {
-                        auto link = links[i];
-
-                        if (link.first == 0 || link.second == 0)
-                            continue;
-
-                        if (link.first > link.second) {
-                            links[fill_pos++] = link;
-                            continue;
-                        }
-
-                        auto left_it = std::lower_bound(bin_ids.begin(), bin_ids.end(), link.first + 1);
-                        auto right_it = std::lower_bound(bin_ids.begin(), bin_ids.end(), link.second);
-                        if (right_it > left_it) {
-                            links[fill_pos++] = link;
-                        }
-                    }
-
-                    gap_links_removed += links.size() - fill_pos;
-                    links.resize(fill_pos);
+                    drop_path_gap_links(binned.bins, binned.links);
                 }
-
-                handle_path(graph.get_path_name(path), links, bins);
-
                 if (progress) {
                     progress_meter->increment(1);
                 }
+            }, [&](const uint64_t &i, binned_path_t &binned) {
+                total_links += binned.links_before_drop;
+                gap_links_removed += binned.links_before_drop - binned.links.size();
+                handle_path(graph.get_path_name(paths[i]), binned.links, binned.bins);
             });
 
             if (progress) {
@@ -177,12 +259,54 @@ namespace odgi {
             }
 
             if (drop_gap_links) {
-                uint64_t path_count = graph.get_path_count();
+                report_gap_links(graph.get_path_count(), gap_links_removed, total_links);
+            }
+        }
 
-                std::cerr << std::setprecision(4) << "[odgi::bin_path_info] Gap links removed: " << (100.0 *  ((double)gap_links_removed / (double)total_links))
-                          << "%, that is " << gap_links_removed << " gap links (" << path_count << " path start links + "
-                          << path_count << " path end links + " << (gap_links_removed - path_count * 2) << " inner gap links) of "
-                          << total_links << " total links" << std::endl;
+        void bin_path_info(const bin_index_t &index,
+                           const std::function<void(const uint64_t &, const uint64_t &)> &handle_header,
+                           const std::function<void(const std::string &,
+                                                    const std::vector<std::pair<uint64_t, uint64_t>> &,
+                                                    const std::map<uint64_t, algorithms::path_info_t> &)> &handle_path,
+                           const std::function<void(const uint64_t &, const std::string &)> &handle_sequence,
+                           const uint64_t &bin_width,
+                           bool drop_gap_links,
+                           bool progress,
+                           uint64_t nthreads) {
+            const uint64_t len = index.get_pangenome_length();
+            const uint64_t num_bins = len / bin_width + (len % bin_width ? 1 : 0);
+            const uint64_t factor = bin_width / index.get_bin_width();
+            handle_header(len, bin_width);
+            const std::string &graph_seq = index.get_sequence();
+            for (uint64_t i = 0; i < num_bins; ++i) {
+                handle_sequence(i + 1, graph_seq.substr(i * bin_width, bin_width));
+            }
+            uint64_t gap_links_removed = 0;
+            uint64_t total_links = 0;
+            std::unique_ptr<progress_meter::ProgressMeter> progress_meter;
+            if (progress) {
+                progress_meter = std::make_unique<progress_meter::ProgressMeter>(
+                        index.get_path_count(), "[odgi::bin] bin_path_info:");
+            }
+            for_each_binned_path(index.get_path_count(), nthreads, [&](const uint64_t &i, binned_path_t &binned) {
+                index.get_path_bins(i, factor, binned.bins, &binned.links);
+                binned.links_before_drop = binned.links.size();
+                if (drop_gap_links) {
+                    drop_path_gap_links(binned.bins, binned.links);
+                }
+                if (progress) {
+                    progress_meter->increment(1);
+                }
+            }, [&](const uint64_t &i, binned_path_t &binned) {
+                total_links += binned.links_before_drop;
+                gap_links_removed += binned.links_before_drop - binned.links.size();
+                handle_path(index.get_path_name(i), binned.links, binned.bins);
+            });
+            if (progress) {
+                progress_meter->finish();
+            }
+            if (drop_gap_links) {
+                report_gap_links(index.get_path_count(), gap_links_removed, total_links);
             }
         }
 
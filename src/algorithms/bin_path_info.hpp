@@ -9,6 +9,8 @@
 #include <unordered_set>
 #include <unordered_map>
 #include <map>
+#include <string>
+#include <functional>
 #include <iomanip> // std::setprecision
 #include <handlegraph/handle_graph.hpp>
 #include <handlegraph/util.hpp>
@@ -30,6 +32,28 @@ namespace odgi {
             // long int last_nucleotide;
         };
 
+        class bin_index_t;
+
+        /// Map the handle ranks of a compacted graph to their offset in the pangenome sequence, with the
+        /// pangenome length in the last entry. The sequence is appended to graph_seq if it is given.
+        std::vector<uint64_t> bin_position_map(const PathHandleGraph &graph, uint64_t &len, std::string *graph_seq = nullptr);
+
+        /// Walk the path through bins of bin_width bp. The fields of each path_info_t hold the sums the means
+        /// are taken of: the number of nucleotides, how many of them are inverted and the sum of their path positions.
+        void collect_path_bins(const PathHandleGraph &graph,
+                               const path_handle_t &path,
+                               const std::vector<uint64_t> &position_map,
+                               const uint64_t &bin_width,
+                               std::map<uint64_t, path_info_t> &bins,
+                               std::vector<std::pair<uint64_t, uint64_t>> &links,
+                               uint64_t &path_length);
+
+        /// Remove the links that only step over bins the path does not visit, returning how many were removed
+        uint64_t drop_path_gap_links(const std::map<uint64_t, path_info_t> &bins,
+                                     std::vector<std::pair<uint64_t, uint64_t>> &links);
+
+        /// Bin each path of the graph and hand it to handle_path, in the order of the paths. The paths are
+        /// binned on nthreads threads, each into bins of its own; handle_path is only called from the calling thread.
         void bin_path_info(const PathHandleGraph &graph,
                            const std::string &prefix_delimiter,
                            const std::function<void(const uint64_t &, const uint64_t &)> &handle_header,
@@ -40,6 +64,19 @@ namespace odgi {
                            uint64_t num_bins = 0,
                            uint64_t bin_width = 0,
                            bool drop_gap_links = false,
-                           bool progress = false);
+                           bool progress = false,
+                           uint64_t nthreads = 1);
+
+        /// The same as above, read from a bin index at a bin_width that is a multiple of its own
+        void bin_path_info(const bin_index_t &index,
+                           const std::function<void(const uint64_t &, const uint64_t &)> &handle_header,
+                           const std::function<void(const std::string &,
+                                                    const std::vector<std::pair<uint64_t, uint64_t>> &,
+                                                    const std::map<uint64_t, algorithms::path_info_t> &)> &handle_path,
+                           const std::function<void(const uint64_t &, const std::string &)> &handle_sequence,
+                           const uint64_t &bin_width,
+                           bool drop_gap_links = false,
+                           bool progress = false,
+                           uint64_t nthreads = 1);
     }
 }
@@ -128,6 +128,130 @@ uint64_t break_cycles(
     return removed_edges;
 }
 
+std::vector<edge_t> edges_inducing_cycles(
+    const HandleGraph& graph,
+    const uint64_t& max_cycle_size,
+    const uint64_t& max_search_bp,
+    const uint64_t& iter_max,
+    const uint64_t& nthreads) {
+
+    std::vector<ska::flat_hash_set<nid_t>> components = strongly_connected_components(&graph, nthreads);
+    const nid_t min_id = graph.min_node_id();
+    const uint64_t id_range = graph.get_node_count() ? graph.max_node_id() - min_id + 1 : 0;
+    std::vector<uint64_t> component_of(id_range, std::numeric_limits<uint64_t>::max());
+    // only components with a cycle need a search: those of many nodes, or a node looping onto itself
+    std::vector<uint64_t> cyclic;
+    for (uint64_t i = 0; i < components.size(); ++i) {
+        bool has_cycle = components[i].size() > 1;
+        for (const nid_t& id : components[i]) {
+            component_of[id - min_id] = i;
+            if (!has_cycle) {
+                const handle_t h = graph.get_handle(id);
+                for (const bool go_left : {false, true}) {
+                    graph.follow_edges(h, go_left, [&](const handle_t& next) {
+                        has_cycle |= graph.get_id(next) == id;
+                    });
+                }
+            }
+        }
+        if (has_cycle) {
+            cyclic.push_back(i);
+        }
+    }
+    // start the largest tangles first, they dominate the run time
+    std::sort(cyclic.begin(), cyclic.end(), [&](const uint64_t& a, const uint64_t& b) {
+        return components[a].size() > components[b].size();
+    });
+
+    std::vector<std::vector<edge_t>> component_edges(components.size());
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+    for (uint64_t k = 0; k < cyclic.size(); ++k) {
+        const uint64_t c = cyclic[k];
+        std::vector<nid_t> ids(components[c].begin(), components[c].end());
+        std::sort(ids.begin(), ids.end());
+        auto in_component = [&](const handle_t& h) {
+            return component_of[graph.get_id(h) - min_id] == c;
+        };
+        // edges found in earlier iterations stand in for the edges the serial version has destroyed by then
+        ska::flat_hash_set<edge_t> removed;
+        for (uint64_t iter = 0; iter < iter_max; ++iter) {
+            ska::flat_hash_set<edge_t> edges_to_remove;
+            auto known = [&](const ska::flat_hash_set<edge_t>& edges, const handle_t& p, const handle_t& h) {
+                return edges.count(std::make_pair(p, h)) || edges.count(std::make_pair(graph.flip(h), graph.flip(p)));
+            };
+            for (const nid_t& id : ids) {
+                uint64_t seen_bp = 0;
+                uint64_t max_depth = 0;
+                uint64_t last_min_length_bp = 0;
+                uint64_t curr_min_length_bp = std::numeric_limits<uint64_t>::max();
+                const handle_t handle = graph.get_handle(id);
+                for (const handle_t& root_handle : { handle, graph.flip(handle) }) {
+                    bfs(graph,
+                        [&](const handle_t& h, const uint64_t& r, const uint64_t& l, const uint64_t& d) {
+                            if (d > max_depth) {
+                                max_depth = d;
+                                last_min_length_bp = curr_min_length_bp;
+                                curr_min_length_bp = l;
+                            } else {
+                                curr_min_length_bp = std::min(l, curr_min_length_bp);
+                            }
+                            seen_bp += graph.get_length(h);
+                        },
+                        [](const handle_t& h) { return false; },
+                        [&](const handle_t& p, const handle_t& h) {
+                            if (!in_component(h) || known(removed, p, h)) {
+                                return true;
+                            } else if (h == root_handle) {
+                                edges_to_remove.insert(std::make_pair(p, h));
+                                return true;
+                            } else {
+                                return known(edges_to_remove, p, h);
+                            }
+                        },
+                        [&]() {
+                            return last_min_length_bp > max_cycle_size || seen_bp > max_search_bp;
+                        },
+                        { root_handle },
+                        { },
+                        false);
+                }
+            }
+            if (edges_to_remove.empty()) {
+                break;
+            }
+            for (auto& e : edges_to_remove) {
+                component_edges[c].push_back(e);
+            }
+            removed.insert(edges_to_remove.begin(), edges_to_remove.end());
+        }
+    }
+
+    std::vector<edge_t> edges;
+    for (auto& e : component_edges) {
+        edges.insert(edges.end(), e.begin(), e.end());
+    }
+    return edges;
+}
+
+uint64_t break_cycles(
+    DeletableHandleGraph& graph,
+    const uint64_t& max_cycle_size,
+    const uint64_t& max_search_bp,
+    const uint64_t& iter_max,
+    const uint64_t& nthreads) {
+
+    std::vector<edge_t> edges_to_remove
+        = algorithms::edges_inducing_cycles(graph, max_cycle_size, max_search_bp, iter_max, nthreads);
+    if (auto* g = dynamic_cast<graph_t*>(&graph)) {
+        g->destroy_edges(edges_to_remove);
+    } else {
+        for (auto& edge : edges_to_remove) {
+            graph.destroy_edge(edge);
+        }
+    }
+    return edges_to_remove.size();
+}
+
 }
 
 }
@@ -6,6 +6,7 @@
 #include <vector>
 #include "odgi.hpp"
 #include "bfs.hpp"
+#include "strongly_connected_components.hpp"
 
 namespace odgi {
 
@@ -25,6 +26,24 @@ uint64_t break_cycles(
     const uint64_t& max_search_bp,
     const uint64_t& iter_max);
 
+// the same search run on each strongly connected component in nthreads threads, as no cycle leaves its
+// component; every component is searched up to iter_max times, skipping the edges found so far
+std::vector<edge_t> edges_inducing_cycles(
+    const HandleGraph& graph,
+    const uint64_t& max_cycle_size,
+    const uint64_t& max_search_bp,
+    const uint64_t& iter_max,
+    const uint64_t& nthreads);
+
+// breaks the cycles found across the strongly connected components in nthreads threads, returning how
+// many edges we removed
+uint64_t break_cycles(
+    DeletableHandleGraph& graph,
+    const uint64_t& max_cycle_size,
+    const uint64_t& max_search_bp,
+    const uint64_t& iter_max,
+    const uint64_t& nthreads);
+
 }
 
 }
@@ -62,6 +62,109 @@ namespace odgi {
             graph.apply_ordering(new_handles, true);
         }
 
+        void chop(const graph_t& graph, graph_t& chopped, const uint64_t& max_node_length,
+                  const uint64_t& nthreads, const bool& show_info) {
+            std::vector<handle_t> handles;
+            handles.reserve(graph.get_node_count());
+            graph.for_each_handle([&](const handle_t& handle) {
+                handles.push_back(handle);
+            });
+            const nid_t min_id = handles.empty() ? 0 : graph.min_node_id();
+            const uint64_t id_range = handles.empty() ? 0 : graph.max_node_id() - min_id + 1;
+
+            // the first new id of each node, by old id, and how many pieces it has
+            std::vector<uint64_t> first_piece(id_range, 0);
+            std::vector<uint64_t> piece_count(id_range, 0);
+#pragma omp parallel for schedule(static) num_threads(nthreads)
+            for (uint64_t i = 0; i < handles.size(); ++i) {
+                const uint64_t length = graph.get_length(handles[i]);
+                piece_count[graph.get_id(handles[i]) - min_id] =
+                        length > max_node_length ? (length + max_node_length - 1) / max_node_length : 1;
+            }
+            uint64_t total_pieces = 0;
+            uint64_t nodes_to_chop = 0;
+            for (auto& handle : handles) {
+                const uint64_t r = graph.get_id(handle) - min_id;
+                first_piece[r] = total_pieces + 1;
+                total_pieces += piece_count[r];
+                nodes_to_chop += piece_count[r] > 1;
+            }
+
+            if (show_info) {
+                std::cerr << "[odgi::chop] " << nodes_to_chop << " node(s) to chop into "
+                          << total_pieces - (handles.size() - nodes_to_chop) << " piece(s)." << std::endl;
+            }
+
+            chopped.set_number_of_threads(nthreads);
+            // the nodes are created in order, so their ids are their ranks
+            for (auto& handle : handles) {
+                const std::string sequence = graph.get_sequence(handle);
+                const uint64_t r = graph.get_id(handle) - min_id;
+                for (uint64_t j = 0; j < piece_count[r]; ++j) {
+                    chopped.create_handle(sequence.substr(j * max_node_length, max_node_length), first_piece[r] + j);
+                }
+            }
+
+            // the pieces an oriented handle enters and leaves by
+            auto entry_piece = [&](const handle_t& h) {
+                const uint64_t r = graph.get_id(h) - min_id;
+                return graph.get_is_reverse(h)
+                       ? chopped.get_handle(first_piece[r] + piece_count[r] - 1, true)
+                       : chopped.get_handle(first_piece[r], false);
+            };
+            auto exit_piece = [&](const handle_t& h) {
+                return chopped.flip(entry_piece(graph.flip(h)));
+            };
+            std::vector<std::vector<edge_t>> edges(nthreads);
+#pragma omp parallel for schedule(dynamic, 4096) num_threads(nthreads)
+            for (uint64_t i = 0; i < handles.size(); ++i) {
+                auto& thread_edges = edges[omp_get_thread_num()];
+                const uint64_t r = graph.get_id(handles[i]) - min_id;
+                for (uint64_t j = 1; j < piece_count[r]; ++j) {
+                    thread_edges.emplace_back(chopped.get_handle(first_piece[r] + j - 1, false),
+                                              chopped.get_handle(first_piece[r] + j, false));
+                }
+                // the edges of both sides, create_edges drops those found from both of their ends
+                for (auto& h : {handles[i], graph.flip(handles[i])}) {
+                    graph.follow_edges(h, false, [&](const handle_t& next) {
+                        thread_edges.emplace_back(exit_piece(h), entry_piece(next));
+                    });
+                }
+            }
+            {
+                std::vector<edge_t> all_edges;
+                for (auto& e : edges) {
+                    all_edges.insert(all_edges.end(), e.begin(), e.end());
+                    std::vector<edge_t>().swap(e);
+                }
+                chopped.create_edges(all_edges);
+            }
+
+            std::vector<path_handle_t> paths;
+            std::vector<path_handle_t> chopped_paths;
+            graph.for_each_path_handle([&](const path_handle_t& path) {
+                paths.push_back(path);
+                chopped_paths.push_back(chopped.create_path_handle(graph.get_path_name(path), graph.get_is_circular(path)));
+            });
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+            for (uint64_t i = 0; i < paths.size(); ++i) {
+                std::vector<handle_t> steps;
+                graph.for_each_step_in_path(paths[i], [&](const step_handle_t& step) {
+                    const handle_t h = graph.get_handle_of_step(step);
+                    const uint64_t r = graph.get_id(h) - min_id;
+                    if (graph.get_is_reverse(h)) {
+                        for (uint64_t j = piece_count[r]; j-- > 0;) {
+                            steps.push_back(chopped.get_handle(first_piece[r] + j, true));
+                        }
+                    } else {
+                        for (uint64_t j = 0; j < piece_count[r]; ++j) {
+                            steps.push_back(chopped.get_handle(first_piece[r] + j, false));
+                        }
+                    }
+                });
+                chopped.append_steps(chopped_paths[i], steps);
+            }
+        }
+
     }
 }
-
@@ -7,6 +7,7 @@
 #include <vector>
 
 #include "simple_components.hpp"
+#include "odgi.hpp"
 
 namespace odgi {
 namespace algorithms {
@@ -18,6 +19,14 @@ using namespace handlegraph;
  */
 void chop(handlegraph::MutablePathDeletableHandleGraph& graph, const uint64_t& max_node_length,
           const uint64_t& nthreads, const bool& show_info);
+
+/**
+ * Write the graph with its nodes cut to be less than the given max node length into the empty
+ * chopped graph, in one pass: the pieces of all nodes are planned up front, so that their ids
+ * follow the node order, and the edges and the path steps are then rewritten in parallel.
+ */
+void chop(const graph_t& graph, graph_t& chopped, const uint64_t& max_node_length,
+          const uint64_t& nthreads, const bool& show_info);
     
 }
 }
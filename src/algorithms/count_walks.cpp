@@ -1,6 +1,10 @@
 #include "count_walks.hpp"
 
-namespace vg {
+#include <atomic>
+#include <cmath>
+#include <omp.h>
+
+namespace odgi {
 namespace algorithms {
 
 using namespace std;
@@ -10,7 +14,7 @@ using namespace handlegraph;
         
         vector<handle_t> sinks;
         unordered_map<handle_t, size_t> count;
-        count.reserve(graph->node_size());
+        count.reserve(graph->get_node_count());
         
         // identify sources and sinks
         graph->for_each_handle([&](const handle_t& handle) {
@@ -55,10 +59,114 @@ using namespace handlegraph;
         // total up the walks at the sinks
         size_t total_count = 0;
         for (handle_t& sink : sinks) {
+            if (numeric_limits<size_t>::max() - total_count < count[sink]) {
+                return numeric_limits<size_t>::max();
+            }
             total_count += count[sink];
         }
         
         return total_count;
     }
+
+    // add b into a, saturating the count and summing the logs as log2(2^x + 2^y)
+    static inline void add_walks(walk_count_t& a, const walk_count_t& b) {
+        if (b.saturated || numeric_limits<uint64_t>::max() - a.count < b.count) {
+            a.count = numeric_limits<uint64_t>::max();
+            a.saturated = true;
+        } else {
+            a.count += b.count;
+        }
+        if (std::isinf(b.log2_count)) {
+            return;
+        }
+        if (std::isinf(a.log2_count)) {
+            a.log2_count = b.log2_count;
+            return;
+        }
+        const double hi = max(a.log2_count, b.log2_count);
+        const double lo = min(a.log2_count, b.log2_count);
+        a.log2_count = hi + log2(1.0 + exp2(lo - hi));
+    }
+
+    walk_count_t count_walks(const HandleGraph* graph, const uint64_t& nthreads) {
+
+        walk_count_t total;
+        if (graph->get_node_count() == 0) {
+            return total;
+        }
+        // node ids are dense in the graphs we count over, so index everything by id offset
+        const nid_t min_id = graph->min_node_id();
+        const uint64_t id_range = graph->max_node_id() - min_id + 1;
+        auto idx = [&](const handle_t& h) { return (uint64_t)(graph->get_id(h) - min_id); };
+
+        vector<handle_t> handles;
+        handles.reserve(graph->get_node_count());
+        graph->for_each_handle([&](const handle_t& handle) {
+            handles.push_back(handle);
+        });
+
+        // count down the inbound edges of each handle, the sources start the first level
+        vector<atomic<uint64_t>> pending(id_range);
+        vector<walk_count_t> count(id_range);
+        vector<handle_t> level;
+        vector<handle_t> sinks;
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(nthreads)
+        for (uint64_t i = 0; i < handles.size(); ++i) {
+            uint64_t in = 0;
+            graph->follow_edges(handles[i], true, [&](const handle_t& prev) { ++in; });
+            pending[idx(handles[i])].store(in, memory_order_relaxed);
+        }
+        for (const handle_t& handle : handles) {
+            if (pending[idx(handle)].load(memory_order_relaxed) == 0) {
+                level.push_back(handle);
+            }
+        }
+
+        vector<vector<handle_t>> next_level(nthreads);
+        vector<vector<handle_t>> thread_sinks(nthreads);
+        while (!level.empty()) {
+#pragma omp parallel for schedule(dynamic, 256) num_threads(nthreads)
+            for (uint64_t i = 0; i < level.size(); ++i) {
+                const handle_t& handle = level[i];
+                const int tid = omp_get_thread_num();
+                // the predecessors are all in earlier levels, so their counts are final
+                walk_count_t& here = count[idx(handle)];
+                bool is_source = true;
+                graph->follow_edges(handle, true, [&](const handle_t& prev) {
+                    is_source = false;
+                    add_walks(here, count[idx(prev)]);
+                });
+                if (is_source) {
+                    here.count = 1;
+                    here.log2_count = 0;
+                }
+                bool is_sink = true;
+                graph->follow_edges(handle, false, [&](const handle_t& next) {
+                    is_sink = false;
+                    if (pending[idx(next)].fetch_sub(1, memory_order_acq_rel) == 1) {
+                        next_level[tid].push_back(next);
+                    }
+                });
+                if (is_sink) {
+                    thread_sinks[tid].push_back(handle);
+                }
+            }
+            level.clear();
+            for (auto& l : next_level) {
+                level.insert(level.end(), l.begin(), l.end());
+                l.clear();
+            }
+        }
+
+        // total up the walks at the sinks, in id order so the log sum does not depend on the threads
+        for (auto& s : thread_sinks) {
+            sinks.insert(sinks.end(), s.begin(), s.end());
+        }
+        sort(sinks.begin(), sinks.end(), [&](const handle_t& a, const handle_t& b) { return idx(a) < idx(b); });
+        for (const handle_t& sink : sinks) {
+            add_walks(total, count[idx(sink)]);
+        }
+        return total;
+    }
 }
 }
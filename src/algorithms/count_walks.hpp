@@ -13,7 +13,7 @@
 #include <unordered_map>
 #include <vector>
 
-namespace vg {
+namespace odgi {
 namespace algorithms {
 
 using namespace std;
@@ -26,6 +26,22 @@ using namespace handlegraph;
     /// than this.
     size_t count_walks(const HandleGraph* graph);
 
+    /// A number of walks that does not wrap around
+    struct walk_count_t {
+        /// the count, or numeric_limits<uint64_t>::max() if it is at least that large
+        uint64_t count = 0;
+        /// true if count hit its maximum
+        bool saturated = false;
+        /// log2 of the count, kept on however large it gets; -infinity for no walks
+        double log2_count = -numeric_limits<double>::infinity();
+    };
+
+    /// The same count over the forward handles of a single-stranded DAG, made level by level
+    /// with nthreads threads: each level holds the handles whose inbound edges all come from
+    /// earlier levels, and every handle of a level pulls the sum of its predecessors' counts.
+    /// Besides the saturated count, a log2 count is kept for walk numbers beyond 64 bits.
+    walk_count_t count_walks(const HandleGraph* graph, const uint64_t& nthreads);
+
 }
 }
 
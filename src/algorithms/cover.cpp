@@ -68,6 +68,60 @@ namespace odgi {
             return head_nodes;
         }
 
+        std::vector<uint8_t>
+        nice_and_acyclic_components(const HandleGraph &graph, const component_labels_t &labels, const uint64_t &nthreads) {
+            std::vector<uint8_t> acyclic(labels.size(), 0);
+            constexpr size_t NOT_SEEN = std::numeric_limits<size_t>::max();
+            std::vector<size_t> indegree(labels.nodes.size(), NOT_SEEN); // remaining indegree
+            std::vector<uint8_t> orientation(labels.nodes.size(), 0);
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+            for (uint64_t c = 0; c < labels.size(); ++c) {
+                std::stack<handle_t> active;
+                size_t found = 0; // Number of nodes that have become head nodes.
+
+                // Find the head nodes.
+                for (uint64_t m = labels.first_member[c]; m < labels.first_member[c + 1]; ++m) {
+                    const uint64_t i = labels.members[m];
+                    handle_t handle = graph.get_handle(graph.get_id(labels.nodes[i]), false);
+                    if (graph.get_degree(handle, true) == 0) {
+                        indegree[i] = 0;
+                        active.push(handle);
+                        found++;
+                    }
+                }
+
+                // Process the successors as in is_nice_and_acyclic.
+                bool ok = true;
+                while (!(active.empty())) {
+                    handle_t curr = active.top();
+                    active.pop();
+                    graph.follow_edges(curr, false, [&](const handle_t &next) -> bool {
+                        const uint64_t i = labels.index_of(graph.get_id(next));
+                        const uint8_t next_orientation = graph.get_is_reverse(next);
+                        if (indegree[i] == NOT_SEEN) // First visit to the node.
+                        {
+                            indegree[i] = graph.get_degree(next, true);
+                            orientation[i] = next_orientation;
+                        } else if (next_orientation != orientation[i]) // Already visited, wrong orientation.
+                        {
+                            ok = false;
+                            return false;
+                        }
+                        indegree[i]--;
+                        if (indegree[i] == 0) {
+                            active.push(next);
+                            found++;
+                        }
+                        return true;
+                    });
+                    if (!ok) { break; }
+                }
+                acyclic[c] = ok && found == labels.component_size(c) && found > 0;
+            }
+            return acyclic;
+        }
+
         template<class NodeCoverage>
         size_t
         find_first(std::vector<NodeCoverage> &array, nid_t id) {
@@ -238,6 +292,7 @@ namespace odgi {
                              size_t num_paths_per_component, size_t node_window_size,
                              size_t min_node_depth, size_t max_number_of_paths_generable,
                              bool write_node_depth, std::string &node_depth,
+                             std::vector<std::vector<handle_t>> &new_paths,
                              const uint64_t& nthreads, const bool& ignore_paths, const bool& show_progress) {
             typedef typename Coverage::coverage_t coverage_t;
             typedef typename Coverage::node_coverage_t node_coverage_t;
@@ -247,6 +302,7 @@ namespace odgi {
             ska::flat_hash_set<handlegraph::nid_t> head_nodes = is_nice_and_acyclic(graph, component);
             bool acyclic = !(head_nodes.empty());
             if (show_progress) {
+#pragma omp critical (cerr)
                 std::cerr << Coverage::name() << ": processing component " << (component_id + 1) << " / "
                           << components.size() << ", which has " << component.size() << " node(s) and it is "
                           << (acyclic ? "acyclic." : "cyclic.") << std::endl;
@@ -262,6 +318,7 @@ namespace odgi {
             // For example, if there are no haplotypes for LocalHaplotypes.
             if (all_nodes_depth.empty()) {
                 if (show_progress) {
+#pragma omp critical (cerr)
                     std::cerr << Coverage::name() << ": Cannot find this type of path cover for the component"
                               << std::endl;
                 }
@@ -293,6 +350,7 @@ namespace odgi {
 
                 if (all_nodes_depth.front().second >= min_node_depth) {
                     if (show_progress) {
+#pragma omp critical (cerr)
                         std::cerr << Coverage::name() << ": minimum node depth reached after generating " << i << " paths." << std::endl;
                     }
 
@@ -318,11 +376,8 @@ namespace odgi {
                     }
                 }
 
-                path_handle_t new_path = graph.create_path_handle(
-                        "Path_" + std::to_string(component_id) + "_" + std::to_string(i));
-                for (handle_t handle : path) {
-                    graph.append_step(new_path, handle);
-                }
+                // written by the caller as Path_<component_id>_<i>, once all components are covered
+                new_paths.emplace_back(path.begin(), path.end());
 
 #ifdef debug_cover
                 std::cerr << "Path_" + std::to_string(component_id) + "_" + std::to_string(i) << ":";
@@ -334,14 +389,11 @@ namespace odgi {
             }
 
             if ((min_node_depth != std::numeric_limits<uint64_t>::max()) && (i >= num_paths_per_component)){
+#pragma omp critical (cerr)
                 std::cerr << Coverage::name() <<": maximum number of generable paths reached." << std::endl;
             }
 
             if (write_node_depth) {
-                if (component_id == 0) {
-                    node_depth += "component_id\tnode_id\tdepth\n";
-                }
-
                 for (node_coverage_t single_depth : all_nodes_depth) {
                     node_depth +=
                             std::to_string(component_id) + "\t" + std::to_string(single_depth.first) + "\t" +
@@ -358,26 +410,53 @@ namespace odgi {
                         bool write_node_depth, std::string &node_depth,
                         const uint64_t& nthreads, const bool& ignore_paths, const bool& show_progress) {
             std::vector<ska::flat_hash_set<handlegraph::nid_t>> weak_components = algorithms::weakly_connected_components(
-                    &graph);
-
-            // Handle each component separately.
-            size_t processed_components = 0;
-            for (size_t contig = 0; contig < weak_components.size(); contig++) {
+                    &graph, nthreads);
+
+            // Handle each component separately, one per thread. The components only read the graph, and
+            // their paths are written afterwards, in component order.
+            const uint64_t component_count = weak_components.size();
+            const uint64_t threads_per_component = component_count > 1 ? 1 : nthreads;
+            std::vector<std::vector<std::vector<handle_t>>> component_paths(component_count);
+            std::vector<std::string> component_node_depths(component_count);
+            std::atomic<uint64_t> processed_components(0);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+            for (size_t contig = 0; contig < component_count; contig++) {
                 if (component_path_cover<SimpleCoverage>(graph, weak_components, contig,
                                                          num_paths_per_component, node_window_size,
                                                          min_node_depth, max_number_of_paths_generable,
-                                                         write_node_depth, node_depth,
-                                                         nthreads, ignore_paths, show_progress)) {
-                    processed_components++;
+                                                         write_node_depth, component_node_depths[contig],
+                                                         component_paths[contig],
+                                                         threads_per_component, ignore_paths, show_progress)) {
+                    const uint64_t processed = ++processed_components;
 
                     if (show_progress) {
-                        std::cerr << "[odgi::path_cover] Processed: " << processed_components << std::endl;
+#pragma omp critical (cerr)
+                        std::cerr << "[odgi::path_cover] Processed: " << processed << std::endl;
                     }
                 }
             }
-        }
 
+            std::vector<std::pair<path_handle_t, const std::vector<handle_t>*>> to_write;
+            for (size_t contig = 0; contig < component_count; contig++) {
+                for (uint64_t i = 0; i < component_paths[contig].size(); ++i) {
+                    to_write.emplace_back(graph.create_path_handle(
+                            "Path_" + std::to_string(contig) + "_" + std::to_string(i)), &component_paths[contig][i]);
+                }
+            }
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+            for (uint64_t i = 0; i < to_write.size(); ++i) {
+                for (handle_t handle : *to_write[i].second) {
+                    graph.append_step(to_write[i].first, handle);
+                }
+            }
 
+            if (write_node_depth) {
+                node_depth += "component_id\tnode_id\tdepth\n";
+                for (auto &depths : component_node_depths) {
+                    node_depth += depths;
+                }
+            }
+        }
 
 void hogwild_path_cover(handlegraph::MutablePathDeletableHandleGraph &graph,
                         double target_depth,
@@ -385,25 +464,32 @@ void hogwild_path_cover(handlegraph::MutablePathDeletableHandleGraph &graph,
 
     // get depth -> graph depth
     uint64_t node_count = graph.get_node_count();
-    uint64_t graph_bp = 0;
     uint64_t step_count = 0;
-    // make a rank select dictionary over our sequence space
-    // to get a node randomly distributed in the total length of the graph
+    // the nodes by rank, with the offset of their end in the total length of the graph,
+    // to get a node randomly distributed in the sequence space
+    std::vector<handle_t> handles;
+    std::vector<uint64_t> node_ends;
+    handles.reserve(node_count);
+    node_ends.reserve(node_count);
+    uint64_t graph_bp = 0;
     graph.for_each_handle(
         [&](const handle_t& h) {
             graph_bp += graph.get_length(h);
             step_count += graph.get_step_count(h);
+            handles.push_back(h);
+            node_ends.push_back(graph_bp);
         });
-    //sdsl::bit_vector graph_vec();
-    sdsl::bit_vector graph_bv(graph_bp);
-    graph_bp = 0;
-    graph.for_each_handle(
-        [&](const handle_t& h) {
-            graph_bv[graph_bp] = 1;
-            graph_bp += graph.get_length(h);
-        });
-    sdsl::bit_vector::rank_1_type graph_bv_rank;
-    sdsl::util::assign(graph_bv_rank, sdsl::bit_vector::rank_1_type(&graph_bv));
+    if (graph_bp == 0) {
+        return;
+    }
+    const nid_t min_id = graph.min_node_id();
+    std::vector<uint64_t> node_rank(graph.max_node_id() - min_id + 1, 0);
+    // the depth every thread has reduced its local depth into
+    std::vector<uint64_t> shared_depth(node_count);
+    for (uint64_t i = 0; i < node_count; ++i) {
+        node_rank[graph.get_id(handles[i]) - min_id] = i;
+        shared_depth[i] = graph.get_step_count(handles[i]);
+    }
     uint64_t target_step_count = node_count * target_depth - (ignore_paths ? 0 : step_count);
     // run hogwild until our thread count is
     std::unique_ptr<progress_meter::ProgressMeter> progress_meter;
@@ -411,7 +497,8 @@ void hogwild_path_cover(handlegraph::MutablePathDeletableHandleGraph &graph,
         progress_meter = std::make_unique<progress_meter::ProgressMeter>(
             target_step_count, "[odgi::hogwild_cover] covering the graph:");
     }
-    // launch a thread to update the learning rate, count iterations, and decide when to stop
+    // how many steps a thread may take before the others see the depth it added
+    const uint64_t reduce_interval = 4096;
     std::atomic<uint64_t> added_steps; added_steps.store(0);
     std::atomic<uint64_t> added_paths; added_paths.store(0);
     auto worker_lambda =
@@ -423,19 +510,40 @@ void hogwild_path_cover(handlegraph::MutablePathDeletableHandleGraph &graph,
             // we'll sample from all path steps
             std::uniform_int_distribution<uint64_t> dis_graph_pos = std::uniform_int_distribution<uint64_t>(0, graph_bp-1);
             std::uniform_int_distribution<uint64_t> flip(0, 1);
+            // the depth this thread added since its last reduction
+            ska::flat_hash_map<uint64_t, uint64_t> local_depth;
+            uint64_t local_steps = 0;
+            auto reduce = [&](void) {
+                for (auto& d : local_depth) {
+                    __atomic_fetch_add(&shared_depth[d.first], d.second, __ATOMIC_RELAXED);
+                }
+                local_depth.clear();
+                if (show_progress) progress_meter->increment(local_steps);
+                local_steps = 0;
+            };
+            auto depth = [&](const handle_t& h) {
+                const uint64_t r = node_rank[graph.get_id(h) - min_id];
+                auto f = local_depth.find(r);
+                return __atomic_load_n(&shared_depth[r], __ATOMIC_RELAXED) + (f != local_depth.end() ? f->second : 0);
+            };
+            auto random_handle = [&](void) {
+                const uint64_t r = std::upper_bound(node_ends.begin(), node_ends.end(), dis_graph_pos(gen)) - node_ends.begin();
+                return flip(gen) ? graph.flip(handles[r]) : handles[r];
+            };
+            std::vector<handle_t> steps;
             while (added_steps.load() < target_step_count) {
                 // create a path
                 std::stringstream ss;
                 ss << "cover_" << added_paths++;
                 path_handle_t path = graph.create_path_handle(ss.str());
                 // find a random handle
-                handle_t h = graph.get_handle(graph_bv_rank(dis_graph_pos(gen)), flip(gen));
+                handle_t h = random_handle();
                 uint64_t iter = 0;
                 handle_t lowest;
                 bool seen_low = false;
-                while (graph.get_step_count(h) > 0 && iter++ < 100) {
-                    h = graph.get_handle(graph_bv_rank(dis_graph_pos(gen)), flip(gen));
-                    if (!seen_low || graph.get_step_count(h) < graph.get_step_count(lowest)) {
+                while (depth(h) > 0 && iter++ < 100) {
+                    h = random_handle();
+                    if (!seen_low || depth(h) < depth(lowest)) {
                         lowest = h;
                         seen_low = true;
                     }
@@ -444,10 +552,13 @@ void hogwild_path_cover(handlegraph::MutablePathDeletableHandleGraph &graph,
                     h = lowest;
                 }
                 while (true) {
-                    graph.append_step(path, h);
-                    if (show_progress) progress_meter->increment(1);
-                    ++added_steps;
-                    if (added_steps.load() >= target_step_count) {
+                    steps.push_back(h);
+                    ++local_depth[node_rank[graph.get_id(h) - min_id]];
+                    ++local_steps;
+                    if (local_steps >= reduce_interval) {
+                        reduce();
+                    }
+                    if (++added_steps >= target_step_count) {
                         break;
                     }
                     handle_t best_next;
@@ -455,7 +566,7 @@ void hogwild_path_cover(handlegraph::MutablePathDeletableHandleGraph &graph,
                     graph.follow_edges(
                         h, false,
                         [&](const handle_t& n) {
-                            uint64_t next_cov = graph.get_step_count(n);
+                            uint64_t next_cov = depth(n);
                             if (next_cov < lowest_cov) {
                                 best_next = n;
                                 lowest_cov = next_cov;
@@ -467,6 +578,12 @@ void hogwild_path_cover(handlegraph::MutablePathDeletableHandleGraph &graph,
                         break;
                     }
                 }
+                // write the path at once, and let the others see its depth
+                for (auto& step : steps) {
+                    graph.append_step(path, step);
+                }
+                steps.clear();
+                reduce();
             }
         };
 
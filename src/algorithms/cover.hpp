@@ -31,6 +31,14 @@ namespace algorithms {
         ska::flat_hash_set<handlegraph::nid_t>
         is_nice_and_acyclic(const HandleGraph &graph, const ska::flat_hash_set<handlegraph::nid_t> &component);
 
+        /*
+          The same test for all components of the labels at once, one component per thread, as 1 for the nice and
+          acyclic components and 0 for the others. The indegrees and orientations are kept in arrays over all
+          nodes, which the threads share as each component only touches its own nodes.
+        */
+        std::vector<uint8_t>
+        nice_and_acyclic_components(const HandleGraph &graph, const component_labels_t &labels, const uint64_t &nthreads);
+
         /*
           Find a path cover of the graph with num_paths_per_component paths per component, adding the generated paths in
           the graph. The path cover is built greedily. Each time we extend a path, we choose the extension,
@@ -0,0 +1,306 @@
+#include "coverage_matrix.hpp"
+#include "progress.hpp"
+#include "memory_budget.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <filesystem>
+#include <memory>
+
+namespace odgi {
+namespace algorithms {
+
+static const char COVERAGE_MATRIX_MAGIC[8] = {'O', 'D', 'G', 'I', 'C', 'O', 'V', 'M'};
+static const uint64_t COVERAGE_MATRIX_VERSION = 1;
+
+template<typename T>
+static void write_vector(std::ostream &out, const std::vector<T> &v) {
+    const uint64_t n = v.size();
+    out.write((const char *) &n, sizeof(n));
+    out.write((const char *) v.data(), n * sizeof(T));
+}
+
+template<typename T>
+static bool read_vector(std::istream &in, std::vector<T> &v) {
+    uint64_t n = 0;
+    if (!in.read((char *) &n, sizeof(n))) {
+        return false;
+    }
+    v.resize(n);
+    return n == 0 || (bool) in.read((char *) v.data(), n * sizeof(T));
+}
+
+template<typename T>
+static bool read_value(std::istream &in, T &v) {
+    return (bool) in.read((char *) &v, sizeof(T));
+}
+
+bool coverage_matrix_t::build(const PathHandleGraph &graph,
+                              const uint64_t &nthreads,
+                              const bool &progress,
+                              const coverage_block_counter_t &count_block) {
+    node_count = graph.get_node_count();
+    min_id = node_count ? graph.min_node_id() : 0;
+    if (node_count && (uint64_t) (graph.max_node_id() - min_id) + 1 != node_count) {
+        return false;
+    }
+    path_handles.clear();
+    path_names.clear();
+    path_ranks.clear();
+    graph.for_each_path_handle([&](const path_handle_t &path) {
+        path_ranks[path] = path_handles.size();
+        path_handles.push_back(path);
+        path_names.push_back(graph.get_path_name(path));
+    });
+
+    // each block of nodes is run-length encoded on its own, then the blocks are stitched together
+    struct block_t {
+        std::vector<uint64_t> first_node;
+        std::vector<uint64_t> lengths;
+        std::vector<uint64_t> offsets;
+        std::vector<uint32_t> paths;
+        std::vector<uint32_t> counts;
+    };
+    // the dense blocks of count_block hold a count per node and path
+    const uint64_t block_size = count_block
+        ? std::max((uint64_t) 1, memory_budget::buffer_bytes(0.25, (uint64_t) 1 << 28) / sizeof(uint32_t)
+                                 / std::max((uint64_t) 1, (uint64_t) path_handles.size()))
+        : 1 << 14;
+    const uint64_t block_count = (node_count + block_size - 1) / block_size;
+    std::vector<block_t> blocks(block_count);
+    std::unique_ptr<progress_meter::ProgressMeter> progress_meter;
+    if (progress) {
+        progress_meter = std::make_unique<progress_meter::ProgressMeter>(
+                node_count, "[odgi::coverage_matrix] collecting the steps on the nodes:");
+    }
+#pragma omp parallel for schedule(dynamic, 1) num_threads(count_block ? 1 : nthreads)
+    for (uint64_t b = 0; b < block_count; ++b) {
+        block_t &block = blocks[b];
+        block.offsets.push_back(0);
+        std::vector<uint32_t> on_node;
+        std::vector<std::pair<uint32_t, uint32_t>> row;
+        const uint64_t end = std::min(node_count, (b + 1) * block_size);
+        std::vector<uint32_t> dense;
+        if (count_block) {
+            dense.assign((end - b * block_size) * path_handles.size(), 0);
+            count_block(b * block_size, end, dense);
+        }
+        for (uint64_t r = b * block_size; r < end; ++r) {
+            const handle_t h = graph.get_handle(min_id + r);
+            row.clear();
+            if (count_block) {
+                const uint32_t *counts = dense.data() + (r - b * block_size) * path_handles.size();
+                for (uint32_t p = 0; p < path_handles.size(); ++p) {
+                    if (counts[p] > 0) {
+                        row.emplace_back(p, counts[p]);
+                    }
+                }
+            } else {
+                on_node.clear();
+                graph.for_each_step_on_handle(h, [&](const step_handle_t &step) {
+                    on_node.push_back(path_ranks.at(graph.get_path_handle_of_step(step)));
+                });
+                std::sort(on_node.begin(), on_node.end());
+                for (auto &p : on_node) {
+                    if (!row.empty() && row.back().first == p) {
+                        ++row.back().second;
+                    } else {
+                        row.emplace_back(p, 1);
+                    }
+                }
+            }
+            const uint64_t l = graph.get_length(h);
+            bool same = !block.first_node.empty() && row.size() == block.offsets.back() - block.offsets[block.offsets.size() - 2];
+            for (uint64_t i = 0; same && i < row.size(); ++i) {
+                const uint64_t e = block.offsets[block.offsets.size() - 2] + i;
+                same = block.paths[e] == row[i].first && block.counts[e] == row[i].second;
+            }
+            if (same) {
+                block.lengths.back() += l;
+            } else {
+                block.first_node.push_back(r);
+                block.lengths.push_back(l);
+                for (auto &e : row) {
+                    block.paths.push_back(e.first);
+                    block.counts.push_back(e.second);
+                }
+                block.offsets.push_back(block.paths.size());
+            }
+        }
+        if (progress) {
+            progress_meter->increment(end - b * block_size);
+        }
+    }
+    if (progress) {
+        progress_meter->finish();
+    }
+
+    run_first_node.clear();
+    run_lengths.clear();
+    row_offsets.assign(1, 0);
+    entry_paths.clear();
+    entry_counts.clear();
+    for (auto &block : blocks) {
+        for (uint64_t i = 0; i < block.first_node.size(); ++i) {
+            const uint64_t begin = block.offsets[i];
+            const uint64_t end = block.offsets[i + 1];
+            bool same = i == 0 && !run_first_node.empty() && end - begin == row_offsets.back() - row_offsets[row_offsets.size() - 2];
+            for (uint64_t j = 0; same && j < end - begin; ++j) {
+                const uint64_t e = row_offsets[row_offsets.size() - 2] + j;
+                same = entry_paths[e] == block.paths[begin + j] && entry_counts[e] == block.counts[begin + j];
+            }
+            if (same) {
+                run_lengths.back() += block.lengths[i];
+                continue;
+            }
+            run_first_node.push_back(block.first_node[i]);
+            run_lengths.push_back(block.lengths[i]);
+            entry_paths.insert(entry_paths.end(), block.paths.begin() + begin, block.paths.begin() + end);
+            entry_counts.insert(entry_counts.end(), block.counts.begin() + begin, block.counts.begin() + end);
+            row_offsets.push_back(entry_paths.size());
+        }
+        block = block_t();
+    }
+
+    path_lengths.assign(path_handles.size(), 0);
+    path_step_counts.assign(path_handles.size(), 0);
+    total_length = 0;
+    total_steps = 0;
+    for (uint64_t run = 0; run < run_first_node.size(); ++run) {
+        total_length += run_lengths[run];
+        for_each_path_in_run(run, [&](const uint64_t &p, const uint64_t &c) {
+            path_lengths[p] += c * run_lengths[run];
+            path_step_counts[p] += c * get_run_node_count(run);
+            total_steps += c * get_run_node_count(run);
+        });
+    }
+    return true;
+}
+
+void coverage_matrix_t::serialize(std::ostream &out) const {
+    out.write(COVERAGE_MATRIX_MAGIC, sizeof(COVERAGE_MATRIX_MAGIC));
+    out.write((const char *) &COVERAGE_MATRIX_VERSION, sizeof(COVERAGE_MATRIX_VERSION));
+    out.write((const char *) &node_count, sizeof(node_count));
+    out.write((const char *) &min_id, sizeof(min_id));
+    out.write((const char *) &total_length, sizeof(total_length));
+    out.write((const char *) &total_steps, sizeof(total_steps));
+    write_vector(out, run_first_node);
+    write_vector(out, run_lengths);
+    write_vector(out, row_offsets);
+    write_vector(out, entry_paths);
+    write_vector(out, entry_counts);
+    write_vector(out, path_lengths);
+    write_vector(out, path_step_counts);
+    for (auto &name : path_names) {
+        const uint64_t n = name.size();
+        out.write((const char *) &n, sizeof(n));
+        out.write(name.data(), n);
+    }
+}
+
+bool coverage_matrix_t::load(std::istream &in, const PathHandleGraph &graph) {
+    char magic[sizeof(COVERAGE_MATRIX_MAGIC)];
+    uint64_t version = 0;
+    if (!in.read(magic, sizeof(magic))
+        || !std::equal(magic, magic + sizeof(magic), COVERAGE_MATRIX_MAGIC)
+        || !read_value(in, version) || version != COVERAGE_MATRIX_VERSION
+        || !read_value(in, node_count) || !read_value(in, min_id)
+        || !read_value(in, total_length) || !read_value(in, total_steps)
+        || !read_vector(in, run_first_node) || !read_vector(in, run_lengths)
+        || !read_vector(in, row_offsets) || !read_vector(in, entry_paths) || !read_vector(in, entry_counts)
+        || !read_vector(in, path_lengths) || !read_vector(in, path_step_counts)) {
+        return false;
+    }
+    if (row_offsets.size() != run_first_node.size() + 1 || run_lengths.size() != run_first_node.size()
+        || entry_counts.size() != entry_paths.size() || row_offsets.back() != entry_paths.size()
+        || path_step_counts.size() != path_lengths.size()
+        || (!run_first_node.empty() && run_first_node.back() >= node_count)) {
+        return false;
+    }
+    // the matrix must describe this graph, in its current node order
+    if (node_count != graph.get_node_count() || path_lengths.size() != graph.get_path_count()
+        || (node_count && min_id != graph.min_node_id())) {
+        return false;
+    }
+    path_names.resize(path_lengths.size());
+    path_handles.clear();
+    path_ranks.clear();
+    uint64_t steps = 0;
+    for (uint64_t i = 0; i < path_names.size(); ++i) {
+        uint64_t n = 0;
+        if (!read_value(in, n)) {
+            return false;
+        }
+        path_names[i].resize(n);
+        if (n && !in.read(&path_names[i][0], n)) {
+            return false;
+        }
+        if (!graph.has_path(path_names[i])) {
+            return false;
+        }
+        const path_handle_t path = graph.get_path_handle(path_names[i]);
+        if (graph.get_step_count(path) != path_step_counts[i]) {
+            return false;
+        }
+        steps += path_step_counts[i];
+        path_ranks[path] = i;
+        path_handles.push_back(path);
+    }
+    if (steps != total_steps) {
+        return false;
+    }
+    // a sorted graph keeps its sums, but not its runs: each run must still cover nodes of its length,
+    // and its first node the steps of its paths
+    for (uint64_t run = 0; run < run_first_node.size(); ++run) {
+        uint64_t length = 0;
+        const uint64_t first = run_first_node[run];
+        for (uint64_t r = first; r < first + get_run_node_count(run); ++r) {
+            length += graph.get_length(graph.get_handle(min_id + r));
+        }
+        uint64_t depth = 0;
+        for_each_path_in_run(run, [&](const uint64_t &p, const uint64_t &c) {
+            depth += c;
+        });
+        if (length != run_lengths[run] || graph.get_step_count(graph.get_handle(min_id + first)) != depth) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool coverage_matrix_t::load_or_build(const std::string &file,
+                                      const PathHandleGraph &graph,
+                                      const uint64_t &nthreads,
+                                      const bool &progress,
+                                      const std::string &subcommand_name,
+                                      const coverage_block_counter_t &count_block) {
+    if (!file.empty() && std::filesystem::exists(file)) {
+        std::ifstream in(file, std::ios::binary);
+        if (load(in, graph)) {
+            return true;
+        }
+        std::cerr << "[odgi::" << subcommand_name << "] warning: the coverage matrix \"" << file
+                  << "\" was not built for this graph, building it again." << std::endl;
+    }
+    if (!build(graph, nthreads, progress, count_block)) {
+        std::cerr << "[odgi::" << subcommand_name << "] error: the node IDs are not compacted. Please run 'odgi sort' using -O, --optimize to optimize the graph." << std::endl;
+        return false;
+    }
+    if (file.empty()) {
+        return true;
+    }
+    std::ofstream out(file, std::ios::binary);
+    serialize(out);
+    if (!out) {
+        std::cerr << "[odgi::" << subcommand_name << "] error: could not write the coverage matrix to \"" << file << "\"." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+uint64_t coverage_matrix_t::get_run_of_node(const uint64_t &node_rank) const {
+    return std::upper_bound(run_first_node.begin(), run_first_node.end(), node_rank) - run_first_node.begin() - 1;
+}
+
+}
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+/**
+ * \file coverage_matrix.hpp
+ *
+ * Defines a sparse node by path matrix of step counts, that can be cached beside a graph.
+ */
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <iostream>
+#include <functional>
+#include <handlegraph/path_handle_graph.hpp>
+#include <handlegraph/util.hpp>
+#include "hash_map.hpp"
+
+namespace odgi {
+namespace algorithms {
+
+using namespace handlegraph;
+
+/// Fills counts, dense and zeroed, with the steps of each path on the nodes whose ranks are in [first, end),
+/// the count of path rank p on node rank r at (r - first) * path_count + p, as a GPU does for build
+using coverage_block_counter_t = std::function<void(const uint64_t &first, const uint64_t &end, std::vector<uint32_t> &counts)>;
+
+/// How many times each path steps on each node of a graph with compacted node ids.
+/// The rows are the nodes in id order, stored in compressed sparse row form with one entry per
+/// path on the node. Consecutive nodes crossed by the same paths the same number of times, as
+/// along the conserved stretches of a pangenome, share one row, called a run.
+/// The paths are ranked in the order of for_each_path_handle.
+class coverage_matrix_t {
+public:
+
+    /// Collect the steps on the nodes of a graph, in blocks of nodes in parallel, or one block after
+    /// the other from count_block if it is given. The node ids must be compacted, false if they are not.
+    bool build(const PathHandleGraph &graph,
+               const uint64_t &nthreads,
+               const bool &progress,
+               const coverage_block_counter_t &count_block = nullptr);
+
+    void serialize(std::ostream &out) const;
+
+    /// Read a matrix written by serialize, false if the stream does not hold one or it was
+    /// not built for this graph
+    bool load(std::istream &in, const PathHandleGraph &graph);
+
+    /// Load the matrix from file if it was built for this graph, else build it and write it
+    /// there to be loaded by the next run, or only build it if file is empty. Errors are reported
+    /// for the given subcommand.
+    bool load_or_build(const std::string &file,
+                       const PathHandleGraph &graph,
+                       const uint64_t &nthreads,
+                       const bool &progress,
+                       const std::string &subcommand_name,
+                       const coverage_block_counter_t &count_block = nullptr);
+
+    uint64_t get_node_count(void) const {
+        return node_count;
+    }
+
+    uint64_t get_path_count(void) const {
+        return path_handles.size();
+    }
+
+    uint64_t get_run_count(void) const {
+        return run_first_node.size();
+    }
+
+    /// The rank of the first node of the run, in id order
+    uint64_t get_run_first_node(const uint64_t &run) const {
+        return run_first_node[run];
+    }
+
+    /// The number of nodes in the run
+    uint64_t get_run_node_count(const uint64_t &run) const {
+        return (run + 1 < run_first_node.size() ? run_first_node[run + 1] : node_count) - run_first_node[run];
+    }
+
+    /// The sum of the lengths of the nodes in the run
+    uint64_t get_run_length(const uint64_t &run) const {
+        return run_lengths[run];
+    }
+
+    /// The run holding the node of this rank
+    uint64_t get_run_of_node(const uint64_t &node_rank) const;
+
+    /// The rank of the node with this id in a compacted graph
+    uint64_t get_node_rank(const nid_t &id) const {
+        return (uint64_t) (id - min_id);
+    }
+
+    /// Call func(path_rank, step_count) for each path on the nodes of the run, by increasing path rank
+    template<typename F>
+    void for_each_path_in_run(const uint64_t &run, const F &func) const {
+        for (uint64_t i = row_offsets[run]; i < row_offsets[run + 1]; ++i) {
+            func((uint64_t) entry_paths[i], (uint64_t) entry_counts[i]);
+        }
+    }
+
+    path_handle_t get_path_handle(const uint64_t &path_rank) const {
+        return path_handles[path_rank];
+    }
+
+    uint64_t get_path_rank(const path_handle_t &path) const {
+        return path_ranks.at(path);
+    }
+
+    uint64_t get_path_length(const uint64_t &path_rank) const {
+        return path_lengths[path_rank];
+    }
+
+    uint64_t get_path_step_count(const uint64_t &path_rank) const {
+        return path_step_counts[path_rank];
+    }
+
+private:
+
+    uint64_t node_count = 0;
+    nid_t min_id = 0;
+    uint64_t total_length = 0;
+    uint64_t total_steps = 0;
+    std::vector<uint64_t> run_first_node;
+    std::vector<uint64_t> run_lengths;
+    std::vector<uint64_t> row_offsets;
+    std::vector<uint32_t> entry_paths;
+    std::vector<uint32_t> entry_counts;
+    std::vector<std::string> path_names;
+    std::vector<uint64_t> path_lengths;
+    std::vector<uint64_t> path_step_counts;
+    std::vector<path_handle_t> path_handles;
+    ska::flat_hash_map<path_handle_t, uint64_t> path_ranks;
+};
+
+}
+}
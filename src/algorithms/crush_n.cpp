@@ -1,27 +1,41 @@
 #include "crush_n.hpp"
+#include <cstring>
 
 namespace odgi {
 namespace algorithms {
 
 void crush_n(odgi::graph_t& graph) {
+    // Ns are stored outside the packed bases, so finding the nodes with runs of them decodes nothing
+    std::vector<handle_t> to_crush;
     graph.for_each_handle([&](const handle_t& handle) {
-        // strip Ns from start
-        std::string seq;
-        bool in_n = false;
-        for (auto c : graph.get_sequence(handle)) {
-            if (c == 'N') {
-                if (in_n) {
-                    continue;
-                } else {
-                    in_n = true;
-                }
-            } else {
-                in_n = false;
-            }
-            seq.push_back(c);
+        if (graph.has_base_run(handle, 'N')) {
+#pragma omp critical (crush_n)
+            to_crush.push_back(handle);
         }
-        graph.set_handle_sequence(handle, seq);
     }, true); // in parallel
+
+#pragma omp parallel for schedule(dynamic, 1)
+    for (uint64_t i = 0; i < to_crush.size(); ++i) {
+        const std::string seq = graph.get_sequence(to_crush[i]);
+        std::string crushed;
+        crushed.reserve(seq.size());
+        const char* p = seq.data();
+        const char* end = p + seq.size();
+        // keep the first N of each run and skip the rest
+        while (p < end) {
+            const char* n = (const char*)std::memchr(p, 'N', end - p);
+            if (n == nullptr) {
+                crushed.append(p, end);
+                break;
+            }
+            crushed.append(p, n + 1);
+            p = n + 1;
+            while (p < end && *p == 'N') {
+                ++p;
+            }
+        }
+        graph.set_handle_sequence(to_crush[i], crushed);
+    }
 }
 
 }
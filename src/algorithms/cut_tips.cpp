@@ -15,9 +15,12 @@ std::vector<handle_t> tip_handles(
             if (graph.get_degree(handle, false) == 0
                 // might be more correct if this were xor
                 || graph.get_degree(handle, true) == 0) {
+#pragma omp critical (tip_handles)
                 tips.push_back(handle);
             }
-        });
+        }, true);
+    // keep the graph order regardless of the threads
+    std::sort(tips.begin(), tips.end(), [](const handle_t& a, const handle_t& b) { return as_integer(a) < as_integer(b); });
     return tips;
 }
 
@@ -31,11 +34,10 @@ uint64_t cut_tips(
 }
 
 uint64_t cut_tips(
-    MutablePathDeletableHandleGraph& graph,
+    graph_t& graph,
     uint64_t min_depth) {
     auto tips = tip_handles(graph);
     std::vector<handle_t> drop_tips;
-    std::sort(tips.begin(), tips.end());
     for (auto& tip : tips) {
         std::vector<step_handle_t> to_destroy;
         graph.for_each_step_on_handle(
@@ -50,9 +52,7 @@ uint64_t cut_tips(
             drop_tips.push_back(tip);
         }
     }
-    for (auto& tip : drop_tips) {
-        graph.destroy_handle(tip);
-    }
+    graph.destroy_handles(drop_tips);
     return tips.size();
 }
 
@@ -21,7 +21,7 @@ uint64_t cut_tips(
     DeletableHandleGraph& graph);
 
 uint64_t cut_tips(
-    MutablePathDeletableHandleGraph& graph,
+    graph_t& graph,
     uint64_t min_depth = 0);
 
 }
@@ -10,7 +10,10 @@ using namespace handlegraph;
 
 
 ska::flat_hash_map<handlegraph::nid_t, handlegraph::nid_t> dagify(const HandleGraph* graph, MutableHandleGraph* into,
-                                                                  size_t min_preserved_path_length) {
+                                                                  size_t min_preserved_path_length,
+                                                                  const uint64_t& nthreads,
+                                                                  const uint64_t& max_copies,
+                                                                  const uint64_t& max_unrolled_nodes) {
         
     // initialize the translator from the dagified graph back to the original graph
     ska::flat_hash_map<handlegraph::nid_t, handlegraph::nid_t> translator;
@@ -39,7 +42,7 @@ ska::flat_hash_map<handlegraph::nid_t, handlegraph::nid_t> dagify(const HandleGr
     }
 
     // find the strongly connected components of the original graph
-    std::vector<ska::flat_hash_set<handlegraph::nid_t>> strong_components = strongly_connected_components(graph);
+    std::vector<ska::flat_hash_set<handlegraph::nid_t>> strong_components = strongly_connected_components(graph, nthreads);
 
 #ifdef debug_dagify
     cerr << "got strongly connected components:" << endl;
@@ -53,26 +56,49 @@ ska::flat_hash_map<handlegraph::nid_t, handlegraph::nid_t> dagify(const HandleGr
         
     // duplicate strongly connected components into the dagified graph in such a way
     // that paths are preserved
-        
+
     // a tracker for which SCC a node belongs to
     ska::flat_hash_map<handlegraph::nid_t, size_t> component_of;
-    // a map from a node in the original graph to all its copies (in order) in the
-    // dagified graph
-    ska::flat_hash_map<handle_t, std::vector<handle_t>> injector;
     for (size_t i = 0; i < strong_components.size(); i++) {
-            
+        for (handlegraph::nid_t node_id : strong_components[i]) {
+            component_of[node_id] = i;
+        }
+    }
+
+    // how each SCC is unrolled, which depends only on the SCC itself
+    struct unrolling_t {
+        std::vector<handle_t> layout;
+        std::vector<std::vector<size_t>> forward_edges;
+        std::vector<std::pair<size_t, size_t>> backward_edges;
+        size_t copies = 0;
+    };
+    std::vector<unrolling_t> unrollings(strong_components.size());
+
+    // plan the copies of every SCC in parallel, the largest first
+    std::vector<size_t> by_size(strong_components.size());
+    for (size_t i = 0; i < by_size.size(); i++) {
+        by_size[i] = i;
+    }
+    std::sort(by_size.begin(), by_size.end(), [&](const size_t& a, const size_t& b) {
+        return strong_components[a].size() > strong_components[b].size();
+    });
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+    for (size_t k = 0; k < by_size.size(); k++) {
+        const size_t i = by_size[k];
+
 #ifdef debug_dagify
+#pragma omp critical (cerr)
         cerr << "handling component " << i << endl;
 #endif
-            
-        // keep track of which nodes are in which component (for later)
+
         auto& component = strong_components[i];
-        for (handlegraph::nid_t node_id : component) {
-            component_of[node_id] = i;
-        }
-            
+        auto& unrolling = unrollings[i];
+        auto& layout = unrolling.layout;
+        auto& forward_edges = unrolling.forward_edges;
+        auto& backward_edges = unrolling.backward_edges;
+
         // figure out how many times we need to copy this SCC
-            
+
         // wrap the SCC in a handle graph
         SubHandleGraph subgraph(graph);
         for (const handlegraph::nid_t& node_id : component) {
@@ -80,7 +106,6 @@ ska::flat_hash_map<handlegraph::nid_t, handlegraph::nid_t> dagify(const HandleGr
         }
 
         // get a layout with a low FAS, generic to any kind of graph
-        std::vector<handle_t> layout;
         // but only if it's large enough to justify our dynamic data structure costs
         if (subgraph.get_node_count() > 1000) {
             layout = topological_order(&subgraph, false, false); // sort without heads or tails
@@ -99,13 +124,6 @@ ska::flat_hash_map<handlegraph::nid_t, handlegraph::nid_t> dagify(const HandleGr
                 layout[layout.size() / 2] = subgraph.flip(layout[layout.size() / 2]);
             }
         }
-            
-#ifdef debug_dagify
-        cerr << "layout for component:" << endl;
-        for (const handle_t& h : layout) {
-            cerr << "\t" << graph->get_id(h) << (graph->get_is_reverse(h) ? "-" : "+") << endl;
-        }
-#endif
 
         // record the ordering of the layout so we can identify backward edges
         ska::flat_hash_map<handle_t, size_t> ordering;
@@ -114,8 +132,7 @@ ska::flat_hash_map<handlegraph::nid_t, handlegraph::nid_t> dagify(const HandleGr
         }
 
         // mark the edges as either forward or backward relative to the layout
-        std::vector<std::vector<size_t>> forward_edges(layout.size());
-        std::vector<std::pair<size_t, size_t>> backward_edges;
+        forward_edges.resize(layout.size());
         subgraph.for_each_edge([&](const edge_t& edge) {
                 // get the indices of the edge in the layout, making sure to match
                 // the canonical orientation
@@ -129,7 +146,7 @@ ska::flat_hash_map<handlegraph::nid_t, handlegraph::nid_t> dagify(const HandleGr
                     i = ordering[subgraph.flip(edge.second)];
                     j = ordering[subgraph.flip(edge.first)];
                 }
-                
+
                 // classify the edge as forward or backward
                 if (i < j) {
                     forward_edges[i].push_back(j);
@@ -137,103 +154,48 @@ ska::flat_hash_map<handlegraph::nid_t, handlegraph::nid_t> dagify(const HandleGr
                 else {
                     backward_edges.emplace_back(i, j);
                 }
-                
+
                 // always keep going
                 return true;
             });
-            
+
         // check for each node whether we've duplicated the component enough times
         // to preserve its cycles
-            
+
         // dynamic progamming structures that represent distances within the current
         // copy of the SCC and the next copy
         std::vector<int64_t> distances(layout.size(), numeric_limits<int64_t>::max());
         std::vector<int64_t> next_distances(layout.size(), numeric_limits<int64_t>::max());
-            
+
         // init the distances so that we are measuring from the end of the heads of
         // backward edges (which cross to the next copy of the SCC)
         for (const pair<size_t, size_t>& bwd_edge : backward_edges) {
             handle_t handle = layout[bwd_edge.first];
             distances[ordering[handle]] = -subgraph.get_length(handle);
         }
-            
+
         // init the tracker that we use for the bail-out condition
         int64_t min_relaxed_dist = -1;
-            
+
         // add copies until the minimum distance to the new copy is longer than the distance we're
-        // trying to preserven
-        for (size_t copy_num = 0; min_relaxed_dist < int64_t(min_preserved_path_length); copy_num++) {
-                
-#ifdef debug_dagify
-            cerr << "copy number " << copy_num << endl;
-#endif
-                
-            // do we need a new copy of this SCC to preserve paths?
-            if (copy_num == injector[layout.front()].size()) {
-                // we haven't added this copy of the connected component yet
-                    
-#ifdef debug_dagify
-                cerr << "adding nodes for this copy" << endl;
-#endif
-                    
-                // add the nodes
-                for (const handle_t& original_handle : layout) {
-                    // create the node in the same foward orientation as the original
-                    handle_t new_handle = into->create_handle(graph->get_sequence(graph->forward(original_handle)));
-                    // use the handle locally in the same orientation as it is in the layout
-                    if (graph->get_is_reverse(original_handle)) {
-                        new_handle = into->flip(new_handle);
-                    }
-#ifdef debug_dagify
-                    cerr << "\t" << graph->get_id(original_handle) << " duplicated to " << into->get_id(new_handle) << endl;
-#endif
-                        
-                    // record the translation between the graphs
-                    translator[into->get_id(new_handle)] = graph->get_id(original_handle);
-                    injector[original_handle].push_back(new_handle);
-                }
-                    
-                // add the forward edges within this copy
-                for (size_t i = 0; i < forward_edges.size(); i++) {
-                    handle_t from = injector[layout[i]].back();
-                    for (const size_t& j : forward_edges[i]) {
-                        into->create_edge(from, injector[layout[j]].back());
-#ifdef debug_dagify
-                        cerr << "\t\tfwd edge " << into->get_id(from) << (into->get_is_reverse(from) ? "-" : "+") << " -> " << into->get_id(injector[layout[j]].back()) << (into->get_is_reverse(injector[layout[j]].back()) ? "-" : "+") << endl;
-#endif
-                    }
-                }
-                    
-                // is there a previous copy?
-                if (copy_num > 0) {
-                    // add the backward edges between the copies
-                    for (const pair<size_t, size_t>& bwd_edge : backward_edges) {
-                        const auto& from_copies = injector[layout[bwd_edge.first]];
-                        into->create_edge(from_copies[from_copies.size() - 2],
-                                          injector[layout[bwd_edge.second]].back());
-#ifdef debug_dagify
-                        cerr << "\t\tbwd edge " << into->get_id(from_copies[from_copies.size() - 2]) << (into->get_is_reverse(from_copies[from_copies.size() - 2]) ? "-" : "+") << " -> " << into->get_id(injector[layout[bwd_edge.second]].back()) << (into->get_is_reverse(injector[layout[bwd_edge.second]].back()) ? "-" : "+") << endl;
-#endif
-                    }
-                }
-            }
-                
-            // we've finished adding the copy of the SCC that corresponds to this iteration
-            // now we will do the dynamic programming to bound the distance to the next SCC
-                
+        // trying to preserve, or we reach the cap
+        for (size_t copy_num = 0; min_relaxed_dist < int64_t(min_preserved_path_length)
+                 && (max_copies == 0 || copy_num < max_copies); copy_num++) {
+            unrolling.copies = copy_num + 1;
+
             // find the shortest path to the nodes, staying within this copy of the SCC
             for (size_t i = 0; i < distances.size(); i++) {
                 // skip infinity to avoid overflow
                 if (distances[i] == numeric_limits<int64_t>::max()) {
                     continue;
                 }
-                    
+
                 int64_t dist_thru = distances[i] + subgraph.get_length(layout[i]);
                 for (const size_t& j : forward_edges[i]) {
                     distances[j] = min(distances[j], dist_thru);
                 }
             }
-                
+
             // now find the minimum distance to nodes in the next copy of the SCC (which
             // may not yet be created in the graph)
             min_relaxed_dist = numeric_limits<int64_t>::max();
@@ -242,7 +204,7 @@ ska::flat_hash_map<handlegraph::nid_t, handlegraph::nid_t> dagify(const HandleGr
                 if (distances[bwd_edge.first] == numeric_limits<int64_t>::max()) {
                     continue;
                 }
-                    
+
                 int64_t dist_thru = distances[bwd_edge.first] + subgraph.get_length(layout[bwd_edge.first]);
                 if (dist_thru < next_distances[bwd_edge.second]) {
                     next_distances[bwd_edge.second] = dist_thru;
@@ -250,24 +212,90 @@ ska::flat_hash_map<handlegraph::nid_t, handlegraph::nid_t> dagify(const HandleGr
                     min_relaxed_dist = min(min_relaxed_dist, dist_thru);
                 }
             }
-                
-#ifdef debug_dagify
-            cerr << "distances within component" << endl;
-            for (size_t i = 0; i < distances.size(); i++) {
-                cerr << "\t" << graph->get_id(layout[i]) << (graph->get_is_reverse(layout[i]) ? "-" : "+") << " " << distances[i] << endl;
-            }
-            cerr << "distances to next component" << endl;
-            for (size_t i = 0; i < next_distances.size(); i++) {
-                cerr << "\t" << graph->get_id(layout[i]) << (graph->get_is_reverse(layout[i]) ? "-" : "+") << " " << next_distances[i] << endl;
-            }
-#endif
-                
+
             // initialize the DP structures for the next iteration
             distances = move(next_distances);
             next_distances.assign(distances.size(), numeric_limits<int64_t>::max());
         }
     }
-        
+
+    // keep the unrolled graph within the node budget by capping the copies of the most repeated SCCs
+    // at the largest count that fits, never going below one copy
+    if (max_unrolled_nodes) {
+        auto unrolled_nodes = [&](const size_t& cap) {
+            uint64_t total = 0;
+            for (auto& unrolling : unrollings) {
+                total += std::min(unrolling.copies, cap) * unrolling.layout.size();
+            }
+            return total;
+        };
+        size_t max_needed = 1;
+        for (auto& unrolling : unrollings) {
+            max_needed = std::max(max_needed, unrolling.copies);
+        }
+        if (unrolled_nodes(max_needed) > max_unrolled_nodes) {
+            size_t lo = 1, hi = max_needed;
+            while (lo < hi) {
+                const size_t mid = lo + (hi - lo + 1) / 2;
+                if (unrolled_nodes(mid) <= max_unrolled_nodes) {
+                    lo = mid;
+                } else {
+                    hi = mid - 1;
+                }
+            }
+            for (auto& unrolling : unrollings) {
+                unrolling.copies = std::min(unrolling.copies, lo);
+            }
+        }
+    }
+
+    // a map from a node in the original graph to all its copies (in order) in the
+    // dagified graph
+    ska::flat_hash_map<handle_t, std::vector<handle_t>> injector;
+    for (size_t c = 0; c < unrollings.size(); c++) {
+        auto& unrolling = unrollings[c];
+        const auto& layout = unrolling.layout;
+        for (size_t copy_num = 0; copy_num < unrolling.copies; copy_num++) {
+
+#ifdef debug_dagify
+            cerr << "adding nodes for copy " << copy_num << " of component " << c << endl;
+#endif
+
+            // add the nodes
+            for (const handle_t& original_handle : layout) {
+                // create the node in the same foward orientation as the original
+                handle_t new_handle = into->create_handle(graph->get_sequence(graph->forward(original_handle)));
+                // use the handle locally in the same orientation as it is in the layout
+                if (graph->get_is_reverse(original_handle)) {
+                    new_handle = into->flip(new_handle);
+                }
+                // record the translation between the graphs
+                translator[into->get_id(new_handle)] = graph->get_id(original_handle);
+                injector[original_handle].push_back(new_handle);
+            }
+
+            // add the forward edges within this copy
+            for (size_t i = 0; i < unrolling.forward_edges.size(); i++) {
+                handle_t from = injector[layout[i]].back();
+                for (const size_t& j : unrolling.forward_edges[i]) {
+                    into->create_edge(from, injector[layout[j]].back());
+                }
+            }
+
+            // is there a previous copy?
+            if (copy_num > 0) {
+                // add the backward edges between the copies
+                for (const pair<size_t, size_t>& bwd_edge : unrolling.backward_edges) {
+                    const auto& from_copies = injector[layout[bwd_edge.first]];
+                    into->create_edge(from_copies[from_copies.size() - 2],
+                                      injector[layout[bwd_edge.second]].back());
+                }
+            }
+        }
+        // the plan is no longer needed
+        unrolling = unrolling_t();
+    }
+
 #ifdef debug_dagify
     cerr << "adding edges between SCCs" << endl;
 #endif
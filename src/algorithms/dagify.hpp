@@ -20,7 +20,14 @@ namespace algorithms {
 // up to a given minimum length. Input HandleGraph must have a single stranded orientation.
 // Consider checking this property with has_single_stranded_orientation() before using.
 // Returns a mapping from the node IDs of into to the node IDs in graph.
+// The strongly connected components are found, and how many copies each needs is worked out, in
+// nthreads threads. A non-zero max_copies caps the copies of any one component, and a non-zero
+// max_unrolled_nodes caps the node count of into by lowering the copies of the most repeated
+// components; paths longer than the copies can hold are then not preserved.
 ska::flat_hash_map<handlegraph::nid_t, handlegraph::nid_t> dagify(const HandleGraph* graph, MutableHandleGraph* into,
-                                                                  size_t min_preserved_path_length);
+                                                                  size_t min_preserved_path_length,
+                                                                  const uint64_t& nthreads = 1,
+                                                                  const uint64_t& max_copies = 0,
+                                                                  const uint64_t& max_unrolled_nodes = 0);
 }
 }
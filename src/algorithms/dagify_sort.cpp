@@ -3,34 +3,41 @@
 namespace odgi {
 namespace algorithms {
 
-std::vector<handle_t> dagify_sort(const HandleGraph& base, MutableHandleGraph& split, MutableHandleGraph& into) {
-    auto split_to_orig = algorithms::split_strands(&base, &split);
-    auto dagified_to_split = algorithms::dagify(&split, &into, 1);
+std::vector<handle_t> dagify_sort(const graph_t& base, graph_t& split, MutableHandleGraph& into,
+                                  const uint64_t& nthreads,
+                                  const uint64_t& max_copies,
+                                  const uint64_t& max_unrolled_nodes) {
+    auto split_to_orig = algorithms::split_strands(base, split, nthreads);
+    auto dagified_to_split = algorithms::dagify(&split, &into, 1, nthreads, max_copies, max_unrolled_nodes);
     auto dagified_to_orig = [&](handlegraph::nid_t id) {
-        return split_to_orig[dagified_to_split[id]];
+        return split_to_orig[dagified_to_split[id] - 1];
     };
     auto order = algorithms::topological_order(&into, true, false);
-    // find the mean position in the order for each original handle
-    ska::flat_hash_map<handlegraph::nid_t, std::pair<uint64_t, uint64_t>> pos_accum;
+    // find the mean position in the order for each original handle, by the offset of its id
+    const handlegraph::nid_t min_id = base.min_node_id();
+    std::vector<std::pair<uint64_t, uint64_t>> pos_accum(base.get_node_count() ? base.max_node_id() - min_id + 1 : 0);
     for (uint64_t i = 0; i < order.size(); ++i) {
         auto& handle = order[i];
         auto e = dagified_to_orig(into.get_id(handle));
         if (e.second) continue;
-        handlegraph::nid_t id = e.first;
-        pos_accum[id].first += i;
-        ++pos_accum[id].second;
+        auto& accum = pos_accum[e.first - min_id];
+        accum.first += i;
+        ++accum.second;
     }
     // sort the original ids by their average position in the dagified sort
-    std::vector<std::pair<handlegraph::nid_t, double>> avg_pos; avg_pos.reserve(pos_accum.size());
-    for (auto& e : pos_accum) {
-        avg_pos.push_back(std::make_pair(e.first, (double)e.second.first/(double)e.second.second));
+    std::vector<std::pair<handlegraph::nid_t, double>> avg_pos; avg_pos.reserve(base.get_node_count());
+    for (uint64_t i = 0; i < pos_accum.size(); ++i) {
+        if (pos_accum[i].second) {
+            avg_pos.push_back(std::make_pair(min_id + i, (double)pos_accum[i].first/(double)pos_accum[i].second));
+        }
     }
-    std::sort(avg_pos.begin(), avg_pos.end(),
-              [](const std::pair<handlegraph::nid_t, double>& a,
-                 const std::pair<handlegraph::nid_t, double>& b) {
-                  return a.second < b.second;
-              });
+    std::stable_sort(avg_pos.begin(), avg_pos.end(),
+                     [](const std::pair<handlegraph::nid_t, double>& a,
+                        const std::pair<handlegraph::nid_t, double>& b) {
+                         return a.second < b.second;
+                     });
     std::vector<handle_t> translated_order;
+    translated_order.reserve(avg_pos.size());
     for (auto& e : avg_pos) {
         translated_order.push_back(base.get_handle(e.first));
     }
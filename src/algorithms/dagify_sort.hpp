@@ -13,7 +13,11 @@ namespace algorithms {
 
 using namespace handlegraph;
 
-std::vector<handle_t> dagify_sort(const HandleGraph& base, MutableHandleGraph& split, MutableHandleGraph& into);
+/// max_copies and max_unrolled_nodes bound the unrolling of the strongly connected components, see dagify
+std::vector<handle_t> dagify_sort(const graph_t& base, graph_t& split, MutableHandleGraph& into,
+                                  const uint64_t& nthreads = 1,
+                                  const uint64_t& max_copies = 0,
+                                  const uint64_t& max_unrolled_nodes = 0);
 
 }
 }
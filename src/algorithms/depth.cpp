@@ -14,87 +14,220 @@ std::vector<handle_t> find_handles_exceeding_depth_limits(const MutablePathDelet
     return handles;
 }
 
-std::vector<edge_t> find_edges_exceeding_depth_limits(const MutablePathDeletableHandleGraph& graph, uint64_t min_depth, uint64_t max_depth) {
-    std::vector<edge_t> edges;
-    graph.for_each_handle([&](const handle_t& handle) {
-            hash_map<handle_t, uint64_t> nexts;
-            hash_map<handle_t, uint64_t> prevs;
-            graph.for_each_step_on_handle(handle, [&](const step_handle_t& step) {
-                    if (graph.has_next_step(step)) {
-                        step_handle_t next = graph.get_next_step(step);
-                        ++nexts[graph.get_handle_of_step(next)];
-                    }
-                    if (graph.has_previous_step(step)) {
-                        step_handle_t prev = graph.get_previous_step(step);
-                        ++prevs[graph.get_handle_of_step(prev)];
-                    }
-                });
-            for (auto& n : nexts) {
-                const uint64_t& path_cov = n.second;
-                if (min_depth && path_cov < min_depth || max_depth && path_cov > max_depth) {
-                    edges.push_back(std::make_pair(handle, n.first));
-                }
+bool edge_depth_index_t::is_canonical(const handle_t& a, const handle_t& b) {
+    const handle_t fa = number_bool_packing::toggle_bit(b);
+    const handle_t fb = number_bool_packing::toggle_bit(a);
+    return as_integer(a) < as_integer(fa) || (a == fa && as_integer(b) <= as_integer(fb));
+}
+
+uint64_t edge_depth_index_t::index_of(handle_t a, handle_t b) const {
+    if (!is_canonical(a, b)) {
+        const handle_t fa = number_bool_packing::toggle_bit(b);
+        b = number_bool_packing::toggle_bit(a);
+        a = fa;
+    }
+    const uint64_t row = as_integer(a);
+    if (row + 1 < row_begin.size()) {
+        for (uint64_t i = row_begin[row]; i < row_begin[row + 1]; ++i) {
+            if (right[i] == b) {
+                return i;
             }
-            for (auto& p : prevs) {
-                const uint64_t& path_cov = p.second;
-                if (min_depth && path_cov < min_depth || max_depth && path_cov > max_depth) {
-                    edges.push_back(std::make_pair(p.first, handle));
+        }
+    }
+    return std::numeric_limits<uint64_t>::max();
+}
+
+edge_depth_index_t::edge_depth_index_t(const graph_t& graph, const uint64_t& nthreads)
+    : node_count(graph.get_node_count()) {
+    // handles of graph_t are their rank and orientation, so each has its own row
+    uint64_t rows = 0;
+    graph.for_each_handle([&](const handle_t& h) {
+        rows = std::max(rows, (uint64_t)as_integer(h) + 2);
+    });
+    row_begin.assign(rows + 1, 0);
+    auto for_each_canonical_edge = [&](const handle_t& h, const std::function<void(const handle_t&, const handle_t&)>& func) {
+        for (const handle_t& a : {h, graph.flip(h)}) {
+            graph.follow_edges(a, false, [&](const handle_t& b) {
+                if (is_canonical(a, b)) {
+                    func(a, b);
+                }
+            });
+        }
+    };
+    // count and prefix sum the row sizes, then fill the rows; each node writes its own two rows
+    graph.for_each_handle([&](const handle_t& h) {
+        for_each_canonical_edge(h, [&](const handle_t& a, const handle_t& b) {
+            ++row_begin[as_integer(a) + 1];
+        });
+    }, true);
+    for (uint64_t i = 1; i <= rows; ++i) {
+        row_begin[i] += row_begin[i - 1];
+    }
+    right.resize(row_begin[rows]);
+    graph.for_each_handle([&](const handle_t& h) {
+        uint64_t fill[2] = {row_begin[as_integer(h)], row_begin[as_integer(graph.flip(h))]};
+        for_each_canonical_edge(h, [&](const handle_t& a, const handle_t& b) {
+            right[fill[number_bool_packing::unpack_bit(a)]++] = b;
+        });
+    }, true);
+    // 32 bits of depth are enough for any number of haplotypes we will see crossing one edge
+    std::vector<std::atomic<uint32_t>>(right.size()).swap(depth);
+    std::vector<path_handle_t> paths;
+    graph.for_each_path_handle([&](const path_handle_t& p) { paths.push_back(p); });
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+    for (uint64_t i = 0; i < paths.size(); ++i) {
+        bool first = true;
+        handle_t prev;
+        graph.for_each_step_in_path(paths[i], [&](const step_handle_t& step) {
+            const handle_t curr = graph.get_handle_of_step(step);
+            if (!first) {
+                const uint64_t e = index_of(prev, curr);
+                if (e < depth.size()) {
+                    depth[e].fetch_add(1, std::memory_order_relaxed);
                 }
             }
+            first = false;
+            prev = curr;
         });
+    }
+}
+
+uint64_t edge_depth_index_t::get_depth(const handle_t& a, const handle_t& b) const {
+    const uint64_t e = index_of(a, b);
+    return e < depth.size() ? depth[e].load(std::memory_order_relaxed) : 0;
+}
+
+void edge_depth_index_t::for_each_edge_depth(const std::function<void(const edge_t&, const uint64_t&)>& func, const uint64_t& nthreads) const {
+    const uint64_t rows = row_begin.empty() ? 0 : row_begin.size() - 1;
+#pragma omp parallel for schedule(dynamic, 4096) num_threads(nthreads)
+    for (uint64_t row = 0; row < rows; ++row) {
+        const handle_t a = as_handle(row);
+        for (uint64_t i = row_begin[row]; i < row_begin[row + 1]; ++i) {
+            func(std::make_pair(a, right[i]), depth[i].load(std::memory_order_relaxed));
+        }
+    }
+}
+
+static const char EDGE_DEPTH_INDEX_MAGIC[8] = {'O', 'D', 'G', 'I', 'E', 'D', 'P', 'T'};
+static const uint64_t EDGE_DEPTH_INDEX_VERSION = 1;
+
+bool edge_depth_index_t::is_index_of(const graph_t& graph) const {
+    return node_count == graph.get_node_count() && right.size() == graph.get_edge_count();
+}
+
+void edge_depth_index_t::serialize(std::ostream& out) const {
+    out.write(EDGE_DEPTH_INDEX_MAGIC, sizeof(EDGE_DEPTH_INDEX_MAGIC));
+    out.write((const char*)&EDGE_DEPTH_INDEX_VERSION, sizeof(EDGE_DEPTH_INDEX_VERSION));
+    out.write((const char*)&node_count, sizeof(node_count));
+    const uint64_t rows = row_begin.size();
+    const uint64_t edges = right.size();
+    out.write((const char*)&rows, sizeof(rows));
+    out.write((const char*)&edges, sizeof(edges));
+    out.write((const char*)row_begin.data(), rows * sizeof(uint64_t));
+    for (const handle_t& b : right) {
+        const uint64_t i = as_integer(b);
+        out.write((const char*)&i, sizeof(i));
+    }
+    for (const auto& d : depth) {
+        const uint32_t v = d.load(std::memory_order_relaxed);
+        out.write((const char*)&v, sizeof(v));
+    }
+}
+
+bool edge_depth_index_t::load(std::istream& in) {
+    char magic[sizeof(EDGE_DEPTH_INDEX_MAGIC)];
+    uint64_t version = 0, rows = 0, edges = 0;
+    if (!in.read(magic, sizeof(magic))
+        || !std::equal(magic, magic + sizeof(magic), EDGE_DEPTH_INDEX_MAGIC)
+        || !in.read((char*)&version, sizeof(version)) || version != EDGE_DEPTH_INDEX_VERSION
+        || !in.read((char*)&node_count, sizeof(node_count))
+        || !in.read((char*)&rows, sizeof(rows))
+        || !in.read((char*)&edges, sizeof(edges))) {
+        return false;
+    }
+    row_begin.resize(rows);
+    if (rows && !in.read((char*)row_begin.data(), rows * sizeof(uint64_t))) {
+        return false;
+    }
+    if (rows ? row_begin.back() != edges : edges != 0) {
+        return false;
+    }
+    std::vector<uint64_t> packed(edges);
+    std::vector<uint32_t> counts(edges);
+    if (edges && (!in.read((char*)packed.data(), edges * sizeof(uint64_t))
+                  || !in.read((char*)counts.data(), edges * sizeof(uint32_t)))) {
+        return false;
+    }
+    right.resize(edges);
+    std::vector<std::atomic<uint32_t>>(edges).swap(depth);
+    for (uint64_t i = 0; i < edges; ++i) {
+        right[i] = as_handle(packed[i]);
+        depth[i].store(counts[i], std::memory_order_relaxed);
+    }
+    return true;
+}
+
+// the edges in a deterministic order, whatever the threads did
+static void sort_edges(std::vector<edge_t>& edges) {
     std::sort(edges.begin(), edges.end(), [](const edge_t& a, const edge_t& b) {
             return std::make_pair(as_integer(a.first), as_integer(a.second))
                 < std::make_pair(as_integer(b.first), as_integer(b.second));
         });
     edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
-    return edges;
 }
 
-std::vector<edge_t> keep_mutual_best_edges(const MutablePathDeletableHandleGraph& graph, uint64_t n_best) {
+std::vector<edge_t> find_edges_exceeding_depth_limits(const graph_t& graph, uint64_t min_depth, uint64_t max_depth, const uint64_t& nthreads) {
+    return find_edges_exceeding_depth_limits(edge_depth_index_t(graph, nthreads), min_depth, max_depth, nthreads);
+}
+
+std::vector<edge_t> find_edges_exceeding_depth_limits(const edge_depth_index_t& index, uint64_t min_depth, uint64_t max_depth, const uint64_t& nthreads) {
+    std::vector<std::vector<edge_t>> thread_edges(nthreads);
+    index.for_each_edge_depth([&](const edge_t& edge, const uint64_t& path_cov) {
+            // edges without path steps over them are not considered
+            if (path_cov && (min_depth && path_cov < min_depth || max_depth && path_cov > max_depth)) {
+                thread_edges[omp_get_thread_num()].push_back(edge);
+            }
+        }, nthreads);
     std::vector<edge_t> edges;
+    for (auto& t : thread_edges) {
+        edges.insert(edges.end(), t.begin(), t.end());
+    }
+    sort_edges(edges);
+    return edges;
+}
+
+std::vector<edge_t> keep_mutual_best_edges(const graph_t& graph, uint64_t n_best, const uint64_t& nthreads) {
+    return keep_mutual_best_edges(graph, edge_depth_index_t(graph, nthreads), n_best, nthreads);
+}
+
+std::vector<edge_t> keep_mutual_best_edges(const graph_t& graph, const edge_depth_index_t& index, uint64_t n_best, const uint64_t& nthreads) {
+    std::vector<std::vector<edge_t>> thread_edges(nthreads);
     graph.for_each_handle([&](const handle_t& handle) {
-            hash_map<handle_t, uint64_t> nexts;
-            hash_map<handle_t, uint64_t> prevs;
-            graph.for_each_step_on_handle(handle, [&](const step_handle_t& step) {
-                    if (graph.has_next_step(step)) {
-                        step_handle_t next = graph.get_next_step(step);
-                        ++nexts[graph.get_handle_of_step(next)];
-                    }
-                    if (graph.has_previous_step(step)) {
-                        step_handle_t prev = graph.get_previous_step(step);
-                        ++prevs[graph.get_handle_of_step(prev)];
-                    }
-                });
-            std::map<uint64_t, handle_t> nexts_sorted;
-            for (auto& n : nexts) {
-                nexts_sorted[n.second] = n.first;
-            }
-            std::map<uint64_t, handle_t> prevs_sorted;
-            for (auto& p : prevs) {
-                prevs_sorted[p.second] = p.first;
-            }
-            uint64_t i = 0;
-            for (auto& n : nexts_sorted) {
-                if (nexts.size() - i++ > n_best) {
-                    edges.push_back(std::make_pair(handle, n.second));
-                } else {
-                    break;
-                }
-            }
-            i = 0;
-            for (auto& p : prevs_sorted) {
-                if (prevs.size() - i++ > n_best) {
-                    edges.push_back(std::make_pair(p.second, handle));
-                } else {
-                    break;
+            auto& edges = thread_edges[omp_get_thread_num()];
+            // on each side, rank the edges crossed by paths by their depth and drop all but the n_best deepest
+            for (const bool go_left : {false, true}) {
+                std::vector<std::pair<uint64_t, handle_t>> sides;
+                graph.follow_edges(handle, go_left, [&](const handle_t& other) {
+                        const uint64_t d = go_left ? index.get_depth(other, handle) : index.get_depth(handle, other);
+                        if (d) {
+                            sides.push_back(std::make_pair(d, other));
+                        }
+                    });
+                std::sort(sides.begin(), sides.end(), [](const std::pair<uint64_t, handle_t>& a, const std::pair<uint64_t, handle_t>& b) {
+                        return a.first > b.first || (a.first == b.first && as_integer(a.second) < as_integer(b.second));
+                    });
+                for (uint64_t i = n_best; i < sides.size(); ++i) {
+                    edges.push_back(go_left
+                                    ? std::make_pair(sides[i].second, handle)
+                                    : std::make_pair(handle, sides[i].second));
                 }
             }
-        });
-    std::sort(edges.begin(), edges.end(), [](const edge_t& a, const edge_t& b) {
-            return std::make_pair(as_integer(a.first), as_integer(a.second))
-                < std::make_pair(as_integer(b.first), as_integer(b.second));
-        });
-    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+        }, nthreads > 1);
+    std::vector<edge_t> edges;
+    for (auto& t : thread_edges) {
+        edges.insert(edges.end(), t.begin(), t.end());
+    }
+    sort_edges(edges);
     return edges;
 }
 
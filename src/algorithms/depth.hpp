@@ -4,7 +4,9 @@
 #include <vector>
 #include <map>
 #include <algorithm>
+#include <atomic>
 #include <omp.h>
+#include "odgi.hpp"
 #include "hash_map.hpp"
 #include "position.hpp"
 #include <handlegraph/types.hpp>
@@ -27,11 +29,41 @@ namespace algorithms {
 /// Find handles with more or less than the given path depth limits
 std::vector<handle_t> find_handles_exceeding_depth_limits(const MutablePathDeletableHandleGraph& graph, uint64_t min_depth, uint64_t max_depth);
 
-/// Find edges with more or less than the given path depth limits
-std::vector<edge_t> find_edges_exceeding_depth_limits(const MutablePathDeletableHandleGraph& graph, uint64_t min_depth, uint64_t max_depth);
+/// The path depth of every edge of a graph_t. Each edge is kept once, in the orientation (a, b) that is not
+/// greater than (flip(b), flip(a)), in the row of its left handle a, so edges are found without hashing.
+class edge_depth_index_t {
+public:
+    /// an empty index, to be loaded
+    edge_depth_index_t(void) = default;
+    /// index the edges and count the path steps crossing them, in parallel
+    edge_depth_index_t(const graph_t& graph, const uint64_t& nthreads);
+    /// the number of edges in the index
+    uint64_t get_edge_count(void) const { return right.size(); }
+    /// whether the index was built from a graph of the same nodes and edges as this one
+    bool is_index_of(const graph_t& graph) const;
+    void serialize(std::ostream& out) const;
+    /// read an index written by serialize, false if the stream does not hold one
+    bool load(std::istream& in);
+    /// the number of times the paths cross the edge (a, b), in either orientation
+    uint64_t get_depth(const handle_t& a, const handle_t& b) const;
+    /// call func with each edge and its depth, in parallel
+    void for_each_edge_depth(const std::function<void(const edge_t&, const uint64_t&)>& func, const uint64_t& nthreads) const;
+private:
+    std::vector<uint64_t> row_begin; // for each handle a = pack(rank, is_rev), where its edges start
+    std::vector<handle_t> right; // the right handle of each edge
+    std::vector<std::atomic<uint32_t>> depth;
+    uint64_t node_count = 0;
+    static bool is_canonical(const handle_t& a, const handle_t& b);
+    uint64_t index_of(handle_t a, handle_t b) const;
+};
+
+/// Find edges with more or less than the given path depth limits, among the edges crossed by paths
+std::vector<edge_t> find_edges_exceeding_depth_limits(const graph_t& graph, uint64_t min_depth, uint64_t max_depth, const uint64_t& nthreads = 1);
+std::vector<edge_t> find_edges_exceeding_depth_limits(const edge_depth_index_t& index, uint64_t min_depth, uint64_t max_depth, const uint64_t& nthreads = 1);
 
 /// Keep the N best edges by path depth inbound and outbound of every node where they are the best for their neighbors
-std::vector<edge_t> keep_mutual_best_edges(const MutablePathDeletableHandleGraph& graph, uint64_t n_best);
+std::vector<edge_t> keep_mutual_best_edges(const graph_t& graph, uint64_t n_best, const uint64_t& nthreads = 1);
+std::vector<edge_t> keep_mutual_best_edges(const graph_t& graph, const edge_depth_index_t& index, uint64_t n_best, const uint64_t& nthreads = 1);
 
 /// Provide depth of our given path ranges to callback, requires the graph to be optimized!
 void for_each_path_range_depth(const PathHandleGraph& graph,
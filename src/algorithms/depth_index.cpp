@@ -0,0 +1,258 @@
+#include "depth_index.hpp"
+#include "progress.hpp"
+
+#include <algorithm>
+#include <memory>
+
+namespace odgi {
+namespace algorithms {
+
+static const char DEPTH_INDEX_MAGIC[8] = {'O', 'D', 'G', 'I', 'D', 'P', 'T', 'H'};
+static const uint64_t DEPTH_INDEX_VERSION = 1;
+
+template<typename T>
+static void write_vector(std::ostream &out, const std::vector<T> &v) {
+    const uint64_t n = v.size();
+    out.write((const char *) &n, sizeof(n));
+    out.write((const char *) v.data(), n * sizeof(T));
+}
+
+template<typename T>
+static bool read_vector(std::istream &in, std::vector<T> &v) {
+    uint64_t n = 0;
+    if (!in.read((char *) &n, sizeof(n))) {
+        return false;
+    }
+    v.resize(n);
+    return n == 0 || (bool) in.read((char *) v.data(), n * sizeof(T));
+}
+
+template<typename T>
+static bool read_value(std::istream &in, T &v) {
+    return (bool) in.read((char *) &v, sizeof(T));
+}
+
+void depth_index_t::build(const PathHandleGraph &graph,
+                          const std::vector<bool> &paths_to_consider,
+                          const uint64_t &nthreads,
+                          const bool &progress) {
+    // the depth of each node, by id
+    const nid_t min_id = graph.get_node_count() ? graph.min_node_id() : 0;
+    std::vector<uint32_t> node_depths(graph.get_node_count() ? graph.max_node_id() - min_id + 1 : 0, 0);
+    const bool subset_paths = !paths_to_consider.empty();
+    graph.for_each_handle([&](const handle_t &h) {
+        auto &d = node_depths[graph.get_id(h) - min_id];
+        if (subset_paths) {
+            graph.for_each_step_on_handle(h, [&](const step_handle_t &s) {
+                if (paths_to_consider[as_integer(graph.get_path_handle_of_step(s))]) {
+                    ++d;
+                }
+            });
+        } else {
+            d = graph.get_step_count(h);
+        }
+    }, true);
+
+    std::vector<path_handle_t> path_handles;
+    path_names.clear();
+    path_ranks.clear();
+    graph.for_each_path_handle([&](const path_handle_t &path) {
+        path_ranks[graph.get_path_name(path)] = path_handles.size();
+        path_names.push_back(graph.get_path_name(path));
+        path_handles.push_back(path);
+    });
+    path_lengths.assign(path_handles.size(), 0);
+
+    std::unique_ptr<progress_meter::ProgressMeter> progress_meter;
+    if (progress) {
+        progress_meter = std::make_unique<progress_meter::ProgressMeter>(
+                path_handles.size(), "[odgi::depth] building depth index:");
+    }
+    std::vector<std::vector<uint64_t>> starts(path_handles.size());
+    std::vector<std::vector<uint32_t>> depths(path_handles.size());
+    std::vector<std::vector<uint64_t>> sums(path_handles.size());
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+    for (uint64_t i = 0; i < path_handles.size(); ++i) {
+        auto &s = starts[i];
+        auto &d = depths[i];
+        uint64_t &length = path_lengths[i];
+        graph.for_each_step_in_path(path_handles[i], [&](const step_handle_t &step) {
+            const handle_t h = graph.get_handle_of_step(step);
+            const uint32_t depth = node_depths[graph.get_id(h) - min_id];
+            if (d.empty() || d.back() != depth) {
+                s.push_back(length);
+                d.push_back(depth);
+            }
+            length += graph.get_length(h);
+        });
+        auto &b = sums[i];
+        uint64_t sum = 0;
+        for (uint64_t r = 0; r < s.size(); ++r) {
+            if (r % block_size == 0) {
+                b.push_back(sum);
+            }
+            sum += (uint64_t) d[r] * ((r + 1 < s.size() ? s[r + 1] : length) - s[r]);
+        }
+        if (progress) {
+            progress_meter->increment(1);
+        }
+    }
+    if (progress) {
+        progress_meter->finish();
+    }
+
+    path_run_offsets.assign(1, 0);
+    path_block_offsets.assign(1, 0);
+    run_starts.clear();
+    run_depths.clear();
+    block_sums.clear();
+    for (uint64_t i = 0; i < path_handles.size(); ++i) {
+        run_starts.insert(run_starts.end(), starts[i].begin(), starts[i].end());
+        run_depths.insert(run_depths.end(), depths[i].begin(), depths[i].end());
+        block_sums.insert(block_sums.end(), sums[i].begin(), sums[i].end());
+        path_run_offsets.push_back(run_starts.size());
+        path_block_offsets.push_back(block_sums.size());
+        std::vector<uint64_t>().swap(starts[i]);
+        std::vector<uint32_t>().swap(depths[i]);
+        std::vector<uint64_t>().swap(sums[i]);
+    }
+    build_tree();
+}
+
+void depth_index_t::build_tree(void) {
+    const uint64_t block_count = block_sums.size();
+    tree_min.assign(2 * block_count, 0);
+    tree_max.assign(2 * block_count, 0);
+    for (uint64_t p = 0; p + 1 < path_run_offsets.size(); ++p) {
+        for (uint64_t r = path_run_offsets[p]; r < path_run_offsets[p + 1]; ++r) {
+            const uint64_t leaf = block_count + path_block_offsets[p] + (r - path_run_offsets[p]) / block_size;
+            if ((r - path_run_offsets[p]) % block_size == 0) {
+                tree_min[leaf] = run_depths[r];
+                tree_max[leaf] = run_depths[r];
+            } else {
+                tree_min[leaf] = std::min(tree_min[leaf], run_depths[r]);
+                tree_max[leaf] = std::max(tree_max[leaf], run_depths[r]);
+            }
+        }
+    }
+    for (uint64_t n = block_count; n-- > 1;) {
+        tree_min[n] = std::min(tree_min[2 * n], tree_min[2 * n + 1]);
+        tree_max[n] = std::max(tree_max[2 * n], tree_max[2 * n + 1]);
+    }
+}
+
+void depth_index_t::serialize(std::ostream &out) const {
+    out.write(DEPTH_INDEX_MAGIC, sizeof(DEPTH_INDEX_MAGIC));
+    out.write((const char *) &DEPTH_INDEX_VERSION, sizeof(DEPTH_INDEX_VERSION));
+    const uint64_t path_count = path_names.size();
+    out.write((const char *) &path_count, sizeof(path_count));
+    for (auto &name : path_names) {
+        const uint64_t n = name.size();
+        out.write((const char *) &n, sizeof(n));
+        out.write(name.data(), n);
+    }
+    write_vector(out, path_lengths);
+    write_vector(out, path_run_offsets);
+    write_vector(out, path_block_offsets);
+    write_vector(out, run_starts);
+    write_vector(out, run_depths);
+    write_vector(out, block_sums);
+}
+
+bool depth_index_t::load(std::istream &in) {
+    char magic[sizeof(DEPTH_INDEX_MAGIC)];
+    uint64_t version = 0;
+    uint64_t path_count = 0;
+    if (!in.read(magic, sizeof(magic))
+        || !std::equal(magic, magic + sizeof(magic), DEPTH_INDEX_MAGIC)
+        || !read_value(in, version) || version != DEPTH_INDEX_VERSION
+        || !read_value(in, path_count)) {
+        return false;
+    }
+    path_names.assign(path_count, "");
+    path_ranks.clear();
+    for (uint64_t i = 0; i < path_count; ++i) {
+        uint64_t n = 0;
+        if (!read_value(in, n)) {
+            return false;
+        }
+        path_names[i].resize(n);
+        if (n && !in.read(&path_names[i][0], n)) {
+            return false;
+        }
+        path_ranks[path_names[i]] = i;
+    }
+    if (!read_vector(in, path_lengths) || !read_vector(in, path_run_offsets)
+        || !read_vector(in, path_block_offsets) || !read_vector(in, run_starts)
+        || !read_vector(in, run_depths) || !read_vector(in, block_sums)
+        || path_lengths.size() != path_count
+        || path_run_offsets.size() != path_count + 1 || path_run_offsets.back() != run_starts.size()
+        || path_block_offsets.size() != path_count + 1 || path_block_offsets.back() != block_sums.size()
+        || run_depths.size() != run_starts.size()) {
+        return false;
+    }
+    build_tree();
+    return true;
+}
+
+uint64_t depth_index_t::run_at(const uint64_t &rank, const uint64_t &pos) const {
+    auto begin = run_starts.begin() + path_run_offsets[rank];
+    auto end = run_starts.begin() + path_run_offsets[rank + 1];
+    return std::upper_bound(begin, end, pos) - run_starts.begin() - 1;
+}
+
+uint64_t depth_index_t::sum_before(const uint64_t &rank, const uint64_t &run, const uint64_t &pos) const {
+    const uint64_t first_run = path_run_offsets[rank];
+    const uint64_t block = (run - first_run) / block_size;
+    uint64_t sum = block_sums[path_block_offsets[rank] + block];
+    for (uint64_t r = first_run + block * block_size; r < run; ++r) {
+        sum += (uint64_t) run_depths[r] * (run_starts[r + 1] - run_starts[r]);
+    }
+    return sum + (uint64_t) run_depths[run] * (pos - run_starts[run]);
+}
+
+void depth_index_t::get_range_depth(const uint64_t &rank, const uint64_t &start, const uint64_t &end,
+                                    double &mean, uint64_t &min, uint64_t &max) const {
+    const uint64_t first_run = run_at(rank, start);
+    const uint64_t last_run = run_at(rank, end - 1);
+    mean = (double) (sum_before(rank, last_run, end) - sum_before(rank, first_run, start)) / (double) (end - start);
+
+    uint32_t lo = run_depths[first_run];
+    uint32_t hi = lo;
+    auto scan = [&](const uint64_t &from, const uint64_t &to) {
+        for (uint64_t r = from; r <= to; ++r) {
+            lo = std::min(lo, run_depths[r]);
+            hi = std::max(hi, run_depths[r]);
+        }
+    };
+    const uint64_t path_first_run = path_run_offsets[rank];
+    const uint64_t first_block = (first_run - path_first_run) / block_size;
+    const uint64_t last_block = (last_run - path_first_run) / block_size;
+    if (first_block == last_block) {
+        scan(first_run, last_run);
+    } else {
+        scan(first_run, path_first_run + (first_block + 1) * block_size - 1);
+        scan(path_first_run + last_block * block_size, last_run);
+        // the blocks in between, bottom up
+        const uint64_t block_count = block_sums.size();
+        uint64_t l = block_count + path_block_offsets[rank] + first_block + 1;
+        uint64_t r = block_count + path_block_offsets[rank] + last_block;
+        for (; l < r; l >>= 1, r >>= 1) {
+            if (l & 1) {
+                lo = std::min(lo, tree_min[l]);
+                hi = std::max(hi, tree_max[l]);
+                ++l;
+            }
+            if (r & 1) {
+                --r;
+                lo = std::min(lo, tree_min[r]);
+                hi = std::max(hi, tree_max[r]);
+            }
+        }
+    }
+    min = lo;
+    max = hi;
+}
+
+}
+}
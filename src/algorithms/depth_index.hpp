@@ -0,0 +1,100 @@
+#pragma once
+
+/**
+ * \file depth_index.hpp
+ *
+ * Defines a file of the depth along each path, answering mean, min and max depth queries over path ranges.
+ */
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <iostream>
+#include <unordered_map>
+#include <handlegraph/path_handle_graph.hpp>
+#include <handlegraph/util.hpp>
+
+namespace odgi {
+namespace algorithms {
+
+using namespace handlegraph;
+
+/// The depth of each base of each path, as counted by odgi depth, without the graph.
+/// Each path is stored as runs of consecutive bases of the same depth. The runs are grouped in
+/// blocks, and only the blocks keep the sum of the depth before them and, in a segment tree,
+/// their min and max depth, so a range query finds its runs by binary search, scans the runs of
+/// at most two blocks, and takes O(log n) tree nodes for the blocks in between.
+class depth_index_t {
+public:
+
+    /// Collect the depth of the paths, one path per thread. If paths_to_consider is not empty,
+    /// only the steps of the paths it marks, by as_integer of their handle, count.
+    void build(const PathHandleGraph &graph,
+               const std::vector<bool> &paths_to_consider,
+               const uint64_t &nthreads,
+               const bool &progress);
+
+    void serialize(std::ostream &out) const;
+
+    /// Read an index written by serialize, false if the stream does not hold one
+    bool load(std::istream &in);
+
+    uint64_t get_path_count(void) const {
+        return path_names.size();
+    }
+
+    bool has_path(const std::string &name) const {
+        return path_ranks.count(name) > 0;
+    }
+
+    uint64_t get_path_rank(const std::string &name) const {
+        return path_ranks.at(name);
+    }
+
+    const std::string &get_path_name(const uint64_t &rank) const {
+        return path_names[rank];
+    }
+
+    uint64_t get_path_length(const uint64_t &rank) const {
+        return path_lengths[rank];
+    }
+
+    /// The mean, min and max depth over the bases [start, end) of the path, with start < end <= its length
+    void get_range_depth(const uint64_t &rank, const uint64_t &start, const uint64_t &end,
+                         double &mean, uint64_t &min, uint64_t &max) const;
+
+private:
+
+    static const uint64_t block_size = 64;
+
+    std::vector<std::string> path_names;
+    std::unordered_map<std::string, uint64_t> path_ranks;
+    std::vector<uint64_t> path_lengths;
+    /// the runs of path p at [path_run_offsets[p], path_run_offsets[p + 1]), likewise the blocks
+    std::vector<uint64_t> path_run_offsets;
+    std::vector<uint64_t> path_block_offsets;
+    /// the offset in its path of the first base of each run, and the depth of its bases
+    std::vector<uint64_t> run_starts;
+    std::vector<uint32_t> run_depths;
+    /// the depth summed over the bases of the path before each block
+    std::vector<uint64_t> block_sums;
+    /// the min and max depth of all blocks, the leaf of block b at block count + b
+    std::vector<uint32_t> tree_min;
+    std::vector<uint32_t> tree_max;
+
+    void build_tree(void);
+
+    /// the end of the run in its path
+    uint64_t run_end(const uint64_t &rank, const uint64_t &run) const {
+        return run + 1 < path_run_offsets[rank + 1] ? run_starts[run + 1] : path_lengths[rank];
+    }
+
+    /// the run of the path holding the base at offset pos
+    uint64_t run_at(const uint64_t &rank, const uint64_t &pos) const;
+
+    /// the depth summed over the bases of the path before pos, within the block of run
+    uint64_t sum_before(const uint64_t &rank, const uint64_t &run, const uint64_t &pos) const;
+};
+
+}
+}
@@ -4,28 +4,42 @@
 namespace odgi {
 namespace algorithms {
 
+// the sampled walks are kept per thread until sampling ends, as handles of priv
+typedef std::vector<std::vector<handle_t>> sampled_walks_t;
+
 void diff_priv_worker(const uint64_t tid,
                       const PathHandleGraph& graph,
-                      const std::function<void(step_handle_t, step_handle_t)> callback,
-                      const std::function<handle_t(std::mt19937&)> sample_handle,
+                      const graph_t& priv,
+                      XoshiroCpp::Xoshiro256Plus gen,
+                      const std::function<handle_t(XoshiroCpp::Xoshiro256Plus&)>& sample_handle,
                       std::atomic<uint64_t>& sampled_length,
                       const uint64_t target_length,
+                      const uint64_t reduction_length,
                       const double epsilon,
                       const double min_haplotype_freq,
-                      const uint64_t bp_limit) {
+                      const uint64_t bp_limit,
+                      sampled_walks_t& walks,
+                      progress_meter::ProgressMeter* progress) {
 
-    std::random_device rd;
-    std::mt19937 mt(rd()); // fully random seed
     std::uniform_real_distribution<double> unif(0,1);
-    random_selector<> selector{};
 
     typedef std::vector<std::pair<step_handle_t, step_handle_t>> step_ranges_t;
 
+    // the length sampled by this thread since it last added it to the shared total
+    uint64_t local_length = 0;
+    auto reduce = [&](void) {
+        sampled_length.fetch_add(local_length);
+        if (progress) {
+            progress->increment(local_length);
+        }
+        local_length = 0;
+    };
+
     // algorithm
-    while (sampled_length < target_length) {
+    while (sampled_length.load() + local_length < target_length) {
         //std::cerr << "length vs target " << sampled_length << " < " << target_length << std::endl;
         // we randomly sample a starting node and orientation, weighted by node length
-        handle_t h = sample_handle(mt);
+        handle_t h = sample_handle(gen);
         // we collect all potential forward extensions
         step_ranges_t ranges;
         graph.for_each_step_on_handle(
@@ -60,7 +74,7 @@ void diff_priv_worker(const uint64_t tid,
             }
             // apply the exponential mechanism using weighted sampling
             // first we sample within the range of the sum of weights
-            double d = unif(mt) * sum_weights;
+            double d = unif(gen) * sum_weights;
             handle_t opt;
             // respect ranges
             double x = 0;
@@ -84,18 +98,31 @@ void diff_priv_worker(const uint64_t tid,
             if (ranges.size() >= min_haplotype_freq
                 && walk_length >= bp_limit) {
                 // get a random range to avoid orientation bias
-                auto& r = selector(ranges);
-                sampled_length.fetch_add(walk_length);
-                callback(r.first, r.second);
+                std::uniform_int_distribution<uint64_t> pick(0, ranges.size() - 1);
+                auto& r = ranges[pick(gen)];
+                walks.emplace_back();
+                auto& walk = walks.back();
+                for (step_handle_t s = r.first;
+                     ;
+                     s = graph.get_next_step(s)) {
+                    handle_t j = graph.get_handle_of_step(s);
+                    walk.push_back(priv.get_handle(graph.get_id(j), graph.get_is_reverse(j)));
+                    if (s == r.second) break;
+                }
+                local_length += walk_length;
+                if (local_length >= reduction_length) {
+                    reduce();
+                }
                 break;
             }
         }
     }
+    reduce();
 }
 
 void diff_priv(
     const PathHandleGraph& graph,
-    MutablePathDeletableHandleGraph& priv,
+    graph_t& priv,
     const double epsilon,
     const double target_coverage,
     const double min_haplotype_freq,
@@ -129,9 +156,9 @@ void diff_priv(
         });
     sdsl::bit_vector::rank_1_type graph_bv_rank;
     sdsl::util::assign(graph_bv_rank, sdsl::bit_vector::rank_1_type(&graph_bv));
-    std::uniform_int_distribution<uint64_t> dis_graph_pos = std::uniform_int_distribution<uint64_t>(0, graph_bp-1);
-    std::uniform_int_distribution<uint64_t> flip(0, 1);
-    auto sample_handle = [&](std::mt19937& gen) {
+    auto sample_handle = [&](XoshiroCpp::Xoshiro256Plus& gen) {
+        std::uniform_int_distribution<uint64_t> dis_graph_pos(0, graph_bp-1);
+        std::uniform_int_distribution<uint64_t> flip(0, 1);
         uint64_t pos = dis_graph_pos(gen)+1;
         uint64_t id = graph_bv_rank(pos);
         //std::cerr << "pos=" << pos << " id=" << id << std::endl;
@@ -144,60 +171,31 @@ void diff_priv(
         std::string banner = "[odgi::priv] exponential mechanism sampling subpaths:";
         sampling_progress = std::make_unique<progress_meter::ProgressMeter>(target_length, banner);
     }
-    std::atomic<size_t> written_paths(0);
-    // handles our sampled ranges
-    auto writer_callback = [&](step_handle_t a, step_handle_t b) {
-        // write the walk
-        std::stringstream ss;
-        ss << "hap" << ++written_paths;
-        std::string name = ss.str();
-        path_handle_t p;
-#pragma omp critical (priv_path_create)
-        {
-            p = priv.create_path_handle(name);
-        }
-        uint64_t sample_length = 0;
-        for (step_handle_t s = a;
-             ;
-             s = graph.get_next_step(s)) {
-            handle_t h = graph.get_handle_of_step(s);
-            sample_length += graph.get_length(h);
-            handle_t j = priv.get_handle(graph.get_id(h), graph.get_is_reverse(h));
-            priv.append_step(p, j);
-            if (s == b) break;
-        }
-        if (progress_reporting) {
-            sampling_progress->increment(sample_length);
-        }
-        if (write_samples) {
-            std::stringstream ss;
-            ss << name << "\t";
-            for (step_handle_t s = a;
-                 ;
-                 s = graph.get_next_step(s)) {
-                handle_t h = graph.get_handle_of_step(s);
-                ss << (graph.get_is_reverse(h) ? "<" : ">")
-                   << graph.get_id(h);
-                if (s == b) break;
-            }
-#pragma omp critical (cout)
-            std::cout << ss.str() << std::endl;
-        }
-    };
 
+    // each thread gets its own stream of the generator, and adds its sampled length to the total in steps
+    // of about 1% of the target, which bounds how far the threads overshoot it together
+    std::random_device rd;
+    XoshiroCpp::Xoshiro256Plus gen(((uint64_t)rd() << 32) | rd()); // fully random seed
+    const uint64_t reduction_length = std::max((uint64_t)1, target_length / (100 * std::max((uint64_t)1, nthreads)));
+    std::vector<sampled_walks_t> walks(nthreads);
     std::vector<std::thread> workers;
     workers.reserve(nthreads);
     for (uint64_t t = 0; t < nthreads; ++t) {
         workers.emplace_back(&diff_priv_worker,
                              t,
                              std::cref(graph),
-                             writer_callback,
-                             sample_handle,
+                             std::cref(priv),
+                             gen,
+                             std::cref(sample_handle),
                              std::ref(sampled_length),
                              target_length,
+                             reduction_length,
                              epsilon,
                              min_haplotype_freq,
-                             bp_limit);
+                             bp_limit,
+                             std::ref(walks[t]),
+                             sampling_progress.get());
+        gen.jump();
     }
 
     // stuff happens
@@ -210,6 +208,32 @@ void diff_priv(
         sampling_progress->finish();
     }
 
+    // name the walks in thread order, then write their steps in bulk and in parallel
+    std::vector<path_handle_t> walk_paths;
+    std::vector<std::vector<handle_t>*> walk_steps;
+    for (auto& thread_walks : walks) {
+        for (auto& walk : thread_walks) {
+            walk_paths.push_back(priv.create_path_handle("hap" + std::to_string(walk_paths.size() + 1)));
+            walk_steps.push_back(&walk);
+        }
+    }
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+    for (uint64_t i = 0; i < walk_paths.size(); ++i) {
+        priv.append_steps(walk_paths[i], *walk_steps[i]);
+    }
+    if (write_samples) {
+        for (uint64_t i = 0; i < walk_paths.size(); ++i) {
+            std::stringstream ss;
+            ss << priv.get_path_name(walk_paths[i]) << "\t";
+            for (auto& h : *walk_steps[i]) {
+                ss << (priv.get_is_reverse(h) ? "<" : ">")
+                   << priv.get_id(h);
+            }
+            std::cout << ss.str() << std::endl;
+        }
+    }
+    std::vector<sampled_walks_t>().swap(walks);
+
     // embed edges
     std::vector<path_handle_t> paths;
     priv.for_each_path_handle([&](const path_handle_t& p) {
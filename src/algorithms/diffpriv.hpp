@@ -12,7 +12,9 @@
 #include <handlegraph/path_handle_graph.hpp>
 #include <handlegraph/mutable_path_deletable_handle_graph.hpp>
 #include <handlegraph/util.hpp>
+#include "odgi.hpp"
 #include "progress.hpp"
+#include "XoshiroCpp.hpp"
 //#include "hash_map.hpp"
 
 namespace odgi {
@@ -22,8 +24,7 @@ using namespace handlegraph;
 
 void diff_priv(
     const PathHandleGraph& graph,
-    MutablePathDeletableHandleGraph& priv,
-    //PathHandleGraph& priv,
+    graph_t& priv,
     const double epsilon,
     const double target_coverage,
     const double min_haplotype_freq,
@@ -21,13 +21,12 @@ bool is_head_node(handle_t h, const HandleGraph* g) {
 }
 
 int32_t distance_to_head(handle_t h, int32_t limit, const HandleGraph* graph) {
-	unordered_set<handle_t> seen;
+	odgi::algorithms::visited_set_t seen(*graph);
 	return distance_to_head(h, limit, 0, seen, graph);
 }
 
-int32_t distance_to_head(handle_t h, int32_t limit, int32_t dist, unordered_set<handle_t>& seen, const HandleGraph* graph) {
-	if (seen.count(h)) return -1;
-	seen.insert(h);
+int32_t distance_to_head(handle_t h, int32_t limit, int32_t dist, odgi::algorithms::visited_set_t& seen, const HandleGraph* graph) {
+	if (!seen.insert(h)) return -1;
 	if (limit <= 0) {
 		return -1;
 	}
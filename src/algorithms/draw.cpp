@@ -1,5 +1,14 @@
 #include "draw.hpp"
 #include "split.hpp"
+#include "ordered_chunk_writer.hpp"
+#include "text_writer.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <zlib.h>
+#ifdef USE_GPU
+#include "cuda/draw.h"
+#endif
 
 namespace odgi {
 
@@ -50,6 +59,167 @@ void encodeWithState(const char *filename, std::vector<unsigned char> &image, un
     if (error) std::cout << "encoder error " << error << ": " << lodepng_error_text(error) << std::endl;
 }
 
+bool encode_rows(const std::string &filename, const uint64_t &width, const uint64_t &height,
+                 const std::function<void(const uint64_t &, unsigned char *)> &fill_row,
+                 const uint64_t &nthreads, const uint64_t &band_height) {
+    std::ofstream out(filename, std::ios::binary);
+    if (!out) {
+        std::cerr << "[odgi::png] error: cannot write " << filename << std::endl;
+        return false;
+    }
+    auto put_u32 = [](std::string &s, const uint32_t &v) {
+        s.push_back((char) (v >> 24));
+        s.push_back((char) (v >> 16));
+        s.push_back((char) (v >> 8));
+        s.push_back((char) v);
+    };
+    auto write_chunk = [&](const char *type, const std::string &data) {
+        std::string chunk;
+        put_u32(chunk, data.size());
+        chunk.append(type, 4);
+        chunk.append(data);
+        const uint32_t crc = crc32(crc32(0L, Z_NULL, 0), (const Bytef *) chunk.data() + 4, data.size() + 4);
+        put_u32(chunk, crc);
+        out.write(chunk.data(), chunk.size());
+    };
+
+    out.write("\x89PNG\r\n\x1a\n", 8);
+    std::string header;
+    put_u32(header, width);
+    put_u32(header, height);
+    header.push_back(8); // bit depth
+    header.push_back(6); // RGBA
+    header.push_back(0); // deflate
+    header.push_back(0); // adaptive filtering
+    header.push_back(0); // no interlace
+    write_chunk("IHDR", header);
+
+    // The bands are raw deflate streams, all but the last ending in a sync flush on a byte boundary, so
+    // their concatenation after a zlib header is one valid stream. The adler32 of the whole is combined
+    // from the adler32 of each band.
+    const uint64_t row_bytes = 4 * width + 1;
+    const uint64_t band_count = (height + band_height - 1) / band_height;
+    uLong adler = adler32(0L, Z_NULL, 0);
+    bool first_band = true;
+    bool ok = true;
+    for (uint64_t first = 0; first < band_count && ok; first += nthreads) {
+        const uint64_t last = std::min(band_count, first + nthreads);
+        std::vector<std::string> compressed(last - first);
+        std::vector<uLong> band_adler(last - first);
+        std::vector<uint64_t> band_size(last - first);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+        for (uint64_t b = first; b < last; ++b) {
+            const uint64_t y_begin = b * band_height;
+            const uint64_t y_end = std::min(height, y_begin + band_height);
+            std::vector<unsigned char> raw((y_end - y_begin) * row_bytes);
+            std::vector<unsigned char> row(4 * width);
+            for (uint64_t y = y_begin; y < y_end; ++y) {
+                fill_row(y, row.data());
+                // filter each scanline with Sub, which needs no other row
+                unsigned char *filtered = &raw[(y - y_begin) * row_bytes];
+                filtered[0] = 1;
+                for (uint64_t i = 0; i < 4 * width; ++i) {
+                    filtered[i + 1] = row[i] - (i >= 4 ? row[i - 4] : 0);
+                }
+            }
+            z_stream stream{};
+            deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+            std::string &z = compressed[b - first];
+            z.resize(deflateBound(&stream, raw.size()) + 16);
+            stream.next_in = raw.data();
+            stream.avail_in = raw.size();
+            stream.next_out = (Bytef *) &z[0];
+            stream.avail_out = z.size();
+            deflate(&stream, b + 1 == band_count ? Z_FINISH : Z_SYNC_FLUSH);
+            z.resize(z.size() - stream.avail_out);
+            deflateEnd(&stream);
+            band_adler[b - first] = adler32(adler32(0L, Z_NULL, 0), raw.data(), raw.size());
+            band_size[b - first] = raw.size();
+        }
+        for (uint64_t b = first; b < last; ++b) {
+            std::string data = first_band ? std::string("\x78\x9c", 2) : std::string();
+            first_band = false;
+            data.append(compressed[b - first]);
+            adler = adler32_combine(adler, band_adler[b - first], band_size[b - first]);
+            if (b + 1 == band_count) {
+                put_u32(data, adler);
+            }
+            write_chunk("IDAT", data);
+        }
+        ok = (bool) out;
+    }
+    write_chunk("IEND", std::string());
+    if (!out) {
+        std::cerr << "[odgi::png] error: cannot write " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+uint64_t encode_tile_pyramid(const std::string &dir, const std::vector<unsigned char> &image,
+                             const uint64_t &width, const uint64_t &height,
+                             const uint64_t &tile_size, const uint64_t &nthreads) {
+    uint64_t max_zoom = 0;
+    while ((tile_size << max_zoom) < std::max(width, height)) {
+        ++max_zoom;
+    }
+
+    std::vector<unsigned char> level = image;
+    uint64_t level_width = width;
+    uint64_t level_height = height;
+    for (int64_t zoom = max_zoom; zoom >= 0; --zoom) {
+        const uint64_t tiles_x = (level_width + tile_size - 1) / tile_size;
+        const uint64_t tiles_y = (level_height + tile_size - 1) / tile_size;
+        for (uint64_t tx = 0; tx < tiles_x; ++tx) {
+            std::filesystem::create_directories(dir + "/" + std::to_string(zoom) + "/" + std::to_string(tx));
+        }
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+        for (uint64_t t = 0; t < tiles_x * tiles_y; ++t) {
+            const uint64_t tx = t / tiles_y;
+            const uint64_t ty = t % tiles_y;
+            std::vector<unsigned char> tile(tile_size * tile_size * 4, 255);
+            const uint64_t x0 = tx * tile_size;
+            const uint64_t y0 = ty * tile_size;
+            const uint64_t w = std::min(tile_size, level_width - x0);
+            const uint64_t h = std::min(tile_size, level_height - y0);
+            for (uint64_t y = 0; y < h; ++y) {
+                std::copy(level.begin() + 4 * (level_width * (y0 + y) + x0),
+                          level.begin() + 4 * (level_width * (y0 + y) + x0 + w),
+                          tile.begin() + 4 * tile_size * y);
+            }
+            const std::string filename = dir + "/" + std::to_string(zoom) + "/" + std::to_string(tx)
+                                         + "/" + std::to_string(ty) + ".png";
+            encodeOneStep(filename.c_str(), tile, tile_size, tile_size);
+        }
+        if (zoom > 0) {
+            // halve the resolution, averaging each 2x2 block of pixels
+            const uint64_t half_width = (level_width + 1) / 2;
+            const uint64_t half_height = (level_height + 1) / 2;
+            std::vector<unsigned char> half(half_width * half_height * 4);
+#pragma omp parallel for schedule(static) num_threads(nthreads)
+            for (uint64_t y = 0; y < half_height; ++y) {
+                for (uint64_t x = 0; x < half_width; ++x) {
+                    for (uint8_t z = 0; z < 4; ++z) {
+                        uint64_t sum = 0;
+                        uint64_t count = 0;
+                        for (uint64_t sy = 2 * y; sy < std::min(2 * y + 2, level_height); ++sy) {
+                            for (uint64_t sx = 2 * x; sx < std::min(2 * x + 2, level_width); ++sx) {
+                                sum += level[4 * (level_width * sy + sx) + z];
+                                ++count;
+                            }
+                        }
+                        half[4 * (half_width * y + x) + z] = (sum + count / 2) / count;
+                    }
+                }
+            }
+            level.swap(half);
+            level_width = half_width;
+            level_height = half_height;
+        }
+    }
+    return max_zoom;
+}
+
 }
 
 namespace algorithms {
@@ -208,7 +378,9 @@ void draw_svg(std::ostream &out,
 			  std::vector<algorithms::color_t>& node_id_to_color,
               ska::flat_hash_map<handlegraph::nid_t, std::set<std::string>>& node_id_to_label_map,
               const float& sparsification_factor,
-              const bool& lengthen_left_nodes) {
+              const bool& lengthen_left_nodes,
+              const double& lod_tolerance,
+              const uint64_t& nthreads) {
 
     std::vector<std::vector<handle_t>> weak_components;
     coord_range_2d_t rendered_range;
@@ -236,106 +408,229 @@ void draw_svg(std::ostream &out,
         //<< "</style>"
         << std::endl;
 
-    auto range_itr = component_ranges.begin();
-    for (auto& component : weak_components) {
-        auto& range = *range_itr++;
-        auto& x_off = range.x_offset;
-        auto& y_off = range.y_offset;
-		//const algorithms::color_t node_color = !node_id_to_color.empty() ? node_id_to_color[graph.get_id(handle)] : COLOR_BLACK;
-
-        std::vector<handle_t> highlights;
-        std::vector<handle_t> nodes_with_labels;
-
-        for (auto& handle : component) {
-			algorithms::color_t color = node_id_to_color.empty() ? COLOR_BLACK : node_id_to_color[graph.get_id(handle)];
-
-            if (!(sparsification_factor == 0 || keep_node(graph.get_id(handle), sparsification_factor) || node_id_to_label_map.count(graph.get_id(handle)))) {
-                continue; // Skip this node to output a lighter SVG (do not nodes with labels, if any)
+    // In LOD mode, consecutive segments of the same color that meet within lod_tolerance are chained into
+    // polylines, which are simplified with Douglas-Peucker to drop the points closer than lod_tolerance to
+    // the line through their neighbors. Chains that fit in lod_tolerance are not drawn at all.
+    const bool lod = lod_tolerance > 0;
+    // enough decimals to place points to a tenth of the tolerance
+    const int lod_decimals = lod ? std::max(0, (int) std::ceil(-std::log10(lod_tolerance / 10))) : 0;
+    auto append_number = [&](std::string& text, const double& value) {
+        if (lod) {
+            algorithms::append_fixed(text, value, lod_decimals);
+        } else {
+            algorithms::append_shortest(text, value);
+        }
+    };
+    std::string stroke_width;
+    append_number(stroke_width, line_width);
+
+    auto append_line = [&](std::string& text, const Coordinates& c, const algorithms::color_t& color) {
+        text += "<line x1=\"";
+        append_number(text, c.x1);
+        text += "\" x2=\"";
+        append_number(text, c.x2);
+        text += "\" y1=\"";
+        append_number(text, c.y1);
+        text += "\" y2=\"";
+        append_number(text, c.y2);
+        text += "\" stroke=\"";
+        text += to_hexrgb(color); //to_rgba(color) // with rgba, nodes are invisible with InkScape
+        text += "\" stroke-width=\"";
+        text += stroke_width;
+        text += "\"/>\n";
+    };
+
+    auto append_chain = [&](std::string& text, std::vector<xy_d_t>& chain, const algorithms::color_t& chain_color) {
+        if (chain.empty()) {
+            return;
+        }
+        double min_x = chain.front().x, max_x = min_x, min_y = chain.front().y, max_y = min_y;
+        for (auto& p : chain) {
+            min_x = std::min(min_x, p.x);
+            max_x = std::max(max_x, p.x);
+            min_y = std::min(min_y, p.y);
+            max_y = std::max(max_y, p.y);
+        }
+        if (std::hypot(max_x - min_x, max_y - min_y) >= lod_tolerance) {
+            std::vector<bool> keep(chain.size(), false);
+            keep.front() = keep.back() = true;
+            std::vector<std::pair<uint64_t, uint64_t>> spans = {{0, chain.size() - 1}};
+            while (!spans.empty()) {
+                auto span = spans.back();
+                spans.pop_back();
+                const xy_d_t& a = chain[span.first];
+                const xy_d_t& b = chain[span.second];
+                const double length = std::hypot(b.x - a.x, b.y - a.y);
+                double farthest = 0;
+                uint64_t split = span.first;
+                for (uint64_t i = span.first + 1; i < span.second; ++i) {
+                    const xy_d_t& p = chain[i];
+                    const double d = length > 0
+                        ? std::abs((b.x - a.x) * (a.y - p.y) - (a.x - p.x) * (b.y - a.y)) / length
+                        : std::hypot(p.x - a.x, p.y - a.y);
+                    if (d > farthest) {
+                        farthest = d;
+                        split = i;
+                    }
+                }
+                if (farthest >= lod_tolerance) {
+                    keep[split] = true;
+                    spans.push_back({span.first, split});
+                    spans.push_back({split, span.second});
+                }
             }
-
-            Coordinates newEndpoints = adjustNodeEndpoints(handle, X, Y, scale, x_off, y_off, sparsification_factor, lengthen_left_nodes);
-
-            if (color == COLOR_BLACK || color == COLOR_LIGHTGRAY) {
-                out << "<line x1=\""
-                    << newEndpoints.x1
-                    << "\" x2=\""
-                    << newEndpoints.x2
-                    << "\" y1=\""
-                    << newEndpoints.y1
-                    << "\" y2=\""
-                    << newEndpoints.y2
-                    << "\" stroke=\"" << to_hexrgb(color)
-                    << "\" stroke-width=\"" << line_width
-                    << "\"/>"
-                    << std::endl;
-            } else {
-                highlights.push_back(handle);
+            text += "<polyline points=\"";
+            bool first = true;
+            for (uint64_t i = 0; i < chain.size(); ++i) {
+                if (keep[i]) {
+                    if (!first) {
+                        text += ' ';
+                    }
+                    append_number(text, chain[i].x);
+                    text += ',';
+                    append_number(text, chain[i].y);
+                    first = false;
+                }
             }
-
-            // Check if this is a node with a label
-            if (node_id_to_label_map.count(graph.get_id(handle))){
-                nodes_with_labels.push_back(handle);
+            text += "\" fill=\"none\" stroke=\"";
+            text += to_hexrgb(chain_color);
+            text += "\" stroke-width=\"";
+            text += stroke_width;
+            text += "\"/>\n";
+        }
+        chain.clear();
+    };
+
+    auto is_drawn = [&](const handle_t& handle) {
+        const nid_t id = graph.get_id(handle);
+        // skip nodes to output a lighter SVG, but not those with labels, if any
+        return sparsification_factor == 0 || keep_node(id, sparsification_factor) || node_id_to_label_map.count(id);
+    };
+    auto color_of = [&](const handle_t& handle) {
+        return node_id_to_color.empty() ? COLOR_BLACK : node_id_to_color[graph.get_id(handle)];
+    };
+
+    // the grey nodes of a component come first, its colored highlights on top of them, and its labels last
+    enum item_kind_t { GREY_NODES, HIGHLIGHTS, LABELS };
+    struct item_t {
+        uint64_t component;
+        uint64_t begin;
+        uint64_t end;
+        item_kind_t kind;
+    };
+    // nodes are formatted in parallel by blocks, but a LOD chain can run through a whole component
+    const uint64_t nodes_per_item = lod ? std::numeric_limits<uint64_t>::max() : 1 << 14;
+    std::vector<item_t> items;
+    // labels avoid the ones placed before them, so they are laid out up front in the order they are drawn
+    std::vector<std::string> labels_of(weak_components.size());
+    for (uint64_t c = 0; c < weak_components.size(); ++c) {
+        const auto& component = weak_components[c];
+        for (const item_kind_t kind : {GREY_NODES, HIGHLIGHTS}) {
+            for (uint64_t begin = 0; begin < component.size(); begin += std::min(nodes_per_item, component.size() - begin)) {
+                items.push_back({c, begin, begin + std::min(nodes_per_item, component.size() - begin), kind});
             }
         }
-
-        // Color highlights and put them after grey nodes to have colored nodes on top of grey ones
-        for (auto& handle : highlights) {
-            Coordinates newEndpoints = adjustNodeEndpoints(handle, X, Y, scale, x_off, y_off, sparsification_factor, lengthen_left_nodes);
-            algorithms::color_t color = node_id_to_color.empty() ? COLOR_BLACK : node_id_to_color[graph.get_id(handle)];
-            out << "<line x1=\""
-                << newEndpoints.x1
-                << "\" x2=\""
-                << newEndpoints.x2
-                << "\" y1=\""
-                << newEndpoints.y1
-                << "\" y2=\""
-                << newEndpoints.y2
-                << "\" stroke=\"" << to_hexrgb(color) //to_rgba(color) // with rgba, nodes are invisible with InkScape
-                << "\" stroke-width=\"" << line_width
-                << "\"/>"
-                << std::endl;
+        if (node_id_to_label_map.empty()) {
+            continue;
         }
-
-        // Render labels at the end, to have them on top of everything
-        for (auto& handle : nodes_with_labels) {
-            Coordinates newEndpoints = adjustNodeEndpoints(handle, X, Y, scale, x_off, y_off, sparsification_factor, lengthen_left_nodes);
+        const auto& range = component_ranges[c];
+        std::string& text = labels_of[c];
+        for (auto& handle : component) {
+            auto f = node_id_to_label_map.find(graph.get_id(handle));
+            if (f == node_id_to_label_map.end()) {
+                continue;
+            }
+            Coordinates newEndpoints = adjustNodeEndpoints(handle, X, Y, scale, range.x_offset, range.y_offset, sparsification_factor, lengthen_left_nodes);
 
             // Collect the labels that can be put without overlapping identical ones
             std::vector<std::string> labels;
-            for (auto text : node_id_to_label_map[graph.get_id(handle)]){
-                if (!is_too_close(newEndpoints.x2, newEndpoints.y2, text, 30.0, placed_labels)) {
-                    labels.push_back(text);
+            for (auto& label : f->second) {
+                if (!is_too_close(newEndpoints.x2, newEndpoints.y2, label, 30.0, placed_labels)) {
+                    labels.push_back(label);
                 }
             }
             // Check if there is something to label
-            if (!labels.empty()){
-                out << "<text font-family=\"Arial\" font-size=\"20\" fill=\"#000000\" stroke=\"#000000\" y=\"" << newEndpoints.y2 << "\">";
-                for (auto text : labels){
-                    out << "<tspan x=\"" << newEndpoints.x2 << "\" dy=\"1.0em\">" << text << "</tspan>";
-                    placed_labels.emplace_back(newEndpoints.x2, newEndpoints.y2, text); // Record the label's placement
+            if (!labels.empty()) {
+                text += "<text font-family=\"Arial\" font-size=\"20\" fill=\"#000000\" stroke=\"#000000\" y=\"";
+                append_number(text, newEndpoints.y2);
+                text += "\">";
+                for (auto& label : labels) {
+                    text += "<tspan x=\"";
+                    append_number(text, newEndpoints.x2);
+                    text += "\" dy=\"1.0em\">" + label + "</tspan>";
+                    placed_labels.emplace_back(newEndpoints.x2, newEndpoints.y2, label); // Record the label's placement
                 }
-                out << "</text>"
-                    << std::endl;
+                text += "</text>\n";
             }
         }
+        if (!text.empty()) {
+            items.push_back({c, 0, 0, LABELS});
+        }
     }
 
+    out.flush();
+    ordered_chunk_writer writer(out);
+    writer.open_writer();
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+    for (uint64_t k = 0; k < items.size(); ++k) {
+        const item_t& item = items[k];
+        std::string text;
+        if (item.kind == LABELS) {
+            text.swap(labels_of[item.component]);
+            writer.append(k, text, true);
+            continue;
+        }
+        const auto& component = weak_components[item.component];
+        const auto& range = component_ranges[item.component];
+        std::vector<xy_d_t> chain;
+        algorithms::color_t chain_color = COLOR_BLACK;
+        for (uint64_t i = item.begin; i < item.end; ++i) {
+            const handle_t& handle = component[i];
+            if (!is_drawn(handle)) {
+                continue;
+            }
+            const algorithms::color_t color = color_of(handle);
+            const bool highlight = !(color == COLOR_BLACK || color == COLOR_LIGHTGRAY);
+            if (highlight != (item.kind == HIGHLIGHTS)) {
+                continue;
+            }
+            Coordinates c = adjustNodeEndpoints(handle, X, Y, scale, range.x_offset, range.y_offset, sparsification_factor, lengthen_left_nodes);
+            if (!lod) {
+                append_line(text, c, color);
+            } else if (!chain.empty() && color == chain_color
+                       && std::hypot(c.x1 - chain.back().x, c.y1 - chain.back().y) <= lod_tolerance) {
+                chain.push_back({c.x2, c.y2});
+            } else {
+                append_chain(text, chain, chain_color);
+                chain_color = color;
+                chain.push_back({c.x1, c.y1});
+                chain.push_back({c.x2, c.y2});
+            }
+        }
+        append_chain(text, chain, chain_color);
+        writer.append(k, text, true);
+    }
+    writer.close_writer();
+
     // todo, edges, paths, coverage, bins
 
     out << "</svg>" << std::endl;
 }
 
-std::vector<uint8_t> rasterize(const std::vector<double> &X,
-                               const std::vector<double> &Y,
-                               const PathHandleGraph &graph,
-                               const double& scale,
-                               const double& border,
-                               uint64_t& width,
-                               uint64_t& height,
-                               const double& line_width,
-                               const double& path_line_spacing,
-                               bool color_paths,
-                               std::vector<algorithms::color_t>& node_id_to_color) {
+// draw the layout into an atomic image, which rasterize and draw_png then export
+static atomic_image_buf_t rasterize_image(const std::vector<double> &X,
+                                          const std::vector<double> &Y,
+                                          const PathHandleGraph &graph,
+                                          const double& scale,
+                                          const double& border,
+                                          uint64_t& width,
+                                          uint64_t& height,
+                                          const double& line_width,
+                                          const double& path_line_spacing,
+                                          bool color_paths,
+                                          std::vector<algorithms::color_t>& node_id_to_color,
+                                          const uint64_t& nthreads,
+                                          const bool& gpu) {
 
     std::vector<std::vector<handle_t>> weak_components;
     coord_range_2d_t rendered_range;
@@ -370,19 +665,25 @@ std::vector<uint8_t> rasterize(const std::vector<double> &X,
                              source_width, source_height,
                              source_min_x, source_min_y);
 
+    // The segments are listed in drawing order, with the highlights of each component after its other nodes,
+    // then bucketed by the tiles they can touch. Each tile is drawn by one thread in that order, so the pixels
+    // come out as if all segments had been drawn one after the other.
+    struct draw_target_t {
+        xy_d_t xy0;
+        xy_d_t xy1;
+        algorithms::color_t color;
+        handle_t handle;
+    };
+    std::vector<draw_target_t> targets;
+    targets.reserve(graph.get_node_count());
     auto range_itr = component_ranges.begin();
-	struct draw_target_t {
-		xy_d_t xy0;
-		xy_d_t xy1;
-		algorithms::color_t color;
-	};
-	
     for (auto& component : weak_components) {
         auto& range = *range_itr++;
         auto& x_off = range.x_offset;
         auto& y_off = range.y_offset;
-		std::vector<draw_target_t> highlights;
-//#pragma omp parallel for
+        const uint64_t first = targets.size();
+        targets.resize(first + component.size());
+#pragma omp parallel for schedule(static) num_threads(nthreads)
         for (uint64_t i = 0; i < component.size(); ++i) {
             const handle_t& handle = component[i];
             uint64_t a = 2 * number_bool_packing::unpack_number(handle);
@@ -402,17 +703,89 @@ std::vector<uint8_t> rasterize(const std::vector<double> &X,
                      source_width, source_height,
                      2, 2,
                      width-4, height-4);
+            const algorithms::color_t node_color = !color_paths && !node_id_to_color.empty()
+                ? node_id_to_color[graph.get_id(handle)] : COLOR_BLACK;
+            targets[first + i] = {xy0, xy1, node_color, handle};
+        }
+        if (!color_paths) {
+            // if gray or black color, otherwise save for later
+            std::stable_partition(targets.begin() + first, targets.end(), [](const draw_target_t& target) {
+                return target.color == COLOR_BLACK || target.color == COLOR_LIGHTGRAY;
+            });
+        }
+    }
+
+#ifdef USE_GPU
+    // the segments go to the GPU in drawing order, which it keeps where they overlap
+    if (gpu && !color_paths) {
+        std::vector<cuda::draw_segment_t> segments(targets.size());
+#pragma omp parallel for schedule(static) num_threads(nthreads)
+        for (uint64_t i = 0; i < targets.size(); ++i) {
+            const draw_target_t& target = targets[i];
+            segments[i] = {(float) target.xy0.x, (float) target.xy0.y,
+                           (float) target.xy1.x, (float) target.xy1.y, target.color.hex};
+        }
+        std::vector<uint32_t> pixels;
+        if (cuda::draw_segments(segments, width, height, line_width / image.source_per_px_y, pixels)) {
+#pragma omp parallel for schedule(static) num_threads(nthreads)
+            for (uint64_t i = 0; i < pixels.size(); ++i) {
+                image.pixels[i].store(pixels[i], std::memory_order_relaxed);
+            }
+            return image;
+        }
+        std::cerr << "[odgi::draw] warning: the image does not fit on the GPU, drawing it on the CPU" << std::endl;
+    }
+#endif
+
+    // how far from its center line a segment can draw, in pixels, including the antialiasing
+    auto reach_of = [&](const draw_target_t& target) -> double {
+        if (color_paths) {
+            const double steps = graph.get_step_count(target.handle);
+            return steps * (line_width + path_line_spacing) / image.source_per_px_y
+                + line_width / image.source_per_px_y / image.source_per_px_y + 3;
+        } else {
+            return line_width / image.source_per_px_y + 3;
+        }
+    };
+    const uint64_t tile_size = 256;
+    const uint64_t tiles_x = (width + tile_size - 1) / tile_size;
+    const uint64_t tiles_y = (height + tile_size - 1) / tile_size;
+    auto tile_of = [&](const double& v, const uint64_t& tiles) -> uint64_t {
+        return v <= 0 ? 0 : std::min(tiles - 1, (uint64_t) (v / tile_size));
+    };
+    std::vector<std::vector<uint64_t>> tile_targets(tiles_x * tiles_y);
+    for (uint64_t i = 0; i < targets.size(); ++i) {
+        const draw_target_t& target = targets[i];
+        const double reach = reach_of(target);
+        const uint64_t tx0 = tile_of(std::min(target.xy0.x, target.xy1.x) - reach, tiles_x);
+        const uint64_t tx1 = tile_of(std::max(target.xy0.x, target.xy1.x) + reach, tiles_x);
+        const uint64_t ty0 = tile_of(std::min(target.xy0.y, target.xy1.y) - reach, tiles_y);
+        const uint64_t ty1 = tile_of(std::max(target.xy0.y, target.xy1.y) + reach, tiles_y);
+        for (uint64_t ty = ty0; ty <= ty1; ++ty) {
+            for (uint64_t tx = tx0; tx <= tx1; ++tx) {
+                tile_targets[ty * tiles_x + tx].push_back(i);
+            }
+        }
+    }
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+    for (uint64_t t = 0; t < tile_targets.size(); ++t) {
+        const uint64_t x0 = (t % tiles_x) * tile_size;
+        const uint64_t y0 = (t / tiles_x) * tile_size;
+        atomic_image_buf_t tile(image, x0, y0, x0 + tile_size, y0 + tile_size);
+        for (auto& i : tile_targets[t]) {
+            const draw_target_t& target = targets[i];
             if (color_paths) {
                 std::vector<color_t> path_colors;
                 graph.for_each_step_on_handle(
-                    handle,
+                    target.handle,
                     [&](const step_handle_t& s) {
                         path_colors.push_back(
                             all_path_colors[as_integer(graph.get_path_handle_of_step(s))-1]);
                     });
                 // for step on handle
                 // get the path color
-                wu_calc_rainbow(xy0, xy1, image, path_colors, path_line_spacing, line_width);
+                wu_calc_rainbow(target.xy0, target.xy1, tile, path_colors, path_line_spacing, line_width);
             } else {
                 /*
                 aaline(xy0, xy1,
@@ -420,25 +793,32 @@ std::vector<uint8_t> rasterize(const std::vector<double> &X,
                        image,
                        line_width);
                 */
-                const algorithms::color_t node_color = !node_id_to_color.empty() ? node_id_to_color[graph.get_id(handle)] : COLOR_BLACK;
-
-				// if gray or black color, otherwise save for later
-				if (node_color == COLOR_BLACK || node_color == COLOR_LIGHTGRAY) {
-					wu_calc_wide_line(xy0, xy1, node_color, image, line_width);
-				} else {
-					highlights.push_back({xy0, xy1, node_color});
-				}
+                wu_calc_wide_line(target.xy0, target.xy1, target.color, tile, line_width);
             }
         }
-		// color highlights
-		for (auto& highlight : highlights) {
-			wu_calc_wide_line(highlight.xy0, highlight.xy1, highlight.color, image, line_width);
-		}
+        std::vector<uint64_t>().swap(tile_targets[t]);
     }
 
     // todo, edges, paths, coverage, bins
     
-    return image.to_bytes();
+    return image;
+}
+
+std::vector<uint8_t> rasterize(const std::vector<double> &X,
+                               const std::vector<double> &Y,
+                               const PathHandleGraph &graph,
+                               const double& scale,
+                               const double& border,
+                               uint64_t& width,
+                               uint64_t& height,
+                               const double& line_width,
+                               const double& path_line_spacing,
+                               bool color_paths,
+                               std::vector<algorithms::color_t>& node_id_to_color,
+                               const uint64_t& nthreads,
+                               const bool& gpu) {
+    return rasterize_image(X, Y, graph, scale, border, width, height,
+                           line_width, path_line_spacing, color_paths, node_id_to_color, nthreads, gpu).to_bytes();
 }
 
 void draw_png(const std::string& filename,
@@ -452,18 +832,32 @@ void draw_png(const std::string& filename,
               const double& line_width,
               const double& path_line_spacing,
               bool color_paths,
-              std::vector<algorithms::color_t>& node_id_to_color) {
-    auto bytes = rasterize(X, Y,
-                           graph,
-                           scale,
-                           border,
-                           width,
-                           height,
-                           line_width,
-                           path_line_spacing,
-                           color_paths,
-                           node_id_to_color);
-    png::encodeOneStep(filename.c_str(), bytes, width, height);
+              std::vector<algorithms::color_t>& node_id_to_color,
+              const uint64_t& nthreads,
+              const bool& gpu) {
+    atomic_image_buf_t image = rasterize_image(X, Y,
+                                               graph,
+                                               scale,
+                                               border,
+                                               width,
+                                               height,
+                                               line_width,
+                                               path_line_spacing,
+                                               color_paths,
+                                               node_id_to_color,
+                                               nthreads,
+                                               gpu);
+    // stream the rows out of the atomic image, rather than copying it to bytes for lodepng
+    png::encode_rows(filename, width, height,
+                     [&](const uint64_t& y, unsigned char* row) {
+                         for (uint64_t x = 0; x < width; ++x) {
+                             const color_t c = {(*image.image)[width * y + x].load()};
+                             row[4 * x    ] = c.c.r;
+                             row[4 * x + 1] = c.c.g;
+                             row[4 * x + 2] = c.c.b;
+                             row[4 * x + 3] = c.c.a;
+                         }
+                     }, nthreads);
 }
 
 }
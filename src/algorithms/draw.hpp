@@ -8,6 +8,7 @@
 #include <set>
 #include <thread>
 #include <atomic>
+#include <functional>
 #include <handlegraph/path_handle_graph.hpp>
 #include <handlegraph/handle_graph.hpp>
 #include "weakly_connected_components.hpp"
@@ -25,6 +26,23 @@ void encodeOneStep(const char *filename, std::vector<unsigned char> &image, unsi
 void encodeTwoSteps(const char *filename, std::vector<unsigned char> &image, unsigned width, unsigned height);
 void encodeWithState(const char *filename, std::vector<unsigned char> &image, unsigned width, unsigned height);
 
+/// Write a width * height RGBA PNG whose rows are produced on demand by fill_row(y, row), which gets
+/// 4 * width bytes to fill. The rows are taken in bands of band_height, each band deflated on its own
+/// by one of nthreads threads and appended as an IDAT chunk, like pigz does for gzip, so only nthreads
+/// bands are in memory at a time. fill_row may be called from several threads at once. Returns false
+/// and reports on stderr if the file could not be written.
+bool encode_rows(const std::string &filename, const uint64_t &width, const uint64_t &height,
+                 const std::function<void(const uint64_t &, unsigned char *)> &fill_row,
+                 const uint64_t &nthreads, const uint64_t &band_height = 256);
+
+/// Write the width * height RGBA image as a pyramid of tile_size * tile_size PNG tiles in dir/zoom/x/y.png.
+/// Zoom 0 holds the whole image in one tile, and each following zoom doubles the resolution, up to the
+/// full image at the last one. Tiles on the right and bottom edges are padded with white. Each zoom is
+/// downsampled from the next one, and its tiles are encoded in parallel. Returns the last zoom level.
+uint64_t encode_tile_pyramid(const std::string &dir, const std::vector<unsigned char> &image,
+                             const uint64_t &width, const uint64_t &height,
+                             const uint64_t &tile_size, const uint64_t &nthreads);
+
 }
 
 namespace algorithms {
@@ -74,7 +92,9 @@ void draw_svg(std::ostream &out,
 			  std::vector<algorithms::color_t>& node_id_to_color,
               ska::flat_hash_map<handlegraph::nid_t, std::set<std::string>>& node_id_to_label_map,
               const float& sparsification_factor,
-              const bool& lengthen_left_nodes);
+              const bool& lengthen_left_nodes,
+              const double& lod_tolerance = 0,
+              const uint64_t& nthreads = 1);
 
 std::vector<uint8_t> rasterize(const std::vector<double> &X,
                                const std::vector<double> &Y,
@@ -86,8 +106,11 @@ std::vector<uint8_t> rasterize(const std::vector<double> &X,
                                const double& line_width,
                                const double& path_line_spacing,
                                bool color_paths,
-                               std::vector<algorithms::color_t>& node_id_to_color);
+                               std::vector<algorithms::color_t>& node_id_to_color,
+                               const uint64_t& nthreads = 1,
+                               const bool& gpu = false);
 
+/// With gpu, on a build with -DUSE_GPU=ON, the nodes are drawn by cuda::draw_segments, unless the paths are colored
 void draw_png(const std::string& filename,
               const std::vector<double> &X,
               const std::vector<double> &Y,
@@ -99,7 +122,9 @@ void draw_png(const std::string& filename,
               const double& line_width,
               const double& path_line_spacing,
               bool color_paths,
-              std::vector<algorithms::color_t>& node_id_to_color);
+              std::vector<algorithms::color_t>& node_id_to_color,
+              const uint64_t& nthreads = 1,
+              const bool& gpu = false);
 
 
 
@@ -0,0 +1,165 @@
+#pragma once
+
+/**
+ * \file external_sort.hpp
+ *
+ * Defines a sorter that keeps a bounded buffer in memory and spills sorted runs to temporary files
+ * once it is full, merging them when the values are read back.
+ */
+
+#include <vector>
+#include <string>
+#include <queue>
+#include <fstream>
+#include <functional>
+#include <type_traits>
+#include <algorithm>
+#include <cstdint>
+#include "ips4o.hpp"
+#include "xp.hpp"
+
+namespace odgi {
+namespace algorithms {
+
+/// Sorts values of a trivially copyable type in runs of at most buffer_bytes, so that the memory it
+/// takes does not grow with the data. While they fit in the buffer, the values are only sorted in
+/// memory. Push is not thread-safe; the runs are sorted with nthreads threads.
+template<typename T, typename Less = std::less<T>>
+class external_sorter_t {
+    static_assert(std::is_trivially_copyable<T>::value, "the values are written to disk as they are");
+public:
+
+    external_sorter_t(const uint64_t& buffer_bytes, const uint64_t& nthreads,
+                      const std::string& base = "sort", const Less& less = Less())
+        : capacity(std::max((uint64_t) 1, buffer_bytes / sizeof(T))), nthreads(nthreads), base(base), less(less) {
+    }
+
+    ~external_sorter_t(void) {
+        clear();
+    }
+
+    external_sorter_t(const external_sorter_t& other) = delete;
+    external_sorter_t& operator=(const external_sorter_t& other) = delete;
+
+    void push(const T& value) {
+        if (buffer.size() == capacity) {
+            spill();
+        } else if (buffer.size() == buffer.capacity()) {
+            // grow by doubling, but never past the buffer size
+            buffer.reserve(std::min(capacity, std::max((uint64_t) 1024, (uint64_t) buffer.size() * 2)));
+        }
+        buffer.push_back(value);
+        ++count;
+    }
+
+    /// The number of values pushed
+    uint64_t size(void) const {
+        return count;
+    }
+
+    /// The number of runs spilled to disk so far
+    uint64_t run_count(void) const {
+        return runs.size();
+    }
+
+    /// Call the lambda on each value in sorted order, after which the sorter is empty
+    void for_each(const std::function<void(const T&)>& lambda) {
+        if (runs.empty()) {
+            ips4o::parallel::sort(buffer.begin(), buffer.end(), less, nthreads);
+            for (auto& value : buffer) {
+                lambda(value);
+            }
+            clear();
+            return;
+        }
+        // the rest goes to a last run, so that the runs are read back in blocks that together
+        // take no more than the buffer did
+        if (!buffer.empty()) {
+            spill();
+        }
+        std::vector<T>().swap(buffer);
+        const uint64_t block = std::max((uint64_t) 1, capacity / runs.size());
+        std::vector<run_reader_t> readers(runs.size());
+        // the heads of the runs, the smallest on top, the earlier run first among equal values
+        auto greater = [&](const std::pair<T, uint64_t>& a, const std::pair<T, uint64_t>& b) {
+            return less(b.first, a.first) || (!less(a.first, b.first) && b.second < a.second);
+        };
+        std::priority_queue<std::pair<T, uint64_t>, std::vector<std::pair<T, uint64_t>>, decltype(greater)> heads(greater);
+        for (uint64_t i = 0; i < runs.size(); ++i) {
+            readers[i].in.open(runs[i], std::ios::binary);
+            readers[i].block = block;
+            readers[i].next();
+            if (readers[i].has_value()) {
+                heads.emplace(readers[i].value(), i);
+            }
+        }
+        while (!heads.empty()) {
+            const std::pair<T, uint64_t> head = heads.top();
+            heads.pop();
+            lambda(head.first);
+            auto& reader = readers[head.second];
+            reader.advance();
+            if (reader.has_value()) {
+                heads.emplace(reader.value(), head.second);
+            }
+        }
+        readers.clear();
+        clear();
+    }
+
+private:
+
+    /// Reads a run back block by block
+    struct run_reader_t {
+        std::ifstream in;
+        std::vector<T> values;
+        uint64_t block = 1;
+        uint64_t i = 0;
+
+        void next(void) {
+            values.resize(block);
+            in.read((char*) values.data(), block * sizeof(T));
+            values.resize(in.gcount() / sizeof(T));
+            i = 0;
+        }
+        bool has_value(void) const {
+            return i < values.size();
+        }
+        const T& value(void) const {
+            return values[i];
+        }
+        void advance(void) {
+            if (++i == values.size()) {
+                next();
+            }
+        }
+    };
+
+    void spill(void) {
+        ips4o::parallel::sort(buffer.begin(), buffer.end(), less, nthreads);
+        runs.push_back(xp::temp_file::create(base));
+        xp::temp_file::ofstream_t out(runs.back());
+        out.write((const char*) buffer.data(), buffer.size() * sizeof(T));
+        buffer.clear();
+    }
+
+    void clear(void) {
+        std::vector<T>().swap(buffer);
+        for (auto& run : runs) {
+            xp::temp_file::remove(run);
+        }
+        runs.clear();
+        count = 0;
+    }
+
+    const uint64_t capacity;
+    const uint64_t nthreads;
+    const std::string base;
+    Less less;
+    std::vector<T> buffer;
+    std::vector<std::string> runs;
+    uint64_t count = 0;
+};
+
+}
+}
@@ -81,6 +81,77 @@ ska::flat_hash_map<handle_t, size_t>  find_shortest_paths(const HandleGraph* g,
 
 }
 
+void shortest_path_workspace_t::begin(const uint64_t& handle_bound) {
+    if (epoch.size() < handle_bound) {
+        epoch.resize(handle_bound, 0);
+        dist.resize(handle_bound);
+    }
+    if (++current_epoch == 0) {
+        // the epochs wrapped around, so the old tags could look current
+        std::fill(epoch.begin(), epoch.end(), 0);
+        current_epoch = 1;
+    }
+    heap.clear();
+    order.clear();
+}
+
+void find_shortest_paths(const HandleGraph* g, handle_t start, bool traverse_leftward,
+                         shortest_path_workspace_t& workspace, const handle_t* target, size_t max_distance) {
+
+    // guess the handle range from the largest id, it's grown as needed to fit others
+    workspace.begin(2 * (uint64_t)std::max<nid_t>(g->max_node_id(), 0) + 2);
+    // a min-heap of tentative distances; a handle can be in it several times, and only its first
+    // pop counts, which takes the place of the updateable queue of the allocating version
+    auto greater = [](const std::pair<size_t, handle_t>& a, const std::pair<size_t, handle_t>& b) {
+        return a.first > b.first;
+    };
+    auto& heap = workspace.heap;
+    heap.emplace_back(0, start);
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), greater);
+        size_t distance;
+        handle_t current;
+        std::tie(distance, current) = heap.back();
+        heap.pop_back();
+        if (distance > max_distance || !workspace.set(current, distance)) {
+            continue;
+        }
+        workspace.order.push_back(current);
+        if (target && current == *target) {
+            break;
+        }
+        if (current != start) {
+            // count distance from the end of the start handle, as above
+            distance += g->get_length(current);
+        }
+        g->follow_edges(current, traverse_leftward, [&](const handle_t& next) {
+            if (!workspace.reached(next)) {
+                heap.emplace_back(distance, next);
+                std::push_heap(heap.begin(), heap.end(), greater);
+            }
+        });
+    }
+}
+
+std::vector<size_t> find_shortest_path_lengths(const HandleGraph* g,
+                                               const std::vector<std::pair<handle_t, handle_t>>& queries,
+                                               const uint64_t& nthreads,
+                                               bool traverse_leftward,
+                                               size_t max_distance) {
+    std::vector<size_t> lengths(queries.size(), std::numeric_limits<size_t>::max());
+#pragma omp parallel num_threads(nthreads)
+    {
+        shortest_path_workspace_t workspace;
+#pragma omp for schedule(dynamic, 1)
+        for (uint64_t i = 0; i < queries.size(); ++i) {
+            find_shortest_paths(g, queries[i].first, traverse_leftward, workspace,
+                                &queries[i].second, max_distance);
+            lengths[i] = workspace.distance(queries[i].second);
+        }
+    }
+    return lengths;
+}
+
     
 }
 }
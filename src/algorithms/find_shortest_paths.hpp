@@ -7,6 +7,8 @@
  */
 
 #include <unordered_map>
+#include <vector>
+#include <limits>
 
 #include "position.hpp"
 #include "hash_map.hpp"
@@ -23,6 +25,65 @@ using namespace handlegraph;
 /// side of the start node and the incoming side of the target.
 ska::flat_hash_map<handle_t, size_t>  find_shortest_paths(const HandleGraph* g, handle_t start,
                                                           bool traverse_leftward = false);
+
+/// Scratch space for repeated shortest path searches, to be kept by one thread. The
+/// distances are dense arrays indexed by handlegraph::as_integer of the handles, which
+/// suits graphs whose handles pack a compact node rank such as graph_t. Instead of
+/// clearing them, each search bumps an epoch and entries from older epochs count as unset.
+class shortest_path_workspace_t {
+public:
+    /// Is the handle reached by the last search?
+    inline bool reached(const handle_t& h) const {
+        const uint64_t i = as_integer(h);
+        return i < epoch.size() && epoch[i] == current_epoch;
+    }
+    /// The distance of a reached handle in the last search, or the maximum size_t
+    inline size_t distance(const handle_t& h) const {
+        return reached(h) ? dist[as_integer(h)] : std::numeric_limits<size_t>::max();
+    }
+    /// The handles settled by the last search, in the order of their distances
+    const std::vector<handle_t>& settled(void) const { return order; }
+private:
+    friend void find_shortest_paths(const HandleGraph* g, handle_t start, bool traverse_leftward,
+                                    shortest_path_workspace_t& workspace, const handle_t* target, size_t max_distance);
+    std::vector<size_t> dist;
+    std::vector<uint32_t> epoch;
+    uint32_t current_epoch = 0;
+    std::vector<std::pair<size_t, handle_t>> heap;
+    std::vector<handle_t> order;
+    /// start a new search, making every entry unset
+    void begin(const uint64_t& handle_bound);
+    /// give the handle a distance in this search if it has none yet
+    inline bool set(const handle_t& h, const size_t& d) {
+        const uint64_t i = as_integer(h);
+        if (i >= epoch.size()) {
+            epoch.resize(i + 1, 0);
+            dist.resize(i + 1);
+        }
+        if (epoch[i] == current_epoch) {
+            return false;
+        }
+        epoch[i] = current_epoch;
+        dist[i] = d;
+        return true;
+    }
+};
+
+/// The same Dijkstra search, made in the given workspace without allocating once it has
+/// grown to the graph. It stops after settling the target, if given, or at max_distance.
+void find_shortest_paths(const HandleGraph* g, handle_t start, bool traverse_leftward,
+                         shortest_path_workspace_t& workspace,
+                         const handle_t* target = nullptr,
+                         size_t max_distance = std::numeric_limits<size_t>::max());
+
+/// The shortest distances between many pairs of handles, measured as in find_shortest_paths,
+/// with the queries spread over nthreads threads that each reuse one workspace. Unreachable
+/// pairs, or those beyond max_distance, get the maximum size_t.
+std::vector<size_t> find_shortest_path_lengths(const HandleGraph* g,
+                                               const std::vector<std::pair<handle_t, handle_t>>& queries,
+                                               const uint64_t& nthreads,
+                                               bool traverse_leftward = false,
+                                               size_t max_distance = std::numeric_limits<size_t>::max());
                                                       
 }
 }
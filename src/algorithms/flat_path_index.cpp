@@ -0,0 +1,44 @@
+#include "flat_path_index.hpp"
+#include "numa.hpp"
+#include "huge_pages.hpp"
+
+namespace odgi {
+
+namespace algorithms {
+
+    uint64_t flat_path_index_t::size_in_bytes(const xp::XP &path_index) {
+        uint64_t step_count = 0;
+        const std::vector<xp::XPPath *> paths = path_index.get_paths();
+        for (auto *path : paths) {
+            step_count += path->handles.size();
+        }
+        return step_count * sizeof(step_t) + (paths.size() + 1) * sizeof(uint64_t);
+    }
+
+    void flat_path_index_t::build(const xp::XP &path_index, const uint64_t &nthreads) {
+        const std::vector<xp::XPPath *> paths = path_index.get_paths();
+        first_step.resize(paths.size() + 1);
+        first_step[0] = 0;
+        for (uint64_t i = 0; i < paths.size(); ++i) {
+            first_step[i + 1] = first_step[i] + paths[i]->handles.size();
+        }
+        steps.resize(first_step.back());
+#pragma omp parallel for schedule(dynamic,1) num_threads(nthreads)
+        for (uint64_t i = 0; i < paths.size(); ++i) {
+            const xp::XPPath &path = *paths[i];
+            step_t *out = &steps[first_step[i]];
+            const uint64_t step_count = path.handles.size();
+            for (uint64_t r = 0; r < step_count; ++r) {
+                out[r].handle = as_integer(path.handle(r));
+                out[r].pos = path.positions[r];
+            }
+        }
+        numa::interleave(first_step);
+        numa::interleave(steps);
+        huge_pages::advise(first_step);
+        huge_pages::advise(steps);
+    }
+
+}
+
+}
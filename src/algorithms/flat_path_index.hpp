@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <handlegraph/types.hpp>
+#include <handlegraph/util.hpp>
+#include "xp.hpp"
+
+namespace odgi {
+
+namespace algorithms {
+
+using namespace handlegraph;
+
+/// An uncompressed copy of the steps of an XP index, for the inner loops of the path-guided SGD.
+/// Each step of each path is stored in path order with its handle and nucleotide position, like the
+/// path_element_t array of the CUDA layout, so a lookup is one load instead of decoding bit-packed
+/// sdsl vectors. Step and path handles are the ones of the XP index it was built from.
+class flat_path_index_t {
+public:
+
+    /// Bytes that a flat copy of the given index takes
+    static uint64_t size_in_bytes(const xp::XP &path_index);
+
+    /// Copy the steps of all paths of the index
+    void build(const xp::XP &path_index, const uint64_t &nthreads);
+
+    bool empty(void) const {
+        return steps.empty();
+    }
+
+    inline handle_t get_handle_of_step(const step_handle_t &step_handle) const {
+        return as_handle(step(step_handle).handle);
+    }
+
+    inline size_t get_position_of_step(const step_handle_t &step_handle) const {
+        return step(step_handle).pos;
+    }
+
+    inline size_t get_path_step_count(const path_handle_t &path_handle) const {
+        const uint64_t i = as_integer(path_handle) - 1;
+        return first_step[i + 1] - first_step[i];
+    }
+
+private:
+
+    struct step_t {
+        uint64_t handle; // the handle as integer, the lowest bit is the orientation
+        uint64_t pos;    // 0-based nucleotide position of the step in its path
+    };
+
+    /// For each path, by path handle - 1, its first step in steps, and the total step count at the end
+    std::vector<uint64_t> first_step;
+    std::vector<step_t> steps;
+
+    inline const step_t &step(const step_handle_t &step_handle) const {
+        return steps[first_step[as_integers(step_handle)[0] - 1] + as_integers(step_handle)[1]];
+    }
+};
+
+}
+
+}
@@ -61,8 +61,12 @@ void flip_paths(graph_t& graph,
         }
     }
 
-#pragma omp parallel for
-    for (auto& path : paths) {
+    // Decide the orientation of each path and collect its steps in the new graph, one path per thread
+    std::vector<uint8_t> is_flipped(paths.size(), 0);
+    std::vector<std::vector<handle_t>> path_steps(paths.size());
+#pragma omp parallel for schedule(dynamic, 1)
+    for (uint64_t i = 0; i < paths.size(); ++i) {
+        const path_handle_t& path = paths[i];
         // ref_paths must not be flipped either
         if (!no_flip.count(path) && !ref_flip.count(path)) {
             // Check path orientation with respect to the graph
@@ -81,69 +85,59 @@ void flip_paths(graph_t& graph,
                 });
 
             // Check if the path should be flipped
-            bool flip_path = false;
             if (ref_flip.size() > 0) {
                 // if ref paths are reversed, reversed paths should be
                 // not flipped to stay consistent with the reference
-                flip_path = ref_rev > ref_fwd ? rev < fwd : rev > fwd;
+                is_flipped[i] = ref_rev > ref_fwd ? rev < fwd : rev > fwd;
             } else {
                 // those that tend to be reversed more than forward should be flipped
-                flip_path = rev > fwd;
+                is_flipped[i] = rev > fwd;
             }
-            if (flip_path) {
-                auto name = graph.get_path_name(path) + "_inv";
-                auto flipped = into.create_path_handle(name);
-                std::vector<handle_t> v;
-                graph.for_each_step_in_path(
-                    path,
-                    [&into,&v,&graph](const step_handle_t& s) {
-                        auto h = graph.flip(graph.get_handle_of_step(s));
-                        auto q = into.get_handle(graph.get_id(h), graph.get_is_reverse(h));
-                        v.push_back(q);
-                    });
-                std::reverse(v.begin(), v.end());
-                for (auto& q : v) {
-                    into.append_step(flipped, q);
+        }
+        auto& v = path_steps[i];
+        v.reserve(graph.get_step_count(path));
+        graph.for_each_step_in_path(
+            path,
+            [&](const step_handle_t& s) {
+                auto h = graph.get_handle_of_step(s);
+                if (is_flipped[i]) {
+                    h = graph.flip(h);
                 }
-            } else {
-                auto fwd = into.create_path_handle(graph.get_path_name(path));
-                graph.for_each_step_in_path(
-                    path,
-                    [&fwd,&into,&graph](const step_handle_t& s) {
-                        auto h = graph.get_handle_of_step(s);
-                        auto q = into.get_handle(graph.get_id(h), graph.get_is_reverse(h));
-                        into.append_step(fwd, q);
-                    });
-            }
-        } else {
-            // add the path as-is
-            auto fwd = into.create_path_handle(graph.get_path_name(path));
-            graph.for_each_step_in_path(
-                path,
-                [&fwd,&into,&graph](const step_handle_t& s) {
-                    auto h = graph.get_handle_of_step(s);
-                    auto q = into.get_handle(graph.get_id(h), graph.get_is_reverse(h));
-                    into.append_step(fwd, q);
-                });
+                v.push_back(into.get_handle(graph.get_id(h), graph.get_is_reverse(h)));
+            });
+        if (is_flipped[i]) {
+            std::reverse(v.begin(), v.end());
         }
     }
 
-    ska::flat_hash_set<std::pair<handle_t, handle_t>> edges_to_create;
-#pragma omp parallel for
-    for (auto& path : paths) {
-        // New edges can be due only when paths are flipped
-        if (!no_flip.count(path)) {
-            handle_t last;
-            const step_handle_t begin_step = into.path_begin(path);
-            into.for_each_step_in_path(path, [&](const step_handle_t &step) {
-                handle_t h = into.get_handle_of_step(step);
-                if (step != begin_step && !into.has_edge(last, h)) {
-    #pragma omp critical (edges_to_create)
-                    edges_to_create.insert({last, h});
+    // Create the paths in their original order, then fill them in bulk
+    std::vector<path_handle_t> into_paths(paths.size());
+    for (uint64_t i = 0; i < paths.size(); ++i) {
+        into_paths[i] = into.create_path_handle(graph.get_path_name(paths[i]) + (is_flipped[i] ? "_inv" : ""));
+    }
+#pragma omp parallel for schedule(dynamic, 1)
+    for (uint64_t i = 0; i < paths.size(); ++i) {
+        into.append_steps(into_paths[i], path_steps[i]);
+    }
+
+    // New edges can be due only when paths are flipped
+    std::vector<std::vector<std::pair<handle_t, handle_t>>> thread_edges(omp_get_max_threads());
+#pragma omp parallel for schedule(dynamic, 1)
+    for (uint64_t i = 0; i < paths.size(); ++i) {
+        if (is_flipped[i]) {
+            auto& edges = thread_edges[omp_get_thread_num()];
+            const auto& v = path_steps[i];
+            for (uint64_t j = 1; j < v.size(); ++j) {
+                if (!into.has_edge(v[j - 1], v[j])) {
+                    edges.emplace_back(v[j - 1], v[j]);
                 }
-                last = h;
-            });
+            }
         }
+        std::vector<handle_t>().swap(path_steps[i]);
+    }
+    ska::flat_hash_set<std::pair<handle_t, handle_t>> edges_to_create;
+    for (auto& edges : thread_edges) {
+        edges_to_create.insert(edges.begin(), edges.end());
     }
     // add missing edges
     for (auto edge: edges_to_create) {
@@ -11,9 +11,13 @@ namespace odgi {
     namespace algorithms {
 
     std::vector<handle_t>groom(const handlegraph::MutablePathDeletableHandleGraph &graph,
-							   bool progress_reporting, const std::vector<handlegraph::path_handle_t> target_paths, bool use_bfs) {
+							   bool progress_reporting, const std::vector<handlegraph::path_handle_t> target_paths, bool use_bfs,
+							   const uint64_t &nthreads) {
 			bool target_grooming = (target_paths.size() > 0);
 
+            // the heads, the components and the traversals all follow the edges, which are indexed once
+            const FrozenHandleGraph frozen(&graph, nthreads);
+
             // This (s) is our set of oriented nodes.
             //dyn::succinct_bitvector<dyn::spsi<dyn::packed_vector,256,16> > s;
             uint64_t min_handle_rank = std::numeric_limits<uint64_t>::max();
@@ -32,9 +36,9 @@ namespace odgi {
 				bool use_heads = true;
 				bool use_tails = false;
 				if (use_heads) {
-					seeds = head_nodes(&graph);
+					seeds = head_nodes(&frozen);
 				} else if (use_tails) {
-					seeds = tail_nodes(&graph);
+					seeds = tail_nodes(&frozen);
 				} else {
 					handle_t min_handle = number_bool_packing::pack(min_handle_rank, false);
 					seeds = {min_handle};
@@ -76,15 +80,20 @@ namespace odgi {
 				}
 			}
 
-            // We need to keep track of the nodes we haven't visited to seed subsequent runs of the BFS
-            dyn::succinct_bitvector<dyn::spsi<dyn::packed_vector, 256, 16> > unvisited, flipped;
-            for (uint64_t i = 0; i <= max_handle_rank; ++i) {
-                unvisited.push_back(1);
-                flipped.push_back(0);
+            // The components are groomed independently, so we run one traversal per component and thread.
+            // Within a component, the seeds are taken in the same order as in a traversal of the whole
+            // graph, then the unvisited node of the lowest rank as long as there is one, so the
+            // orientations come out the same.
+            const component_labels_t components = weakly_connected_component_labels(&frozen, nthreads);
+            std::vector<std::vector<handle_t>> component_seeds(components.size());
+            for (auto& seed : seeds) {
+                component_seeds[components.component_of[components.index_of(graph.get_id(seed))]].push_back(seed);
             }
+            std::vector<handle_t>().swap(seeds);
 
-            uint64_t prev_max_root = 0;
-            uint64_t prev_max_length = 0;
+            // We need to keep track of the nodes we haven't visited to seed subsequent runs of the BFS
+            std::vector<uint8_t> unvisited(max_handle_rank + 1, 1);
+            std::vector<uint8_t> flipped(max_handle_rank + 1, 0);
 
             std::unique_ptr<progress_meter::ProgressMeter> bfs_progress;
             if (progress_reporting) {
@@ -92,80 +101,66 @@ namespace odgi {
                 bfs_progress = std::make_unique<progress_meter::ProgressMeter>(graph.get_node_count(), banner);
             }
 
-            uint64_t edge_count = 0;
-
-            while (unvisited.rank1(unvisited.size()) != 0) {
-                if (use_bfs) {
-                    bfs(graph,
-                        [&graph, &unvisited, &flipped, &progress_reporting, &bfs_progress, &needs_flipping, &is_ref, &target_grooming]
-                        (const handle_t &h, const uint64_t &r, const uint64_t &l, const uint64_t &d) {
-                            if (progress_reporting) {
-                                bfs_progress->increment(1);
-                            }
-                            uint64_t i = number_bool_packing::unpack_number(h);
-                            unvisited.set(i, 0);
-							if (target_grooming && is_ref[i]) {
-								if (needs_flipping[i]) {
-									flipped.set(i, true);
-								} else {
-									flipped.set(i, false);
-								}
-							} else {
-								flipped.set(i, graph.get_is_reverse(h));
-							}
-                        },
-                        [&unvisited](const handle_t &h) {
-                            uint64_t i = number_bool_packing::unpack_number(h);
-                            return unvisited.at(i) == 0;
-                        },
-                        [&edge_count](const handle_t &l, const handle_t &h) {
-                            ++edge_count;
-                            return false;
-                        },
-                        [](void) { return false; },
-                        seeds,
-                        {},
-                        false); // don't use bidirectional search
-                    // get another seed
-                    if (unvisited.rank1(unvisited.size()) != 0) {
-                        uint64_t i = unvisited.select1(0);
-                        handle_t h = number_bool_packing::pack(i, false);
-                        seeds = {h};
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+            for (uint64_t c = 0; c < components.size(); ++c) {
+                std::vector<handle_t>& component_seed = component_seeds[c];
+                // the ranks of the component's nodes, to find the next seed
+                std::vector<uint64_t> ranks;
+                ranks.reserve(components.component_size(c));
+                for (uint64_t m = components.first_member[c]; m < components.first_member[c + 1]; ++m) {
+                    ranks.push_back(number_bool_packing::unpack_number(components.nodes[components.members[m]]));
+                }
+                std::sort(ranks.begin(), ranks.end());
+                auto next_unvisited = ranks.begin();
+
+                auto orient = [&](const handle_t &h) {
+                    if (progress_reporting) {
+                        bfs_progress->increment(1);
+                    }
+                    uint64_t i = number_bool_packing::unpack_number(h);
+                    unvisited[i] = 0;
+                    if (target_grooming && is_ref[i]) {
+                        flipped[i] = needs_flipping[i];
+                    } else {
+                        flipped[i] = graph.get_is_reverse(h);
+                    }
+                };
+                auto is_visited = [&unvisited](const handle_t &h) {
+                    uint64_t i = number_bool_packing::unpack_number(h);
+                    return unvisited[i] == 0;
+                };
+                while (true) {
+                    if (!component_seed.empty()) {
+                        if (use_bfs) {
+                            bfs(frozen,
+                                [&orient](const handle_t &h, const uint64_t &r, const uint64_t &l, const uint64_t &d) {
+                                    orient(h);
+                                },
+                                is_visited,
+                                [](const handle_t &l, const handle_t &h) {
+                                    return false;
+                                },
+                                [](void) { return false; },
+                                component_seed,
+                                {},
+                                false); // don't use bidirectional search
+                        } else {
+                            dfs(frozen,
+                                orient,
+                                is_visited,
+                                [](const handle_t& h) { return false; },
+                                [](void) { return false; },
+                                component_seed);
+                        }
                     }
-                } else {
-                    dfs(graph,
-                        [&graph, &unvisited, &flipped, &progress_reporting, &bfs_progress, &needs_flipping, &is_ref, &target_grooming]
-                        (const handle_t &h) {
-                            if (progress_reporting) {
-                                bfs_progress->increment(1);
-                            }
-                            uint64_t i = number_bool_packing::unpack_number(h);
-                            unvisited.set(i, 0);
-							if (target_grooming && is_ref[i]) {
-								if (needs_flipping[i]) {
-									flipped.set(i, true);
-								} else {
-									flipped.set(i, false);
-								}
-							} else {
-								flipped.set(i, graph.get_is_reverse(h));
-							}
-                        },
-                        [&unvisited](const handle_t &h) {
-                            uint64_t i = number_bool_packing::unpack_number(h);
-                            return unvisited.at(i) == 0;
-                        },
-                        [](const handle_t& h) { return false; },
-                        [](void) { return false; },
-                        seeds);
-                    //{},
-                    //false); // don't use bidirectional search
                     // get another seed
-                    if (unvisited.rank1(unvisited.size()) != 0) {
-                        uint64_t i = unvisited.select1(0);
-                        handle_t h = number_bool_packing::pack(i, false);
-                        seeds = {h};
+                    while (next_unvisited != ranks.end() && !unvisited[*next_unvisited]) {
+                        ++next_unvisited;
+                    }
+                    if (next_unvisited == ranks.end()) {
+                        break;
                     }
+                    component_seed = {number_bool_packing::pack(*next_unvisited, false)};
                 }
             }
 
@@ -10,6 +10,9 @@
 #include "topological_sort.hpp"
 #include "progress.hpp"
 #include "dfs.hpp"
+#include "bfs.hpp"
+#include "weakly_connected_components.hpp"
+#include "frozen_graph.hpp"
 
 namespace odgi {
     namespace algorithms {
@@ -17,13 +20,15 @@ namespace odgi {
         using namespace handlegraph;
 
 /**
- * Remove spurious inverting links based on a dominant orientation of the graph
+ * Remove spurious inverting links based on a dominant orientation of the graph,
+ * traversing the weakly connected components in nthreads threads
  */
         std::vector<handle_t>
         groom(const handlegraph::MutablePathDeletableHandleGraph &graph,
               bool progress_reporting,
 			  const std::vector<handlegraph::path_handle_t> target_paths,
-              bool use_bfs = true);
+              bool use_bfs = true,
+              const uint64_t &nthreads = 1);
 
     }
 }
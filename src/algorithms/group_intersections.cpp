@@ -0,0 +1,212 @@
+#include "group_intersections.hpp"
+#include "cpu_dispatch.hpp"
+
+#include <algorithm>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace odgi {
+namespace algorithms {
+
+namespace {
+
+/// shared[b] += weight * popcount(x & words[b]) for the n words, the rows of a word that all have one weight
+void add_weighted_and_counts_generic(const uint64_t x, const uint64_t *words, const uint64_t n,
+                                     const uint64_t weight, uint64_t *shared) {
+    for (uint64_t b = 0; b < n; ++b) {
+        shared[b] += weight * __builtin_popcountll(x & words[b]);
+    }
+}
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+
+__attribute__((target("popcnt")))
+void add_weighted_and_counts_popcnt(const uint64_t x, const uint64_t *words, const uint64_t n,
+                                    const uint64_t weight, uint64_t *shared) {
+    for (uint64_t b = 0; b < n; ++b) {
+        shared[b] += weight * __builtin_popcountll(x & words[b]);
+    }
+}
+
+/// Counts of at most 64 times a 64-bit weight, from the 32-bit products of its halves
+__attribute__((target("avx2")))
+inline __m256i mul_count_avx2(const __m256i counts, const __m256i weight_lo, const __m256i weight_hi) {
+    return _mm256_add_epi64(_mm256_mul_epu32(counts, weight_lo),
+                            _mm256_slli_epi64(_mm256_mul_epu32(counts, weight_hi), 32));
+}
+
+/// Four words at a time, counting the bits of each byte from a table of nibbles
+__attribute__((target("avx2,popcnt")))
+void add_weighted_and_counts_avx2(const uint64_t x, const uint64_t *words, const uint64_t n,
+                                  const uint64_t weight, uint64_t *shared) {
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_nibbles = _mm256_set1_epi8(0x0f);
+    const __m256i xs = _mm256_set1_epi64x((long long) x);
+    const __m256i weight_lo = _mm256_set1_epi64x((long long) (weight & 0xffffffff));
+    const __m256i weight_hi = _mm256_set1_epi64x((long long) (weight >> 32));
+    uint64_t b = 0;
+    for (; b + 4 <= n; b += 4) {
+        const __m256i v = _mm256_and_si256(xs, _mm256_loadu_si256((const __m256i *) (words + b)));
+        const __m256i bytes = _mm256_add_epi8(
+                _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, low_nibbles)),
+                _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), low_nibbles)));
+        const __m256i counts = _mm256_sad_epu8(bytes, _mm256_setzero_si256());
+        __m256i *out = (__m256i *) (shared + b);
+        _mm256_storeu_si256(out, _mm256_add_epi64(_mm256_loadu_si256(out), mul_count_avx2(counts, weight_lo, weight_hi)));
+    }
+    for (; b < n; ++b) {
+        shared[b] += weight * __builtin_popcountll(x & words[b]);
+    }
+}
+
+/// Eight words at a time with the vector popcount
+__attribute__((target("avx512f,avx512bw,avx512vpopcntdq,popcnt")))
+void add_weighted_and_counts_avx512(const uint64_t x, const uint64_t *words, const uint64_t n,
+                                    const uint64_t weight, uint64_t *shared) {
+    const __m512i xs = _mm512_set1_epi64((long long) x);
+    const __m512i weight_lo = _mm512_set1_epi64((long long) (weight & 0xffffffff));
+    const __m512i weight_hi = _mm512_set1_epi64((long long) (weight >> 32));
+    uint64_t b = 0;
+    for (; b + 8 <= n; b += 8) {
+        const __m512i counts = _mm512_popcnt_epi64(_mm512_and_si512(xs, _mm512_loadu_si512(words + b)));
+        const __m512i products = _mm512_add_epi64(_mm512_mul_epu32(counts, weight_lo),
+                                                  _mm512_slli_epi64(_mm512_mul_epu32(counts, weight_hi), 32));
+        _mm512_storeu_si512(shared + b, _mm512_add_epi64(_mm512_loadu_si512(shared + b), products));
+    }
+    for (; b < n; ++b) {
+        shared[b] += weight * __builtin_popcountll(x & words[b]);
+    }
+}
+
+#endif
+
+typedef void (*add_weighted_and_counts_t)(const uint64_t, const uint64_t *, const uint64_t, const uint64_t, uint64_t *);
+
+const cpu::kernel_t<add_weighted_and_counts_t> add_weighted_and_counts(
+        "group_intersections", {
+                {cpu::isa_generic, add_weighted_and_counts_generic},
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+                {cpu::isa_popcnt, add_weighted_and_counts_popcnt},
+                {cpu::isa_avx2, add_weighted_and_counts_avx2},
+                {cpu::isa_avx512, add_weighted_and_counts_avx512},
+#endif
+        });
+
+}
+
+void group_rows_t::add_node(const uint64_t &weight, const std::vector<std::pair<uint32_t, uint64_t>> &group_steps) {
+    if (group_steps.size() < 2) {
+        return;
+    }
+    uint64_t max_steps = 0;
+    for (auto &gs : group_steps) {
+        max_steps = std::max(max_steps, gs.second);
+    }
+    for (uint64_t k = 1; k <= max_steps; ++k) {
+        const uint64_t begin = groups.size();
+        for (auto &gs : group_steps) {
+            if (gs.second >= k) {
+                groups.push_back(gs.first);
+            }
+        }
+        if (groups.size() - begin < 2) {
+            // the deeper rows only get thinner
+            groups.resize(begin);
+            break;
+        }
+        weights.push_back(weight);
+        offsets.push_back(groups.size());
+    }
+}
+
+void group_intersections_t::build(const std::vector<group_rows_t> &parts,
+                                  const uint64_t &group_count,
+                                  const uint64_t &nthreads) {
+    this->group_count = group_count;
+    // sort the rows by weight, so that the words hold similar weights
+    std::vector<std::pair<uint64_t, std::pair<uint32_t, uint64_t>>> order;
+    uint64_t row_count = 0;
+    for (auto &part : parts) {
+        row_count += part.size();
+    }
+    order.reserve(row_count);
+    for (uint32_t p = 0; p < parts.size(); ++p) {
+        for (uint64_t i = 0; i < parts[p].size(); ++i) {
+            order.push_back({parts[p].weights[i], {p, i}});
+        }
+    }
+    std::sort(order.begin(), order.end());
+
+    word_count = (row_count + 63) / 64;
+    bits.assign(word_count * group_count, 0);
+    word_weight.assign(word_count, 0);
+    plane_offsets.assign(word_count + 1, 0);
+    // a word whose rows all have the same weight needs no planes
+#pragma omp parallel for schedule(static) num_threads(nthreads)
+    for (uint64_t w = 0; w < word_count; ++w) {
+        const uint64_t end = std::min(row_count, (w + 1) * 64);
+        const uint64_t min_weight = order[w * 64].first;
+        const uint64_t max_weight = order[end - 1].first;
+        word_weight[w] = min_weight;
+        uint64_t plane_count = 0;
+        if (min_weight != max_weight) {
+            for (uint64_t v = max_weight; v; v >>= 1) {
+                ++plane_count;
+            }
+        }
+        plane_offsets[w + 1] = plane_count;
+    }
+    for (uint64_t w = 0; w < word_count; ++w) {
+        plane_offsets[w + 1] += plane_offsets[w];
+    }
+    planes.assign(plane_offsets.back(), 0);
+#pragma omp parallel for schedule(static) num_threads(nthreads)
+    for (uint64_t w = 0; w < word_count; ++w) {
+        const uint64_t end = std::min(row_count, (w + 1) * 64);
+        uint64_t *word = &bits[w * group_count];
+        const uint64_t plane_count = plane_offsets[w + 1] - plane_offsets[w];
+        for (uint64_t r = w * 64; r < end; ++r) {
+            const uint64_t bit = (uint64_t) 1 << (r - w * 64);
+            const group_rows_t &part = parts[order[r].second.first];
+            const uint64_t i = order[r].second.second;
+            for (uint64_t j = part.offsets[i]; j < part.offsets[i + 1]; ++j) {
+                word[part.groups[j]] |= bit;
+            }
+            for (uint64_t j = 0; j < plane_count; ++j) {
+                if ((order[r].first >> j) & 1) {
+                    planes[plane_offsets[w] + j] |= bit;
+                }
+            }
+        }
+    }
+}
+
+void group_intersections_t::intersections_of(const uint32_t &a, std::vector<uint64_t> &shared) const {
+    shared.assign(group_count, 0);
+    for (uint64_t w = 0; w < word_count; ++w) {
+        const uint64_t *word = &bits[w * group_count];
+        const uint64_t x_a = word[a];
+        if (x_a == 0) {
+            continue;
+        }
+        const uint64_t plane_begin = plane_offsets[w];
+        const uint64_t plane_end = plane_offsets[w + 1];
+        if (plane_begin == plane_end) {
+            add_weighted_and_counts(x_a, word, group_count, word_weight[w], shared.data());
+        } else {
+            for (uint64_t b = 0; b < group_count; ++b) {
+                const uint64_t x = x_a & word[b];
+                if (x) {
+                    for (uint64_t j = plane_begin; j < plane_end; ++j) {
+                        shared[b] += (uint64_t) __builtin_popcountll(x & planes[j]) << (j - plane_begin);
+                    }
+                }
+            }
+        }
+    }
+}
+
+}
+}
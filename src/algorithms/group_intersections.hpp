@@ -0,0 +1,64 @@
+#pragma once
+
+/**
+ * \file group_intersections.hpp
+ *
+ * Defines a bit-parallel kernel for the weighted pairwise intersections of path groups.
+ */
+
+#include <vector>
+#include <cstdint>
+#include <utility>
+
+namespace odgi {
+namespace algorithms {
+
+/// The rows of a graph that two groups can share: each row is a weight, the length of a node, and
+/// the groups on it. A group stepping c times on a node is in c rows of that node, the k-th row
+/// holding the groups with at least k steps, so that summing the weights of the shared rows gives
+/// the sum over the nodes of the length times the smaller step count.
+struct group_rows_t {
+    std::vector<uint64_t> weights;
+    std::vector<uint64_t> offsets = {0};
+    std::vector<uint32_t> groups;
+
+    /// Add the rows of a node of length weight, given the steps of each group on it.
+    /// The rows holding a single group only add to its own length and are left out.
+    void add_node(const uint64_t &weight, const std::vector<std::pair<uint32_t, uint64_t>> &group_steps);
+
+    uint64_t size(void) const {
+        return weights.size();
+    }
+};
+
+/// The rows as one bit vector over the rows per group, stored word by word, so that the groups
+/// sharing a word of 64 rows are found with an and and a popcount. The rows are sorted by
+/// weight, and the weights of each word are split into bit planes, so a word only costs as
+/// many popcounts as its largest weight has bits, or one when its weights are all the same.
+class group_intersections_t {
+public:
+
+    /// Collect the rows added to the parts, possibly in several threads, for group_count groups
+    void build(const std::vector<group_rows_t> &parts,
+               const uint64_t &group_count,
+               const uint64_t &nthreads);
+
+    /// The weight of the rows group a shares with each group, into shared, which is resized to the group count.
+    /// The shared weight of a with itself only counts the rows with other groups.
+    void intersections_of(const uint32_t &a, std::vector<uint64_t> &shared) const;
+
+private:
+
+    uint64_t group_count = 0;
+    uint64_t word_count = 0;
+    /// word w of group g at w * group_count + g
+    std::vector<uint64_t> bits;
+    /// the weight of all rows of word w, or 0 if they differ and the planes are needed
+    std::vector<uint64_t> word_weight;
+    /// planes[plane_offsets[w] + j] holds bit j of the weights of word w
+    std::vector<uint64_t> plane_offsets;
+    std::vector<uint64_t> planes;
+};
+
+}
+}
@@ -1,5 +1,7 @@
 #include "heaps.hpp"
 
+#include <limits>
+
 namespace odgi {
 
 namespace algorithms {
@@ -9,7 +11,8 @@ void for_each_heap_permutation(const PathHandleGraph& graph,
                                const ska::flat_hash_map<path_handle_t, std::vector<interval_t>>& path_intervals,
                                uint64_t n_permutations,
                                uint64_t min_node_depth,
-                               const std::function<void(const std::vector<uint64_t>&, uint64_t)>& func) {
+                               const std::function<void(const std::vector<uint64_t>&, uint64_t)>& func,
+                               const coverage_matrix_t* coverage) {
     //const std::function<bool(const path_handle_t&, _t)>& in_range) {
     //std::vector<std::vector<path_handle_t>>
     auto get_permutation = [&](void) {
@@ -86,28 +89,142 @@ void for_each_heap_permutation(const PathHandleGraph& graph,
         }
     }
 
+    if (coverage != nullptr) {
+        // the target bp of each run, and the groups each path belongs to
+        std::vector<uint64_t> run_target_bp(coverage->get_run_count(), 0);
+#pragma omp parallel for
+        for (uint64_t run = 0; run < coverage->get_run_count(); ++run) {
+            const uint64_t first = coverage->get_run_first_node(run);
+            for (uint64_t rank = first; rank < first + coverage->get_run_node_count(run); ++rank) {
+                if (target_nodes[rank]) {
+                    run_target_bp[run] += graph.get_length(graph.get_handle(rank + 1));
+                }
+            }
+        }
+        std::vector<std::vector<uint64_t>> groups_of_path(coverage->get_path_count());
+        for (uint64_t j = 0; j < path_groups.size(); ++j) {
+            for (auto& path : path_groups[j]) {
+                groups_of_path[coverage->get_path_rank(path)].push_back(j);
+            }
+        }
+        const uint64_t never = std::numeric_limits<uint64_t>::max();
+#pragma omp parallel for
+        for (uint64_t i = 0; i < n_permutations; ++i) {
+            auto permutation = get_permutation();
+            std::vector<uint64_t> group_pos(path_groups.size());
+            for (uint64_t k = 0; k < permutation.size(); ++k) {
+                group_pos[permutation[k]] = k;
+            }
+            // when each path is first considered
+            std::vector<uint64_t> path_pos(groups_of_path.size(), never);
+            for (uint64_t p = 0; p < groups_of_path.size(); ++p) {
+                for (auto& j : groups_of_path[p]) {
+                    path_pos[p] = std::min(path_pos[p], group_pos[j]);
+                }
+            }
+            // a run is seen with the first of its paths
+            std::vector<uint64_t> vals(permutation.size(), 0);
+            for (uint64_t run = 0; run < run_target_bp.size(); ++run) {
+                if (run_target_bp[run]) {
+                    uint64_t seen_at = never;
+                    coverage->for_each_path_in_run(run, [&](const uint64_t& p, const uint64_t& c) {
+                        seen_at = std::min(seen_at, path_pos[p]);
+                    });
+                    if (seen_at != never) {
+                        vals[seen_at] += run_target_bp[run];
+                    }
+                }
+            }
+            for (uint64_t k = 1; k < vals.size(); ++k) {
+                vals[k] += vals[k - 1];
+            }
+            func(vals, i);
+        }
+        return;
+    }
+
+    // the target nodes each group steps on, as a bit vector over the target nodes of the graph
+    // XXX the graph must be node-id compacted for this trick!
+    const uint64_t node_count = graph.get_node_count();
+    auto for_each_group_node = [&](const uint64_t& j, std::vector<uint64_t>& node_bits,
+                                   const std::function<void(const uint64_t&)>& func) {
+        node_bits.assign((node_count + 63) / 64, 0);
+        for (auto& path : path_groups[j]) {
+            graph.for_each_step_in_path(
+                path,
+                [&](const step_handle_t& step) {
+                    uint64_t rank = graph.get_id(graph.get_handle_of_step(step))-1; // assumes compaction!
+                    if (target_nodes[rank]) {
+                        node_bits[rank / 64] |= (uint64_t) 1 << (rank % 64);
+                    }
+                });
+        }
+        for (uint64_t w = 0; w < node_bits.size(); ++w) {
+            for (uint64_t x = node_bits[w]; x; x &= x - 1) {
+                func(w * 64 + __builtin_ctzll(x));
+            }
+        }
+    };
+    // consecutive target nodes on the same groups are merged into one column, weighted by their
+    // length; the groups of a node are told apart by the xor of a random key per group
+    std::vector<uint64_t> node_signature(node_count, 0);
+#pragma omp parallel for schedule(dynamic, 1)
+    for (uint64_t j = 0; j < path_groups.size(); ++j) {
+        uint64_t key = (j + 1) * 0x9e3779b97f4a7c15ULL;
+        key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        key = (key ^ (key >> 27)) * 0x94d049bb133111ebULL;
+        key ^= key >> 31;
+        std::vector<uint64_t> node_bits;
+        for_each_group_node(j, node_bits, [&](const uint64_t& rank) {
+#pragma omp atomic
+            node_signature[rank] ^= key;
+        });
+    }
+    const uint32_t no_column = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> node_column(node_count, no_column);
+    std::vector<uint64_t> column_bp;
+    for (uint64_t rank = 0; rank < node_count; ++rank) {
+        if (target_nodes[rank] && node_signature[rank] != 0) {
+            if (column_bp.empty() || node_signature[rank] != node_signature[rank - 1]
+                || node_column[rank - 1] == no_column) {
+                column_bp.push_back(0);
+            }
+            node_column[rank] = column_bp.size() - 1;
+            column_bp.back() += graph.get_length(graph.get_handle(rank + 1));
+        }
+    }
+    std::vector<uint64_t>().swap(node_signature);
+    const uint64_t column_words = (column_bp.size() + 63) / 64;
+    std::vector<uint64_t> group_columns(path_groups.size() * column_words, 0);
+#pragma omp parallel for schedule(dynamic, 1)
+    for (uint64_t j = 0; j < path_groups.size(); ++j) {
+        uint64_t* columns = &group_columns[j * column_words];
+        std::vector<uint64_t> node_bits;
+        for_each_group_node(j, node_bits, [&](const uint64_t& rank) {
+            const uint32_t c = node_column[rank];
+            columns[c / 64] |= (uint64_t) 1 << (c % 64);
+        });
+    }
+    std::vector<uint32_t>().swap(node_column);
+
+    // each permutation ors the groups into the columns seen so far, adding the length of the new ones
 #pragma omp parallel for
     for (uint64_t i = 0; i < n_permutations; ++i) {
         auto permutation = get_permutation();
-        // XXX the graph must be node-id compacted for this trick!
-        std::vector<bool> seen_nodes(graph.get_node_count(), 0);
+        std::vector<uint64_t> seen(column_words, 0);
         uint64_t seen_bp = 0;
         std::vector<uint64_t> vals;
+        vals.reserve(permutation.size());
         for (auto& j : permutation) {
-            auto& paths = path_groups[j];
-            for (auto& path : paths) {
-                uint64_t pos = 0;
-                graph.for_each_step_in_path(
-                    path,
-                    [&](const step_handle_t& step) {
-                        auto h = graph.get_handle_of_step(step);
-                        uint64_t rank = graph.get_id(h)-1; // assumes compaction!
-                        if (target_nodes[rank] && !seen_nodes[rank]) {
-                            seen_nodes[rank] = 1;
-                            seen_bp += graph.get_length(h);
-                        }
-                        pos += graph.get_length(h);
-                    });
+            const uint64_t* columns = &group_columns[j * column_words];
+            for (uint64_t w = 0; w < column_words; ++w) {
+                const uint64_t x = columns[w] & ~seen[w];
+                if (x) {
+                    seen[w] |= x;
+                    for (uint64_t y = x; y; y &= y - 1) {
+                        seen_bp += column_bp[w * 64 + __builtin_ctzll(y)];
+                    }
+                }
             }
             vals.push_back(seen_bp);
         }
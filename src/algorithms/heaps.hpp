@@ -15,6 +15,7 @@
 #include <handlegraph/handle_graph.hpp>
 #include <handlegraph/path_handle_graph.hpp>
 #include <atomic_bitvector.hpp>
+#include "coverage_matrix.hpp"
 
 namespace odgi {
 
@@ -24,12 +25,16 @@ namespace algorithms {
 
 /// For each permutation of the path groups
 /// we call func with a vector that is the fraction of the pangenome covered when we've considered N groups in the permutation
+/// The paths are walked once, to give each group a bit vector over the target nodes, merged into columns of consecutive
+/// nodes on the same groups, so the permutations, run in parallel, only or these bit vectors and sum the new columns' lengths.
+/// If a coverage matrix of the graph is given, the nodes seen by each permutation are taken from its runs instead of the path steps
 void for_each_heap_permutation(const PathHandleGraph& graph,
                                const std::vector<std::vector<path_handle_t>>& path_groups,
                                const ska::flat_hash_map<path_handle_t, std::vector<interval_t>>& path_intervals,
                                uint64_t n_permutations,
                                uint64_t min_node_depth,
-                               const std::function<void(const std::vector<uint64_t>&, uint64_t)>& func);
+                               const std::function<void(const std::vector<uint64_t>&, uint64_t)>& func,
+                               const coverage_matrix_t* coverage = nullptr);
 
 }
 
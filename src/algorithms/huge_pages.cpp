@@ -0,0 +1,96 @@
+#include "huge_pages.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace odgi {
+namespace algorithms {
+
+namespace huge_pages {
+
+namespace {
+
+    // the size of a transparent huge page on x86-64 and on aarch64 with 4 KiB base pages
+    const uintptr_t huge_page_size = 2ULL << 20;
+
+#ifdef __linux__
+    // from linux/mman.h, for kernels and C libraries older than 6.1
+#ifndef MADV_COLLAPSE
+    const int madv_collapse = 25;
+#else
+    const int madv_collapse = MADV_COLLAPSE;
+#endif
+#endif
+
+    bool from_environment(void) {
+        const char *value = std::getenv("ODGI_HUGE_PAGES");
+        return value != nullptr && std::strcmp(value, "") != 0 && std::strcmp(value, "0") != 0;
+    }
+
+    std::atomic<bool> use_huge_pages(from_environment());
+    std::atomic<uint64_t> advised(0);
+
+}
+
+void set_enabled(const bool &enable) {
+    use_huge_pages.store(enable);
+}
+
+bool enabled(void) {
+    return use_huge_pages.load();
+}
+
+bool advise(const void *data, const size_t &bytes) {
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (!use_huge_pages.load() || data == nullptr) {
+        return false;
+    }
+    // only the huge pages that lie entirely in the range, the head and tail stay on base pages
+    const uintptr_t begin = ((uintptr_t) data + huge_page_size - 1) / huge_page_size * huge_page_size;
+    const uintptr_t end = ((uintptr_t) data + bytes) / huge_page_size * huge_page_size;
+    if (end <= begin) {
+        return false;
+    }
+    if (madvise((void *) begin, end - begin, MADV_HUGEPAGE) != 0) {
+        return false;
+    }
+    // the vectors are usually filled by the time they are advised; without a collapse their pages would
+    // wait for khugepaged. Kernels before 6.1 reject it, which leaves them to khugepaged as before.
+    madvise((void *) begin, end - begin, madv_collapse);
+    advised.fetch_add(end - begin);
+    return true;
+#else
+    return false;
+#endif
+}
+
+uint64_t advised_bytes(void) {
+    return advised.load();
+}
+
+uint64_t backed_bytes(void) {
+    std::ifstream rollup("/proc/self/smaps_rollup");
+    std::string line;
+    const std::string key = "AnonHugePages:";
+    while (std::getline(rollup, line)) {
+        if (line.compare(0, key.size(), key) == 0) {
+            try {
+                return std::stoull(line.substr(key.size())) * 1024; // kilobytes
+            } catch (const std::exception &) {
+                return 0;
+            }
+        }
+    }
+    return 0;
+}
+
+}
+
+}
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace odgi {
+namespace algorithms {
+
+/// Transparent huge pages for the large arrays that are read at random: the coordinates of the path
+/// guided SGD, the vectors of the path index and of the step indexes, and the image buffers of viz and
+/// draw. Backing them with 2 MiB pages rather than 4 KiB ones cuts the TLB misses of those random reads.
+/// The arrays stay in their std::vector and sdsl containers; their ranges are marked with
+/// madvise(MADV_HUGEPAGE), and the pages already touched are collapsed where the kernel supports it.
+/// Off by default, on with --huge-pages or ODGI_HUGE_PAGES=1. Everything is a no-op off Linux, when
+/// transparent huge pages are disabled system-wide, or on ranges too small to hold one huge page.
+namespace huge_pages {
+
+/// Turn the advice on or off; the default comes from the ODGI_HUGE_PAGES environment variable
+void set_enabled(const bool &enable);
+
+bool enabled(void);
+
+/// Ask for huge pages on the huge-page-aligned part of the given range.
+/// Returns false if the range was left as it was.
+bool advise(const void *data, const size_t &bytes);
+
+template<typename T>
+bool advise(const std::vector<T> &v) {
+    return advise(v.data(), v.size() * sizeof(T));
+}
+
+/// For sdsl int_vector and bit_vector
+template<typename V>
+bool advise_bits(const V &v) {
+    return advise(v.data(), (v.bit_size() + 63) / 64 * sizeof(uint64_t));
+}
+
+/// The bytes of all the ranges advised so far
+uint64_t advised_bytes(void);
+
+/// The bytes of the process's anonymous memory backed by huge pages right now, from /proc/self/smaps_rollup
+uint64_t backed_bytes(void);
+
+}
+
+}
+}
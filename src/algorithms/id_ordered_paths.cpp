@@ -1,72 +1,81 @@
 #include "id_ordered_paths.hpp"
+#include "path_tasks.hpp"
+#include "ips4o.hpp"
 
 namespace odgi {
 namespace algorithms {
 
-std::vector<path_handle_t> id_ordered_paths(const PathHandleGraph& g, bool avg, bool rev) {
-    return prefix_and_id_ordered_paths(g, "", avg, rev);
+std::vector<path_handle_t> id_ordered_paths(const PathHandleGraph& g, bool avg, bool rev, const uint64_t& nthreads) {
+    return prefix_and_id_ordered_paths(g, "", avg, rev, nthreads);
 }
 
-std::vector<path_handle_t> prefix_and_id_ordered_paths(const PathHandleGraph& g, const std::string& prefix_delimiter, bool avg, bool rev) {
+std::vector<path_handle_t> prefix_and_id_ordered_paths(const PathHandleGraph& g, const std::string& prefix_delimiter,
+                                                       bool avg, bool rev, const uint64_t& nthreads) {
+    std::vector<path_handle_t> paths;
+    paths.reserve(g.get_path_count());
+    g.for_each_path_handle([&](const path_handle_t& p) {
+            paths.push_back(p);
+        });
     // find the prefix order based on existing set
-    std::unordered_set<std::string> seen_prefixes;
-    std::unordered_map<std::string, uint64_t> initial_path_prefix_rank;
-    auto get_path_prefix = [&](const path_handle_t& p) -> std::string {
-        if (prefix_delimiter.empty()) {
-            return "";
-        } else {
-            std::string path_name = g.get_path_name(p);
-            return path_name.substr(0, path_name.find(prefix_delimiter));
+    std::vector<uint64_t> path_prefix_rank(paths.size(), 0);
+    if (!prefix_delimiter.empty()) {
+        std::vector<std::string> path_prefixes(paths.size());
+#pragma omp parallel for schedule(static) num_threads(nthreads)
+        for (uint64_t i = 0; i < paths.size(); ++i) {
+            std::string path_name = g.get_path_name(paths[i]);
+            path_prefixes[i] = path_name.substr(0, path_name.find(prefix_delimiter));
         }
-    };
-    g.for_each_path_handle([&](const path_handle_t& p) {
-            std::string path_prefix = get_path_prefix(p);
-            if (!seen_prefixes.count(path_prefix)) {
-                initial_path_prefix_rank[path_prefix] = seen_prefixes.size();
-                seen_prefixes.insert(path_prefix);
+        std::unordered_map<std::string, uint64_t> initial_path_prefix_rank;
+        for (uint64_t i = 0; i < paths.size(); ++i) {
+            auto f = initial_path_prefix_rank.find(path_prefixes[i]);
+            if (f == initial_path_prefix_rank.end()) {
+                f = initial_path_prefix_rank.emplace(path_prefixes[i], initial_path_prefix_rank.size()).first;
             }
-        });
-    std::vector<std::string> path_prefix_order(seen_prefixes.size());
-    for (auto& p : initial_path_prefix_rank) {
-        path_prefix_order[p.second] = p.first;
+            path_prefix_rank[i] = f->second;
+        }
     }
-    // accumulate the paths by their minimum id per prefix
-    std::unordered_map<std::string, std::vector<std::pair<double, path_handle_t> > > paths;
-    g.for_each_path_handle([&](const path_handle_t& p) {
-            // get the min id
+    // get the average or the min id of each path, the longest paths first
+    std::vector<double> path_ids(paths.size());
+    std::vector<uint64_t> costs(paths.size());
+#pragma omp parallel for schedule(static) num_threads(nthreads)
+    for (uint64_t i = 0; i < paths.size(); ++i) {
+        costs[i] = g.get_step_count(paths[i]);
+    }
+    run_tasks(costs, nthreads, [&](const uint64_t& i, const uint64_t& tid) {
             if (avg) {
                 double sum_id = 0;
                 uint64_t step_count = 0;
-                g.for_each_step_in_path(p, [&](const step_handle_t& occ) {
+                g.for_each_step_in_path(paths[i], [&](const step_handle_t& occ) {
                         sum_id += (double)g.get_id(g.get_handle_of_step(occ));
                         ++step_count;
                     });
-                std::string path_prefix = get_path_prefix(p);
-                paths[path_prefix].push_back(make_pair(sum_id/(double)step_count, p));
+                // empty paths go last, as they do when ordering by min id
+                path_ids[i] = step_count ? sum_id/(double)step_count : std::numeric_limits<double>::max();
             } else {
                 double min_id = std::numeric_limits<double>::max();
-                g.for_each_step_in_path(p, [&](const step_handle_t& occ) {
+                g.for_each_step_in_path(paths[i], [&](const step_handle_t& occ) {
                         min_id = std::min((double)g.get_id(g.get_handle_of_step(occ)), min_id);
                     });
-                std::string path_prefix = get_path_prefix(p);
-                paths[path_prefix].push_back(make_pair(min_id, p));
+                path_ids[i] = min_id;
             }
         });
-    for (auto& b : paths) {
-        auto& paths_by = b.second;
-        std::sort(paths_by.begin(), paths_by.end(), [&](const std::pair<double, path_handle_t>& a,
-                                                        const std::pair<double, path_handle_t>& b) {
-                      return a.first < b.first || a.first == b.first && as_integer(a.second) < as_integer(b.second);
-                  });
-        if (rev) {
-            std::reverse(paths_by.begin(), paths_by.end());
-        }
+    // sort by prefix, then by id, ties broken by path handle, reversed within each prefix if asked
+    std::vector<uint64_t> ranks(paths.size());
+    for (uint64_t i = 0; i < ranks.size(); ++i) {
+        ranks[i] = i;
     }
-    std::vector<path_handle_t> order; order.reserve(g.get_path_count());
-    for (auto& path_prefix : path_prefix_order) {
-        for (auto& p : paths[path_prefix]) {
-            order.push_back(p.second);
-        }
+    ips4o::parallel::sort(ranks.begin(), ranks.end(), [&](const uint64_t& a, const uint64_t& b) {
+            if (path_prefix_rank[a] != path_prefix_rank[b]) {
+                return path_prefix_rank[a] < path_prefix_rank[b];
+            }
+            const uint64_t& x = rev ? b : a;
+            const uint64_t& y = rev ? a : b;
+            return path_ids[x] < path_ids[y]
+                || path_ids[x] == path_ids[y] && as_integer(paths[x]) < as_integer(paths[y]);
+        }, nthreads);
+    std::vector<path_handle_t> order; order.reserve(paths.size());
+    for (auto& i : ranks) {
+        order.push_back(paths[i]);
     }
     return order;
 }
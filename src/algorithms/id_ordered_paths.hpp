@@ -17,9 +17,13 @@ namespace algorithms {
 using namespace std;
 using namespace handlegraph;
 
-std::vector<path_handle_t> id_ordered_paths(const PathHandleGraph& g, bool avg = true, bool rev = false);
+/// Order the paths by their average (or minimum) node id, walking and sorting them on nthreads threads
+std::vector<path_handle_t> id_ordered_paths(const PathHandleGraph& g, bool avg = true, bool rev = false,
+                                            const uint64_t& nthreads = 1);
 
-std::vector<path_handle_t> prefix_and_id_ordered_paths(const PathHandleGraph& g, const std::string& prefix_delimiter, bool avg = true, bool rev = false);
+/// Order the paths by the first appearance of their name prefix up to prefix_delimiter, then as id_ordered_paths
+std::vector<path_handle_t> prefix_and_id_ordered_paths(const PathHandleGraph& g, const std::string& prefix_delimiter,
+                                                       bool avg = true, bool rev = false, const uint64_t& nthreads = 1);
 
 }
 }
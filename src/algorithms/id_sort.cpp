@@ -1,6 +1,7 @@
 #include "id_sort.hpp"
 
 #include "apply_bulk_modifications.hpp"
+#include "ips4o.hpp"
 
 #include <algorithm>
 #include <vector>
@@ -11,18 +12,19 @@ namespace algorithms {
 using namespace std;
 using namespace handlegraph;
 
-vector<handle_t> id_order(HandleGraph* g) {
+vector<handle_t> id_order(const HandleGraph* g, const uint64_t& nthreads) {
     // We will fill and sort this
     vector<handle_t> to_return;
+    to_return.reserve(g->get_node_count());
     g->for_each_handle([&](const handle_t& handle) {
         // Collect all the handles
         to_return.push_back(handle);
     });
     
-    std::sort(to_return.begin(), to_return.end(), [&](const handle_t& a, const handle_t& b) {
-        // Sort in ID order with the standard algorithm
+    ips4o::parallel::sort(to_return.begin(), to_return.end(), [&](const handle_t& a, const handle_t& b) {
+        // Sort in ID order
         return g->get_id(a) < g->get_id(b);
-    });
+    }, nthreads);
     
     return to_return;
 }
@@ -22,8 +22,9 @@ using namespace handlegraph;
 
 /**
  * Order all the handles in the graph in ID order. All orientations are forward.
+ * The handles are sorted on nthreads threads.
  */
-vector<handle_t> id_order(const HandleGraph* g);
+vector<handle_t> id_order(const HandleGraph* g, const uint64_t& nthreads = 1);
 
 /**
  * Sort the given handle graph by ID, and then apply that sort to re-order the
@@ -1,4 +1,6 @@
 #include "inject.hpp"
+#include "odgi.hpp"
+#include <deps/ips4o/ips4o.hpp>
 
 namespace odgi {
 
@@ -10,8 +12,10 @@ void inject_ranges(MutablePathDeletableHandleGraph& graph,
                    const ska::flat_hash_map<path_handle_t, std::vector<std::pair<interval_t, std::string>>>& path_intervals,
                    const std::vector<std::string>& ordered_intervals, const bool show_progress) {
 
-    // we collect cut points based on where our intervals start and end
-    ska::flat_hash_map<handle_t, std::vector<size_t>> cut_points;
+    // we collect cut points based on where our intervals start and end, in each thread,
+    // and group them by node once all paths are done
+    const uint64_t num_threads = omp_get_max_threads();
+    std::vector<std::vector<std::pair<handle_t, size_t>>> thread_cut_points(num_threads);
 
     // parallel over paths requires collecting path handles in a vector
     std::vector<path_handle_t> paths;
@@ -37,8 +41,10 @@ void inject_ranges(MutablePathDeletableHandleGraph& graph,
                 num_intervals.load(), "[odgi::inject] collecting cut points");
     }
 
-#pragma omp parallel for
-    for (auto& path : paths) {
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+    for (uint64_t i = 0; i < paths.size(); ++i) {
+        const path_handle_t& path = paths[i];
+        auto& cut_points = thread_cut_points[omp_get_thread_num()];
         if (path_intervals.find(path) != path_intervals.end()) {
             auto& intervals = path_intervals.find(path)->second;
             auto ival = intervals.begin();
@@ -60,8 +66,7 @@ void inject_ranges(MutablePathDeletableHandleGraph& graph,
                             // store cut points on the forward strand to avoid dups
                             auto last_h_fwd = graph.get_is_reverse(last_h) ?
                                 graph.flip(last_h) : last_h;
-#pragma omp critical (cut_points)
-                            cut_points[last_h_fwd].push_back(last_offset);
+                            cut_points.emplace_back(last_h_fwd, last_offset);
                         }
                         interval_ends.erase(interval_ends.begin());
                     }
@@ -80,8 +85,7 @@ void inject_ranges(MutablePathDeletableHandleGraph& graph,
                             // store cut points on the forward strand to avoid dups
                             auto h_fwd = graph.get_is_reverse(h) ?
                                 graph.flip(h) : h;
-#pragma omp critical (cut_points)
-                            cut_points[h_fwd].push_back(offset);
+                            cut_points.emplace_back(h_fwd, offset);
                         }
                         ++ival;
                         if (show_progress) {
@@ -103,8 +107,7 @@ void inject_ranges(MutablePathDeletableHandleGraph& graph,
                     // store cut points on the forward strand to avoid dups
                     auto last_h_fwd = graph.get_is_reverse(last_h) ?
                                       graph.flip(last_h) : last_h;
-#pragma omp critical (cut_points)
-                    cut_points[last_h_fwd].push_back(last_offset);
+                    cut_points.emplace_back(last_h_fwd, last_offset);
                 }
                 interval_ends.erase(interval_ends.begin());
             }
@@ -115,11 +118,22 @@ void inject_ranges(MutablePathDeletableHandleGraph& graph,
         progress->finish();
     }
 
-    for (auto& c : cut_points) {
-        auto& v = c.second;
-        std::sort(v.begin(), v.end());
-        v.erase(std::unique(v.begin(), v.end()), v.end());
+    std::vector<std::pair<handle_t, size_t>> all_cut_points;
+    for (auto& c : thread_cut_points) {
+        all_cut_points.insert(all_cut_points.end(), c.begin(), c.end());
+        std::vector<std::pair<handle_t, size_t>>().swap(c);
     }
+    ips4o::parallel::sort(all_cut_points.begin(), all_cut_points.end(),
+                          [](const std::pair<handle_t, size_t>& a, const std::pair<handle_t, size_t>& b) {
+                              return as_integer(a.first) < as_integer(b.first)
+                                     || (a.first == b.first && a.second < b.second);
+                          }, num_threads);
+    all_cut_points.erase(std::unique(all_cut_points.begin(), all_cut_points.end()), all_cut_points.end());
+    ska::flat_hash_map<handle_t, std::vector<size_t>> cut_points;
+    for (auto& c : all_cut_points) {
+        cut_points[c.first].push_back(c.second);
+    }
+    std::vector<std::pair<handle_t, size_t>>().swap(all_cut_points);
 
     /*
     for (auto& c : cut_points) {
@@ -131,8 +145,17 @@ void inject_ranges(MutablePathDeletableHandleGraph& graph,
     }
     */
 
-    // then we cut the nodes in the graph at the interval starts and ends
+    // then we cut the nodes in the graph at the interval starts and ends,
+    // which may renumber the paths, so we find them again by name
+    std::vector<std::string> path_names(paths.size());
+    for (uint64_t i = 0; i < paths.size(); ++i) {
+        path_names[i] = graph.get_path_name(paths[i]);
+    }
     chop_at(graph, cut_points);
+    std::vector<path_handle_t> chopped_paths(paths.size());
+    for (uint64_t i = 0; i < paths.size(); ++i) {
+        chopped_paths[i] = graph.get_path_handle(path_names[i]);
+    }
 
     if (show_progress) {
         progress = std::make_unique<algorithms::progress_meter::ProgressMeter>(
@@ -152,18 +175,39 @@ void inject_ranges(MutablePathDeletableHandleGraph& graph,
         }
     }
 
+    // a graph_t writes the steps of a path with a single lock per node
+    graph_t* odgi_graph = dynamic_cast<graph_t*>(&graph);
+    auto append_path_steps = [&](const path_handle_t& p, const std::vector<handle_t>& steps) {
+        if (odgi_graph) {
+            odgi_graph->append_steps(p, steps);
+        } else {
+            for (auto& h : steps) {
+                graph.append_step(p, h);
+            }
+        }
+    };
+
+    // each injected path copies a run of the steps of its path, which a graph_t then saves as a reference
+    std::vector<std::vector<std::pair<path_handle_t, std::pair<path_handle_t, uint64_t>>>> thread_copies(num_threads);
+
     // then we iterate back through the sorted path intervals and add paths at the appropriate points
-#pragma omp parallel for
-    for (auto& path : paths) {
-        if (path_intervals.find(path) != path_intervals.end()) {
-            auto& intervals = path_intervals.find(path)->second;
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+    for (uint64_t i = 0; i < paths.size(); ++i) {
+        const path_handle_t& path = chopped_paths[i];
+        auto x = path_intervals.find(paths[i]);
+        if (x != path_intervals.end()) {
+            auto& intervals = x->second;
             auto ival = intervals.begin();
+            // the steps of each injected path are collected and appended at once
+            std::vector<handle_t> steps;
             // IMPORTANT: in the key of the map, the end position (uint64_t) has
             // to come first to keep the open intervals sorted by end coordinates.
             // The annotation name (std::string) is necessary to avoid losing
             // annotations having the same end coordinates.
-            std::map<std::pair<uint64_t, std::string>, step_handle_t> open_intervals_by_end;
+            std::map<std::pair<uint64_t, std::string>, std::pair<step_handle_t, uint64_t>> open_intervals_by_end;
+            auto& copies = thread_copies[omp_get_thread_num()];
             uint64_t pos = 0;
+            uint64_t rank = 0;
             handle_t last_h;
             graph.for_each_step_in_path(
                 path,
@@ -185,20 +229,18 @@ void inject_ranges(MutablePathDeletableHandleGraph& graph,
                                       << std::endl;
                             exit(1);
                         }
-                        // add the path
-                        path_handle_t p;
-#pragma omp critical (get_path)
-                        {
-                            auto f = injected_paths.find(name);
-                            assert(f != injected_paths.end());
-                            p = f->second;
-                        }
-                        auto& c = open_intervals_by_end.begin()->second;
+                        // add the path, the names are only read here
+                        auto f = injected_paths.find(name);
+                        assert(f != injected_paths.end());
+                        auto& c = open_intervals_by_end.begin()->second.first;
                         auto end = step;
+                        steps.clear();
                         do {
-                            graph.append_step(p, graph.get_handle_of_step(c));
+                            steps.push_back(graph.get_handle_of_step(c));
                             c = graph.get_next_step(c);
                         } while (c != end);
+                        append_path_steps(f->second, steps);
+                        copies.emplace_back(f->second, std::make_pair(path, open_intervals_by_end.begin()->second.second));
                         // clean up
                         open_intervals_by_end.erase(open_intervals_by_end.begin());
                     }
@@ -209,13 +251,14 @@ void inject_ranges(MutablePathDeletableHandleGraph& graph,
                            && ival->first.first >= pos
                            && ival->first.first < pos + len) {
                         // the intervals must start at the node start
-                        open_intervals_by_end[std::make_pair(ival->first.second, ival->second)] = step;
+                        open_intervals_by_end[std::make_pair(ival->first.second, ival->second)] = std::make_pair(step, rank);
                         ++ival;
                         if (show_progress) {
                             progress->increment(1);
                         }
                     }
                     pos += len;
+                    ++rank;
                     last_h = h;
                 });
 
@@ -225,19 +268,17 @@ void inject_ranges(MutablePathDeletableHandleGraph& graph,
                 // get reference to name
                 auto& name = open_intervals_by_end.begin()->first.second;
                 // add the path
-                path_handle_t p;
-#pragma omp critical (get_path)
-                {
-                    auto f = injected_paths.find(name);
-                    assert(f != injected_paths.end());
-                    p = f->second;
-                }
-                auto& c = open_intervals_by_end.begin()->second;
+                auto f = injected_paths.find(name);
+                assert(f != injected_paths.end());
+                auto& c = open_intervals_by_end.begin()->second.first;
                 auto end = graph.path_end(path);
+                steps.clear();
                 do {
-                    graph.append_step(p, graph.get_handle_of_step(c));
+                    steps.push_back(graph.get_handle_of_step(c));
                     c = graph.get_next_step(c);
                 } while (c != end);
+                append_path_steps(f->second, steps);
+                copies.emplace_back(f->second, std::make_pair(path, open_intervals_by_end.begin()->second.second));
                 // clean up
                 open_intervals_by_end.erase(open_intervals_by_end.begin());
             }
@@ -247,11 +288,154 @@ void inject_ranges(MutablePathDeletableHandleGraph& graph,
     if (show_progress) {
         progress->finish();
     }
+
+    if (odgi_graph) {
+        for (auto& copies : thread_copies) {
+            for (auto& c : copies) {
+                odgi_graph->set_path_copy(c.first, c.second.first, c.second.second);
+            }
+        }
+    }
+}
+
+/// chop_at for a graph_t: the pieces of all nodes are planned up front, with the ids that dividing the
+/// nodes and reordering them would give, and the graph is rebuilt from them, writing each path once
+/// instead of rewriting its steps for every node it crosses that is divided
+static void chop_at_rebuild(graph_t &graph,
+                            const ska::flat_hash_map<handle_t, std::vector<size_t>>& cut_points,
+                            const uint64_t& nthreads) {
+    std::vector<handle_t> handles;
+    handles.reserve(graph.get_node_count());
+    graph.for_each_handle([&](const handle_t &handle) {
+        handles.push_back(handle);
+    });
+    const nid_t min_id = handles.empty() ? 0 : graph.min_node_id();
+    const uint64_t id_range = handles.empty() ? 0 : graph.max_node_id() - min_id + 1;
+
+    // the cut offsets of each node, by rank, and the first new id of its pieces
+    std::vector<const std::vector<size_t>*> node_cuts(handles.size(), nullptr);
+    std::vector<uint64_t> first_piece(id_range, 0);
+    std::vector<uint64_t> piece_count(id_range, 0);
+    uint64_t total_pieces = 0;
+    for (uint64_t i = 0; i < handles.size(); ++i) {
+        auto f = cut_points.find(handles[i]);
+        if (f != cut_points.end()) {
+            node_cuts[i] = &f->second;
+        }
+        const uint64_t r = graph.get_id(handles[i]) - min_id;
+        first_piece[r] = total_pieces + 1;
+        piece_count[r] = node_cuts[i] ? node_cuts[i]->size() + 1 : 1;
+        total_pieces += piece_count[r];
+    }
+
+    std::vector<std::string> sequences(total_pieces);
+#pragma omp parallel for schedule(dynamic, 4096) num_threads(nthreads)
+    for (uint64_t i = 0; i < handles.size(); ++i) {
+        const uint64_t r = graph.get_id(handles[i]) - min_id;
+        if (node_cuts[i]) {
+            const std::string sequence = graph.get_sequence(handles[i]);
+            const auto& cuts = *node_cuts[i];
+            for (uint64_t j = 0; j < piece_count[r]; ++j) {
+                const uint64_t begin = j ? cuts[j - 1] : 0;
+                const uint64_t end = j < cuts.size() ? cuts[j] : sequence.size();
+                sequences[first_piece[r] - 1 + j] = sequence.substr(begin, end - begin);
+            }
+        } else {
+            sequences[first_piece[r] - 1] = graph.get_sequence(handles[i]);
+        }
+    }
+
+    // the new handle of id and orientation, as create_handle will give it
+    auto new_handle = [](const uint64_t &id, const bool &is_rev) {
+        return number_bool_packing::pack(id - 1, is_rev);
+    };
+    // the pieces an oriented handle enters and leaves by
+    auto entry_piece = [&](const handle_t& h) {
+        const uint64_t r = graph.get_id(h) - min_id;
+        return graph.get_is_reverse(h)
+               ? new_handle(first_piece[r] + piece_count[r] - 1, true)
+               : new_handle(first_piece[r], false);
+    };
+    auto exit_piece = [&](const handle_t& h) {
+        return number_bool_packing::toggle_bit(entry_piece(graph.flip(h)));
+    };
+    std::vector<std::vector<edge_t>> edges(nthreads);
+#pragma omp parallel for schedule(dynamic, 4096) num_threads(nthreads)
+    for (uint64_t i = 0; i < handles.size(); ++i) {
+        auto& thread_edges = edges[omp_get_thread_num()];
+        const uint64_t r = graph.get_id(handles[i]) - min_id;
+        for (uint64_t j = 1; j < piece_count[r]; ++j) {
+            thread_edges.emplace_back(new_handle(first_piece[r] + j - 1, false),
+                                      new_handle(first_piece[r] + j, false));
+        }
+        // both sides, create_edges drops the edges found from both of their ends
+        for (auto& h : {handles[i], graph.flip(handles[i])}) {
+            graph.follow_edges(h, false, [&](const handle_t& next) {
+                thread_edges.emplace_back(exit_piece(h), entry_piece(next));
+            });
+        }
+    }
+
+    std::vector<path_handle_t> paths;
+    graph.for_each_path_handle([&](const path_handle_t& path) {
+        paths.push_back(path);
+    });
+    std::vector<std::string> path_names(paths.size());
+    std::vector<bool> path_is_circular(paths.size());
+    std::vector<std::vector<handle_t>> path_steps(paths.size());
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+    for (uint64_t i = 0; i < paths.size(); ++i) {
+        path_names[i] = graph.get_path_name(paths[i]);
+        graph.for_each_step_in_path(paths[i], [&](const step_handle_t& step) {
+            const handle_t h = graph.get_handle_of_step(step);
+            const uint64_t r = graph.get_id(h) - min_id;
+            if (graph.get_is_reverse(h)) {
+                for (uint64_t j = piece_count[r]; j-- > 0;) {
+                    path_steps[i].push_back(new_handle(first_piece[r] + j, true));
+                }
+            } else {
+                for (uint64_t j = 0; j < piece_count[r]; ++j) {
+                    path_steps[i].push_back(new_handle(first_piece[r] + j, false));
+                }
+            }
+        });
+    }
+    for (uint64_t i = 0; i < paths.size(); ++i) {
+        path_is_circular[i] = graph.get_is_circular(paths[i]);
+    }
+
+    graph.clear();
+    for (uint64_t i = 0; i < sequences.size(); ++i) {
+        graph.create_handle(sequences[i], i + 1);
+        std::string().swap(sequences[i]);
+    }
+    {
+        std::vector<edge_t> all_edges;
+        for (auto& e : edges) {
+            all_edges.insert(all_edges.end(), e.begin(), e.end());
+            std::vector<edge_t>().swap(e);
+        }
+        graph.create_edges(all_edges);
+    }
+    std::vector<path_handle_t> new_paths(paths.size());
+    for (uint64_t i = 0; i < paths.size(); ++i) {
+        new_paths[i] = graph.create_path_handle(path_names[i], path_is_circular[i]);
+    }
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+    for (uint64_t i = 0; i < paths.size(); ++i) {
+        graph.append_steps(new_paths[i], path_steps[i]);
+        std::vector<handle_t>().swap(path_steps[i]);
+    }
 }
 
 void chop_at(MutablePathDeletableHandleGraph &graph,
              const ska::flat_hash_map<handle_t, std::vector<size_t>>& cut_points) {
 
+    if (auto* g = dynamic_cast<graph_t*>(&graph)) {
+        chop_at_rebuild(*g, cut_points, omp_get_max_threads());
+        return;
+    }
+
     std::vector<std::tuple<uint64_t, uint64_t, handle_t>> originalRank_inChoppedNodeRank_handle;
     std::vector<std::pair<uint64_t, handle_t>> originalRank_handleToChop;
 
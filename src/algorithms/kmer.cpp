@@ -1,5 +1,13 @@
 #include "kmer.hpp"
 
+#include <cassert>
+#include <deque>
+#include <limits>
+#include <omp.h>
+#include "ips4o.hpp"
+#include "flat_hash_map.hpp"
+#include "lockfree_hashtable.hpp"
+
 namespace odgi {
 
 namespace algorithms {
@@ -62,10 +70,9 @@ void for_each_kmer(const HandleGraph& graph, size_t k, size_t edge_max,
                             nid_t curr_id = graph.get_id(kmer.curr);
                             size_t curr_length = graph.get_length(kmer.curr);
                             bool curr_is_rev = graph.get_is_reverse(kmer.curr);
-                            std::string curr_seq = graph.get_sequence(kmer.curr);
                             size_t take = std::min(curr_length, k-kmer.seq.size());
                             kmer.end = make_pos_t(curr_id, curr_is_rev, take);
-                            kmer.seq.append(curr_seq.substr(0,take));
+                            kmer.seq.append(graph.get_subsequence(kmer.curr, 0, take));
                             if (kmer.seq.size() < k) {
                                 size_t next_count = 0;
                                 if (edge_max) graph.follow_edges(kmer.curr, false, [&](const handle_t& next) { ++next_count; return next_count <= 1; });
@@ -103,6 +110,235 @@ void for_each_kmer(const HandleGraph& graph, size_t k, size_t edge_max,
         }, true);
 }
 
+
+// the 2-bit code of each base, 4 for anything but ACGT
+static uint8_t packed_base_code(const char& c) {
+    switch (c) {
+    case 'A': case 'a': return 0;
+    case 'C': case 'c': return 1;
+    case 'G': case 'g': return 2;
+    case 'T': case 't': return 3;
+    default: return 4;
+    }
+}
+
+// a candidate of a minimizer window, by its start along the walk
+struct window_kmer_t {
+    uint64_t hash;
+    uint64_t start;
+    uint64_t kmer;
+};
+
+// a walk from a node, extended one handle at a time
+struct packed_walk_t {
+    handle_t handle; // the next handle to read
+    uint64_t walked; // the bases we read before it
+    uint64_t kmer; // the last k bases
+    uint64_t valid; // how many of the last bases are ACGT
+    uint16_t forks;
+    // the candidates of the current window, their hashes increasing from the front
+    std::deque<window_kmer_t> window;
+    uint64_t last_reported;
+};
+
+// walk the kmers starting in each node orientation, or with w > 0 the minimizers of the windows starting there
+static void for_each_packed(const HandleGraph& graph, size_t k, size_t w, size_t edge_max,
+                            const std::function<void(const packed_kmer_t&)>& lambda) {
+    assert(k > 0 && k <= max_packed_kmer_length);
+    const uint64_t mask = k == max_packed_kmer_length ? std::numeric_limits<uint64_t>::max() : ((uint64_t)1 << (2 * k)) - 1;
+    // the bases we need past a start in the node
+    const uint64_t span = w ? k + w - 1 : k;
+    std::vector<uint8_t> codes(256);
+    for (uint64_t c = 0; c < 256; ++c) {
+        codes[c] = packed_base_code((char)c);
+    }
+    graph.for_each_handle([&](const handle_t& h) {
+            std::vector<packed_walk_t> todo;
+            std::vector<uint64_t> kmers;
+            std::vector<uint64_t> hashes;
+            std::vector<uint8_t> valid;
+            for (auto handle_is_rev : { false, true }) {
+                const handle_t root = handle_is_rev ? graph.flip(h) : h;
+                const nid_t root_id = graph.get_id(root);
+                const uint64_t needed = graph.get_length(root) + span - 1;
+                todo.push_back({root, 0, 0, 0, 0, {}, std::numeric_limits<uint64_t>::max()});
+                while (!todo.empty()) {
+                    packed_walk_t walk = std::move(todo.back());
+                    todo.pop_back();
+                    const std::string seq = graph.get_sequence(walk.handle);
+                    const uint64_t take = std::min((uint64_t)seq.size(), needed - walk.walked);
+                    // roll the kmer ending at each base we take
+                    kmers.resize(take);
+                    valid.resize(take);
+                    for (uint64_t j = 0; j < take; ++j) {
+                        const uint8_t code = codes[(uint8_t)seq[j]];
+                        if (code > 3) {
+                            walk.kmer = 0;
+                            walk.valid = 0;
+                        } else {
+                            walk.kmer = ((walk.kmer << 2) | code) & mask;
+                            ++walk.valid;
+                        }
+                        kmers[j] = walk.kmer;
+                        valid[j] = walk.valid >= k;
+                    }
+                    const uint64_t first = walk.walked;
+                    walk.walked += take;
+                    if (!w) {
+                        for (uint64_t j = 0; j < take; ++j) {
+                            if (valid[j]) {
+                                lambda({kmers[j], make_pos_t(root_id, handle_is_rev, first + j + 1 - k)});
+                            }
+                        }
+                    } else {
+                        // hash all kmers of the node at once, which the compiler can vectorize
+                        hashes.resize(take);
+                        uint64_t* hash_data = hashes.data();
+                        const uint64_t* kmer_data = kmers.data();
+#pragma omp simd
+                        for (uint64_t j = 0; j < take; ++j) {
+                            hash_data[j] = hash_packed_kmer(kmer_data[j], mask);
+                        }
+                        for (uint64_t j = 0; j < take; ++j) {
+                            if (first + j + 1 < k) {
+                                continue;
+                            }
+                            const uint64_t t = first + j + 1 - k;
+                            if (valid[j]) {
+                                while (!walk.window.empty() && walk.window.back().hash > hashes[j]) {
+                                    walk.window.pop_back();
+                                }
+                                walk.window.push_back({hashes[j], t, kmers[j]});
+                            }
+                            // the window of the w kmers ending at t
+                            if (t + 1 >= w) {
+                                const uint64_t s = t + 1 - w;
+                                while (!walk.window.empty() && walk.window.front().start < s) {
+                                    walk.window.pop_front();
+                                }
+                                if (!walk.window.empty() && walk.window.front().start != walk.last_reported) {
+                                    walk.last_reported = walk.window.front().start;
+                                    lambda({walk.window.front().kmer, make_pos_t(root_id, handle_is_rev, walk.last_reported)});
+                                }
+                            }
+                        }
+                    }
+                    if (walk.walked < needed) {
+                        // follow edges if we haven't read all the bases we need
+                        size_t next_count = 0;
+                        if (edge_max) graph.follow_edges(walk.handle, false, [&](const handle_t& next) { ++next_count; return next_count <= 1; });
+                        if (!(next_count > 1 && edge_max == walk.forks)) {
+                            graph.follow_edges(walk.handle, false, [&](const handle_t& next) {
+                                    todo.push_back(walk);
+                                    auto& next_walk = todo.back();
+                                    next_walk.handle = next;
+                                    if (next_count > 1) {
+                                        ++next_walk.forks;
+                                    }
+                                });
+                        }
+                    }
+                }
+            }
+        }, true);
+}
+
+void for_each_packed_kmer(const HandleGraph& graph, size_t k, size_t edge_max,
+                          const std::function<void(const packed_kmer_t&)>& lambda) {
+    for_each_packed(graph, k, 0, edge_max, lambda);
+}
+
+void for_each_minimizer(const HandleGraph& graph, size_t k, size_t w, size_t edge_max,
+                        const std::function<void(const packed_kmer_t&)>& lambda) {
+    assert(w > 0);
+    for_each_packed(graph, k, w, edge_max, lambda);
+}
+
+// the count of a kmer in the shared table, owned by the thread that added it
+struct kmer_counter_t {
+    kmer_counter_t(const uint64_t& k, const uint64_t& c) : kmer(k), count(c) { }
+    uint64_t kmer;
+    std::atomic<uint64_t> count;
+};
+
+// the table hashes its keys with std::hash, the identity on integers, and picks buckets by their low bits,
+// which in a packed kmer are its last few bases; the kmers are mixed (bijectively) to spread them out
+static uint64_t mix_packed_kmer(uint64_t kmer) {
+    kmer ^= kmer >> 33;
+    kmer *= 0xff51afd7ed558ccdULL;
+    kmer ^= kmer >> 33;
+    kmer *= 0xc4ceb9fe1a85ec53ULL;
+    kmer ^= kmer >> 33;
+    return kmer;
+}
+
+std::vector<kmer_count_t> count_packed_kmers(const HandleGraph& graph, size_t k, size_t edge_max, uint64_t nthreads) {
+    // the private tallies are merged once they hold this many kmers, which keeps them in cache
+    const uint64_t tally_limit = 1 << 16;
+    lockfree::LockFreeHashTable<uint64_t, kmer_counter_t*> table;
+    const uint64_t tally_count = std::max((uint64_t) omp_get_max_threads(), nthreads);
+    std::vector<ska::flat_hash_map<uint64_t, uint64_t>> tallies(tally_count);
+    // the counters each thread added, with their addresses kept stable as they grow
+    std::vector<std::deque<kmer_counter_t>> counters(tally_count);
+    auto merge = [&](const uint64_t& tid) {
+        auto& tally = tallies[tid];
+        for (auto& entry : tally) {
+            const uint64_t key = mix_packed_kmer(entry.first);
+            kmer_counter_t* counter = nullptr;
+            if (table.Find(key, counter)) {
+                counter->count.fetch_add(entry.second, std::memory_order_relaxed);
+            } else {
+                counters[tid].emplace_back(entry.first, entry.second);
+                // when another thread adds the same kmer in between, one of the two counters replaces the other
+                // in the table; both are still listed in counters, and their counts are summed at the end
+                table.Insert(key, &counters[tid].back());
+            }
+        }
+        tally.clear();
+    };
+    for_each_packed(graph, k, 0, edge_max, [&](const packed_kmer_t& kmer) {
+            const uint64_t tid = omp_get_thread_num();
+            auto& tally = tallies[tid];
+            ++tally[kmer.kmer];
+            if (tally.size() >= tally_limit) {
+                merge(tid);
+            }
+        });
+#pragma omp parallel for schedule(dynamic,1) num_threads(nthreads)
+    for (uint64_t tid = 0; tid < tally_count; ++tid) {
+        merge(tid);
+    }
+    std::vector<kmer_count_t> counts;
+    for (auto& list : counters) {
+        for (auto& counter : list) {
+            counts.push_back({counter.kmer, counter.count.load(std::memory_order_relaxed)});
+        }
+    }
+    ips4o::parallel::sort(counts.begin(), counts.end(), [](const kmer_count_t& a, const kmer_count_t& b) {
+            return a.kmer < b.kmer;
+        }, nthreads);
+    // sum the counters of the kmers that were added twice
+    uint64_t distinct = 0;
+    for (uint64_t i = 0; i < counts.size(); ++i) {
+        if (distinct > 0 && counts[distinct - 1].kmer == counts[i].kmer) {
+            counts[distinct - 1].count += counts[i].count;
+        } else {
+            counts[distinct++] = counts[i];
+        }
+    }
+    counts.resize(distinct);
+    return counts;
+}
+
+std::string unpack_kmer(const uint64_t& kmer, const size_t& k) {
+    static const char bases[4] = {'A', 'C', 'G', 'T'};
+    std::string seq(k, 'N');
+    for (size_t i = 0; i < k; ++i) {
+        seq[i] = bases[(kmer >> (2 * (k - 1 - i))) & 3];
+    }
+    return seq;
+}
+
 }
 
 std::ostream& operator<<(std::ostream& out, const kmer_t& kmer) {
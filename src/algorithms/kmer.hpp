@@ -4,6 +4,8 @@
 #include <iostream>
 #include <string>
 #include <list>
+#include <vector>
+#include <functional>
 #include <handlegraph/util.hpp>
 #include <handlegraph/handle_graph.hpp>
 #include "position.hpp"
@@ -42,6 +44,59 @@ namespace algorithms {
 void for_each_kmer(const HandleGraph& graph, size_t k, size_t edge_max,
                    const std::function<void(const kmer_t&)>& lambda);
 
+/// The longest kmer we can pack into 64 bits.
+const size_t max_packed_kmer_length = 32;
+
+/// A kmer packed 2 bits per base, A=0 C=1 G=2 T=3, with its first base in the highest bits, and
+/// the position of its first base in the graph. Kmers over other bases are left out.
+struct packed_kmer_t {
+    uint64_t kmer;
+    pos_t begin;
+};
+
+/// An invertible hash of the kmers of length k, as used to order them for minimizers.
+/// Only shifts, adds and xors, so that a loop over many kmers vectorizes.
+inline uint64_t hash_packed_kmer(uint64_t key, const uint64_t& mask) {
+    key = (~key + (key << 21)) & mask;
+    key = key ^ key >> 24;
+    key = ((key + (key << 3)) + (key << 8)) & mask;
+    key = key ^ key >> 14;
+    key = ((key + (key << 2)) + (key << 4)) & mask;
+    key = key ^ key >> 28;
+    key = (key + (key << 31)) & mask;
+    return key;
+}
+
+/// Iterate over all the kmers of length k <= max_packed_kmer_length starting in the graph, in both
+/// orientations of each node, rolling their packed values along the walks instead of building their
+/// strings. Each kmer is reported once for each distinct walk it spells, as in for_each_kmer, and
+/// edge_max likewise limits the furcations a walk crosses. The nodes are handled in parallel, so
+/// lambda is called from several threads.
+void for_each_packed_kmer(const HandleGraph& graph, size_t k, size_t edge_max,
+                          const std::function<void(const packed_kmer_t&)>& lambda);
+
+/// Iterate over the (w, k) minimizers of the walks of the graph: of every w consecutive kmers along a
+/// walk, the one with the smallest hash_packed_kmer, the leftmost on ties. The windows are those whose
+/// first kmer starts in a node, so a minimizer shared by windows starting in different nodes is
+/// reported for each of these nodes. Otherwise as for_each_packed_kmer.
+void for_each_minimizer(const HandleGraph& graph, size_t k, size_t w, size_t edge_max,
+                        const std::function<void(const packed_kmer_t&)>& lambda);
+
+/// A distinct packed kmer and the number of times it occurs.
+struct kmer_count_t {
+    uint64_t kmer;
+    uint64_t count;
+};
+
+/// Count the kmers of length k <= max_packed_kmer_length that for_each_packed_kmer reports, in both
+/// orientations. Each thread first tallies its kmers in a small private table, which it merges into a
+/// shared lock-free hash table whenever it fills up, so that the repeated kmers of a region reach the
+/// shared table once. Returns the distinct kmers in the order of their packed values.
+std::vector<kmer_count_t> count_packed_kmers(const HandleGraph& graph, size_t k, size_t edge_max, uint64_t nthreads);
+
+/// The bases of a kmer of length k packed as in packed_kmer_t.
+std::string unpack_kmer(const uint64_t& kmer, const size_t& k);
+
 }
 
 }
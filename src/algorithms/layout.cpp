@@ -1,5 +1,11 @@
 #include "layout.hpp"
 #include "draw.hpp"
+#include "ordered_chunk_writer.hpp"
+#include "text_writer.hpp"
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <mio/mmap.hpp>
 
 namespace odgi {
 namespace algorithms {
@@ -7,31 +13,43 @@ namespace layout {
 
 using namespace handlegraph;
 
-void to_tsv(std::ostream &out, const std::vector<double> &X, const std::vector<double> &Y, const std::vector<std::vector<handlegraph::handle_t>> weak_components) {
-    /*std::vector<std::pair<double, uint64_t>> weak_component_order;
-    for (uint64_t i = 0; i < weak_components.size(); ++i) {
-        auto& weak_component = weak_components[i];
-        uint64_t id_sum = 0;
-        for (auto node_id : weak_component) {
-            id_sum += node_id;
+void to_tsv(std::ostream &out, const std::vector<double> &X, const std::vector<double> &Y,
+            const std::vector<std::vector<handlegraph::handle_t>>& weak_components, const uint64_t& nthreads) {
+    out << "idx" << "\t" << "X" << "\t" << "Y" << "\t" << "component" << "\n";
+    // the rows of blocks of handles are formatted in parallel, and written in order
+    const uint64_t handles_per_item = 1 << 14;
+    std::vector<std::pair<uint64_t, uint64_t>> items; // component and first handle in it
+    for (uint64_t num_component = 0; num_component < weak_components.size(); ++num_component) {
+        for (uint64_t i = 0; i < weak_components[num_component].size(); i += handles_per_item) {
+            items.push_back({num_component, i});
         }
-        double avg_id = id_sum / (double) weak_component.size();
-        weak_component_order.push_back(std::make_pair(avg_id, i));
     }
-    std::sort(weak_component_order.begin(), weak_component_order.end());*/
-
-    out << std::setprecision(std::numeric_limits<double>::digits10 + 1);
-    out << "idx" << "\t" << "X" << "\t" << "Y" << "\t" << "component" << std::endl;
-
-    for (uint64_t num_component = 0; num_component < weak_components.size(); ++num_component) {
-        for (auto& handle :  weak_components[num_component]) {
-            uint64_t pos = 2 * number_bool_packing::unpack_number(handle);
-
-            out << as_integer(handle) << "\t" << X[pos] << "\t" << Y[pos] << "\t" << num_component <<std::endl;
-            out << as_integer(handle)+1 << "\t" << X[pos + 1] << "\t" << Y[pos + 1] << "\t" << num_component<< std::endl;
+    ordered_chunk_writer writer(out);
+    writer.open_writer();
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+    for (uint64_t k = 0; k < items.size(); ++k) {
+        const uint64_t num_component = items[k].first;
+        const auto& component = weak_components[num_component];
+        const uint64_t end = std::min((uint64_t) component.size(), items[k].second + handles_per_item);
+        std::string text;
+        text.reserve((end - items[k].second) * 96);
+        for (uint64_t i = items[k].second; i < end; ++i) {
+            const handle_t& handle = component[i];
+            const uint64_t pos = 2 * number_bool_packing::unpack_number(handle);
+            for (uint64_t end_of_node = 0; end_of_node < 2; ++end_of_node) {
+                append_integer(text, as_integer(handle) + end_of_node);
+                text += '\t';
+                append_shortest(text, X[pos + end_of_node]);
+                text += '\t';
+                append_shortest(text, Y[pos + end_of_node]);
+                text += '\t';
+                append_integer(text, num_component);
+                text += '\n';
+            }
         }
+        writer.append(k, text, true);
     }
-
+    writer.close_writer();
 }
 
 double coord_dist(xy_d_t point1, xy_d_t point2) {
@@ -40,6 +58,15 @@ double coord_dist(xy_d_t point1, xy_d_t point2) {
     return sqrt(dx * dx + dy * dy);
 }
 
+void coord_dists(const double* ax, const double* ay, const double* bx, const double* by, double* dists, const uint64_t& n) {
+#pragma omp simd
+    for (uint64_t i = 0; i < n; ++i) {
+        const double dx = ax[i] - bx[i];
+        const double dy = ay[i] - by[i];
+        dists[i] = std::sqrt(dx * dx + dy * dy);
+    }
+}
+
 Layout::Layout(const std::vector<double> &X, const std::vector<double> &Y) {
     std::vector<uint64_t> vals;
     //assert(X.size)( == Y.size());
@@ -56,21 +83,158 @@ Layout::Layout(const std::vector<double> &X, const std::vector<double> &Y) {
 }
 
 void Layout::serialize(std::ostream& out) {
+    if (binary_xy) {
+        Layout(get_X(), get_Y()).serialize(out);
+        return;
+    }
     sdsl::write_member(min_value, out);
     xy.serialize(out);
 }
 
+void Layout::serialize_binary(std::ostream& out, const std::string& metadata) {
+    const uint64_t n = size();
+    binary_layout_header_t header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, binary_layout_magic, sizeof(header.magic));
+    header.version = binary_layout_version;
+    header.point_count = n;
+    double min_x = std::numeric_limits<double>::max();
+    double min_y = std::numeric_limits<double>::max();
+    for (uint64_t i = 0; i < n; ++i) {
+        min_x = std::min(min_x, get_x(i));
+        min_y = std::min(min_y, get_y(i));
+    }
+    header.origin_x = n ? min_x : 0;
+    header.origin_y = n ? min_y : 0;
+    header.metadata_size = metadata.size();
+    header.points_offset = (sizeof(header) + metadata.size() + 63) / 64 * 64;
+    out.write((const char*)&header, sizeof(header));
+    out.write(metadata.data(), metadata.size());
+    const std::string padding(header.points_offset - sizeof(header) - metadata.size(), '\0');
+    out.write(padding.data(), padding.size());
+    // write the points in blocks to bound the buffer size
+    const uint64_t block_size = 1 << 16;
+    std::vector<float> block;
+    block.reserve(2 * block_size);
+    for (uint64_t i = 0; i < n; i += block_size) {
+        block.clear();
+        const uint64_t end = std::min(n, i + block_size);
+        for (uint64_t j = i; j < end; ++j) {
+            block.push_back((float)(get_x(j) - header.origin_x));
+            block.push_back((float)(get_y(j) - header.origin_y));
+        }
+        out.write((const char*)block.data(), block.size() * sizeof(float));
+    }
+}
+
+void Layout::load_binary(const char* data, uint64_t length) {
+    binary_layout_header_t header;
+    if (length < sizeof(header)) {
+        throw std::runtime_error("[odgi::algorithms::layout] error: truncated binary layout header");
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (header.version != binary_layout_version) {
+        throw std::runtime_error("[odgi::algorithms::layout] error: unsupported binary layout version "
+                                 + std::to_string(header.version));
+    }
+    if (header.points_offset < sizeof(header) + header.metadata_size
+        || header.points_offset % 64 != 0
+        || length < header.points_offset + header.point_count * 2 * sizeof(float)) {
+        throw std::runtime_error("[odgi::algorithms::layout] error: truncated or malformed binary layout");
+    }
+    binary_metadata.assign(data + sizeof(header), header.metadata_size);
+    binary_xy = (const float*)(data + header.points_offset);
+    binary_points = header.point_count;
+    origin_x = header.origin_x;
+    origin_y = header.origin_y;
+    sdsl::util::clear(xy);
+}
+
+void Layout::load_binary(std::istream& in) {
+    // the magic has already been consumed
+    binary_layout_header_t header;
+    std::memcpy(header.magic, binary_layout_magic, sizeof(header.magic));
+    in.read((char*)&header + sizeof(header.magic), sizeof(header) - sizeof(header.magic));
+    if (!in || header.points_offset < sizeof(header) + header.metadata_size) {
+        throw std::runtime_error("[odgi::algorithms::layout] error: truncated or malformed binary layout");
+    }
+    // keep the points 64-byte aligned in memory, as in the file
+    const uint64_t length = header.points_offset + header.point_count * 2 * sizeof(float);
+    auto buffer = std::make_shared<std::vector<float>>((length + sizeof(float) - 1) / sizeof(float) + 16);
+    char* base = (char*)buffer->data();
+    base += (64 - ((uintptr_t)base % 64)) % 64;
+    std::memcpy(base, &header, sizeof(header));
+    in.read(base + sizeof(header), length - sizeof(header));
+    if ((uint64_t)in.gcount() != length - sizeof(header)) {
+        throw std::runtime_error("[odgi::algorithms::layout] error: truncated binary layout");
+    }
+    load_binary(base, length);
+    binary_storage = buffer;
+}
+
 void Layout::load(std::istream& in) {
-    sdsl::read_member(min_value, in);
+    char magic[sizeof(binary_layout_magic)];
+    in.read(magic, sizeof(magic));
+    if (in.gcount() == sizeof(magic)
+        && std::memcmp(magic, binary_layout_magic, sizeof(magic)) == 0) {
+        load_binary(in);
+        return;
+    }
+    // the sdsl format starts with min_value
+    std::memcpy(&min_value, magic, sizeof(min_value));
     xy.load(in);
+    binary_storage.reset();
+    binary_xy = nullptr;
+    binary_points = 0;
 }
 
-void Layout::to_tsv(std::ostream &out) {
-    out << std::setprecision(std::numeric_limits<double>::digits10 + 1);
-    out << "idx" << "\t" << "X" << "\t" << "Y" << std::endl;
-    for (uint64_t i = 0; i < size(); ++i) {
-        out << i << "\t" << get_x(i) << "\t" << get_y(i) << std::endl;
+void Layout::load(const std::string& filename) {
+    char magic[sizeof(binary_layout_magic)] = {0};
+    {
+        std::ifstream f(filename.c_str(), std::ios::binary);
+        if (!f) {
+            throw std::runtime_error("[odgi::algorithms::layout] error: cannot open " + filename);
+        }
+        f.read(magic, sizeof(magic));
+        if (std::memcmp(magic, binary_layout_magic, sizeof(magic)) != 0) {
+            f.seekg(0);
+            load(f);
+            return;
+        }
+    }
+    std::error_code error;
+    auto mapping = std::make_shared<mio::mmap_source>(mio::make_mmap_source(filename, 0, mio::map_entire_file, error));
+    if (error) {
+        throw std::runtime_error("[odgi::algorithms::layout] error: cannot memory map " + filename
+                                 + ": " + error.message());
+    }
+    load_binary(mapping->data(), mapping->size());
+    binary_storage = mapping;
+}
+
+void Layout::to_tsv(std::ostream &out, const uint64_t& nthreads) {
+    out << "idx" << "\t" << "X" << "\t" << "Y" << "\n";
+    const uint64_t points_per_item = 1 << 15;
+    const uint64_t point_count = size();
+    const uint64_t items = (point_count + points_per_item - 1) / points_per_item;
+    ordered_chunk_writer writer(out);
+    writer.open_writer();
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+    for (uint64_t k = 0; k < items; ++k) {
+        const uint64_t end = std::min(point_count, (k + 1) * points_per_item);
+        std::string text;
+        text.reserve((end - k * points_per_item) * 48);
+        for (uint64_t i = k * points_per_item; i < end; ++i) {
+            append_integer(text, i);
+            text += '\t';
+            append_shortest(text, get_x(i));
+            text += '\t';
+            append_shortest(text, get_y(i));
+            text += '\n';
+        }
+        writer.append(k, text, true);
     }
+    writer.close_writer();
 }
 
 xy_d_t Layout::coords(const handle_t& handle) {
@@ -80,16 +244,22 @@ xy_d_t Layout::coords(const handle_t& handle) {
 }
 
 size_t Layout::size() {
-    return xy.size()/2;
+    return binary_xy ? binary_points : xy.size()/2;
 }
 
 double Layout::get_x(uint64_t i) const {
+    if (binary_xy) {
+        return binary_xy[2*i] + origin_x;
+    }
     conv_t x;
     x.i = xy[2*i];
     return x.d + min_value;
 }
 
 double Layout::get_y(uint64_t i) const {
+    if (binary_xy) {
+        return binary_xy[2*i+1] + origin_y;
+    }
     conv_t y;
     y.i = xy[2*i+1];
     return y.d + min_value;
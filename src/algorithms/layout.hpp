@@ -1,4 +1,6 @@
 #include <iostream>
+#include <memory>
+#include <string>
 #include <sdsl/enc_vector.hpp>
 #include <handlegraph/handle_graph.hpp>
 #include <handlegraph/util.hpp>
@@ -13,24 +15,66 @@ namespace layout {
 
 using namespace handlegraph;
 
+/// Write the coordinates of both ends of the nodes of each component, formatting blocks of them in parallel
 void to_tsv(std::ostream &out,
             const std::vector<double> &X,
             const std::vector<double> &Y,
-            const std::vector<std::vector<handlegraph::handle_t>> weak_components);
+            const std::vector<std::vector<handlegraph::handle_t>>& weak_components,
+            const uint64_t& nthreads = 1);
 
 double coord_dist(const xy_d_t, const xy_d_t);
+/// The distances between the points (ax[i], ay[i]) and (bx[i], by[i]) of n point pairs in contiguous arrays
+void coord_dists(const double* ax, const double* ay, const double* bx, const double* by, double* dists, const uint64_t& n);
 
 union conv_t { uint64_t i; double d; };
 
+/// Header of the binary layout format. It is followed by metadata_size bytes of free-form metadata and,
+/// starting at points_offset (a multiple of 64), by point_count interleaved float32 (x, y) pairs stored
+/// relative to (origin_x, origin_y). The point array can be memory mapped and used without decoding.
+struct binary_layout_header_t {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t point_count;
+    double origin_x;
+    double origin_y;
+    uint64_t metadata_size;
+    uint64_t points_offset;
+    uint64_t reserved;
+};
+static_assert(sizeof(binary_layout_header_t) == 64, "binary layout header must be 64 bytes");
+
+const char binary_layout_magic[8] = {'O', 'D', 'G', 'I', 'L', 'A', 'Y', 'B'};
+const uint32_t binary_layout_version = 1;
+
 class Layout {
     sdsl::enc_vector<> xy;
     double min_value = std::numeric_limits<double>::max();
+    // binary layout storage, either a memory mapping of the file or an owned buffer
+    std::shared_ptr<const void> binary_storage;
+    const float* binary_xy = nullptr;
+    uint64_t binary_points = 0;
+    double origin_x = 0;
+    double origin_y = 0;
+    std::string binary_metadata;
+    void load_binary(std::istream& in);
+    void load_binary(const char* data, uint64_t length);
 public:
     Layout() { }
     Layout(const std::vector<double> &X, const std::vector<double> &Y);
     void serialize(std::ostream& out);
+    /// write the layout in the binary format, with optional free-form metadata
+    void serialize_binary(std::ostream& out, const std::string& metadata = "");
+    /// load either format from a stream, the binary format is copied into memory
     void load(std::istream& in);
-    void to_tsv(std::ostream &out);
+    /// load either format from a file, the binary format is memory mapped
+    void load(const std::string& filename);
+    bool is_binary() const { return binary_xy != nullptr; }
+    /// the interleaved float32 (x, y) pairs, relative to binary_origin(), of a binary layout
+    const float* binary_data() const { return binary_xy; }
+    xy_d_t binary_origin() const { return { origin_x, origin_y }; }
+    const std::string& metadata() const { return binary_metadata; }
+    void to_tsv(std::ostream &out, const uint64_t& nthreads = 1);
     xy_d_t coords(const handle_t& handle);
     size_t size();
     double get_x(uint64_t i) const;
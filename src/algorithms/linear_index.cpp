@@ -1,29 +1,101 @@
 #include "linear_index.hpp"
+#include "dna.hpp"
 
 namespace odgi {
 namespace algorithms {
 
-linear_index_t::linear_index_t(const PathHandleGraph& graph) {
-    // generate our flattened sequence vector and a positional mapping into it for each handle
-    uint64_t graph_seq_size = 0;
+linear_index_t::linear_index_t(const graph_t& graph, const uint64_t& nthreads) {
+    // generate our flattened sequence and a positional mapping into it for each handle
+    std::vector<handle_t> handles;
+    handles.reserve(graph.get_node_count());
     graph.for_each_handle([&](const handle_t& h) {
-                              graph_seq_size += graph.get_length(h);
-                          });
-    graph_seq.reserve(graph_seq_size);
-    handle_positions.reserve(graph.get_node_count());
-    uint64_t curr_pos_in_seq = 0;
-    graph.for_each_handle([&](const handle_t& h) {
-        graph_seq.append(graph.get_sequence(h));
         // verify that our graph handle space is compact
         // it should be when using a freshly loaded odgi graph
-        assert(number_bool_packing::unpack_number(h) == handle_positions.size());
-        handle_positions.push_back(curr_pos_in_seq);
-        curr_pos_in_seq += graph.get_length(h);
+        assert(number_bool_packing::unpack_number(h) == handles.size());
+        handles.push_back(h);
     });
+    const uint64_t n = handles.size();
+    std::vector<uint64_t> positions(n);
+    // the positions are a prefix sum of the node lengths, summed per block of nodes and then offset by the
+    // blocks before, one block per thread
+    const uint64_t blocks = std::max((uint64_t) 1, std::min(nthreads, n));
+    const uint64_t block_size = (n + blocks - 1) / blocks;
+    std::vector<uint64_t> block_offsets(blocks + 1, 0);
+#pragma omp parallel for schedule(static, 1) num_threads(nthreads)
+    for (uint64_t b = 0; b < blocks; ++b) {
+        uint64_t pos = 0;
+        for (uint64_t i = b * block_size; i < std::min(n, (b + 1) * block_size); ++i) {
+            positions[i] = pos;
+            pos += graph.get_length(handles[i]);
+        }
+        block_offsets[b + 1] = pos;
+    }
+    for (uint64_t b = 0; b < blocks; ++b) {
+        block_offsets[b + 1] += block_offsets[b];
+    }
+    seq_length = block_offsets[blocks];
+    seq_words.assign((seq_length + 31) / 32, 0);
+    // a block only writes the words that lie entirely inside its range of the sequence;
+    // the bases of the words it shares with its neighbours are set afterwards
+    std::vector<std::vector<std::pair<uint64_t, uint64_t>>> shared_bases(blocks);
+    std::vector<std::vector<uint64_t>> block_exceptions(blocks);
+#pragma omp parallel for schedule(static, 1) num_threads(nthreads)
+    for (uint64_t b = 0; b < blocks; ++b) {
+        const uint64_t own_begin = (block_offsets[b] + 31) / 32 * 32;
+        const uint64_t own_end = block_offsets[b + 1] / 32 * 32;
+        auto& shared = shared_bases[b];
+        auto& exceptions = block_exceptions[b];
+        for (uint64_t i = b * block_size; i < std::min(n, (b + 1) * block_size); ++i) {
+            positions[i] += block_offsets[b];
+            const std::string seq = graph.get_sequence(handles[i]);
+            for (uint64_t j = 0; j < seq.size(); ++j) {
+                const uint64_t pos = positions[i] + j;
+                if (!dna_is_2bit(seq[j])) {
+                    exceptions.push_back(pos << 8 | (uint8_t)seq[j]);
+                } else if (pos >= own_begin && pos < own_end) {
+                    set_2bit(seq_words.data(), pos, dna_as_2bit(seq[j]));
+                } else {
+                    shared.emplace_back(pos, dna_as_2bit(seq[j]));
+                }
+            }
+        }
+    }
+    for (uint64_t b = 0; b < blocks; ++b) {
+        for (auto& base : shared_bases[b]) {
+            set_2bit(seq_words.data(), base.first, base.second);
+        }
+        seq_exceptions.insert(seq_exceptions.end(), block_exceptions[b].begin(), block_exceptions[b].end());
+    }
+    sdsl::util::assign(handle_positions, sdsl::enc_vector<>(positions));
+}
+
+uint64_t linear_index_t::position_of_handle(const handle_t& handle) const {
+    const uint64_t rank = number_bool_packing::unpack_number(handle);
+    assert(rank < handle_positions.size());
+    return handle_positions[rank];
+}
+
+uint64_t linear_index_t::size(void) const {
+    return seq_length;
+}
+
+char linear_index_t::get_base(uint64_t pos) const {
+    auto e = std::lower_bound(seq_exceptions.begin(), seq_exceptions.end(), pos << 8);
+    if (e != seq_exceptions.end() && (*e >> 8) == pos) {
+        return (char)(*e & 0xff);
+    }
+    return dna_from_2bit(get_2bit(seq_words.data(), pos));
 }
 
-uint64_t linear_index_t::position_of_handle(const handle_t& handle) {
-    return handle_positions.at(number_bool_packing::unpack_number(handle));
+void linear_index_t::append_sequence(std::string& out, uint64_t pos, uint64_t length) const {
+    length = std::min(length, seq_length - std::min(pos, seq_length));
+    const uint64_t begin = out.size();
+    out.resize(begin + length);
+    unpack_2bit(seq_words.data(), pos, length, out.data() + begin);
+    for (auto e = std::lower_bound(seq_exceptions.begin(), seq_exceptions.end(), pos << 8);
+         e != seq_exceptions.end() && (*e >> 8) < pos + length; ++e) {
+        out[begin + (*e >> 8) - pos] = (char)(*e & 0xff);
+    }
 }
 
 }
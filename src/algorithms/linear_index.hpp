@@ -6,18 +6,34 @@
 #include <handlegraph/path_handle_graph.hpp>
 #include <handlegraph/util.hpp>
 #include <cassert>
+#include <algorithm>
+#include <sdsl/enc_vector.hpp>
+#include "odgi.hpp"
 
 namespace odgi {
 namespace algorithms {
 
 using namespace handlegraph;
 
+/// The node sequences of a graph laid end to end in node rank order.
+/// The sequence is 2-bit packed, with the bases other than ACGT listed aside,
+/// and the start of each node is kept in a differentially encoded vector.
 class linear_index_t {
 public:
-    std::string graph_seq;
-    std::vector<uint64_t> handle_positions;
-    uint64_t position_of_handle(const handle_t& handle);
-    linear_index_t(const PathHandleGraph& graph);
+    /// flatten the graph in nthreads threads, each packing the sequence of a range of nodes
+    linear_index_t(const graph_t& graph, const uint64_t& nthreads = 1);
+    uint64_t position_of_handle(const handle_t& handle) const;
+    /// length of the flattened sequence
+    uint64_t size(void) const;
+    /// base at the given position of the flattened sequence
+    char get_base(uint64_t pos) const;
+    /// append the bases in [pos, pos+length) of the flattened sequence to out
+    void append_sequence(std::string& out, uint64_t pos, uint64_t length) const;
+private:
+    uint64_t seq_length = 0;
+    std::vector<uint64_t> seq_words;
+    std::vector<uint64_t> seq_exceptions; // sorted (position << 8 | base)
+    sdsl::enc_vector<> handle_positions;
 };
 
 }
@@ -1,42 +1,125 @@
 #include "matrix_writer.hpp"
+#include "depth.hpp"
 
 namespace odgi {
 namespace algorithms {
 
-void write_as_sparse_matrix(std::ostream& out, const PathHandleGraph& graph, bool weight_by_edge_depth, bool weight_by_edge_delta) {
-    uint64_t edge_count = 0;
+std::vector<double> sparse_matrix_weights(const PathHandleGraph& graph, const std::vector<edge_t>& edges,
+                                          bool weight_by_edge_depth, bool weight_by_edge_delta,
+                                          const uint64_t& nthreads, const edge_depth_index_t* edge_depths) {
+    std::vector<double> weights(edges.size(), 1);
+    if (weight_by_edge_depth && edge_depths) {
+        // the index counts a crossing of an edge that is its own reverse once, where it counts both ways here
+#pragma omp parallel for schedule(static) num_threads(nthreads)
+        for (uint64_t e = 0; e < edges.size(); ++e) {
+            const bool own_reverse = edges[e].first == graph.flip(edges[e].second);
+            weights[e] = (own_reverse ? 2 : 1) * edge_depths->get_depth(edges[e].first, edges[e].second);
+        }
+    } else if (weight_by_edge_depth) {
+        // how many paths cross the edge? a path crosses it as first then second, or as the flip of
+        // second then the flip of first, and an edge that is its own reverse counts both ways
+        ska::flat_hash_map<std::pair<handle_t, handle_t>, uint64_t> edge_index;
+        edge_index.reserve(2 * edges.size());
+        for (uint64_t e = 0; e < edges.size(); ++e) {
+            edge_index[edges[e]] = e;
+            edge_index[std::make_pair(graph.flip(edges[e].second), graph.flip(edges[e].first))] = e;
+        }
+        std::vector<path_handle_t> paths;
+        graph.for_each_path_handle([&](const path_handle_t& path) {
+            paths.push_back(path);
+        });
+        std::vector<std::atomic<uint64_t>> crossings(edges.size());
+        for (auto& c : crossings) {
+            c.store(0);
+        }
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+        for (uint64_t p = 0; p < paths.size(); ++p) {
+            bool first = true;
+            handle_t last;
+            graph.for_each_step_in_path(paths[p], [&](const step_handle_t& step) {
+                const handle_t h = graph.get_handle_of_step(step);
+                if (!first) {
+                    auto f = edge_index.find(std::make_pair(last, h));
+                    if (f != edge_index.end()) {
+                        const edge_t& edge = edges[f->second];
+                        const bool own_reverse = edge.first == graph.flip(edge.second);
+                        crossings[f->second].fetch_add(own_reverse ? 2 : 1, std::memory_order_relaxed);
+                    }
+                }
+                first = false;
+                last = h;
+            });
+        }
+        for (uint64_t e = 0; e < edges.size(); ++e) {
+            weights[e] = crossings[e].load();
+        }
+    }
+    if (weight_by_edge_delta) {
+#pragma omp parallel for schedule(static) num_threads(nthreads)
+        for (uint64_t e = 0; e < edges.size(); ++e) {
+            double delta = std::abs(graph.get_id(edges[e].first) - graph.get_id(edges[e].second));
+            if (delta == 0) delta = 1;
+            weights[e] = 1 / delta;
+        }
+    }
+    return weights;
+}
+
+void write_as_sparse_matrix(std::ostream& out, const PathHandleGraph& graph, bool weight_by_edge_depth, bool weight_by_edge_delta,
+                            const uint64_t& nthreads, const edge_depth_index_t* edge_depths) {
+    std::vector<edge_t> edges;
     graph.for_each_edge([&](const edge_t& edge) {
-            ++edge_count;
+            edges.push_back(edge);
         });
-    out << graph.max_node_id() << " " << graph.max_node_id() << " " << edge_count*2 << std::endl;
+    const std::vector<double> weights = sparse_matrix_weights(graph, edges, weight_by_edge_depth, weight_by_edge_delta, nthreads, edge_depths);
+    out << graph.max_node_id() << " " << graph.max_node_id() << " " << edges.size()*2 << std::endl;
+    // the entries of blocks of edges are formatted in parallel, and written in order
+    const uint64_t edges_per_item = 1 << 16;
+    const uint64_t items = (edges.size() + edges_per_item - 1) / edges_per_item;
+    ordered_chunk_writer writer(out);
+    writer.open_writer();
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+    for (uint64_t k = 0; k < items; ++k) {
+        std::stringstream entries;
+        const uint64_t end = std::min(edges.size(), (k + 1) * edges_per_item);
+        for (uint64_t e = k * edges_per_item; e < end; ++e) {
+            const edge_t& edge = edges[e];
+            entries << graph.get_id(edge.first) << " " << graph.get_id(edge.second) << " " << weights[e] << "\n";
+            entries << graph.get_id(edge.second) << " " << graph.get_id(edge.first) << " " << weights[e] << "\n";
+        }
+        std::string text = entries.str();
+        writer.append(k, text, true);
+    }
+    writer.close_writer();
+}
+
+bool write_as_sparse_npz(std::ostream& out, const PathHandleGraph& graph, bool weight_by_edge_depth, bool weight_by_edge_delta,
+                         const uint64_t& nthreads, const edge_depth_index_t* edge_depths) {
+    std::vector<edge_t> edges;
     graph.for_each_edge([&](const edge_t& edge) {
-            // how many paths cross the edge?
-            double weight = 0;
-            if (weight_by_edge_depth) {
-                graph.for_each_step_on_handle(edge.first, [&](const step_handle_t& step) {
-                        if (graph.get_handle_of_step(step) == edge.first && graph.has_next_step(step)) {
-                            const handle_t next = graph.get_handle_of_step(graph.get_next_step(step));
-                            if (next == edge.second) {
-                                ++weight;
-                            }
-                        } else if (graph.get_handle_of_step(step) == graph.flip(edge.first) && graph.has_previous_step(step)) {
-                            const handle_t prev = graph.get_handle_of_step(graph.get_previous_step(step));
-                            if (prev == graph.flip(edge.second)) {
-                                ++weight;
-                            }
-                        }
-                    });
-            } else {
-                weight = 1;
-            }
-            if (weight_by_edge_delta) {
-                double delta = std::abs(graph.get_id(edge.first) - graph.get_id(edge.second));
-                if (delta == 0) delta = 1;
-                weight = 1 / delta;
-            }
-            out << graph.get_id(edge.first) << " " << graph.get_id(edge.second) << " " << weight << std::endl;
-            out << graph.get_id(edge.second) << " " << graph.get_id(edge.first) << " " << weight << std::endl;
+            edges.push_back(edge);
         });
+    std::vector<double> data = sparse_matrix_weights(graph, edges, weight_by_edge_depth, weight_by_edge_delta, nthreads, edge_depths);
+    data.resize(2 * edges.size());
+    // the same entries as the text, both directions of edge e at 2e and 2e + 1, with 0-based ids
+    std::vector<int64_t> row(2 * edges.size());
+    std::vector<int64_t> col(2 * edges.size());
+#pragma omp parallel for schedule(static) num_threads(nthreads)
+    for (uint64_t e = 0; e < edges.size(); ++e) {
+        row[2 * e] = col[2 * e + 1] = graph.get_id(edges[e].first) - 1;
+        col[2 * e] = row[2 * e + 1] = graph.get_id(edges[e].second) - 1;
+    }
+    for (uint64_t e = edges.size(); e-- > 0;) {
+        data[2 * e + 1] = data[2 * e] = data[e];
+    }
+    const std::vector<int64_t> shape = {(int64_t) graph.max_node_id(), (int64_t) graph.max_node_id()};
+    const std::string format = "coo";
+    npz_writer_t npz(out);
+    const bool ok = npz.add("row", "<i8", row) && npz.add("col", "<i8", col) && npz.add("data", "<f8", data)
+            && npz.add("shape", "<i8", shape)
+            && npz.add("format", npy_header("|S3", {}), format.data(), format.size());
+    npz.close();
+    return ok;
 }
 
 }
@@ -7,6 +7,13 @@
  */
 
 #include <iostream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include "ordered_chunk_writer.hpp"
+#include "npz_writer.hpp"
+#include "hash_map.hpp"
 #include <handlegraph/handle_graph.hpp>
 #include <handlegraph/path_handle_graph.hpp>
 #include <handlegraph/util.hpp>
@@ -16,7 +23,24 @@ namespace algorithms {
 
 using namespace handlegraph;
 
-void write_as_sparse_matrix(std::ostream& out, const PathHandleGraph& graph, bool weight_by_edge_depth, bool weight_by_edge_delta);
+class edge_depth_index_t;
+
+/// The weight of each edge: 1, the number of times the paths cross it, or the inverse id delta.
+/// The crossings are read from edge_depths, the edge depth index of the graph, if one is given,
+/// or else counted in one parallel pass over the paths
+std::vector<double> sparse_matrix_weights(const PathHandleGraph& graph, const std::vector<edge_t>& edges,
+                                          bool weight_by_edge_depth, bool weight_by_edge_delta,
+                                          const uint64_t& nthreads, const edge_depth_index_t* edge_depths = nullptr);
+
+/// Write the edges as a symmetric sparse matrix of node ids, one entry per edge and direction,
+/// the entries of blocks of edges formatted in nthreads threads
+void write_as_sparse_matrix(std::ostream& out, const PathHandleGraph& graph, bool weight_by_edge_depth, bool weight_by_edge_delta,
+                            const uint64_t& nthreads = 1, const edge_depth_index_t* edge_depths = nullptr);
+
+/// Write the same matrix as an .npz archive as written by scipy.sparse.save_npz for a COO matrix,
+/// with the rows and columns of node id - 1; false if an array is too large for the archive
+bool write_as_sparse_npz(std::ostream& out, const PathHandleGraph& graph, bool weight_by_edge_depth, bool weight_by_edge_delta,
+                         const uint64_t& nthreads = 1, const edge_depth_index_t* edge_depths = nullptr);
 
 }
 }
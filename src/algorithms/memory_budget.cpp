@@ -0,0 +1,63 @@
+#include "memory_budget.hpp"
+
+#include <atomic>
+#include <charconv>
+#include <algorithm>
+
+namespace odgi {
+
+namespace algorithms {
+
+namespace memory_budget {
+
+    namespace {
+        std::atomic<uint64_t> budget_bytes{0};
+    }
+
+    void set(const uint64_t& bytes) {
+        budget_bytes.store(bytes);
+    }
+
+    uint64_t get(void) {
+        return budget_bytes.load();
+    }
+
+    bool parse(const std::string& size, uint64_t& bytes) {
+        uint64_t value = 0;
+        const char* end = size.data() + size.size();
+        auto parsed = std::from_chars(size.data(), end, value);
+        if (parsed.ec != std::errc() || parsed.ptr == size.data()) {
+            return false;
+        }
+        uint64_t shift = 0;
+        if (parsed.ptr != end) {
+            switch (*parsed.ptr) {
+                case 'k': case 'K': shift = 10; break;
+                case 'm': case 'M': shift = 20; break;
+                case 'g': case 'G': shift = 30; break;
+                case 't': case 'T': shift = 40; break;
+                default: return false;
+            }
+            ++parsed.ptr;
+            // allow 16G as well as 16GB
+            if (parsed.ptr != end && (*parsed.ptr == 'b' || *parsed.ptr == 'B')) {
+                ++parsed.ptr;
+            }
+        }
+        if (parsed.ptr != end || value == 0 || (value << shift) >> shift != value) {
+            return false;
+        }
+        bytes = value << shift;
+        return true;
+    }
+
+    uint64_t buffer_bytes(const double& fraction, const uint64_t& fallback) {
+        const uint64_t budget = get();
+        return budget ? std::max((uint64_t)1, (uint64_t)(budget * fraction)) : fallback;
+    }
+
+}
+
+}
+
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace odgi {
+
+namespace algorithms {
+
+/// The memory that the builders of large temporary structures may hold, set for a whole run with
+/// `odgi --max-mem`. Builders that can spill to temporary files size their buffers from it.
+namespace memory_budget {
+
+    /// Set the budget in bytes, 0 for none
+    void set(const uint64_t& bytes);
+
+    /// The budget in bytes, 0 if none was set
+    uint64_t get(void);
+
+    /// Parse a size such as 4096, 500M or 16G (powers of 1024), false if it is not one
+    bool parse(const std::string& size, uint64_t& bytes);
+
+    /// The bytes one buffer may take: the given fraction of the budget, or fallback without a budget
+    uint64_t buffer_bytes(const double& fraction, const uint64_t& fallback);
+
+}
+
+}
+
+}
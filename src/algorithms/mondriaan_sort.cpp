@@ -892,7 +892,8 @@ void mondriaan_main(int argc, char **argv) {
 
 std::vector<handle_t> mondriaan_sort(const PathHandleGraph& graph,
                                      uint64_t n_parts, double eps,
-                                     bool weight_by_edge_depth, bool weight_by_edge_delta) {
+                                     bool weight_by_edge_depth, bool weight_by_edge_delta,
+                                     const uint64_t& nthreads) {
     // set up input
     // write to file
     //std::string tempname = std::tmpnam(nullptr);
@@ -908,7 +909,7 @@ std::vector<handle_t> mondriaan_sort(const PathHandleGraph& graph,
     std::string tempname = temp_file::create();
     std::string outmtx = tempname + ".mtx";
     std::ofstream out(outmtx.c_str());
-    algorithms::write_as_sparse_matrix(out, graph, weight_by_edge_depth, weight_by_edge_delta);
+    algorithms::write_as_sparse_matrix(out, graph, weight_by_edge_depth, weight_by_edge_delta, nthreads);
     out.close();
     // set up mondriaan command line
     std::vector<std::string> args = {
@@ -37,7 +37,8 @@ void mondriaan_main(int argc, char** argv);
 
 std::vector<handle_t> mondriaan_sort(const PathHandleGraph& graph,
                                      uint64_t n_parts, double eps,
-                                     bool weight_by_edge_depth, bool weight_by_edge_delta);
+                                     bool weight_by_edge_depth, bool weight_by_edge_delta,
+                                     const uint64_t& nthreads = 1);
 
 
 }
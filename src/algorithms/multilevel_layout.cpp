@@ -0,0 +1,159 @@
+#include "multilevel_layout.hpp"
+
+namespace odgi {
+namespace algorithms {
+
+void coarsen_simple_components(const graph_t& graph,
+                               const std::vector<path_handle_t>& paths,
+                               coarse_graph_t& coarse,
+                               const uint64_t& nthreads) {
+    const uint64_t node_count = graph.get_node_count();
+    const uint64_t unassigned = std::numeric_limits<uint64_t>::max();
+    coarse.coarse_rank.assign(node_count, unassigned);
+    coarse.is_reverse.assign(node_count, 0);
+    coarse.offset.assign(node_count, 0);
+    coarse.length.clear();
+    coarse.max_merged_length = 0;
+
+    const std::vector<std::vector<handle_t>> components = simple_components(graph, 2, false, nthreads);
+    std::vector<uint64_t> component_of(node_count, unassigned);
+    for (uint64_t i = 0; i < components.size(); ++i) {
+        for (auto& h : components[i]) {
+            component_of[number_bool_packing::unpack_number(h)] = i;
+        }
+    }
+
+    // create the coarse nodes in the order of the fine graph, so that the coarse graph is sorted like it
+    graph.for_each_handle([&](const handle_t& h) {
+        const uint64_t rank = number_bool_packing::unpack_number(h);
+        if (coarse.coarse_rank[rank] != unassigned) {
+            return;
+        }
+        const uint64_t coarse_rank = coarse.length.size();
+        if (component_of[rank] == unassigned) {
+            coarse.graph.create_handle(graph.get_sequence(h));
+            coarse.coarse_rank[rank] = coarse_rank;
+            coarse.length.push_back(graph.get_length(h));
+        } else {
+            std::string sequence;
+            for (auto& m : components[component_of[rank]]) {
+                const uint64_t m_rank = number_bool_packing::unpack_number(m);
+                coarse.coarse_rank[m_rank] = coarse_rank;
+                coarse.is_reverse[m_rank] = graph.get_is_reverse(m);
+                coarse.offset[m_rank] = sequence.size();
+                sequence.append(graph.get_sequence(m));
+            }
+            coarse.graph.create_handle(sequence);
+            coarse.length.push_back(sequence.size());
+            coarse.max_merged_length = std::max(coarse.max_merged_length, (uint64_t)sequence.size());
+        }
+    });
+
+    auto to_coarse = [&](const handle_t& h) {
+        const uint64_t rank = number_bool_packing::unpack_number(h);
+        return number_bool_packing::pack(coarse.coarse_rank[rank],
+                                         graph.get_is_reverse(h) != (bool)coarse.is_reverse[rank]);
+    };
+    // an edge inside a merged component links consecutive members, in the orientation of the component
+    auto is_internal = [&](const handle_t& from, const handle_t& to) {
+        const uint64_t a = number_bool_packing::unpack_number(from);
+        const uint64_t b = number_bool_packing::unpack_number(to);
+        if (a == b || coarse.coarse_rank[a] != coarse.coarse_rank[b] || component_of[a] == unassigned) {
+            return false;
+        }
+        const bool from_rev = graph.get_is_reverse(from) != (bool)coarse.is_reverse[a];
+        const bool to_rev = graph.get_is_reverse(to) != (bool)coarse.is_reverse[b];
+        if (from_rev != to_rev) {
+            return false;
+        }
+        return from_rev
+            ? coarse.offset[b] + graph.get_length(to) == coarse.offset[a]
+            : coarse.offset[a] + graph.get_length(from) == coarse.offset[b];
+    };
+    graph.for_each_edge([&](const edge_t& e) {
+        if (!is_internal(e.first, e.second)) {
+            const handle_t from = to_coarse(e.first);
+            const handle_t to = to_coarse(e.second);
+            if (!coarse.graph.has_edge(from, to)) {
+                coarse.graph.create_edge(from, to);
+            }
+        }
+    });
+
+    coarse.paths.clear();
+    for (auto& path : paths) {
+        coarse.paths.push_back(coarse.graph.create_path_handle(graph.get_path_name(path), graph.get_is_circular(path)));
+    }
+    // a path walks through each merged component as a whole, so we keep the steps entering a coarse node
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+    for (uint64_t i = 0; i < paths.size(); ++i) {
+        std::vector<handle_t> steps;
+        graph.for_each_step_in_path(paths[i], [&](const step_handle_t& step) {
+            const handle_t h = graph.get_handle_of_step(step);
+            const uint64_t rank = number_bool_packing::unpack_number(h);
+            const handle_t c = to_coarse(h);
+            const bool entering = number_bool_packing::unpack_bit(c)
+                ? coarse.offset[rank] + graph.get_length(h) == coarse.length[coarse.coarse_rank[rank]]
+                : coarse.offset[rank] == 0;
+            if (entering || steps.empty()) {
+                steps.push_back(c);
+            }
+        });
+        coarse.graph.append_steps(coarse.paths[i], steps);
+    }
+}
+
+void restrict_layout(const graph_t& graph,
+                     const coarse_graph_t& coarse,
+                     const std::vector<std::atomic<double>>& X,
+                     const std::vector<std::atomic<double>>& Y,
+                     std::vector<std::atomic<double>>& coarse_X,
+                     std::vector<std::atomic<double>>& coarse_Y) {
+    graph.for_each_handle([&](const handle_t& h) {
+        const uint64_t rank = number_bool_packing::unpack_number(h);
+        const uint64_t c = coarse.coarse_rank[rank];
+        const bool rev = coarse.is_reverse[rank];
+        // the fine point at the start and at the end of the coarse node
+        if (coarse.offset[rank] == 0) {
+            const uint64_t p = 2 * rank + rev;
+            coarse_X[2 * c].store(X[p].load());
+            coarse_Y[2 * c].store(Y[p].load());
+        }
+        if (coarse.offset[rank] + graph.get_length(h) == coarse.length[c]) {
+            const uint64_t p = 2 * rank + !rev;
+            coarse_X[2 * c + 1].store(X[p].load());
+            coarse_Y[2 * c + 1].store(Y[p].load());
+        }
+    });
+}
+
+void project_layout(const graph_t& graph,
+                    const coarse_graph_t& coarse,
+                    const std::vector<std::atomic<double>>& coarse_X,
+                    const std::vector<std::atomic<double>>& coarse_Y,
+                    std::vector<std::atomic<double>>& X,
+                    std::vector<std::atomic<double>>& Y,
+                    const uint64_t& nthreads) {
+    graph.for_each_handle([&](const handle_t& h) {
+        const uint64_t rank = number_bool_packing::unpack_number(h);
+        const uint64_t c = coarse.coarse_rank[rank];
+        const double start_x = coarse_X[2 * c].load();
+        const double start_y = coarse_Y[2 * c].load();
+        const double end_x = coarse_X[2 * c + 1].load();
+        const double end_y = coarse_Y[2 * c + 1].load();
+        const double length = coarse.length[c];
+        auto place = [&](const uint64_t& offset, const uint64_t& p) {
+            const double t = length > 0 ? offset / length : 0;
+            X[p].store(start_x + t * (end_x - start_x));
+            Y[p].store(start_y + t * (end_y - start_y));
+        };
+        const uint64_t begin = coarse.offset[rank];
+        const uint64_t end = begin + graph.get_length(h);
+        const bool rev = coarse.is_reverse[rank];
+        place(rev ? end : begin, 2 * rank);
+        place(rev ? begin : end, 2 * rank + 1);
+    }, nthreads > 1);
+}
+
+}
+}
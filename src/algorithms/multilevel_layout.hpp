@@ -0,0 +1,58 @@
+#pragma once
+
+#include "odgi.hpp"
+#include <vector>
+#include <atomic>
+#include <omp.h>
+#include <handlegraph/types.hpp>
+#include <handlegraph/util.hpp>
+#include "simple_components.hpp"
+
+namespace odgi {
+namespace algorithms {
+
+using namespace handlegraph;
+
+/// A coarser version of a graph for multilevel layouts: each simple component of perfect path neighbors is
+/// merged into one node, so the paths, and the nucleotide distances along them, are preserved.
+struct coarse_graph_t {
+    graph_t graph;
+    /// the coarse paths, in the order of the fine paths they were made from
+    std::vector<path_handle_t> paths;
+    /// for each fine node rank: the rank of its coarse node
+    std::vector<uint64_t> coarse_rank;
+    /// for each fine node rank: whether it is reverse with respect to its coarse node
+    std::vector<uint8_t> is_reverse;
+    /// for each fine node rank: the offset of its start in its coarse node
+    std::vector<uint64_t> offset;
+    /// for each coarse node rank: its length
+    std::vector<uint64_t> length;
+    /// the length of the longest merged component
+    uint64_t max_merged_length = 0;
+};
+
+/// Merge the simple components of the graph, keeping the given paths.
+void coarsen_simple_components(const graph_t& graph,
+                               const std::vector<path_handle_t>& paths,
+                               coarse_graph_t& coarse,
+                               const uint64_t& nthreads);
+
+/// Initialize a coarse layout from a fine one, using the fine points at the ends of each merged component.
+void restrict_layout(const graph_t& graph,
+                     const coarse_graph_t& coarse,
+                     const std::vector<std::atomic<double>>& X,
+                     const std::vector<std::atomic<double>>& Y,
+                     std::vector<std::atomic<double>>& coarse_X,
+                     std::vector<std::atomic<double>>& coarse_Y);
+
+/// Place the fine node ends on the segments of their coarse nodes, by their offsets.
+void project_layout(const graph_t& graph,
+                    const coarse_graph_t& coarse,
+                    const std::vector<std::atomic<double>>& coarse_X,
+                    const std::vector<std::atomic<double>>& coarse_Y,
+                    std::vector<std::atomic<double>>& X,
+                    std::vector<std::atomic<double>>& Y,
+                    const uint64_t& nthreads);
+
+}
+}
@@ -0,0 +1,214 @@
+#include "nearest_ref.hpp"
+#include "bfs.hpp"
+#include "node_rank.hpp"
+#include "stepindex.hpp"
+#include "progress.hpp"
+
+#include <algorithm>
+#include <memory>
+
+namespace odgi {
+namespace algorithms {
+
+static const char NEAREST_REF_INDEX_MAGIC[8] = {'O', 'D', 'G', 'I', 'N', 'R', 'E', 'F'};
+static const uint64_t NEAREST_REF_INDEX_VERSION = 1;
+
+nearest_ref_t find_nearest_ref(const PathHandleGraph& graph,
+                               const std::function<bool(const path_handle_t&)>& is_ref,
+                               const handle_t& start_handle,
+                               const uint64_t& bp_limit) {
+    nearest_ref_t hit;
+    hash_set<uint64_t> seen;
+    for (auto try_bidirectional : { false, true }) {
+        if (try_bidirectional) {
+            hit.used_bidirectional = true;
+            seen.erase(as_integer(graph.flip(start_handle)));
+        }
+        bfs(
+            graph,
+            [&](const handle_t& h, const uint64_t& r, const uint64_t& l, const uint64_t& d) {
+                seen.insert(as_integer(h));
+                graph.for_each_step_on_handle(
+                    h, [&](const step_handle_t& s) {
+                        if (!hit.found && is_ref(graph.get_path_handle_of_step(s))) {
+                            hit.found = true;
+                            hit.step = s;
+                            hit.handle = h;
+                            hit.walked = l;
+                            hit.depth = d;
+                        }
+                    });
+            },
+            [&seen](const handle_t& h) { return seen.count(as_integer(h)); },
+            [](const handle_t& l, const handle_t& h) { return false; },
+            [&hit](void) { return hit.found; },
+            { graph.flip(start_handle) },
+            { },
+            hit.used_bidirectional,
+            0,
+            bp_limit);
+        if (hit.found) break;
+    }
+    return hit;
+}
+
+void nearest_ref_index_t::build(const graph_t& graph,
+                                const std::vector<path_handle_t>& ref_paths,
+                                const uint64_t& search_radius,
+                                const uint64_t& nthreads,
+                                const bool& progress) {
+    this->search_radius = search_radius;
+    node_count = graph.get_node_count();
+    edge_count = graph.get_edge_count();
+    std::vector<std::pair<std::string, uint64_t>> refs;
+    for (auto& path : ref_paths) {
+        refs.emplace_back(graph.get_path_name(path), graph.get_step_count(path));
+    }
+    std::sort(refs.begin(), refs.end());
+    ref_names.clear();
+    ref_step_counts.clear();
+    for (auto& ref : refs) {
+        ref_names.push_back(ref.first);
+        ref_step_counts.push_back(ref.second);
+    }
+
+    std::vector<bool> is_ref;
+    for (auto& path : ref_paths) {
+        const uint64_t i = as_integer(path);
+        if (i >= is_ref.size()) {
+            is_ref.resize(i + 1, false);
+        }
+        is_ref[i] = true;
+    }
+    auto ref_fn = [&is_ref](const path_handle_t& path) {
+        const uint64_t i = as_integer(path);
+        return i < is_ref.size() && is_ref[i];
+    };
+
+    const node_rank_t node_rank(graph);
+    std::vector<handle_t> nodes(node_count);
+    graph.for_each_handle([&](const handle_t& h) {
+        nodes[node_rank(h)] = h;
+    });
+    std::unique_ptr<progress_meter::ProgressMeter> progress_meter;
+    if (progress) {
+        progress_meter = std::make_unique<progress_meter::ProgressMeter>(
+                node_count, "[odgi::position] building nearest reference index:");
+    }
+    entries.assign(2 * node_count, entry_t{});
+#pragma omp parallel for schedule(dynamic, 256) num_threads(nthreads)
+    for (uint64_t r = 0; r < node_count; ++r) {
+        for (const bool is_rev : {false, true}) {
+            const nearest_ref_t hit = find_nearest_ref(graph, ref_fn,
+                                                       is_rev ? graph.flip(nodes[r]) : nodes[r],
+                                                       search_radius);
+            entry_t& e = entries[2 * r + is_rev];
+            e.step[0] = as_integers(hit.step)[0];
+            e.step[1] = as_integers(hit.step)[1];
+            e.handle = as_integer(hit.handle);
+            e.walked = hit.walked;
+            e.depth = hit.depth;
+            e.flags = (uint64_t) hit.found | (uint64_t) hit.used_bidirectional << 1;
+        }
+        if (progress) {
+            progress_meter->increment(1);
+        }
+    }
+    if (progress) {
+        progress_meter->finish();
+    }
+
+    // the offsets of the steps that were hit in their paths
+    const step_index_t step_index(graph, ref_paths, nthreads, progress, 0);
+#pragma omp parallel for schedule(static, 4096) num_threads(nthreads)
+    for (uint64_t i = 0; i < entries.size(); ++i) {
+        entry_t& e = entries[i];
+        if (e.flags & 1) {
+            step_handle_t step;
+            as_integers(step)[0] = e.step[0];
+            as_integers(step)[1] = e.step[1];
+            e.ref_offset = step_index.get_position(step, graph);
+        }
+    }
+}
+
+void nearest_ref_index_t::serialize(std::ostream& out) const {
+    out.write(NEAREST_REF_INDEX_MAGIC, sizeof(NEAREST_REF_INDEX_MAGIC));
+    out.write((const char*)&NEAREST_REF_INDEX_VERSION, sizeof(NEAREST_REF_INDEX_VERSION));
+    out.write((const char*)&node_count, sizeof(node_count));
+    out.write((const char*)&edge_count, sizeof(edge_count));
+    out.write((const char*)&search_radius, sizeof(search_radius));
+    const uint64_t ref_count = ref_names.size();
+    out.write((const char*)&ref_count, sizeof(ref_count));
+    for (uint64_t i = 0; i < ref_count; ++i) {
+        const uint64_t n = ref_names[i].size();
+        out.write((const char*)&n, sizeof(n));
+        out.write(ref_names[i].data(), n);
+        out.write((const char*)&ref_step_counts[i], sizeof(uint64_t));
+    }
+    out.write((const char*)entries.data(), entries.size() * sizeof(entry_t));
+}
+
+bool nearest_ref_index_t::load(std::istream& in) {
+    char magic[sizeof(NEAREST_REF_INDEX_MAGIC)];
+    uint64_t version = 0, ref_count = 0;
+    if (!in.read(magic, sizeof(magic))
+        || !std::equal(magic, magic + sizeof(magic), NEAREST_REF_INDEX_MAGIC)
+        || !in.read((char*)&version, sizeof(version)) || version != NEAREST_REF_INDEX_VERSION
+        || !in.read((char*)&node_count, sizeof(node_count))
+        || !in.read((char*)&edge_count, sizeof(edge_count))
+        || !in.read((char*)&search_radius, sizeof(search_radius))
+        || !in.read((char*)&ref_count, sizeof(ref_count))) {
+        return false;
+    }
+    ref_names.assign(ref_count, "");
+    ref_step_counts.assign(ref_count, 0);
+    for (uint64_t i = 0; i < ref_count; ++i) {
+        uint64_t n = 0;
+        if (!in.read((char*)&n, sizeof(n))) {
+            return false;
+        }
+        ref_names[i].resize(n);
+        if ((n && !in.read(&ref_names[i][0], n))
+            || !in.read((char*)&ref_step_counts[i], sizeof(uint64_t))) {
+            return false;
+        }
+    }
+    entries.resize(2 * node_count);
+    return entries.empty() || (bool) in.read((char*)entries.data(), entries.size() * sizeof(entry_t));
+}
+
+bool nearest_ref_index_t::is_index_of(const graph_t& graph, const std::vector<path_handle_t>& ref_paths) const {
+    if (node_count != graph.get_node_count() || edge_count != graph.get_edge_count()
+        || ref_paths.size() != ref_names.size()) {
+        return false;
+    }
+    std::vector<std::pair<std::string, uint64_t>> refs;
+    for (auto& path : ref_paths) {
+        refs.emplace_back(graph.get_path_name(path), graph.get_step_count(path));
+    }
+    std::sort(refs.begin(), refs.end());
+    for (uint64_t i = 0; i < refs.size(); ++i) {
+        if (refs[i].first != ref_names[i] || refs[i].second != ref_step_counts[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+nearest_ref_t nearest_ref_index_t::get_nearest(const uint64_t& rank, const bool& is_rev, uint64_t& ref_offset) const {
+    const entry_t& e = entries[2 * rank + is_rev];
+    nearest_ref_t hit;
+    hit.found = e.flags & 1;
+    hit.used_bidirectional = e.flags & 2;
+    as_integers(hit.step)[0] = e.step[0];
+    as_integers(hit.step)[1] = e.step[1];
+    hit.handle = as_handle(e.handle);
+    hit.walked = e.walked;
+    hit.depth = e.depth;
+    ref_offset = e.ref_offset;
+    return hit;
+}
+
+}
+}
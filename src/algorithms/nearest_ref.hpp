@@ -0,0 +1,98 @@
+#pragma once
+
+/**
+ * \file nearest_ref.hpp
+ *
+ * Defines the search for the nearest step of a set of reference paths from a node, as odgi position
+ * runs it for each query, and an index of its result for every node side of a graph.
+ */
+
+#include <vector>
+#include <cstdint>
+#include <iostream>
+#include <functional>
+#include <handlegraph/path_handle_graph.hpp>
+#include <handlegraph/util.hpp>
+#include "odgi.hpp"
+
+namespace odgi {
+namespace algorithms {
+
+using namespace handlegraph;
+
+/// Where the search from a node first met a reference path
+struct nearest_ref_t {
+    bool found = false;
+    /// whether the search had to follow the edges on both sides of the nodes to find it
+    bool used_bidirectional = false;
+    /// the first reference step on the node that was hit
+    step_handle_t step = {};
+    /// the node that was hit, in the orientation the search entered it
+    handle_t handle = {};
+    /// the bp walked before the node that was hit, and the number of nodes
+    uint64_t walked = 0;
+    uint64_t depth = 0;
+};
+
+/// Search breadth first from the start of start_handle, walking backwards, then, if nothing is found,
+/// in both directions, for the nearest node with a step of a path that is_ref accepts, up to
+/// bp_limit bp away
+nearest_ref_t find_nearest_ref(const PathHandleGraph& graph,
+                               const std::function<bool(const path_handle_t&)>& is_ref,
+                               const handle_t& start_handle,
+                               const uint64_t& bp_limit);
+
+/// The result of find_nearest_ref for both orientations of every node of a graph, with the offset of
+/// the step that was hit in its path, so that translating a graph position along the reference paths
+/// takes a lookup instead of a graph search. The index refers to the steps and handles of the graph it
+/// was built from, which must be loaded from the same file to use it.
+class nearest_ref_index_t {
+public:
+
+    /// Search from every node side, in parallel, within search_radius bp
+    void build(const graph_t& graph,
+               const std::vector<path_handle_t>& ref_paths,
+               const uint64_t& search_radius,
+               const uint64_t& nthreads,
+               const bool& progress);
+
+    void serialize(std::ostream& out) const;
+
+    /// Read an index written by serialize, false if the stream does not hold one
+    bool load(std::istream& in);
+
+    /// Whether the index was built from a graph of the same nodes, edges and reference paths
+    bool is_index_of(const graph_t& graph, const std::vector<path_handle_t>& ref_paths) const;
+
+    uint64_t get_search_radius(void) const {
+        return search_radius;
+    }
+
+    /// The nearest reference step from the node of the given rank, as node_rank_t orders them, in the
+    /// given orientation, and the offset of that step in its path
+    nearest_ref_t get_nearest(const uint64_t& rank, const bool& is_rev, uint64_t& ref_offset) const;
+
+private:
+
+    struct entry_t {
+        uint64_t step[2];
+        uint64_t handle;
+        uint64_t walked;
+        uint64_t depth;
+        uint64_t ref_offset;
+        /// bit 0 for found, bit 1 for used_bidirectional
+        uint64_t flags;
+    };
+
+    uint64_t node_count = 0;
+    uint64_t edge_count = 0;
+    uint64_t search_radius = 0;
+    /// the names and step counts of the reference paths
+    std::vector<std::string> ref_names;
+    std::vector<uint64_t> ref_step_counts;
+    /// the entry of the node of rank r in orientation o at 2r + o
+    std::vector<entry_t> entries;
+};
+
+}
+}
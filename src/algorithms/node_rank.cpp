@@ -0,0 +1,31 @@
+#include "node_rank.hpp"
+#include <algorithm>
+
+namespace odgi {
+namespace algorithms {
+
+node_rank_t::node_rank_t(const HandleGraph& graph) : graph(&graph) {
+    const uint64_t node_count = graph.get_node_count();
+    if (node_count == 0) {
+        return;
+    }
+    min_id = graph.min_node_id();
+    const uint64_t id_range = graph.max_node_id() - min_id + 1;
+    if (id_range == node_count) {
+        return;
+    }
+    // the ranks are the number of ids in the graph before each one
+    sdsl::bit_vector present(id_range, 0);
+    graph.for_each_handle([&](const handle_t& h) {
+        present[graph.get_id(h) - min_id] = 1;
+    });
+    ranks = sdsl::int_vector<>(id_range, 0, std::max(1, (int) sdsl::bits::hi(node_count) + 1));
+    uint64_t rank = 0;
+    for (uint64_t i = 0; i < id_range; ++i) {
+        ranks[i] = rank;
+        rank += present[i];
+    }
+}
+
+}
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+/**
+ * \file node_rank.hpp
+ *
+ * Defines the rank of each node in id order, for the tools that index arrays by node on graphs
+ * whose ids are not compacted.
+ */
+
+#include <cstdint>
+#include <handlegraph/handle_graph.hpp>
+#include <handlegraph/util.hpp>
+#include <sdsl/bit_vectors.hpp>
+
+namespace odgi {
+namespace algorithms {
+
+using namespace handlegraph;
+
+/// The 0-based rank of each node among the nodes sorted by id. When the ids are compacted, the rank
+/// is the id minus the smallest one. Otherwise, the ids leave gaps, such as those of deleted nodes,
+/// and a table over the id range holds the ranks in as many bits as the node count needs, so that a
+/// rank is still read in constant time and the graph need not be optimized beforehand.
+class node_rank_t {
+public:
+
+    explicit node_rank_t(const HandleGraph& graph);
+
+    uint64_t operator()(const nid_t& id) const {
+        const uint64_t i = id - min_id;
+        return ranks.empty() ? i : ranks[i];
+    }
+
+    uint64_t operator()(const handle_t& handle) const {
+        return (*this)(graph->get_id(handle));
+    }
+
+    /// Whether the ids are compacted, so that no table is needed
+    bool is_compact(void) const {
+        return ranks.empty();
+    }
+
+private:
+
+    const HandleGraph* graph;
+    nid_t min_id = 0;
+    sdsl::int_vector<> ranks;
+};
+
+}
+}
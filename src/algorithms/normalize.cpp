@@ -13,6 +13,7 @@
 #include <set>
 #include <iostream>
 #include <sstream>
+#include <algorithm>
 
 namespace odgi {
 namespace algorithms {
@@ -24,19 +25,40 @@ void normalize(handlegraph::MutablePathDeletableHandleGraph& graph, int max_iter
         last_len = graph.get_total_length();
     }
     int iter = 0;
+    // the nodes the last merges touched, by their ids after unchop; the first pass looks at all nodes
+    std::vector<nid_t> dirty;
+    bool first_pass = true;
     do {
         // Ignore doubly reversing edges; that's not really a coherent concept
         // for all handle graphs, or an obstacle to normality.
         
         // combine diced/chopped nodes (subpaths with no branching)
-        unchop(graph);
+        unchop(graph, 1, false, first_pass ? nullptr : &dirty);
+
+        // a new family has a member whose parents changed, so it is found from a touched node or its neighbors
+        std::vector<nid_t> candidates;
+        if (!first_pass) {
+            for (auto& id : dirty) {
+                candidates.push_back(id);
+                for (bool go_left : {false, true}) {
+                    graph.follow_edges(graph.get_handle(id), go_left, [&](const handle_t& n) {
+                        candidates.push_back(graph.get_id(n));
+                    });
+                }
+            }
+            std::sort(candidates.begin(), candidates.end());
+            candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+            if (debug) std::cerr << "[odgi::algorithms::normalize] iteration " << iter+1 << " revisiting " << candidates.size() << " nodes" << std::endl;
+        }
+        dirty.clear();
 
         // Resolve forks that shouldn't be
         std::string debug_message = "";
         if (debug) {
         	debug_message = "[odgi::algorithms::normalize] simplifying siblings";
         }
-        simplify_siblings(graph, debug_message);
+        simplify_siblings(graph, debug_message, first_pass ? nullptr : &candidates, max_iter > 1 ? &dirty : nullptr);
+        first_pass = false;
         
         if (max_iter > 1) {
             size_t curr_len = graph.get_total_length();
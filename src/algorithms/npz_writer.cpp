@@ -0,0 +1,110 @@
+#include "npz_writer.hpp"
+
+#include <zlib.h>
+#include <limits>
+#include <algorithm>
+
+namespace odgi {
+namespace algorithms {
+
+std::string npy_header(const std::string& descr, const std::vector<uint64_t>& shape) {
+    std::string dict = "{'descr': '" + descr + "', 'fortran_order': False, 'shape': (";
+    for (auto& n : shape) {
+        dict += std::to_string(n) + ", ";
+    }
+    if (shape.size() > 1) {
+        // no trailing comma needed but for 1-tuples
+        dict.resize(dict.size() - 2);
+    } else if (shape.size() == 1) {
+        dict.pop_back();
+    }
+    dict += "), }";
+    // pad with spaces so that the data starts on a multiple of 64 bytes
+    const uint64_t preamble = 10;
+    dict.append(63 - (preamble + dict.size()) % 64, ' ');
+    dict.push_back('\n');
+    std::string header("\x93NUMPY\x01\x00", 8);
+    header.push_back((char) (dict.size() & 0xff));
+    header.push_back((char) ((dict.size() >> 8) & 0xff));
+    return header + dict;
+}
+
+void npz_writer_t::put(const uint64_t& value, const uint64_t& bytes) {
+    for (uint64_t b = 0; b < bytes; ++b) {
+        out.put((char) ((value >> (8 * b)) & 0xff));
+    }
+    written += bytes;
+}
+
+bool npz_writer_t::add(const std::string& name, const std::string& header, const char* data, const uint64_t& size) {
+    const uint64_t total = header.size() + size;
+    const uint64_t limit = std::numeric_limits<uint32_t>::max();
+    if (total >= limit || written + total >= limit) {
+        return false;
+    }
+    member_t member;
+    member.name = name + ".npy";
+    member.size = total;
+    member.offset = written;
+    uLong crc = crc32(crc32(0L, Z_NULL, 0), (const Bytef*) header.data(), header.size());
+    // crc32 takes the length as a uInt, so feed large arrays in pieces
+    const uint64_t piece = 1 << 30;
+    for (uint64_t i = 0; i < size; i += piece) {
+        crc = crc32(crc, (const Bytef*) data + i, std::min(piece, size - i));
+    }
+    member.crc = crc;
+    // the local file header of a stored member
+    put(0x04034b50, 4);
+    put(20, 2);
+    put(0, 2);
+    put(0, 2);
+    put(0, 4); // time and date
+    put(member.crc, 4);
+    put(member.size, 4);
+    put(member.size, 4);
+    put(member.name.size(), 2);
+    put(0, 2);
+    out.write(member.name.data(), member.name.size());
+    out.write(header.data(), header.size());
+    out.write(data, size);
+    written += member.name.size() + total;
+    members.push_back(member);
+    return true;
+}
+
+void npz_writer_t::close(void) {
+    const uint64_t directory_offset = written;
+    for (auto& member : members) {
+        put(0x02014b50, 4);
+        put(20, 2);
+        put(20, 2);
+        put(0, 2);
+        put(0, 2);
+        put(0, 4); // time and date
+        put(member.crc, 4);
+        put(member.size, 4);
+        put(member.size, 4);
+        put(member.name.size(), 2);
+        put(0, 2); // extra field
+        put(0, 2); // comment
+        put(0, 2); // disk
+        put(0, 2); // internal attributes
+        put(0, 4); // external attributes
+        put(member.offset, 4);
+        out.write(member.name.data(), member.name.size());
+        written += member.name.size();
+    }
+    const uint64_t directory_size = written - directory_offset;
+    put(0x06054b50, 4);
+    put(0, 2);
+    put(0, 2);
+    put(members.size(), 2);
+    put(members.size(), 2);
+    put(directory_size, 4);
+    put(directory_offset, 4);
+    put(0, 2);
+    out.flush();
+}
+
+}
+}
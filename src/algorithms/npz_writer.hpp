@@ -0,0 +1,55 @@
+#pragma once
+
+/**
+ * \file npz_writer.hpp
+ *
+ * Defines writers of NumPy .npy arrays and of .npz archives of them, as read by numpy.load.
+ */
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <iostream>
+
+namespace odgi {
+namespace algorithms {
+
+/// The header of a .npy file holding a C order array of the given dtype, as '<u4' or '<f8', and shape
+std::string npy_header(const std::string& descr, const std::vector<uint64_t>& shape);
+
+/// Write arrays as the members of a stored, uncompressed .npz archive, a zip of .npy files, so
+/// that the data goes straight from memory to the stream. Each member must stay under 4 GiB.
+class npz_writer_t {
+public:
+
+    explicit npz_writer_t(std::ostream& out) : out(out) {}
+
+    /// Add the member name.npy, of the header followed by size bytes of data; false if it is too large
+    bool add(const std::string& name, const std::string& header, const char* data, const uint64_t& size);
+
+    template<typename T>
+    bool add(const std::string& name, const std::string& descr, const std::vector<T>& values) {
+        return add(name, npy_header(descr, {values.size()}), (const char*) values.data(), values.size() * sizeof(T));
+    }
+
+    /// Write the central directory, ending the archive
+    void close(void);
+
+private:
+
+    struct member_t {
+        std::string name;
+        uint32_t crc;
+        uint32_t size;
+        uint32_t offset;
+    };
+
+    std::ostream& out;
+    uint64_t written = 0;
+    std::vector<member_t> members;
+
+    void put(const uint64_t& value, const uint64_t& bytes);
+};
+
+}
+}
@@ -0,0 +1,135 @@
+#include "numa.hpp"
+
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+
+namespace odgi {
+namespace algorithms {
+
+namespace numa {
+
+namespace {
+
+    std::atomic<bool> pin_threads(false);
+
+#ifdef __linux__
+    // from linux/mempolicy.h, to not depend on libnuma
+    const int mpol_default = 0;
+    const int mpol_interleave = 3;
+    const unsigned mpol_mf_move = 1 << 1;
+    const uint64_t max_nodes = 1024;
+#endif
+
+    /// Parse a list of ranges like 0-3,8,10-11
+    std::vector<uint64_t> parse_list(const std::string &list) {
+        std::vector<uint64_t> values;
+        std::stringstream ss(list);
+        std::string range;
+        while (std::getline(ss, range, ',')) {
+            if (range.empty()) {
+                continue;
+            }
+            const size_t dash = range.find('-');
+            try {
+                const uint64_t first = std::stoull(range.substr(0, dash));
+                const uint64_t last = dash == std::string::npos ? first : std::stoull(range.substr(dash + 1));
+                for (uint64_t v = first; v <= last; ++v) {
+                    values.push_back(v);
+                }
+            } catch (const std::exception &) {
+                return {};
+            }
+        }
+        return values;
+    }
+
+}
+
+std::vector<uint64_t> allowed_nodes(void) {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    const std::string key = "Mems_allowed_list:";
+    while (std::getline(status, line)) {
+        if (line.compare(0, key.size(), key) == 0) {
+            return parse_list(line.substr(line.find_first_not_of(" \t", key.size())));
+        }
+    }
+    return {0};
+}
+
+bool interleave(const void *data, const size_t &bytes) {
+#ifdef __linux__
+    const std::vector<uint64_t> nodes = allowed_nodes();
+    if (nodes.size() < 2 || data == nullptr) {
+        return false;
+    }
+    int mode = mpol_default;
+    if (syscall(SYS_get_mempolicy, &mode, nullptr, 0, nullptr, 0) != 0 || mode != mpol_default) {
+        return false;
+    }
+    // only the pages that lie entirely in the range, the others may be shared with other data
+    const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+    const uintptr_t begin = ((uintptr_t) data + page_size - 1) / page_size * page_size;
+    const uintptr_t end = ((uintptr_t) data + bytes) / page_size * page_size;
+    if (end <= begin) {
+        return false;
+    }
+    unsigned long mask[max_nodes / (8 * sizeof(unsigned long))] = {0};
+    for (auto &node : nodes) {
+        if (node < max_nodes) {
+            mask[node / (8 * sizeof(unsigned long))] |= 1ul << (node % (8 * sizeof(unsigned long)));
+        }
+    }
+    return syscall(SYS_mbind, (void *) begin, end - begin, mpol_interleave, mask, max_nodes + 1, mpol_mf_move) == 0;
+#else
+    return false;
+#endif
+}
+
+void set_pin_threads(const bool &pin) {
+    pin_threads.store(pin);
+}
+
+bool get_pin_threads(void) {
+    return pin_threads.load();
+}
+
+bool pin_thread(const uint64_t &tid) {
+#ifdef __linux__
+    if (!pin_threads.load()) {
+        return false;
+    }
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return false;
+    }
+    std::vector<int> cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &allowed)) {
+            cpus.push_back(cpu);
+        }
+    }
+    if (cpus.empty()) {
+        return false;
+    }
+    cpu_set_t pinned;
+    CPU_ZERO(&pinned);
+    CPU_SET(cpus[tid % cpus.size()], &pinned);
+    return pthread_setaffinity_np(pthread_self(), sizeof(pinned), &pinned) == 0;
+#else
+    return false;
+#endif
+}
+
+}
+
+}
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace odgi {
+namespace algorithms {
+
+/// Memory placement and thread pinning for the multi-socket runs of the path guided SGD. The workers
+/// sample their terms uniformly over the coordinates and the path index, so rather than leaving all
+/// pages on the node of the thread that first touched them, they are spread round robin over the NUMA
+/// nodes the process may allocate on. Everything is a no-op off Linux, on a single node, or when the
+/// process already runs under a memory policy, e.g. with numactl --membind or --interleave.
+namespace numa {
+
+/// The NUMA nodes the process may allocate on
+std::vector<uint64_t> allowed_nodes(void);
+
+/// Spread the pages of the given range over the allowed nodes, moving those already touched.
+/// Returns false if the memory was left where it was.
+bool interleave(const void *data, const size_t &bytes);
+
+template<typename T>
+bool interleave(const std::vector<T> &v) {
+    return interleave(v.data(), v.size() * sizeof(T));
+}
+
+/// For sdsl int_vector and bit_vector
+template<typename V>
+bool interleave_bits(const V &v) {
+    return interleave(v.data(), (v.bit_size() + 63) / 64 * sizeof(uint64_t));
+}
+
+/// Pin each worker thread of the path guided SGD to one CPU, see pin_thread
+void set_pin_threads(const bool &pin);
+
+bool get_pin_threads(void);
+
+/// If pinning is on, pin the calling thread to the CPU of rank tid, modulo their count, among those
+/// the process may run on. Returns false if the thread was not pinned.
+bool pin_thread(const uint64_t &tid);
+
+}
+
+}
+}
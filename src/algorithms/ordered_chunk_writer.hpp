@@ -0,0 +1,139 @@
+#pragma once
+
+#include <string>
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <map>
+#include <deque>
+#include "atomic_queue.h"
+
+namespace odgi {
+namespace algorithms {
+
+/// Write the text of parallel workers to a stream in the order of their work items, as a
+/// pipeline: each worker appends the text of its item in chunks, ending with the last one, and
+/// a writer thread emits the chunks of item 0, then of item 1, and so on, keeping back those
+/// of later items until their turn. The item being written is never held up, while the others
+/// wait to append once max_pending_bytes are kept back, so large outputs stream through
+/// bounded memory. The items must be handed out in increasing order, as schedule(dynamic)
+/// does, and each item must be appended by a single thread.
+class ordered_chunk_writer {
+
+private:
+    struct chunk_t {
+        uint64_t index;
+        bool last;
+        std::string text;
+    };
+
+    std::ostream& out;
+    const uint64_t max_pending_bytes;
+    std::thread writer_thread;
+    atomic_queue::AtomicQueue2<chunk_t*, 2 << 16> chunk_queue;
+    std::atomic<bool> work_todo;
+    std::atomic<uint64_t> next_index;
+    std::atomic<uint64_t> pending_bytes;
+
+    // write the chunk if its item is the current one, true if that item is now complete
+    bool write_chunk(chunk_t* chunk) {
+        out.write(chunk->text.data(), chunk->text.size());
+        pending_bytes -= chunk->text.size();
+        const bool last = chunk->last;
+        delete chunk;
+        return last;
+    }
+
+public:
+
+    explicit ordered_chunk_writer(std::ostream& out, const uint64_t& max_pending_bytes = 1 << 28)
+        : out(out), max_pending_bytes(max_pending_bytes) {
+        work_todo.store(false);
+        next_index.store(0);
+        pending_bytes.store(0);
+    }
+
+    ~ordered_chunk_writer(void) {
+        close_writer();
+    }
+
+    void writer_func(void) {
+        std::map<uint64_t, std::deque<chunk_t*>> waiting;
+        chunk_t* chunk = nullptr;
+        // the chunks of an item arrive in the order its worker appended them
+        auto advance = [&](void) {
+            next_index.store(next_index.load() + 1);
+            auto w = waiting.begin();
+            while (w != waiting.end() && w->first == next_index.load()) {
+                bool done = false;
+                while (!w->second.empty() && !done) {
+                    done = write_chunk(w->second.front());
+                    w->second.pop_front();
+                }
+                if (done) {
+                    next_index.store(next_index.load() + 1);
+                }
+                if (w->second.empty()) {
+                    w = waiting.erase(w);
+                }
+                if (!done) {
+                    break;
+                }
+            }
+        };
+        while (work_todo.load() || !chunk_queue.was_empty()) {
+            if (chunk_queue.try_pop(chunk)) {
+                do {
+                    if (chunk->index == next_index.load()) {
+                        if (write_chunk(chunk)) {
+                            advance();
+                        }
+                    } else {
+                        waiting[chunk->index].push_back(chunk);
+                    }
+                } while (chunk_queue.try_pop(chunk));
+            } else {
+                std::this_thread::sleep_for(std::chrono::nanoseconds(1));
+            }
+        }
+        // only left over if items were skipped, keep their order
+        for (auto& w : waiting) {
+            for (auto& c : w.second) {
+                write_chunk(c);
+            }
+        }
+        out.flush();
+    }
+
+    // start writer_thread
+    void open_writer(void) {
+        if (!work_todo.load()) {
+            work_todo.store(true);
+            writer_thread = std::thread(&ordered_chunk_writer::writer_func, this);
+        }
+    }
+
+    void close_writer(void) {
+        if (work_todo.load()) {
+            work_todo.store(false);
+            if (writer_thread.joinable()) {
+                writer_thread.join();
+            }
+        }
+    }
+
+    /// hand the text, which is left empty, to the writer as the next chunk of the item,
+    /// completing it if last; open_writer() must be called first
+    void append(const uint64_t& index, std::string& text, const bool& last) {
+        while (index != next_index.load() && pending_bytes.load() > max_pending_bytes) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        pending_bytes += text.size();
+        auto* chunk = new chunk_t{index, last, std::string()};
+        chunk->text.swap(text);
+        chunk_queue.push(chunk);
+    }
+};
+
+}
+}
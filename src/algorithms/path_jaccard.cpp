@@ -1,5 +1,7 @@
 #include "path_jaccard.hpp"
 
+#include <algorithm>
+
 namespace odgi {
 	namespace algorithms {
 
@@ -26,96 +28,64 @@ namespace odgi {
 						std::cerr << "MIN: " << min_max_walk_dist.first << " MAX: " << min_max_walk_dist.second << std::endl;
 #endif
 			std::vector<step_jaccard_t> target_jaccard_indices;
+			target_jaccard_indices.reserve(target_step_handles.size());
+			// the sets of the walks, kept by each thread across calls so that their buffers are reused
+			thread_local weighted_node_set_t query_set_min_max;
+			thread_local weighted_node_set_t query_set_max_min;
+			thread_local weighted_node_set_t target_set_min_max;
+			thread_local weighted_node_set_t target_set_max_min;
 			// we were able to walk the given maximum walking distance in both directions, this greatly simplifies the algorithm
 			if (min_max_walk_dist.first >= walking_dist && min_max_walk_dist.second >= walking_dist) {
 				/// for the query:
 				// walk the given walking_dist first to the left (we might not be able to do the full walk)
 				// then walk the given walking_dist to the right
-				// in order to collect all the visited nodes and how often they were visited in a ska::flat_hash_map<uint64_t, uint64_t>
-				// the key is the node identifier, the value is the number of times this node was visited
-				ska::flat_hash_map<nid_t, uint64_t> query_set = collect_nodes_in_walking_dist(graph, walking_dist, walking_dist, cur_step);
+				// in order to collect all the visited nodes, weighted by how often they were visited
+				collect_nodes_in_walking_dist(graph, walking_dist, walking_dist, cur_step, query_set_min_max);
 				// TODO we can precollect all sets so here we don't have to do the walks anymore
 				for (step_handle_t& target_step : target_step_handles) {
-					// we count which node identifier we saw how many times
-					ska::flat_hash_map<nid_t, uint64_t> target_set = collect_nodes_in_walking_dist(graph, walking_dist, walking_dist, target_step);
-					ska::flat_hash_map<nid_t, uint64_t> union_set;
-					for (auto& query_item : query_set) {
-						union_set[query_item.first] = query_item.second;
-					}
-#ifdef debug_tips
-					std::cerr << "UNION SIZE BEFORE: " << union_set.size() << std::endl;
-#endif
-					add_target_set_to_union_set(union_set, target_set);
-#ifdef debug_tips
-					std::cerr << "UNION SIZE AFTER: " << union_set.size() << std::endl;
-
-
-								for (auto u : union_set) {
-									std::cerr << "node_id: " << u.first << " node_count: " << u.second << std::endl;
-								}
-#endif
-					ska::flat_hash_map<nid_t, uint64_t> intersection_set = intersect_target_query_sets(union_set, target_set, query_set);
-#ifdef debug_tips
-					std::cerr << "INTERSECT SIZE: " << intersection_set.size() << std::endl;
-
-								for (auto i : intersection_set) {
-									std::cerr << "node_id: " << i.first << " node_count: " << i.second << std::endl;
-								}
-#endif
-					double jaccard = jaccard_idx_from_intersect_union_sets(intersection_set, union_set, graph);
+					collect_nodes_in_walking_dist(graph, walking_dist, walking_dist, target_step, target_set_min_max);
+					const double jaccard = get_jaccard_index(query_set_min_max, target_set_min_max);
 					target_jaccard_indices.push_back({target_step, jaccard});
 #ifdef debug_tips
 					#pragma omp critical (cout)
-							std::cerr << "Jaccard index of query " << query_path_name << " and target " << target_path << ": " << jaccard << ". Direction: " << walk_from_front << std::endl;
+							std::cerr << "Jaccard index of query and target: " << jaccard << std::endl;
 #endif
 				}
 				// more complex algorithm
 			} else {
-				ska::flat_hash_map<nid_t, uint64_t> query_set_min_max = collect_nodes_in_walking_dist(
-						graph,
-						min_max_walk_dist.first,
-						min_max_walk_dist.second,
-						cur_step);
-				ska::flat_hash_map<nid_t, uint64_t> query_set_max_min = collect_nodes_in_walking_dist(
-						graph,
-						min_max_walk_dist.second,
-						min_max_walk_dist.first,
-						cur_step);
+				collect_nodes_in_walking_dist(graph, min_max_walk_dist.first, min_max_walk_dist.second,
+											  cur_step, query_set_min_max);
+				collect_nodes_in_walking_dist(graph, min_max_walk_dist.second, min_max_walk_dist.first,
+											  cur_step, query_set_max_min);
 				for (step_handle_t& target_step : target_step_handles) {
-					ska::flat_hash_map<nid_t, uint64_t> target_set_min_max = collect_nodes_in_walking_dist(
-							graph,
-							min_max_walk_dist.first,
-							min_max_walk_dist.second,
-							target_step);
-					ska::flat_hash_map<nid_t, uint64_t> target_set_max_min = collect_nodes_in_walking_dist(
-							graph,
-							min_max_walk_dist.second,
-							min_max_walk_dist.first,
-							target_step);
+					collect_nodes_in_walking_dist(graph, min_max_walk_dist.first, min_max_walk_dist.second,
+												  target_step, target_set_min_max);
+					collect_nodes_in_walking_dist(graph, min_max_walk_dist.second, min_max_walk_dist.first,
+												  target_step, target_set_max_min);
 
 					/// [0] -> q_min_max vs. t_min_max
 					/// [1] -> q_min_max vs. t_max_min
 					/// [2] -> q_max_min vs. t_min_max
 					/// [3] -> q_max_min vs. t_max_min
 					/// will be 0.0 if a combinations is not possible
-					std::vector<double> candidate_jaccards = {0.0, 0.0, 0.0, 0.0};
-					if (query_set_min_max.size() > 0) {
-						if (target_set_min_max.size() > 0) {
-							candidate_jaccards[0] = get_jaccard_index(graph, query_set_min_max, target_set_min_max);
+					double candidate_jaccards[4] = {0.0, 0.0, 0.0, 0.0};
+					if (!query_set_min_max.empty()) {
+						if (!target_set_min_max.empty()) {
+							candidate_jaccards[0] = get_jaccard_index(query_set_min_max, target_set_min_max);
 						}
-						if (target_set_max_min.size() > 0) {
-							candidate_jaccards[1] = get_jaccard_index(graph, query_set_min_max, target_set_max_min);
+						if (!target_set_max_min.empty()) {
+							candidate_jaccards[1] = get_jaccard_index(query_set_min_max, target_set_max_min);
 						}
 					}
-					if (query_set_max_min.size() > 0) {
-						if (target_set_min_max.size() > 0) {
-							candidate_jaccards[2] = get_jaccard_index(graph, query_set_max_min, target_set_min_max);
+					if (!query_set_max_min.empty()) {
+						if (!target_set_min_max.empty()) {
+							candidate_jaccards[2] = get_jaccard_index(query_set_max_min, target_set_min_max);
 						}
-						if (target_set_max_min.size() > 0) {
-							candidate_jaccards[3] = get_jaccard_index(graph, query_set_max_min, target_set_max_min);
+						if (!target_set_max_min.empty()) {
+							candidate_jaccards[3] = get_jaccard_index(query_set_max_min, target_set_max_min);
 						}
 					}
-					target_jaccard_indices.push_back({target_step, *max_element(candidate_jaccards.begin(), candidate_jaccards.end())});
+					target_jaccard_indices.push_back({target_step, *std::max_element(candidate_jaccards, candidate_jaccards + 4)});
 				}
 			}
 			std::sort(target_jaccard_indices.begin(), target_jaccard_indices.end(),
@@ -164,30 +134,34 @@ namespace odgi {
 			return target_jaccard_indices;
 		}
 
-		ska::flat_hash_map<nid_t , uint64_t> collect_nodes_in_walking_dist(const graph_t& graph,
-																		   const uint64_t& walking_dist_prev,
-																		   const uint64_t& walking_dist_next,
-																		   const step_handle_t& start_step,
-																		   const bool& walked_walking_dist) {
-			ska::flat_hash_map<nid_t, uint64_t> node_count_set;
+		void weighted_node_set_t::clear() {
+			nodes.clear();
+			total = 0;
+		}
+
+		bool weighted_node_set_t::empty() const {
+			return nodes.empty();
+		}
+
+		void collect_nodes_in_walking_dist(const graph_t& graph,
+										   const uint64_t& walking_dist_prev,
+										   const uint64_t& walking_dist_next,
+										   const step_handle_t& start_step,
+										   weighted_node_set_t& node_set) {
+			node_set.clear();
+			auto& nodes = node_set.nodes;
 			/// first walk to previous steps up to the walking_dist
 			uint64_t dist_walked = 0;
 			uint64_t total_dist_walked = 0;
 			// where does our step come from
 			handle_t cur_h = graph.get_handle_of_step(start_step);
 			step_handle_t cur_step = start_step;
-			nid_t cur_id = graph.get_id(cur_h);
 			while (graph.has_previous_step(cur_step) && (dist_walked < walking_dist_prev)) {
 				step_handle_t prev_step = graph.get_previous_step(cur_step);
 				handle_t prev_h = graph.get_handle_of_step(prev_step);
-				nid_t prev_id = graph.get_id(prev_h);
-				//
-				if (node_count_set.count(prev_id) == 0) {
-					node_count_set[prev_id] = 1;
-				} else {
-					node_count_set[prev_id] = node_count_set[prev_id] + 1;
-				}
-				dist_walked += graph.get_length(prev_h);
+				const uint64_t length = graph.get_length(prev_h);
+				nodes.push_back({graph.get_id(prev_h), length});
+				dist_walked += length;
 				cur_step = prev_step;
 			}
 			total_dist_walked += dist_walked;
@@ -197,152 +171,61 @@ namespace odgi {
 			while (graph.has_next_step(cur_step) && (dist_walked < walking_dist_next)) {
 				step_handle_t next_step = graph.get_next_step(cur_step);
 				handle_t next_h = graph.get_handle_of_step(next_step);
-				nid_t next_id = graph.get_id(next_h);
-				if (node_count_set.count(next_id) == 0) {
-					node_count_set[next_id] = 1;
-				} else {
-					node_count_set[next_id] = node_count_set[next_id] + 1;
-				}
-				dist_walked += graph.get_length(next_h);
+				const uint64_t length = graph.get_length(next_h);
+				nodes.push_back({graph.get_id(next_h), length});
+				dist_walked += length;
 				cur_step = next_step;
 			}
 			total_dist_walked += dist_walked;
-			// where does our step come from, we add id regardless of walking distance and orientation
-			if (node_count_set.count(cur_id) == 0) {
-				node_count_set[cur_id] = 1;
-			} else {
-				node_count_set[cur_id] = node_count_set[cur_id] + 1;
-			}
 			if ((total_dist_walked < (walking_dist_prev + walking_dist_next))) {
-				return ska::flat_hash_map<nid_t, uint64_t>();
+				nodes.clear();
+				return;
 			}
-			return node_count_set;
-		}
-
-		ska::flat_hash_map<nid_t , uint64_t> collect_nodes_in_walking_dist_from_map(const graph_t& graph,
-																					const uint64_t& walking_dist_prev,
-																					const uint64_t& walking_dist_next,
-																					const step_handle_t& start_step,
-																					ska::flat_hash_map<step_handle_t, std::pair<std::vector<nid_t>, std::vector<nid_t>>>& steps_nodes_prev_next_map) {
-			ska::flat_hash_map<nid_t, uint64_t> node_count_set;
-			/// first walk to previous steps up to the walking_dist
-			uint64_t dist_walked = 0;
-			uint64_t total_dist_walked = 0;
-			// where does our step come from
-			handle_t cur_h = graph.get_handle_of_step(start_step);
-			nid_t cur_id = graph.get_id(cur_h);
-			uint64_t idx = 0;
-			vector<nid_t> prev_v = steps_nodes_prev_next_map[start_step].first;
-			uint64_t prev_v_size = prev_v.size();
-			while (idx < prev_v_size && (dist_walked < walking_dist_prev)) {
-				nid_t prev_id = prev_v[idx];
-				handle_t prev_h = graph.get_handle(prev_id);
-				//
-				if (node_count_set.count(prev_id) == 0) {
-					node_count_set[prev_id] = 1;
-				} else {
-					node_count_set[prev_id] = node_count_set[prev_id] + 1;
-				}
-				dist_walked += graph.get_length(prev_h);
-				idx++;
-			}
-			total_dist_walked += dist_walked;
-			dist_walked = 0;
-			/// walking the next steps up to the walking_dist
-			idx = 0;
-			vector<nid_t> next_v = steps_nodes_prev_next_map[start_step].second;
-			uint64_t next_v_size = next_v.size();
-			while (idx < next_v_size && dist_walked < walking_dist_next) {
-				nid_t next_id = next_v[idx];
-				handle_t next_h = graph.get_handle(next_id);
-				if (node_count_set.count(next_id) == 0) {
-					node_count_set[next_id] = 1;
-				} else {
-					node_count_set[next_id] = node_count_set[next_id] + 1;
-				}
-				dist_walked += graph.get_length(next_h);
-				idx++;
-			}
-			total_dist_walked += dist_walked;
 			// where does our step come from, we add id regardless of walking distance and orientation
-			if (node_count_set.count(cur_id) == 0) {
-				node_count_set[cur_id] = 1;
-			} else {
-				node_count_set[cur_id] = node_count_set[cur_id] + 1;
-			}
-			if ((total_dist_walked < (walking_dist_prev + walking_dist_next))) {
-				return ska::flat_hash_map<nid_t, uint64_t>();
-			}
-			return node_count_set;
-		}
-
-		void add_target_set_to_union_set(ska::flat_hash_map<nid_t , uint64_t>& union_set,
-								   const ska::flat_hash_map<nid_t , uint64_t>& target_set) {
-			for (auto& target_item : target_set) {
-				nid_t node_id = target_item.first;
-				uint64_t node_count = target_item.second;
-				if (union_set.count(node_id) != 0) {
-					uint64_t union_node_count = union_set[node_id];
-					union_set[node_id] = std::max(node_count, union_node_count);
+			nodes.push_back({graph.get_id(cur_h), graph.get_length(cur_h)});
+			// sort by node id and sum the weights of the nodes we crossed more than once
+			std::sort(nodes.begin(), nodes.end(), [](const weighted_node_t& a, const weighted_node_t& b) {
+				return a.id < b.id;
+			});
+			uint64_t kept = 0;
+			for (uint64_t i = 0; i < nodes.size(); ++i) {
+				if (kept > 0 && nodes[kept - 1].id == nodes[i].id) {
+					nodes[kept - 1].weight += nodes[i].weight;
 				} else {
-					union_set[node_id] = node_count;
+					nodes[kept++] = nodes[i];
 				}
+				node_set.total += nodes[i].weight;
 			}
+			nodes.resize(kept);
 		}
 
-		ska::flat_hash_map<nid_t, uint64_t> intersect_target_query_sets(ska::flat_hash_map<nid_t , uint64_t>& union_set,
-										 ska::flat_hash_map<nid_t , uint64_t>& target_set,
-										 ska::flat_hash_map<nid_t , uint64_t>& query_set) {
-			ska::flat_hash_map<nid_t, uint64_t> intersect_set;
-			for (auto& union_item : union_set) {
-				nid_t union_node_id = union_item.first;
-				// node is present in both sets, we take the minimum count
-				if ((target_set.count(union_node_id) != 0) && (query_set.count(union_node_id) != 0)) {
-					uint64_t target_node_count = target_set[union_node_id];
-					uint64_t query_node_count = query_set[union_node_id];
-					intersect_set[union_node_id] = std::min(target_node_count, query_node_count);
-				}
-			}
-			return intersect_set;
-		}
-
-		double get_jaccard_index(const graph_t& graph, ska::flat_hash_map<nid_t , uint64_t>& query_set,
-								 ska::flat_hash_map<nid_t , uint64_t>& target_set) {
-			ska::flat_hash_map<nid_t, uint64_t> union_set;
-			for (auto& query_item : query_set) {
-				union_set[query_item.first] = query_item.second;
+		uint64_t intersection_weight(const weighted_node_set_t& query_set, const weighted_node_set_t& target_set) {
+			const weighted_node_t* q = query_set.nodes.data();
+			const weighted_node_t* t = target_set.nodes.data();
+			const weighted_node_t* q_end = q + query_set.nodes.size();
+			const weighted_node_t* t_end = t + target_set.nodes.size();
+			uint64_t weight = 0;
+			// no branch on the comparisons, which are as good as random, only on the ends of the sets
+			while (q != q_end && t != t_end) {
+				const nid_t q_id = q->id;
+				const nid_t t_id = t->id;
+				const uint64_t shared = std::min(q->weight, t->weight);
+				weight += q_id == t_id ? shared : 0;
+				q += q_id <= t_id;
+				t += t_id <= q_id;
 			}
-			add_target_set_to_union_set(union_set, target_set);
-			ska::flat_hash_map<nid_t, uint64_t> intersection_set = intersect_target_query_sets(union_set, target_set, query_set);
-			double jaccard = jaccard_idx_from_intersect_union_sets(intersection_set, union_set, graph);
-			return jaccard;
+			return weight;
 		}
 
-		double jaccard_idx_from_intersect_union_sets(ska::flat_hash_map<nid_t , uint64_t>& intersection_set,
-													 ska::flat_hash_map<nid_t , uint64_t>& union_set,
-													 const graph_t& graph) {
-			double jaccard_idx = 0.0;
-			uint64_t intersect_seq_len = 0;
-			uint64_t union_seq_len = 0;
-			for (auto& intersect_item : intersection_set) {
-				nid_t intersect_node_id = intersect_item.first;
-				uint64_t intersect_node_count = intersect_item.second;
-				handle_t h = graph.get_handle(intersect_node_id);
-				intersect_seq_len += graph.get_length(h)*intersect_node_count;
-			}
-			for (auto& union_item : union_set) {
-				nid_t union_node_id = union_item.first;
-				uint64_t union_node_count = union_item.second;
-				handle_t h = graph.get_handle(union_node_id);
-				union_seq_len += graph.get_length(h)*union_node_count;
-			}
-// #define debug_tips
+		double get_jaccard_index(const weighted_node_set_t& query_set, const weighted_node_set_t& target_set) {
+			// a node's weight in the union is the larger of its two, and max(a, b) = a + b - min(a, b)
+			const uint64_t intersect_seq_len = intersection_weight(query_set, target_set);
+			const uint64_t union_seq_len = query_set.total + target_set.total - intersect_seq_len;
 #ifdef debug_tips
 			std::cerr << "intersect_seq_len: " << intersect_seq_len << std::endl;
 			std::cerr << "union_seq_len: " << union_seq_len << std::endl;
 #endif
-			jaccard_idx = (double) intersect_seq_len / (double) union_seq_len;
-			return jaccard_idx;
+			return (double) intersect_seq_len / (double) union_seq_len;
 		}
 
 		std::pair<uint64_t , uint64_t> find_min_max_walk_dist_from_query_targets(const graph_t& graph,
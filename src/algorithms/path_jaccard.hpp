@@ -29,42 +29,37 @@ namespace odgi {
 																	  const step_handle_t& cur_step,
 																	  std::vector<step_handle_t>& target_step_handles);
 
-		/// from the given start step we walk the given distance in nucleotides left and right following the steps in the given graph graph, collecting all nodes that we cross <key>
-		/// we also record, how many times we visited a node <value>
-		ska::flat_hash_map<nid_t , uint64_t> collect_nodes_in_walking_dist(const graph_t& graph,
-																		const uint64_t& walking_dist_prev,
-																		const uint64_t& walking_dist_next,
-																		const step_handle_t& start_step,
-																		const bool& walked_walking_dist = false);
-
-		/// from the give start step we walk the given distance in nucleotides left and right following the given map, collecting all nodes that we cross <key>
-		/// we also record, how many times we visited a node <value>
-		ska::flat_hash_map<nid_t , uint64_t> collect_nodes_in_walking_dist_from_map(const graph_t& graph,
-																		   const uint64_t& walking_dist_prev,
-																		   const uint64_t& walking_dist_next,
-																		   const step_handle_t& start_step);
+		/// a node crossed by a walk, weighted by its length times the number of times the walk crossed it
+		struct weighted_node_t {
+			nid_t id;
+			uint64_t weight;
+		};
 
-		/// from a given target_set add the nodes into the union_set which might be not empty
-		void add_target_set_to_union_set(ska::flat_hash_map<nid_t , uint64_t>& union_set,
-								   const ska::flat_hash_map<nid_t , uint64_t>& target_set);
+		/// the nodes crossed by a walk, sorted by id, so that two sets are compared by merging them
+		struct weighted_node_set_t {
+			std::vector<weighted_node_t> nodes;
+			/// the sum of the weights, the sequence length of the set
+			uint64_t total = 0;
+			/// empty the set, keeping its buffer
+			void clear();
+			bool empty() const;
+		};
 
-		/// from a given target_set and a given query_set generate the intersection_set
-		/// we use the union_set as guidance
-		ska::flat_hash_map<nid_t, uint64_t> intersect_target_query_sets(ska::flat_hash_map<nid_t , uint64_t>& union_set,
-										 ska::flat_hash_map<nid_t , uint64_t>& target_set,
-										 ska::flat_hash_map<nid_t , uint64_t>& query_set);
+		/// from the given start step we walk the given distance in nucleotides left and right following the steps in the given graph, collecting all nodes that we cross
+		/// into node_set, weighted by their length and by how many times we visited them
+		/// node_set is left empty if we could not walk the full distance
+		void collect_nodes_in_walking_dist(const graph_t& graph,
+										   const uint64_t& walking_dist_prev,
+										   const uint64_t& walking_dist_next,
+										   const step_handle_t& start_step,
+										   weighted_node_set_t& node_set);
 
-		/// calculate the jaccard index from a given graph, a query set and a target set
-		/// invokes jaccard_idx_from_intersect_union_sets
-		double get_jaccard_index(const graph_t& graph, ska::flat_hash_map<nid_t , uint64_t>& query_set,
-								 ska::flat_hash_map<nid_t , uint64_t>& target_set);
+		/// the sequence length the two sets share: of each node in both, the smaller of its two weights
+		uint64_t intersection_weight(const weighted_node_set_t& query_set, const weighted_node_set_t& target_set);
 
-		/// calculate the jaccard index from an intersection_set and a union_set
-		/// 1. calculate the sequence lengths of both sets
-		/// 2. intersection_set_seq_len / union_set_seq_len
-		double jaccard_idx_from_intersect_union_sets(ska::flat_hash_map<nid_t , uint64_t>& intersection_set,
-															   ska::flat_hash_map<nid_t , uint64_t>& union_set,
-															   const graph_t& graph);
+		/// calculate the jaccard index of a query set and a target set
+		/// the sequence length of their intersection over the sequence length of their union, where a node counts with the larger of its weights
+		double get_jaccard_index(const weighted_node_set_t& query_set, const weighted_node_set_t& target_set);
 
 		/// given a vector of target step handles and a walking distance, we want to find out how much of the walking distance we can follow into each direction for each step
 		/// we identify the set of the maximum walkable distance for both directions shared by all steps
@@ -44,5 +44,11 @@ void keep_paths(const graph_t& graph, graph_t& into, const ska::flat_hash_set<pa
     into.optimize();
 }
 
+void keep_paths(graph_t& graph, const ska::flat_hash_set<path_handle_t>& to_keep) {
+    graph.keep_paths([&](const path_handle_t& path) {
+        return to_keep.count(path) > 0;
+    });
+}
+
 }
 }
@@ -15,5 +15,9 @@ using namespace handlegraph;
 
 void keep_paths(const graph_t& graph, graph_t& into, const ska::flat_hash_set<path_handle_t>& to_keep);
 
+/// Keep the paths in to_keep in the graph itself, dropping the steps of the others from its nodes
+/// without copying it; the kept paths are renumbered in their order
+void keep_paths(graph_t& graph, const ska::flat_hash_set<path_handle_t>& to_keep);
+
 }
 }
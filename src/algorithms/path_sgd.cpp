@@ -1,6 +1,9 @@
 #include "path_sgd.hpp"
 #include "dirty_zipfian_int_distribution.h"
 #include "layout.hpp"
+#include "profile.hpp"
+#include "zipf_zetas.hpp"
+#include "sgd_snapshot.hpp"
 
 //#define debug_path_sgd
 // #define eval_path_sgd
@@ -28,7 +31,18 @@ namespace odgi {
                                             const bool &snapshot,
                                             std::vector<std::string> &snapshots,
 											const bool &target_sorting,
-											std::vector<bool>& target_nodes) {
+											std::vector<bool>& target_nodes,
+											const bool &gpu,
+											const uint64_t &batch_terms,
+											const uint64_t &flat_index_max_bytes,
+											const bool &deterministic,
+											const std::string &seed,
+											const std::string &stress_log,
+											const double &stress_plateau,
+											const std::vector<bool> &warm_start_nodes,
+											const std::vector<handle_t> &initial_order,
+											const sgd_checkpoint_config_t &checkpoint) {
+            profile::scope_t profile_scope("path-guided SGD");
 #ifdef debug_path_sgd
             std::cerr << "iter_max: " << iter_max << std::endl;
             std::cerr << "min_term_updates: " << min_term_updates << std::endl;
@@ -59,14 +73,52 @@ namespace odgi {
             std::vector<atomic<bool>> snapshot_progress(iter_max);
             // we will produce one less snapshot compared to iterations
             snapshot_progress[0].store(true);
-            // seed them with the graph order
+            // seed them with the graph order, or with the given order of its handles
             uint64_t len = 0;
-            graph.for_each_handle(
-                    [&X, &graph, &len](const handle_t &handle) {
-                        // nb: we assume that the graph provides a compact handle set
-                        X[number_bool_packing::unpack_number(handle)].store(len);
-                        len += graph.get_length(handle);
-                    });
+            if (initial_order.empty()) {
+                graph.for_each_handle(
+                        [&X, &graph, &len](const handle_t &handle) {
+                            // nb: we assume that the graph provides a compact handle set
+                            X[number_bool_packing::unpack_number(handle)].store(len);
+                            len += graph.get_length(handle);
+                        });
+            } else {
+                for (auto &handle : initial_order) {
+                    X[number_bool_packing::unpack_number(handle)].store(len);
+                    len += graph.get_length(handle);
+                }
+            }
+            // pick up an interrupted run where its checkpoint left it
+            sgd_checkpointer_t checkpointer(checkpoint);
+            sgd_checkpoint_t resumed;
+            const bool resuming = checkpointer.resume(1, num_nodes, iter_max, resumed);
+            uint64_t first_iteration = 0;
+            if (resuming) {
+                for (uint64_t i = 0; i < num_nodes; ++i) {
+                    X[i].store(resumed.coords[i]);
+                }
+                first_iteration = std::min(resumed.iteration, iter_max - 1);
+                for (uint64_t i = 0; i <= first_iteration; ++i) {
+                    snapshot_progress[i].store(true);
+                }
+                if (progress) {
+                    std::cerr << "[odgi::path_linear_sgd] resuming from iteration " << first_iteration
+                              << " of the checkpoint " << checkpoint.filename << std::endl;
+                    progress_meter->increment(first_iteration * min_term_updates);
+                }
+            }
+            // snapshots only keep the positions, as float32 by node rank
+            auto write_snapshot = [&](const std::string &filename) {
+                sgd_snapshot_t snapshot_positions;
+                snapshot_positions.node_count = num_nodes;
+                snapshot_positions.total_length = len;
+                snapshot_positions.positions.reserve(num_nodes);
+                for (auto &x : X) {
+                    snapshot_positions.positions.push_back((float) x.load());
+                }
+                xp::temp_file::ofstream_t snapshot_stream(filename);
+                write_sgd_snapshot(snapshot_stream, snapshot_positions);
+            };
             // the longest path length measured in nucleotides
             //size_t longest_path_in_nucleotides = 0;
             // the total path length in nucleotides
@@ -103,6 +155,100 @@ namespace odgi {
             }
             //path_nucleotide_tree.index();
 
+            // in a warm start, the first step of each term is only drawn from the steps on the nodes to
+            // re-sort, and only these nodes move. Steps are laid out node by node in the path index, so
+            // the steps of node id n start after all steps on the nodes with a smaller id.
+            // In an MPI run, each rank only draws the first step of its terms from the steps of its own paths.
+            const bool warm_start = !warm_start_nodes.empty();
+            const bool distributed_run = distributed::active();
+            std::vector<path_handle_t> rank_paths;
+            std::vector<bool> on_rank;
+            if (distributed_run) {
+                rank_paths = distributed::rank_paths(graph, path_sgd_use_paths);
+                for (auto &path : rank_paths) {
+                    const uint64_t p = as_integer(path);
+                    if (p >= on_rank.size()) {
+                        on_rank.resize(p + 1, false);
+                    }
+                    on_rank[p] = true;
+                }
+            }
+            const bool restrict_steps = warm_start || distributed_run;
+            std::vector<uint64_t> drawn_steps;
+            if (restrict_steps) {
+                const sdsl::int_vector<> &npi_iv = path_index.get_npi_iv();
+                // an index of a subset of the paths lacks the steps of the others
+                uint64_t graph_step_count = 0;
+                graph.for_each_path_handle([&](const path_handle_t &path) {
+                    graph_step_count += graph.get_step_count(path);
+                });
+                const bool index_of_all_steps = graph_step_count == npi_iv.size();
+                uint64_t np_offset = 0;
+                for (uint64_t i = 0; i < num_nodes; ++i) {
+                    const handle_t h = graph.get_handle(i + 1);
+                    uint64_t step_count = graph.get_step_count(h);
+                    if (step_count > 0 && !index_of_all_steps) {
+                        // only the steps of the paths in the index are laid out for the node
+                        step_count = 0;
+                        graph.for_each_step_on_handle(h, [&](const step_handle_t &step) {
+                            step_count += path_index.get_path_step_count(graph.get_path_handle_of_step(step)) > 0;
+                        });
+                    }
+                    if (!warm_start || warm_start_nodes[i]) {
+                        for (uint64_t k = np_offset; k < np_offset + step_count; ++k) {
+                            if (!distributed_run || (npi_iv[k] < on_rank.size() && on_rank[npi_iv[k]])) {
+                                drawn_steps.push_back(k);
+                            }
+                        }
+                    }
+                    np_offset += step_count;
+                }
+                if (progress && warm_start) {
+                    std::cerr << "[odgi::path_linear_sgd] warm start from the current order, sampling "
+                              << drawn_steps.size() << " steps" << std::endl;
+                }
+                if (progress && distributed_run) {
+                    std::cerr << "[odgi::path_linear_sgd] rank " << distributed::rank() << " of " << distributed::size()
+                              << " sampling " << drawn_steps.size() << " steps of " << rank_paths.size() << " paths" << std::endl;
+                }
+            }
+            if (warm_start && distributed::all(drawn_steps.empty())) {
+                // no node to re-sort, keep the current order
+                at_least_one_path_with_more_than_one_step = false;
+            }
+            const uint64_t drawn_step_total = drawn_steps.size();
+            // a rank without steps to draw from still takes part in every exchange, but makes no updates
+            const bool idle = restrict_steps && drawn_step_total == 0;
+            // the ranks share the term updates of an iteration by their share of the steps
+            const uint64_t rank_term_updates = !distributed_run ? min_term_updates
+                : (idle ? 0 : std::max((uint64_t) 1, (uint64_t) std::round((double) min_term_updates * drawn_step_total
+                                                                          / std::max((size_t) 1, path_index.get_np_bv().size()))));
+
+#ifdef USE_GPU
+            if (gpu && !warm_start && !distributed_run && at_least_one_path_with_more_than_one_step) {
+                if (progress) {
+                    std::cerr << "[odgi::path_linear_sgd] running 1D path-guided SGD on the GPU" << std::endl;
+                }
+                cuda::layout_config_t config;
+                config.iter_max = iter_max;
+                config.min_term_updates = min_term_updates;
+                config.eta_max = eta_max;
+                config.eps = eps;
+                config.iter_with_max_learning_rate = (int32_t) iter_with_max_learning_rate;
+                config.first_cooling_iteration = first_cooling_iteration;
+                config.theta = theta;
+                config.space = uint32_t(space);
+                config.space_max = uint32_t(space_max);
+                config.space_quantization_step = uint32_t(space_quantization_step);
+                config.nthreads = nthreads;
+                cuda::gpu_sort(config, graph, path_sgd_use_paths, X, target_sorting ? &target_nodes : nullptr);
+                if (progress) {
+                    progress_meter->increment(total_term_updates);
+                }
+                // skip the CPU threads below
+                at_least_one_path_with_more_than_one_step = false;
+            }
+#endif
             if (at_least_one_path_with_more_than_one_step){
                 double w_min = (double) 1.0 / (double) (eta_max);
 
@@ -125,30 +271,61 @@ namespace odgi {
                 if (progress) {
                     std::cerr << "[odgi::path_linear_sgd] calculating zetas for " << (space <= space_max ? space : space_max + (space - space_max) / space_quantization_step + 1) << " zipf distributions" << std::endl;
                 }
-                std::vector<double> zetas((space <= space_max ? space : space_max + (space - space_max) / space_quantization_step + 1)+1);
-                double zeta_tmp = 0.0;
-                for (uint64_t i = 1; i < space + 1; i++) {
-                    zeta_tmp += dirtyzipf::fast_precise_pow(1.0 / i, theta);
-                    if (i <= space_max) {
-                        zetas[i] = zeta_tmp;
-                    }
-                    if (i >= space_max && (i - space_max) % space_quantization_step == 0) {
-                        zetas[space_max + 1 + (i - space_max) / space_quantization_step] = zeta_tmp;
+                std::vector<double> zetas = zipf_zetas(theta, space, space_max, space_quantization_step, nthreads);
+
+                // optionally read the steps from a flat copy of the path index, if it fits the memory budget
+                flat_path_index_t flat_index;
+                if (flat_index_max_bytes > 0) {
+                    const uint64_t flat_bytes = flat_path_index_t::size_in_bytes(path_index);
+                    if (flat_bytes <= flat_index_max_bytes) {
+                        if (progress) {
+                            std::cerr << "[odgi::path_linear_sgd] building a flat path index of " << flat_bytes << " bytes" << std::endl;
+                        }
+                        flat_index.build(path_index, nthreads);
+                    } else if (progress) {
+                        std::cerr << "[odgi::path_linear_sgd] a flat path index needs " << flat_bytes
+                                  << " bytes, over the budget, using the compact path index" << std::endl;
                     }
                 }
+                const bool use_flat_index = !flat_index.empty();
+                // the workers sample all over the positions and the path index, spread them over the NUMA nodes
+                if (nthreads > 1) {
+                    numa::interleave(X);
+                    path_index.interleave_memory();
+                }
+                // and, if asked for, back them with huge pages to take the TLB misses out of those samples
+                huge_pages::advise(X);
+                path_index.advise_huge_pages();
+                auto handle_of_step = [&](const step_handle_t &step) -> handle_t {
+                    return use_flat_index ? flat_index.get_handle_of_step(step) : path_index.get_handle_of_step(step);
+                };
+                auto position_of_step = [&](const step_handle_t &step) -> size_t {
+                    return use_flat_index ? flat_index.get_position_of_step(step) : path_index.get_position_of_step(step);
+                };
+                auto path_step_count_of = [&](const path_handle_t &path) -> size_t {
+                    return use_flat_index ? flat_index.get_path_step_count(path) : path_index.get_path_step_count(path);
+                };
+
+                auto movable = [&](const handle_t &h) -> bool {
+                    const uint64_t i = graph.get_id(h) - 1;
+                    return (!target_sorting || !target_nodes[i]) && (!warm_start || warm_start_nodes[i]);
+                };
+
+                // the nodes shared with the paths of other ranks, whose positions are averaged across them
+                const distributed::coordinate_averager_t averager(graph, rank_paths);
 
                 // how many term updates we make
                 std::atomic<uint64_t> term_updates;
                 term_updates.store(0);
                 // learning rate
                 std::atomic<double> eta;
-                eta.store(etas.front());
+                eta.store(etas[first_iteration]);
                 // adaptive zip theta
                 std::atomic<double> adj_theta;
-                adj_theta.store(theta);
+                adj_theta.store(first_iteration > first_cooling_iteration ? 0.001 : theta);
                 // if we're in a final cooling phase (last 10%) of iterations
                 std::atomic<bool> cooling;
-                cooling.store(false);
+                cooling.store(first_iteration > first_cooling_iteration);
                 // our max delta
                 std::atomic<double> Delta_max;
                 Delta_max.store(0);
@@ -156,12 +333,157 @@ namespace odgi {
                 std::atomic<bool> work_todo;
                 work_todo.store(true);
                 // approximately what iteration we're on
-                uint64_t iteration = 0;
+                uint64_t iteration = first_iteration;
+                // the step rank of the second step of a term, either a zipfian jump from s_rank or anywhere in the path
+                auto sample_partner_rank =
+                        [&](XoshiroCpp::Xoshiro256Plus &gen,
+                            std::uniform_int_distribution<uint64_t> &flip,
+                            const bool &zipf_jump,
+                            const double &_theta,
+                            const size_t &path_step_count,
+                            const size_t &s_rank) -> uint64_t {
+                            if (zipf_jump) {
+                                if (s_rank > 0 && flip(gen) || s_rank == path_step_count-1) {
+                                    // go backward
+                                    uint64_t jump_space = std::min(space, (uint64_t) s_rank);
+                                    uint64_t space = jump_space;
+                                    if (jump_space > space_max){
+                                        space = space_max + (jump_space - space_max) / space_quantization_step + 1;
+                                    }
+                                    dirtyzipf::dirty_zipfian_int_distribution<uint64_t>::param_type z_p(1, jump_space, _theta, zetas[space]);
+                                    dirtyzipf::dirty_zipfian_int_distribution<uint64_t> z(z_p);
+                                    uint64_t z_i = z(gen);
+                                    //assert(z_i <= path_space);
+                                    return s_rank - z_i;
+                                } else {
+                                    // go forward
+                                    uint64_t jump_space = std::min(space, (uint64_t) (path_step_count - s_rank - 1));
+                                    uint64_t space = jump_space;
+                                    if (jump_space > space_max){
+                                        space = space_max + (jump_space - space_max) / space_quantization_step + 1;
+                                    }
+                                    dirtyzipf::dirty_zipfian_int_distribution<uint64_t>::param_type z_p(1, jump_space, _theta, zetas[space]);
+                                    dirtyzipf::dirty_zipfian_int_distribution<uint64_t> z(z_p);
+                                    uint64_t z_i = z(gen);
+                                    //assert(z_i <= path_space);
+                                    return s_rank + z_i;
+                                }
+                            } else {
+                                // sample randomly across the path
+                                std::uniform_int_distribution<uint64_t> rando(0, path_step_count-1);
+                                return rando(gen);
+                            }
+                        };
+
+                // a fixed sample of terms, to follow the stress of the layout along the iterations
+                const bool monitor_stress = progress || !stress_log.empty() || stress_plateau > 0;
+                struct stress_term_t {
+                    uint64_t i;
+                    uint64_t j;
+                    double d_ij;
+                };
+                std::vector<stress_term_t> stress_terms;
+                std::ofstream stress_out;
+                if (monitor_stress) {
+                    const uint64_t stress_sample_size = 10000;
+                    XoshiroCpp::Xoshiro256Plus gen(9399220);
+                    const sdsl::bit_vector &np_bv = path_index.get_np_bv();
+                    const sdsl::int_vector<> &nr_iv = path_index.get_nr_iv();
+                    const sdsl::int_vector<> &npi_iv = path_index.get_npi_iv();
+                    std::uniform_int_distribution<uint64_t> dis_step(0, np_bv.size() - 1);
+                    std::uniform_int_distribution<uint64_t> flip(0, 1);
+                    for (uint64_t k = 0; k < stress_sample_size; ++k) {
+                        uint64_t step_index = dis_step(gen);
+                        uint64_t path_i = npi_iv[step_index];
+                        size_t path_step_count = path_step_count_of(as_path_handle(path_i));
+                        if (path_step_count == 1) {
+                            continue;
+                        }
+                        step_handle_t step_a, step_b;
+                        size_t s_rank = nr_iv[step_index] - 1;
+                        as_integers(step_a)[0] = path_i;
+                        as_integers(step_a)[1] = s_rank;
+                        as_integers(step_b)[0] = path_i;
+                        as_integers(step_b)[1] = sample_partner_rank(gen, flip, flip(gen), theta, path_step_count, s_rank);
+                        stress_term_t term;
+                        term.d_ij = std::abs(static_cast<double>(position_of_step(step_a))
+                                             - static_cast<double>(position_of_step(step_b)));
+                        if (term.d_ij == 0) {
+                            continue;
+                        }
+                        term.i = number_bool_packing::unpack_number(handle_of_step(step_a));
+                        term.j = number_bool_packing::unpack_number(handle_of_step(step_b));
+                        stress_terms.push_back(term);
+                    }
+                    if (!stress_log.empty()) {
+                        stress_out.open(stress_log);
+                        stress_out << "iteration\teta\tdelta.max\tstress" << std::endl;
+                    }
+                }
+                // iterations in a row whose stress improved by less than stress_plateau
+                uint64_t plateau_iterations = resuming ? resumed.plateau_iterations : 0;
+                double last_stress = resuming ? resumed.last_stress : std::numeric_limits<double>::max();
+                // record the stress at the end of an iteration, and tell if it has plateaued
+                auto record_stress =
+                        [&](const uint64_t &iter, const double &iter_eta, const double &iter_delta_max) -> bool {
+                            if (!monitor_stress) {
+                                return false;
+                            }
+                            double stress = 0;
+                            for (auto &term : stress_terms) {
+                                double d = std::abs(X[term.i].load(std::memory_order_relaxed) - X[term.j].load(std::memory_order_relaxed));
+                                double r = (d - term.d_ij) / term.d_ij;
+                                stress += r * r;
+                            }
+                            stress /= std::max((size_t) 1, stress_terms.size());
+                            if (progress) {
+                                std::cerr << "[odgi::path_linear_sgd] iteration " << iter << " sampled stress: " << stress << std::endl;
+                            }
+                            if (stress_out.is_open()) {
+                                stress_out << iter << "\t" << iter_eta << "\t" << iter_delta_max << "\t" << stress << std::endl;
+                            }
+                            if (stress < last_stress && (last_stress - stress) >= stress_plateau * last_stress) {
+                                plateau_iterations = 0;
+                            } else {
+                                ++plateau_iterations;
+                            }
+                            last_stress = std::min(last_stress, stress);
+                            return stress_plateau > 0 && plateau_iterations >= stress_plateau_patience;
+                        };
+                // save the state before next_iteration, with the generators of a deterministic run
+                auto write_checkpoint =
+                        [&](const uint64_t &next_iteration, const std::vector<XoshiroCpp::Xoshiro256Plus> &gens) {
+                            sgd_checkpoint_t state;
+                            state.dimensions = 1;
+                            state.node_count = num_nodes;
+                            state.iter_max = iter_max;
+                            state.iteration = next_iteration;
+                            state.plateau_iterations = plateau_iterations;
+                            state.last_stress = last_stress;
+                            for (auto &gen : gens) {
+                                state.rng_states.push_back(gen.serialize());
+                            }
+                            state.coords.reserve(num_nodes);
+                            for (auto &x : X) {
+                                state.coords.push_back(x.load());
+                            }
+                            try {
+                                checkpointer.write(state);
+                            } catch (const std::runtime_error &e) {
+                                std::cerr << e.what() << std::endl;
+                                exit(1);
+                            }
+                            if (progress) {
+                                std::cerr << "[odgi::path_linear_sgd] checkpoint before iteration " << next_iteration
+                                          << " written to " << checkpoint.filename << std::endl;
+                            }
+                        };
+
                 // launch a thread to update the learning rate, count iterations, and decide when to stop
                 auto checker_lambda =
                         [&]() {
                             while (work_todo.load()) {
-                                if (term_updates.load() > min_term_updates) {
+                                if (idle || term_updates.load() > rank_term_updates) {
                                     if (snapshot) {
                                         if (snapshot_progress[iteration].load() || iteration == iter_max) {
                                             iteration++;
@@ -178,11 +500,29 @@ namespace odgi {
                                         iteration++;
                                         snapshot_in_progress.store(false);
                                     }
+                                    double iteration_delta_max = Delta_max.load();
+                                    bool plateaued;
+                                    if (distributed_run) {
+                                        // the ranks meet here once per iteration and leave it agreeing on how to go on
+                                        if (averager.due(iteration - 1)) {
+                                            averager.average(X, 1);
+                                        }
+                                        iteration_delta_max = distributed::max(iteration_delta_max);
+                                        plateaued = distributed::all(record_stress(iteration, eta.load(), iteration_delta_max));
+                                    } else {
+                                        plateaued = record_stress(iteration, eta.load(), iteration_delta_max);
+                                    }
                                     if (iteration > iter_max) {
                                         work_todo.store(false);
-                                    } else if (Delta_max.load() <= delta) { // nb: this will also break at 0
+                                    } else if (plateaued) {
+                                        if (progress) {
+                                            std::cerr << "[odgi::path_linear_sgd] sampled stress improved by less than " << stress_plateau
+                                                      << " for " << stress_plateau_patience << " iterations, therefore ending iterations." << std::endl;
+                                        }
+                                        work_todo.store(false);
+                                    } else if (iteration_delta_max <= delta) { // nb: this will also break at 0
                                         if (progress) {
-                                            std::cerr << "[odgi::path_linear_sgd] delta_max: " << Delta_max.load()
+                                            std::cerr << "[odgi::path_linear_sgd] delta_max: " << iteration_delta_max
                                                       << " <= delta: "
                                                       << delta << ". Threshold reached, therefore ending iterations."
                                                       << std::endl;
@@ -195,6 +535,9 @@ namespace odgi {
                                             adj_theta.store(0.001);
                                             cooling.store(true);
                                         }
+                                        if (checkpointer.due()) {
+                                            write_checkpoint(iteration, {});
+                                        }
                                     }
                                     term_updates.store(0);
                                 }
@@ -204,29 +547,33 @@ namespace odgi {
 
                 auto worker_lambda =
                         [&](uint64_t tid) {
-                            // everyone tries to seed with their own random data
-                            const std::uint64_t seed = 9399220 + tid;
+                            // everyone tries to seed with their own random data, and a resumed run with other data again
+                            const std::uint64_t seed = 9399220 + tid + first_iteration * nthreads;
                             XoshiroCpp::Xoshiro256Plus gen(seed); // a nice, fast PRNG
+                            numa::pin_thread(tid);
                             // some references to literal bitvectors in the path index hmmm
                             const sdsl::bit_vector &np_bv = path_index.get_np_bv();
                             const sdsl::int_vector<> &nr_iv = path_index.get_nr_iv();
                             const sdsl::int_vector<> &npi_iv = path_index.get_npi_iv();
                             // we'll sample from all path steps
-                            std::uniform_int_distribution<uint64_t> dis_step = std::uniform_int_distribution<uint64_t>(0, np_bv.size() - 1);
+                            std::uniform_int_distribution<uint64_t> dis_step = std::uniform_int_distribution<uint64_t>(0, (restrict_steps ? drawn_step_total : np_bv.size()) - 1);
                             std::uniform_int_distribution<uint64_t> flip(0, 1);
                             uint64_t term_updates_local = 0;
-                            while (work_todo.load()) {
+                            while (!idle && work_todo.load()) {
                                 if (!snapshot_in_progress.load()) {
                                     // sample the first node from all the nodes in the graph
                                     // pick a random position from all paths
                                     uint64_t step_index = dis_step(gen);
+                                    if (restrict_steps) {
+                                        step_index = drawn_steps[step_index];
+                                    }
 #ifdef debug_sample_from_nodes
                                     std::cerr << "step_index: " << step_index << std::endl;
 #endif
                                     uint64_t path_i = npi_iv[step_index];
                                     path_handle_t path = as_path_handle(path_i);
 
-                                    size_t path_step_count = path_index.get_path_step_count(path);
+                                    size_t path_step_count = path_step_count_of(path);
                                     if (path_step_count == 1){
                                         continue;
                                     }
@@ -242,46 +589,13 @@ namespace odgi {
                                     std::cerr << "step rank in path: " << nr_iv[step_index]  << std::endl;
 #endif
 
-                                    if (cooling.load() || flip(gen)) {
-                                        auto _theta = adj_theta.load();
-                                        if (s_rank > 0 && flip(gen) || s_rank == path_step_count-1) {
-                                            // go backward
-                                            uint64_t jump_space = std::min(space, (uint64_t) s_rank);
-                                            uint64_t space = jump_space;
-                                            if (jump_space > space_max){
-                                                space = space_max + (jump_space - space_max) / space_quantization_step + 1;
-                                            }
-                                            dirtyzipf::dirty_zipfian_int_distribution<uint64_t>::param_type z_p(1, jump_space, _theta, zetas[space]);
-                                            dirtyzipf::dirty_zipfian_int_distribution<uint64_t> z(z_p);
-                                            uint64_t z_i = z(gen);
-                                            //assert(z_i <= path_space);
-                                            as_integers(step_b)[0] = as_integer(path);
-                                            as_integers(step_b)[1] = s_rank - z_i;
-                                        } else {
-                                            // go forward
-                                            uint64_t jump_space = std::min(space, (uint64_t) (path_step_count - s_rank - 1));
-                                            uint64_t space = jump_space;
-                                            if (jump_space > space_max){
-                                                space = space_max + (jump_space - space_max) / space_quantization_step + 1;
-                                            }
-                                            dirtyzipf::dirty_zipfian_int_distribution<uint64_t>::param_type z_p(1, jump_space, _theta, zetas[space]);
-                                            dirtyzipf::dirty_zipfian_int_distribution<uint64_t> z(z_p);
-                                            uint64_t z_i = z(gen);
-                                            //assert(z_i <= path_space);
-                                            as_integers(step_b)[0] = as_integer(path);
-                                            as_integers(step_b)[1] = s_rank + z_i;
-                                        }
-                                    } else {
-                                        // sample randomly across the path
-                                        graph.get_step_count(path);
-                                        std::uniform_int_distribution<uint64_t> rando(0, graph.get_step_count(path)-1);
-                                        as_integers(step_b)[0] = as_integer(path);
-                                        as_integers(step_b)[1] = rando(gen);
-                                    }
+                                    as_integers(step_b)[0] = as_integer(path);
+                                    as_integers(step_b)[1] = sample_partner_rank(gen, flip, cooling.load() || flip(gen), adj_theta.load(),
+                                                                                 path_step_count, s_rank);
 
                                     // and the graph handles, which we need to record the update
-                                    handle_t term_i = path_index.get_handle_of_step(step_a);
-                                    handle_t term_j = path_index.get_handle_of_step(step_b);
+                                    handle_t term_i = handle_of_step(step_a);
+                                    handle_t term_j = handle_of_step(step_b);
 
 									bool update_term_i = true;
 									bool update_term_j = true;
@@ -296,6 +610,14 @@ namespace odgi {
 											update_term_j = false;
 										}
 									}
+									if (warm_start) {
+										if (!warm_start_nodes[graph.get_id(term_i) - 1]) {
+											update_term_i = false;
+										}
+										if (!warm_start_nodes[graph.get_id(term_j) - 1]) {
+											update_term_j = false;
+										}
+									}
 									if (!update_term_j && !update_term_i) {
 										// we also have to update the number of terms here, because else we will over sample and the sorting will take much longer
 										term_updates_local++;
@@ -303,8 +625,8 @@ namespace odgi {
 									}
 
                                     // adjust the positions to the node starts
-                                    size_t pos_in_path_a = path_index.get_position_of_step(step_a);
-                                    size_t pos_in_path_b = path_index.get_position_of_step(step_b);
+                                    size_t pos_in_path_a = position_of_step(step_a);
+                                    size_t pos_in_path_b = position_of_step(step_b);
 #ifdef debug_path_sgd
                                     std::cerr << "1. pos in path " << pos_in_path_a << " " << pos_in_path_b << std::endl;
 #endif
@@ -350,7 +672,8 @@ namespace odgi {
                                 std::cerr << "nodes are " << graph.get_id(term_i) << " and " << graph.get_id(term_j) << std::endl;
 #endif
                                     // distance == magnitude in our 1D situation
-                                    double dx = X[i].load() - X[j].load();
+                                    // the updates race anyway (hogwild), so relaxed ordering spares a fence per store
+                                    double dx = X[i].load(std::memory_order_relaxed) - X[j].load(std::memory_order_relaxed);
                                     if (dx == 0) {
                                         dx = 1e-9; // avoid nan
                                     }
@@ -386,10 +709,10 @@ namespace odgi {
                                     std::cerr << "before X[i] " << X[i].load() << " X[j] " << X[j].load() << std::endl;
 #endif
 									if (update_term_i) {
-										X[i].store(X[i].load() - r_x);
+										X[i].store(X[i].load(std::memory_order_relaxed) - r_x, std::memory_order_relaxed);
 									}
 									if (update_term_j) {
-										X[j].store(X[j].load() + r_x);
+										X[j].store(X[j].load(std::memory_order_relaxed) + r_x, std::memory_order_relaxed);
 									}
 #ifdef debug_path_sgd
                                     std::cerr << "after X[i] " << X[i].load() << " X[j] " << X[j].load() << std::endl;
@@ -406,9 +729,128 @@ namespace odgi {
                             }
                         };
 
+                // batched sampling: each batch draws its first steps from a window of batch_terms steps around
+                // a random path step, so the index lookups stay in cache; the terms are then sorted by node
+                // rank and applied with the positions prefetched. Windows are centered on uniformly drawn
+                // path steps, so the first steps stay close to uniform over all paths, as with worker_lambda.
+                struct batch_term_t {
+                    uint64_t i;
+                    uint64_t j;
+                    double d_ij;
+                    bool update_i;
+                    bool update_j;
+                };
+                auto batch_worker_lambda =
+                        [&](uint64_t tid) {
+                            const std::uint64_t seed = 9399220 + tid + first_iteration * nthreads;
+                            XoshiroCpp::Xoshiro256Plus gen(seed);
+                            numa::pin_thread(tid);
+                            const sdsl::bit_vector &np_bv = path_index.get_np_bv();
+                            const sdsl::int_vector<> &nr_iv = path_index.get_nr_iv();
+                            const sdsl::int_vector<> &npi_iv = path_index.get_npi_iv();
+                            std::uniform_int_distribution<uint64_t> dis_step = std::uniform_int_distribution<uint64_t>(0, (restrict_steps ? drawn_step_total : np_bv.size()) - 1);
+                            std::uniform_int_distribution<uint64_t> flip(0, 1);
+                            std::vector<batch_term_t> batch;
+                            batch.reserve(batch_terms);
+                            uint64_t term_updates_local = 0;
+                            while (!idle && work_todo.load()) {
+                                if (snapshot_in_progress.load()) {
+                                    continue;
+                                }
+                                uint64_t step_index = dis_step(gen);
+                                if (restrict_steps) {
+                                    step_index = drawn_steps[step_index];
+                                }
+                                uint64_t path_i = npi_iv[step_index];
+                                path_handle_t path = as_path_handle(path_i);
+                                size_t path_step_count = path_step_count_of(path);
+                                if (path_step_count == 1) {
+                                    continue;
+                                }
+                                // center the window on the sampled step, shifted to fit in the path
+                                const size_t center = nr_iv[step_index] - 1;
+                                const size_t width = std::min((size_t) batch_terms, path_step_count);
+                                const size_t first = std::min(center - std::min(center, width / 2), path_step_count - width);
+                                std::uniform_int_distribution<uint64_t> dis_window(first, first + width - 1);
+                                const bool is_cooling = cooling.load();
+                                const double _theta = adj_theta.load();
+
+                                batch.clear();
+                                for (uint64_t k = 0; k < batch_terms; ++k) {
+                                    step_handle_t step_a, step_b;
+                                    const size_t s_rank = dis_window(gen);
+                                    as_integers(step_a)[0] = path_i;
+                                    as_integers(step_a)[1] = s_rank;
+                                    as_integers(step_b)[0] = path_i;
+                                    as_integers(step_b)[1] = sample_partner_rank(gen, flip, is_cooling || flip(gen), _theta,
+                                                                                 path_step_count, s_rank);
+                                    handle_t term_i = handle_of_step(step_a);
+                                    handle_t term_j = handle_of_step(step_b);
+                                    batch_term_t term;
+                                    term.update_i = movable(term_i);
+                                    term.update_j = movable(term_j);
+                                    if (!term.update_i && !term.update_j) {
+                                        continue;
+                                    }
+                                    term.d_ij = std::abs(static_cast<double>(position_of_step(step_a))
+                                                         - static_cast<double>(position_of_step(step_b)));
+                                    if (term.d_ij == 0) {
+                                        continue;
+                                    }
+                                    term.i = number_bool_packing::unpack_number(term_i);
+                                    term.j = number_bool_packing::unpack_number(term_j);
+                                    batch.push_back(term);
+                                }
+                                std::sort(batch.begin(), batch.end(),
+                                          [](const batch_term_t &a, const batch_term_t &b) {
+                                              return std::min(a.i, a.j) < std::min(b.i, b.j);
+                                          });
+
+                                const double _eta = eta.load();
+                                const uint64_t prefetch_distance = 8;
+                                for (uint64_t k = 0; k < batch.size(); ++k) {
+                                    if (k + prefetch_distance < batch.size()) {
+                                        __builtin_prefetch(&X[batch[k + prefetch_distance].i], 1);
+                                        __builtin_prefetch(&X[batch[k + prefetch_distance].j], 1);
+                                    }
+                                    const batch_term_t &term = batch[k];
+                                    double mu = _eta / term.d_ij;
+                                    if (mu > 1) {
+                                        mu = 1;
+                                    }
+                                    double dx = X[term.i].load(std::memory_order_relaxed) - X[term.j].load(std::memory_order_relaxed);
+                                    if (dx == 0) {
+                                        dx = 1e-9; // avoid nan
+                                    }
+                                    double mag = std::abs(dx);
+                                    double Delta = mu * (mag - term.d_ij) / 2;
+                                    double Delta_abs = std::abs(Delta);
+                                    while (Delta_abs > Delta_max.load()) {
+                                        Delta_max.store(Delta_abs);
+                                    }
+                                    double r_x = Delta / mag * dx;
+                                    if (term.update_i) {
+                                        X[term.i].store(X[term.i].load(std::memory_order_relaxed) - r_x, std::memory_order_relaxed);
+                                    }
+                                    if (term.update_j) {
+                                        X[term.j].store(X[term.j].load(std::memory_order_relaxed) + r_x, std::memory_order_relaxed);
+                                    }
+                                }
+                                // skipped terms count too, as in worker_lambda
+                                term_updates_local += batch_terms;
+                                if (term_updates_local >= 1000) {
+                                    term_updates += term_updates_local;
+                                    if (progress) {
+                                        progress_meter->increment(term_updates_local);
+                                    }
+                                    term_updates_local = 0;
+                                }
+                            }
+                        };
+
                 auto snapshot_lambda =
                         [&](void) {
-                            uint64_t iter = 0;
+                            uint64_t iter = first_iteration;
                             while (snapshot && work_todo.load()) {
                                 if ((iter < iteration) && iteration != iter_max) {
                                     //snapshot_in_progress.store(true); // will be released again by the snapshot thread
@@ -416,11 +858,7 @@ namespace odgi {
                                     // create temp file
                                     std::string snapshot_tmp_file = xp::temp_file::create("snapshot");
                                     // write to temp file
-                                    ofstream snapshot_stream;
-                                    snapshot_stream.open(snapshot_tmp_file);
-                                    for (auto &x : X) {
-                                        snapshot_stream << x << std::endl;
-                                    }
+                                    write_snapshot(snapshot_tmp_file);
                                     // push back the name of the temp file
                                     snapshots.push_back(snapshot_tmp_file);
                                     iter = iteration;
@@ -433,27 +871,187 @@ namespace odgi {
 
                         };
 
-                std::thread checker(checker_lambda);
-                std::thread snapshot_thread(snapshot_lambda);
+                if (deterministic) {
+                    // each iteration runs in rounds of a fixed number of terms, split into lanes that each
+                    // have their own seeded generator. The terms of a round are computed in parallel from
+                    // the positions at the start of the round, then applied in lane order, so the result
+                    // only depends on the seed, not on the number of threads or their scheduling.
+                    const uint64_t lane_count = 256;
+                    const uint64_t terms_per_lane = 64;
+                    uint64_t seed_hash = 14695981039346656037ull; // FNV-1a, stable across platforms
+                    for (const char c : seed) {
+                        seed_hash = (seed_hash ^ (uint8_t) c) * 1099511628211ull;
+                    }
+                    std::vector<XoshiroCpp::Xoshiro256Plus> lane_gens;
+                    lane_gens.reserve(lane_count);
+                    for (uint64_t l = 0; l < lane_count; ++l) {
+                        lane_gens.emplace_back(seed_hash + l);
+                    }
+                    // a checkpoint of a deterministic run carries on with the same draws
+                    if (resuming && resumed.rng_states.size() == lane_count) {
+                        for (uint64_t l = 0; l < lane_count; ++l) {
+                            lane_gens[l].deserialize(resumed.rng_states[l]);
+                        }
+                    }
+                    struct lane_update_t {
+                        uint64_t i;
+                        uint64_t j;
+                        double r_x;
+                        bool update_i;
+                        bool update_j;
+                    };
+                    std::vector<std::vector<lane_update_t>> lane_updates(lane_count);
+                    std::vector<double> lane_delta_max(lane_count);
+                    const sdsl::bit_vector &np_bv = path_index.get_np_bv();
+                    const sdsl::int_vector<> &nr_iv = path_index.get_nr_iv();
+                    const sdsl::int_vector<> &npi_iv = path_index.get_npi_iv();
+                    const uint64_t step_total = restrict_steps ? drawn_step_total : np_bv.size();
+                    for (uint64_t iter = first_iteration; iter < iter_max; ++iter) {
+                        const double _eta = etas[iter];
+                        const bool is_cooling = iter > first_cooling_iteration;
+                        const double _theta = is_cooling ? 0.001 : theta;
+                        double iteration_delta_max = 0;
+                        for (uint64_t done = 0; done < rank_term_updates; done += lane_count * terms_per_lane) {
+#pragma omp parallel for schedule(static) num_threads(nthreads)
+                            for (uint64_t l = 0; l < lane_count; ++l) {
+                                XoshiroCpp::Xoshiro256Plus &gen = lane_gens[l];
+                                std::uniform_int_distribution<uint64_t> dis_step(0, step_total - 1);
+                                std::uniform_int_distribution<uint64_t> flip(0, 1);
+                                std::vector<lane_update_t> &updates = lane_updates[l];
+                                updates.clear();
+                                double local_delta_max = 0;
+                                for (uint64_t k = 0; k < terms_per_lane; ++k) {
+                                    uint64_t step_index = dis_step(gen);
+                                    if (restrict_steps) {
+                                        step_index = drawn_steps[step_index];
+                                    }
+                                    uint64_t path_i = npi_iv[step_index];
+                                    path_handle_t path = as_path_handle(path_i);
+                                    size_t path_step_count = path_step_count_of(path);
+                                    if (path_step_count == 1) {
+                                        continue;
+                                    }
+                                    step_handle_t step_a, step_b;
+                                    size_t s_rank = nr_iv[step_index] - 1;
+                                    as_integers(step_a)[0] = path_i;
+                                    as_integers(step_a)[1] = s_rank;
+                                    as_integers(step_b)[0] = path_i;
+                                    as_integers(step_b)[1] = sample_partner_rank(gen, flip, is_cooling || flip(gen), _theta,
+                                                                                 path_step_count, s_rank);
+                                    handle_t term_i = handle_of_step(step_a);
+                                    handle_t term_j = handle_of_step(step_b);
+                                    lane_update_t update;
+                                    update.update_i = movable(term_i);
+                                    update.update_j = movable(term_j);
+                                    if (!update.update_i && !update.update_j) {
+                                        continue;
+                                    }
+                                    double d_ij = std::abs(static_cast<double>(position_of_step(step_a))
+                                                           - static_cast<double>(position_of_step(step_b)));
+                                    if (d_ij == 0) {
+                                        continue;
+                                    }
+                                    double mu = _eta / d_ij;
+                                    if (mu > 1) {
+                                        mu = 1;
+                                    }
+                                    update.i = number_bool_packing::unpack_number(term_i);
+                                    update.j = number_bool_packing::unpack_number(term_j);
+                                    double dx = X[update.i].load(std::memory_order_relaxed) - X[update.j].load(std::memory_order_relaxed);
+                                    if (dx == 0) {
+                                        dx = 1e-9; // avoid nan
+                                    }
+                                    double mag = std::abs(dx);
+                                    double Delta = mu * (mag - d_ij) / 2;
+                                    local_delta_max = std::max(local_delta_max, std::abs(Delta));
+                                    update.r_x = Delta / mag * dx;
+                                    updates.push_back(update);
+                                }
+                                lane_delta_max[l] = local_delta_max;
+                            }
+                            for (uint64_t l = 0; l < lane_count; ++l) {
+                                for (auto &update : lane_updates[l]) {
+                                    if (update.update_i) {
+                                        X[update.i].store(X[update.i].load(std::memory_order_relaxed) - update.r_x, std::memory_order_relaxed);
+                                    }
+                                    if (update.update_j) {
+                                        X[update.j].store(X[update.j].load(std::memory_order_relaxed) + update.r_x, std::memory_order_relaxed);
+                                    }
+                                }
+                                iteration_delta_max = std::max(iteration_delta_max, lane_delta_max[l]);
+                            }
+                            if (progress) {
+                                progress_meter->increment(lane_count * terms_per_lane);
+                            }
+                        }
+                        if (snapshot && iter + 1 < iter_max) {
+                            std::string snapshot_tmp_file = xp::temp_file::create("snapshot");
+                            write_snapshot(snapshot_tmp_file);
+                            snapshots.push_back(snapshot_tmp_file);
+                        }
+                        bool plateaued;
+                        if (distributed_run) {
+                            if (averager.due(iter)) {
+                                averager.average(X, 1);
+                            }
+                            iteration_delta_max = distributed::max(iteration_delta_max);
+                            plateaued = distributed::all(record_stress(iter + 1, _eta, iteration_delta_max));
+                        } else {
+                            plateaued = record_stress(iter + 1, _eta, iteration_delta_max);
+                        }
+                        if (plateaued) {
+                            if (progress) {
+                                std::cerr << "[odgi::path_linear_sgd] sampled stress improved by less than " << stress_plateau
+                                          << " for " << stress_plateau_patience << " iterations, therefore ending iterations." << std::endl;
+                            }
+                            break;
+                        }
+                        if (iteration_delta_max <= delta) { // nb: this will also break at 0
+                            if (progress) {
+                                std::cerr << "[odgi::path_linear_sgd] delta_max: " << iteration_delta_max
+                                          << " <= delta: "
+                                          << delta << ". Threshold reached, therefore ending iterations."
+                                          << std::endl;
+                            }
+                            break;
+                        }
+                        if (iter + 1 < iter_max && checkpointer.due()) {
+                            write_checkpoint(iter + 1, lane_gens);
+                        }
+                    }
+                } else {
+                    std::thread checker(checker_lambda);
+                    std::thread snapshot_thread(snapshot_lambda);
 
-                std::vector<std::thread> workers;
-                workers.reserve(nthreads);
-                for (uint64_t t = 0; t < nthreads; ++t) {
-                    workers.emplace_back(worker_lambda, t);
-                }
+                    std::vector<std::thread> workers;
+                    workers.reserve(nthreads);
+                    for (uint64_t t = 0; t < nthreads; ++t) {
+                        if (batch_terms > 0) {
+                            workers.emplace_back(batch_worker_lambda, t);
+                        } else {
+                            workers.emplace_back(worker_lambda, t);
+                        }
+                    }
 
-                for (uint64_t t = 0; t < nthreads; ++t) {
-                    workers[t].join();
-                }
+                    for (uint64_t t = 0; t < nthreads; ++t) {
+                        workers[t].join();
+                    }
 
-                snapshot_thread.join();
+                    snapshot_thread.join();
 
-                checker.join();
+                    checker.join();
+                }
+                if (distributed_run) {
+                    // leave all ranks with the same layout
+                    averager.average(X, 1);
+                }
             }
 
             if (progress) {
                 progress_meter->finish();
             }
+            // the run completed, there is nothing left to resume
+            checkpointer.finish();
 
             // drop out of atomic stuff... maybe not the best way to do this
             std::vector<double> X_final(X.size());
@@ -523,7 +1121,16 @@ namespace odgi {
                                                     const bool &write_layout,
                                                     const std::string &layout_out,
 													const bool &target_sorting,
-													std::vector<bool>& target_nodes) {
+													std::vector<bool>& target_nodes,
+													const bool &gpu,
+													const uint64_t &batch_terms,
+													const uint64_t &flat_index_max_bytes,
+													const bool &deterministic,
+													const std::string &stress_log,
+													const double &stress_plateau,
+													const std::vector<bool> &warm_start_nodes,
+													const std::vector<handle_t> &initial_order,
+											const sgd_checkpoint_config_t &checkpoint) {
             std::vector<string> snapshots;
             std::vector<double> layout = path_linear_sgd(graph,
                                                          path_index,
@@ -544,7 +1151,32 @@ namespace odgi {
                                                          snapshot,
                                                          snapshots,
 														 target_sorting,
-														 target_nodes);
+														 target_nodes,
+														 gpu,
+														 batch_terms,
+														 flat_index_max_bytes,
+														 deterministic,
+														 seed,
+														 stress_log,
+														 stress_plateau,
+														 warm_start_nodes,
+														 initial_order,
+														 checkpoint);
+            // the rank of each node in the order the layout started from, which breaks ties
+            std::vector<uint64_t> seed_rank(graph.get_node_count());
+            if (initial_order.empty()) {
+                for (uint64_t i = 0; i < seed_rank.size(); ++i) {
+                    seed_rank[i] = i;
+                }
+            } else {
+                for (uint64_t i = 0; i < initial_order.size(); ++i) {
+                    seed_rank[number_bool_packing::unpack_number(initial_order[i])] = i;
+                }
+            }
+            auto seed_key = [&](const handle_t &handle) {
+                return 2 * seed_rank[number_bool_packing::unpack_number(handle)]
+                    + number_bool_packing::unpack_bit(handle);
+            };
             // TODO move the following into its own function that we can reuse
 #ifdef debug_components
             std::cerr << "node count: " << graph.get_node_count() << std::endl;
@@ -560,7 +1192,7 @@ namespace odgi {
                 auto &weak_component = weak_components[i];
                 uint64_t id_sum = 0;
                 for (auto node_id : weak_component) {
-                    id_sum += node_id;
+                    id_sum += seed_rank[node_id - 1] + 1;
                 }
                 double avg_id = id_sum / (double) weak_component.size();
                 weak_component_order.push_back(std::make_pair(avg_id, i));
@@ -588,52 +1220,15 @@ namespace odgi {
             }
             weak_components_map.clear();
             if (snapshot) {
+                // the snapshots are the node positions of this graph; odgi viz --sgd-snapshot renders them
                 for (int j = 0; j < snapshots.size(); j++) {
-                    std::string snapshot_file_name = snapshots[j];
-                    std::ifstream snapshot_instream(snapshot_file_name);
-                    std::vector<double> snapshot_layout;
-                    std::string line;
-                    while(std::getline(snapshot_instream, line)) {
-                        snapshot_layout.push_back(std::stod(line));
-                    }
-                    snapshot_instream.close();
-                    uint64_t i = 0;
-                    std::vector<handle_layout_t> snapshot_handle_layout;
-                    graph.for_each_handle(
-                            [&i, &snapshot_layout, &weak_components_map, &snapshot_handle_layout](
-                                    const handle_t &handle) {
-                                snapshot_handle_layout.push_back(
-                                        {
-                                                weak_components_map[number_bool_packing::unpack_number(handle)],
-                                                snapshot_layout[i++],
-                                                handle
-                                        });
-                            });
-                    // sort the graph layout by component, then pos, then handle rank
-                    std::sort(snapshot_handle_layout.begin(), snapshot_handle_layout.end(),
-                              [&](const handle_layout_t &a,
-                                  const handle_layout_t &b) {
-                                  return a.weak_component < b.weak_component
-                                         || (a.weak_component == b.weak_component
-                                             && a.pos < b.pos
-                                             || (a.pos == b.pos
-                                                 && as_integer(a.handle) < as_integer(b.handle)));
-                              });
-                    std::vector<handle_t> order;
-                    order.reserve(graph.get_node_count());
-                    for (auto &layout_handle : snapshot_handle_layout) {
-                        order.push_back(layout_handle.handle);
-                    }
-                    std::cerr << "[odgi::path_linear_sgd] Applying order to graph of snapshot: " << std::to_string(j + 1)
-                              << std::endl;
                     std::string local_snapshot_prefix = snapshot_prefix + std::to_string(j + 1);
-                    auto* graph_copy = new odgi::graph_t();
-                    utils::graph_deep_copy(graph, graph_copy);
-                    graph_copy->apply_ordering(order, true);
-                    ofstream f(local_snapshot_prefix);
                     std::cerr << "[odgi::path_linear_sgd] Writing snapshot: " << std::to_string(j + 1) << std::endl;
-                    graph_copy->serialize(f);
+                    std::ifstream in(snapshots[j].c_str(), std::ios::binary);
+                    std::ofstream f(local_snapshot_prefix.c_str(), std::ios::binary);
+                    f << in.rdbuf();
                     f.close();
+                    xp::temp_file::remove(snapshots[j]);
                 }
             }
             std::vector<handle_layout_t> handle_layout;
@@ -655,9 +1250,9 @@ namespace odgi {
                                  || (a.weak_component == b.weak_component
                                      && a.pos < b.pos
                                      || (a.pos == b.pos
-                                         && as_integer(a.handle) < as_integer(b.handle)));
+                                         && seed_key(a.handle) < seed_key(b.handle)));
                       });
-            if (write_layout) {
+            if (write_layout && distributed::is_root()) {
                 std::vector<double> dummy_vec(handle_layout.size() * 2, 0.0);
                 std::vector<double> sorted_layout(handle_layout.size() * 2);
                 for (uint64_t i = 0; i < handle_layout.size(); i++) {
@@ -683,5 +1278,38 @@ namespace odgi {
             }
             return order;
         }
+
+        std::vector<bool> path_linear_sgd_warm_start_nodes(const graph_t &graph,
+                                                           const std::vector<bool> &changed_nodes,
+                                                           const uint64_t &radius) {
+            std::vector<bool> nodes(changed_nodes);
+            nodes.resize(graph.get_node_count(), false);
+            std::vector<handlegraph::nid_t> frontier;
+            for (uint64_t i = 0; i < nodes.size(); ++i) {
+                if (nodes[i]) {
+                    frontier.push_back(i + 1);
+                }
+            }
+            // breadth-first, one ring of neighbors per round
+            for (uint64_t r = 0; r < radius && !frontier.empty(); ++r) {
+                std::vector<handlegraph::nid_t> next;
+                for (auto &id : frontier) {
+                    graph.follow_edges(graph.get_handle(id), false, [&](const handle_t &h) {
+                        if (!nodes[graph.get_id(h) - 1]) {
+                            nodes[graph.get_id(h) - 1] = true;
+                            next.push_back(graph.get_id(h));
+                        }
+                    });
+                    graph.follow_edges(graph.get_handle(id), true, [&](const handle_t &h) {
+                        if (!nodes[graph.get_id(h) - 1]) {
+                            nodes[graph.get_id(h) - 1] = true;
+                            next.push_back(graph.get_id(h));
+                        }
+                    });
+                }
+                frontier.swap(next);
+            }
+            return nodes;
+        }
     }
 }
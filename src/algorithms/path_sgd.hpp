@@ -6,6 +6,7 @@
 #include <algorithm>
 #include <random>
 #include <set>
+#include <limits>
 #include <thread>
 #include <atomic>
 #include <handlegraph/path_handle_graph.hpp>
@@ -22,6 +23,14 @@
 #include "XoshiroCpp.hpp"
 #include "progress.hpp"
 #include "utils.hpp"
+#include "flat_path_index.hpp"
+#include "sgd_checkpoint.hpp"
+#include "numa.hpp"
+#include "huge_pages.hpp"
+#include "sgd_distributed.hpp"
+#ifdef USE_GPU
+#include "cuda/layout.h"
+#endif
 
 #include <fstream>
 
@@ -30,6 +39,9 @@ namespace algorithms {
 
 using namespace handlegraph;
 
+/// iterations in a row whose stress doesn't improve enough before path_linear_sgd stops early
+const uint64_t stress_plateau_patience = 3;
+
 struct handle_layout_t {
     uint64_t weak_component = 0;
     double pos = 0;
@@ -37,6 +49,14 @@ struct handle_layout_t {
 };
 
 /// use SGD driven, by path guided, and partly zipfian distribution sampled pairwise distances to obtain a 1D linear layout of the graph that respects its topology
+/// with batch_terms > 0, terms are drawn in cache-friendly batches of that size from windows of the paths
+/// with flat_index_max_bytes > 0, steps are read from a flat_path_index_t instead of the XP index if it fits in that many bytes
+/// with deterministic, the result only depends on the seed, whatever the number of threads
+/// the stress of a fixed sample of terms is tracked per iteration, written as TSV to stress_log if given; with
+/// stress_plateau > 0, iterations stop once it improved by less than that fraction for stress_plateau_patience iterations
+/// with warm_start_nodes, by id - 1, the layout starts from the graph order and only these nodes are sampled and moved
+/// with initial_order, a permutation of the graph's handles, the layout starts from that order instead of the graph order
+/// with a checkpoint file, the state is saved between iterations every checkpoint interval, and a resumed run starts from it
 std::vector<double> path_linear_sgd(const graph_t &graph,
                                     const xp::XP &path_index,
                                     const std::vector<path_handle_t>& path_sgd_use_paths,
@@ -54,7 +74,19 @@ std::vector<double> path_linear_sgd(const graph_t &graph,
                                     const uint64_t &nthreads,
                                     const bool &progress,
                                     const bool &snapshot,
-                                    std::vector<std::string> &snapshots);
+                                    std::vector<std::string> &snapshots,
+                                    const bool &target_sorting,
+                                    std::vector<bool>& target_nodes,
+                                    const bool &gpu = false,
+                                    const uint64_t &batch_terms = 0,
+                                    const uint64_t &flat_index_max_bytes = 0,
+                                    const bool &deterministic = false,
+                                    const std::string &seed = "pangenomic!",
+                                    const std::string &stress_log = "",
+                                    const double &stress_plateau = 0,
+                                    const std::vector<bool> &warm_start_nodes = {},
+                                    const std::vector<handle_t> &initial_order = {},
+                                    const sgd_checkpoint_config_t &checkpoint = sgd_checkpoint_config_t());
 
 /// our learning schedule
 std::vector<double> path_linear_sgd_schedule(const double &w_min,
@@ -63,6 +95,7 @@ std::vector<double> path_linear_sgd_schedule(const double &w_min,
                                              const uint64_t &iter_with_max_learning_rate,
                                              const double &eps);
 
+/// with initial_order, the layout starts from it, and components and ties are ordered by it instead of by node id
 std::vector<handle_t> path_linear_sgd_order(const graph_t &graph,
                                             const xp::XP &path_index,
                                             const std::vector<path_handle_t>& path_sgd_use_paths,
@@ -85,7 +118,21 @@ std::vector<handle_t> path_linear_sgd_order(const graph_t &graph,
                                             const bool &write_layout,
                                             const std::string &layout_out,
 											const bool &target_sorting,
-											std::vector<bool>& target_nodes);
+											std::vector<bool>& target_nodes,
+											const bool &gpu = false,
+											const uint64_t &batch_terms = 0,
+											const uint64_t &flat_index_max_bytes = 0,
+											const bool &deterministic = false,
+											const std::string &stress_log = "",
+											const double &stress_plateau = 0,
+											const std::vector<bool> &warm_start_nodes = {},
+											const std::vector<handle_t> &initial_order = {},
+											const sgd_checkpoint_config_t &checkpoint = sgd_checkpoint_config_t());
+
+/// the nodes to re-sort in a warm start: the changed nodes, by id - 1, and those up to radius edges away from them
+std::vector<bool> path_linear_sgd_warm_start_nodes(const graph_t &graph,
+                                                   const std::vector<bool> &changed_nodes,
+                                                   const uint64_t &radius);
 
 }
 
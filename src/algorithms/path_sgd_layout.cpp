@@ -1,5 +1,6 @@
 #include "path_sgd_layout.hpp"
 #include "algorithms/layout.hpp"
+#include "zipf_zetas.hpp"
 
 namespace odgi {
     namespace algorithms {
@@ -23,7 +24,11 @@ namespace odgi {
                                     const bool &snapshot,
                                     const std::string &snapshot_prefix,
                                     std::vector<std::atomic<double>> &X,
-                                    std::vector<std::atomic<double>> &Y) {
+                                    std::vector<std::atomic<double>> &Y,
+                                    const bool &hogwild,
+                                    const uint64_t &flat_index_max_bytes,
+                                    const double &repulsion,
+                                    const sgd_checkpoint_config_t &checkpoint) {
 #ifdef debug_path_sgd
             std::cerr << "iter_max: " << iter_max << std::endl;
             std::cerr << "min_term_updates: " << min_term_updates << std::endl;
@@ -54,6 +59,26 @@ namespace odgi {
             std::vector<atomic<bool>> snapshot_progress(iter_max);
             // we will produce one less snapshot compared to iterations
             snapshot_progress[0].store(true);
+            // pick up an interrupted run where its checkpoint left it, the coordinates of each node end XY-interleaved
+            sgd_checkpointer_t checkpointer(checkpoint);
+            sgd_checkpoint_t resumed;
+            const bool resuming = checkpointer.resume(2, X.size(), iter_max, resumed);
+            uint64_t first_iteration = 0;
+            if (resuming) {
+                for (uint64_t k = 0; k < X.size(); ++k) {
+                    X[k].store(resumed.coords[2 * k]);
+                    Y[k].store(resumed.coords[2 * k + 1]);
+                }
+                first_iteration = std::min(resumed.iteration, iter_max - 1);
+                for (uint64_t i = 0; i <= first_iteration; ++i) {
+                    snapshot_progress[i].store(true);
+                }
+                if (progress) {
+                    std::cerr << "[odgi::path_linear_sgd_layout] resuming from iteration " << first_iteration
+                              << " of the checkpoint " << checkpoint.filename << std::endl;
+                    progress_meter->increment(first_iteration * min_term_updates);
+                }
+            }
             // seed them with the graph order
             uint64_t len = 0;
             // the longest path length measured in nucleotides
@@ -84,30 +109,118 @@ namespace odgi {
                                                                            eps);
 
                 // cache zipf zetas for our full path space
-                std::vector<double> zetas((space <= space_max ? space : space_max + (space - space_max) / space_quantization_step + 1)+1);
-                double zeta_tmp = 0.0;
-                for (uint64_t i = 1; i < space + 1; i++) {
-                    zeta_tmp += dirtyzipf::fast_precise_pow(1.0 / i, theta);
-                    if (i <= space_max) {
-                        zetas[i] = zeta_tmp;
+                std::vector<double> zetas = zipf_zetas(theta, space, space_max, space_quantization_step, nthreads);
+
+                // in hogwild mode, the coordinates of both ends of a node are kept XY-interleaved
+                // in 16 bytes of relaxed floats, so a term update touches one cache line per node
+                std::vector<std::atomic<float>> coords(hogwild ? 4 * num_nodes : 0);
+                if (hogwild) {
+                    for (uint64_t k = 0; k < num_nodes; ++k) {
+                        coords[4 * k].store(X[2 * k].load(), std::memory_order_relaxed);
+                        coords[4 * k + 1].store(Y[2 * k].load(), std::memory_order_relaxed);
+                        coords[4 * k + 2].store(X[2 * k + 1].load(), std::memory_order_relaxed);
+                        coords[4 * k + 3].store(Y[2 * k + 1].load(), std::memory_order_relaxed);
+                    }
+                }
+
+                // optionally read the steps from a flat copy of the path index, if it fits the memory budget
+                flat_path_index_t flat_index;
+                if (flat_index_max_bytes > 0) {
+                    const uint64_t flat_bytes = flat_path_index_t::size_in_bytes(path_index);
+                    if (flat_bytes <= flat_index_max_bytes) {
+                        if (progress) {
+                            std::cerr << "[odgi::path_linear_sgd_layout] building a flat path index of " << flat_bytes << " bytes" << std::endl;
+                        }
+                        flat_index.build(path_index, nthreads);
+                    } else if (progress) {
+                        std::cerr << "[odgi::path_linear_sgd_layout] a flat path index needs " << flat_bytes
+                                  << " bytes, over the budget, using the compact path index" << std::endl;
+                    }
+                }
+                const bool use_flat_index = !flat_index.empty();
+                // the workers sample all over the coordinates and the path index, spread them over the NUMA nodes
+                if (nthreads > 1) {
+                    if (hogwild) {
+                        numa::interleave(coords);
+                    } else {
+                        numa::interleave(X);
+                        numa::interleave(Y);
+                    }
+                    path_index.interleave_memory();
+                }
+                // and, if asked for, back them with huge pages to take the TLB misses out of those samples
+                if (hogwild) {
+                    huge_pages::advise(coords);
+                } else {
+                    huge_pages::advise(X);
+                    huge_pages::advise(Y);
+                }
+                path_index.advise_huge_pages();
+                auto handle_of_step = [&](const step_handle_t &step) -> handle_t {
+                    return use_flat_index ? flat_index.get_handle_of_step(step) : path_index.get_handle_of_step(step);
+                };
+                auto position_of_step = [&](const step_handle_t &step) -> size_t {
+                    return use_flat_index ? flat_index.get_position_of_step(step) : path_index.get_position_of_step(step);
+                };
+                auto path_step_count_of = [&](const path_handle_t &path) -> size_t {
+                    return use_flat_index ? flat_index.get_path_step_count(path) : path_index.get_path_step_count(path);
+                };
+
+                // in an MPI run, each rank draws the first step of its terms from its own paths, and the coordinates
+                // of the nodes shared with other ranks are averaged across them
+                const bool distributed_run = distributed::active();
+                std::vector<path_handle_t> rank_paths;
+                std::vector<uint64_t> drawn_steps;
+                if (distributed_run) {
+                    rank_paths = distributed::rank_paths(graph, path_sgd_use_paths);
+                    std::vector<bool> on_rank;
+                    for (auto &path : rank_paths) {
+                        const uint64_t p = as_integer(path);
+                        if (p >= on_rank.size()) {
+                            on_rank.resize(p + 1, false);
+                        }
+                        on_rank[p] = true;
                     }
-                    if (i >= space_max && (i - space_max) % space_quantization_step == 0) {
-                        zetas[space_max + 1 + (i - space_max) / space_quantization_step] = zeta_tmp;
+                    const sdsl::int_vector<> &npi_iv = path_index.get_npi_iv();
+                    for (uint64_t k = 0; k < npi_iv.size(); ++k) {
+                        if (npi_iv[k] < on_rank.size() && on_rank[npi_iv[k]]) {
+                            drawn_steps.push_back(k);
+                        }
+                    }
+                    if (progress) {
+                        std::cerr << "[odgi::path_linear_sgd_layout] rank " << distributed::rank() << " of " << distributed::size()
+                                  << " sampling " << drawn_steps.size() << " steps of " << rank_paths.size() << " paths" << std::endl;
                     }
                 }
+                const uint64_t drawn_step_total = drawn_steps.size();
+                // a rank without steps to draw from still takes part in every exchange, but makes no updates
+                const bool idle = distributed_run && drawn_step_total == 0;
+                // the ranks share the term updates of an iteration by their share of the steps
+                const uint64_t rank_term_updates = !distributed_run ? min_term_updates
+                    : (idle ? 0 : std::max((uint64_t) 1, (uint64_t) std::round((double) min_term_updates * drawn_step_total
+                                                                              / std::max((size_t) 1, path_index.get_np_bv().size()))));
+                const distributed::coordinate_averager_t averager(graph, rank_paths);
+                auto average_coordinates = [&](void) {
+                    if (hogwild) {
+                        averager.average(coords, 4);
+                    } else {
+                        averager.average(X, 2);
+                        averager.average(Y, 2);
+                    }
+                };
 
                 // how many term updates we make
                 std::atomic<uint64_t> term_updates;
                 term_updates.store(0);
                 // learning rate
                 std::atomic<double> eta;
-                eta.store(etas.front());
+                eta.store(etas[first_iteration]);
                 // adaptive zip theta
                 std::atomic<double> adj_theta;
-                adj_theta.store(theta);
+                adj_theta.store(first_iteration >= first_cooling_iteration ? 0.001 : theta);
                 // if we're in a final cooling phase (last 10%) of iterations
                 std::atomic<bool> cooling;
-                cooling.store(false);
+                cooling.store(first_iteration >= first_cooling_iteration);
                 // our max delta
                 std::atomic<double> Delta_max;
                 Delta_max.store(0);
@@ -115,12 +228,71 @@ namespace odgi {
                 std::atomic<bool> work_todo;
                 work_todo.store(true);
                 // approximately what iteration we're on
-                uint64_t iteration = 0;
+                uint64_t iteration = first_iteration;
+                // are the workers paused for a repulsion pass?
+                std::atomic<bool> repulsion_in_progress;
+                repulsion_in_progress.store(false);
+                // push every node end away from all others with a force of repulsion^2 / distance, approximated
+                // with a quadtree, capped at a displacement of repulsion that cools down with the iterations
+                auto repulsion_pass = [&](const double& factor) {
+                    const uint64_t n_points = 2 * num_nodes;
+                    std::vector<double> px(n_points), py(n_points);
+                    for (uint64_t k = 0; k < n_points; ++k) {
+                        px[k] = hogwild ? coords[2 * k].load(std::memory_order_relaxed) : X[k].load();
+                        py[k] = hogwild ? coords[2 * k + 1].load(std::memory_order_relaxed) : Y[k].load();
+                    }
+                    barnes_hut_quadtree_t tree;
+                    tree.build(px, py);
+                    const double strength = repulsion * repulsion * factor;
+                    const double max_step = repulsion * factor;
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(nthreads)
+                    for (uint64_t k = 0; k < n_points; ++k) {
+                        double fx, fy;
+                        tree.repulsion(k, 0.5, fx, fy);
+                        double dx = strength * fx;
+                        double dy = strength * fy;
+                        const double step = std::sqrt(dx * dx + dy * dy);
+                        if (step > max_step) {
+                            dx *= max_step / step;
+                            dy *= max_step / step;
+                        }
+                        if (hogwild) {
+                            coords[2 * k].store(px[k] + dx, std::memory_order_relaxed);
+                            coords[2 * k + 1].store(py[k] + dy, std::memory_order_relaxed);
+                        } else {
+                            X[k].store(px[k] + dx);
+                            Y[k].store(py[k] + dy);
+                        }
+                    }
+                };
+                // save the state before next_iteration
+                auto write_checkpoint = [&](const uint64_t &next_iteration) {
+                    sgd_checkpoint_t state;
+                    state.dimensions = 2;
+                    state.node_count = X.size();
+                    state.iter_max = iter_max;
+                    state.iteration = next_iteration;
+                    state.coords.resize(2 * X.size());
+                    for (uint64_t k = 0; k < X.size(); ++k) {
+                        state.coords[2 * k] = hogwild ? coords[2 * k].load(std::memory_order_relaxed) : X[k].load();
+                        state.coords[2 * k + 1] = hogwild ? coords[2 * k + 1].load(std::memory_order_relaxed) : Y[k].load();
+                    }
+                    try {
+                        checkpointer.write(state);
+                    } catch (const std::runtime_error &e) {
+                        std::cerr << e.what() << std::endl;
+                        exit(1);
+                    }
+                    if (progress) {
+                        std::cerr << "[odgi::path_linear_sgd_layout] checkpoint before iteration " << next_iteration
+                                  << " written to " << checkpoint.filename << std::endl;
+                    }
+                };
                 // launch a thread to update the learning rate, count iterations, and decide when to stop
                 auto checker_lambda =
                         [&]() {
                             while (work_todo.load()) {
-                                if (term_updates.load() > min_term_updates) {
+                                if (idle || term_updates.load() > rank_term_updates) {
                                     if (snapshot) {
                                         if (snapshot_progress[iteration].load() || iteration == iter_max) {
                                             iteration++;
@@ -137,11 +309,19 @@ namespace odgi {
                                         iteration++;
                                         snapshot_in_progress.store(false);
                                     }
+                                    double iteration_delta_max = Delta_max.load();
+                                    if (distributed_run) {
+                                        // the ranks meet here once per iteration and leave it agreeing on how to go on
+                                        if (averager.due(iteration - 1)) {
+                                            average_coordinates();
+                                        }
+                                        iteration_delta_max = distributed::max(iteration_delta_max);
+                                    }
                                     if (iteration >= iter_max) {
                                         work_todo.store(false);
-                                    } else if (Delta_max.load() <= delta) { // nb: this will also break at 0
+                                    } else if (iteration_delta_max <= delta) { // nb: this will also break at 0
                                         if (progress) {
-                                            std::cerr << "[odgi::path_linear_sgd_layout] delta_max: " << Delta_max.load()
+                                            std::cerr << "[odgi::path_linear_sgd_layout] delta_max: " << iteration_delta_max
                                                       << " <= delta: "
                                                       << delta << ". Threshold reached, therefore ending iterations."
                                                       << std::endl;
@@ -150,11 +330,21 @@ namespace odgi {
                                     } else {
                                         eta.store(etas[iteration]); // update our learning rate
                                         Delta_max.store(delta); // set our delta max to the threshold
+                                        if (repulsion > 0) {
+                                            repulsion_in_progress.store(true);
+                                            // let the workers finish their current term
+                                            std::this_thread::sleep_for(1ms);
+                                            repulsion_pass(1.0 - (double) iteration / (double) iter_max);
+                                            repulsion_in_progress.store(false);
+                                        }
                                         if (iteration >= first_cooling_iteration) {
                                             //std::cerr << std::endl << "setting cooling!!" << std::endl;
                                             adj_theta.store(0.001);
                                             cooling.store(true);
                                         }
+                                        if (checkpointer.due()) {
+                                            write_checkpoint(iteration);
+                                        }
                                     }
                                     term_updates.store(0);
                                 }
@@ -164,29 +354,37 @@ namespace odgi {
 
                 auto worker_lambda =
                         [&](uint64_t tid) {
-                            // everyone tries to seed with their own random data
-                            const std::uint64_t seed = 9399220 + tid;
+                            // everyone tries to seed with their own random data, and a resumed run with other data again
+                            const std::uint64_t seed = 9399220 + tid + first_iteration * nthreads;
                             XoshiroCpp::Xoshiro256Plus gen(seed); // a nice, fast PRNG
+                            numa::pin_thread(tid);
                             // some references to literal bitvectors in the path index hmmm
                             const sdsl::bit_vector &np_bv = path_index.get_np_bv();
                             const sdsl::int_vector<> &nr_iv = path_index.get_nr_iv();
                             const sdsl::int_vector<> &npi_iv = path_index.get_npi_iv();
                             // we'll sample from all path steps
-                            std::uniform_int_distribution<uint64_t> dis_step = std::uniform_int_distribution<uint64_t>(0, np_bv.size() - 1);
+                            std::uniform_int_distribution<uint64_t> dis_step = std::uniform_int_distribution<uint64_t>(0, (distributed_run ? drawn_step_total : np_bv.size()) - 1);
                             std::uniform_int_distribution<uint64_t> flip(0, 1);
                             uint64_t term_updates_local = 0;
-                            while (work_todo.load()) {
+                            while (!idle && work_todo.load()) {
+                                if (repulsion_in_progress.load()) {
+                                    std::this_thread::sleep_for(1ms);
+                                    continue;
+                                }
                                 if (!snapshot_in_progress.load()) {
                                     // sample the first node from all the nodes in the graph
                                     // pick a random position from all paths
                                     uint64_t step_index = dis_step(gen);
+                                    if (distributed_run) {
+                                        step_index = drawn_steps[step_index];
+                                    }
 #ifdef debug_sample_from_nodes
                                     std::cerr << "step_index: " << step_index << std::endl;
 #endif
                                     uint64_t path_i = npi_iv[step_index];
                                     path_handle_t path = as_path_handle(path_i);
 
-                                    size_t path_step_count = path_index.get_path_step_count(path);
+                                    size_t path_step_count = path_step_count_of(path);
                                     if (path_step_count == 1){
                                         continue;
                                     }
@@ -239,14 +437,14 @@ namespace odgi {
 
 
                                     // and the graph handles, which we need to record the update
-                                    handle_t term_i = path_index.get_handle_of_step(step_a);
-                                    handle_t term_j = path_index.get_handle_of_step(step_b);
+                                    handle_t term_i = handle_of_step(step_a);
+                                    handle_t term_j = handle_of_step(step_b);
                                     uint64_t term_i_length = graph.get_length(term_i);
                                     uint64_t term_j_length = graph.get_length(term_j);
 
                                     // adjust the positions to the node starts
-                                    size_t pos_in_path_a = path_index.get_position_of_step(step_a);
-                                    size_t pos_in_path_b = path_index.get_position_of_step(step_b);
+                                    size_t pos_in_path_a = position_of_step(step_a);
+                                    size_t pos_in_path_b = position_of_step(step_b);
 
                                     // determine which end we're working with for each node
                                     bool term_i_is_rev = graph.get_is_reverse(term_i);
@@ -319,8 +517,18 @@ namespace odgi {
                                     if (use_other_end_b) {
                                         offset_j += 1;
                                     }
-                                    double dx = X[2 * i + offset_i].load() - X[2 * j + offset_j].load();
-                                    double dy = Y[2 * i + offset_i].load() - Y[2 * j + offset_j].load();
+                                    std::atomic<float> *coords_i = nullptr;
+                                    std::atomic<float> *coords_j = nullptr;
+                                    double dx, dy;
+                                    if (hogwild) {
+                                        coords_i = &coords[4 * i + 2 * offset_i];
+                                        coords_j = &coords[4 * j + 2 * offset_j];
+                                        dx = coords_i[0].load(std::memory_order_relaxed) - coords_j[0].load(std::memory_order_relaxed);
+                                        dy = coords_i[1].load(std::memory_order_relaxed) - coords_j[1].load(std::memory_order_relaxed);
+                                    } else {
+                                        dx = X[2 * i + offset_i].load() - X[2 * j + offset_j].load();
+                                        dy = Y[2 * i + offset_i].load() - Y[2 * j + offset_j].load();
+                                    }
                                     if (dx == 0) {
                                         dx = 1e-9; // avoid nan
                                     }
@@ -357,10 +565,17 @@ namespace odgi {
 #ifdef debug_path_sgd
                                     std::cerr << "before X[i] " << X[i].load() << " X[j] " << X[j].load() << std::endl;
 #endif
-                                    X[2 * i + offset_i].store(X[2 * i + offset_i].load() - r_x);
-                                    Y[2 * i + offset_i].store(Y[2 * i + offset_i].load() - r_y);
-                                    X[2 * j + offset_j].store(X[2 * j + offset_j].load() + r_x);
-                                    Y[2 * j + offset_j].store(Y[2 * j + offset_j].load() + r_y);
+                                    if (hogwild) {
+                                        coords_i[0].store(coords_i[0].load(std::memory_order_relaxed) - r_x, std::memory_order_relaxed);
+                                        coords_i[1].store(coords_i[1].load(std::memory_order_relaxed) - r_y, std::memory_order_relaxed);
+                                        coords_j[0].store(coords_j[0].load(std::memory_order_relaxed) + r_x, std::memory_order_relaxed);
+                                        coords_j[1].store(coords_j[1].load(std::memory_order_relaxed) + r_y, std::memory_order_relaxed);
+                                    } else {
+                                        X[2 * i + offset_i].store(X[2 * i + offset_i].load() - r_x);
+                                        Y[2 * i + offset_i].store(Y[2 * i + offset_i].load() - r_y);
+                                        X[2 * j + offset_j].store(X[2 * j + offset_j].load() + r_x);
+                                        Y[2 * j + offset_j].store(Y[2 * j + offset_j].load() + r_y);
+                                    }
 #ifdef debug_path_sgd
                                     std::cerr << "after X[i] " << X[i].load() << " X[j] " << X[j].load() << std::endl;
 #endif
@@ -378,20 +593,27 @@ namespace odgi {
 
                 auto snapshot_lambda =
                         [&]() {
-                            uint64_t iter = 0;
+                            uint64_t iter = first_iteration;
                             while (snapshot && work_todo.load()) {
                                 if ((iter < iteration) && iteration != iter_max) {
                                     std::cerr << "[odgi::path_linear_sgd_layout] snapshot thread: Taking snapshot!" << std::endl;
                                     // drop out of atomic stuff... maybe not the best way to do this
                                     std::vector<double> X_iter(X.size());
-                                    uint64_t i = 0;
-                                    for (auto &x : X) {
-                                        X_iter[i++] = x.load();
-                                    }
                                     std::vector<double> Y_iter(Y.size());
-                                    i = 0;
-                                    for (auto &y : Y) {
-                                        Y_iter[i++] = y.load();
+                                    if (hogwild) {
+                                        for (uint64_t k = 0; k < X.size(); ++k) {
+                                            X_iter[k] = coords[2 * k].load(std::memory_order_relaxed);
+                                            Y_iter[k] = coords[2 * k + 1].load(std::memory_order_relaxed);
+                                        }
+                                    } else {
+                                        uint64_t i = 0;
+                                        for (auto &x : X) {
+                                            X_iter[i++] = x.load();
+                                        }
+                                        i = 0;
+                                        for (auto &y : Y) {
+                                            Y_iter[i++] = y.load();
+                                        }
                                     }
                                     algorithms::layout::Layout layout(X_iter, Y_iter);
                                     std::string local_snapshot_prefix = snapshot_prefix + std::to_string(iter + 1);
@@ -423,11 +645,24 @@ namespace odgi {
                 snapshot_thread.join();
 
                 checker.join();
+
+                if (distributed_run) {
+                    // leave all ranks with the same layout
+                    average_coordinates();
+                }
+                if (hogwild) {
+                    for (uint64_t k = 0; k < X.size(); ++k) {
+                        X[k].store(coords[2 * k].load(std::memory_order_relaxed));
+                        Y[k].store(coords[2 * k + 1].load(std::memory_order_relaxed));
+                    }
+                }
             }
 
             if (progress) {
                 progress_meter->finish();
             }
+            // the run completed, there is nothing left to resume
+            checkpointer.finish();
         }
 
         std::vector<double> path_linear_sgd_layout_schedule(const double &w_min,
@@ -486,7 +721,9 @@ namespace odgi {
                                     const bool &snapshot,
                                     const std::string &snapshot_prefix,
                                     std::vector<std::atomic<double>> &X,
-                                    std::vector<std::atomic<double>> &Y) {
+                                    std::vector<std::atomic<double>> &Y,
+                                    const int &gpu_count,
+                                    const uint64_t &max_device_path_steps) {
             cuda::layout_config_t config;
             config.iter_max = iter_max;
             config.min_term_updates = min_term_updates;
@@ -499,6 +736,8 @@ namespace odgi {
             config.space_max = uint32_t(space_max);
             config.space_quantization_step = uint32_t(space_quantization_step);
             config.nthreads = nthreads;
+            config.gpu_count = gpu_count;
+            config.max_device_path_steps = max_device_path_steps;
             cuda::gpu_layout(config, dynamic_cast<const odgi::graph_t&>(graph), X, Y);
             return;
         }
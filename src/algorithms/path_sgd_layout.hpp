@@ -19,6 +19,12 @@
 #include "dirty_zipfian_int_distribution.h"
 #include "XoshiroCpp.hpp"
 #include "progress.hpp"
+#include "flat_path_index.hpp"
+#include "barnes_hut.hpp"
+#include "sgd_checkpoint.hpp"
+#include "numa.hpp"
+#include "huge_pages.hpp"
+#include "sgd_distributed.hpp"
 #ifdef USE_GPU
 #include "cuda/layout.h"
 #endif
@@ -29,6 +35,9 @@ namespace odgi {
         using namespace handlegraph;
 
 /// use SGD driven, by path guided, and partly zipfian distribution sampled pairwise distances to obtain a 1D linear layout of the graph that respects its topology
+/// with hogwild, the workers update a copy of the coordinates held as XY-interleaved relaxed floats, which is written back to X and Y at the end
+/// with flat_index_max_bytes > 0, steps are read from a flat_path_index_t instead of the XP index if it fits in that many bytes
+/// with a checkpoint file, X and Y are saved between iterations every checkpoint interval, and a resumed run starts from them
         void path_linear_sgd_layout(const PathHandleGraph &graph,
                                     const xp::XP &path_index,
                                     const std::vector<path_handle_t> &path_sgd_use_paths,
@@ -48,7 +57,11 @@ namespace odgi {
                                     const bool &snapshot,
                                     const std::string &snapshot_prefix,
                                     std::vector<std::atomic<double>> &X,
-                                    std::vector<std::atomic<double>> &Y);
+                                    std::vector<std::atomic<double>> &Y,
+                                    const bool &hogwild = false,
+                                    const uint64_t &flat_index_max_bytes = 0,
+                                    const double &repulsion = 0,
+                                    const sgd_checkpoint_config_t &checkpoint = sgd_checkpoint_config_t());
 
 /// our learning schedule
         std::vector<double> path_linear_sgd_layout_schedule(const double &w_min,
@@ -76,7 +89,9 @@ namespace odgi {
                                     const bool &snapshot,
                                     const std::string &snapshot_prefix,
                                     std::vector<std::atomic<double>> &X,
-                                    std::vector<std::atomic<double>> &Y);
+                                    std::vector<std::atomic<double>> &Y,
+                                    const int &gpu_count = 0,
+                                    const uint64_t &max_device_path_steps = 0);
 #endif
 /// single threaded and deterministic path guided 1D linear SGD
 /*
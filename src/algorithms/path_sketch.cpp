@@ -0,0 +1,142 @@
+#include "path_sketch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <iterator>
+
+namespace odgi {
+namespace algorithms {
+
+static uint64_t splitmix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+void path_sketch_t::add_node(const uint64_t &id, const uint64_t &length) {
+    const double scale = (double) std::numeric_limits<uint64_t>::max();
+    uint64_t state = splitmix64(id);
+    // the smallest of the remaining n uniform hashes is u + (1 - u) * (1 - r^(1/n)), drawn in order
+    double u = 0;
+    for (uint64_t j = 0; j < length && j < k; ++j) {
+        state = splitmix64(state);
+        const double r = ((state >> 11) + 0.5) / 9007199254740992.0;
+        u += (1.0 - u) * -std::expm1(std::log(r) / (double) (length - j));
+        const uint64_t h = (uint64_t) std::min(scale, u * scale);
+        if (hashes.size() < k) {
+            hashes.push_back(h);
+            std::push_heap(hashes.begin(), hashes.end());
+        } else if (h < hashes.front()) {
+            std::pop_heap(hashes.begin(), hashes.end());
+            hashes.back() = h;
+            std::push_heap(hashes.begin(), hashes.end());
+        } else {
+            // the later base pairs of the node only hash higher
+            break;
+        }
+    }
+}
+
+void path_sketch_t::merge(const path_sketch_t &other) {
+    std::vector<uint64_t> merged;
+    merged.reserve(k);
+    std::set_union(hashes.begin(), hashes.end(), other.hashes.begin(), other.hashes.end(), std::back_inserter(merged));
+    if (merged.size() > k) {
+        merged.resize(k);
+    }
+    hashes.swap(merged);
+}
+
+void path_sketch_t::finish(void) {
+    std::sort(hashes.begin(), hashes.end());
+    hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+}
+
+double path_sketch_t::jaccard(const path_sketch_t &other) const {
+    // the k smallest hashes of the union are a sample of it, count how many are in both
+    uint64_t in_union = 0;
+    uint64_t in_both = 0;
+    auto a = hashes.begin();
+    auto b = other.hashes.begin();
+    while (in_union < k && (a != hashes.end() || b != other.hashes.end())) {
+        if (b == other.hashes.end() || (a != hashes.end() && *a < *b)) {
+            ++a;
+        } else if (a == hashes.end() || *b < *a) {
+            ++b;
+        } else {
+            ++in_both;
+            ++a;
+            ++b;
+        }
+        ++in_union;
+    }
+    return in_union ? (double) in_both / (double) in_union : 0;
+}
+
+void path_sketch_t::serialize(std::ostream &out) const {
+    const uint64_t n = hashes.size();
+    out.write((const char *) &k, sizeof(k));
+    out.write((const char *) &n, sizeof(n));
+    out.write((const char *) hashes.data(), n * sizeof(uint64_t));
+}
+
+bool path_sketch_t::load(std::istream &in) {
+    uint64_t n = 0;
+    if (!in.read((char *) &k, sizeof(k)) || !in.read((char *) &n, sizeof(n)) || n > k) {
+        return false;
+    }
+    hashes.resize(n);
+    return n == 0 || (bool) in.read((char *) hashes.data(), n * sizeof(uint64_t));
+}
+
+static const char SKETCH_MAGIC[8] = {'O', 'D', 'G', 'I', 'S', 'K', 'C', 'H'};
+
+void write_sketches(std::ostream &out,
+                    const std::vector<std::string> &names,
+                    const std::vector<uint64_t> &lengths,
+                    const std::vector<path_sketch_t> &sketches) {
+    out.write(SKETCH_MAGIC, sizeof(SKETCH_MAGIC));
+    const uint64_t n = sketches.size();
+    out.write((const char *) &n, sizeof(n));
+    for (uint64_t i = 0; i < n; ++i) {
+        const uint64_t name_length = names[i].size();
+        out.write((const char *) &name_length, sizeof(name_length));
+        out.write(names[i].data(), name_length);
+        out.write((const char *) &lengths[i], sizeof(uint64_t));
+        sketches[i].serialize(out);
+    }
+}
+
+bool read_sketches(std::istream &in,
+                   std::vector<std::string> &names,
+                   std::vector<uint64_t> &lengths,
+                   std::vector<path_sketch_t> &sketches) {
+    char magic[sizeof(SKETCH_MAGIC)];
+    uint64_t n = 0;
+    if (!in.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), SKETCH_MAGIC)
+        || !in.read((char *) &n, sizeof(n))) {
+        return false;
+    }
+    for (uint64_t i = 0; i < n; ++i) {
+        uint64_t name_length = 0;
+        if (!in.read((char *) &name_length, sizeof(name_length))) {
+            return false;
+        }
+        std::string name(name_length, '\0');
+        uint64_t length = 0;
+        path_sketch_t sketch;
+        if ((name_length && !in.read(&name[0], name_length))
+            || !in.read((char *) &length, sizeof(length)) || !sketch.load(in)) {
+            return false;
+        }
+        names.push_back(name);
+        lengths.push_back(length);
+        sketches.push_back(sketch);
+    }
+    return true;
+}
+
+}
+}
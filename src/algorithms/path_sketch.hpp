@@ -0,0 +1,70 @@
+#pragma once
+
+/**
+ * \file path_sketch.hpp
+ *
+ * Defines bottom-k sketches of the node sets of paths, weighted by node length, to estimate their Jaccard similarity.
+ */
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <iostream>
+
+namespace odgi {
+namespace algorithms {
+
+/// A bottom-k sketch of the base pairs of a set of nodes: the k smallest of the hashes of all
+/// their base pairs, sorted. The base pairs of a node are hashed as a sequence of uniform order
+/// statistics seeded by its id, so that only the handful of them that can make it into the
+/// sketch are ever drawn, and a node counts with its length without walking its sequence.
+/// Sketches from graphs that share node ids and lengths can be compared.
+class path_sketch_t {
+public:
+
+    explicit path_sketch_t(const uint64_t &k = 0) : k(k) {}
+
+    /// Add the base pairs of a node, which must not have been added before
+    void add_node(const uint64_t &id, const uint64_t &length);
+
+    /// Add the base pairs of the other sketch
+    void merge(const path_sketch_t &other);
+
+    /// Sort the hashes, after the last add_node
+    void finish(void);
+
+    /// The estimated Jaccard similarity of the base pairs of the two sketches, which must have the same k
+    double jaccard(const path_sketch_t &other) const;
+
+    uint64_t get_k(void) const {
+        return k;
+    }
+
+    const std::vector<uint64_t> &get_hashes(void) const {
+        return hashes;
+    }
+
+    void serialize(std::ostream &out) const;
+
+    bool load(std::istream &in);
+
+private:
+    uint64_t k;
+    /// a max-heap while nodes are added, sorted once finished
+    std::vector<uint64_t> hashes;
+};
+
+/// Write named sketches, with the length of the base pairs each one was taken of
+void write_sketches(std::ostream &out,
+                    const std::vector<std::string> &names,
+                    const std::vector<uint64_t> &lengths,
+                    const std::vector<path_sketch_t> &sketches);
+
+/// Append the sketches written by write_sketches, false if the stream does not hold them
+bool read_sketches(std::istream &in,
+                   std::vector<std::string> &names,
+                   std::vector<uint64_t> &lengths,
+                   std::vector<path_sketch_t> &sketches);
+
+}
+}
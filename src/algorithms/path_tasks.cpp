@@ -0,0 +1,206 @@
+#include "path_tasks.hpp"
+
+#include <deque>
+#include <mutex>
+#include <numeric>
+#include <algorithm>
+#include <random>
+#include <cmath>
+#include <unordered_map>
+#include <handlegraph/util.hpp>
+#include <omp.h>
+
+namespace odgi {
+namespace algorithms {
+
+void run_tasks(const std::vector<uint64_t> &costs,
+               const uint64_t &nthreads,
+               const std::function<void(const uint64_t &, const uint64_t &)> &func) {
+    const uint64_t thread_count = std::max((uint64_t) 1, std::min(nthreads, (uint64_t) costs.size()));
+    if (thread_count == 1) {
+        for (uint64_t i = 0; i < costs.size(); ++i) {
+            func(i, 0);
+        }
+        return;
+    }
+    std::vector<uint64_t> order(costs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](const uint64_t &a, const uint64_t &b) {
+        return costs[a] > costs[b];
+    });
+    struct queue_t {
+        std::mutex mutex;
+        std::deque<uint64_t> tasks;
+    };
+    std::vector<queue_t> queues(thread_count);
+    for (uint64_t k = 0; k < order.size(); ++k) {
+        queues[k % thread_count].tasks.push_back(order[k]);
+    }
+#pragma omp parallel num_threads(thread_count)
+    {
+        const uint64_t tid = omp_get_thread_num();
+        while (true) {
+            bool found = false;
+            uint64_t task = 0;
+            {
+                std::lock_guard<std::mutex> guard(queues[tid].mutex);
+                if (!queues[tid].tasks.empty()) {
+                    task = queues[tid].tasks.front();
+                    queues[tid].tasks.pop_front();
+                    found = true;
+                }
+            }
+            // nb: no task is ever added, so once all queues were seen empty, we are done
+            for (uint64_t k = 1; !found && k < thread_count; ++k) {
+                queue_t &victim = queues[(tid + k) % thread_count];
+                std::lock_guard<std::mutex> guard(victim.mutex);
+                if (!victim.tasks.empty()) {
+                    task = victim.tasks.back();
+                    victim.tasks.pop_back();
+                    found = true;
+                }
+            }
+            if (!found) {
+                break;
+            }
+            func(task, tid);
+        }
+    }
+}
+
+std::vector<path_task_t> split_path_tasks(const PathHandleGraph &graph,
+                                          const std::vector<path_handle_t> &paths,
+                                          const uint64_t &nthreads,
+                                          const uint64_t &min_task_steps) {
+    std::vector<uint64_t> step_counts(paths.size());
+    uint64_t total_steps = 0;
+    for (uint64_t i = 0; i < paths.size(); ++i) {
+        step_counts[i] = graph.get_step_count(paths[i]);
+        total_steps += step_counts[i];
+    }
+    const uint64_t max_task_steps = std::max(std::max((uint64_t) 1, min_task_steps),
+                                             total_steps / (8 * std::max((uint64_t) 1, nthreads)));
+    std::vector<std::vector<path_task_t>> path_tasks(paths.size());
+    run_tasks(step_counts, nthreads, [&](const uint64_t &i, const uint64_t &) {
+        std::vector<path_task_t> &tasks = path_tasks[i];
+        path_task_t task;
+        task.path_index = i;
+        task.begin = graph.path_begin(paths[i]);
+        if (step_counts[i] <= max_task_steps) {
+            task.step_count = step_counts[i];
+            tasks.push_back(task);
+            return;
+        }
+        const step_handle_t end = graph.path_end(paths[i]);
+        uint64_t taken = 0;
+        for (step_handle_t step = task.begin; step != end; step = graph.get_next_step(step)) {
+            if (task.step_count == max_task_steps) {
+                tasks.push_back(task);
+                tasks.back().is_last = false;
+                task.begin = step;
+                task.step_count = 0;
+                task.is_first = false;
+            }
+            ++task.step_count;
+            // circular paths come back to their first step
+            if (++taken == step_counts[i]) {
+                break;
+            }
+        }
+        if (task.step_count > 0) {
+            tasks.push_back(task);
+        }
+    });
+    std::vector<path_task_t> tasks;
+    for (auto &t : path_tasks) {
+        tasks.insert(tasks.end(), t.begin(), t.end());
+    }
+    return tasks;
+}
+
+std::vector<path_task_t> sample_path_tasks(const PathHandleGraph &graph,
+                                           const std::vector<path_handle_t> &paths,
+                                           const double &fraction,
+                                           const uint64_t &nthreads,
+                                           const uint64_t &block_steps,
+                                           const uint64_t &min_blocks,
+                                           const uint64_t &seed) {
+    std::unordered_map<uint64_t, uint64_t> path_index;
+    uint64_t total_steps = 0;
+    for (uint64_t i = 0; i < paths.size(); ++i) {
+        path_index[as_integer(paths[i])] = i;
+        total_steps += graph.get_step_count(paths[i]);
+    }
+    std::vector<path_task_t> tasks;
+    if (total_steps == 0) {
+        return tasks;
+    }
+    // the nodes that have steps, with their cumulative step counts
+    std::vector<handle_t> handles;
+    std::vector<uint64_t> cumulative;
+    uint64_t all_steps = 0;
+    graph.for_each_handle([&](const handle_t &h) {
+        const uint64_t count = graph.get_step_count(h);
+        if (count > 0) {
+            all_steps += count;
+            handles.push_back(h);
+            cumulative.push_back(all_steps);
+        }
+    });
+    const uint64_t block = std::max((uint64_t) 1, block_steps);
+    const uint64_t count = std::max(min_blocks, (uint64_t) std::ceil(fraction * (double) total_steps / (double) block));
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<uint64_t> draw(0, all_steps - 1);
+    std::vector<step_handle_t> starts;
+    starts.reserve(count);
+    // the paths given may hold few of the steps, so stop after many draws in vain
+    uint64_t misses = 0;
+    while (starts.size() < count && misses < 64 * count) {
+        const uint64_t s = draw(rng);
+        const uint64_t k = std::upper_bound(cumulative.begin(), cumulative.end(), s) - cumulative.begin();
+        uint64_t rank = s - (k > 0 ? cumulative[k - 1] : 0);
+        step_handle_t drawn;
+        graph.for_each_step_on_handle(handles[k], [&](const step_handle_t &step) {
+            if (rank-- == 0) {
+                drawn = step;
+                return false;
+            }
+            return true;
+        });
+        if (path_index.count(as_integer(graph.get_path_handle_of_step(drawn)))) {
+            starts.push_back(drawn);
+        } else {
+            ++misses;
+        }
+    }
+    tasks.resize(starts.size());
+#pragma omp parallel for schedule(dynamic, 1) num_threads(std::max((uint64_t) 1, nthreads))
+    for (uint64_t t = 0; t < starts.size(); ++t) {
+        path_task_t &task = tasks[t];
+        const path_handle_t path = graph.get_path_handle_of_step(starts[t]);
+        task.path_index = path_index.at(as_integer(path));
+        task.begin = starts[t];
+        task.is_first = starts[t] == graph.path_begin(path);
+        const step_handle_t back = graph.path_back(path);
+        step_handle_t step = starts[t];
+        task.step_count = 1;
+        while (task.step_count < block && step != back) {
+            step = graph.get_next_step(step);
+            ++task.step_count;
+        }
+        task.is_last = step == back;
+    }
+    return tasks;
+}
+
+std::vector<uint64_t> path_task_costs(const std::vector<path_task_t> &tasks) {
+    std::vector<uint64_t> costs;
+    costs.reserve(tasks.size());
+    for (auto &task : tasks) {
+        costs.push_back(task.step_count);
+    }
+    return costs;
+}
+
+}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <handlegraph/path_handle_graph.hpp>
+
+namespace odgi {
+namespace algorithms {
+
+using namespace handlegraph;
+
+/// A run of consecutive steps of one of the paths given to split_path_tasks
+struct path_task_t {
+    uint64_t path_index = 0;  // index of the path in the given paths
+    step_handle_t begin;      // first step of the run
+    uint64_t step_count = 0;
+    bool is_first = true;     // does the run start its path?
+    bool is_last = true;      // does the run end its path?
+};
+
+/// Run func(task, thread) for each of the tasks, whose costs, e.g. their step counts, are given, on nthreads
+/// threads numbered from 0. The tasks are dealt to one queue per thread, the costliest first. A thread
+/// takes its tasks from the front of its own queue, and once it is empty, steals from the back of the
+/// other queues, so that a few long tasks don't leave most threads idle at the end.
+void run_tasks(const std::vector<uint64_t> &costs,
+               const uint64_t &nthreads,
+               const std::function<void(const uint64_t &, const uint64_t &)> &func);
+
+/// Cut the paths into runs of at most about 1/(8 * nthreads) of all their steps, and never less than
+/// min_task_steps steps, so that the long paths are shared by several threads. The tasks of a path
+/// follow each other in path order. The paths are walked in parallel to find the cuts.
+std::vector<path_task_t> split_path_tasks(const PathHandleGraph &graph,
+                                          const std::vector<path_handle_t> &paths,
+                                          const uint64_t &nthreads,
+                                          const uint64_t &min_task_steps = 4096);
+
+/// Runs of at most block_steps steps that start at steps drawn uniformly, with replacement, from all the
+/// steps of the paths, as many as to cover about the given fraction of the steps, and at least min_blocks
+/// of them where the paths have the steps. A step is drawn by picking a node by its step count and a step
+/// on it, so no path is walked to reach its step; steps of paths not given are drawn again. The draws
+/// follow from the seed, so a run is reproducible. The tasks are in no particular order.
+std::vector<path_task_t> sample_path_tasks(const PathHandleGraph &graph,
+                                           const std::vector<path_handle_t> &paths,
+                                           const double &fraction,
+                                           const uint64_t &nthreads,
+                                           const uint64_t &block_steps = 256,
+                                           const uint64_t &min_blocks = 32,
+                                           const uint64_t &seed = 9399220);
+
+/// The step counts of the tasks, to run them with run_tasks
+std::vector<uint64_t> path_task_costs(const std::vector<path_task_t> &tasks);
+
+}
+}
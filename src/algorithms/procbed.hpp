@@ -13,6 +13,7 @@
 #include "position.hpp"
 #include "split.hpp"
 #include "IITree.h"
+#include "readahead.hpp"
 #include <handlegraph/types.hpp>
 #include <handlegraph/iteratee.hpp>
 #include <handlegraph/util.hpp>
@@ -0,0 +1,165 @@
+#include "profile.hpp"
+#include "huge_pages.hpp"
+
+#include <mutex>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/resource.h>
+
+namespace odgi {
+
+namespace algorithms {
+
+namespace profile {
+
+    namespace {
+
+        struct phase_t {
+            std::string name;
+            uint64_t depth = 0;
+            double seconds = 0;
+            uint64_t rss = 0;
+            uint64_t peak_rss = 0;
+            bool done = false;
+        };
+
+        struct state_t {
+            std::atomic<bool> enabled{false};
+            bool as_json = false;
+            std::mutex mutex;
+            std::vector<phase_t> phases;
+            uint64_t depth = 0;
+        };
+
+        state_t& state(void) {
+            static state_t s;
+            return s;
+        }
+
+        void report_at_exit(void) {
+            auto& s = state();
+            report(std::cerr, s.as_json);
+        }
+
+        std::string json_escape(const std::string& s) {
+            std::string out;
+            for (const char c : s) {
+                if (c == '"' || c == '\\') out.push_back('\\');
+                out.push_back(c);
+            }
+            return out;
+        }
+
+    }
+
+    void enable(bool as_json) {
+        auto& s = state();
+        if (s.enabled) return;
+        s.as_json = as_json;
+        s.enabled = true;
+        std::atexit(report_at_exit);
+    }
+
+    bool enabled(void) {
+        return state().enabled.load(std::memory_order_relaxed);
+    }
+
+    uint64_t current_rss(void) {
+        std::ifstream statm("/proc/self/statm");
+        uint64_t size = 0, resident = 0;
+        if (statm >> size >> resident) {
+            return resident * (uint64_t)sysconf(_SC_PAGESIZE);
+        }
+        return peak_rss();
+    }
+
+    uint64_t peak_rss(void) {
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0) {
+            return 0;
+        }
+#ifdef __APPLE__
+        return (uint64_t)usage.ru_maxrss; // bytes
+#else
+        return (uint64_t)usage.ru_maxrss * 1024; // kilobytes
+#endif
+    }
+
+    void report(std::ostream& out, bool as_json) {
+        auto& s = state();
+        std::lock_guard<std::mutex> guard(s.mutex);
+        const double mb = 1024.0 * 1024.0;
+        if (as_json) {
+            out << "{\"phases\":[";
+            for (uint64_t i = 0; i < s.phases.size(); ++i) {
+                const auto& p = s.phases[i];
+                out << (i ? "," : "")
+                    << "{\"name\":\"" << json_escape(p.name) << "\""
+                    << ",\"depth\":" << p.depth
+                    << ",\"seconds\":" << p.seconds
+                    << ",\"rss_bytes\":" << p.rss
+                    << ",\"peak_rss_bytes\":" << p.peak_rss
+                    << ",\"complete\":" << (p.done ? "true" : "false") << "}";
+            }
+            out << "],\"peak_rss_bytes\":" << peak_rss();
+            if (huge_pages::enabled()) {
+                out << ",\"huge_pages_advised_bytes\":" << huge_pages::advised_bytes()
+                    << ",\"huge_pages_backed_bytes\":" << huge_pages::backed_bytes();
+            }
+            out << "}" << std::endl;
+        } else {
+            out << "[odgi::profile] " << std::left << std::setw(40) << "phase"
+                << std::right << std::setw(12) << "wall (s)"
+                << std::setw(12) << "rss (MB)"
+                << std::setw(16) << "peak rss (MB)" << std::endl;
+            for (const auto& p : s.phases) {
+                const std::string name = std::string(2 * p.depth, ' ') + p.name + (p.done ? "" : " (incomplete)");
+                out << "[odgi::profile] " << std::left << std::setw(40) << name
+                    << std::right << std::fixed << std::setprecision(3) << std::setw(12) << p.seconds
+                    << std::setprecision(1) << std::setw(12) << p.rss / mb
+                    << std::setw(16) << p.peak_rss / mb << std::endl;
+            }
+            out << "[odgi::profile] peak rss: " << std::fixed << std::setprecision(1) << peak_rss() / mb << " MB" << std::endl;
+            if (huge_pages::enabled()) {
+                out << "[odgi::profile] huge pages: " << huge_pages::advised_bytes() / mb << " MB advised, "
+                    << huge_pages::backed_bytes() / mb << " MB backed" << std::endl;
+            }
+            out.unsetf(std::ios_base::floatfield);
+        }
+    }
+
+    scope_t::scope_t(const std::string& name) {
+        if (!enabled()) return;
+        auto& s = state();
+        std::lock_guard<std::mutex> guard(s.mutex);
+        index = (int64_t)s.phases.size();
+        phase_t phase;
+        phase.name = name;
+        phase.depth = s.depth++;
+        s.phases.push_back(phase);
+        start_time = std::chrono::steady_clock::now();
+    }
+
+    scope_t::~scope_t(void) {
+        if (index < 0) return;
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+        const uint64_t rss = current_rss();
+        const uint64_t peak = peak_rss();
+        auto& s = state();
+        std::lock_guard<std::mutex> guard(s.mutex);
+        auto& phase = s.phases[index];
+        phase.seconds = elapsed.count();
+        phase.rss = rss;
+        phase.peak_rss = peak;
+        phase.done = true;
+        --s.depth;
+    }
+
+}
+
+}
+
+}
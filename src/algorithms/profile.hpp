@@ -0,0 +1,46 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+namespace odgi {
+
+namespace algorithms {
+
+/// Lightweight per-phase instrumentation.
+/// Phases are timed with scoped timers and record the resident set size when they end.
+/// Everything is a no-op until enable() is called, which `odgi --profile` does.
+namespace profile {
+
+    /// Start recording phases, and report them on stderr at exit, as JSON if asked
+    void enable(bool as_json);
+
+    bool enabled(void);
+
+    /// Current and peak resident set size of the process, in bytes
+    uint64_t current_rss(void);
+    uint64_t peak_rss(void);
+
+    /// Write the recorded phases, in the order they started
+    void report(std::ostream& out, bool as_json);
+
+    /// Times the enclosing scope as one phase, nested scopes are reported indented
+    class scope_t {
+    public:
+        explicit scope_t(const std::string& name);
+        ~scope_t(void);
+        scope_t(const scope_t& other) = delete;
+        scope_t& operator=(const scope_t& other) = delete;
+    private:
+        int64_t index = -1;
+        std::chrono::time_point<std::chrono::steady_clock> start_time;
+    };
+
+}
+
+}
+
+}
@@ -8,6 +8,13 @@
 #include <cmath>
 #include <iomanip>
 #include <sstream>
+#include <fstream>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/resource.h>
 
 namespace odgi {
 
@@ -15,34 +22,84 @@ namespace algorithms {
 
 namespace progress_meter {
 
+    /// Where the meters also write JSON lines, one per update, if the ODGI_TELEMETRY
+    /// environment variable names a file ("-" for stderr); nullptr otherwise.
+    inline std::ostream* telemetry_stream(void) {
+        static std::ofstream file;
+        static std::ostream* stream = [&](void) -> std::ostream* {
+            const char* target = std::getenv("ODGI_TELEMETRY");
+            if (target == nullptr || *target == '\0') {
+                return nullptr;
+            }
+            if (std::string(target) == "-") {
+                return &std::cerr;
+            }
+            file.open(target, std::ios::app);
+            return file ? &file : nullptr;
+        }();
+        return stream;
+    }
+
+    inline std::mutex& telemetry_mutex(void) {
+        static std::mutex m;
+        return m;
+    }
+
+    /// Resident set size of this process in bytes (the peak where the current size is not available)
+    inline uint64_t resident_set_size(void) {
+#ifdef __linux__
+        std::ifstream statm("/proc/self/statm");
+        uint64_t pages = 0, resident = 0;
+        if (statm >> pages >> resident) {
+            return resident * (uint64_t)sysconf(_SC_PAGESIZE);
+        }
+        return 0;
+#else
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return (uint64_t)usage.ru_maxrss; // bytes on macOS
+#endif
+    }
+
     class ProgressMeter {
     public:
         std::string banner;
         std::atomic<uint64_t> total;
-        std::atomic<uint64_t> completed;
         std::chrono::time_point<std::chrono::steady_clock> start_time;
         std::thread logger;
         ProgressMeter(uint64_t _total, const std::string& _banner)
                 : total(_total), banner(_banner) {
             start_time = std::chrono::steady_clock::now();
-            completed = 0;
+            for (auto& c : counters) {
+                c.value.store(0, std::memory_order_relaxed);
+            }
             logger = std::thread(
                     [&](void) {
                         do_print();
-                        auto last = 0;
-                        while (completed < total) {
-                            auto curr = completed - last;
-                            if (curr > 0) {
+                        uint64_t last = 0;
+                        std::unique_lock<std::mutex> lock(wake_mutex);
+                        while (!finished && get_completed() < total) {
+                            wake.wait_for(lock, std::chrono::milliseconds(500));
+                            const uint64_t curr = get_completed();
+                            if (!finished && curr > last) {
                                 do_print();
-                                last = completed;
+                                last = curr;
                             }
-                            std::this_thread::sleep_for(std::chrono::milliseconds(500));
                         }
                     });
         };
+        /// Sum of the per-thread counters
+        uint64_t get_completed(void) const {
+            uint64_t sum = 0;
+            for (auto& c : counters) {
+                sum += c.value.load(std::memory_order_relaxed);
+            }
+            return std::min(sum, total.load());
+        }
         void do_print(void) {
             auto curr = std::chrono::steady_clock::now();
             std::chrono::duration<double> elapsed_seconds = curr-start_time;
+            const uint64_t completed = get_completed();
             double rate = completed / elapsed_seconds.count();
             double seconds_to_completion = (completed > 0 ? (total - completed) / rate : 0);
             std::cerr << "\r" << banner << " "
@@ -56,9 +113,15 @@ namespace progress_meter {
                       << std::setw(4) << std::scientific << rate << " bp/s "
                       << "elapsed: " << print_time(elapsed_seconds.count()) << " "
                       << "remain: " << print_time(seconds_to_completion);
+            write_telemetry(completed, elapsed_seconds.count(), rate, seconds_to_completion);
         }
         void finish(void) {
-            completed.store(total);
+            {
+                std::lock_guard<std::mutex> lock(wake_mutex);
+                finished = true;
+                counters[0].value.fetch_add(total, std::memory_order_relaxed);
+            }
+            wake.notify_all();
             logger.join();
             do_print();
             std::cerr << std::endl;
@@ -84,8 +147,52 @@ namespace progress_meter {
             seconds = ((((int)input_seconds % cseconds_in_day) % cseconds_in_hour) % cseconds_in_minute) / cseconds; // + (input_seconds - std::floor(input_seconds));
             //std::cerr << input_seconds << " seconds is " << days << " days, " << hours << " hours, " << minutes << " minutes, and " << seconds << " seconds." << std::endl;
         }
+        /// Add to the counter of the calling thread, which only it and the logger touch
         void increment(const uint64_t& incr) {
-            completed += incr;
+            counters[thread_slot()].value.fetch_add(incr, std::memory_order_relaxed);
+        }
+    private:
+        static const uint64_t counter_slots = 64;
+        struct alignas(64) counter_t {
+            std::atomic<uint64_t> value;
+        };
+        counter_t counters[counter_slots];
+        bool finished = false;
+        std::mutex wake_mutex;
+        std::condition_variable wake;
+        static uint64_t thread_slot(void) {
+            static std::atomic<uint64_t> next_slot(0);
+            thread_local const uint64_t slot = next_slot.fetch_add(1, std::memory_order_relaxed) % counter_slots;
+            return slot;
+        }
+        void write_telemetry(uint64_t completed, double elapsed, double rate, double remain) {
+            std::ostream* out = telemetry_stream();
+            if (out == nullptr) {
+                return;
+            }
+            std::string name;
+            for (auto c : banner) {
+                if (c == '"' || c == '\\') {
+                    name.push_back('\\');
+                }
+                name.push_back(c);
+            }
+            const auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count();
+            std::stringstream line;
+            line << std::setprecision(6)
+                 << "{\"time_ms\":" << now
+                 << ",\"banner\":\"" << name << "\""
+                 << ",\"completed\":" << completed
+                 << ",\"total\":" << total
+                 << ",\"elapsed_s\":" << elapsed
+                 << ",\"rate\":" << rate
+                 << ",\"remain_s\":" << remain
+                 << ",\"rss_bytes\":" << resident_set_size()
+                 << ",\"finished\":" << (finished ? "true" : "false")
+                 << "}\n";
+            std::lock_guard<std::mutex> lock(telemetry_mutex());
+            *out << line.str() << std::flush;
         }
     };
 
@@ -1,5 +1,8 @@
 #include "prune.hpp"
 
+#include <algorithm>
+#include <atomic_bitvector.hpp>
+
 namespace odgi {
 
 namespace algorithms {
@@ -7,96 +10,92 @@ namespace algorithms {
 std::vector<edge_t> find_edges_to_prune(const HandleGraph& graph,
                                         size_t k, size_t edge_max,
                                         int n_threads) {
-    // for each position on the forward and reverse of the graph
-    //unordered_set<edge_t> edges_to_prune;
-    std::vector<std::vector<edge_t> > edges_to_prune;
-    edges_to_prune.resize(n_threads);
+    // We walk up to k bases on from the end of each oriented handle. Past a handle with more than
+    // one next handle we count a furcation, and once we took edge_max of them, all edges leaving
+    // the next such handle are pruned. Which edges a walk prunes only depends on the handle it is
+    // at, the bases it has left and its furcations, and a walk with more bases left prunes all
+    // that one with fewer would. So for each (handle, furcations) we remember the most bases any
+    // walk had left there, and drop the walks that arrive with no more, which keeps the walks
+    // around hubs from being repeated for each of their many ways in.
+    const nid_t min_id = graph.get_node_count() ? graph.min_node_id() : 0;
+    const uint64_t handle_count = graph.get_node_count() ? 2 * (graph.max_node_id() - min_id + 1) : 0;
+    auto handle_rank = [&](const handle_t& h) {
+        return 2 * (graph.get_id(h) - min_id) + graph.get_is_reverse(h);
+    };
+    const uint64_t fork_levels = edge_max + 1;
+    std::vector<uint32_t> best_remaining(handle_count * fork_levels, 0);
+    // the handles whose outgoing edges are all pruned
+    atomicbitvector::atomic_bv_t pruned(handle_count);
+
+    // claim the walk at h, false if one with as many bases left was already there
+    auto claim = [&](const handle_t& h, const uint64_t& forks, const uint32_t& remaining) {
+        uint32_t* best = &best_remaining[handle_rank(h) * fork_levels + forks];
+        uint32_t seen = __atomic_load_n(best, __ATOMIC_RELAXED);
+        while (seen < remaining) {
+            if (__atomic_compare_exchange_n(best, &seen, remaining, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    struct prune_walk_t {
+        handle_t curr; /// the handle whose end we are at
+        uint32_t remaining; /// the bases we may still walk
+        uint16_t forks; /// how many branching edge crossings we took to get here
+    };
+
     graph.for_each_handle([&](const handle_t& h) {
+            std::vector<prune_walk_t> todo;
             // for the forward and reverse of this handle
-            // walk k bases from the end, so that any kmer starting on the node will be represented in the tree we build
             for (auto handle_is_rev : { false, true }) {
-                //cerr << "###########################################" << endl;
-                handle_t handle = handle_is_rev ? graph.flip(h) : h;
-                std::list<walk_t> walks;
-                // for each position in the node, set up a kmer with that start position and the node end or kmer length as the end position
-                // determine next positions
-                nid_t handle_id = graph.get_id(handle);
-                size_t handle_length = graph.get_length(handle);
-                std::string handle_seq = graph.get_sequence(handle);
-                for (size_t i = 0; i < handle_length;  ++i) {
-                    pos_t begin = make_pos_t(handle_id, handle_is_rev, handle_length);
-                    pos_t end = make_pos_t(handle_id, handle_is_rev, std::min(handle_length, i+k));
-                    walk_t walk = walk_t(offset(end)-offset(begin), begin, end, handle, 0);
-                    if (walk.length < k) {
-                        // are we branching over more than one edge?
-                        size_t next_count = 0;
-                        graph.follow_edges(walk.curr, false, [&](const handle_t& next) { ++next_count; return next_count <= 1; });
-                        graph.follow_edges(walk.curr, false, [&](const handle_t& next) {
-                                if (next_count > 1 && edge_max == walk.forks) { // our next step takes us over the max
-                                    int tid = omp_get_thread_num();
-                                    edges_to_prune[tid].push_back(graph.edge_handle(walk.curr, next));
-                                } else {
-                                    walks.push_back(walk);
-                                    auto& todo = walks.back();
-                                    todo.curr = next;
-                                    if (next_count > 1) {
-                                        ++todo.forks;
-                                    }
-                                }
-                            });
-                    } else {
-                        walks.push_back(walk);
-                    }
+                const handle_t handle = handle_is_rev ? graph.flip(h) : h;
+                if (claim(handle, 0, k)) {
+                    todo.push_back({handle, (uint32_t)k, 0});
                 }
-                // now expand the kmers until they reach k
-                while (!walks.empty()) {
-                    // first we check which ones have reached length k in the current handle; for each of these we run lambda and remove them from our list
-                    auto walks_end = walks.end();
-                    for (std::list<walk_t>::iterator q = walks.begin(); q != walks_end; ++q) {
-                        auto& walk = *q;
-                        // did we reach our target length?
-                        if (walk.length >= k) {
-                            q = walks.erase(q);
-                        } else {
-                            nid_t curr_id = graph.get_id(walk.curr);
-                            size_t curr_length = graph.get_length(walk.curr);
-                            bool curr_is_rev = graph.get_is_reverse(walk.curr);
-                            size_t take = std::min(curr_length, k-walk.length);
-                            walk.end = make_pos_t(curr_id, curr_is_rev, take);
-                            walk.length += take;
-                            if (walk.length < k) {
-                                // if not, we need to expand through the node then follow on
-                                size_t next_count = 0;
-                                graph.follow_edges(walk.curr, false, [&](const handle_t& next) { ++next_count; return next_count <= 1; });
-                                graph.follow_edges(walk.curr, false, [&](const handle_t& next) {
-                                        if (next_count > 1 && edge_max == walk.forks) { // our next step takes us over the max
-                                            int tid = omp_get_thread_num();
-                                            edges_to_prune[tid].push_back(graph.edge_handle(walk.curr, next));
-                                        } else {
-                                            walks.push_back(walk);
-                                            auto& todo = walks.back();
-                                            todo.curr = next;
-                                            if (next_count > 1) {
-                                                ++todo.forks;
-                                            }
-                                        }
-                                    });
-                                q = walks.erase(q);
-                            } else {
-                                // nothing, we'll remove it next time around
-                            }
-                        }
+                while (!todo.empty()) {
+                    const prune_walk_t walk = todo.back();
+                    todo.pop_back();
+                    // are we branching over more than one edge?
+                    size_t next_count = 0;
+                    graph.follow_edges(walk.curr, false, [&](const handle_t& next) { ++next_count; return next_count <= 1; });
+                    if (next_count > 1 && edge_max == walk.forks) {
+                        // our next step takes us over the max
+                        pruned.set(handle_rank(walk.curr));
+                        continue;
                     }
+                    const uint16_t forks = walk.forks + (next_count > 1);
+                    graph.follow_edges(walk.curr, false, [&](const handle_t& next) {
+                            const size_t length = graph.get_length(next);
+                            if (length < walk.remaining && claim(next, forks, walk.remaining - length)) {
+                                todo.push_back({next, (uint32_t)(walk.remaining - length), forks});
+                            }
+                        });
                 }
             }
         }, true);
+
+    std::vector<std::vector<edge_t>> edges_to_prune(n_threads);
+#pragma omp parallel for schedule(static) num_threads(n_threads)
+    for (uint64_t i = 0; i < handle_count; ++i) {
+        if (pruned.test(i)) {
+            const nid_t id = min_id + i / 2;
+            const handle_t curr = graph.get_handle(id, i % 2);
+            auto& edges = edges_to_prune[omp_get_thread_num()];
+            graph.follow_edges(curr, false, [&](const handle_t& next) {
+                    edges.push_back(graph.edge_handle(curr, next));
+                });
+        }
+    }
     uint64_t total_edges = 0;
     for (auto& v : edges_to_prune) total_edges += v.size();
     std::vector<edge_t> merged; merged.reserve(total_edges);
     for (auto& v : edges_to_prune) {
         merged.insert(merged.end(), v.begin(), v.end());
     }
-    // duplicates are assumed to be dealt with externally
+    // an edge is found from both of its ends if those are both pruned
+    std::sort(merged.begin(), merged.end());
+    merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
     return merged;
 }
 
@@ -35,7 +35,9 @@ struct walk_t {
     uint16_t length; /// how far we've been
 };
 
-/// Iterate over all the walks up to length k, adding edges which 
+/// Iterate over all the walks up to length k from the end of each handle, returning the edges which
+/// would take a walk over more than edge_max furcations, without duplicates. The walks reaching a
+/// handle with no more bases left than an earlier walk with the same furcations are not repeated.
 std::vector<edge_t> find_edges_to_prune(const HandleGraph& graph, size_t k, size_t edge_max, int n_threads);
 
 }
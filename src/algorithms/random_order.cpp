@@ -1,17 +1,45 @@
 #include "random_order.hpp"
+#include "ips4o.hpp"
+#include <omp.h>
 
 namespace odgi {
 
 namespace algorithms {
 
-std::vector<handle_t> random_order(const HandleGraph& graph) {
+std::vector<handle_t> random_order(const HandleGraph& graph, const uint64_t& nthreads) {
     std::vector<handle_t> order;
+    order.reserve(graph.get_node_count());
     graph.for_each_handle([&order](const handle_t& handle) {
             order.push_back(handle);
         });
     std::random_device dev;
-    std::mt19937 rng(dev());
-    std::shuffle(order.begin(), order.end(), rng);
+    if (nthreads <= 1) {
+        std::mt19937 rng(dev());
+        std::shuffle(order.begin(), order.end(), rng);
+        return order;
+    }
+    // draw a random key for each handle, each thread from its own generator, and sort by the keys
+    std::vector<std::pair<uint64_t, handle_t>> keyed(order.size());
+    std::vector<uint64_t> seeds(nthreads);
+    for (auto& seed : seeds) {
+        seed = ((uint64_t)dev() << 32) | dev();
+    }
+#pragma omp parallel num_threads(nthreads)
+    {
+        std::mt19937_64 rng(seeds[omp_get_thread_num()]);
+#pragma omp for schedule(static)
+        for (uint64_t i = 0; i < order.size(); ++i) {
+            keyed[i] = std::make_pair(rng(), order[i]);
+        }
+    }
+    ips4o::parallel::sort(keyed.begin(), keyed.end(),
+                          [](const std::pair<uint64_t, handle_t>& a, const std::pair<uint64_t, handle_t>& b) {
+                              return a.first < b.first;
+                          }, nthreads);
+#pragma omp parallel for schedule(static) num_threads(nthreads)
+    for (uint64_t i = 0; i < order.size(); ++i) {
+        order[i] = keyed[i].second;
+    }
     return order;
 }
 
@@ -11,8 +11,8 @@ namespace algorithms {
 
 using namespace handlegraph;
 
-// provide a randomized order for the graph
-std::vector<handle_t> random_order(const HandleGraph& graph);
+// provide a randomized order for the graph, shuffled on nthreads threads
+std::vector<handle_t> random_order(const HandleGraph& graph, const uint64_t& nthreads = 1);
 
 }
 }
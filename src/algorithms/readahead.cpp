@@ -0,0 +1,189 @@
+#include "readahead.hpp"
+
+#include <cstdlib>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace odgi {
+namespace algorithms {
+
+namespace {
+    // blocks aligned to pages, as some network and direct-I/O file systems prefer
+    const uint64_t block_alignment = 4096;
+}
+
+readahead_streambuf_t::readahead_streambuf_t(const uint64_t& block_bytes)
+    : block_bytes((std::max(block_bytes, block_alignment) + block_alignment - 1) / block_alignment * block_alignment) {
+    setg(nullptr, nullptr, nullptr);
+}
+
+readahead_streambuf_t::~readahead_streambuf_t(void) {
+    close();
+}
+
+bool readahead_streambuf_t::open(const std::string& filename) {
+    close();
+    fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    for (auto& block : blocks) {
+        block = (char*) std::aligned_alloc(block_alignment, block_bytes);
+    }
+    restart(0);
+    return true;
+}
+
+bool readahead_streambuf_t::is_open(void) const {
+    return fd != -1;
+}
+
+void readahead_streambuf_t::close(void) {
+    wait();
+    if (fd != -1) {
+        ::close(fd);
+        fd = -1;
+    }
+    for (auto& block : blocks) {
+        std::free(block);
+        block = nullptr;
+    }
+    setg(nullptr, nullptr, nullptr);
+}
+
+void readahead_streambuf_t::wait(void) {
+    if (reader.joinable()) {
+        reader.join();
+    }
+}
+
+void readahead_streambuf_t::restart(const uint64_t& offset) {
+    wait();
+    current = 0;
+    current_offset = offset;
+    next_offset = offset;
+    filled[0] = 0;
+    setg(blocks[0], blocks[0], blocks[0]);
+    // the first block is read ahead like any other, so opening does not wait on the file
+    read_ahead(current ^ 1, offset);
+}
+
+void readahead_streambuf_t::read_ahead(const int& k, const uint64_t& offset) {
+    reader = std::thread([this, k, offset](void) {
+        int64_t n = 0;
+        while ((uint64_t) n < block_bytes) {
+            const ssize_t r = pread(fd, blocks[k] + n, block_bytes - n, offset + n);
+            if (r <= 0) {
+                break;
+            }
+            n += r;
+        }
+        filled[k] = n;
+    });
+}
+
+readahead_streambuf_t::int_type readahead_streambuf_t::underflow(void) {
+    if (gptr() < egptr()) {
+        return traits_type::to_int_type(*gptr());
+    }
+    if (fd == -1 || !reader.joinable()) {
+        return traits_type::eof();
+    }
+    wait();
+    current ^= 1;
+    current_offset = next_offset;
+    const int64_t n = filled[current];
+    setg(blocks[current], blocks[current], blocks[current] + n);
+    if (n <= 0) {
+        return traits_type::eof();
+    }
+    next_offset = current_offset + n;
+    // a short block is the end of the file, only a full one is followed by another
+    if ((uint64_t) n == block_bytes) {
+        read_ahead(current ^ 1, next_offset);
+    }
+    return traits_type::to_int_type(*gptr());
+}
+
+readahead_streambuf_t::pos_type readahead_streambuf_t::seekoff(off_type off, std::ios_base::seekdir dir,
+                                                               std::ios_base::openmode which) {
+    if (fd == -1 || !(which & std::ios_base::in)) {
+        return pos_type(off_type(-1));
+    }
+    off_type target = off;
+    if (dir == std::ios_base::cur) {
+        target += current_offset + (gptr() - eback());
+    } else if (dir == std::ios_base::end) {
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            return pos_type(off_type(-1));
+        }
+        target += st.st_size;
+    }
+    return seekpos(pos_type(target), which);
+}
+
+readahead_streambuf_t::pos_type readahead_streambuf_t::seekpos(pos_type pos, std::ios_base::openmode which) {
+    const off_type target = pos;
+    if (fd == -1 || !(which & std::ios_base::in) || target < 0) {
+        return pos_type(off_type(-1));
+    }
+    if ((uint64_t) target >= current_offset && (uint64_t) target <= current_offset + (egptr() - eback())) {
+        // tellg, and seeks back within the block, keep what was read
+        setg(eback(), eback() + (target - current_offset), egptr());
+    } else {
+        restart(target);
+    }
+    return pos;
+}
+
+std::streamsize readahead_streambuf_t::showmanyc(void) {
+    return egptr() - gptr();
+}
+
+readahead_ifstream_t::readahead_ifstream_t(void) : std::istream(nullptr) {
+    rdbuf(&buf);
+    setstate(std::ios_base::failbit);
+}
+
+readahead_ifstream_t::readahead_ifstream_t(const std::string& filename) : std::istream(nullptr) {
+    rdbuf(&buf);
+    open(filename);
+}
+
+void readahead_ifstream_t::open(const std::string& filename) {
+    if (buf.open(filename)) {
+        clear();
+    } else {
+        setstate(std::ios_base::failbit);
+    }
+}
+
+bool readahead_ifstream_t::is_open(void) const {
+    return buf.is_open();
+}
+
+void readahead_ifstream_t::close(void) {
+    buf.close();
+}
+
+void advise_sequential(const void* data, const size_t& bytes) {
+    if (data == nullptr || bytes == 0) {
+        return;
+    }
+    // madvise wants a page-aligned start
+    const uintptr_t page = sysconf(_SC_PAGESIZE);
+    const uintptr_t begin = (uintptr_t) data / page * page;
+    const size_t length = (uintptr_t) data + bytes - begin;
+    madvise((void*) begin, length, MADV_SEQUENTIAL);
+    madvise((void*) begin, length, MADV_WILLNEED);
+}
+
+}
+}
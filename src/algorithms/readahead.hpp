@@ -0,0 +1,84 @@
+#pragma once
+
+/**
+ * \file readahead.hpp
+ *
+ * Defines an input stream that reads its file in large blocks on a background thread, one block ahead
+ * of the decoding, so that the latency of slow or network file systems overlaps with the work on the
+ * data already read.
+ */
+
+#include <string>
+#include <istream>
+#include <streambuf>
+#include <thread>
+#include <cstdint>
+#include <cstddef>
+
+namespace odgi {
+namespace algorithms {
+
+/// A stream buffer over a file, double-buffered: while one block is decoded, the next one is read
+/// with pread into the other. Seeks within the current block are free; others drop the block read
+/// ahead and start again at the new offset.
+class readahead_streambuf_t : public std::streambuf {
+public:
+    static constexpr uint64_t default_block_bytes = 1ULL << 22;
+
+    explicit readahead_streambuf_t(const uint64_t& block_bytes = default_block_bytes);
+    ~readahead_streambuf_t(void);
+
+    readahead_streambuf_t(const readahead_streambuf_t& other) = delete;
+    readahead_streambuf_t& operator=(const readahead_streambuf_t& other) = delete;
+
+    /// Open the file and start reading its first block, false if it cannot be opened
+    bool open(const std::string& filename);
+    bool is_open(void) const;
+    void close(void);
+
+protected:
+    int_type underflow(void) override;
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+    std::streamsize showmanyc(void) override;
+
+private:
+    /// Drop the blocks and start reading ahead at the given offset
+    void restart(const uint64_t& offset);
+    /// Read the block at the given offset into blocks[k] on the reader thread
+    void read_ahead(const int& k, const uint64_t& offset);
+    /// Wait for the block being read ahead, if any
+    void wait(void);
+
+    const uint64_t block_bytes;
+    int fd = -1;
+    char* blocks[2] = {nullptr, nullptr};
+    int64_t filled[2] = {0, 0};
+    // the block being decoded, and the file offset of its first byte
+    int current = 0;
+    uint64_t current_offset = 0;
+    // the file offset of the block being read ahead into the other one
+    uint64_t next_offset = 0;
+    std::thread reader;
+};
+
+/// An input file stream reading ahead, for the loaders of graphs and of BED, GFF and other text inputs
+class readahead_ifstream_t : public std::istream {
+public:
+    readahead_ifstream_t(void);
+    explicit readahead_ifstream_t(const std::string& filename);
+
+    void open(const std::string& filename);
+    bool is_open(void) const;
+    void close(void);
+
+private:
+    readahead_streambuf_t buf;
+};
+
+/// Tell the kernel that a mapped file is about to be read through from start to end, so that it
+/// reads ahead of the page faults
+void advise_sequential(const void* data, const size_t& bytes);
+
+}
+}
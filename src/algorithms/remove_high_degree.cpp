@@ -1,4 +1,5 @@
 #include "remove_high_degree.hpp"
+#include <omp.h>
 
 namespace odgi {
 namespace algorithms {
@@ -25,5 +26,51 @@ void remove_high_degree_nodes(DeletableHandleGraph& g, int max_degree) {
     }
 }
 
+std::vector<uint64_t> node_degrees(const graph_t& g, const uint64_t& nthreads) {
+    // graph_t handles are node ranks, so the degrees go in a dense array
+    uint64_t ranks = 0;
+    g.for_each_handle([&](const handle_t& h) {
+            ranks = std::max(ranks, (uint64_t)number_bool_packing::unpack_number(h) + 1);
+        });
+    std::vector<uint64_t> degrees(ranks, 0);
+#pragma omp parallel for schedule(dynamic, 4096) num_threads(nthreads)
+    for (uint64_t rank = 0; rank < ranks; ++rank) {
+        const handle_t h = number_bool_packing::pack(rank, false);
+        if (g.has_node(g.get_id(h))) {
+            degrees[rank] = g.get_degree(h, false) + g.get_degree(h, true);
+        }
+    }
+    return degrees;
+}
+
+std::vector<uint64_t> degree_histogram(const std::vector<uint64_t>& degrees, const graph_t& g) {
+    std::vector<uint64_t> histogram;
+    g.for_each_handle([&](const handle_t& h) {
+            const uint64_t d = degrees[number_bool_packing::unpack_number(h)];
+            if (d >= histogram.size()) {
+                histogram.resize(d + 1, 0);
+            }
+            ++histogram[d];
+        });
+    return histogram;
+}
+
+uint64_t remove_high_degree_nodes(graph_t& g, const uint64_t& max_degree, const uint64_t& nthreads,
+                                  std::vector<uint64_t>* histogram) {
+    const std::vector<uint64_t> degrees = node_degrees(g, nthreads);
+    if (histogram) {
+        *histogram = degree_histogram(degrees, g);
+    }
+    std::vector<handle_t> to_remove;
+    g.for_each_handle([&](const handle_t& h) {
+            if (degrees[number_bool_packing::unpack_number(h)] > max_degree) {
+                to_remove.push_back(h);
+            }
+        });
+    // each surviving neighbor drops its edges to the removed nodes in one rewrite
+    g.destroy_handles(to_remove);
+    return to_remove.size();
+}
+
 }
 }
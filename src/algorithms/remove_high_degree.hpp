@@ -10,6 +10,7 @@
 #include <handlegraph/deletable_handle_graph.hpp>
 #include <vector>
 #include <iostream>
+#include "odgi.hpp"
 
 namespace odgi {
 namespace algorithms {
@@ -18,6 +19,17 @@ using namespace handlegraph;
 
 void remove_high_degree_nodes(DeletableHandleGraph& g, int max_degree);
 
+/// The degree of every node, the edges on both of its sides, computed in parallel and indexed by node rank
+std::vector<uint64_t> node_degrees(const graph_t& g, const uint64_t& nthreads);
+
+/// How many nodes have each degree: entry d counts the nodes of degree d
+std::vector<uint64_t> degree_histogram(const std::vector<uint64_t>& degrees, const graph_t& g);
+
+/// Remove the nodes of degree above max_degree in one batch, returning how many were removed.
+/// If given, the degree histogram of the graph before the removal is stored in histogram.
+uint64_t remove_high_degree_nodes(graph_t& g, const uint64_t& max_degree, const uint64_t& nthreads,
+                                  std::vector<uint64_t>* histogram = nullptr);
+
 }
 }
 
@@ -27,23 +27,30 @@ std::vector<std::pair<path_handle_t, handle_t>> isolated_path_handles(
                     path_handle_t path = graph.get_path_handle_of_step(single_step);
                     if (single_step == graph.path_begin(path)
                         && single_step == graph.path_back(path)) {
+#pragma omp critical (isolated_path_handles)
                         isolated.push_back(std::make_pair(path, handle));
                     }
                 }
             }
-        });
+        }, true);
+    // keep the graph order regardless of the threads
+    std::sort(isolated.begin(), isolated.end(),
+              [](const std::pair<path_handle_t, handle_t>& a, const std::pair<path_handle_t, handle_t>& b) {
+                  return as_integer(a.second) < as_integer(b.second);
+              });
     return isolated;
 }
 
 uint64_t remove_isolated_paths(
-    MutablePathDeletableHandleGraph& graph) {
+    graph_t& graph) {
     auto isolated = isolated_path_handles(graph);
+    std::vector<handle_t> handles;
+    handles.reserve(isolated.size());
     for (auto& p : isolated) {
-        auto& path = p.first;
-        auto& handle = p.second;
-        graph.destroy_path(path);
-        graph.destroy_handle(handle);
+        graph.destroy_path(p.first);
+        handles.push_back(p.second);
     }
+    graph.destroy_handles(handles);
     return isolated.size();
 }
 
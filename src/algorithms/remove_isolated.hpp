@@ -18,7 +18,7 @@ std::vector<std::pair<path_handle_t, handle_t>> isolated_path_handles(
     const MutablePathDeletableHandleGraph& graph);
 
 uint64_t remove_isolated_paths(
-    MutablePathDeletableHandleGraph& graph);
+    graph_t& graph);
 
 }
 
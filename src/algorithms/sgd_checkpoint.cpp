@@ -0,0 +1,127 @@
+#include "sgd_checkpoint.hpp"
+#include <fstream>
+#include <iostream>
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+namespace odgi {
+namespace algorithms {
+
+namespace {
+
+const char sgd_checkpoint_magic[8] = {'o', 'd', 'g', 'i', 's', 'c', 'k', '1'};
+
+}
+
+void write_sgd_checkpoint(const std::string& filename, const sgd_checkpoint_t& checkpoint) {
+    const std::string tmp_filename = filename + ".tmp";
+    {
+        std::ofstream out(tmp_filename.c_str(), std::ios::binary);
+        const uint64_t rng_count = checkpoint.rng_states.size();
+        const uint64_t coord_count = checkpoint.coords.size();
+        out.write(sgd_checkpoint_magic, sizeof(sgd_checkpoint_magic));
+        out.write((const char*)&checkpoint.dimensions, sizeof(uint64_t));
+        out.write((const char*)&checkpoint.node_count, sizeof(uint64_t));
+        out.write((const char*)&checkpoint.iter_max, sizeof(uint64_t));
+        out.write((const char*)&checkpoint.iteration, sizeof(uint64_t));
+        out.write((const char*)&checkpoint.plateau_iterations, sizeof(uint64_t));
+        out.write((const char*)&checkpoint.last_stress, sizeof(double));
+        out.write((const char*)&rng_count, sizeof(uint64_t));
+        out.write((const char*)checkpoint.rng_states.data(), rng_count * sizeof(std::array<uint64_t, 4>));
+        out.write((const char*)&coord_count, sizeof(uint64_t));
+        out.write((const char*)checkpoint.coords.data(), coord_count * sizeof(double));
+        out.close();
+        if (!out) {
+            throw std::runtime_error("[odgi::algorithms::sgd_checkpoint] error: cannot write " + tmp_filename);
+        }
+    }
+    if (std::rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+        throw std::runtime_error("[odgi::algorithms::sgd_checkpoint] error: cannot rename " + tmp_filename
+                                 + " to " + filename + ": " + std::strerror(errno));
+    }
+}
+
+bool read_sgd_checkpoint(const std::string& filename, sgd_checkpoint_t& checkpoint) {
+    std::ifstream in(filename.c_str(), std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    char magic[sizeof(sgd_checkpoint_magic)];
+    uint64_t rng_count = 0;
+    in.read(magic, sizeof(magic));
+    in.read((char*)&checkpoint.dimensions, sizeof(uint64_t));
+    in.read((char*)&checkpoint.node_count, sizeof(uint64_t));
+    in.read((char*)&checkpoint.iter_max, sizeof(uint64_t));
+    in.read((char*)&checkpoint.iteration, sizeof(uint64_t));
+    in.read((char*)&checkpoint.plateau_iterations, sizeof(uint64_t));
+    in.read((char*)&checkpoint.last_stress, sizeof(double));
+    in.read((char*)&rng_count, sizeof(uint64_t));
+    if (!in || std::memcmp(magic, sgd_checkpoint_magic, sizeof(magic)) != 0) {
+        throw std::runtime_error("[odgi::algorithms::sgd_checkpoint] error: " + filename + " is not a path guided SGD checkpoint");
+    }
+    checkpoint.rng_states.resize(rng_count);
+    in.read((char*)checkpoint.rng_states.data(), rng_count * sizeof(std::array<uint64_t, 4>));
+    uint64_t coord_count = 0;
+    in.read((char*)&coord_count, sizeof(uint64_t));
+    if (!in || coord_count != checkpoint.dimensions * checkpoint.node_count) {
+        throw std::runtime_error("[odgi::algorithms::sgd_checkpoint] error: " + filename + " is truncated");
+    }
+    checkpoint.coords.resize(coord_count);
+    in.read((char*)checkpoint.coords.data(), coord_count * sizeof(double));
+    if ((uint64_t)in.gcount() != coord_count * sizeof(double)) {
+        throw std::runtime_error("[odgi::algorithms::sgd_checkpoint] error: " + filename + " is truncated");
+    }
+    return true;
+}
+
+sgd_checkpointer_t::sgd_checkpointer_t(const sgd_checkpoint_config_t& config)
+    : config(config), last_write(std::chrono::steady_clock::now()) { }
+
+bool sgd_checkpointer_t::due() const {
+    return enabled()
+        && std::chrono::steady_clock::now() - last_write >= std::chrono::seconds(config.interval_seconds);
+}
+
+void sgd_checkpointer_t::write(const sgd_checkpoint_t& checkpoint) {
+    write_sgd_checkpoint(config.filename, checkpoint);
+    last_write = std::chrono::steady_clock::now();
+}
+
+bool sgd_checkpointer_t::resume(const uint64_t& dimensions, const uint64_t& node_count, const uint64_t& iter_max,
+                                sgd_checkpoint_t& checkpoint) const {
+    if (!enabled() || !config.resume) {
+        return false;
+    }
+    bool found = false;
+    try {
+        found = read_sgd_checkpoint(config.filename, checkpoint);
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << std::endl;
+        exit(1);
+    }
+    if (!found) {
+        return false;
+    }
+    if (checkpoint.dimensions != dimensions || checkpoint.node_count != node_count) {
+        std::cerr << "[odgi::algorithms::sgd_checkpoint] error: " << config.filename
+                  << " was taken on another graph, or by another command." << std::endl;
+        exit(1);
+    }
+    if (checkpoint.iter_max != iter_max) {
+        std::cerr << "[odgi::algorithms::sgd_checkpoint] error: " << config.filename << " was taken with "
+                  << checkpoint.iter_max << " iterations, not " << iter_max << "." << std::endl;
+        exit(1);
+    }
+    return true;
+}
+
+void sgd_checkpointer_t::finish() const {
+    if (enabled()) {
+        std::remove(config.filename.c_str());
+    }
+}
+
+}
+}
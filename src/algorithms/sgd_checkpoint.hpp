@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <array>
+#include <chrono>
+#include <limits>
+#include <cstdint>
+
+namespace odgi {
+namespace algorithms {
+
+/// Where and how often a long path guided SGD run (odgi sort -Y, odgi layout) saves its state,
+/// and whether it picks up from the state saved by an earlier, interrupted run
+struct sgd_checkpoint_config_t {
+    std::string filename;
+    uint64_t interval_seconds = 600;
+    bool resume = false;
+};
+
+/// The state of a path guided SGD run between two iterations: the coordinates, the next iteration to run
+/// (which gives the position in the learning rate schedule), the stress plateau counters and, when the run
+/// is deterministic, the state of each of its generators
+struct sgd_checkpoint_t {
+    uint64_t dimensions = 0;
+    uint64_t node_count = 0;
+    uint64_t iter_max = 0;
+    uint64_t iteration = 0;
+    uint64_t plateau_iterations = 0;
+    double last_stress = std::numeric_limits<double>::max();
+    std::vector<std::array<uint64_t, 4>> rng_states;
+    std::vector<double> coords;
+};
+
+/// Writes to a temporary file next to the checkpoint, then renames it, so that an interruption
+/// never leaves a partial checkpoint behind. Throws std::runtime_error if it cannot be written.
+void write_sgd_checkpoint(const std::string& filename, const sgd_checkpoint_t& checkpoint);
+
+/// Returns false if there is no such file; throws std::runtime_error if the file is not a checkpoint
+bool read_sgd_checkpoint(const std::string& filename, sgd_checkpoint_t& checkpoint);
+
+/// Drives the checkpoints of one run
+class sgd_checkpointer_t {
+public:
+    sgd_checkpointer_t(const sgd_checkpoint_config_t& config);
+    bool enabled() const { return !config.filename.empty(); }
+    /// Whether the interval has elapsed since the run started or since the last checkpoint
+    bool due() const;
+    void write(const sgd_checkpoint_t& checkpoint);
+    /// Load the checkpoint to resume from, if asked to and one exists. Exits with an error if
+    /// it was taken on another graph or with other parameters.
+    bool resume(const uint64_t& dimensions, const uint64_t& node_count, const uint64_t& iter_max,
+                sgd_checkpoint_t& checkpoint) const;
+    /// Remove the checkpoint once the run has completed
+    void finish() const;
+private:
+    sgd_checkpoint_config_t config;
+    std::chrono::steady_clock::time_point last_write;
+};
+
+}
+}
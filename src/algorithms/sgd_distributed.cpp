@@ -0,0 +1,164 @@
+#include "sgd_distributed.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <iostream>
+#ifdef USE_MPI
+#include <mpi.h>
+#endif
+
+namespace odgi {
+
+namespace algorithms {
+
+namespace distributed {
+
+    namespace {
+        int world_rank = 0;
+        int world_size = 1;
+        bool started = false;
+        std::atomic<uint64_t> interval{1};
+    }
+
+    void init(int* argc, char*** argv) {
+#ifdef USE_MPI
+        // the collectives are called from the SGD checker thread, one at a time
+        int provided = 0;
+        MPI_Init_thread(argc, argv, MPI_THREAD_SERIALIZED, &provided);
+        if (provided < MPI_THREAD_SERIALIZED) {
+            std::cerr << "[odgi::distributed] error: the MPI library does not support calls from worker threads" << std::endl;
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+        MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+        started = true;
+#endif
+    }
+
+    void finalize(void) {
+#ifdef USE_MPI
+        if (started) {
+            MPI_Finalize();
+            started = false;
+        }
+#endif
+    }
+
+    bool active(void) {
+        return world_size > 1;
+    }
+
+    int rank(void) {
+        return world_rank;
+    }
+
+    int size(void) {
+        return world_size;
+    }
+
+    bool is_root(void) {
+        return world_rank == 0;
+    }
+
+    void set_sync_interval(const uint64_t& iterations) {
+        interval.store(std::max((uint64_t) 1, iterations));
+    }
+
+    uint64_t sync_interval(void) {
+        return interval.load();
+    }
+
+    std::vector<path_handle_t> rank_paths(const PathHandleGraph& graph, const std::vector<path_handle_t>& paths) {
+        std::vector<std::pair<uint64_t, uint64_t>> by_steps; // (step count, index in paths)
+        for (uint64_t i = 0; i < paths.size(); ++i) {
+            const uint64_t steps = graph.get_step_count(paths[i]);
+            if (steps > 1) {
+                by_steps.emplace_back(steps, i);
+            }
+        }
+        // longest first, each to the rank with the fewest steps so far, ties to the lower rank
+        std::sort(by_steps.begin(), by_steps.end(), [](const auto& a, const auto& b) {
+            return a.first > b.first || (a.first == b.first && a.second < b.second);
+        });
+        std::vector<uint64_t> load(world_size, 0);
+        std::vector<uint64_t> mine;
+        for (auto& p : by_steps) {
+            const int r = std::min_element(load.begin(), load.end()) - load.begin();
+            load[r] += p.first;
+            if (r == world_rank) {
+                mine.push_back(p.second);
+            }
+        }
+        // keep the order the paths were given in
+        std::sort(mine.begin(), mine.end());
+        std::vector<path_handle_t> local;
+        for (auto& i : mine) {
+            local.push_back(paths[i]);
+        }
+        return local;
+    }
+
+    double max(const double& value) {
+        double result = value;
+#ifdef USE_MPI
+        if (started) {
+            MPI_Allreduce(&value, &result, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+        }
+#endif
+        return result;
+    }
+
+    bool all(const bool& value) {
+        int result = value;
+#ifdef USE_MPI
+        if (started) {
+            int local = value;
+            MPI_Allreduce(&local, &result, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+        }
+#endif
+        return result;
+    }
+
+    void sum(std::vector<double>& values) {
+#ifdef USE_MPI
+        if (started && !values.empty()) {
+            // in chunks, as the counts are ints
+            const uint64_t chunk = 1ULL << 28;
+            for (uint64_t i = 0; i < values.size(); i += chunk) {
+                MPI_Allreduce(MPI_IN_PLACE, values.data() + i, (int) std::min(chunk, values.size() - i),
+                              MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+            }
+        }
+#endif
+    }
+
+    coordinate_averager_t::coordinate_averager_t(const PathHandleGraph& graph,
+                                                 const std::vector<path_handle_t>& local_paths) {
+        const uint64_t node_count = graph.get_node_count();
+        on_rank.resize(node_count, false);
+        const nid_t shift = node_count ? graph.min_node_id() : 1;
+        for (auto& path : local_paths) {
+            graph.for_each_step_in_path(path, [&](const step_handle_t& step) {
+                on_rank[graph.get_id(graph.get_handle_of_step(step)) - shift] = true;
+            });
+        }
+        std::vector<double> counts(node_count);
+        for (uint64_t i = 0; i < node_count; ++i) {
+            counts[i] = on_rank[i];
+        }
+        sum(counts);
+        rank_counts.resize(node_count);
+        for (uint64_t i = 0; i < node_count; ++i) {
+            rank_counts[i] = (uint32_t) counts[i];
+        }
+    }
+
+    bool coordinate_averager_t::due(const uint64_t& iteration) const {
+        return (iteration + 1) % sync_interval() == 0;
+    }
+
+}
+
+}
+
+}
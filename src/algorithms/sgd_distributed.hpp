@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <handlegraph/path_handle_graph.hpp>
+
+namespace odgi {
+
+namespace algorithms {
+
+/// The ranks of an MPI run of the path-guided SGD, for builds with -DUSE_MPI=ON. Each rank loads the whole
+/// graph, takes its share of the paths, and runs the hogwild updates on their terms only; the coordinates of
+/// the nodes that more than one rank touches are averaged across those ranks every few iterations. Without
+/// MPI, or when started as a single process, there is one rank and none of this changes a thing.
+namespace distributed {
+
+    using namespace handlegraph;
+
+    /// Start MPI if the build has it; call once from main before anything else
+    void init(int* argc, char*** argv);
+
+    /// Shut MPI down again; call once before exiting
+    void finalize(void);
+
+    /// True if there is more than one rank
+    bool active(void);
+
+    /// This process's rank, 0 without MPI
+    int rank(void);
+
+    /// The number of ranks, 1 without MPI
+    int size(void);
+
+    /// True on the rank that writes the results
+    bool is_root(void);
+
+    /// Average the shared coordinates every this many iterations, 1 by default
+    void set_sync_interval(const uint64_t& iterations);
+    uint64_t sync_interval(void);
+
+    /// The paths this rank works on: the given paths with more than one step, dealt out by step count so that the
+    /// ranks get about the same number of steps, the same on every rank
+    std::vector<path_handle_t> rank_paths(const PathHandleGraph& graph, const std::vector<path_handle_t>& paths);
+
+    /// The largest value over all ranks
+    double max(const double& value);
+
+    /// True if the value is true on all ranks
+    bool all(const bool& value);
+
+    /// Sum the values elementwise over all ranks, in place
+    void sum(std::vector<double>& values);
+
+    /// Averages coordinates across the ranks whose paths step on the node they belong to. The coordinates of the
+    /// node ranked i by id are coords[i * per_node] to coords[(i + 1) * per_node - 1]; the node ids must be
+    /// compacted. Nodes that no rank touches keep their coordinates.
+    class coordinate_averager_t {
+    public:
+        coordinate_averager_t(const PathHandleGraph& graph, const std::vector<path_handle_t>& local_paths);
+
+        /// True if the coordinates are due to be averaged after the given (0-based) iteration
+        bool due(const uint64_t& iteration) const;
+
+        template<typename T>
+        void average(std::vector<std::atomic<T>>& coords, const uint64_t& per_node) const {
+            std::vector<double> sums(coords.size());
+            for (uint64_t k = 0; k < coords.size(); ++k) {
+                if (on_rank[k / per_node]) {
+                    sums[k] = coords[k].load(std::memory_order_relaxed);
+                }
+            }
+            sum(sums);
+            for (uint64_t k = 0; k < coords.size(); ++k) {
+                const uint32_t& n = rank_counts[k / per_node];
+                if (n > 0) {
+                    coords[k].store(sums[k] / n, std::memory_order_relaxed);
+                }
+            }
+        }
+
+    private:
+        std::vector<bool> on_rank;
+        std::vector<uint32_t> rank_counts;
+    };
+
+}
+
+}
+
+}
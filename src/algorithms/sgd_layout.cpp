@@ -6,31 +6,48 @@ namespace algorithms {
 
 using namespace handlegraph;
 
-std::vector<double> sgd_layout(const HandleGraph& graph, uint64_t pivots, uint64_t t_max, double eps, double x_padding) {
+std::vector<double> sgd_layout(const HandleGraph& graph, uint64_t pivots, uint64_t t_max, double eps, double x_padding,
+                               const uint64_t& nthreads) {
     std::vector<double> layout(graph.get_node_count()*2);
-    double max_x = 0;
-    auto weak_components = algorithms::weakly_connected_components(&graph);
-    for (auto& weak_component : weak_components) {
-        std::vector<handlegraph::nid_t> component_ids;
-        ska::flat_hash_map<handlegraph::nid_t, uint64_t> local_id;
-        for (auto& id : weak_component) {
-            component_ids.push_back(id);
-        }
-        std::sort(component_ids.begin(), component_ids.end());
-        for (uint64_t i = 0; i < component_ids.size(); ++i) {
-            local_id[component_ids[i]] = i;
+    const component_labels_t components = weakly_connected_component_labels(&graph, nthreads);
+    // the position of each node among the members of its component, which is its id for the SGD
+    std::vector<uint64_t> local_id(components.nodes.size());
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+    for (uint64_t c = 0; c < components.size(); ++c) {
+        for (uint64_t m = components.first_member[c]; m < components.first_member[c + 1]; ++m) {
+            local_id[components.members[m]] = m - components.first_member[c];
         }
-        // convert to input format for SGD
+    }
+    // the components are laid out in parallel, the largest first so that they do not hold up the end
+    std::vector<uint64_t> by_size(components.size());
+    for (uint64_t c = 0; c < by_size.size(); ++c) {
+        by_size[c] = c;
+    }
+    std::stable_sort(by_size.begin(), by_size.end(), [&](const uint64_t& a, const uint64_t& b) {
+        return components.component_size(a) > components.component_size(b);
+    });
+    std::vector<std::vector<double>> component_X(components.size());
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+    for (uint64_t k = 0; k < by_size.size(); ++k) {
+        const uint64_t c = by_size[k];
+        // convert to input format for SGD, each edge taken once, from its end with the lower local id
         std::vector<uint64_t> I, J;
-        graph.for_each_edge([&](const edge_t& e) {
-                if (weak_component.count(graph.get_id(e.first))
-                    && weak_component.count(graph.get_id(e.first))) {
-                    I.push_back(local_id[graph.get_id(e.first)]);
-                    J.push_back(local_id[graph.get_id(e.second)]);
+        for (uint64_t m = components.first_member[c]; m < components.first_member[c + 1]; ++m) {
+            const uint64_t i = components.members[m];
+            const handle_t& h = components.nodes[i];
+            auto take = [&](const handle_t& other) {
+                const uint64_t j = components.index_of(graph.get_id(other));
+                if (local_id[i] < local_id[j]) {
+                    I.push_back(local_id[i]);
+                    J.push_back(local_id[j]);
                 }
-            });
-        uint64_t n = weak_component.size();
-        std::vector<double> X(2*n);
+            };
+            graph.follow_edges(h, false, take);
+            graph.follow_edges(h, true, take);
+        }
+        uint64_t n = components.component_size(c);
+        std::vector<double>& X = component_X[c];
+        X.resize(2*n);
         std::random_device dev;
         // todo, seed with graph topology/contents to get a more stable result
         std::mt19937 rng(dev());
@@ -44,26 +61,24 @@ std::vector<double> sgd_layout(const HandleGraph& graph, uint64_t pivots, uint64
         } else {
             sgd2::layout_unweighted(n, X.data(), I.size(), I.data(), J.data(), t_max, eps);
         }
-
-        for (uint64_t i = 0; i < 2*n; i+=2) {
-            //std::cerr << "i = " << i << std::endl;
-            uint64_t j = component_ids[i/2]-1;
+    }
+    // the components go side by side in the order of their first node
+    double max_x = 0;
+    for (uint64_t c = 0; c < components.size(); ++c) {
+        const std::vector<double>& X = component_X[c];
+        for (uint64_t m = components.first_member[c]; m < components.first_member[c + 1]; ++m) {
+            const uint64_t i = 2 * (m - components.first_member[c]);
+            uint64_t j = graph.get_id(components.nodes[components.members[m]])-1;
             layout[j*2] = X[i] + max_x;
             layout[j*2+1] = X[i+1];
-            //std::cerr << "layout " << j << " " << layout[j*2] << " " << layout[j*2+1] << std::endl;
         }
         // set new max_x
-        for (uint64_t i = 0; i < 2*n; i+=2) {
+        for (uint64_t i = 0; i < X.size(); i+=2) {
             max_x = std::max(X[i], max_x);
         }
         max_x += x_padding;
+        std::vector<double>().swap(component_X[c]);
     }
-    // all the weakly connected component layouts have been merged here
-    /*
-    for (uint64_t i = 0; i < layout.size(); i+=2) {
-        std::cerr << i/2 << " " << layout[i] << " " << layout[i+1] << std::endl;
-    }
-    */
     return layout;
 }
 
@@ -16,7 +16,10 @@ namespace algorithms {
 
 using namespace handlegraph;
 
-std::vector<double> sgd_layout(const HandleGraph& graph, uint64_t pivots, uint64_t t_max, double eps, double x_padding);
+/// Lay out each weakly connected component with the SGD of s_gd2, sparse with the given number of pivots if not 0,
+/// the components side by side along x; the components are labeled and laid out in nthreads threads
+std::vector<double> sgd_layout(const HandleGraph& graph, uint64_t pivots, uint64_t t_max, double eps, double x_padding,
+                               const uint64_t& nthreads = 1);
 
 }
 }
@@ -0,0 +1,96 @@
+#include "sgd_snapshot.hpp"
+#include "weakly_connected_components.hpp"
+#include <fstream>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+
+namespace odgi {
+namespace algorithms {
+
+namespace {
+
+const char sgd_snapshot_magic[8] = {'o', 'd', 'g', 'i', 's', 'g', 'd', '1'};
+
+}
+
+void write_sgd_snapshot(std::ostream& out, const sgd_snapshot_t& snapshot) {
+    out.write(sgd_snapshot_magic, sizeof(sgd_snapshot_magic));
+    out.write((const char*)&snapshot.node_count, sizeof(uint64_t));
+    out.write((const char*)&snapshot.total_length, sizeof(uint64_t));
+    out.write((const char*)snapshot.positions.data(), snapshot.positions.size() * sizeof(float));
+}
+
+sgd_snapshot_t read_sgd_snapshot(const std::string& filename) {
+    std::ifstream in(filename.c_str(), std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("[odgi::algorithms::sgd_snapshot] error: cannot open " + filename);
+    }
+    char magic[sizeof(sgd_snapshot_magic)];
+    sgd_snapshot_t snapshot;
+    in.read(magic, sizeof(magic));
+    in.read((char*)&snapshot.node_count, sizeof(uint64_t));
+    in.read((char*)&snapshot.total_length, sizeof(uint64_t));
+    if (!in || std::memcmp(magic, sgd_snapshot_magic, sizeof(magic)) != 0) {
+        throw std::runtime_error("[odgi::algorithms::sgd_snapshot] error: " + filename + " is not a path guided SGD snapshot");
+    }
+    snapshot.positions.resize(snapshot.node_count);
+    in.read((char*)snapshot.positions.data(), snapshot.node_count * sizeof(float));
+    if ((uint64_t)in.gcount() != snapshot.node_count * sizeof(float)) {
+        throw std::runtime_error("[odgi::algorithms::sgd_snapshot] error: " + filename + " is truncated");
+    }
+    return snapshot;
+}
+
+bool sgd_snapshot_matches(const sgd_snapshot_t& snapshot, const graph_t& graph) {
+    if (snapshot.node_count != graph.get_node_count()) {
+        return false;
+    }
+    uint64_t total_length = 0;
+    graph.for_each_handle([&](const handle_t& h) {
+        total_length += graph.get_length(h);
+    });
+    return total_length == snapshot.total_length;
+}
+
+std::vector<handle_t> sgd_snapshot_order(const graph_t& graph, const sgd_snapshot_t& snapshot) {
+    const std::vector<ska::flat_hash_set<handlegraph::nid_t>> weak_components = weakly_connected_components(&graph);
+    std::vector<std::pair<double, uint64_t>> weak_component_order;
+    for (uint64_t i = 0; i < weak_components.size(); ++i) {
+        uint64_t id_sum = 0;
+        for (auto node_id : weak_components[i]) {
+            id_sum += node_id;
+        }
+        weak_component_order.push_back(std::make_pair(id_sum / (double) weak_components[i].size(), i));
+    }
+    std::sort(weak_component_order.begin(), weak_component_order.end());
+    std::vector<uint64_t> weak_component_id(weak_component_order.size());
+    for (uint64_t i = 0; i < weak_component_order.size(); ++i) {
+        weak_component_id[weak_component_order[i].second] = i;
+    }
+    std::vector<uint64_t> component_of(graph.get_node_count());
+    for (uint64_t i = 0; i < weak_components.size(); ++i) {
+        for (auto node_id : weak_components[i]) {
+            component_of[node_id - 1] = weak_component_id[i];
+        }
+    }
+    std::vector<handle_t> order;
+    order.reserve(graph.get_node_count());
+    graph.for_each_handle([&](const handle_t& h) {
+        order.push_back(h);
+    });
+    auto rank = [&](const handle_t& h) {
+        return number_bool_packing::unpack_number(h);
+    };
+    std::sort(order.begin(), order.end(), [&](const handle_t& a, const handle_t& b) {
+        const uint64_t ca = component_of[graph.get_id(a) - 1];
+        const uint64_t cb = component_of[graph.get_id(b) - 1];
+        const float pa = snapshot.positions[rank(a)];
+        const float pb = snapshot.positions[rank(b)];
+        return ca < cb || (ca == cb && (pa < pb || (pa == pb && rank(a) < rank(b))));
+    });
+    return order;
+}
+
+}
+}
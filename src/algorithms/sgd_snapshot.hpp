@@ -0,0 +1,36 @@
+#pragma once
+
+#include "odgi.hpp"
+#include <string>
+#include <vector>
+#include <iostream>
+#include <handlegraph/handle_graph.hpp>
+
+namespace odgi {
+namespace algorithms {
+
+using namespace handlegraph;
+
+/// A snapshot of the 1D positions of the nodes during path guided SGD (odgi sort -u).
+/// It holds one float32 position per node, by node rank, instead of a reordered copy of the graph;
+/// the node count and total sequence length of the graph it was taken on are kept to check it against.
+struct sgd_snapshot_t {
+    uint64_t node_count = 0;
+    uint64_t total_length = 0;
+    std::vector<float> positions;
+};
+
+void write_sgd_snapshot(std::ostream& out, const sgd_snapshot_t& snapshot);
+
+/// Throws std::runtime_error if the file is not a snapshot
+sgd_snapshot_t read_sgd_snapshot(const std::string& filename);
+
+/// Check that the snapshot was taken on a graph with the same nodes as the given one
+bool sgd_snapshot_matches(const sgd_snapshot_t& snapshot, const graph_t& graph);
+
+/// Order the handles of the graph as path_linear_sgd_order does: by weakly connected component, in the
+/// order of their average node id, then by snapshot position, then by node rank
+std::vector<handle_t> sgd_snapshot_order(const graph_t& graph, const sgd_snapshot_t& snapshot);
+
+}
+}
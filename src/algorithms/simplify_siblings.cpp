@@ -6,6 +6,7 @@
  */
 
 #include "simplify_siblings.hpp"
+#include <omp.h>
 
 namespace odgi {
 namespace algorithms {
@@ -13,6 +14,14 @@ namespace algorithms {
 bool simplify_siblings(
     handlegraph::MutablePathDeletableHandleGraph& graph,
     const std::string &progress_message) {
+    return simplify_siblings(graph, progress_message, nullptr, nullptr);
+}
+
+bool simplify_siblings(
+    handlegraph::MutablePathDeletableHandleGraph& graph,
+    const std::string &progress_message,
+    const std::vector<nid_t>* candidates,
+    std::vector<nid_t>* touched) {
 
     // Each handle is part of a "family" of handles with the same parents on
     // the left side and the same leading base. We elide the trivial ones. We
@@ -31,10 +40,117 @@ bool simplify_siblings(
     const bool show_progress = !progress_message.empty();
     if (show_progress) {
         progress = std::make_unique<algorithms::progress_meter::ProgressMeter>(
-            graph.get_node_count(), progress_message + " over nodes");
+            candidates ? candidates->size() : graph.get_node_count(), progress_message + " over nodes");
     }
 
-    graph.for_each_handle([&](const handle_t& local_forward_node) {
+    // The superfamily of a handle, all children of its parents that have exactly its parents,
+    // is the same for each of its members and does not depend on the merges we pick, so we find
+    // them all in parallel first. Each is kept once, by its smallest member, and every oriented
+    // handle points to its superfamily through a dense index over the id range.
+    const nid_t min_id = graph.get_node_count() ? graph.min_node_id() : 0;
+    const uint64_t id_range = graph.get_node_count() ? graph.max_node_id() - min_id + 1 : 0;
+    auto slot_of = [&](const handle_t& h) {
+        return 2 * (uint64_t)(graph.get_id(h) - min_id) + graph.get_is_reverse(h);
+    };
+    const uint64_t no_family = std::numeric_limits<uint64_t>::max();
+    std::vector<uint64_t> superfamily_of(2 * id_range, no_family);
+    std::vector<std::vector<handle_t>> superfamilies;
+
+    std::vector<handle_t> roots;
+    if (candidates) {
+        for (auto& id : *candidates) {
+            if (graph.has_node(id)) {
+                roots.push_back(graph.get_handle(id));
+            }
+        }
+    } else {
+        graph.for_each_handle([&](const handle_t& h) { roots.push_back(h); });
+    }
+    std::vector<bool> is_root(candidates ? id_range : 0);
+    for (auto& h : roots) {
+        if (candidates) {
+            is_root[graph.get_id(h) - min_id] = true;
+        }
+    }
+    const uint64_t nthreads = omp_get_max_threads();
+    std::vector<std::vector<std::vector<handle_t>>> thread_superfamilies(nthreads);
+
+    auto find_superfamily = [&](const handle_t& node, std::vector<handle_t>& superfamily) {
+        // Look left from the node and make a set of the things you see.
+        ska::flat_hash_set<handle_t> correct_parents;
+        graph.follow_edges(node, true, [&](const handle_t& parent) {
+            correct_parents.insert(parent);
+        });
+        // Keep a set of things we have checked so we don't have to constantly check them
+        ska::flat_hash_set<handle_t> checked;
+        for (auto& parent : correct_parents) {
+            graph.follow_edges(parent, false, [&](const handle_t& candidate) {
+                // Look right from parents and for each candidate family member
+                if (!checked.insert(candidate).second) {
+                    return;
+                }
+                // Look left from it and see if it has the right parents.
+                size_t seen_parents = 0;
+                bool bad_parent = false;
+                graph.follow_edges(candidate, true, [&](const handle_t& candidate_parent) {
+                    if (!correct_parents.count(candidate_parent)) {
+                        // We have a parent we shouldn't
+                        bad_parent = true;
+                        return false;
+                    } else {
+                        // Otherwise we found one of the right ones.
+                        seen_parents++;
+                        return true;
+                    }
+                });
+                if (!bad_parent && seen_parents == correct_parents.size()) {
+                    // If it has the correct parents, it is a member of the superfamily
+                    superfamily.push_back(candidate);
+                }
+            });
+        }
+        std::sort(superfamily.begin(), superfamily.end(), [](const handle_t& a, const handle_t& b) {
+            return as_integer(a) < as_integer(b);
+        });
+    };
+
+#pragma omp parallel for schedule(dynamic, 256)
+    for (uint64_t i = 0; i < roots.size(); ++i) {
+        for (bool local_orientation : {false, true}) {
+            const handle_t node = local_orientation ? graph.flip(roots[i]) : roots[i];
+            std::vector<handle_t> superfamily;
+            find_superfamily(node, superfamily);
+            if (superfamily.size() < 2) {
+                continue;
+            }
+            // keep a nontrivial superfamily from its smallest member that we look from
+            for (auto& h : superfamily) {
+                if (!candidates || is_root[graph.get_id(h) - min_id]) {
+                    if (h == node) {
+                        thread_superfamilies[omp_get_thread_num()].push_back(std::move(superfamily));
+                    }
+                    break;
+                }
+            }
+        }
+    }
+    for (auto& t : thread_superfamilies) {
+        for (auto& superfamily : t) {
+            superfamilies.push_back(std::move(superfamily));
+        }
+        std::vector<std::vector<handle_t>>().swap(t);
+    }
+    // each oriented handle has one superfamily, so the slots are written once
+#pragma omp parallel for schedule(dynamic, 256)
+    for (uint64_t f = 0; f < superfamilies.size(); ++f) {
+        for (auto& h : superfamilies[f]) {
+            superfamily_of[slot_of(h)] = f;
+        }
+    }
+
+    // Now choose the families in the serial order: this is a greedy independent set on the
+    // conflicts between families that share a node.
+    auto find_families = [&](const handle_t& local_forward_node) {
         // For each node local forward
         
         for (bool local_orientation : {false, true}) {
@@ -48,108 +164,18 @@ bool simplify_siblings(
             if (in_family.count(graph.get_id(node))) {
                 // If it is in a family in one orientation, don't find a family for it in the other orientation.
                 // We can only merge from one end of a node at a time.
-#ifdef debug
-                cerr << "Node " << graph.get_id(node) << " is already in a family to merge" << endl;
-#endif
-                
                 return;
             }
-            // For each handle where it or its RC isn't already in a superfamily, identify its superfamily.
-            ska::flat_hash_set<handle_t> superfamily;
-            
-            // Look left from the node and make a set of the things you see.
-            ska::flat_hash_set<handle_t> correct_parents;
-            graph.follow_edges(node, true, [&](const handle_t& parent) {
-                correct_parents.insert(parent);
-#ifdef debug
-                cerr << "Parent set includes: " << graph.get_id(parent) << (graph.get_is_reverse(parent) ? '-' : '+') << endl;
-#endif
-            });
-            
-            // Keep a set of things that are partial siblings so we don't have to constantly check them
-            ska::flat_hash_set<handle_t> partial_siblings;
-            for (auto& parent : correct_parents) {
-                graph.follow_edges(parent, false, [&](const handle_t& candidate) {
-                    // Look right from parents and for each candidate family member
-                    
-#ifdef debug
-                    cerr << "Parent " << graph.get_id(parent) << (graph.get_is_reverse(parent) ? '-' : '+')
-                        << " suggests sibling " << graph.get_id(candidate) << (graph.get_is_reverse(candidate) ? '-' : '+') << endl;
-#endif
-                    
-                    if (partial_siblings.count(candidate)) {
-                        // Known non-member
-#ifdef debug
-                        cerr << "\tAlready checked." << endl;
-#endif
-                        return;
-                    }
-                    if (superfamily.count(candidate)) {
-                        // Known member
-#ifdef debug
-                        cerr << "\tAlready taken." << endl;
-#endif
-                        return;
-                    }
-                    
-                    if (in_family.count(graph.get_id(candidate))) {
-                        // If it is in a family in one orientation, don't find a family for it in the other orientation.
-                        // We can only merge from one end of a node at a time.
-#ifdef debug
-                        cerr << "\tAlready in a family to merge." << endl;
-#endif
-                        return;
-                    }
-                    
-                    // Look left from it and see if it has the right parents.
-                    size_t seen_parents = 0;
-                    bool bad_parent = false;
-                    graph.follow_edges(candidate, true, [&](const handle_t& candidate_parent) {
-                        if (!correct_parents.count(candidate_parent)) {
-                            // We have a parent we shouldn't
-                            bad_parent = true;
-                            
-#ifdef debug
-                            cerr << "\tHas unacceptable parent "
-                                << graph.get_id(candidate_parent) << (graph.get_is_reverse(candidate_parent) ? '-' : '+') << endl;
-#endif
-                            
-                            return false;
-                        } else {
-                            // Otherwise we found one of the right ones.
-                            seen_parents++;
-                            
-#ifdef debug
-                            cerr << "\tHas OK parent "
-                                << graph.get_id(candidate_parent) << (graph.get_is_reverse(candidate_parent) ? '-' : '+') << endl;
-#endif
-                            
-                            return true;
-                        }
-                    });
-                    
-#ifdef debug
-                    cerr << "\tHas " << seen_parents << "/" << correct_parents.size() << " required parents" << endl;
-#endif
-                    
-                    if (!bad_parent && seen_parents == correct_parents.size()) {
-                        // If it has the correct parents, it is a member of the superfamily
-                        superfamily.insert(candidate);
-                        
-#ifdef debug
-                        cerr << "\tBelongs in superfamily" << endl;
-#endif
-                        
-                    } else {
-                        // Otherwise, it is out, so don't check it again if we find it from another parent.
-                        partial_siblings.insert(candidate);
-                        
-#ifdef debug
-                        cerr << "\tOnly a partial sibling" << endl;
-#endif
-                        
-                    }
-                });
+            const uint64_t f = superfamily_of[slot_of(node)];
+            if (f == no_family) {
+                continue;
+            }
+            // The members already in a family to merge are left out, as if they were never seen.
+            std::vector<handle_t> superfamily;
+            for (auto& h : superfamilies[f]) {
+                if (!in_family.count(graph.get_id(h))) {
+                    superfamily.push_back(h);
+                }
             }
             
             // Now we have a family. It can't overap with any existing ones.
@@ -236,7 +262,13 @@ bool simplify_siblings(
         if (show_progress) {
             progress->increment(1);
         }
-    });
+    };
+    for (auto& root : roots) {
+        find_families(root);
+    }
+    if (show_progress) {
+        progress->increment(candidates ? candidates->size() - roots.size() : 0);
+    }
 
     if (show_progress) {
         progress->finish();
@@ -258,27 +290,50 @@ bool simplify_siblings(
     
     // We set this tro true if we do any work.
     bool made_progress = false;
+
+    // the merges create nodes above the current max id, and only touch the families and their neighbors
+    const nid_t max_id_before = graph.get_node_count() ? graph.max_node_id() : 0;
+    if (touched) {
+        for (auto& family : families) {
+            for (auto& h : family) {
+                touched->push_back(graph.get_id(h));
+                for (bool go_left : {false, true}) {
+                    graph.follow_edges(h, go_left, [&](const handle_t& n) {
+                        touched->push_back(graph.get_id(n));
+                    });
+                }
+            }
+        }
+    }
     
-    for (auto& family : families) {
-        // Set up the merge
-        // everything needs to start at base 0
-        std::vector<std::pair<handle_t, size_t>> merge_from;
-        merge_from.reserve(family.size());
-        merge_from.emplace_back(family.at(0), 0);
-    
-        // Work out the length of the longest common prefix
+    // Work out the length of the longest common prefix of each family, reading only
+    std::vector<size_t> lcp_lengths(families.size());
+#pragma omp parallel for schedule(dynamic, 64)
+    for (size_t f = 0; f < families.size(); ++f) {
+        auto& family = families[f];
         size_t lcp_length = graph.get_length(family.at(0));
         std::string reference_string = graph.get_sequence(family.at(0));
         for (size_t i = 1; i < family.size(); i++) {
-            // Create the merge start position
-            merge_from.emplace_back(family.at(i), 0);
-            
             // See where the first mismatch is, and min that in with the LCP length
             auto other_string = graph.get_sequence(family.at(i));
-            auto mismatch_iters = std::mismatch(reference_string.begin(), reference_string.end(), other_string.begin());
+            auto mismatch_iters = std::mismatch(reference_string.begin(), reference_string.end(),
+                                                other_string.begin(), other_string.end());
             size_t match_length = mismatch_iters.first - reference_string.begin();
             lcp_length = std::min(lcp_length, match_length);
         }
+        lcp_lengths[f] = lcp_length;
+    }
+
+    for (size_t f = 0; f < families.size(); ++f) {
+        auto& family = families[f];
+        // Set up the merge
+        // everything needs to start at base 0
+        std::vector<std::pair<handle_t, size_t>> merge_from;
+        merge_from.reserve(family.size());
+        for (auto& h : family) {
+            merge_from.emplace_back(h, 0);
+        }
+        const size_t lcp_length = lcp_lengths[f];
         
         // There should be at least one base of match because we bucketed by base.
         assert(lcp_length >= 1);
@@ -298,6 +353,14 @@ bool simplify_siblings(
         progress->finish();
     }
 
+    if (touched && made_progress) {
+        for (nid_t id = max_id_before + 1; id <= graph.max_node_id(); ++id) {
+            if (graph.has_node(id)) {
+                touched->push_back(id);
+            }
+        }
+    }
+
     // To merge everything on the other side of stuff we just merged, we need to start from the top again.
     // So return if we did anything and more might remain (or have been created) to do.
     return made_progress;
@@ -26,6 +26,17 @@ using namespace handlegraph;
  */
 bool simplify_siblings(handlegraph::MutablePathDeletableHandleGraph& graph,
                        const std::string &progress_message = "");
+
+/**
+ * Simplify siblings as above, but only look for families from the nodes with the given ids
+ * that still exist, if candidates is not null. If touched is not null, the ids of the nodes
+ * whose sequence or neighbors may have changed by the merges are added to it: the family
+ * members and their neighbors that are left, and all new nodes.
+ */
+bool simplify_siblings(handlegraph::MutablePathDeletableHandleGraph& graph,
+                       const std::string &progress_message,
+                       const std::vector<nid_t>* candidates,
+                       std::vector<nid_t>* touched);
     
 }
 }
@@ -59,5 +59,68 @@ ska::flat_hash_map<handlegraph::nid_t, std::pair<handlegraph::nid_t, bool>> spli
     return move(node_translation);
 }
 
+std::vector<std::pair<handlegraph::nid_t, bool>> split_strands(const graph_t& source, graph_t& into,
+                                                               const uint64_t& nthreads) {
+
+    if (into.get_node_count()) {
+        std::cerr << "error:[algorithms] attempted to create strand-splitted graph in a non-empty graph" << std::endl;
+        exit(1);
+    }
+
+    std::vector<handle_t> handles;
+    handles.reserve(source.get_node_count());
+    source.for_each_handle([&](const handle_t& handle) {
+            handles.push_back(handle);
+        });
+    // the handle ranks of source may have gaps, so index them densely
+    std::vector<uint64_t> index_of(handles.empty() ? 0 : number_bool_packing::unpack_number(handles.back()) + 1);
+    for (uint64_t i = 0; i < handles.size(); ++i) {
+        index_of[number_bool_packing::unpack_number(handles[i])] = i;
+    }
+
+    into.set_number_of_threads(nthreads);
+    const uint64_t first_rank = number_bool_packing::unpack_number(
+        into.create_handles(2 * handles.size(), [&](const uint64_t& i) {
+                const std::string sequence = source.get_sequence(handles[i / 2]);
+                return i % 2 ? reverse_complement(sequence) : sequence;
+            }));
+
+    std::vector<std::pair<handlegraph::nid_t, bool>> node_translation(2 * handles.size());
+    // the forward node of into that spells the oriented handle
+    auto split_of = [&](const handle_t& h) {
+        return number_bool_packing::pack(first_rank + 2 * index_of[number_bool_packing::unpack_number(h)]
+                                         + source.get_is_reverse(h), false);
+    };
+    // translate each edge into two edges between forward-oriented nodes, from both of its nodes,
+    // and let create_edges drop the repeats
+    std::vector<std::vector<edge_t>> thread_edges(nthreads);
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(nthreads)
+    for (uint64_t i = 0; i < handles.size(); ++i) {
+        const handle_t& handle = handles[i];
+        const nid_t id = source.get_id(handle);
+        node_translation[2 * i] = std::make_pair(id, false);
+        node_translation[2 * i + 1] = std::make_pair(id, true);
+        auto& edges = thread_edges[omp_get_thread_num()];
+        auto add_edge = [&](const handle_t& prev, const handle_t& next) {
+            edges.push_back(std::make_pair(split_of(prev), split_of(next)));
+            edges.push_back(std::make_pair(split_of(source.flip(next)), split_of(source.flip(prev))));
+        };
+        source.follow_edges(handle, true, [&](const handle_t& prev) {
+                add_edge(prev, handle);
+            });
+        source.follow_edges(handle, false, [&](const handle_t& next) {
+                add_edge(handle, next);
+            });
+    }
+    std::vector<edge_t> edges;
+    for (auto& e : thread_edges) {
+        edges.insert(edges.end(), e.begin(), e.end());
+        std::vector<edge_t>().swap(e);
+    }
+    into.create_edges(edges);
+
+    return node_translation;
+}
+
 }
 }
@@ -11,6 +11,8 @@
 //#include "utility.hpp"
 #include "dna.hpp"
 #include "hash_map.hpp"
+#include "odgi.hpp"
+#include <omp.h>
 #include <utility>
 #include <unordered_set>
 #include <unordered_map>
@@ -29,5 +31,11 @@ using namespace handlegraph;
 ska::flat_hash_map<handlegraph::nid_t, std::pair<handlegraph::nid_t, bool>> split_strands(const HandleGraph* source,
                                                                                           MutableHandleGraph* into);
 
+    /// The same for a graph_t, building 'into' in bulk with nthreads threads. The i-th node of
+    /// 'source' becomes nodes 2i+1 (forward) and 2i+2 (reverse complement) of 'into', and entry
+    /// id-1 of the returned vector translates node id of 'into' back to 'source'.
+std::vector<std::pair<handlegraph::nid_t, bool>> split_strands(const graph_t& source, graph_t& into,
+                                                               const uint64_t& nthreads);
+
 }
 }
@@ -1,55 +1,94 @@
 #include "stepindex.hpp"
 #include "progress.hpp"
+#include "huge_pages.hpp"
 
 namespace odgi {
 namespace algorithms {
 
+// follows the magic number when the positions are bit-compressed; the first byte of the old
+// int_vector<64> positions is that of their size in bits, a multiple of 64, so it never matches
+static const char BIT_COMPRESSED_MARK = 'B';
+
 step_index_t::step_index_t() {
 	step_mphf = new boophf_step_t();
 }
 
 
 
+// set entry i of a zero initialized bit-compressed vector, from any thread
+static void set_packed(sdsl::int_vector<>& v, const uint64_t& i, const uint64_t& value) {
+	const uint64_t width = v.width();
+	const uint64_t bit = i * width;
+	uint64_t* words = v.data();
+	__atomic_fetch_or(&words[bit / 64], value << (bit % 64), __ATOMIC_RELAXED);
+	if (bit % 64 + width > 64) {
+		__atomic_fetch_or(&words[bit / 64 + 1], value >> (64 - bit % 64), __ATOMIC_RELAXED);
+	}
+}
+
 step_index_t::step_index_t(const PathHandleGraph& graph,
                            const std::vector<path_handle_t>& paths,
                            const uint64_t& nthreads,
                            const bool progress,
 						   const uint64_t& sample_rate) {
 	this->sample_rate = sample_rate;
-
-    // iterate through the paths, recording steps in the structure we'll use to build the mphf
-    std::vector<step_handle_t> steps;
+	auto is_sampled = [&](const step_handle_t& step) {
+		return sample_rate == 0 || 0 == utils::modulo(graph.get_id(graph.get_handle_of_step(step)), sample_rate);
+	};
+
+	// count the sampled steps of each path, so that they can be collected in place
+	std::vector<uint64_t> step_offsets(paths.size() + 1, 0);
+	// the lengths are by path rank, the paths may be a subset
+	uint64_t max_path_rank = 0;
+	for (auto& path : paths) {
+		max_path_rank = std::max(max_path_rank, (uint64_t) as_integer(path));
+	}
+	path_len = sdsl::int_vector<64>(max_path_rank, 0);
 	std::unique_ptr<algorithms::progress_meter::ProgressMeter> collecting_steps_progress_meter;
 	if (progress) {
 		collecting_steps_progress_meter = std::make_unique<algorithms::progress_meter::ProgressMeter>(
-				paths.size(), "[odgi::algorithms::stepindex] Collecting Steps Progress:");
+				2 * paths.size(), "[odgi::algorithms::stepindex] Collecting Steps Progress:");
 	}
-	path_len.resize(paths.size());
-#pragma omp parallel for schedule(dynamic,1)
-    for (auto& path : paths) {
-        std::vector<step_handle_t> my_steps;
+#pragma omp parallel for schedule(dynamic,1) num_threads(nthreads)
+	for (uint64_t i = 0; i < paths.size(); ++i) {
+		const path_handle_t& path = paths[i];
 		uint64_t path_length = 0;
-        graph.for_each_step_in_path(
-            path, [&](const step_handle_t& step) {
+		uint64_t sampled = 0;
+		graph.for_each_step_in_path(
+			path, [&](const step_handle_t& step) {
 				path_length += graph.get_length(graph.get_handle_of_step(step));
-				// sampling
-				if (sample_rate == 0 || 0 == utils::modulo(graph.get_id(graph.get_handle_of_step(step)), sample_rate)) {
-					my_steps.push_back(step);
+				sampled += is_sampled(step);
+			});
+		sampled += is_sampled(graph.path_end(path));
+		// each path writes its own entry
+		path_len[as_integer(path) - 1] = path_length;
+		step_offsets[i + 1] = sampled;
+		if (progress) {
+			collecting_steps_progress_meter->increment(1);
+		}
+	}
+	for (uint64_t i = 0; i < paths.size(); ++i) {
+		step_offsets[i + 1] += step_offsets[i];
+	}
+	std::vector<step_handle_t> steps(step_offsets.back());
+#pragma omp parallel for schedule(dynamic,1) num_threads(nthreads)
+	for (uint64_t i = 0; i < paths.size(); ++i) {
+		const path_handle_t& path = paths[i];
+		uint64_t j = step_offsets[i];
+		graph.for_each_step_in_path(
+			path, [&](const step_handle_t& step) {
+				if (is_sampled(step)) {
+					steps[j++] = step;
 				}
 			});
-		// sampling
-		if (sample_rate == 0 || 0 == utils::modulo(graph.get_id(graph.get_handle_of_step(graph.path_end(path))), sample_rate)) {
-			my_steps.push_back(graph.path_end(path));
+		if (is_sampled(graph.path_end(path))) {
+			steps[j++] = graph.path_end(path);
 		}
-
-#pragma omp critical (path_len)
-		path_len[as_integer(path) - 1] = path_length;
-#pragma omp critical (steps_collect)
-        steps.insert(steps.end(), my_steps.begin(), my_steps.end());
-        if(progress) {
-        	collecting_steps_progress_meter->increment(1);
-        }
-    }
+		if (progress) {
+			collecting_steps_progress_meter->increment(1);
+		}
+	}
+	std::vector<uint64_t>().swap(step_offsets);
 	if (progress) {
 		collecting_steps_progress_meter->finish();
 	}
@@ -57,27 +96,34 @@ step_index_t::step_index_t(const PathHandleGraph& graph,
     ips4o::parallel::sort(steps.begin(), steps.end(), std::less<>(), nthreads);
     // build the hash function (quietly)
     step_mphf = new boophf_step_t(steps.size(), steps, nthreads, 2.0, false, false);
-    // use the hash function to record the step positions
-    pos.resize(steps.size());
+    // the hash function no longer needs the steps
+    const uint64_t step_count = steps.size();
+    std::vector<step_handle_t>().swap(steps);
+    // use the hash function to record the step positions, with as many bits as the longest path needs
+    uint64_t max_path_len = 0;
+    for (uint64_t i = 0; i < path_len.size(); ++i) {
+        max_path_len = std::max(max_path_len, (uint64_t) path_len[i]);
+    }
+    pos = sdsl::int_vector<>(step_count, 0, std::max(1, (int) sdsl::bits::hi(max_path_len) + 1));
 	std::unique_ptr<algorithms::progress_meter::ProgressMeter> building_progress_meter;
 	if (progress) {
 		building_progress_meter = std::make_unique<algorithms::progress_meter::ProgressMeter>(
 				paths.size(), "[odgi::algorithms::stepindex] Building Progress:");
 	}
-#pragma omp parallel for schedule(dynamic,1)
+#pragma omp parallel for schedule(dynamic,1) num_threads(nthreads)
     for (auto& path : paths) {
         uint64_t offset = 0;
         graph.for_each_step_in_path(
             path, [&](const step_handle_t& step) {
 				// sampling
-				if (sample_rate == 0 || 0 == utils::modulo(graph.get_id(graph.get_handle_of_step(step)), sample_rate)) {
-					pos[step_mphf->lookup(step)] = offset;
+				if (is_sampled(step)) {
+					set_packed(pos, step_mphf->lookup(step), offset);
 				}
 				offset += graph.get_length(graph.get_handle_of_step(step));
 				});
 		// sampling
-		if (sample_rate == 0 || 0 == utils::modulo(graph.get_id(graph.get_handle_of_step(graph.path_end(path))), sample_rate)) {
-			pos[step_mphf->lookup(graph.path_end(path))] = offset;
+		if (is_sampled(graph.path_end(path))) {
+			set_packed(pos, step_mphf->lookup(graph.path_end(path)), offset);
 		}
         if (progress) {
         	building_progress_meter->increment(1);
@@ -86,6 +132,8 @@ step_index_t::step_index_t(const PathHandleGraph& graph,
 	if (progress) {
 		building_progress_meter->finish();
 	}
+	// the positions are looked up at random by step
+	huge_pages::advise_bits(pos);
 }
 
 const uint64_t step_index_t::get_position(const step_handle_t& step, const PathHandleGraph& graph) const {
@@ -142,8 +190,8 @@ size_t step_index_t::serialize_and_measure(std::ostream &out, sdsl::structure_tr
 
 	// Do the magic number
 	std::string sample_rate = std::to_string(this->sample_rate);
-	out << "STEP" << sample_rate << "INDEX";
-	written += 9;
+	out << "STEP" << sample_rate << "INDEX" << BIT_COMPRESSED_MARK;
+	written += 10;
 	written += sample_rate.length();
 
 	// POSITION STUFF
@@ -198,8 +246,21 @@ void step_index_t::load_sdsl(std::istream &in) {
 	delete[] index_buffer;
 
 	try {
-		pos.load(in);
+		if (in.peek() == BIT_COMPRESSED_MARK) {
+			in.get();
+			pos.load(in);
+		} else {
+			// an index written before the positions were bit-compressed
+			sdsl::int_vector<64> full_pos;
+			full_pos.load(in);
+			pos = sdsl::int_vector<>(full_pos.size(), 0, 64);
+			for (uint64_t i = 0; i < full_pos.size(); ++i) {
+				pos[i] = full_pos[i];
+			}
+			sdsl::util::bit_compress(pos);
+		}
 		path_len.load(in);
+		huge_pages::advise_bits(pos);
 	} catch (const std::runtime_error &e) {
 		// Pass XGFormatErrors through
 		throw e;
@@ -224,75 +285,72 @@ step_index_t::~step_index_t(void) {
 path_step_index_t::path_step_index_t(const PathHandleGraph& graph,
                                      const path_handle_t& path,
                                      const uint64_t& nthreads) {
-    // iterate through the paths, recording steps in the structure we'll use to build the mphf
-    {
-        std::vector<step_handle_t> steps;
-        std::vector<nid_t> nodes;
-        graph.for_each_step_in_path(
-            path, [&](const step_handle_t& step) {
-                steps.push_back(step);
-                nodes.push_back(graph.get_id(graph.get_handle_of_step(step)));
-            });
-        steps.push_back(graph.path_end(path));
-        // sort the steps, nb. they're unique
-        ips4o::parallel::sort(steps.begin(), steps.end(), std::less<>(), nthreads);
-        // build the hash function (quietly)
-        step_mphf = new boophf_step_t(steps.size(), steps, nthreads, 2.0, false, false);
-
-        ips4o::parallel::sort(nodes.begin(), nodes.end(), std::less<>(), nthreads);
-        // then take unique positions
-        nodes.erase(std::unique(nodes.begin(),
-                                nodes.end()),
-                    nodes.end());
-        // build the hash function (quietly)
-        node_mphf = new boophf_uint64_t(nodes.size(), nodes, nthreads, 2.0, false, false);
-        node_count = nodes.size();
-        step_count = steps.size();
-    }
-
+    // walk the path once, recording its steps in order, with the ids of their nodes
+    std::vector<step_handle_t> steps;
+    std::vector<nid_t> nodes;
     {
-        // here, we sort steps by handle and then position
-        // and build our handle->step list and step->offset maps
-        // these are steps sorted by the bbhash of their node id, and then their offset in the path
-        std::vector<std::tuple<uint64_t, uint64_t, step_handle_t>> steps_by_node;
         uint64_t offset = 0;
         graph.for_each_step_in_path(
             path, [&](const step_handle_t& step) {
-                steps_by_node.push_back(std::make_tuple(node_mphf->lookup(graph.get_id(graph.get_handle_of_step(step))),
-                                                        offset,
-                                                        step));
-                offset += graph.get_length(graph.get_handle_of_step(step));
+                const handle_t h = graph.get_handle_of_step(step);
+                steps.push_back(step);
+                nodes.push_back(graph.get_id(h));
+                offset += graph.get_length(h);
             });
         if (offset == 0) {
             std::cerr << "[odgi::algorithms::stepindex] unable to index empty path " << graph.get_path_name(path) << std::endl;
             std::abort();
         }
+    }
+    const uint64_t path_step_count = steps.size();
+    {
+        // build the hash functions (quietly) on sorted copies, nb. the steps are unique
+        std::vector<step_handle_t> sorted_steps(steps);
+        sorted_steps.push_back(graph.path_end(path));
+        ips4o::parallel::sort(sorted_steps.begin(), sorted_steps.end(), std::less<>(), nthreads);
+        step_mphf = new boophf_step_t(sorted_steps.size(), sorted_steps, nthreads, 2.0, false, false);
+        step_count = sorted_steps.size();
+    }
+    {
+        std::vector<nid_t> sorted_nodes(nodes);
+        ips4o::parallel::sort(sorted_nodes.begin(), sorted_nodes.end(), std::less<>(), nthreads);
+        // then take unique positions
+        sorted_nodes.erase(std::unique(sorted_nodes.begin(),
+                                       sorted_nodes.end()),
+                           sorted_nodes.end());
+        node_mphf = new boophf_uint64_t(sorted_nodes.size(), sorted_nodes, nthreads, 2.0, false, false);
+        node_count = sorted_nodes.size();
+    }
 
-        node_offset.resize(node_count+1);
-        step_offset.resize(step_count+1);
-        ips4o::parallel::sort(steps_by_node.begin(), steps_by_node.end(), std::less<>(), nthreads);
-        uint64_t last_idx = 0;
-        node_offset[0] = 0; // first offset is 0 by definition
-        for (auto& node_step : steps_by_node) {
-            auto& idx = std::get<0>(node_step);
-            //auto& offset = std::get<1>(node_step); // just used for sorting
-            auto& step = std::get<2>(node_step);
-            //std::cerr << "idx = " << idx << " " << as_integers(step)[0] << ":" << as_integers(step)[1] << std::endl;
-            if (idx != last_idx) {
-                node_offset[idx] = node_steps.size();
-            }
-            step_offset[step_mphf->lookup(step)] = node_steps.size();
-            node_steps.push_back(step);
-            last_idx = idx;
-        }
-        if (last_idx != node_count-1) {
-            std::cerr << "last_idx vs node count " << last_idx << " " << node_count << std::endl;
-            std::cerr << "[odgi::algorithms::stepindex] unexpected mismatch between last_idx and node_count" << std::endl;
-            std::abort();
+    // here, we sort steps by the bbhash of their node id, and then their offset in the path,
+    // and build our handle->step list and step->offset maps; the steps are already in path order,
+    // so counting them by node and placing them in that order sorts them
+    std::vector<uint64_t> node_idx(path_step_count);
+#pragma omp parallel for schedule(static) num_threads(nthreads)
+    for (uint64_t i = 0; i < path_step_count; ++i) {
+        node_idx[i] = node_mphf->lookup(nodes[i]);
+    }
+    std::vector<nid_t>().swap(nodes);
+    node_offset.assign(node_count + 1, 0);
+    for (auto& idx : node_idx) {
+        ++node_offset[idx + 1];
+    }
+    for (uint64_t i = 0; i < node_count; ++i) {
+        node_offset[i + 1] += node_offset[i];
+    }
+    node_steps.resize(path_step_count);
+    step_offset.resize(step_count + 1);
+    {
+        std::vector<uint64_t> next(node_offset.begin(), node_offset.end() - 1);
+        for (uint64_t i = 0; i < path_step_count; ++i) {
+            const uint64_t j = next[node_idx[i]]++;
+            node_steps[j] = steps[i];
+            step_offset[step_mphf->lookup(steps[i])] = j;
         }
-        node_offset[node_count] = node_steps.size();
-        step_offset[step_count] = node_steps.size();
     }
+    step_offset[step_count] = node_steps.size();
+    huge_pages::advise(node_steps);
+    huge_pages::advise(step_offset);
 }
 
 path_step_index_t::~path_step_index_t(void) {
@@ -300,6 +358,61 @@ path_step_index_t::~path_step_index_t(void) {
     delete step_mphf;
 }
 
+static const char PATH_STEP_INDEX_MAGIC[8] = {'O', 'D', 'G', 'I', 'P', 'S', 'I', 'X'};
+
+template<typename T>
+static void write_index_vector(std::ostream& out, const std::vector<T>& v) {
+    const uint64_t n = v.size();
+    out.write((const char*) &n, sizeof(n));
+    out.write((const char*) v.data(), n * sizeof(T));
+}
+
+template<typename T>
+static bool read_index_vector(std::istream& in, std::vector<T>& v) {
+    uint64_t n = 0;
+    if (!in.read((char*) &n, sizeof(n))) {
+        return false;
+    }
+    v.resize(n);
+    return n == 0 || (bool) in.read((char*) v.data(), n * sizeof(T));
+}
+
+void path_step_index_t::serialize(std::ostream& out) const {
+    out.write(PATH_STEP_INDEX_MAGIC, sizeof(PATH_STEP_INDEX_MAGIC));
+    out.write((const char*) &node_count, sizeof(node_count));
+    out.write((const char*) &step_count, sizeof(step_count));
+    write_index_vector(out, node_offset);
+    write_index_vector(out, node_steps);
+    write_index_vector(out, step_offset);
+    node_mphf->save(out);
+    step_mphf->save(out);
+}
+
+bool path_step_index_t::load(std::istream& in) {
+    char magic[sizeof(PATH_STEP_INDEX_MAGIC)];
+    if (!in.read(magic, sizeof(magic))
+        || !std::equal(magic, magic + sizeof(magic), PATH_STEP_INDEX_MAGIC)
+        || !in.read((char*) &node_count, sizeof(node_count))
+        || !in.read((char*) &step_count, sizeof(step_count))
+        || !read_index_vector(in, node_offset)
+        || !read_index_vector(in, node_steps)
+        || !read_index_vector(in, step_offset)
+        || node_offset.size() != node_count + 1
+        || step_offset.size() != step_count + 1
+        || node_offset.back() != node_steps.size()) {
+        return false;
+    }
+    delete node_mphf;
+    delete step_mphf;
+    node_mphf = new boophf_uint64_t();
+    step_mphf = new boophf_step_t();
+    node_mphf->load(in);
+    step_mphf->load(in);
+    huge_pages::advise(node_steps);
+    huge_pages::advise(step_offset);
+    return (bool) in;
+}
+
 uint64_t path_step_index_t::get_node_idx(const nid_t& id) const {
     return node_mphf->lookup(id);
 }
@@ -65,7 +65,8 @@ struct step_index_t {
 	void load(const std::string& name);
     // map from step to position in its path
     boophf_step_t* step_mphf = nullptr;
-	sdsl::int_vector<64> pos;
+	// bit-compressed to the width of the longest path length
+	sdsl::int_vector<> pos;
 	sdsl::int_vector<64> path_len;
 	uint64_t sample_rate;
 private:
@@ -93,7 +94,15 @@ struct path_step_index_t {
     path_step_index_t(const PathHandleGraph& graph,
                       const path_handle_t& paths,
                       const uint64_t& nthreads);
+    // an empty index, to be filled by load
+    path_step_index_t(void) = default;
+    path_step_index_t(const path_step_index_t&) = delete;
+    path_step_index_t& operator=(const path_step_index_t&) = delete;
     ~path_step_index_t(void);
+    // the steps are written as they are, so an index is only valid for the graph it was built on
+    void serialize(std::ostream& out) const;
+    // read an index written by serialize, false if the stream does not hold one
+    bool load(std::istream& in);
     // map from node id in the path to an index in node_offsets
     boophf_uint64_t* node_mphf = nullptr;
     // map to the beginning of a range in node_steps
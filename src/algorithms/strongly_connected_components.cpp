@@ -1,5 +1,7 @@
 #include "strongly_connected_components.hpp"
 
+#include <limits>
+
 namespace odgi {
 namespace algorithms {
 
@@ -144,5 +146,300 @@ using namespace handlegraph;
         return components;
     }
 
+    vector<ska::flat_hash_set<handlegraph::nid_t>> strongly_connected_components(const HandleGraph* handle_graph,
+                                                                                 const uint64_t& nthreads) {
+        if (nthreads <= 1) {
+            return strongly_connected_components(handle_graph);
+        }
+
+        // number the handles 2 * node index + is_reverse, with node indexes by id - min id when ids are compact
+        const uint64_t node_count = handle_graph->get_node_count();
+        vector<handle_t> nodes;
+        nodes.reserve(node_count);
+        handle_graph->for_each_handle([&](const handle_t& handle) {
+            nodes.push_back(handle_graph->forward(handle));
+        });
+        const handlegraph::nid_t min_id = node_count ? handle_graph->min_node_id() : 0;
+        const bool dense = node_count && (uint64_t) (handle_graph->max_node_id() - min_id) + 1 == node_count;
+        ska::flat_hash_map<handlegraph::nid_t, uint64_t> sparse_index;
+        if (!dense) {
+            sparse_index.reserve(node_count);
+            for (uint64_t i = 0; i < nodes.size(); ++i) {
+                sparse_index[handle_graph->get_id(nodes[i])] = i;
+            }
+        }
+        auto index_of = [&](const handle_t& handle) -> uint64_t {
+            const handlegraph::nid_t id = handle_graph->get_id(handle);
+            return 2 * (dense ? id - min_id : sparse_index.at(id)) + handle_graph->get_is_reverse(handle);
+        };
+        auto handle_of = [&](const uint64_t& v) -> handle_t {
+            return v & 1 ? handle_graph->flip(nodes[v >> 1]) : nodes[v >> 1];
+        };
+        auto for_each_next = [&](const uint64_t& v, bool go_left, const std::function<void(const uint64_t&)>& lambda) {
+            handle_graph->follow_edges(handle_of(v), go_left, [&](const handle_t& next) {
+                lambda(index_of(next));
+            });
+        };
+
+        const uint64_t vertex_count = 2 * node_count;
+        const uint64_t unassigned = std::numeric_limits<uint64_t>::max();
+        vector<uint64_t> component_of(vertex_count, unassigned);
+        std::atomic<uint64_t> next_component(0);
+
+        // trim the handles that cannot be on a cycle, like in Kahn's algorithm from both ends at once
+        {
+            vector<std::atomic<uint64_t>> in_degree(vertex_count);
+            vector<std::atomic<uint64_t>> out_degree(vertex_count);
+            vector<std::atomic<bool>> trimmed(vertex_count);
+            vector<uint64_t> frontier;
+#pragma omp parallel num_threads(nthreads)
+            {
+                vector<uint64_t> local;
+#pragma omp for schedule(dynamic, 4096)
+                for (uint64_t v = 0; v < vertex_count; ++v) {
+                    uint64_t in = 0, out = 0;
+                    for_each_next(v, true, [&](const uint64_t&) { ++in; });
+                    for_each_next(v, false, [&](const uint64_t&) { ++out; });
+                    in_degree[v].store(in, std::memory_order_relaxed);
+                    out_degree[v].store(out, std::memory_order_relaxed);
+                    trimmed[v].store(false, std::memory_order_relaxed);
+                    if (in == 0 || out == 0) {
+                        local.push_back(v);
+                    }
+                }
+#pragma omp critical (scc_frontier)
+                frontier.insert(frontier.end(), local.begin(), local.end());
+            }
+            while (!frontier.empty()) {
+                vector<uint64_t> next_frontier;
+#pragma omp parallel num_threads(nthreads)
+                {
+                    vector<uint64_t> local;
+#pragma omp for schedule(dynamic, 1024)
+                    for (uint64_t i = 0; i < frontier.size(); ++i) {
+                        const uint64_t v = frontier[i];
+                        if (trimmed[v].exchange(true)) {
+                            continue;
+                        }
+                        component_of[v] = next_component.fetch_add(1);
+                        for_each_next(v, false, [&](const uint64_t& w) {
+                            if (in_degree[w].fetch_sub(1) == 1) {
+                                local.push_back(w);
+                            }
+                        });
+                        for_each_next(v, true, [&](const uint64_t& u) {
+                            if (out_degree[u].fetch_sub(1) == 1) {
+                                local.push_back(u);
+                            }
+                        });
+                    }
+#pragma omp critical (scc_frontier)
+                    next_frontier.insert(next_frontier.end(), local.begin(), local.end());
+                }
+                frontier.swap(next_frontier);
+            }
+        }
+
+        // the parts of the graph still to split, as lists of handles that share a color
+        vector<uint64_t> color(vertex_count, 0);
+        uint64_t next_color = 1;
+        vector<vector<uint64_t>> parts(1);
+        for (uint64_t v = 0; v < vertex_count; ++v) {
+            if (component_of[v] == unassigned) {
+                parts[0].push_back(v);
+            }
+        }
+        // parts below this size are cheaper to finish on a single thread
+        const uint64_t serial_part_size = 1 << 16;
+        const uint8_t reached_forward = 1;
+        const uint8_t reached_backward = 2;
+        vector<std::atomic<uint8_t>> reached(vertex_count);
+#pragma omp parallel for schedule(static) num_threads(nthreads)
+        for (uint64_t v = 0; v < vertex_count; ++v) {
+            reached[v].store(0, std::memory_order_relaxed);
+        }
+
+        // Tarjan's algorithm on the handles of one color, with an explicit stack
+        auto tarjan = [&](const vector<uint64_t>& part) {
+            const uint64_t part_color = color[part.front()];
+            auto in_part = [&](const uint64_t& w) {
+                return color[w] == part_color && component_of[w] == unassigned;
+            };
+            ska::flat_hash_map<uint64_t, uint64_t> discovered;
+            ska::flat_hash_map<uint64_t, uint64_t> lowlink;
+            ska::flat_hash_set<uint64_t> on_stack;
+            vector<uint64_t> scc_stack;
+            // each frame is a handle and the successors it still has to visit
+            vector<std::pair<uint64_t, vector<uint64_t>>> frames;
+            uint64_t index = 0;
+            auto open = [&](const uint64_t& v) {
+                discovered[v] = lowlink[v] = index++;
+                scc_stack.push_back(v);
+                on_stack.insert(v);
+                frames.emplace_back(v, vector<uint64_t>());
+                for_each_next(v, false, [&](const uint64_t& w) {
+                    if (in_part(w)) {
+                        frames.back().second.push_back(w);
+                    }
+                });
+            };
+            for (auto& root : part) {
+                if (discovered.count(root)) {
+                    continue;
+                }
+                open(root);
+                while (!frames.empty()) {
+                    const uint64_t v = frames.back().first;
+                    auto& successors = frames.back().second;
+                    if (!successors.empty()) {
+                        const uint64_t w = successors.back();
+                        successors.pop_back();
+                        if (!discovered.count(w)) {
+                            open(w);
+                        } else if (on_stack.count(w)) {
+                            lowlink[v] = std::min(lowlink[v], discovered[w]);
+                        }
+                        continue;
+                    }
+                    frames.pop_back();
+                    if (!frames.empty()) {
+                        uint64_t& parent_lowlink = lowlink[frames.back().first];
+                        parent_lowlink = std::min(parent_lowlink, lowlink[v]);
+                    }
+                    if (lowlink[v] == discovered[v]) {
+                        const uint64_t component = next_component.fetch_add(1);
+                        uint64_t w;
+                        do {
+                            w = scc_stack.back();
+                            scc_stack.pop_back();
+                            on_stack.erase(w);
+                            component_of[w] = component;
+                        } while (w != v);
+                    }
+                }
+            }
+        };
+
+        // search from the handles in frontier along edges to the given side, within one color, marking them
+        auto parallel_reach = [&](vector<uint64_t> frontier, const uint64_t& part_color,
+                                  const bool& go_left, const uint8_t& mark) {
+            while (!frontier.empty()) {
+                vector<uint64_t> next_frontier;
+#pragma omp parallel num_threads(nthreads)
+                {
+                    vector<uint64_t> local;
+#pragma omp for schedule(dynamic, 1024)
+                    for (uint64_t i = 0; i < frontier.size(); ++i) {
+                        for_each_next(frontier[i], go_left, [&](const uint64_t& w) {
+                            if (color[w] == part_color && component_of[w] == unassigned
+                                && !(reached[w].fetch_or(mark) & mark)) {
+                                local.push_back(w);
+                            }
+                        });
+                    }
+#pragma omp critical (scc_frontier)
+                    next_frontier.insert(next_frontier.end(), local.begin(), local.end());
+                }
+                frontier.swap(next_frontier);
+            }
+        };
+
+        while (!parts.empty()) {
+            vector<vector<uint64_t>> small_parts;
+            vector<vector<uint64_t>> next_parts;
+            for (auto& part : parts) {
+                if (part.empty()) {
+                    continue;
+                }
+                if (part.size() < serial_part_size) {
+                    small_parts.push_back(std::move(part));
+                    continue;
+                }
+                // forward-backward split: the handles reached both ways from the pivot are its component
+                const uint64_t part_color = color[part.front()];
+                const uint64_t pivot = part[part.size() / 2];
+                reached[pivot].store(reached_forward | reached_backward);
+                parallel_reach({pivot}, part_color, false, reached_forward);
+                parallel_reach({pivot}, part_color, true, reached_backward);
+                const uint64_t component = next_component.fetch_add(1);
+                const uint64_t forward_color = next_color++;
+                const uint64_t backward_color = next_color++;
+                const uint64_t rest_color = next_color++;
+#pragma omp parallel for schedule(static) num_threads(nthreads)
+                for (uint64_t i = 0; i < part.size(); ++i) {
+                    const uint64_t v = part[i];
+                    const uint8_t m = reached[v].exchange(0);
+                    if (m == (reached_forward | reached_backward)) {
+                        component_of[v] = component;
+                    } else if (m == reached_forward) {
+                        color[v] = forward_color;
+                    } else if (m == reached_backward) {
+                        color[v] = backward_color;
+                    } else {
+                        color[v] = rest_color;
+                    }
+                }
+                vector<uint64_t> forward_part, backward_part, rest_part;
+                for (auto& v : part) {
+                    if (component_of[v] != unassigned) {
+                        continue;
+                    }
+                    if (color[v] == forward_color) {
+                        forward_part.push_back(v);
+                    } else if (color[v] == backward_color) {
+                        backward_part.push_back(v);
+                    } else {
+                        rest_part.push_back(v);
+                    }
+                }
+                vector<uint64_t>().swap(part);
+                next_parts.push_back(std::move(forward_part));
+                next_parts.push_back(std::move(backward_part));
+                next_parts.push_back(std::move(rest_part));
+            }
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+            for (uint64_t i = 0; i < small_parts.size(); ++i) {
+                tarjan(small_parts[i]);
+            }
+            parts.swap(next_parts);
+        }
+
+        // A component and its reverse complement have the same node ids, so keep the one with the lower number.
+        vector<uint64_t> component_size(next_component.load(), 0);
+        vector<uint64_t> first_handle(component_size.size(), unassigned);
+        for (uint64_t v = 0; v < vertex_count; ++v) {
+            const uint64_t c = component_of[v];
+            if (first_handle[c] == unassigned) {
+                first_handle[c] = v;
+            }
+            ++component_size[c];
+        }
+        vector<uint64_t> kept;
+        for (uint64_t c = 0; c < component_size.size(); ++c) {
+            if (first_handle[c] != unassigned && c <= component_of[first_handle[c] ^ 1]) {
+                kept.push_back(c);
+            }
+        }
+        vector<uint64_t> slot_of(component_size.size(), unassigned);
+        for (uint64_t i = 0; i < kept.size(); ++i) {
+            slot_of[kept[i]] = i;
+        }
+        vector<vector<handlegraph::nid_t>> members(kept.size());
+        for (uint64_t v = 0; v < vertex_count; ++v) {
+            const uint64_t slot = slot_of[component_of[v]];
+            if (slot != unassigned) {
+                members[slot].push_back(handle_graph->get_id(nodes[v >> 1]));
+            }
+        }
+        vector<ska::flat_hash_set<handlegraph::nid_t>> components(kept.size());
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+        for (uint64_t i = 0; i < kept.size(); ++i) {
+            components[i].reserve(members[i].size());
+            components[i].insert(members[i].begin(), members[i].end());
+            vector<handlegraph::nid_t>().swap(members[i]);
+        }
+        return components;
+    }
+
 }
 }
@@ -4,6 +4,8 @@
 #include <handlegraph/handle_graph.hpp>
 #include "hash_map.hpp"
 #include "dfs.hpp"
+#include <atomic>
+#include <omp.h>
 
 namespace odgi {
 namespace algorithms {
@@ -13,6 +15,14 @@ using namespace handlegraph;
 
 /// Find all of the nodes with no edges on their left sides.
 vector<ska::flat_hash_set<handlegraph::nid_t>> strongly_connected_components(const HandleGraph* g);
+
+/// The same components, found without recursion in nthreads threads. Handles with no live inputs or
+/// outputs are trimmed off as singletons first, then the rest is split by forward-backward searches
+/// from a pivot, in parallel, until the parts are small enough to finish with Tarjan's algorithm on
+/// one thread each. Components come out ordered by their discovery rather than in reverse
+/// topological order.
+vector<ska::flat_hash_set<handlegraph::nid_t>> strongly_connected_components(const HandleGraph* g,
+                                                                             const uint64_t& nthreads);
     
 }
 }
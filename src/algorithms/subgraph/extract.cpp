@@ -1,4 +1,9 @@
 #include "extract.hpp"
+#include <limits>
+#include <numeric>
+#include <queue>
+#include "flat_hash_map.hpp"
+#include "algorithms/path_tasks.hpp"
 
 namespace odgi {
     namespace algorithms {
@@ -74,9 +79,14 @@ namespace odgi {
             std::vector<std::vector<std::pair<uint64_t, uint64_t>>> subpath_ranges;
             subpath_ranges.resize(source_paths.size());
 
+            // the walks are as long as the paths, so the longest go first, and idle threads steal
+            std::vector<uint64_t> path_step_counts;
+            for (auto &source_path_handle : source_paths) {
+                path_step_counts.push_back(source.get_step_count(source_path_handle));
+            }
+
             // Search subpaths in parallel
-#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
-            for (uint64_t path_rank = 0; path_rank < source_paths.size(); ++path_rank) {
+            run_tasks(path_step_counts, num_threads, [&](const uint64_t &path_rank, const uint64_t &) {
                 auto &source_path_handle = source_paths[path_rank];
                 const std::string path_name = source.get_path_name(source_path_handle);
 
@@ -112,7 +122,7 @@ namespace odgi {
                 if (show_progress) {
                     progress->increment(1);
                 }
-            }
+            });
 
             // Create subpaths
             for (uint64_t path_rank = 0; path_rank < source_paths.size(); ++path_rank) {
@@ -130,8 +140,7 @@ namespace odgi {
             }
 
             // Fill subpaths in parallel
-#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
-            for (uint64_t path_rank = 0; path_rank < source_paths.size(); ++path_rank) {
+            run_tasks(path_step_counts, num_threads, [&](const uint64_t &path_rank, const uint64_t &) {
                 if (!subpath_ranges[path_rank].empty()) {
                     const auto &source_path_handle = source_paths[path_rank];
                     const std::string path_name = source.get_path_name(source_path_handle);
@@ -171,6 +180,130 @@ namespace odgi {
                     });
                 }
 
+                if (show_progress) {
+                    progress->increment(1);
+                }
+            });
+
+            if (show_progress) {
+                progress->finish();
+            }
+        }
+
+        /// The runs of consecutive steps of a path on the nodes of a subgraph
+        struct subgraph_run_t {
+            uint32_t subgraph;
+            uint64_t start;
+            uint64_t end;
+            step_handle_t first_step;
+            step_handle_t last_step;
+            uint64_t step_count;
+            uint64_t last_step_rank;
+        };
+
+        /// Find the runs of each source path in all subgraphs, in the order of the path, walking each path once
+        static void find_subgraph_runs(const graph_t &source, const std::vector<path_handle_t> &source_paths,
+                                       const std::vector<graph_t> &subgraphs,
+                                       std::vector<std::vector<subgraph_run_t>> &path_runs,
+                                       const uint64_t num_threads,
+                                       algorithms::progress_meter::ProgressMeter *progress) {
+            // The subgraphs holding each node, at [node_offsets[rank], node_offsets[rank + 1]) for the rank of its id
+            const nid_t shift = source.min_node_id();
+            std::vector<uint64_t> node_offsets(source.get_node_count() + 2, 0);
+            for (auto &subgraph : subgraphs) {
+                subgraph.for_each_handle([&](const handle_t &h) {
+                    ++node_offsets[subgraph.get_id(h) - shift + 2];
+                });
+            }
+            for (uint64_t i = 2; i < node_offsets.size(); ++i) {
+                node_offsets[i] += node_offsets[i - 1];
+            }
+            std::vector<uint32_t> node_subgraphs(node_offsets.back());
+            for (uint32_t g = 0; g < subgraphs.size(); ++g) {
+                subgraphs[g].for_each_handle([&](const handle_t &h) {
+                    node_subgraphs[node_offsets[subgraphs[g].get_id(h) - shift + 1]++] = g;
+                });
+            }
+
+            path_runs.clear();
+            path_runs.resize(source_paths.size());
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+            for (uint64_t path_rank = 0; path_rank < source_paths.size(); ++path_rank) {
+                auto &runs = path_runs[path_rank];
+                // the last run of each subgraph met so far
+                ska::flat_hash_map<uint32_t, uint64_t> last_runs;
+                uint64_t walked = 0;
+                uint64_t step_rank = 0;
+                source.for_each_step_in_path(source_paths[path_rank], [&](const step_handle_t &step) {
+                    const handle_t source_handle = source.get_handle_of_step(step);
+                    const uint64_t source_length = source.get_length(source_handle);
+                    const uint64_t rank = source.get_id(source_handle) - shift;
+                    for (uint64_t j = node_offsets[rank]; j < node_offsets[rank + 1]; ++j) {
+                        const uint32_t g = node_subgraphs[j];
+                        auto f = last_runs.find(g);
+                        if (f != last_runs.end() && runs[f->second].last_step_rank + 1 == step_rank) {
+                            auto &run = runs[f->second];
+                            run.end = walked + source_length;
+                            run.last_step = step;
+                            ++run.step_count;
+                            run.last_step_rank = step_rank;
+                        } else {
+                            last_runs[g] = runs.size();
+                            runs.push_back({g, walked, walked + source_length, step, step, 1, step_rank});
+                        }
+                    }
+                    walked += source_length;
+                    ++step_rank;
+                });
+
+                if (progress) {
+                    progress->increment(1);
+                }
+            }
+        }
+
+        void add_subpaths_to_subgraphs(const graph_t &source, const std::vector<path_handle_t> &source_paths,
+                                       std::vector<graph_t> &subgraphs, const uint64_t num_threads,
+                                       const std::string &progress_message) {
+            const bool show_progress = !progress_message.empty();
+
+            std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress;
+            if (show_progress) {
+                progress = std::make_unique<algorithms::progress_meter::ProgressMeter>(
+                        source_paths.size() + subgraphs.size(), progress_message);
+            }
+
+            // Search subpaths in parallel
+            std::vector<std::vector<subgraph_run_t>> path_runs;
+            find_subgraph_runs(source, source_paths, subgraphs, path_runs, num_threads, progress.get());
+
+            // Create and fill the subpaths of each subgraph in parallel, in the order of the paths
+            std::vector<std::vector<std::pair<uint64_t, uint64_t>>> subgraph_runs(subgraphs.size());
+            for (uint64_t path_rank = 0; path_rank < source_paths.size(); ++path_rank) {
+                for (uint64_t i = 0; i < path_runs[path_rank].size(); ++i) {
+                    subgraph_runs[path_runs[path_rank][i].subgraph].push_back({path_rank, i});
+                }
+            }
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+            for (uint64_t g = 0; g < subgraphs.size(); ++g) {
+                graph_t &subgraph = subgraphs[g];
+                for (auto &path_run : subgraph_runs[g]) {
+                    const path_handle_t source_path_handle = source_paths[path_run.first];
+                    const subgraph_run_t &run = path_runs[path_run.first][path_run.second];
+                    const path_handle_t subpath_handle = create_subpath(
+                            subgraph, make_path_name(source.get_path_name(source_path_handle), run.start, run.end),
+                            source.get_is_circular(source_path_handle));
+                    std::vector<handle_t> handles;
+                    handles.reserve(run.step_count);
+                    step_handle_t step = run.first_step;
+                    for (uint64_t k = 0; k < run.step_count; ++k, step = source.get_next_step(step)) {
+                        const handle_t source_handle = source.get_handle_of_step(step);
+                        handles.push_back(subgraph.get_handle(source.get_id(source_handle),
+                                                              source.get_is_reverse(source_handle)));
+                    }
+                    subgraph.append_steps(subpath_handle, handles);
+                }
+
                 if (show_progress) {
                     progress->increment(1);
                 }
@@ -181,6 +314,127 @@ namespace odgi {
             }
         }
 
+        void merge_close_subpaths_of_subgraphs(const graph_t &source, const std::vector<path_handle_t> &source_paths,
+                                               std::vector<graph_t> &subgraphs, const uint64_t max_dist_subpaths,
+                                               const uint64_t num_iterations, const uint64_t num_threads,
+                                               const bool show_progress) {
+            // Iterate multiple times to merge subpaths which became mergeable during the first iteration where new nodes were added
+            for (uint64_t i = 0; i < num_iterations; ++i) {
+                std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress;
+                if (show_progress) {
+                    progress = std::make_unique<algorithms::progress_meter::ProgressMeter>(
+                            source_paths.size(), "[odgi::extract] merge subpaths closer than " + std::to_string(max_dist_subpaths) + " bps - iteration " +
+                                                 std::to_string(i + 1) + " (max " + std::to_string(num_iterations) + ")");
+                }
+
+                std::vector<std::vector<subgraph_run_t>> path_runs;
+                find_subgraph_runs(source, source_paths, subgraphs, path_runs, num_threads, progress.get());
+
+                if (show_progress) {
+                    progress->finish();
+                }
+
+                // The steps between two runs of a path in the same subgraph, the last one not included.
+                // Those before the first run and after the last one are not considered.
+                std::vector<std::vector<std::pair<step_handle_t, step_handle_t>>> short_missing_subpaths(subgraphs.size());
+                uint64_t missing_count = 0;
+                for (auto &runs : path_runs) {
+                    ska::flat_hash_map<uint32_t, uint64_t> last_runs;
+                    for (uint64_t r = 0; r < runs.size(); ++r) {
+                        auto f = last_runs.find(runs[r].subgraph);
+                        if (f != last_runs.end() && runs[r].start - runs[f->second].end <= max_dist_subpaths) {
+                            short_missing_subpaths[runs[r].subgraph].push_back(
+                                    {source.get_next_step(runs[f->second].last_step), runs[r].first_step});
+                            ++missing_count;
+                        }
+                        last_runs[runs[r].subgraph] = r;
+                    }
+                }
+
+                if (missing_count == 0) {
+                    break; // Nothing mergeable, do not waste time in further iterations
+                }
+
+                // Restore short subpaths by adding the associated handles
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+                for (uint64_t g = 0; g < subgraphs.size(); ++g) {
+                    graph_t &subgraph = subgraphs[g];
+                    for (auto &range : short_missing_subpaths[g]) {
+                        for (step_handle_t step = range.first; step != range.second; step = source.get_next_step(step)) {
+                            handle_t h = source.get_handle_of_step(step);
+                            const uint64_t id = source.get_id(h);
+                            // To avoid adding multiple times the same node
+                            if (!subgraph.has_node(id)) {
+                                if (source.get_is_reverse(h)) {
+                                    h = source.flip(h); // All handles are added in forward in the subgraph
+                                }
+                                subgraph.create_handle(source.get_sequence(h), id);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        void find_path_range_steps(const graph_t &source, std::vector<path_range_t> &path_ranges,
+                                   std::vector<step_handle_t> &first_steps, const uint64_t num_threads) {
+            first_steps.assign(path_ranges.size(), step_handle_t());
+
+            // The ranges of each path, by start
+            std::vector<uint64_t> order(path_ranges.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::sort(order.begin(), order.end(), [&](const uint64_t &a, const uint64_t &b) {
+                return as_integer(path_ranges[a].begin.path) < as_integer(path_ranges[b].begin.path)
+                       || (path_ranges[a].begin.path == path_ranges[b].begin.path
+                           && path_ranges[a].begin.offset < path_ranges[b].begin.offset);
+            });
+            std::vector<uint64_t> path_begins;
+            for (uint64_t i = 0; i < order.size(); ++i) {
+                if (i == 0 || path_ranges[order[i]].begin.path != path_ranges[order[i - 1]].begin.path) {
+                    path_begins.push_back(i);
+                }
+            }
+            const uint64_t path_count = path_begins.size();
+            path_begins.push_back(order.size());
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+            for (uint64_t k = 0; k < path_count; ++k) {
+                const path_handle_t path_handle = path_ranges[order[path_begins[k]]].begin.path;
+                const auto path_end = source.path_end(path_handle);
+                for (uint64_t i = path_begins[k]; i < path_begins[k + 1]; ++i) {
+                    first_steps[order[i]] = path_end;
+                }
+
+                // the ranges met and not yet passed, by their original end
+                std::priority_queue<std::pair<uint64_t, uint64_t>,
+                        std::vector<std::pair<uint64_t, uint64_t>>,
+                        std::greater<std::pair<uint64_t, uint64_t>>> open_ranges;
+                uint64_t next = path_begins[k];
+                uint64_t walked = 0;
+                for (step_handle_t cur_step = source.path_begin(path_handle);
+                     cur_step != path_end && (next < path_begins[k + 1] || !open_ranges.empty());
+                     cur_step = source.get_next_step(cur_step)) {
+                    const uint64_t length = source.get_length(source.get_handle_of_step(cur_step));
+                    for (; next < path_begins[k + 1] && path_ranges[order[next]].begin.offset < walked + length; ++next) {
+                        auto &path_range = path_ranges[order[next]];
+                        if (path_range.end.offset > walked) {
+                            first_steps[order[next]] = cur_step;
+                            open_ranges.push({path_range.end.offset, order[next]});
+                            path_range.begin.offset = walked;
+                        }
+                    }
+                    walked += length;
+                    for (; !open_ranges.empty() && open_ranges.top().first <= walked; open_ranges.pop()) {
+                        path_ranges[open_ranges.top().second].end.offset = walked;
+                    }
+                }
+                // the ranges going beyond the end of the path
+                for (; !open_ranges.empty(); open_ranges.pop()) {
+                    path_ranges[open_ranges.top().second].end.offset = walked;
+                }
+            }
+        }
+
         void extract_path_range(const graph_t &source, path_handle_t path_handle, int64_t start, int64_t end,
                                 graph_t &subgraph) {
             algorithms::for_handle_in_path_range(
@@ -289,37 +543,50 @@ namespace odgi {
 
         void
         expand_subgraph_by_length(const graph_t &source, graph_t &subgraph, const uint64_t &length, bool forward_only) {
-            uint64_t accumulated_length = 0;
-            std::vector<handle_t> curr_handles;
+            if (subgraph.get_node_count() == 0 || length == 0) {
+                return;
+            }
+            // A Dijkstra search from all nodes of the subgraph at once, where reaching a node costs the length of the
+            // nodes crossed since leaving the subgraph. Each node closer than length bases is added once, when it is
+            // settled, and nothing beyond that bound is ever queued, so the search stops exactly at the limit.
+            const nid_t shift = source.min_node_id();
+            std::vector<uint64_t> distance(source.get_node_count(), std::numeric_limits<uint64_t>::max());
+            typedef std::pair<uint64_t, uint64_t> dist_rank_t;
+            std::priority_queue<dist_rank_t, std::vector<dist_rank_t>, std::greater<dist_rank_t>> queue;
+            auto reach_from = [&](const handle_t &h, const uint64_t &dist_across) {
+                auto reach = [&](const handle_t &c) {
+                    const uint64_t rank = source.get_id(c) - shift;
+                    if (dist_across < distance[rank]) {
+                        distance[rank] = dist_across;
+                        queue.push({dist_across, rank});
+                    }
+                };
+                source.follow_edges(h, false, reach);
+                if (!forward_only) {
+                    source.follow_edges(h, true, reach);
+                }
+            };
+            std::vector<handle_t> seeds;
             subgraph.for_each_handle([&](const handle_t &h) {
-                curr_handles.push_back(h);
+                distance[subgraph.get_id(h) - shift] = 0;
+                seeds.push_back(source.get_handle(subgraph.get_id(h)));
             });
-            while (accumulated_length < length && !curr_handles.empty()) {
-                std::vector<handle_t> next_handles;
-                for (auto &h : curr_handles) {
-                    const handle_t old_h = source.get_handle(subgraph.get_id(h));
-                    source.follow_edges(old_h, false, [&](const handle_t &c) {
-                        if (!subgraph.has_node(source.get_id(c))) {
-                            const handle_t x = subgraph.create_handle(
-                                    source.get_sequence(source.get_is_reverse(c) ? source.flip(c) : c),
-                                    source.get_id(c));
-                            next_handles.push_back(x);
-                            accumulated_length += subgraph.get_length(x);
-                        }
-                    });
-                    if (!forward_only) {
-                        source.follow_edges(old_h, true, [&](const handle_t &c) {
-                            if (!subgraph.has_node(source.get_id(c))) {
-                                const handle_t x = subgraph.create_handle(
-                                        source.get_sequence(source.get_is_reverse(c) ? source.flip(c) : c),
-                                        source.get_id(c));
-                                next_handles.push_back(x);
-                                accumulated_length += subgraph.get_length(x);
-                            }
-                        });
-                    }
+            // the neighbors of the subgraph are at distance 0
+            for (auto &h : seeds) {
+                reach_from(h, 0);
+            }
+            while (!queue.empty()) {
+                const dist_rank_t here = queue.top();
+                queue.pop();
+                if (here.first > distance[here.second]) {
+                    continue; // already settled closer
+                }
+                const handle_t h = source.get_handle(here.second + shift);
+                subgraph.create_handle(source.get_sequence(h), here.second + shift);
+                const uint64_t dist_across = here.first + source.get_length(h);
+                if (dist_across < length) {
+                    reach_from(h, dist_across);
                 }
-                curr_handles = std::move(next_handles);
             }
         }
 
@@ -400,11 +667,12 @@ namespace odgi {
                 const std::vector<path_handle_t>& paths,
                 const std::function<bool(handle_t)>& in_bounds,
                 const uint64_t& length,
-                const std::function<void(const std::vector<path_range_t>&)>& output,
+                const std::function<void(const uint64_t&, const std::vector<path_range_t>&)>& output,
                 const uint64_t& num_threads) {
 
 #pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
-            for (path_handle_t path : paths) {
+            for (uint64_t path_index = 0; path_index < paths.size(); ++path_index) {
+                const path_handle_t path = paths[path_index];
                 std::vector<path_range_t> path_ranges;
 
                 uint64_t walked = 0;
@@ -454,7 +722,7 @@ namespace odgi {
                     }
                 }
 
-                output(path_ranges);
+                output(path_index, path_ranges);
             }
         }
 
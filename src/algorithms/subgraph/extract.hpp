@@ -28,6 +28,24 @@ namespace odgi {
                                       graph_t &subgraph, uint64_t num_threads,
                                       const std::string &progress_message = "");
 
+        /// add subpaths to each of the subgraphs like add_subpaths_to_subgraph, but walking each source path
+        /// only once for all of them: each step is handed to every subgraph holding its node
+        void add_subpaths_to_subgraphs(const graph_t &source, const std::vector<path_handle_t> &source_paths,
+                                       std::vector<graph_t> &subgraphs, uint64_t num_threads,
+                                       const std::string &progress_message = "");
+
+        /// merge the subpaths of each subgraph closer than max_dist_subpaths along a source path, by adding the nodes
+        /// between them, walking each source path only once per iteration for all subgraphs
+        void merge_close_subpaths_of_subgraphs(const graph_t &source, const std::vector<path_handle_t> &source_paths,
+                                               std::vector<graph_t> &subgraphs, uint64_t max_dist_subpaths,
+                                               uint64_t num_iterations, uint64_t num_threads,
+                                               bool show_progress);
+
+        /// extend the path ranges to whole nodes, as extract does not cut them, and find the first step of each, or
+        /// the path end if the range holds no step; the ranges of each path are found in a single walk along it
+        void find_path_range_steps(const graph_t &source, std::vector<path_range_t> &path_ranges,
+                                   std::vector<step_handle_t> &first_steps, uint64_t num_threads);
+
         void extract_path_range(const graph_t &source, path_handle_t path_handle, int64_t start, int64_t end,
                                 graph_t &subgraph);
 
@@ -47,12 +65,13 @@ namespace odgi {
         void embed_lace_paths(graph_t &source, graph_t &subgraph,
                               const std::vector<path_handle_t>& lace_paths);
 
+        /// Call output with the index of each path in paths and its ranges, as the paths are done in parallel
         void windows_in_out(
                 const PathHandleGraph& graph,
                 const std::vector<path_handle_t>& paths,
                 const std::function<bool(handle_t)>& in_bounds,
                 const uint64_t& length,
-                const std::function<void(const std::vector<path_range_t>&)>& output,
+                const std::function<void(const uint64_t&, const std::vector<path_range_t>&)>& output,
                 const uint64_t& num_threads);
 
         bool check_and_get_windows_in_out_parameter(
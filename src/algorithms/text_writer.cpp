@@ -0,0 +1,131 @@
+#include "text_writer.hpp"
+#include "bgzf.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+namespace odgi {
+namespace algorithms {
+
+namespace {
+    // the buffer holds this much text per compressing thread, in chunks of whole BGZF blocks
+    const uint64_t chunk_bytes = 64 * bgzf_block_input_size;
+    const uint64_t plain_capacity = 1ULL << 22;
+}
+
+text_writer_t::text_writer_t(std::ostream& out, const bool& bgzip, const uint64_t& nthreads)
+    : out(out)
+    , bgzip(bgzip)
+    , nthreads(std::max((uint64_t) 1, nthreads))
+    , capacity(bgzip ? chunk_bytes * std::max((uint64_t) 1, nthreads) : plain_capacity) {
+    buffer.reserve(capacity);
+}
+
+text_writer_t::~text_writer_t(void) {
+    finish();
+}
+
+text_writer_t& text_writer_t::operator<<(const double& value) {
+    char digits[32];
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    const auto end = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::general, 6).ptr;
+    return write(digits, end - digits);
+#else
+    // without floating point to_chars (before GCC 11), as the C locale formats it
+    const int length = std::snprintf(digits, sizeof(digits), "%g", value);
+    return write(digits, length);
+#endif
+}
+
+void append_shortest(std::string& text, const double& value) {
+    char digits[32];
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    const auto end = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::general).ptr;
+    text.append(digits, end - digits);
+#else
+    // without floating point to_chars (before GCC 11), as it writes the value: the fewest significant
+    // digits that read back as the value, in fixed notation for decimal exponents from -4 to 5 and in
+    // scientific notation otherwise
+    int precision = 17;
+    // 15 digits cut to their last nonzero one are the fewest for a normal value, a subnormal one may need fewer
+    for (int p = std::fpclassify(value) == FP_SUBNORMAL ? 1 : 15; p < 17; ++p) {
+        std::snprintf(digits, sizeof(digits), "%.*e", p - 1, value);
+        if (std::strtod(digits, nullptr) == value) {
+            precision = p;
+            break;
+        }
+    }
+    int length = std::snprintf(digits, sizeof(digits), "%.*e", precision - 1, value);
+    if (std::isfinite(value)) {
+        // drop the trailing zeros of the mantissa
+        const char* e = std::strchr(digits, 'e');
+        const int exponent = std::atoi(e + 1);
+        for (const char* last = e - 1; precision > 1 && *last == '0'; --last) {
+            --precision;
+        }
+        if (exponent >= -4 && exponent < 6) {
+            length = std::snprintf(digits, sizeof(digits), "%.*f", std::max(0, precision - 1 - exponent), value);
+        } else {
+            length = std::snprintf(digits, sizeof(digits), "%.*e", precision - 1, value);
+        }
+    }
+    text.append(digits, length);
+#endif
+}
+
+void append_fixed(std::string& text, const double& value, const int& decimals) {
+    // the integer part of a double takes up to 309 digits
+    char digits[384];
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    const auto result = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::fixed, decimals);
+    if (result.ec == std::errc()) {
+        text.append(digits, result.ptr - digits);
+        return;
+    }
+#endif
+    const int length = std::snprintf(nullptr, 0, "%.*f", decimals, value);
+    const uint64_t start = text.size();
+    text.resize(start + length + 1);
+    std::snprintf(&text[start], length + 1, "%.*f", decimals, value);
+    text.resize(start + length);
+}
+
+void text_writer_t::flush(void) {
+    if (buffer.empty()) {
+        return;
+    }
+    if (!bgzip) {
+        out.write(buffer.data(), buffer.size());
+    } else {
+        const uint64_t chunks = (buffer.size() + chunk_bytes - 1) / chunk_bytes;
+        std::vector<std::string> compressed(chunks);
+#pragma omp parallel for schedule(static,1) num_threads(nthreads)
+        for (uint64_t i = 0; i < chunks; ++i) {
+            const uint64_t offset = i * chunk_bytes;
+            bgzf_compress(buffer.data() + offset, std::min(chunk_bytes, (uint64_t) buffer.size() - offset), compressed[i]);
+        }
+        for (auto& c : compressed) {
+            out.write(c.data(), c.size());
+        }
+    }
+    buffer.clear();
+}
+
+void text_writer_t::finish(void) {
+    if (finished) {
+        return;
+    }
+    flush();
+    if (bgzip) {
+        out.write(bgzf_eof().data(), bgzf_eof().size());
+    }
+    out.flush();
+    finished = true;
+}
+
+}
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+/**
+ * \file text_writer.hpp
+ *
+ * Defines a buffered writer of large text outputs, like the JSON and TSV of odgi bin, that formats
+ * numbers without going through the locale and formatting machinery of iostreams.
+ */
+
+#include <ostream>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <charconv>
+#include <type_traits>
+
+namespace odgi {
+namespace algorithms {
+
+/// Append the shortest text that reads back as exactly the value, as with %g but with as many
+/// significant digits as it takes, such as "0.1" or "1234.5678901234567"
+void append_shortest(std::string& text, const double& value);
+
+/// Append the value with the given number of decimals, as iostreams write it with std::fixed
+void append_fixed(std::string& text, const double& value, const int& decimals);
+
+/// Append the integer in decimal
+template<typename T>
+void append_integer(std::string& text, const T& value) {
+    char digits[24];
+    const auto end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+    text.append(digits, end - digits);
+}
+
+/// Writes text to a stream through a large buffer, optionally compressed to BGZF (which gzip reads)
+/// on several threads. Numbers come out as iostreams write them by default: integers in decimal,
+/// floating point numbers as with %g, in 6 significant digits. Nothing is written until the buffer
+/// fills up or at flush(), and finish() must be called once at the end to close the BGZF file.
+class text_writer_t {
+public:
+    text_writer_t(std::ostream& out, const bool& bgzip = false, const uint64_t& nthreads = 1);
+    ~text_writer_t(void);
+
+    text_writer_t(const text_writer_t& other) = delete;
+    text_writer_t& operator=(const text_writer_t& other) = delete;
+
+    text_writer_t& operator<<(const char& c) {
+        reserve(1);
+        buffer.push_back(c);
+        return *this;
+    }
+
+    text_writer_t& operator<<(const char* text) {
+        return write(text, std::strlen(text));
+    }
+
+    text_writer_t& operator<<(const std::string& text) {
+        return write(text.data(), text.size());
+    }
+
+    template<typename T>
+    typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, char>::value
+                            && !std::is_same<T, bool>::value, text_writer_t&>::type
+    operator<<(const T& value) {
+        char digits[24];
+        const auto end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+        return write(digits, end - digits);
+    }
+
+    text_writer_t& operator<<(const double& value);
+
+    text_writer_t& write(const char* data, const uint64_t& size) {
+        reserve(size);
+        buffer.append(data, size);
+        return *this;
+    }
+
+    /// Write out what is buffered, in whole BGZF blocks if compressing
+    void flush(void);
+
+    /// Flush, and end the BGZF file; nothing may be written afterwards
+    void finish(void);
+
+private:
+    /// Flush first if the buffer cannot take size more bytes
+    void reserve(const uint64_t& size) {
+        if (buffer.size() + size > capacity) {
+            flush();
+        }
+    }
+
+    std::ostream& out;
+    const bool bgzip;
+    const uint64_t nthreads;
+    const uint64_t capacity;
+    std::string buffer;
+    bool finished = false;
+};
+
+}
+}
@@ -5,114 +5,222 @@ namespace odgi {
 
 		using namespace handlegraph;
 
+		void build_target_indexes(const graph_t& graph,
+								  const std::vector<path_handle_t>& target_paths,
+								  std::vector<std::unique_ptr<path_step_index_t>>& target_indexes,
+								  const uint64_t& num_threads,
+								  const bool& progress) {
+			std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress_meter;
+			if (progress) {
+				progress_meter = std::make_unique<algorithms::progress_meter::ProgressMeter>(
+						target_paths.size(), "[odgi::tips::build_target_indexes] indexing the target paths:");
+			}
+			target_indexes.clear();
+			target_indexes.resize(target_paths.size());
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+			for (uint64_t i = 0; i < target_paths.size(); ++i) {
+				// an empty target is never hit, and can not be indexed
+				if (!graph.is_empty(target_paths[i])) {
+					target_indexes[i] = std::make_unique<path_step_index_t>(graph, target_paths[i], 1);
+				}
+				if (progress) {
+					progress_meter->increment(1);
+				}
+			}
+			if (progress) {
+				progress_meter->finish();
+			}
+		}
+
+		static const char TARGET_INDEX_MAGIC[8] = {'O', 'D', 'G', 'I', 'T', 'I', 'P', 'X'};
+
+		void write_target_indexes(const graph_t& graph,
+								  const std::vector<path_handle_t>& target_paths,
+								  const std::vector<std::unique_ptr<path_step_index_t>>& target_indexes,
+								  const std::string& filename) {
+			std::ofstream out(filename.c_str(), std::ios::binary);
+			out.write(TARGET_INDEX_MAGIC, sizeof(TARGET_INDEX_MAGIC));
+			uint64_t path_count = 0;
+			for (auto& index : target_indexes) {
+				path_count += (index != nullptr);
+			}
+			out.write((const char*) &path_count, sizeof(path_count));
+			for (uint64_t i = 0; i < target_paths.size(); ++i) {
+				if (target_indexes[i]) {
+					const std::string name = graph.get_path_name(target_paths[i]);
+					const uint64_t n = name.size();
+					out.write((const char*) &n, sizeof(n));
+					out.write(name.data(), n);
+					target_indexes[i]->serialize(out);
+				}
+			}
+		}
+
+		bool load_target_indexes(const graph_t& graph,
+								 const std::vector<path_handle_t>& target_paths,
+								 std::vector<std::unique_ptr<path_step_index_t>>& target_indexes,
+								 const std::string& filename) {
+			std::ifstream in(filename.c_str(), std::ios::binary);
+			char magic[sizeof(TARGET_INDEX_MAGIC)];
+			uint64_t path_count = 0;
+			if (!in.read(magic, sizeof(magic))
+				|| !std::equal(magic, magic + sizeof(magic), TARGET_INDEX_MAGIC)
+				|| !in.read((char*) &path_count, sizeof(path_count))) {
+				return false;
+			}
+			ska::flat_hash_map<std::string, uint64_t> path_rank;
+			for (uint64_t i = 0; i < target_paths.size(); ++i) {
+				path_rank[graph.get_path_name(target_paths[i])] = i;
+			}
+			target_indexes.clear();
+			target_indexes.resize(target_paths.size());
+			for (uint64_t i = 0; i < path_count; ++i) {
+				uint64_t n = 0;
+				std::string name;
+				if (!in.read((char*) &n, sizeof(n))) {
+					return false;
+				}
+				name.resize(n);
+				auto index = std::make_unique<path_step_index_t>();
+				if ((n && !in.read(&name[0], n)) || !index->load(in)) {
+					return false;
+				}
+				auto f = path_rank.find(name);
+				if (f != path_rank.end()) {
+					target_indexes[f->second] = std::move(index);
+				}
+			}
+			for (uint64_t i = 0; i < target_paths.size(); ++i) {
+				if (!target_indexes[i] && !graph.is_empty(target_paths[i])) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		// the range of the target's steps on the node in node_steps of its index, empty if the node is not on the target;
+		// the node hash maps any id into its range, so we check that the first step found there is on the node
+		static std::pair<uint64_t, uint64_t> target_steps_on_node(const graph_t& graph,
+																  const path_step_index_t& target_index,
+																  const nid_t& id) {
+			const uint64_t idx = target_index.get_node_idx(id);
+			if (idx >= target_index.node_count) {
+				return {0, 0};
+			}
+			const uint64_t begin = target_index.node_offset[idx];
+			const uint64_t end = target_index.node_offset[idx + 1];
+			if (begin == end || graph.get_id(graph.get_handle_of_step(target_index.node_steps[begin])) != id) {
+				return {0, 0};
+			}
+			return {begin, end};
+		}
+
+		// walk from one end of the query until we hit a node of the target, reporting the best steps of the target there,
+		// false if we never hit it
+		static bool walk_tip(const graph_t& graph,
+							 const path_handle_t& query_path,
+							 const std::string& query_path_name,
+							 const std::string& target_path,
+							 const path_step_index_t& target_index,
+							 const algorithms::step_index_t& step_index,
+							 algorithms::tips_bed_writer& bed_writer_thread,
+							 const bool& walk_from_front,
+							 const uint64_t& n_best_mappings,
+							 const uint64_t& walking_dist,
+							 const bool& report_additional_jaccards) {
+			step_handle_t cur_step = walk_from_front ? graph.path_begin(query_path) : graph.path_back(query_path);
+			while (true) {
+				// did we already hit the given reference path?
+				const auto range = target_steps_on_node(graph, target_index, graph.get_id(graph.get_handle_of_step(cur_step)));
+				if (range.first != range.second) {
+					std::vector<step_handle_t> target_step_handles(target_index.node_steps.begin() + range.first,
+																   target_index.node_steps.begin() + range.second);
+					std::vector<step_jaccard_t> target_jaccard_indices = jaccard_indices_from_step_handles(graph,
+																										   walking_dist,
+																										   cur_step,
+																										   target_step_handles);
+					uint64_t i = 0;
+
+					// report other jaccards as a csv list in the BED
+					std::vector<double> additional_jaccards_to_report;
+					uint64_t start_index = 0 + n_best_mappings;
+					if (!report_additional_jaccards) {
+						start_index = target_jaccard_indices.size();
+					}
+					/// do we even have indices left for reporting?
+					if (!(start_index >= target_jaccard_indices.size())) {
+						for (uint64_t n = start_index; n < target_jaccard_indices.size(); n++) {
+							additional_jaccards_to_report.push_back(target_jaccard_indices[n].jaccard);
+						}
+					}
+					/// only report the Nth final steps
+					for (auto& target_jaccard_index : target_jaccard_indices) {
+						if (i == n_best_mappings) {
+							break;
+						}
+						step_handle_t final_target_step = target_jaccard_index.step;
+						double final_target_jaccard = target_jaccard_index.jaccard;
+
+						uint64_t target_min_pos = step_index.get_position(final_target_step, graph); // 0-based starting position in BED
+						uint64_t target_max_pos = target_min_pos + graph.get_length(graph.get_handle_of_step(final_target_step)); // 1-based ending position in BED
+
+						/// add BED record to queue of the BED writer
+						bed_writer_thread.append(target_path, target_min_pos, target_max_pos,
+												 query_path_name, step_index.get_position(cur_step, graph),
+												 final_target_jaccard, walk_from_front, additional_jaccards_to_report);
+						i++;
+					}
+					return true;
+				}
+				if (walk_from_front ? graph.has_next_step(cur_step) : graph.has_previous_step(cur_step)) {
+					cur_step = walk_from_front ? graph.get_next_step(cur_step) : graph.get_previous_step(cur_step);
+				} else {
+					// did we iterate over all steps and we did not hit the target path?
+					return false;
+				}
+			}
+		}
+
 		void walk_tips(const graph_t& graph,
-					   const std::vector<path_handle_t>& paths,
-					   const path_handle_t& target_path_t,
-					   const std::vector<bool>& target_handles,
-					   algorithms::step_index_t& step_index,
+					   const std::vector<path_handle_t>& query_paths,
+					   const std::vector<path_handle_t>& target_paths,
+					   const std::vector<std::unique_ptr<path_step_index_t>>& target_indexes,
+					   const algorithms::step_index_t& step_index,
 					   const uint64_t& num_threads,
-					   const std::function<step_handle_t(const path_handle_t&)>& get_path_end,
-					   const std::function<step_handle_t(const step_handle_t&)>& get_step,
-					   const std::function<bool(const step_handle_t&)>& has_step,
 					   algorithms::tips_bed_writer& bed_writer_thread,
 					   const bool& progress,
-					   const bool& walk_from_front,
-					   ska::flat_hash_set<std::string>& not_visited_set,
+					   std::vector<std::vector<path_handle_t>>& not_visited,
 					   const uint64_t& n_best_mappings,
 					   const uint64_t& walking_dist,
 					   const bool& report_additional_jaccards) {
 
-			const std::string target_path = graph.get_path_name(target_path_t);
-
+			const uint64_t query_count = query_paths.size();
+			const uint64_t pair_count = target_paths.size() * query_count;
 			std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress_meter;
 			if (progress) {
-				std::string end;
-				if (walk_from_front) {
-					end = "front";
-				} else {
-					end = "back";
-				}
-				std::string progress_message = "[odgi::tips::walk_tips] BED Progress for target path '"
-											   + graph.get_path_name(target_path_t) + "' walking from the " + end + " of all query paths:";
 				progress_meter = std::make_unique<algorithms::progress_meter::ProgressMeter>(
-						paths.size(), progress_message);
+						pair_count, "[odgi::tips::walk_tips] BED Progress walking the tips of all query paths to all target paths:");
 			}
 
+			// one work item per tip, so a few targets with many queries keep all threads busy as well
+			std::vector<uint8_t> visited(pair_count, 0);
 #pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
-			for (auto path : paths) {
+			for (uint64_t k = 0; k < pair_count; ++k) {
+				const uint64_t t = k / query_count;
+				const path_handle_t& target_path_t = target_paths[t];
+				const path_handle_t& path = query_paths[k % query_count];
 				// prevent self tips
 				if (path == target_path_t) {
-					continue;
-				}
-				std::string query_path_name = graph.get_path_name(path);
-				bool tip_reached_target = false;
-				// collecting tips
-				step_handle_t cur_step = get_path_end(path);
-				handle_t cur_h = graph.get_handle_of_step(cur_step);
-				while (!tip_reached_target) {
-					// did we already hit the given reference path?
-					if (target_handles[number_bool_packing::unpack_number(cur_h)]) {
-						std::vector<step_handle_t> target_step_handles;
-						graph.for_each_step_on_handle(
-								cur_h,
-								[&](const step_handle_t& s) {
-									/// we can do these expensive iterations here, because we only have to do it once for each walk
-									if (graph.get_path_handle_of_step(s) == target_path_t) {
-										// collect only the steps for the given target
-										target_step_handles.push_back(s);
-									}
-								});
-
-						std::vector<step_jaccard_t> target_jaccard_indices = jaccard_indices_from_step_handles(graph,
-																											   walking_dist,
-																											   cur_step,
-																											   target_step_handles);
-						uint64_t i = 0;
-
-						// report other jaccards as a csv list in the BED
-						std::vector<double> additional_jaccards_to_report;
-						uint64_t start_index = 0 + n_best_mappings;
-						if (!report_additional_jaccards) {
-							start_index = target_jaccard_indices.size();
-						}
-						/// do we even have indices left for reporting?
-						if (!(start_index >= target_jaccard_indices.size())) {
-							for (uint64_t n = start_index; n < target_jaccard_indices.size(); n++) {
-								additional_jaccards_to_report.push_back(target_jaccard_indices[n].jaccard);
-							}
-						}
-						/// only report the Nth final steps
-						for (auto& target_jaccard_index : target_jaccard_indices) {
-							if (i == n_best_mappings) {
-								break;
-							}
-							step_handle_t final_target_step = target_jaccard_index.step;
-							double final_target_jaccard = target_jaccard_index.jaccard;
-
-							uint64_t target_min_pos = step_index.get_position(final_target_step, graph); // 0-based starting position in BED
-							uint64_t target_max_pos = target_min_pos + graph.get_length(graph.get_handle_of_step(final_target_step)); // 1-based ending position in BED
-
-							/// add BED record to queue of the BED writer
-							bed_writer_thread.append(target_path, target_min_pos, target_max_pos,
-													 query_path_name, step_index.get_position(cur_step, graph),
-													 final_target_jaccard, walk_from_front, additional_jaccards_to_report);
-							i++;
-						}
-						tip_reached_target = true;
-					}
-					if (has_step(cur_step)) {
-						cur_step = get_step(cur_step);
-						cur_h = graph.get_handle_of_step(cur_step);
-					} else {
-						// did we iterate over all steps and we did not hit the query path?
-						tip_reached_target = true;
-#pragma omp critical (not_visited_set)
-						not_visited_set.insert(query_path_name);
-						// do we still want this?
-//						if (progress) {
-//#pragma omp critical (cout)
-//							std::cerr << "[odgi::tips::walk_tips] warning: For target path '" << query_path_name << "' there was no hit!" << std::endl;
-//						}
+					visited[k] = 1;
+				} else if (target_indexes[t]) {
+					const std::string target_path = graph.get_path_name(target_path_t);
+					const std::string query_path_name = graph.get_path_name(path);
+					/// walk from the front, and only if that hits the target, from the back
+					if (walk_tip(graph, path, query_path_name, target_path, *target_indexes[t], step_index,
+								 bed_writer_thread, true, n_best_mappings, walking_dist, report_additional_jaccards)) {
+						walk_tip(graph, path, query_path_name, target_path, *target_indexes[t], step_index,
+								 bed_writer_thread, false, n_best_mappings, walking_dist, report_additional_jaccards);
+						visited[k] = 1;
 					}
 				}
 				if (progress) {
@@ -122,6 +230,13 @@ namespace odgi {
 			if (progress) {
 				progress_meter->finish();
 			}
+
+			not_visited.assign(target_paths.size(), std::vector<path_handle_t>());
+			for (uint64_t k = 0; k < pair_count; ++k) {
+				if (!visited[k]) {
+					not_visited[k / query_count].push_back(query_paths[k % query_count]);
+				}
+			}
 		}
 	}
 }
@@ -6,6 +6,7 @@
 #include "odgi.hpp"
 #include <omp.h>
 #include "hash_map.hpp"
+#include <memory>
 
 /**
  * \file tips.hpp
@@ -18,8 +19,29 @@ namespace odgi {
 
 		using namespace handlegraph;
 
-		/// Iterate over the given paths. We walk from a chosen end (path_start or path_back) until we hit a node of the given query (reference) path(s).
-		/// We record the hit as a BED output.
+		/// Index the steps of each target path by node, one target per thread, so that the walks reaching a
+		/// target node find its steps there without iterating over all steps on the node.
+		void build_target_indexes(const graph_t& graph,
+								  const std::vector<path_handle_t>& target_paths,
+								  std::vector<std::unique_ptr<path_step_index_t>>& target_indexes,
+								  const uint64_t& num_threads,
+								  const bool& progress);
+
+		/// Write the target indexes, keyed by the names of their paths.
+		void write_target_indexes(const graph_t& graph,
+								  const std::vector<path_handle_t>& target_paths,
+								  const std::vector<std::unique_ptr<path_step_index_t>>& target_indexes,
+								  const std::string& filename);
+
+		/// Read the indexes of the target paths from a file written by write_target_indexes for the same graph.
+		/// False if the file is malformed or misses one of the targets.
+		bool load_target_indexes(const graph_t& graph,
+								 const std::vector<path_handle_t>& target_paths,
+								 std::vector<std::unique_ptr<path_step_index_t>>& target_indexes,
+								 const std::string& filename);
+
+		/// Iterate over all pairs of a target and a query path, in parallel. We walk from the front of the query path
+		/// until we hit a node of the target path, and if we did, also from the back. We record the hits as BED output.
 		/// #chrom #start #end #path_name #path_pos #jaccard #from_front #add_jaccards
 		/// #chrom: The query path name.
 		/// #start: The 0-based start position of the query we hit in the node.
@@ -29,19 +51,16 @@ namespace odgi {
 		/// #jaccard: The jaccard index of the query and target path around the region of the step where the query hit the target.
 		/// #walk_from_front: If 1 we walked from the head of the target path. Else we walked from the tail and it is 0.
 		/// add_jaccards: The additional jaccards of candidate reference step(s). Comma-separated.
+		/// The query paths never hitting a target are collected, in query order, in not_visited for each target.
 		void walk_tips(const graph_t& graph,
-				 const std::vector<path_handle_t>& paths,
-				 const path_handle_t& target_path_t,
-				 const std::vector<bool>& target_handles,
-				 algorithms::step_index_t& step_index,
+				 const std::vector<path_handle_t>& query_paths,
+				 const std::vector<path_handle_t>& target_paths,
+				 const std::vector<std::unique_ptr<path_step_index_t>>& target_indexes,
+				 const algorithms::step_index_t& step_index,
 				 const uint64_t& num_threads,
-				 const std::function<step_handle_t(const path_handle_t&)>& get_path_end,
-				 const std::function<step_handle_t(const step_handle_t&)>& get_step,
-				 const std::function<bool(const step_handle_t&)>& has_step,
 				 algorithms::tips_bed_writer& bed_writer_thread,
 				 const bool& progress,
-				 const bool& walk_from_front,
-				 ska::flat_hash_set<std::string>& not_visited_set,
+				 std::vector<std::vector<path_handle_t>>& not_visited,
 				 const uint64_t& n_best_mappings,
 				 const uint64_t& walking_dist,
 				 const bool& report_additional_jaccards);
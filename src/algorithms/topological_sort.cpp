@@ -1,4 +1,7 @@
 #include "topological_sort.hpp"
+#include <atomic>
+#include <queue>
+#include <omp.h>
 
 namespace odgi {
 namespace algorithms {
@@ -366,6 +369,152 @@ std::vector<handle_t> two_way_topological_order(const HandleGraph* g) {
     return result;
 }
 
+std::vector<handle_t> parallel_topological_order(const HandleGraph* g,
+                                                 const uint64_t& nthreads,
+                                                 bool use_heads,
+                                                 bool use_tails,
+                                                 bool progress_reporting) {
+    uint64_t max_handle_rank = 0;
+    g->for_each_handle([&](const handle_t& found) {
+            max_handle_rank = std::max(max_handle_rank,
+                                       number_bool_packing::unpack_number(found));
+        });
+    const uint64_t rank_count = max_handle_rank + 1;
+    const uint64_t node_count = g->get_node_count();
+    // ranks can have holes left by deleted nodes
+    std::vector<bool> present(rank_count, false);
+    g->for_each_handle([&](const handle_t& found) {
+            present[number_bool_packing::unpack_number(found)] = true;
+        });
+    // 0 while a node has not been reached, else 1 + the orientation it was first reached in
+    std::vector<std::atomic<uint8_t>> reached(rank_count);
+    // the left-side edges, in that orientation, that are left to follow before the node is ready
+    std::vector<std::atomic<int64_t>> remaining(rank_count);
+    std::vector<std::atomic<bool>> emitted(rank_count);
+
+    auto left_degree = [&](const handle_t& h) {
+        int64_t degree = 0;
+        g->follow_edges(h, true, [&](const handle_t& ignored) { ++degree; });
+        return degree;
+    };
+    // follow one left-side edge into h: 2 if it was the last one, 1 if h was reached first by it, else 0
+    auto arrive = [&](const handle_t& h) -> int {
+        const uint64_t r = number_bool_packing::unpack_number(h);
+        const uint8_t o = 1 + number_bool_packing::unpack_bit(h);
+        uint8_t expected = 0;
+        if (reached[r].compare_exchange_strong(expected, o)) {
+            // count our own edge right away
+            const int64_t degree = left_degree(h);
+            return remaining[r].fetch_add(degree - 1) + degree - 1 == 0 ? 2 : 1;
+        } else if (expected == o) {
+            return remaining[r].fetch_sub(1) == 1 ? 2 : 0;
+        }
+        // an edge into the right side of a node reached the other way round
+        return 0;
+    };
+
+    // the heads or tails make up the first frontier
+    std::vector<uint64_t> frontier;
+    if (use_heads || use_tails) {
+        std::vector<std::vector<uint64_t>> seeds(nthreads);
+#pragma omp parallel for schedule(dynamic, 4096) num_threads(nthreads)
+        for (uint64_t r = 0; r < rank_count; ++r) {
+            if (present[r]) {
+                bool seed = true;
+                g->follow_edges(number_bool_packing::pack(r, false), use_heads, [&](const handle_t& ignored) {
+                        seed = false;
+                        return false;
+                    });
+                if (seed) {
+                    seeds[omp_get_thread_num()].push_back(r);
+                }
+            }
+        }
+        for (auto& s : seeds) {
+            frontier.insert(frontier.end(), s.begin(), s.end());
+        }
+        std::sort(frontier.begin(), frontier.end());
+        for (auto& r : frontier) {
+            reached[r].store(1);
+            emitted[r].store(true);
+        }
+    }
+
+    std::unique_ptr<progress_meter::ProgressMeter> progress;
+    if (progress_reporting) {
+        std::string banner = "[odgi::parallel_topological_order] sorting nodes:";
+        progress = std::make_unique<progress_meter::ProgressMeter>(node_count, banner);
+    }
+
+    std::vector<handle_t> sorted;
+    sorted.reserve(node_count);
+    // nodes reached but not ready yet, the lowest ranked is the next cycle entry point
+    std::priority_queue<uint64_t, std::vector<uint64_t>, std::greater<uint64_t>> pending;
+    uint64_t next_unreached = 0;
+    std::vector<std::vector<uint64_t>> next_local(nthreads);
+    std::vector<std::vector<uint64_t>> pending_local(nthreads);
+    while (sorted.size() < node_count) {
+        if (frontier.empty()) {
+            uint64_t seed = rank_count;
+            while (!pending.empty() && seed == rank_count) {
+                if (!emitted[pending.top()].load()) {
+                    seed = pending.top();
+                }
+                pending.pop();
+            }
+            if (seed == rank_count) {
+                while (!present[next_unreached] || emitted[next_unreached].load()) {
+                    ++next_unreached;
+                }
+                seed = next_unreached;
+                reached[seed].store(1);
+            }
+            emitted[seed].store(true);
+            frontier.push_back(seed);
+        }
+        for (auto& r : frontier) {
+            sorted.push_back(number_bool_packing::pack(r, false));
+        }
+        if (progress_reporting) {
+            progress->increment(frontier.size());
+        }
+#pragma omp parallel for schedule(dynamic, 64) num_threads(nthreads)
+        for (uint64_t i = 0; i < frontier.size(); ++i) {
+            const int tid = omp_get_thread_num();
+            g->follow_edges(number_bool_packing::pack(frontier[i], false), false, [&](const handle_t& next) {
+                    const uint64_t r = number_bool_packing::unpack_number(next);
+                    if (emitted[r].load()) {
+                        return;
+                    }
+                    const int arrival = arrive(next);
+                    if (arrival == 2) {
+                        if (!emitted[r].exchange(true)) {
+                            next_local[tid].push_back(r);
+                        }
+                    } else if (arrival == 1) {
+                        pending_local[tid].push_back(r);
+                    }
+                });
+        }
+        frontier.clear();
+        for (uint64_t t = 0; t < nthreads; ++t) {
+            frontier.insert(frontier.end(), next_local[t].begin(), next_local[t].end());
+            next_local[t].clear();
+            for (auto& r : pending_local[t]) {
+                pending.push(r);
+            }
+            pending_local[t].clear();
+        }
+        std::sort(frontier.begin(), frontier.end());
+    }
+
+    if (progress_reporting) {
+        progress->finish();
+    }
+
+    return sorted;
+}
+
 std::vector<handle_t> lazy_topological_order_internal(const HandleGraph* g, bool lazier) {
     
     // map that will contain the orientation and the in degree for each node
@@ -486,10 +635,10 @@ std::vector<handle_t> breadth_first_topological_order(const HandleGraph& g, cons
 
     // We need to keep track of the nodes we haven't visited to seed subsequent
     // runs of the BFS
-    dyn::succinct_bitvector<dyn::spsi<dyn::packed_vector,256,16> > unvisited;
-    for (uint64_t i = 0; i <= max_handle_rank; ++i) {
-        unvisited.push_back(1);
-    }
+    // a plain bit per rank, with a count and the lowest rank that can still be unvisited
+    std::vector<bool> unvisited(max_handle_rank + 1, true);
+    uint64_t unvisited_count = unvisited.size();
+    uint64_t first_unvisited = 0;
     /*
     g.for_each_handle([&](const handle_t& found) {
                           uint64_t rank = number_bool_packing::unpack_number(found);
@@ -501,7 +650,7 @@ std::vector<handle_t> breadth_first_topological_order(const HandleGraph& g, cons
     uint64_t prev_max_length = 0;
     
     std::vector<bfs_state_t> order_raw;
-    while (unvisited.rank1(unvisited.size())!=0) {
+    while (unvisited_count != 0) {
         /*
         std::cerr << "unvisited size " << unvisited.rank1(unvisited.size()) << std::endl;
         for (uint64_t i = 0; i < unvisited.size(); ++i) {
@@ -513,7 +662,7 @@ std::vector<handle_t> breadth_first_topological_order(const HandleGraph& g, cons
         uint64_t curr_max_root = 0;
         uint64_t curr_max_length = 0;
         bfs(g,
-            [&g,&order_raw,&unvisited,&seen_bp,
+            [&g,&order_raw,&unvisited,&unvisited_count,&seen_bp,
              &prev_max_root,&curr_max_root,
              &prev_max_length,&curr_max_length]
             (const handle_t& h, const uint64_t& r, const uint64_t& l, const uint64_t& d) {
@@ -522,11 +671,14 @@ std::vector<handle_t> breadth_first_topological_order(const HandleGraph& g, cons
                 curr_max_root = std::max(r+prev_max_root, curr_max_root);
                 curr_max_length = std::max(l+prev_max_length, curr_max_length);
                 seen_bp += g.get_length(h);
-                unvisited.set(i, 0);
+                if (unvisited[i]) {
+                    unvisited[i] = false;
+                    --unvisited_count;
+                }
             },
             [&unvisited](const handle_t& h) {
                 uint64_t i = number_bool_packing::unpack_number(h);
-                return unvisited.at(i)==0;
+                return !unvisited[i];
             },
             [](const handle_t& l, const handle_t& h) { return false; },
             [&seen_bp,&chunk_size]() { return seen_bp > chunk_size; },
@@ -536,9 +688,11 @@ std::vector<handle_t> breadth_first_topological_order(const HandleGraph& g, cons
         // get another seed
         prev_max_root = curr_max_root;
         prev_max_length = curr_max_length;
-        if (unvisited.rank1(unvisited.size())!=0) {
-            uint64_t i = unvisited.select1(0);
-            handle_t h = number_bool_packing::pack(i, false);
+        if (unvisited_count != 0) {
+            while (!unvisited[first_unvisited]) {
+                ++first_unvisited;
+            }
+            handle_t h = number_bool_packing::pack(first_unvisited, false);
             seeds = { h };
         }
     }
@@ -582,10 +736,10 @@ std::vector<handle_t> depth_first_topological_order(const HandleGraph& g, const
 
     // We need to keep track of the nodes we haven't visited to seed subsequent
     // runs of the BFS
-    dyn::succinct_bitvector<dyn::spsi<dyn::packed_vector,256,16> > unvisited;
-    for (uint64_t i = 0; i <= max_handle_rank; ++i) {
-        unvisited.push_back(1);
-    }
+    // a plain bit per rank, with a count and the lowest rank that can still be unvisited
+    std::vector<bool> unvisited(max_handle_rank + 1, true);
+    uint64_t unvisited_count = unvisited.size();
+    uint64_t first_unvisited = 0;
     /*
     g.for_each_handle([&](const handle_t& found) {
                           uint64_t rank = number_bool_packing::unpack_number(found);
@@ -593,7 +747,7 @@ std::vector<handle_t> depth_first_topological_order(const HandleGraph& g, const
                       });
     */
     std::vector<handle_t> order;
-    while (unvisited.rank1(unvisited.size())!=0) {
+    while (unvisited_count != 0) {
         /*
         std::cerr << "unvisited size " << unvisited.rank1(unvisited.size()) << std::endl;
         for (uint64_t i = 0; i < unvisited.size(); ++i) {
@@ -603,16 +757,19 @@ std::vector<handle_t> depth_first_topological_order(const HandleGraph& g, const
         */
         uint64_t bp_count = 0;
         dfs(g,
-            [&g,&order,&unvisited,&bp_count](const handle_t& h) {
+            [&g,&order,&unvisited,&unvisited_count,&bp_count](const handle_t& h) {
                 uint64_t i = number_bool_packing::unpack_number(h);
                 bp_count += g.get_length(h);
                 order.push_back(h);
-                unvisited.set(i, 0);
+                if (unvisited[i]) {
+                    unvisited[i] = false;
+                    --unvisited_count;
+                }
             },
             [](const handle_t& h) { },
             [&unvisited](const handle_t& h) {
                 uint64_t i = number_bool_packing::unpack_number(h);
-                return unvisited.at(i)==0;
+                return !unvisited[i];
             },
             [&bp_count,&chunk_size]() {
                 //std::cerr << "bp_count " << bp_count << std::endl;
@@ -620,9 +777,11 @@ std::vector<handle_t> depth_first_topological_order(const HandleGraph& g, const
             },
             seeds);
         // get another seed
-        if (unvisited.rank1(unvisited.size())!=0) {
-            uint64_t i = unvisited.select1(0);
-            handle_t h = number_bool_packing::pack(i, false);
+        if (unvisited_count != 0) {
+            while (!unvisited[first_unvisited]) {
+                ++first_unvisited;
+            }
+            handle_t h = number_bool_packing::pack(first_unvisited, false);
             seeds = { h };
         }
     }
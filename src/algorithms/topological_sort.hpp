@@ -68,6 +68,22 @@ std::vector<handle_t> topological_order(const HandleGraph* g,
 
 std::vector<handle_t> two_way_topological_order(const HandleGraph* g);
 
+/**
+ * A level-synchronous, parallel variant of topological_order(). Each frontier of oriented
+ * nodes is expanded with nthreads threads, and the nodes whose left-side edges have all been
+ * followed form the next frontier, sorted by rank. The remaining left-side edges of each node
+ * are counted down in an atomic array indexed by node rank, in the orientation the node was
+ * first reached in. When a frontier is empty, the sort continues from the lowest ranked node
+ * that was reached but not emitted, as a cycle entry point, else from the lowest ranked node
+ * not yet reached. On DAGs the result is a topological order; on graphs where a node can be
+ * reached in both orientations at once, its orientation depends on the thread timing.
+ */
+std::vector<handle_t> parallel_topological_order(const HandleGraph* g,
+                                                 const uint64_t& nthreads,
+                                                 bool use_heads = true,
+                                                 bool use_tails = false,
+                                                 bool progress_reporting = false);
+
 /**
  * Order the nodes in a graph using a topological sort. The sort is NOT guaranteed
  * to be machine-independent, but it is faster than topological_order(). This algorithm 
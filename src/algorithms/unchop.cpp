@@ -5,6 +5,9 @@
  */
 
 #include "unchop.hpp"
+#include "odgi.hpp"
+
+#include <limits>
 
 namespace odgi {
     namespace algorithms {
@@ -256,6 +259,180 @@ namespace odgi {
             return combined;
         }
 
+        /// Unchop a graph_t by rebuilding it: the merged nodes, edges and path steps of all simple
+        /// components are laid out in parallel against the old graph, which is then cleared and
+        /// refilled in the final node order, so no node is concatenated, relinked or destroyed one by one.
+        static void unchop_rebuild(graph_t &graph,
+                                   const std::vector<std::vector<handle_t>> &components,
+                                   ska::flat_hash_map<nid_t, uint64_t> &node_rank,
+                                   const uint64_t &nthreads,
+                                   std::vector<nid_t> *tracked_ids,
+                                   uint64_t &num_node_unchopped,
+                                   uint64_t &num_new_nodes) {
+            const nid_t min_id = graph.get_node_count() ? graph.min_node_id() : 0;
+            const uint64_t id_range = graph.get_node_count() ? graph.max_node_id() - min_id + 1 : 0;
+            const uint64_t no_component = std::numeric_limits<uint64_t>::max();
+            std::vector<uint64_t> component_of(id_range, no_component);
+            for (uint64_t c = 0; c < components.size(); ++c) {
+                if (components[c].size() >= 2) {
+                    for (auto &handle : components[c]) {
+                        component_of[graph.get_id(handle) - min_id] = c;
+                    }
+                    num_node_unchopped += components[c].size();
+                    ++num_new_nodes;
+                }
+            }
+
+            // the new nodes by rank, a merged node taking the mean rank of its parts: (rank, is merged, old id or component)
+            std::vector<std::tuple<double, bool, uint64_t>> order;
+            order.reserve(graph.get_node_count() - num_node_unchopped + num_new_nodes);
+            graph.for_each_handle([&](const handle_t &h) {
+                if (component_of[graph.get_id(h) - min_id] == no_component) {
+                    order.emplace_back(node_rank[graph.get_id(h)], false, graph.get_id(h));
+                }
+            });
+            for (uint64_t c = 0; c < components.size(); ++c) {
+                if (components[c].size() >= 2) {
+                    double rank_sum = 0;
+                    for (auto &handle : components[c]) {
+                        rank_sum += node_rank[graph.get_id(handle)];
+                    }
+                    order.emplace_back(rank_sum / components[c].size(), true, c);
+                }
+            }
+            ips4o::parallel::sort(order.begin(), order.end(), std::less<>(), nthreads);
+
+            // the new ids follow the order
+            std::vector<uint64_t> new_node_id(id_range, 0);
+            std::vector<uint64_t> new_component_id(components.size(), 0);
+            std::vector<std::string> sequences(order.size());
+#pragma omp parallel for schedule(dynamic, 4096) num_threads(nthreads)
+            for (uint64_t i = 0; i < order.size(); ++i) {
+                const uint64_t x = std::get<2>(order[i]);
+                if (std::get<1>(order[i])) {
+                    new_component_id[x] = i + 1;
+                    for (auto &handle : components[x]) {
+                        sequences[i].append(graph.get_sequence(handle));
+                    }
+                } else {
+                    new_node_id[x - min_id] = i + 1;
+                    sequences[i] = graph.get_sequence(graph.get_handle(x));
+                }
+            }
+            if (tracked_ids) {
+                std::vector<nid_t> renamed;
+                for (auto &id : *tracked_ids) {
+                    if (id >= min_id && id - min_id < id_range) {
+                        const uint64_t c = component_of[id - min_id];
+                        const uint64_t new_id = c == no_component ? new_node_id[id - min_id] : new_component_id[c];
+                        if (new_id) {
+                            renamed.push_back(new_id);
+                        }
+                    }
+                }
+                tracked_ids->swap(renamed);
+            }
+            // the new handle of id and orientation, as create_handle will give it
+            auto new_handle = [](const uint64_t &id, const bool &is_rev) {
+                return number_bool_packing::pack(id - 1, is_rev);
+            };
+            // the new handle we leave or enter the old one by, false at the inner sides of a component
+            auto exit_handle = [&](const handle_t &h, handle_t &n) {
+                const uint64_t c = component_of[graph.get_id(h) - min_id];
+                if (c == no_component) {
+                    n = new_handle(new_node_id[graph.get_id(h) - min_id], graph.get_is_reverse(h));
+                } else if (h == components[c].back()) {
+                    n = new_handle(new_component_id[c], false);
+                } else if (h == graph.flip(components[c].front())) {
+                    n = new_handle(new_component_id[c], true);
+                } else {
+                    return false;
+                }
+                return true;
+            };
+            auto entry_handle = [&](const handle_t &h, handle_t &n) {
+                if (!exit_handle(graph.flip(h), n)) {
+                    return false;
+                }
+                n = number_bool_packing::toggle_bit(n);
+                return true;
+            };
+
+            std::vector<handle_t> handles;
+            handles.reserve(graph.get_node_count());
+            graph.for_each_handle([&](const handle_t &h) {
+                handles.push_back(h);
+            });
+            std::vector<std::vector<edge_t>> edges(nthreads);
+#pragma omp parallel for schedule(dynamic, 4096) num_threads(nthreads)
+            for (uint64_t i = 0; i < handles.size(); ++i) {
+                const handle_t &h = handles[i];
+                auto &thread_edges = edges[omp_get_thread_num()];
+                // both sides, create_edges drops the edges found from both of their ends
+                for (auto &from : {h, graph.flip(h)}) {
+                    handle_t left;
+                    if (exit_handle(from, left)) {
+                        graph.follow_edges(from, false, [&](const handle_t &next) {
+                            handle_t right;
+                            if (entry_handle(next, right)) {
+                                thread_edges.emplace_back(left, right);
+                            }
+                        });
+                    }
+                }
+            }
+
+            // the paths step once on each merged node, where they enter the component
+            std::vector<path_handle_t> paths;
+            graph.for_each_path_handle([&](const path_handle_t &p) {
+                paths.push_back(p);
+            });
+            std::vector<std::string> path_names(paths.size());
+            std::vector<bool> path_is_circular(paths.size());
+            std::vector<std::vector<handle_t>> path_steps(paths.size());
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+            for (uint64_t i = 0; i < paths.size(); ++i) {
+                path_names[i] = graph.get_path_name(paths[i]);
+                graph.for_each_step_in_path(paths[i], [&](const step_handle_t &s) {
+                    const handle_t h = graph.get_handle_of_step(s);
+                    const uint64_t c = component_of[graph.get_id(h) - min_id];
+                    if (c == no_component) {
+                        path_steps[i].push_back(new_handle(new_node_id[graph.get_id(h) - min_id], graph.get_is_reverse(h)));
+                    } else if (h == components[c].front()) {
+                        path_steps[i].push_back(new_handle(new_component_id[c], false));
+                    } else if (h == graph.flip(components[c].back())) {
+                        path_steps[i].push_back(new_handle(new_component_id[c], true));
+                    }
+                });
+            }
+            for (uint64_t i = 0; i < paths.size(); ++i) {
+                path_is_circular[i] = graph.get_is_circular(paths[i]);
+            }
+
+            graph.clear();
+            for (uint64_t i = 0; i < sequences.size(); ++i) {
+                graph.create_handle(sequences[i], i + 1);
+                std::string().swap(sequences[i]);
+            }
+            {
+                std::vector<edge_t> all_edges;
+                for (auto &e : edges) {
+                    all_edges.insert(all_edges.end(), e.begin(), e.end());
+                    std::vector<edge_t>().swap(e);
+                }
+                graph.create_edges(all_edges);
+            }
+            std::vector<path_handle_t> new_paths(paths.size());
+            for (uint64_t i = 0; i < paths.size(); ++i) {
+                new_paths[i] = graph.create_path_handle(path_names[i], path_is_circular[i]);
+            }
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+            for (uint64_t i = 0; i < paths.size(); ++i) {
+                graph.append_steps(new_paths[i], path_steps[i]);
+                std::vector<handle_t>().swap(path_steps[i]);
+            }
+        }
+
         bool unchop(handlegraph::MutablePathDeletableHandleGraph &graph) {
             return unchop(graph, 1, false);
         }
@@ -263,6 +440,13 @@ namespace odgi {
         bool unchop(handlegraph::MutablePathDeletableHandleGraph &graph,
                     const uint64_t &nthreads,
                     const bool &show_info) {
+            return unchop(graph, nthreads, show_info, nullptr);
+        }
+
+        bool unchop(handlegraph::MutablePathDeletableHandleGraph &graph,
+                    const uint64_t &nthreads,
+                    const bool &show_info,
+                    std::vector<nid_t> *tracked_ids) {
 #ifdef debug
             std::cerr << "Running unchop" << std::endl;
 #endif
@@ -294,64 +478,111 @@ namespace odgi {
             });
 
             auto components = simple_components(graph, 2, true, nthreads);
-            ska::flat_hash_set<nid_t> to_merge;
-            for (auto &comp : components) {
-                for (auto &handle : comp) {
-                    to_merge.insert(graph.get_id(handle));
+            uint64_t num_node_unchopped = 0;
+            uint64_t num_new_nodes = 0;
+            if (auto *g = dynamic_cast<graph_t *>(&graph)) {
+                unchop_rebuild(*g, components, node_rank, nthreads, tracked_ids, num_node_unchopped, num_new_nodes);
+                if (show_info) {
+                    std::cerr << "[odgi::unchop] unchopped " << num_node_unchopped << " nodes into " << num_new_nodes
+                              << " new nodes." << std::endl;
                 }
-            }
-            std::vector<std::pair<double, handle_t>> ordered_handles;
-            graph.for_each_handle(
-                    [&](const handle_t &handle) {
-                        if (!to_merge.count(graph.get_id(handle))) {
-                            ordered_handles.push_back(std::make_pair(
-                                    node_rank[graph.get_id(handle)],
-                                    handle));
+            } else {
+                ska::flat_hash_set<nid_t> to_merge;
+                for (auto &comp : components) {
+                    for (auto &handle : comp) {
+                        to_merge.insert(graph.get_id(handle));
+                    }
+                }
+                // the handle each tracked node ends up in, until the nodes are renumbered
+                ska::flat_hash_map<nid_t, handle_t> tracked_handle;
+                if (tracked_ids) {
+                    for (auto &id : *tracked_ids) {
+                        if (graph.has_node(id)) {
+                            tracked_handle[id] = graph.get_handle(id);
                         }
-                    });
+                    }
+                }
+                std::vector<std::pair<double, handle_t>> ordered_handles;
+                graph.for_each_handle(
+                        [&](const handle_t &handle) {
+                            if (!to_merge.count(graph.get_id(handle))) {
+                                ordered_handles.push_back(std::make_pair(
+                                        node_rank[graph.get_id(handle)],
+                                        handle));
+                            }
+                        });
 
-            uint64_t num_node_unchopped = 0;
-            uint64_t num_new_nodes = 0;
-            for (auto &comp : components) {
+                for (auto &comp : components) {
 #ifdef debug
-                std::cerr << "Unchop " << comp.size() << " nodes together" << std::endl;
+                    std::cerr << "Unchop " << comp.size() << " nodes together" << std::endl;
 #endif
-                if (comp.size() >= 2) {
-                    // sort by lowest rank to maintain order
-                    double rank_sum = 0;
-                    for (auto &handle : comp) {
-                        rank_sum += node_rank[graph.get_id(handle)];
-                    }
-                    double rank_v = rank_sum / comp.size();
-                    handle_t n = concat_nodes(graph, comp);
-                    ordered_handles.push_back(std::make_pair(rank_v, n));
-                    //node_order.push_back(graph.get_id(n));
-                    num_node_unchopped += comp.size();
-                    num_new_nodes++;
-                } else {
-                    for (auto &c : comp) {
-                        ordered_handles.push_back(std::make_pair(node_rank[graph.get_id(c)], c));
+                    if (comp.size() >= 2) {
+                        // sort by lowest rank to maintain order
+                        double rank_sum = 0;
+                        for (auto &handle : comp) {
+                            rank_sum += node_rank[graph.get_id(handle)];
+                        }
+                        double rank_v = rank_sum / comp.size();
+                        std::vector<nid_t> comp_ids;
+                        if (tracked_ids) {
+                            for (auto &handle : comp) {
+                                comp_ids.push_back(graph.get_id(handle));
+                            }
+                        }
+                        handle_t n = concat_nodes(graph, comp);
+                        for (auto &id : comp_ids) {
+                            auto f = tracked_handle.find(id);
+                            if (f != tracked_handle.end()) {
+                                f->second = n;
+                            }
+                        }
+                        ordered_handles.push_back(std::make_pair(rank_v, n));
+                        //node_order.push_back(graph.get_id(n));
+                        num_node_unchopped += comp.size();
+                        num_new_nodes++;
+                    } else {
+                        for (auto &c : comp) {
+                            ordered_handles.push_back(std::make_pair(node_rank[graph.get_id(c)], c));
+                        }
                     }
                 }
-            }
 
-            // todo try sorting again
+                // todo try sorting again
 
-            if (show_info) {
-                std::cerr << "[odgi::unchop] unchopped " << num_node_unchopped << " nodes into " << num_new_nodes
-                          << " new nodes." << std::endl;
-            }
+                if (show_info) {
+                    std::cerr << "[odgi::unchop] unchopped " << num_node_unchopped << " nodes into " << num_new_nodes
+                              << " new nodes." << std::endl;
+                }
 
-            assert(graph.get_node_count() == ordered_handles.size());
+                assert(graph.get_node_count() == ordered_handles.size());
 
-            ips4o::parallel::sort(ordered_handles.begin(), ordered_handles.end(), std::less<>(), nthreads);
+                ips4o::parallel::sort(ordered_handles.begin(), ordered_handles.end(), std::less<>(), nthreads);
 
-            std::vector<handle_t> handle_order;
-            for (auto &h : ordered_handles) {
-                handle_order.push_back(h.second);
-            }
+                std::vector<handle_t> handle_order;
+                for (auto &h : ordered_handles) {
+                    handle_order.push_back(h.second);
+                }
+
+                if (tracked_ids) {
+                    // apply_ordering gives the i-th handle the id i + 1
+                    ska::flat_hash_map<handle_t, nid_t> new_id;
+                    for (auto &t : tracked_handle) {
+                        new_id[t.second] = 0;
+                    }
+                    for (uint64_t i = 0; i < handle_order.size(); ++i) {
+                        auto f = new_id.find(handle_order[i]);
+                        if (f != new_id.end()) {
+                            f->second = i + 1;
+                        }
+                    }
+                    tracked_ids->clear();
+                    for (auto &t : tracked_handle) {
+                        tracked_ids->push_back(new_id[t.second]);
+                    }
+                }
 
-            graph.apply_ordering(handle_order, true);
+                graph.apply_ordering(handle_order, true);
+            }
 
             std::atomic<bool> ok(true);
 
@@ -38,6 +38,15 @@ bool unchop(handlegraph::MutablePathDeletableHandleGraph& graph,
             const uint64_t& nthreads,
             const bool& show_info);
 
+/**
+ * Unchop as above, renaming the node ids in tracked_ids, if not null, to the ids of the nodes
+ * they end up in, as unchop renumbers all nodes. The ids of missing nodes are dropped.
+ */
+bool unchop(handlegraph::MutablePathDeletableHandleGraph& graph,
+            const uint64_t& nthreads,
+            const bool& show_info,
+            std::vector<nid_t>* tracked_ids);
+
 //std::vector<std::deque<handle_t>> simple_components(PathHandleGraph* graph, int min_size = 1, false);
 
 handle_t concat_nodes(handlegraph::MutablePathDeletableHandleGraph& graph, const std::vector<handle_t>& nodes);
@@ -498,6 +498,131 @@ double self_mean_coverage(
     return (double)sum / (double)bp;
 }
 
+void self_coverage_t::build(const PathHandleGraph& graph, const path_handle_t& path, const path_step_index_t& self_index) {
+    length = 0;
+    run_starts.clear();
+    run_coverages.clear();
+    run_sums.clear();
+    uint64_t sum = 0;
+    graph.for_each_step_in_path(path, [&](const step_handle_t& step) {
+        const handle_t handle = graph.get_handle_of_step(step);
+        const uint64_t coverage = self_index.n_steps_on_node(graph.get_id(handle));
+        if (run_coverages.empty() || run_coverages.back() != coverage) {
+            if (!run_starts.empty()) {
+                sum += run_coverages.back() * (length - run_starts.back());
+            }
+            run_starts.push_back(length);
+            run_coverages.push_back(coverage);
+            run_sums.push_back(sum);
+        }
+        length += graph.get_length(handle);
+    });
+}
+
+uint64_t self_coverage_t::sum_before(const uint64_t& pos) const {
+    if (run_starts.empty()) {
+        return 0;
+    }
+    const uint64_t p = std::min(pos, length);
+    const uint64_t r = std::upper_bound(run_starts.begin(), run_starts.end(), p) - run_starts.begin() - 1;
+    return run_sums[r] + run_coverages[r] * (p - run_starts[r]);
+}
+
+double self_coverage_t::mean(const uint64_t& begin_pos, const uint64_t& end_pos) const {
+    // as self_mean_coverage, 0/0 for an empty segment
+    return (double)(sum_before(end_pos) - sum_before(begin_pos)) / (double)(end_pos - begin_pos);
+}
+
+template<typename T>
+static void write_coverage_vector(std::ostream& out, const std::vector<T>& v) {
+    const uint64_t n = v.size();
+    out.write((const char*) &n, sizeof(n));
+    out.write((const char*) v.data(), n * sizeof(T));
+}
+
+template<typename T>
+static bool read_coverage_vector(std::istream& in, std::vector<T>& v) {
+    uint64_t n = 0;
+    if (!in.read((char*) &n, sizeof(n))) {
+        return false;
+    }
+    v.resize(n);
+    return n == 0 || (bool) in.read((char*) v.data(), n * sizeof(T));
+}
+
+void self_coverage_t::serialize(std::ostream& out) const {
+    out.write((const char*) &length, sizeof(length));
+    write_coverage_vector(out, run_starts);
+    write_coverage_vector(out, run_coverages);
+    write_coverage_vector(out, run_sums);
+}
+
+bool self_coverage_t::load(std::istream& in) {
+    return in.read((char*) &length, sizeof(length))
+        && read_coverage_vector(in, run_starts)
+        && read_coverage_vector(in, run_coverages)
+        && read_coverage_vector(in, run_sums)
+        && run_coverages.size() == run_starts.size()
+        && run_sums.size() == run_starts.size();
+}
+
+static const char SELF_COVERAGE_MAGIC[8] = {'O', 'D', 'G', 'I', 'S', 'C', 'O', 'V'};
+
+void write_self_coverages(
+    const PathHandleGraph& graph,
+    const std::vector<path_handle_t>& paths,
+    const std::vector<self_coverage_t>& coverages,
+    const std::string& filename) {
+    std::ofstream out(filename.c_str(), std::ios::binary);
+    out.write(SELF_COVERAGE_MAGIC, sizeof(SELF_COVERAGE_MAGIC));
+    const uint64_t path_count = paths.size();
+    out.write((const char*) &path_count, sizeof(path_count));
+    for (uint64_t i = 0; i < paths.size(); ++i) {
+        const std::string name = graph.get_path_name(paths[i]);
+        const uint64_t n = name.size();
+        out.write((const char*) &n, sizeof(n));
+        out.write(name.data(), n);
+        coverages[i].serialize(out);
+    }
+}
+
+bool load_self_coverages(
+    const PathHandleGraph& graph,
+    const std::vector<path_handle_t>& paths,
+    std::vector<self_coverage_t>& coverages,
+    const std::string& filename) {
+    std::ifstream in(filename.c_str(), std::ios::binary);
+    char magic[sizeof(SELF_COVERAGE_MAGIC)];
+    uint64_t path_count = 0;
+    if (!in.read(magic, sizeof(magic))
+        || !std::equal(magic, magic + sizeof(magic), SELF_COVERAGE_MAGIC)
+        || !in.read((char*) &path_count, sizeof(path_count))) {
+        return false;
+    }
+    ska::flat_hash_map<std::string, uint64_t> path_rank;
+    for (uint64_t i = 0; i < paths.size(); ++i) {
+        path_rank[graph.get_path_name(paths[i])] = i;
+    }
+    coverages.resize(paths.size());
+    for (uint64_t i = 0; i < path_count; ++i) {
+        uint64_t n = 0;
+        std::string name;
+        if (!in.read((char*) &n, sizeof(n))) {
+            return false;
+        }
+        name.resize(n);
+        self_coverage_t coverage;
+        if ((n && !in.read(&name[0], n)) || !coverage.load(in)) {
+            return false;
+        }
+        auto f = path_rank.find(name);
+        if (f != path_rank.end()) {
+            coverages[f->second] = std::move(coverage);
+        }
+    }
+    return true;
+}
+
 uint64_t query_hits_target_front(
 		const PathHandleGraph& graph,
 		const path_handle_t& query,
@@ -555,12 +680,13 @@ void map_segments(
     const std::vector<step_handle_t>& cuts,
     const segment_map_t& target_segments,
     const step_index_t& step_index,
-    const path_step_index_t& self_index,
+    const self_coverage_t& path_self_coverage,
     const double& max_self_coverage,
     const uint64_t& n_best,
     const double& min_jaccard,
     const untangle_output_t& output_type,
-    ska::flat_hash_map<path_handle_t, uint64_t>& path_to_len) {
+    const ska::flat_hash_map<path_handle_t, uint64_t>& path_to_len,
+    std::ostream& out) {
     // query name is the first field in our outputs
     std::string query_name = graph.get_path_name(path);
     // helper for building up gene order lists and gggenes plot data
@@ -580,7 +706,7 @@ void map_segments(
         auto end_pos = step_index.get_position(end, graph);
         uint64_t length = end_pos - begin_pos;
         // get the self coverage TODO
-        double self_coverage = self_mean_coverage(graph, self_index, path, begin, end);
+        double self_coverage = path_self_coverage.mean(begin_pos, end_pos);
         if (max_self_coverage && self_coverage > max_self_coverage) continue;
         std::vector<segment_mapping_t> target_mapping =
             target_segments.get_matches(graph, cuts[i], cuts[i+1], length);
@@ -603,14 +729,13 @@ void map_segments(
                     std::string target_name = graph.get_path_name(target_path);
                     if (output_type == untangle_output_t::PAF){
                         // PAF format
-#pragma omp critical (cout)
-                        std::cout << query_name << "\t"
-                        << path_to_len[path] << "\t"
+                        out << query_name << "\t"
+                        << path_to_len.at(path) << "\t"
                         << begin_pos << "\t"
                         << end_pos << "\t"          // Query end (0-based; BED-like; open)
                         << (mapping.is_inv ? "-" : "+") << "\t"
                         << target_name << "\t"
-                        << path_to_len[target_path] << "\t"
+                        << path_to_len.at(target_path) << "\t"
                         << target_begin_pos << "\t"
                         << target_end_pos << "\t"    // Target end (0-based; BED-like; open)
                         << 0 << "\t"
@@ -637,9 +762,8 @@ void map_segments(
                                     mapping.is_inv });
                         }
                     } else if (output_type == untangle_output_t::BEDPE) {
-#pragma omp critical (cout)
                         // BEDPE format
-                        std::cout << query_name << "\t"
+                        out << query_name << "\t"
                         << begin_pos << "\t"
                         << end_pos << "\t"              // chrom1 end (1-based)
                         << target_name << "\t"
@@ -664,8 +788,7 @@ void map_segments(
         }
         std::string s = ss.str();
         if (s.size() && s.at(s.size()-1) == ',') { s.pop_back(); }
-#pragma omp critical (cout)
-        std::cout << s << std::endl;
+        out << s << std::endl;
     }
     if (output_type == untangle_output_t::GGGENES
         || output_type == untangle_output_t::SCHEMATIC) {
@@ -686,8 +809,7 @@ void map_segments(
                << range.query_end << "\t"
                << (range.is_inv ? "0" : "1") << std::endl;
         }
-#pragma omp critical (cout)
-        std::cout << ss.str();
+        out << ss.str();
     }
 }
 
@@ -705,6 +827,8 @@ void untangle(
     const untangle_output_t& output_type,
     const std::string& cut_points_input,
     const std::string& cut_points_output,
+    const std::string& self_coverage_input,
+    const std::string& self_coverage_output,
     const size_t& num_threads,
     const bool& show_progress,
 	const step_index_t& step_index,
@@ -934,14 +1058,14 @@ void untangle(
             return path_len;
         };
 
+        std::vector<uint64_t> path_lens(paths.size());
 #pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
         for (uint64_t i = 0; i < paths.size(); ++i) {
-            auto& path = paths[i];
-            const uint64_t path_len = get_path_length(graph, paths[i]);
-
-            // You can't write on such a data structure in parallel
-#pragma omp critical (path_to_len)
-            path_to_len[path] = path_len;
+            path_lens[i] = get_path_length(graph, paths[i]);
+        }
+        // You can't write on such a data structure in parallel
+        for (uint64_t i = 0; i < paths.size(); ++i) {
+            path_to_len[paths[i]] = path_lens[i];
         }
     } else if (output_type == untangle_output_t::BEDPE) {
         std::cout << "#query.name\tquery.start\tquery.end\tref.name\tref.start\tref.end\tscore\tinv\tself.cov\tnth.best" << std::endl;
@@ -958,8 +1082,22 @@ void untangle(
                 queries.size(), "[odgi::algorithms::untangle] untangling " + to_string(queries.size()) + " queries");
     }
 
+    // the self coverage of each query, computed once from its self index unless it was saved by an earlier run
+    std::vector<self_coverage_t> query_self_coverages(queries.size());
+    if (!self_coverage_input.empty()) {
+        if (!load_self_coverages(graph, queries, query_self_coverages, self_coverage_input)) {
+            std::cerr << "[odgi::algorithms::untangle] error: cannot read the self coverage from " << self_coverage_input << std::endl;
+            exit(1);
+        }
+    }
+
+    // each query is mapped against the shared target segments on its own thread, and its
+    // records are written in the order of the queries
+    ordered_chunk_writer writer(std::cout);
+    writer.open_writer();
 #pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
-    for (auto& query : queries) {
+    for (uint64_t q = 0; q < queries.size(); ++q) {
+        auto& query = queries[q];
         auto self_index = path_step_index_t(graph, query, threads_per);
         std::vector<step_handle_t> cuts
             = merge_cuts(
@@ -974,10 +1112,16 @@ void untangle(
                 merge_dist,
                 step_index,
 				graph);
+        if (query_self_coverages[q].empty()) {
+            query_self_coverages[q].build(graph, query, self_index);
+        }
+        std::stringstream out;
         map_segments(graph, query, cuts, target_segments,
-                     step_index, self_index,
+                     step_index, query_self_coverages[q],
                      max_self_coverage, n_best, min_jaccard,
-                     output_type, path_to_len);
+                     output_type, path_to_len, out);
+        std::string text = out.str();
+        writer.append(q, text, true);
 
         //write_cuts(graph, query, cuts, step_pos);
 
@@ -986,12 +1130,18 @@ void untangle(
         }
     }
 
+    writer.close_writer();
+
     if (show_progress) {
         progress->finish();
     }
 
     //self_dotplot(graph, query, step_pos);
 
+    if (!self_coverage_output.empty()) {
+        write_self_coverages(graph, queries, query_self_coverages, self_coverage_output);
+    }
+
     // If requested, write cut points to a file
     if (!cut_points_output.empty()) {
         std::ofstream f(cut_points_output.c_str());
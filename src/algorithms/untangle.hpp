@@ -11,6 +11,7 @@
 #include "hash_map.hpp"
 #include "ips4o.hpp"
 #include "stepindex.hpp"
+#include "ordered_chunk_writer.hpp"
 
 namespace odgi {
 namespace algorithms {
@@ -64,6 +65,42 @@ public:
         const uint64_t& idx) const;
 };
 
+/// The self coverage along a path, the count of the steps of the path on the node of each step,
+/// stored as runs of steps of equal coverage, so that the mean self coverage of any segment cut at
+/// step boundaries is found by binary search on its path offsets rather than by walking it
+class self_coverage_t {
+public:
+    void build(const PathHandleGraph& graph, const path_handle_t& path, const path_step_index_t& self_index);
+    /// the mean self coverage of the bases [begin_pos, end_pos) of the path
+    double mean(const uint64_t& begin_pos, const uint64_t& end_pos) const;
+    bool empty(void) const {
+        return run_starts.empty();
+    }
+    void serialize(std::ostream& out) const;
+    bool load(std::istream& in);
+private:
+    uint64_t length = 0;
+    /// the path offset where each run starts, its coverage, and the sum of length times coverage before it
+    std::vector<uint64_t> run_starts;
+    std::vector<uint64_t> run_coverages;
+    std::vector<uint64_t> run_sums;
+    uint64_t sum_before(const uint64_t& pos) const;
+};
+
+/// Write the self coverage of the paths to a file that later runs can load with load_self_coverages
+void write_self_coverages(
+    const PathHandleGraph& graph,
+    const std::vector<path_handle_t>& paths,
+    const std::vector<self_coverage_t>& coverages,
+    const std::string& filename);
+
+/// Fill the self coverage of the paths saved in the file, leaving the others empty; false if it can't be read
+bool load_self_coverages(
+    const PathHandleGraph& graph,
+    const std::vector<path_handle_t>& paths,
+    std::vector<self_coverage_t>& coverages,
+    const std::string& filename);
+
 std::vector<step_handle_t> untangle_cuts(
     const PathHandleGraph& graph,
     const step_handle_t& start,
@@ -106,12 +143,13 @@ void map_segments(
     const std::vector<step_handle_t>& cuts,
     const segment_map_t& target_segments,
     const step_index_t& step_index,
-    const path_step_index_t& self_index,
+    const self_coverage_t& self_coverage,
     const double& max_self_coverage,
     const uint64_t& n_best,
     const double& min_jaccard,
     const untangle_output_t& output_type,
-    const ska::flat_hash_map<path_handle_t, uint64_t>& path_to_len);
+    const ska::flat_hash_map<path_handle_t, uint64_t>& path_to_len,
+    std::ostream& out);
 
 void untangle(
     const PathHandleGraph& graph,
@@ -125,6 +163,8 @@ void untangle(
     const untangle_output_t& output_type,
     const std::string& cut_points_input,
     const std::string& cut_points_output,
+    const std::string& self_coverage_input,
+    const std::string& self_coverage_output,
     const size_t& num_threads,
 	const bool& show_progress,
 	const step_index_t& step_index,
@@ -0,0 +1,74 @@
+#pragma once
+
+/**
+ * \file visited_set.hpp
+ *
+ * Defines a set of node traversals to track where a graph search has been.
+ */
+
+#include <vector>
+#include <cstdint>
+#include <handlegraph/handle_graph.hpp>
+#include <handlegraph/util.hpp>
+#include "hash_map.hpp"
+
+namespace odgi {
+namespace algorithms {
+
+using namespace handlegraph;
+
+/// A set of handles, that is of nodes in an orientation, for graph searches.
+/// When the node ids of the graph are compact, as after optimize(), membership is a bit per
+/// handle in a dense vector indexed by id - min id, which takes a quarter byte per node.
+/// Otherwise it falls back to a hash set. Building the dense form costs O(node count), so
+/// searches that only touch a small part of a large graph should keep to a hash set.
+class visited_set_t {
+public:
+
+    explicit visited_set_t(const HandleGraph& graph)
+        : graph(graph) {
+        const uint64_t node_count = graph.get_node_count();
+        if (node_count > 0) {
+            min_id = graph.min_node_id();
+            dense = (uint64_t) (graph.max_node_id() - min_id) + 1 == node_count;
+            if (dense) {
+                bits.resize(2 * node_count, false);
+            }
+        }
+    }
+
+    bool contains(const handle_t& handle) const {
+        return dense ? bits[index_of(handle)] : sparse.count(handle) > 0;
+    }
+
+    /// Add the handle, true if it was not in the set yet
+    bool insert(const handle_t& handle) {
+        if (dense) {
+            const uint64_t i = index_of(handle);
+            if (bits[i]) {
+                return false;
+            }
+            bits[i] = true;
+            return true;
+        }
+        return sparse.insert(handle).second;
+    }
+
+    bool is_dense(void) const {
+        return dense;
+    }
+
+private:
+    const HandleGraph& graph;
+    bool dense = false;
+    nid_t min_id = 0;
+    std::vector<bool> bits;
+    ska::flat_hash_set<handle_t> sparse;
+
+    uint64_t index_of(const handle_t& handle) const {
+        return 2 * (uint64_t) (graph.get_id(handle) - min_id) + graph.get_is_reverse(handle);
+    }
+};
+
+}
+}
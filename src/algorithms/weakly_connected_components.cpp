@@ -1,5 +1,7 @@
 #include "weakly_connected_components.hpp"
 
+#include <limits>
+
 namespace odgi {
 namespace algorithms {
 
@@ -9,14 +11,14 @@ std::vector<ska::flat_hash_set<handlegraph::nid_t>> weakly_connected_components(
     std::vector<ska::flat_hash_set<handlegraph::nid_t>> to_return;
     
     // This only holds locally forward handles
-    ska::flat_hash_set<handle_t> traversed;
+    visited_set_t traversed(*graph);
     
     graph->for_each_handle([&](const handle_t& handle) {
         
         // Only think about it in the forward orientation
         auto forward = graph->forward(handle);
         
-        if (traversed.count(forward)) {
+        if (traversed.contains(forward)) {
             // Already have this node, so don't start a search from it.
             return;
         }
@@ -36,7 +38,7 @@ std::vector<ska::flat_hash_set<handlegraph::nid_t>> weakly_connected_components(
                 // Again, make it forward
                 auto other_forward = graph->forward(other);
                 
-                if (!traversed.count(other_forward)) {
+                if (!traversed.contains(other_forward)) {
                     stack.push_back(other_forward);
                 }
             };
@@ -50,9 +52,95 @@ std::vector<ska::flat_hash_set<handlegraph::nid_t>> weakly_connected_components(
     return to_return;
 }
 
-std::vector<std::vector<handlegraph::handle_t>> weakly_connected_component_vectors(const HandleGraph* graph) {
+component_labels_t weakly_connected_component_labels(const HandleGraph* graph, const uint64_t& nthreads) {
+    component_labels_t labels;
+    // index the nodes, by id - min id when the ids are compact
+    const uint64_t node_count = graph->get_node_count();
+    auto& nodes = labels.nodes;
+    nodes.reserve(node_count);
+    graph->for_each_handle([&](const handle_t& handle) {
+        nodes.push_back(graph->forward(handle));
+    });
+    labels.min_id = node_count ? graph->min_node_id() : 0;
+    labels.dense = !node_count || (uint64_t) (graph->max_node_id() - labels.min_id) + 1 == node_count;
+    if (!labels.dense) {
+        labels.sparse_index.reserve(node_count);
+        for (uint64_t i = 0; i < nodes.size(); ++i) {
+            labels.sparse_index[graph->get_id(nodes[i])] = i;
+        }
+    }
+    auto index_of = [&](const handle_t& handle) -> uint64_t {
+        return labels.index_of(graph->get_id(handle));
+    };
+
+    std::vector<std::atomic<DisjointSets::Aint>> dset_data(node_count);
+    DisjointSets dset(dset_data.data(), dset_data.size());
+#pragma omp parallel for schedule(dynamic, 4096) num_threads(nthreads)
+    for (uint64_t i = 0; i < nodes.size(); ++i) {
+        const uint64_t here = index_of(nodes[i]);
+        auto unite_other = [&](const handle_t& other) {
+            dset.unite(here, index_of(other));
+        };
+        graph->follow_edges(nodes[i], false, unite_other);
+        graph->follow_edges(nodes[i], true, unite_other);
+    }
+
+    // number the components by their first node, then list their members
+    std::vector<uint64_t> root(node_count);
+#pragma omp parallel for schedule(static) num_threads(nthreads)
+    for (uint64_t i = 0; i < nodes.size(); ++i) {
+        root[i] = dset.find(index_of(nodes[i]));
+    }
+    const uint64_t unnumbered = std::numeric_limits<uint64_t>::max();
+    std::vector<uint64_t> component_of_root(node_count, unnumbered);
+    std::vector<uint64_t> component_size;
+    auto& component_of = labels.component_of;
+    component_of.resize(node_count);
+    for (uint64_t i = 0; i < nodes.size(); ++i) {
+        uint64_t& component = component_of_root[root[i]];
+        if (component == unnumbered) {
+            component = component_size.size();
+            component_size.push_back(0);
+        }
+        ++component_size[component];
+        component_of[i] = component;
+    }
+    auto& first_member = labels.first_member;
+    first_member.assign(component_size.size() + 1, 0);
+    for (uint64_t c = 0; c < component_size.size(); ++c) {
+        first_member[c + 1] = first_member[c] + component_size[c];
+    }
+    labels.members.resize(node_count);
+    std::vector<uint64_t> next_member(first_member.begin(), first_member.end() - 1);
+    for (uint64_t i = 0; i < nodes.size(); ++i) {
+        labels.members[next_member[component_of[i]]++] = i;
+    }
+    return labels;
+}
+
+std::vector<ska::flat_hash_set<handlegraph::nid_t>> weakly_connected_components(const HandleGraph* graph,
+                                                                                const uint64_t& nthreads) {
+    if (nthreads <= 1) {
+        return weakly_connected_components(graph);
+    }
+
+    const component_labels_t labels = weakly_connected_component_labels(graph, nthreads);
+    std::vector<ska::flat_hash_set<handlegraph::nid_t>> to_return(labels.size());
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+    for (uint64_t c = 0; c < labels.size(); ++c) {
+        auto& component = to_return[c];
+        component.reserve(labels.component_size(c));
+        for (uint64_t m = labels.first_member[c]; m < labels.first_member[c + 1]; ++m) {
+            component.insert(graph->get_id(labels.nodes[labels.members[m]]));
+        }
+    }
+    return to_return;
+}
+
+std::vector<std::vector<handlegraph::handle_t>> weakly_connected_component_vectors(const HandleGraph* graph,
+                                                                                 const uint64_t& nthreads) {
     std::vector<std::vector<handlegraph::handle_t>> components;
-    for (auto& component : weakly_connected_components(graph)) {
+    for (auto& component : weakly_connected_components(graph, nthreads)) {
         components.emplace_back();
         auto& v = components.back();
         for (auto& id : component) {
@@ -73,14 +161,14 @@ std::vector<std::pair<ska::flat_hash_set<handlegraph::nid_t>, std::vector<handle
     std::vector<std::pair<ska::flat_hash_set<handlegraph::nid_t>, std::vector<handle_t>>> to_return;
     
     // This only holds locally forward handles
-    ska::flat_hash_set<handle_t> traversed;
+    visited_set_t traversed(*graph);
     
     graph->for_each_handle([&](const handle_t& handle) {
         
         // Only think about it in the forward orientation
         auto forward = graph->forward(handle);
         
-        if (traversed.count(forward)) {
+        if (traversed.contains(forward)) {
             // Already have this node, so don't start a search from it.
             return;
         }
@@ -104,7 +192,7 @@ std::vector<std::pair<ska::flat_hash_set<handlegraph::nid_t>, std::vector<handle
                 // Again, make it forward
                 auto other_forward = graph->forward(other);
                 
-                if (!traversed.count(other_forward)) {
+                if (!traversed.contains(other_forward)) {
                     stack.push_back(other_forward);
                 }
                 
@@ -9,6 +9,10 @@
 #include <handlegraph/handle_graph.hpp>
 #include <handlegraph/util.hpp>
 #include "hash_map.hpp"
+#include "visited_set.hpp"
+#include "dset64.hpp"
+#include <atomic>
+#include <omp.h>
 #include <vector>
 #include <algorithm>
 
@@ -24,8 +28,45 @@ using namespace handlegraph;
 /// connected component is orientation-independent.
 std::vector<ska::flat_hash_set<handlegraph::nid_t>> weakly_connected_components(const HandleGraph* graph);
 
+/// The same components, found with a lock-free union-find over the edges of the graph in nthreads
+/// threads. Components come out in the order of their first node in for_each_handle, as in the
+/// serial search. Only the edges are walked in parallel, so this is worth it on large graphs.
+std::vector<ska::flat_hash_set<handlegraph::nid_t>> weakly_connected_components(const HandleGraph* graph,
+                                                                                const uint64_t& nthreads);
+
+/// The weakly connected components as labels rather than sets: the nodes, locally forward, in the order
+/// of for_each_handle, with the component of each, numbered by their first node as in the serial search.
+/// The members of component c are members[first_member[c]] to members[first_member[c + 1] - 1], as
+/// indexes into nodes, in the order of for_each_handle.
+struct component_labels_t {
+    std::vector<handle_t> nodes;
+    std::vector<uint64_t> component_of;
+    std::vector<uint64_t> first_member;
+    std::vector<uint64_t> members;
+    nid_t min_id = 0;
+    /// the index of each id in nodes, when the ids are not compact
+    bool dense = true;
+    ska::flat_hash_map<nid_t, uint64_t> sparse_index;
+
+    uint64_t size(void) const {
+        return first_member.empty() ? 0 : first_member.size() - 1;
+    }
+
+    uint64_t component_size(const uint64_t& c) const {
+        return first_member[c + 1] - first_member[c];
+    }
+
+    uint64_t index_of(const nid_t& id) const {
+        return dense ? id - min_id : sparse_index.at(id);
+    }
+};
+
+/// Label the weakly connected components with the lock-free union-find over the edges, in nthreads threads
+component_labels_t weakly_connected_component_labels(const HandleGraph* graph, const uint64_t& nthreads);
+
 /// Returns a vector of handles, one for each component, which can be easier to use in some cases
-std::vector<std::vector<handlegraph::handle_t>> weakly_connected_component_vectors(const HandleGraph* graph);
+std::vector<std::vector<handlegraph::handle_t>> weakly_connected_component_vectors(const HandleGraph* graph,
+                                                                                 const uint64_t& nthreads = 1);
 
 /// Return pairs of weakly connected component ID sets and the handles that are
 /// their tips, oriented inward. If a node is both a head and a tail, it will
@@ -0,0 +1,174 @@
+#include "windowed_sort.hpp"
+#include "flat_hash_map.hpp"
+
+#include <limits>
+#include <memory>
+#include <algorithm>
+
+namespace odgi {
+namespace algorithms {
+
+std::vector<handle_t> windowed_order(const graph_t &graph,
+                                     const path_handle_t &reference,
+                                     const uint64_t &window_size,
+                                     const uint64_t &window_overlap,
+                                     const uint64_t &context,
+                                     const uint64_t &nthreads,
+                                     const std::function<std::vector<handle_t>(graph_t &)> &sort_window,
+                                     const bool &progress) {
+    const uint64_t node_count = graph.get_node_count();
+    const uint64_t no_anchor = std::numeric_limits<uint64_t>::max();
+    auto rank_of = [](const handle_t &h) -> uint64_t {
+        return number_bool_packing::unpack_number(h);
+    };
+
+    // anchor each node, by handle rank, at the reference offset where it is first seen
+    std::vector<uint64_t> anchor(node_count, no_anchor);
+    std::vector<uint64_t> frontier;
+    uint64_t reference_length = 0;
+    graph.for_each_step_in_path(reference, [&](const step_handle_t &step) {
+        const handle_t h = graph.get_handle_of_step(step);
+        const uint64_t r = rank_of(h);
+        if (anchor[r] == no_anchor) {
+            anchor[r] = reference_length;
+            frontier.push_back(r);
+        }
+        reference_length += graph.get_length(h);
+    });
+    // pull in the nodes off the reference, one ring of neighbors at a time
+    for (uint64_t d = 0; d < context && !frontier.empty(); ++d) {
+        std::vector<uint64_t> next;
+        for (auto &r : frontier) {
+            for (bool go_left : {false, true}) {
+                graph.follow_edges(number_bool_packing::pack(r, false), go_left, [&](const handle_t &n) {
+                    const uint64_t s = rank_of(n);
+                    if (anchor[s] == no_anchor) {
+                        anchor[s] = anchor[r];
+                        next.push_back(s);
+                    }
+                });
+            }
+        }
+        frontier.swap(next);
+    }
+
+    // window k covers [k * stride, k * stride + window_size) on the reference
+    const uint64_t stride = window_size - window_overlap;
+    const uint64_t window_count = reference_length <= window_size
+                                  ? 1 : 2 + (reference_length - window_size - 1) / stride;
+    const uint64_t last = window_count - 1;
+    auto first_window_of = [&](const uint64_t &a) -> uint64_t {
+        return a < window_size ? 0 : std::min(last, (a - window_size) / stride + 1);
+    };
+    auto last_window_of = [&](const uint64_t &a) -> uint64_t {
+        return std::min(last, a / stride);
+    };
+    // a node belongs to the window whose middle part, between the middles of its overlaps, holds its anchor
+    auto owner_of = [&](const uint64_t &a) -> uint64_t {
+        return a < window_overlap / 2 ? 0 : std::min(last, (a - window_overlap / 2) / stride);
+    };
+
+    std::vector<std::vector<uint64_t>> members(window_count);
+    for (uint64_t r = 0; r < node_count; ++r) {
+        if (anchor[r] != no_anchor) {
+            for (uint64_t k = first_window_of(anchor[r]); k <= last_window_of(anchor[r]); ++k) {
+                members[k].push_back(r);
+            }
+        }
+    }
+
+    // cut the paths into the runs of consecutive steps in each window
+    std::vector<std::vector<std::vector<handle_t>>> runs(window_count);
+    {
+        std::vector<uint64_t> last_step(window_count);
+        graph.for_each_path_handle([&](const path_handle_t &path) {
+            std::fill(last_step.begin(), last_step.end(), no_anchor);
+            uint64_t i = 0;
+            graph.for_each_step_in_path(path, [&](const step_handle_t &step) {
+                const handle_t h = graph.get_handle_of_step(step);
+                const uint64_t a = anchor[rank_of(h)];
+                if (a != no_anchor) {
+                    for (uint64_t k = first_window_of(a); k <= last_window_of(a); ++k) {
+                        if (last_step[k] == no_anchor || last_step[k] + 1 != i) {
+                            runs[k].emplace_back();
+                        }
+                        runs[k].back().push_back(h);
+                        last_step[k] = i;
+                    }
+                }
+                ++i;
+            });
+        });
+    }
+
+    std::unique_ptr<progress_meter::ProgressMeter> progress_meter;
+    if (progress) {
+        progress_meter = std::make_unique<progress_meter::ProgressMeter>(
+                window_count, "[odgi::windowed_order] sorting " + std::to_string(window_count) + " windows:");
+    }
+    std::vector<std::vector<handle_t>> window_orders(window_count);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+    for (uint64_t k = 0; k < window_count; ++k) {
+        const std::vector<uint64_t> &nodes = members[k];
+        if (!nodes.empty()) {
+            // a compacted copy of the window, with node ids in the current order
+            ska::flat_hash_map<uint64_t, nid_t> local_id;
+            graph_t window;
+            for (uint64_t i = 0; i < nodes.size(); ++i) {
+                local_id[nodes[i]] = i + 1;
+                window.create_handle(graph.get_sequence(number_bool_packing::pack(nodes[i], false)), i + 1);
+            }
+            auto local_handle = [&](const handle_t &h) -> handle_t {
+                return window.get_handle(local_id[rank_of(h)], graph.get_is_reverse(h));
+            };
+            for (auto &r : nodes) {
+                const handle_t h = number_bool_packing::pack(r, false);
+                for (bool go_left : {false, true}) {
+                    graph.follow_edges(h, go_left, [&](const handle_t &n) {
+                        if (local_id.count(rank_of(n))) {
+                            if (go_left) {
+                                window.create_edge(local_handle(n), local_handle(h));
+                            } else {
+                                window.create_edge(local_handle(h), local_handle(n));
+                            }
+                        }
+                    });
+                }
+            }
+            for (uint64_t i = 0; i < runs[k].size(); ++i) {
+                const path_handle_t path = window.create_path_handle("run_" + std::to_string(i));
+                for (auto &h : runs[k][i]) {
+                    window.append_step(path, local_handle(h));
+                }
+            }
+            runs[k].clear();
+            for (auto &h : sort_window(window)) {
+                const uint64_t r = nodes[window.get_id(h) - 1];
+                if (owner_of(anchor[r]) == k) {
+                    window_orders[k].push_back(number_bool_packing::pack(r, false));
+                }
+            }
+        }
+        if (progress) {
+            progress_meter->increment(1);
+        }
+    }
+    if (progress) {
+        progress_meter->finish();
+    }
+
+    std::vector<handle_t> order;
+    order.reserve(node_count);
+    for (auto &window_order : window_orders) {
+        order.insert(order.end(), window_order.begin(), window_order.end());
+    }
+    for (uint64_t r = 0; r < node_count; ++r) {
+        if (anchor[r] == no_anchor) {
+            order.push_back(number_bool_packing::pack(r, false));
+        }
+    }
+    return order;
+}
+
+}
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <functional>
+#include <handlegraph/types.hpp>
+#include <handlegraph/util.hpp>
+#include "odgi.hpp"
+#include "progress.hpp"
+
+namespace odgi {
+namespace algorithms {
+
+using namespace handlegraph;
+
+/// Sort a graph with a linear backbone in overlapping windows along a reference path.
+/// Nodes off the reference are anchored to the closest reference node, up to context edges away.
+/// Each window holds the nodes anchored in window_size bp of the reference, overlapping the next one by
+/// window_overlap bp, with the edges between them and the runs of all paths over them. The windows are
+/// sorted in parallel by sort_window, which gets a compacted graph and may be called from several threads
+/// at once. The final order takes the nodes of each window that are anchored closer to its middle than to
+/// its neighbors', in the order of that window, followed by the nodes that could not be anchored.
+std::vector<handle_t> windowed_order(const graph_t &graph,
+                                     const path_handle_t &reference,
+                                     const uint64_t &window_size,
+                                     const uint64_t &window_overlap,
+                                     const uint64_t &context,
+                                     const uint64_t &nthreads,
+                                     const std::function<std::vector<handle_t>(graph_t &)> &sort_window,
+                                     const bool &progress);
+
+}
+}
@@ -1,4 +1,16 @@
 #include "xp.hpp"
+#include <algorithm>
+#include <mio/mmap.hpp>
+#include "profile.hpp"
+#include "numa.hpp"
+#include "huge_pages.hpp"
+#include "external_sort.hpp"
+#include "memory_budget.hpp"
+#include "readahead.hpp"
+#include <csignal>
+#include <map>
+#include <sstream>
+#include <tuple>
 
 // #define debug_load
 // #define debug_np
@@ -6,6 +18,27 @@ namespace xp {
 
     using namespace handlegraph;
 
+    namespace {
+        /// Read-only stream buffer over a memory range
+        struct mapped_buf_t : std::streambuf {
+            mapped_buf_t(const char* begin, const char* end) {
+                setg(const_cast<char*>(begin), const_cast<char*>(begin), const_cast<char*>(end));
+            }
+        };
+
+        /// A step of a path on a node, sorted by node to lay out the node->path vectors
+        struct node_path_t {
+            uint64_t node_id;
+            uint64_t step_rank;
+            uint64_t path_id;
+            uint64_t rank_in_path;
+            bool operator<(const node_path_t& other) const {
+                return std::tie(node_id, step_rank, path_id, rank_in_path)
+                    < std::tie(other.node_id, other.step_rank, other.path_id, other.rank_in_path);
+            }
+        };
+    }
+
     ////////////////////////////////////////////////////////////////////////////
     // Here is XP
     ////////////////////////////////////////////////////////////////////////////
@@ -25,35 +58,46 @@ namespace xp {
         from_handle_graph(graph, basename, nthreads);
     }
 
-    void XP::from_handle_graph(odgi::graph_t &graph, std::string basename, const uint64_t& nthreads) {
+    void XP::from_handle_graph(odgi::graph_t &graph, const std::vector<path_handle_t>& indexed_paths,
+                               const uint64_t& nthreads) {
+        from_handle_graph(graph, std::string(), nthreads, &indexed_paths);
+    }
+
+    void XP::from_handle_graph(odgi::graph_t &graph, std::string basename, const uint64_t& nthreads,
+                               const std::vector<path_handle_t>* indexed_paths) {
         // create temporary file for path names
         if (basename.empty()) {
-            basename = temp_file::get_dir() + '/';
+            basename = temp_file::work_dir() + '/';
         }
-        from_handle_graph_impl(graph, basename, nthreads);
+        from_handle_graph_impl(graph, basename, nthreads, indexed_paths);
         temp_file::cleanup(); // clean up our temporary files
     }
 
-    void XP::from_handle_graph_impl(odgi::graph_t &graph, const std::string& basename, const uint64_t& nthreads) {
-    	if (!graph.is_optimized()) {
-			std::cerr << "error [xp]: Graph to index is not optimized. Please run 'odgi sort' using -O, --optimize." << std::endl;
-			exit(1);
-    	}
+    void XP::from_handle_graph_impl(odgi::graph_t &graph, const std::string& basename, const uint64_t& nthreads,
+                                    const std::vector<path_handle_t>* indexed_paths) {
+        odgi::algorithms::profile::scope_t profile_scope("build path index");
         // Specify the working directory
         sdsl::cache_config config(true, basename);
 
         std::string path_names;
-        // the graph must be compacted for this to work
+        // the positions are indexed by handle number, those left by deleted nodes starting where the
+        // next node does, so that the graph need not be compacted
         sdsl::int_vector<> position_map;
-        sdsl::util::assign(position_map, sdsl::int_vector<>(graph.get_node_count() + 1));
+        sdsl::util::assign(position_map, sdsl::int_vector<>(
+            graph.get_node_count() ? number_bool_packing::unpack_number(graph.get_handle(graph.max_node_id())) + 2 : 1));
         uint64_t len = 0;
-        nid_t last_node_id = graph.min_node_id();
+        uint64_t next_number = 0;
         graph.for_each_handle([&](const handle_t &h) {
-            position_map[number_bool_packing::unpack_number(h)] = len;
+            const uint64_t number = number_bool_packing::unpack_number(h);
+            while (next_number <= number) {
+                position_map[next_number++] = len;
+            }
             uint64_t hl = graph.get_length(h);
             len += hl;
         });
-        position_map[position_map.size() - 1] = len;
+        while (next_number < position_map.size()) {
+            position_map[next_number++] = len;
+        }
 #ifdef debug_from_handle_graph
         std::cerr << "[XP CONSTRUCTION]: The current graph to index has nucleotide length: " << len << std::endl;
         std::cerr << "[XP CONSTRUCTION]: position_map: ";
@@ -64,31 +108,73 @@ namespace xp {
 #endif
         // record the number of nodes + the number of paths within each node
         uint64_t np_size = 0;
-        std::string node_path_idx = basename + ".node_path.mm";
-        // we fill the multiset with a tuple[handle id, step_rank, path_id, rank_of_handle_in_path]
-        mmmulti::map<uint64_t , std::tuple<uint64_t, uint64_t, uint64_t, uint64_t>>
-            node_path_ms(node_path_idx, std::make_tuple(0, 0, 0, 0));
-        node_path_ms.open_writer();
+        // the steps on each node, sorted in runs that fit in a quarter of the memory budget, or
+        // in runs of 1 GiB without one, and spilled to temporary files beyond that
+        odgi::algorithms::external_sorter_t<node_path_t> node_path_ms(
+            odgi::algorithms::memory_budget::buffer_bytes(0.25, (uint64_t) 1 << 30), nthreads, "node_path");
+        std::vector<path_handle_t> path_handles;
+        path_handles.reserve(graph.get_path_count());
         graph.for_each_path_handle([&](const path_handle_t &path) {
-            std::vector<handle_t> p;
-            uint64_t handle_rank_in_path = 0;
-            graph.for_each_step_in_path(path, [&](const step_handle_t &occ) {
-                handle_t h = graph.get_handle_of_step(occ);
-                uint64_t step_rank = as_integers(occ)[1];
-                p.push_back(h);
-                uint64_t hl = graph.get_length(h);
-                ++handle_rank_in_path; // handle ranks in path are 1-based
-                size_t node_id = graph.get_id(h);
-                node_path_ms.append(node_id, std::make_tuple(node_id, step_rank, as_integer(path), handle_rank_in_path));
-                np_size++;
-            });
-            std::string path_name = graph.get_path_name(path);
-            // std::cout << "[XP CONSTRUCTION]: Indexing path: " << path_name << std::endl;
-            XPPath *path_index = new XPPath(path_name, p, false, graph);
-            // Add path_index to paths.
-            paths.push_back(path_index);
-            path_names += start_marker + path_name + end_marker;
+            path_handles.push_back(path);
         });
+        // the paths left out of a subset index get an empty path, so that the handles stay those of the graph
+        std::vector<uint64_t> indexed;
+        if (indexed_paths != nullptr) {
+            for (auto& path : *indexed_paths) {
+                indexed.push_back(as_integer(path));
+            }
+            std::sort(indexed.begin(), indexed.end());
+        }
+        // build the path indexes in parallel, spilling node->path records into the multimap by batches
+        const uint64_t spill_size = 1 << 16;
+        std::mutex node_path_ms_mutex;
+        std::vector<XPPath*> built(path_handles.size(), nullptr);
+        std::atomic<uint64_t> np_count(0);
+#pragma omp parallel num_threads(nthreads)
+        {
+            std::vector<node_path_t> spill;
+            auto flush = [&](void) {
+                std::lock_guard<std::mutex> guard(node_path_ms_mutex);
+                for (auto& r : spill) {
+                    node_path_ms.push(r);
+                }
+                spill.clear();
+            };
+#pragma omp for schedule(dynamic, 1)
+            for (uint64_t i = 0; i < path_handles.size(); ++i) {
+                const path_handle_t& path = path_handles[i];
+                if (indexed_paths != nullptr
+                    && !std::binary_search(indexed.begin(), indexed.end(), (uint64_t) as_integer(path))) {
+                    built[i] = new XPPath(graph.get_path_name(path), std::vector<handle_t>(), false, graph);
+                    continue;
+                }
+                std::vector<handle_t> p;
+                p.reserve(graph.get_step_count(path));
+                uint64_t handle_rank_in_path = 0;
+                graph.for_each_step_in_path(path, [&](const step_handle_t &occ) {
+                    handle_t h = graph.get_handle_of_step(occ);
+                    uint64_t step_rank = as_integers(occ)[1];
+                    p.push_back(h);
+                    ++handle_rank_in_path; // handle ranks in path are 1-based
+                    size_t node_id = graph.get_id(h);
+                    spill.push_back({node_id, step_rank, (uint64_t) as_integer(path), handle_rank_in_path});
+                    if (spill.size() >= spill_size) {
+                        flush();
+                    }
+                });
+                np_count += handle_rank_in_path;
+                built[i] = new XPPath(graph.get_path_name(path), p, false, graph);
+            }
+            if (!spill.empty()) {
+                flush();
+            }
+        }
+        np_size = np_count.load();
+        // paths and their names are kept in the graph's path order
+        for (uint64_t i = 0; i < path_handles.size(); ++i) {
+            paths.push_back(built[i]);
+            path_names += start_marker + graph.get_path_name(path_handles[i]) + end_marker;
+        }
         // assign the position map iv
         sdsl::util::assign(pos_map_iv, sdsl::enc_vector<>(position_map));
         // set the path counts
@@ -116,22 +202,21 @@ namespace xp {
 
         sdsl::construct(pn_csa, path_name_file, config, 1);
         // we need to take care of the node->path vectors
-        node_path_ms.index(nthreads, graph.get_node_count() + 1);
         sdsl::util::assign(nr_iv, sdsl::int_vector<>(np_size));
         sdsl::util::assign(np_bv, sdsl::bit_vector(np_size));
         sdsl::util::assign(npi_iv, sdsl::int_vector<>(np_size));
-        // fill the node->path vectors
-        uint64_t  np_offset = 0;
-        for (int64_t i = 0; i < graph.get_node_count(); i++) {
-            np_bv[np_offset] = 1; // mark node start
-            uint64_t has_steps = false;
-            node_path_ms.for_values_of(i+1, [&](const std::tuple<uint64_t, uint64_t, uint64_t, uint64_t>& v) {
-                nr_iv[np_offset] = std::get<3>(v); // handle_rank_of_path
-                npi_iv[np_offset] = std::get<2>(v); // path id
-                has_steps = true;
-                np_offset++;
-            });
-        }
+        // fill the node->path vectors in node order, marking where each node's steps start
+        uint64_t np_offset = 0;
+        uint64_t current_node_id = 0;
+        node_path_ms.for_each([&](const node_path_t& v) {
+            if (v.node_id != current_node_id) {
+                np_bv[np_offset] = 1; // mark node start
+                current_node_id = v.node_id;
+            }
+            nr_iv[np_offset] = v.rank_in_path; // handle_rank_of_path
+            npi_iv[np_offset] = v.path_id; // path id
+            np_offset++;
+        });
         sdsl::util::bit_compress(nr_iv);
         sdsl::util::bit_compress(npi_iv);
         // sdsl::util::assign(np_bv_rank, sdsl::rank_support_v<1>(&np_bv));
@@ -154,10 +239,7 @@ namespace xp {
         */
         std::cerr << std::endl;
 #endif
-        // node_path_ms.reset(); // free the mmmultimap
-        std::remove(node_path_idx.c_str());
         std::remove(path_name_file.c_str());
-        // delete node_path_ms;
     }
 
     std::vector<XPPath *> XP::get_paths() const {
@@ -221,6 +303,12 @@ namespace xp {
         sdsl::structure_tree::add_size(paths_child, paths_written);
         written += paths_written;
 
+        if (!panpos_table.empty()) {
+            out << "PT";
+            written += 2;
+            written += panpos_table.serialize(out, child, "pangenome_pos_table");
+        }
+
         sdsl::structure_tree::add_size(child, written);
         return written;
     }
@@ -230,6 +318,19 @@ namespace xp {
         load(in);
     }
 
+    void XP::load(const std::string& filename) {
+        std::error_code error;
+        mio::mmap_source mapping = mio::make_mmap_source(filename, 0, mio::map_entire_file, error);
+        if (error) {
+            throw XPFormatError("Index file " + filename + " cannot be mapped: " + error.message());
+        }
+        // the index is read through once, let the kernel fetch ahead of the page faults
+        odgi::algorithms::advise_sequential(mapping.data(), mapping.size());
+        mapped_buf_t buf(mapping.data(), mapping.data() + mapping.size());
+        std::istream in(&buf);
+        load(in);
+    }
+
     void XP::load(std::istream &in) {
 
         if (!in.good()) {
@@ -278,6 +379,12 @@ namespace xp {
             // np_bv_select.load(in, &np_bv);
             nr_iv.load(in);
             npi_iv.load(in);
+            // indexes written without the pangenome position table end here
+            if (in.peek() == 'P') {
+                in.get(buffer);
+                in.get(buffer);
+                panpos_table.load(in);
+            }
 #ifdef debug_load
             std::cerr << "np_bv: ";
             for (uint64_t i = 0; i < np_bv.size(); i++) {
@@ -420,6 +527,28 @@ namespace xp {
     const sdsl::int_vector<>& XP::get_npi_iv() const {
         return npi_iv;
     }
+
+    void XP::interleave_memory() const {
+        odgi::algorithms::numa::interleave_bits(nr_iv);
+        odgi::algorithms::numa::interleave_bits(npi_iv);
+        odgi::algorithms::numa::interleave_bits(np_bv);
+        for (auto *path : paths) {
+            odgi::algorithms::numa::interleave_bits(path->handles);
+            odgi::algorithms::numa::interleave_bits(path->positions);
+            odgi::algorithms::numa::interleave_bits(path->offsets);
+        }
+    }
+
+    void XP::advise_huge_pages() const {
+        odgi::algorithms::huge_pages::advise_bits(nr_iv);
+        odgi::algorithms::huge_pages::advise_bits(npi_iv);
+        odgi::algorithms::huge_pages::advise_bits(np_bv);
+        for (auto *path : paths) {
+            odgi::algorithms::huge_pages::advise_bits(path->handles);
+            odgi::algorithms::huge_pages::advise_bits(path->positions);
+            odgi::algorithms::huge_pages::advise_bits(path->offsets);
+        }
+    }
 /*
     const sdsl::rank_support_v<1> XP::get_np_bv_rank() const {
         return np_bv_rank;
@@ -441,13 +570,20 @@ namespace xp {
             std::cerr << "[XP] error: The given path name " << path_name << " is not in the index." << std::endl;
             exit(1);
         }
-        const XPPath& xppath = get_path(path_name);
+        const XPPath& xppath = *paths[as_integer(p_h) - 1];
         // Is the nucleotide position there?!
         if (xppath.offsets.size() <= nuc_pos) {
             std::cerr << "[XP] error: The given path " << path_name << " with nucleotide position " << nuc_pos << " is not in the index." << std::endl;
             exit(1);
         }
+        return get_pangenome_pos(p_h, nuc_pos);
+    }
 
+    size_t XP::get_pangenome_pos(const handlegraph::path_handle_t &p_h, const size_t &nuc_pos) const {
+        if (!panpos_table.empty()) {
+            return panpos_table.get_pangenome_pos(p_h, nuc_pos);
+        }
+        const XPPath& xppath = *paths[as_integer(p_h) - 1];
         step_handle_t step_handle = get_step_at_position(p_h, nuc_pos);
 #ifdef debug_get_pangenome_pos
         std::cerr << "[GET_PANGENOME_POS]: step_handle: path_handle_t: " << as_integers(step_handle)[0] << " step_rank_at_position: " << as_integers(step_handle)[1] << std::endl;
@@ -502,6 +638,101 @@ namespace xp {
         return pos_in_pangenome;
     }
 
+    void XP::build_pangenome_pos_table(const uint64_t& nthreads) {
+        panpos_table.build(paths, pos_map_iv, nthreads);
+    }
+
+    bool XP::has_pangenome_pos_table() const {
+        return !panpos_table.empty();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Here is PanPosTable
+    ////////////////////////////////////////////////////////////////////////////
+
+    void PanPosTable::build(const std::vector<XPPath *> &paths, const sdsl::enc_vector<> &pos_map_iv, const uint64_t &nthreads) {
+        // (path offset, pangenome offset) of the run starts of each path
+        std::vector<std::vector<std::pair<uint64_t, uint64_t>>> runs(paths.size());
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+        for (uint64_t i = 0; i < paths.size(); ++i) {
+            const XPPath &xppath = *paths[i];
+            auto &path_runs_of = runs[i];
+            uint64_t path_off = 0;
+            for (uint64_t k = 0; k < xppath.handles.size(); ++k) {
+                const handle_t h = xppath.handle(k);
+                const uint64_t rank = number_bool_packing::unpack_number(h);
+                const uint64_t node_pos = pos_map_iv[rank];
+                const uint64_t node_length = pos_map_iv[rank + 1] - node_pos;
+                const bool is_rev = number_bool_packing::unpack_bit(h);
+                // the pangenome offset of the first base of the step, in the direction of the path
+                const uint64_t pos = is_rev ? node_pos + node_length - 1 : node_pos;
+                bool extends = false;
+                if (!path_runs_of.empty()) {
+                    const auto &run = path_runs_of.back();
+                    const uint64_t run_start = run.second & ~reverse_bit;
+                    const uint64_t walked = path_off - run.first;
+                    if (is_rev == (bool) (run.second & reverse_bit)) {
+                        extends = is_rev ? run_start >= walked && run_start - walked == pos : run_start + walked == pos;
+                    }
+                }
+                if (!extends) {
+                    path_runs_of.emplace_back(path_off, pos | (is_rev ? reverse_bit : 0));
+                }
+                path_off += node_length;
+            }
+        }
+        sdsl::util::assign(path_runs, sdsl::int_vector<64>(paths.size() + 1));
+        uint64_t total = 0;
+        for (uint64_t i = 0; i < paths.size(); ++i) {
+            path_runs[i] = total;
+            total += runs[i].size();
+        }
+        path_runs[paths.size()] = total;
+        sdsl::util::assign(run_offsets, sdsl::int_vector<64>(total));
+        sdsl::util::assign(run_pos, sdsl::int_vector<64>(total));
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+        for (uint64_t i = 0; i < paths.size(); ++i) {
+            uint64_t j = path_runs[i];
+            for (auto &run : runs[i]) {
+                run_offsets[j] = run.first;
+                run_pos[j] = run.second;
+                ++j;
+            }
+            std::vector<std::pair<uint64_t, uint64_t>>().swap(runs[i]);
+        }
+    }
+
+    bool PanPosTable::empty() const {
+        return path_runs.empty();
+    }
+
+    size_t PanPosTable::get_pangenome_pos(const handlegraph::path_handle_t &path_handle, const size_t &nuc_pos) const {
+        const uint64_t rank = as_integer(path_handle) - 1;
+        const uint64_t *runs = run_offsets.data();
+        // the last run starting at or before the position
+        const uint64_t k = std::upper_bound(runs + path_runs[rank], runs + path_runs[rank + 1], (uint64_t) nuc_pos)
+                           - runs - 1;
+        const uint64_t walked = nuc_pos - run_offsets[k];
+        const uint64_t pos = run_pos[k];
+        return (pos & reverse_bit) ? (pos & ~reverse_bit) - walked : pos + walked;
+    }
+
+    size_t PanPosTable::serialize(std::ostream &out, sdsl::structure_tree_node *v, std::string name) const {
+        sdsl::structure_tree_node *child = sdsl::structure_tree::add_child(v, name, sdsl::util::class_name(*this));
+        size_t written = 0;
+        written += path_runs.serialize(out, child, "path_runs");
+        written += run_offsets.serialize(out, child, "run_offsets");
+        written += run_pos.serialize(out, child, "run_pangenome_pos");
+        sdsl::structure_tree::add_size(child, written);
+        return written;
+    }
+
+    void PanPosTable::load(std::istream &in) {
+        path_runs.load(in);
+        run_offsets.load(in);
+        run_pos.load(in);
+    }
+
     ////////////////////////////////////////////////////////////////////////////
     // Here is XPPath
     ////////////////////////////////////////////////////////////////////////////
@@ -687,58 +918,98 @@ namespace xp {
 // We use this to make the API thread-safe
         std::recursive_mutex monitor;
 
-        std::string temp_dir;
+        std::vector<std::string> temp_dirs;
+        uint64_t next_temp_dir = 0;
+        uint64_t buffer_size = 4 << 20;
 
 /// Because the names are in a static object, we can delete them when
 /// std::exit() is called.
         struct Handler {
             std::set<std::string> filenames;
-            std::string parent_directory;
+            std::map<std::string, std::string> parent_directories; // temp dir -> our directory in it
+            bool signals_installed = false;
             ~Handler() {
                 cleanup();
             }
         } handler;
 
-        void cleanup() {
-            std::lock_guard<std::recursive_mutex> lock(monitor);
+        void remove_all() {
             for (auto &filename : handler.filenames) {
                 std::remove(filename.c_str());
             }
             handler.filenames.clear();
-            if (!handler.parent_directory.empty()) {
+            for (auto &dirs : handler.parent_directories) {
+                const std::string &parent_directory = dirs.second;
                 // There may be extraneous files in the directory still (like .fai files)
-                auto directory = opendir(handler.parent_directory.c_str());
-                dirent *dp;
-                while ((dp = readdir(directory)) != nullptr) {
-                    // For every item still in it, delete it.
-                    // TODO: Maybe eventually recursively delete?
-                    std::remove((handler.parent_directory + "/" + dp->d_name).c_str());
+                auto directory = opendir(parent_directory.c_str());
+                if (directory != nullptr) {
+                    dirent *dp;
+                    while ((dp = readdir(directory)) != nullptr) {
+                        // For every item still in it, delete it.
+                        // TODO: Maybe eventually recursively delete?
+                        std::remove((parent_directory + "/" + dp->d_name).c_str());
+                    }
+                    closedir(directory);
                 }
-                closedir(directory);
                 // Delete the directory itself
-                std::remove(handler.parent_directory.c_str());
-                // clean up record of directory
-                handler.parent_directory.clear();
+                std::remove(parent_directory.c_str());
             }
+            // clean up record of directories
+            handler.parent_directories.clear();
         }
 
-        std::string create(const std::string &base) {
+        void cleanup() {
             std::lock_guard<std::recursive_mutex> lock(monitor);
+            remove_all();
+        }
+
+        void cleanup_on_signal(int sig) {
+            // best effort: the interrupted thread may be holding the monitor, so we don't take it
+            remove_all();
+            std::signal(sig, SIG_DFL);
+            std::raise(sig);
+        }
 
-            if (handler.parent_directory.empty()) {
-                // Make a parent directory for our temp files
-                std::string tmpdirname = get_dir() + "/xp-XXXXXX";
-                auto got = mkdtemp((char*)tmpdirname.c_str());
-                if (got != nullptr) {
-                    // Save the directory we got
-                    handler.parent_directory = got;
-                } else {
-                    std::cerr << "[xp::temp_file]: couldn't create temp directory: " << tmpdirname << std::endl;
-                    exit(1);
+        void install_signal_handlers() {
+            if (handler.signals_installed) {
+                return;
+            }
+            handler.signals_installed = true;
+            for (int sig : {SIGINT, SIGTERM, SIGHUP, SIGQUIT}) {
+                // leave alone the signals that somebody else already handles or ignores
+                struct sigaction current;
+                if (sigaction(sig, nullptr, &current) == 0 && current.sa_handler == SIG_DFL) {
+                    std::signal(sig, cleanup_on_signal);
                 }
             }
+        }
 
-            std::string tmpname = handler.parent_directory + "/" + base + "XXXXXX";
+        std::string work_dir() {
+            std::lock_guard<std::recursive_mutex> lock(monitor);
+
+            get_dir();
+            const std::string &dir = temp_dirs[next_temp_dir++ % temp_dirs.size()];
+            auto f = handler.parent_directories.find(dir);
+            if (f != handler.parent_directories.end()) {
+                return f->second;
+            }
+            install_signal_handlers();
+            // Make a parent directory for our temp files
+            std::string tmpdirname = dir + "/xp-XXXXXX";
+            auto got = mkdtemp((char*)tmpdirname.c_str());
+            if (got == nullptr) {
+                std::cerr << "[xp::temp_file]: couldn't create temp directory: " << tmpdirname << std::endl;
+                exit(1);
+            }
+            // Save the directory we got
+            handler.parent_directories[dir] = got;
+            return got;
+        }
+
+        std::string create(const std::string &base) {
+            std::lock_guard<std::recursive_mutex> lock(monitor);
+
+            std::string tmpname = work_dir() + "/" + base + "XXXXXX";
             // hack to use mkstemp to get us a safe temporary file name
             int fd = mkstemp(&tmpname[0]);
             if (fd != -1) {
@@ -768,33 +1039,51 @@ namespace xp {
         void set_dir(const std::string &new_temp_dir) {
             std::lock_guard<std::recursive_mutex> lock(monitor);
 
-            temp_dir = new_temp_dir;
+            temp_dirs.clear();
+            next_temp_dir = 0;
+            std::stringstream dirs(new_temp_dir);
+            std::string dir;
+            while (std::getline(dirs, dir, ',')) {
+                if (!dir.empty()) {
+                    temp_dirs.push_back(dir);
+                }
+            }
         }
 
         std::string get_dir() {
             std::lock_guard<std::recursive_mutex> lock(monitor);
 
-            // Get the default temp dir from environment variables.
-            if (temp_dir.empty()) {
+            // Default to the working directory
+            if (temp_dirs.empty()) {
                 char cwd[512];
                 getcwd(cwd, sizeof(cwd));
-                temp_dir = std::string(cwd);
-                /*const char *system_temp_dir = nullptr;
-                for (const char *var_name : {"TMPDIR", "TMP", "TEMP", "TEMPDIR", "USERPROFILE"}) {
-                    if (system_temp_dir == nullptr) {
-                        system_temp_dir = getenv(var_name);
-                    }
-                }
-                if (system_temp_dir == nullptr) {
-                    char cwd[512];
-                    getcwd(cwd, sizeof(cwd));
-                    temp_dir = std::string(cwd);
-                } else {
-                    temp_dir = system_temp_dir;
-                }*/
+                temp_dirs.push_back(std::string(cwd));
             }
 
-            return temp_dir;
+            return temp_dirs.front();
+        }
+
+        void set_buffer_size(const uint64_t &bytes) {
+            std::lock_guard<std::recursive_mutex> lock(monitor);
+
+            buffer_size = std::max(bytes, (uint64_t)4096);
+        }
+
+        uint64_t get_buffer_size() {
+            std::lock_guard<std::recursive_mutex> lock(monitor);
+
+            return buffer_size;
+        }
+
+        ofstream_t::ofstream_t(const std::string &filename)
+            : buffer(nullptr, std::free) {
+            const uint64_t size = (get_buffer_size() + 4095) / 4096 * 4096;
+            buffer.reset((char *)std::aligned_alloc(4096, size));
+            // the buffer has to be in place before the file is opened
+            if (buffer) {
+                rdbuf()->pubsetbuf(buffer.get(), size);
+            }
+            open(filename.c_str(), std::ios::binary);
         }
     }
 }
@@ -2,6 +2,7 @@
 
 #include <iostream>
 #include <fstream>
+#include <memory>
 #include <string>
 #include <dirent.h>
 #include <omp.h>
@@ -37,6 +38,32 @@ namespace xp {
         using std::runtime_error::runtime_error;
     };
 
+    /**
+    * The steps of each path cut into runs that are contiguous in the pangenome, going forward or
+    * backward, so that a path offset is turned into a pangenome offset by one binary search over
+    * the run starts of its path, without the rank and select queries of the XPPath.
+    */
+    class PanPosTable {
+    public:
+        /// Build the runs of the given paths, whose path handles are their rank + 1
+        void build(const std::vector<XPPath *> &paths, const sdsl::enc_vector<> &pos_map_iv, const uint64_t &nthreads);
+
+        bool empty() const;
+
+        /// The 0-based pangenome offset of the 0-based offset on the path, which must be on it
+        size_t get_pangenome_pos(const handlegraph::path_handle_t &path_handle, const size_t &nuc_pos) const;
+
+        size_t serialize(std::ostream &out, sdsl::structure_tree_node *v = nullptr, std::string name = "") const;
+
+        void load(std::istream &in);
+
+    private:
+        static const uint64_t reverse_bit = (uint64_t)1 << 63;
+        sdsl::int_vector<64> path_runs;    // index of the first run of each path by rank, and the end
+        sdsl::int_vector<64> run_offsets;  // path offset of the first base of each run
+        sdsl::int_vector<64> run_pos;      // its pangenome offset, with reverse_bit set for backward runs
+    };
+
     /**
     * Provides succinct storage for the positional paths of a graph.
     */
@@ -67,15 +94,27 @@ namespace xp {
 
         /// Build the path index from a simple graph.
         void from_handle_graph(odgi::graph_t &graph, const uint64_t& nthreads);
-        void from_handle_graph(odgi::graph_t &graph, std::string basename, const uint64_t& nthreads);
+        void from_handle_graph(odgi::graph_t &graph, std::string basename, const uint64_t& nthreads,
+                               const std::vector<handlegraph::path_handle_t>* indexed_paths = nullptr);
+
+        /// Build the path index of the given paths only, such as those a path guided SGD samples from. The
+        /// other paths keep their handle and name, but have no steps in the index.
+        void from_handle_graph(odgi::graph_t &graph, const std::vector<handlegraph::path_handle_t>& indexed_paths,
+                               const uint64_t& nthreads);
 
         /// helper to builder
-        void from_handle_graph_impl(odgi::graph_t &graph, const std::string& basename, const uint64_t& nthreads);
+        void from_handle_graph_impl(odgi::graph_t &graph, const std::string& basename, const uint64_t& nthreads,
+                                    const std::vector<handlegraph::path_handle_t>* indexed_paths = nullptr);
 
         /// Load this XP index from a stream. Throw an XPFormatError if the stream
         /// does not produce a valid XP file.
         void load(std::istream &in);
 
+        /// Load this XP index from a file through a read-only memory mapping, so that
+        /// the sdsl structures are filled straight from the page cache, which is shared
+        /// between the processes loading the same index.
+        void load(const std::string& filename);
+
         /// Alias for load() to match the SerializableHandleGraph interface.
         void deserialize_members(std::istream &in);
 
@@ -123,8 +162,23 @@ namespace xp {
         /// 0-base positioning!
         /// Will exit with (1) if the given path name is not in the index.
         /// Will exit with (1) given position is not in the given path.
+        /// Answered from the pangenome position table when the index has one.
         size_t get_pangenome_pos(const std::string &path_name, const size_t &nuc_pos) const;
 
+        /// Look up the pangenome position of a 0-based position on a path of the index, which must be on it
+        size_t get_pangenome_pos(const handlegraph::path_handle_t &path_handle, const size_t &nuc_pos) const;
+
+        /// Build the pangenome position table, which is saved with the index
+        void build_pangenome_pos_table(const uint64_t& nthreads);
+
+        bool has_pangenome_pos_table() const;
+
+        /// Spread the step tables that the path guided SGD samples from over the NUMA nodes, see algorithms::numa
+        void interleave_memory() const;
+
+        /// Ask for transparent huge pages on the same step tables, see algorithms::huge_pages
+        void advise_huge_pages() const;
+
         /// Get the path of the given path name
         const XPPath& get_path(const std::string& name) const;
 
@@ -172,6 +226,9 @@ namespace xp {
         sdsl::bit_vector np_bv;
         // sdsl::bit_vector::rank_1_type np_bv_rank;
         sdsl::bit_vector::select_1_type np_bv_select;
+
+        // optional, written after the rest of the index behind its own magic number
+        PanPosTable panpos_table;
     };
 
     class XPPath {
@@ -224,14 +281,16 @@ namespace xp {
 
     /**
  * Temporary files. Create with create() and remove with remove(). All
- * temporary files will be deleted when the program exits normally or with
- * std::exit(). The files will be created in a directory determined from
- * environment variables, though this can be overridden with set_dir().
+ * temporary files will be deleted when the program exits normally, with
+ * std::exit(), or on SIGINT, SIGTERM, SIGHUP and SIGQUIT. The files will be
+ * created in the working directory, though this can be overridden with
+ * set_dir(), which also takes a comma-separated list of directories that new
+ * files are spread over in turn (e.g. one per local drive).
  * The interface is thread-safe.
  */
     namespace temp_file {
 
-/// Clean up our files and temporary directory
+/// Clean up our files and temporary directories
         void cleanup();
 
 /// Create a temporary file starting with the given base name
@@ -240,15 +299,32 @@ namespace xp {
 /// Create a temporary file
         std::string create();
 
+/// Our own directory inside the next temp dir in turn, for tools that name their own files
+        std::string work_dir();
+
 /// Remove a temporary file
         void remove(const std::string &filename);
 
-/// Set a temp dir, overriding system defaults and environment variables.
+/// Set the temp dir, or a comma-separated list of them, overriding the working directory.
         void set_dir(const std::string &new_temp_dir);
 
-/// Get the current temp dir
+/// Get the current temp dir, the first one if there are several
         std::string get_dir();
 
+/// Set the size of the buffer of the streams opened with ofstream_t
+        void set_buffer_size(const uint64_t &bytes);
+
+/// Get the size of the buffer of the streams opened with ofstream_t
+        uint64_t get_buffer_size();
+
+/// An output file stream with a large, page aligned buffer, for writing temporary files in big blocks
+        class ofstream_t : public std::ofstream {
+        public:
+            explicit ofstream_t(const std::string &filename);
+        private:
+            std::unique_ptr<char, void (*)(void *)> buffer;
+        };
+
     } // namespace temp_file
 
     /// Uses OMP to get the count of threads
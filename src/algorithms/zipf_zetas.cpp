@@ -0,0 +1,161 @@
+#include "zipf_zetas.hpp"
+#include "dirty_zipfian_int_distribution.h"
+
+#include <mutex>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+namespace odgi {
+namespace algorithms {
+
+namespace zipf_zetas_cache {
+
+    namespace {
+        std::mutex mutex;
+        std::string cache_dir;
+    }
+
+    void set_dir(const std::string &dir) {
+        std::lock_guard<std::mutex> guard(mutex);
+        cache_dir = dir;
+    }
+
+    std::string get_dir(void) {
+        std::lock_guard<std::mutex> guard(mutex);
+        return cache_dir;
+    }
+
+}
+
+namespace {
+
+    const char zetas_magic[8] = {'o', 'd', 'g', 'i', 'z', 'e', 't', 'a'};
+
+    struct zetas_header_t {
+        char magic[8];
+        double theta;
+        uint64_t space;
+        uint64_t space_max;
+        uint64_t space_quantization_step;
+        uint64_t count;
+    };
+
+    std::string zetas_file_name(const std::string &dir, const double &theta, const uint64_t &space,
+                                const uint64_t &space_max, const uint64_t &space_quantization_step) {
+        uint64_t theta_bits;
+        std::memcpy(&theta_bits, &theta, sizeof(theta_bits));
+        std::stringstream name;
+        name << dir << "/odgi-zipf-zetas-" << std::hex << theta_bits << std::dec
+             << "-" << space << "-" << space_max << "-" << space_quantization_step << ".bin";
+        return name.str();
+    }
+
+    bool load_zetas(const std::string &file_name, const zetas_header_t &expected, std::vector<double> &zetas) {
+        std::ifstream in(file_name, std::ios::binary);
+        zetas_header_t header;
+        if (!in.read((char *) &header, sizeof(header))
+            || std::memcmp(&header, &expected, sizeof(header)) != 0) {
+            return false;
+        }
+        zetas.resize(header.count);
+        return (bool) in.read((char *) zetas.data(), zetas.size() * sizeof(double));
+    }
+
+    void store_zetas(const std::string &file_name, const zetas_header_t &header, const std::vector<double> &zetas) {
+        // write aside and rename, so concurrent jobs only ever see complete tables
+        const std::string tmp_name = file_name + ".tmp." + std::to_string(getpid());
+        std::ofstream out(tmp_name, std::ios::binary);
+        out.write((const char *) &header, sizeof(header));
+        out.write((const char *) zetas.data(), zetas.size() * sizeof(double));
+        out.close();
+        if (!out || std::rename(tmp_name.c_str(), file_name.c_str()) != 0) {
+            std::remove(tmp_name.c_str());
+        }
+    }
+
+}
+
+std::vector<double> zipf_zetas(const double &theta,
+                               const uint64_t &space,
+                               const uint64_t &space_max,
+                               const uint64_t &space_quantization_step,
+                               const uint64_t &nthreads) {
+    const uint64_t count = (space <= space_max ? space : space_max + (space - space_max) / space_quantization_step + 1) + 1;
+    zetas_header_t header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, zetas_magic, sizeof(zetas_magic));
+    header.theta = theta;
+    header.space = space;
+    header.space_max = space_max;
+    header.space_quantization_step = space_quantization_step;
+    header.count = count;
+
+    const std::string dir = zipf_zetas_cache::get_dir();
+    std::string file_name;
+    std::vector<double> zetas;
+    if (!dir.empty()) {
+        file_name = zetas_file_name(dir, theta, space, space_max, space_quantization_step);
+        if (load_zetas(file_name, header, zetas)) {
+            return zetas;
+        }
+    }
+
+    zetas.assign(count, 0.0);
+    // the index of the table entry holding the sum up to i, if any
+    auto entry_of = [&](const uint64_t &i, const bool &quantized) -> int64_t {
+        if (!quantized) {
+            return i <= space_max ? (int64_t) i : -1;
+        }
+        return i >= space_max && (i - space_max) % space_quantization_step == 0
+               ? (int64_t) (space_max + 1 + (i - space_max) / space_quantization_step) : -1;
+    };
+    // sum each chunk on its own, then add the sums of the chunks before it
+    const uint64_t chunk_size = 1 << 16;
+    const uint64_t chunk_count = (space + chunk_size - 1) / chunk_size;
+    std::vector<double> chunk_sums(chunk_count, 0.0);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+    for (uint64_t c = 0; c < chunk_count; ++c) {
+        const uint64_t begin = 1 + c * chunk_size;
+        const uint64_t end = std::min(space + 1, begin + chunk_size);
+        double zeta_tmp = 0.0;
+        for (uint64_t i = begin; i < end; ++i) {
+            zeta_tmp += dirtyzipf::fast_precise_pow(1.0 / i, theta);
+            for (const bool quantized : {false, true}) {
+                const int64_t e = entry_of(i, quantized);
+                if (e >= 0) {
+                    zetas[e] = zeta_tmp;
+                }
+            }
+        }
+        chunk_sums[c] = zeta_tmp;
+    }
+    std::vector<double> chunk_offsets(chunk_count, 0.0);
+    for (uint64_t c = 1; c < chunk_count; ++c) {
+        chunk_offsets[c] = chunk_offsets[c - 1] + chunk_sums[c - 1];
+    }
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+    for (uint64_t c = 1; c < chunk_count; ++c) {
+        const uint64_t begin = 1 + c * chunk_size;
+        const uint64_t end = std::min(space + 1, begin + chunk_size);
+        for (uint64_t i = begin; i < end; ++i) {
+            for (const bool quantized : {false, true}) {
+                const int64_t e = entry_of(i, quantized);
+                if (e >= 0) {
+                    zetas[e] += chunk_offsets[c];
+                }
+            }
+        }
+    }
+
+    if (!file_name.empty()) {
+        store_zetas(file_name, header, zetas);
+    }
+    return zetas;
+}
+
+}
+}
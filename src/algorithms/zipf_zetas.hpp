@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+namespace odgi {
+namespace algorithms {
+
+/// The zeta values of the quantized zipfian distributions that the path-guided SGD draws its jumps from.
+/// Entry i, for i <= space_max, is the sum of 1/k^theta for k in [1, i]; entry space_max + 1 + m is the same
+/// sum up to space_max + m * space_quantization_step. The sums are taken in fixed chunks in parallel, so the
+/// values don't depend on the number of threads. When a cache directory is set, the table is read from a
+/// file there keyed by its parameters, or written to it on first use.
+std::vector<double> zipf_zetas(const double &theta,
+                               const uint64_t &space,
+                               const uint64_t &space_max,
+                               const uint64_t &space_quantization_step,
+                               const uint64_t &nthreads);
+
+namespace zipf_zetas_cache {
+
+/// Set the directory to keep the zeta tables in, empty to not cache them
+void set_dir(const std::string &dir);
+
+std::string get_dir(void);
+
+}
+
+}
+}
@@ -0,0 +1,277 @@
+/**
+ * \file
+ * bench/graph_bench.cpp: microbenchmarks for the hot operations of graph_t.
+ *
+ * Each input GFA is built once, then chopped to each of the given maximum node lengths,
+ * which scales the number of nodes, edges and steps while keeping the paths. The timings
+ * are the best of the given number of repeats, written as TSV on stdout. The path-guided SGD
+ * runs also report how well their layouts fit the paths on stderr.
+ */
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <limits>
+#include "odgi.hpp"
+#include "gfa_to_handle.hpp"
+#include "algorithms/xp.hpp"
+#include "algorithms/path_sgd.hpp"
+#include "args.hxx"
+
+using namespace odgi;
+
+namespace {
+
+    /// Best wall time in seconds of the given number of runs of func, with setup untimed
+    double best_of(uint64_t repeats,
+                   const std::function<void(void)>& setup,
+                   const std::function<void(void)>& func) {
+        double best = std::numeric_limits<double>::max();
+        for (uint64_t i = 0; i < repeats; ++i) {
+            setup();
+            auto start = std::chrono::steady_clock::now();
+            func();
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count());
+        }
+        return best;
+    }
+
+    /// Split every node longer than max_node_length, as odgi chop does
+    void chop(graph_t& graph, uint64_t max_node_length) {
+        std::vector<handle_t> to_chop;
+        graph.for_each_handle([&](const handle_t& h) {
+            if (graph.get_length(h) > max_node_length) {
+                to_chop.push_back(h);
+            }
+        });
+        for (auto& h : to_chop) {
+            std::vector<size_t> offsets;
+            const uint64_t length = graph.get_length(h);
+            for (uint64_t i = max_node_length; i < length; i += max_node_length) {
+                offsets.push_back(i);
+            }
+            graph.divide_handle(h, offsets);
+        }
+    }
+
+    /// Mean relative error between the layout distance and the path distance of consecutive
+    /// steps, to check that a faster sampler still converges
+    double adjacent_step_error(const graph_t& graph, const std::vector<double>& layout) {
+        double error = 0;
+        uint64_t pairs = 0;
+        graph.for_each_path_handle([&](const path_handle_t& p) {
+            step_handle_t s = graph.path_begin(p);
+            const step_handle_t end = graph.path_end(p);
+            while (s != end && graph.has_next_step(s)) {
+                const step_handle_t next = graph.get_next_step(s);
+                const handle_t h = graph.get_handle_of_step(s);
+                const double d = graph.get_length(h);
+                const double x = std::abs(layout[number_bool_packing::unpack_number(graph.get_handle_of_step(next))]
+                                          - layout[number_bool_packing::unpack_number(h)]);
+                error += std::abs(x - d) / d;
+                ++pairs;
+                s = next;
+            }
+        });
+        return pairs ? error / pairs : 0;
+    }
+
+}
+
+int main(int argc, char** argv) {
+    args::ArgumentParser parser("Benchmark the hot operations of graph_t on the given GFA files.");
+    args::ValueFlagList<std::string> gfa_files(parser, "FILE", "A GFA file to benchmark on, can be given several times (default: the test graphs DRB1-3123, LPA, chr6.C4 in test/).", {'i', "gfa"});
+    args::ValueFlag<std::string> scales_arg(parser, "N,N,...", "Maximum node lengths to chop the graphs to, 0 keeps the graph as built (default: 0,32,8).", {'c', "chop-to"});
+    args::ValueFlag<uint64_t> repeats_arg(parser, "N", "Repeat each measurement N times and keep the best (default: 3).", {'r', "repeats"});
+    args::ValueFlag<uint64_t> threads_arg(parser, "N", "Number of threads for building and loading the graphs, and for the path-guided SGD (default: 1).", {'t', "threads"});
+    args::ValueFlag<uint64_t> batch_terms_arg(parser, "N", "Batch size of the batched path-guided SGD sampler (default: 1024).", {'b', "batch-terms"});
+    args::HelpFlag help(parser, "help", "Print a help message for odgi_bench.", {'h', "help"});
+    try {
+        parser.ParseCLI(argc, argv);
+    } catch (args::Help) {
+        std::cout << parser;
+        return 0;
+    } catch (args::ParseError e) {
+        std::cerr << e.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+
+    std::vector<std::string> inputs = args::get(gfa_files);
+    if (inputs.empty()) {
+        inputs = { "test/DRB1-3123.gfa", "test/LPA.gfa", "test/chr6.C4.gfa" };
+    }
+    std::vector<uint64_t> scales;
+    {
+        std::stringstream ss(scales_arg ? args::get(scales_arg) : "0,32,8");
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            scales.push_back(std::stoull(item));
+        }
+    }
+    const uint64_t repeats = repeats_arg ? std::max(args::get(repeats_arg), (uint64_t)1) : 3;
+    const uint64_t num_threads = threads_arg ? std::max(args::get(threads_arg), (uint64_t)1) : 1;
+    const uint64_t batch_terms = batch_terms_arg ? std::max(args::get(batch_terms_arg), (uint64_t)1) : 1024;
+
+    std::cout << "graph\tchop.to\tnodes\tedges\tsteps\toperation\tseconds\titems\titems.per.second" << std::endl;
+    for (auto& input : inputs) {
+        graph_t base;
+        gfa_to_handle(input, &base, false, num_threads, false);
+        base.set_number_of_threads(num_threads);
+        for (auto& scale : scales) {
+            graph_t graph;
+            uint64_t chopped_nodes = 0;
+            double chop_time = 0;
+            if (scale > 0) {
+                chop_time = best_of(repeats,
+                                    [&](void) { graph.copy(base); },
+                                    [&](void) { chop(graph, scale); });
+                chopped_nodes = graph.get_node_count();
+                graph.optimize();
+            } else {
+                graph.copy(base);
+            }
+            graph.set_number_of_threads(num_threads);
+            uint64_t steps = 0;
+            graph.for_each_path_handle([&](const path_handle_t& p) {
+                steps += graph.get_step_count(p);
+            });
+            const uint64_t nodes = graph.get_node_count();
+            auto report = [&](const std::string& operation, double seconds, uint64_t items) {
+                std::cout << input << "\t" << scale << "\t" << nodes << "\t" << graph.get_edge_count() << "\t" << steps
+                          << "\t" << operation << "\t" << seconds << "\t" << items
+                          << "\t" << (seconds > 0 ? items / seconds : 0) << std::endl;
+            };
+            auto no_setup = [](void) {};
+
+            if (scale > 0) {
+                report("divide_handle", chop_time, chopped_nodes);
+            }
+
+            uint64_t followed = 0;
+            const double follow_edges_time = best_of(repeats, no_setup, [&](void) {
+                followed = 0;
+                graph.for_each_handle([&](const handle_t& h) {
+                    for (bool go_left : {false, true}) {
+                        graph.follow_edges(h, go_left, [&](const handle_t& next) { ++followed; });
+                    }
+                });
+            });
+            report("follow_edges", follow_edges_time, followed);
+
+            uint64_t visited = 0;
+            const double for_each_step_on_handle_time = best_of(repeats, no_setup, [&](void) {
+                visited = 0;
+                graph.for_each_handle([&](const handle_t& h) {
+                    graph.for_each_step_on_handle(h, [&](const step_handle_t& s) { ++visited; });
+                });
+            });
+            report("for_each_step_on_handle", for_each_step_on_handle_time, visited);
+
+            uint64_t walked = 0;
+            const double get_next_step_time = best_of(repeats, no_setup, [&](void) {
+                walked = 0;
+                graph.for_each_path_handle([&](const path_handle_t& p) {
+                    const step_handle_t end = graph.path_end(p);
+                    for (step_handle_t s = graph.path_begin(p); s != end; s = graph.get_next_step(s)) {
+                        ++walked;
+                    }
+                });
+            });
+            report("get_next_step", get_next_step_time, walked);
+
+            // copy each path step by step into a new path, the copies are dropped between runs
+            std::vector<std::vector<handle_t>> path_handles;
+            graph.for_each_path_handle([&](const path_handle_t& p) {
+                path_handles.emplace_back();
+                graph.for_each_step_in_path(p, [&](const step_handle_t& s) {
+                    path_handles.back().push_back(graph.get_handle_of_step(s));
+                });
+            });
+            std::vector<path_handle_t> copies;
+            const double append_step_time = best_of(repeats, [&](void) {
+                for (auto& c : copies) {
+                    graph.destroy_path(c);
+                }
+                copies.clear();
+            }, [&](void) {
+                for (uint64_t i = 0; i < path_handles.size(); ++i) {
+                    path_handle_t c = graph.create_path_handle("odgi_bench_copy_" + std::to_string(i));
+                    for (auto& h : path_handles[i]) {
+                        graph.append_step(c, h);
+                    }
+                    copies.push_back(c);
+                }
+            });
+            report("append_step", append_step_time, steps);
+            for (auto& c : copies) {
+                graph.destroy_path(c);
+            }
+            path_handles.clear();
+
+            graph_t reordered;
+            const double apply_ordering_time = best_of(repeats, [&](void) {
+                reordered.copy(graph);
+            }, [&](void) {
+                std::vector<handle_t> order;
+                order.reserve(nodes);
+                reordered.for_each_handle([&](const handle_t& h) { order.push_back(h); });
+                std::reverse(order.begin(), order.end());
+                reordered.apply_ordering(order, true);
+            });
+            report("apply_ordering", apply_ordering_time, nodes);
+            reordered.clear();
+
+            std::string serialized;
+            const double serialize_time = best_of(repeats, no_setup, [&](void) {
+                std::stringstream out;
+                graph.serialize(out);
+                serialized = out.str();
+            });
+            report("serialize", serialize_time, serialized.size());
+
+            const double deserialize_time = best_of(repeats, no_setup, [&](void) {
+                std::stringstream in(serialized);
+                graph_t loaded;
+                loaded.set_number_of_threads(num_threads);
+                loaded.deserialize(in);
+            });
+            report("deserialize", deserialize_time, serialized.size());
+
+            // the path-guided 1D SGD of odgi sort -Y, with its default parameters but fewer iterations,
+            // drawing each term from all paths and in batches from path windows
+            xp::XP path_index;
+            path_index.from_handle_graph(graph, num_threads);
+            std::vector<path_handle_t> paths;
+            uint64_t max_path_steps = 0;
+            uint64_t max_path_length = 0;
+            graph.for_each_path_handle([&](const path_handle_t& p) {
+                paths.push_back(p);
+                max_path_steps = std::max(max_path_steps, (uint64_t)graph.get_step_count(p));
+                max_path_length = std::max(max_path_length, (uint64_t)path_index.get_path_length(p));
+            });
+            const uint64_t sgd_iter_max = 10;
+            std::vector<bool> no_targets;
+            for (const uint64_t batch : {(uint64_t)0, batch_terms}) {
+                std::vector<double> layout;
+                const double sgd_time = best_of(repeats, no_setup, [&](void) {
+                    std::vector<std::string> snapshots;
+                    layout = algorithms::path_linear_sgd(graph, path_index, paths, sgd_iter_max, 0, steps,
+                                                         0, 0.01, (double)(max_path_steps * max_path_steps), 0.99,
+                                                         max_path_length, 100, 100, 0.5, num_threads,
+                                                         false, false, snapshots, false, no_targets, false, batch);
+                });
+                const std::string operation = batch ? "path_linear_sgd.batched" : "path_linear_sgd";
+                report(operation, sgd_time, sgd_iter_max * steps);
+                std::cerr << "[odgi_bench] " << input << " chop.to " << scale << " " << operation
+                          << " adjacent step error: " << adjacent_step_error(graph, layout) << std::endl;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include "cpu_dispatch.hpp"
+#include <cstdlib>
+#include <map>
+
+namespace odgi {
+namespace cpu {
+
+    const char* isa_name(const isa_t& isa) {
+        switch (isa) {
+            case isa_popcnt: return "popcnt";
+            case isa_avx2: return "avx2";
+            case isa_avx512: return "avx512";
+            default: return "generic";
+        }
+    }
+
+    isa_t detected_isa(void) {
+        // kernels resolve during static initialization, so this must not rely on the constructors of others
+        static const isa_t isa = []() {
+            isa_t best = isa_generic;
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("popcnt")) {
+                best = isa_popcnt;
+                if (__builtin_cpu_supports("avx2")) {
+                    best = isa_avx2;
+                    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")
+                        && __builtin_cpu_supports("avx512vpopcntdq")) {
+                        best = isa_avx512;
+                    }
+                }
+            }
+#endif
+            const char* forced = std::getenv("ODGI_CPU");
+            if (forced != nullptr) {
+                for (isa_t lower = isa_generic; lower < best; lower = (isa_t)(lower + 1)) {
+                    if (std::string(forced) == isa_name(lower)) {
+                        best = lower;
+                    }
+                }
+            }
+            return best;
+        }();
+        return isa;
+    }
+
+    /// Kept in a static variable of a function, so that it is built before the kernels of any file use it
+    static std::map<std::string, kernel_info_t>& get_registry(void) {
+        static std::map<std::string, kernel_info_t> registry;
+        return registry;
+    }
+
+    void register_kernel(const kernel_info_t& info) {
+        get_registry()[info.name] = info;
+    }
+
+    void for_each_kernel(const std::function<void(const kernel_info_t&)>& lambda) {
+        for (auto& k : get_registry()) {
+            lambda(k.second);
+        }
+    }
+
+}
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+/** \file
+ * cpu_dispatch.hpp: chooses, once per run, the variant of a kernel built for the best instruction set
+ * of the CPU, so that one binary uses AVX2 or AVX-512 where they are and falls back where they are not
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <utility>
+#include <initializer_list>
+#include <functional>
+
+namespace odgi {
+namespace cpu {
+
+    /// The instruction sets the kernels have variants for, each one including the ones before it;
+    /// isa_avx512 stands for AVX-512 F, BW and VPOPCNTDQ
+    enum isa_t {
+        isa_generic = 0,
+        isa_popcnt,
+        isa_avx2,
+        isa_avx512,
+    };
+
+    const char* isa_name(const isa_t& isa);
+
+    /// The best instruction set of this CPU, lowered to the one named by the ODGI_CPU environment variable
+    /// (generic, popcnt, avx2 or avx512) if that is lower, so that a fallback can be tried on any host
+    isa_t detected_isa(void);
+
+    /// What a kernel was built for and the variant it runs
+    struct kernel_info_t {
+        std::string name;
+        std::vector<isa_t> variants;
+        isa_t selected;
+    };
+
+    /// Call the lambda for each kernel, in name order
+    void for_each_kernel(const std::function<void(const kernel_info_t&)>& lambda);
+
+    /// Note the variants of a kernel and the one it runs, for for_each_kernel
+    void register_kernel(const kernel_info_t& info);
+
+    /**
+     * A kernel with a function per instruction set, which resolves to the variant of the best set the CPU
+     * has when it is constructed. Kernels are static objects of the file that defines their variants:
+     *
+     *     static cpu::kernel_t<uint64_t(*)(const uint64_t*, uint64_t)> count_bits(
+     *         "count_bits", {{cpu::isa_generic, count_bits_generic}, {cpu::isa_avx2, count_bits_avx2}});
+     *     ...
+     *     count_bits(words, n);
+     *
+     * A generic variant must be given. The variants of the other sets are compiled for them, with a target
+     * attribute, whatever the flags of the build.
+     */
+    template<typename F>
+    class kernel_t {
+    public:
+        kernel_t(const char* name, std::initializer_list<std::pair<isa_t, F>> variants) {
+            kernel_info_t info{name, {}, isa_generic};
+            const isa_t best = detected_isa();
+            for (auto& v : variants) {
+                info.variants.push_back(v.first);
+                if (v.first <= best && (function == nullptr || v.first >= info.selected)) {
+                    function = v.second;
+                    info.selected = v.first;
+                }
+            }
+            register_kernel(info);
+        }
+
+        template<typename... Args>
+        auto operator()(Args&&... args) const {
+            return function(std::forward<Args>(args)...);
+        }
+
+    private:
+        F function = nullptr;
+    };
+
+}
+}
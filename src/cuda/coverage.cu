@@ -0,0 +1,146 @@
+#include "coverage.h"
+#include "layout.h"
+#include <cuda.h>
+#include <memory>
+#include <algorithm>
+#include "cuda_runtime_api.h"
+
+namespace cuda {
+
+#define COVERAGE_BLOCK_SIZE 256
+#define COVERAGE_MAX_BLOCKS 65535
+
+/// Add each step whose node (id - 1) is in [first, end) to the count of its path on its node
+__global__
+void count_steps_kernel(cuda::path_data_t path_data, uint64_t first, uint64_t end, uint32_t path_count, uint32_t *counts) {
+    const uint64_t stride = (uint64_t) blockDim.x * gridDim.x;
+    for (uint64_t i = (uint64_t) blockIdx.x * blockDim.x + threadIdx.x; i < path_data.total_path_steps; i += stride) {
+        const path_element_t &e = path_data.element_array[i];
+        if (e.node_id >= first && e.node_id < end) {
+            atomicAdd(&counts[(uint64_t) (e.node_id - first) * path_count + e.pidx], 1u);
+        }
+    }
+}
+
+/// One block of threads per row, its threads taking the pairs of groups on the row
+__global__
+void shared_lengths_kernel(uint64_t row_count, const uint64_t *weights, const uint64_t *offsets,
+                           const uint32_t *groups, const uint32_t *counts, uint64_t group_count,
+                           unsigned long long *shared) {
+    for (uint64_t r = blockIdx.x; r < row_count; r += gridDim.x) {
+        const uint64_t begin = offsets[r];
+        const uint64_t k = offsets[r + 1] - begin;
+        for (uint64_t pair = threadIdx.x; pair < k * k; pair += blockDim.x) {
+            const uint64_t i = begin + pair / k;
+            const uint64_t j = begin + pair % k;
+            if (i != j) {
+                atomicAdd(&shared[(uint64_t) groups[i] * group_count + groups[j]],
+                          (unsigned long long) (weights[r] * min(counts[i], counts[j])));
+            }
+        }
+    }
+}
+
+/// The paths on the GPU, flattened on the first count, and the counts of the last block, freed with the last
+/// copy of the counter
+struct coverage_state_t {
+    const odgi::graph_t *graph = nullptr;
+    int nthreads = 1;
+    bool flattened = false;
+    path_data_t path_data;
+    uint32_t path_count = 0;
+    uint64_t shift = 0;
+    uint32_t *counts = nullptr;
+    uint64_t capacity = 0;
+
+    ~coverage_state_t() {
+        if (flattened) {
+            free_path_data(path_data);
+        }
+        cudaFree(counts);
+    }
+};
+
+std::function<void(const uint64_t &, const uint64_t &, std::vector<uint32_t> &)>
+node_path_coverage_counter(const odgi::graph_t &graph, int nthreads) {
+    auto state = std::make_shared<coverage_state_t>();
+    state->graph = &graph;
+    state->nthreads = nthreads;
+    return [state](const uint64_t &first, const uint64_t &end, std::vector<uint32_t> &counts) {
+        if (!state->flattened) {
+            std::vector<odgi::path_handle_t> paths;
+            state->graph->for_each_path_handle([&](const odgi::path_handle_t &p) {
+                paths.push_back(p);
+            });
+            make_path_data(*state->graph, paths, state->nthreads, state->path_data);
+            state->path_count = paths.size();
+            // the steps hold their node as id - 1, and the blocks are by rank, id - min_id
+            state->shift = state->graph->get_node_count() ? state->graph->min_node_id() - 1 : 0;
+            state->flattened = true;
+        }
+        const uint64_t n = (end - first) * state->path_count;
+        if (n > state->capacity) {
+            cudaFree(state->counts);
+            CUDACHECK(cudaMalloc(&state->counts, n * sizeof(uint32_t)));
+            state->capacity = n;
+        }
+        CUDACHECK(cudaMemset(state->counts, 0, n * sizeof(uint32_t)));
+        const uint64_t steps = state->path_data.total_path_steps;
+        const uint64_t blocks = std::max((uint64_t) 1, std::min((uint64_t) COVERAGE_MAX_BLOCKS,
+                                                                (steps + COVERAGE_BLOCK_SIZE - 1) / COVERAGE_BLOCK_SIZE));
+        count_steps_kernel<<<blocks, COVERAGE_BLOCK_SIZE>>>(state->path_data, first + state->shift, end + state->shift,
+                                                            state->path_count, state->counts);
+        CUDACHECK(cudaGetLastError());
+        CUDACHECK(cudaDeviceSynchronize());
+        counts.resize(n);
+        CUDACHECK(cudaMemcpy(counts.data(), state->counts, n * sizeof(uint32_t), cudaMemcpyDeviceToHost));
+    };
+}
+
+bool gpu_shared_lengths(const std::vector<uint64_t> &weights,
+                        const std::vector<uint64_t> &offsets,
+                        const std::vector<uint32_t> &groups,
+                        const std::vector<uint32_t> &counts,
+                        uint64_t group_count,
+                        std::vector<uint64_t> &shared) {
+    const uint64_t row_count = weights.size();
+    const uint64_t matrix_bytes = group_count * group_count * sizeof(unsigned long long);
+    const uint64_t input_bytes = (weights.size() + offsets.size()) * sizeof(uint64_t)
+        + (groups.size() + counts.size()) * sizeof(uint32_t);
+    size_t free_bytes = 0, total_bytes = 0;
+    CUDACHECK(cudaMemGetInfo(&free_bytes, &total_bytes));
+    if (matrix_bytes + input_bytes > free_bytes) {
+        return false;
+    }
+    uint64_t *d_weights, *d_offsets;
+    uint32_t *d_groups, *d_counts;
+    unsigned long long *d_shared;
+    CUDACHECK(cudaMalloc(&d_weights, std::max((uint64_t) 1, row_count) * sizeof(uint64_t)));
+    CUDACHECK(cudaMalloc(&d_offsets, offsets.size() * sizeof(uint64_t)));
+    CUDACHECK(cudaMalloc(&d_groups, std::max((size_t) 1, groups.size()) * sizeof(uint32_t)));
+    CUDACHECK(cudaMalloc(&d_counts, std::max((size_t) 1, counts.size()) * sizeof(uint32_t)));
+    CUDACHECK(cudaMalloc(&d_shared, std::max((uint64_t) 1, matrix_bytes)));
+    CUDACHECK(cudaMemcpy(d_weights, weights.data(), row_count * sizeof(uint64_t), cudaMemcpyHostToDevice));
+    CUDACHECK(cudaMemcpy(d_offsets, offsets.data(), offsets.size() * sizeof(uint64_t), cudaMemcpyHostToDevice));
+    CUDACHECK(cudaMemcpy(d_groups, groups.data(), groups.size() * sizeof(uint32_t), cudaMemcpyHostToDevice));
+    CUDACHECK(cudaMemcpy(d_counts, counts.data(), counts.size() * sizeof(uint32_t), cudaMemcpyHostToDevice));
+    CUDACHECK(cudaMemset(d_shared, 0, matrix_bytes));
+    if (row_count > 0) {
+        const uint64_t blocks = std::min((uint64_t) COVERAGE_MAX_BLOCKS, row_count);
+        shared_lengths_kernel<<<blocks, COVERAGE_BLOCK_SIZE>>>(row_count, d_weights, d_offsets, d_groups, d_counts,
+                                                               group_count, d_shared);
+        CUDACHECK(cudaGetLastError());
+        CUDACHECK(cudaDeviceSynchronize());
+    }
+    shared.resize(group_count * group_count);
+    static_assert(sizeof(unsigned long long) == sizeof(uint64_t), "the sums are copied as they are");
+    CUDACHECK(cudaMemcpy(shared.data(), d_shared, matrix_bytes, cudaMemcpyDeviceToHost));
+    cudaFree(d_weights);
+    cudaFree(d_offsets);
+    cudaFree(d_groups);
+    cudaFree(d_counts);
+    cudaFree(d_shared);
+    return true;
+}
+
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+#include "odgi.hpp"
+
+namespace cuda {
+
+/// A counter of the steps of the paths of the graph, ranked in the order of for_each_path_handle, on blocks
+/// of nodes ranked by id, for algorithms::coverage_matrix_t::build. The paths are flattened into a path_data_t
+/// on the first call and stay on the GPU, and each block of nodes takes one pass of a kernel over all steps.
+/// The node ids must be compacted, and the graph must outlive the counter.
+std::function<void(const uint64_t &, const uint64_t &, std::vector<uint32_t> &)>
+node_path_coverage_counter(const odgi::graph_t &graph, int nthreads);
+
+/// Given rows of weights[r] holding the groups groups[offsets[r]] to groups[offsets[r + 1] - 1], each once, with
+/// their step counts, how much each pair of distinct groups shares: the sum over their common rows of the weight
+/// times the smaller count, into shared[a * group_count + b]. False if the matrix does not fit on the GPU.
+bool gpu_shared_lengths(const std::vector<uint64_t> &weights,
+                        const std::vector<uint64_t> &offsets,
+                        const std::vector<uint32_t> &groups,
+                        const std::vector<uint32_t> &counts,
+                        uint64_t group_count,
+                        std::vector<uint64_t> &shared);
+
+}
@@ -0,0 +1,130 @@
+#include "draw.h"
+#include "layout.h"
+#include <cuda.h>
+#include <algorithm>
+#include "cuda_runtime_api.h"
+
+namespace cuda {
+
+#define DRAW_BLOCK_SIZE 256
+#define DRAW_MAX_BLOCKS 65535
+
+// a pixel's key: whether its segment covers it at least half, the rank of the segment + 1, and the coverage
+#define DRAW_SOLID_BIT (1ULL << 63)
+#define DRAW_RANK_MASK ((1ULL << 55) - 1)
+
+/// One thread per segment, walking its major axis and, at each step, the pixels across the width of the line
+__global__
+void draw_segments_kernel(const draw_segment_t *segments, uint64_t segment_count,
+                          uint64_t width, uint64_t height, float half_width,
+                          unsigned long long *keys) {
+    const uint64_t stride = (uint64_t) blockDim.x * gridDim.x;
+    for (uint64_t s = (uint64_t) blockIdx.x * blockDim.x + threadIdx.x; s < segment_count; s += stride) {
+        const draw_segment_t seg = segments[s];
+        const float dx = seg.x1 - seg.x0;
+        const float dy = seg.y1 - seg.y0;
+        const float length_2 = dx * dx + dy * dy;
+        const bool steep = fabsf(dy) > fabsf(dx);
+        // the segment along its major axis (u) and its minor axis (v)
+        const float u0 = steep ? seg.y0 : seg.x0;
+        const float v0 = steep ? seg.x0 : seg.y0;
+        const float du = steep ? dy : dx;
+        const float dv = steep ? dx : dy;
+        const uint64_t u_limit = steep ? height : width;
+        const uint64_t v_limit = steep ? width : height;
+        // how far across the minor axis a line half_width thick reaches from its center
+        const float reach = du != 0.0f ? half_width * sqrtf(length_2) / fabsf(du) + 1.0f : half_width + 1.0f;
+        const float u_min = fminf(u0, u0 + du) - half_width - 1.0f;
+        const float u_max = fmaxf(u0, u0 + du) + half_width + 1.0f;
+        const int64_t u_first = max((int64_t) 0, (int64_t) floorf(u_min));
+        const int64_t u_last = min((int64_t) u_limit - 1, (int64_t) ceilf(u_max));
+        const unsigned long long rank = ((unsigned long long) s + 1) & DRAW_RANK_MASK;
+        for (int64_t u = u_first; u <= u_last; ++u) {
+            const float t_u = du != 0.0f ? fminf(1.0f, fmaxf(0.0f, ((float) u - u0) / du)) : 0.0f;
+            const float v_center = v0 + t_u * dv;
+            const int64_t v_first = max((int64_t) 0, (int64_t) floorf(v_center - reach));
+            const int64_t v_last = min((int64_t) v_limit - 1, (int64_t) ceilf(v_center + reach));
+            for (int64_t v = v_first; v <= v_last; ++v) {
+                const float px = steep ? (float) v : (float) u;
+                const float py = steep ? (float) u : (float) v;
+                // the distance of the pixel to the segment
+                float t = length_2 > 0.0f ? ((px - seg.x0) * dx + (py - seg.y0) * dy) / length_2 : 0.0f;
+                t = fminf(1.0f, fmaxf(0.0f, t));
+                const float ex = px - (seg.x0 + t * dx);
+                const float ey = py - (seg.y0 + t * dy);
+                const float coverage = fminf(1.0f, fmaxf(0.0f, half_width + 0.5f - sqrtf(ex * ex + ey * ey)));
+                if (coverage > 0.0f) {
+                    const unsigned long long c8 = (unsigned long long) lrintf(coverage * 255.0f);
+                    const unsigned long long key = (coverage >= 0.5f ? DRAW_SOLID_BIT : 0ULL) | (rank << 8) | c8;
+                    const uint64_t x = steep ? v : u;
+                    const uint64_t y = steep ? u : v;
+                    atomicMax(&keys[y * width + x], key);
+                }
+            }
+        }
+    }
+}
+
+/// Turn the key of each pixel into the color of its segment, layered onto white by its coverage
+__global__
+void resolve_pixels_kernel(const draw_segment_t *segments, const unsigned long long *keys, uint64_t pixel_count,
+                           uint32_t *pixels) {
+    const uint64_t stride = (uint64_t) blockDim.x * gridDim.x;
+    for (uint64_t i = (uint64_t) blockIdx.x * blockDim.x + threadIdx.x; i < pixel_count; i += stride) {
+        const unsigned long long key = keys[i];
+        if (key == 0) {
+            pixels[i] = 0xffffffff;
+            continue;
+        }
+        const uint32_t color = segments[((key >> 8) & DRAW_RANK_MASK) - 1].color;
+        const float f = (float) (key & 0xff) / 255.0f;
+        uint32_t out = 0xff000000;
+        for (int shift = 0; shift < 24; shift += 8) {
+            const float c = (float) ((color >> shift) & 0xff);
+            out |= (uint32_t) lrintf(c * f + 255.0f * (1.0f - f)) << shift;
+        }
+        pixels[i] = out;
+    }
+}
+
+bool draw_segments(const std::vector<draw_segment_t> &segments,
+                   uint64_t width, uint64_t height, float width_px,
+                   std::vector<uint32_t> &pixels) {
+    const uint64_t pixel_count = width * height;
+    const uint64_t needed = pixel_count * (sizeof(unsigned long long) + sizeof(uint32_t))
+        + segments.size() * sizeof(draw_segment_t);
+    size_t free_bytes = 0, total_bytes = 0;
+    CUDACHECK(cudaMemGetInfo(&free_bytes, &total_bytes));
+    if (needed > free_bytes) {
+        return false;
+    }
+    draw_segment_t *d_segments;
+    unsigned long long *d_keys;
+    uint32_t *d_pixels;
+    CUDACHECK(cudaMalloc(&d_segments, std::max((size_t) 1, segments.size()) * sizeof(draw_segment_t)));
+    CUDACHECK(cudaMalloc(&d_keys, std::max((uint64_t) 1, pixel_count) * sizeof(unsigned long long)));
+    CUDACHECK(cudaMalloc(&d_pixels, std::max((uint64_t) 1, pixel_count) * sizeof(uint32_t)));
+    CUDACHECK(cudaMemcpy(d_segments, segments.data(), segments.size() * sizeof(draw_segment_t), cudaMemcpyHostToDevice));
+    CUDACHECK(cudaMemset(d_keys, 0, pixel_count * sizeof(unsigned long long)));
+    const float half_width = std::max(width_px, 1.0f) / 2.0f;
+    if (!segments.empty()) {
+        const uint64_t blocks = std::min((uint64_t) DRAW_MAX_BLOCKS,
+                                         (segments.size() + DRAW_BLOCK_SIZE - 1) / DRAW_BLOCK_SIZE);
+        draw_segments_kernel<<<blocks, DRAW_BLOCK_SIZE>>>(d_segments, segments.size(), width, height, half_width, d_keys);
+        CUDACHECK(cudaGetLastError());
+    }
+    if (pixel_count > 0) {
+        const uint64_t blocks = std::min((uint64_t) DRAW_MAX_BLOCKS, (pixel_count + DRAW_BLOCK_SIZE - 1) / DRAW_BLOCK_SIZE);
+        resolve_pixels_kernel<<<blocks, DRAW_BLOCK_SIZE>>>(d_segments, d_keys, pixel_count, d_pixels);
+        CUDACHECK(cudaGetLastError());
+    }
+    CUDACHECK(cudaDeviceSynchronize());
+    pixels.resize(pixel_count);
+    CUDACHECK(cudaMemcpy(pixels.data(), d_pixels, pixel_count * sizeof(uint32_t), cudaMemcpyDeviceToHost));
+    cudaFree(d_segments);
+    cudaFree(d_keys);
+    cudaFree(d_pixels);
+    return true;
+}
+
+}
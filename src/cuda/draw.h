@@ -0,0 +1,25 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+namespace cuda {
+
+/// A node to draw as a straight line between its two ends, in pixels, with its RGBA color as in algorithms::color_t
+struct draw_segment_t {
+    float x0;
+    float y0;
+    float x1;
+    float y1;
+    uint32_t color;
+};
+
+/// Draw the segments as antialiased lines of width_px pixels into a width * height framebuffer on the GPU, white to
+/// start with, and copy it back into pixels, row by row. Where segments overlap, a pixel takes the color of the last
+/// one in the list that covers it at least half, or else of the last one that touches it, so the segments are layered
+/// in the order they are given as by a sequential drawing. False if the framebuffer does not fit on the GPU.
+bool draw_segments(const std::vector<draw_segment_t> &segments,
+                   uint64_t width, uint64_t height, float width_px,
+                   std::vector<uint32_t> &pixels);
+
+}
@@ -1,17 +1,11 @@
 #include "layout.h"
 #include <cuda.h>
 #include <assert.h>
+#include <tuple>
+#include <algorithm>
+#include <cstring>
 #include "cuda_runtime_api.h"
 
-#define CUDACHECK(cmd) do {                         \
-  cudaError_t err = cmd;                            \
-  if (err != cudaSuccess) {                         \
-    printf("Failed: Cuda error %s:%d '%s'\n",       \
-        __FILE__,__LINE__,cudaGetErrorString(err)); \
-    exit(EXIT_FAILURE);                             \
-  }                                                 \
-} while(0)
-
 #define NCCLCHECK(cmd) do {                         \
   ncclResult_t res = cmd;                           \
   if (res != ncclSuccess) {                         \
@@ -203,8 +197,9 @@ void gpu_layout_kernel(int iter, cuda::layout_config_t config, curandStateCoales
 
     // select path
     __shared__ uint32_t first_step_idx[BLOCK_SIZE / WARP_SIZE]; // BLOCK_SIZE/WARP_SIZE = 1024/32 = 32
-    // each thread picks its own path
-    uint32_t step_idx = curand_coalesced(thread_rnd_state, threadIdx.x) % path_data.total_path_steps;
+    // each thread picks its own path, from all path steps, which may be more than 2^32
+    uint64_t step_idx = ((uint64_t(curand_coalesced(thread_rnd_state, threadIdx.x)) << 32)
+                         | uint64_t(curand_coalesced(thread_rnd_state, threadIdx.x))) % path_data.total_path_steps;
 
     uint32_t path_idx = path_data.element_array[step_idx].pidx;
     path_t p = path_data.paths[path_idx];
@@ -287,16 +282,109 @@ void gpu_layout_kernel(int iter, cuda::layout_config_t config, curandStateCoales
 }
 
 
-void gpu_layout(layout_config_t config, const odgi::graph_t &graph, std::vector<std::atomic<double>> &X, std::vector<std::atomic<double>> &Y) {
+/**
+* @brief: one batch of 1D term updates for the path-guided SGD sort, one term per thread
+* Mirrors `path_linear_sgd` on the CPU: pairs of steps are sampled as in `gpu_layout_kernel`,
+* and only the start of each node gets a position. Positions are kept in double precision,
+* as the float coordinates of the 2D layout can't resolve single bases along a chromosome.
+* @param X: the 1D position of each node, by node id - 1
+* @param fixed: nodes whose position must not change (target sorting), or NULL
+*/
+__global__
+void gpu_sort_kernel(int iter, cuda::layout_config_t config, curandStateCoalesced_t *rnd_state, double eta, double *zetas,
+                     double *X, const bool *fixed, cuda::path_data_t path_data, int sm_count) {
+    uint32_t smid = __mysmid();
+    assert(smid < sm_count);
 
+    curandStateCoalesced_t *thread_rnd_state = &rnd_state[smid];
 
-    std::cout << "===== Use GPU to compute odgi-layout =====" << std::endl;
-    // get cuda device property, and get the SM count
-    cudaDeviceProp prop;
-    CUDACHECK(cudaGetDeviceProperties(&prop, 0));
-    int sm_count = prop.multiProcessorCount;
+    __shared__ bool cooling[BLOCK_SIZE / WARP_SIZE];
+    if (threadIdx.x % WARP_SIZE == 1) {
+        cooling[threadIdx.x / WARP_SIZE] = (iter >= config.first_cooling_iteration) || (curand_coalesced(thread_rnd_state, threadIdx.x) % 2 == 0);
+    }
+    __syncwarp();
 
-    // create eta array
+    // pick a step uniformly from all path steps, which may be more than 2^32
+    uint64_t step_idx = ((uint64_t(curand_coalesced(thread_rnd_state, threadIdx.x)) << 32)
+                         | uint64_t(curand_coalesced(thread_rnd_state, threadIdx.x))) % path_data.total_path_steps;
+
+    uint32_t path_idx = path_data.element_array[step_idx].pidx;
+    path_t p = path_data.paths[path_idx];
+
+    if (p.step_count < 2) {
+        return;
+    }
+
+    uint32_t s1_idx = step_idx - p.first_step_in_path;
+    assert(s1_idx < p.step_count);
+    uint32_t s2_idx;
+
+    if (cooling[threadIdx.x / WARP_SIZE]) {
+        bool backward;
+        uint32_t jump_space;
+        if (s1_idx > 0 && (curand_coalesced(thread_rnd_state, threadIdx.x) % 2 == 0) || s1_idx == p.step_count-1) {
+            // go backward
+            backward = true;
+            jump_space = min(config.space, s1_idx);
+        } else {
+            // go forward
+            backward = false;
+            jump_space = min(config.space, p.step_count - s1_idx - 1);
+        }
+        uint32_t space = jump_space;
+        if (jump_space > config.space_max) {
+            space = config.space_max + (jump_space - config.space_max) / config.space_quantization_step + 1;
+        }
+
+        uint32_t z_i = cuda_rnd_zipf(thread_rnd_state, jump_space, config.theta, zetas[2], zetas[space]);
+
+        s2_idx = backward ? s1_idx - z_i : s1_idx + z_i;
+    } else {
+        do {
+            s2_idx = curand_coalesced(thread_rnd_state, threadIdx.x) % p.step_count;
+        } while (s1_idx == s2_idx);
+    }
+    assert(s2_idx < p.step_count);
+
+    const uint32_t i = p.elements[s1_idx].node_id;
+    const uint32_t j = p.elements[s2_idx].node_id;
+    const bool update_i = fixed == NULL || !fixed[i];
+    const bool update_j = fixed == NULL || !fixed[j];
+    if (!update_i && !update_j) {
+        return;
+    }
+
+    // the positions of the node starts in the path
+    double term_dist = fabs(double(llabs(p.elements[s1_idx].pos)) - double(llabs(p.elements[s2_idx].pos)));
+    if (term_dist == 0.0) {
+        return;
+    }
+
+    double mu = eta / term_dist;
+    if (mu > 1.0) {
+        mu = 1.0;
+    }
+
+    // distance == magnitude in our 1D situation
+    double dx = X[i] - X[j];
+    if (dx == 0.0) {
+        dx = 1e-9; // avoid nan
+    }
+    double mag = fabs(dx);
+    double delta = mu * (mag - term_dist) / 2.0;
+    double r_x = delta / mag * dx;
+    // like the CPU implementation, updates race without locks (hogwild)
+    if (update_i) {
+        X[i] = X[i] - r_x;
+    }
+    if (update_j) {
+        X[j] = X[j] + r_x;
+    }
+}
+
+
+/// learning rate schedule, one eta per iteration
+static double *make_etas(const layout_config_t &config) {
     double *etas;
     cudaMallocManaged(&etas, config.iter_max * sizeof(double));
 
@@ -311,48 +399,18 @@ void gpu_layout(layout_config_t config, const odgi::graph_t &graph, std::vector<
         double eta = eta_max * exp(-lambda * (std::abs(i - iter_with_max_learning_rate)));
         etas[i] = isnan(eta)? eta_min : eta;
     }
+    return etas;
+}
 
-    // create node data structure
-    // consisting of sequence length and coords
-    uint32_t node_count = graph.get_node_count();
-    assert(graph.min_node_id() == 1);
-    assert(graph.max_node_id() == node_count);
-    assert(graph.max_node_id() - graph.min_node_id() + 1 == node_count);
-
-    cuda::node_data_t node_data;
-    node_data.node_count = node_count;
-    cudaMallocManaged(&node_data.nodes, node_count * sizeof(cuda::node_t));
-    for (int node_idx = 0; node_idx < node_count; node_idx++) {
-        //assert(graph.has_node(node_idx));
-        cuda::node_t *n_tmp = &node_data.nodes[node_idx];
-
-        // sequence length
-        const handlegraph::handle_t h = graph.get_handle(node_idx + 1, false);
-        // NOTE: unable store orientation (reverse), since this information is path dependent
-        n_tmp->seq_length = graph.get_length(h);
-
-        // copy random coordinates
-        n_tmp->coords[0] = float(X[node_idx * 2].load());
-        n_tmp->coords[1] = float(Y[node_idx * 2].load());
-        n_tmp->coords[2] = float(X[node_idx * 2 + 1].load());
-        n_tmp->coords[3] = float(Y[node_idx * 2 + 1].load());
-    }
-
-
-    // create path data structure
-    uint32_t path_count = graph.get_path_count();
-    cuda::path_data_t path_data;
+void make_path_data(const odgi::graph_t &graph, const std::vector<odgi::path_handle_t> &path_handles,
+                           int nthreads, cuda::path_data_t &path_data) {
+    uint32_t path_count = path_handles.size();
     path_data.path_count = path_count;
     path_data.total_path_steps = 0;
     cudaMallocManaged(&path_data.paths, path_count * sizeof(cuda::path_t));
-
-    vector<odgi::path_handle_t> path_handles{};
-    path_handles.reserve(path_count);
-    graph.for_each_path_handle(
-        [&] (const odgi::path_handle_t& p) {
-            path_handles.push_back(p);
-            path_data.total_path_steps += graph.get_step_count(p);
-        });
+    for (auto &p : path_handles) {
+        path_data.total_path_steps += graph.get_step_count(p);
+    }
     cudaMallocManaged(&path_data.element_array, path_data.total_path_steps * sizeof(path_element_t));
 
     // get length and starting position of all paths
@@ -365,7 +423,7 @@ void gpu_layout(layout_config_t config, const odgi::graph_t &graph, std::vector<
         first_step_counter += step_count;
     }
 
-#pragma omp parallel for num_threads(config.nthreads)
+#pragma omp parallel for num_threads(nthreads)
     for (int path_idx = 0; path_idx < path_count; path_idx++) {
         odgi::path_handle_t p = path_handles[path_idx];
         //std::cout << graph.get_path_name(p) << ": " << graph.get_step_count(p) << std::endl;
@@ -405,9 +463,15 @@ void gpu_layout(layout_config_t config, const odgi::graph_t &graph, std::vector<
             }
         }
     }
+}
+
+void free_path_data(cuda::path_data_t &path_data) {
+    cudaFree(path_data.paths);
+    cudaFree(path_data.element_array);
+}
 
-    // cache zipf zetas
-    auto start_zeta = std::chrono::high_resolution_clock::now();
+/// cache zipf zetas
+static double *make_zetas(const layout_config_t &config) {
     double *zetas;
     uint64_t zetas_cnt = ((config.space <= config.space_max)? config.space : (config.space_max + (config.space - config.space_max) / config.space_quantization_step + 1)) + 1;
     cudaMallocManaged(&zetas, zetas_cnt * sizeof(double));
@@ -421,12 +485,12 @@ void gpu_layout(layout_config_t config, const odgi::graph_t &graph, std::vector<
             zetas[config.space_max + 1 + (i - config.space_max) / config.space_quantization_step] = zeta_tmp;
         }
     }
-    auto end_zeta = std::chrono::high_resolution_clock::now();
-    uint32_t duration_zeta_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_zeta - start_zeta).count();
+    return zetas;
+}
 
+/// one coalesced random state per SM
+static curandStateCoalesced_t *make_rnd_state(int sm_count) {
     const uint64_t block_size = BLOCK_SIZE;
-    uint64_t block_nbr = (config.min_term_updates + block_size - 1) / block_size; 
-
     curandState_t *rnd_state_tmp;
     curandStateCoalesced_t *rnd_state;
     CUDACHECK(cudaMallocManaged(&rnd_state_tmp, sm_count * block_size * sizeof(curandState_t)));
@@ -435,17 +499,207 @@ void gpu_layout(layout_config_t config, const odgi::graph_t &graph, std::vector<
     CUDACHECK(cudaGetLastError());
     CUDACHECK(cudaDeviceSynchronize());
     cudaFree(rnd_state_tmp);
+    return rnd_state;
+}
+
+static int get_sm_count(int device) {
+    cudaDeviceProp prop;
+    CUDACHECK(cudaGetDeviceProperties(&prop, device));
+    return prop.multiProcessorCount;
+}
+
+/// split the paths into chunks of at most max_steps steps, cutting paths that are longer.
+/// The chunks point into the element array of all_paths, whose pidx fields are rewritten to
+/// index the paths of their chunk. With max_steps 0, there is one chunk with all paths.
+static void split_path_data(const cuda::path_data_t &all_paths, uint64_t max_steps, std::vector<cuda::path_data_t> &chunks) {
+    if (max_steps == 0) {
+        max_steps = std::max(all_paths.total_path_steps, uint64_t(1));
+    }
+    // (path, first step, step count) of the pieces of each chunk
+    std::vector<std::vector<std::tuple<uint32_t, uint64_t, uint64_t>>> pieces(1);
+    uint64_t chunk_steps = 0;
+    for (uint32_t path_idx = 0; path_idx < all_paths.path_count; path_idx++) {
+        uint64_t step_count = all_paths.paths[path_idx].step_count;
+        uint64_t first = 0;
+        while (first < step_count) {
+            if (chunk_steps == max_steps) {
+                pieces.emplace_back();
+                chunk_steps = 0;
+            }
+            uint64_t n = std::min(step_count - first, max_steps - chunk_steps);
+            pieces.back().push_back(std::make_tuple(path_idx, first, n));
+            chunk_steps += n;
+            first += n;
+        }
+    }
+    chunks.resize(pieces.size());
+    for (size_t c = 0; c < pieces.size(); c++) {
+        cuda::path_data_t &chunk = chunks[c];
+        chunk.path_count = pieces[c].size();
+        chunk.total_path_steps = 0;
+        cudaMallocManaged(&chunk.paths, std::max(chunk.path_count, uint32_t(1)) * sizeof(cuda::path_t));
+        chunk.element_array = NULL;
+        for (uint32_t i = 0; i < chunk.path_count; i++) {
+            uint32_t path_idx = std::get<0>(pieces[c][i]);
+            uint64_t first = std::get<1>(pieces[c][i]);
+            uint64_t n = std::get<2>(pieces[c][i]);
+            path_element_t *elements = &all_paths.element_array[all_paths.paths[path_idx].first_step_in_path + first];
+            if (chunk.element_array == NULL) {
+                chunk.element_array = elements;
+            }
+            chunk.paths[i].step_count = n;
+            chunk.paths[i].first_step_in_path = chunk.total_path_steps;
+            chunk.paths[i].elements = elements;
+            for (uint64_t s = 0; s < n; s++) {
+                elements[s].pidx = i;
+            }
+            chunk.total_path_steps += n;
+        }
+    }
+}
+
+void gpu_layout(layout_config_t config, const odgi::graph_t &graph, std::vector<std::atomic<double>> &X, std::vector<std::atomic<double>> &Y) {
+
+
+    std::cout << "===== Use GPU to compute odgi-layout =====" << std::endl;
+    int device_count = 0;
+    CUDACHECK(cudaGetDeviceCount(&device_count));
+    if (config.gpu_count > 0) {
+        device_count = std::min(device_count, config.gpu_count);
+    }
+
+    // create eta array
+    double *etas = make_etas(config);
+
+    // create node data structure
+    // consisting of sequence length and coords
+    uint32_t node_count = graph.get_node_count();
+    assert(graph.min_node_id() == 1);
+    assert(graph.max_node_id() == node_count);
+    assert(graph.max_node_id() - graph.min_node_id() + 1 == node_count);
+
+    // the reference copy of the coordinates, which the devices' updates are merged into
+    std::vector<cuda::node_t> nodes(node_count);
+    for (int node_idx = 0; node_idx < node_count; node_idx++) {
+        //assert(graph.has_node(node_idx));
+        cuda::node_t *n_tmp = &nodes[node_idx];
+
+        // sequence length
+        const handlegraph::handle_t h = graph.get_handle(node_idx + 1, false);
+        // NOTE: unable store orientation (reverse), since this information is path dependent
+        n_tmp->seq_length = graph.get_length(h);
+
+        // copy random coordinates
+        n_tmp->coords[0] = float(X[node_idx * 2].load());
+        n_tmp->coords[1] = float(Y[node_idx * 2].load());
+        n_tmp->coords[2] = float(X[node_idx * 2 + 1].load());
+        n_tmp->coords[3] = float(Y[node_idx * 2 + 1].load());
+    }
+
+
+    // create path data structure
+    // it lives in managed memory, so chunks are paged in from the host when they don't all fit on the devices
+    vector<odgi::path_handle_t> path_handles{};
+    path_handles.reserve(graph.get_path_count());
+    graph.for_each_path_handle(
+        [&] (const odgi::path_handle_t& p) {
+            path_handles.push_back(p);
+        });
+    cuda::path_data_t path_data;
+    make_path_data(graph, path_handles, config.nthreads, path_data);
+    std::vector<cuda::path_data_t> chunks;
+    split_path_data(path_data, config.max_device_path_steps, chunks);
+
+    // spread the chunks over the devices, balancing their steps
+    struct device_t {
+        int sm_count;
+        cuda::node_data_t node_data;
+        double *zetas;
+        curandStateCoalesced_t *rnd_state;
+        std::vector<size_t> chunks;
+        uint64_t steps = 0;
+    };
+    device_count = std::max(1, std::min(device_count, int(chunks.size())));
+    std::vector<device_t> devices(device_count);
+    for (size_t c = 0; c < chunks.size(); c++) {
+        auto least_loaded = std::min_element(devices.begin(), devices.end(),
+                                             [](const device_t &a, const device_t &b) { return a.steps < b.steps; });
+        least_loaded->chunks.push_back(c);
+        least_loaded->steps += chunks[c].total_path_steps;
+    }
+    std::cout << "paths in " << chunks.size() << " chunk(s) on " << device_count << " device(s)" << std::endl;
+
+    for (int d = 0; d < device_count; d++) {
+        CUDACHECK(cudaSetDevice(d));
+        device_t &device = devices[d];
+        device.sm_count = get_sm_count(d);
+        device.node_data.node_count = node_count;
+        CUDACHECK(cudaMallocManaged(&device.node_data.nodes, node_count * sizeof(cuda::node_t)));
+        memcpy(device.node_data.nodes, nodes.data(), node_count * sizeof(cuda::node_t));
+        device.zetas = make_zetas(config);
+        device.rnd_state = make_rnd_state(device.sm_count);
+        if (device.chunks.size() == 1) {
+            // the chunk stays on the device for all iterations
+            const cuda::path_data_t &chunk = chunks[device.chunks.front()];
+            cudaMemPrefetchAsync(chunk.element_array, chunk.total_path_steps * sizeof(path_element_t), d);
+        }
+    }
+
+    const uint64_t block_size = BLOCK_SIZE;
+    const uint64_t total_path_steps = std::max(path_data.total_path_steps, uint64_t(1));
 
     for (int iter = 0; iter < config.iter_max; iter++) {
-        gpu_layout_kernel<<<block_nbr, block_size>>>(iter, config, rnd_state, etas[iter], zetas, node_data, path_data, sm_count);
-        // check error
-        CUDACHECK(cudaGetLastError());
-        CUDACHECK(cudaDeviceSynchronize());
+        // each device runs its share of the term updates, chunk by chunk
+#pragma omp parallel for num_threads(device_count)
+        for (int d = 0; d < device_count; d++) {
+            CUDACHECK(cudaSetDevice(d));
+            device_t &device = devices[d];
+            for (auto c : device.chunks) {
+                const cuda::path_data_t &chunk = chunks[c];
+                if (chunk.total_path_steps == 0) {
+                    continue;
+                }
+                if (device.chunks.size() > 1) {
+                    // stream the chunk in from host memory
+                    cudaMemPrefetchAsync(chunk.element_array, chunk.total_path_steps * sizeof(path_element_t), d);
+                }
+                uint64_t term_updates = (double)config.min_term_updates * chunk.total_path_steps / total_path_steps;
+                uint64_t block_nbr = (term_updates + block_size - 1) / block_size;
+                if (block_nbr == 0) {
+                    continue;
+                }
+                gpu_layout_kernel<<<block_nbr, block_size>>>(iter, config, device.rnd_state, etas[iter], device.zetas, device.node_data, chunk, device.sm_count);
+                // check error
+                CUDACHECK(cudaGetLastError());
+                CUDACHECK(cudaDeviceSynchronize());
+            }
+        }
+
+        if (device_count > 1) {
+            // reconcile: add up the moves of all devices, then restart every device from the sum
+#pragma omp parallel for num_threads(config.nthreads)
+            for (int node_idx = 0; node_idx < node_count; node_idx++) {
+                for (int k = 0; k < 4; k++) {
+                    float base = nodes[node_idx].coords[k];
+                    float moved = base;
+                    for (int d = 0; d < device_count; d++) {
+                        moved += devices[d].node_data.nodes[node_idx].coords[k] - base;
+                    }
+                    nodes[node_idx].coords[k] = moved;
+                }
+            }
+            for (int d = 0; d < device_count; d++) {
+                memcpy(devices[d].node_data.nodes, nodes.data(), node_count * sizeof(cuda::node_t));
+            }
+        }
+    }
+    if (device_count == 1) {
+        memcpy(nodes.data(), devices[0].node_data.nodes, node_count * sizeof(cuda::node_t));
     }
 
     // copy coords back to X, Y vectors
     for (int node_idx = 0; node_idx < node_count; node_idx++) {
-        cuda::node_t *n = &(node_data.nodes[node_idx]);
+        cuda::node_t *n = &(nodes[node_idx]);
         // coords[0], coords[1], coords[2], coords[3] are stored consecutively. 
         float *coords = n->coords;
         // check if coordinates valid (not NaN or infinite)
@@ -463,13 +717,79 @@ void gpu_layout(layout_config_t config, const odgi::graph_t &graph, std::vector<
 
     // free memory
     cudaFree(etas);
-    cudaFree(node_data.nodes);
-    cudaFree(path_data.paths);
-    cudaFree(path_data.element_array);
-    cudaFree(zetas);
-    cudaFree(rnd_state);
+    for (int d = 0; d < device_count; d++) {
+        CUDACHECK(cudaSetDevice(d));
+        cudaFree(devices[d].node_data.nodes);
+        cudaFree(devices[d].zetas);
+        cudaFree(devices[d].rnd_state);
+    }
+    for (auto &chunk : chunks) {
+        cudaFree(chunk.paths);
+    }
+    free_path_data(path_data);
+    CUDACHECK(cudaSetDevice(0));
 
     return;
 }
 
-}
\ No newline at end of file
+void gpu_sort(layout_config_t config, const odgi::graph_t &graph, const std::vector<odgi::path_handle_t> &path_handles,
+              std::vector<std::atomic<double>> &X, const std::vector<bool> *fixed_nodes) {
+    int sm_count = get_sm_count(0);
+    double *etas = make_etas(config);
+
+    uint32_t node_count = graph.get_node_count();
+    assert(graph.min_node_id() == 1);
+    assert(graph.max_node_id() == node_count);
+
+    double *X_gpu;
+    cudaMallocManaged(&X_gpu, node_count * sizeof(double));
+    // X is indexed by node rank, the kernel by node id
+    graph.for_each_handle(
+        [&](const odgi::handle_t &h) {
+            X_gpu[graph.get_id(h) - 1] = X[odgi::number_bool_packing::unpack_number(h)].load();
+        });
+    bool *fixed = NULL;
+    if (fixed_nodes != nullptr) {
+        cudaMallocManaged(&fixed, node_count * sizeof(bool));
+        for (uint32_t node_idx = 0; node_idx < node_count; node_idx++) {
+            fixed[node_idx] = (*fixed_nodes)[node_idx];
+        }
+    }
+
+    cuda::path_data_t path_data;
+    make_path_data(graph, path_handles, config.nthreads, path_data);
+    double *zetas = make_zetas(config);
+
+    const uint64_t block_size = BLOCK_SIZE;
+    uint64_t block_nbr = (config.min_term_updates + block_size - 1) / block_size;
+
+    curandStateCoalesced_t *rnd_state = make_rnd_state(sm_count);
+
+    if (path_data.total_path_steps > 0) {
+        for (int iter = 0; iter < config.iter_max; iter++) {
+            gpu_sort_kernel<<<block_nbr, block_size>>>(iter, config, rnd_state, etas[iter], zetas, X_gpu, fixed, path_data, sm_count);
+            CUDACHECK(cudaGetLastError());
+            CUDACHECK(cudaDeviceSynchronize());
+        }
+    }
+
+    graph.for_each_handle(
+        [&](const odgi::handle_t &h) {
+            double x = X_gpu[graph.get_id(h) - 1];
+            if (!isfinite(x)) {
+                std::cerr << "[odgi::path_linear_sgd] warning: invalid position for node " << graph.get_id(h) << std::endl;
+            }
+            X[odgi::number_bool_packing::unpack_number(h)].store(x);
+        });
+
+    cudaFree(etas);
+    cudaFree(X_gpu);
+    if (fixed != NULL) {
+        cudaFree(fixed);
+    }
+    free_path_data(path_data);
+    cudaFree(zetas);
+    cudaFree(rnd_state);
+}
+
+}
@@ -14,6 +14,15 @@
 #include "XoshiroCpp.hpp"
 #include "dirty_zipfian_int_distribution.h"
 
+#define CUDACHECK(cmd) do {                         \
+  cudaError_t err = cmd;                            \
+  if (err != cudaSuccess) {                         \
+    printf("Failed: Cuda error %s:%d '%s'\n",       \
+        __FILE__,__LINE__,cudaGetErrorString(err)); \
+    exit(EXIT_FAILURE);                             \
+  }                                                 \
+} while(0)
+
 namespace cuda {
 
 
@@ -46,6 +55,12 @@ struct path_data_t {
     path_element_t *element_array;
 };
 
+/// Flatten the steps of the given paths into path_data, in managed memory, with the nucleotide position
+/// of each step in its path, negative on the reverse strand, and the node of each step as its id - 1
+void make_path_data(const odgi::graph_t &graph, const std::vector<odgi::path_handle_t> &path_handles,
+                    int nthreads, path_data_t &path_data);
+
+void free_path_data(path_data_t &path_data);
 
 // #define SM_COUNT 84
 // #define SM_COUNT 108
@@ -74,9 +89,16 @@ struct layout_config_t {
     uint32_t space_max;
     uint32_t space_quantization_step;
     int nthreads;
+    int gpu_count = 0;                   // devices to spread the paths over, 0 uses all of them
+    uint64_t max_device_path_steps = 0;  // steps per chunk of paths streamed to a device, 0 keeps them in one chunk
 };
 
 
 void gpu_layout(layout_config_t config, const odgi::graph_t &graph, std::vector<std::atomic<double>> &X, std::vector<std::atomic<double>> &Y);
 
+/// 1D path-guided SGD over the given paths, as used by `odgi sort -p Y`. X holds the node
+/// positions by node rank, seeded by the caller. Nodes flagged in fixed_nodes (by id - 1), if given, don't move.
+void gpu_sort(layout_config_t config, const odgi::graph_t &graph, const std::vector<odgi::path_handle_t> &path_handles,
+              std::vector<std::atomic<double>> &X, const std::vector<bool> *fixed_nodes);
+
 }
\ No newline at end of file
@@ -0,0 +1,266 @@
+#include "dna.hpp"
+#include "cpu_dispatch.hpp"
+
+#include <algorithm>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace odgi {
+
+namespace {
+
+void reverse_complement_generic(const char* seq, const uint64_t length, char* out) {
+    for (uint64_t i = 0; i < length; ++i) {
+        out[length - 1 - i] = reverse_complement(seq[i]);
+    }
+}
+
+/// Swap and complement the bases at [i, i + n) with the ones n bases back from j
+inline void swap_complement(char* seq, uint64_t i, uint64_t j, const uint64_t n) {
+    for (uint64_t k = 0; k < n; ++k, ++i) {
+        --j;
+        const char tmp = seq[i];
+        seq[i] = reverse_complement(seq[j]);
+        seq[j] = reverse_complement(tmp);
+    }
+}
+
+void reverse_complement_in_place_generic(char* seq, const uint64_t length) {
+    swap_complement(seq, 0, length, length / 2);
+    if (length % 2) {
+        seq[length / 2] = reverse_complement(seq[length / 2]);
+    }
+}
+
+uint64_t find_non_2bit_generic(const char* seq, const uint64_t length) {
+    for (uint64_t i = 0; i < length; ++i) {
+        if (!dna_is_2bit(seq[i])) {
+            return i;
+        }
+    }
+    return length;
+}
+
+uint64_t pack_2bit_generic(const char* seq, const uint64_t length, uint64_t* words, const uint64_t index) {
+    uint64_t others = 0;
+    for (uint64_t i = 0; i < length; ++i) {
+        others += !dna_is_2bit(seq[i]);
+        set_2bit(words, index + i, dna_as_2bit(seq[i]));
+    }
+    return others;
+}
+
+void unpack_2bit_generic(const uint64_t* words, const uint64_t index, const uint64_t length, char* out) {
+    for (uint64_t i = 0; i < length; ++i) {
+        out[i] = dna_from_2bit(get_2bit(words, index + i));
+    }
+}
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+
+// The AVX2 variants handle 32 bases at once. A byte table is looked up by the low nibble of each base,
+// which differs between A, C, G, T and N, and tells what the base must be for the lookup to apply;
+// the other nibbles map to a value with another low nibble, which no base matches.
+
+/// Whether each base is one of ACGTN in either case, which the nibble complement covers
+__attribute__((target("avx2")))
+inline __m256i complementable_avx2(const __m256i v, const __m256i lo) {
+    const __m256i bases = _mm256_setr_epi8(1, 'A', 3, 'C', 'T', 4, 7, 'G', 9, 8, 11, 10, 13, 12, 'N', 14,
+                                           1, 'A', 3, 'C', 'T', 4, 7, 'G', 9, 8, 11, 10, 13, 12, 'N', 14);
+    return _mm256_cmpeq_epi8(_mm256_and_si256(v, _mm256_set1_epi8((char) 0xdf)), _mm256_shuffle_epi8(bases, lo));
+}
+
+/// Reverse the 32 bases and complement them, keeping their case, if they are all ACGTN, else false
+__attribute__((target("avx2")))
+inline bool reverse_complement_avx2_block(const __m256i v, __m256i& rc) {
+    const __m256i lo = _mm256_and_si256(v, _mm256_set1_epi8(0x0f));
+    if (_mm256_movemask_epi8(complementable_avx2(v, lo)) != -1) {
+        return false;
+    }
+    const __m256i complements = _mm256_setr_epi8(0, 'T', 0, 'G', 'A', 0, 0, 'C', 0, 0, 0, 0, 0, 0, 'N', 0,
+                                                 0, 'T', 0, 'G', 'A', 0, 0, 'C', 0, 0, 0, 0, 0, 0, 'N', 0);
+    const __m256i reverse = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+                                             15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    const __m256i c = _mm256_or_si256(_mm256_and_si256(v, _mm256_set1_epi8(0x20)), _mm256_shuffle_epi8(complements, lo));
+    const __m256i r = _mm256_shuffle_epi8(c, reverse);
+    rc = _mm256_permute2x128_si256(r, r, 1);
+    return true;
+}
+
+__attribute__((target("avx2")))
+void reverse_complement_avx2(const char* seq, const uint64_t length, char* out) {
+    uint64_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i rc;
+        if (reverse_complement_avx2_block(_mm256_loadu_si256((const __m256i*) (seq + i)), rc)) {
+            _mm256_storeu_si256((__m256i*) (out + length - i - 32), rc);
+        } else {
+            reverse_complement_generic(seq + i, 32, out + length - i - 32);
+        }
+    }
+    reverse_complement_generic(seq + i, length - i, out);
+}
+
+__attribute__((target("avx2")))
+void reverse_complement_in_place_avx2(char* seq, const uint64_t length) {
+    uint64_t i = 0;
+    uint64_t j = length;
+    for (; j - i >= 64; i += 32, j -= 32) {
+        __m256i front, back;
+        if (reverse_complement_avx2_block(_mm256_loadu_si256((const __m256i*) (seq + i)), front)
+            && reverse_complement_avx2_block(_mm256_loadu_si256((const __m256i*) (seq + j - 32)), back)) {
+            _mm256_storeu_si256((__m256i*) (seq + i), back);
+            _mm256_storeu_si256((__m256i*) (seq + j - 32), front);
+        } else {
+            swap_complement(seq, i, j, 32);
+        }
+    }
+    reverse_complement_in_place_generic(seq + i, j - i);
+}
+
+/// A mask of the bases that are A, C, G or T
+__attribute__((target("avx2")))
+inline __m256i is_2bit_avx2(const __m256i v, const __m256i lo) {
+    const __m256i bases = _mm256_setr_epi8(1, 'A', 3, 'C', 'T', 4, 7, 'G', 9, 8, 11, 10, 13, 12, 15, 14,
+                                           1, 'A', 3, 'C', 'T', 4, 7, 'G', 9, 8, 11, 10, 13, 12, 15, 14);
+    return _mm256_cmpeq_epi8(v, _mm256_shuffle_epi8(bases, lo));
+}
+
+__attribute__((target("avx2")))
+uint64_t find_non_2bit_avx2(const char* seq, const uint64_t length) {
+    uint64_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        const __m256i v = _mm256_loadu_si256((const __m256i*) (seq + i));
+        const uint32_t valid = _mm256_movemask_epi8(is_2bit_avx2(v, _mm256_and_si256(v, _mm256_set1_epi8(0x0f))));
+        if (valid != 0xffffffff) {
+            return i + __builtin_ctz(~valid);
+        }
+    }
+    return i + find_non_2bit_generic(seq + i, length - i);
+}
+
+__attribute__((target("avx2")))
+uint64_t pack_2bit_avx2(const char* seq, const uint64_t length, uint64_t* words, const uint64_t index) {
+    // up to the first word boundary, and past the last one, base by base
+    const uint64_t head = std::min(length, (32 - (index & 31)) & 31);
+    uint64_t others = pack_2bit_generic(seq, head, words, index);
+    const __m256i codes = _mm256_setr_epi8(0, 0, 0, 1, 3, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0,
+                                           0, 0, 0, 1, 3, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i pair_weights = _mm256_set1_epi16(1 | (4 << 8));
+    const __m256i quad_weights = _mm256_set1_epi32(1 | (16 << 16));
+    const __m256i gather = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                            0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    uint64_t i = head;
+    for (; i + 32 <= length; i += 32) {
+        const __m256i v = _mm256_loadu_si256((const __m256i*) (seq + i));
+        const __m256i lo = _mm256_and_si256(v, _mm256_set1_epi8(0x0f));
+        const __m256i valid = is_2bit_avx2(v, lo);
+        others += 32 - __builtin_popcount((uint32_t) _mm256_movemask_epi8(valid));
+        const __m256i c = _mm256_and_si256(_mm256_shuffle_epi8(codes, lo), valid);
+        // 4 codes to a byte, the first one in the lowest bits, in the low byte of each 32-bit lane
+        const __m256i bytes = _mm256_shuffle_epi8(
+            _mm256_madd_epi16(_mm256_maddubs_epi16(c, pair_weights), quad_weights), gather);
+        words[(index + i) >> 5] = (uint64_t) (uint32_t) _mm256_cvtsi256_si32(bytes)
+            | (uint64_t) (uint32_t) _mm256_extract_epi32(bytes, 4) << 32;
+    }
+    return others + pack_2bit_generic(seq + i, length - i, words, index + i);
+}
+
+__attribute__((target("avx2")))
+void unpack_2bit_avx2(const uint64_t* words, const uint64_t index, const uint64_t length, char* out) {
+    const uint64_t head = std::min(length, (32 - (index & 31)) & 31);
+    unpack_2bit_generic(words, index, head, out);
+    // each output byte takes the word's byte holding its code, then keeps the code at its place in it
+    const __m256i spread = _mm256_setr_epi8(0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                            4, 4, 4, 4, 5, 5, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7);
+    const __m256i first = _mm256_set1_epi32(0x000000ff);
+    const __m256i second = _mm256_set1_epi32(0x0000ff00);
+    const __m256i third = _mm256_set1_epi32(0x00ff0000);
+    const __m256i fourth = _mm256_set1_epi32((int) 0xff000000);
+    const __m256i three = _mm256_set1_epi8(3);
+    const __m256i bases = _mm256_setr_epi8('A', 'C', 'G', 'T', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                           'A', 'C', 'G', 'T', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    uint64_t i = head;
+    for (; i + 32 <= length; i += 32) {
+        const __m256i b = _mm256_shuffle_epi8(_mm256_set1_epi64x((long long) words[(index + i) >> 5]), spread);
+        const __m256i c = _mm256_or_si256(
+            _mm256_or_si256(_mm256_and_si256(b, first), _mm256_and_si256(_mm256_srli_epi16(b, 2), second)),
+            _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi16(b, 4), third), _mm256_and_si256(_mm256_srli_epi16(b, 6), fourth)));
+        _mm256_storeu_si256((__m256i*) (out + i), _mm256_shuffle_epi8(bases, _mm256_and_si256(c, three)));
+    }
+    unpack_2bit_generic(words, index + i, length - i, out + i);
+}
+
+#endif
+
+typedef void (*reverse_complement_t)(const char*, const uint64_t, char*);
+typedef void (*reverse_complement_in_place_t)(char*, const uint64_t);
+typedef uint64_t (*find_non_2bit_t)(const char*, const uint64_t);
+typedef uint64_t (*pack_2bit_t)(const char*, const uint64_t, uint64_t*, const uint64_t);
+typedef void (*unpack_2bit_t)(const uint64_t*, const uint64_t, const uint64_t, char*);
+
+const cpu::kernel_t<reverse_complement_t> reverse_complement_kernel(
+        "reverse_complement", {
+                {cpu::isa_generic, reverse_complement_generic},
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+                {cpu::isa_avx2, reverse_complement_avx2},
+#endif
+        });
+
+const cpu::kernel_t<reverse_complement_in_place_t> reverse_complement_in_place_kernel(
+        "reverse_complement_in_place", {
+                {cpu::isa_generic, reverse_complement_in_place_generic},
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+                {cpu::isa_avx2, reverse_complement_in_place_avx2},
+#endif
+        });
+
+const cpu::kernel_t<find_non_2bit_t> find_non_2bit_kernel(
+        "dna_find_non_2bit", {
+                {cpu::isa_generic, find_non_2bit_generic},
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+                {cpu::isa_avx2, find_non_2bit_avx2},
+#endif
+        });
+
+const cpu::kernel_t<pack_2bit_t> pack_2bit_kernel(
+        "pack_2bit", {
+                {cpu::isa_generic, pack_2bit_generic},
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+                {cpu::isa_avx2, pack_2bit_avx2},
+#endif
+        });
+
+const cpu::kernel_t<unpack_2bit_t> unpack_2bit_kernel(
+        "unpack_2bit", {
+                {cpu::isa_generic, unpack_2bit_generic},
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+                {cpu::isa_avx2, unpack_2bit_avx2},
+#endif
+        });
+
+}
+
+void reverse_complement(const char* seq, const uint64_t& length, char* out) {
+    reverse_complement_kernel(seq, length, out);
+}
+
+void reverse_complement_in_place(char* seq, const uint64_t& length) {
+    reverse_complement_in_place_kernel(seq, length);
+}
+
+uint64_t dna_find_non_2bit(const char* seq, const uint64_t& length) {
+    return find_non_2bit_kernel(seq, length);
+}
+
+uint64_t pack_2bit(const char* seq, const uint64_t& length, uint64_t* words, const uint64_t& index) {
+    return pack_2bit_kernel(seq, length, words, index);
+}
+
+void unpack_2bit(const uint64_t* words, const uint64_t& index, const uint64_t& length, char* out) {
+    unpack_2bit_kernel(words, index, length, out);
+}
+
+}
@@ -2,6 +2,7 @@
 #define dank_dna_hpp
 
 #include <string>
+#include <cstdint>
 
 namespace odgi {
 
@@ -39,29 +40,31 @@ static const char complement[256] = {'N', 'N', 'N', 'N', 'N', 'N', 'N', 'N', //
                                      'N', 'N', 'N', 'N', 'N', 'N', 'N', 'N'};// 256
 
 inline char reverse_complement(const char& c) {
-    return complement[c];
+    return complement[(uint8_t)c];
 }
 
+/// Write the reverse complement of the length bases at seq to out, which must hold as many and not overlap seq.
+/// Runs of ACGTN in either case are done 32 bases at a time where the CPU has AVX2, see cpu_dispatch.hpp.
+void reverse_complement(const char* seq, const uint64_t& length, char* out);
+
+/// Reverse complement the length bases at seq where they are
+void reverse_complement_in_place(char* seq, const uint64_t& length);
+
 inline std::string reverse_complement(const std::string& seq) {
-    std::string rc;
-    rc.assign(seq.rbegin(), seq.rend());
-    for (auto& c : rc) {
-        c = complement[c];
-    }
+    std::string rc(seq.size(), '\0');
+    reverse_complement(seq.data(), seq.size(), rc.data());
     return rc;
 }
-    
+
 inline void reverse_complement_in_place(std::string& seq) {
-    size_t swap_size = seq.size() / 2;
-    for (size_t i = 0, j = seq.size() - 1; i < swap_size; i++, j--) {
-        char tmp = seq[i];
-        seq[i] = complement[seq[j]];
-        seq[j] = complement[tmp];
-    }
-    
-    if (seq.size() % 2) {
-        seq[swap_size] = complement[seq[swap_size]];
-    }
+    reverse_complement_in_place(seq.data(), seq.size());
+}
+
+/// Append the reverse complement of the length bases at seq to out, which can be a buffer kept between calls
+inline void append_reverse_complement(const char* seq, const uint64_t& length, std::string& out) {
+    const uint64_t begin = out.size();
+    out.resize(begin + length);
+    reverse_complement(seq, length, out.data() + begin);
 }
 
 inline int dna_as_int(char c) {
@@ -94,6 +97,52 @@ inline char int_as_dna(int i) {
     }
 }
 
+/// 2-bit codes, such that the complement of a code is 3 - code
+/// only ACGT are packable, everything else has to be kept aside as an exception
+inline bool dna_is_2bit(char c) {
+    return c == 'A' || c == 'C' || c == 'G' || c == 'T';
+}
+
+inline uint64_t dna_as_2bit(char c) {
+    switch (c) {
+    case 'C':
+        return 1;
+    case 'G':
+        return 2;
+    case 'T':
+        return 3;
+    default:
+        return 0;
+    }
+}
+
+inline char dna_from_2bit(uint64_t code) {
+    static const char bases[4] = {'A', 'C', 'G', 'T'};
+    return bases[code & 3];
+}
+
+/// get the i-th 2-bit code from an array of words holding 32 codes each
+inline uint64_t get_2bit(const uint64_t* words, uint64_t i) {
+    return (words[i >> 5] >> ((i & 31) << 1)) & 3;
+}
+
+/// set the i-th 2-bit code in an array of words holding 32 codes each
+inline void set_2bit(uint64_t* words, uint64_t i, uint64_t code) {
+    const uint64_t shift = (i & 31) << 1;
+    words[i >> 5] = (words[i >> 5] & ~(3ull << shift)) | ((code & 3) << shift);
+}
+
+/// The offset of the first of the length bases at seq that is not A, C, G or T, or length if there is none
+uint64_t dna_find_non_2bit(const char* seq, const uint64_t& length);
+
+/// Set the 2-bit codes index to index + length - 1 of the words to the bases at seq, the ones that are not
+/// ACGT to 0 as dna_as_2bit does, and return how many of those there are. Whole words are written without
+/// reading them, the codes of other bases in the first and last word are kept.
+uint64_t pack_2bit(const char* seq, const uint64_t& length, uint64_t* words, const uint64_t& index = 0);
+
+/// Write the bases of the 2-bit codes index to index + length - 1 of the words to out, which must hold length chars
+void unpack_2bit(const uint64_t* words, const uint64_t& index, const uint64_t& length, char* out);
+
 }
 
 #endif
@@ -0,0 +1,100 @@
+/**
+ * \file frozen_graph.cpp: contains the implementation of FrozenHandleGraph
+ */
+
+
+#include "frozen_graph.hpp"
+
+#include <algorithm>
+
+namespace odgi {
+
+FrozenHandleGraph::FrozenHandleGraph(const HandleGraph* super, const uint64_t& nthreads)
+    : super(super), node_rank(*super) {
+    const uint64_t node_count = super->get_node_count();
+    std::vector<handle_t> nodes(node_count);
+    super->for_each_handle([&](const handle_t& h) {
+        nodes[node_rank(h)] = h;
+    });
+    // count the neighbors of each side, then lay them out side after side
+    offsets.resize(2 * node_count + 1, 0);
+#pragma omp parallel for schedule(dynamic, 4096) num_threads(nthreads)
+    for (uint64_t r = 0; r < node_count; ++r) {
+        offsets[2 * r + 1] = super->get_degree(nodes[r], false);
+        offsets[2 * r + 2] = super->get_degree(nodes[r], true);
+    }
+    for (uint64_t i = 1; i < offsets.size(); ++i) {
+        offsets[i] += offsets[i - 1];
+    }
+    targets.resize(offsets.back());
+#pragma omp parallel for schedule(dynamic, 4096) num_threads(nthreads)
+    for (uint64_t r = 0; r < node_count; ++r) {
+        for (const bool go_left : {false, true}) {
+            uint64_t i = offsets[2 * r + go_left];
+            super->follow_edges(nodes[r], go_left, [&](const handle_t& next) {
+                targets[i++] = next;
+            });
+        }
+    }
+}
+
+bool FrozenHandleGraph::has_node(nid_t node_id) const {
+    return super->has_node(node_id);
+}
+
+handle_t FrozenHandleGraph::get_handle(const nid_t& node_id, bool is_reverse) const {
+    return super->get_handle(node_id, is_reverse);
+}
+
+nid_t FrozenHandleGraph::get_id(const handle_t& handle) const {
+    return super->get_id(handle);
+}
+
+bool FrozenHandleGraph::get_is_reverse(const handle_t& handle) const {
+    return super->get_is_reverse(handle);
+}
+
+handle_t FrozenHandleGraph::flip(const handle_t& handle) const {
+    return super->flip(handle);
+}
+
+size_t FrozenHandleGraph::get_length(const handle_t& handle) const {
+    return super->get_length(handle);
+}
+
+std::string FrozenHandleGraph::get_sequence(const handle_t& handle) const {
+    return super->get_sequence(handle);
+}
+
+bool FrozenHandleGraph::follow_edges_impl(const handle_t& handle, bool go_left, const std::function<bool(const handle_t&)>& iteratee) const {
+    return for_each_neighbor(handle, go_left, iteratee);
+}
+
+bool FrozenHandleGraph::for_each_handle_impl(const std::function<bool(const handle_t&)>& iteratee, bool parallel) const {
+    return super->for_each_handle(iteratee, parallel);
+}
+
+size_t FrozenHandleGraph::get_node_count() const {
+    return super->get_node_count();
+}
+
+nid_t FrozenHandleGraph::min_node_id() const {
+    return super->min_node_id();
+}
+
+nid_t FrozenHandleGraph::max_node_id() const {
+    return super->max_node_id();
+}
+
+size_t FrozenHandleGraph::get_degree(const handle_t& handle, bool go_left) const {
+    const uint64_t side = 2 * node_rank(handle) + (go_left != super->get_is_reverse(handle));
+    return offsets[side + 1] - offsets[side];
+}
+
+bool FrozenHandleGraph::has_edge(const handle_t& left, const handle_t& right) const {
+    return !for_each_neighbor(left, false, [&](const handle_t& next) {
+        return next != right;
+    });
+}
+
+}
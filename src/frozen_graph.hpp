@@ -0,0 +1,111 @@
+#pragma once
+
+/** \file
+ * frozen_graph.hpp: defines a read-only handle graph view with its edges in flat arrays
+ */
+
+#include <handlegraph/handle_graph.hpp>
+#include <handlegraph/util.hpp>
+#include "algorithms/node_rank.hpp"
+#include <string>
+#include <vector>
+
+namespace odgi {
+
+using namespace handlegraph;
+
+    /**
+     * A HandleGraph implementation that answers edge queries of some other HandleGraph from a
+     * compact adjacency index, built once on construction: the neighbors of each side of each node
+     * are stored one after the other in a single array, in the order the super graph follows them,
+     * so following edges is a scan of a contiguous range instead of decoding the super graph's edge
+     * records. Everything else is forwarded to the super graph, whose handles are used. The super
+     * graph must not be edited while the view is in use.
+     */
+    class FrozenHandleGraph : public HandleGraph {
+    public:
+
+        /// Index the edges of the super graph on nthreads threads
+        FrozenHandleGraph(const HandleGraph* super, const uint64_t& nthreads = 1);
+
+        /// Call iteratee on the handles to the next (go_left = false) or previous nodes of the handle,
+        /// without the cost of a std::function; returns false if iteratee returned false to stop
+        template<typename Iteratee>
+        bool for_each_neighbor(const handle_t& handle, bool go_left, const Iteratee& iteratee) const {
+            const bool is_rev = super->get_is_reverse(handle);
+            const uint64_t side = 2 * node_rank(handle) + (go_left != is_rev);
+            for (uint64_t i = offsets[side]; i < offsets[side + 1]; ++i) {
+                if (!iteratee(is_rev ? super->flip(targets[i]) : targets[i])) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        //////////////////////////
+        /// HandleGraph interface
+        //////////////////////////
+
+        // Method to check if a node exists by ID
+        virtual bool has_node(nid_t node_id) const;
+
+        /// Look up the handle for the node with the given ID in the given orientation
+        virtual handle_t get_handle(const nid_t& node_id, bool is_reverse = false) const;
+
+        /// Get the ID from a handle
+        virtual nid_t get_id(const handle_t& handle) const;
+
+        /// Get the orientation of a handle
+        virtual bool get_is_reverse(const handle_t& handle) const;
+
+        /// Invert the orientation of a handle (potentially without getting its ID)
+        virtual handle_t flip(const handle_t& handle) const;
+
+        /// Get the length of a node
+        virtual size_t get_length(const handle_t& handle) const;
+
+        /// Get the sequence of a node, presented in the handle's local forward
+        /// orientation.
+        virtual std::string get_sequence(const handle_t& handle) const;
+
+        /// Loop over all the handles to next/previous (right/left) nodes. Passes
+        /// them to a callback which returns false to stop iterating and true to
+        /// continue. Returns true if we finished and false if we stopped early.
+        virtual bool follow_edges_impl(const handle_t& handle, bool go_left, const std::function<bool(const handle_t&)>& iteratee) const;
+
+        /// Loop over all the nodes in the graph in their local forward
+        /// orientations, in their internal stored order. Stop if the iteratee
+        /// returns false. Can be told to run in parallel, in which case stopping
+        /// after a false return value is on a best-effort basis and iteration
+        /// order is not defined.
+        virtual bool for_each_handle_impl(const std::function<bool(const handle_t&)>& iteratee, bool parallel = false) const;
+
+        /// Return the number of nodes in the graph
+        virtual size_t get_node_count() const;
+
+        /// Return the smallest ID in the graph, or some smaller number if the
+        /// smallest ID is unavailable. Return value is unspecified if the graph is empty.
+        virtual nid_t min_node_id() const;
+
+        /// Return the largest ID in the graph, or some larger number if the
+        /// largest ID is unavailable. Return value is unspecified if the graph is empty.
+        virtual nid_t max_node_id() const;
+
+        /// Get the number of edges on the right (go_left = false) or left (go_left
+        /// = true) side of the given handle, in constant time.
+        virtual size_t get_degree(const handle_t& handle, bool go_left) const;
+
+        /// Returns true if there is an edge that allows traversal from the left
+        /// handle to the right handle.
+        virtual bool has_edge(const handle_t& left, const handle_t& right) const;
+
+    private:
+        const HandleGraph* super = nullptr;
+        algorithms::node_rank_t node_rank;
+        /// the neighbors of the right side of the node ranked r in its forward orientation are
+        /// targets[offsets[2r]] to targets[offsets[2r+1]-1], those of its left side follow
+        std::vector<uint64_t> offsets;
+        std::vector<handle_t> targets;
+    };
+
+}
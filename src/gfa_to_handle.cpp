@@ -1,4 +1,11 @@
 #include "gfa_to_handle.hpp"
+#include "algorithms/profile.hpp"
+#include "algorithms/readahead.hpp"
+#include <charconv>
+#include <cstring>
+#include <numeric>
+#include <string_view>
+#include <zlib.h>
 
 namespace odgi {
 
@@ -24,175 +31,626 @@ std::map<char, uint64_t> gfa_line_counts(const char* filename) {
     return counts;
 }
 
+namespace {
+
+/// A byte range of the mapped GFA that starts at a line start and ends after a newline (or at the end of the file)
+struct gfa_chunk_t {
+    const char* begin;
+    const char* end;
+};
+
+/// A P or W line, whose steps are appended once all nodes exist
+struct gfa_path_line_t {
+    std::string name;
+    std::string_view steps;
+    bool is_walk;
+    handlegraph::path_handle_t path;
+};
+
+/// Per-chunk results of the first pass over the file
+struct gfa_chunk_scan_t {
+    std::map<char, uint64_t> counts;
+    uint64_t min_id = std::numeric_limits<uint64_t>::max();
+    uint64_t max_id = std::numeric_limits<uint64_t>::min();
+    std::vector<gfa_path_line_t> paths;
+};
+
+/// Split the buffer into at most n chunks on newline boundaries
+std::vector<gfa_chunk_t> split_gfa_chunks(const char* buf, size_t size, uint64_t n) {
+    std::vector<gfa_chunk_t> chunks;
+    const char* end = buf + size;
+    const char* begin = buf;
+    const size_t target = size / n + 1;
+    while (begin < end) {
+        const char* split = begin + std::min(target, (size_t)(end - begin));
+        if (split < end) {
+            const char* nl = (const char*)memchr(split, '\n', end - split);
+            split = nl ? nl + 1 : end;
+        }
+        chunks.push_back({begin, split});
+        begin = split;
+    }
+    return chunks;
+}
+
+/// Call the function on each line of the chunk, without its newline
+void for_each_gfa_line(const gfa_chunk_t& chunk, const std::function<void(std::string_view)>& func) {
+    const char* p = chunk.begin;
+    while (p < chunk.end) {
+        const char* nl = (const char*)memchr(p, '\n', chunk.end - p);
+        const char* e = nl ? nl : chunk.end;
+        std::string_view line(p, e - p);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (!line.empty()) {
+            func(line);
+        }
+        p = e + 1;
+    }
+}
+
+/// Split a line into its first max_fields tab-separated fields, the last of which holds the rest of the line
+std::vector<std::string_view> split_gfa_fields(std::string_view line, uint64_t max_fields) {
+    std::vector<std::string_view> fields;
+    while (fields.size() + 1 < max_fields) {
+        size_t tab = line.find('\t');
+        if (tab == std::string_view::npos) {
+            break;
+        }
+        fields.push_back(line.substr(0, tab));
+        line.remove_prefix(tab + 1);
+    }
+    fields.push_back(line);
+    return fields;
+}
+
+/// Parse a node id, returning false if the field is not a number
+bool parse_gfa_id(std::string_view field, uint64_t& id) {
+    auto result = std::from_chars(field.data(), field.data() + field.size(), id);
+    return result.ec == std::errc() && result.ptr == field.data() + field.size();
+}
+
+/// Run func(i) for every i in [0, n) across n_threads threads, handing out indexes dynamically
+void parallel_for_each_index(uint64_t n, uint64_t n_threads, const std::function<void(uint64_t)>& func) {
+    std::atomic<uint64_t> next{0};
+    auto worker =
+        [&]() {
+            uint64_t i;
+            while ((i = next.fetch_add(1)) < n) {
+                func(i);
+            }
+        };
+    std::vector<std::thread> workers;
+    workers.reserve(n_threads);
+    for (uint64_t t = 0; t < n_threads; ++t) {
+        workers.emplace_back(worker);
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+}
+
+
+/// Check for the gzip magic, which also covers bgzip
+bool is_gzip(const char* buf, size_t size) {
+    return size >= 18 && (uint8_t)buf[0] == 0x1f && (uint8_t)buf[1] == 0x8b;
+}
+
+inline uint16_t read_le16(const char* p) {
+    return (uint8_t)p[0] | ((uint16_t)(uint8_t)p[1] << 8);
+}
+
+inline uint32_t read_le32(const char* p) {
+    return read_le16(p) | ((uint32_t)read_le16(p + 2) << 16);
+}
+
+/// A BGZF block: where its deflate data lies in the file and where its text goes in the output
+struct bgzf_block_t {
+    uint64_t data_offset;
+    uint64_t data_length;
+    uint64_t out_offset;
+    uint64_t out_length;
+};
+
+/// Walk the BGZF block headers, returning false if the file is plain gzip
+bool bgzf_blocks(const char* buf, size_t size, std::vector<bgzf_block_t>& blocks) {
+    uint64_t offset = 0;
+    uint64_t out_offset = 0;
+    while (offset < size) {
+        const char* h = buf + offset;
+        if (size - offset < 18 || !is_gzip(h, size - offset) || !((uint8_t)h[3] & 4)) {
+            return false;
+        }
+        const uint16_t xlen = read_le16(h + 10);
+        uint64_t block_size = 0;
+        // find the BC subfield holding the block size
+        for (uint64_t x = 12; x + 4 <= 12 + (uint64_t)xlen && offset + x + 4 <= size; ) {
+            const uint16_t slen = read_le16(h + x + 2);
+            if (h[x] == 'B' && h[x+1] == 'C' && slen == 2) {
+                block_size = (uint64_t)read_le16(h + x + 4) + 1;
+            }
+            x += 4 + slen;
+        }
+        if (block_size == 0 || offset + block_size > size || block_size < 12 + (uint64_t)xlen + 8) {
+            return false;
+        }
+        const uint64_t out_length = read_le32(h + block_size - 4);
+        blocks.push_back({offset + 12 + xlen, block_size - 12 - xlen - 8, out_offset, out_length});
+        out_offset += out_length;
+        offset += block_size;
+    }
+    return true;
+}
+
+/// Inflate the compressed GFA into memory, decompressing BGZF blocks in parallel
+void inflate_gfa(const char* buf, size_t size, uint64_t n_threads, const std::string& filename, std::string& out) {
+    std::vector<bgzf_block_t> blocks;
+    if (bgzf_blocks(buf, size, blocks)) {
+        out.resize(blocks.empty() ? 0 : blocks.back().out_offset + blocks.back().out_length);
+        parallel_for_each_index(
+            blocks.size(), n_threads,
+            [&](uint64_t i) {
+                auto& b = blocks[i];
+                if (b.out_length == 0) return;
+                z_stream zs;
+                std::memset(&zs, 0, sizeof(zs));
+                inflateInit2(&zs, -15); // raw deflate, the block header is already parsed
+                zs.next_in = (Bytef*)(buf + b.data_offset);
+                zs.avail_in = b.data_length;
+                zs.next_out = (Bytef*)&out[b.out_offset];
+                zs.avail_out = b.out_length;
+                const int ret = inflate(&zs, Z_FINISH);
+                inflateEnd(&zs);
+                if (ret != Z_STREAM_END || zs.avail_out != 0) {
+                    std::cerr << "[odgi::gfa_to_handle] Error: corrupt BGZF block at offset " << b.data_offset
+                              << " in " << filename << "." << std::endl;
+                    exit(1);
+                }
+            });
+    } else {
+        // plain gzip has no independent blocks, so it inflates on one thread, member after member
+        z_stream zs;
+        std::memset(&zs, 0, sizeof(zs));
+        inflateInit2(&zs, 15 + 16);
+        zs.next_in = (Bytef*)buf;
+        zs.avail_in = size;
+        out.resize(std::max((size_t)1 << 20, size * 4));
+        uint64_t written = 0;
+        while (true) {
+            if (written == out.size()) {
+                out.resize(out.size() * 2);
+            }
+            zs.next_out = (Bytef*)&out[written];
+            zs.avail_out = out.size() - written;
+            const int ret = inflate(&zs, Z_NO_FLUSH);
+            written = out.size() - zs.avail_out;
+            if (ret == Z_STREAM_END) {
+                if (zs.avail_in == 0) break;
+                inflateReset(&zs);
+            } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+                std::cerr << "[odgi::gfa_to_handle] Error: could not decompress " << filename << "." << std::endl;
+                exit(1);
+            } else if (ret == Z_BUF_ERROR && zs.avail_in == 0) {
+                std::cerr << "[odgi::gfa_to_handle] Error: " << filename << " is truncated." << std::endl;
+                exit(1);
+            }
+        }
+        inflateEnd(&zs);
+        out.resize(written);
+    }
+}
+
+}
+
+namespace {
+
+/// The text of a GFA file, mapped, or inflated into memory if it is compressed
+struct gfa_text_t {
+    int fd = -1;
+    char* buf = nullptr;
+    size_t filesize = 0;
+    std::string inflated;
+    const char* data = nullptr;
+    size_t size = 0;
+};
+
+void open_gfa_text(const string& gfa_filename, uint64_t n_threads, gfa_text_t& text) {
+    text.filesize = gfak::mmap_open(gfa_filename, text.buf, text.fd);
+    if (text.fd == -1) {
+        std::cerr << "[odgi::gfa_to_handle] Error: couldn't open GFA file " << gfa_filename << "." << std::endl;
+        exit(1);
+    }
+    odgi::algorithms::advise_sequential(text.buf, text.filesize);
+    text.data = text.buf;
+    text.size = text.filesize;
+    // gzip and bgzip input is inflated into memory rather than to scratch disk
+    if (is_gzip(text.buf, text.filesize)) {
+        inflate_gfa(text.buf, text.filesize, n_threads, gfa_filename, text.inflated);
+        gfak::mmap_close(text.buf, text.fd, text.filesize);
+        text.fd = -1;
+        text.data = text.inflated.data();
+        text.size = text.inflated.size();
+    }
+}
+
+void close_gfa_text(gfa_text_t& text) {
+    if (text.fd != -1) {
+        gfak::mmap_close(text.buf, text.fd, text.filesize);
+        text.fd = -1;
+    }
+}
+
+/// Count the lines of the chunk, find its id range, and collect its paths
+void scan_gfa_chunk(const gfa_chunk_t& chunk, gfa_chunk_scan_t& scan) {
+    for_each_gfa_line(
+        chunk,
+        [&](std::string_view line) {
+            scan.counts[line[0]]++;
+            if (line[0] == 'S') {
+                auto fields = split_gfa_fields(line, 3);
+                uint64_t id = 0;
+                if (fields.size() < 3 || !parse_gfa_id(fields[1], id)) {
+                    std::cerr << "[odgi::gfa_to_handle] Error parsing segment '"
+                              << (fields.size() > 1 ? fields[1] : line) << "'" << std::endl;
+                    exit(1);
+                }
+                scan.min_id = std::min(scan.min_id, id);
+                scan.max_id = std::max(scan.max_id, id);
+            } else if (line[0] == 'P') {
+                auto fields = split_gfa_fields(line, 4);
+                if (fields.size() < 3) {
+                    std::cerr << "[odgi::gfa_to_handle] Error parsing path line '" << line.substr(0, 64) << "'" << std::endl;
+                    exit(1);
+                }
+                scan.paths.push_back({std::string(fields[1]), fields[2], false, handlegraph::as_path_handle(0)});
+            } else if (line[0] == 'W') {
+                auto fields = split_gfa_fields(line, 8);
+                if (fields.size() < 7) {
+                    std::cerr << "[odgi::gfa_to_handle] Error parsing walk line '" << line.substr(0, 64) << "'" << std::endl;
+                    exit(1);
+                }
+                // name walks by sample, haplotype and sequence, with the walked range if it is given
+                std::string name = std::string(fields[1]) + "#" + std::string(fields[2]) + "#" + std::string(fields[3]);
+                if (fields[4] != "*" && fields[5] != "*") {
+                    name += ":" + std::string(fields[4]) + "-" + std::string(fields[5]);
+                }
+                scan.paths.push_back({name, fields[6], true, handlegraph::as_path_handle(0)});
+            }
+        });
+}
+
+/// Parse the segments of each chunk in parallel, in file order
+std::vector<std::vector<std::pair<uint64_t, std::string_view>>> parse_gfa_segments(
+    const std::vector<gfa_chunk_t>& chunks, std::vector<gfa_chunk_scan_t>& scans, uint64_t n_threads) {
+    std::vector<std::vector<std::pair<uint64_t, std::string_view>>> segments(chunks.size());
+    parallel_for_each_index(
+        chunks.size(), n_threads,
+        [&](uint64_t c) {
+            segments[c].reserve(scans[c].counts['S']);
+            for_each_gfa_line(
+                chunks[c],
+                [&](std::string_view line) {
+                    if (line[0] != 'S') return;
+                    auto fields = split_gfa_fields(line, 4);
+                    uint64_t id = 0;
+                    parse_gfa_id(fields[1], id);
+                    segments[c].push_back(std::make_pair(id, fields[2]));
+                });
+        });
+    return segments;
+}
+
+/// Create the edges of the L lines, each chunk in its own thread; a graph_t takes them as one batch,
+/// merged per node, rather than locking both nodes per edge
+void build_gfa_edges(const std::vector<gfa_chunk_t>& chunks, std::vector<gfa_chunk_scan_t>& scans,
+                     handlegraph::MutablePathMutableHandleGraph* graph, graph_t* batch_graph,
+                     uint64_t id_increment, uint64_t edge_count, uint64_t n_threads, bool progress) {
+    std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress_meter;
+    if (progress) {
+        progress_meter = std::make_unique<algorithms::progress_meter::ProgressMeter>(
+            edge_count, "[odgi::gfa_to_handle] building edges:");
+    }
+    std::vector<std::vector<handlegraph::edge_t>> chunk_edges(batch_graph ? chunks.size() : 0);
+    parallel_for_each_index(
+        chunks.size(), n_threads,
+        [&](uint64_t c) {
+            if (batch_graph) {
+                chunk_edges[c].reserve(scans[c].counts['L']);
+            }
+            for_each_gfa_line(
+                chunks[c],
+                [&](std::string_view line) {
+                    if (line[0] != 'L') return;
+                    auto fields = split_gfa_fields(line, 6);
+                    uint64_t source_id = 0;
+                    uint64_t sink_id = 0;
+                    if (fields.size() < 5 || !parse_gfa_id(fields[1], source_id) || !parse_gfa_id(fields[3], sink_id)) {
+                        std::cerr << "[odgi::gfa_to_handle] Error creating edge from line '" << line.substr(0, 64) << "'" << std::endl;
+                        exit(1);
+                    }
+                    source_id -= id_increment;
+                    sink_id -= id_increment;
+                    if (graph->has_node(source_id) && graph->has_node(sink_id)) {
+                        handlegraph::handle_t a = graph->get_handle(source_id, fields[2] == "-");
+                        handlegraph::handle_t b = graph->get_handle(sink_id, fields[4] == "-");
+                        if (batch_graph) {
+                            chunk_edges[c].push_back(std::make_pair(a, b));
+                        } else {
+                            graph->create_edge(a, b);
+                        }
+                    } else {
+                        std::cerr << "[odgi::gfa_to_handle] Error creating edge '" << fields[1] << " <--> " << fields[3] << "' due to missing node(s)" << std::endl;
+                        exit(1);
+                    }
+                    if (progress) progress_meter->increment(1);
+                });
+        });
+    if (batch_graph) {
+        std::vector<handlegraph::edge_t> edges;
+        edges.reserve(edge_count);
+        for (auto& e : chunk_edges) {
+            edges.insert(edges.end(), e.begin(), e.end());
+            std::vector<handlegraph::edge_t>().swap(e);
+        }
+        batch_graph->set_number_of_threads(n_threads);
+        batch_graph->create_edges(edges);
+    }
+    if (progress) {
+        progress_meter->finish();
+    }
+}
+
+/// Create the paths of the P and W lines in file order, so that the path ranks are stable,
+/// then parse and append their steps in parallel, a path per thread
+void build_gfa_paths(std::vector<gfa_chunk_scan_t>& scans,
+                     handlegraph::MutablePathMutableHandleGraph* graph, graph_t* batch_graph,
+                     uint64_t id_increment, uint64_t path_count, uint64_t n_threads, bool progress) {
+    std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress_meter;
+    if (progress) {
+        progress_meter = std::make_unique<algorithms::progress_meter::ProgressMeter>(
+            path_count, "[odgi::gfa_to_handle] building paths:");
+    }
+    std::vector<gfa_path_line_t*> paths;
+    paths.reserve(path_count);
+    for (auto& scan : scans) {
+        for (auto& p : scan.paths) {
+            p.path = graph->create_path_handle(p.name);
+            paths.push_back(&p);
+        }
+    }
+    auto append =
+        [&](gfa_path_line_t& p, std::vector<handle_t>& handles, std::string_view s, bool is_rev) {
+            uint64_t id = 0;
+            if (!parse_gfa_id(s, id)) {
+                std::cerr << "[odgi::gfa_to_handle] id parsing failure for path "
+                          << p.name << " attempting to parse node id from '" << s << "'" << std::endl;
+                exit(1);
+            }
+            id -= id_increment;
+            if (graph->has_node(id)) {
+                handles.push_back(graph->get_handle(id, is_rev));
+            } else {
+                std::cerr << "[odgi::gfa_to_handle] Error creating path '" << p.name << "' due to missing node '" << s << "'" << std::endl;
+                exit(1);
+            }
+        };
+    parallel_for_each_index(
+        paths.size(), n_threads,
+        [&](uint64_t i) {
+            auto& p = *paths[i];
+            std::vector<handle_t> handles;
+            std::string_view steps = p.steps;
+            if (p.is_walk) {
+                // >1<2>3
+                while (!steps.empty()) {
+                    bool is_rev = steps[0] == '<';
+                    steps.remove_prefix(1);
+                    size_t next = steps.find_first_of("<>");
+                    append(p, handles, steps.substr(0, next), is_rev);
+                    steps.remove_prefix(next == std::string_view::npos ? steps.size() : next);
+                }
+            } else {
+                // 1+,2-,3+
+                while (!steps.empty()) {
+                    size_t comma = steps.find(',');
+                    std::string_view s = steps.substr(0, comma);
+                    if (s.size() < 2) {
+                        std::cerr << "[odgi::gfa_to_handle] Error creating path '" << p.name << "' from step '" << s << "'" << std::endl;
+                        exit(1);
+                    }
+                    append(p, handles, s.substr(0, s.size() - 1), s.back() == '-');
+                    steps.remove_prefix(comma == std::string_view::npos ? steps.size() : comma + 1);
+                }
+            }
+            if (batch_graph) {
+                batch_graph->append_steps(p.path, handles);
+            } else {
+                for (auto& handle : handles) {
+                    graph->append_step(p.path, handle);
+                }
+            }
+            if (progress) progress_meter->increment(1);
+        });
+    if (progress) {
+        progress_meter->finish();
+    }
+    if (batch_graph && paths.size() > 1) {
+        // a path spelled exactly as an earlier one, such as a duplicate contig, is noted as a copy of it,
+        // which the graph then saves as a reference to the earlier path rather than as steps of its own
+        std::vector<uint64_t> hashes(paths.size());
+        parallel_for_each_index(
+            paths.size(), n_threads,
+            [&](uint64_t i) {
+                hashes[i] = std::hash<std::string_view>()(paths[i]->steps);
+            });
+        std::vector<uint64_t> order(paths.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](const uint64_t& a, const uint64_t& b) {
+            return hashes[a] < hashes[b] || (hashes[a] == hashes[b] && a < b);
+        });
+        for (uint64_t k = 1, first = order[0]; k < order.size(); ++k) {
+            const gfa_path_line_t& p = *paths[order[k]];
+            const gfa_path_line_t& q = *paths[first];
+            if (hashes[order[k]] == hashes[first] && p.is_walk == q.is_walk
+                && !p.steps.empty() && p.steps == q.steps) {
+                batch_graph->set_path_copy(p.path, q.path, 0);
+            } else {
+                first = order[k];
+            }
+        }
+    }
+}
+
+/// Scan the chunks in parallel, summing their line counts and id ranges
+std::vector<gfa_chunk_scan_t> scan_gfa_chunks(const std::vector<gfa_chunk_t>& chunks, uint64_t n_threads,
+                                              std::map<char, uint64_t>& line_counts, uint64_t& min_id, uint64_t& max_id) {
+    std::vector<gfa_chunk_scan_t> scans(chunks.size());
+    parallel_for_each_index(
+        chunks.size(), n_threads,
+        [&](uint64_t c) {
+            scan_gfa_chunk(chunks[c], scans[c]);
+        });
+    min_id = std::numeric_limits<uint64_t>::max();
+    max_id = std::numeric_limits<uint64_t>::min();
+    for (auto& scan : scans) {
+        for (auto& c : scan.counts) {
+            line_counts[c.first] += c.second;
+        }
+        min_id = std::min(min_id, scan.min_id);
+        max_id = std::max(max_id, scan.max_id);
+    }
+    return scans;
+}
+
+}
+
 void gfa_to_handle(const string& gfa_filename,
                    handlegraph::MutablePathMutableHandleGraph* graph,
                    bool compact_ids,
                    uint64_t n_threads,
                    bool progress) {
 
+    algorithms::profile::scope_t profile_scope("parse GFA");
     n_threads = (n_threads == 0 ? 1 : n_threads);
-    char* filename = (char*) gfa_filename.c_str();
-    //std::cerr << "filename is " << filename << std::endl;
-    gfak::GFAKluge gg;
-    uint64_t i = 0;
-    uint64_t min_id = std::numeric_limits<uint64_t>::max();
-    uint64_t max_id = std::numeric_limits<uint64_t>::min();
+    gfa_text_t text;
+    open_gfa_text(gfa_filename, n_threads, text);
+    // each thread works on its own range of lines
+    const std::vector<gfa_chunk_t> chunks = split_gfa_chunks(text.data, text.size, n_threads);
+
+    // in parallel scan over the chunks to count lines, find the id range, and collect the paths
     std::map<char, uint64_t> line_counts;
-    // in parallel scan over the file to count edges and sequences
-    {
-        std::thread x(
-            [&]() {
-                gg.for_each_sequence_line_in_file(
-                    filename,
-                    [&](gfak::sequence_elem s) {
-                        try {
-                            uint64_t id = stol(s.name);
-                            min_id = std::min(min_id, id);
-                            max_id = std::max(max_id, id);
-                        } catch (const std::exception& e) {
-                            std::cerr << "[odgi::gfa_to_handle] Error parsing segment '" << s.name << "': " << e.what() << std::endl;
-                            exit(1);
-                        }
-                    });
-            });
-        line_counts = gfa_line_counts(filename);
-        x.join();
-    }
+    uint64_t min_id = 0;
+    uint64_t max_id = 0;
+    std::vector<gfa_chunk_scan_t> scans = scan_gfa_chunks(chunks, n_threads, line_counts, min_id, max_id);
     uint64_t id_increment = (compact_ids ? min_id - 1 : 0);
     uint64_t node_count = line_counts['S'];
     uint64_t edge_count = line_counts['L'];
-    uint64_t path_count = line_counts['P'];
+    uint64_t path_count = line_counts['P'] + line_counts['W'];
+
     // build the nodes
+    // node creation resizes the graph, so the segments of each chunk are parsed in parallel
+    // and then added in file order
     {
         std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress_meter;
         if (progress) {
             progress_meter = std::make_unique<algorithms::progress_meter::ProgressMeter>(
                 node_count, "[odgi::gfa_to_handle] building nodes:");
         }
-        gg.for_each_sequence_line_in_file(
-            filename,
-            [&](const gfak::sequence_elem& s) {
-                try {
-                    uint64_t id = stol(s.name);
-                    graph->create_handle(s.sequence, id - id_increment);
-                } catch (const std::exception& e) {
-                    std::cerr << "[odgi::gfa_to_handle] Error creating node '" << s.name << ": " << e.what() << std::endl;
-                    exit(1);
-                }
+        auto segments = parse_gfa_segments(chunks, scans, n_threads);
+        for (auto& chunk_segments : segments) {
+            for (auto& s : chunk_segments) {
+                graph->create_handle(std::string(s.second), s.first - id_increment);
                 if (progress) progress_meter->increment(1);
-            });
+            }
+            chunk_segments.clear();
+            chunk_segments.shrink_to_fit();
+        }
         if (progress) {
             progress_meter->finish();
         }
     }
 
-    {
-        std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress_meter;
-        if (progress) {
-            progress_meter = std::make_unique<algorithms::progress_meter::ProgressMeter>(
-                edge_count, "[odgi::gfa_to_handle] building edges:");
-        }
-        gg.for_each_edge_line_in_file(
-            filename,
-            [&](const gfak::edge_elem& e) {
-                if (e.source_name.empty()) return;
-                try {
-                    uint64_t source_id = stol(e.source_name) - id_increment;
-                    uint64_t sink_id = stol(e.sink_name) - id_increment;
-                    if (graph->has_node(source_id) && graph->has_node(sink_id)) {
-                        handlegraph::handle_t a = graph->get_handle(stol(e.source_name) - id_increment, !e.source_orientation_forward);
-                        handlegraph::handle_t b = graph->get_handle(stol(e.sink_name) - id_increment, !e.sink_orientation_forward);
-                        graph->create_edge(a, b);
-                    } else {
-                        std::cerr << "[odgi::gfa_to_handle] Error creating edge '" << e.source_name << " <--> " << e.sink_name << "' due to missing node(s)" << std::endl;
-                        exit(1);
-                    }
-                } catch (const std::exception& exc) {
-                    std::cerr << "[odgi::gfa_to_handle] Error creating edge '" << e.source_name << " <--> " << e.sink_name << "': " << exc.what() << std::endl;
-                    exit(1);
-                }
+    // a graph_t takes edges and path steps in batches
+    graph_t* batch_graph = dynamic_cast<graph_t*>(graph);
 
-                if (progress) progress_meter->increment(1);
-            });
-        if (progress) {
-            progress_meter->finish();
-        }
-    }
+    build_gfa_edges(chunks, scans, graph, batch_graph, id_increment, edge_count, n_threads, progress);
 
     if (path_count > 0) {
-        std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress_meter;
-        if (progress) {
-            progress_meter = std::make_unique<algorithms::progress_meter::ProgressMeter>(
-                path_count, "[odgi::gfa_to_handle] building paths:");
-        }
-        gfa_path_queue_t path_queue;
-        std::mutex logging_mutex;
-        std::atomic<bool> work_todo{};
-        uint64_t idx = 0;
-        auto worker =
-            [&](uint64_t tid) {
-                while (work_todo.load()) {
-                    path_elem_t * p;
-                    if (path_queue.try_pop(p)) {
-                        uint64_t i = 0;
-                        for (auto& s : p->gfak.segment_names) {
-                            uint64_t id = 0;
-                            try {
-                                id = std::stoull(s) - id_increment;
-                                if (graph->has_node(id)) {
-                                    graph->append_step(p->path,
-                                                graph->get_handle(id,
-                                                                    // in gfak, true == +
-                                                                    !p->gfak.orientations[i++]));
-                                } else {
-                                    std::cerr << "[odgi::gfa_to_handle] Error creating path '" << graph->get_path_name(p->path) << "' due to missing node '" << s << "'" << std::endl;
-                                    exit(1);
-                                }
-                            } catch (...) {
-                                std::cerr << "[odgi::gfa_to_handle] id parsing failure for path "
-                                          << graph->get_path_name(p->path)
-                                          << " attempting to parse node id from '" << s << "'" << std::endl;
-                                exit(1);
-                            }
-                        }
-                        delete p;
-                        if (progress) progress_meter->increment(1);
-                    } else {
-                        std::this_thread::sleep_for(std::chrono::nanoseconds(1));
-                    }
-                }
-            };
+        build_gfa_paths(scans, graph, batch_graph, id_increment, path_count, n_threads, progress);
+    }
 
-        std::vector<std::thread> workers;
-        workers.reserve(n_threads);
-        work_todo.store(true);
-        for (uint64_t t = 0; t < n_threads; ++t) {
-            workers.emplace_back(worker, t);
-        }
+    close_gfa_text(text);
 
-        gg.for_each_path_line_in_file(
-            filename,
-            [&](const gfak::path_elem& path) {
-                handlegraph::path_handle_t p_h = graph->create_path_handle(path.name);
-                path_elem_t* p = new path_elem_t({p_h, path});
-                path_queue.push(p);
-            });
+    if (compact_ids) {
+        graph->optimize();
+    }
 
-        while (!path_queue.was_empty()) {
-            std::this_thread::sleep_for(std::chrono::nanoseconds(1));
+}
+
+void gfa_append_to_handle(const string& gfa_filename,
+                          graph_t* graph,
+                          uint64_t n_threads,
+                          bool progress) {
+
+    algorithms::profile::scope_t profile_scope("append GFA");
+    n_threads = (n_threads == 0 ? 1 : n_threads);
+    gfa_text_t text;
+    open_gfa_text(gfa_filename, n_threads, text);
+    const std::vector<gfa_chunk_t> chunks = split_gfa_chunks(text.data, text.size, n_threads);
+    std::map<char, uint64_t> line_counts;
+    uint64_t min_id = 0;
+    uint64_t max_id = 0;
+    std::vector<gfa_chunk_scan_t> scans = scan_gfa_chunks(chunks, n_threads, line_counts, min_id, max_id);
+    graph->set_number_of_threads(n_threads);
+
+    // the paths are appended, never merged into paths of the graph
+    for (auto& scan : scans) {
+        for (auto& p : scan.paths) {
+            if (graph->has_path(p.name)) {
+                std::cerr << "[odgi::gfa_to_handle] Error: path '" << p.name << "' is already in the graph" << std::endl;
+                exit(1);
+            }
         }
-        work_todo.store(false);
-        for (uint64_t t = 0; t < n_threads; ++t) {
-            workers[t].join();
+    }
+
+    // segments already in the graph are checked, the others are added
+    {
+        auto segments = parse_gfa_segments(chunks, scans, n_threads);
+        std::atomic<bool> mismatch(false);
+        parallel_for_each_index(
+            segments.size(), n_threads,
+            [&](uint64_t c) {
+                for (auto& s : segments[c]) {
+                    if (graph->has_node(s.first)
+                        && graph->get_sequence(graph->get_handle(s.first)) != s.second) {
+                        std::cerr << "[odgi::gfa_to_handle] Error: segment " << s.first
+                                  << " differs from node " << s.first << " of the graph" << std::endl;
+                        mismatch.store(true);
+                    }
+                }
+            });
+        if (mismatch) {
+            exit(1);
         }
-        if (progress) {
-            progress_meter->finish();
+        for (auto& chunk_segments : segments) {
+            for (auto& s : chunk_segments) {
+                if (!graph->has_node(s.first)) {
+                    graph->create_handle(std::string(s.second), s.first);
+                }
+            }
         }
     }
 
-    if (compact_ids) {
-        graph->optimize();
+    // existing links are ignored by the batch
+    build_gfa_edges(chunks, scans, graph, graph, 0, line_counts['L'], n_threads, progress);
+
+    const uint64_t path_count = line_counts['P'] + line_counts['W'];
+    if (path_count > 0) {
+        build_gfa_paths(scans, graph, graph, 0, path_count, n_threads, progress);
     }
 
+    close_gfa_text(text);
 }
+
 }
@@ -17,6 +17,7 @@
 #include <functional>
 #include "atomic_queue.h"
 #include "progress.hpp"
+#include "odgi.hpp"
 
 namespace odgi {
 
@@ -37,4 +38,13 @@ void gfa_to_handle(const string& gfa_filename,
                    uint64_t n_threads,
                    bool show_progress);
 
+/// Adds the segments, links and paths of a GFA file to a graph that already holds others, in time
+/// proportional to the file. Segments whose ids are in the graph must carry the sequence of their
+/// node, links that exist are ignored, and the P and W lines must name paths not yet in the graph,
+/// whose steps are appended in batches.
+void gfa_append_to_handle(const string& gfa_filename,
+                          graph_t* graph,
+                          uint64_t n_threads,
+                          bool show_progress);
+
 }
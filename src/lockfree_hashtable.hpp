@@ -112,6 +112,12 @@ class LockFreeHashTable {
 
   size_t size() const { return size_.load(std::memory_order_relaxed); }
 
+  // An estimate of the bytes of the items and buckets: a node and a boxed value per item, a dummy
+  // node and a slot per bucket
+  size_t memory_bytes() const {
+    return size() * (sizeof(RegularNode) + sizeof(V)) + bucket_size() * (sizeof(DummyNode) + sizeof(Bucket));
+  }
+
  private:
   size_t bucket_size() const {
     return 1 << power_of_2_.load(std::memory_order_relaxed);
@@ -4,6 +4,10 @@
 // New subcommand system provides all the subcommands that used to live here
 #include "subcommand/subcommand.hpp"
 #include "version.hpp"
+#include "algorithms/profile.hpp"
+#include "algorithms/huge_pages.hpp"
+#include "algorithms/memory_budget.hpp"
+#include "algorithms/sgd_distributed.hpp"
 
 using namespace std;
 using namespace odgi;
@@ -40,10 +44,38 @@ int main(int argc, char *argv[]) {
         return 0;
     }
 
+    // --profile (or --profile=json), --max-mem=SIZE and --huge-pages may be given to any subcommand, we take them out of its arguments
+    {
+        int kept = 1;
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (i > 1 && (arg == "--profile" || arg == "--profile=json")) {
+                odgi::algorithms::profile::enable(arg == "--profile=json");
+            } else if (i > 1 && (arg == "--max-mem" || arg.rfind("--max-mem=", 0) == 0)) {
+                const std::string size = arg == "--max-mem" ? (i + 1 < argc ? argv[++i] : "") : arg.substr(10);
+                uint64_t bytes = 0;
+                if (!odgi::algorithms::memory_budget::parse(size, bytes)) {
+                    cerr << "[odgi] error: --max-mem takes a size such as 4096, 500M or 16G, not '" << size << "'." << endl;
+                    return 1;
+                }
+                odgi::algorithms::memory_budget::set(bytes);
+            } else if (i > 1 && arg == "--huge-pages") {
+                odgi::algorithms::huge_pages::set_enabled(true);
+            } else {
+                argv[kept++] = argv[i];
+            }
+        }
+        argc = kept;
+        argv[argc] = nullptr;
+    }
+
     const auto* subcommand = odgi::subcommand::Subcommand::get(argc, argv);
     if (subcommand != nullptr) {
-        // We found a matching subcommand, so run it
-        return (*subcommand)(argc, argv);
+        // We found a matching subcommand, so run it, as one of the ranks of an MPI run if started by mpirun
+        odgi::algorithms::distributed::init(&argc, &argv);
+        const int status = (*subcommand)(argc, argv);
+        odgi::algorithms::distributed::finalize();
+        return status;
     } else {
         // No subcommand found
         cerr << "[odgi] error: command '" << argv[1] << "' not found.\n\nType `odgi` to list the available commands.\n" << endl;
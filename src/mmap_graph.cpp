@@ -0,0 +1,650 @@
+//
+//  mmap_graph.cpp
+//
+
+#include "mmap_graph.hpp"
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cassert>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "dna.hpp"
+
+namespace odgi {
+
+namespace {
+
+inline uint64_t pad_to_word(uint64_t bytes) {
+    return (bytes + 7) & ~7ull;
+}
+
+void write_padding(std::ostream& out, uint64_t bytes) {
+    static const char zeros[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    out.write(zeros, pad_to_word(bytes) - bytes);
+}
+
+// write a section and pad it so that the next one stays 8-byte aligned
+void write_section(std::ostream& out, const char* data, uint64_t bytes) {
+    out.write(data, bytes);
+    write_padding(out, bytes);
+}
+
+void write_section(std::ostream& out, const std::vector<uint64_t>& v) {
+    write_section(out, (const char*)v.data(), v.size() * sizeof(uint64_t));
+}
+
+const std::string shm_prefix = "shm:";
+
+inline bool is_shm_name(const std::string& filename) {
+    return filename.compare(0, shm_prefix.size(), shm_prefix) == 0;
+}
+
+// POSIX wants shared memory names to start with a single slash
+inline std::string shm_path(const std::string& name) {
+    return name.empty() || name[0] != '/' ? "/" + name : name;
+}
+
+// unbuffered output to a file descriptor, so that freeze() can write straight into a segment
+class fd_streambuf_t : public std::streambuf {
+public:
+    explicit fd_streambuf_t(int fd) : fd(fd) {}
+protected:
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        std::streamsize done = 0;
+        while (done < n) {
+            const ssize_t w = ::write(fd, s + done, n - done);
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            done += w;
+        }
+        return done;
+    }
+    int_type overflow(int_type c) override {
+        if (traits_type::eq_int_type(c, traits_type::eof())) {
+            return traits_type::not_eof(c);
+        }
+        const char ch = traits_type::to_char_type(c);
+        return xsputn(&ch, 1) == 1 ? c : traits_type::eof();
+    }
+private:
+    int fd;
+};
+
+}
+
+void mmap_graph_t::freeze(const graph_t& graph, std::ostream& out) {
+    header_t h;
+    std::memset(&h, 0, sizeof(header_t));
+    h.magic = MAGIC;
+    h.version = VERSION;
+
+    // node ranks follow the graph's iteration order
+    std::vector<uint64_t> node_ids;
+    node_ids.reserve(graph.get_node_count());
+    graph.for_each_handle(
+        [&](const handle_t& handle) {
+            node_ids.push_back(graph.get_id(handle));
+        });
+    h.node_count = node_ids.size();
+    if (h.node_count) {
+        auto minmax = std::minmax_element(node_ids.begin(), node_ids.end());
+        h.min_id = *minmax.first;
+        h.max_id = *minmax.second;
+    }
+    std::vector<uint64_t> rank_of_id(h.node_count ? h.max_id - h.min_id + 1 : 0, NO_RANK);
+    for (uint64_t i = 0; i < node_ids.size(); ++i) {
+        rank_of_id[node_ids[i] - h.min_id] = i;
+    }
+    auto to_frozen =
+        [&](const handle_t& handle) {
+            return as_integer(number_bool_packing::pack(rank_of_id[graph.get_id(handle) - h.min_id],
+                                                        graph.get_is_reverse(handle)));
+        };
+
+    // sequence offsets
+    std::vector<uint64_t> seq_index(h.node_count + 1, 0);
+    for (uint64_t i = 0; i < h.node_count; ++i) {
+        seq_index[i+1] = seq_index[i] + graph.get_length(graph.get_handle(node_ids[i]));
+    }
+    h.seq_length = seq_index.back();
+
+    // 2-bit packed sequences, with the bases that are not ACGT kept aside as (position << 8 | base)
+    std::vector<uint64_t> seq_words((h.seq_length + 31) / 32, 0);
+    std::vector<uint64_t> seq_exceptions;
+    for (uint64_t i = 0; i < h.node_count; ++i) {
+        const std::string s = graph.get_sequence(graph.get_handle(node_ids[i]));
+        if (pack_2bit(s.data(), s.size(), seq_words.data(), seq_index[i]) > 0) {
+            for (uint64_t j = dna_find_non_2bit(s.data(), s.size()); j < s.size();
+                 j += 1 + dna_find_non_2bit(s.data() + j + 1, s.size() - j - 1)) {
+                seq_exceptions.push_back((seq_index[i] + j) << 8 | (uint8_t)s[j]);
+            }
+        }
+    }
+    h.seq_exception_count = seq_exceptions.size();
+
+    // edges to the right of each oriented handle
+    std::vector<uint64_t> edge_index(2 * h.node_count + 1, 0);
+    std::vector<uint64_t> edge_targets;
+    for (uint64_t i = 0; i < h.node_count; ++i) {
+        for (uint8_t is_rev = 0; is_rev < 2; ++is_rev) {
+            graph.follow_edges(
+                graph.get_handle(node_ids[i], is_rev), false,
+                [&](const handle_t& next) {
+                    edge_targets.push_back(to_frozen(next));
+                });
+            edge_index[2*i+is_rev+1] = edge_targets.size();
+        }
+    }
+    h.edge_count = graph.get_edge_count();
+
+    // paths, in the order of the graph's path handles
+    std::vector<path_handle_t> paths;
+    graph.for_each_path_handle(
+        [&](const path_handle_t& path) {
+            paths.push_back(path);
+        });
+    h.path_count = paths.size();
+    std::vector<uint64_t> path_step_index(h.path_count + 1, 0);
+    std::vector<uint64_t> path_name_index(h.path_count + 1, 0);
+    std::vector<uint64_t> path_circular(h.path_count, 0);
+    std::string names;
+    for (uint64_t i = 0; i < h.path_count; ++i) {
+        names.append(graph.get_path_name(paths[i]));
+        path_name_index[i+1] = names.size();
+        path_step_index[i+1] = path_step_index[i] + graph.get_step_count(paths[i]);
+        path_circular[i] = graph.get_is_circular(paths[i]);
+    }
+    h.name_length = names.size();
+    h.step_count = path_step_index.back();
+    std::vector<uint64_t> path_name_order(h.path_count);
+    for (uint64_t i = 0; i < h.path_count; ++i) {
+        path_name_order[i] = i;
+    }
+    std::sort(path_name_order.begin(), path_name_order.end(),
+              [&](const uint64_t& a, const uint64_t& b) {
+                  return std::string_view(names.data() + path_name_index[a], path_name_index[a+1] - path_name_index[a])
+                      < std::string_view(names.data() + path_name_index[b], path_name_index[b+1] - path_name_index[b]);
+              });
+    std::vector<uint64_t> path_steps;
+    path_steps.reserve(h.step_count);
+    for (auto& path : paths) {
+        graph.for_each_step_in_path(
+            path,
+            [&](const step_handle_t& step) {
+                path_steps.push_back(to_frozen(graph.get_handle_of_step(step)));
+            });
+    }
+
+    // invert the path steps into the steps on each node, with a counting sort by node rank
+    std::vector<uint64_t> node_step_index(h.node_count + 1, 0);
+    for (auto& s : path_steps) {
+        ++node_step_index[number_bool_packing::unpack_number(as_handle(s)) + 1];
+    }
+    for (uint64_t i = 0; i < h.node_count; ++i) {
+        node_step_index[i+1] += node_step_index[i];
+    }
+    std::vector<uint64_t> node_steps(2 * h.step_count);
+    {
+        std::vector<uint64_t> fill(node_step_index.begin(), node_step_index.end() - 1);
+        for (uint64_t p = 0; p < h.path_count; ++p) {
+            for (uint64_t j = path_step_index[p]; j < path_step_index[p+1]; ++j) {
+                uint64_t& k = fill[number_bool_packing::unpack_number(as_handle(path_steps[j]))];
+                node_steps[2*k] = p;
+                node_steps[2*k+1] = j - path_step_index[p];
+                ++k;
+            }
+        }
+    }
+
+    // lay out the sections
+    uint64_t offset = pad_to_word(sizeof(header_t));
+    auto place =
+        [&](uint64_t& section_offset, uint64_t bytes) {
+            section_offset = offset;
+            offset += pad_to_word(bytes);
+        };
+    place(h.ids_offset, node_ids.size() * sizeof(uint64_t));
+    place(h.id_to_rank_offset, rank_of_id.size() * sizeof(uint64_t));
+    place(h.seq_index_offset, seq_index.size() * sizeof(uint64_t));
+    place(h.seq_offset, seq_words.size() * sizeof(uint64_t));
+    place(h.seq_exception_offset, seq_exceptions.size() * sizeof(uint64_t));
+    place(h.edge_index_offset, edge_index.size() * sizeof(uint64_t));
+    place(h.edge_offset, edge_targets.size() * sizeof(uint64_t));
+    place(h.path_step_index_offset, path_step_index.size() * sizeof(uint64_t));
+    place(h.path_name_index_offset, path_name_index.size() * sizeof(uint64_t));
+    place(h.path_name_offset, h.name_length);
+    place(h.path_name_order_offset, path_name_order.size() * sizeof(uint64_t));
+    place(h.path_circular_offset, path_circular.size() * sizeof(uint64_t));
+    place(h.path_steps_offset, path_steps.size() * sizeof(uint64_t));
+    place(h.node_step_index_offset, node_step_index.size() * sizeof(uint64_t));
+    place(h.node_steps_offset, node_steps.size() * sizeof(uint64_t));
+
+    write_section(out, (const char*)&h, sizeof(header_t));
+    write_section(out, node_ids);
+    write_section(out, rank_of_id);
+    write_section(out, seq_index);
+    write_section(out, seq_words);
+    write_section(out, seq_exceptions);
+    write_section(out, edge_index);
+    write_section(out, edge_targets);
+    write_section(out, path_step_index);
+    write_section(out, path_name_index);
+    write_section(out, names.c_str(), names.size());
+    write_section(out, path_name_order);
+    write_section(out, path_circular);
+    write_section(out, path_steps);
+    write_section(out, node_step_index);
+    write_section(out, node_steps);
+}
+
+void mmap_graph_t::share(const graph_t& graph, const std::string& name) {
+    const std::string path = shm_path(name);
+    const int fd = shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        std::cerr << "[odgi::mmap_graph] error: could not create shared memory segment \"" << name << "\": "
+                  << std::strerror(errno) << std::endl;
+        exit(1);
+    }
+    fd_streambuf_t sbuf(fd);
+    std::ostream out(&sbuf);
+    freeze(graph, out);
+    out.flush();
+    const bool ok = out.good();
+    ::close(fd);
+    if (!ok) {
+        shm_unlink(path.c_str());
+        std::cerr << "[odgi::mmap_graph] error: could not write the graph to shared memory segment \"" << name << "\"." << std::endl;
+        exit(1);
+    }
+}
+
+bool mmap_graph_t::unshare(const std::string& name) {
+    return shm_unlink(shm_path(name).c_str()) == 0;
+}
+
+bool mmap_graph_t::is_mmap_graph(const std::string& filename) {
+    if (is_shm_name(filename)) {
+        const int fd = shm_open(shm_path(filename.substr(shm_prefix.size())).c_str(), O_RDONLY, 0);
+        if (fd < 0) {
+            return false;
+        }
+        uint64_t magic = 0;
+        const bool ok = ::pread(fd, &magic, sizeof(magic), 0) == sizeof(magic);
+        ::close(fd);
+        return ok && magic == MAGIC;
+    }
+    std::ifstream in(filename.c_str(), std::ios::binary);
+    uint64_t magic = 0;
+    in.read((char*)&magic, sizeof(magic));
+    return in.good() && magic == MAGIC;
+}
+
+void mmap_graph_t::load(const std::string& filename) {
+    unmap();
+    std::error_code error;
+    if (is_shm_name(filename)) {
+        const int fd = shm_open(shm_path(filename.substr(shm_prefix.size())).c_str(), O_RDONLY, 0);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            std::cerr << "[odgi::mmap_graph] error: could not attach \"" << filename << "\": " << std::strerror(errno) << std::endl;
+            exit(1);
+        }
+        if (st.st_size > 0) {
+            buffer.map(fd, 0, st.st_size, error);
+        }
+        // the mapping outlives the descriptor
+        ::close(fd);
+    } else {
+        buffer.map(filename, error);
+    }
+    if (error) {
+        std::cerr << "[odgi::mmap_graph] error: could not map \"" << filename << "\": " << error.message() << std::endl;
+        exit(1);
+    }
+    attach(filename);
+}
+
+void mmap_graph_t::attach(const std::string& filename) {
+    if (buffer.size() < sizeof(header_t)) {
+        std::cerr << "[odgi::mmap_graph] error: \"" << filename << "\" is too small to be a memory-mappable graph." << std::endl;
+        exit(1);
+    }
+    header = at_offset<header_t>(0);
+    if (header->magic != MAGIC) {
+        std::cerr << "[odgi::mmap_graph] error: \"" << filename << "\" is not a memory-mappable graph." << std::endl;
+        exit(1);
+    }
+    if (header->version != VERSION) {
+        std::cerr << "[odgi::mmap_graph] error: \"" << filename << "\" has layout version " << header->version
+                  << ", expected " << VERSION << "." << std::endl;
+        exit(1);
+    }
+    if (header->node_steps_offset + 2 * header->step_count * sizeof(uint64_t) > buffer.size()) {
+        std::cerr << "[odgi::mmap_graph] error: \"" << filename << "\" is truncated." << std::endl;
+        exit(1);
+    }
+    ids = at_offset<uint64_t>(header->ids_offset);
+    id_to_rank = at_offset<uint64_t>(header->id_to_rank_offset);
+    seq_index = at_offset<uint64_t>(header->seq_index_offset);
+    seq_words = at_offset<uint64_t>(header->seq_offset);
+    seq_exceptions = at_offset<uint64_t>(header->seq_exception_offset);
+    edge_index = at_offset<uint64_t>(header->edge_index_offset);
+    edges = at_offset<uint64_t>(header->edge_offset);
+    path_step_index = at_offset<uint64_t>(header->path_step_index_offset);
+    path_name_index = at_offset<uint64_t>(header->path_name_index_offset);
+    path_names = at_offset<char>(header->path_name_offset);
+    path_name_order = at_offset<uint64_t>(header->path_name_order_offset);
+    path_circular = at_offset<uint64_t>(header->path_circular_offset);
+    path_steps = at_offset<uint64_t>(header->path_steps_offset);
+    node_step_index = at_offset<uint64_t>(header->node_step_index_offset);
+    node_steps = at_offset<uint64_t>(header->node_steps_offset);
+}
+
+void mmap_graph_t::unmap() {
+    if (buffer.is_mapped()) {
+        buffer.unmap();
+    }
+    header = nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////
+// Handle graph interface
+////////////////////////////////////////////////////////////////////////////
+
+bool mmap_graph_t::has_node(nid_t node_id) const {
+    return header->node_count
+        && node_id >= (nid_t)header->min_id
+        && node_id <= (nid_t)header->max_id
+        && id_to_rank[node_id - header->min_id] != NO_RANK;
+}
+
+handle_t mmap_graph_t::get_handle(const nid_t& node_id, bool is_reverse) const {
+    return number_bool_packing::pack(id_to_rank[node_id - header->min_id], is_reverse);
+}
+
+nid_t mmap_graph_t::get_id(const handle_t& handle) const {
+    return ids[number_bool_packing::unpack_number(handle)];
+}
+
+bool mmap_graph_t::get_is_reverse(const handle_t& handle) const {
+    return number_bool_packing::unpack_bit(handle);
+}
+
+handle_t mmap_graph_t::flip(const handle_t& handle) const {
+    return number_bool_packing::toggle_bit(handle);
+}
+
+size_t mmap_graph_t::get_length(const handle_t& handle) const {
+    uint64_t rank = number_bool_packing::unpack_number(handle);
+    return seq_index[rank+1] - seq_index[rank];
+}
+
+void mmap_graph_t::append_forward_sequence(std::string& out, uint64_t pos, uint64_t length) const {
+    const uint64_t begin = out.size();
+    out.resize(begin + length);
+    unpack_2bit(seq_words, pos, length, out.data() + begin);
+    const uint64_t* end = seq_exceptions + header->seq_exception_count;
+    for (const uint64_t* e = std::lower_bound(seq_exceptions, end, pos << 8);
+         e != end && (*e >> 8) < pos + length; ++e) {
+        out[begin + (*e >> 8) - pos] = (char)(*e & 0xff);
+    }
+}
+
+std::string mmap_graph_t::forward_sequence(uint64_t pos, uint64_t length) const {
+    std::string s;
+    append_forward_sequence(s, pos, length);
+    return s;
+}
+
+void mmap_graph_t::append_sequence(const handle_t& handle, std::string& out) const {
+    uint64_t rank = number_bool_packing::unpack_number(handle);
+    const uint64_t begin = out.size();
+    append_forward_sequence(out, seq_index[rank], seq_index[rank+1] - seq_index[rank]);
+    if (get_is_reverse(handle)) {
+        reverse_complement_in_place(out.data() + begin, out.size() - begin);
+    }
+}
+
+std::string mmap_graph_t::get_sequence(const handle_t& handle) const {
+    uint64_t rank = number_bool_packing::unpack_number(handle);
+    std::string s = forward_sequence(seq_index[rank], seq_index[rank+1] - seq_index[rank]);
+    if (get_is_reverse(handle)) {
+        reverse_complement_in_place(s);
+    }
+    return s;
+}
+
+size_t mmap_graph_t::get_node_count() const {
+    return header->node_count;
+}
+
+nid_t mmap_graph_t::min_node_id() const {
+    return header->min_id;
+}
+
+nid_t mmap_graph_t::max_node_id() const {
+    return header->max_id;
+}
+
+size_t mmap_graph_t::get_degree(const handle_t& handle, bool go_left) const {
+    uint64_t i = as_integer(go_left ? flip(handle) : handle);
+    return edge_index[i+1] - edge_index[i];
+}
+
+bool mmap_graph_t::has_edge(const handle_t& left, const handle_t& right) const {
+    uint64_t i = as_integer(left);
+    for (uint64_t j = edge_index[i]; j < edge_index[i+1]; ++j) {
+        if (edges[j] == as_integer(right)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t mmap_graph_t::get_edge_count() const {
+    return header->edge_count;
+}
+
+size_t mmap_graph_t::get_total_length() const {
+    return header->seq_length;
+}
+
+char mmap_graph_t::get_base(const handle_t& handle, size_t index) const {
+    uint64_t rank = number_bool_packing::unpack_number(handle);
+    uint64_t length = seq_index[rank+1] - seq_index[rank];
+    char c = forward_sequence(seq_index[rank] + (get_is_reverse(handle) ? length - index - 1 : index), 1)[0];
+    return get_is_reverse(handle) ? reverse_complement(c) : c;
+}
+
+std::string mmap_graph_t::get_subsequence(const handle_t& handle, size_t index, size_t size) const {
+    uint64_t rank = number_bool_packing::unpack_number(handle);
+    uint64_t length = seq_index[rank+1] - seq_index[rank];
+    if (index >= length) return "";
+    size = std::min(size, length - index);
+    if (get_is_reverse(handle)) {
+        std::string s = forward_sequence(seq_index[rank] + length - index - size, size);
+        reverse_complement_in_place(s);
+        return s;
+    } else {
+        return forward_sequence(seq_index[rank] + index, size);
+    }
+}
+
+bool mmap_graph_t::follow_edges_impl(const handle_t& handle, bool go_left, const std::function<bool(const handle_t&)>& iteratee) const {
+    // edges on the left of a handle are the flipped edges on the right of its reverse
+    uint64_t i = as_integer(go_left ? flip(handle) : handle);
+    for (uint64_t j = edge_index[i]; j < edge_index[i+1]; ++j) {
+        const handle_t& next = as_handle(edges[j]);
+        if (!iteratee(go_left ? flip(next) : next)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool mmap_graph_t::for_each_handle_impl(const std::function<bool(const handle_t&)>& iteratee, bool parallel) const {
+    if (parallel) {
+        volatile bool flag=true;
+#pragma omp parallel for
+        for (uint64_t i = 0; i < header->node_count; ++i) {
+            if (!flag) continue;
+            bool result = iteratee(number_bool_packing::pack(i, false));
+#pragma omp atomic
+            flag &= result;
+        }
+        return flag;
+    } else {
+        for (uint64_t i = 0; i < header->node_count; ++i) {
+            if (!iteratee(number_bool_packing::pack(i, false))) return false;
+        }
+        return true;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////
+// Path handle interface
+////////////////////////////////////////////////////////////////////////////
+
+size_t mmap_graph_t::get_path_count() const {
+    return header->path_count;
+}
+
+bool mmap_graph_t::has_path(const std::string& path_name) const {
+    const uint64_t* end = path_name_order + header->path_count;
+    const uint64_t* it = std::lower_bound(
+        path_name_order, end, path_name,
+        [&](const uint64_t& rank, const std::string& name) {
+            return path_name_view(rank) < std::string_view(name);
+        });
+    return it != end && path_name_view(*it) == path_name;
+}
+
+path_handle_t mmap_graph_t::get_path_handle(const std::string& path_name) const {
+    const uint64_t* end = path_name_order + header->path_count;
+    const uint64_t* it = std::lower_bound(
+        path_name_order, end, path_name,
+        [&](const uint64_t& rank, const std::string& name) {
+            return path_name_view(rank) < std::string_view(name);
+        });
+    assert(it != end && path_name_view(*it) == path_name);
+    return as_path_handle(*it + 1);
+}
+
+std::string mmap_graph_t::get_path_name(const path_handle_t& path_handle) const {
+    return std::string(path_name_view(path_rank(path_handle)));
+}
+
+bool mmap_graph_t::get_is_circular(const path_handle_t& path_handle) const {
+    return path_circular[path_rank(path_handle)];
+}
+
+size_t mmap_graph_t::get_step_count(const path_handle_t& path_handle) const {
+    uint64_t rank = path_rank(path_handle);
+    return path_step_index[rank+1] - path_step_index[rank];
+}
+
+size_t mmap_graph_t::get_step_count(const handle_t& handle) const {
+    uint64_t rank = number_bool_packing::unpack_number(handle);
+    return node_step_index[rank+1] - node_step_index[rank];
+}
+
+handle_t mmap_graph_t::get_handle_of_step(const step_handle_t& step_handle) const {
+    return as_handle(path_steps[path_step_index[as_integers(step_handle)[0] - 1] + as_integers(step_handle)[1]]);
+}
+
+path_handle_t mmap_graph_t::get_path_handle_of_step(const step_handle_t& step_handle) const {
+    return as_path_handle(as_integers(step_handle)[0]);
+}
+
+step_handle_t mmap_graph_t::path_begin(const path_handle_t& path_handle) const {
+    return make_step(path_rank(path_handle), 0);
+}
+
+step_handle_t mmap_graph_t::path_end(const path_handle_t& path_handle) const {
+    return make_step(path_rank(path_handle), get_step_count(path_handle));
+}
+
+step_handle_t mmap_graph_t::path_back(const path_handle_t& path_handle) const {
+    return make_step(path_rank(path_handle), get_step_count(path_handle) - 1);
+}
+
+step_handle_t mmap_graph_t::path_front_end(const path_handle_t& path_handle) const {
+    return make_step(path_rank(path_handle), std::numeric_limits<uint64_t>::max());
+}
+
+bool mmap_graph_t::has_next_step(const step_handle_t& step_handle) const {
+    path_handle_t path = get_path_handle_of_step(step_handle);
+    uint64_t rank = as_integers(step_handle)[1];
+    uint64_t count = get_step_count(path);
+    return rank + 1 < count || (rank + 1 == count && get_is_circular(path));
+}
+
+bool mmap_graph_t::has_previous_step(const step_handle_t& step_handle) const {
+    path_handle_t path = get_path_handle_of_step(step_handle);
+    uint64_t rank = as_integers(step_handle)[1];
+    uint64_t count = get_step_count(path);
+    return (rank > 0 && rank <= count) || (rank == 0 && count && get_is_circular(path));
+}
+
+step_handle_t mmap_graph_t::get_next_step(const step_handle_t& step_handle) const {
+    path_handle_t path = get_path_handle_of_step(step_handle);
+    uint64_t p_rank = path_rank(path);
+    uint64_t rank = as_integers(step_handle)[1];
+    uint64_t count = get_step_count(path);
+    if (rank == std::numeric_limits<uint64_t>::max()) {
+        return make_step(p_rank, 0);
+    } else if (rank + 1 < count) {
+        return make_step(p_rank, rank + 1);
+    } else if (rank + 1 == count && get_is_circular(path)) {
+        return make_step(p_rank, 0);
+    } else {
+        return path_end(path);
+    }
+}
+
+step_handle_t mmap_graph_t::get_previous_step(const step_handle_t& step_handle) const {
+    path_handle_t path = get_path_handle_of_step(step_handle);
+    uint64_t p_rank = path_rank(path);
+    uint64_t rank = as_integers(step_handle)[1];
+    uint64_t count = get_step_count(path);
+    if (rank == std::numeric_limits<uint64_t>::max()) {
+        return step_handle;
+    } else if (rank > 0) {
+        return make_step(p_rank, rank - 1);
+    } else if (count && get_is_circular(path)) {
+        return make_step(p_rank, count - 1);
+    } else {
+        return path_front_end(path);
+    }
+}
+
+size_t mmap_graph_t::get_ordinal_rank_of_step(const step_handle_t& step_handle) const {
+    return as_integers(step_handle)[1];
+}
+
+bool mmap_graph_t::for_each_path_handle_impl(const std::function<bool(const path_handle_t&)>& iteratee) const {
+    for (uint64_t i = 0; i < header->path_count; ++i) {
+        if (!iteratee(as_path_handle(i + 1))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool mmap_graph_t::for_each_step_on_handle_impl(const handle_t& handle, const std::function<bool(const step_handle_t&)>& iteratee) const {
+    uint64_t rank = number_bool_packing::unpack_number(handle);
+    for (uint64_t j = node_step_index[rank]; j < node_step_index[rank+1]; ++j) {
+        if (!iteratee(make_step(node_steps[2*j], node_steps[2*j+1]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,288 @@
+//
+//  odgi
+//
+//  mmap_graph.hpp
+//
+//  immutable, memory-mappable graph layout and a read-only view over it
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <limits>
+#include <vector>
+#include <functional>
+#include <iostream>
+#include <handlegraph/types.hpp>
+#include <handlegraph/iteratee.hpp>
+#include <handlegraph/util.hpp>
+#include <handlegraph/handle_graph.hpp>
+#include <handlegraph/path_handle_graph.hpp>
+#include <mio/mmap.hpp>
+#include <omp.h>
+#include "odgi.hpp"
+
+namespace odgi {
+
+using namespace handlegraph;
+
+/// A read-only graph backed by a memory-mapped file.
+/// The file is a flat, 8-byte aligned CSR layout of sequences, edges, and path steps,
+/// so loading is a single mmap and concurrent jobs share the page cache.
+/// Sequences are 2-bit packed in one buffer, with the bases other than ACGT listed aside.
+/// Node ranks follow the iteration order of the graph that was frozen.
+/// Handles are the node rank packed with the orientation bit.
+/// Step handles hold the path handle and the 0-based rank of the step on its path.
+class mmap_graph_t : public PathHandleGraph {
+
+public:
+
+    mmap_graph_t(void) = default;
+    ~mmap_graph_t(void) { unmap(); }
+
+    /// Write the given graph in the memory-mappable layout
+    static void freeze(const graph_t& graph, std::ostream& out);
+
+    /// Freeze the graph into a new POSIX shared memory segment with the given name,
+    /// so that other processes on the host can attach it as "shm:NAME"
+    static void share(const graph_t& graph, const std::string& name);
+
+    /// Remove the named shared memory segment; processes that attached it keep their mapping
+    static bool unshare(const std::string& name);
+
+    /// Check if the file, or the "shm:NAME" segment, starts with the layout's magic number
+    static bool is_mmap_graph(const std::string& filename);
+
+    /// Map the given file, or attach the "shm:NAME" segment, which must have been written with freeze()
+    void load(const std::string& filename);
+
+    /// Release the mapping
+    void unmap(void);
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Handle graph interface
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// Method to check if a node exists by ID
+    bool has_node(nid_t node_id) const;
+
+    /// Look up the handle for the node with the given ID in the given orientation
+    handle_t get_handle(const nid_t& node_id, bool is_reverse = false) const;
+
+    /// Get the ID from a handle
+    nid_t get_id(const handle_t& handle) const;
+
+    /// Get the orientation of a handle
+    bool get_is_reverse(const handle_t& handle) const;
+
+    /// Invert the orientation of a handle (potentially without getting its ID)
+    handle_t flip(const handle_t& handle) const;
+
+    /// Get the length of a node
+    size_t get_length(const handle_t& handle) const;
+
+    /// Get the sequence of a node, presented in the handle's local forward orientation.
+    std::string get_sequence(const handle_t& handle) const;
+
+    /// Return the number of nodes in the graph
+    size_t get_node_count(void) const;
+
+    /// Return the smallest ID in the graph
+    nid_t min_node_id(void) const;
+
+    /// Return the largest ID in the graph
+    nid_t max_node_id(void) const;
+
+    /// Get the number of edges on the right (go_left = false) or left (go_left
+    /// = true) side of the given handle in constant time.
+    size_t get_degree(const handle_t& handle, bool go_left) const;
+
+    /// Check if an edge exists
+    bool has_edge(const handle_t& left, const handle_t& right) const;
+
+    /// Return the total number of edges in the graph
+    size_t get_edge_count(void) const;
+
+    /// Return the total length of all node sequences
+    size_t get_total_length(void) const;
+
+    /// Returns one base of a handle's sequence, in the orientation of the handle
+    char get_base(const handle_t& handle, size_t index) const;
+
+    /// Returns a substring of a handle's sequence, in the orientation of the handle
+    std::string get_subsequence(const handle_t& handle, size_t index, size_t size) const;
+
+    /// Append the sequence of a handle, in its orientation, to out
+    void append_sequence(const handle_t& handle, std::string& out) const;
+
+protected:
+
+    /// Loop over all the handles to next/previous (right/left) nodes. Passes
+    /// them to a callback which returns false to stop iterating and true to
+    /// continue. Returns true if we finished and false if we stopped early.
+    bool follow_edges_impl(const handle_t& handle, bool go_left, const std::function<bool(const handle_t&)>& iteratee) const;
+
+    /// Loop over all the nodes in the graph in their local forward
+    /// orientations, in their internal stored order. Stop if the iteratee
+    /// returns false. Can be told to run in parallel, in which case stopping
+    /// after a false return value is on a best-effort basis and iteration
+    /// order is not defined.
+    bool for_each_handle_impl(const std::function<bool(const handle_t&)>& iteratee, bool parallel = false) const;
+
+public:
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Path handle interface
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// Returns the number of paths stored in the graph
+    size_t get_path_count(void) const;
+
+    /// Determine if a path name exists and is legal to get a path handle for.
+    bool has_path(const std::string& path_name) const;
+
+    /// Look up the path handle for the given path name.
+    /// The path with that name must exist.
+    path_handle_t get_path_handle(const std::string& path_name) const;
+
+    /// Look up the name of a path from a handle to it
+    std::string get_path_name(const path_handle_t& path_handle) const;
+
+    /// Returns true if the path is circular
+    bool get_is_circular(const path_handle_t& path_handle) const;
+
+    /// Returns the number of node steps in the path
+    size_t get_step_count(const path_handle_t& path_handle) const;
+
+    /// Returns the number of node steps on the handle
+    size_t get_step_count(const handle_t& handle) const;
+
+    /// Get a node handle (node ID and orientation) from a handle to an step on a path
+    handle_t get_handle_of_step(const step_handle_t& step_handle) const;
+
+    /// Returns a handle to the path that an step is on
+    path_handle_t get_path_handle_of_step(const step_handle_t& step_handle) const;
+
+    /// Get a handle to the first step in a path.
+    step_handle_t path_begin(const path_handle_t& path_handle) const;
+
+    /// Get a handle to a fictitious handle one past the end of the path
+    step_handle_t path_end(const path_handle_t& path_handle) const;
+
+    /// Get a handle to the last step, which is arbitrary in the case of a circular path
+    step_handle_t path_back(const path_handle_t& path_handle) const;
+
+    /// Get a handle to a fictitious handle one past the start of the path
+    step_handle_t path_front_end(const path_handle_t& path_handle) const;
+
+    /// Returns true if the step is not the last step on the path, else false
+    bool has_next_step(const step_handle_t& step_handle) const;
+
+    /// Returns true if the step is not the first step on the path, else false
+    bool has_previous_step(const step_handle_t& step_handle) const;
+
+    /// Returns a handle to the next step on the path
+    step_handle_t get_next_step(const step_handle_t& step_handle) const;
+
+    /// Returns a handle to the previous step on the path
+    step_handle_t get_previous_step(const step_handle_t& step_handle) const;
+
+    /// Returns the 0-based ordinal rank of a step on a path
+    size_t get_ordinal_rank_of_step(const step_handle_t& step_handle) const;
+
+protected:
+
+    /// Execute a function on each path in the graph
+    bool for_each_path_handle_impl(const std::function<bool(const path_handle_t&)>& iteratee) const;
+
+    /// Enumerate the path steps on a given handle (strand agnostic)
+    bool for_each_step_on_handle_impl(const handle_t& handle, const std::function<bool(const step_handle_t&)>& iteratee) const;
+
+public:
+
+    /// Magic number at the start of the file ("odgimmap")
+    static const uint64_t MAGIC = 0x70616d6d6967646full;
+    /// Layout version, bump on incompatible changes
+    static const uint64_t VERSION = 2;
+
+    /// On-disk header, all offsets are in bytes from the start of the file
+    struct header_t {
+        uint64_t magic;
+        uint64_t version;
+        uint64_t node_count;
+        uint64_t edge_count;
+        uint64_t path_count;
+        uint64_t step_count;
+        uint64_t min_id;
+        uint64_t max_id;
+        uint64_t seq_length;
+        uint64_t name_length;
+        uint64_t ids_offset;             // node_count node ids, by rank
+        uint64_t id_to_rank_offset;      // max_id-min_id+1 ranks, UINT64_MAX marks gaps
+        uint64_t seq_index_offset;       // node_count+1 sequence offsets
+        uint64_t seq_offset;             // seq_length 2-bit codes, 32 per word
+        uint64_t edge_index_offset;      // 2*node_count+1 offsets, by oriented handle
+        uint64_t edge_offset;            // handles to the right of each oriented handle
+        uint64_t path_step_index_offset; // path_count+1 offsets into the path steps
+        uint64_t path_name_index_offset; // path_count+1 offsets into the path names
+        uint64_t path_name_offset;       // name_length characters
+        uint64_t path_name_order_offset; // path_count path ranks sorted by name
+        uint64_t path_circular_offset;   // path_count flags
+        uint64_t path_steps_offset;      // step_count handles
+        uint64_t node_step_index_offset; // node_count+1 offsets into the node steps
+        uint64_t node_steps_offset;      // step_count (path rank, step rank) pairs
+        uint64_t seq_exception_count;
+        uint64_t seq_exception_offset;   // sorted (position << 8 | base) for bases other than ACGT
+    };
+
+private:
+
+    mio::mmap_source buffer;
+    const header_t* header = nullptr;
+    const uint64_t* ids = nullptr;
+    const uint64_t* id_to_rank = nullptr;
+    const uint64_t* seq_index = nullptr;
+    const uint64_t* seq_words = nullptr;
+    const uint64_t* seq_exceptions = nullptr;
+    const uint64_t* edge_index = nullptr;
+    const uint64_t* edges = nullptr;
+    const uint64_t* path_step_index = nullptr;
+    const uint64_t* path_name_index = nullptr;
+    const char* path_names = nullptr;
+    const uint64_t* path_name_order = nullptr;
+    const uint64_t* path_circular = nullptr;
+    const uint64_t* path_steps = nullptr;
+    const uint64_t* node_step_index = nullptr;
+    const uint64_t* node_steps = nullptr;
+
+    /// Marker for ids that are not in the graph
+    static const uint64_t NO_RANK = std::numeric_limits<uint64_t>::max();
+
+    inline uint64_t path_rank(const path_handle_t& path) const {
+        return as_integer(path) - 1;
+    }
+    inline std::string_view path_name_view(uint64_t rank) const {
+        return std::string_view(path_names + path_name_index[rank],
+                                path_name_index[rank+1] - path_name_index[rank]);
+    }
+    inline step_handle_t make_step(uint64_t p_rank, uint64_t s_rank) const {
+        step_handle_t step;
+        as_integers(step)[0] = p_rank + 1;
+        as_integers(step)[1] = s_rank;
+        return step;
+    }
+    /// Decode the forward bases in [pos, pos+length) of the packed sequence buffer
+    std::string forward_sequence(uint64_t pos, uint64_t length) const;
+    void append_forward_sequence(std::string& out, uint64_t pos, uint64_t length) const;
+    /// Check the header of the mapped buffer and point the sections into it
+    void attach(const std::string& filename);
+    template<typename T>
+    inline const T* at_offset(uint64_t offset) const {
+        return reinterpret_cast<const T*>(buffer.data() + offset);
+    }
+
+};
+
+}
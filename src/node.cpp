@@ -1,4 +1,5 @@
 #include "node.hpp"
+#include <algorithm>
 
 namespace odgi {
 
@@ -7,7 +8,7 @@ uint64_t node_t::sequence_size() const {
 }
 
 void node_t::set_sequence(const std::string& seq) {
-    sequence = seq;
+    sequence.assign(seq);
 }
 
 void node_t::set_id(const uint64_t& new_id) {
@@ -18,8 +19,24 @@ const uint64_t& node_t::get_id() const {
     return id;
 }
 
-const std::string& node_t::get_sequence() const {
-    return sequence;
+std::string node_t::get_sequence() const {
+    return sequence.str();
+}
+
+char node_t::get_base(const uint64_t& offset) const {
+    return sequence.at(offset);
+}
+
+bool node_t::has_exception_run(const char& c) const {
+    return sequence.has_exception_run(c);
+}
+
+void node_t::append_sequence(std::string& out, const uint64_t& offset, const uint64_t& length) const {
+    sequence.append_to(out, offset, length);
+}
+
+void node_t::copy_sequence(char* out, const uint64_t& offset, const uint64_t& length) const {
+    sequence.copy_to(out, offset, length);
 }
 
 // encode an internal representation of an external id (adding if none exists)
@@ -41,18 +58,40 @@ uint64_t node_t::decode(const uint64_t& idx) const {
     return from_delta(decoding.at(idx));
 }
 
+void node_t::decode_edges(const uint64_t& begin, const uint64_t& end,
+                          uint64_t* other_ids, bool* other_rev, bool* to_curr, bool* on_rev) const {
+    for (uint64_t i = begin, j = EDGE_RECORD_LENGTH*begin; i < end; ++i, j += EDGE_RECORD_LENGTH) {
+        *other_ids++ = edges.at(j);
+        const uint8_t packed_edge = edges.at(j+1);
+        *other_rev++ = edge_helper::unpack_other_rev(packed_edge);
+        *to_curr++ = edge_helper::unpack_to_curr(packed_edge);
+        *on_rev++ = edge_helper::unpack_on_rev(packed_edge);
+    }
+}
+
+void node_t::decode_step_flags(const uint64_t& begin, const uint64_t& end,
+                               bool* is_rev, bool* is_del) const {
+    for (uint64_t i = begin, j = PATH_RECORD_LENGTH*begin+1; i < end; ++i, j += PATH_RECORD_LENGTH) {
+        const uint8_t type = paths.at(j);
+        *is_rev++ = step_type_helper::unpack_is_rev(type);
+        *is_del++ = step_type_helper::unpack_is_del(type);
+    }
+}
+
 void node_t::for_each_edge(const std::function<bool(uint64_t other_id,
                                                     bool other_rev,
                                                     bool to_curr,
                                                     bool on_rev)>& func) const {
-    for (uint64_t i = 0; i < edges.size(); ) {
-        uint64_t other_id = edges.at(i++);
-        uint8_t packed_edge = edges.at(i++);
-        if (!func(other_id,
-                  edge_helper::unpack_other_rev(packed_edge),
-                  edge_helper::unpack_to_curr(packed_edge),
-                  edge_helper::unpack_on_rev(packed_edge))) {
-            break;
+    uint64_t other_ids[RECORD_DECODE_BLOCK];
+    bool other_rev[RECORD_DECODE_BLOCK], to_curr[RECORD_DECODE_BLOCK], on_rev[RECORD_DECODE_BLOCK];
+    const uint64_t n_edges = edge_count();
+    for (uint64_t begin = 0; begin < n_edges; begin += RECORD_DECODE_BLOCK) {
+        const uint64_t end = std::min(begin + RECORD_DECODE_BLOCK, n_edges);
+        decode_edges(begin, end, other_ids, other_rev, to_curr, on_rev);
+        for (uint64_t k = 0; k < end - begin; ++k) {
+            if (!func(other_ids[k], other_rev[k], to_curr[k], on_rev[k])) {
+                return;
+            }
         }
     }
 }
@@ -65,6 +104,68 @@ void node_t::add_edge(const uint64_t& other_id,
     auto edge_type = edge_helper::pack(other_rev, to_curr, on_rev);
     edges.push_back(other_id);
     edges.push_back(edge_type);
+    if (edge_index) {
+        index_edge(edge_key(other_id, other_rev, to_curr, on_rev));
+    } else if (edge_count() >= HUB_EDGE_COUNT) {
+        reindex_edges();
+    }
+}
+
+void node_t::index_edge(const uint64_t& key) {
+    auto& index = *edge_index;
+    index.keys.push_back(key);
+    ++index.side_count[key & 1];
+    // merging in a tail that grows with the sorted part keeps both the merges and the scans of the tail cheap
+    if (index.keys.size() - index.sorted > 64 + (index.sorted >> 8)) {
+        std::sort(index.keys.begin() + index.sorted, index.keys.end());
+        std::inplace_merge(index.keys.begin(), index.keys.begin() + index.sorted, index.keys.end());
+        index.sorted = index.keys.size();
+    }
+}
+
+void node_t::unindex_edge(const uint64_t& key) {
+    auto& index = *edge_index;
+    auto tail = std::find(index.keys.begin() + index.sorted, index.keys.end(), key);
+    if (tail != index.keys.end()) {
+        index.keys.erase(tail);
+    } else {
+        auto it = std::lower_bound(index.keys.begin(), index.keys.begin() + index.sorted, key);
+        if (it == index.keys.begin() + index.sorted || *it != key) return;
+        index.keys.erase(it);
+        --index.sorted;
+    }
+    --index.side_count[key & 1];
+}
+
+void node_t::reindex_edges(void) {
+    const uint64_t n_edges = edge_count();
+    if (n_edges < HUB_EDGE_COUNT) {
+        edge_index.reset();
+        return;
+    }
+    if (!edge_index) {
+        edge_index = std::make_unique<edge_index_t>();
+    }
+    auto& index = *edge_index;
+    index.keys.clear();
+    index.keys.reserve(n_edges);
+    index.side_count[0] = index.side_count[1] = 0;
+    for_each_edge([&](uint64_t other_id, bool other_rev, bool to_curr, bool on_rev) {
+        const uint64_t key = edge_key(other_id, other_rev, to_curr, on_rev);
+        index.keys.push_back(key);
+        ++index.side_count[key & 1];
+        return true;
+    });
+    std::sort(index.keys.begin(), index.keys.end());
+    index.sorted = index.keys.size();
+}
+
+uint64_t node_t::count_indexed_edges(const uint64_t& other_id, const bool& other_rev, const bool& on_left) const {
+    const auto& index = *edge_index;
+    const uint64_t key = (other_id << 2) | (other_rev << 1) | on_left;
+    const auto sorted_end = index.keys.begin() + index.sorted;
+    const auto range = std::equal_range(index.keys.begin(), sorted_end, key);
+    return (range.second - range.first) + std::count(sorted_end, index.keys.end(), key);
 }
 
 bool node_t::remove_edge(const uint64_t& target_id,
@@ -86,6 +187,11 @@ bool node_t::remove_edge(const uint64_t& target_id,
                 && to_curr == ends_here) {
                 edges.remove(i);
                 edges.remove(i);
+                if (edge_index) {
+                    unindex_edge(edge_key(other_id, edge_helper::unpack_other_rev(packed_edge),
+                                          edge_helper::unpack_to_curr(packed_edge),
+                                          edge_helper::unpack_on_rev(packed_edge)));
+                }
                 return true;
             }
         }
@@ -93,6 +199,32 @@ bool node_t::remove_edge(const uint64_t& target_id,
     return false;
 }
 
+uint64_t node_t::remove_edges_if(const std::function<bool(uint64_t other_id,
+                                                          bool other_rev,
+                                                          bool to_curr,
+                                                          bool on_rev)>& drop) {
+    dyn::hacked_vector kept_edges;
+    uint64_t removed = 0;
+    for (uint64_t i = 0; i < edges.size(); i+=EDGE_RECORD_LENGTH) {
+        const uint64_t other_id = edges.at(i);
+        const uint8_t packed_edge = edges.at(i+1);
+        if (drop(other_id,
+                 edge_helper::unpack_other_rev(packed_edge),
+                 edge_helper::unpack_to_curr(packed_edge),
+                 edge_helper::unpack_on_rev(packed_edge))) {
+            ++removed;
+        } else {
+            kept_edges.push_back(other_id);
+            kept_edges.push_back(packed_edge);
+        }
+    }
+    if (removed) {
+        edges = kept_edges;
+        reindex_edges();
+    }
+    return removed;
+}
+
 void node_t::add_path_step(const uint64_t& path_id, const bool& is_rev,
                            const bool& is_start, const bool& is_end,
                            const uint64_t& prev_id, const uint64_t& prev_rank,
@@ -149,10 +281,15 @@ void node_t::for_each_path_step(
     const std::function<bool(uint64_t rank,
                              uint64_t path_id,
                              bool is_rev)>& func) const {
-    uint64_t n_paths = path_count();
-    for (uint64_t i = 0; i < n_paths; ++i) {
-        if (!step_is_del(i) && !func(i, paths.at(PATH_RECORD_LENGTH*i), step_is_rev(i))) {
-            break;
+    bool is_rev[RECORD_DECODE_BLOCK], is_del[RECORD_DECODE_BLOCK];
+    const uint64_t n_paths = path_count();
+    for (uint64_t begin = 0; begin < n_paths; begin += RECORD_DECODE_BLOCK) {
+        const uint64_t end = std::min(begin + RECORD_DECODE_BLOCK, n_paths);
+        decode_step_flags(begin, end, is_rev, is_del);
+        for (uint64_t i = begin; i < end; ++i) {
+            if (!is_del[i-begin] && !func(i, paths.at(PATH_RECORD_LENGTH*i), is_rev[i-begin])) {
+                return;
+            }
         }
     }
 }
@@ -318,6 +455,7 @@ void node_t::clear() {
 void node_t::clear_edges() {
     dyn::hacked_vector null_iv;
     edges = null_iv;
+    edge_index.reset();
 }
 
 void node_t::clear_paths() {
@@ -337,6 +475,19 @@ void node_t::copy(const node_t& other) {
     edges = other.edges;
     decoding = other.decoding;
     paths = other.paths;
+    reindex_edges();
+}
+
+void node_t::take(node_t& other) {
+    clear();
+    id = other.id;
+    generation = other.generation;
+    sequence.swap(other.sequence);
+    std::swap(edges, other.edges);
+    std::swap(edge_index, other.edge_index);
+    std::swap(decoding, other.decoding);
+    std::swap(paths, other.paths);
+    other.clear();
 }
 
 void node_t::apply_ordering(
@@ -345,7 +496,7 @@ void node_t::apply_ordering(
     // flip the node sequence if needed
     bool flip = to_flip(id);
     if (flip) {
-        reverse_complement_in_place(sequence);
+        sequence.reverse_complement();
     }
     // rewrite the encoding (affects path storage)
     std::vector<uint64_t> dec_v;
@@ -403,6 +554,7 @@ void node_t::apply_ordering(
             return true;
         });
     edges = new_edges;
+    reindex_edges();
 }
 
 void node_t::apply_path_ordering(
@@ -419,10 +571,12 @@ void node_t::apply_path_ordering(
 
 uint64_t node_t::serialize(std::ostream& out) const {
     uint64_t written = 0;
-    size_t seq_size = sequence.size();
+    // sequences are written unpacked, which keeps the record layout independent of the in-memory encoding
+    const std::string seq = sequence.str();
+    size_t seq_size = seq.size();
     out.write((char*)&seq_size, sizeof(size_t));
     written += sizeof(size_t);
-    out.write((char*)sequence.c_str(), seq_size*sizeof(char));
+    out.write((char*)seq.c_str(), seq_size*sizeof(char));
     written += seq_size*sizeof(char);
     out.write((char*)&id, sizeof(id));
     written += sizeof(id);
@@ -432,20 +586,44 @@ uint64_t node_t::serialize(std::ostream& out) const {
     return written;
 }
 
-void node_t::load(std::istream& in) {
+node_t::footprint_t node_t::footprint(void) const {
+    footprint_t f;
+    f.sequence = sequence.memory_bytes();
+    f.edges = edges.bit_size() / 8 + decoding.bit_size() / 8
+        + (edge_index ? sizeof(edge_index_t) + edge_index->keys.capacity() * sizeof(uint64_t) : 0);
+    f.paths = paths.bit_size() / 8;
+    // the vectors give the bytes they write; a stream without a buffer takes none of them
+    std::ostream sink(nullptr);
+    f.serialized_sequence = sizeof(size_t) + sequence.size() + sizeof(id);
+    f.serialized_edges = edges.serialize(sink) + decoding.serialize(sink);
+    f.serialized_paths = paths.serialize(sink);
+    return f;
+}
+
+void node_t::load(std::istream& in, const bool& with_paths) {
     size_t len = 0;
     in.read((char*)&len, sizeof(size_t));
-    sequence.resize(len);
-    in.read((char*)sequence.c_str(), len*sizeof(uint8_t));
+    load(in, len, with_paths);
+}
+
+void node_t::load(std::istream& in, size_t len, const bool& with_paths) {
+    std::string seq(len, '\0');
+    in.read((char*)seq.c_str(), len*sizeof(uint8_t));
+    sequence.assign(seq);
     in.read((char*)&id, sizeof(id));
     edges.load(in);
+    reindex_edges();
     decoding.load(in); 
-    paths.load(in);
+    if (with_paths) {
+        paths.load(in);
+    } else {
+        clear_paths();
+    }
     //display();
 }
 
 void node_t::display() const {
-    std::cerr << "seq " << sequence << " "
+    std::cerr << "seq " << sequence.str() << " "
               << "edge_count " << edge_count() << " "
               << "path_count " << path_count();
     std::cerr << " | ";
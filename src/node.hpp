@@ -10,10 +10,12 @@
 #include <cstring>
 #include <cassert>
 #include <atomic>
+#include <memory>
 // #include "bmap.hpp"
 #include "dynamic.hpp"
 #include "varint.hpp"
 #include "dna.hpp"
+#include "packed_sequence.hpp"
 
 namespace odgi {
 
@@ -21,15 +23,40 @@ using namespace handlegraph;
 //using nid_t = handlegraph::nid_t;
 const uint8_t EDGE_RECORD_LENGTH = 2;
 const uint8_t PATH_RECORD_LENGTH = 6;
+/// Number of edge or step records decoded at once by the record visitors
+const uint64_t RECORD_DECODE_BLOCK = 256;
+/// Number of edge records from which a node keeps its edges indexed by side, see node_t::edge_index_t
+const uint64_t HUB_EDGE_COUNT = 128;
 
 /// A node object with the sequence, its edge lists, and paths
 class node_t {
     uint64_t id = 0;
     std::atomic_flag lock = ATOMIC_FLAG_INIT;
-    std::string sequence;
+    /// snapshot generation of the graph when this record was written, see graph_t::snapshot
+    uint32_t generation = 0;
+    packed_sequence_t sequence;
     dyn::hacked_vector edges;
     dyn::hacked_vector decoding;
     dyn::hacked_vector paths;
+    /// The edges of a hub node as sorted keys, so that degrees and edge lookups do not decode the whole
+    /// edge list. New keys go to an unsorted tail, merged in once it outgrows a small share of the rest.
+    /// Only nodes with at least HUB_EDGE_COUNT edge records have one; it is rebuilt from the records when
+    /// they are rewritten, and is never serialized.
+    struct edge_index_t {
+        std::vector<uint64_t> keys;
+        uint64_t sorted = 0;
+        uint64_t side_count[2] = {0, 0};
+    };
+    std::unique_ptr<edge_index_t> edge_index;
+    /// the key of an edge record, with its orientations read from the forward strand of this node
+    inline static uint64_t edge_key(const uint64_t& other_id, const bool& other_rev,
+                                    const bool& to_curr, const bool& on_rev) {
+        return (other_id << 2) | ((other_rev ^ on_rev) << 1) | (to_curr ^ on_rev);
+    }
+    void index_edge(const uint64_t& key);
+    void unindex_edge(const uint64_t& key);
+    /// rebuild the edge index from the edge records, dropping it if the node is no longer a hub
+    void reindex_edges(void);
     // relativistic conversions
     inline uint64_t to_delta(const uint64_t& other_id) const {
         if (other_id > id) {
@@ -93,8 +120,28 @@ public:
     inline void clear_lock(void) {
         lock.clear(std::memory_order_release);
     }
+    inline const uint32_t& get_generation(void) const { return generation; }
+    inline void set_generation(const uint32_t& g) { generation = g; }
     inline const uint64_t edge_count(void) const { return edges.size()/EDGE_RECORD_LENGTH; }
     inline const uint64_t path_count(void) const { return paths.size()/PATH_RECORD_LENGTH; }
+    /// whether the edges are indexed by side, which is the case for hub nodes
+    inline bool has_edge_index(void) const { return edge_index != nullptr; }
+    /// with an edge index, the number of edge records on the left (on_left) or right side of the forward strand
+    inline uint64_t side_edge_count(const bool& on_left) const { return edge_index->side_count[on_left]; }
+    /// with an edge index, the number of edge records to other_id, in orientation other_rev, on the left
+    /// (on_left) or right side, with both orientations read from the forward strand of this node
+    uint64_t count_indexed_edges(const uint64_t& other_id, const bool& other_rev, const bool& on_left) const;
+    /// The bytes of the sequence, the edge records with their index, and the path steps of the node, on the
+    /// heap and in its serialized record
+    struct footprint_t {
+        uint64_t sequence = 0;
+        uint64_t edges = 0;
+        uint64_t paths = 0;
+        uint64_t serialized_sequence = 0;
+        uint64_t serialized_edges = 0;
+        uint64_t serialized_paths = 0;
+    };
+    footprint_t footprint(void) const;
     struct step_t {
         uint64_t path_id;
         bool is_rev;
@@ -110,10 +157,25 @@ public:
     uint64_t decode(const uint64_t& idx) const;
 
     uint64_t sequence_size(void) const;
-    const std::string& get_sequence(void) const;
+    std::string get_sequence(void) const;
     void set_sequence(const std::string& seq);
+    /// the forward base at the given offset
+    char get_base(const uint64_t& offset) const;
+    /// whether the sequence has a run of at least two of the base c; c must not be one of ACGT
+    bool has_exception_run(const char& c) const;
+    /// append the forward bases in [offset, offset+length) to out
+    void append_sequence(std::string& out, const uint64_t& offset, const uint64_t& length) const;
+    /// write the forward bases in [offset, offset+length) to out, which must hold length chars
+    void copy_sequence(char* out, const uint64_t& offset, const uint64_t& length) const;
     const uint64_t& get_id(void) const;
     void set_id(const uint64_t& new_id);
+    /// Decode the edges in [begin, end) into the given arrays, reading each record field once
+    void decode_edges(const uint64_t& begin, const uint64_t& end,
+                      uint64_t* other_ids, bool* other_rev, bool* to_curr, bool* on_rev) const;
+    /// Decode the orientation and deletion flags of the steps in [begin, end) into the given arrays,
+    /// without reading the other fields of the step records
+    void decode_step_flags(const uint64_t& begin, const uint64_t& end,
+                           bool* is_rev, bool* is_del) const;
     void for_each_edge(const std::function<bool(uint64_t other_id,
                                                 bool on_rev,
                                                 bool other_rev,
@@ -126,6 +188,12 @@ public:
                      const bool& target_rev,
                      const bool& ends_here,
                      const bool& is_rev);
+    /// remove, in one pass over the edge list, the edge records for which drop holds, returning how many were
+    /// removed; drop sees the records as for_each_edge does
+    uint64_t remove_edges_if(const std::function<bool(uint64_t other_id,
+                                                      bool other_rev,
+                                                      bool to_curr,
+                                                      bool on_rev)>& drop);
     void add_path_step(const uint64_t& path_id, const bool& is_rev,
                        const bool& is_start, const bool& is_end,
                        const uint64_t& prev_id, const uint64_t& prev_rank,
@@ -170,9 +238,14 @@ public:
     void clear_paths(void);
     void clear_encoding(void);
     uint64_t serialize(std::ostream& out) const;
-    void load(std::istream& in);
+    /// without paths, the path steps that end the record are not read
+    void load(std::istream& in, const bool& with_paths = true);
+    /// load a record whose leading sequence length has already been read
+    void load(std::istream& in, size_t seq_size, const bool& with_paths = true);
     void display(void) const;
     void copy(const node_t& other);
+    /// move the contents of the other node into this one, leaving it empty
+    void take(node_t& other);
     void apply_ordering(
         const std::function<uint64_t(uint64_t)>& get_new_id,
         const std::function<bool(uint64_t)>& to_flip);
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <new>
+#include "node.hpp"
+
+namespace odgi {
+
+/// A slab allocator for the nodes of one graph.
+/// Nodes are carved out of slabs of slab_size records and released ones are reused,
+/// so building and chopping do not hit the general heap once per node.
+/// Not thread-safe, like node creation in graph_t.
+class node_pool_t {
+public:
+
+    /// Counters to check how node storage behaves
+    struct stats_t {
+        uint64_t slabs = 0;       // slabs currently held
+        uint64_t allocated = 0;   // nodes handed out
+        uint64_t reused = 0;      // of which came from the free list
+        uint64_t released = 0;    // nodes given back
+        uint64_t compactions = 0; // calls to compact()
+        uint64_t live(void) const { return allocated - released; }
+    };
+
+    node_pool_t(void) = default;
+    node_pool_t(const node_pool_t& other) = delete;
+    node_pool_t& operator=(const node_pool_t& other) = delete;
+    ~node_pool_t(void) { free_slabs(slabs); }
+
+    /// Construct a new empty node
+    node_t* allocate(void) {
+        ++counters.allocated;
+        node_t* slot;
+        if (!free_list.empty()) {
+            ++counters.reused;
+            slot = free_list.back();
+            free_list.pop_back();
+        } else {
+            if (slabs.empty() || slab_used == slab_size) {
+                slabs.push_back(static_cast<node_t*>(::operator new(sizeof(node_t) * slab_size)));
+                ++counters.slabs;
+                slab_used = 0;
+            }
+            slot = slabs.back() + slab_used++;
+        }
+        return new (slot) node_t();
+    }
+
+    /// Destroy a node and make its slot available again
+    void release(node_t* node) {
+        if (node == nullptr) return;
+        ++counters.released;
+        node->~node_t();
+        free_list.push_back(node);
+    }
+
+    /// Move the given nodes, in order, into fresh contiguous slabs and drop the old ones.
+    /// The vector is updated in place and null entries are kept. Every live node of
+    /// the pool must be in the vector, all outstanding pointers are invalidated.
+    /// The nodes are moved with the given number of threads, handing over their edge,
+    /// path and sequence storage, so only the fixed-size records exist twice meanwhile.
+    void compact(std::vector<node_t*>& nodes, const uint64_t& nthreads = 1) {
+        std::vector<node_t*> old_slabs;
+        old_slabs.swap(slabs);
+        free_list.clear();
+        // the k-th live node goes to slot k of the new slabs
+        std::vector<uint64_t> slot_of(nodes.size());
+        uint64_t live = 0;
+        for (uint64_t i = 0; i < nodes.size(); ++i) {
+            if (nodes[i] != nullptr) {
+                slot_of[i] = live++;
+            }
+        }
+        for (uint64_t s = 0; s * slab_size < live; ++s) {
+            slabs.push_back(static_cast<node_t*>(::operator new(sizeof(node_t) * slab_size)));
+        }
+        slab_used = live ? live - (slabs.size() - 1) * slab_size : slab_size;
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(nthreads)
+        for (uint64_t i = 0; i < nodes.size(); ++i) {
+            node_t*& node = nodes[i];
+            if (node == nullptr) continue;
+            node_t* moved = new (slabs[slot_of[i] / slab_size] + slot_of[i] % slab_size) node_t();
+            moved->take(*node);
+            node->~node_t();
+            node = moved;
+        }
+        free_slabs(old_slabs);
+        counters.slabs = slabs.size();
+        ++counters.compactions;
+    }
+
+    const stats_t& stats(void) const {
+        return counters;
+    }
+
+private:
+    static const uint64_t slab_size = 4096;
+    std::vector<node_t*> slabs;
+    uint64_t slab_used = 0;
+    std::vector<node_t*> free_list;
+    stats_t counters;
+
+    static void free_slabs(std::vector<node_t*>& to_free) {
+        for (auto* slab : to_free) {
+            ::operator delete(slab);
+        }
+        to_free.clear();
+    }
+};
+
+}
@@ -312,3 +312,101 @@ const bool odgi_for_each_step_on_handle(const ograph_t graph,
 const std::string odgi_get_path_name(const ograph_t graph, const path_handle_i ipath) {
   return (as_graph_t(graph))->get_path_name(as_path_handle(ipath));
 }
+
+const size_t odgi_get_path_steps(const ograph_t graph,
+                                 const path_handle_i ipath,
+                                 const size_t first_step,
+                                 const size_t max_steps,
+                                 handle_i *handles)
+{
+  auto g = as_graph_t(graph);
+  const path_handle_t path = as_path_handle(ipath);
+  size_t rank = 0;
+  size_t written = 0;
+  if (max_steps == 0 || g->is_empty(path)) {
+    return 0;
+  }
+  step_handle_t step = g->path_begin(path);
+  const step_handle_t end = g->path_end(path);
+  for (; step != end && rank < first_step; step = g->get_next_step(step)) {
+    ++rank;
+  }
+  for (; step != end && written < max_steps; step = g->get_next_step(step)) {
+    handles[written++] = as_handle_i(g->get_handle_of_step(step));
+  }
+  return written;
+}
+
+const size_t odgi_get_sequences(const ograph_t graph,
+                                const nid_t first_id,
+                                const nid_t last_id,
+                                char *seq,
+                                const size_t seq_size,
+                                size_t *offsets)
+{
+  auto g = as_graph_t(graph);
+  size_t total = 0;
+  size_t i = 0;
+  for (nid_t id = first_id; id <= last_id; ++id, ++i) {
+    offsets[i] = total;
+    if (g->has_node(id)) {
+      total += g->get_length(g->get_handle(id));
+    }
+  }
+  offsets[i] = total;
+  if (total > seq_size) {
+    return total;
+  }
+  i = 0;
+  for (nid_t id = first_id; id <= last_id; ++id, ++i) {
+    if (offsets[i + 1] > offsets[i]) {
+      auto& node = g->get_node_ref(g->get_handle(id));
+      node.get_lock();
+      node.copy_sequence(seq + offsets[i], 0, offsets[i + 1] - offsets[i]);
+      node.clear_lock();
+    }
+  }
+  return total;
+}
+
+const size_t odgi_get_edges(const ograph_t graph,
+                            const nid_t first_id,
+                            const nid_t last_id,
+                            handle_i *edges,
+                            const size_t max_edges)
+{
+  auto g = as_graph_t(graph);
+  size_t count = 0;
+  for (nid_t id = first_id; id <= last_id; ++id) {
+    if (!g->has_node(id)) {
+      continue;
+    }
+    g->get_node_cref(g->get_handle(id)).for_each_edge(
+        [&](nid_t other_id, bool other_rev, bool to_curr, bool on_rev) {
+          if (!to_curr) {
+            if (count < max_edges) {
+              edges[2 * count] = as_handle_i(g->get_handle(id, on_rev));
+              edges[2 * count + 1] = as_handle_i(g->get_handle(other_id, other_rev));
+            }
+            ++count;
+          }
+          return true;
+        });
+  }
+  return count;
+}
+
+void odgi_get_path_lengths(const ograph_t graph,
+                           const path_handle_i *ipaths,
+                           const size_t count,
+                           size_t *lengths)
+{
+  auto g = as_graph_t(graph);
+  for (size_t i = 0; i < count; ++i) {
+    size_t length = 0;
+    g->for_each_step_in_path(as_path_handle(ipaths[i]), [&](const step_handle_t& step) {
+      length += g->get_length(g->get_handle_of_step(step));
+    });
+    lengths[i] = length;
+  }
+}
@@ -111,6 +111,39 @@ const bool odgi_for_each_step_on_handle(const ograph_t graph,
 
 const std::string odgi_get_path_name(const ograph_t graph, const path_handle_i ipath);
 
+// Bulk access into caller-provided buffers, without allocating on the C++ side
+
+// Write the handles of at most max_steps steps of the path, from the step of rank first_step on,
+// returning the number written
+const size_t odgi_get_path_steps(const ograph_t graph,
+                                 const path_handle_i ipath,
+                                 const size_t first_step,
+                                 const size_t max_steps,
+                                 handle_i *handles);
+// Write the forward sequences of the nodes with ids first_id to last_id, both included, one after
+// the other into seq, and the offset of each into offsets, which holds last_id - first_id + 2
+// entries, the last being the end. Missing ids have empty sequences. Returns the total length;
+// nothing is written to seq if that is more than seq_size.
+const size_t odgi_get_sequences(const ograph_t graph,
+                                const nid_t first_id,
+                                const nid_t last_id,
+                                char *seq,
+                                const size_t seq_size,
+                                size_t *offsets);
+// Write the edges starting on the nodes with ids first_id to last_id, both included, as pairs of
+// handles into edges, at most max_edges of them. Each edge is reported once, by its start as
+// in GFA L lines. Returns the number of edges, which may be more than max_edges.
+const size_t odgi_get_edges(const ograph_t graph,
+                            const nid_t first_id,
+                            const nid_t last_id,
+                            handle_i *edges,
+                            const size_t max_edges);
+// Write the length in bp of each of the count paths into lengths
+void odgi_get_path_lengths(const ograph_t graph,
+                           const path_handle_i *ipaths,
+                           const size_t count,
+                           size_t *lengths);
+
 // Language agnostic C interface starts here
 
 extern "C" {
@@ -3,15 +3,162 @@
 //
 
 #include "odgi.hpp"
+#include "algorithms/profile.hpp"
+#include "algorithms/ordered_chunk_writer.hpp"
+#include "algorithms/bgzf.hpp"
+#include <sstream>
+#include <cstring>
+#include <tuple>
+#include <thread>
+#include <numeric>
+#include <deps/ips4o/ips4o.hpp>
+#include <arpa/inet.h>
 
 namespace odgi {
 
+namespace {
+
+/// Leads the node records of a serialized graph, which are then written in blocks
+/// of node_block_size records, each block prefixed by the offsets of its records
+const uint64_t node_block_marker = std::numeric_limits<uint64_t>::max();
+const uint64_t node_block_size = 1 << 16;
+/// Leads node records written in the same blocks, but each deflated on its own and prefixed by its
+/// uncompressed and compressed sizes, so that the blocks are compressed and inflated in parallel
+const uint64_t node_zblock_marker = std::numeric_limits<uint64_t>::max() - 1;
+
+/// Set in the stored length of a path written as a copy of a run of another path, whose first step then
+/// holds the id of that path and the rank of the run start in it, see graph_t::set_path_copy
+const uint64_t path_copy_flag = (uint64_t)1 << 63;
+
+/// The step at its rank among the steps of its node once some of them are dropped, see path_step_rank_maps
+step_handle_t remap_step_rank(step_handle_t step, const std::vector<std::vector<uint64_t>>& rank_maps) {
+    const uint64_t rank = number_bool_packing::unpack_number(as_handle(as_integers(step)[0]));
+    if (rank < rank_maps.size() && !rank_maps[rank].empty()) {
+        as_integers(step)[1] = rank_maps[rank][as_integers(step)[1]];
+    }
+    return step;
+}
+
+/// Leads a delta written by serialize_changes, which never starts a serialized graph
+const char delta_magic[8] = {'o', 'd', 'g', 'i', 'd', 'l', 't', '1'};
+
+void write_counts(std::ostream& out, const graph_header_t& h) {
+    out.write((char*)&h.max_node_id,sizeof(h.max_node_id));
+    out.write((char*)&h.min_node_id,sizeof(h.min_node_id));
+    out.write((char*)&h.node_count,sizeof(h.node_count));
+    out.write((char*)&h.edge_count,sizeof(h.edge_count));
+    out.write((char*)&h.path_count,sizeof(h.path_count));
+    out.write((char*)&h.path_handle_next,sizeof(h.path_handle_next));
+    out.write((char*)&h.id_increment,sizeof(h.id_increment));
+}
+
+bool read_counts(std::istream& in, graph_header_t& h) {
+    return (bool)in.read((char*)&h.max_node_id,sizeof(h.max_node_id))
+        && in.read((char*)&h.min_node_id,sizeof(h.min_node_id))
+        && in.read((char*)&h.node_count,sizeof(h.node_count))
+        && in.read((char*)&h.edge_count,sizeof(h.edge_count))
+        && in.read((char*)&h.path_count,sizeof(h.path_count))
+        && in.read((char*)&h.path_handle_next,sizeof(h.path_handle_next))
+        && in.read((char*)&h.id_increment,sizeof(h.id_increment));
+}
+
+bool same_counts(const graph_header_t& a, const graph_header_t& b) {
+    return a.max_node_id == b.max_node_id && a.min_node_id == b.min_node_id
+        && a.node_count == b.node_count && a.edge_count == b.edge_count
+        && a.path_count == b.path_count && a.path_handle_next == b.path_handle_next
+        && a.id_increment == b.id_increment;
+}
+
+/// Whether the text is a number as std::to_string writes it, that fits in 64 bits
+bool is_plain_number(const std::string& text) {
+    return !text.empty() && text.size() <= 19
+        && text.find_first_not_of("0123456789") == std::string::npos
+        && (text[0] != '0' || text.size() == 1);
+}
+
+/// Split a PanSN path name, sample#haplotype#contig with an optional :start-end range on the contig,
+/// into the fields of a GFA W line; false if the name does not follow PanSN. Without a range,
+/// has_range is false and start and end are left at 0.
+bool pansn_walk_fields(const std::string& name, std::string& sample, std::string& haplotype,
+                       std::string& contig, bool& has_range, uint64_t& start, uint64_t& end) {
+    const auto a = name.find('#');
+    const auto b = a == std::string::npos ? a : name.find('#', a + 1);
+    if (b == std::string::npos || a == 0 || b == a + 1 || b + 1 == name.size()
+        || name.find('#', b + 1) != std::string::npos
+        || name.find_first_not_of("0123456789", a + 1) != b) {
+        return false;
+    }
+    sample = name.substr(0, a);
+    haplotype = name.substr(a + 1, b - a - 1);
+    contig = name.substr(b + 1);
+    has_range = false;
+    start = 0;
+    end = 0;
+    const auto c = contig.rfind(':');
+    const auto d = c == std::string::npos ? c : contig.find('-', c);
+    // only a range that is written back the same way is taken out of the name
+    if (d != std::string::npos && is_plain_number(contig.substr(c + 1, d - c - 1))
+        && is_plain_number(contig.substr(d + 1))) {
+        has_range = true;
+        start = std::stoull(contig.substr(c + 1, d - c - 1));
+        end = std::stoull(contig.substr(d + 1));
+        contig.resize(c);
+    }
+    return !contig.empty();
+}
+
+/// Read-only stream buffer over a node record in a loaded block
+struct membuf_t : std::streambuf {
+    membuf_t(char* begin, char* end) {
+        setg(begin, begin, end);
+    }
+};
+
+}
+
+// the slots are read atomically, as parallel edits may swap in copies of nodes held by a snapshot
 node_t& graph_t::get_node_ref(const handle_t& handle) const {
-    return *node_v[number_bool_packing::unpack_number(handle)];
+    return *__atomic_load_n(&node_v[number_bool_packing::unpack_number(handle)], __ATOMIC_ACQUIRE);
 }
 
 const node_t& graph_t::get_node_cref(const handle_t& handle) const {
-    return *node_v[number_bool_packing::unpack_number(handle)];
+    return *__atomic_load_n(&node_v[number_bool_packing::unpack_number(handle)], __ATOMIC_ACQUIRE);
+}
+
+node_t& graph_t::get_writable_node(const handle_t& handle) {
+    node_t*& slot = node_v[number_bool_packing::unpack_number(handle)];
+    mark_changed(number_bool_packing::unpack_number(handle));
+    node_t* node = __atomic_load_n(&slot, __ATOMIC_ACQUIRE);
+    if (!node_in_snapshot(node)) {
+        return *node;
+    }
+    // copy under the lock of the shared record, so that only one of several editors copies it
+    node->get_lock();
+    node_t* current = __atomic_load_n(&slot, __ATOMIC_ACQUIRE);
+    if (current == node) {
+#pragma omp critical (odgi_node_pool)
+        {
+            current = node_pool.allocate();
+            _retired_nodes.emplace_back(_snapshot_generation, node);
+        }
+        current->copy(*node);
+        current->set_generation(_snapshot_generation);
+        __atomic_store_n(&slot, current, __ATOMIC_RELEASE);
+    }
+    node->clear_lock();
+    return *current;
+}
+
+void graph_t::retire_node(node_t* node) {
+    if (node == nullptr) return;
+#pragma omp critical (odgi_node_pool)
+    {
+        if (node_in_snapshot(node)) {
+            _retired_nodes.emplace_back(_snapshot_generation, node);
+        } else {
+            node_pool.release(node);
+        }
+    }
 }
 
 /// Method to check if a node exists by ID
@@ -75,38 +222,63 @@ std::string graph_t::get_sequence(const handle_t& handle) const {
     node.get_lock();
     auto seq = node.get_sequence();
     node.clear_lock();
-    return (get_is_reverse(handle) ? reverse_complement(seq) : seq);
+    if (get_is_reverse(handle)) {
+        reverse_complement_in_place(seq);
+    }
+    return seq;
+}
+
+bool graph_t::has_base_run(const handle_t& handle, char c) const {
+    auto& node = get_node_ref(handle);
+    node.get_lock();
+    const bool run = node.has_exception_run(c);
+    node.clear_lock();
+    return run;
+}
+
+char graph_t::get_base(const handle_t& handle, size_t index) const {
+    auto& node = get_node_ref(handle);
+    node.get_lock();
+    char c = get_is_reverse(handle)
+        ? reverse_complement(node.get_base(node.sequence_size() - index - 1))
+        : node.get_base(index);
+    node.clear_lock();
+    return c;
+}
+
+std::string graph_t::get_subsequence(const handle_t& handle, size_t index, size_t size) const {
+    std::string seq;
+    auto& node = get_node_ref(handle);
+    node.get_lock();
+    const uint64_t length = node.sequence_size();
+    if (index < length) {
+        size = std::min(size, length - index);
+        node.append_sequence(seq, get_is_reverse(handle) ? length - index - size : index, size);
+    }
+    node.clear_lock();
+    if (get_is_reverse(handle)) {
+        reverse_complement_in_place(seq);
+    }
+    return seq;
+}
+
+void graph_t::append_sequence(const handle_t& handle, std::string& out) const {
+    const uint64_t begin = out.size();
+    auto& node = get_node_ref(handle);
+    node.get_lock();
+    node.append_sequence(out, 0, node.sequence_size());
+    node.clear_lock();
+    if (get_is_reverse(handle)) {
+        // reverse complement the appended range in place
+        reverse_complement_in_place(out.data() + begin, out.size() - begin);
+    }
 }
 
 /// Loop over all the handles to next/previous (right/left) nodes. Passes
 /// them to a callback which returns false to stop iterating and true to
 /// continue. Returns true if we finished and false if we stopped early.
 bool graph_t::follow_edges_impl(const handle_t& handle, bool go_left, const std::function<bool(const handle_t&)>& iteratee) const {
-    const node_t& node = get_node_cref(handle);
-    nid_t node_id = get_id(handle);
-    bool is_rev = get_is_reverse(handle);
-    node.for_each_edge(
-        [&](nid_t other_id,
-            bool other_rev,
-            bool to_curr,
-            bool on_rev) {
-            if (other_id == node_id && on_rev == other_rev) {
-                // non-inverting self loop
-                // we can go either direction
-                to_curr = go_left;
-                other_rev = is_rev;
-            } else if (is_rev != on_rev) {
-                other_rev ^= 1;
-                to_curr ^= 1;
-            }
-            if (!go_left && !to_curr
-                || go_left && to_curr) {
-                if (!iteratee(get_handle(other_id, other_rev))) {
-                    return false;
-                }
-            }
-            return true;
-        });
+    visit_edges(handle, go_left, iteratee);
     return true;
 }
 
@@ -161,10 +333,15 @@ nid_t graph_t::max_node_id() const {
 ////////////////////////////////////////////////////////////////////////////
 
 /// Get the number of edges on the right (go_left = false) or left (go_left
-/// = true) side of the given handle. The default implementation is O(n) in
-/// the number of edges returned, but graph implementations that track this
-/// information more efficiently can override this method.
+/// = true) side of the given handle. Hub nodes answer from their edge index,
+/// others count the edges they visit.
 size_t graph_t::get_degree(const handle_t& handle, bool go_left) const {
+    const node_t& node = get_node_cref(handle);
+    if (node.has_edge_index()) {
+        const bool on_left = go_left ^ get_is_reverse(handle);
+        // a non-inverting self loop is recorded once, on one side, but is followed from both
+        return node.side_edge_count(on_left) + node.count_indexed_edges(get_id(handle), false, !on_left);
+    }
     size_t degree = 0;
     follow_edges(handle, go_left, [&degree](const handle_t& h) { ++degree; });
     return degree;
@@ -233,7 +410,7 @@ path_handle_t graph_t::get_path_handle(const std::string& path_name) const {
 
 /// Look up the name of a path from a handle to it
 std::string graph_t::get_path_name(const path_handle_t& path_handle) const {
-    return path_metadata(path_handle).name;
+    return std::string(path_metadata(path_handle).name);
 }
 
 /// Returns the number of node steps in the path
@@ -259,20 +436,7 @@ bool graph_t::for_each_path_handle_impl(const std::function<bool(const path_hand
 }
 
 bool graph_t::for_each_step_on_handle_impl(const handle_t& handle, const std::function<bool(const step_handle_t&)>& iteratee) const {
-    uint64_t handle_n = number_bool_packing::unpack_number(handle);
-    const node_t& node = get_node_cref(handle);
-    bool flag = true;
-    node.for_each_path_step(
-        [&](uint64_t rank,
-            uint64_t path_id,
-            bool is_rev) {
-            step_handle_t step_handle;
-            as_integers(step_handle)[0] = as_integer(number_bool_packing::pack(handle_n, is_rev));
-            as_integers(step_handle)[1] = rank;
-            flag &= iteratee(step_handle);
-            return flag;
-        });
-    return flag;
+    return visit_steps_on_handle(handle, iteratee);
 }
 
 /// Returns a vector of all steps of a node on paths. Optionally restricts to
@@ -280,13 +444,18 @@ bool graph_t::for_each_step_on_handle_impl(const handle_t& handle, const std::fu
 std::vector<step_handle_t> graph_t::steps_of_handle(const handle_t& handle,
                                                     bool match_orientation) const {
     std::vector<step_handle_t> res;
-    for_each_step_on_handle(handle, [&](const step_handle_t& step) {
-            handle_t h = get_handle_of_step(step);
-            if (!match_orientation || get_is_reverse(h) == get_is_reverse(handle)) {
-                res.push_back(step);
+    steps_of_handle(handle, res, match_orientation);
+    return res;
+}
+
+void graph_t::steps_of_handle(const handle_t& handle, std::vector<step_handle_t>& steps,
+                              bool match_orientation) const {
+    steps.clear();
+    visit_steps_on_handle(handle, [&](const step_handle_t& step) {
+            if (!match_orientation || get_is_reverse(get_handle_of_step(step)) == get_is_reverse(handle)) {
+                steps.push_back(step);
             }
         });
-    return res;
 }
 
 size_t graph_t::get_step_count(const handle_t& handle) const {
@@ -457,9 +626,190 @@ path_handle_t graph_t::get_path_handle_of_step(const step_handle_t& step_handle)
 // Additional optional interface with a default implementation
 ////////////////////////////////////////////////////////////////////////////
 
+const graph_t::step_index_t& graph_t::path_step_index(const path_handle_t& path) const {
+    if (_step_indexes_of) {
+        return _step_indexes_of->path_step_index(path);
+    }
+    auto& p = get_path_metadata(path);
+    const uint64_t epoch = _step_index_epoch.load();
+    if (p.step_index_epoch.load(std::memory_order_acquire) != epoch) {
+        p.get_lock();
+        if (p.step_index_epoch.load(std::memory_order_acquire) != epoch) {
+            auto* index = new step_index_t();
+            index->steps.reserve(p.length / step_index_sample + 1);
+            index->offsets.reserve(p.length / step_index_sample + 1);
+            uint64_t rank = 0;
+            uint64_t offset = 0;
+            for_each_step_in_path(
+                path,
+                [&](const step_handle_t& step) {
+                    if (rank % step_index_sample == 0) {
+                        index->sample_of[step] = index->steps.size();
+                        index->steps.push_back(step);
+                        index->offsets.push_back(offset);
+                    }
+                    ++rank;
+                    offset += get_length(get_handle_of_step(step));
+                });
+            index->length = offset;
+            // readers check the epoch before loading the index, so the index is swapped in first
+            delete p.step_index.exchange(index, std::memory_order_acq_rel);
+            p.step_index_epoch.store(epoch, std::memory_order_release);
+        }
+        p.clear_lock();
+    }
+    return *p.step_index.load(std::memory_order_acquire);
+}
+
 /// Returns the 0-based ordinal rank of a step on a path
 size_t graph_t::get_ordinal_rank_of_step(const step_handle_t& step_handle) const {
-    return 0; // no implementation of this in odgi (yet)
+    const auto& index = path_step_index(get_path_handle_of_step(step_handle));
+    uint64_t walked = 0;
+    step_handle_t step = step_handle;
+    auto f = index.sample_of.find(step);
+    while (f == index.sample_of.end()) {
+        step = get_previous_step(step);
+        ++walked;
+        f = index.sample_of.find(step);
+    }
+    return f->second * step_index_sample + walked;
+}
+
+/// Returns the 0-based offset of the first base of a step on its path
+size_t graph_t::get_position_of_step(const step_handle_t& step_handle) const {
+    const auto& index = path_step_index(get_path_handle_of_step(step_handle));
+    uint64_t walked = 0;
+    step_handle_t step = step_handle;
+    auto f = index.sample_of.find(step);
+    while (f == index.sample_of.end()) {
+        step = get_previous_step(step);
+        walked += get_length(get_handle_of_step(step));
+        f = index.sample_of.find(step);
+    }
+    return index.offsets[f->second] + walked;
+}
+
+/// Returns the step at the given 0-based rank on the path, or path_end if the path is shorter
+step_handle_t graph_t::get_step_at_rank(const path_handle_t& path_handle, size_t rank) const {
+    if (rank >= get_step_count(path_handle)) {
+        return path_end(path_handle);
+    }
+    const auto& index = path_step_index(path_handle);
+    step_handle_t step = index.steps[rank / step_index_sample];
+    for (uint64_t i = rank % step_index_sample; i > 0; --i) {
+        step = get_next_step(step);
+    }
+    return step;
+}
+
+/// Returns the step covering the given 0-based offset on the path, or path_end if the path is shorter
+step_handle_t graph_t::get_step_at_position(const path_handle_t& path_handle, size_t position) const {
+    const auto& index = path_step_index(path_handle);
+    if (position >= index.length) {
+        return path_end(path_handle);
+    }
+    // the last sampled step starting at or before the position
+    const uint64_t i = std::upper_bound(index.offsets.begin(), index.offsets.end(), position)
+        - index.offsets.begin() - 1;
+    step_handle_t step = index.steps[i];
+    uint64_t offset = index.offsets[i] + get_length(get_handle_of_step(step));
+    while (offset <= position) {
+        step = get_next_step(step);
+        offset += get_length(get_handle_of_step(step));
+    }
+    return step;
+}
+
+void graph_t::index_path_steps(const uint64_t& nthreads) {
+    std::vector<path_handle_t> paths;
+    paths.reserve(get_path_count());
+    for_each_path_handle([&](const path_handle_t& path) { paths.push_back(path); });
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+    for (uint64_t i = 0; i < paths.size(); ++i) {
+        path_step_index(paths[i]);
+    }
+}
+
+void graph_t::invalidate_path_step_indexes(void) {
+    ++_step_index_epoch;
+}
+
+std::string_view graph_t::name_arena_t::add(const std::string_view& name) {
+    while (lock.test_and_set(std::memory_order_acquire)); // spin
+    if (used + name.size() > block_size) {
+        // names longer than a block get one of their own
+        blocks.emplace_back(new char[std::max(block_size, (uint64_t)name.size())]);
+        used = 0;
+    }
+    char* stored = blocks.back().get() + used;
+    std::memcpy(stored, name.data(), name.size());
+    used += name.size();
+    lock.clear(std::memory_order_release);
+    return std::string_view(stored, name.size());
+}
+
+void graph_t::name_arena_t::clear(void) {
+    blocks.clear();
+    used = block_size;
+}
+
+const std::vector<path_handle_t>& graph_t::path_name_index(void) const {
+    if (!_path_name_index_valid.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> guard(_path_name_index_mutex);
+        if (!_path_name_index_valid.load(std::memory_order_acquire)) {
+            _path_name_index.clear();
+            _path_name_index.reserve(get_path_count());
+            for_each_path_handle([&](const path_handle_t& path) { _path_name_index.push_back(path); });
+            std::sort(_path_name_index.begin(), _path_name_index.end(),
+                      [&](const path_handle_t& a, const path_handle_t& b) {
+                          return path_metadata(a).name < path_metadata(b).name;
+                      });
+            _path_name_index_valid.store(true, std::memory_order_release);
+        }
+    }
+    return _path_name_index;
+}
+
+void graph_t::for_each_path_with_prefix(const std::string& prefix, const std::function<void(const path_handle_t&)>& iteratee) const {
+    const auto& index = path_name_index();
+    auto it = std::lower_bound(index.begin(), index.end(), prefix,
+                               [&](const path_handle_t& path, const std::string& p) {
+                                   return path_metadata(path).name < p;
+                               });
+    for ( ; it != index.end() && path_metadata(*it).name.compare(0, prefix.size(), prefix) == 0; ++it) {
+        iteratee(*it);
+    }
+}
+
+std::vector<std::pair<std::string, std::vector<path_handle_t>>> graph_t::pansn_path_groups(const uint64_t& fields) const {
+    std::vector<std::pair<std::string, std::vector<path_handle_t>>> groups;
+    hash_map<std::string, uint64_t> group_of;
+    for (auto& path : path_name_index()) {
+        const std::string_view name = path_metadata(path).name;
+        // cut the name at its fields-th separator, or at its last one if it has fewer
+        size_t end = std::string::npos;
+        for (size_t i = 0, next = name.find('#'); i < fields && next != std::string::npos; ++i) {
+            end = next;
+            next = name.find('#', next + 1);
+        }
+        std::string group(name.substr(0, end));
+        auto f = group_of.find(group);
+        if (f == group_of.end()) {
+            group_of[group] = groups.size();
+            groups.emplace_back(std::move(group), std::vector<path_handle_t>());
+            groups.back().second.push_back(path);
+        } else {
+            groups[f->second].second.push_back(path);
+        }
+    }
+    // a name that is a group on its own may sort apart from the longer names of its group
+    std::sort(groups.begin(), groups.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+    for (auto& group : groups) {
+        std::sort(group.second.begin(), group.second.end(),
+                  [](const path_handle_t& a, const path_handle_t& b) { return as_integer(a) < as_integer(b); });
+    }
+    return groups;
 }
 
 /// Returns true if the given path is empty, and false otherwise
@@ -518,6 +868,7 @@ handle_t graph_t::create_handle(const std::string& sequence, const nid_t& id) {
         for (uint64_t i = old_size+1; i <= id; ++i) {
             deleted_nodes.insert(i);
         }
+        track_node_count();
     }
     // update min/max node ids
     _max_node_id = std::max(id, _max_node_id.load());
@@ -534,13 +885,42 @@ handle_t graph_t::create_handle(const std::string& sequence, const nid_t& id) {
         assert(deleted_nodes.count(id));
         deleted_nodes.erase(id);
     }
-    n = new node_t();
+    n = node_pool.allocate();
+    mark_changed(handle_rank);
     auto& node = *n;
+    node.set_generation(_snapshot_generation);
     node.set_id(id);
     node.set_sequence(sequence);
     return number_bool_packing::pack(handle_rank, 0);
 }
 
+handle_t graph_t::create_handles(const uint64_t& count, const std::function<std::string(const uint64_t&)>& get_sequence) {
+    const uint64_t first_rank = node_v.size();
+    if (count == 0) {
+        return number_bool_packing::pack(first_rank, 0);
+    }
+    node_v.resize(first_rank + count, nullptr);
+    track_node_count();
+    for (uint64_t i = 0; i < count; ++i) {
+        node_t* n = node_pool.allocate();
+        n->set_generation(_snapshot_generation);
+        n->set_id(first_rank + i + 1);
+        node_v[first_rank + i] = n;
+        mark_changed(first_rank + i);
+    }
+    _max_node_id = first_rank + count;
+    if (!_min_node_id) {
+        _min_node_id = first_rank + 1;
+    }
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(_num_threads)
+    for (uint64_t i = 0; i < count; ++i) {
+        const std::string sequence = get_sequence(i);
+        assert(sequence.size());
+        node_v[first_rank + i]->set_sequence(sequence);
+    }
+    return number_bool_packing::pack(first_rank, 0);
+}
+
 /// Remove the node belonging to the given handle and all of its edges.
 /// Does not update any stored paths.
 /// Invalidates the destroyed handle.
@@ -548,6 +928,7 @@ handle_t graph_t::create_handle(const std::string& sequence, const nid_t& id) {
 /// May **NOT** be called during parallel for_each_handle iteration.
 /// May **NOT** be called on the node from which edges are being followed during follow_edges.
 void graph_t::destroy_handle(const handle_t& handle) {
+    ++_step_index_epoch; // the step indexes of the paths over the node are stale
     handle_t fwd_handle = get_is_reverse(handle) ? flip(handle) : handle;
     uint64_t id = get_id(handle);
     if (!has_node(id)) return; // deleted already
@@ -568,13 +949,81 @@ void graph_t::destroy_handle(const handle_t& handle) {
     }
     // clear the node storage
     auto& node = node_v[number_bool_packing::unpack_number(handle)];
-    delete node;
+    retire_node(node);
+    mark_changed(number_bool_packing::unpack_number(handle));
     // remove from the graph
     node = nullptr;
     // add the index to our list of open node slots
     deleted_nodes.insert(id);
 }
 
+void graph_t::destroy_handles(const std::vector<handle_t>& handles) {
+    // the live nodes to destroy, once each
+    std::vector<uint64_t> doomed_ranks;
+    doomed_ranks.reserve(handles.size());
+    std::vector<bool> doomed(node_v.size(), false);
+    for (auto& handle : handles) {
+        const uint64_t rank = number_bool_packing::unpack_number(handle);
+        if (rank < node_v.size() && node_v[rank] != nullptr && !doomed[rank]) {
+            doomed[rank] = true;
+            doomed_ranks.push_back(rank);
+        }
+    }
+    if (doomed_ranks.empty()) return;
+    ++_step_index_epoch; // the step indexes of the paths over the nodes are stale
+    auto is_doomed = [&](const uint64_t& other_id) {
+        return doomed[get_node_rank(other_id)];
+    };
+    // find the surviving neighbors, and count the edges between destroyed nodes
+    // self loops are stored once, other edges on both of their nodes
+    std::vector<std::vector<uint64_t>> neighbors(_num_threads);
+    uint64_t doomed_self_edges = 0;
+    uint64_t doomed_pair_records = 0;
+#pragma omp parallel for schedule(dynamic, 256) num_threads(_num_threads) reduction(+:doomed_self_edges,doomed_pair_records)
+    for (uint64_t i = 0; i < doomed_ranks.size(); ++i) {
+        const uint64_t rank = doomed_ranks[i];
+        const uint64_t id = rank + 1 + _id_increment;
+        auto& local = neighbors[omp_get_thread_num()];
+        node_v[rank]->for_each_edge(
+            [&](uint64_t other_id, bool other_rev, bool to_curr, bool on_rev) {
+                if (other_id == id) {
+                    ++doomed_self_edges;
+                } else if (is_doomed(other_id)) {
+                    ++doomed_pair_records;
+                } else {
+                    local.push_back(get_node_rank(other_id));
+                }
+                return true;
+            });
+    }
+    std::vector<uint64_t> survivors;
+    for (auto& local : neighbors) {
+        survivors.insert(survivors.end(), local.begin(), local.end());
+        std::vector<uint64_t>().swap(local);
+    }
+    ips4o::parallel::sort(survivors.begin(), survivors.end(), std::less<>(), _num_threads);
+    survivors.erase(std::unique(survivors.begin(), survivors.end()), survivors.end());
+    // each surviving neighbor drops its edges to destroyed nodes in one pass
+    uint64_t survivor_records = 0;
+#pragma omp parallel for schedule(dynamic, 256) num_threads(_num_threads) reduction(+:survivor_records)
+    for (uint64_t i = 0; i < survivors.size(); ++i) {
+        auto& node = get_writable_node(number_bool_packing::pack(survivors[i], false));
+        survivor_records += node.remove_edges_if(
+            [&](uint64_t other_id, bool other_rev, bool to_curr, bool on_rev) {
+                return is_doomed(other_id);
+            });
+    }
+    _edge_count -= survivor_records + doomed_self_edges + doomed_pair_records / 2;
+    // clear the node storage and open the slots
+    for (auto& rank : doomed_ranks) {
+        auto& node = node_v[rank];
+        retire_node(node);
+        mark_changed(rank);
+        node = nullptr;
+        deleted_nodes.insert(rank + 1 + _id_increment);
+    }
+}
+
 /*
 void graph_t::rebuild_id_handle_mapping() {
     // for each live node, record the id in a new vector
@@ -597,14 +1046,158 @@ void graph_t::rebuild_id_handle_mapping() {
 }
 */
 
+/// Create a batch of edges without per-edge locking.
+/// The batch is deduplicated and checked against the graph up front, then split into the
+/// records each node has to store, so that every node's edge list is written by one thread.
+void graph_t::create_edges(const std::vector<edge_t>& edges) {
+    // canonicalize so that both spellings of an edge collapse
+    std::vector<edge_t> batch(edges.size());
+#pragma omp parallel for schedule(static, 4096) num_threads(_num_threads)
+    for (uint64_t i = 0; i < edges.size(); ++i) {
+        handle_t left = edges[i].first;
+        handle_t right = edges[i].second;
+        canonicalize_edge(left, right);
+        batch[i] = std::make_pair(left, right);
+    }
+    auto edge_less =
+        [](const edge_t& a, const edge_t& b) {
+            return as_integer(a.first) < as_integer(b.first)
+                || (a.first == b.first && as_integer(a.second) < as_integer(b.second));
+        };
+    ips4o::parallel::sort(batch.begin(), batch.end(), edge_less, _num_threads);
+    batch.erase(std::unique(batch.begin(), batch.end()), batch.end());
+    // drop the edges that are already there, reading only
+    std::vector<bool> is_new(batch.size());
+#pragma omp parallel for schedule(static, 4096) num_threads(_num_threads)
+    for (uint64_t i = 0; i < batch.size(); ++i) {
+        is_new[i] = !has_edge(batch[i].first, batch[i].second);
+    }
+    // one record per node side of each new edge: (node rank, edge index, is the right side)
+    std::vector<std::tuple<uint64_t, uint64_t, bool>> records;
+    records.reserve(batch.size() * 2);
+    uint64_t created = 0;
+    for (uint64_t i = 0; i < batch.size(); ++i) {
+        if (!is_new[i]) continue;
+        ++created;
+        const uint64_t left_rank = number_bool_packing::unpack_number(batch[i].first);
+        const uint64_t right_rank = number_bool_packing::unpack_number(batch[i].second);
+        records.emplace_back(left_rank, i, false);
+        // only insert the second side if it's on a different node
+        if (left_rank != right_rank) {
+            records.emplace_back(right_rank, i, true);
+        }
+    }
+    ips4o::parallel::sort(records.begin(), records.end(), std::less<>(), _num_threads);
+    std::vector<uint64_t> node_starts;
+    for (uint64_t i = 0; i < records.size(); ++i) {
+        if (i == 0 || std::get<0>(records[i]) != std::get<0>(records[i-1])) {
+            node_starts.push_back(i);
+        }
+    }
+    const uint64_t node_count = node_starts.size();
+    node_starts.push_back(records.size());
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(_num_threads)
+    for (uint64_t k = 0; k < node_count; ++k) {
+        auto& node = get_writable_node(number_bool_packing::pack(std::get<0>(records[node_starts[k]]), false));
+        for (uint64_t j = node_starts[k]; j < node_starts[k+1]; ++j) {
+            const edge_t& edge = batch[std::get<1>(records[j])];
+            if (!std::get<2>(records[j])) {
+                node.add_edge(get_id(edge.second),
+                              get_is_reverse(edge.second),
+                              false,
+                              get_is_reverse(edge.first));
+            } else {
+                node.add_edge(get_id(edge.first),
+                              get_is_reverse(edge.first),
+                              true,
+                              get_is_reverse(edge.second));
+            }
+        }
+    }
+    _edge_count += created;
+}
+
+/// Destroy a batch of edges. Like create_edges, the batch is deduplicated and split into the
+/// records each node stores, so that every node's edge list is rewritten once, by one thread.
+void graph_t::destroy_edges(const std::vector<edge_t>& edges) {
+    std::vector<edge_t> batch(edges.size());
+#pragma omp parallel for schedule(static, 4096) num_threads(_num_threads)
+    for (uint64_t i = 0; i < edges.size(); ++i) {
+        handle_t left = edges[i].first;
+        handle_t right = edges[i].second;
+        canonicalize_edge(left, right);
+        batch[i] = std::make_pair(left, right);
+    }
+    auto edge_less =
+        [](const edge_t& a, const edge_t& b) {
+            return as_integer(a.first) < as_integer(b.first)
+                || (a.first == b.first && as_integer(a.second) < as_integer(b.second));
+        };
+    ips4o::parallel::sort(batch.begin(), batch.end(), edge_less, _num_threads);
+    batch.erase(std::unique(batch.begin(), batch.end()), batch.end());
+    // one record per node side of each edge: (node rank, edge index, is the right side)
+    std::vector<std::tuple<uint64_t, uint64_t, bool>> records;
+    records.reserve(batch.size() * 2);
+    for (uint64_t i = 0; i < batch.size(); ++i) {
+        const uint64_t left_rank = number_bool_packing::unpack_number(batch[i].first);
+        const uint64_t right_rank = number_bool_packing::unpack_number(batch[i].second);
+        records.emplace_back(left_rank, i, false);
+        if (left_rank != right_rank) {
+            records.emplace_back(right_rank, i, true);
+        }
+    }
+    ips4o::parallel::sort(records.begin(), records.end(), std::less<>(), _num_threads);
+    std::vector<uint64_t> node_starts;
+    for (uint64_t i = 0; i < records.size(); ++i) {
+        if (i == 0 || std::get<0>(records[i]) != std::get<0>(records[i-1])) {
+            node_starts.push_back(i);
+        }
+    }
+    const uint64_t node_count = node_starts.size();
+    node_starts.push_back(records.size());
+    // self loops are stored once, other edges on both of their nodes
+    uint64_t self_records = 0;
+    uint64_t other_records = 0;
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(_num_threads) reduction(+:self_records,other_records)
+    for (uint64_t k = 0; k < node_count; ++k) {
+        const uint64_t rank = std::get<0>(records[node_starts[k]]);
+        const uint64_t id = rank + 1 + _id_increment;
+        if (node_v[rank] == nullptr) continue;
+        auto& node = get_writable_node(number_bool_packing::pack(rank, false));
+        node.remove_edges_if(
+            [&](uint64_t other_id, bool other_rev, bool to_curr, bool on_rev) {
+                for (uint64_t j = node_starts[k]; j < node_starts[k+1]; ++j) {
+                    const edge_t& edge = batch[std::get<1>(records[j])];
+                    const bool right_side = std::get<2>(records[j]);
+                    const handle_t& here = right_side ? edge.second : edge.first;
+                    const handle_t& there = right_side ? edge.first : edge.second;
+                    // a record read from the other strand of this node has its orientations flipped
+                    const bool flip = on_rev != get_is_reverse(here);
+                    if (other_id == get_id(there)
+                        && (other_rev ^ flip) == get_is_reverse(there)
+                        && (to_curr ^ flip) == right_side) {
+                        if (other_id == id) {
+                            ++self_records;
+                        } else {
+                            ++other_records;
+                        }
+                        return true;
+                    }
+                }
+                return false;
+            });
+    }
+    _edge_count -= self_records + other_records / 2;
+}
+
 /// Create an edge connecting the given handles in the given order and orientations.
 /// Ignores existing edges.
 void graph_t::create_edge(const handle_t& left_h, const handle_t& right_h) {
     uint64_t left_rank = number_bool_packing::unpack_number(left_h);
     uint64_t right_rank = number_bool_packing::unpack_number(right_h);
     bool create_edge = false;
-    auto& left_node = get_node_ref(left_h);
-    auto& right_node = get_node_ref(right_h);
+    auto& left_node = get_writable_node(left_h);
+    auto& right_node = get_writable_node(right_h);
     // ordered locking
     if (left_rank < right_rank) {
         left_node.get_lock();
@@ -661,6 +1254,16 @@ uint64_t graph_t::edge_to_delta(const handle_t& left, const handle_t& right) con
 */
 
 bool graph_t::has_edge(const handle_t& left, const handle_t& right) const {
+    const node_t& node = get_node_cref(left);
+    if (node.has_edge_index()) {
+        const bool left_rev = get_is_reverse(left);
+        const bool other_rev = get_is_reverse(right) ^ left_rev;
+        if (node.count_indexed_edges(get_id(right), other_rev, left_rev)) {
+            return true;
+        }
+        // a non-inverting self loop recorded on the other side reaches the handle itself
+        return left == right && node.count_indexed_edges(get_id(right), false, !left_rev);
+    }
     bool exists = false;
     follow_edges(left, false, [&right, &exists](const handle_t& next) {
             if (next == right) exists = true;
@@ -673,8 +1276,8 @@ bool graph_t::has_edge(const handle_t& left, const handle_t& right) const {
 /// Ignores nonexistent edges.
 /// Does not update any stored paths.
 void graph_t::destroy_edge(const handle_t& left_h, const handle_t& right_h) {
-    auto& left_node = get_node_ref(left_h);
-    auto& right_node =  get_node_ref(right_h);
+    auto& left_node = get_writable_node(left_h);
+    auto& right_node =  get_writable_node(right_h);
     bool left_rev = get_is_reverse(left_h);
     bool right_rev = get_is_reverse(right_h);
     _edge_count -=
@@ -689,8 +1292,16 @@ void graph_t::clear() {
     _min_node_id = 0;
     _edge_count = 0;
     deleted_nodes.clear();
-    for (auto& n : node_v) {
-        delete n;
+    // the records of a snapshot belong to the graph it was taken from
+    if (_snapshot_of == nullptr) {
+        const bool shared = _live_snapshot_count.load();
+        for (auto& n : node_v) {
+            if (shared) {
+                retire_node(n);
+            } else {
+                node_pool.release(n);
+            }
+        }
     }
     node_v.clear();
     for_each_path_handle(
@@ -703,12 +1314,18 @@ void graph_t::clear() {
         });
     _path_count = 0;
     _path_handle_next = 0;
+    _path_copies.clear();
+    _path_name_index_valid.store(false);
+    path_names.clear();
+    if (_snapshot_of == nullptr) {
+        reclaim_snapshot_nodes();
+    }
 }
 
 void graph_t::clear_paths() {
     for_each_handle(
         [&](const handle_t& handle) {
-            node_t& node = get_node_ref(handle);
+            node_t& node = get_writable_node(handle);
             node.clear_paths();
         });
     for_each_path_handle(
@@ -721,6 +1338,9 @@ void graph_t::clear_paths() {
         });
     _path_count = 0;
     _path_handle_next = 0;
+    _path_copies.clear();
+    _path_name_index_valid.store(false);
+    path_names.clear();
 }
 
 /// Swap the nodes corresponding to the given handles, in the ordering used
@@ -735,7 +1355,96 @@ void graph_t::swap_handles(const handle_t& a, const handle_t& b) {
 }
 
 void graph_t::optimize(bool allow_id_reassignment) {
+    algorithms::profile::scope_t profile_scope("optimize");
     apply_ordering({}, allow_id_reassignment);
+    // lay the nodes out contiguously in their new order, dropping the holes left by deletions,
+    // unless snapshots still point into the current storage
+    reclaim_snapshot_nodes();
+    if (!_live_snapshot_count.load() && _retired_nodes.empty()) {
+        node_pool.compact(node_v, _num_threads);
+    }
+}
+
+const node_pool_t::stats_t& graph_t::get_node_allocation_stats() const {
+    return node_pool.stats();
+}
+
+graph_t::memory_breakdown_t::bytes_t graph_t::memory_breakdown_t::total(void) const {
+    bytes_t t;
+    for (const bytes_t* b : {&node_records, &sequences, &edges, &path_steps, &path_metadata, &hash_tables}) {
+        t += *b;
+    }
+    return t;
+}
+
+graph_t::memory_breakdown_t graph_t::measure_memory(void) const {
+    // the power of two bucket of a count, 0 for 0
+    auto bucket_of = [](const uint64_t& n) {
+        return (uint64_t)(n ? 64 - __builtin_clzll(n) : 0);
+    };
+    auto add_to_bucket = [](std::vector<memory_breakdown_t::bucket_t>& buckets, const uint64_t& b,
+                            const memory_breakdown_t::bytes_t& bytes) {
+        if (buckets.size() <= b) {
+            buckets.resize(b + 1);
+        }
+        ++buckets[b].nodes;
+        buckets[b].bytes += bytes;
+    };
+    auto merge_buckets = [](std::vector<memory_breakdown_t::bucket_t>& into,
+                            const std::vector<memory_breakdown_t::bucket_t>& from) {
+        if (into.size() < from.size()) {
+            into.resize(from.size());
+        }
+        for (uint64_t b = 0; b < from.size(); ++b) {
+            into[b].nodes += from[b].nodes;
+            into[b].bytes += from[b].bytes;
+        }
+    };
+    std::vector<memory_breakdown_t> per_thread(_num_threads);
+#pragma omp parallel for schedule(dynamic, 4096) num_threads(_num_threads)
+    for (uint64_t i = 0; i < node_v.size(); ++i) {
+        auto& m = per_thread[omp_get_thread_num()];
+        const node_t* node = node_v[i];
+        if (node == nullptr) {
+            // a deleted slot is written as an empty record
+            m.node_records.serialized += sizeof(size_t) + sizeof(uint64_t) + 3 * sizeof(uint64_t);
+            continue;
+        }
+        const node_t::footprint_t f = node->footprint();
+        m.node_records.memory += sizeof(node_t);
+        m.sequences.memory += f.sequence;
+        m.sequences.serialized += f.serialized_sequence;
+        m.edges.memory += f.edges;
+        m.edges.serialized += f.serialized_edges;
+        m.path_steps.memory += f.paths;
+        m.path_steps.serialized += f.serialized_paths;
+        memory_breakdown_t::bytes_t bytes;
+        bytes.memory = f.sequence + f.edges + f.paths;
+        bytes.serialized = f.serialized_sequence + f.serialized_edges + f.serialized_paths;
+        add_to_bucket(m.by_degree, bucket_of(node->edge_count()), bytes);
+        add_to_bucket(m.by_depth, bucket_of(node->path_count()), bytes);
+    }
+    memory_breakdown_t m;
+    for (auto& t : per_thread) {
+        m.node_records += t.node_records;
+        m.sequences += t.sequences;
+        m.edges += t.edges;
+        m.path_steps += t.path_steps;
+        merge_buckets(m.by_degree, t.by_degree);
+        merge_buckets(m.by_depth, t.by_depth);
+    }
+    // the node table, the counts leading the graph and the record offsets written with each block
+    m.node_records.memory += node_v.capacity() * sizeof(node_t*);
+    m.node_records.serialized += 9 * sizeof(uint64_t) + node_v.size() * sizeof(uint64_t);
+    for_each_path_handle([&](const path_handle_t& path) {
+        const auto& p = path_metadata(path);
+        m.path_metadata.memory += sizeof(path_metadata_t);
+        m.path_metadata.serialized += sizeof(uint64_t) + 2 * sizeof(step_handle_t) + sizeof(size_t) + p.name.size();
+    });
+    m.path_metadata.memory += path_names.bytes();
+    m.hash_tables.memory = path_metadata_h->memory_bytes() + path_name_h->memory_bytes()
+        + deleted_nodes.bucket_count() * (sizeof(uint64_t) + 1);
+    return m;
 }
 
 bool graph_t::is_optimized(void) {
@@ -747,41 +1456,117 @@ bool graph_t::is_optimized(void) {
 }
 
 void graph_t::reassign_node_ids(const std::function<nid_t(const nid_t&)>& get_new_id) {
-    assert(false); // to implement
-    /*
-    graph_t reassigned;
-    // nodes
-    for_each_handle(
-        [&](const handle_t& handle) {
-            reassigned.create_handle(get_sequence(handle), get_new_id(get_id(handle)));
-        });
-    // edges
-    for_each_edge(
-        [&](const edge_t& edge) {
-            reassigned.create_edge(reassigned.get_handle(get_new_id(get_id(edge.first)), get_is_reverse(edge.first)),
-                                   reassigned.get_handle(get_new_id(get_id(edge.second)), get_is_reverse(edge.second)));
-        });
-    // paths
-    for_each_path_handle(
-        [&](const path_handle_t& old_path) {
-            path_handle_t new_path = reassigned.create_path_handle(get_path_name(old_path));
-            for_each_step_in_path(
-                old_path,
-                [&](const step_handle_t& step) {
-                    handle_t old_handle = get_handle_of_step(step);
-                    handle_t new_handle = reassigned.get_handle(get_new_id(get_id(old_handle)),
-                                                                get_is_reverse(old_handle));
-                    reassigned.append_step(new_path, new_handle);
-                });
-        });
-    *this = reassigned;
-    */
-    // XXXXXX TODO
+    algorithms::profile::scope_t profile_scope("reassign node ids");
+    // the new id of each node, 0 for deleted slots
+    std::vector<nid_t> new_ids(node_v.size(), 0);
+    nid_t new_min_id = std::numeric_limits<nid_t>::max();
+    nid_t new_max_id = 0;
+#pragma omp parallel for schedule(static) num_threads(_num_threads) reduction(min:new_min_id) reduction(max:new_max_id)
+    for (uint64_t i = 0; i < node_v.size(); ++i) {
+        if (node_v[i] != nullptr) {
+            const nid_t old_id = i + 1 + _id_increment;
+            const nid_t new_id = get_new_id(old_id);
+            new_ids[i] = new_id ? new_id : old_id;
+            new_min_id = std::min(new_min_id, new_ids[i]);
+            new_max_id = std::max(new_max_id, new_ids[i]);
+        }
+    }
+    if (new_max_id == 0) {
+        return;
+    }
+    // the new ranks start at 0 again, as the increment moves to the new min id
+    const nid_t old_increment = _id_increment;
+    const nid_t new_increment = new_min_id - 1;
+    // the node records hold full ids, the path metadata holds ranks
+    auto get_new_node_id =
+        [&](uint64_t id) {
+            return (uint64_t)new_ids[id - 1 - old_increment];
+        };
+    auto get_new_rank_id =
+        [&](uint64_t id) {
+            const nid_t new_id = new_ids[id - 1];
+            return new_id ? new_id - new_increment : 0;
+        };
+    auto no_flip =
+        [&](uint64_t id) {
+            return false;
+        };
+
+    // each node's edges and path steps are re-encoded on their own once the mapping is known
+#pragma omp parallel for schedule(dynamic, 256) num_threads(_num_threads)
+    for (uint64_t i = 0; i < node_v.size(); ++i) {
+        handle_t h = number_bool_packing::pack(i,false);
+        if (!is_deleted(h)) {
+            auto& node = get_writable_node(h);
+            node.apply_ordering(get_new_node_id, no_flip);
+        }
+    }
+    remap_path_metadata(get_new_rank_id, no_flip);
+
+    // move the nodes to their new ranks, leaving the unused ranks as deleted nodes
+    std::vector<node_t*> new_node_v(new_max_id - new_increment, nullptr);
+#pragma omp parallel for schedule(static) num_threads(_num_threads)
+    for (uint64_t i = 0; i < node_v.size(); ++i) {
+        if (node_v[i] != nullptr) {
+            assert(new_node_v[new_ids[i] - new_min_id] == nullptr);
+            new_node_v[new_ids[i] - new_min_id] = node_v[i];
+        }
+    }
+    node_v = std::move(new_node_v);
+    _all_nodes_changed = true;
+    _id_increment = new_increment;
+    _min_node_id = 1;
+    _max_node_id = node_v.size();
+    deleted_nodes.clear();
+    for (uint64_t i = 0; i < node_v.size(); ++i) {
+        if (node_v[i] == nullptr) {
+            deleted_nodes.insert(i + 1 + _id_increment);
+        }
+    }
+    ++_step_index_epoch; // the steps moved to other nodes
+}
+
+void graph_t::remap_path_metadata(const std::function<uint64_t(uint64_t)>& get_new_id,
+                                  const std::function<bool(uint64_t)>& to_flip) {
+#pragma omp parallel for schedule(static, 1) num_threads(_num_threads)
+    for (uint64_t i = 1; i <= _path_handle_next; ++i) {
+        path_metadata_t* p;
+        if (path_metadata_h->Find(i, p)) {
+            const auto& path = as_path_handle(i);
+            auto& old_meta = path_metadata(as_path_handle(i));
+            path_metadata_h->Delete(as_integer(path));
+            path_name_h->Delete(p->name);
+            p = new path_metadata_t();
+            p->handle.store(old_meta.handle); // same by def
+            p->length.store(old_meta.length); // same
+            // reassign the handle ids, empty paths have no steps to remap
+            step_handle_t f = old_meta.first.load();
+            step_handle_t l = old_meta.last.load();
+            if (old_meta.length) {
+                handle_t& f_h = as_handle((uint64_t&)as_integers(f)[0]);
+                uint64_t f_id = number_bool_packing::unpack_number(f_h) + 1;
+                f_h = number_bool_packing::pack(get_new_id(f_id)-1, // note -1
+                                                get_is_reverse(f_h)^to_flip(f_id));
+                handle_t& l_h = as_handle((uint64_t&)as_integers(l)[0]);
+                uint64_t l_id = number_bool_packing::unpack_number(l_h) + 1;
+                l_h = number_bool_packing::pack(get_new_id(l_id)-1, // note -1
+                                                get_is_reverse(l_h)^to_flip(l_id));
+            }
+            p->first.store(f);
+            p->last.store(l);
+            p->name = old_meta.name;
+            p->is_circular.store(old_meta.is_circular);
+            path_metadata_h->Insert(as_integer(path), p);
+            path_name_h->Insert(p->name, p);
+            delete &old_meta;
+        }
+    }
 }
 
 /// Reorder the graph's internal structure to match that given.
 /// Optionally compact the id space of the graph to match the ordering, from 1->|ordering|.
 bool graph_t::apply_ordering(const std::vector<handle_t>& order_in, bool compact_ids) {
+    algorithms::profile::scope_t profile_scope("apply ordering");
     // get mapping from old to new id
     // if we're given an empty order, just compact the ids based on our ordering
     const std::vector<handle_t>* order;
@@ -802,6 +1587,7 @@ bool graph_t::apply_ordering(const std::vector<handle_t>& order_in, bool compact
     ids.resize(node_v.size(), std::make_pair(0, false));
 
     if (compact_ids) {
+#pragma omp parallel for schedule(static) num_threads(_num_threads)
         for (uint64_t i = 0; i < order->size(); ++i) {
             ids[number_bool_packing::unpack_number(order->at(i))] =
                 std::make_pair(i+1,
@@ -825,48 +1611,18 @@ bool graph_t::apply_ordering(const std::vector<handle_t>& order_in, bool compact
             return ids[id - 1].second;
         };
 
-    // nodes, edges, and path steps
-#pragma omp parallel for schedule(static, 1) num_threads(_num_threads)
+    // nodes, edges, and path steps, in dynamic chunks of neighboring nodes as their degrees and depths vary a lot
+#pragma omp parallel for schedule(dynamic, 256) num_threads(_num_threads)
     for (uint64_t i = 0; i < node_v.size(); ++i) {
         handle_t h = number_bool_packing::pack(i,false);
         if (!is_deleted(h)) {
-            auto& node = get_node_ref(h);
+            auto& node = get_writable_node(h);
             node.apply_ordering(get_new_id, to_flip);
         }
     }
 
     // path metadata
-#pragma omp parallel for schedule(static, 1) num_threads(_num_threads)
-    for (uint64_t i = 1; i <= _path_handle_next; ++i) {
-        path_metadata_t* p;
-        if (path_metadata_h->Find(i, p)) {
-            const auto& path = as_path_handle(i);
-            auto& old_meta = path_metadata(as_path_handle(i));
-            path_metadata_h->Delete(as_integer(path));
-            path_name_h->Delete(p->name);
-            p = new path_metadata_t();
-            p->handle.store(old_meta.handle); // same by def
-            p->length.store(old_meta.length); // same
-            // reassign the handle ids
-            step_handle_t f = old_meta.first.load();
-            handle_t& f_h = as_handle((uint64_t&)as_integers(f)[0]);
-            uint64_t f_id = get_id(f_h);
-            f_h = number_bool_packing::pack(get_new_id(f_id)-1, // note -1
-                                            get_is_reverse(f_h)^to_flip(f_id));
-            p->first.store(f);
-            step_handle_t l = old_meta.last.load();
-            handle_t& l_h = as_handle((uint64_t&)as_integers(l)[0]);
-            uint64_t l_id = get_id(l_h);
-            l_h = number_bool_packing::pack(get_new_id(l_id)-1, // note -1
-                                            get_is_reverse(l_h)^to_flip(l_id));
-            p->last.store(l);
-            p->name = old_meta.name;
-            p->is_circular.store(old_meta.is_circular);
-            path_metadata_h->Insert(as_integer(path), p);
-            path_name_h->Insert(p->name, p);
-            delete &old_meta;
-        }
-    }
+    remap_path_metadata(get_new_id, to_flip);
 
     // now we actually apply the ordering to our node_v, while removing deleted slots
     std::vector<node_t*> new_node_v; //(order->size());
@@ -893,49 +1649,60 @@ bool graph_t::apply_ordering(const std::vector<handle_t>& order_in, bool compact
         _max_node_id = new_node_v.size();
     }
     node_v = new_node_v;
+    _all_nodes_changed = true;
     deleted_nodes.clear();
 
     return true;
 }
 
 void graph_t::apply_path_ordering(const std::vector<path_handle_t>& order) {
-    std::vector<path_handle_t> curr_to_new(order.size());
-    {
-        uint64_t i = 0;
-        for (auto& p : order) {
-            curr_to_new[as_integer(p)-1] = as_path_handle(++i);
-        }
+    // by handle, which can run past the path count if paths were destroyed
+    std::vector<path_handle_t> curr_to_new(std::max((uint64_t)order.size(), _path_handle_next.load()));
+#pragma omp parallel for schedule(static) num_threads(_num_threads)
+    for (uint64_t i = 0; i < order.size(); ++i) {
+        curr_to_new[as_integer(order[i])-1] = as_path_handle(i+1);
     }
     auto get_new_path_handle =
         [&](const path_handle_t& p) {
             return curr_to_new[as_integer(p)-1];
         };
-    // now we save our metadata
-    std::vector<path_metadata_t*> metadata;
-    metadata.reserve(_path_count.load());
-    // then we'll apply this to our metadata map in parallel
-    for_each_path_handle(
-        [&](const path_handle_t& path) {
-            auto& p_m = get_path_metadata(path);
-            assert(p_m.handle == path);
+    // now we save our metadata, by current path handle
+    std::vector<path_metadata_t*> metadata(_path_handle_next, nullptr);
+#pragma omp parallel for schedule(static) num_threads(_num_threads)
+    for (uint64_t i = 1; i <= _path_handle_next; ++i) {
+        path_metadata_t* p;
+        if (path_metadata_h->Find(i, p)) {
+            assert(p->handle == as_path_handle(i));
+            metadata[i-1] = p;
+        }
+    }
+    // then we'll apply this to our metadata map in parallel, all old keys going before the new ones come in
+#pragma omp parallel for schedule(static) num_threads(_num_threads)
+    for (uint64_t i = 0; i < metadata.size(); ++i) {
+        if (metadata[i]) {
+            path_metadata_h->Delete(i+1);
+        }
+    }
+#pragma omp parallel for schedule(static) num_threads(_num_threads)
+    for (uint64_t i = 0; i < metadata.size(); ++i) {
+        if (metadata[i]) {
+            auto& p_m = *metadata[i];
             // update our internal handle
-            p_m.handle.store(get_new_path_handle(path));
-            metadata.push_back(&p_m);
-            path_metadata_h->Delete(as_integer(path));
-        });
-    for (auto* m : metadata) {
-        path_metadata_h->Insert(as_integer(m->handle), m);
+            p_m.handle.store(get_new_path_handle(as_path_handle(i+1)));
+            path_metadata_h->Insert(as_integer(p_m.handle), &p_m);
+        }
     }
+    _path_name_index_valid.store(false);
     // and to the nodes in parallel
     auto get_new_path_id =
         [&](const uint64_t& id) {
             return as_integer(curr_to_new[id-1]);
         };
-#pragma omp parallel for schedule(static, 1) num_threads(_num_threads)
+#pragma omp parallel for schedule(dynamic, 256) num_threads(_num_threads)
     for (uint64_t i = 0; i < node_v.size(); ++i) {
         handle_t h = number_bool_packing::pack(i,false);
         if (!is_deleted(h)) {
-            auto& node = get_node_ref(h);
+            auto& node = get_writable_node(h);
             node.apply_path_ordering(get_new_path_id);
         }
     }
@@ -952,6 +1719,7 @@ void graph_t::apply_path_ordering(const std::vector<path_handle_t>& order) {
 handle_t graph_t::apply_orientation(const handle_t& handle) {
     // do nothing if we're already in the right orientation
     if (!get_is_reverse(handle)) return handle;
+    ++_step_index_epoch; // the steps on the node are flipped
     handle_t fwd_handle = flip(handle);
     handle_t rev_handle = handle;
     // store edges
@@ -980,7 +1748,7 @@ handle_t graph_t::apply_orientation(const handle_t& handle) {
     // we have the technology. we can rebuild it.
     // replace the handle sequence
     //set_handle_sequence(handle, seq);
-    auto& node = get_node_ref(handle);
+    auto& node = get_writable_node(handle);
 
     // flip the node sequence
     node.set_sequence(get_sequence(handle));
@@ -1025,7 +1793,8 @@ handle_t graph_t::apply_orientation(const handle_t& handle) {
 
 void graph_t::set_handle_sequence(const handle_t& handle, const std::string& seq) {
     assert(seq.size());
-    auto& node = get_node_ref(handle);
+    ++_step_index_epoch; // the offsets of the steps after the node change
+    auto& node = get_writable_node(handle);
     node.get_lock();
     node.set_sequence(seq);
     node.clear_lock();
@@ -1039,6 +1808,7 @@ void graph_t::set_handle_sequence(const handle_t& handle, const std::string& seq
 /// passed in.
 /// Updates stored paths.
 std::vector<handle_t> graph_t::divide_handle(const handle_t& handle, const std::vector<size_t>& offsets) {
+    ++_step_index_epoch; // the steps on the node are split
     // convert the offsets to the forward strand, if needed
     std::vector<uint64_t> fwd_offsets = { 0 };
     uint64_t length = get_length(handle);
@@ -1105,7 +1875,7 @@ std::vector<handle_t> graph_t::divide_handle(const handle_t& handle, const std::
             rewrite_segment(step, step, handles);
         }
     }
-    get_node_ref(handle).clear_paths();
+    get_writable_node(handle).clear_paths();
     // collect the context of the handle
     vector<handle_t> edges_fwd_fwd;
     vector<handle_t> edges_fwd_rev;
@@ -1136,6 +1906,7 @@ std::vector<handle_t> graph_t::divide_handle(const handle_t& handle, const std::
 }
 
 handle_t graph_t::combine_handles(const std::vector<handle_t>& handles) {
+    ++_step_index_epoch; // the steps on the nodes are merged
     std::string seq;
     for (auto& handle : handles) {
         seq.append(get_sequence(handle));
@@ -1211,6 +1982,76 @@ void graph_t::destroy_path(const path_handle_t& path) {
     path_name_h->Delete(p.name);
     delete &p;
     --_path_count;
+    _path_name_index_valid.store(false);
+}
+
+void graph_t::keep_paths(const std::function<bool(const path_handle_t&)>& keep) {
+    // by path id, which can run past the path count if paths were destroyed
+    std::vector<path_metadata_t*> metadata(_path_handle_next + 1, nullptr);
+    std::vector<uint64_t> new_path_id(_path_handle_next + 1, 0);
+    uint64_t kept_path_count = 0;
+    for (uint64_t i = 1; i <= _path_handle_next; ++i) {
+        path_metadata_t* p;
+        if (path_metadata_h->Find(i, p)) {
+            metadata[i] = p;
+            if (keep(as_path_handle(i))) {
+                new_path_id[i] = ++kept_path_count;
+            }
+        }
+    }
+    if (kept_path_count == _path_count) {
+        return;
+    }
+    // the steps of the kept paths are renumbered and relinked to the ranks their neighbors move to
+    std::vector<std::vector<uint64_t>> rank_maps;
+    path_step_rank_maps(new_path_id, rank_maps);
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(_num_threads)
+    for (uint64_t i = 0; i < node_v.size(); ++i) {
+        if (node_v[i] == nullptr || node_v[i]->path_count() == 0) continue;
+        std::vector<node_t::step_t> steps;
+        kept_path_steps(*node_v[i], new_path_id, rank_maps, steps);
+        node_t& node = get_writable_node(number_bool_packing::pack(i, false));
+        node.clear_paths();
+        for (auto& step : steps) {
+            node.add_path_step(step);
+        }
+    }
+    // all old keys go before the new ones come in
+    for (uint64_t i = 1; i < metadata.size(); ++i) {
+        if (metadata[i]) {
+            path_metadata_h->Delete(i);
+        }
+    }
+    for (uint64_t i = 1; i < metadata.size(); ++i) {
+        path_metadata_t* p = metadata[i];
+        if (p == nullptr) continue;
+        if (!new_path_id[i]) {
+            path_name_h->Delete(p->name);
+            delete p;
+            continue;
+        }
+        if (p->length) {
+            p->first.store(remap_step_rank(p->first.load(), rank_maps));
+            p->last.store(remap_step_rank(p->last.load(), rank_maps));
+        }
+        p->handle.store(as_path_handle(new_path_id[i]));
+        path_metadata_h->Insert(new_path_id[i], p);
+    }
+    // a copy stays noted as such if it is kept with its source
+    ska::flat_hash_map<uint64_t, path_copy_t> copies;
+    for (auto& c : _path_copies) {
+        if (c.first < new_path_id.size() && new_path_id[c.first]
+            && c.second.source < new_path_id.size() && new_path_id[c.second.source]) {
+            path_copy_t& copy = copies[new_path_id[c.first]];
+            copy = c.second;
+            copy.source = new_path_id[c.second.source];
+        }
+    }
+    _path_copies.swap(copies);
+    _path_count = kept_path_count;
+    _path_handle_next = kept_path_count;
+    _path_name_index_valid.store(false);
+    invalidate_path_step_indexes();
 }
 
 /**
@@ -1230,18 +2071,19 @@ path_handle_t graph_t::create_path_handle(const std::string& name, bool is_circu
     p.first.store(step);
     p.last.store(step);
     p.length.store(0);
-    p.name = name;
+    p.name = path_names.add(name);
     p.is_circular = is_circular;
     ++_path_count; // atomic
     path_metadata_h->Insert(as_integer(path), _p);
-    path_name_h->Insert(name, _p);
+    path_name_h->Insert(p.name, _p);
+    _path_name_index_valid.store(false);
     auto& q = path_metadata(path);
     return path;
 }
 
 step_handle_t graph_t::create_step(const path_handle_t& path, const handle_t& handle) {
     // where are we going to insert?
-    auto& node = get_node_ref(handle);
+    auto& node = get_writable_node(handle);
     node.get_lock();
     uint64_t rank_on_handle = node.path_count();
     // build our step
@@ -1262,13 +2104,13 @@ void graph_t::link_steps(const step_handle_t& from, const step_handle_t& to) {
     const handle_t& to_handle = get_handle_of_step(to);
     const uint64_t& from_rank = as_integers(from)[1];
     const uint64_t& to_rank = as_integers(to)[1];
-    node_t& from_node = get_node_ref(from_handle);
+    node_t& from_node = get_writable_node(from_handle);
     from_node.get_lock();
     from_node.set_step_next_id(from_rank, get_id(to_handle));
     from_node.set_step_next_rank(from_rank, to_rank);
     from_node.set_step_is_end(from_rank, false);
     from_node.clear_lock();
-    node_t& to_node = get_node_ref(to_handle);
+    node_t& to_node = get_writable_node(to_handle);
     to_node.get_lock();
     to_node.set_step_prev_id(to_rank, get_id(from_handle));
     to_node.set_step_prev_rank(to_rank, from_rank);
@@ -1296,7 +2138,8 @@ void graph_t::destroy_step(const step_handle_t& step_handle) {
     }
     // reduce the step count in the path
     --path_meta.length;
-    node_t& curr_node = get_node_ref(get_handle_of_step(step_handle));
+    path_meta.step_index_epoch.store(0);
+    node_t& curr_node = get_writable_node(get_handle_of_step(step_handle));
     curr_node.get_lock();
     curr_node.clear_path_step(as_integers(step_handle)[1]);
     curr_node.clear_lock();
@@ -1318,6 +2161,7 @@ step_handle_t graph_t::prepend_step(const path_handle_t& path, const handle_t& t
     p.first.store(new_step);
     // update our step count
     ++p.length;
+    p.step_index_epoch.store(0);
     return new_step;
 }
 
@@ -1337,9 +2181,81 @@ step_handle_t graph_t::append_step(const path_handle_t& path, const handle_t& to
     p.last.store(new_step);
     // update our step count
     ++p.length;
+    p.step_index_epoch.store(0);
     return new_step;
 }
 
+std::vector<step_handle_t> graph_t::append_steps(const path_handle_t& path, const std::vector<handle_t>& to_append) {
+    std::vector<step_handle_t> steps(to_append.size());
+    if (to_append.empty()) return steps;
+    const uint64_t n = to_append.size();
+    const uint64_t path_id = as_integer(path);
+    // visit the steps grouped by node, so that each node is locked once per phase
+    std::vector<uint64_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(),
+              [&](const uint64_t& a, const uint64_t& b) {
+                  const uint64_t ra = number_bool_packing::unpack_number(to_append[a]);
+                  const uint64_t rb = number_bool_packing::unpack_number(to_append[b]);
+                  return ra < rb || (ra == rb && a < b);
+              });
+    auto for_each_node_group =
+        [&](const std::function<void(node_t&, uint64_t, uint64_t)>& func) {
+            uint64_t i = 0;
+            while (i < n) {
+                const uint64_t rank = number_bool_packing::unpack_number(to_append[order[i]]);
+                uint64_t j = i + 1;
+                while (j < n && number_bool_packing::unpack_number(to_append[order[j]]) == rank) ++j;
+                node_t& node = get_writable_node(to_append[order[i]]);
+                node.get_lock();
+                func(node, i, j);
+                node.clear_lock();
+                i = j;
+            }
+        };
+    auto& p = get_path_metadata(path);
+    const bool was_empty = !p.length;
+    // write the step records, their ranks on the nodes are known once all are written
+    for_each_node_group(
+        [&](node_t& node, uint64_t begin, uint64_t end) {
+            for (uint64_t i = begin; i < end; ++i) {
+                const uint64_t k = order[i];
+                const handle_t& handle = to_append[k];
+                as_integers(steps[k])[0] = as_integer(handle);
+                as_integers(steps[k])[1] = node.path_count();
+                const bool is_start = k == 0;
+                const bool is_end = k + 1 == n;
+                node.add_path_step(path_id, get_is_reverse(handle),
+                                   is_start, is_end,
+                                   is_start ? 0 : get_id(to_append[k-1]), 0,
+                                   is_end ? 0 : get_id(to_append[k+1]), 0);
+            }
+        });
+    // link the new steps to each other
+    for_each_node_group(
+        [&](node_t& node, uint64_t begin, uint64_t end) {
+            for (uint64_t i = begin; i < end; ++i) {
+                const uint64_t k = order[i];
+                const uint64_t rank = as_integers(steps[k])[1];
+                if (k > 0) {
+                    node.set_step_prev_rank(rank, as_integers(steps[k-1])[1]);
+                }
+                if (k + 1 < n) {
+                    node.set_step_next_rank(rank, as_integers(steps[k+1])[1]);
+                }
+            }
+        });
+    if (was_empty) {
+        p.first.store(steps.front());
+    } else {
+        link_steps(path_back(path), steps.front());
+    }
+    p.last.store(steps.back());
+    p.length += n;
+    p.step_index_epoch.store(0);
+    return steps;
+}
+
 /// helper to handle the case where we remove an step from a given path
 /// on a node that has other steps from the same path, thus invalidating the
 /// ranks used to refer to it
@@ -1349,7 +2265,7 @@ void graph_t::decrement_rank(const step_handle_t& step_handle) {
     if (has_previous_step(step_handle)) {
         auto step = get_previous_step(step_handle);
         // decrement the rank information
-        node_t& step_node = get_node_ref(get_handle_of_step(step));
+        node_t& step_node = get_writable_node(get_handle_of_step(step));
         step_node.get_lock();
         uint64_t step_rank = as_integers(step)[1];
         step_node.set_step_next_rank(step_rank,
@@ -1364,7 +2280,7 @@ void graph_t::decrement_rank(const step_handle_t& step_handle) {
     }
     if (has_next_step(step_handle)) {
         auto step = get_next_step(step_handle);
-        node_t& step_node = get_node_ref(get_handle_of_step(step));
+        node_t& step_node = get_writable_node(get_handle_of_step(step));
         step_node.get_lock();
         uint64_t step_rank = as_integers(step)[1];
         step_node.set_step_prev_rank(step_rank,
@@ -1480,6 +2396,10 @@ void graph_t::display() const {
 
     std::cerr << "_max_node_id = " << _max_node_id << std::endl;
     std::cerr << "_min_node_id = " << _min_node_id << std::endl;
+    const auto& alloc = node_pool.stats();
+    std::cerr << "node_pool = slabs " << alloc.slabs << " allocated " << alloc.allocated
+              << " reused " << alloc.reused << " released " << alloc.released
+              << " live " << alloc.live() << " compactions " << alloc.compactions << std::endl;
 
     //std::cerr << "graph_id_map" << "\t";
     //for (auto& k : graph_id_map) std::cerr << k.first << "->" << k.second << " "; std::cerr << std::endl;
@@ -1542,58 +2462,146 @@ void graph_t::display() const {
 
 }
 
-void graph_t::to_gfa(std::ostream& out, const bool& emit_node_annotation) const {
-    out << "H\tVN:Z:1.0" << std::endl;
-    // for each node
-    for_each_handle([&out,&emit_node_annotation, this](const handle_t& h) {
-            out << "S\t" << get_id(h) << "\t" << get_sequence(h);
-            if (emit_node_annotation) {
-                out << "\t"
-                << "DP:i:" << get_step_count(h) << "\t"
-                << "RC:i:" << get_step_count(h) * get_length(h);
+void graph_t::to_gfa(std::ostream& out, const bool& emit_node_annotation,
+                     const uint64_t& nthreads, const bool& bgzip, const bool& pansn_walks) const {
+    // the text of each work item goes out once it reaches this size
+    const uint64_t output_chunk_size = 1 << 20;
+    const uint64_t nodes_per_item = 1 << 14;
+    {
+        // W lines came with GFA 1.1
+        std::string header = pansn_walks ? "H\tVN:Z:1.1\n" : "H\tVN:Z:1.0\n";
+        if (bgzip) {
+            std::string compressed;
+            algorithms::bgzf_compress(header, compressed);
+            header.swap(compressed);
+        }
+        out.write(header.data(), header.size());
+    }
+    std::vector<path_handle_t> paths;
+    paths.reserve(get_path_count());
+    for_each_path_handle([&](const path_handle_t& p) {
+        paths.push_back(p);
+    });
+    const uint64_t node_items = (node_v.size() + nodes_per_item - 1) / nodes_per_item;
+    algorithms::ordered_chunk_writer writer(out);
+    writer.open_writer();
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+    for (uint64_t item = 0; item < node_items + paths.size(); ++item) {
+        std::string text;
+        std::string compressed;
+        // hand over the text, compressed into its own blocks with bgzip
+        auto emit = [&](const bool& last) {
+            if (bgzip) {
+                algorithms::bgzf_compress(text, compressed);
+                text.clear();
+                writer.append(item, compressed, last);
+            } else {
+                writer.append(item, text, last);
             }
-            out << std::endl;
-
-            {
+        };
+        if (item < node_items) {
+            // the S lines of a range of nodes, each followed by the L lines of the edges starting on it
+            const uint64_t end = std::min((item + 1) * nodes_per_item, (uint64_t) node_v.size());
+            for (uint64_t i = item * nodes_per_item; i < end; ++i) {
+                const handle_t h = number_bool_packing::pack(i, false);
+                if (is_deleted(h)) continue;
+                const nid_t node_id = get_id(h);
+                text.append("S\t");
+                text.append(std::to_string(node_id));
+                text.push_back('\t');
+                text.append(get_sequence(h));
+                if (emit_node_annotation) {
+                    text.append("\tDP:i:");
+                    text.append(std::to_string(get_step_count(h)));
+                    text.append("\tRC:i:");
+                    text.append(std::to_string(get_step_count(h) * get_length(h)));
+                }
+                text.push_back('\n');
                 // use this direct iteration to avoid double counting edges
                 // we only consider write the edges relative to their start
-                const node_t& node = get_node_cref(h);
-                bool is_rev = get_is_reverse(h);
-                nid_t node_id = get_id(h);
-                node.for_each_edge(
+                get_node_cref(h).for_each_edge(
                     [&](nid_t other_id,
                         bool other_rev,
                         bool to_curr,
                         bool on_rev) {
                         if (!to_curr) {
-                            out << "L\t" << node_id << "\t"
-                                << (on_rev?"-":"+") << "\t"
-                                << other_id << "\t"
-                                << (other_rev?"-":"+") << "\t"
-                                << "0M" << std::endl;
+                            text.append("L\t");
+                            text.append(std::to_string(node_id));
+                            text.append(on_rev ? "\t-\t" : "\t+\t");
+                            text.append(std::to_string(other_id));
+                            text.append(other_rev ? "\t-\t0M\n" : "\t+\t0M\n");
                         }
                         return true;
                     });
+                if (text.size() >= output_chunk_size) {
+                    emit(false);
+                }
             }
-        });
-    for_each_path_handle([&out,this](const path_handle_t& p) {
-            out << "P\t" << get_path_name(p) << "\t";
-            auto& path_meta = path_metadata(p);
-            uint64_t i = 0;
-            for_each_step_in_path(p, [this,&i,&out](const step_handle_t& step) {
-                    handle_t h = get_handle_of_step(step);
-                    out << get_id(h) << (get_is_reverse(h)?"-":"+");
-                    if (has_next_step(step)) out << ",";
-                    ++i;
+        } else {
+            const path_handle_t& p = paths[item - node_items];
+            const std::string path_name = get_path_name(p);
+            std::string sample, haplotype, contig;
+            bool has_range = false;
+            uint64_t start = 0, end = 0;
+            // a circular path stays a P line, a walk can not say so
+            bool as_walk = pansn_walks && !get_is_circular(p)
+                && pansn_walk_fields(path_name, sample, haplotype, contig, has_range, start, end);
+            if (as_walk && has_range) {
+                // the range is read back into the name, so it must be the one the walk spans
+                uint64_t length = 0;
+                for_each_step_in_path(p, [&](const step_handle_t& step) {
+                    length += get_length(get_handle_of_step(step));
                 });
-            out << "\t" << "*"; // always put at least a "*" in the overlaps field
-            if (get_is_circular(p)) {
-                out << "\t" << "TP:Z:circular";
+                as_walk = start + length == end;
             }
-            assert(i == path_meta.length);
-            //out << "\t" << "steps:i:" << path_meta.length;
-            out << std::endl;
-        });
+            if (as_walk) {
+                text.append("W\t");
+                text.append(sample);
+                text.push_back('\t');
+                text.append(haplotype);
+                text.push_back('\t');
+                text.append(contig);
+                text.push_back('\t');
+                text.append(has_range ? std::to_string(start) : "*");
+                text.push_back('\t');
+                text.append(has_range ? std::to_string(end) : "*");
+                text.push_back('\t');
+                for_each_step_in_path(p, [&](const step_handle_t& step) {
+                    const handle_t h = get_handle_of_step(step);
+                    text.push_back(get_is_reverse(h) ? '<' : '>');
+                    text.append(std::to_string(get_id(h)));
+                    if (text.size() >= output_chunk_size) {
+                        emit(false);
+                    }
+                });
+                text.push_back('\n');
+            } else {
+                text.append("P\t");
+                text.append(path_name);
+                text.push_back('\t');
+                for_each_step_in_path(p, [&](const step_handle_t& step) {
+                    const handle_t h = get_handle_of_step(step);
+                    text.append(std::to_string(get_id(h)));
+                    text.push_back(get_is_reverse(h) ? '-' : '+');
+                    if (has_next_step(step)) text.push_back(',');
+                    if (text.size() >= output_chunk_size) {
+                        emit(false);
+                    }
+                });
+                text.append("\t*"); // always put at least a "*" in the overlaps field
+                if (get_is_circular(p)) {
+                    text.append("\tTP:Z:circular");
+                }
+                text.push_back('\n');
+            }
+        }
+        emit(true);
+    }
+    writer.close_writer();
+    if (bgzip) {
+        out.write(algorithms::bgzf_eof().data(), algorithms::bgzf_eof().size());
+    }
+    out.flush();
 }
 
 uint32_t graph_t::get_magic_number() const {
@@ -1601,6 +2609,7 @@ uint32_t graph_t::get_magic_number() const {
 }
 
 void graph_t::serialize_members(std::ostream& out) const {
+    algorithms::profile::scope_t profile_scope("serialize graph");
     //rebuild_id_handle_mapping();
     uint64_t written = 0;
     out.write((char*)&_max_node_id,sizeof(_max_node_id));
@@ -1619,32 +2628,122 @@ void graph_t::serialize_members(std::ostream& out) const {
     out.write((char*)&_id_increment,sizeof(_id_increment));
     written += sizeof(_id_increment);
     //assert(node_count == node_v.size());
+    // node records are written in blocks, each led by a table of record offsets, so that both writing and
+    // loading can work on whole blocks concurrently; small graphs get smaller blocks to keep all threads busy
+    const uint64_t block_size = std::max((uint64_t)1024,
+                                         std::min(node_block_size, node_count / (4 * std::max(_num_threads, (uint64_t)1)) + 1));
+    if (node_count) {
+        const uint64_t& marker = _compress_serialization ? node_zblock_marker : node_block_marker;
+        out.write((char*)&marker,sizeof(marker));
+        written += sizeof(marker);
+        out.write((char*)&block_size,sizeof(block_size));
+        written += sizeof(block_size);
+    }
+    // the paths that are still copies of runs of other paths are written as references to them, leaving
+    // their steps out of the node records, which are rewritten where they lose steps or link to ones that do
+    const auto copies = held_path_copies();
+    std::vector<uint64_t> kept_path_id;
+    std::vector<std::vector<uint64_t>> rank_maps;
+    std::vector<std::atomic<bool>> rewritten;
+    if (!copies.empty()) {
+        kept_path_id.resize(_path_handle_next + 1);
+        std::iota(kept_path_id.begin(), kept_path_id.end(), 0);
+        for (auto& c : copies) {
+            kept_path_id[c.first] = 0;
+        }
+        path_step_rank_maps(kept_path_id, rank_maps);
+        rewritten = std::vector<std::atomic<bool>>(node_count);
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(_num_threads)
+        for (uint64_t i = 0; i < node_count; ++i) {
+            if (rank_maps[i].empty()) continue;
+            rewritten[i].store(true);
+            node_v[i]->for_each_path_step([&](const node_t::step_t& step) {
+                if (kept_path_id[step.path_id]) {
+                    if (step.prev_id) rewritten[step.prev_id - _id_increment - 1].store(true);
+                    if (step.next_id) rewritten[step.next_id - _id_increment - 1].store(true);
+                }
+                return true;
+            });
+        }
+    }
     // hack
     // todo big mess, middle of removal of deleted node bv
     node_t empty_node;
-    for (auto& node : node_v) {
-        // check if node is null
-        if (node == nullptr) {
-            written += empty_node.serialize(out);
-        } else {
-            written += node->serialize(out);
+    // each thread lays out whole blocks, which a writer thread emits in order while the next ones are laid out
+    const uint64_t block_count = (node_count + block_size - 1) / block_size;
+    std::atomic<uint64_t> block_bytes(0);
+    algorithms::ordered_chunk_writer writer(out);
+    writer.open_writer();
+#pragma omp parallel for schedule(dynamic, 1) num_threads(_num_threads)
+    for (uint64_t b = 0; b < block_count; ++b) {
+        const uint64_t begin = b * block_size;
+        const uint64_t n = std::min(block_size, node_count - begin);
+        std::vector<uint64_t> offsets(n + 1, 0);
+        std::ostringstream records;
+        std::vector<node_t::step_t> steps;
+        for (uint64_t i = 0; i < n; ++i) {
+            // check if node is null
+            auto* node = node_v[begin + i];
+            if (node == nullptr) {
+                empty_node.serialize(records);
+            } else if (!rewritten.empty() && rewritten[begin + i].load()) {
+                node_t kept;
+                kept.copy(*node);
+                kept.clear_paths();
+                kept_path_steps(*node, kept_path_id, rank_maps, steps);
+                for (auto& step : steps) {
+                    kept.add_path_step(step);
+                }
+                kept.serialize(records);
+            } else {
+                node->serialize(records);
+            }
+            offsets[i+1] = records.tellp();
         }
+        std::string raw((char*)offsets.data(), offsets.size()*sizeof(uint64_t));
+        raw.append(records.str());
+        if (_compress_serialization) {
+            // the compressed blocks carry their sizes
+            std::string text(2*sizeof(uint64_t), '\0');
+            algorithms::deflate_raw(raw.data(), raw.size(), text);
+            const uint64_t sizes[2] = { raw.size(), text.size() - 2*sizeof(uint64_t) };
+            std::memcpy((char*)text.data(), sizes, sizeof(sizes));
+            raw.swap(text);
+        }
+        block_bytes += raw.size();
+        writer.append(b, raw, true);
     }
+    writer.close_writer();
+    written += block_bytes.load();
     // there are _path_count of these to write
     uint64_t j = 0;
     for_each_path_handle(
         [&](const path_handle_t& path) {
             auto& m = path_metadata(path);
-            out.write((char*)&m.length,sizeof(m.length));
-            written += sizeof(m.length);
-            out.write((char*)&m.first,sizeof(m.first));
-            written += sizeof(m.first);
-            out.write((char*)&m.last,sizeof(m.last));
-            written += sizeof(m.last);
+            uint64_t length = m.length;
+            step_handle_t first = m.first;
+            step_handle_t last = m.last;
+            auto c = copies.find(as_integer(path));
+            if (c != copies.end()) {
+                length = c->second.length | path_copy_flag;
+                as_integers(first)[0] = c->second.source;
+                as_integers(first)[1] = c->second.start;
+                as_integers(last)[0] = 0;
+                as_integers(last)[1] = 0;
+            } else if (length && !rank_maps.empty()) {
+                first = remap_step_rank(first, rank_maps);
+                last = remap_step_rank(last, rank_maps);
+            }
+            out.write((char*)&length,sizeof(length));
+            written += sizeof(length);
+            out.write((char*)&first,sizeof(first));
+            written += sizeof(first);
+            out.write((char*)&last,sizeof(last));
+            written += sizeof(last);
             size_t k = m.name.size();
             out.write((char*)&k,sizeof(k));
             written += sizeof(k);
-            out.write((char*)m.name.c_str(),m.name.size());
+            out.write(m.name.data(),m.name.size());
             written += k;
             ++j;
         });
@@ -1652,6 +2751,9 @@ void graph_t::serialize_members(std::ostream& out) const {
 }
 
 void graph_t::deserialize_members(std::istream& in) {
+    algorithms::profile::scope_t profile_scope("load graph");
+    _path_copies.clear();
+    _path_name_index_valid.store(false);
     in.read((char*)&_max_node_id,sizeof(_max_node_id));
     in.read((char*)&_min_node_id,sizeof(_min_node_id));
     uint64_t node_count = node_v.size();
@@ -1661,36 +2763,742 @@ void graph_t::deserialize_members(std::istream& in) {
     in.read((char*)&_path_handle_next,sizeof(_path_handle_next));
     in.read((char*)&_id_increment,sizeof(_id_increment));
     node_v.resize(node_count,nullptr);
+    // graphs written before the node block layout start directly with the first node record,
+    // whose leading sequence length can never be the block marker
+    uint64_t marker = 0;
+    if (node_count) {
+        in.read((char*)&marker,sizeof(marker));
+    }
+    if (marker == node_zblock_marker) {
+        uint64_t block_size = 0;
+        in.read((char*)&block_size,sizeof(block_size));
+        // the pool is not thread-safe, so the records are allocated up front
+        for (size_t i = 0; i < node_count; ++i) {
+            node_v[i] = node_pool.allocate();
+        }
+        // read a batch of blocks, then inflate and load them in parallel
+        const uint64_t block_count = (node_count + block_size - 1) / block_size;
+        const uint64_t batch_size = std::max(_num_threads, (uint64_t)1);
+        // as with plain blocks, the next batch is read while the current one is inflated
+        std::vector<std::string> compressed[2] = { std::vector<std::string>(batch_size), std::vector<std::string>(batch_size) };
+        std::vector<uint64_t> raw_sizes[2] = { std::vector<uint64_t>(batch_size), std::vector<uint64_t>(batch_size) };
+        std::atomic<bool> truncated(false);
+        auto read_batch = [&](const uint64_t& batch, const int& k) {
+            const uint64_t blocks = std::min(batch_size, block_count - batch);
+            for (uint64_t b = 0; b < blocks; ++b) {
+                uint64_t compressed_size = 0;
+                in.read((char*)&raw_sizes[k][b],sizeof(raw_sizes[k][b]));
+                in.read((char*)&compressed_size,sizeof(compressed_size));
+                compressed[k][b].resize(in ? compressed_size : 0);
+                in.read((char*)compressed[k][b].data(),compressed[k][b].size());
+                if (!in) {
+                    truncated.store(true);
+                    return;
+                }
+            }
+        };
+        if (block_count) {
+            read_batch(0, 0);
+        }
+        for (uint64_t batch = 0, k = 0; batch < block_count; batch += batch_size, k ^= 1) {
+            if (truncated) {
+                throw std::runtime_error("[odgi::graph_t] error: truncated compressed node block");
+            }
+            std::thread reader;
+            if (batch + batch_size < block_count) {
+                reader = std::thread(read_batch, batch + batch_size, k ^ 1);
+            }
+            const uint64_t blocks = std::min(batch_size, block_count - batch);
+            auto& batch_compressed = compressed[k];
+            auto& batch_raw_sizes = raw_sizes[k];
+#pragma omp parallel for schedule(dynamic, 1) num_threads(_num_threads)
+            for (uint64_t b = 0; b < blocks; ++b) {
+                const uint64_t begin = (batch + b) * block_size;
+                const uint64_t n = std::min(block_size, node_count - begin);
+                std::string raw(batch_raw_sizes[b], '\0');
+                algorithms::inflate_raw(batch_compressed[b].data(), batch_compressed[b].size(), (char*)raw.data(), raw.size());
+                std::string().swap(batch_compressed[b]);
+                const uint64_t* offsets = (const uint64_t*)raw.data();
+                char* records = (char*)raw.data() + (n + 1)*sizeof(uint64_t);
+                for (uint64_t i = 0; i < n; ++i) {
+                    membuf_t buf(records + offsets[i], records + offsets[i+1]);
+                    std::istream record(&buf);
+                    node_v[begin + i]->load(record, !_load_topology_only);
+                }
+            }
+            if (reader.joinable()) {
+                reader.join();
+            }
+        }
+    } else if (marker == node_block_marker) {
+        uint64_t block_size = 0;
+        in.read((char*)&block_size,sizeof(block_size));
+        // the pool is not thread-safe, so the records are allocated up front
+        for (size_t i = 0; i < node_count; ++i) {
+            node_v[i] = node_pool.allocate();
+        }
+        // a reader thread fetches the next block while the current one is decoded, so that
+        // loading from a pipe overlaps with the writer upstream rather than waiting on it
+        std::vector<uint64_t> offsets[2];
+        std::string block[2];
+        auto read_block = [&](const uint64_t& begin, const int& k) {
+            const uint64_t n = std::min(block_size, node_count - begin);
+            offsets[k].resize(n + 1);
+            in.read((char*)offsets[k].data(),offsets[k].size()*sizeof(uint64_t));
+            block[k].resize(in ? offsets[k].back() : 0);
+            in.read((char*)block[k].data(),block[k].size());
+        };
+        read_block(0, 0);
+        for (uint64_t begin = 0, k = 0; begin < node_count; begin += block_size, k ^= 1) {
+            if (!in) {
+                throw std::runtime_error("[odgi::graph_t] error: truncated node block");
+            }
+            std::thread reader;
+            if (begin + block_size < node_count) {
+                reader = std::thread(read_block, begin + block_size, k ^ 1);
+            }
+            const uint64_t n = std::min(block_size, node_count - begin);
+            const auto& block_offsets = offsets[k];
+            char* records = (char*)block[k].data();
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(_num_threads)
+            for (uint64_t i = 0; i < n; ++i) {
+                membuf_t buf(records + block_offsets[i], records + block_offsets[i+1]);
+                std::istream record(&buf);
+                // the steps close each record, so without paths the rest of the record is never decoded
+                node_v[begin + i]->load(record, !_load_topology_only);
+            }
+            if (reader.joinable()) {
+                reader.join();
+            }
+        }
+    } else {
+        for (size_t i = 0; i < node_count; ++i) {
+            node_v[i] = node_pool.allocate();
+            if (i == 0) {
+                node_v[i]->load(in, marker);
+            } else {
+                node_v[i]->load(in);
+            }
+            if (_load_topology_only) {
+                node_v[i]->clear_paths();
+            }
+        }
+    }
     for (size_t i = 0; i < node_count; ++i) {
-        node_v[i] = new node_t;
         auto& node = node_v[i];
-        node->load(in);
         if (node->get_id() == 0) {
             // detect which nodes are deleted
             // these must be the only ones with id == 0
             // they have been stored as empty node records
-            delete node;
+            node_pool.release(node);
             node = nullptr;
             deleted_nodes.insert(i+1);
         }
     }
-    for (size_t j = 0; j < _path_count; ++j) {
+    const uint64_t stored_path_count = _path_count;
+    // the new id of each stored path, 0 if it is not kept
+    std::vector<uint64_t> new_path_id(stored_path_count + 1, 0);
+    uint64_t kept_path_count = 0;
+    std::vector<path_metadata_t*> kept;
+    // the paths stored as copies of runs of other paths, by stored id, and where those paths start
+    std::vector<std::pair<uint64_t, path_copy_t>> stored_copies;
+    std::vector<step_handle_t> stored_first(stored_path_count + 1);
+    std::vector<uint64_t> stored_length(stored_path_count + 1, 0);
+    std::string name;
+    for (size_t j = 0; j < stored_path_count; ++j) {
         path_metadata_t* _p = new path_metadata_t();
         auto& m = *_p;
-        m.handle = as_path_handle(j+1);
-        in.read((char*)&m.length,sizeof(m.length));
-        in.read((char*)&m.first,sizeof(m.first));
-        in.read((char*)&m.last,sizeof(m.last));
+        uint64_t length = 0;
+        step_handle_t first, last;
+        in.read((char*)&length,sizeof(length));
+        in.read((char*)&first,sizeof(first));
+        in.read((char*)&last,sizeof(last));
         uint64_t s;
         in.read((char*)&s,sizeof(s));
-        char n[s+1]; n[s] = '\0';
-        in.read(n,s);
-        m.name = string(n);
-        path_metadata_h->Insert(as_integer(m.handle), _p);
-        path_name_h->Insert(m.name, _p);
+        name.resize(s);
+        in.read((char*)name.data(),s);
+        const bool is_copy = length & path_copy_flag;
+        if (!is_copy) {
+            stored_first[j+1] = first;
+            stored_length[j+1] = length;
+        }
+        if (_load_topology_only || (_load_path_filter && !_load_path_filter(name))) {
+            delete _p;
+            continue;
+        }
+        if (is_copy) {
+            path_copy_t c;
+            c.source = as_integers(first)[0];
+            c.start = as_integers(first)[1];
+            c.length = length & ~path_copy_flag;
+            stored_copies.push_back(std::make_pair(j+1, c));
+            // the copy starts empty and gets its steps once the paths are in place
+            length = 0;
+            as_integers(first)[0] = as_integers(first)[1] = 0;
+            last = first;
+        }
+        m.length.store(length);
+        m.first.store(first);
+        m.last.store(last);
+        new_path_id[j+1] = ++kept_path_count;
+        m.handle = as_path_handle(kept_path_count);
+        m.name = path_names.add(name);
+        kept.push_back(_p);
+    }
+    // the steps of the copies are read from their sources before the sources that are not kept lose them
+    std::vector<std::vector<handle_t>> copy_steps(stored_copies.size());
+    if (!stored_copies.empty()) {
+        std::map<uint64_t, std::vector<uint64_t>> copies_of;
+        for (uint64_t k = 0; k < stored_copies.size(); ++k) {
+            const auto& c = stored_copies[k].second;
+            if (c.source == 0 || c.source > stored_path_count || c.start + c.length > stored_length[c.source]) {
+                throw std::runtime_error("[odgi::graph_t] error: path stored as a copy of a missing run of steps");
+            }
+            copies_of[c.source].push_back(k);
+        }
+        std::vector<std::pair<uint64_t, std::vector<uint64_t>>> sources(copies_of.begin(), copies_of.end());
+#pragma omp parallel for schedule(dynamic, 1) num_threads(_num_threads)
+        for (uint64_t i = 0; i < sources.size(); ++i) {
+            uint64_t end = 0;
+            for (auto& k : sources[i].second) {
+                end = std::max(end, stored_copies[k].second.start + stored_copies[k].second.length);
+            }
+            std::vector<handle_t> steps;
+            steps.reserve(end);
+            step_handle_t step = stored_first[sources[i].first];
+            while (true) {
+                steps.push_back(get_handle_of_step(step));
+                if (steps.size() == end) break;
+                step = get_next_step(step);
+            }
+            for (auto& k : sources[i].second) {
+                const auto& c = stored_copies[k].second;
+                copy_steps[k].assign(steps.begin() + c.start, steps.begin() + c.start + c.length);
+            }
+        }
     }
+    _path_count = kept_path_count;
+    _path_handle_next = kept_path_count;
+    if (!_load_topology_only && kept_path_count < stored_path_count) {
+        std::vector<std::vector<uint64_t>> rank_maps;
+        drop_loaded_path_steps(new_path_id, rank_maps);
+        // the first and last steps of the kept paths move to the new ranks of their steps
+        for (auto* m : kept) {
+            if (m->length) {
+                m->first.store(remap_step_rank(m->first.load(), rank_maps));
+                m->last.store(remap_step_rank(m->last.load(), rank_maps));
+            }
+        }
+    }
+    for (auto* _p : kept) {
+        path_metadata_h->Insert(as_integer(_p->handle), _p);
+        path_name_h->Insert(_p->name, _p);
+    }
+    // expand the copies, which stay noted as such while their sources are loaded with them
+#pragma omp parallel for schedule(dynamic, 1) num_threads(_num_threads)
+    for (uint64_t k = 0; k < stored_copies.size(); ++k) {
+        append_steps(as_path_handle(new_path_id[stored_copies[k].first]), copy_steps[k]);
+        std::vector<handle_t>().swap(copy_steps[k]);
+    }
+    for (auto& stored : stored_copies) {
+        if (new_path_id[stored.second.source]) {
+            path_copy_t& c = _path_copies[new_path_id[stored.first]];
+            c = stored.second;
+            c.source = new_path_id[stored.second.source];
+        }
+    }
+}
+
+void graph_t::set_compressed_serialization(const bool& compress) {
+    _compress_serialization = compress;
 }
 
+void graph_t::set_path_loading(const bool& topology_only,
+                               const std::function<bool(const std::string_view&)>& keep_path) {
+    _load_topology_only = topology_only;
+    _load_path_filter = keep_path;
+}
+
+void graph_t::path_step_rank_maps(const std::vector<uint64_t>& new_path_id,
+                                  std::vector<std::vector<uint64_t>>& rank_maps) const {
+    // the steps of the kept paths point at the ranks of their neighbors, which move when steps are dropped
+    rank_maps.assign(node_v.size(), {});
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(_num_threads)
+    for (uint64_t i = 0; i < node_v.size(); ++i) {
+        if (node_v[i] == nullptr) continue;
+        const node_t& node = *node_v[i];
+        const uint64_t n_steps = node.path_count();
+        uint64_t n_kept = 0;
+        for (uint64_t r = 0; r < n_steps; ++r) {
+            n_kept += !node.step_is_del(r) && new_path_id[node.step_path_id(r)];
+        }
+        if (n_kept == n_steps) continue;
+        auto& rank_map = rank_maps[i];
+        rank_map.resize(n_steps, 0);
+        uint64_t k = 0;
+        for (uint64_t r = 0; r < n_steps; ++r) {
+            if (!node.step_is_del(r) && new_path_id[node.step_path_id(r)]) {
+                rank_map[r] = k++;
+            }
+        }
+    }
+}
+
+void graph_t::kept_path_steps(const node_t& node, const std::vector<uint64_t>& new_path_id,
+                              const std::vector<std::vector<uint64_t>>& rank_maps,
+                              std::vector<node_t::step_t>& steps) const {
+    auto new_rank = [&](const uint64_t& id, const uint64_t& rank) {
+        const uint64_t neighbor = id - _id_increment - 1;
+        if (id == 0 || neighbor >= rank_maps.size() || rank_maps[neighbor].empty()) {
+            return rank;
+        }
+        return rank_maps[neighbor][rank];
+    };
+    const uint64_t n_steps = node.path_count();
+    steps.clear();
+    steps.reserve(n_steps);
+    for (uint64_t r = 0; r < n_steps; ++r) {
+        if (node.step_is_del(r) || !new_path_id[node.step_path_id(r)]) continue;
+        node_t::step_t step = node.get_path_step(r);
+        step.path_id = new_path_id[step.path_id];
+        step.prev_rank = new_rank(step.prev_id, step.prev_rank);
+        step.next_rank = new_rank(step.next_id, step.next_rank);
+        steps.push_back(step);
+    }
+}
+
+void graph_t::drop_loaded_path_steps(const std::vector<uint64_t>& new_path_id,
+                                     std::vector<std::vector<uint64_t>>& rank_maps) {
+    path_step_rank_maps(new_path_id, rank_maps);
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(_num_threads)
+    for (uint64_t i = 0; i < node_v.size(); ++i) {
+        if (node_v[i] == nullptr) continue;
+        node_t& node = *node_v[i];
+        std::vector<node_t::step_t> steps;
+        kept_path_steps(node, new_path_id, rank_maps, steps);
+        node.clear_paths();
+        for (auto& step : steps) {
+            node.add_path_step(step);
+        }
+    }
+}
+
+void graph_t::set_path_copy(const path_handle_t& copy, const path_handle_t& source, const uint64_t& start) {
+    path_copy_t& c = _path_copies[as_integer(copy)];
+    c.source = as_integer(source);
+    c.start = start;
+    c.length = get_step_count(copy);
+}
+
+ska::flat_hash_map<uint64_t, graph_t::path_copy_t> graph_t::held_path_copies(void) const {
+    ska::flat_hash_map<uint64_t, path_copy_t> held;
+    // the copies of each source are checked together, walking the source once
+    std::map<uint64_t, std::vector<uint64_t>> copies_of;
+    for (auto& c : _path_copies) {
+        path_metadata_t* p;
+        if (c.second.length && !_path_copies.count(c.second.source)
+            && path_metadata_h->Find(c.first, p) && path_metadata_h->Find(c.second.source, p)) {
+            copies_of[c.second.source].push_back(c.first);
+        }
+    }
+    std::vector<std::pair<uint64_t, std::vector<uint64_t>>> sources(copies_of.begin(), copies_of.end());
+    std::vector<std::vector<uint64_t>> held_of(sources.size());
+#pragma omp parallel for schedule(dynamic, 1) num_threads(_num_threads)
+    for (uint64_t i = 0; i < sources.size(); ++i) {
+        uint64_t end = 0;
+        for (auto& copy : sources[i].second) {
+            const auto& c = _path_copies.at(copy);
+            end = std::max(end, c.start + c.length);
+        }
+        std::vector<handle_t> steps;
+        steps.reserve(end);
+        const path_handle_t source = as_path_handle(sources[i].first);
+        if (get_step_count(source)) {
+            for (step_handle_t step = path_begin(source);
+                 steps.size() < end && step != path_end(source); step = get_next_step(step)) {
+                steps.push_back(get_handle_of_step(step));
+            }
+        }
+        for (auto& copy : sources[i].second) {
+            const auto& c = _path_copies.at(copy);
+            if (c.start + c.length > steps.size() || get_step_count(as_path_handle(copy)) != c.length) {
+                continue;
+            }
+            const path_handle_t path = as_path_handle(copy);
+            uint64_t k = c.start;
+            step_handle_t step = path_begin(path);
+            while (step != path_end(path) && get_handle_of_step(step) == steps[k]) {
+                step = get_next_step(step);
+                ++k;
+            }
+            if (step == path_end(path)) {
+                held_of[i].push_back(copy);
+            }
+        }
+    }
+    for (auto& copies : held_of) {
+        for (auto& copy : copies) {
+            held[copy] = _path_copies.at(copy);
+        }
+    }
+    return held;
+}
+
+
+bool graph_t::read_header(std::istream& in, graph_header_t& header) {
+    // the magic number is written in network byte order by SerializableHandleGraph::serialize
+    uint32_t magic_number = 0;
+    if (!in.read((char*)&magic_number,sizeof(magic_number)) || ntohl(magic_number) != graph_t().get_magic_number()) {
+        return false;
+    }
+    return (bool)in.read((char*)&header.max_node_id,sizeof(header.max_node_id))
+        && in.read((char*)&header.min_node_id,sizeof(header.min_node_id))
+        && in.read((char*)&header.node_count,sizeof(header.node_count))
+        && in.read((char*)&header.edge_count,sizeof(header.edge_count))
+        && in.read((char*)&header.path_count,sizeof(header.path_count))
+        && in.read((char*)&header.path_handle_next,sizeof(header.path_handle_next))
+        && in.read((char*)&header.id_increment,sizeof(header.id_increment));
+}
+
+graph_header_t graph_t::current_header(void) const {
+    graph_header_t header;
+    header.max_node_id = _max_node_id;
+    header.min_node_id = _min_node_id;
+    header.node_count = node_v.size();
+    header.edge_count = _edge_count;
+    header.path_count = _path_count;
+    header.path_handle_next = _path_handle_next;
+    header.id_increment = _id_increment;
+    return header;
+}
+
+void graph_t::track_changes(void) {
+    _tracked_base = current_header();
+    _track_changes = true;
+    _all_nodes_changed = false;
+    _changed_nodes.assign((node_v.size() + 63) / 64, 0);
+}
+
+void graph_t::serialize_changes(std::ostream& out, const std::string& base_file) const {
+    if (!_track_changes) {
+        throw std::runtime_error("[odgi::graph_t] error: changes were not tracked, call track_changes before editing");
+    }
+    out.write(delta_magic, sizeof(delta_magic));
+    const uint64_t name_size = base_file.size();
+    out.write((char*)&name_size,sizeof(name_size));
+    out.write(base_file.data(), base_file.size());
+    write_counts(out, _tracked_base);
+    write_counts(out, current_header());
+    // the records past the end of the base are new, a record of a deleted node is written empty
+    std::vector<uint64_t> ranks;
+    for (uint64_t i = 0; i < node_v.size(); ++i) {
+        if (_all_nodes_changed || i >= _tracked_base.node_count
+            || (i / 64 < _changed_nodes.size() && (_changed_nodes[i / 64] >> (i % 64)) & 1)) {
+            ranks.push_back(i);
+        }
+    }
+    const uint64_t record_count = ranks.size();
+    out.write((char*)&record_count,sizeof(record_count));
+    // each record is led by its rank and size, laid out in blocks by several threads and written in order
+    const uint64_t block_count = (record_count + node_block_size - 1) / node_block_size;
+    node_t empty_node;
+    algorithms::ordered_chunk_writer writer(out);
+    writer.open_writer();
+#pragma omp parallel for schedule(dynamic, 1) num_threads(_num_threads)
+    for (uint64_t b = 0; b < block_count; ++b) {
+        std::ostringstream records;
+        std::ostringstream record;
+        const uint64_t end = std::min(record_count, (b + 1) * node_block_size);
+        for (uint64_t k = b * node_block_size; k < end; ++k) {
+            record.str("");
+            auto* node = node_v[ranks[k]];
+            if (node == nullptr) {
+                empty_node.serialize(record);
+            } else {
+                node->serialize(record);
+            }
+            const std::string bytes = record.str();
+            const uint64_t size = bytes.size();
+            records.write((char*)&ranks[k],sizeof(ranks[k]));
+            records.write((char*)&size,sizeof(size));
+            records.write(bytes.data(), bytes.size());
+        }
+        std::string text = records.str();
+        writer.append(b, text, true);
+    }
+    writer.close_writer();
+    // the paths are few next to the nodes, so all of them are written with their handles, which may have gaps
+    const uint64_t path_count = _path_count;
+    out.write((char*)&path_count,sizeof(path_count));
+    for_each_path_handle(
+        [&](const path_handle_t& path) {
+            auto& m = path_metadata(path);
+            const uint64_t handle = as_integer(path);
+            out.write((char*)&handle,sizeof(handle));
+            const uint64_t length = m.length;
+            out.write((char*)&length,sizeof(length));
+            const step_handle_t first = m.first;
+            out.write((char*)&first,sizeof(first));
+            const step_handle_t last = m.last;
+            out.write((char*)&last,sizeof(last));
+            const uint8_t circular = m.is_circular;
+            out.write((char*)&circular,sizeof(circular));
+            const uint64_t k = m.name.size();
+            out.write((char*)&k,sizeof(k));
+            out.write(m.name.data(),m.name.size());
+        });
+}
+
+bool graph_t::read_delta_base(std::istream& in, std::string& base_file) {
+    char magic[sizeof(delta_magic)];
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, delta_magic, sizeof(magic)) != 0) {
+        return false;
+    }
+    uint64_t name_size = 0;
+    if (!in.read((char*)&name_size,sizeof(name_size))) {
+        return false;
+    }
+    base_file.resize(name_size);
+    return (bool)in.read((char*)base_file.data(), name_size);
+}
+
+void graph_t::apply_changes(std::istream& in) {
+    algorithms::profile::scope_t profile_scope("apply graph delta");
+    std::string base_file;
+    graph_header_t base;
+    graph_header_t header;
+    if (!read_delta_base(in, base_file) || !read_counts(in, base) || !read_counts(in, header)) {
+        throw std::runtime_error("[odgi::graph_t] error: not a graph delta");
+    }
+    if (!same_counts(base, current_header())) {
+        throw std::runtime_error("[odgi::graph_t] error: the delta does not apply to this graph, which differs from "
+                                 + base_file + " as it was when the delta was written");
+    }
+    _path_name_index_valid.store(false);
+    ++_step_index_epoch;
+    for (uint64_t i = header.node_count; i < node_v.size(); ++i) {
+        retire_node(node_v[i]);
+    }
+    node_v.resize(header.node_count, nullptr);
+    uint64_t record_count = 0;
+    in.read((char*)&record_count,sizeof(record_count));
+    // read a block of records, then load them in parallel into fresh records, as the pool is not thread-safe
+    std::vector<uint64_t> ranks;
+    std::vector<uint64_t> offsets;
+    std::string block;
+    for (uint64_t begin = 0; begin < record_count; begin += node_block_size) {
+        const uint64_t n = std::min(node_block_size, record_count - begin);
+        ranks.resize(n);
+        offsets.assign(n + 1, 0);
+        block.clear();
+        for (uint64_t i = 0; i < n; ++i) {
+            uint64_t size = 0;
+            in.read((char*)&ranks[i],sizeof(ranks[i]));
+            in.read((char*)&size,sizeof(size));
+            if (!in || ranks[i] >= node_v.size()) {
+                throw std::runtime_error("[odgi::graph_t] error: truncated or malformed graph delta");
+            }
+            block.resize(offsets[i] + size);
+            in.read((char*)block.data() + offsets[i], size);
+            offsets[i+1] = block.size();
+            retire_node(node_v[ranks[i]]);
+            node_v[ranks[i]] = node_pool.allocate();
+            node_v[ranks[i]]->set_generation(_snapshot_generation);
+        }
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(_num_threads)
+        for (uint64_t i = 0; i < n; ++i) {
+            membuf_t buf((char*)block.data() + offsets[i], (char*)block.data() + offsets[i+1]);
+            std::istream record(&buf);
+            node_v[ranks[i]]->load(record);
+        }
+        for (uint64_t i = 0; i < n; ++i) {
+            auto& node = node_v[ranks[i]];
+            if (node->get_id() == 0) {
+                node_pool.release(node);
+                node = nullptr;
+            }
+        }
+    }
+    _max_node_id = header.max_node_id;
+    _min_node_id = header.min_node_id;
+    _edge_count = header.edge_count;
+    _id_increment = header.id_increment;
+    deleted_nodes.clear();
+    for (uint64_t i = 0; i < node_v.size(); ++i) {
+        if (node_v[i] == nullptr) {
+            deleted_nodes.insert(i + 1 + _id_increment);
+        }
+    }
+    // the paths of the delta replace those of the base
+    for_each_path_handle(
+        [&](const path_handle_t& p) {
+            auto s = get_path_name(p);
+            delete &get_path_metadata(p);
+            path_metadata_h->Delete(as_integer(p));
+            path_name_h->Delete(s);
+        });
+    uint64_t path_count = 0;
+    in.read((char*)&path_count,sizeof(path_count));
+    std::string name;
+    for (uint64_t j = 0; j < path_count; ++j) {
+        auto* m = new path_metadata_t();
+        uint64_t handle = 0;
+        uint64_t length = 0;
+        step_handle_t first;
+        step_handle_t last;
+        uint8_t circular = 0;
+        uint64_t k = 0;
+        in.read((char*)&handle,sizeof(handle));
+        in.read((char*)&length,sizeof(length));
+        in.read((char*)&first,sizeof(first));
+        in.read((char*)&last,sizeof(last));
+        in.read((char*)&circular,sizeof(circular));
+        in.read((char*)&k,sizeof(k));
+        name.resize(k);
+        in.read((char*)name.data(),k);
+        if (!in) {
+            delete m;
+            throw std::runtime_error("[odgi::graph_t] error: truncated graph delta");
+        }
+        m->handle = as_path_handle(handle);
+        m->length = length;
+        m->first = first;
+        m->last = last;
+        m->is_circular = circular;
+        m->name = path_names.add(name);
+        path_metadata_h->Insert(handle, m);
+        path_name_h->Insert(m->name, m);
+    }
+    _path_count = path_count;
+    _path_handle_next = header.path_handle_next;
+}
+
+graph_stream_writer_t::graph_stream_writer_t(std::ostream& out,
+                                             const std::vector<graph_header_t>& headers,
+                                             const uint64_t& num_threads)
+    : out(out), headers(headers), num_threads(num_threads) {
+    graph_header_t total;
+    uint64_t offset = 0;
+    for (auto& header : headers) {
+        assert(header.id_increment == 0);
+        if (header.max_node_id) {
+            if (!total.min_node_id) {
+                total.min_node_id = header.min_node_id + offset;
+            }
+            total.max_node_id = header.max_node_id + offset;
+        }
+        offset += header.node_count;
+        total.node_count += header.node_count;
+        total.edge_count += header.edge_count;
+        total.path_count += header.path_count;
+    }
+    total.path_handle_next = total.path_count;
+    const uint32_t magic_number = htonl(graph_t().get_magic_number());
+    out.write((char*)&magic_number,sizeof(magic_number));
+    out.write((char*)&total.max_node_id,sizeof(total.max_node_id));
+    out.write((char*)&total.min_node_id,sizeof(total.min_node_id));
+    out.write((char*)&total.node_count,sizeof(total.node_count));
+    out.write((char*)&total.edge_count,sizeof(total.edge_count));
+    out.write((char*)&total.path_count,sizeof(total.path_count));
+    out.write((char*)&total.path_handle_next,sizeof(total.path_handle_next));
+    out.write((char*)&total.id_increment,sizeof(total.id_increment));
+    if (total.node_count) {
+        out.write((char*)&node_block_marker,sizeof(node_block_marker));
+        out.write((char*)&node_block_size,sizeof(node_block_size));
+    }
+    block.reserve(node_block_size);
+}
+
+void graph_stream_writer_t::write_block(void) {
+    std::vector<uint64_t> offsets(block.size() + 1, 0);
+    for (uint64_t i = 0; i < block.size(); ++i) {
+        offsets[i+1] = offsets[i] + block[i].size();
+    }
+    out.write((char*)offsets.data(),offsets.size()*sizeof(uint64_t));
+    for (auto& record : block) {
+        out.write(record.c_str(),record.size());
+    }
+    block.clear();
+}
+
+void graph_stream_writer_t::append(graph_t& graph, const std::function<std::string(const std::string&)>& get_path_name) {
+    assert(appended < headers.size());
+    assert(graph.node_v.size() == headers[appended].node_count);
+    // the loaded paths are numbered in the order they were written, which the output keeps
+    std::vector<path_handle_t> paths;
+    graph.for_each_path_handle([&](const path_handle_t& path) {
+        paths.push_back(path);
+    });
+    std::sort(paths.begin(), paths.end(), [](const path_handle_t& a, const path_handle_t& b) {
+        return as_integer(a) < as_integer(b);
+    });
+    assert(paths.size() == headers[appended].path_count);
+    std::vector<uint64_t> new_path_id(paths.empty() ? 0 : as_integer(paths.back()) + 1, 0);
+    for (uint64_t i = 0; i < paths.size(); ++i) {
+        new_path_id[as_integer(paths[i])] = path_offset + i + 1;
+    }
+
+    node_t empty_node;
+    const uint64_t node_count = graph.node_v.size();
+    for (uint64_t begin = 0; begin < node_count; ) {
+        const uint64_t first = block.size();
+        const uint64_t n = std::min(node_block_size - first, node_count - begin);
+        block.resize(first + n);
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(num_threads)
+        for (uint64_t i = 0; i < n; ++i) {
+            std::ostringstream record;
+            auto* node = graph.node_v[begin + i];
+            if (node == nullptr) {
+                empty_node.serialize(record);
+            } else {
+                node->set_id(node->get_id() + node_offset);
+                node->apply_path_ordering([&](uint64_t path_id) {
+                    return new_path_id[path_id];
+                });
+                node->serialize(record);
+            }
+            block[first + i] = record.str();
+        }
+        begin += n;
+        if (block.size() == node_block_size) {
+            write_block();
+        }
+    }
+
+    // the steps of the path ends point at the node ranks, in the number part of their handles
+    auto shift_step = [&](const step_handle_t& step) {
+        step_handle_t shifted = step;
+        as_integers(shifted)[0] += node_offset << 1;
+        return shifted;
+    };
+    for (auto& path : paths) {
+        auto& m = graph.path_metadata(path);
+        const uint64_t length = m.length;
+        const step_handle_t first = length ? shift_step(m.first.load()) : m.first.load();
+        const step_handle_t last = length ? shift_step(m.last.load()) : m.last.load();
+        const std::string name = get_path_name(std::string(m.name));
+        const size_t k = name.size();
+        path_records.append((const char*)&length,sizeof(length));
+        path_records.append((const char*)&first,sizeof(first));
+        path_records.append((const char*)&last,sizeof(last));
+        path_records.append((const char*)&k,sizeof(k));
+        path_records.append(name);
+    }
+
+    node_offset += node_count;
+    path_offset += paths.size();
+    ++appended;
+}
+
+void graph_stream_writer_t::finish(void) {
+    assert(appended == headers.size());
+    if (!block.empty()) {
+        write_block();
+    }
+    out.write(path_records.data(),path_records.size());
+    std::string().swap(path_records);
+    out.flush();
+}
 
 void graph_t::set_number_of_threads(uint64_t num_threads) {
     _num_threads = num_threads;
@@ -1700,6 +3508,131 @@ uint64_t graph_t::get_number_of_threads() {
     return _num_threads;
 }
 
+void graph_t::move_from(graph_t& other) {
+    if (other._live_snapshot_count.load()) {
+        // the records are still seen by snapshots of the other graph
+        copy(other);
+        other.clear();
+        return;
+    }
+    clear();
+    _max_node_id.store(other._max_node_id);
+    _min_node_id.store(other._min_node_id);
+    _edge_count.store(other._edge_count);
+    _path_handle_next.store(other._path_handle_next);
+    _id_increment.store(other._id_increment);
+    deleted_nodes = std::move(other.deleted_nodes);
+    node_v.resize(other.node_v.size(), nullptr);
+    for (size_t i = 0; i < other.node_v.size(); ++i) {
+        node_t*& source = other.node_v[i];
+        if (source == nullptr) continue;
+        node_v[i] = node_pool.allocate();
+        node_v[i]->take(*source);
+        other.node_pool.release(source);
+        source = nullptr;
+    }
+    // the steps refer to the paths by handle, so the metadata keeps the handles of the other graph
+    other.for_each_path_handle(
+        [&](const path_handle_t& path) {
+            const auto& m = other.path_metadata(path);
+            auto* p = new path_metadata_t();
+            p->copy(m);
+            p->name = path_names.add(m.name);
+            path_metadata_h->Insert(as_integer(path), p);
+            path_name_h->Insert(p->name, p);
+            ++_path_count;
+        });
+    _path_name_index_valid.store(false);
+    other.clear();
+}
+
+std::shared_ptr<const graph_t> graph_t::snapshot(void) {
+    reclaim_snapshot_nodes();
+    // the records written so far are stamped with an older generation, so edits copy them from now on
+    const uint32_t generation = ++_snapshot_generation;
+    auto* view = new graph_t();
+    view->_snapshot_of = this;
+    view->_num_threads = _num_threads;
+    view->_max_node_id.store(_max_node_id);
+    view->_min_node_id.store(_min_node_id);
+    view->_edge_count.store(_edge_count);
+    view->_path_handle_next.store(_path_handle_next);
+    view->_id_increment.store(_id_increment);
+    view->node_v = node_v;
+    view->deleted_nodes = deleted_nodes;
+    for_each_path_handle(
+        [&](const path_handle_t& path) {
+            const auto& m = path_metadata(path);
+            auto* p = new path_metadata_t();
+            p->copy(m);
+            p->name = view->path_names.add(m.name);
+            view->path_metadata_h->Insert(as_integer(path), p);
+            view->path_name_h->Insert(p->name, p);
+            ++view->_path_count;
+        });
+    {
+        std::lock_guard<std::mutex> guard(_snapshot_mutex);
+        _live_snapshots.insert(generation);
+        ++_live_snapshot_count;
+    }
+    // the last reader may drop the snapshot on any thread, the records are reclaimed by the graph
+    return std::shared_ptr<const graph_t>(
+        view,
+        [this, generation](const graph_t* g) {
+            delete g;
+            std::lock_guard<std::mutex> guard(_snapshot_mutex);
+            _live_snapshots.erase(generation);
+            --_live_snapshot_count;
+        });
+}
+
+void graph_t::reclaim_snapshot_nodes(void) {
+    uint32_t oldest = std::numeric_limits<uint32_t>::max();
+    {
+        std::lock_guard<std::mutex> guard(_snapshot_mutex);
+        if (!_live_snapshots.empty()) {
+            oldest = *_live_snapshots.begin();
+        }
+    }
+    // a record retired under generation g can only be seen by the snapshots up to g
+    while (!_retired_nodes.empty() && _retired_nodes.front().first < oldest) {
+        node_pool.release(_retired_nodes.front().second);
+        _retired_nodes.pop_front();
+    }
+}
+
+bool graph_t::is_snapshot(void) const {
+    return _snapshot_of != nullptr;
+}
+
+void graph_t::share(const graph_t& other) {
+    clear();
+    // as for a snapshot, the records belong to the other graph, which is not edited while they are shared
+    _snapshot_of = &other;
+    _step_indexes_of = &other;
+    _max_node_id.store(other._max_node_id);
+    _min_node_id.store(other._min_node_id);
+    _edge_count.store(other._edge_count);
+    _path_handle_next.store(other._path_handle_next);
+    _id_increment.store(other._id_increment);
+    node_v = other.node_v;
+    deleted_nodes = other.deleted_nodes;
+    other.for_each_path_handle(
+        [&](const path_handle_t& path) {
+            const auto& m = other.path_metadata(path);
+            auto* p = new path_metadata_t();
+            p->copy(m);
+            p->name = path_names.add(m.name);
+            path_metadata_h->Insert(as_integer(path), p);
+            path_name_h->Insert(p->name, p);
+            ++_path_count;
+        });
+}
+
+bool graph_t::loads_all_paths(void) const {
+    return !_load_topology_only && !_load_path_filter;
+}
+
 void graph_t::copy(const graph_t& other) {
     clear();
     _max_node_id.store(other._max_node_id);
@@ -1708,9 +3641,10 @@ void graph_t::copy(const graph_t& other) {
     _path_count.store(other._path_count);
     _path_handle_next.store(other._path_handle_next);
     _id_increment.store(other._id_increment);
+    _path_copies = other._path_copies;
     node_v.resize(other.node_v.size());
     for (size_t i = 0; i < other.node_v.size(); ++i) {
-        node_v[i] = new node_t;
+        node_v[i] = node_pool.allocate();
         auto* node = node_v[i];
         node->copy(other.get_node_cref(as_handle(i)));
     }
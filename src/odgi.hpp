@@ -31,10 +31,16 @@
 #include "dna.hpp"
 #include "hash_map.hpp"
 #include "node.hpp"
+#include "node_pool.hpp"
 
 #include <omp.h>
 #include "atomic_bitvector.hpp"
 #include <mutex>
+#include <type_traits>
+#include <string_view>
+#include <memory>
+#include <set>
+#include <deque>
 
 namespace odgi {
 
@@ -43,6 +49,18 @@ using namespace handlegraph;
 // Resolve ambiguous nid_t typedef by putting it in our namespace.
 using nid_t = handlegraph::nid_t;
 
+/// The leading counts of a serialized graph, readable without loading it
+struct graph_header_t {
+    nid_t max_node_id = 0;
+    nid_t min_node_id = 0;
+    /// the node records, including those of deleted nodes
+    uint64_t node_count = 0;
+    uint64_t edge_count = 0;
+    uint64_t path_count = 0;
+    uint64_t path_handle_next = 0;
+    nid_t id_increment = 0;
+};
+
 class graph_t : public MutablePathDeletableHandleGraph, public SerializableHandleGraph, public RankedHandleGraph {
 
 public:
@@ -51,7 +69,7 @@ public:
         // set up initial delimiters
         path_metadata_h = std::make_unique<lockfree::LockFreeHashTable<uint64_t,
                                                                        path_metadata_t*>>();
-        path_name_h = std::make_unique<lockfree::LockFreeHashTable<std::string,
+        path_name_h = std::make_unique<lockfree::LockFreeHashTable<std::string_view,
                                                                    path_metadata_t*>>();
         _edge_count = 0;
         _path_count = 0;
@@ -84,6 +102,21 @@ public:
     /// Get the sequence of a node, presented in the handle's local forward orientation.
     std::string get_sequence(const handle_t& handle) const;
 
+    /// Returns one base of a handle's sequence, in the orientation of the handle.
+    char get_base(const handle_t& handle, size_t index) const;
+
+    /// Whether the node has a run of at least two of the base c, which must not be one of ACGT.
+    /// Does not decode the sequence.
+    bool has_base_run(const handle_t& handle, char c) const;
+
+    /// Returns a substring of a handle's sequence, in the orientation of the handle.
+    /// Only the requested range is decoded.
+    std::string get_subsequence(const handle_t& handle, size_t index, size_t size) const;
+
+    /// Append the sequence of a handle, in its orientation, to out.
+    /// Reusing out across calls avoids allocating a string per node.
+    void append_sequence(const handle_t& handle, std::string& out) const;
+
 protected:
     /// Loop over all the handles to next/previous (right/left) nodes. Passes
     /// them to a callback which returns false to stop iterating and true to
@@ -184,6 +217,31 @@ public:
     std::vector<step_handle_t> steps_of_handle(const handle_t& handle,
                                                bool match_orientation = false) const;
 
+    /// Fills steps with the steps of a node on paths, reusing its storage.
+    void steps_of_handle(const handle_t& handle, std::vector<step_handle_t>& steps,
+                         bool match_orientation = false) const;
+
+    /// The visit_* functions are inlineable versions of the for_each_* iteratees, for hot loops
+    /// that know they hold a graph_t. The visitor may return void, or a bool that is false to stop,
+    /// and the visit returns false if it was stopped.
+
+    /// Visit all the nodes in their local forward orientation, in their internal order.
+    template<typename Visitor>
+    bool visit_handles(const Visitor& visitor) const;
+
+    /// Visit the handles reached by following the edges on the left or right of the handle.
+    template<typename Visitor>
+    bool visit_edges(const handle_t& handle, bool go_left, const Visitor& visitor) const;
+
+    /// Visit the steps on a node. A visitor taking a step_handle_t and a path_handle_t
+    /// also gets the path of each step, read from the step record without any locking.
+    template<typename Visitor>
+    bool visit_steps_on_handle(const handle_t& handle, const Visitor& visitor) const;
+
+    /// Visit the steps of a path, from first through last.
+    template<typename Visitor>
+    bool visit_steps_in_path(const path_handle_t& path, const Visitor& visitor) const;
+
 protected:
 
     /// Execute a function on each path in the graph
@@ -238,8 +296,34 @@ public:
     path_handle_t get_path_handle_of_step(const step_handle_t& step_handle) const;
 
     /// Returns the 0-based ordinal rank of a step on a path
+    /// Uses the step index of the path, which is built on the first query after the path changes
     size_t get_ordinal_rank_of_step(const step_handle_t& step_handle) const;
 
+    /// Returns the 0-based offset of the first base of a step on its path
+    size_t get_position_of_step(const step_handle_t& step_handle) const;
+
+    /// Returns the step at the given 0-based rank on the path, or path_end if the path is shorter
+    step_handle_t get_step_at_rank(const path_handle_t& path_handle, size_t rank) const;
+
+    /// Returns the step covering the given 0-based offset on the path, or path_end if the path is shorter
+    step_handle_t get_step_at_position(const path_handle_t& path_handle, size_t position) const;
+
+    /// Build the step indexes of all paths now, in parallel, rather than on their first queries
+    void index_path_steps(const uint64_t& nthreads);
+
+    /// Drop the step indexes of all paths, for edits made to the node records outside of graph_t
+    void invalidate_path_step_indexes(void);
+
+    /// Loop over the paths whose names start with the prefix, in the order of their names
+    /// Uses the sorted path name index, which is built on first use after paths are added or removed
+    void for_each_path_with_prefix(const std::string& prefix, const std::function<void(const path_handle_t&)>& iteratee) const;
+
+    /// Group the paths by the part of their PanSN names (sample#haplotype#contig) before the fields-th '#',
+    /// so 1 groups them by sample and 2 by haplotype. The last field is always taken as the contig, so
+    /// sample#contig names group by sample, and a name without any '#' is a group of its own
+    /// The groups come in the order of their names, each with its paths in handle order
+    std::vector<std::pair<std::string, std::vector<path_handle_t>>> pansn_path_groups(const uint64_t& fields) const;
+
     /// Returns true if the given path is empty, and false otherwise
     bool is_empty(const path_handle_t& path_handle) const;
 
@@ -258,6 +342,11 @@ public:
     /// Create a new node with the given id and sequence, then return the handle.
     handle_t create_handle(const std::string& sequence, const nid_t& id);
 
+    /// Append count nodes with the ids following the last node, the i-th one with the sequence
+    /// get_sequence(i), and return the handle of the first. The node records are allocated at once
+    /// and get_sequence is called in parallel, so it must be safe to call concurrently.
+    handle_t create_handles(const uint64_t& count, const std::function<std::string(const uint64_t&)>& get_sequence);
+
     /// Remove the node belonging to the given handle and all of its edges.
     /// Does not update any stored paths.
     /// Invalidates the destroyed handle.
@@ -266,10 +355,21 @@ public:
     /// May **NOT** be called on the node from which edges are being followed during follow_edges.
     void destroy_handle(const handle_t& handle);
 
+    /// Remove a batch of handles and all edges incident to them. Each surviving neighbor's edge list
+    /// is rewritten once, in parallel, instead of once per removed edge. As with destroy_handle, the
+    /// paths are not updated and should not step on the removed handles.
+    void destroy_handles(const std::vector<handle_t>& handles);
+
     /// Create an edge connecting the given handles in the given order and orientations.
     /// Ignores existing edges.
     void create_edge(const handle_t& left, const handle_t& right);
 
+    /// Create many edges at once, ignoring existing and repeated ones.
+    /// Each node's edge list is filled by a single thread, so hub nodes do not
+    /// serialize concurrent inserts the way repeated create_edge calls do.
+    /// Must not run concurrently with other edge mutations.
+    void create_edges(const std::vector<edge_t>& edges);
+
     /// Check if an edge exists
     bool has_edge(const handle_t& left, const handle_t& right) const;
 
@@ -283,6 +383,10 @@ public:
     /// Does not update any stored paths.
     void destroy_edge(const handle_t& left, const handle_t& right);
 
+    /// Remove a batch of edges, rewriting each affected node's edge list once and in parallel.
+    /// Ignores nonexistent edges. Does not update any stored paths.
+    void destroy_edges(const std::vector<edge_t>& edges);
+
     /// Convenient wrapper for destroy_edge.
     inline void destroy_edge(const edge_t& edge) {
         destroy_edge(edge.first, edge.second);
@@ -315,7 +419,8 @@ public:
     /// smallest node identifier is 1 and largest node identifier is equal to get_node_count()
     bool is_optimized(void);
 
-    /// Reassign the node ids
+    /// Reassign the node ids, get_new_id returning 0 to keep an id. The new ids must be distinct.
+    /// get_new_id is called concurrently from _num_threads threads.
     void reassign_node_ids(const std::function<nid_t(const nid_t&)>& get_new_id);
 
     /// Reorder the graph's paths as given.
@@ -361,6 +466,13 @@ public:
      */
     void destroy_path(const path_handle_t& path);
 
+    /**
+     * Keep only the paths for which keep is true, dropping the steps of the others from the nodes in
+     * one parallel pass that compacts the steps of each node, so no copy of the graph is needed.
+     * The kept paths are renumbered in their order, which invalidates handles to paths and steps.
+     */
+    void keep_paths(const std::function<bool(const path_handle_t&)>& keep);
+
     /**
      * Create a path with the given name. The caller must ensure that no path
      * with the given name exists already, or the behavior is undefined.
@@ -384,6 +496,13 @@ public:
      */
     step_handle_t append_step(const path_handle_t& path, const handle_t& to_append);
 
+    /**
+     * Append the given visits to the end of the path, in order. Returns handles
+     * to the new steps. The step records are written grouped by node, so each
+     * node is locked twice per call rather than once per step.
+     */
+    std::vector<step_handle_t> append_steps(const path_handle_t& path, const std::vector<handle_t>& to_append);
+
     /**
      * Insert a visit to a node to the given path between the given steps.
      * Returns a handle to the new step on the path which is appended.
@@ -402,8 +521,13 @@ public:
     /// A helper function to visualize the state of the graph
     void display(void) const;
 
-    /// Convert to GFA (for debugging)
-    void to_gfa(std::ostream& out, const bool& emit_node_annotation = false) const;
+    /// Convert to GFA. The S and L lines of ranges of nodes and the P line of each path are
+    /// formatted in nthreads threads and written in order; with bgzip, as BGZF blocks. With
+    /// pansn_walks, the paths named sample#haplotype#contig[:start-end] become GFA 1.1 W lines, whose
+    /// start and end are * without a range, so that reading them back gives the same names
+    void to_gfa(std::ostream& out, const bool& emit_node_annotation = false,
+                const uint64_t& nthreads = 1, const bool& bgzip = false,
+                const bool& pansn_walks = false) const;
 
     /// Magic number header for serialization
     uint32_t get_magic_number(void) const;
@@ -414,6 +538,75 @@ public:
     /// Load
     void deserialize_members(std::istream& in);
 
+    /// Write the node records of the next serializations as deflated blocks, compressed in parallel, which
+    /// loading detects and inflates in parallel. It pays off where reading the file costs more than inflating it.
+    void set_compressed_serialization(const bool& compress);
+
+    /// Note that the steps of copy are those of source from its start-th step on, as for an annotation injected
+    /// over a path, so that serialize writes copy as a reference to that run of source rather than as steps of
+    /// its own, which loading expands again. Notes that no longer hold when saving are ignored, as are copies
+    /// of copies. Not thread-safe.
+    void set_path_copy(const path_handle_t& copy, const path_handle_t& source, const uint64_t& start);
+
+    /// Choose what the next loads keep of the paths: with topology_only, no paths and no steps,
+    /// which are then not even decoded; otherwise the paths whose names keep_path accepts, or all
+    /// of them without keep_path. The kept paths are numbered again from 1 in their stored order.
+    void set_path_loading(const bool& topology_only,
+                          const std::function<bool(const std::string_view&)>& keep_path = nullptr);
+
+    /// Read the header of a graph written by serialize, false if the stream does not hold one
+    static bool read_header(std::istream& in, graph_header_t& header);
+
+    /// Start recording which node records change, so that serialize_changes can write the edits since
+    /// now as a delta over the graph as it is now, saved in full elsewhere
+    void track_changes(void);
+
+    /// Write the node records that changed since track_changes and all the path metadata as a delta
+    /// over the graph stored in base_file, which the loader applies on top of that file
+    void serialize_changes(std::ostream& out, const std::string& base_file) const;
+
+    /// Whether the stream holds a delta written by serialize_changes, setting the name of its base file
+    static bool read_delta_base(std::istream& in, std::string& base_file);
+
+    /// Apply a delta written by serialize_changes to this graph, which must be its base as it was saved
+    void apply_changes(std::istream& in);
+
+    /// Counters of the node allocator, to check slab use and reuse
+    const node_pool_t::stats_t& get_node_allocation_stats(void) const;
+
+    /// Where the bytes of the graph go, on the heap and in the serialized graph, see measure_memory
+    struct memory_breakdown_t {
+        struct bytes_t {
+            uint64_t memory = 0;
+            uint64_t serialized = 0;
+            bytes_t& operator+=(const bytes_t& other) {
+                memory += other.memory;
+                serialized += other.serialized;
+                return *this;
+            }
+        };
+        bytes_t node_records; // the node table and the fixed part of each record
+        bytes_t sequences;
+        bytes_t edges;
+        bytes_t path_steps;
+        bytes_t path_metadata; // the metadata and the names of the paths
+        bytes_t hash_tables; // the path tables and the set of deleted nodes
+        /// the nodes and the bytes of their sequences, edges and steps, by bucket of node degree (edge
+        /// records) and of path depth (steps); bucket 0 holds 0, bucket b > 0 holds [2^(b-1), 2^b)
+        struct bucket_t {
+            uint64_t nodes = 0;
+            bytes_t bytes;
+        };
+        std::vector<bucket_t> by_degree;
+        std::vector<bucket_t> by_depth;
+        bytes_t total(void) const;
+    };
+
+    /// Measure the graph, in parallel over its nodes. The serialized bytes are those of an uncompressed
+    /// graph without path copies, and the bytes of the hash tables and the path step indexes are estimates
+    /// or left out, so the report is a guide to what compaction pays off rather than an exact account.
+    memory_breakdown_t measure_memory(void) const;
+
     void set_number_of_threads(uint64_t num_threads);
 
     uint64_t get_number_of_threads();
@@ -421,6 +614,33 @@ public:
     /// copy the other graph into this one
     void copy(const graph_t& other);
 
+    /// Move the other graph into this one, leaving it empty. The nodes are moved in id order into
+    /// fresh contiguous storage, each handing over its edges, steps and sequence and being released
+    /// from the other graph right away, so the two graphs together stay close to the size of one.
+    void move_from(graph_t& other);
+
+    /// Take a read-only snapshot of the graph, which keeps showing the graph as it is now while the
+    /// graph goes on being edited. The snapshot shares the node records: as long as it is held, an edit
+    /// writes to a copy of the node and the old record is kept for the snapshot, so taking one costs
+    /// a pointer per node and a copy of the path metadata. Readers may use the snapshot from any
+    /// thread during edits. Take snapshots between edits, release them before the graph goes away,
+    /// and note that optimize() leaves the node storage uncompacted while any is held.
+    std::shared_ptr<const graph_t> snapshot(void);
+
+    /// Give the node records kept for released snapshots back to the node storage
+    void reclaim_snapshot_nodes(void);
+
+    /// If this graph is a snapshot of another one
+    bool is_snapshot(void) const;
+
+    /// Make this graph a read-only view of other, sharing its node records and the step indexes of its
+    /// paths, so that several read-only jobs work against a graph loaded once. Costs a pointer per node
+    /// and a copy of the path metadata; other must outlive the view and stay unedited while it is held.
+    void share(const graph_t& other);
+
+    /// Whether the next loads keep every path, see set_path_loading
+    bool loads_all_paths(void) const;
+
 /// These are the backing data structures that we use to fulfill the above functions
 
     /// Records the handle to node_id mapping
@@ -431,8 +651,30 @@ public:
     // TODO use it in create_handle and friends
     std::atomic_flag node_lock = ATOMIC_FLAG_INIT;
     std::vector<node_t*> node_v; // not threadsafe
+    /// slab storage backing node_v, compacted by optimize()
+    node_pool_t node_pool;
     node_t& get_node_ref(const handle_t& handle) const;
     const node_t& get_node_cref(const handle_t& handle) const;
+    /// The node to edit, copied first if a live snapshot may still see the current record
+    node_t& get_writable_node(const handle_t& handle);
+    /// Drop a node from the graph, keeping its record while a live snapshot may see it
+    void retire_node(node_t* node);
+    /// Set in a snapshot, whose node records belong to this graph
+    const graph_t* _snapshot_of = nullptr;
+    /// Set in a view made by share, whose path step indexes are those of this graph
+    const graph_t* _step_indexes_of = nullptr;
+    /// Bumped by each snapshot, node records stamped with an older generation may be in a snapshot
+    uint32_t _snapshot_generation = 0;
+    std::atomic<uint64_t> _live_snapshot_count = 0;
+    /// generations of the snapshots that are still held
+    std::set<uint32_t> _live_snapshots;
+    std::mutex _snapshot_mutex;
+    /// records taken out of the graph while in a snapshot, with the generation of the newest snapshot then
+    std::deque<std::pair<uint32_t, node_t*>> _retired_nodes;
+    inline bool node_in_snapshot(const node_t* node) const {
+        return _live_snapshot_count.load(std::memory_order_acquire)
+            && node->get_generation() < _snapshot_generation;
+    }
     /// Mark deleted nodes here for translating graph ids into internal ranks
     //dyn::hacked_vector deleted_nodes;
     hash_set<uint64_t> deleted_nodes;
@@ -441,6 +683,58 @@ public:
     std::atomic<nid_t> _min_node_id = 0;
     std::atomic<nid_t> _id_increment = 0;
     uint64_t _num_threads = 1;
+    /// the node records changed since track_changes, one bit per rank, set concurrently by editors
+    std::vector<uint64_t> _changed_nodes;
+    bool _track_changes = false;
+    /// set by the edits that rewrite every record, such as reordering or renumbering the nodes
+    bool _all_nodes_changed = false;
+    /// the counts of the graph when track_changes was called, checked against the base of a delta
+    graph_header_t _tracked_base;
+    /// the counts that serialize would write now
+    graph_header_t current_header(void) const;
+    inline void mark_changed(const uint64_t& rank) {
+        if (_track_changes && rank / 64 < _changed_nodes.size()) {
+            __atomic_fetch_or(&_changed_nodes[rank / 64], (uint64_t)1 << (rank % 64), __ATOMIC_RELAXED);
+        }
+    }
+    /// grow the change bits with node_v, which is only resized by a single thread
+    inline void track_node_count(void) {
+        if (_track_changes) {
+            _changed_nodes.resize((node_v.size() + 63) / 64, 0);
+        }
+    }
+    /// whether serialize_members deflates the node blocks
+    bool _compress_serialization = false;
+    /// what deserialize_members loads of the paths, see set_path_loading
+    bool _load_topology_only = false;
+    std::function<bool(const std::string_view&)> _load_path_filter;
+    /// a path whose steps are those of its source from the start-th step on, see set_path_copy
+    struct path_copy_t {
+        uint64_t source = 0;
+        uint64_t start = 0;
+        uint64_t length = 0;
+    };
+    /// the noted copies, by path id
+    ska::flat_hash_map<uint64_t, path_copy_t> _path_copies;
+    /// The noted copies that still match their sources, which serialize writes as references
+    ska::flat_hash_map<uint64_t, path_copy_t> held_path_copies(void) const;
+    /// The new rank of each step of the nodes that lose some of their steps when the paths mapped to 0
+    /// by new_path_id are dropped, empty for the nodes that keep them all
+    void path_step_rank_maps(const std::vector<uint64_t>& new_path_id,
+                             std::vector<std::vector<uint64_t>>& rank_maps) const;
+    /// The steps of the node that are kept, renumbered and relinked to the new ranks of their neighbors
+    void kept_path_steps(const node_t& node, const std::vector<uint64_t>& new_path_id,
+                         const std::vector<std::vector<uint64_t>>& rank_maps,
+                         std::vector<node_t::step_t>& steps) const;
+    /// Drop the steps of the paths that are not kept from the loaded node records, fixing the ranks of
+    /// the other steps; new_path_id maps a stored path id to its new one, or 0 to drop its path
+    void drop_loaded_path_steps(const std::vector<uint64_t>& new_path_id,
+                                std::vector<std::vector<uint64_t>>& rank_maps);
+
+    /// Rewrite the first and last steps of each path for new node ranks and orientations, get_new_id
+    /// mapping the current rank + 1 of a node to its new rank + 1
+    void remap_path_metadata(const std::function<uint64_t(uint64_t)>& get_new_id,
+                             const std::function<bool(uint64_t)>& to_flip);
 
     inline void canonicalize_edge(handle_t& left, handle_t& right) const {
         if (number_bool_packing::unpack_bit(left) && number_bool_packing::unpack_bit(right)
@@ -451,14 +745,35 @@ public:
         }
     }
 
+    /// Every step_index_sample-th step of a path, with its offset, so that the rank and offset of any
+    /// step are found by walking back at most step_index_sample steps to the last sampled one
+    static const uint64_t step_index_sample = 64;
+    struct step_index_t {
+        std::vector<step_handle_t> steps;
+        std::vector<uint64_t> offsets;
+        ska::flat_hash_map<step_handle_t, uint64_t> sample_of;
+        uint64_t length = 0;
+    };
+
+    /// Epoch of the step indexes, bumped by the edits that change step handles or node lengths
+    std::atomic<uint64_t> _step_index_epoch = 1;
+
     struct path_metadata_t {
         std::atomic<path_handle_t> handle = as_path_handle(0);
         std::atomic<uint64_t> length;
         std::atomic<step_handle_t> first;
         std::atomic<step_handle_t> last;
-        std::string name;
+        /// a view of the name in the path name arena of the graph
+        std::string_view name;
         std::atomic<bool> is_circular;
+        /// held while the step index is built
         std::atomic_flag lock = ATOMIC_FLAG_INIT;
+        /// the step index is valid while its epoch matches the one of the graph, 0 when the path changed
+        std::atomic<step_index_t*> step_index = nullptr;
+        std::atomic<uint64_t> step_index_epoch = 0;
+        ~path_metadata_t(void) {
+            delete step_index.load();
+        }
         inline void get_lock(void) {
             while (lock.test_and_set(std::memory_order_acquire))  // acquire lock
                 ; // spin
@@ -466,19 +781,35 @@ public:
         inline void clear_lock(void) {
             lock.clear(std::memory_order_release);
         }
+        /// copy all but the name, which must already be in the arena of this graph
         void copy(const path_metadata_t& other) {
             handle.store(other.handle);
             length.store(other.length);
             first.store(other.first);
             last.store(other.last);
-            name = other.name;
             is_circular.store(other.is_circular);
         }
     };
 
+    /// Packs the path names into large blocks that are never moved, so that the metadata and the
+    /// name table hold views of a single copy of each name rather than strings of their own.
+    /// The names of destroyed paths are only released when the graph is cleared.
+    class name_arena_t {
+        static const uint64_t block_size = 1 << 20;
+        std::vector<std::unique_ptr<char[]>> blocks;
+        uint64_t used = block_size;
+        std::atomic_flag lock = ATOMIC_FLAG_INIT;
+    public:
+        std::string_view add(const std::string_view& name);
+        void clear(void);
+        /// about the bytes of the blocks, counting the longer blocks of long names as ordinary ones
+        uint64_t bytes(void) const { return blocks.size() * block_size; }
+    };
+    name_arena_t path_names;
+
     /// maps between path identifier and the start, end, and length of the path
     std::unique_ptr<lockfree::LockFreeHashTable<uint64_t, path_metadata_t*>> path_metadata_h;
-    std::unique_ptr<lockfree::LockFreeHashTable<std::string, path_metadata_t*>> path_name_h;
+    std::unique_ptr<lockfree::LockFreeHashTable<std::string_view, path_metadata_t*>> path_name_h;
     path_metadata_t& get_path_metadata(const path_handle_t& path) const;
     const path_metadata_t& path_metadata(const path_handle_t& path) const;
 
@@ -509,6 +840,15 @@ public:
     /// Helper to stitch up partially built paths
     void link_steps(const step_handle_t& from, const step_handle_t& to);
 
+    /// Get the step index of the path, building it if the path changed since it was last built
+    const step_index_t& path_step_index(const path_handle_t& path) const;
+
+    /// The path handles sorted by name, valid while _path_name_index_valid is set
+    mutable std::vector<path_handle_t> _path_name_index;
+    mutable std::atomic<bool> _path_name_index_valid = false;
+    mutable std::mutex _path_name_index_mutex;
+    const std::vector<path_handle_t>& path_name_index(void) const;
+
     /// Decrement the step rank references for this step
     void decrement_rank(const step_handle_t& step_handle);
 
@@ -523,6 +863,147 @@ public:
 
 };
 
+namespace graph_visit {
+/// Call the visitor, treating a visitor that returns nothing as one that never stops
+template<typename Visitor, typename... Args>
+inline bool call(const Visitor& visitor, Args&&... args) {
+    if constexpr (std::is_void_v<std::invoke_result_t<const Visitor&, Args...>>) {
+        visitor(std::forward<Args>(args)...);
+        return true;
+    } else {
+        return visitor(std::forward<Args>(args)...);
+    }
+}
+}
+
+template<typename Visitor>
+bool graph_t::visit_handles(const Visitor& visitor) const {
+    for (uint64_t i = 0; i < node_v.size(); ++i) {
+        if (node_v[i] == nullptr) continue;
+        if (!graph_visit::call(visitor, number_bool_packing::pack(i, false))) return false;
+    }
+    return true;
+}
+
+template<typename Visitor>
+bool graph_t::visit_edges(const handle_t& handle, bool go_left, const Visitor& visitor) const {
+    const node_t& node = get_node_cref(handle);
+    const nid_t node_id = number_bool_packing::unpack_number(handle) + 1 + _id_increment;
+    const bool is_rev = number_bool_packing::unpack_bit(handle);
+    uint64_t other_ids[RECORD_DECODE_BLOCK];
+    bool other_revs[RECORD_DECODE_BLOCK], to_currs[RECORD_DECODE_BLOCK], on_revs[RECORD_DECODE_BLOCK];
+    const uint64_t n_edges = node.edge_count();
+    for (uint64_t begin = 0; begin < n_edges; begin += RECORD_DECODE_BLOCK) {
+        const uint64_t end = std::min(begin + RECORD_DECODE_BLOCK, n_edges);
+        node.decode_edges(begin, end, other_ids, other_revs, to_currs, on_revs);
+        for (uint64_t k = 0; k < end - begin; ++k) {
+            const nid_t other_id = other_ids[k];
+            bool other_rev = other_revs[k];
+            bool to_curr = to_currs[k];
+            const bool on_rev = on_revs[k];
+            if (other_id == node_id && on_rev == other_rev) {
+                // non-inverting self loop
+                // we can go either direction
+                to_curr = go_left;
+                other_rev = is_rev;
+            } else if (is_rev != on_rev) {
+                other_rev ^= 1;
+                to_curr ^= 1;
+            }
+            if (go_left == to_curr) {
+                const handle_t other = number_bool_packing::pack(other_id - _id_increment - 1, other_rev);
+                if (!graph_visit::call(visitor, other)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+template<typename Visitor>
+bool graph_t::visit_steps_on_handle(const handle_t& handle, const Visitor& visitor) const {
+    constexpr bool with_path = std::is_invocable_v<const Visitor&, const step_handle_t&, const path_handle_t&>;
+    const uint64_t handle_n = number_bool_packing::unpack_number(handle);
+    const node_t& node = get_node_cref(handle);
+    // only the orientation and deletion flags of the steps are needed, decoded a block at a time
+    bool is_rev[RECORD_DECODE_BLOCK], is_del[RECORD_DECODE_BLOCK];
+    const uint64_t n_steps = node.path_count();
+    step_handle_t step_handle;
+    for (uint64_t begin = 0; begin < n_steps; begin += RECORD_DECODE_BLOCK) {
+        const uint64_t end = std::min(begin + RECORD_DECODE_BLOCK, n_steps);
+        node.decode_step_flags(begin, end, is_rev, is_del);
+        for (uint64_t rank = begin; rank < end; ++rank) {
+            if (is_del[rank-begin]) continue;
+            as_integers(step_handle)[0] = as_integer(number_bool_packing::pack(handle_n, is_rev[rank-begin]));
+            as_integers(step_handle)[1] = rank;
+            bool keep_going;
+            if constexpr (with_path) {
+                keep_going = graph_visit::call(visitor, (const step_handle_t&)step_handle,
+                                               as_path_handle(node.step_path_id(rank)));
+            } else {
+                keep_going = graph_visit::call(visitor, (const step_handle_t&)step_handle);
+            }
+            if (!keep_going) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+template<typename Visitor>
+bool graph_t::visit_steps_in_path(const path_handle_t& path, const Visitor& visitor) const {
+    if (is_empty(path)) return true;
+    step_handle_t step = path_begin(path);
+    const step_handle_t end_step = path_back(path);
+    while (true) {
+        if (!graph_visit::call(visitor, (const step_handle_t&)step)) {
+            return false;
+        }
+        // in circular paths, we'll always have a next step, so we always check if we're at our path's last step
+        if (step != end_step && has_next_step(step)) {
+            step = get_next_step(step);
+        } else {
+            return true;
+        }
+    }
+}
+
+/// Writes several graphs one after the other as a single graph in the serialized format of graph_t,
+/// without building it. The node records of each graph are shifted past those of the graphs before it,
+/// which only changes their ids and path ids, as their edges and steps are stored relative to the node.
+/// The header is written up front from the headers of all the graphs, so only the graph being appended
+/// needs to be in memory. The graphs must not use an id increment.
+class graph_stream_writer_t {
+public:
+
+    graph_stream_writer_t(std::ostream& out, const std::vector<graph_header_t>& headers, const uint64_t& num_threads);
+
+    /// Append the next graph, which must match the next of the headers, renaming its paths with get_path_name.
+    /// Its node records are shifted in place, so the graph must be dropped afterwards.
+    void append(graph_t& graph, const std::function<std::string(const std::string&)>& get_path_name);
+
+    /// Write the pending node records and the paths, once all graphs are appended
+    void finish(void);
+
+private:
+
+    std::ostream& out;
+    std::vector<graph_header_t> headers;
+    uint64_t num_threads;
+    uint64_t appended = 0;
+    /// the node records and paths of the graphs appended so far
+    uint64_t node_offset = 0;
+    uint64_t path_offset = 0;
+    /// the records of the node block being filled
+    std::vector<std::string> block;
+    /// the path metadata, written after all node records
+    std::string path_records;
+
+    void write_block(void);
+};
+
 //const static uint64_t path_begin_marker = std::numeric_limits<uint64_t>::max();
 //const static uint64_t path_end_marker = 2;
 
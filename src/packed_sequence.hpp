@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include "dna.hpp"
+
+namespace odgi {
+
+/// A node sequence stored as 2-bit codes.
+/// Up to 32 bases live inline in the object, longer sequences in a word array.
+/// Bases other than ACGT (N, IUPAC codes, lowercase) are kept in a sorted exception list,
+/// which is only allocated when there are any.
+class packed_sequence_t {
+public:
+    packed_sequence_t(void) = default;
+    packed_sequence_t(const packed_sequence_t& other) { *this = other; }
+    ~packed_sequence_t(void) { release(); }
+
+    packed_sequence_t& operator=(const packed_sequence_t& other) {
+        if (this == &other) return *this;
+        release();
+        length = other.length;
+        if (length > inline_bases) {
+            const uint64_t n = word_count(length);
+            codes.words = new uint64_t[n];
+            std::copy(other.codes.words, other.codes.words + n, codes.words);
+        } else {
+            codes.word = other.codes.word;
+        }
+        if (other.exceptions) {
+            exceptions = new std::vector<std::pair<uint64_t, char>>(*other.exceptions);
+        }
+        return *this;
+    }
+
+    /// Exchange the stored sequences, without copying either
+    void swap(packed_sequence_t& other) {
+        std::swap(length, other.length);
+        std::swap(codes, other.codes);
+        std::swap(exceptions, other.exceptions);
+    }
+
+    /// Replace the stored sequence
+    void assign(const std::string& seq) {
+        release();
+        length = seq.size();
+        if (length > inline_bases) {
+            codes.words = new uint64_t[word_count(length)]();
+        } else {
+            codes.word = 0;
+        }
+        if (pack_2bit(seq.data(), length, data()) > 0) {
+            exceptions = new std::vector<std::pair<uint64_t, char>>();
+            for (uint64_t i = dna_find_non_2bit(seq.data(), length); i < length;
+                 i += 1 + dna_find_non_2bit(seq.data() + i + 1, length - i - 1)) {
+                exceptions->push_back(std::make_pair(i, seq[i]));
+            }
+        }
+    }
+
+    /// Number of bases
+    uint64_t size(void) const {
+        return length;
+    }
+
+    /// The forward base at the given position
+    char at(uint64_t i) const {
+        if (exceptions) {
+            auto e = std::lower_bound(exceptions->begin(), exceptions->end(), std::make_pair(i, (char)0));
+            if (e != exceptions->end() && e->first == i) {
+                return e->second;
+            }
+        }
+        return dna_from_2bit(get_2bit(data(), i));
+    }
+
+    /// Write the forward bases in [index, index+n) to out, which must hold n chars
+    void copy_to(char* out, uint64_t index, uint64_t n) const {
+        unpack_2bit(data(), index, n, out);
+        if (exceptions) {
+            for (auto e = std::lower_bound(exceptions->begin(), exceptions->end(), std::make_pair(index, (char)0));
+                 e != exceptions->end() && e->first < index + n; ++e) {
+                out[e->first - index] = e->second;
+            }
+        }
+    }
+
+    /// Append the forward bases in [index, index+n) to out
+    void append_to(std::string& out, uint64_t index, uint64_t n) const {
+        const uint64_t begin = out.size();
+        out.resize(begin + n);
+        if (n) {
+            copy_to(&out[begin], index, n);
+        }
+    }
+
+    /// Decode the whole forward sequence
+    std::string str(void) const {
+        std::string s;
+        append_to(s, 0, length);
+        return s;
+    }
+
+    /// Reverse complement the stored sequence
+    void reverse_complement(void) {
+        std::string s = str();
+        reverse_complement_in_place(s);
+        assign(s);
+    }
+
+    void clear(void) {
+        release();
+    }
+
+    /// The bytes held on the heap, beyond the object itself
+    uint64_t memory_bytes(void) const {
+        return (length > inline_bases ? word_count(length) * sizeof(uint64_t) : 0)
+            + (exceptions ? sizeof(*exceptions) + exceptions->capacity() * sizeof((*exceptions)[0]) : 0);
+    }
+
+    /// Whether the base c, which must not be one of ACGT, occurs at two adjacent positions.
+    /// Only the exception list is scanned, so this is free for nodes without such bases.
+    bool has_exception_run(char c) const {
+        if (!exceptions) {
+            return false;
+        }
+        for (uint64_t i = 1; i < exceptions->size(); ++i) {
+            const auto& prev = (*exceptions)[i - 1];
+            const auto& curr = (*exceptions)[i];
+            if (curr.second == c && prev.second == c && prev.first + 1 == curr.first) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    static const uint64_t inline_bases = 32;
+    uint64_t length = 0;
+    union {
+        uint64_t word;
+        uint64_t* words;
+    } codes = {0};
+    std::vector<std::pair<uint64_t, char>>* exceptions = nullptr;
+
+    static inline uint64_t word_count(uint64_t bases) {
+        return (bases + 31) / 32;
+    }
+    inline const uint64_t* data(void) const {
+        return length > inline_bases ? codes.words : &codes.word;
+    }
+    inline uint64_t* data(void) {
+        return length > inline_bases ? codes.words : &codes.word;
+    }
+    void release(void) {
+        if (length > inline_bases) {
+            delete[] codes.words;
+        }
+        codes.word = 0;
+        length = 0;
+        delete exceptions;
+        exceptions = nullptr;
+    }
+};
+
+}
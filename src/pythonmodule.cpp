@@ -1,16 +1,45 @@
 // odgi
 #include "odgi.hpp"
+#include "algorithms/layout.hpp"
 
 // Pybind11
 #include <pybind11/pybind11.h>
 #include <pybind11/functional.h>
 #include <pybind11/iostream.h>
 #include <pybind11/stl.h>
+#include <pybind11/numpy.h>
 
 namespace py = pybind11;
 
 using namespace odgi;
 
+// Hand the vector to NumPy without copying it: the array views its data and frees it with the capsule
+template<typename T>
+py::array_t<T> to_numpy(std::vector<T>&& values, const std::vector<py::ssize_t>& shape) {
+    auto* owned = new std::vector<T>(std::move(values));
+    py::capsule free_when_done(owned, [](void* v) { delete reinterpret_cast<std::vector<T>*>(v); });
+    return py::array_t<T>(shape, owned->data(), free_when_done);
+}
+
+template<typename T>
+py::array_t<T> to_numpy(std::vector<T>&& values) {
+    const py::ssize_t n = values.size();
+    return to_numpy(std::move(values), {n});
+}
+
+// The handles of the graph in the order of for_each_handle
+inline std::vector<handlegraph::handle_t> all_handles(const odgi::graph_t& g) {
+    std::vector<handlegraph::handle_t> handles;
+    handles.reserve(g.get_node_count());
+    g.for_each_handle([&](const handlegraph::handle_t& h) { handles.push_back(h); });
+    return handles;
+}
+
+// A handle as its id, negated when it is reverse
+inline int64_t signed_id(const odgi::graph_t& g, const handlegraph::handle_t& h) {
+    return g.get_is_reverse(h) ? -g.get_id(h) : g.get_id(h);
+}
+
 PYBIND11_MODULE(odgi, m)
 {
 
@@ -90,11 +119,105 @@ PYBIND11_MODULE(odgi, m)
              "Loop over all handles to next/previous (False and True, respectively) nodes. Passes them to a callback which returns False to stop iterating and True to continue.  Returns True if we finished and False if we stopped early.")
         .def("for_each_handle",
              [](const odgi::graph_t& g, const std::function<bool(const handlegraph::handle_t&)>& iteratee, bool parallel) {
+                 if (parallel) {
+                     // the threads take turns on the GIL to call back into Python
+                     py::gil_scoped_release release;
+                     return g.for_each_handle([&iteratee](const handlegraph::handle_t& h) {
+                         py::gil_scoped_acquire acquire;
+                         iteratee(h);
+                         return true;
+                     }, true);
+                 }
                  return g.for_each_handle([&iteratee](const handlegraph::handle_t& h){ iteratee(h); return true; }, parallel);
              },
-             "Iterate over all the nodes in the graph.",
+             "Iterate over all the nodes in the graph. With parallel, the iteratee is called from several threads, one at a time.",
              py::arg("iteratee"),
              py::arg("parallel") = false)
+        .def("node_ids",
+             [](const odgi::graph_t& g) {
+                 std::vector<int64_t> ids;
+                 ids.reserve(g.get_node_count());
+                 g.for_each_handle([&](const handlegraph::handle_t& h) { ids.push_back(g.get_id(h)); });
+                 return to_numpy(std::move(ids));
+             },
+             "Return the ids of all nodes as a NumPy array, in the order of for_each_handle.")
+        .def("node_lengths",
+             [](const odgi::graph_t& g, const uint64_t& nthreads) {
+                 std::vector<uint64_t> values;
+                 {
+                     py::gil_scoped_release release;
+                     const std::vector<handlegraph::handle_t> handles = all_handles(g);
+                     values.resize(handles.size());
+#pragma omp parallel for schedule(static) num_threads(nthreads)
+                     for (uint64_t i = 0; i < handles.size(); ++i) {
+                         values[i] = g.get_length(handles[i]);
+                     }
+                 }
+                 return to_numpy(std::move(values));
+             },
+             "Return the lengths of all nodes as a NumPy array, in the order of for_each_handle. Filled in nthreads threads, without the GIL.",
+             py::arg("nthreads") = 1)
+        .def("node_depths",
+             [](const odgi::graph_t& g, const uint64_t& nthreads) {
+                 std::vector<uint64_t> values;
+                 {
+                     py::gil_scoped_release release;
+                     const std::vector<handlegraph::handle_t> handles = all_handles(g);
+                     values.resize(handles.size());
+#pragma omp parallel for schedule(static) num_threads(nthreads)
+                     for (uint64_t i = 0; i < handles.size(); ++i) {
+                         values[i] = g.get_step_count(handles[i]);
+                     }
+                 }
+                 return to_numpy(std::move(values));
+             },
+             "Return the number of path steps on each node as a NumPy array, in the order of for_each_handle. Filled in nthreads threads, without the GIL.",
+             py::arg("nthreads") = 1)
+        .def("edges",
+             [](const odgi::graph_t& g) {
+                 std::vector<int64_t> edges;
+                 g.for_each_edge([&](const handlegraph::edge_t& e) {
+                     edges.push_back(signed_id(g, e.first));
+                     edges.push_back(signed_id(g, e.second));
+                     return true;
+                 });
+                 const py::ssize_t n = edges.size() / 2;
+                 return to_numpy(std::move(edges), {n, 2});
+             },
+             "Return all edges as an (E, 2) NumPy array of the node ids on their sides, negated for reverse handles.")
+        .def("path_steps",
+             [](const odgi::graph_t& g, const handlegraph::path_handle_t& path) {
+                 std::vector<int64_t> steps;
+                 {
+                     py::gil_scoped_release release;
+                     steps.reserve(g.get_step_count(path));
+                     g.for_each_step_in_path(path, [&](const handlegraph::step_handle_t& s) {
+                         steps.push_back(signed_id(g, g.get_handle_of_step(s)));
+                     });
+                 }
+                 return to_numpy(std::move(steps));
+             },
+             "Return the steps of the path as a NumPy array of node ids, negated for reverse steps.",
+             py::arg("path"))
+        .def("path_lengths",
+             [](const odgi::graph_t& g, const uint64_t& nthreads) {
+                 std::vector<uint64_t> lengths;
+                 {
+                     py::gil_scoped_release release;
+                     std::vector<handlegraph::path_handle_t> paths;
+                     g.for_each_path_handle([&](const handlegraph::path_handle_t& p) { paths.push_back(p); });
+                     lengths.resize(paths.size());
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+                     for (uint64_t i = 0; i < paths.size(); ++i) {
+                         g.for_each_step_in_path(paths[i], [&](const handlegraph::step_handle_t& s) {
+                             lengths[i] += g.get_length(g.get_handle_of_step(s));
+                         });
+                     }
+                 }
+                 return to_numpy(std::move(lengths));
+             },
+             "Return the length in bp of each path as a NumPy array, in the order of for_each_path_handle, one path per thread of nthreads, without the GIL.",
+             py::arg("nthreads") = 1)
         .def("get_node_count",
              &odgi::graph_t::get_node_count,
              "Return the number of nodes in the graph.")
@@ -193,11 +316,18 @@ PYBIND11_MODULE(odgi, m)
         .def("get_path_handle_of_step",
              &graph_t::get_path_handle_of_step,
              "Returns a handle to the path that an step is on.")
-        /*
         .def("get_ordinal_rank_of_step",
              &odgi::graph_t::get_ordinal_rank_of_step,
-             "Returns the 0-based ordinal rank of a step on a path. (warning: not implemented in odgi)")
-        */
+             "Returns the 0-based ordinal rank of a step on a path.")
+        .def("get_position_of_step",
+             &odgi::graph_t::get_position_of_step,
+             "Returns the 0-based offset of the first base of a step on its path.")
+        .def("get_step_at_rank",
+             &odgi::graph_t::get_step_at_rank,
+             "Returns the step at the given 0-based rank on the path, or the path end if the path is shorter.")
+        .def("get_step_at_position",
+             &odgi::graph_t::get_step_at_position,
+             "Returns the step covering the given 0-based offset on the path, or the path end if the path is shorter.")
         .def("is_empty",
              &odgi::graph_t::is_empty,
              "Returns true if the given path is empty, and false otherwise.")
@@ -244,11 +374,13 @@ PYBIND11_MODULE(odgi, m)
              &odgi::graph_t::apply_ordering,
              "Reorder the graph's internal structure to match that given.\nOptionally compact the id space of the graph to match the ordering, from 1->|ordering|.",
              py::arg("order"),
-             py::arg("compact_ids") = false)
+             py::arg("compact_ids") = false,
+             py::call_guard<py::gil_scoped_release>())
         .def("optimize",
              &odgi::graph_t::optimize,
              "Organize the graph for better performance and memory use.",
-             py::arg("allow_id_reassignment") = false)
+             py::arg("allow_id_reassignment") = false,
+             py::call_guard<py::gil_scoped_release>())
         .def("apply_path_ordering",
              &odgi::graph_t::apply_path_ordering,
              "Reorder the graph's paths as given.")
@@ -310,14 +442,65 @@ PYBIND11_MODULE(odgi, m)
                  std::ofstream out(file.c_str());
                  g.serialize(out);
              },
-             "Save the graph to the given file, returning the number of bytes written.")
+             "Save the graph to the given file, returning the number of bytes written.",
+             py::call_guard<py::gil_scoped_release>())
         .def("load",
              [](odgi::graph_t& g, const std::string& file) {
                  std::ifstream in(file.c_str());
                  g.deserialize(in);
              },
-             "Load the graph from the given file.")
+             "Load the graph from the given file.",
+             py::call_guard<py::gil_scoped_release>())
         // Definition of class_<odgi::graph_t> ends here.
     ;
 
+    py::class_<odgi::algorithms::layout::Layout>(m, "layout", "a 2D layout of the graph, with a point for each end of each node")
+        .def(py::init<>())
+        .def("load",
+             [](odgi::algorithms::layout::Layout& l, const std::string& file) {
+                 l.load(file);
+             },
+             "Load the layout from the given file. Binary layouts are memory mapped.",
+             py::call_guard<py::gil_scoped_release>())
+        .def("size",
+             &odgi::algorithms::layout::Layout::size,
+             "The number of points in the layout, two per node.")
+        .def("is_binary",
+             &odgi::algorithms::layout::Layout::is_binary,
+             "Whether the layout was loaded from the binary layout format.")
+        .def("metadata",
+             &odgi::algorithms::layout::Layout::metadata,
+             "The metadata stored in a binary layout.")
+        .def("coords",
+             [](odgi::algorithms::layout::Layout& l, const handlegraph::handle_t& h) {
+                 const auto xy = l.coords(h);
+                 return std::make_pair(xy.x, xy.y);
+             },
+             "The (x, y) coordinates of the point where the handle starts.")
+        .def("origin",
+             [](const odgi::algorithms::layout::Layout& l) {
+                 const auto xy = l.binary_origin();
+                 return std::make_pair(xy.x, xy.y);
+             },
+             "The origin the points of a binary layout are stored relative to.")
+        .def("points",
+             [](py::object self) {
+                 auto& l = self.cast<odgi::algorithms::layout::Layout&>();
+                 const py::ssize_t n = l.size();
+                 if (l.is_binary()) {
+                     // a read-only view of the mapped float32 pairs, keeping the layout alive
+                     py::array_t<float> points({n, (py::ssize_t)2}, l.binary_data(), self);
+                     points.attr("setflags")(py::arg("write") = false);
+                     return py::array(points);
+                 }
+                 std::vector<double> points(2 * n);
+                 for (py::ssize_t i = 0; i < n; ++i) {
+                     points[2 * i] = l.get_x(i);
+                     points[2 * i + 1] = l.get_y(i);
+                 }
+                 return py::array(to_numpy(std::move(points), {n, (py::ssize_t)2}));
+             },
+             "The points as an (n, 2) NumPy array. For binary layouts this is a zero-copy float32 view relative to origin(), otherwise a float64 copy of the absolute coordinates.")
+    ;
+
 }
@@ -0,0 +1,472 @@
+/**
+ * \file rle_path_graph.cpp: contains the implementation of RLEPathHandleGraph
+ */
+
+#include "rle_path_graph.hpp"
+#include "algorithms/path_tasks.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace odgi {
+
+namespace {
+
+/// the record of the path front ends, whose position is their path
+const uint64_t front_end_record = std::numeric_limits<uint64_t>::max();
+
+step_handle_t make_step(const uint64_t& record, const uint64_t& position) {
+    step_handle_t step;
+    as_integers(step)[0] = record;
+    as_integers(step)[1] = position;
+    return step;
+}
+
+uint64_t step_record(const step_handle_t& step) {
+    return as_integers(step)[0];
+}
+
+uint64_t step_position(const step_handle_t& step) {
+    return as_integers(step)[1];
+}
+
+}
+
+RLEPathHandleGraph::RLEPathHandleGraph(const HandleGraph* topology) : topology(topology) {
+    // record 0 holds the path starts
+    records.emplace_back();
+}
+
+void RLEPathHandleGraph::add_paths(const PathHandleGraph& source, const uint64_t& nthreads) {
+    std::vector<path_handle_t> path_handles;
+    source.for_each_path_handle([&](const path_handle_t& path) {
+        path_handles.push_back(path);
+    });
+    // the paths are walked in parallel in batches, but must go in one by one, as each insertion
+    // moves the visits of the paths inserted before it
+    const uint64_t batch_size = std::max((uint64_t)1, nthreads);
+    std::vector<std::vector<handle_t>> batch;
+    for (uint64_t i = 0; i < path_handles.size(); i += batch_size) {
+        const uint64_t batch_end = std::min((uint64_t)path_handles.size(), i + batch_size);
+        batch.assign(batch_end - i, std::vector<handle_t>());
+#pragma omp parallel for schedule(dynamic, 1) num_threads(batch_size)
+        for (uint64_t j = i; j < batch_end; ++j) {
+            auto& handles = batch[j - i];
+            handles.reserve(source.get_step_count(path_handles[j]));
+            source.for_each_step_in_path(path_handles[j], [&](const step_handle_t& step) {
+                const handle_t h = source.get_handle_of_step(step);
+                handles.push_back(topology->get_handle(source.get_id(h), source.get_is_reverse(h)));
+            });
+        }
+        for (uint64_t j = i; j < batch_end; ++j) {
+            rle_path_t path;
+            path.name = source.get_path_name(path_handles[j]);
+            path.is_circular = source.get_is_circular(path_handles[j]);
+            path_rank[path.name] = paths.size();
+            paths.push_back(path);
+            insert_path(batch[j - i]);
+        }
+    }
+
+    // walk the paths from their starts, to find their ends and sample the steps that know their path
+    std::vector<uint64_t> costs(started_paths.size());
+    for (uint64_t j = 0; j < started_paths.size(); ++j) {
+        costs[j] = paths[started_paths[j]].step_count;
+    }
+    std::vector<std::vector<std::pair<step_handle_t, uint64_t>>> samples(batch_size);
+    algorithms::run_tasks(costs, batch_size, [&](const uint64_t& j, const uint64_t& tid) {
+        const uint64_t pid = started_paths[j];
+        rle_path_t& path = paths[pid];
+        step_handle_t step;
+        next_visit(make_step(0, j), step);
+        path.first = step;
+        uint64_t count = 1;
+        step_handle_t next;
+        while (next_visit(step, next)) {
+            if (count % sample_interval == 0) {
+                samples[tid].push_back(std::make_pair(step, pid));
+            }
+            step = next;
+            ++count;
+        }
+        path.last = step;
+        samples[tid].push_back(std::make_pair(step, pid));
+    });
+    for (auto& thread_samples : samples) {
+        for (auto& sample : thread_samples) {
+            sampled_path[sample.first] = sample.second;
+        }
+    }
+}
+
+void RLEPathHandleGraph::insert_path(const std::vector<handle_t>& handles) {
+    paths.back().step_count = handles.size();
+    if (handles.empty()) {
+        return;
+    }
+    // open the records first, so that the references below stay valid
+    std::vector<uint64_t> visited(handles.size());
+    for (uint64_t i = 0; i < handles.size(); ++i) {
+        auto f = record_of_handle.find(as_integer(handles[i]));
+        if (f == record_of_handle.end()) {
+            visited[i] = records.size();
+            record_of_handle[as_integer(handles[i])] = records.size();
+            records.emplace_back();
+            records.back().handle = handles[i];
+        } else {
+            visited[i] = f->second;
+        }
+    }
+    // the new path starts after all the others
+    started_paths.push_back(paths.size() - 1);
+    uint64_t u = 0;
+    uint64_t position_u = records[0].size;
+    uint32_t successor = successor_index(records[0], visited[0]);
+    insert_visit(records[0], position_u, successor);
+    for (uint64_t i = 0; i < visited.size(); ++i) {
+        const uint64_t w = visited[i];
+        // the visit comes after those from u that come before it in u
+        const uint64_t before = rank(records[u], position_u, successor);
+        const uint64_t position_w = add_predecessor_visit(records[w], u) + before;
+        successor = successor_index(records[w], i + 1 < visited.size() ? visited[i + 1] : 0);
+        insert_visit(records[w], position_w, successor);
+        u = w;
+        position_u = position_w;
+    }
+}
+
+uint64_t RLEPathHandleGraph::find_record(const handle_t& handle) const {
+    auto f = record_of_handle.find(as_integer(handle));
+    return f == record_of_handle.end() ? 0 : f->second;
+}
+
+uint32_t RLEPathHandleGraph::successor_index(record_t& record, const uint64_t& successor) {
+    for (uint32_t i = 0; i < record.successors.size(); ++i) {
+        if (record.successors[i] == successor) {
+            return i;
+        }
+    }
+    record.successors.push_back(successor);
+    return record.successors.size() - 1;
+}
+
+uint64_t RLEPathHandleGraph::add_predecessor_visit(record_t& record, const uint64_t& predecessor) {
+    auto it = std::lower_bound(record.predecessors.begin(), record.predecessors.end(),
+                               std::make_pair(predecessor, (uint64_t)0));
+    uint64_t start;
+    if (it != record.predecessors.end() && it->first == predecessor) {
+        start = it->second;
+    } else {
+        start = it == record.predecessors.end() ? record.size : it->second;
+        it = record.predecessors.insert(it, std::make_pair(predecessor, start));
+    }
+    // the groups of the later predecessors move down
+    for (++it; it != record.predecessors.end(); ++it) {
+        ++it->second;
+    }
+    return start;
+}
+
+uint64_t RLEPathHandleGraph::group_start(const record_t& record, const uint64_t& predecessor) {
+    auto it = std::lower_bound(record.predecessors.begin(), record.predecessors.end(),
+                               std::make_pair(predecessor, (uint64_t)0));
+    return it->second;
+}
+
+void RLEPathHandleGraph::insert_visit(record_t& record, const uint64_t& position, const uint32_t& successor) {
+    auto& body = record.body;
+    uint64_t offset = 0;
+    uint64_t i = 0;
+    for ( ; i < body.size() && offset + body[i].length <= position; ++i) {
+        offset += body[i].length;
+    }
+    if (i < body.size() && body[i].successor == successor) {
+        ++body[i].length;
+    } else if (i > 0 && offset == position && body[i - 1].successor == successor) {
+        ++body[i - 1].length;
+    } else if (i == body.size() || offset == position) {
+        body.insert(body.begin() + i, run_t{successor, 1});
+    } else {
+        // split the run around the new visit
+        const uint32_t head = position - offset;
+        const run_t tail = {body[i].successor, body[i].length - head};
+        body[i].length = head;
+        body.insert(body.begin() + i + 1, {run_t{successor, 1}, tail});
+    }
+    ++record.size;
+}
+
+uint64_t RLEPathHandleGraph::rank(const record_t& record, const uint64_t& position, const uint32_t& successor) {
+    uint64_t count = 0;
+    uint64_t offset = 0;
+    for (auto& run : record.body) {
+        if (offset >= position) {
+            break;
+        }
+        if (run.successor == successor) {
+            count += std::min((uint64_t)run.length, position - offset);
+        }
+        offset += run.length;
+    }
+    return count;
+}
+
+uint64_t RLEPathHandleGraph::select(const record_t& record, const uint64_t& rank, const uint32_t& successor) {
+    uint64_t remaining = rank;
+    uint64_t offset = 0;
+    for (auto& run : record.body) {
+        if (run.successor == successor) {
+            if (remaining < run.length) {
+                return offset + remaining;
+            }
+            remaining -= run.length;
+        }
+        offset += run.length;
+    }
+    return record.size;
+}
+
+uint32_t RLEPathHandleGraph::successor_at(const record_t& record, const uint64_t& position) {
+    uint64_t offset = 0;
+    for (auto& run : record.body) {
+        offset += run.length;
+        if (position < offset) {
+            return run.successor;
+        }
+    }
+    return 0;
+}
+
+bool RLEPathHandleGraph::next_visit(const step_handle_t& step, step_handle_t& next) const {
+    const record_t& from = records[step_record(step)];
+    const uint32_t successor = successor_at(from, step_position(step));
+    const uint64_t w = from.successors[successor];
+    if (w == 0) {
+        return false;
+    }
+    next = make_step(w, group_start(records[w], step_record(step))
+                     + rank(from, step_position(step), successor));
+    return true;
+}
+
+uint64_t RLEPathHandleGraph::path_of_step(const step_handle_t& step) const {
+    step_handle_t current = step;
+    step_handle_t next;
+    while (true) {
+        auto f = sampled_path.find(current);
+        if (f != sampled_path.end()) {
+            return f->second;
+        }
+        next_visit(current, next);
+        current = next;
+    }
+}
+
+uint64_t RLEPathHandleGraph::get_run_count(void) const {
+    uint64_t count = 0;
+    for (auto& record : records) {
+        count += record.body.size();
+    }
+    return count;
+}
+
+uint64_t RLEPathHandleGraph::get_visit_count(void) const {
+    uint64_t count = 0;
+    for (uint64_t i = 1; i < records.size(); ++i) {
+        count += records[i].size;
+    }
+    return count;
+}
+
+bool RLEPathHandleGraph::has_node(nid_t node_id) const {
+    return topology->has_node(node_id);
+}
+
+handle_t RLEPathHandleGraph::get_handle(const nid_t& node_id, bool is_reverse) const {
+    return topology->get_handle(node_id, is_reverse);
+}
+
+nid_t RLEPathHandleGraph::get_id(const handle_t& handle) const {
+    return topology->get_id(handle);
+}
+
+bool RLEPathHandleGraph::get_is_reverse(const handle_t& handle) const {
+    return topology->get_is_reverse(handle);
+}
+
+handle_t RLEPathHandleGraph::flip(const handle_t& handle) const {
+    return topology->flip(handle);
+}
+
+size_t RLEPathHandleGraph::get_length(const handle_t& handle) const {
+    return topology->get_length(handle);
+}
+
+std::string RLEPathHandleGraph::get_sequence(const handle_t& handle) const {
+    return topology->get_sequence(handle);
+}
+
+size_t RLEPathHandleGraph::get_node_count() const {
+    return topology->get_node_count();
+}
+
+nid_t RLEPathHandleGraph::min_node_id() const {
+    return topology->min_node_id();
+}
+
+nid_t RLEPathHandleGraph::max_node_id() const {
+    return topology->max_node_id();
+}
+
+bool RLEPathHandleGraph::follow_edges_impl(const handle_t& handle, bool go_left, const std::function<bool(const handle_t&)>& iteratee) const {
+    return topology->follow_edges(handle, go_left, iteratee);
+}
+
+bool RLEPathHandleGraph::for_each_handle_impl(const std::function<bool(const handle_t&)>& iteratee, bool parallel) const {
+    return topology->for_each_handle(iteratee, parallel);
+}
+
+size_t RLEPathHandleGraph::get_path_count() const {
+    return paths.size();
+}
+
+bool RLEPathHandleGraph::has_path(const std::string& path_name) const {
+    return path_rank.count(path_name);
+}
+
+path_handle_t RLEPathHandleGraph::get_path_handle(const std::string& path_name) const {
+    return as_path_handle(path_rank.at(path_name) + 1);
+}
+
+std::string RLEPathHandleGraph::get_path_name(const path_handle_t& path_handle) const {
+    return paths[as_integer(path_handle) - 1].name;
+}
+
+bool RLEPathHandleGraph::get_is_circular(const path_handle_t& path_handle) const {
+    return paths[as_integer(path_handle) - 1].is_circular;
+}
+
+size_t RLEPathHandleGraph::get_step_count(const path_handle_t& path_handle) const {
+    return paths[as_integer(path_handle) - 1].step_count;
+}
+
+size_t RLEPathHandleGraph::get_step_count(const handle_t& handle) const {
+    size_t count = 0;
+    const uint64_t forward = find_record(topology->forward(handle));
+    const uint64_t reverse = find_record(topology->flip(topology->forward(handle)));
+    if (forward) {
+        count += records[forward].size;
+    }
+    if (reverse) {
+        count += records[reverse].size;
+    }
+    return count;
+}
+
+handle_t RLEPathHandleGraph::get_handle_of_step(const step_handle_t& step_handle) const {
+    return records[step_record(step_handle)].handle;
+}
+
+path_handle_t RLEPathHandleGraph::get_path_handle_of_step(const step_handle_t& step_handle) const {
+    const uint64_t record = step_record(step_handle);
+    if (record == 0 || record == front_end_record) {
+        return as_path_handle(step_position(step_handle) + 1);
+    }
+    return as_path_handle(path_of_step(step_handle) + 1);
+}
+
+step_handle_t RLEPathHandleGraph::path_begin(const path_handle_t& path_handle) const {
+    const auto& path = paths[as_integer(path_handle) - 1];
+    return path.step_count ? path.first : path_end(path_handle);
+}
+
+step_handle_t RLEPathHandleGraph::path_end(const path_handle_t& path_handle) const {
+    // the visits of record 0 are never steps
+    return make_step(0, as_integer(path_handle) - 1);
+}
+
+step_handle_t RLEPathHandleGraph::path_back(const path_handle_t& path_handle) const {
+    const auto& path = paths[as_integer(path_handle) - 1];
+    return path.step_count ? path.last : path_front_end(path_handle);
+}
+
+step_handle_t RLEPathHandleGraph::path_front_end(const path_handle_t& path_handle) const {
+    return make_step(front_end_record, as_integer(path_handle) - 1);
+}
+
+bool RLEPathHandleGraph::has_next_step(const step_handle_t& step_handle) const {
+    const record_t& record = records[step_record(step_handle)];
+    return record.successors[successor_at(record, step_position(step_handle))] != 0
+        || paths[path_of_step(step_handle)].is_circular;
+}
+
+bool RLEPathHandleGraph::has_previous_step(const step_handle_t& step_handle) const {
+    const record_t& record = records[step_record(step_handle)];
+    auto group = std::upper_bound(record.predecessors.begin(), record.predecessors.end(), step_position(step_handle),
+                                  [](const uint64_t& position, const std::pair<uint64_t, uint64_t>& p) {
+                                      return position < p.second;
+                                  }) - 1;
+    return group->first != 0 || paths[path_of_step(step_handle)].is_circular;
+}
+
+step_handle_t RLEPathHandleGraph::get_next_step(const step_handle_t& step_handle) const {
+    if (step_record(step_handle) == front_end_record) {
+        return path_begin(as_path_handle(step_position(step_handle) + 1));
+    }
+    step_handle_t next;
+    if (next_visit(step_handle, next)) {
+        return next;
+    }
+    const uint64_t pid = path_of_step(step_handle);
+    return paths[pid].is_circular ? paths[pid].first : path_end(as_path_handle(pid + 1));
+}
+
+step_handle_t RLEPathHandleGraph::get_previous_step(const step_handle_t& step_handle) const {
+    const uint64_t w = step_record(step_handle);
+    if (w == 0) {
+        return path_back(as_path_handle(step_position(step_handle) + 1));
+    }
+    const record_t& record = records[w];
+    const uint64_t position = step_position(step_handle);
+    // the group of the visit tells where it comes from, and its rank in the group which visit there
+    auto group = std::upper_bound(record.predecessors.begin(), record.predecessors.end(), position,
+                                  [](const uint64_t& position, const std::pair<uint64_t, uint64_t>& p) {
+                                      return position < p.second;
+                                  }) - 1;
+    const uint64_t u = group->first;
+    const record_t& from = records[u];
+    const uint32_t successor = std::find(from.successors.begin(), from.successors.end(), w) - from.successors.begin();
+    const uint64_t position_u = select(from, position - group->second, successor);
+    if (u == 0) {
+        const uint64_t pid = started_paths[position_u];
+        return paths[pid].is_circular ? paths[pid].last : path_front_end(as_path_handle(pid + 1));
+    }
+    return make_step(u, position_u);
+}
+
+bool RLEPathHandleGraph::for_each_path_handle_impl(const std::function<bool(const path_handle_t&)>& iteratee) const {
+    for (uint64_t i = 0; i < paths.size(); ++i) {
+        if (!iteratee(as_path_handle(i + 1))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool RLEPathHandleGraph::for_each_step_on_handle_impl(const handle_t& handle, const std::function<bool(const step_handle_t&)>& iteratee) const {
+    const handle_t forward = topology->forward(handle);
+    for (const handle_t& h : {forward, topology->flip(forward)}) {
+        const uint64_t record = find_record(h);
+        if (record == 0) {
+            continue;
+        }
+        for (uint64_t i = 0; i < records[record].size; ++i) {
+            if (!iteratee(make_step(record, i))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+}
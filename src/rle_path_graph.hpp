@@ -0,0 +1,154 @@
+#pragma once
+
+/** \file
+ * rle_path_graph.hpp: defines a path handle graph whose paths are stored as run-length
+ * compressed successor records, as in the GBWT
+ */
+
+#include "hash_map.hpp"
+#include <handlegraph/handle_graph.hpp>
+#include <handlegraph/path_handle_graph.hpp>
+#include <handlegraph/util.hpp>
+#include <string>
+#include <vector>
+
+namespace odgi {
+
+using namespace handlegraph;
+
+    /**
+     * A PathHandleGraph that takes its nodes, sequences and edges from another HandleGraph and stores
+     * its paths in the manner of the GBWT. Each oriented node has a record of the visits of the paths,
+     * sorted by the reversed path prefixes leading to them, and each visit keeps only the node that
+     * the path goes to next. Haplotypes that share their recent history then sit next to each other
+     * and go on to the same node, so a record is a short list of runs of successors, whatever the
+     * number of haplotypes. A step is a position in the record of its node, and moving along a path is
+     * a rank or select over the runs of a record. Paths are added once, after which the graph is read
+     * only; the paths of the graph they came from can then be dropped.
+     */
+    class RLEPathHandleGraph : public PathHandleGraph {
+    public:
+
+        /// Build on the nodes and edges of the topology graph, which must outlive this one
+        RLEPathHandleGraph(const HandleGraph* topology);
+
+        /// Add the paths of source, which must have the nodes of the topology graph, extracting them on
+        /// nthreads threads. Call it once, before any other use of the paths.
+        void add_paths(const PathHandleGraph& source, const uint64_t& nthreads = 1);
+
+        /// The number of runs of successors over all records, against get_visit_count() steps
+        uint64_t get_run_count(void) const;
+
+        /// The number of steps over all paths
+        uint64_t get_visit_count(void) const;
+
+        //////////////////////////
+        /// HandleGraph interface
+        //////////////////////////
+
+        virtual bool has_node(nid_t node_id) const;
+        virtual handle_t get_handle(const nid_t& node_id, bool is_reverse = false) const;
+        virtual nid_t get_id(const handle_t& handle) const;
+        virtual bool get_is_reverse(const handle_t& handle) const;
+        virtual handle_t flip(const handle_t& handle) const;
+        virtual size_t get_length(const handle_t& handle) const;
+        virtual std::string get_sequence(const handle_t& handle) const;
+        virtual size_t get_node_count() const;
+        virtual nid_t min_node_id() const;
+        virtual nid_t max_node_id() const;
+
+        //////////////////////////
+        /// PathHandleGraph interface
+        //////////////////////////
+
+        virtual size_t get_path_count() const;
+        virtual bool has_path(const std::string& path_name) const;
+        virtual path_handle_t get_path_handle(const std::string& path_name) const;
+        virtual std::string get_path_name(const path_handle_t& path_handle) const;
+        virtual bool get_is_circular(const path_handle_t& path_handle) const;
+        virtual size_t get_step_count(const path_handle_t& path_handle) const;
+        virtual size_t get_step_count(const handle_t& handle) const;
+        virtual handle_t get_handle_of_step(const step_handle_t& step_handle) const;
+        virtual path_handle_t get_path_handle_of_step(const step_handle_t& step_handle) const;
+        virtual step_handle_t path_begin(const path_handle_t& path_handle) const;
+        virtual step_handle_t path_end(const path_handle_t& path_handle) const;
+        virtual step_handle_t path_back(const path_handle_t& path_handle) const;
+        virtual step_handle_t path_front_end(const path_handle_t& path_handle) const;
+        virtual bool has_next_step(const step_handle_t& step_handle) const;
+        virtual bool has_previous_step(const step_handle_t& step_handle) const;
+        virtual step_handle_t get_next_step(const step_handle_t& step_handle) const;
+        virtual step_handle_t get_previous_step(const step_handle_t& step_handle) const;
+
+    protected:
+
+        virtual bool follow_edges_impl(const handle_t& handle, bool go_left, const std::function<bool(const handle_t&)>& iteratee) const;
+        virtual bool for_each_handle_impl(const std::function<bool(const handle_t&)>& iteratee, bool parallel = false) const;
+        virtual bool for_each_path_handle_impl(const std::function<bool(const path_handle_t&)>& iteratee) const;
+        virtual bool for_each_step_on_handle_impl(const handle_t& handle, const std::function<bool(const step_handle_t&)>& iteratee) const;
+
+    private:
+        /// the successors of consecutive visits, by their index in the successors of the record
+        struct run_t {
+            uint32_t successor;
+            uint32_t length;
+        };
+
+        /// The visits of an oriented node, record 0 being the path starts, one per path in path order
+        struct record_t {
+            handle_t handle;
+            uint64_t size = 0;
+            /// the records the visits go to next, 0 for the end of a path
+            std::vector<uint64_t> successors;
+            /// the records the visits come from, sorted, with the position of the first visit from each
+            std::vector<std::pair<uint64_t, uint64_t>> predecessors;
+            std::vector<run_t> body;
+        };
+
+        struct rle_path_t {
+            std::string name;
+            bool is_circular = false;
+            uint64_t step_count = 0;
+            step_handle_t first;
+            step_handle_t last;
+        };
+
+        /// Every sample_interval-th step of a path knows its path, which other steps find by
+        /// walking forward to the next sampled step or to the last step of their path
+        static const uint64_t sample_interval = 1024;
+
+        const HandleGraph* topology = nullptr;
+        std::vector<record_t> records;
+        ska::flat_hash_map<uint64_t, uint64_t> record_of_handle;
+        std::vector<rle_path_t> paths;
+        ska::flat_hash_map<std::string, uint64_t> path_rank;
+        /// the path of the sampled steps and of the last steps
+        ska::flat_hash_map<step_handle_t, uint64_t> sampled_path;
+
+        /// The record of the oriented node, 0 if no path visits it
+        uint64_t find_record(const handle_t& handle) const;
+        /// Append a path, walking it from the path starts and inserting a visit into each record
+        void insert_path(const std::vector<handle_t>& handles);
+        /// The index of the successor in the record, added if new
+        uint32_t successor_index(record_t& record, const uint64_t& successor);
+        /// Count a new visit of the record from the predecessor, returning the position of the first
+        /// visit from the predecessor, whose group is opened if it is new
+        static uint64_t add_predecessor_visit(record_t& record, const uint64_t& predecessor);
+        /// Insert a visit going to the successor of the given index at the position
+        static void insert_visit(record_t& record, const uint64_t& position, const uint32_t& successor);
+        /// The number of visits before the position that go to the successor of the given index
+        static uint64_t rank(const record_t& record, const uint64_t& position, const uint32_t& successor);
+        /// The position of the visit that is the rank-th going to the successor of the given index
+        static uint64_t select(const record_t& record, const uint64_t& rank, const uint32_t& successor);
+        /// The index of the successor of the visit at the position
+        static uint32_t successor_at(const record_t& record, const uint64_t& position);
+        /// The position of the first visit of the record from the predecessor
+        static uint64_t group_start(const record_t& record, const uint64_t& predecessor);
+        /// Set next to the step after the given one, false if the given step ends its path
+        bool next_visit(const step_handle_t& step, step_handle_t& next) const;
+        /// The path of a step, walking forward to a step that knows it
+        uint64_t path_of_step(const step_handle_t& step) const;
+        /// the paths by their first visit in record 0
+        std::vector<uint64_t> started_paths;
+    };
+
+}
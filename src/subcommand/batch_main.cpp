@@ -0,0 +1,257 @@
+#include "subcommand.hpp"
+#include "odgi.hpp"
+#include "args.hxx"
+#include <omp.h>
+#include <cstdio>
+#include <set>
+#include <map>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include "utils.hpp"
+
+namespace odgi {
+
+using namespace odgi::subcommand;
+
+namespace {
+
+/// The subcommands that only read their input graph, which may then be shared between them
+const std::set<std::string> read_only_subcommands = {
+    "bin", "degree", "depth", "draw", "flatten", "heaps", "kmers", "layout", "matrix", "overlap",
+    "pathindex", "paths", "pav", "position", "procbed", "similarity", "stats", "stepindex", "tips",
+    "unitig", "untangle", "validate", "view"
+};
+
+/// The options of those subcommands that edit the graph they load: a view shared from the loaded graph
+/// would write into its node records
+const std::map<std::string, std::vector<std::string>> editing_options = {
+    {"paths", {"-K", "--keep-paths", "-X", "--drop-paths"}},
+    {"kmers", {"-D", "--max-degree"}}
+};
+
+/// Whether the word gives the option, alone, with its value after '=' or, for a short option, attached
+bool gives_option(const std::string& word, const std::string& option) {
+    if (word.compare(0, option.size(), option) != 0) {
+        return false;
+    }
+    return word.size() == option.size()
+        || (option[1] == '-' ? word[option.size()] == '=' : true);
+}
+
+/// Split a script line into words on blanks, keeping quoted words whole; false on an unclosed quote
+bool split_command_line(const std::string& line, std::vector<std::string>& words) {
+    std::string word;
+    bool in_word = false;
+    char quote = 0;
+    for (const char c : line) {
+        if (quote) {
+            if (c == quote) {
+                quote = 0;
+            } else {
+                word.push_back(c);
+            }
+        } else if (c == '\'' || c == '"') {
+            quote = c;
+            in_word = true;
+        } else if (c == ' ' || c == '\t') {
+            if (in_word) {
+                words.push_back(word);
+                word.clear();
+                in_word = false;
+            }
+        } else {
+            word.push_back(c);
+            in_word = true;
+        }
+    }
+    if (in_word) {
+        words.push_back(word);
+    }
+    return quote == 0;
+}
+
+}
+
+int main_batch(int argc, char **argv) {
+
+    // trick argumentparser to do the right thing with the subcommand
+    for (uint64_t i = 1; i < argc - 1; ++i) {
+        argv[i] = argv[i + 1];
+    }
+    const std::string prog_name = "odgi batch";
+    argv[0] = (char *) prog_name.c_str();
+    --argc;
+
+    args::ArgumentParser parser("Run a script of read-only subcommands against graphs loaded once.");
+    args::Group mandatory_opts(parser, "[ MANDATORY ARGUMENTS ]");
+    args::ValueFlagList<std::string> og_in_files(mandatory_opts, "FILE", "Load the succinct variation graph in ODGI format from this *FILE* once, for all the commands of the script that read it with -i, --idx. It may be given several times.", {'i', "idx"});
+    args::ValueFlag<std::string> script_file(mandatory_opts, "FILE", "Read the commands from this *FILE*, one per line as typed after *odgi*, with an optional *> FILE* to write the standard output of the command to *FILE*. Blank lines and lines starting with # are skipped. Without it, the commands are read from standard input.", {'s', "script"});
+    args::Group batch_opts(parser, "[ Batch Options ]");
+    args::Flag keep_going(batch_opts, "keep-going", "Run the remaining commands after one fails, instead of stopping at the first failure.", {'k', "keep-going"});
+    args::Group threading_opts(parser, "[ Threading ]");
+    args::ValueFlag<uint64_t> nthreads(threading_opts, "N", "Number of threads to use to load the graphs.",
+                                       {'t', "threads"});
+    args::Group processing_info_opts(parser, "[ Processing Information ]");
+    args::Flag progress(processing_info_opts, "progress", "Write the current progress to stderr.", {'P', "progress"});
+    args::Group program_info_opts(parser, "[ Program Information ]");
+    args::HelpFlag help(program_info_opts, "help", "Print a help message for odgi batch.", {'h', "help"});
+    try {
+        parser.ParseCLI(argc, argv);
+    } catch (args::Help) {
+        std::cout << parser;
+        return 0;
+    } catch (args::ParseError e) {
+        std::cerr << e.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+    if (argc == 1) {
+        std::cout << parser;
+        return 1;
+    }
+
+    if (!og_in_files) {
+        std::cerr << "[odgi::batch] error: please specify the graphs to load once via -i=[FILE], --idx=[FILE]." << std::endl;
+        return 1;
+    }
+
+    std::vector<std::vector<std::string>> commands;
+    std::vector<std::string> outputs;
+    {
+        std::ifstream script_in;
+        if (script_file && args::get(script_file) != "-") {
+            script_in.open(args::get(script_file));
+            if (!script_in) {
+                std::cerr << "[odgi::batch] error: cannot open the script \"" << args::get(script_file) << "\"." << std::endl;
+                return 1;
+            }
+        }
+        std::istream& in = script_in.is_open() ? script_in : std::cin;
+        std::string line;
+        uint64_t line_number = 0;
+        while (std::getline(in, line)) {
+            ++line_number;
+            std::vector<std::string> words;
+            if (!split_command_line(line, words)) {
+                std::cerr << "[odgi::batch] error: unclosed quote on line " << line_number << " of the script." << std::endl;
+                return 1;
+            }
+            if (words.empty() || words[0][0] == '#') {
+                continue;
+            }
+            if (words[0] == "odgi") {
+                words.erase(words.begin());
+            }
+            // the standard output of a command may go to its own file
+            std::string output;
+            for (uint64_t i = 0; i < words.size(); ++i) {
+                if (words[i] == ">" && i + 2 == words.size()) {
+                    output = words[i + 1];
+                } else if (words[i].size() > 1 && words[i][0] == '>' && i + 1 == words.size()) {
+                    output = words[i].substr(1);
+                } else {
+                    continue;
+                }
+                words.resize(i);
+                break;
+            }
+            if (words.empty() || !read_only_subcommands.count(words[0])) {
+                std::cerr << "[odgi::batch] error: line " << line_number << " of the script runs "
+                          << (words.empty() ? std::string("no command") : "'" + words[0] + "'")
+                          << ", which is not one of the read-only commands that can share a graph." << std::endl;
+                return 1;
+            }
+            // the shared graph must not be edited
+            std::vector<std::string> editing = {"--delta"};
+            auto e = editing_options.find(words[0]);
+            if (e != editing_options.end()) {
+                editing.insert(editing.end(), e->second.begin(), e->second.end());
+            }
+            for (uint64_t i = 1; i < words.size(); ++i) {
+                for (auto& option : editing) {
+                    if (gives_option(words[i], option)) {
+                        std::cerr << "[odgi::batch] error: line " << line_number << " of the script edits its input graph with "
+                                  << option << "." << std::endl;
+                        return 1;
+                    }
+                }
+            }
+            commands.push_back(words);
+            outputs.push_back(output);
+        }
+    }
+
+    const uint64_t num_threads = args::get(nthreads) ? args::get(nthreads) : 1;
+    omp_set_num_threads(num_threads);
+
+    // the graphs are loaded once and stay unedited, each command gets a view of the one it loads
+    std::vector<std::unique_ptr<graph_t>> graphs;
+    for (auto& infile : args::get(og_in_files)) {
+        graphs.push_back(std::make_unique<graph_t>());
+        utils::handle_gfa_odgi_input(infile, "batch", args::get(progress), num_threads, *graphs.back());
+        utils::share_loaded_graph(infile, graphs.back().get());
+    }
+
+    int status = 0;
+    for (uint64_t c = 0; c < commands.size(); ++c) {
+        std::vector<std::string> words = commands[c];
+        words.insert(words.begin(), "odgi");
+        std::vector<char*> command_argv;
+        for (auto& word : words) {
+            command_argv.push_back((char*)word.c_str());
+        }
+        command_argv.push_back(nullptr);
+        const int command_argc = words.size();
+        const auto* subcommand = Subcommand::get(command_argc, command_argv.data());
+        if (subcommand == nullptr) {
+            std::cerr << "[odgi::batch] error: command '" << words[1] << "' not found." << std::endl;
+            status = 1;
+            break;
+        }
+        if (args::get(progress)) {
+            std::cerr << "[odgi::batch] running command " << (c + 1) << " of " << commands.size() << ": odgi " << words[1] << std::endl;
+        }
+        // redirect the descriptor, so that both streams and C stdio of the command reach the file
+        int saved_stdout = -1;
+        if (!outputs[c].empty()) {
+            std::cout.flush();
+            fflush(stdout);
+            const int fd = open(outputs[c].c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd == -1) {
+                std::cerr << "[odgi::batch] error: cannot write to \"" << outputs[c] << "\"." << std::endl;
+                status = 1;
+                break;
+            }
+            saved_stdout = dup(STDOUT_FILENO);
+            dup2(fd, STDOUT_FILENO);
+            close(fd);
+        }
+        const int ret = (*subcommand)(command_argc, command_argv.data());
+        if (saved_stdout != -1) {
+            std::cout.flush();
+            fflush(stdout);
+            dup2(saved_stdout, STDOUT_FILENO);
+            close(saved_stdout);
+        }
+        if (ret != 0) {
+            std::cerr << "[odgi::batch] error: command " << (c + 1) << " (odgi " << words[1] << ") failed with status " << ret << "." << std::endl;
+            status = ret;
+            if (!args::get(keep_going)) {
+                break;
+            }
+        }
+    }
+
+    // the graphs go away with this command
+    for (auto& infile : args::get(og_in_files)) {
+        utils::share_loaded_graph(infile, nullptr);
+    }
+
+    return status;
+}
+
+static Subcommand odgi_batch("batch", "Run read-only commands against graphs loaded once.",
+                             PIPELINE, 3, main_batch);
+
+}
@@ -3,10 +3,13 @@
 #include "args.hxx"
 #include "algorithms/bin_path_info.hpp"
 #include "algorithms/bin_path_depth.hpp"
+#include "algorithms/bin_index.hpp"
+#include "algorithms/text_writer.hpp"
 #include "gfa_to_handle.hpp"
 #include "utils.hpp"
 
 #include <regex>
+#include <fstream>
 
 namespace odgi {
 
@@ -40,6 +43,7 @@ int main_bin(int argc, char** argv) {
     args::ValueFlag<uint64_t> num_bins(bin_opts, "N", "The number of bins the pangenome sequence should be chopped up to.", {'n', "num-bins"});
     args::ValueFlag<uint64_t> bin_width(bin_opts, "bp", "The bin width specifies the size of each bin.", {'w', "bin-width"});
     args::Flag write_seqs_not(bin_opts, "write-seqs-not", "If -j,--json is set, no nucleotide sequences will be printed to stdout in order to save disk space.", {'s', "no-seqs"});
+    args::Flag bgzip(bin_opts, "bgzip", "Compress the output of the JSON and TSV modes with BGZF, as bgzip does, which gzip reads too.", {"bgzip"});
     args::Flag drop_gap_links(bin_opts, "drop-gap-links", "Don't include gap links in the output. "
                                                           "We divide links into 2 classes:\n1. The links which help to follow complex variations. "
                                                           "They need to be drawn, else one could not follow the sequence of a path.\n"
@@ -47,6 +51,12 @@ int main_bin(int argc, char** argv) {
                                                           " Such links solely connecting a path from left to right may not be"
                                                           "relevant to understand a path's traveral through the bins. Therfore,"
                                                           " when this option is set, the gap-links are left out saving disk space.", {'g', "no-gap-links"});
+    args::Group bin_index_opts(parser, "[ Bin Index Options ]");
+    args::ValueFlag<std::string> write_bin_index(bin_index_opts, "FILE", "Write a bin index of the graph at the bin width given by -w,--bin-width=[N] to this FILE, instead of printing the bins. "
+                                                                         "It holds the bins of all paths and the pangenome sequence, so that they can be printed "
+                                                                         "at any multiple of that bin width without loading the graph again.", {'x', "write-index"});
+    args::ValueFlag<std::string> bin_index_file(bin_index_opts, "FILE", "Read the bins from this bin index FILE, written with -x,--write-index=[FILE], instead of binning the graph. "
+                                                                        "The bin width must be a multiple of the one of the index.", {'X', "bin-index"});
     args::Group haplo_blocker_opts(parser, "[ HaploBlocker Options ]");
     args::Flag haplo_blocker(haplo_blocker_opts, "haplo-blocker", "Write a TSV to stdout formatted in a "
                                                                   "way ready for HaploBlocker: Each row corresponds to a node. "
@@ -77,16 +87,26 @@ int main_bin(int argc, char** argv) {
         return 1;
     }
 
-    if (!dg_in_file) {
+    if (!dg_in_file && !bin_index_file) {
         std::cerr << "[odgi::bin] error: please specify an input file from where to load the graph via -i=[FILE], --idx=[FILE]." << std::endl;
         return 1;
     }
 
+    if (write_bin_index && bin_index_file) {
+        std::cerr << "[odgi::bin] error: please specify either -x,--write-index=[FILE] or -X,--bin-index=[FILE], not both." << std::endl;
+        return 1;
+    }
+
+    if (write_bin_index && (!args::get(bin_width) || args::get(num_bins))) {
+        std::cerr << "[odgi::bin] error: please specify the bin width of the index via -w,--bin-width=[N]." << std::endl;
+        return 1;
+    }
+
 	const uint64_t num_threads = args::get(nthreads) ? args::get(nthreads) : 1;
 
 	graph_t graph;
     assert(argc > 0);
-    if (!args::get(dg_in_file).empty()) {
+    if (dg_in_file && !args::get(dg_in_file).empty()) {
         std::string infile = args::get(dg_in_file);
         if (infile == "-") {
             graph.deserialize(std::cin);
@@ -112,6 +132,27 @@ int main_bin(int argc, char** argv) {
         }
     };
 
+    if (write_bin_index) {
+        algorithms::bin_index_t index;
+        index.build(graph, args::get(bin_width), num_threads, args::get(progress));
+        std::ofstream f(args::get(write_bin_index), std::ios::binary);
+        index.serialize(f);
+        if (!f) {
+            std::cerr << "[odgi::bin] error: could not write the bin index to " << args::get(write_bin_index) << "." << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    algorithms::bin_index_t index;
+    if (bin_index_file) {
+        std::ifstream f(args::get(bin_index_file), std::ios::binary);
+        if (!f || !index.load(f)) {
+            std::cerr << "[odgi::bin] error: " << args::get(bin_index_file) << " is not a bin index, please write one via -x,--write-index=[FILE]." << std::endl;
+            return 1;
+        }
+    }
+
     // our aggregation matrix
     std::vector<std::pair<std::string, std::vector<algorithms::path_info_t>>> table;
     if (args::get(num_bins) + args::get(bin_width) == 0) {
@@ -119,6 +160,22 @@ int main_bin(int argc, char** argv) {
         return 1;
     }
 
+    uint64_t index_bin_width = 0;
+    if (bin_index_file && !haplo_blocker) {
+        const uint64_t len = index.get_pangenome_length();
+        index_bin_width = args::get(bin_width) ? args::get(bin_width) : std::max((uint64_t) 1, len / args::get(num_bins));
+        if (index_bin_width % index.get_bin_width() != 0) {
+            std::cerr << "[odgi::bin] error: the bin width " << index_bin_width << " is not a multiple of the bin width "
+                      << index.get_bin_width() << " of the bin index." << std::endl;
+            return 1;
+        }
+    }
+
+    if (haplo_blocker && bin_index_file) {
+        std::cerr << "[odgi::bin] error: the HaploBlocker mode needs the graph, please specify it via -i=[FILE], --idx=[FILE]." << std::endl;
+        return 1;
+    }
+
     if (haplo_blocker) {
         std::cerr << "[odgi::bin] main: running in HaploBlocker mode. Ignoring input parameters -D/--path-delim, -j/--json, -a/--aggregate-delim, "
                      "-n/--num-bins, -w/--bin-width, -s/--no-seqs, -g/--no-gap-links." << std::endl;
@@ -126,7 +183,7 @@ int main_bin(int argc, char** argv) {
         uint64_t haplo_blocker_min_paths_ = args::get(haplo_blocker_min_paths) ? args::get(haplo_blocker_min_paths) : 1;
         uint64_t haplo_blocker_min_depth_ = args::get(haplo_blocker_min_depth) ? args::get(haplo_blocker_min_depth) : 1.0;
         algorithms::bin_path_depth(graph, args::get(progress),
-                                      haplo_blocker_min_paths_, haplo_blocker_min_depth_);
+                                      haplo_blocker_min_paths_, haplo_blocker_min_depth_, num_threads);
         // write header of table to stdout
 
         // for all paths, for each node and nucleotide in path --> better unordered_map https://stackoverflow.com/questions/1939953/how-to-find-if-a-given-key-exists-in-a-c-stdmap
@@ -138,6 +195,9 @@ int main_bin(int argc, char** argv) {
         // cap depth by 255
     } else {
 
+        // everything below is written through a buffer, bgzipped if asked for, in path order
+        algorithms::text_writer_t out(std::cout, args::get(bgzip), num_threads);
+
         // ODGI JSON VERSION
         const uint64_t ODGI_JSON_VERSION = 12; // this brings the exact nucleotide positions for each bin for each path referred to as ranges
 
@@ -149,34 +209,34 @@ int main_bin(int argc, char** argv) {
         std::function<void(const uint64_t&,
                            const uint64_t&)> write_header_json
                 = [&] (const uint64_t pangenome_length, const uint64_t bin_width) {
-                    std::cout << "{\"odgi_version\": " << ODGI_JSON_VERSION << ",";
-                    std::cout << "\"bin_width\": " << bin_width << ",";
-                    std::cout << "\"pangenome_length\": " << pangenome_length << "}" << std::endl;
+                    out << "{\"odgi_version\": " << ODGI_JSON_VERSION << ",";
+                    out << "\"bin_width\": " << bin_width << ",";
+                    out << "\"pangenome_length\": " << pangenome_length << "}" << '\n';
                 };
 
         std::function<void(const uint64_t&,
                            const std::string&)> write_seq_json
                 = [&](const uint64_t& bin_id, const std::string& seq) {
                     if (args::get(write_seqs_not)) {
-                        std::cout << "{\"bin_id\":" << bin_id << "}" << std::endl;
+                        out << "{\"bin_id\":" << bin_id << "}" << '\n';
                     } else {
-                        std::cout << "{\"bin_id\":" << bin_id << ","
-                                  << "\"sequence\":\"" << seq << "\"}" << std::endl;
+                        out << "{\"bin_id\":" << bin_id << ","
+                                  << "\"sequence\":\"" << seq << "\"}" << '\n';
                     }
                 };
 
         std::function<void(const vector<std::pair<uint64_t , uint64_t >>&)> write_ranges_json
                 = [&](const vector<std::pair<uint64_t , uint64_t >>& ranges) {
-                    std::cout << "[";
+                    out << "[";
                     for (int i = 0; i < ranges.size(); i++) {
                         std::pair<uint64_t, uint64_t > range = ranges[i];
                         if (i == 0) {
-                            std::cout << "[" << range.first << "," << range.second << "]";
+                            out << "[" << range.first << "," << range.second << "]";
                         } else {
-                            std::cout << "," << "[" << range.first << "," << range.second << "]";
+                            out << "," << "[" << range.first << "," << range.second << "]";
                         }
                     }
-                    std::cout << "]";
+                    out << "]";
                 };
 
         std::function<void(const std::string&,
@@ -187,35 +247,35 @@ int main_bin(int argc, char** argv) {
                       const std::map<uint64_t, algorithms::path_info_t>& bins) {
                     std::string name_prefix = get_path_prefix(path_name);
                     std::string name_suffix = get_path_suffix(path_name);
-                    std::cout << R"({"path_name":")" << path_name << "\",";
+                    out << R"({"path_name":")" << path_name << "\",";
                     if (!delim.empty()) {
-                        std::cout << "\"path_name_prefix\":\"" << name_prefix << "\","
+                        out << "\"path_name_prefix\":\"" << name_prefix << "\","
                                   << "\"path_name_suffix\":\"" << name_suffix << "\",";
                     }
-                    std::cout << "\"bins\":[";
+                    out << "\"bins\":[";
                     auto entry_it = bins.begin();
                     for (uint64_t i = 0; i < bins.size(); ++i) {
                         auto& bin_id = entry_it->first;
                         auto &info = entry_it->second;
-                        std::cout << "[" << bin_id << ","
+                        out << "[" << bin_id << ","
                                   << info.mean_depth << ","
                                   << info.mean_inv << ","
                                   << info.mean_pos << ",";
                         write_ranges_json(info.ranges);
-                        std::cout << "]";
+                        out << "]";
                         if (i+1 != bins.size()) {
-                            std::cout << ",";
+                            out << ",";
                         }
                         ++entry_it;
                     }
-                    std::cout << "]";
-                    std::cout << ",\"links\":[";
+                    out << "]";
+                    out << ",\"links\":[";
                     for (uint64_t i = 0; i < links.size(); ++i) {
                         auto &link = links[i];
-                        std::cout << "[" << link.first << "," << link.second << "]";
-                        if (i + 1 < links.size()) std::cout << ",";
+                        out << "[" << link.first << "," << link.second << "]";
+                        if (i + 1 < links.size()) out << ",";
                     }
-                    std::cout << "]}" << std::endl;
+                    out << "]}" << '\n';
                 };
 
         std::function<void(const uint64_t&,
@@ -235,7 +295,7 @@ int main_bin(int argc, char** argv) {
                         auto& bin_id = entry.first;
                         auto& info = entry.second;
                         if (info.mean_depth > 0) {
-                            std::cout << path_name << "\t"
+                            out << path_name << "\t"
                                       << name_prefix << "\t"
                                       << name_suffix << "\t"
                                       << bin_id << "\t"
@@ -244,21 +304,16 @@ int main_bin(int argc, char** argv) {
                                       << info.mean_pos << "\t"
                                       << info.ranges[0].first << "\t";
                             if (info.ranges[info.ranges.size() - 1].second == 0) {
-                                std::cout << info.ranges[info.ranges.size() - 1].first << std::endl;
+                                out << info.ranges[info.ranges.size() - 1].first << '\n';
                             } else {
-                                std::cout << info.ranges[info.ranges.size() - 1].second << std::endl;
+                                out << info.ranges[info.ranges.size() - 1].second << '\n';
                             }
                         }
                     }
                 };
 
-        if (args::get(output_json)) {
-            algorithms::bin_path_info(graph, (args::get(aggregate_delim) ? args::get(path_delim) : ""),
-                                      write_header_json,write_json, write_seq_json,
-                                      args::get(num_bins), args::get(bin_width), args::get(drop_gap_links),
-                                      args::get(progress));
-        } else {
-            std::cout << "path.name" << "\t"
+        auto write_header_tsv_columns = [&](void) {
+            out << "path.name" << "\t"
                       << "path.prefix" << "\t"
                       << "path.suffix" << "\t"
                       << "bin" << "\t"
@@ -266,12 +321,31 @@ int main_bin(int argc, char** argv) {
                       << "mean.inv" << "\t"
                       << "mean.pos" << "\t"
                       << "first.nucl" << "\t"
-                      << "last.nucl" << std::endl;
+                      << "last.nucl" << '\n';
+        };
+
+        if (bin_index_file) {
+            if (args::get(output_json)) {
+                algorithms::bin_path_info(index, write_header_json, write_json, write_seq_json,
+                                          index_bin_width, args::get(drop_gap_links), args::get(progress), num_threads);
+            } else {
+                write_header_tsv_columns();
+                algorithms::bin_path_info(index, write_header_tsv, write_tsv, write_seq_noop,
+                                          index_bin_width, args::get(drop_gap_links), args::get(progress), num_threads);
+            }
+        } else if (args::get(output_json)) {
+            algorithms::bin_path_info(graph, (args::get(aggregate_delim) ? args::get(path_delim) : ""),
+                                      write_header_json,write_json, write_seq_json,
+                                      args::get(num_bins), args::get(bin_width), args::get(drop_gap_links),
+                                      args::get(progress), num_threads);
+        } else {
+            write_header_tsv_columns();
             algorithms::bin_path_info(graph, (args::get(aggregate_delim) ? args::get(path_delim) : ""),
                                       write_header_tsv,write_tsv, write_seq_noop,
                                       args::get(num_bins), args::get(bin_width), args::get(drop_gap_links),
-                                      args::get(progress));
+                                      args::get(progress), num_threads);
         }
+        out.finish();
     }
     return 0;
 }
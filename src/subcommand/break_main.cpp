@@ -80,12 +80,14 @@ int main_break(int argc, char** argv) {
         }
     }
 
+    graph.set_number_of_threads(num_threads);
+
     const uint64_t iter_max = args::get(repeat_up_to) ? args::get(repeat_up_to) : 1;
 
     // break cycles
     if (args::get(show)) {
         std::vector<edge_t> cycle_edges
-            = algorithms::edges_inducing_cycles(graph, args::get(max_cycle_size), args::get(max_search_bp));
+            = algorithms::edges_inducing_cycles(graph, args::get(max_cycle_size), args::get(max_search_bp), iter_max, num_threads);
 
         for (auto& e : cycle_edges) {
             std::cout << graph.get_id(e.first) << (graph.get_is_reverse(e.first)?"-":"+")
@@ -95,7 +97,7 @@ int main_break(int argc, char** argv) {
         }
     } else {
         const uint64_t removed_edges
-            = algorithms::break_cycles(graph, args::get(max_cycle_size), args::get(max_search_bp), iter_max);
+            = algorithms::break_cycles(graph, args::get(max_cycle_size), args::get(max_search_bp), iter_max, num_threads);
         if (removed_edges > 0) {
             graph.clear_paths();
         }
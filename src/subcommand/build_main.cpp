@@ -1,11 +1,13 @@
 #include "subcommand.hpp"
 #include "odgi.hpp"
+#include "mmap_graph.hpp"
 #include "gfa_to_handle.hpp"
 #include "args.hxx"
 #include <cstdio>
 #include <algorithm>
 #include <filesystem>
 #include "algorithms/topological_sort.hpp"
+#include "utils.hpp"
 
 namespace odgi {
 
@@ -24,8 +26,19 @@ int main_build(int argc, char** argv) {
     args::ArgumentParser parser("Construct a dynamic succinct variation graph in ODGI format from a GFAv1.");
     args::Group mandatory_opts(parser, "[ MANDATORY OPTIONS ]");
     args::ValueFlag<std::string> gfa_file(mandatory_opts, "FILE", "GFAv1 FILE containing the nodes, edges and "
-                                                          "paths to build a dynamic succinct variation graph from.", {'g', "gfa"});
+                                                          "paths to build a dynamic succinct variation graph from. It may be gzip or bgzip compressed.", {'g', "gfa"});
     args::ValueFlag<std::string> dg_out_file(mandatory_opts, "FILE", "Write the dynamic succinct variation graph to this *FILE*. A file ending with *.og* is recommended.", {'o', "out"});
+    args::ValueFlag<std::string> mmap_out_file(mandatory_opts, "FILE", "Write the graph in the packed, read-only layout to this *FILE* instead of (or in addition to) -o, --out."
+                                                                        " Sequences are 2-bit encoded in one buffer and edges and path steps are stored in shared arrays indexed by node rank."
+                                                                        " Commands that only read the graph can memory-map it.", {'m', "to-mmap"});
+    args::Flag compress(mandatory_opts, "compress", "Deflate the node records of the graph written to -o, --out in blocks, compressed and"
+                                                   " loaded in parallel, for graphs read from storage slower than inflating them.", {"compress"});
+    args::Group append_opts(parser, "[ Appending ]");
+    args::ValueFlag<std::string> append_to(append_opts, "FILE", "Load the graph in ODGI format from this *FILE* and add to it the segments, links and paths of"
+                                                                 " -g, --gfa, instead of building the graph from scratch. Segments already in the graph must have the same"
+                                                                 " sequence, and the paths must be new, so that new haplotypes cost time in proportion to their lines.", {'a', "append"});
+    args::Flag delta(append_opts, "delta", "With -a, --append, write to -o, --out only the changes, as a delta over the appended graph"
+                                          " that ODGI commands load on top of it; odgi compact writes the graph in full.", {"delta"});
     args::Group graph_sorting(parser, "[ Graph Sorting ]");
     args::Flag optimize(graph_sorting, "optimize", "Compact the graph id space into a dense integer range.", {'O', "optimize"});
     args::Flag toposort(graph_sorting, "sort", "Apply a general topological sort to the graph and order the node ids"
@@ -63,8 +76,12 @@ int main_build(int argc, char** argv) {
 		std::cerr << "[odgi::build] error: please specify an input file to load the graph from via -g=[FILE], --gfa=[FILE]." << std::endl;
 		return 1;
     }
-    if (!dg_out_file) {
-        std::cerr << "[odgi::build] error: please specify an output file to store the graph via -o=[FILE], --out=[FILE]." << std::endl;
+    if (delta && (!append_to || !dg_out_file || mmap_out_file)) {
+        std::cerr << "[odgi::build] error: --delta requires -a, --append and -o, --out, and no -m, --to-mmap." << std::endl;
+        return 1;
+    }
+    if (!dg_out_file && !mmap_out_file) {
+        std::cerr << "[odgi::build] error: please specify an output file to store the graph via -o=[FILE], --out=[FILE] or -m=[FILE], --to-mmap=[FILE]." << std::endl;
         return 1;
     }
     {
@@ -73,7 +90,16 @@ int main_build(int argc, char** argv) {
             std::cerr << "[odgi::build] error: the given file \"" << gfa_filename << "\" does not exist. Please specify an existing input file via -g=[FILE], --gfa=[FILE]." << std::endl;
             return 1;
         }
-        if (!gfa_filename.empty()) {
+        if (append_to) {
+            utils::handle_gfa_odgi_input(args::get(append_to), "build", args::get(progress), args::get(nthreads), graph);
+            if (delta) {
+                graph.track_changes();
+            }
+            gfa_append_to_handle(gfa_filename, &graph, args::get(nthreads), args::get(progress));
+            if (args::get(optimize)) {
+                graph.optimize();
+            }
+        } else if (!gfa_filename.empty()) {
             gfa_to_handle(gfa_filename, &graph, args::get(optimize), args::get(nthreads), args::get(progress));
         }
     }
@@ -89,6 +115,10 @@ int main_build(int argc, char** argv) {
         graph.display();
     }
     const std::string outfile = args::get(dg_out_file);
+    if (delta) {
+        return utils::write_graph_delta(graph, args::get(append_to), outfile, "build");
+    }
+    graph.set_compressed_serialization(args::get(compress));
     if (!outfile.empty()) {
         if (outfile == "-") {
             graph.serialize(std::cout);
@@ -98,6 +128,11 @@ int main_build(int argc, char** argv) {
             f.close();
         }
     }
+    if (mmap_out_file) {
+        ofstream f(args::get(mmap_out_file).c_str(), std::ios::binary);
+        mmap_graph_t::freeze(graph, f);
+        f.close();
+    }
     return 0;
 }
 
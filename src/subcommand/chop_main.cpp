@@ -84,16 +84,18 @@ namespace odgi {
             }
         }
 
-        algorithms::chop(graph, args::get(chop_to), num_threads, args::get(debug));
+        graph_t chopped;
+        algorithms::chop(graph, chopped, args::get(chop_to), num_threads, args::get(debug));
+        graph.clear();
 
         {
             const std::string outfile = args::get(dg_out_file);
             if (!outfile.empty()) {
                 if (outfile == "-") {
-                    graph.serialize(std::cout);
+                    chopped.serialize(std::cout);
                 } else {
                     ofstream f(outfile.c_str());
-                    graph.serialize(f);
+                    chopped.serialize(f);
                     f.close();
                 }
             }
@@ -0,0 +1,95 @@
+#include "subcommand.hpp"
+#include "odgi.hpp"
+#include "args.hxx"
+#include <omp.h>
+#include "utils.hpp"
+
+namespace odgi {
+
+using namespace odgi::subcommand;
+
+int main_compact(int argc, char **argv) {
+
+    // trick argumentparser to do the right thing with the subcommand
+    for (uint64_t i = 1; i < argc - 1; ++i) {
+        argv[i] = argv[i + 1];
+    }
+    const std::string prog_name = "odgi compact";
+    argv[0] = (char *) prog_name.c_str();
+    --argc;
+
+    args::ArgumentParser parser("Apply a chain of deltas to their base graph and write the result in full.");
+    args::Group mandatory_opts(parser, "[ MANDATORY ARGUMENTS ]");
+    args::ValueFlag<std::string> og_in_file(mandatory_opts, "FILE", "Load the delta written with *--delta* from this *FILE*, together with the graph in ODGI format it was written over.", {'i', "idx"});
+    args::ValueFlag<std::string> og_out_file(mandatory_opts, "FILE", "Write the graph in ODGI format to this *FILE*. A file ending with *.og* is recommended.", {'o', "out"});
+    args::Group compact_opts(parser, "[ Compact Options ]");
+    args::Flag compress(compact_opts, "compress", "Deflate the node records of the written graph in parallel blocks.", {"compress"});
+    args::Group threading_opts(parser, "[ Threading ]");
+    args::ValueFlag<uint64_t> nthreads(threading_opts, "N", "Number of threads to use for parallel operations.",
+                                       {'t', "threads"});
+    args::Group processing_info_opts(parser, "[ Processing Information ]");
+    args::Flag progress(processing_info_opts, "progress", "Write the current progress to stderr.", {'P', "progress"});
+    args::Group program_info_opts(parser, "[ Program Information ]");
+    args::HelpFlag help(program_info_opts, "help", "Print a help message for odgi compact.", {'h', "help"});
+    try {
+        parser.ParseCLI(argc, argv);
+    } catch (args::Help) {
+        std::cout << parser;
+        return 0;
+    } catch (args::ParseError e) {
+        std::cerr << e.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+    if (argc == 1) {
+        std::cout << parser;
+        return 1;
+    }
+
+    if (!og_in_file || args::get(og_in_file).empty() || args::get(og_in_file) == "-") {
+        std::cerr
+            << "[odgi::compact] error: please specify an input file from where to load the delta via -i=[FILE], --idx=[FILE]."
+            << std::endl;
+        return 1;
+    }
+
+    if (!og_out_file || args::get(og_out_file).empty()) {
+        std::cerr << "[odgi::compact] error: please specify an output file to store the graph via -o=[FILE], --out=[FILE]." << std::endl;
+        return 1;
+    }
+
+    const uint64_t num_threads = args::get(nthreads) ? args::get(nthreads) : 1;
+    omp_set_num_threads(num_threads);
+
+    graph_t graph;
+    utils::handle_gfa_odgi_input(args::get(og_in_file), "compact", args::get(progress), num_threads, graph);
+
+    // the full format numbers the paths from 1, so dropped paths must not leave gaps in the handles
+    std::vector<path_handle_t> paths;
+    graph.for_each_path_handle([&](const path_handle_t& p) {
+        paths.push_back(p);
+    });
+    if (!paths.empty() && as_integer(paths.back()) != paths.size()) {
+        if (args::get(progress)) {
+            std::cerr << "[odgi::compact] renumbering " << paths.size() << " paths" << std::endl;
+        }
+        graph.apply_path_ordering(paths);
+    }
+
+    graph.set_compressed_serialization(args::get(compress));
+    const std::string outfile = args::get(og_out_file);
+    if (outfile == "-") {
+        graph.serialize(std::cout);
+    } else {
+        ofstream f(outfile.c_str());
+        graph.serialize(f);
+        f.close();
+    }
+
+    return 0;
+}
+
+static Subcommand odgi_compact("compact", "Write a graph saved as deltas in full.",
+                               PIPELINE, 3, main_compact);
+
+}
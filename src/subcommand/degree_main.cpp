@@ -5,6 +5,7 @@
 #include "subgraph/region.hpp"
 #include <omp.h>
 #include "algorithms/degree.hpp"
+#include "algorithms/ordered_chunk_writer.hpp"
 
 #include "src/algorithms/subgraph/extract.hpp"
 
@@ -130,6 +131,25 @@ int main_degree(int argc, char** argv) {
 	const uint64_t num_threads = args::get(_num_threads) ? args::get(_num_threads) : 1;
 
 	odgi::graph_t graph;
+	// the node and graph summaries only need the topology, and the subset paths alone stand in for all paths
+	// unless other paths are asked for by name
+	const bool named_paths = path_name || path_file || path_pos || path_pos_file || bed_input;
+	ska::flat_hash_set<std::string> subset_path_names;
+	if (!_subset_paths && !named_paths && !graph_degree_vec && !path_degree && !self_degree
+		&& !_windows_in && !_windows_out) {
+		graph.set_path_loading(true);
+	} else if (_subset_paths && !named_paths) {
+		std::ifstream refs(args::get(_subset_paths).c_str());
+		std::string line;
+		while (std::getline(refs, line)) {
+			if (!line.empty()) {
+				subset_path_names.insert(line);
+			}
+		}
+		graph.set_path_loading(false, [&](const std::string_view& name) {
+			return subset_path_names.count(std::string(name)) > 0;
+		});
+	}
     assert(argc > 0);
     if (!args::get(og_file).empty()) {
         std::string infile = args::get(og_file);
@@ -169,6 +189,44 @@ int main_degree(int argc, char** argv) {
 		paths_to_consider.resize(graph.get_path_count() + 1, true);
 	}
 
+	// the degree of each node, computed once in parallel and shared by all the outputs
+	std::vector<uint64_t> node_degree(graph.get_node_count() ? graph.max_node_id() - shift + 1 : 0, 0);
+	graph.for_each_handle(
+			[&](const handle_t& h) {
+				node_degree[graph.get_id(h) - shift] = graph.get_degree(h, false) + graph.get_degree(h, true);
+			}, true);
+	auto degree_of = [&node_degree,&shift,&graph](const handle_t& h) {
+		return node_degree[graph.get_id(h) - shift];
+	};
+
+	// write the per-base degree vector of each path, in parallel and in the order of the paths
+	auto write_path_vectors = [&](const std::vector<path_handle_t>& paths,
+								  const std::function<uint64_t(const path_handle_t&, const handle_t&)>& get_degree) {
+		algorithms::ordered_chunk_writer writer(std::cout);
+		writer.open_writer();
+#pragma omp parallel for schedule(dynamic, 1)
+		for (uint64_t i = 0; i < paths.size(); ++i) {
+			const path_handle_t& path = paths[i];
+			std::string text = graph.get_path_name(path);
+			graph.for_each_step_in_path(
+					path,
+					[&](const step_handle_t& step) {
+						const handle_t handle = graph.get_handle_of_step(step);
+						const std::string value = " " + std::to_string(get_degree(path, handle));
+						for (uint64_t j = graph.get_length(handle); j > 0; --j) {
+							text.append(value);
+						}
+						if (text.size() >= (1 << 20)) {
+							writer.append(i, text, false);
+							text.clear();
+						}
+					});
+			text.push_back('\n');
+			writer.append(i, text, true);
+		}
+		writer.close_writer();
+	};
+
 	// these options are exclusive (probably we should say with a warning)
 	std::vector<odgi::pos_t> graph_positions;
 	std::vector<odgi::path_pos_t> path_positions;
@@ -233,19 +291,14 @@ int main_degree(int argc, char** argv) {
 				[&](const handle_t &h) {
 					uint64_t degree = 0;
 					bool consider = false;
-					graph.for_each_step_on_handle(
+					graph.visit_steps_on_handle(
 							h,
-							[&](const step_handle_t &occ) {
-								if (paths_to_consider[
-										as_integer(
-												graph.get_path_handle_of_step(occ))
-								]) {
-									consider = true;
-									return;
-								}
+							[&](const step_handle_t &occ, const path_handle_t &path) {
+								consider = paths_to_consider[as_integer(path)];
+								return !consider;
 							});
 					if (consider) {
-						degree += graph.get_degree(h, false) + graph.get_degree(h, true);
+						degree += degree_of(h);
 					}
 					auto length = graph.get_length(h);
 					for (uint64_t i = 0; i < length; ++i) {
@@ -261,26 +314,9 @@ int main_degree(int argc, char** argv) {
 						paths.push_back(path);
 					}
 				});
-		// for each path handle
-#pragma omp parallel for schedule(dynamic, 1)
-		for (auto& path : paths) {
-			std::stringstream ss;
-			ss << graph.get_path_name(path);
-			// for each step
-			uint64_t pos = 0;
-			graph.for_each_step_in_path(
-					path,
-					[&](const step_handle_t& step) {
-						handle_t handle = graph.get_handle_of_step(step);
-						auto degree = graph.get_degree(handle, false) + graph.get_degree(handle, true);
-						auto next_pos = pos + graph.get_length(handle);
-						while (pos++ < next_pos) {
-							ss << " " << degree;
-						}
-					});
-#pragma omp critical (cout)
-			std::cout << ss.str() << std::endl;
-		}
+		write_path_vectors(paths, [&](const path_handle_t& path, const handle_t& handle) {
+			return degree_of(handle);
+		});
 	} else if (self_degree) {
 		std::vector<path_handle_t> paths;
 		graph.for_each_path_handle(
@@ -289,37 +325,20 @@ int main_degree(int argc, char** argv) {
 						paths.push_back(path);
 					}
 				});
-		// for each path handle
-#pragma omp parallel for schedule(dynamic, 1)
-		for (auto& path : paths) {
-			std::stringstream ss;
-			ss << graph.get_path_name(path);
-			// for each step
-			uint64_t pos = 0;
-			graph.for_each_step_in_path(
-					path,
-					[&](const step_handle_t& step) {
-						handle_t handle = graph.get_handle_of_step(step);
-						uint64_t degree = 0;
-						graph.for_each_step_on_handle(
-								handle,
-								[&](const step_handle_t& other) {
-									if (path == graph.get_path_handle_of_step(other)) {
-										degree += graph.get_degree(handle, false) + graph.get_degree(handle, true);
-									}
-								});
-						auto next_pos = pos + graph.get_length(handle);
-						while (pos++ < next_pos) {
-							ss << " " << degree;
-						}
+		// the degree of the node counted once for each visit of the path
+		write_path_vectors(paths, [&](const path_handle_t& path, const handle_t& handle) {
+			uint64_t visits = 0;
+			graph.visit_steps_on_handle(
+					handle,
+					[&](const step_handle_t& other, const path_handle_t& other_path) {
+						visits += (path == other_path);
 					});
-#pragma omp critical (cout)
-			std::cout << ss.str() << std::endl;
-		}
+			return visits * degree_of(handle);
+		});
 	} else if (graph_pos) {
 		add_graph_pos(graph, args::get(graph_pos));
 	} else if (graph_pos_file) {
-		std::ifstream gpos(args::get(graph_pos_file));
+		algorithms::readahead_ifstream_t gpos(args::get(graph_pos_file));
 		std::string buffer;
 		while (std::getline(gpos, buffer)) {
 			add_graph_pos(graph, buffer);
@@ -335,7 +354,7 @@ int main_degree(int argc, char** argv) {
 			add_path_pos(graph, buffer);
 		}
 	} else if (bed_input) {
-		std::ifstream bed_in(args::get(bed_input));
+		algorithms::readahead_ifstream_t bed_in(args::get(bed_input));
 		std::string buffer;
 		while (std::getline(bed_in, buffer)) {
 		    add_bed_range(path_ranges, graph, buffer);
@@ -357,16 +376,10 @@ int main_degree(int argc, char** argv) {
 
 	auto get_graph_pos = [](const odgi::graph_t &graph,
 							const path_pos_t &pos) {
-		const auto path_end = graph.path_end(pos.path);
-		uint64_t walked = 0;
-		for (step_handle_t s = graph.path_begin(pos.path);
-			 s != path_end; s = graph.get_next_step(s)) {
+		const step_handle_t s = graph.get_step_at_position(pos.path, pos.offset);
+		if (s != graph.path_end(pos.path)) {
 			handle_t h = graph.get_handle_of_step(s);
-			uint64_t node_length = graph.get_length(h);
-			if (walked + node_length > pos.offset) {
-				return make_pos_t(graph.get_id(h), graph.get_is_reverse(h), pos.offset - walked);
-			}
-			walked += node_length;
+			return make_pos_t(graph.get_id(h), graph.get_is_reverse(h), pos.offset - graph.get_position_of_step(s));
 		}
 
 #pragma omp critical (cout)
@@ -388,7 +401,7 @@ int main_degree(int argc, char** argv) {
 		return walked;
 	};
 
-	auto get_graph_node_degree = [](const odgi::graph_t &graph, const nid_t node_id,
+	auto get_graph_node_degree = [&degree_of](const odgi::graph_t &graph, const nid_t node_id,
 									const std::vector<bool>& paths_to_consider) {
 
 		uint64_t node_degree = 0;
@@ -397,18 +410,16 @@ int main_degree(int argc, char** argv) {
 		const handle_t h = graph.get_handle(node_id);
 		bool consider = false;
 
-		graph.for_each_step_on_handle(
+		graph.visit_steps_on_handle(
 				h,
-				[&](const step_handle_t &occ) {
-					if (paths_to_consider[
-							as_integer(graph.get_path_handle_of_step(occ))]) {
+				[&](const step_handle_t &occ, const path_handle_t &path) {
+					if (paths_to_consider[as_integer(path)]) {
 						consider = true;
-						unique_paths.insert(as_integer(graph.get_path(occ)));
-						return;
+						unique_paths.insert(as_integer(path));
 					}
 				});
 		if (consider) {
-			node_degree +=graph.get_degree(h, false) + graph.get_degree(h, true);
+			node_degree += degree_of(h);
 		}
 
 		return make_pair(node_degree, unique_paths.size());
@@ -421,24 +432,16 @@ int main_degree(int argc, char** argv) {
 			paths.push_back(path);
 		});
 
-		// precompute degrees for all handles in parallel
-		std::vector<uint64_t> degrees(graph.get_node_count() + 1);
-		graph.for_each_handle(
-				[&](const handle_t& h) {
-					auto id = graph.get_id(h);
-					degrees[id - shift] = graph.get_degree(h, false) + graph.get_degree(h, true);
-				}, true);
-
 		auto in_bounds =
 				[&](const handle_t &handle) {
-					uint64_t degree = degrees[graph.get_id(handle) - shift];
+					uint64_t degree = degree_of(handle);
 					return _windows_in ? (degree >= windows_in_min && degree <= windows_in_max) : (degree < windows_out_min || degree > windows_out_max);
 				};
 
 		std::cout << "#path\tstart\tend" << std::endl;
 
 		algorithms::windows_in_out(graph, paths, in_bounds, _windows_in ? windows_in_len : windows_out_len,
-								   [&](const std::vector<path_range_t>& path_ranges) {
+								   [&](const uint64_t& path_index, const std::vector<path_range_t>& path_ranges) {
 #pragma omp critical (cout)
 									   for (auto path_range : path_ranges) {
 										   std::cout << graph.get_path_name(path_range.begin.path) << "\t"
@@ -456,7 +459,7 @@ int main_degree(int argc, char** argv) {
         uint64_t max_degree = std::numeric_limits<uint64_t>::min();
         graph.for_each_handle(
                 [&](const handle_t& handle) {
-                    uint64_t degree = graph.get_degree(handle, false) + graph.get_degree(handle, true);
+                    uint64_t degree = degree_of(handle);
                     total_edges += degree;
                     min_degree = std::min(min_degree, degree);
                     max_degree = std::max(max_degree, degree);
@@ -475,8 +478,7 @@ int main_degree(int argc, char** argv) {
 		for (auto& graph_pos : graph_positions) {
 #pragma omp critical (cout)
 			std::cout << id(graph_pos) << "\t"
-					  << graph.get_degree(graph.get_handle(id(graph_pos)), false) +
-					  graph.get_degree(graph.get_handle(id(graph_pos)), true)
+					  << node_degree[id(graph_pos) - shift]
 					  << std::endl;
 		}
 	}
@@ -6,6 +6,8 @@
 #include "algorithms/bfs.hpp"
 #include "algorithms/depth.hpp"
 #include "algorithms/path_length.hpp"
+#include "algorithms/ordered_chunk_writer.hpp"
+#include "algorithms/depth_index.hpp"
 #include <omp.h>
 
 #include "src/algorithms/subgraph/extract.hpp"
@@ -69,6 +71,13 @@ namespace odgi {
         args::Flag summarize_depth(depth_opts, "summarize-graph-depth",
                                    "Provide a summary of the depth distribution in the graph, in a tab-delimited format it prints to stdout: node.count, graph.length, step.count, path.length, mean.node.depth (step.count/node.count), and mean.graph.depth (path.length/graph.length).",
                                    {'S', "summarize"});
+        args::Flag summary_approx(depth_opts, "approx",
+                                  "For -S, --summarize, estimate step.count, path.length and the mean depths from the depth of about 1% of the nodes, drawn at random, "
+                                  "instead of all of them. Two more columns give the half width of the 95% confidence intervals of mean.node.depth and mean.graph.depth.",
+                                  {"approx"});
+        args::ValueFlag<double> summary_sample_rate(depth_opts, "FRACTION",
+                                                    "Draw about this FRACTION of the nodes for --approx, which it implies [default: 0.01].",
+                                                    {"sample-rate"});
 
         args::ValueFlag<std::string> _windows_in(depth_opts, "LEN:MIN:MAX:TIPS",
                                                 "Print to stdout a BED file of path intervals where the depth is between MIN and MAX, "
@@ -85,6 +94,20 @@ namespace odgi {
                               {'U', "window-unique-depth"});
 
 
+        args::Group index_opts(parser, "[ Depth Index Options ]");
+        args::ValueFlag<std::string> write_depth_index(index_opts, "FILE",
+                                                       "Write an index of the depth along each path, counting the steps of the paths given by -s, --subset-paths, to FILE and exit.",
+                                                       {"write-depth-index"});
+        args::ValueFlag<std::string> write_edge_depth_index(index_opts, "FILE",
+                                                            "Write an index of the number of times the paths cross each edge to FILE and exit. "
+                                                            "It is read via --edge-depth-index by odgi matrix, odgi stats and odgi prune.",
+                                                            {"write-edge-depth-index"});
+        args::ValueFlag<std::string> depth_index_file(index_opts, "FILE",
+                                                      "Answer the path range queries of -r, --path, -R, --paths and -b, --bed-input, or of all paths if none is given, "
+                                                      "from the depth index in FILE written via --write-depth-index, without loading a graph. "
+                                                      "The ranges get the columns min.depth and max.depth after mean.depth.",
+                                                      {"depth-index"});
+
         args::Group threading_opts(parser, "[ Threading ] ");
         args::ValueFlag<uint64_t> _num_threads(threading_opts, "N", "Number of threads to use in parallel operations.", {'t', "threads"});
 		args::Group processing_info_opts(parser, "[ Processing Information ]");
@@ -106,6 +129,74 @@ namespace odgi {
             return 1;
         }
 
+        const bool sampled = summary_approx || summary_sample_rate;
+        const double sample_rate = summary_sample_rate ? args::get(summary_sample_rate) : 0.01;
+        if (sampled) {
+            if (!summarize_depth) {
+                std::cerr << "[odgi::depth] error: please specify -S, --summarize to use --approx or --sample-rate." << std::endl;
+                return 1;
+            }
+            if (sample_rate <= 0 || sample_rate > 1) {
+                std::cerr << "[odgi::depth] error: the sample rate must be greater than 0 and at most 1." << std::endl;
+                return 1;
+            }
+        }
+
+        if (depth_index_file) {
+            if (write_depth_index || write_edge_depth_index || _subset_paths || graph_pos || graph_pos_file || path_pos || path_pos_file
+                || graph_depth_table || graph_depth_vec || path_depth || self_depth || summarize_depth
+                || _windows_in || _windows_out) {
+                std::cerr << "[odgi::depth] error: a depth index given via --depth-index only answers path range queries, "
+                             "please specify them via -r, --path, -R, --paths, or -b, --bed-input." << std::endl;
+                return 1;
+            }
+            algorithms::depth_index_t index;
+            std::ifstream in(args::get(depth_index_file), std::ios::binary);
+            if (!in || !index.load(in)) {
+                std::cerr << "[odgi::depth] error: \"" << args::get(depth_index_file) << "\" does not hold a depth index written via --write-depth-index." << std::endl;
+                return 1;
+            }
+            std::cout << "#path\tstart\tend\tmean.depth\tmin.depth\tmax.depth" << std::endl;
+            // a range in BED format, like add_bed_range reads it from a graph
+            auto report_range = [&](const std::string& buffer) {
+                if (buffer.empty() || buffer[0] == '#') {
+                    return;
+                }
+                const auto vals = split(buffer, '\t');
+                if (!index.has_path(vals[0])) {
+                    std::cerr << "[odgi::depth] error: path " << vals[0] << " not found in the depth index" << std::endl;
+                    exit(1);
+                }
+                const uint64_t rank = index.get_path_rank(vals[0]);
+                const uint64_t start = vals.size() > 1 ? (uint64_t) std::stoull(vals[1]) : 0;
+                const uint64_t end = vals.size() > 2 ? (uint64_t) std::stoull(vals[2]) : index.get_path_length(rank);
+                if (start >= end || end > index.get_path_length(rank)) {
+                    std::cerr << "[odgi::depth] error: wrong input coordinates in row: " << buffer << std::endl;
+                    exit(1);
+                }
+                double mean;
+                uint64_t min, max;
+                index.get_range_depth(rank, start, end, mean, min, max);
+                std::cout << vals[0] << "\t" << start << "\t" << end << "\t"
+                          << mean << "\t" << min << "\t" << max << "\n";
+            };
+            std::string buffer;
+            if (bed_input || path_file) {
+                algorithms::readahead_ifstream_t ranges(bed_input ? args::get(bed_input) : args::get(path_file));
+                while (std::getline(ranges, buffer)) {
+                    report_range(buffer);
+                }
+            } else if (path_name) {
+                report_range(args::get(path_name));
+            } else {
+                for (uint64_t i = 0; i < index.get_path_count(); ++i) {
+                    report_range(index.get_path_name(i));
+                }
+            }
+            std::cout.flush();
+            return 0;
+        }
+
         if (!og_file) {
             std::cerr << "[odgi::depth] error: please specify a target graph via -i=[FILE], --idx=[FILE]." << std::endl;
             return 1;
@@ -240,6 +331,42 @@ namespace odgi {
             }
         };
 
+        if (write_edge_depth_index) {
+            const algorithms::edge_depth_index_t index(graph, num_threads);
+            std::ofstream out(args::get(write_edge_depth_index), std::ios::binary);
+            index.serialize(out);
+            if (!out) {
+                std::cerr << "[odgi::depth] error: could not write the edge depth index to \"" << args::get(write_edge_depth_index) << "\"." << std::endl;
+                return 1;
+            }
+            return 0;
+        }
+
+        if (write_depth_index) {
+            algorithms::depth_index_t index;
+            std::vector<bool> subset;
+            if (_subset_paths) {
+                subset = paths_to_consider;
+            }
+            index.build(graph, subset, num_threads, args::get(progress));
+            std::ofstream out(args::get(write_depth_index), std::ios::binary);
+            index.serialize(out);
+            if (!out) {
+                std::cerr << "[odgi::depth] error: could not write the depth index to \"" << args::get(write_depth_index) << "\"." << std::endl;
+                return 1;
+            }
+            return 0;
+        }
+
+        // the per base depth vectors repeat the depth of a node for each of its bases
+        const uint64_t output_chunk_size = 1 << 20;
+        auto append_depth = [](std::string& line, const uint64_t& depth, const uint64_t& length) {
+            const std::string field = " " + std::to_string(depth);
+            for (uint64_t j = 0; j < length; ++j) {
+                line.append(field);
+            }
+        };
+
         if (summarize_depth) {
             // we do nothing here, we iterate over the handles in the graph later
         } else if (graph_depth_table) {
@@ -251,13 +378,10 @@ namespace odgi {
             graph.for_each_handle(
                 [&](const handle_t &h) {
                     uint64_t depth = 0;
-                    graph.for_each_step_on_handle(
+                    graph.visit_steps_on_handle(
                         h,
-                        [&](const step_handle_t &occ) {
-                            depth += paths_to_consider[
-                                as_integer(
-                                    graph.get_path_handle_of_step(occ))
-                                ];
+                        [&](const step_handle_t &occ, const path_handle_t &path) {
+                            depth += paths_to_consider[as_integer(path)];
                         });
                     auto length = graph.get_length(h);
                     for (uint64_t i = 0; i < length; ++i) {
@@ -273,26 +397,27 @@ namespace odgi {
                         paths.push_back(path);
                     }
                 });
-            // for each path handle
+            // each path is a line, streamed out in chunks and in order
+            algorithms::ordered_chunk_writer writer(std::cout);
+            writer.open_writer();
 #pragma omp parallel for schedule(dynamic, 1)
-            for (auto& path : paths) {
-                std::stringstream ss;
-                ss << graph.get_path_name(path);
+            for (uint64_t i = 0; i < paths.size(); ++i) {
+                const path_handle_t& path = paths[i];
+                std::string line = graph.get_path_name(path);
                 // for each step
-                uint64_t pos = 0;
                 graph.for_each_step_in_path(
                     path,
                     [&](const step_handle_t& step) {
                         handle_t handle = graph.get_handle_of_step(step);
-                        auto depth = graph.get_step_count(handle);
-                        auto next_pos = pos + graph.get_length(handle);
-                        while (pos++ < next_pos) {
-                            ss << " " << depth;
+                        append_depth(line, graph.get_step_count(handle), graph.get_length(handle));
+                        if (line.size() >= output_chunk_size) {
+                            writer.append(i, line, false);
                         }
                     });
-#pragma omp critical (cout)
-                std::cout << ss.str() << std::endl;
+                line.push_back('\n');
+                writer.append(i, line, true);
             }
+            writer.close_writer();
         } else if (self_depth) {
             std::vector<path_handle_t> paths;
             graph.for_each_path_handle(
@@ -301,36 +426,37 @@ namespace odgi {
                         paths.push_back(path);
                     }
                 });
-            // for each path handle
+            algorithms::ordered_chunk_writer writer(std::cout);
+            writer.open_writer();
 #pragma omp parallel for schedule(dynamic, 1)
-            for (auto& path : paths) {
-                std::stringstream ss;
-                ss << graph.get_path_name(path);
+            for (uint64_t i = 0; i < paths.size(); ++i) {
+                const path_handle_t& path = paths[i];
+                std::string line = graph.get_path_name(path);
                 // for each step
-                uint64_t pos = 0;
                 graph.for_each_step_in_path(
                     path,
                     [&](const step_handle_t& step) {
                         handle_t handle = graph.get_handle_of_step(step);
                         uint64_t depth = 0;
-                        graph.for_each_step_on_handle(
+                        graph.visit_steps_on_handle(
                             handle,
-                            [&](const step_handle_t& other) {
-                                depth += (path == graph.get_path_handle_of_step(other));
+                            [&](const step_handle_t& other, const path_handle_t& other_path) {
+                                depth += (path == other_path);
                             });
-                        auto next_pos = pos + graph.get_length(handle);
-                        while (pos++ < next_pos) {
-                            ss << " " << depth;
+                        append_depth(line, depth, graph.get_length(handle));
+                        if (line.size() >= output_chunk_size) {
+                            writer.append(i, line, false);
                         }
                     });
-#pragma omp critical (cout)
-                std::cout << ss.str() << std::endl;
+                line.push_back('\n');
+                writer.append(i, line, true);
             }
+            writer.close_writer();
         } else if (graph_pos) {
             // if we're given a graph_pos, we'll convert it into a path pos
             add_graph_pos(graph, args::get(graph_pos));
         } else if (graph_pos_file) {
-            std::ifstream gpos(args::get(graph_pos_file));
+            algorithms::readahead_ifstream_t gpos(args::get(graph_pos_file));
             std::string buffer;
             while (std::getline(gpos, buffer)) {
                 add_graph_pos(graph, buffer);
@@ -346,7 +472,7 @@ namespace odgi {
                 add_path_pos(graph, buffer);
             }
         } else if (bed_input) {
-            std::ifstream bed_in(args::get(bed_input));
+            algorithms::readahead_ifstream_t bed_in(args::get(bed_input));
             std::string buffer;
             while (std::getline(bed_in, buffer)) {
                 add_bed_range(path_ranges, graph, buffer);
@@ -368,16 +494,10 @@ namespace odgi {
 
         auto get_graph_pos = [](const odgi::graph_t &graph,
                                 const path_pos_t &pos) {
-            const auto path_end = graph.path_end(pos.path);
-            uint64_t walked = 0;
-            for (step_handle_t s = graph.path_begin(pos.path);
-                 s != path_end; s = graph.get_next_step(s)) {
+            const step_handle_t s = graph.get_step_at_position(pos.path, pos.offset);
+            if (s != graph.path_end(pos.path)) {
                 handle_t h = graph.get_handle_of_step(s);
-                uint64_t node_length = graph.get_length(h);
-                if (walked + node_length > pos.offset) {
-                    return make_pos_t(graph.get_id(h), graph.get_is_reverse(h), pos.offset - walked);
-                }
-                walked += node_length;
+                return make_pos_t(graph.get_id(h), graph.get_is_reverse(h), pos.offset - graph.get_position_of_step(s));
             }
 
 #pragma omp critical (cout)
@@ -407,13 +527,12 @@ namespace odgi {
 
             const handle_t h = graph.get_handle(node_id);
 
-            graph.for_each_step_on_handle(
+            graph.visit_steps_on_handle(
                 h,
-                [&](const step_handle_t &occ) {
-                    if (paths_to_consider[
-                            as_integer(graph.get_path_handle_of_step(occ))]) {
+                [&](const step_handle_t &occ, const path_handle_t &path) {
+                    if (paths_to_consider[as_integer(path)]) {
                         ++node_depth;
-                        unique_paths.insert(as_integer(graph.get_path(occ)));
+                        unique_paths.insert(as_integer(path));
                     }
                 });
 
@@ -458,22 +577,96 @@ namespace odgi {
 
             std::cout << "#path\tstart\tend" << std::endl;
 
+            algorithms::ordered_chunk_writer writer(std::cout);
+            writer.open_writer();
             algorithms::windows_in_out(graph, paths, in_bounds, _windows_in ? windows_in_len : windows_out_len,
-                           [&](const std::vector<path_range_t>& path_ranges) {
-#pragma omp critical (cout)
-                               for (auto path_range : path_ranges) {
+                           [&](const uint64_t& path_index, const std::vector<path_range_t>& path_ranges) {
+                               std::string lines;
+                               for (auto& path_range : path_ranges) {
                                    if (!windows_only_tips
                                        || path_range.begin.offset == 0
                                        || path_range.end.offset == path_length[path_range.begin.path]) {
-                                       std::cout << graph.get_path_name(path_range.begin.path) << "\t"
-                                                 << path_range.begin.offset << "\t"
-                                                 << path_range.end.offset << std::endl;
+                                       lines.append(graph.get_path_name(path_range.begin.path)).push_back('\t');
+                                       lines.append(std::to_string(path_range.begin.offset)).push_back('\t');
+                                       lines.append(std::to_string(path_range.end.offset)).push_back('\n');
+                                       if (lines.size() >= output_chunk_size) {
+                                           writer.append(path_index, lines, false);
+                                       }
                                    }
                                }
+                               writer.append(path_index, lines, true);
                            }, num_threads);
+            writer.close_writer();
         }
 
-        if (summarize_depth) {
+        if (summarize_depth && sampled) {
+            std::cout << "#node.count\tgraph.length\tstep.count\tpath.length\tmean.node.depth\tmean.graph.depth"
+                      << "\tmean.node.depth.ci95\tmean.graph.depth.ci95" << std::endl;
+            // the sums over the drawn nodes of the depth d and length l that the estimates and their variances need
+            struct depth_sums_t {
+                double n = 0, d = 0, dd = 0, l = 0, ll = 0, ld = 0, lld = 0, lldd = 0;
+            };
+            std::vector<depth_sums_t> thread_sums(omp_get_max_threads());
+            // a node is drawn when a hash of its id falls below the rate, which is the same on every run
+            const uint64_t threshold = sample_rate >= 1 ? std::numeric_limits<uint64_t>::max()
+                : (uint64_t)(sample_rate * (double)std::numeric_limits<uint64_t>::max());
+            std::atomic<uint64_t> node_count; node_count.store(0);
+            std::atomic<uint64_t> graph_length; graph_length.store(0);
+            graph.for_each_handle(
+                [&](const handle_t& h) {
+                    const nid_t node_id = graph.get_id(h);
+                    const double l = graph.get_length(h);
+                    ++node_count;
+                    graph_length += (uint64_t)l;
+                    uint64_t x = (uint64_t)node_id + 0x9e3779b97f4a7c15ULL;
+                    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+                    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+                    x ^= x >> 31;
+                    if (x > threshold) {
+                        return;
+                    }
+                    const double d = get_graph_node_depth(graph, node_id, paths_to_consider).first;
+                    auto& s = thread_sums[omp_get_thread_num()];
+                    s.n += 1;
+                    s.d += d;
+                    s.dd += d * d;
+                    s.l += l;
+                    s.ll += l * l;
+                    s.ld += l * d;
+                    s.lld += l * l * d;
+                    s.lldd += l * l * d * d;
+                }, true);
+            depth_sums_t s;
+            for (auto& t : thread_sums) {
+                s.n += t.n; s.d += t.d; s.dd += t.dd; s.l += t.l; s.ll += t.ll; s.ld += t.ld; s.lld += t.lld; s.lldd += t.lldd;
+            }
+            double mean_node_depth = 0, mean_graph_depth = 0, ci_node_depth = 0, ci_graph_depth = 0;
+            if (s.n > 0) {
+                mean_node_depth = s.d / s.n;
+                mean_graph_depth = s.l > 0 ? s.ld / s.l : 0;
+            }
+            if (s.n > 1) {
+                // the nodes are drawn without replacement, hence the finite population correction
+                const double fpc = std::max(0.0, 1.0 - s.n / (double)node_count);
+                const double var_d = std::max(0.0, (s.dd - s.n * mean_node_depth * mean_node_depth) / (s.n - 1));
+                ci_node_depth = 1.96 * std::sqrt(var_d / s.n * fpc);
+                // the linearized variance of the ratio estimate sum(l * d) / sum(l)
+                const double r = mean_graph_depth;
+                const double residuals = std::max(0.0, s.lldd - 2 * r * s.lld + r * r * s.ll);
+                const double mean_l = s.l / s.n;
+                if (mean_l > 0) {
+                    ci_graph_depth = 1.96 * std::sqrt(residuals / (s.n - 1) / s.n * fpc) / mean_l;
+                }
+            }
+            std::cout << node_count << "\t"
+                      << graph_length << "\t"
+                      << (uint64_t)std::llround(mean_node_depth * (double)node_count) << "\t"
+                      << (uint64_t)std::llround(mean_graph_depth * (double)graph_length) << "\t"
+                      << mean_node_depth << "\t"
+                      << mean_graph_depth << "\t"
+                      << ci_node_depth << "\t"
+                      << ci_graph_depth << std::endl;
+        } else if (summarize_depth) {
             std::cout << "#node.count\tgraph.length\tstep.count\tpath.length\tmean.node.depth\tmean.graph.depth" << std::endl;
             std::atomic<uint64_t> step_count; step_count.store(0);
             std::atomic<uint64_t> node_count; node_count.store(0);
@@ -499,32 +692,39 @@ namespace odgi {
 
         if (!graph_positions.empty()) {
             std::cout << "#node.id\tdepth\tdepth.uniq" << std::endl;
+            algorithms::ordered_chunk_writer writer(std::cout);
+            writer.open_writer();
 #pragma omp parallel for schedule(dynamic, 1)
-            for (auto &pos : graph_positions) {
-                const nid_t node_id = id(pos);
+            for (uint64_t i = 0; i < graph_positions.size(); ++i) {
+                const nid_t node_id = id(graph_positions[i]);
                 const auto depth = get_graph_node_depth(graph, node_id, paths_to_consider);
 
-#pragma omp critical (cout)
-                std::cout << node_id << "\t"
-                          << depth.first << "\t"
-                          << depth.second << std::endl;
+                std::string line = std::to_string(node_id) + "\t"
+                    + std::to_string(depth.first) + "\t"
+                    + std::to_string(depth.second) + "\n";
+                writer.append(i, line, true);
             }
+            writer.close_writer();
         }
 
         if (!path_positions.empty()) {
             std::cout << "#path.position\tdepth\tdepth.uniq" << std::endl;
+            algorithms::ordered_chunk_writer writer(std::cout);
+            writer.open_writer();
 #pragma omp parallel for schedule(dynamic, 1)
-            for (auto &path_pos : path_positions) {
+            for (uint64_t i = 0; i < path_positions.size(); ++i) {
+                const path_pos_t& path_pos = path_positions[i];
                 const pos_t pos = get_graph_pos(graph, path_pos);
 
                 const nid_t node_id = id(pos);
                 const auto depth = get_graph_node_depth(graph, node_id, paths_to_consider);
 
-#pragma omp critical (cout)
-                std::cout << (graph.get_path_name(path_pos.path)) << "," << path_pos.offset << ","
-                          << (path_pos.is_rev ? "-" : "+") << "\t"
-                          << depth.first << "\t" << depth.second << std::endl;
+                std::string line = graph.get_path_name(path_pos.path) + "," + std::to_string(path_pos.offset) + ","
+                    + (path_pos.is_rev ? "-" : "+") + "\t"
+                    + std::to_string(depth.first) + "\t" + std::to_string(depth.second) + "\n";
+                writer.append(i, line, true);
             }
+            writer.close_writer();
         }
 
         if (!path_ranges.empty()) {
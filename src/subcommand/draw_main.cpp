@@ -53,8 +53,16 @@ int main_draw(int argc, char **argv) {
                                                 {'b', "bed-file"});
     args::ValueFlag<float> node_sparsification(visualizations_opts, "N", "Remove this fraction of nodes from the SVG output (to output smaller files) (default: 0.0, keep all nodes).", {'f', "svg-sparse-factor"});
     args::Flag lengthen_left_nodes(visualizations_opts, "lengthen", "When node sparsitication is active, lengthen the remaining nodes proportionally with the sparsification factor", {'l', "svg-lengthen-nodes"});
+    args::ValueFlag<double> svg_lod(visualizations_opts, "N", "Level of detail for the SVG output: chain consecutive segments of the same color into polylines,"
+                                                            " drop the points within *N* SVG units of the line through their neighbors and the"
+                                                            " features smaller than *N*, so that the file grows with what is visible at that scale"
+                                                            " rather than with the number of nodes (default: 0.0, one line per node).", {"svg-lod"});
     args::Group threading(parser, "[ Threading ]");
 	args::ValueFlag<uint64_t> nthreads(threading, "N", "Number of threads to use for parallel operations.", {'t', "threads"});
+#ifdef USE_GPU
+    args::Group gpu_opts(parser, "[ GPU ]");
+    args::Flag gpu_draw(gpu_opts, "gpu", "Rasterize the PNG with the GPU, unless the paths are colored with -C, --color-paths.", {"gpu"});
+#endif
 	args::Group processing_info_opts(parser, "[ Processing Information ]");
 	args::Flag progress(processing_info_opts, "progress", "Write the current progress to stderr.", {'P', "progress"});
     args::Group program_info_opts(parser, "[ Program Information ]");
@@ -101,10 +109,33 @@ int main_draw(int argc, char **argv) {
         std::cerr << "[odgi::draw] error: -f/--svg-sparse-factor must be in the range [0.0, 1.0]." << std::endl;
         return 1;
     }
+    const double svg_lod_tolerance = svg_lod ? args::get(svg_lod) : 0.0;
+    if (svg_lod_tolerance < 0.0) {
+        std::cerr << "[odgi::draw] error: --svg-lod must not be negative." << std::endl;
+        return 1;
+    }
 
 	const uint64_t num_threads = args::get(nthreads) ? args::get(nthreads) : 1;
 
 	graph_t graph;
+    // only the paths of the BED ranges, if any, or those to color are needed
+    ska::flat_hash_set<std::string> bed_path_names;
+    if (!args::get(color_paths)) {
+        if (_path_bed_file && !args::get(_path_bed_file).empty()) {
+            algorithms::readahead_ifstream_t bed_in(args::get(_path_bed_file));
+            std::string line;
+            while (std::getline(bed_in, line)) {
+                if (!line.empty() && line[0] != '#') {
+                    bed_path_names.insert(line.substr(0, line.find('\t')));
+                }
+            }
+            graph.set_path_loading(false, [&](const std::string_view& name) {
+                return bed_path_names.count(std::string(name)) > 0;
+            });
+        } else {
+            graph.set_path_loading(true);
+        }
+    }
     assert(argc > 0);
     {
         const std::string infile = args::get(dg_in_file);
@@ -128,7 +159,7 @@ int main_draw(int argc, char **argv) {
     ska::flat_hash_map<handlegraph::nid_t, std::set<std::string>> node_id_to_label_map; // To remember the unique node to label for each path range
 
     if (_path_bed_file && !args::get(_path_bed_file).empty()) {
-        std::ifstream bed_in(args::get(_path_bed_file));
+        algorithms::readahead_ifstream_t bed_in(args::get(_path_bed_file));
         std::string line;
         while (std::getline(bed_in, line)) {
             add_bed_range(path_ranges, graph, line);
@@ -205,9 +236,7 @@ int main_draw(int argc, char **argv) {
             if (infile == "-") {
                 layout.load(std::cin);
             } else {
-                ifstream f(infile.c_str());
-                layout.load(f);
-                f.close();
+                layout.load(infile);
             }
         }
     }
@@ -216,10 +245,10 @@ int main_draw(int argc, char **argv) {
         auto& outfile = args::get(tsv_out_file);
         if (!outfile.empty()) {
             if (outfile == "-") {
-                layout.to_tsv(std::cout);
+                layout.to_tsv(std::cout, num_threads);
             } else {
                 ofstream f(outfile.c_str());
-                layout.to_tsv(f);
+                layout.to_tsv(f, num_threads);
                 f.close();
             }
         }
@@ -232,7 +261,7 @@ int main_draw(int argc, char **argv) {
         // todo could be done with callbacks
         std::vector<double> X = layout.get_X();
         std::vector<double> Y = layout.get_Y();
-        algorithms::draw_svg(f, X, Y, graph, svg_scale, border_bp, _png_line_width, node_id_to_color, node_id_to_label_map, sparse_nodes, args::get(lengthen_left_nodes));
+        algorithms::draw_svg(f, X, Y, graph, svg_scale, border_bp, _png_line_width, node_id_to_color, node_id_to_label_map, sparse_nodes, args::get(lengthen_left_nodes), svg_lod_tolerance, num_threads);
         f.close();    
     }
 
@@ -241,7 +270,12 @@ int main_draw(int argc, char **argv) {
         // todo could be done with callbacks
         std::vector<double> X = layout.get_X();
         std::vector<double> Y = layout.get_Y();
-        algorithms::draw_png(outfile, X, Y, graph, 1.0, border_bp, 0, _png_height, _png_line_width, _png_path_line_spacing, _color_paths, node_id_to_color);
+#ifdef USE_GPU
+        const bool gpu = args::get(gpu_draw);
+#else
+        const bool gpu = false;
+#endif
+        algorithms::draw_png(outfile, X, Y, graph, 1.0, border_bp, 0, _png_height, _png_line_width, _png_path_line_spacing, _color_paths, node_id_to_color, num_threads, gpu);
     }
     
     return 0;
@@ -2,6 +2,7 @@
 
 #include "args.hxx"
 #include <queue>
+#include <algorithm>
 #include <atomic_bitvector.hpp>
 #include "src/algorithms/subgraph/extract.hpp"
 
@@ -41,6 +42,10 @@ namespace odgi {
         args::ValueFlag<uint64_t> nthreads(threading_opts, "N",
                                            "Number of threads to use for parallel operations.",
                                            {'t', "threads"});
+        args::ValueFlag<uint64_t> _max_in_flight(threading_opts, "N",
+                                                 "Build and write at most N components at the same time, each holding its "
+                                                 "component graph in memory (default: the number of threads).",
+                                                 {"max-in-flight"});
         args::Group processing_info_opts(parser, "[ Processing Information ]");
         args::Flag _progress(processing_info_opts, "progress", "Print information about the components and the progress to stderr.",
                           {'P', "progress"});
@@ -93,7 +98,7 @@ namespace odgi {
         }
 
         std::vector<ska::flat_hash_set<handlegraph::nid_t>> weak_components =
-                algorithms::weakly_connected_components(&graph);
+                algorithms::weakly_connected_components(&graph, num_threads);
 
 
         atomicbitvector::atomic_bv_t ignore_component(weak_components.size());
@@ -222,44 +227,54 @@ namespace odgi {
             }
         }
 
+        // the components to write, biggest first, so that the largest ones do not start last and hold up the end
+        std::vector<uint64_t> components_to_write;
         for (uint64_t component_index = 0; component_index < weak_components.size(); ++component_index) {
             if (!ignore_component.test(component_index)) {
-                auto &weak_component = weak_components[component_index];
+                components_to_write.push_back(component_index);
+            } else if (progress) {
+                component_progress->increment(1);
+            }
+        }
+        std::stable_sort(components_to_write.begin(), components_to_write.end(), [&](const uint64_t &a, const uint64_t &b) {
+            return weak_components[a].size() > weak_components[b].size();
+        });
 
-                graph_t subgraph;
+        // each worker holds a single component graph at a time, bounding the memory by the number of workers;
+        // the threads left over go to filling the paths of the components
+        const uint64_t in_flight = std::max((uint64_t) 1, std::min(num_threads, _max_in_flight ? args::get(_max_in_flight) : num_threads));
+        const uint64_t path_threads = std::max((uint64_t) 1, num_threads / in_flight);
 
-                for (auto node_id : weak_component) {
-                    subgraph.create_handle(graph.get_sequence(graph.get_handle(node_id)), node_id);
-                }
+#pragma omp parallel for schedule(dynamic, 1) num_threads(in_flight)
+        for (uint64_t i = 0; i < components_to_write.size(); ++i) {
+            const uint64_t component_index = components_to_write[i];
+            auto &weak_component = weak_components[component_index];
 
-                weak_component.clear();
+            graph_t subgraph;
 
-                algorithms::add_connecting_edges_to_subgraph(graph, subgraph);
-                algorithms::add_full_paths_to_component(graph, subgraph, num_threads);
+            for (auto node_id : weak_component) {
+                subgraph.create_handle(graph.get_sequence(graph.get_handle(node_id)), node_id);
+            }
 
-                if (optimize) {
-                    subgraph.optimize();
-                }
+            ska::flat_hash_set<handlegraph::nid_t>().swap(weak_component);
 
-                const string filename = output_dir_plus_prefix + "." + to_string(component_index) + (to_gfa ? ".gfa" : ".og");
+            algorithms::add_connecting_edges_to_subgraph(graph, subgraph);
+            algorithms::add_full_paths_to_component(graph, subgraph, path_threads);
 
-                // Save the component
-                ofstream f(filename);
-                if (to_gfa){
-                    subgraph.to_gfa(f, false);
-                }else {
-                    subgraph.serialize(f);
-                }
-                f.close();
-
-                /*if (debug) {
-#pragma omp critical (cout)
-                        std::cerr << "Written component num. " << component_index
-                                  << " - num. of nodes " << subgraph.get_node_count()
-                                  << " - num. of paths: " << subgraph.get_path_count()
-                                  << std::endl;
-                }*/
+            if (optimize) {
+                subgraph.optimize();
+            }
+
+            const string filename = output_dir_plus_prefix + "." + to_string(component_index) + (to_gfa ? ".gfa" : ".og");
+
+            // Save the component
+            ofstream f(filename);
+            if (to_gfa){
+                subgraph.to_gfa(f, false);
+            }else {
+                subgraph.serialize(f);
             }
+            f.close();
 
             if (progress) {
                 component_progress->increment(1);
@@ -5,6 +5,7 @@
 #include "split.hpp"
 #include <omp.h>
 #include <regex>
+#include <numeric>
 #include "utils.hpp"
 #include "atomic_bitvector.hpp"
 #include "src/algorithms/subgraph/extract.hpp"
@@ -190,11 +191,8 @@ namespace odgi {
             }
         }
 
+        // the nodes to keep are marked over the id range, so that the ids need not be compacted
         const uint64_t shift = graph.min_node_id();
-        if (graph.max_node_id() - shift >= graph.get_node_count()){
-            std::cerr << "[odgi::extract] error: the node IDs are not compacted. Please run 'odgi sort' using -O, --optimize to optimize the graph." << std::endl;
-            exit(1);
-        }
 
         // Prepare all paths for parallelize the next step (actually, not all paths are always present in the subgraph)
         std::vector<path_handle_t> paths;
@@ -270,7 +268,7 @@ namespace odgi {
         {
             // handle targets from BED
             if (_path_bed_file && !args::get(_path_bed_file).empty()) {
-                std::ifstream bed_in(args::get(_path_bed_file));
+                algorithms::readahead_ifstream_t bed_in(args::get(_path_bed_file));
                 std::string line;
                 while (std::getline(bed_in, line)) {
                     add_bed_range(input_path_ranges, graph, line);
@@ -410,23 +408,33 @@ namespace odgi {
 
         omp_set_num_threads((int) num_threads);
 
-        auto prep_graph = [&shift](
-                             graph_t &source, std::vector<path_handle_t>* source_paths,
-                             const std::vector<path_handle_t>& lace_paths, graph_t &subgraph,
-                             std::vector<odgi::path_range_t> path_ranges, std::vector<std::pair<uint64_t, uint64_t>> pangenomic_ranges,
+        // Collect the nodes of the path/pangenomic ranges in the subgraph, and expand it if requested.
+        // The path ranges are extended to whole nodes and deduplicated, along with first_steps, the first step
+        // of each range, which is found if not given.
+        auto collect_nodes = [&shift](
+                             graph_t &source, graph_t &subgraph,
+                             std::vector<odgi::path_range_t> &path_ranges, std::vector<step_handle_t> &first_steps,
+                             const std::vector<std::pair<uint64_t, uint64_t>> &pangenomic_ranges,
                              const uint64_t context_steps, const uint64_t context_bases, const bool full_range, const bool inverse,
-                             const uint64_t max_dist_subpaths, const uint64_t num_iterations,
-                             const uint64_t num_threads, const bool show_progress, const bool optimize) {
-            if (context_steps > 0 || context_bases > 0) {
-                if (show_progress) {
-                    std::cerr << "[odgi::extract] expansion and adding connecting edges" << std::endl;
-                }
+                             const uint64_t num_threads, const bool show_progress) {
+            auto expand = [&](void) {
+                if (context_steps > 0 || context_bases > 0) {
+                    if (show_progress) {
+                        std::cerr << "[odgi::extract] expansion and adding connecting edges" << std::endl;
+                    }
 
-                if (context_steps > 0) {
-                    algorithms::expand_subgraph_by_steps(source, subgraph, context_steps, false);
-                } else {
-                    algorithms::expand_subgraph_by_length(source, subgraph, context_bases, false);
+                    if (context_steps > 0) {
+                        algorithms::expand_subgraph_by_steps(source, subgraph, context_steps, false);
+                    } else {
+                        algorithms::expand_subgraph_by_length(source, subgraph, context_bases, false);
+                    }
                 }
+            };
+
+            // The inverted query is the complement of the context of the given nodes, as the path
+            // ranges were already inverted outside; otherwise the context of all the nodes is taken
+            if (inverse) {
+                expand();
             }
 
             // Check if there are nodes in the subgraph, to avoid extracting the whole graph
@@ -463,51 +471,35 @@ namespace odgi {
 
             // Collect handles in path/pangenomic ranges (it is assumed they were already inverted outside, if needed)
             {
+                // The extraction does not cut nodes, so the input path ranges have to be
+                // extended if their ranges (start, end) fall in the middle of the nodes.
+                // This is important to path names with the correct path ranges.
+                if (first_steps.size() != path_ranges.size()) {
+                    algorithms::find_path_range_steps(source, path_ranges, first_steps, num_threads);
+                }
+
                 std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress;
                 if (show_progress) {
                     progress = std::make_unique<algorithms::progress_meter::ProgressMeter>(
                             path_ranges.size(), "[odgi::extract] extracting path ranges");
                 }
 
-                atomicbitvector::atomic_bv_t keep_bv(source.get_node_count()+1);
+                atomicbitvector::atomic_bv_t keep_bv(source.get_node_count() ? source.max_node_id() - shift + 1 : 1);
 
-#pragma omp parallel for schedule(dynamic,1)
-                for (auto &path_range : path_ranges) {
-                    const path_handle_t path_handle = path_range.begin.path;
+#pragma omp parallel for schedule(dynamic,1) num_threads(num_threads)
+                for (uint64_t i = 0; i < path_ranges.size(); ++i) {
                     if (show_progress) {
                         progress->increment(1);
                     }
 
-                    // The extraction does not cut nodes, so the input path ranges have to be
-                    // extended if their ranges (start, end) fall in the middle of the nodes.
-                    bool first = true;
-                    uint64_t new_start = 0;
-                    uint64_t new_end = 0;
-                    
-                    const uint64_t start = path_range.begin.offset;
-                    const uint64_t end = path_range.end.offset;
-
-                    uint64_t walked = 0;
-                    const auto path_end = source.path_end(path_handle);
-                    for (step_handle_t cur_step = source.path_begin(path_handle);
-                        cur_step != path_end && walked < end; cur_step = source.get_next_step(cur_step)) {
+                    uint64_t walked = path_ranges[i].begin.offset;
+                    const auto path_end = source.path_end(path_ranges[i].begin.path);
+                    for (step_handle_t cur_step = first_steps[i];
+                        cur_step != path_end && walked < path_ranges[i].end.offset; cur_step = source.get_next_step(cur_step)) {
                         const handle_t cur_handle = source.get_handle_of_step(cur_step);
                         walked += source.get_length(cur_handle);
-                        if (walked > start) {
-                            keep_bv.set(source.get_id(cur_handle) - shift);
-
-                            if (first) {
-                                first = false;
-                                new_start = walked - source.get_length(cur_handle);
-                            }
-                        }
+                        keep_bv.set(source.get_id(cur_handle) - shift);
                     }
-                    new_end = walked;
-
-                    // Extend path range to entirely include the first and the last node of the range.
-                    // Thi is important to path names with the correct path ranges.
-                    path_range.begin.offset = new_start;
-                    path_range.end.offset = new_end;
                 }
                 if (!pangenomic_ranges.empty()) {
                     uint64_t pos = 0;
@@ -535,6 +527,10 @@ namespace odgi {
                 }
             }
 
+            if (!inverse) {
+                expand();
+            }
+
             // Check if there are nodes in the subgraph, to avoid min_node_id == max_node_id == 0
             if (full_range && subgraph.get_node_count() > 0) {
                 // Take the start and end node of this and fill things in
@@ -543,31 +539,34 @@ namespace odgi {
                                                                                                                 : "");
             }
 
-            // These paths are treated differently: only the specified ranges are included in the extracted graph
-            std::vector<path_handle_t> source_paths_from_path_ranges;
-            for (auto &path_range : path_ranges) {
-                source_paths_from_path_ranges.push_back(path_range.begin.path);
-            }
-
-            // `max_dist_subpaths` and `add_subpaths_to_subgraph` have to work with the paths not specified in the
-            // input path ranges, preventing their possible fragmentation.
-            std::sort(source_paths_from_path_ranges.begin(), source_paths_from_path_ranges.end());
-            source_paths->erase(std::remove_if(source_paths->begin(), source_paths->end(), [&](const auto&x) {
-                return std::binary_search(source_paths_from_path_ranges.begin(), source_paths_from_path_ranges.end(), x);
-            }), source_paths->end());
-
             // We don't cut nodes for the extraction, so close path intervals can generate identical subpaths.
             // To avoid duplicated subpaths in the final subgraph, we remove duplicated path ranges.
             {
-                std::set<odgi::path_range_t, odgi::path_range_comparator> unique_path_ranges;
+                const odgi::path_range_comparator path_range_less;
+                std::vector<uint64_t> order(path_ranges.size());
+                std::iota(order.begin(), order.end(), 0);
+                std::stable_sort(order.begin(), order.end(), [&](const uint64_t& a, const uint64_t& b) {
+                    return path_range_less(path_ranges[a], path_ranges[b]);
+                });
 
-                for (const auto& path_range : path_ranges) {
-                    unique_path_ranges.insert(path_range);
+                std::vector<odgi::path_range_t> unique_path_ranges;
+                std::vector<step_handle_t> unique_first_steps;
+                for (auto i : order) {
+                    if (unique_path_ranges.empty() || path_range_less(unique_path_ranges.back(), path_ranges[i])) {
+                        unique_path_ranges.push_back(path_ranges[i]);
+                        unique_first_steps.push_back(first_steps[i]);
+                    }
                 }
 
-                path_ranges.assign(unique_path_ranges.begin(), unique_path_ranges.end());
+                path_ranges.swap(unique_path_ranges);
+                first_steps.swap(unique_first_steps);
             }
+        };
 
+        auto merge_close_subpaths = [](
+                             graph_t &source, std::vector<path_handle_t>* source_paths, graph_t &subgraph,
+                             const uint64_t max_dist_subpaths, const uint64_t num_iterations,
+                             const uint64_t num_threads, const bool show_progress) {
             if (max_dist_subpaths > 0) {
                 // Iterate multiple times to merge subpaths which became mergeable during the first iteration where new nodes were added
                 for (uint8_t i = 0; i < num_iterations; ++i) {
@@ -578,13 +577,14 @@ namespace odgi {
                                                          std::to_string(i + 1) + " (max " + std::to_string(num_iterations) + ")");
                     }
 
-                    // The last step is not included
-                    std::vector<std::pair<step_handle_t, step_handle_t>> short_missing_subpaths;
+                    // The last step is not included; each path fills its own list, so the threads never wait on each other
+                    std::vector<std::vector<std::pair<step_handle_t, step_handle_t>>> short_missing_subpaths_of_path(source_paths->size());
 
                     // Search not included subpaths (in parallel)
 #pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
                     for (uint64_t path_rank = 0; path_rank < source_paths->size(); ++path_rank) {
                         auto &source_path_handle = (*source_paths)[path_rank];
+                        auto &short_missing_subpaths = short_missing_subpaths_of_path[path_rank];
                         uint64_t walked = 0;
 
                         // check if the nodes are in the output subgraph
@@ -612,7 +612,6 @@ namespace odgi {
                                 if (!in_match) {
                                     if (!ignore_subpath) {
                                         if ((end_nt - start_nt) <= max_dist_subpaths) {
-#pragma omp critical (short_missing_subpaths)
                                             short_missing_subpaths.push_back(std::make_pair(start_step, step));
                                         }
                                     }
@@ -635,6 +634,13 @@ namespace odgi {
                         progress->finish();
                     }
 
+                    // In the order of the paths
+                    std::vector<std::pair<step_handle_t, step_handle_t>> short_missing_subpaths;
+                    for (auto &path_short_missing_subpaths : short_missing_subpaths_of_path) {
+                        short_missing_subpaths.insert(short_missing_subpaths.end(),
+                                                      path_short_missing_subpaths.begin(), path_short_missing_subpaths.end());
+                    }
+
                     if (short_missing_subpaths.empty()) {
                         break; // Nothing mergeable, do not waste time in further iterations
                     }
@@ -657,9 +663,13 @@ namespace odgi {
                     }
                 }
             }
+        };
 
-            // ----------------------------------------------------------------------------------
-            // Insert the subpaths corresponding to the path ranges (if any)
+        // Insert the subpaths corresponding to the path ranges (if any)
+        auto add_path_range_subpaths = [](
+                             graph_t &source, graph_t &subgraph,
+                             const std::vector<odgi::path_range_t> &path_ranges, const std::vector<step_handle_t> &first_steps,
+                             const uint64_t num_threads) {
             // Create subpaths
             std::vector<path_handle_t> subpaths_from_path_ranges;
             subpaths_from_path_ranges.reserve(path_ranges.size());
@@ -680,40 +690,24 @@ namespace odgi {
             // Fill subpaths in parallel
 #pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
             for (uint64_t i = 0; i < subpaths_from_path_ranges.size(); ++i) {
-                auto path_range = path_ranges[i];
-                const path_handle_t path_handle = path_range.begin.path;
                 const path_handle_t subpath_handle = subpaths_from_path_ranges[i];
 
-                algorithms::for_handle_in_path_range(
-                        source, path_handle, path_range.begin.offset, path_range.end.offset,
-                        [&](const handle_t& handle) {
-                            subgraph.append_step(
-                                    subpath_handle,
-                                    subgraph.get_handle(source.get_id(handle),
-                                                        source.get_is_reverse(handle))
-                            );
-                        });
-            }
-            // ----------------------------------------------------------------------------------
-
-            // rewrite lace paths so that skipped regions are represented as new nodes that we then add to our subgraph
-            if (!lace_paths.empty()) {
-                if (show_progress) {
-                    std::cerr << "[odgi::extract] adding " << lace_paths.size() << " lace paths" << std::endl;
+                std::vector<handle_t> handles;
+                uint64_t walked = path_ranges[i].begin.offset;
+                const auto path_end = source.path_end(path_ranges[i].begin.path);
+                for (step_handle_t cur_step = first_steps[i];
+                     cur_step != path_end && walked < path_ranges[i].end.offset; cur_step = source.get_next_step(cur_step)) {
+                    const handle_t handle = source.get_handle_of_step(cur_step);
+                    walked += source.get_length(handle);
+                    handles.push_back(subgraph.get_handle(source.get_id(handle),
+                                                          source.get_is_reverse(handle)));
                 }
-
-                algorithms::embed_lace_paths(source, subgraph, lace_paths);
+                subgraph.append_steps(subpath_handle, handles);
             }
+        };
 
-            // Connect the collected handles
-            algorithms::add_connecting_edges_to_subgraph(source, subgraph, show_progress
-                                                                           ? "[odgi::extract] adding connecting edges"
-                                                                           : "");
-
-            // Add subpaths covering the collected handles
-            algorithms::add_subpaths_to_subgraph(source, *source_paths, subgraph, num_threads,
-                                                 show_progress ? "[odgi::extract] adding subpaths" : "");
-
+        // Add the edges missing for the subpaths and remove the empty ones
+        auto finish_graph = [](graph_t &subgraph, const uint64_t num_threads, const bool show_progress, const bool optimize) {
             std::vector<path_handle_t> subpaths;
             subpaths.reserve(subgraph.get_path_count());
             subgraph.for_each_path_handle([&](const path_handle_t& path) {
@@ -726,20 +720,26 @@ namespace odgi {
                         subpaths.size(), "[odgi::extract] checking missing edges and empty subpaths");
             }
 
-            ska::flat_hash_set<std::pair<handle_t, handle_t>> edges_to_create;
+            // The missing edges and the emptiness of each subpath, found without locking and merged after
+            std::vector<std::vector<edge_t>> missing_edges_of_path(subpaths.size());
+            std::vector<uint8_t> is_empty_path(subpaths.size(), 0);
 
 #pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
-            for (auto path: subpaths) {
-                handle_t last;
-                const step_handle_t begin_step = subgraph.path_begin(path);
-                subgraph.for_each_step_in_path(path, [&](const step_handle_t &step) {
-                    handle_t h = subgraph.get_handle_of_step(step);
-                    if (step != begin_step && !subgraph.has_edge(last, h)) {
-#pragma omp critical (edges_to_create)
-                        edges_to_create.insert({last, h});
-                    }
-                    last = h;
-                });
+            for (uint64_t i = 0; i < subpaths.size(); ++i) {
+                const path_handle_t path = subpaths[i];
+                if (subgraph.is_empty(path)) {
+                    is_empty_path[i] = 1;
+                } else {
+                    handle_t last;
+                    const step_handle_t begin_step = subgraph.path_begin(path);
+                    subgraph.for_each_step_in_path(path, [&](const step_handle_t &step) {
+                        handle_t h = subgraph.get_handle_of_step(step);
+                        if (step != begin_step && !subgraph.has_edge(last, h)) {
+                            missing_edges_of_path[i].push_back({last, h});
+                        }
+                        last = h;
+                    });
+                }
 
                 if (show_progress) {
                     progress_checking->increment(1);
@@ -750,12 +750,15 @@ namespace odgi {
                 progress_checking->finish();
             }
 
+            ska::flat_hash_set<std::pair<handle_t, handle_t>> edges_to_create;
+            for (auto &missing_edges : missing_edges_of_path) {
+                edges_to_create.insert(missing_edges.begin(), missing_edges.end());
+            }
+
             // remove empty subpaths
-#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
-            for (auto path: subpaths) {
-                if (subgraph.is_empty(path)) {
-#pragma omp critical (subgraph)
-                    subgraph.destroy_path(path);
+            for (uint64_t i = 0; i < subpaths.size(); ++i) {
+                if (is_empty_path[i]) {
+                    subgraph.destroy_path(subpaths[i]);
                 }
             }
 
@@ -765,10 +768,8 @@ namespace odgi {
 
             subpaths.clear();
 
-            // add missing edges
-            for (auto edge: edges_to_create) {
-                subgraph.create_edge(edge.first, edge.second);
-            }
+            // add missing edges, each node's edges filled by one thread
+            subgraph.create_edges(std::vector<edge_t>(edges_to_create.begin(), edges_to_create.end()));
 
             if (show_progress && edges_to_create.size() > 0) {
                 std::cerr << "[odgi::extract] fixed " << edges_to_create.size() << " edge(s)" << std::endl;
@@ -782,6 +783,56 @@ namespace odgi {
             }
         };
 
+        auto prep_graph = [&](
+                             graph_t &source, std::vector<path_handle_t>* source_paths,
+                             const std::vector<path_handle_t>& lace_paths, graph_t &subgraph,
+                             std::vector<odgi::path_range_t> path_ranges, std::vector<std::pair<uint64_t, uint64_t>> pangenomic_ranges,
+                             const uint64_t context_steps, const uint64_t context_bases, const bool full_range, const bool inverse,
+                             const uint64_t max_dist_subpaths, const uint64_t num_iterations,
+                             const uint64_t num_threads, const bool show_progress, const bool optimize) {
+            std::vector<step_handle_t> first_steps;
+            collect_nodes(source, subgraph, path_ranges, first_steps, pangenomic_ranges,
+                          context_steps, context_bases, full_range, inverse,
+                          num_threads, show_progress);
+
+            // These paths are treated differently: only the specified ranges are included in the extracted graph
+            std::vector<path_handle_t> source_paths_from_path_ranges;
+            for (auto &path_range : path_ranges) {
+                source_paths_from_path_ranges.push_back(path_range.begin.path);
+            }
+
+            // `max_dist_subpaths` and `add_subpaths_to_subgraph` have to work with the paths not specified in the
+            // input path ranges, preventing their possible fragmentation.
+            std::sort(source_paths_from_path_ranges.begin(), source_paths_from_path_ranges.end());
+            source_paths->erase(std::remove_if(source_paths->begin(), source_paths->end(), [&](const auto&x) {
+                return std::binary_search(source_paths_from_path_ranges.begin(), source_paths_from_path_ranges.end(), x);
+            }), source_paths->end());
+
+            merge_close_subpaths(source, source_paths, subgraph, max_dist_subpaths, num_iterations, num_threads, show_progress);
+
+            add_path_range_subpaths(source, subgraph, path_ranges, first_steps, num_threads);
+
+            // rewrite lace paths so that skipped regions are represented as new nodes that we then add to our subgraph
+            if (!lace_paths.empty()) {
+                if (show_progress) {
+                    std::cerr << "[odgi::extract] adding " << lace_paths.size() << " lace paths" << std::endl;
+                }
+
+                algorithms::embed_lace_paths(source, subgraph, lace_paths);
+            }
+
+            // Connect the collected handles
+            algorithms::add_connecting_edges_to_subgraph(source, subgraph, show_progress
+                                                                           ? "[odgi::extract] adding connecting edges"
+                                                                           : "");
+
+            // Add subpaths covering the collected handles
+            algorithms::add_subpaths_to_subgraph(source, *source_paths, subgraph, num_threads,
+                                                 show_progress ? "[odgi::extract] adding subpaths" : "");
+
+            finish_graph(subgraph, num_threads, show_progress, optimize);
+        };
+
         auto check_and_create_handle = [&](const graph_t &source, graph_t &subgraph, const nid_t node_id) {
             if (graph.has_node(node_id)) {
                 if (!subgraph.has_node(node_id)){
@@ -796,25 +847,85 @@ namespace odgi {
         };
 
         if (_split_subgraphs) {
-            for (auto &path_range : *path_ranges) {
-                graph_t subgraph;
+            // All subgraphs are extracted together, so that each path is walked once to find all the ranges on it,
+            // and once to find the subpaths of all subgraphs (and per merging iteration), instead of once per range.
+            // The rest of the work is done per subgraph, in parallel.
+            std::vector<odgi::path_range_t> subgraph_ranges = *path_ranges;
+            std::vector<step_handle_t> first_steps;
+            algorithms::find_path_range_steps(graph, subgraph_ranges, first_steps, num_threads);
+
+            // These paths are treated differently: only the specified ranges are included in the extracted graphs
+            {
+                std::vector<path_handle_t> source_paths_from_path_ranges;
+                for (auto &path_range : subgraph_ranges) {
+                    source_paths_from_path_ranges.push_back(path_range.begin.path);
+                }
+                std::sort(source_paths_from_path_ranges.begin(), source_paths_from_path_ranges.end());
+                paths.erase(std::remove_if(paths.begin(), paths.end(), [&](const auto&x) {
+                    return std::binary_search(source_paths_from_path_ranges.begin(), source_paths_from_path_ranges.end(), x);
+                }), paths.end());
+            }
 
-                const path_handle_t path_handle = path_range.begin.path;
+            std::vector<graph_t> subgraphs(subgraph_ranges.size());
+            {
+                std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress;
+                if (show_progress) {
+                    progress = std::make_unique<algorithms::progress_meter::ProgressMeter>(
+                            subgraphs.size(), "[odgi::extract] extracting " + std::to_string(subgraphs.size()) + " path ranges");
+                }
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+                for (uint64_t i = 0; i < subgraphs.size(); ++i) {
+                    std::vector<odgi::path_range_t> ranges = {subgraph_ranges[i]};
+                    std::vector<step_handle_t> steps = {first_steps[i]};
+                    collect_nodes(graph, subgraphs[i], ranges, steps, *pangenomic_ranges,
+                                  context_steps, context_bases, _full_range, false, 1, false);
+                    if (show_progress) {
+                        progress->increment(1);
+                    }
+                }
+                if (show_progress) {
+                    progress->finish();
+                }
+            }
+
+            if (max_dist_subpaths > 0) {
+                algorithms::merge_close_subpaths_of_subgraphs(graph, paths, subgraphs, max_dist_subpaths, num_iterations,
+                                                              num_threads, show_progress);
+            }
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+            for (uint64_t i = 0; i < subgraphs.size(); ++i) {
+                add_path_range_subpaths(graph, subgraphs[i], {subgraph_ranges[i]}, {first_steps[i]}, 1);
+            }
 
+            // The lace paths add nodes to the source graph, so they are embedded one subgraph at a time
+            if (!lace_paths.empty()) {
                 if (show_progress) {
-                    std::cerr << "[odgi::extract] extracting path range " << graph.get_path_name(path_range.begin.path) << ":" << path_range.begin.offset
-                              << "-"
-                              << path_range.end.offset << std::endl;
+                    std::cerr << "[odgi::extract] adding " << lace_paths.size() << " lace paths" << std::endl;
+                }
+                for (auto &subgraph : subgraphs) {
+                    algorithms::embed_lace_paths(graph, subgraph, lace_paths);
                 }
+            }
 
-                prep_graph(
-                    graph, &paths,
-                    lace_paths, subgraph,
-                    {path_range}, *pangenomic_ranges,
-                    context_steps, context_bases, _full_range, false,
-                    max_dist_subpaths, num_iterations,
-                    num_threads, show_progress, optimize);
+            if (show_progress) {
+                std::cerr << "[odgi::extract] adding connecting edges" << std::endl;
+            }
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+            for (uint64_t i = 0; i < subgraphs.size(); ++i) {
+                algorithms::add_connecting_edges_to_subgraph(graph, subgraphs[i]);
+            }
+
+            algorithms::add_subpaths_to_subgraphs(graph, paths, subgraphs, num_threads,
+                                                  show_progress ? "[odgi::extract] adding subpaths" : "");
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+            for (uint64_t i = 0; i < subgraphs.size(); ++i) {
+                finish_graph(subgraphs[i], 1, false, optimize);
+            }
 
+            for (uint64_t i = 0; i < subgraphs.size(); ++i) {
+                const auto &path_range = (*path_ranges)[i];
                 const string filename = graph.get_path_name(path_range.begin.path) + ":" + to_string(path_range.begin.offset) + "-" + to_string(path_range.end.offset) + ".og";
 
                 if (show_progress) {
@@ -822,8 +933,10 @@ namespace odgi {
                 }
 
                 ofstream f(filename);
-                subgraph.serialize(f);
+                subgraphs[i].serialize(f);
                 f.close();
+                // free each subgraph once written
+                subgraphs[i].clear();
             }
         } else {
             graph_t subgraph;
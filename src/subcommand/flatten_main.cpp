@@ -3,6 +3,7 @@
 #include "args.hxx"
 #include <omp.h>
 #include "algorithms/linear_index.hpp"
+#include "algorithms/ordered_chunk_writer.hpp"
 #include "utils.hpp"
 
 namespace odgi {
@@ -74,7 +75,7 @@ int main_flatten(int argc, char** argv) {
     }
 
     // graph linearization with handle to position mapping
-    algorithms::linear_index_t linear(graph);
+    algorithms::linear_index_t linear(graph, num_threads);
 
     const std::string fasta_name = !args::get(fasta_seq_name).empty() ? args::get(fasta_seq_name) : args::get(odgi_in_file);
 
@@ -82,12 +83,27 @@ int main_flatten(int argc, char** argv) {
         const std::string fasta_out = args::get(fasta_out_file);
         if (!fasta_out.empty()) {
             const uint8_t fasta_line_width = 80;
+            // whole lines of the sequence per work item
+            const uint64_t item_lines = 1 << 14;
 
             auto write_fasta = [&](ostream& out) {
-                out << ">" << fasta_name << std::endl;
-                for (uint64_t i = 0; i < linear.graph_seq.size(); i+=fasta_line_width) {
-                    out << linear.graph_seq.substr(i, fasta_line_width) << std::endl;
+                out << ">" << fasta_name << "\n";
+                const uint64_t item_bases = item_lines * fasta_line_width;
+                const uint64_t items = (linear.size() + item_bases - 1) / item_bases;
+                algorithms::ordered_chunk_writer writer(out);
+                writer.open_writer();
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+                for (uint64_t k = 0; k < items; ++k) {
+                    const uint64_t end = std::min(linear.size(), (k + 1) * item_bases);
+                    std::string text;
+                    text.reserve(item_bases + item_lines);
+                    for (uint64_t i = k * item_bases; i < end; i += fasta_line_width) {
+                        linear.append_sequence(text, i, fasta_line_width);
+                        text.push_back('\n');
+                    }
+                    writer.append(k, text, true);
                 }
+                writer.close_writer();
             };
 
             if (fasta_out == "-") {
@@ -100,11 +116,8 @@ int main_flatten(int argc, char** argv) {
     }
 
     if (!args::get(bed_out_file).empty()) {
-        auto write_bed_line = [&](ostream& out, const std::string& path_name, const uint64_t& start,
-                const uint64_t& end, bool is_rev, const uint64_t& rank) {
-            out << fasta_name << "\t" << start << "\t" << end << "\t"
-            << path_name << "\t" << (is_rev ? "-" : "+") << "\t" << rank << std::endl;
-        };
+        // the text of a path goes out once it reaches this size
+        const uint64_t output_chunk_size = 1 << 20;
 
         const std::string bed_out = args::get(bed_out_file);
         ofstream b;
@@ -113,20 +126,43 @@ int main_flatten(int argc, char** argv) {
             bed_stdout = false;
             b.open(bed_out.c_str());
         }
+        std::ostream& out = bed_stdout ? std::cout : b;
 
-        (bed_stdout ? std::cout : b) << "#name\tstart\tend\tpath.name\tstrand\tstep.rank\n";
+        out << "#name\tstart\tend\tpath.name\tstrand\tstep.rank\n";
 
+        std::vector<path_handle_t> paths;
         graph.for_each_path_handle([&](const path_handle_t& p) {
-            const std::string path_name = graph.get_path_name(p);
+            paths.push_back(p);
+        });
+        // the records of each path are formatted in parallel and written in path order
+        algorithms::ordered_chunk_writer writer(out);
+        writer.open_writer();
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+        for (uint64_t k = 0; k < paths.size(); ++k) {
+            const std::string path_name = graph.get_path_name(paths[k]);
+            std::string text;
             uint64_t rank = 0;
-            graph.for_each_step_in_path(p, [&](const step_handle_t& s) {
+            graph.for_each_step_in_path(paths[k], [&](const step_handle_t& s) {
                 const handle_t h = graph.get_handle_of_step(s);
                 const uint64_t start = linear.position_of_handle(h);
                 const uint64_t end = start + graph.get_length(h);
-                const bool is_rev = graph.get_is_reverse(h);
-                write_bed_line(bed_stdout ? std::cout : b, path_name, start, end, is_rev, rank++);
+                text.append(fasta_name);
+                text.push_back('\t');
+                text.append(std::to_string(start));
+                text.push_back('\t');
+                text.append(std::to_string(end));
+                text.push_back('\t');
+                text.append(path_name);
+                text.append(graph.get_is_reverse(h) ? "\t-\t" : "\t+\t");
+                text.append(std::to_string(rank++));
+                text.push_back('\n');
+                if (text.size() >= output_chunk_size) {
+                    writer.append(k, text, false);
+                }
             });
-        });
+            writer.append(k, text, true);
+        }
+        writer.close_writer();
 
         if (!bed_stdout) {
             b.close();
@@ -114,7 +114,7 @@ int main_groom(int argc, char** argv) {
 		target_paths = load_paths(args::get(_target_paths));
 	}
 
-    graph.apply_ordering(algorithms::groom(graph, progress, target_paths, !args::get(use_dfs)));
+    graph.apply_ordering(algorithms::groom(graph, progress, target_paths, !args::get(use_dfs), num_threads));
 
     {
         const std::string outfile = args::get(og_out_file);
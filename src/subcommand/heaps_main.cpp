@@ -6,6 +6,10 @@
 #include "utils.hpp"
 #include "split.hpp"
 
+#ifdef USE_GPU
+#include "cuda/coverage.h"
+#endif
+
 namespace odgi {
 
 using namespace odgi::subcommand;
@@ -34,6 +38,12 @@ int main_heaps(int argc, char **argv) {
                                              {'n', "n-permutations"});
     args::ValueFlag<uint64_t> _min_node_depth(heaps_opts, "N", "Exclude nodes with less than this path depth (default: 0).",
                                          {'d', "min-node-depth"});
+    args::ValueFlag<std::string> _coverage_matrix(heaps_opts, "FILE", "Take the nodes seen by each path group from the coverage matrix in *FILE*, instead of"
+                                                  " walking the paths in each permutation. If *FILE* does not exist or was built for another graph, it is built and written there.", {"coverage-matrix"});
+#ifdef USE_GPU
+    args::Group gpu_opts(parser, "[ GPU ]");
+    args::Flag gpu_compute(gpu_opts, "gpu", "Count the steps of the paths on the nodes with the GPU, into a coverage matrix that is kept in memory, or written to the *FILE* of --coverage-matrix if it has to be built, and take the nodes seen by each group from it.", {"gpu"});
+#endif
     args::Group threading_opts(parser, "[ Threading ]");
     args::ValueFlag<uint64_t> nthreads(threading_opts, "N", "Number of threads to use for parallel operations.",
                                        {'t', "threads"});
@@ -107,27 +117,11 @@ int main_heaps(int argc, char **argv) {
                     path_groups_map[group].push_back(graph.get_path_handle(path_name));
                 }
             }
-        } else if (group_by_haplotype) {
-            graph.for_each_path_handle([&](const path_handle_t& p) {
-                auto path_name = graph.get_path_name(p);
-                // split and decide
-                auto vals = split(path_name, '#');
-                if (vals.size() == 1) { // Assume ctg
-                    path_groups_map[vals.front()].push_back(p);
-                } else if (vals.size() == 2) { // Assume sample#ctg
-                    path_groups_map[vals.front()].push_back(p);
-                } else if (vals.size() == 3) { // Assume sample#hap#ctg
-                    auto key = vals[0] + vals[1];
-                    path_groups_map[key].push_back(p);
-                }
-            });
-        } else if (group_by_sample) {
-            graph.for_each_path_handle([&](const path_handle_t& p) {
-                auto path_name = graph.get_path_name(p);
-                // split and decide
-                auto vals = split(path_name, '#');
-                path_groups_map[vals.front()].push_back(p);
-            });
+        } else if (group_by_haplotype || group_by_sample) {
+            // group by sample#hap or by sample, taking ctg, sample#ctg and sample#hap#ctg names
+            for (auto& group : graph.pansn_path_groups(group_by_haplotype ? 2 : 1)) {
+                path_groups_map[group.first] = std::move(group.second);
+            }
         } else {
             // no groups
             graph.for_each_path_handle([&](const path_handle_t& p) {
@@ -142,7 +136,7 @@ int main_heaps(int argc, char **argv) {
 
     ska::flat_hash_map<path_handle_t, std::vector<interval_t>> intervals;
     if (_bed_targets) {
-        std::ifstream bed(args::get(_bed_targets).c_str());
+        algorithms::readahead_ifstream_t bed(args::get(_bed_targets));
         std::string line;
         while (std::getline(bed, line)) {
             if (!line.empty()) {
@@ -186,7 +180,21 @@ int main_heaps(int argc, char **argv) {
         }
     };
 
-    algorithms::for_each_heap_permutation(graph, path_groups, intervals, n_permutations, min_node_depth, handle_output);
+    algorithms::coverage_matrix_t coverage;
+    algorithms::coverage_block_counter_t count_block;
+#ifdef USE_GPU
+    if (gpu_compute) {
+        count_block = cuda::node_path_coverage_counter(graph, num_threads);
+    }
+#endif
+    const bool use_coverage_matrix = _coverage_matrix || count_block;
+    if (use_coverage_matrix
+        && !coverage.load_or_build(args::get(_coverage_matrix), graph, num_threads, args::get(progress), "heaps", count_block)) {
+        return 1;
+    }
+
+    algorithms::for_each_heap_permutation(graph, path_groups, intervals, n_permutations, min_node_depth, handle_output,
+                                          use_coverage_matrix ? &coverage : nullptr);
 
     return 0;
 }
@@ -27,6 +27,8 @@ int main_inject(int argc, char **argv) {
     args::Group inject_opts(parser, "[ Inject Options ]");
     args::ValueFlag<std::string> _bed_targets(inject_opts, "FILE", "BED file over path space of the graph. Records will be converted into new paths in the output graph.",
                                               {'b', "bed-targets"});
+    args::Flag delta(inject_opts, "delta", "Write only the changes to the input graph, as a delta over it that"
+                     " ODGI commands load on top of the input graph; odgi compact writes the graph in full.", {"delta"});
     args::Group threading_opts(parser, "[ Threading ]");
     args::ValueFlag<uint64_t> nthreads(threading_opts, "N", "Number of threads to use for parallel operations.",
                                        {'t', "threads"});
@@ -82,7 +84,7 @@ int main_inject(int argc, char **argv) {
                        std::vector<std::pair<interval_t, std::string>>> path_intervals;
     std::vector<std::string> ordered_intervals;
     if (_bed_targets) {
-        std::ifstream bed(args::get(_bed_targets).c_str());
+        algorithms::readahead_ifstream_t bed(args::get(_bed_targets));
         std::string line;
         while (std::getline(bed, line)) {
             if (!line.empty()) {
@@ -122,10 +124,16 @@ int main_inject(int argc, char **argv) {
 
     omp_set_num_threads(num_threads);
     graph.set_number_of_threads(num_threads);
+    if (delta) {
+        graph.track_changes();
+    }
 
     algorithms::inject_ranges(graph, path_intervals, ordered_intervals, args::get(progress));
 
     const std::string outfile = args::get(og_out_file);
+    if (delta) {
+        return utils::write_graph_delta(graph, args::get(og_in_file), outfile, "inject");
+    }
     if (outfile == "-") {
         graph.serialize(std::cout);
     } else {
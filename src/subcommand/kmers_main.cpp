@@ -8,6 +8,7 @@
 #include "algorithms/prune.hpp"
 #include "algorithms/remove_high_degree.hpp"
 #include <chrono>
+#include <map>
 #include "utils.hpp"
 
 namespace odgi {
@@ -36,6 +37,16 @@ int main_kmers(int argc, char** argv) {
 	args::Group processing_info_opts(parser, "[ Processing Information ]");
 	args::Flag progress(processing_info_opts, "progress", "Write the current progress to stderr.", {'P', "progress"});
     args::Flag kmers_stdout(kmer_opts, "", "Write the kmers to stdout. Kmers are line-separated.", {'c', "stdout"});
+    args::ValueFlag<std::string> kmers_binary(kmer_opts, "FILE", "Write the kmers packed 2 bits per base, with the positions of their first base, "
+                                              "to FILE in binary. Requires a kmer length of at most 32. Kmers over other bases than ACGT are left out.", {'b', "binary"});
+    args::ValueFlag<uint64_t> minimizer_window(kmer_opts, "N", "Only write the minimizers of each window of N consecutive kmers along each walk to the binary output.",
+                                               {'w', "minimizer-window"});
+    args::Flag kmer_counts(kmer_opts, "", "Count the kmers in the process and write each distinct kmer with its count, tab-separated,"
+                           " to stdout, in lexicographic order. Requires a kmer length of at most 32. Kmers over other bases than ACGT are left out.",
+                           {'n', "counts"});
+    args::Flag kmer_histogram(kmer_opts, "", "Count the kmers like -n, --counts, but write their histogram to stdout: each count,"
+                              " tab-separated from the number of distinct kmers with that count.", {'H', "histogram"});
+    args::ValueFlag<uint64_t> min_count(kmer_opts, "N", "Only write the kmers seen at least N times to the output of -n, --counts.", {'m', "min-count"});
     args::Group program_info_opts(parser, "[ Program Information ]");
     args::HelpFlag help(program_info_opts, "help", "Print a help message for odgi kmers.", {'h', "help"});
 
@@ -65,9 +76,39 @@ int main_kmers(int argc, char** argv) {
     }
     assert(args::get(kmer_length));
 
+    if (minimizer_window && !kmers_binary) {
+        std::cerr << "[odgi::kmers] error: minimizers (-w, --minimizer-window) are only written to the binary output (-b, --binary)." << std::endl;
+        return 1;
+    }
+
+    if (kmers_binary && args::get(kmer_length) > algorithms::max_packed_kmer_length) {
+        std::cerr << "[odgi::kmers] error: the binary output (-b, --binary) packs kmers of at most "
+                  << algorithms::max_packed_kmer_length << " bases." << std::endl;
+        return 1;
+    }
+
+    const bool counting = kmer_counts || kmer_histogram;
+    if (counting && (kmers_binary || kmers_stdout || (kmer_counts && kmer_histogram))) {
+        std::cerr << "[odgi::kmers] error: please choose one of -c, --stdout, -b, --binary, -n, --counts and -H, --histogram." << std::endl;
+        return 1;
+    }
+
+    if (counting && args::get(kmer_length) > algorithms::max_packed_kmer_length) {
+        std::cerr << "[odgi::kmers] error: kmers are counted packed, at most "
+                  << algorithms::max_packed_kmer_length << " bases long." << std::endl;
+        return 1;
+    }
+
+    if (min_count && !kmer_counts) {
+        std::cerr << "[odgi::kmers] error: a minimum count (-m, --min-count) applies to the kmer counts (-n, --counts) only." << std::endl;
+        return 1;
+    }
+
 	const uint64_t num_threads = args::get(threads) ? args::get(threads) : 1;
 
 	graph_t graph;
+    // the steps are never used here, so they are not even decoded
+    graph.set_path_loading(true);
     assert(argc > 0);
     {
         const std::string infile = args::get(dg_in_file);
@@ -97,7 +138,63 @@ int main_kmers(int argc, char** argv) {
     }
     */
 
-    if (args::get(kmers_stdout)) {
+    if (kmers_binary) {
+        // a header of the magic, k and w (0 for all kmers), then a record of (kmer, node id, offset << 1 | is_rev) per kmer
+        static const char KMERS_MAGIC[8] = {'O', 'D', 'G', 'I', 'K', 'M', 'E', 'R'};
+        std::ofstream out(args::get(kmers_binary).c_str(), std::ios::binary);
+        const uint64_t k = args::get(kmer_length);
+        const uint64_t w = minimizer_window ? args::get(minimizer_window) : 0;
+        out.write(KMERS_MAGIC, sizeof(KMERS_MAGIC));
+        out.write((const char*)&k, sizeof(k));
+        out.write((const char*)&w, sizeof(w));
+        std::vector<std::vector<uint64_t>> buffers(num_threads);
+        auto flush = [&](std::vector<uint64_t>& buffer) {
+            out.write((const char*)buffer.data(), buffer.size() * sizeof(uint64_t));
+            buffer.clear();
+        };
+        auto write_kmer = [&](const algorithms::packed_kmer_t& kmer) {
+            auto& buffer = buffers.at(omp_get_thread_num());
+            buffer.push_back(kmer.kmer);
+            buffer.push_back(id(kmer.begin));
+            buffer.push_back(offset(kmer.begin) << 1 | is_rev(kmer.begin));
+            if (buffer.size() > 3e5) {
+#pragma omp critical (out)
+                flush(buffer);
+            }
+        };
+        if (w) {
+            algorithms::for_each_minimizer(graph, k, w, args::get(max_furcations), write_kmer);
+        } else {
+            algorithms::for_each_packed_kmer(graph, k, args::get(max_furcations), write_kmer);
+        }
+        for (auto& buffer : buffers) {
+            flush(buffer);
+        }
+    } else if (counting) {
+        const uint64_t k = args::get(kmer_length);
+        const std::vector<algorithms::kmer_count_t> counts =
+            algorithms::count_packed_kmers(graph, k, args::get(max_furcations), num_threads);
+        if (args::get(progress)) {
+            std::cerr << "[odgi::kmers] counted " << counts.size() << " distinct kmers" << std::endl;
+        }
+        if (kmer_counts) {
+            const uint64_t at_least = min_count ? args::get(min_count) : 1;
+            for (auto& c : counts) {
+                if (c.count >= at_least) {
+                    std::cout << algorithms::unpack_kmer(c.kmer, k) << "\t" << c.count << "\n";
+                }
+            }
+        } else {
+            std::map<uint64_t, uint64_t> histogram;
+            for (auto& c : counts) {
+                ++histogram[c.count];
+            }
+            for (auto& h : histogram) {
+                std::cout << h.first << "\t" << h.second << "\n";
+            }
+        }
+        std::cout.flush();
+    } else if (args::get(kmers_stdout)) {
         std::vector<std::vector<kmer_t>> buffers(num_threads);
 
         algorithms::for_each_kmer(graph, args::get(kmer_length), args::get(max_furcations), [&](const kmer_t& kmer) {
@@ -4,6 +4,7 @@
 #include "args.hxx"
 #include <omp.h>
 #include "algorithms/sgd_layout.hpp"
+#include "algorithms/readahead.hpp"
 
 namespace odgi {
 
@@ -71,6 +72,7 @@ int main_layout0(int argc, char** argv) {
     args::ValueFlag<double> eps_rate(parser, "N", "learning rate for SGD layout (default 0.01)", {'e', "eps"});
     args::ValueFlag<double> x_pad(parser, "N", "padding between connected component layouts (default 10.0)", {'x', "x-padding"});
     args::ValueFlag<double> render_scale(parser, "N", "SVG scaling (default 5.0)", {'R', "render-scale"});
+    args::ValueFlag<uint64_t> nthreads(parser, "N", "number of threads to use, over the connected components (default 1)", {'t', "threads"});
     args::Flag debug(parser, "debug", "print information about the layout", {'d', "debug"});
 
     try {
@@ -103,6 +105,7 @@ int main_layout0(int argc, char** argv) {
     double eps = !args::get(eps_rate) ? 0.01 : args::get(eps_rate);
     double x_padding = !args::get(x_pad) ? 10.0 : args::get(x_pad);
     double svg_scale = !args::get(render_scale) ? 5.0 : args::get(render_scale);
+    const uint64_t num_threads = args::get(nthreads) ? args::get(nthreads) : 1;
     
     graph_t graph;
     assert(argc > 0);
@@ -111,13 +114,13 @@ int main_layout0(int argc, char** argv) {
         if (infile == "-") {
             graph.deserialize(std::cin);
         } else {
-            ifstream f(infile.c_str());
+            algorithms::readahead_ifstream_t f(infile);
             graph.deserialize(f);
             f.close();
         }
     }
 
-    std::vector<double> layout = algorithms::sgd_layout(graph, n_pivots, t_max, eps, x_padding);
+    std::vector<double> layout = algorithms::sgd_layout(graph, n_pivots, t_max, eps, x_padding, num_threads);
 
     std::string outfile = args::get(svg_out_file);
     if (!outfile.empty()) {
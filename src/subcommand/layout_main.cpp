@@ -6,8 +6,10 @@
 #include "algorithms/xp.hpp"
 #include "algorithms/sgd_layout.hpp"
 #include "algorithms/path_sgd_layout.hpp"
+#include "algorithms/zipf_zetas.hpp"
 #include "algorithms/draw.hpp"
 #include "algorithms/layout.hpp"
+#include "algorithms/multilevel_layout.hpp"
 #include "hilbert.hpp"
 #include "utils.hpp"
 
@@ -31,9 +33,10 @@ int main_layout(int argc, char **argv) {
     args::ValueFlag<std::string> dg_in_file(mandatory_opts, "FILE", "Load the succinct variation graph in ODGI format from this *FILE*. The file name usually ends with *.og*. It also accepts GFAv1, but the on-the-fly conversion to the ODGI format requires additional time!", {'i', "idx"});
     args::Group files_io_opts(parser, "[ Files IO ]");
     args::ValueFlag<std::string> layout_out_file(files_io_opts, "FILE", "Write the layout coordinates to this FILE in .lay binary format.", {'o', "out"});
+    args::ValueFlag<std::string> binary_out_file(files_io_opts, "FILE", "Write the layout coordinates to this FILE in the memory-mappable binary layout format (float32 coordinates).", {'B', "out-binary"});
     args::ValueFlag<std::string> tsv_out_file(files_io_opts, "FILE", "Write the layout in TSV format to this FILE.", {'T', "tsv"});
     args::ValueFlag<std::string> xp_in_file(files_io_opts, "FILE", "Load the path index from this FILE so that it does not have to be created for the layout calculation.", {'X', "path-index"});
-    args::ValueFlag<std::string> tmp_base(files_io_opts, "PATH", "directory for temporary files", {'C', "temp-dir"});
+    args::ValueFlag<std::string> tmp_base(files_io_opts, "PATH", "directory for temporary files, or a comma-separated list of directories (e.g. on separate drives) to spread them over", {'C', "temp-dir"});
     /// Path-guided-2D-SGD parameters
     args::ValueFlag<std::string> p_sgd_in_file(files_io_opts, "FILE",
                                                "Specify a line separated list of paths to sample from for the on the fly term generation process in the path guided 2D SGD (default: sample from all paths).",
@@ -73,6 +76,8 @@ int main_layout(int argc, char **argv) {
                                                {'k', "path-sgd-zipf-space"});
     args::ValueFlag<uint64_t> p_sgd_zipf_space_max(pg_sgd_opts, "N", "The maximum space size N of the Zipfian distribution beyond which quantization occurs (default: 1000).", {'I', "path-sgd-zipf-space-max"});
     args::ValueFlag<uint64_t> p_sgd_zipf_space_quantization_step(pg_sgd_opts, "N", "The size of the quantization step N when the maximum space size of the Zipfian distribution is exceeded (default: 100).", {'l', "path-sgd-zipf-space-quantization-step"});
+    args::ValueFlag<std::string> p_sgd_zipf_cache(pg_sgd_opts, "DIR", "Keep the tables of the Zipfian distributions in this directory, keyed by theta and"
+                                                                      " space parameters, and reuse them in later runs instead of recomputing them.", {"path-sgd-zipf-cache"});
     /*
     args::ValueFlag<std::string> p_sgd_seed(parser, "STRING",
                                             "set the seed for the deterministic 1-threaded path guided linear 1D SGD model (default: pangenomic!)",
@@ -81,14 +86,42 @@ int main_layout(int argc, char **argv) {
     args::ValueFlag<std::string> p_sgd_snapshot(pg_sgd_opts, "STRING",
                                                 "Set the prefix to which each snapshot layout of a path guided 2D SGD iteration should be written to (default: NONE).",
                                                 {'u', "path-sgd-snapshot"});
+    args::ValueFlag<double> p_sgd_flat_index_mem(pg_sgd_opts, "N", "Read the path steps in the PG-SGD from a flat, uncompressed copy of the path index if it takes at most N GB"
+                                                                   " of RAM. Each lookup is then one load instead of decoding the compact index (default: *0*, always use the compact index).", {"path-sgd-flat-index-mem"});
+    args::ValueFlag<std::string> p_sgd_checkpoint(pg_sgd_opts, "FILE", "Save the coordinates and the iteration of the path guided 2D SGD to this FILE between"
+                                                                       " iterations, so that an interrupted layout can be picked up with *--resume*. With"
+                                                                       " *-M, --multilevel*, only the refinement on the full graph is checkpointed. The FILE"
+                                                                       " is removed once the SGD completed. Not available with --gpu.", {"checkpoint"});
+    args::ValueFlag<uint64_t> p_sgd_checkpoint_interval(pg_sgd_opts, "N", "Save a checkpoint at most every N seconds (default: *600*).", {"checkpoint-interval"});
+    args::Flag p_sgd_resume(pg_sgd_opts, "resume", "Resume the path guided 2D SGD from the *--checkpoint* FILE, if it exists. Give the same"
+                                                   " input and parameters as for the interrupted run.", {"resume"});
+    args::ValueFlag<uint64_t> p_sgd_sync_interval(pg_sgd_opts, "N", "When run with mpirun on a build with MPI, average the coordinates of the nodes"
+                                                                  " shared by the paths of several ranks every N iterations (default: *1*).", {"sync-interval"});
+    args::Group multilevel_opts(parser, "[ Multilevel Options ]");
+    args::Flag multilevel(multilevel_opts, "multilevel", "First lay out a coarse graph in which each simple component of perfect path neighbors is merged into"
+                                                          " one node, then project that layout onto the graph and refine it with fewer iterations.", {'M', "multilevel"});
+    args::ValueFlag<uint64_t> multilevel_refine_iter(multilevel_opts, "N", "The number of PG-SGD iterations N refining the projected layout on the full graph (default: a third of -x=[N], --path-sgd-iter-max=[N]).", {"multilevel-refine-iter"});
+    args::ValueFlag<double> multilevel_refine_eta_max(multilevel_opts, "N", "The first and maximum learning rate N when refining the projected layout (default: squared length of the longest merged component).", {"multilevel-refine-eta-max"});
+    args::Group repulsion_opts(parser, "[ Repulsion Options ]");
+    args::ValueFlag<double> p_sgd_repulsion(repulsion_opts, "N", "After each PG-SGD iteration, push all node ends apart with an approximate (Barnes-Hut quadtree) repulsive force,"
+                                                                 " moving each by at most N, approximately in bp, cooling down with the iterations. This spreads out regions"
+                                                                 " covered by few paths. Not available with --gpu (default: 0, no repulsion).", {"path-sgd-repulsion"});
     args::Group threading_opts(parser, "[ Threading ]");
     args::ValueFlag<uint64_t> nthreads(threading_opts, "N",
                                        "Number of threads to use for parallel operations.",
                                        {'t', "threads"});
+    args::Flag hogwild(threading_opts, "hogwild", "Let the threads update the coordinates as XY-interleaved single precision floats without"
+                                                  " synchronization. Faster and lighter on memory traffic, at the cost of precision.", {"hogwild"});
+    args::Flag numa_pin_threads(threading_opts, "numa-pin-threads", "Pin each PG-SGD worker thread to its own CPU, in the order of the CPUs the process may"
+                                                                    " run on. With more than one thread, the coordinates and the path index are spread"
+                                                                    " over the NUMA nodes anyway.", {"numa-pin-threads"});
 #ifdef USE_GPU
     // GPU-enabled Layout
     args::Group gpu_opts(parser, "[ GPU ]");
     args::Flag gpu_compute(gpu_opts, "gpu", "Enable computation with GPU.", {"gpu"});
+    args::ValueFlag<int> gpu_count(gpu_opts, "N", "Spread the paths over N GPUs, whose coordinates are reconciled after each iteration (default: all GPUs).", {"gpu-count"});
+    args::ValueFlag<uint64_t> gpu_chunk_steps(gpu_opts, "N", "Stream the paths to the GPUs in chunks of at most N steps from host memory, for graphs"
+                                                             " larger than the GPU memory. Longer paths are cut (default: all paths in one chunk per GPU).", {"gpu-chunk-steps"});
 #endif
     args::Group processing_info_opts(parser, "[ Processsing Information ]");
     args::Flag progress(processing_info_opts, "progress", "Write the current progress to stderr.", {'P', "progress"});
@@ -117,14 +150,16 @@ int main_layout(int argc, char **argv) {
         return 1;
     }
 
-    if (!layout_out_file && !tsv_out_file) {
+    if (!layout_out_file && !binary_out_file && !tsv_out_file) {
         std::cerr
-            << "[odgi::layout] error: Please specify an output file to where to store the layout via -o/--out=[FILE] or -T/--tsv=[FILE]."
+            << "[odgi::layout] error: Please specify an output file to where to store the layout via -o/--out=[FILE], -B/--out-binary=[FILE] or -T/--tsv=[FILE]."
             << std::endl;
         return 1;
     }
 
 	const uint64_t num_threads = nthreads ? args::get(nthreads) : 1;
+	algorithms::numa::set_pin_threads(args::get(numa_pin_threads));
+	const uint64_t flat_index_max_bytes = p_sgd_flat_index_mem ? (uint64_t)(args::get(p_sgd_flat_index_mem) * 1024 * 1024 * 1024) : 0;
 
 	graph_t graph;
     assert(argc > 0);
@@ -144,6 +179,9 @@ int main_layout(int argc, char **argv) {
         getcwd(cwd, sizeof(cwd));
         xp::temp_file::set_dir(std::string(cwd));
     }
+    if (p_sgd_zipf_cache) {
+        algorithms::zipf_zetas_cache::set_dir(args::get(p_sgd_zipf_cache));
+    }
 
     if (!graph.is_optimized()) {
 		std::cerr << "[odgi::layout] error: the graph is not optimized. Please run 'odgi sort' using -O, --optimize." << std::endl;
@@ -202,12 +240,43 @@ int main_layout(int argc, char **argv) {
     double path_sgd_eps = p_sgd_eps ? args::get(p_sgd_eps) : 0.01;
     double path_sgd_delta = p_sgd_delta ? args::get(p_sgd_delta) : 0;
     double path_sgd_cooling = p_sgd_cooling ? args::get(p_sgd_cooling) : 0.5;
+    const double path_sgd_repulsion = p_sgd_repulsion ? args::get(p_sgd_repulsion) : 0;
+    if (path_sgd_repulsion < 0) {
+        std::cerr << "[odgi::layout] error: the repulsion given by --path-sgd-repulsion=[N] must not be negative." << std::endl;
+        return 1;
+    }
+    algorithms::sgd_checkpoint_config_t path_sgd_checkpoint;
+    if (p_sgd_checkpoint) {
+        path_sgd_checkpoint.filename = args::get(p_sgd_checkpoint);
+        path_sgd_checkpoint.interval_seconds = p_sgd_checkpoint_interval ? args::get(p_sgd_checkpoint_interval) : 600;
+        path_sgd_checkpoint.resume = args::get(p_sgd_resume);
+    } else if (p_sgd_resume || p_sgd_checkpoint_interval) {
+        std::cerr << "[odgi::layout] error: --resume and --checkpoint-interval need a --checkpoint FILE." << std::endl;
+        return 1;
+    }
     // will be filled, if the user decides to write a snapshot of the graph after each sorting iterationn
     const bool snapshot = p_sgd_snapshot;
     std::string snapshot_prefix;
     if (snapshot) {
         snapshot_prefix = args::get(p_sgd_snapshot);
     }
+    if (p_sgd_sync_interval) {
+        if (args::get(p_sgd_sync_interval) == 0) {
+            std::cerr << "[odgi::layout] error: --sync-interval must be at least 1." << std::endl;
+            return 1;
+        }
+        algorithms::distributed::set_sync_interval(args::get(p_sgd_sync_interval));
+    }
+#ifdef USE_GPU
+    const bool gpu = args::get(gpu_compute);
+#else
+    const bool gpu = false;
+#endif
+    if (algorithms::distributed::active() && (snapshot || p_sgd_checkpoint || gpu)) {
+        std::cerr << "[odgi::layout] error: --path-sgd-snapshot, --checkpoint and --gpu can not be used in an MPI run"
+                  << " with more than one rank." << std::endl;
+        return 1;
+    }
 
     // default parameters that need a path index to be present
     uint64_t path_sgd_min_term_updates;
@@ -216,15 +285,6 @@ int main_layout(int argc, char **argv) {
     xp::XP path_index;
     bool first_time_index = true;
 
-    // take care of path index
-    if (xp_in_file) {
-        std::ifstream in;
-        in.open(args::get(xp_in_file));
-        path_index.load(in);
-        in.close();
-    } else {
-        path_index.from_handle_graph(graph, num_threads);
-    }
     // do we only want so sample from a subset of paths?
     if (p_sgd_in_file) {
         std::string buf;
@@ -246,6 +306,24 @@ int main_layout(int argc, char **argv) {
                 path_sgd_use_paths.push_back(path);
             });
     }
+    // take care of path index, which only needs the paths we sample from
+    if (xp_in_file) {
+        std::ifstream in;
+        in.open(args::get(xp_in_file));
+        path_index.load(in);
+        in.close();
+        for (auto &path : path_sgd_use_paths) {
+            if (path_index.get_path_step_count(path) != graph.get_step_count(path)) {
+                std::cerr << "[odgi::layout] error: the path index given by -X=[FILE], --path-index=[FILE] does not"
+                             " index the steps of path '" << graph.get_path_name(path) << "'." << std::endl;
+                return 1;
+            }
+        }
+    } else if (p_sgd_in_file) {
+        path_index.from_handle_graph(graph, path_sgd_use_paths, num_threads);
+    } else {
+        path_index.from_handle_graph(graph, num_threads);
+    }
 
 
     uint64_t sum_path_step_count = get_sum_path_step_count(path_sgd_use_paths, path_index);
@@ -329,6 +407,73 @@ int main_layout(int argc, char **argv) {
           //std::cerr << pos << ": " << graph_X[pos] << "," << graph_Y[pos] << " ------ " << graph_X[pos + 1] << "," << graph_Y[pos + 1] << std::endl;
       });
 
+    if (multilevel) {
+        algorithms::coarse_graph_t coarse;
+        algorithms::coarsen_simple_components(graph, path_sgd_use_paths, coarse, num_threads);
+        const uint64_t coarse_node_count = coarse.graph.get_node_count();
+        if (coarse_node_count == graph.get_node_count()) {
+            if (show_progress) {
+                std::cerr << "[odgi::layout] multilevel: no simple components to merge, laying out the full graph" << std::endl;
+            }
+        } else {
+            if (show_progress) {
+                std::cerr << "[odgi::layout] multilevel: laying out the coarse graph with " << coarse_node_count
+                          << " of " << graph.get_node_count() << " nodes" << std::endl;
+            }
+            std::vector<std::atomic<double>> coarse_X(coarse_node_count * 2);
+            std::vector<std::atomic<double>> coarse_Y(coarse_node_count * 2);
+            algorithms::restrict_layout(graph, coarse, graph_X, graph_Y, coarse_X, coarse_Y);
+
+            xp::XP coarse_index;
+            coarse_index.from_handle_graph(coarse.graph, num_threads);
+            const uint64_t coarse_sum_path_step_count = get_sum_path_step_count(coarse.paths, coarse_index);
+            uint64_t coarse_min_term_updates;
+            if (args::get(p_sgd_min_term_updates_paths)) {
+                coarse_min_term_updates = args::get(p_sgd_min_term_updates_paths) * coarse_sum_path_step_count;
+            } else if (args::get(p_sgd_min_term_updates_num_nodes)) {
+                coarse_min_term_updates = args::get(p_sgd_min_term_updates_num_nodes) * coarse_node_count;
+            } else {
+                coarse_min_term_updates = 10.0 * coarse_sum_path_step_count;
+            }
+            const uint64_t coarse_max_path_step_count = get_max_path_step_count(coarse.paths, coarse_index);
+            const uint64_t coarse_zipf_space = args::get(p_sgd_zipf_space) ? std::min(args::get(p_sgd_zipf_space), coarse_max_path_step_count) : coarse_max_path_step_count;
+            const double coarse_max_eta = args::get(p_sgd_eta_max) ? args::get(p_sgd_eta_max) : (double) coarse_max_path_step_count * coarse_max_path_step_count;
+            const uint64_t coarse_zipf_space_max = args::get(p_sgd_zipf_space_max) ? std::min(coarse_zipf_space, args::get(p_sgd_zipf_space_max)) : 1000;
+
+            algorithms::path_linear_sgd_layout(
+                coarse.graph,
+                coarse_index,
+                coarse.paths,
+                path_sgd_iter_max,
+                0,
+                coarse_min_term_updates,
+                sgd_delta,
+                eps,
+                coarse_max_eta,
+                path_sgd_zipf_theta,
+                coarse_zipf_space,
+                coarse_zipf_space_max,
+                path_sgd_zipf_space_quantization_step,
+                path_sgd_cooling,
+                num_threads,
+                show_progress,
+                false,
+                snapshot_prefix,
+                coarse_X,
+                coarse_Y,
+                args::get(hogwild),
+                flat_index_max_bytes,
+                path_sgd_repulsion
+                );
+            algorithms::project_layout(graph, coarse, coarse_X, coarse_Y, graph_X, graph_Y, num_threads);
+
+            // the refinement only has to settle the nodes within the merged components
+            path_sgd_iter_max = multilevel_refine_iter ? args::get(multilevel_refine_iter) : std::max((uint64_t)1, path_sgd_iter_max / 3);
+            path_sgd_max_eta = multilevel_refine_eta_max ? args::get(multilevel_refine_eta_max)
+                : std::max(1.0, (double) coarse.max_merged_length * coarse.max_merged_length);
+        }
+    }
+
     //double max_x = 0;
 #ifdef USE_GPU
     if (gpu_compute) { // run on GPU
@@ -352,7 +497,9 @@ int main_layout(int argc, char **argv) {
             snapshot,
             snapshot_prefix,
             graph_X,
-            graph_Y
+            graph_Y,
+            gpu_count ? args::get(gpu_count) : 0,
+            gpu_chunk_steps ? args::get(gpu_chunk_steps) : 0
             );
     } 
 #endif
@@ -380,7 +527,11 @@ int main_layout(int argc, char **argv) {
             snapshot,
             snapshot_prefix,
             graph_X,
-            graph_Y
+            graph_Y,
+            args::get(hogwild),
+            flat_index_max_bytes,
+            path_sgd_repulsion,
+            path_sgd_checkpoint
             );
 #ifdef USE_GPU
     }
@@ -435,14 +586,18 @@ int main_layout(int argc, char **argv) {
     }
 
 
+    if (!algorithms::distributed::is_root()) {
+        // the ranks of an MPI run end up with the same layout, one writes it
+        return 0;
+    }
     if (tsv_out_file) {
         auto& outfile = args::get(tsv_out_file);
         if (outfile.size()) {
             if (outfile == "-") {
-                algorithms::layout::to_tsv(std::cout, X_final, Y_final, weak_components);
+                algorithms::layout::to_tsv(std::cout, X_final, Y_final, weak_components, num_threads);
             } else {
                 ofstream f(outfile.c_str());
-                algorithms::layout::to_tsv(f, X_final, Y_final, weak_components);
+                algorithms::layout::to_tsv(f, X_final, Y_final, weak_components, num_threads);
                 f.close();
             }
         }
@@ -461,6 +616,21 @@ int main_layout(int argc, char **argv) {
             }
         }
     }
+
+    if (binary_out_file) {
+        auto& outfile = args::get(binary_out_file);
+        if (outfile.size()) {
+            algorithms::layout::Layout lay(X_final, Y_final);
+            const std::string metadata = "odgi layout\tgraph=" + args::get(dg_in_file);
+            if (outfile == "-") {
+                lay.serialize_binary(std::cout, metadata);
+            } else {
+                ofstream f(outfile.c_str(), std::ios::binary);
+                lay.serialize_binary(f, metadata);
+                f.close();
+            }
+        }
+    }
     
     return 0;
 }
@@ -2,6 +2,7 @@
 #include "odgi.hpp"
 #include "args.hxx"
 #include "algorithms/matrix_writer.hpp"
+#include "algorithms/depth.hpp"
 #include "utils.hpp"
 
 namespace odgi {
@@ -23,7 +24,9 @@ int main_matrix(int argc, char** argv) {
     args::ValueFlag<std::string> dg_in_file(mandatory_opts, "FILE", "Load the succinct variation graph in ODGI format from this *FILE*. The file name usually ends with *.og*. It also accepts GFAv1, but the on-the-fly conversion to the ODGI format requires additional time!", {'i', "idx"});
     args::Group matrix_opts(parser, "[ Matrix Options ]");
     args::Flag weight_by_edge_depth(matrix_opts, "edge-depth-weight", "Weigh edges by their path depth.", {'e', "edge-depth-weight"});
+    args::ValueFlag<std::string> edge_depth_index_file(matrix_opts, "FILE", "Read the path depth of the edges for *-e, --edge-depth-weight* from the edge depth index in *FILE*, written via *odgi depth --write-edge-depth-index*, instead of walking the paths.", {"edge-depth-index"});
     args::Flag weight_by_edge_delta(matrix_opts, "delta-weight", "Weigh edges by the inverse id delta.", {'d', "delta-weight"});
+    args::ValueFlag<std::string> npz_out_file(matrix_opts, "FILE", "Write the matrix to *FILE* as a binary COO matrix in the .npz format of scipy.sparse.save_npz, with 0-based node ids, instead of as text to stdout.", {"npz"});
 	args::Group threading(parser, "[ Threading ]");
 	args::ValueFlag<uint64_t> nthreads(threading, "N", "Number of threads to use for parallel operations.", {'t', "threads"});
 	args::Group processing_info_opts(parser, "[ Processing Information ]");
@@ -67,7 +70,34 @@ int main_matrix(int argc, char** argv) {
         }
     }
 
-    algorithms::write_as_sparse_matrix(std::cout, graph, args::get(weight_by_edge_depth), args::get(weight_by_edge_delta));
+    // the path depth of the edges, counted once for the whole matrix or read from a file
+    std::unique_ptr<algorithms::edge_depth_index_t> edge_depths;
+    if (args::get(weight_by_edge_depth)) {
+        if (edge_depth_index_file) {
+            edge_depths.reset(new algorithms::edge_depth_index_t());
+            std::ifstream in(args::get(edge_depth_index_file), std::ios::binary);
+            if (!in || !edge_depths->load(in) || !edge_depths->is_index_of(graph)) {
+                std::cerr << "[odgi::matrix] error: \"" << args::get(edge_depth_index_file) << "\" does not hold an edge depth index of the graph written via odgi depth --write-edge-depth-index." << std::endl;
+                return 1;
+            }
+        } else {
+            edge_depths.reset(new algorithms::edge_depth_index_t(graph, num_threads));
+        }
+    }
+
+    if (npz_out_file) {
+        std::ofstream out(args::get(npz_out_file), std::ios::binary);
+        if (!out) {
+            std::cerr << "[odgi::matrix] error: could not open " << args::get(npz_out_file) << " for writing." << std::endl;
+            return 1;
+        }
+        if (!algorithms::write_as_sparse_npz(out, graph, args::get(weight_by_edge_depth), args::get(weight_by_edge_delta), num_threads, edge_depths.get())) {
+            std::cerr << "[odgi::matrix] error: the matrix is too large for the .npz archive." << std::endl;
+            return 1;
+        }
+    } else {
+        algorithms::write_as_sparse_matrix(std::cout, graph, args::get(weight_by_edge_depth), args::get(weight_by_edge_delta), num_threads, edge_depths.get());
+    }
 
     return 0;
 }
@@ -74,6 +74,9 @@ int main_normalize(int argc, char** argv) {
         }
     }
 
+    omp_set_num_threads(num_threads);
+    graph.set_number_of_threads(num_threads);
+
     algorithms::normalize(graph, args::get(max_iterations) ? args::get(max_iterations) : 10, args::get(debug));
 
     {
@@ -6,6 +6,7 @@
 #include <omp.h>
 #include <mutex>
 #include "utils.hpp"
+#include "algorithms/ordered_chunk_writer.hpp"
 
 namespace odgi {
 
@@ -118,7 +119,7 @@ namespace odgi {
                 add_bed_range(path_ranges, graph, line);
             }
         } else {// if (bed_input) {
-            std::ifstream bed_in(args::get(bed_input));
+            algorithms::readahead_ifstream_t bed_in(args::get(bed_input));
             std::string line;
             while (std::getline(bed_in, line)) {
                 add_bed_range(path_ranges, graph, line);
@@ -128,59 +129,95 @@ namespace odgi {
         if (!path_ranges.empty()) {
             std::cout << "#path\tstart\tend\tpath.touched" << std::endl;
 
-//#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
-            for (auto &path_range : path_ranges) {
-                // Collect handles crossed by the path in the specified range
-                uint64_t start = path_range.begin.offset;
-                uint64_t end = path_range.end.offset;
-                path_handle_t path_handle = path_range.begin.path;
-
-                std::unordered_set<handle_t> handles;
-
-                uint64_t walked = 0;
-                auto path_end = graph.path_end(path_handle);
-                for (step_handle_t cur_step = graph.path_begin(path_handle);
-                     cur_step != path_end && walked < end; cur_step = graph.get_next_step(cur_step)) {
-                    handle_t cur_handle = graph.get_handle_of_step(cur_step);
-                    uint64_t cur_length = graph.get_length(cur_handle);
-                    walked += cur_length;
-                    if (walked >= start) {
-                        handles.insert(cur_handle);
-                    }
+            // collect the nodes crossed by each range, by id minus the smallest id,
+            // jumping to the first step of the range with the step index of its path
+            std::vector<std::vector<uint64_t>> range_nodes(path_ranges.size());
+            const uint64_t shift = graph.min_node_id();
+            const uint64_t node_slots = graph.max_node_id() - shift + 1;
+            atomicbitvector::atomic_bv_t in_a_range(node_slots);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+            for (uint64_t i = 0; i < path_ranges.size(); ++i) {
+                const auto& path_range = path_ranges[i];
+                const uint64_t start = path_range.begin.offset;
+                const uint64_t end = path_range.end.offset;
+                const path_handle_t path_handle = path_range.begin.path;
+                if (end == 0 || graph.get_step_count(path_handle) == 0) continue;
+                // the ranges keep the steps ending at their start, as the walk from the path begin used to
+                step_handle_t cur_step = graph.get_step_at_position(path_handle, start ? start - 1 : 0);
+                const auto path_end = graph.path_end(path_handle);
+                if (cur_step == path_end) continue;
+                uint64_t walked = graph.get_position_of_step(cur_step);
+                auto& nodes = range_nodes[i];
+                for (; cur_step != path_end && walked < end; cur_step = graph.get_next_step(cur_step)) {
+                    const handle_t cur_handle = graph.get_handle_of_step(cur_step);
+                    walked += graph.get_length(cur_handle);
+                    nodes.push_back(graph.get_id(cur_handle) - shift);
+                    in_a_range.set(nodes.back());
                 }
+                std::sort(nodes.begin(), nodes.end());
+                nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+            }
 
-                // Collect paths that cross the collected handles
-                std::vector<path_handle_t> touched_path_handles;
+            // the paths to report, by path handle
+            uint64_t max_path_id = 0;
+            for (auto& p : paths_to_consider) {
+                max_path_id = std::max(max_path_id, (uint64_t)as_integer(p));
+            }
+            std::vector<bool> is_considered(max_path_id + 1, false);
+            for (auto& p : paths_to_consider) {
+                is_considered[as_integer(p)] = true;
+            }
 
-                std::mutex touched_path_handles_mutex;
+            // index the distinct considered paths of each node in a range once, so that overlapping
+            // ranges share the lookups and no path is walked
+            std::vector<std::vector<uint64_t>> node_paths(node_slots);
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(num_threads)
+            for (uint64_t i = 0; i < node_slots; ++i) {
+                if (!in_a_range.test(i) || !graph.has_node(i + shift)) continue;
+                auto& paths = node_paths[i];
+                graph.visit_steps_on_handle(graph.get_handle(i + shift),
+                                            [&](const step_handle_t& step, const path_handle_t& path) {
+                                                const uint64_t path_id = as_integer(path);
+                                                if (path_id <= max_path_id && is_considered[path_id]) {
+                                                    paths.push_back(path_id);
+                                                }
+                                            });
+                std::sort(paths.begin(), paths.end());
+                paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+                paths.shrink_to_fit();
+            }
+
+            // answer the ranges in parallel, writing them out in input order
+            algorithms::ordered_chunk_writer writer(std::cout);
+            writer.open_writer();
 #pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
-                for (path_handle_t p_h : paths_to_consider) {
-                    if (p_h != path_handle) {
-                        bool stop = false;
-                        graph.for_each_step_in_path(p_h, [&](const step_handle_t &step) {
-                            if (!stop && handles.count(graph.get_handle_of_step(step)) > 0) {
-                                {
-                                    std::lock_guard<std::mutex> guard(touched_path_handles_mutex);
-                                    touched_path_handles.push_back(p_h);
-                                }
-
-                                stop = true;
-                            }
-                        });
-                    }
+            for (uint64_t i = 0; i < path_ranges.size(); ++i) {
+                const auto& path_range = path_ranges[i];
+                const path_handle_t path_handle = path_range.begin.path;
+                std::vector<uint64_t> touched;
+                for (auto& node : range_nodes[i]) {
+                    const auto& paths = node_paths[node];
+                    touched.insert(touched.end(), paths.begin(), paths.end());
                 }
-
-                std::sort(touched_path_handles.begin(), touched_path_handles.end(),
-                        [](const path_handle_t& a, const path_handle_t& b) {
-                            return as_integer(a) < as_integer(b);
-                        });
-
-//#pragma omp critical (cout)
-                for (auto touched_path_handle : touched_path_handles) {
-                    std::cout << (graph.get_path_name(path_handle)) << "\t" << start << "\t" << end << "\t"
-                              << graph.get_path_name(touched_path_handle) << std::endl;
+                std::sort(touched.begin(), touched.end());
+                touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+
+                const std::string prefix = graph.get_path_name(path_handle) + "\t"
+                    + std::to_string(path_range.begin.offset) + "\t" + std::to_string(path_range.end.offset) + "\t";
+                std::string text;
+                for (auto& path_id : touched) {
+                    if (path_id == as_integer(path_handle)) continue;
+                    text.append(prefix);
+                    text.append(graph.get_path_name(as_path_handle(path_id)));
+                    text.push_back('\n');
+                    if (text.size() >= (1 << 20)) {
+                        writer.append(i, text, false);
+                        text.clear();
+                    }
                 }
+                writer.append(i, text, true);
             }
+            writer.close_writer();
         }
 
         return 0;
@@ -22,6 +22,9 @@ namespace odgi {
         args::Group mandatory_opts(parser, "[ MANDATORY OPTIONS ]");
         args::ValueFlag<std::string> dg_in_file(mandatory_opts, "FILE", "Load the succinct variation graph in ODGI format from this *FILE*. The file name usually ends with *.og*.", {'i', "idx"});
         args::ValueFlag<std::string> idx_out_file(mandatory_opts, "FILE", "Write the succinct variation graph index to this FILE. A file ending with *.xp* is recommended.", {'o', "out"});
+        args::Group index_opts(parser, "[ Index Options ]");
+        args::ValueFlag<std::string> paths_in_file(index_opts, "FILE", "Only index the steps of the paths listed in this *FILE*, one path name per line, such as those given to the path guided SGD of odgi sort and odgi layout by -f, --path-sgd-use-paths. The other paths keep their name in the index, but none of their steps.", {'f', "paths"});
+        args::Flag pos_table(index_opts, "pos-table", "Also store a table of the runs of path steps that are contiguous in the pangenome, which answers the pangenome position queries of odgi panpos and odgi server with one binary search.", {'p', "pos-table"});
         args::Group threading_opts(parser, "[ Threading ]");
         args::ValueFlag<std::uint64_t> nthreads(threading_opts, "N", "Number of threads to use for parallel operations.", {'t', "threads"});
 		args::Group processing_info_opts(parser, "[ Processing Information ]");
@@ -74,10 +77,35 @@ namespace odgi {
         }
 
         XP path_index;
-        path_index.from_handle_graph(graph, num_threads);
-		if (progress) {
-			std::cout << "Indexed " << path_index.path_count << " path(s)." << std::endl;
-		}
+        if (paths_in_file) {
+            std::vector<path_handle_t> indexed_paths;
+            std::ifstream in(args::get(paths_in_file).c_str());
+            std::string buf;
+            while (std::getline(in, buf)) {
+                if (buf.empty()) {
+                    continue;
+                }
+                if (!graph.has_path(buf)) {
+                    std::cerr << "[odgi::pathindex] error: path '" << buf
+                              << "' as was given by -f=[FILE], --paths=[FILE] is not present in the graph." << std::endl;
+                    return 1;
+                }
+                indexed_paths.push_back(graph.get_path_handle(buf));
+            }
+            path_index.from_handle_graph(graph, indexed_paths, num_threads);
+            if (progress) {
+                std::cout << "Indexed the steps of " << indexed_paths.size() << " of " << path_index.path_count
+                          << " path(s)." << std::endl;
+            }
+        } else {
+            path_index.from_handle_graph(graph, num_threads);
+            if (progress) {
+                std::cout << "Indexed " << path_index.path_count << " path(s)." << std::endl;
+            }
+        }
+        if (pos_table) {
+            path_index.build_pangenome_pos_table(num_threads);
+        }
 
 #ifdef debug_pathindex
         size_t pangenome_pos = path_index.get_pangenome_pos("5", 1);
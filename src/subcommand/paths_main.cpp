@@ -1,11 +1,15 @@
 #include "subcommand.hpp"
 #include "odgi.hpp"
+#include "mmap_graph.hpp"
 #include "args.hxx"
 #include "split.hpp"
 #include "position.hpp"
 #include <omp.h>
 #include "utils.hpp"
 #include "algorithms/path_keep.hpp"
+#include "algorithms/coverage_matrix.hpp"
+#include "algorithms/ordered_chunk_writer.hpp"
+#include "algorithms/npz_writer.hpp"
 
 namespace odgi {
 
@@ -28,6 +32,65 @@ bool isValid(const std::string& levels, double max_val) {
     return true;
 }
 
+// -L/--list-paths, -l/--list-path-start-end and -f/--fasta only need the path interface,
+// so they are shared between the dynamic graph and the memory-mapped one
+template<typename Graph>
+void print_path_listing(const Graph& graph, bool list_names, bool list_path_start_end,
+                        bool write_fasta, uint64_t num_threads) {
+    if (list_path_start_end && list_names) {
+    	std::vector<path_handle_t> paths;
+		graph.for_each_path_handle([&](const path_handle_t& p) {
+			paths.push_back(p);
+		});
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+		for (auto path : paths) {
+			uint64_t path_len = 0;
+			graph.for_each_step_in_path(path, [&](const step_handle_t& s) {
+				handle_t h = graph.get_handle_of_step(s);
+				path_len += graph.get_length(h);
+			});
+#pragma omp critical (cout)
+			std::cout << graph.get_path_name(path) << "\t" << 1 << "\t" << path_len << std::endl;
+		}
+	} else if (list_names) {
+        graph.for_each_path_handle([&](const path_handle_t& p) {
+                std::cout << graph.get_path_name(p) << std::endl;
+            });
+    }
+
+    if (write_fasta) {
+        std::vector<path_handle_t> paths;
+        graph.for_each_path_handle([&](const path_handle_t& p) {
+            paths.push_back(p);
+        });
+        // one path per thread, written in order
+        algorithms::ordered_chunk_writer writer(std::cout);
+        writer.open_writer();
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+        for (uint64_t i = 0; i < paths.size(); ++i) {
+            const path_handle_t& p = paths[i];
+            // size the record up front, then decode into it instead of allocating a string per step
+            uint64_t path_len = 0;
+            graph.for_each_step_in_path(p, [&](const step_handle_t& s) {
+                path_len += graph.get_length(graph.get_handle_of_step(s));
+            });
+            const std::string path_name = graph.get_path_name(p);
+            std::string record;
+            record.reserve(path_name.size() + path_len + 3);
+            record.push_back('>');
+            record.append(path_name);
+            record.push_back('\n');
+            graph.for_each_step_in_path(
+                p, [&](const step_handle_t& s) {
+                       graph.append_sequence(graph.get_handle_of_step(s), record);
+                   });
+            record.push_back('\n');
+            writer.append(i, record, true);
+        }
+        writer.close_writer();
+    }
+}
+
 int main_paths(int argc, char** argv) {
 
     // trick argumentparser to do the right thing with the subcommand
@@ -40,7 +103,7 @@ int main_paths(int argc, char** argv) {
 
     args::ArgumentParser parser("Interrogate the embedded paths of a graph. Does not print anything to stdout by default!");
     args::Group mandatory_opts(parser, "[ MANDATORY ARGUMENTS ]");
-    args::ValueFlag<std::string> dg_in_file(mandatory_opts, "FILE", "Load the succinct variation graph in ODGI format from this *FILE*. The file name usually ends with *.og*. It also accepts GFAv1, but the on-the-fly conversion to the ODGI format requires additional time!", {'i', "idx"});
+    args::ValueFlag<std::string> dg_in_file(mandatory_opts, "FILE", "Load the succinct variation graph in ODGI format from this *FILE*. The file name usually ends with *.og*. It also accepts GFAv1, but the on-the-fly conversion to the ODGI format requires additional time! A graph frozen with odgi view -m can be given as its file, or as shm:NAME once shared with odgi view --to-shm; only -L, -l and -f apply to it.", {'i', "idx"});
     args::Group path_investigation_opts(parser, "[ Path Investigation Options ]");
     args::ValueFlag<std::string> overlaps_file(path_investigation_opts, "FILE", "Read in the path grouping *FILE* to generate the overlap statistics"
                                                                " from. The file must be tab-delimited. The first column lists a"
@@ -57,6 +120,11 @@ int main_paths(int argc, char** argv) {
                                                               " *path.name*, *path.length*, *path.step.count*, *node.1*,"
                                                               " *node.2*, *node.n*. Each path entry is printed in its own line.", {'H', "haplotypes"});
     args::Flag scale_by_node_length(path_investigation_opts, "haplo", "Scale the haplotype matrix cells by node length.", {'N', "scale-by-node-len"});
+    args::ValueFlag<std::string> haplo_matrix_npy(path_investigation_opts, "FILE", "With -H/--haplotypes, write the cells of the matrix to *FILE* in NumPy .npy format, one row per path and"
+                                                  " one column per node, as 32-bit unsigned integers, or 64-bit ones with -N/--scale-by-node-len."
+                                                  " stdout then only gets the leading columns of each row.", {"haplotypes-npy"});
+    args::ValueFlag<std::string> coverage_matrix_file(path_investigation_opts, "FILE", "With -H/--haplotypes, take the steps of the paths on the nodes from the coverage matrix in *FILE*,"
+                                                      " instead of walking the paths. If *FILE* does not exist or was built for another graph, it is built and written there.", {"coverage-matrix"});
    
     args::Group non_ref_opts(parser, "[ Non-ref. Sequence Options ]");
     args::ValueFlag<std::string> non_reference_nodes(non_ref_opts, "FILE", "Print to stdout IDs of nodes that are not in the paths listed (by line) in *FILE*.", {"non-reference-nodes"});
@@ -82,6 +150,8 @@ int main_paths(int argc, char** argv) {
     args::ValueFlag<std::string> keep_paths_file(path_modification_opts, "FILE", "Keep paths listed (by line) in *FILE*.", {'K', "keep-paths"});
     args::ValueFlag<std::string> drop_paths_file(path_modification_opts, "FILE", "Drop paths listed (by line) in *FILE*.", {'X', "drop-paths"});
     args::ValueFlag<std::string> dg_out_file(path_modification_opts, "FILE", "Write the dynamic succinct variation graph to this file (e.g. *.og*).", {'o', "out"});
+    args::Flag delta(path_modification_opts, "delta", "Drop the paths from the input graph itself and write only the changes,"
+                     " as a delta over the input graph that ODGI commands load on top of it; odgi compact writes the graph in full.", {"delta"});
     args::Group threading_opts(parser, "[ Threading ]");
     args::ValueFlag<uint64_t> threads(threading_opts, "N", "Number of threads to use for parallel operations.", {'t', "threads"});
 	args::Group processing_info_opts(parser, "[ Processing Information ]");
@@ -149,12 +219,30 @@ int main_paths(int argc, char** argv) {
         return 1;
     }
 
+    if (haplo_matrix_npy && !haplo_matrix) {
+        std::cerr << "[odgi::paths] error: --haplotypes-npy requires -H, --haplotypes." << std::endl;
+        return 1;
+    }
+
 	const uint64_t num_threads = args::get(threads) ? args::get(threads) : 1;
     omp_set_num_threads(num_threads);
 
+    std::string infile = args::get(dg_in_file);
+    if (infile != "-" && mmap_graph_t::is_mmap_graph(infile)) {
+        if (overlaps_file || haplo_matrix || non_reference_nodes || non_reference_ranges
+            || coverage_levels || fraction_levels || keep_paths_file || drop_paths_file) {
+            std::cerr << "[odgi::paths] error: a memory-mapped graph only supports -L,--list-paths, -l,--list-path-start-end and -f,--fasta." << std::endl;
+            return 1;
+        }
+        mmap_graph_t graph;
+        graph.load(infile);
+        print_path_listing(graph, args::get(list_names), args::get(list_path_start_end),
+                           args::get(write_fasta), num_threads);
+        return 0;
+    }
+
 	graph_t graph;
     assert(argc > 0);
-    std::string infile = args::get(dg_in_file);
     if (infile.size()) {
         if (infile == "-") {
             graph.deserialize(std::cin);
@@ -176,38 +264,8 @@ int main_paths(int argc, char** argv) {
         }
     }
 
-    if (list_path_start_end && list_names) {
-    	std::vector<path_handle_t> paths;
-		graph.for_each_path_handle([&](const path_handle_t& p) {
-			paths.push_back(p);
-		});
-#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
-		for (auto path : paths) {
-			uint64_t path_len = 0;
-			graph.for_each_step_in_path(path, [&](const step_handle_t& s) {
-				handle_t h = graph.get_handle_of_step(s);
-				path_len += graph.get_length(h);
-			});
-#pragma omp critical (cout)
-			std::cout << graph.get_path_name(path) << "\t" << 1 << "\t" << path_len << std::endl;
-		}
-	} else if (args::get(list_names)) {
-        graph.for_each_path_handle([&](const path_handle_t& p) {
-                std::cout << graph.get_path_name(p) << std::endl;
-            });
-    }
-
-    if (args::get(write_fasta)) {
-        graph.for_each_path_handle(
-            [&](const path_handle_t& p) {
-                std::cout << ">" << graph.get_path_name(p) << std::endl;
-                graph.for_each_step_in_path(
-                    p, [&](const step_handle_t& s) {
-                           std::cout << graph.get_sequence(graph.get_handle_of_step(s));
-                       });
-                std::cout << std::endl;
-            });
-    }
+    print_path_listing(graph, args::get(list_names), args::get(list_path_start_end),
+                       args::get(write_fasta), num_threads);
 
     const uint16_t delim_pos = path_delim_pos ? args::get(path_delim_pos) - 1 : 0;
 
@@ -242,13 +300,33 @@ int main_paths(int argc, char** argv) {
             header << "path.name" << "\t"
                    << "path.length" << "\t"
                    << "path.step.count";
-            graph.for_each_handle(
-                [&](const handle_t& handle) {
-                    header << "\t" << "node." << graph.get_id(handle);
-                });
+            if (args::get(haplo_matrix_npy).empty()) {
+                graph.for_each_handle(
+                    [&](const handle_t& handle) {
+                        header << "\t" << "node." << graph.get_id(handle);
+                    });
+            }
             std::cout << header.str() << std::endl;
         }
         bool node_length_scale = args::get(scale_by_node_length);
+        // the runs of nodes each path is on, with its steps on each node of the run
+        algorithms::coverage_matrix_t coverage;
+        std::vector<std::vector<std::pair<uint64_t, uint64_t>>> path_runs;
+        if (coverage_matrix_file) {
+            if (!coverage.load_or_build(args::get(coverage_matrix_file), graph, num_threads, args::get(progress), "paths")) {
+                return 1;
+            }
+            path_runs.resize(coverage.get_path_count());
+            for (uint64_t run = 0; run < coverage.get_run_count(); ++run) {
+                coverage.for_each_path_in_run(run, [&](const uint64_t& p, const uint64_t& c) {
+                    path_runs[p].emplace_back(run, c);
+                });
+            }
+        }
+        // the group and path name of each row, checked serially so the messages keep their order
+        std::vector<path_handle_t> paths;
+        std::vector<std::string> group_names;
+        std::vector<std::string> path_names;
         graph.for_each_path_handle(
             [&](const path_handle_t& p) {
                 std::string full_path_name = graph.get_path_name(p);
@@ -260,16 +338,56 @@ int main_paths(int argc, char** argv) {
                     std::cerr << "[odgi::paths] warning: path name '" << full_path_name << "' has too few occurrences of '" << delim << "'. "
                               << "The " << cnt_pos.first + 1 << "-th occurrence is used." << std::endl;
                 }
-                std::string group_name = (delim ? full_path_name.substr(0, cnt_pos.second) : "");
-                std::string path_name = (delim ? full_path_name.substr(cnt_pos.second+1) : full_path_name);
-                uint64_t path_length = 0;
-                uint64_t path_step_count = 0;
-                std::vector<uint64_t> row(graph.get_node_count());
-                // Initialize first to avoid possible bugs later
-                for (uint32_t i = 0; i < graph.get_node_count(); ++i) {
-                    row[i] = 0;
-                }
+                paths.push_back(p);
+                group_names.push_back(delim ? full_path_name.substr(0, cnt_pos.second) : "");
+                path_names.push_back(delim ? full_path_name.substr(cnt_pos.second+1) : full_path_name);
+            });
+        std::vector<uint64_t> node_lengths;
+        if (node_length_scale) {
+            node_lengths.resize(graph.get_node_count());
+            for (uint64_t i = 0; i < node_lengths.size(); ++i) {
+                node_lengths[i] = graph.get_length(graph.get_handle(i+shift));
+            }
+        }
 
+        // with --haplotypes-npy the cells go there, row by row, and stdout only keeps the leading columns
+        std::ofstream npy;
+        const bool write_npy = !args::get(haplo_matrix_npy).empty();
+        if (write_npy) {
+            npy.open(args::get(haplo_matrix_npy), std::ios::binary);
+            if (!npy) {
+                std::cerr << "[odgi::paths] error: could not open " << args::get(haplo_matrix_npy) << " for writing." << std::endl;
+                return 1;
+            }
+            const std::string header = algorithms::npy_header(node_length_scale ? "<u8" : "<u4",
+                                                              {paths.size(), graph.get_node_count()});
+            npy.write(header.data(), header.size());
+        }
+        algorithms::ordered_chunk_writer writer(std::cout);
+        std::unique_ptr<algorithms::ordered_chunk_writer> npy_writer;
+        writer.open_writer();
+        if (write_npy) {
+            npy_writer = std::make_unique<algorithms::ordered_chunk_writer>(npy);
+            npy_writer->open_writer();
+        }
+        // a row per path, counted and formatted in parallel and written in path order
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+        for (uint64_t k = 0; k < paths.size(); ++k) {
+            const path_handle_t& p = paths[k];
+            uint64_t path_length = 0;
+            uint64_t path_step_count = 0;
+            std::vector<uint32_t> row(graph.get_node_count(), 0);
+
+            if (coverage_matrix_file) {
+                const uint64_t path_rank = coverage.get_path_rank(p);
+                path_length = coverage.get_path_length(path_rank);
+                path_step_count = coverage.get_path_step_count(path_rank);
+                for (auto& run_count : path_runs[path_rank]) {
+                    const uint64_t first = coverage.get_run_first_node(run_count.first);
+                    std::fill(row.begin() + first, row.begin() + first + coverage.get_run_node_count(run_count.first),
+                              run_count.second);
+                }
+            } else {
                 graph.for_each_step_in_path(
                     p,
                     [&](const step_handle_t& s) {
@@ -278,23 +396,42 @@ int main_paths(int argc, char** argv) {
                         ++path_step_count;
                         row[graph.get_id(h)-shift]++;
                     });
-                if (delim) {
-                    std::cout << group_name << "\t";
-                }
-                std::cout << path_name << "\t"
-                          << path_length << "\t"
-                          << path_step_count;
+            }
+            std::string line;
+            if (delim) {
+                line.append(group_names[k]);
+                line.push_back('\t');
+            }
+            line.append(path_names[k]);
+            line.push_back('\t');
+            line.append(std::to_string(path_length));
+            line.push_back('\t');
+            line.append(std::to_string(path_step_count));
+            if (write_npy) {
+                std::string cells;
                 if (node_length_scale) {
+                    std::vector<uint64_t> scaled(row.size());
                     for (uint64_t i = 0; i < row.size(); ++i) {
-                        std::cout << "\t" << row[i] * graph.get_length(graph.get_handle(i+shift));
+                        scaled[i] = row[i] * node_lengths[i];
                     }
+                    cells.assign((const char*) scaled.data(), scaled.size() * sizeof(uint64_t));
                 } else {
-                    for (uint64_t i = 0; i < row.size(); ++i) {
-                        std::cout << "\t" << row[i];
-                    }
+                    cells.assign((const char*) row.data(), row.size() * sizeof(uint32_t));
                 }
-                std::cout << std::endl;
-            });
+                npy_writer->append(k, cells, true);
+            } else {
+                for (uint64_t i = 0; i < row.size(); ++i) {
+                    line.push_back('\t');
+                    line.append(std::to_string(node_length_scale ? row[i] * node_lengths[i] : row[i]));
+                }
+            }
+            line.push_back('\n');
+            writer.append(k, line, true);
+        }
+        writer.close_writer();
+        if (write_npy) {
+            npy_writer->close_writer();
+        }
     }
 
     if (!args::get(overlaps_file).empty()) {
@@ -407,17 +544,39 @@ int main_paths(int argc, char** argv) {
                 }
             }
         }
-        graph_t into;
-        algorithms::keep_paths(graph, into, to_keep);
-        // write the graph
-        if (dg_out_file) {
-            const std::string outfile = args::get(dg_out_file);
-            if (outfile == "-") {
-                into.serialize(std::cout);
-            } else {
-                ofstream f(outfile.c_str());
-                into.serialize(f);
-                f.close();
+        if (delta) {
+            graph.track_changes();
+            std::vector<path_handle_t> to_drop;
+            graph.for_each_path_handle([&](const path_handle_t& p) {
+                if (!to_keep.count(p)) {
+                    to_drop.push_back(p);
+                }
+            });
+            for (auto& p : to_drop) {
+                graph.destroy_path(p);
+            }
+            const int ret = utils::write_graph_delta(graph, args::get(dg_in_file), args::get(dg_out_file), "paths");
+            if (ret) {
+                return ret;
+            }
+        } else {
+            // the steps of the dropped paths go in place, without a second graph in memory
+            graph.set_number_of_threads(num_threads);
+            algorithms::keep_paths(graph, to_keep);
+            if (!graph.is_optimized()) {
+                // as written by a copy of the graph, with compacted ids
+                graph.optimize();
+            }
+            // write the graph
+            if (dg_out_file) {
+                const std::string outfile = args::get(dg_out_file);
+                if (outfile == "-") {
+                    graph.serialize(std::cout);
+                } else {
+                    ofstream f(outfile.c_str());
+                    graph.serialize(f);
+                    f.close();
+                }
             }
         }
     }
@@ -7,7 +7,13 @@
 #include "utils.hpp"
 #include "split.hpp"
 #include "subgraph/region.hpp"
-#include "IITree.h"
+#include "algorithms/coverage_matrix.hpp"
+#include "algorithms/ordered_chunk_writer.hpp"
+#include "algorithms/path_tasks.hpp"
+
+#ifdef USE_GPU
+#include "cuda/coverage.h"
+#endif
 
 namespace odgi {
 
@@ -41,6 +47,12 @@ int main_pav(int argc, char **argv) {
                                        {'B', "binary-values"});
     args::Flag _matrix_output(pav_opts, "bool", "Emit the PAV ratios in a matrix, with path ranges as rows and paths/groups as columns.",
                                            {'M', "matrix-output"});
+    args::ValueFlag<std::string> _coverage_matrix(pav_opts, "FILE", "Take the paths crossing each node from the coverage matrix in *FILE*, instead of"
+                                                  " looking up the steps on the node. If *FILE* does not exist or was built for another graph, it is built and written there.", {"coverage-matrix"});
+#ifdef USE_GPU
+    args::Group gpu_opts(parser, "[ GPU ]");
+    args::Flag gpu_compute(gpu_opts, "gpu", "Count the steps of the paths on the nodes with the GPU, into a coverage matrix that is kept in memory, or written to the *FILE* of --coverage-matrix if it has to be built.", {"gpu"});
+#endif
     args::Group threading_opts(parser, "[ Threading ]");
     args::ValueFlag<uint64_t> nthreads(threading_opts, "N", "Number of threads to use for parallel operations.",
                                        {'t', "threads"});
@@ -140,34 +152,14 @@ int main_pav(int argc, char **argv) {
                         << std::endl;
                 return 1;
             }
-        } else if (_group_by_sample) {
-            graph.for_each_path_handle([&](const path_handle_t& p) {
-                auto path_name = graph.get_path_name(p);
-                // split and decide
-                const auto vals = split(path_name, '#');
-                const auto group = vals.front();
-                path_2_group[p] = group;
-                group_2_index[group] = 0;
-            });
-        } else if (_group_by_haplotype) {
-            graph.for_each_path_handle([&](const path_handle_t& p) {
-                auto path_name = graph.get_path_name(p);
-                // split and decide
-                const auto vals = split(path_name, '#');
-                if (vals.size() == 1) { // Assume ctg
-                    const auto group = vals.front();
-                    path_2_group[p] = group;
-                    group_2_index[group] = 0;
-                } else if (vals.size() == 2) { // Assume sample#ctg
-                    const auto group = vals.front();
-                    path_2_group[p] = group;
-                    group_2_index[group] = 0;
-                } else if (vals.size() == 3) { // Assume sample#hap#ctg
-                    const auto group = vals[0] + '#' + vals[1];
-                    path_2_group[p] = group;
-                    group_2_index[group] = 0;
+        } else {
+            // group by sample or by sample#hap, taking ctg, sample#ctg and sample#hap#ctg names
+            for (auto& group : graph.pansn_path_groups(_group_by_sample ? 1 : 2)) {
+                for (auto& p : group.second) {
+                    path_2_group[p] = group.first;
                 }
-            });
+                group_2_index[group.first] = 0;
+            }
         }
 
         uint64_t group_index = 0;
@@ -179,7 +171,7 @@ int main_pav(int argc, char **argv) {
     // Read target paths from BED
     std::vector<odgi::path_range_t> path_ranges;
     if (_path_bed_file && !args::get(_path_bed_file).empty()) {
-        std::ifstream bed_in(args::get(_path_bed_file));
+        algorithms::readahead_ifstream_t bed_in(args::get(_path_bed_file));
         std::string line;
         while (std::getline(bed_in, line)) {
             add_bed_range(path_ranges, graph, line);
@@ -224,22 +216,29 @@ int main_pav(int argc, char **argv) {
         path_handle_2_index[p2mm.first] = i++;
     }
 
-    // Prepare the interval trees for querying target path ranges
+    // Index the nucleotide offsets of the steps of the target paths, between their min and max coordinates.
+    // The steps of a path tile it, so the steps of a range start with the one holding its begin,
+    // found by binary search, and follow it up to the end of the range.
     std::unique_ptr <odgi::algorithms::progress_meter::ProgressMeter> operation_progress;
     if (show_progress) {
-        std::string banner = "[odgi::pav] preparing the interval trees for querying target path ranges:";
+        std::string banner = "[odgi::pav] indexing the step offsets of the target paths:";
 		operation_progress = std::make_unique<odgi::algorithms::progress_meter::ProgressMeter>(path_handles.size(), banner);
     }
-    std::vector<IITree<uint64_t, uint64_t>> trees;
-    trees.resize(path_handles.size());
-#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
-    for (uint64_t i = 0; i < path_handles.size(); ++i) {
+    std::vector<std::vector<uint64_t>> step_offsets(path_handles.size());
+    std::vector<std::vector<nid_t>> step_node_ids(path_handles.size());
+    // the paths can be orders of magnitude apart in length, so the longest go first, and idle threads steal
+    std::vector<uint64_t> path_step_counts;
+    for (auto& path_handle : path_handles) {
+        path_step_counts.push_back(graph.get_step_count(path_handle));
+    }
+    algorithms::run_tasks(path_step_counts, num_threads, [&](const uint64_t& i, const uint64_t&) {
         const auto& path_handle = path_handles[i];
         const uint64_t min = path_name_2_min_max[path_handle].first;
         const uint64_t max = path_name_2_min_max[path_handle].second;
 
         const uint64_t index = path_handle_2_index[path_handle];
-        auto& tree = trees[index];
+        auto& offsets = step_offsets[index];
+        auto& node_ids = step_node_ids[index];
 
         uint64_t walked = 0;
         const auto path_end = graph.path_end(path_handle);
@@ -249,19 +248,31 @@ int main_pav(int argc, char **argv) {
             const uint64_t len_cur_handle = graph.get_length(cur_handle);
             walked += len_cur_handle;
             if (walked > min) {
-                tree.add(walked - len_cur_handle, walked, graph.get_id(cur_handle));
+                offsets.push_back(walked - len_cur_handle);
+                node_ids.push_back(graph.get_id(cur_handle));
             }
         }
 
-        tree.index(); // index
-
         if (show_progress) {
             operation_progress->increment(1);
         }
-    }
+    });
     if (show_progress) {
         operation_progress->finish();
     }
+    algorithms::coverage_matrix_t coverage;
+    algorithms::coverage_block_counter_t count_block;
+#ifdef USE_GPU
+    if (gpu_compute) {
+        count_block = cuda::node_path_coverage_counter(graph, num_threads);
+    }
+#endif
+    const bool use_coverage_matrix = _coverage_matrix || count_block;
+    if (use_coverage_matrix
+        && !coverage.load_or_build(args::get(_coverage_matrix), graph, num_threads, show_progress, "pav", count_block)) {
+        return 1;
+    }
+
     const bool emit_matrix_else_table = args::get(_matrix_output);
 
     // Emit the PAV matrix
@@ -285,7 +296,7 @@ int main_pav(int argc, char **argv) {
     std::cout << std::endl;
 
     auto print_pav_table_row = [](
-            const basic_ostream<char>& stream,
+            std::ostream& out,
             graph_t& graph,
             const uint64_t len_unique_nodes_in_range,
             const std::vector<uint64_t>& len_unique_nodes_in_range_for_each_group,
@@ -297,13 +308,13 @@ int main_pav(int argc, char **argv) {
         // Check if there were nodes in the range
         const double pav_ratio = len_unique_nodes_in_range == 0 ?
                                  0 : (double) len_unique_nodes_in_range_for_each_group[group_rank] / (double) len_unique_nodes_in_range;
-        std::cout << std::setprecision(5)
-                  << graph.get_path_name(path_range.begin.path) << "\t"
-                  << path_range.begin.offset << "\t"
-                  << path_range.end.offset << "\t"
-                  << path_range.name << "\t"
-                  << group_name << "\t"
-                  << (emit_binary_values ? pav_ratio >= binary_threshold : pav_ratio) << "\n";
+        out << std::setprecision(5)
+            << graph.get_path_name(path_range.begin.path) << "\t"
+            << path_range.begin.offset << "\t"
+            << path_range.end.offset << "\t"
+            << path_range.name << "\t"
+            << group_name << "\t"
+            << (emit_binary_values ? pav_ratio >= binary_threshold : pav_ratio) << "\n";
     };
 
     if (show_progress) {
@@ -311,6 +322,9 @@ int main_pav(int argc, char **argv) {
 		operation_progress = std::make_unique<odgi::algorithms::progress_meter::ProgressMeter>(path_ranges.size(), banner);
     }
 
+    // The ranges are computed in parallel, and their rows written in the order of the ranges
+    algorithms::ordered_chunk_writer writer(std::cout);
+    writer.open_writer();
 #pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
     for (uint64_t i = 0; i < path_ranges.size(); ++i) {
         auto &path_range = path_ranges[i];
@@ -318,63 +332,73 @@ int main_pav(int argc, char **argv) {
         const uint64_t end = path_range.end.offset;
 
         const uint64_t index = path_handle_2_index[path_range.begin.path];
-        auto& tree = trees[index];
-
-        std::vector<size_t> node_ids_info;
-        tree.overlap(begin, end, node_ids_info); // retrieve overlaps
+        const auto& offsets = step_offsets[index];
+        const auto& node_ids = step_node_ids[index];
 
         uint64_t len_unique_nodes_in_range = 0;
-        std::vector<uint64_t> len_unique_nodes_in_range_for_each_group(
-                group_paths ? group_2_index.size() : graph.get_path_count(),
-                0);
+        const uint64_t group_count = group_paths ? group_2_index.size() : graph.get_path_count();
+        std::vector<uint64_t> len_unique_nodes_in_range_for_each_group(group_count, 0);
+        // the last step in the range each group was counted on, so that it counts once per node
+        std::vector<uint64_t> last_step_of_group(group_count, std::numeric_limits<uint64_t>::max());
 
         // For each node in the range
-        for (const auto& node_id_info : node_ids_info) {
-            const auto& node_id = tree.data(node_id_info);
+        auto first = std::upper_bound(offsets.begin(), offsets.end(), begin);
+        if (first != offsets.begin()) {
+            --first;
+        }
+        for (uint64_t k = first - offsets.begin(); k < offsets.size() && offsets[k] < end; ++k) {
+            const auto& node_id = node_ids[k];
             const auto& handle = graph.get_handle(node_id);
+            const uint64_t len_handle = graph.get_length(handle);
 
             // Get paths that cross the node
-            unordered_set<uint64_t> group_ranks_on_node_handle;
-            graph.for_each_step_on_handle(handle, [&](const step_handle_t &source_step) {
-                const auto& path_handle = graph.get_path_handle_of_step(source_step);
+            auto add_path = [&](const path_handle_t& path_handle) {
                 // Check if the paths are grouped and there are paths that do not belong to any group
                 if (!group_paths || path_2_group.find(path_handle) != path_2_group.end()) {
                     const uint64_t group_rank = group_paths ?
                             group_2_index[path_2_group[path_handle]] :
                             as_integer(path_handle) - 1;
-                    group_ranks_on_node_handle.insert(group_rank);
+                    if (last_step_of_group[group_rank] != k) {
+                        last_step_of_group[group_rank] = k;
+                        len_unique_nodes_in_range_for_each_group[group_rank] += len_handle;
+                    }
                 }
-            });
-
-            const uint64_t len_handle = graph.get_length(handle);
-            for (const auto& group_rank: group_ranks_on_node_handle) {
-                len_unique_nodes_in_range_for_each_group[group_rank] += len_handle;
+            };
+            if (use_coverage_matrix) {
+                const uint64_t run = coverage.get_run_of_node(coverage.get_node_rank(node_id));
+                coverage.for_each_path_in_run(run, [&](const uint64_t& p, const uint64_t& c) {
+                    add_path(coverage.get_path_handle(p));
+                });
+            } else {
+                graph.visit_steps_on_handle(handle, [&](const step_handle_t &source_step, const path_handle_t &path) {
+                    add_path(path);
+                });
             }
 
             len_unique_nodes_in_range += len_handle;
         }
 
-#pragma omp critical (cout)
+        std::ostringstream out;
         {
             if (emit_matrix_else_table) {
-                std::cout << std::setprecision(5)
-                          << graph.get_path_name(path_range.begin.path) << "\t"
-                          << path_range.begin.offset << "\t"
-                          << path_range.end.offset << "\t"
-                          << path_range.name;
+                out << std::setprecision(5)
+                    << graph.get_path_name(path_range.begin.path) << "\t"
+                    << path_range.begin.offset << "\t"
+                    << path_range.end.offset << "\t"
+                    << path_range.name;
                 for (auto& x: len_unique_nodes_in_range_for_each_group) {
                     // Check if there were nodes in the range
                     const double pav_ratio = len_unique_nodes_in_range == 0 ?
                                              0 : (double) x / (double) len_unique_nodes_in_range;
-                    std::cout << "\t" << (emit_binary_values ? pav_ratio >= binary_threshold : pav_ratio);
+                    out << "\t" << (emit_binary_values ? pav_ratio >= binary_threshold : pav_ratio);
                 }
-                std::cout << std::endl;
+                out << "\n";
             } else {
                 if (group_paths) {
                     for (auto& x : group_2_index) {
                         const uint64_t group_rank = x.second;
                         print_pav_table_row(
-                                std::cout,
+                                out,
                                 graph,
                                 len_unique_nodes_in_range,
                                 len_unique_nodes_in_range_for_each_group,
@@ -388,7 +412,7 @@ int main_pav(int argc, char **argv) {
                     graph.for_each_path_handle([&](const path_handle_t path_handle) {
                         const uint64_t group_rank = as_integer(path_handle) - 1;
                         print_pav_table_row(
-                                std::cout,
+                                out,
                                 graph,
                                 len_unique_nodes_in_range,
                                 len_unique_nodes_in_range_for_each_group,
@@ -401,12 +425,14 @@ int main_pav(int argc, char **argv) {
                 }
             }
         }
-
+        std::string rows = out.str();
+        writer.append(i, rows, true);
 
         if (show_progress) {
             operation_progress->increment(1);
         }
     }
+    writer.close_writer();
     if (show_progress) {
         operation_progress->finish();
     }
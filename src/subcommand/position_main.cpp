@@ -6,6 +6,10 @@
 #include "subgraph/region.hpp"
 #include "algorithms/bfs.hpp"
 #include "algorithms/path_jaccard.hpp"
+#include "algorithms/stepindex.hpp"
+#include "algorithms/nearest_ref.hpp"
+#include "algorithms/node_rank.hpp"
+#include "algorithms/ordered_chunk_writer.hpp"
 #include <omp.h>
 #include "utils.hpp"
 #include "picosha2.h"
@@ -53,6 +57,9 @@ int main_position(int argc, char** argv) {
 	args::ValueFlag<uint64_t> _walking_dist(position_opts, "N", "Maximum walking distance in nucleotides for one orientation when finding the best target (reference) range for each query path (default: 10000). Note: If we walked 9999 base pairs and **w, --jaccard-context** is **10000**, we will also include the next node, even if we overflow the actual limit.",
 											{'w', "jaccard-context"});
     args::Flag all_positions_of_ref_path(position_opts, "all-positions", "Emit all positions for all nodes in the specified ref-paths.", {"all-positions"});
+    args::Group index_opts(parser, "[ Nearest Reference Index Options ]");
+    args::ValueFlag<std::string> write_nearest_index(index_opts, "FILE", "Search the nearest step of the reference paths, within *-d, --search-radius*, from both orientations of every node of the target graph, write the results to the index *FILE* and exit.", {"write-nearest-index"});
+    args::ValueFlag<std::string> nearest_index_file(index_opts, "FILE", "Look up the nearest reference step of the positions in the target graph in the index *FILE*, written via *--write-nearest-index* for the same graph and reference paths, instead of searching the graph for each position.", {"nearest-index"});
     args::Group threading_opts(parser, "[ Threading ]");
     args::ValueFlag<uint64_t> threads(threading_opts, "N", "Number of threads to use for parallel operations.", {'t', "threads"});
 	args::Group processing_info_opts(parser, "[ Processing Information ]");
@@ -160,6 +167,39 @@ int main_position(int argc, char** argv) {
         }
     }
 
+    uint64_t search_radius = _search_radius ? args::get(_search_radius) : 10000;
+    uint64_t walking_dist = _walking_dist ? args::get(_walking_dist) : 10000;
+
+    if (write_nearest_index) {
+        algorithms::nearest_ref_index_t nearest_index;
+        nearest_index.build(target_graph, ref_paths, search_radius, num_threads, args::get(progress));
+        std::ofstream out(args::get(write_nearest_index), std::ios::binary);
+        nearest_index.serialize(out);
+        if (!out) {
+            std::cerr << "[odgi::position] error: could not write the nearest reference index to " << args::get(write_nearest_index) << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    // the nearest reference steps of the nodes of the target graph, if we were given them
+    std::unique_ptr<algorithms::nearest_ref_index_t> nearest_index;
+    std::unique_ptr<algorithms::node_rank_t> target_node_rank;
+    if (nearest_index_file) {
+        nearest_index = std::make_unique<algorithms::nearest_ref_index_t>();
+        std::ifstream in(args::get(nearest_index_file), std::ios::binary);
+        if (!in || !nearest_index->load(in) || !nearest_index->is_index_of(target_graph, ref_paths)) {
+            std::cerr << "[odgi::position] error: " << args::get(nearest_index_file)
+                      << " is not a nearest reference index of the target graph and its reference paths" << std::endl;
+            return 1;
+        }
+        if (_search_radius && search_radius != nearest_index->get_search_radius()) {
+            std::cerr << "[odgi::position] error: the nearest reference index was built with a search radius of "
+                      << nearest_index->get_search_radius() << " bp, not " << search_radius << std::endl;
+            return 1;
+        }
+        target_node_rank = std::make_unique<algorithms::node_rank_t>(target_graph);
+    }
+
 	std::unordered_map<std::string, std::tuple<std::string, uint64_t, uint64_t>> path_start_end_pos_map;
 	std::string gff_in_file;
 	if (gff_input) {
@@ -416,7 +456,7 @@ int main_position(int argc, char** argv) {
 				add_graph_pos(target_graph, args::get(graph_pos));
 			}
 		} else if (graph_pos_file) {
-			std::ifstream gpos(args::get(graph_pos_file).c_str());
+			algorithms::readahead_ifstream_t gpos(args::get(graph_pos_file));
 			std::string buffer;
 			if (lifting) {
 				while (std::getline(gpos, buffer)) {
@@ -436,7 +476,7 @@ int main_position(int argc, char** argv) {
 			}
 		} else if (path_pos_file) {
 			// if we're given a file of path positions, we'll convert them all
-			std::ifstream refs(args::get(path_pos_file).c_str());
+			algorithms::readahead_ifstream_t refs(args::get(path_pos_file));
 			std::string buffer;
 			while (std::getline(refs, buffer)) {
 				if (lifting) {
@@ -446,7 +486,7 @@ int main_position(int argc, char** argv) {
 				}
 			}
 		} else if (bed_input) {
-			std::ifstream bed_in(args::get(bed_input).c_str());
+			algorithms::readahead_ifstream_t bed_in(args::get(bed_input));
 			std::string buffer;
 			while (std::getline(bed_in, buffer)) {
 				if (lifting) {
@@ -457,7 +497,7 @@ int main_position(int argc, char** argv) {
 			}
 		}
 	} else {
-		std::ifstream gff_in(gff_in_file.c_str());
+		algorithms::readahead_ifstream_t gff_in(gff_in_file);
 		std::string buffer;
 		while (std::getline(gff_in, buffer)) {
 			// we have to add to our own vector, because we are doing something different
@@ -465,9 +505,6 @@ int main_position(int argc, char** argv) {
 		}
 	}
 
-    uint64_t search_radius = _search_radius ? args::get(_search_radius) : 10000;
-    uint64_t walking_dist = _walking_dist ? args::get(_walking_dist) : 10000;
-
     // make an hash set of our ref path ids for quicker lookup
     hash_set<uint64_t> ref_path_set;
     for (auto& path : ref_paths) {
@@ -482,10 +519,84 @@ int main_position(int argc, char** argv) {
         lift_path_set_target.insert(as_integer(path));
     }
 
+    // The queries are translated in batch: instead of walking each queried path from its start for every
+    // query, the step offsets of the queried paths are indexed once, to find the step at a path position
+    // by binary search, and, when there are at least as many queries as paths to hit, the positions of
+    // the steps of those paths are indexed too, to find the offset of a hit step directly.
+    struct path_offsets_t {
+        std::vector<uint64_t> starts;
+        std::vector<step_handle_t> steps;
+        uint64_t length = 0;
+    };
+    auto index_path_offsets = [&num_threads](const odgi::graph_t& graph,
+                                             const std::vector<path_handle_t>& paths,
+                                             ska::flat_hash_map<path_handle_t, path_offsets_t>& offsets) {
+        std::vector<path_handle_t> todo;
+        for (auto& path : paths) {
+            if (!offsets.count(path)) {
+                offsets[path];
+                todo.push_back(path);
+            }
+        }
+#pragma omp parallel for schedule(dynamic,1) num_threads(num_threads)
+        for (uint64_t i = 0; i < todo.size(); ++i) {
+            path_offsets_t& path_offsets = offsets.find(todo[i])->second;
+            graph.for_each_step_in_path(todo[i], [&](const step_handle_t& s) {
+                path_offsets.starts.push_back(path_offsets.length);
+                path_offsets.steps.push_back(s);
+                path_offsets.length += graph.get_length(graph.get_handle_of_step(s));
+            });
+        }
+    };
+    ska::flat_hash_map<path_handle_t, path_offsets_t> target_path_offsets;
+    ska::flat_hash_map<path_handle_t, path_offsets_t> source_path_offsets;
+    {
+        std::vector<path_handle_t> source_paths;
+        std::vector<path_handle_t> target_paths;
+        auto& query_paths = lifting ? source_paths : target_paths;
+        for (auto& path_pos : path_positions) {
+            query_paths.push_back(path_pos.path);
+        }
+        for (auto& path_range : path_ranges) {
+            // the GFF ranges are always on the target graph
+            (gff_input ? target_paths : query_paths).push_back(path_range.begin.path);
+        }
+        if (lifting) {
+            // the lifted positions are found along the lift paths of the target
+            target_paths.insert(target_paths.end(), lift_paths_target.begin(), lift_paths_target.end());
+        }
+        index_path_offsets(source_graph, source_paths, source_path_offsets);
+        index_path_offsets(target_graph, target_paths, target_path_offsets);
+    }
+    const uint64_t query_count = graph_positions.size() + path_positions.size() + 2 * path_ranges.size();
+    std::unique_ptr<algorithms::step_index_t> target_step_index;
+    std::unique_ptr<algorithms::step_index_t> source_step_index;
+    if (!gff_input && !give_graph_pos && query_count >= ref_paths.size() && !ref_paths.empty()) {
+        target_step_index = std::make_unique<algorithms::step_index_t>(target_graph, ref_paths, num_threads, args::get(progress), 0);
+    }
+    if (lifting && query_count >= lift_paths_source.size()) {
+        source_step_index = std::make_unique<algorithms::step_index_t>(source_graph, lift_paths_source, num_threads, args::get(progress), 0);
+    }
+
     auto get_graph_pos =
-        [](const odgi::graph_t& graph,
+        [&](const odgi::graph_t& graph,
            const path_pos_t& pos,
            step_handle_t& step) {
+            const auto& offsets = &graph == &source_graph ? source_path_offsets : target_path_offsets;
+            auto f = offsets.find(pos.path);
+            if (f != offsets.end()) {
+                const path_offsets_t& path_offsets = f->second;
+                if (pos.offset < path_offsets.length) {
+                    const uint64_t i = std::upper_bound(path_offsets.starts.begin(), path_offsets.starts.end(), pos.offset)
+                                       - path_offsets.starts.begin() - 1;
+                    step = path_offsets.steps[i];
+                    handle_t h = graph.get_handle_of_step(step);
+                    return make_pos_t(graph.get_id(h), graph.get_is_reverse(h), pos.offset - path_offsets.starts[i]);
+                }
+#pragma omp critical (cout)
+                std::cerr << "[odgi::position] warning: position " << graph.get_path_name(pos.path) << ":" << pos.offset << " outside of path. Walked " << path_offsets.length << std::endl;
+                return make_pos_t(0, false, 0);
+            }
             auto path_end = graph.path_end(pos.path);
             uint64_t walked = 0;
             for (step_handle_t s = graph.path_begin(pos.path);
@@ -504,15 +615,19 @@ int main_position(int argc, char** argv) {
         };
 
 	auto get_graph_node_ids_annotation =
-			[](const odgi::graph_t& graph,
+			[&](const odgi::graph_t& graph,
 			   const path_range_t& path_range) {
-				auto path_end = graph.path_end(path_range.begin.path);
 				std::unordered_map<uint64_t , std::set<std::string>> node_annotation_map;
-				uint64_t walked = 0;
 				uint64_t path_pos_start = path_range.begin.offset;
 				uint64_t path_pos_end = path_range.end.offset;
-				for (step_handle_t s = graph.path_begin(path_range.begin.path);
-					 s != path_end; s = graph.get_next_step(s)) {
+				// start at the step holding the range start
+				const path_offsets_t& path_offsets = target_path_offsets.find(path_range.begin.path)->second;
+				uint64_t first = std::upper_bound(path_offsets.starts.begin(), path_offsets.starts.end(), path_pos_start)
+								 - path_offsets.starts.begin();
+				first = first ? first - 1 : 0;
+				for (uint64_t i = first; i < path_offsets.steps.size(); ++i) {
+					const step_handle_t& s = path_offsets.steps[i];
+					uint64_t walked = path_offsets.starts[i];
 					handle_t h = graph.get_handle_of_step(s);
 					uint64_t nid = graph.get_id(h);
 					uint64_t node_length = graph.get_length(h);
@@ -535,14 +650,17 @@ int main_position(int argc, char** argv) {
 						// we can return here, nothing more to do
 						return node_annotation_map;
 					}
-					walked += node_length;
 				}
 				return node_annotation_map;
 			};
 
     auto get_offset_in_path =
-        [](const odgi::graph_t& graph,
+        [&](const odgi::graph_t& graph,
            const path_handle_t& path, const step_handle_t& target) {
+            const auto& step_index = &graph == &source_graph ? source_step_index : target_step_index;
+            if (step_index) {
+                return (uint64_t) step_index->get_position(target, graph);
+            }
             auto path_end = graph.path_end(path);
             uint64_t walked = 0;
             step_handle_t s = graph.path_begin(path);
@@ -634,7 +752,8 @@ int main_position(int argc, char** argv) {
         };
 
     auto get_position =
-        [&search_radius,&get_offset_in_path,&walking_dist,&set_adj_last_node](const odgi::graph_t& graph,
+        [&search_radius,&get_offset_in_path,&walking_dist,&set_adj_last_node,
+         &nearest_index,&target_node_rank,&target_graph,&ref_path_set](const odgi::graph_t& graph,
                                              const hash_set<uint64_t>& path_set,
                                              const pos_t& pos, lift_result_t& lift,
                                              const step_handle_t target_step_handle,
@@ -646,51 +765,24 @@ int main_position(int argc, char** argv) {
             bool& rev_vs_ref = lift.is_rev_vs_ref;
             bool& used_bidirectional = lift.used_bidirectional;
             handle_t start_handle = graph.get_handle(id(pos), is_rev(pos));
-            bool found_hit = false;
             uint64_t adj_last_node = 0;
-            hash_set<uint64_t> seen;
-            uint64_t d_bfs;
-            handle_t h_bfs;
-            for (auto try_bidirectional : { false, true }) {
-                if (try_bidirectional) {
-					used_bidirectional = true;
-					seen.erase(as_integer(graph.flip(start_handle)));
-                }
-                odgi::algorithms::bfs(
+            // the search is the same with or without the index, which holds its result for each node side
+            const bool use_index = nearest_index && &graph == &target_graph && &path_set == &ref_path_set;
+            uint64_t indexed_offset = 0;
+            const algorithms::nearest_ref_t nearest = use_index
+                ? nearest_index->get_nearest((*target_node_rank)(start_handle), is_rev(pos), indexed_offset)
+                : algorithms::find_nearest_ref(
                     graph,
-                    [&](const handle_t& h, const uint64_t& r, const uint64_t& l, const uint64_t& d) {
-                        seen.insert(as_integer(h));
-                        bool got_hit = false;
-                        step_handle_t hit;
-                        graph.for_each_step_on_handle(
-                            h, [&](const step_handle_t& s) {
-                                   auto p = graph.get_path_handle_of_step(s);
-                                   if (!got_hit && path_set.count(as_integer(p))) {
-                                       //std::cerr << "thought I got a hit" << std::endl;
-                                       got_hit = true;
-                                       hit = s;
-                                       walked_to_hit_ref += l; // how far we came to get to this node
-									   d_bfs = d; // we need this for the path jaccard calculations
-									   h_bfs = h;
-									   set_adj_last_node(graph, s, h, used_bidirectional, d, pos, rev_vs_ref, adj_last_node);
-                                   }
-                               });
-                        if (got_hit) {
-                            ref_hit = hit;
-                            found_hit = true;
-                        }
-                    },
-                    [&seen](const handle_t& h) { return seen.count(as_integer(h)); },
-                    [](const handle_t& l, const handle_t& h) { return false; },
-                    [&found_hit](void) { return found_hit; },
-                    { graph.flip(start_handle) },
-                    { },
-                    used_bidirectional,
-                    0,
+                    [&path_set](const path_handle_t& p) { return path_set.count(as_integer(p)) > 0; },
+                    start_handle,
                     search_radius);
-                if (found_hit) break; // if we got a hit, don't go bidirectional
-            }
-            if (found_hit) {
+            used_bidirectional = nearest.used_bidirectional;
+            const uint64_t d_bfs = nearest.depth;
+            const handle_t h_bfs = nearest.handle;
+            if (nearest.found) {
+                ref_hit = nearest.step;
+                walked_to_hit_ref += nearest.walked;
+                set_adj_last_node(graph, ref_hit, h_bfs, used_bidirectional, d_bfs, pos, rev_vs_ref, adj_last_node);
             	if (path_jaccard) {
 					std::vector<step_handle_t> query_step_handles;
 					path_handle_t ref_hit_path = graph.get_path_handle_of_step(ref_hit);
@@ -714,7 +806,8 @@ int main_position(int argc, char** argv) {
 
 				path_handle_t p = graph.get_path_handle_of_step(ref_hit);
 				// TODO ORIENTATION
-				path_offset = get_offset_in_path(graph, p, ref_hit) + adj_last_node;
+				path_offset = (use_index && ref_hit == nearest.step ? indexed_offset : get_offset_in_path(graph, p, ref_hit))
+							  + adj_last_node;
                 return true;
             } else {
                 path_offset = -1;
@@ -741,8 +834,13 @@ int main_position(int argc, char** argv) {
         }
     }
     // for each position that we want to look up
+    // print in the order of the input, though the queries run in parallel
+    algorithms::ordered_chunk_writer graph_pos_writer(std::cout);
+    graph_pos_writer.open_writer();
 #pragma omp parallel for schedule(dynamic,1)
-    for (auto& _pos : graph_positions) {
+    for (uint64_t i = 0; i < graph_positions.size(); ++i) {
+        auto& _pos = graph_positions[i];
+        std::stringstream out;
         // go to the graph
         // do a little BFS, bounded by our limit
         // now, if we found our hit, print
@@ -773,24 +871,22 @@ int main_position(int argc, char** argv) {
         std::vector<lift_result_t> result_v;
         if (id(pos) && give_graph_pos) {
             // force graph position in target
-#pragma omp critical (cout)
             {
                 if (lifting) {
-                    std::cout << id(_pos) << "," << offset(_pos) << "," << (is_rev(_pos) ? "-" : "+") << "\t";
+                    out << id(_pos) << "," << offset(_pos) << "," << (is_rev(_pos) ? "-" : "+") << "\t";
                 }
-                std::cout << id(pos) << "," << offset(pos) << "," << (is_rev(pos) ? "-" : "+") << "\t"
+                out << id(pos) << "," << offset(pos) << "," << (is_rev(pos) ? "-" : "+") << "\t"
                           << "\t" << id(pos) << "," << offset(pos) << "," << (is_rev(pos) ? "-" : "+") << std::endl;
             }
         } else if (args::get(all_immediate) && get_immediate(target_graph, ref_path_set, pos, result_v)) {
             bool ref_is_rev = false;
             for (auto& result : result_v) {
                 path_handle_t p = target_graph.get_path_handle_of_step(result.ref_hit);
-#pragma omp critical (cout)
                 {
                     if (lifting) {
-                        std::cout << id(_pos) << "," << offset(_pos) << "," << (is_rev(_pos) ? "-" : "+") << "\t";
+                        out << id(_pos) << "," << offset(_pos) << "," << (is_rev(_pos) ? "-" : "+") << "\t";
                     }
-                    std::cout << id(pos) << "," << offset(pos) << "," << (is_rev(pos) ? "-" : "+") << "\t"
+                    out << id(pos) << "," << offset(pos) << "," << (is_rev(pos) ? "-" : "+") << "\t"
                               << target_graph.get_path_name(p) << "," << result.path_offset << "," << (ref_is_rev ? "-" : "+") << "\t"
                               << result.walked_to_hit_ref << "\t" << (result.is_rev_vs_ref ? "-" : "+") << std::endl;
                 }
@@ -798,20 +894,26 @@ int main_position(int argc, char** argv) {
         } else if (get_position(target_graph, ref_path_set, pos, result, step_handle_graph_pos, false)) {
             bool ref_is_rev = false;
             path_handle_t p = target_graph.get_path_handle_of_step(result.ref_hit);
-#pragma omp critical (cout)
             {
                 if (lifting) {
-                    std::cout << id(_pos) << "," << offset(_pos) << "," << (is_rev(_pos) ? "-" : "+") << "\t";
+                    out << id(_pos) << "," << offset(_pos) << "," << (is_rev(_pos) ? "-" : "+") << "\t";
                 }
-                std::cout << id(pos) << "," << offset(pos) << "," << (is_rev(pos) ? "-" : "+") << "\t"
+                out << id(pos) << "," << offset(pos) << "," << (is_rev(pos) ? "-" : "+") << "\t"
                           << target_graph.get_path_name(p) << "," << result.path_offset << "," << (ref_is_rev ? "-" : "+") << "\t"
                           << result.walked_to_hit_ref << "\t" << (result.is_rev_vs_ref ? "-" : "+") << std::endl;
             }
         }
+        std::string text = out.str();
+        graph_pos_writer.append(i, text, true);
     }
+    graph_pos_writer.close_writer();
 
+    algorithms::ordered_chunk_writer path_pos_writer(std::cout);
+    path_pos_writer.open_writer();
 #pragma omp parallel for schedule(dynamic,1)
-    for (auto& path_pos : path_positions) {
+    for (uint64_t i = 0; i < path_positions.size(); ++i) {
+        auto& path_pos = path_positions[i];
+        std::stringstream out;
         // TODO we need a better input format
         pos_t pos;
 		step_handle_t step_handle_graph_pos;
@@ -840,28 +942,33 @@ int main_position(int argc, char** argv) {
         //std::cerr << "Got graph pos " << id(pos) << std::endl;
         if (id(pos)) {
             if (give_graph_pos) {
-#pragma omp critical (cout)
-                std::cout << "#source.path.pos\ttarget.graph.pos" << std::endl
+                out << "#source.path.pos\ttarget.graph.pos" << std::endl
                           << (lifting ? source_graph.get_path_name(path_pos.path) : target_graph.get_path_name(path_pos.path))
                           << "," << path_pos.offset << "," << (path_pos.is_rev ? "-" : "+")
                           << "\t" << id(pos) << "," << offset(pos) << "," << (is_rev(pos) ? "-" : "+") << std::endl;
             } else if (get_position(target_graph, ref_path_set, pos, result, step_handle_graph_pos, true)) {
                 bool ref_is_rev = false;
                 path_handle_t p = target_graph.get_path_handle_of_step(result.ref_hit);
-#pragma omp critical (cout)
-                std::cout << "#source.path.pos\ttarget.path.pos\tdist.to.ref\tstrand.vs.ref" << std::endl
+                out << "#source.path.pos\ttarget.path.pos\tdist.to.ref\tstrand.vs.ref" << std::endl
                           << (lifting ? source_graph.get_path_name(path_pos.path) : target_graph.get_path_name(path_pos.path)) << ","
                           << path_pos.offset << "," << (path_pos.is_rev ? "-" : "+") << "\t"
                           << target_graph.get_path_name(p) << "," << result.path_offset << "," << (ref_is_rev ? "-" : "+") << "\t"
                           << result.walked_to_hit_ref << "\t" << (result.is_rev_vs_ref ? "-" : "+") << std::endl;
             }
         }
+        std::string text = out.str();
+        path_pos_writer.append(i, text, true);
     }
+    path_pos_writer.close_writer();
 
 	std::vector<std::unordered_map<uint64_t , std::set<std::string>>> node_annotation_maps;
 
+    algorithms::ordered_chunk_writer path_range_writer(std::cout);
+    path_range_writer.open_writer();
 #pragma omp parallel for schedule(dynamic,1)
-    for (auto& path_range : path_ranges) {
+    for (uint64_t i = 0; i < path_ranges.size(); ++i) {
+        auto& path_range = path_ranges[i];
+        std::stringstream out;
 		pos_t pos_begin, pos_end;
         // handle the lift into the target graph
 		step_handle_t step_handle_graph_pos_begin;
@@ -909,8 +1016,7 @@ int main_position(int argc, char** argv) {
             // TODO add a GAF-style path to the record to say where the BED range walks in the graph
             // TODO optionally list out the nodes in this particular range (e.g. those within it in our sort order)
             if (give_graph_pos) {
-#pragma omp critical (cout)
-                std::cout << path_range.data << "\t"
+                out << path_range.data << "\t"
                           << id(pos_begin) << "," << offset(pos_begin) << "," << (is_rev(pos_begin)?"-":"+") << "\t"
                           << id(pos_end) << "," << offset(pos_end) << "," << (is_rev(pos_end)?"-":"+") << std::endl;
             } else if (get_position(target_graph, ref_path_set, pos_begin, lift_begin, step_handle_graph_pos_begin, true)
@@ -919,8 +1025,7 @@ int main_position(int argc, char** argv) {
                 path_handle_t p_begin = target_graph.get_path_handle_of_step(lift_begin.ref_hit);
                 path_handle_t p_end = target_graph.get_path_handle_of_step(lift_end.ref_hit);
                 // XXX TODO assert these to be equal......
-#pragma omp critical (cout)
-                std::cout << path_range.data << "\t"
+                out << path_range.data << "\t"
                           << target_graph.get_path_name(p_begin) << ","
                           << lift_begin.path_offset << ","
                           << (lift_begin.is_rev_vs_ref ? "-" : "+") << "\t"
@@ -931,7 +1036,10 @@ int main_position(int argc, char** argv) {
                     //<< walked_to_hit_ref << "\t" << (is_rev_vs_ref ? "-" : "+") << std::endl;
             }
         }
+        std::string text = out.str();
+        path_range_writer.append(i, text, true);
     }
+    path_range_writer.close_writer();
 	if (gff_input) {
 		//  clean up duplicates
 		std::map<uint64_t , std::set<std::string>> final_node_annotation_map;
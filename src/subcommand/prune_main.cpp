@@ -33,6 +33,9 @@ int main_prune(int argc, char** argv) {
     args::ValueFlag<uint64_t> max_furcations(kmer_opts, "N", "Break at edges that would induce *N* many furcations in a kmer.", {'e', "max-furcations"});
     args::Group node_options(parser, "[ Node Options ]");
     args::ValueFlag<uint64_t> max_degree(node_options, "N", "Remove nodes that have a higher node degree than *N*.", {'d', "max-degree"});
+    args::ValueFlag<std::string> degree_histogram(node_options, "FILE", "Write the node degree histogram of the input graph to *FILE* as"
+                                                                        " tab-separated *degree* and *nodes* columns, to help choosing *-d, --max-degree*."
+                                                                        " Without *-o, --out* only the histogram is written.", {'H', "degree-histogram"});
     args::ValueFlag<uint64_t> min_depth(node_options, "N", "Remove nodes covered by fewer than *N* number of path steps.", {'c', "min-depth"});
     args::ValueFlag<uint64_t> max_depth(node_options, "N", "Remove nodes covered by more than *N* number of path steps.", {'C', "max-depth"});
     args::Flag cut_tips(node_options, "bool", "Remove nodes which are graph tips.", {'T', "cut-tips"});
@@ -41,6 +44,7 @@ int main_prune(int argc, char** argv) {
                                              " nodes. Only set this argument in combination with **-c,"
                                              " –min-coverage**=*N* and **-C, --max-coverage**=*N*.", {'E', "edge-depth"});
     args::ValueFlag<uint64_t> best_edges(edge_opts, "N", "Only keep the *N* most covered inbound and output edges of each node.", {'b', "best-edges"});
+    args::ValueFlag<std::string> edge_depth_index_file(edge_opts, "FILE", "Read the path depth of the edges for *-E, --edge-depth* and *-b, --best-edges* from the edge depth index in *FILE*, written via *odgi depth --write-edge-depth-index*, instead of walking the paths. Not applicable with *-d, --max-degree* and *-e, --max-furcations*, which change the graph first.", {"edge-depth-index"});
     args::Group step_opts(parser, "[ Step Options ]");
     args::ValueFlag<uint64_t> expand_steps(step_opts, "N", "Also include nodes within this many steps of a component passing the prune thresholds.", {'s', "expand-steps"});
     args::ValueFlag<uint64_t> expand_length(step_opts, "N", "Also include nodes within this graph nucleotide distance of a component passing the prune thresholds.", {'l', "expand-length"});
@@ -83,13 +87,19 @@ int main_prune(int argc, char** argv) {
         return 1;
     }
 
-    if (!dg_out_file) {
+    if (!dg_out_file && !degree_histogram) {
         std::cerr
                 << "[odgi::prune] error: please specify an output file to where to store the pruned graph via -o=[FILE], --out=[FILE]."
                 << std::endl;
         return 1;
     }
 
+    if (edge_depth_index_file && (args::get(max_degree) || args::get(max_furcations))) {
+        std::cerr << "[odgi::prune] error: an edge depth index given via --edge-depth-index can not be used with -d, --max-degree or -e, --max-furcations, "
+                     "as they change the edges before they are pruned by depth." << std::endl;
+        return 1;
+    }
+
 	const int n_threads = threads ? args::get(threads) : 1;
 
 	graph_t graph;
@@ -105,17 +115,33 @@ int main_prune(int argc, char** argv) {
     }
 
     omp_set_num_threads(n_threads);
+    graph.set_number_of_threads(n_threads);
 
+    if (degree_histogram) {
+        const std::vector<uint64_t> histogram
+            = algorithms::degree_histogram(algorithms::node_degrees(graph, n_threads), graph);
+        std::ofstream f(args::get(degree_histogram).c_str());
+        f << "degree\tnodes" << std::endl;
+        for (uint64_t d = 0; d < histogram.size(); ++d) {
+            if (histogram[d]) {
+                f << d << "\t" << histogram[d] << std::endl;
+            }
+        }
+        if (!dg_out_file) {
+            return 0;
+        }
+    }
     if (args::get(max_degree)) {
         graph.clear_paths();
-        algorithms::remove_high_degree_nodes(graph, args::get(max_degree));
+        const uint64_t removed = algorithms::remove_high_degree_nodes(graph, args::get(max_degree), n_threads);
+        if (args::get(progress)) {
+            std::cerr << "[odgi::prune] removed " << removed << " nodes of degree above " << args::get(max_degree) << std::endl;
+        }
     }
     if (args::get(max_furcations)) {
         std::vector<edge_t> to_prune = algorithms::find_edges_to_prune(graph, args::get(kmer_length), args::get(max_furcations), n_threads);
         //std::cerr << "edges to prune: " << to_prune.size() << std::endl;
-        for (auto& edge : to_prune) {
-            graph.destroy_edge(edge);
-        }
+        graph.destroy_edges(to_prune);
         // we're just removing edges, so paths shouldn't be damaged
         //std::cerr << "done prune" << std::endl;
     }
@@ -124,13 +150,26 @@ int main_prune(int argc, char** argv) {
         std::vector<edge_t> edges_to_drop_depth;
         std::vector<edge_t> edges_to_drop_best;
 
+        // the path depth of the edges, counted once for both edge filters or read from a file
+        algorithms::edge_depth_index_t edge_depths;
+        if (args::get(edge_depth) || args::get(best_edges)) {
+            if (edge_depth_index_file) {
+                std::ifstream in(args::get(edge_depth_index_file), std::ios::binary);
+                if (!in || !edge_depths.load(in) || !edge_depths.is_index_of(graph)) {
+                    std::cerr << "[odgi::prune] error: \"" << args::get(edge_depth_index_file) << "\" does not hold an edge depth index of the graph written via odgi depth --write-edge-depth-index." << std::endl;
+                    return 1;
+                }
+            } else {
+                edge_depths = algorithms::edge_depth_index_t(graph, n_threads);
+            }
+        }
         if (args::get(edge_depth)) {
-            edges_to_drop_depth = algorithms::find_edges_exceeding_depth_limits(graph, args::get(min_depth), args::get(max_depth));
+            edges_to_drop_depth = algorithms::find_edges_exceeding_depth_limits(edge_depths, args::get(min_depth), args::get(max_depth), n_threads);
         } else {
             handles_to_drop = algorithms::find_handles_exceeding_depth_limits(graph, args::get(min_depth), args::get(max_depth));
         }
         if (args::get(best_edges)) {
-            edges_to_drop_best = algorithms::keep_mutual_best_edges(graph, args::get(best_edges));
+            edges_to_drop_best = algorithms::keep_mutual_best_edges(graph, edge_depths, args::get(best_edges), n_threads);
         }
         // TODO this needs fixing
         // we should split up the paths rather than drop them
@@ -144,15 +183,9 @@ int main_prune(int argc, char** argv) {
                     graph.clear_paths();
                 }
                 //std::cerr << "got " << to_drop.size() << " handles to drop" << std::endl;
-                for (auto& edge : edges_to_drop_depth) {
-                    graph.destroy_edge(edge);
-                }
-                for (auto& edge : edges_to_drop_best) {
-                    graph.destroy_edge(edge);
-                }
-                for (auto& handle : handles_to_drop) {
-                    graph.destroy_handle(handle);
-                }
+                graph.destroy_edges(edges_to_drop_depth);
+                graph.destroy_edges(edges_to_drop_best);
+                graph.destroy_handles(handles_to_drop);
             };
         if (args::get(expand_steps)) {
             graph_t source;
@@ -231,9 +264,10 @@ int main_prune(int argc, char** argv) {
         std::cerr << "[odgi::prune] found " << paths_to_remove.size() << "/" << num_of_paths_in_file
                   << " paths to remove." << std::endl;
 
-        for(auto& path : paths_to_remove) {
-            graph.destroy_path(path);
-        }
+        // the steps of the paths go in one pass over the nodes
+        graph.keep_paths([&](const path_handle_t& path) {
+            return !path_already_seen[as_integer(path) - 1];
+        });
     }
 
     {
@@ -1,8 +1,31 @@
 #include "subcommand.hpp"
 #include "args.hxx"
 #include "algorithms/xp.hpp"
+#include "algorithms/subgraph/extract.hpp"
+#include "algorithms/depth_index.hpp"
+#include "subgraph.hpp"
+#include "utils.hpp"
 #include <httplib.h>
 #include <filesystem>
+#include <charconv>
+#include <string_view>
+#include <sstream>
+#include <fstream>
+#include <map>
+#include <unordered_set>
+#include <unordered_map>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <limits>
+#include <cstring>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
 
 namespace odgi {
 
@@ -10,6 +33,427 @@ namespace odgi {
     using namespace xp;
     using namespace httplib;
 
+    namespace {
+
+    /// A cache of whole responses, bounded by their bytes, which drops the least recently used first
+    class response_cache_t {
+    public:
+        explicit response_cache_t(const uint64_t& max_bytes) : max_bytes(max_bytes) {}
+
+        /// Set the content and its type if the key is cached, making it the most recently used
+        bool get(const std::string& key, std::string& content, std::string& content_type) {
+            std::lock_guard<std::mutex> guard(mutex);
+            auto f = index.find(key);
+            if (f == index.end()) {
+                ++misses;
+                return false;
+            }
+            entries.splice(entries.begin(), entries, f->second);
+            content = f->second->content;
+            content_type = f->second->content_type;
+            ++hits;
+            return true;
+        }
+
+        void put(const std::string& key, const std::string& content, const std::string& content_type) {
+            const uint64_t size = entry_bytes(key, content, content_type);
+            if (size > max_bytes) {
+                return;
+            }
+            std::lock_guard<std::mutex> guard(mutex);
+            if (index.count(key)) {
+                return;
+            }
+            entries.push_front({key, content, content_type});
+            index[key] = entries.begin();
+            bytes += size;
+            while (bytes > max_bytes) {
+                auto& last = entries.back();
+                bytes -= entry_bytes(last.key, last.content, last.content_type);
+                index.erase(last.key);
+                entries.pop_back();
+                ++evictions;
+            }
+        }
+
+        std::string stats_json(void) {
+            std::lock_guard<std::mutex> guard(mutex);
+            return "{\"hits\":" + std::to_string(hits)
+                + ",\"misses\":" + std::to_string(misses)
+                + ",\"evictions\":" + std::to_string(evictions)
+                + ",\"entries\":" + std::to_string(entries.size())
+                + ",\"bytes\":" + std::to_string(bytes)
+                + ",\"max_bytes\":" + std::to_string(max_bytes) + "}";
+        }
+
+    private:
+        struct entry_t {
+            std::string key;
+            std::string content;
+            std::string content_type;
+        };
+        /// the payload and a rough allowance for the list node and the index entry
+        static uint64_t entry_bytes(const std::string& key, const std::string& content, const std::string& content_type) {
+            return 2 * key.size() + content.size() + content_type.size() + 128;
+        }
+        const uint64_t max_bytes;
+        std::mutex mutex;
+        std::list<entry_t> entries;
+        std::unordered_map<std::string, std::list<entry_t>::iterator> index;
+        uint64_t bytes = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+    };
+
+    /// The frames of the binary protocol: a type byte, the payload length as a little-endian uint32
+    /// and the payload. A client may send any number of frames before reading the answers, which
+    /// come back one per frame and in order.
+    enum binary_frame_t : uint8_t {
+        /// path name -> its uint32 id, 0 if it is not in the index
+        binary_path_id = 1,
+        /// pairs of uint32 path id and uint64 1-based position -> one uint64 pangenome position per pair
+        binary_translate = 2,
+        /// a message, after which the server closes the connection
+        binary_error = 255
+    };
+    const uint64_t binary_max_payload = 64 << 20;
+    const uint64_t binary_flush_bytes = 1 << 16;
+
+    uint64_t read_le(const char* data, const uint64_t& bytes) {
+        uint64_t v = 0;
+        for (uint64_t b = 0; b < bytes; ++b) {
+            v |= (uint64_t)(uint8_t)data[b] << (8 * b);
+        }
+        return v;
+    }
+
+    void append_le(std::string& out, const uint64_t& v, const uint64_t& bytes) {
+        for (uint64_t b = 0; b < bytes; ++b) {
+            out.push_back((char)((v >> (8 * b)) & 0xff));
+        }
+    }
+
+    bool send_all(const int& fd, const std::string& data) {
+        uint64_t sent = 0;
+        while (sent < data.size()) {
+            const ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) return false;
+            sent += n;
+        }
+        return true;
+    }
+
+    /// Answer the frames of one connection until the client closes it. The answers are sent once
+    /// enough of them are pending or the frames received so far are all answered, so that a client
+    /// streaming its queries gets its answers in large writes.
+    void serve_binary_connection(const int fd,
+                                 const std::function<uint64_t(const std::string&)>& path_id,
+                                 const std::function<uint64_t(const uint64_t&, const uint64_t&)>& translate) {
+        std::string in;
+        uint64_t parsed = 0;
+        std::string out;
+        std::string name;
+        std::vector<char> buffer(1 << 16);
+        while (true) {
+            const ssize_t n = recv(fd, buffer.data(), buffer.size(), 0);
+            if (n <= 0) break;
+            in.append(buffer.data(), n);
+            bool failed = false;
+            while (in.size() - parsed >= 5) {
+                const uint8_t type = in[parsed];
+                const uint64_t length = read_le(in.data() + parsed + 1, 4);
+                const std::string error =
+                    length > binary_max_payload ? "frame too large"
+                    : type == binary_translate && length % 12 ? "translate payload is not a multiple of 12 bytes"
+                    : type != binary_path_id && type != binary_translate ? "unknown frame type " + std::to_string(type)
+                    : "";
+                if (!error.empty()) {
+                    out.push_back((char)binary_error);
+                    append_le(out, error.size(), 4);
+                    out += error;
+                    failed = true;
+                    break;
+                }
+                if (in.size() - parsed - 5 < length) break;
+                const char* payload = in.data() + parsed + 5;
+                if (type == binary_path_id) {
+                    name.assign(payload, length);
+                    out.push_back((char)binary_path_id);
+                    append_le(out, 4, 4);
+                    append_le(out, path_id(name), 4);
+                } else {
+                    const uint64_t count = length / 12;
+                    out.push_back((char)binary_translate);
+                    append_le(out, count * 8, 4);
+                    for (uint64_t i = 0; i < count; ++i) {
+                        append_le(out, translate(read_le(payload + 12 * i, 4), read_le(payload + 12 * i + 4, 8)), 8);
+                    }
+                }
+                parsed += 5 + length;
+                if (out.size() >= binary_flush_bytes) {
+                    if (!send_all(fd, out)) {
+                        failed = true;
+                        break;
+                    }
+                    out.clear();
+                }
+            }
+            // keep only the start of the frame still being received
+            in.erase(0, parsed);
+            parsed = 0;
+            if ((!out.empty() && !send_all(fd, out)) || failed) break;
+            out.clear();
+        }
+        close(fd);
+    }
+
+    /// Tells the loaded files apart by their name, size and modification time, so that answers cached
+    /// for one set of inputs are never served for another
+    std::string input_fingerprint(const std::vector<std::string>& files) {
+        uint64_t h = 1469598103934665603ULL;
+        auto mix = [&](const std::string& s) {
+            for (const char c : s) {
+                h = (h ^ (uint8_t)c) * 1099511628211ULL;
+            }
+        };
+        for (auto& file : files) {
+            std::error_code error;
+            mix(file);
+            mix(std::to_string(std::filesystem::file_size(file, error)));
+            mix(std::to_string(std::filesystem::last_write_time(file, error).time_since_epoch().count()));
+        }
+        std::ostringstream out;
+        out << std::hex << h;
+        return out.str();
+    }
+
+    /// Parse a 1-based nucleotide position
+    bool parse_position(std::string_view s, uint64_t& pos) {
+        auto result = std::from_chars(s.data(), s.data() + s.size(), pos);
+        return result.ec == std::errc() && result.ptr == s.data() + s.size() && pos > 0;
+    }
+
+    /// The inputs that queries are answered from, each of them optional
+    struct served_inputs_t {
+        bool has_index = false;
+        bool has_graph = false;
+        bool has_depth_index = false;
+        XP path_index;
+        /// the path names resolved once rather than in the name index of the XP on every query
+        std::unordered_map<std::string, path_handle_t> xp_paths;
+        graph_t graph;
+        algorithms::depth_index_t depth_index;
+        /// the size of the loaded files, as an estimate of the memory they take
+        uint64_t bytes = 0;
+
+        /// The 1-based pangenome position, or 0 if the path or position is not in the index
+        uint64_t pangenome_position(const std::string& path_name, const uint64_t& nuc_pos_1) const {
+            auto f = xp_paths.find(path_name);
+            return f == xp_paths.end() ? 0 : pangenome_position(as_integer(f->second), nuc_pos_1);
+        }
+
+        /// The same for the path of the given id in the index
+        uint64_t pangenome_position(const uint64_t& id, const uint64_t& nuc_pos_1) const {
+            if (id == 0 || id > path_index.path_count || nuc_pos_1 == 0
+                || nuc_pos_1 - 1 >= path_index.get_path_length(as_path_handle(id))) {
+                return 0;
+            }
+            return path_index.get_pangenome_pos(as_path_handle(id), nuc_pos_1 - 1) + 1;
+        }
+    };
+
+    /// The files of a set of inputs, empty for the ones not given
+    struct input_files_t {
+        std::string index;
+        std::string graph;
+        std::string depth_index;
+    };
+
+    /// Load the given inputs, false with a message if one of them cannot be read
+    bool load_served_inputs(const input_files_t& files, const uint64_t& num_threads,
+                            served_inputs_t& inputs, std::string& error) {
+        std::error_code size_error;
+        if (!files.index.empty()) {
+            if (!std::filesystem::exists(files.index)) {
+                error = "the index \"" + files.index + "\" does not exist";
+                return false;
+            }
+            try {
+                // the index is read through a memory mapping of the file
+                inputs.path_index.load(files.index);
+            } catch (const std::exception& e) {
+                error = e.what();
+                return false;
+            }
+            for (uint64_t i = 1; i <= inputs.path_index.path_count; ++i) {
+                inputs.xp_paths[inputs.path_index.get_path_name(as_path_handle(i))] = as_path_handle(i);
+            }
+            inputs.has_index = true;
+            inputs.bytes += std::filesystem::file_size(files.index, size_error);
+        }
+        if (!files.graph.empty()) {
+            if (!std::filesystem::exists(files.graph)) {
+                error = "the graph \"" + files.graph + "\" does not exist";
+                return false;
+            }
+            utils::handle_gfa_odgi_input(files.graph, "server", false, num_threads, inputs.graph);
+            inputs.has_graph = true;
+            inputs.bytes += std::filesystem::file_size(files.graph, size_error);
+        }
+        if (!files.depth_index.empty()) {
+            std::ifstream in(files.depth_index, std::ios::binary);
+            if (!in || !inputs.depth_index.load(in)) {
+                error = "the file \"" + files.depth_index + "\" does not hold a depth index written by odgi depth --write-depth-index";
+                return false;
+            }
+            inputs.has_depth_index = true;
+            inputs.bytes += std::filesystem::file_size(files.depth_index, size_error);
+        }
+        return true;
+    }
+
+    /// Named inputs, loaded on their first query and dropped, least recently used first, once the
+    /// loaded ones take more than the memory budget. Queries hold the inputs they use, so that a
+    /// dropped set is only freed when its last query is answered.
+    class input_registry_t {
+    public:
+        input_registry_t(const std::map<std::string, input_files_t>& registered,
+                         const uint64_t& budget_bytes, const uint64_t& num_threads)
+            : budget_bytes(budget_bytes), num_threads(num_threads) {
+            for (auto& r : registered) {
+                entries[r.first] = std::make_unique<entry_t>();
+                entries[r.first]->files = r.second;
+            }
+        }
+
+        /// The inputs of the name, loading them if needed, or null with a message and an HTTP status
+        std::shared_ptr<const served_inputs_t> get(const std::string& name, std::string& error, int& status) {
+            auto f = entries.find(name);
+            if (f == entries.end()) {
+                error = "no inputs are registered as '" + name + "'";
+                status = 404;
+                return nullptr;
+            }
+            entry_t& entry = *f->second;
+            {
+                std::lock_guard<std::mutex> guard(mutex);
+                if (entry.inputs) {
+                    entry.last_use = ++tick;
+                    return entry.inputs;
+                }
+            }
+            // a set is loaded once, however many queries wait for it, and without holding up the others
+            std::lock_guard<std::mutex> loading(entry.loading);
+            {
+                std::lock_guard<std::mutex> guard(mutex);
+                if (entry.inputs) {
+                    entry.last_use = ++tick;
+                    return entry.inputs;
+                }
+            }
+            auto inputs = std::make_shared<served_inputs_t>();
+            if (!load_served_inputs(entry.files, num_threads, *inputs, error)) {
+                status = 500;
+                return nullptr;
+            }
+            std::lock_guard<std::mutex> guard(mutex);
+            entry.inputs = inputs;
+            entry.last_use = ++tick;
+            ++entry.loads;
+            loaded_bytes += inputs->bytes;
+            while (loaded_bytes > budget_bytes) {
+                entry_t* oldest = nullptr;
+                for (auto& e : entries) {
+                    if (e.second->inputs && e.second.get() != &entry
+                        && (oldest == nullptr || e.second->last_use < oldest->last_use)) {
+                        oldest = e.second.get();
+                    }
+                }
+                if (oldest == nullptr) break;
+                loaded_bytes -= oldest->inputs->bytes;
+                oldest->inputs.reset();
+                ++evictions;
+            }
+            return inputs;
+        }
+
+        std::string stats_json(void) {
+            std::lock_guard<std::mutex> guard(mutex);
+            std::string out = "{\"budget_bytes\":" + std::to_string(budget_bytes)
+                + ",\"loaded_bytes\":" + std::to_string(loaded_bytes)
+                + ",\"evictions\":" + std::to_string(evictions) + ",\"inputs\":[";
+            bool first = true;
+            for (auto& e : entries) {
+                out += std::string(first ? "" : ",") + "{\"name\":\"" + e.first + "\""
+                    + ",\"loaded\":" + (e.second->inputs ? "true" : "false")
+                    + ",\"loads\":" + std::to_string(e.second->loads)
+                    + ",\"bytes\":" + std::to_string(e.second->inputs ? e.second->inputs->bytes : 0) + "}";
+                first = false;
+            }
+            return out + "]}";
+        }
+
+    private:
+        struct entry_t {
+            input_files_t files;
+            std::shared_ptr<const served_inputs_t> inputs;
+            uint64_t last_use = 0;
+            uint64_t loads = 0;
+            std::mutex loading;
+        };
+        /// fixed once built, so that the entries are found without the lock
+        std::map<std::string, std::unique_ptr<entry_t>> entries;
+        const uint64_t budget_bytes;
+        const uint64_t num_threads;
+        std::mutex mutex;
+        uint64_t tick = 0;
+        uint64_t loaded_bytes = 0;
+        uint64_t evictions = 0;
+    };
+
+    /// Read a registry of tab-separated lines of a name, a path index, a graph and a depth index, the
+    /// last ones optional or '-', with relative paths taken from the directory of the registry
+    bool read_registry(const std::string& registry_file, std::map<std::string, input_files_t>& registered,
+                       std::string& error) {
+        std::ifstream in(registry_file);
+        if (!in) {
+            error = "cannot read the registry \"" + registry_file + "\"";
+            return false;
+        }
+        const std::filesystem::path dir = std::filesystem::path(registry_file).parent_path();
+        auto resolve = [&](const std::string& file) {
+            if (file.empty() || file == "-") return std::string();
+            const std::filesystem::path p(file);
+            return (p.is_relative() ? dir / p : p).string();
+        };
+        std::string line;
+        uint64_t line_number = 0;
+        while (std::getline(in, line)) {
+            ++line_number;
+            if (line.empty() || line[0] == '#') continue;
+            std::vector<std::string> fields;
+            std::stringstream ss(line);
+            std::string field;
+            while (std::getline(ss, field, '\t')) {
+                fields.push_back(field);
+            }
+            fields.resize(std::max((size_t)4, fields.size()));
+            input_files_t files = {resolve(fields[1]), resolve(fields[2]), resolve(fields[3])};
+            if (fields[0].empty() || fields[0].find('/') != std::string::npos
+                || (files.index.empty() && files.graph.empty() && files.depth_index.empty())) {
+                error = "line " + std::to_string(line_number) + " of the registry needs a name without '/' and at least one file";
+                return false;
+            }
+            if (!registered.insert(std::make_pair(fields[0], files)).second) {
+                error = "'" + fields[0] + "' is registered twice";
+                return false;
+            }
+        }
+        return true;
+    }
+    }
+
     int main_server(int argc, char** argv) {
 
         for (uint64_t i = 1; i < argc-1; ++i) {
@@ -19,12 +463,21 @@ namespace odgi {
         argv[0] = (char*)prog_name.c_str();
         --argc;
 
-        args::ArgumentParser parser("Start a basic HTTP server with a given path index file to go from *path:position* to *pangenome:position* very efficiently.");
+        args::ArgumentParser parser("Start a basic HTTP server with a given path index file to go from *path:position* to *pangenome:position* very efficiently, and optionally serve regions of a resident graph.");
         args::Group mandatory_opts(parser, "[ MANDATORY OPTIONS ]");
         args::ValueFlag<std::string> dg_in_file(mandatory_opts, "FILE", "Load the succinct variation graph index from this *FILE*. The file name usually ends with *.xp*.", {'i', "idx"});
         args::ValueFlag<std::string> port(mandatory_opts, "N", "Run the server under this port.", {'p', "port"});
+        args::Group graph_opts(parser, "[ Graph Options ]");
+        args::ValueFlag<std::string> og_in_file(graph_opts, "FILE", "Keep the graph in this *FILE* in memory and serve subgraph, depth and path coverage queries over path ranges. The file name usually ends with *.og*. It also accepts GFAv1.", {'g', "graph"});
+        args::ValueFlag<std::string> depth_index_file(graph_opts, "FILE", "Serve mean, min and max depth queries over path ranges from the depth index in this *FILE*, written by odgi depth --write-depth-index.", {'d', "depth-index"});
+        args::ValueFlag<std::string> registry_file(graph_opts, "FILE", "Serve the named inputs listed in this *FILE*, one per line as a name, a path index, a graph and a depth index separated by tabs, the last ones optional or '-', each loaded on its first query under /g/NAME/. It replaces *-i, --idx*, *-g, --graph* and *-d, --depth-index*.", {'r', "registry"});
+        args::ValueFlag<uint64_t> memory_budget_mb(graph_opts, "N", "Keep the registered inputs that take up to *N* MiB loaded, dropping the least recently used ones beyond it (default: no limit).", {'m', "memory-budget"});
         args::Group http_opts(parser, "[ HTTP Options ]");
         args::ValueFlag<std::string> ip_address(http_opts, "IP", "Run the server under this IP address. If not specified, *IP* will be *localhost*.", {'a', "ip"});
+        args::ValueFlag<uint64_t> binary_port(http_opts, "N", "Also answer path to pangenome position queries in the binary protocol on this TCP port, which takes pipelined, length-prefixed frames on one connection.", {'b', "binary-port"});
+        args::ValueFlag<uint64_t> cache_mb(http_opts, "N", "Keep up to *N* MiB of subgraph, depth and coverage answers, so that repeated queries of the same region are answered from memory (default: 256, 0 disables the cache).", {'c', "cache-mb"});
+        args::Group threading_opts(parser, "[ Threading ]");
+        args::ValueFlag<uint64_t> nthreads(threading_opts, "N", "Number of worker threads answering requests (default: 1).", {'t', "threads"});
         args::Group program_information(parser, "[ Program Information ]");
         args::HelpFlag help(program_information, "help", "Print a help message for odgi server.", {'h', "help"});
 
@@ -43,80 +496,390 @@ namespace odgi {
             return 1;
         }
 
-        if (!dg_in_file) {
-            std::cerr << "[odgi::server]: please enter a file to read the index from via -i=[FILE], --idx=[FILE]." << std::endl;
+        if (!dg_in_file && !og_in_file && !depth_index_file && !registry_file) {
+            std::cerr << "[odgi::server]: please enter a file to read the index from via -i=[FILE], --idx=[FILE], a graph to serve via -g=[FILE], --graph=[FILE], "
+                         "a depth index via -d=[FILE], --depth-index=[FILE], or a registry of them via -r=[FILE], --registry=[FILE]." << std::endl;
             exit(1);
         }
 
+        if (registry_file && (dg_in_file || og_in_file || depth_index_file)) {
+            std::cerr << "[odgi::server] error: the inputs of a registry given via -r=[FILE], --registry=[FILE] replace -i, -g and -d." << std::endl;
+            return 1;
+        }
+
+        if (registry_file && binary_port) {
+            std::cerr << "[odgi::server] error: the binary protocol serves the path index given via -i=[FILE], --idx=[FILE], not a registry." << std::endl;
+            return 1;
+        }
+
         if (!port) {
             std::cerr << "[odgi::server]: please enter a port for the server via -p=[N], --port=[N]." << std::endl;
             exit(1);
         }
 
-        XP path_index;
-		if (!std::filesystem::exists(args::get(dg_in_file))) {
-			std::cerr << "[odgi::" << "panpos" << "] error: the given file \"" << args::get(dg_in_file) << "\" does not exist. Please specify an existing input file in xp format via -i=[FILE], --idx=[FILE]." << std::endl;
-			return 1;
-		}
-        std::ifstream in;
-        in.open(args::get(dg_in_file));
-        path_index.load(in);
-        in.close();
+        const uint64_t num_threads = nthreads ? std::max(args::get(nthreads), (uint64_t)1) : 1;
 
-        /*
-        const char* pattern = R"(/(\d+)/(\w+))";
-        std::regex regexi = std::regex(pattern);
-        std::cmatch cm;    // same as std::match_results<const char*> cm;
-        std::regex_match ("/3/test",cm,regexi);
-        std::cout << "the matches were: " << std::endl;
-        for (unsigned i=0; i<cm.size(); ++i) {
-            std::cout << "[" << cm[i] << "] " << std::endl;
-        }
-        std::cout << std::endl;
-
-        // const char* pattern1 = R"(/(\w+)/(\d+))";
-        // const char* pattern1 = R"(/([a-zA-Z]*[0-9]*)/(\d+))";
-        const char* pattern1 = R"(/(\w*.*)/(\d+))";
-        std::regex regexi1 = std::regex(pattern1);
-        std::cmatch cm1;    // same as std::match_results<const char*> cm;
-        std::regex_match ("/5-/3",cm1,regexi1); // /1741.hr2/3
-        std::cout << "the matches were: " << std::endl;
-        for (unsigned i=0; i<cm1.size(); ++i) {
-            std::cout << "[" << cm1[i] << "] " << std::endl;
+        // the inputs given on the command line are loaded now, those of a registry on their first query
+        std::vector<std::string> input_names;
+        served_inputs_t single;
+        std::unique_ptr<input_registry_t> registry;
+        if (registry_file) {
+            std::map<std::string, input_files_t> registered;
+            std::string error;
+            if (!read_registry(args::get(registry_file), registered, error)) {
+                std::cerr << "[odgi::server] error: " << error << "." << std::endl;
+                return 1;
+            }
+            for (auto& r : registered) {
+                for (auto* file : {&r.second.index, &r.second.graph, &r.second.depth_index}) {
+                    if (!file->empty()) input_names.push_back(*file);
+                }
+            }
+            const uint64_t budget = memory_budget_mb ? args::get(memory_budget_mb) << 20 : std::numeric_limits<uint64_t>::max();
+            registry = std::make_unique<input_registry_t>(registered, budget, num_threads);
+        } else {
+            input_files_t files;
+            if (dg_in_file) files.index = args::get(dg_in_file);
+            if (og_in_file) files.graph = args::get(og_in_file);
+            if (depth_index_file) files.depth_index = args::get(depth_index_file);
+            std::string error;
+            if (!load_served_inputs(files, num_threads, single, error)) {
+                std::cerr << "[odgi::server] error: " << error << "." << std::endl;
+                return 1;
+            }
+            for (auto* file : {&files.index, &files.graph, &files.depth_index}) {
+                if (!file->empty()) input_names.push_back(*file);
+            }
         }
-        */
 
         Server svr;
 
-        svr.Get("/hi", [](const Request& req, Response& res) {
+        svr.new_task_queue = [num_threads] { return new ThreadPool(num_threads); };
+
+        auto set_cors_headers = [](Response& res) {
             res.set_header("Access-Control-Allow-Origin", "*");
             res.set_header("Access-Control-Expose-Headers", "text/plain");
             res.set_header("Access-Control-Allow-Methods", "GET, POST, DELETE, PUT");
-            res.set_content("Hello World!", "text/plain");
-            std::cout << "GOT REQUEST : HELLO WORLD!" << std::endl;
-        });
+        };
+
+        // the answers over graph regions are cached whole, keyed by the request and the loaded inputs
+        const std::string fingerprint = input_fingerprint(input_names);
+        const uint64_t cache_bytes = (cache_mb ? args::get(cache_mb) : 256) << 20;
+        response_cache_t cache(cache_bytes);
+        auto cached = [&](const Server::Handler& handler) -> Server::Handler {
+            if (cache_bytes == 0) {
+                return handler;
+            }
+            return [&, handler](const Request& req, Response& res) {
+                std::string key = fingerprint + " " + req.path;
+                for (auto& param : req.params) {
+                    key += "&" + param.first + "=" + param.second;
+                }
+                std::string content, content_type;
+                if (cache.get(key, content, content_type)) {
+                    set_cors_headers(res);
+                    res.set_content(content, content_type.c_str());
+                    return;
+                }
+                handler(req, res);
+                if (res.status == -1 || res.status == 200) {
+                    cache.put(key, res.body, res.get_header_value("Content-Type"));
+                }
+            };
+        };
+
+        // the answers read their arguments from the matches of the route starting at m, which is
+        // past the name of the inputs for the routes of a registry
+        using answer_t = std::function<void(const served_inputs_t&, const Request&, Response&, const size_t&)>;
+
+        // parse /<route>/<path>/<start>/<end> with a 1-based, inclusive range into a 0-based, half-open one
+        auto parse_range = [&](const graph_t& graph, const Request& req, Response& res, const size_t& m,
+                               path_handle_t& path, uint64_t& start, uint64_t& end) {
+            const std::string path_name = req.matches[m];
+            const std::string start_1 = req.matches[m + 1];
+            const std::string end_1 = req.matches[m + 2];
+            if (!graph.has_path(path_name)) {
+                res.status = 404;
+                res.set_content("path '" + path_name + "' is not in the graph", "text/plain");
+                return false;
+            }
+            if (!parse_position(start_1, start) || !parse_position(end_1, end) || start > end) {
+                res.status = 400;
+                res.set_content("invalid range " + start_1 + "-" + end_1, "text/plain");
+                return false;
+            }
+            path = graph.get_path_handle(path_name);
+            --start;
+            return true;
+        };
 
-        svr.Get(R"(/(\w*.*)/(\d+))", [&](const Request& req, Response& res) {
-            /*
-            for (size_t i = 0; i < req.matches.size(); i++) {
-                std::cout << req.matches[i] << std::endl;
+        // the subgraph induced by the nodes of the range, with the subpaths of all paths over it
+        const answer_t answer_subgraph = [&](const served_inputs_t& in, const Request& req, Response& res, const size_t& m) {
+            const graph_t& graph = in.graph;
+            path_handle_t path;
+            uint64_t start, end;
+            if (!parse_range(graph, req, res, m, path, start, end)) return;
+            uint64_t context_steps = 0;
+            const std::string context = req.has_param("context") ? req.get_param_value("context") : "0";
+            auto parsed = std::from_chars(context.data(), context.data() + context.size(), context_steps);
+            if (parsed.ec != std::errc() || parsed.ptr != context.data() + context.size()) {
+                res.status = 400;
+                res.set_content("invalid context", "text/plain");
+                return;
             }
-             */
-            auto path_name = req.matches[1];
-            auto nuc_pos_1 = req.matches[2];
-            std::cout << "GOT REQUEST : path name: " << path_name << "; 1-based nucleotide position: " << nuc_pos_1 << std::endl;
-            size_t nuc_pos_0 = std::stoi(nuc_pos_1) - 1;
-            size_t pan_pos = 0;
-            if (path_index.has_path(path_name)) {
-                if (path_index.has_position(path_name, nuc_pos_0)) {
-                    pan_pos = path_index.get_pangenome_pos(path_name, nuc_pos_0) + 1;
+            // a view on the graph, so that nothing is copied but the subpaths
+            SubPathHandleGraph subgraph(&graph);
+            std::vector<handle_t> curr_handles;
+            algorithms::for_handle_in_path_range(graph, path, start, end, [&](const handle_t& h) {
+                if (!subgraph.has_node(graph.get_id(h))) {
+                    subgraph.add_handle(h);
+                    curr_handles.push_back(h);
                 }
+            });
+            // the context, as extract expands a subgraph by steps
+            for (uint64_t i = 0; i < context_steps && !curr_handles.empty(); ++i) {
+                std::vector<handle_t> next_handles;
+                for (auto& h : curr_handles) {
+                    graph.follow_edges(h, false, [&](const handle_t& c) {
+                        if (!subgraph.has_node(graph.get_id(c))) {
+                            subgraph.add_handle(c);
+                            next_handles.push_back(c);
+                        }
+                    });
+                    graph.follow_edges(h, true, [&](const handle_t& c) {
+                        if (!subgraph.has_node(graph.get_id(c))) {
+                            subgraph.add_handle(c);
+                            next_handles.push_back(c);
+                        }
+                    });
+                }
+                curr_handles = std::move(next_handles);
             }
-            std::cout << "SEND RESPONSE: pangenome position: " << pan_pos << std::endl;
-            res.set_header("Access-Control-Allow-Origin", "*");
-            res.set_header("Access-Control-Expose-Headers", "text/plain");
-            res.set_header("Access-Control-Allow-Methods", "GET, POST, DELETE, PUT");
-            res.set_content(std::to_string(pan_pos), "text/plain");
+            subgraph.index_paths();
+            if (req.has_param("format") && req.get_param_value("format") == "json") {
+                std::stringstream out;
+                out << "{\"nodes\":[";
+                bool first = true;
+                subgraph.for_each_handle([&](const handle_t& h) {
+                    out << (first ? "" : ",") << "{\"id\":" << subgraph.get_id(h)
+                        << ",\"sequence\":\"" << subgraph.get_sequence(h) << "\"}";
+                    first = false;
+                });
+                out << "],\"edges\":[";
+                first = true;
+                subgraph.for_each_edge([&](const edge_t& e) {
+                    out << (first ? "" : ",") << "{\"from\":" << subgraph.get_id(e.first)
+                        << ",\"from_rev\":" << (subgraph.get_is_reverse(e.first) ? "true" : "false")
+                        << ",\"to\":" << subgraph.get_id(e.second)
+                        << ",\"to_rev\":" << (subgraph.get_is_reverse(e.second) ? "true" : "false") << "}";
+                    first = false;
+                });
+                out << "],\"paths\":[";
+                first = true;
+                subgraph.for_each_path_handle([&](const path_handle_t& p) {
+                    out << (first ? "" : ",") << "{\"name\":\"" << subgraph.get_path_name(p) << "\",\"steps\":[";
+                    bool first_step = true;
+                    subgraph.for_each_step_in_path(p, [&](const step_handle_t& step) {
+                        const handle_t h = subgraph.get_handle_of_step(step);
+                        out << (first_step ? "\"" : ",\"") << subgraph.get_id(h) << (subgraph.get_is_reverse(h) ? "-" : "+") << "\"";
+                        first_step = false;
+                    });
+                    out << "]}";
+                    first = false;
+                });
+                out << "]}";
+                res.set_content(out.str(), "application/json");
+            } else {
+                std::stringstream out;
+                subgraph.to_gfa(out);
+                res.set_content(out.str(), "text/plain");
+            }
+        };
+
+        // the path depth of each node in the range, in path order
+        const answer_t answer_depth = [&](const served_inputs_t& in, const Request& req, Response& res, const size_t& m) {
+            const graph_t& graph = in.graph;
+            path_handle_t path;
+            uint64_t start, end;
+            if (!parse_range(graph, req, res, m, path, start, end)) return;
+            std::string out = "[";
+            algorithms::for_handle_in_path_range(
+                    graph, path, start, end,
+                    [&](const handle_t& h) {
+                        if (out.size() > 1) out.push_back(',');
+                        out += "{\"id\":" + std::to_string(graph.get_id(h))
+                            + ",\"length\":" + std::to_string(graph.get_length(h))
+                            + ",\"depth\":" + std::to_string(graph.get_step_count(h)) + "}";
+                    });
+            out.push_back(']');
+            res.set_content(out, "application/json");
+        };
+
+        // for each path over the range's nodes, the number of its steps and bases on them
+        const answer_t answer_coverage = [&](const served_inputs_t& in, const Request& req, Response& res, const size_t& m) {
+            const graph_t& graph = in.graph;
+            path_handle_t path;
+            uint64_t start, end;
+            if (!parse_range(graph, req, res, m, path, start, end)) return;
+            std::unordered_set<nid_t> visited;
+            std::map<uint64_t, std::pair<uint64_t, uint64_t>> coverage; // path -> steps, bases
+            algorithms::for_handle_in_path_range(
+                    graph, path, start, end,
+                    [&](const handle_t& h) {
+                        if (!visited.insert(graph.get_id(h)).second) return;
+                        const uint64_t length = graph.get_length(h);
+                        graph.for_each_step_on_handle(h, [&](const step_handle_t& step) {
+                            auto& c = coverage[as_integer(graph.get_path_handle_of_step(step))];
+                            ++c.first;
+                            c.second += length;
+                        });
+                    });
+            std::string out = "[";
+            for (auto& c : coverage) {
+                if (out.size() > 1) out.push_back(',');
+                out += "{\"name\":\"" + graph.get_path_name(as_path_handle(c.first))
+                    + "\",\"steps\":" + std::to_string(c.second.first)
+                    + ",\"bases\":" + std::to_string(c.second.second) + "}";
+            }
+            out.push_back(']');
+            res.set_content(out, "application/json");
+        };
+
+        // the mean, min and max depth over a 1-based, inclusive range of a path
+        const answer_t answer_depth_range = [&](const served_inputs_t& in, const Request& req, Response& res, const size_t& m) {
+            const auto& depth_index = in.depth_index;
+            const std::string path_name = req.matches[m];
+            const std::string start_1 = req.matches[m + 1];
+            const std::string end_1 = req.matches[m + 2];
+            if (!depth_index.has_path(path_name)) {
+                res.status = 404;
+                res.set_content("path '" + path_name + "' is not in the depth index", "text/plain");
+                return;
+            }
+            const uint64_t rank = depth_index.get_path_rank(path_name);
+            uint64_t start, end;
+            if (!parse_position(start_1, start) || !parse_position(end_1, end) || start > end
+                || end > depth_index.get_path_length(rank)) {
+                res.status = 400;
+                res.set_content("invalid range " + start_1 + "-" + end_1, "text/plain");
+                return;
+            }
+            double mean;
+            uint64_t min, max;
+            depth_index.get_range_depth(rank, start - 1, end, mean, min, max);
+            std::ostringstream out;
+            out << "{\"mean\":" << mean << ",\"min\":" << min << ",\"max\":" << max << "}";
+            res.set_content(out.str(), "application/json");
+        };
+
+        const answer_t answer_position = [&](const served_inputs_t& in, const Request& req, Response& res, const size_t& m) {
+            const std::string path_name = req.matches[m];
+            const std::string nuc_pos = req.matches[m + 1];
+            uint64_t nuc_pos_1 = 0;
+            if (!parse_position(nuc_pos, nuc_pos_1)) {
+                res.status = 400;
+                res.set_content("invalid position", "text/plain");
+                return;
+            }
+            res.set_content(std::to_string(in.pangenome_position(path_name, nuc_pos_1)), "text/plain");
+        };
+
+        // batched queries: one PATH_NAME:POSITION per line in the body, answered in order
+        // as a JSON array, or as little-endian uint64 values with ?format=binary
+        const answer_t answer_batch = [&](const served_inputs_t& in, const Request& req, Response& res, const size_t& m) {
+            const bool binary = req.has_param("format") && req.get_param_value("format") == "binary";
+            std::vector<uint64_t> positions;
+            std::string_view body = req.body;
+            std::string path_name;
+            while (!body.empty()) {
+                const size_t eol = body.find('\n');
+                std::string_view line = body.substr(0, eol);
+                body.remove_prefix(eol == std::string_view::npos ? body.size() : eol + 1);
+                if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+                if (line.empty()) continue;
+                // path names may contain ':', the position follows the last one
+                const size_t colon = line.rfind(':');
+                uint64_t nuc_pos_1 = 0;
+                if (colon == std::string_view::npos || !parse_position(line.substr(colon + 1), nuc_pos_1)) {
+                    res.status = 400;
+                    res.set_content("invalid query '" + std::string(line) + "', expected PATH_NAME:POSITION", "text/plain");
+                    return;
+                }
+                path_name.assign(line.data(), colon);
+                positions.push_back(in.pangenome_position(path_name, nuc_pos_1));
+            }
+            if (binary) {
+                std::string out(positions.size() * sizeof(uint64_t), '\0');
+                for (uint64_t i = 0; i < positions.size(); ++i) {
+                    for (uint64_t b = 0; b < sizeof(uint64_t); ++b) {
+                        out[i * sizeof(uint64_t) + b] = (char)((positions[i] >> (8 * b)) & 0xff);
+                    }
+                }
+                res.set_content(out, "application/octet-stream");
+            } else {
+                std::string out = "[";
+                for (uint64_t i = 0; i < positions.size(); ++i) {
+                    if (i) out.push_back(',');
+                    out += std::to_string(positions[i]);
+                }
+                out.push_back(']');
+                res.set_content(out, "application/json");
+            }
+        };
+
+        // a route answers from the inputs given on the command line, or from those named in its path
+        // for a registry, provided that they hold what the answer needs
+        auto route = [&](const answer_t& answer, bool served_inputs_t::* needs, const std::string& what) -> Server::Handler {
+            if (!registry) {
+                return [&, answer](const Request& req, Response& res) {
+                    set_cors_headers(res);
+                    answer(single, req, res, 1);
+                };
+            }
+            return [&, answer, needs, what](const Request& req, Response& res) {
+                set_cors_headers(res);
+                std::string error;
+                int status = 200;
+                auto inputs = registry->get(req.matches[1], error, status);
+                if (!inputs) {
+                    res.status = status;
+                    res.set_content(error, "text/plain");
+                } else if (!((*inputs).*needs)) {
+                    res.status = 404;
+                    res.set_content("'" + std::string(req.matches[1]) + "' has no " + what, "text/plain");
+                } else {
+                    answer(*inputs, req, res, 2);
+                }
+            };
+        };
+        const std::string prefix = registry ? "/g/([^/]+)" : "";
+        const bool all = (bool)registry;
+
+        svr.Get("/hi", [&](const Request& req, Response& res) {
+            set_cors_headers(res);
+            res.set_content("Hello World!", "text/plain");
+        });
+
+        if (all || single.has_graph) {
+            svr.Get((prefix + R"(/subgraph/(.+)/(\d+)/(\d+))").c_str(), cached(route(answer_subgraph, &served_inputs_t::has_graph, "graph")));
+            svr.Get((prefix + R"(/depth/(.+)/(\d+)/(\d+))").c_str(), cached(route(answer_depth, &served_inputs_t::has_graph, "graph")));
+            svr.Get((prefix + R"(/coverage/(.+)/(\d+)/(\d+))").c_str(), cached(route(answer_coverage, &served_inputs_t::has_graph, "graph")));
+        }
+
+        if (all || single.has_depth_index) {
+            svr.Get((prefix + R"(/depth-range/(.+)/(\d+)/(\d+))").c_str(), cached(route(answer_depth_range, &served_inputs_t::has_depth_index, "depth index")));
+        }
+
+        if (all || single.has_index) {
+            svr.Get((prefix + R"(/(\w*.*)/(\d+))").c_str(), route(answer_position, &served_inputs_t::has_index, "path index"));
+            svr.Post((prefix + "/batch").c_str(), route(answer_batch, &served_inputs_t::has_index, "path index"));
+        }
+
+        svr.Get("/stats", [&](const Request& req, Response& res) {
+            set_cors_headers(res);
+            res.set_content("{\"cache\":" + cache.stats_json()
+                            + (registry ? ",\"registry\":" + registry->stats_json() : std::string()) + "}",
+                            "application/json");
         });
 
         svr.Get("/stop", [&](const Request& req, Response& res) {
@@ -131,9 +894,66 @@ namespace odgi {
             ip = args::get(ip_address);
         }
 
+        // the binary protocol runs next to the HTTP server, with a thread per connection
+        int binary_fd = -1;
+        std::atomic<bool> stopping(false);
+        std::thread binary_acceptor;
+        if (binary_port) {
+            if (!single.has_index) {
+                std::cerr << "[odgi::server] error: the binary protocol answers path index queries, please give the index via -i=[FILE], --idx=[FILE]." << std::endl;
+                return 1;
+            }
+            addrinfo hints;
+            std::memset(&hints, 0, sizeof(hints));
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            hints.ai_flags = AI_PASSIVE;
+            addrinfo* address = nullptr;
+            const std::string service = std::to_string(args::get(binary_port));
+            if (getaddrinfo(ip.c_str(), service.c_str(), &hints, &address) == 0) {
+                binary_fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+                const int yes = 1;
+                setsockopt(binary_fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+                if (binary_fd != -1 && (bind(binary_fd, address->ai_addr, address->ai_addrlen) != 0
+                                        || listen(binary_fd, SOMAXCONN) != 0)) {
+                    close(binary_fd);
+                    binary_fd = -1;
+                }
+                freeaddrinfo(address);
+            }
+            if (binary_fd == -1) {
+                std::cerr << "[odgi::server] error: cannot listen on " << ip << ":" << service << " for the binary protocol." << std::endl;
+                return 1;
+            }
+            auto path_id = [&](const std::string& name) -> uint64_t {
+                auto f = single.xp_paths.find(name);
+                return f == single.xp_paths.end() ? 0 : as_integer(f->second);
+            };
+            auto translate = [&](const uint64_t& id, const uint64_t& nuc_pos_1) -> uint64_t {
+                return single.pangenome_position(id, nuc_pos_1);
+            };
+            binary_acceptor = std::thread([&, path_id, translate]() {
+                while (!stopping.load()) {
+                    const int fd = accept(binary_fd, nullptr, nullptr);
+                    if (fd == -1) continue;
+                    const int yes = 1;
+                    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+                    std::thread(serve_binary_connection, fd, path_id, translate).detach();
+                }
+            });
+            std::cout << "binary protocol listening on " << ip << ":" << service << std::endl;
+        }
+
         std::cout << "http server listening on http://" << ip << ":" << args::get(port) << std::endl;
         svr.listen(ip.c_str(), p);
 
+        if (binary_acceptor.joinable()) {
+            stopping.store(true);
+            shutdown(binary_fd, SHUT_RDWR);
+            close(binary_fd);
+            binary_acceptor.join();
+        }
+
         /*
         // we have a 0-based positioning
         uint64_t nucleotide_pos = args::get(nuc_pos) - 1;
@@ -4,20 +4,20 @@
 #include "split.hpp"
 #include <omp.h>
 #include "utils.hpp"
+#include "algorithms/coverage_matrix.hpp"
+#include "algorithms/group_intersections.hpp"
+#include "algorithms/path_sketch.hpp"
+#include "algorithms/visited_set.hpp"
+#include "algorithms/path_tasks.hpp"
+
+#ifdef USE_GPU
+#include "cuda/coverage.h"
+#endif
 
 namespace odgi {
 
 using namespace odgi::subcommand;
 
-// Functions used for the distance matrix generation
-inline uint64_t encode_pair(uint32_t v, uint32_t h) {
-    return ((uint64_t)v << 32) | (uint64_t)h;
-}
-inline void decode_pair(uint64_t pair, uint32_t *v, uint32_t *h) {
-    *v = pair >> 32;
-    *h = pair & 0x00000000FFFFFFFF;
-}
-
 int main_similarity(int argc, char** argv) {
 
     // trick argumentparser to do the right thing with the subcommand
@@ -39,6 +39,20 @@ int main_similarity(int argc, char** argv) {
                                                         {'p', "delim-pos"});   
     args::Flag distances(path_investigation_opts, "distances", "Provide distances (dissimilarities) instead of similarities. "
                                                              "Outputs additional columns with the Euclidean and Manhattan distances." , {'d', "distances"});
+    args::ValueFlag<std::string> coverage_matrix_file(path_investigation_opts, "FILE", "Take the steps of the paths on the nodes from the coverage matrix in *FILE*, instead of"
+                                                    " walking the paths. If *FILE* does not exist or was built for another graph, it is built and written there.", {"coverage-matrix"});
+    args::Group approx_opts(parser, "[ Approximate Similarity Options ]");
+    args::Flag approx(approx_opts, "approx", "Estimate the similarities from bottom-k sketches of the node sets of the paths or groups, weighted by node length,"
+                                             " instead of computing them exactly. The lengths are those of the node sets, so nodes visited several times count once.", {'a', "approx"});
+    args::ValueFlag<uint64_t> sketch_size(approx_opts, "N", "Keep the N smallest base pair hashes in each sketch (default: 1000). Larger sketches give more precise estimates.", {'k', "sketch-size"});
+    args::ValueFlag<std::string> sketch_out_file(approx_opts, "FILE", "Write the sketches, those read via --sketch-in included, to *FILE*.", {"sketch-out"});
+    args::ValueFlag<std::string> sketch_in_file(approx_opts, "FILE", "Compare the paths or groups of the graph also with the sketches in *FILE*, written via --sketch-out"
+                                                                   " from a graph with the same node ids. The pairs within *FILE* are not reported again.", {"sketch-in"});
+#ifdef USE_GPU
+    args::Group gpu_opts(parser, "[ GPU ]");
+    args::Flag gpu_compute(gpu_opts, "gpu", "Count the steps of the paths on the nodes with the GPU, into a coverage matrix that is kept in memory, or written to the *FILE* of"
+                                            " --coverage-matrix if it has to be built, and sum up the lengths shared by each pair of paths or groups on the GPU as well.", {"gpu"});
+#endif
 args::Group threading_opts(parser, "[ Threading ]");
     args::ValueFlag<uint64_t> threads(threading_opts, "N", "Number of threads to use for parallel operations.", {'t', "threads"});
 	args::Group processing_info_opts(parser, "[ Processing Information ]");
@@ -66,6 +80,13 @@ args::Group threading_opts(parser, "[ Threading ]");
         return 1;
     }
 
+#ifdef USE_GPU
+    if (gpu_compute && approx) {
+        std::cerr << "[odgi::similarity] error: the sketches of -a, --approx are not computed on the GPU, please specify only one of --gpu and -a, --approx." << std::endl;
+        return 1;
+    }
+#endif
+
     if (path_delim_pos && args::get(path_delim_pos) < 1) {
 		std::cerr << "[odgi::similarity] error: -p,--delim-pos has to specify a value greater than 0." << std::endl;
 		return 1;
@@ -158,6 +179,186 @@ args::Group threading_opts(parser, "[ Threading ]");
                 return (uint32_t)as_integer(p);
             });
 
+    auto write_header = [&](void) {
+        /*if (using_delim) {
+            std::cout << "group.a" << "\t"
+                        << "group.b" << "\t"
+                        << "group.a.length" << "\t"
+                        << "group.b.length" << "\t";
+        } else {
+            std::cout << "path.a" << "\t"
+                        << "path.b" << "\t"
+                        << "path.a.length" << "\t"
+                        << "path.b.length" << "\t";
+        }*/
+        // Avoid changing column names (we use the more generic ones)
+        std::cout << "group.a" << "\t"
+                << "group.b" << "\t"
+                << "group.a.length" << "\t"
+                << "group.b.length" << "\t"
+                << "intersection" << "\t";
+    
+        if (emit_distances) {
+            std::cout << "jaccard.distance" << "\t"
+                      << "cosine.distance" << "\t"
+                      << "dice.distance" << "\t"
+                      << "estimated.difference.rate" << "\t"
+                      << "euclidean.distance" << "\t"
+                      << "manhattan.distance";
+        } else {
+            std::cout << "jaccard.similarity" << "\t"
+                      << "cosine.similarity" << "\t"
+                      << "dice.similarity" << "\t"
+                      << "estimated.identity";
+        }
+
+        std::cout << std::endl;
+    };
+
+    auto write_pair = [&](std::ostream& out, const std::string& name_a, const std::string& name_b,
+                          const uint64_t& length_a, const uint64_t& length_b, const uint64_t& intersection) {
+        // From https://stats.stackexchange.com/questions/58706/distance-metrics-for-binary-vectors
+        const double jaccard = (double)intersection / (double)(length_a + length_b - intersection);
+        const double cosine = (double)intersection / std::sqrt((double)(length_a * length_b));
+        const double dice = 2.0 * ((double) intersection / (double)(length_a + length_b));
+        const double estimated_identity = 2.0 * jaccard / (1.0 + jaccard);
+
+        out << name_a << "\t"
+            << name_b << "\t"
+            << length_a << "\t"
+            << length_b << "\t"
+            << intersection << "\t";
+
+        if (emit_distances) {
+            const double euclidian_distance = std::sqrt((double)((length_a + length_b - intersection) - intersection));
+            const uint64_t manhattan_distance = (length_a + length_b - intersection) - intersection;
+            out << (1.0 - jaccard) << "\t"
+                << (1.0 - cosine) << "\t"
+                << (1.0 - dice) << "\t"
+                << (1.0 - estimated_identity) << "\t"
+                << euclidian_distance << "\t"
+                << manhattan_distance << "\n";
+        } else {
+            out << jaccard << "\t"
+                << cosine << "\t"
+                << dice << "\t"
+                << estimated_identity << "\n";
+        }
+    };
+
+    if (approx) {
+        const uint64_t k = sketch_size ? args::get(sketch_size) : 1000;
+        std::vector<std::string> names;
+        std::vector<uint64_t> lengths;
+        std::vector<algorithms::path_sketch_t> sketches;
+        if (sketch_in_file) {
+            std::ifstream in(args::get(sketch_in_file), std::ios::binary);
+            if (!in || !algorithms::read_sketches(in, names, lengths, sketches)) {
+                std::cerr << "[odgi::similarity] error: \"" << args::get(sketch_in_file) << "\" does not hold sketches written via --sketch-out." << std::endl;
+                return 1;
+            }
+            for (auto& sketch : sketches) {
+                if (sketch.get_k() != k) {
+                    std::cerr << "[odgi::similarity] error: the sketches in \"" << args::get(sketch_in_file) << "\" have a size of " << sketch.get_k()
+                              << ", please specify it via -k, --sketch-size." << std::endl;
+                    return 1;
+                }
+            }
+        }
+        const uint64_t old_count = sketches.size();
+
+        // the paths of each group of this graph
+        ska::flat_hash_map<uint32_t, uint64_t> group_rank;
+        std::vector<std::vector<path_handle_t>> group_members;
+        graph.for_each_path_handle([&](const path_handle_t& p) {
+            const uint32_t id = get_path_id(p);
+            auto f = group_rank.find(id);
+            if (f == group_rank.end()) {
+                group_rank[id] = group_members.size();
+                group_members.emplace_back();
+                names.push_back(get_path_name(id));
+            }
+            group_members[group_rank[id]].push_back(p);
+        });
+        const uint64_t count = names.size();
+        lengths.resize(count, 0);
+        sketches.resize(count, algorithms::path_sketch_t(k));
+
+        const bool show_progress = args::get(progress);
+        std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress_meter;
+        if (show_progress) {
+            progress_meter = std::make_unique<algorithms::progress_meter::ProgressMeter>(
+                    group_members.size(), "[odgi::similarity] sketching the paths");
+        }
+        // a group of a few long paths takes most of the time, so they go first, and idle threads steal
+        std::vector<uint64_t> group_step_counts(group_members.size(), 0);
+        for (uint64_t i = 0; i < group_members.size(); ++i) {
+            for (auto& p : group_members[i]) {
+                group_step_counts[i] += graph.get_step_count(p);
+            }
+        }
+        algorithms::run_tasks(group_step_counts, num_threads, [&](const uint64_t& i, const uint64_t&) {
+            algorithms::visited_set_t seen(graph);
+            algorithms::path_sketch_t& sketch = sketches[old_count + i];
+            uint64_t& length = lengths[old_count + i];
+            for (auto& p : group_members[i]) {
+                graph.for_each_step_in_path(p, [&](const step_handle_t& s) {
+                    const handle_t h = graph.forward(graph.get_handle_of_step(s));
+                    if (seen.insert(h)) {
+                        const uint64_t l = graph.get_length(h);
+                        sketch.add_node(graph.get_id(h), l);
+                        length += l;
+                    }
+                });
+            }
+            sketch.finish();
+            if (show_progress) {
+                progress_meter->increment(1);
+            }
+        });
+        if (show_progress) {
+            progress_meter->finish();
+        }
+
+        if (sketch_out_file) {
+            std::ofstream out(args::get(sketch_out_file), std::ios::binary);
+            algorithms::write_sketches(out, names, lengths, sketches);
+            if (!out) {
+                std::cerr << "[odgi::similarity] error: could not write the sketches to \"" << args::get(sketch_out_file) << "\"." << std::endl;
+                return 1;
+            }
+        }
+
+        write_header();
+        // the new sketches against all, in order, a block at a time
+        const uint64_t block_size = 1024;
+        std::vector<std::string> lines(block_size);
+        for (uint64_t block = old_count; block < count; block += block_size) {
+            const uint64_t block_end = std::min(count, block + block_size);
+#pragma omp parallel for schedule(dynamic, 1)
+            for (uint64_t a = block; a < block_end; ++a) {
+                std::ostringstream out;
+                for (uint64_t b = 0; b < count; ++b) {
+                    const double jaccard = a == b ? 1.0 : sketches[a].jaccard(sketches[b]);
+                    if (jaccard > 0) {
+                        const uint64_t intersection = std::llround(jaccard / (1.0 + jaccard) * (double) (lengths[a] + lengths[b]));
+                        write_pair(out, names[a], names[b], lengths[a], lengths[b], intersection);
+                        if (b < old_count) {
+                            write_pair(out, names[b], names[a], lengths[b], lengths[a], intersection);
+                        }
+                    }
+                }
+                lines[a - block] = out.str();
+            }
+            for (uint64_t a = block; a < block_end; ++a) {
+                std::cout << lines[a - block];
+                std::string().swap(lines[a - block]);
+            }
+        }
+        std::cout.flush();
+        return 0;
+    }
+
     std::vector<uint64_t> bp_count;
     if (using_delim) {
         bp_count.resize(path_groups.size());
@@ -177,120 +378,167 @@ args::Group threading_opts(parser, "[ Threading ]");
         bp_count[get_path_id(p)] = 0;
     }
 
+    const bool show_progress = args::get(progress);
+    algorithms::coverage_matrix_t coverage;
+    algorithms::coverage_block_counter_t count_block;
+#ifdef USE_GPU
+    if (gpu_compute) {
+        count_block = cuda::node_path_coverage_counter(graph, num_threads);
+    }
+#endif
+    const bool use_coverage_matrix = coverage_matrix_file || count_block;
+    if (use_coverage_matrix
+        && !coverage.load_or_build(args::get(coverage_matrix_file), graph, num_threads, show_progress, "similarity", count_block)) {
+        return 1;
+    }
+
+    if (use_coverage_matrix) {
+        for (uint64_t i = 0; i < coverage.get_path_count(); ++i) {
+            bp_count[get_path_id(coverage.get_path_handle(i))] += coverage.get_path_length(i);
+        }
+    } else {
 #pragma omp parallel for
-    for (uint32_t i = 0; i < path_max; ++i) {
-        path_handle_t p = as_path_handle(i + 1);
-        uint64_t path_length = 0;
-        graph.for_each_step_in_path(
-            p,
-            [&](const step_handle_t& s) {
-                path_length += graph.get_length(graph.get_handle_of_step(s));
-            });
+        for (uint32_t i = 0; i < path_max; ++i) {
+            path_handle_t p = as_path_handle(i + 1);
+            uint64_t path_length = 0;
+            graph.for_each_step_in_path(
+                p,
+                [&](const step_handle_t& s) {
+                    path_length += graph.get_length(graph.get_handle_of_step(s));
+                });
 #pragma omp critical (bp_count)
-        bp_count[get_path_id(p)] += path_length;
+            bp_count[get_path_id(p)] += path_length;
+        }
     }
 
-    const bool show_progress = args::get(progress);
-    std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress_meter;
-    if (show_progress) {
-        progress_meter = std::make_unique<algorithms::progress_meter::ProgressMeter>(
-                graph.get_node_count(), "[odgi::similarity] collecting path intersection lengths");
+    const uint64_t group_count = bp_count.size();
+    // with --gpu, the shared lengths of all pairs of groups are summed up on the GPU from the runs of the coverage matrix
+    std::vector<uint64_t> gpu_shared;
+    bool shared_on_gpu = false;
+#ifdef USE_GPU
+    if (gpu_compute) {
+        std::vector<uint64_t> weights;
+        std::vector<uint64_t> offsets = {0};
+        std::vector<uint32_t> groups;
+        std::vector<uint32_t> counts;
+        ska::flat_hash_map<uint32_t, uint64_t> run_group_steps;
+        for (uint64_t run = 0; run < coverage.get_run_count(); ++run) {
+            run_group_steps.clear();
+            coverage.for_each_path_in_run(run, [&](const uint64_t& p, const uint64_t& c) {
+                run_group_steps[get_path_id(coverage.get_path_handle(p))] += c;
+            });
+            // a row of one group shares nothing
+            if (run_group_steps.size() < 2) {
+                continue;
+            }
+            weights.push_back(coverage.get_run_length(run));
+            for (auto& g : run_group_steps) {
+                groups.push_back(g.first);
+                counts.push_back(g.second);
+            }
+            offsets.push_back(groups.size());
+        }
+        shared_on_gpu = cuda::gpu_shared_lengths(weights, offsets, groups, counts, group_count, gpu_shared);
+        if (!shared_on_gpu) {
+            std::cerr << "[odgi::similarity] warning: the " << group_count << " x " << group_count
+                      << " matrix of shared lengths does not fit on the GPU, computing it on the CPU." << std::endl;
+        }
     }
+#endif
 
-    // ska::flat_hash_map<std::pair<uint64_t, uint64_t>, uint64_t> leads to huge memory usage with deep graphs
-    ska::flat_hash_map<uint64_t, uint64_t> path_intersection_length;
-    graph.for_each_handle(
-        [&](const handle_t& h) {
-            ska::flat_hash_map<uint32_t, uint64_t> local_path_lengths;
-            size_t l = graph.get_length(h);
-            graph.for_each_step_on_handle(
-                h,
-                [&](const step_handle_t& s) {
-                    local_path_lengths[get_path_id(graph.get_path_handle_of_step(s))] += l;
+    algorithms::group_intersections_t intersections;
+    std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress_meter;
+    if (!shared_on_gpu) {
+        // the nodes as rows of groups for the bit-parallel intersection kernel, one part per thread
+        std::vector<algorithms::group_rows_t> row_parts(std::max(num_threads, (uint64_t) omp_get_max_threads()));
+        if (show_progress) {
+            progress_meter = std::make_unique<algorithms::progress_meter::ProgressMeter>(
+                    use_coverage_matrix ? coverage.get_run_count() : graph.get_node_count(),
+                    "[odgi::similarity] collecting the groups on the nodes");
+        }
+        if (use_coverage_matrix) {
+            // the nodes of a run are crossed by the same paths the same number of times, so they add up to one node of the run length
+#pragma omp parallel for schedule(dynamic, 1024)
+            for (uint64_t run = 0; run < coverage.get_run_count(); ++run) {
+                ska::flat_hash_map<uint32_t, uint64_t> local_group_steps;
+                coverage.for_each_path_in_run(run, [&](const uint64_t& p, const uint64_t& c) {
+                    local_group_steps[get_path_id(coverage.get_path_handle(p))] += c;
                 });
+                const std::vector<std::pair<uint32_t, uint64_t>> group_steps(local_group_steps.begin(), local_group_steps.end());
+                row_parts[omp_get_thread_num()].add_node(coverage.get_run_length(run), group_steps);
 
-#pragma omp critical (path_intersection_length)
-            for (auto& p : local_path_lengths) {
-                for (auto& q : local_path_lengths) {
-                    path_intersection_length[encode_pair(p.first, q.first)] += std::min(p.second, q.second);
+                if (show_progress) {
+                    progress_meter->increment(1);
                 }
             }
+        } else {
+            graph.for_each_handle(
+                [&](const handle_t& h) {
+                    ska::flat_hash_map<uint32_t, uint64_t> local_group_steps;
+                    graph.for_each_step_on_handle(
+                        h,
+                        [&](const step_handle_t& s) {
+                            ++local_group_steps[get_path_id(graph.get_path_handle_of_step(s))];
+                        });
+                    const std::vector<std::pair<uint32_t, uint64_t>> group_steps(local_group_steps.begin(), local_group_steps.end());
+                    row_parts[omp_get_thread_num()].add_node(graph.get_length(h), group_steps);
+
+                    if (show_progress) {
+                        progress_meter->increment(1);
+                    }
+                }, true);
+        }
 
-            if (show_progress) {
-                progress_meter->increment(1);
-            }
-        }, true);
-
-    if (show_progress) {
-        progress_meter->finish();
-    }
+        if (show_progress) {
+            progress_meter->finish();
+        }
 
-    /*if (using_delim) {
-        std::cout << "group.a" << "\t"
-                    << "group.b" << "\t"
-                    << "group.a.length" << "\t"
-                    << "group.b.length" << "\t";
-    } else {
-        std::cout << "path.a" << "\t"
-                    << "path.b" << "\t"
-                    << "path.a.length" << "\t"
-                    << "path.b.length" << "\t";
-    }*/
-    // Avoid changing column names (we use the more generic ones)
-    std::cout << "group.a" << "\t"
-            << "group.b" << "\t"
-            << "group.a.length" << "\t"
-            << "group.b.length" << "\t"
-            << "intersection" << "\t";
-    
-    if (emit_distances) {
-        std::cout << "jaccard.distance" << "\t"
-                  << "cosine.distance" << "\t"
-                  << "dice.distance" << "\t"
-                  << "estimated.difference.rate" << "\t"
-                  << "euclidean.distance" << "\t"
-                  << "manhattan.distance";
-    } else {
-        std::cout << "jaccard.similarity" << "\t"
-                  << "cosine.similarity" << "\t"
-                  << "dice.similarity" << "\t"
-                  << "estimated.identity";
+        intersections.build(row_parts, group_count, num_threads);
+        std::vector<algorithms::group_rows_t>().swap(row_parts);
     }
 
-    std::cout << std::endl;
-    for (auto& p : path_intersection_length) {
-        uint32_t id_a, id_b;
-        decode_pair(p.first, &id_a, &id_b);
+    write_header();
 
-        auto& intersection = p.second;
 
-        // From https://stats.stackexchange.com/questions/58706/distance-metrics-for-binary-vectors
-        const double jaccard = (double)intersection / (double)(bp_count[id_a] + bp_count[id_b] - intersection);
-        const double cosine = (double)intersection / std::sqrt((double)(bp_count[id_a] * bp_count[id_b]));
-        const double dice = 2.0 * ((double) intersection / (double)(bp_count[id_a] + bp_count[id_b]));
-        const double estimated_identity = 2.0 * jaccard / (1.0 + jaccard);
-
-        std::cout << get_path_name(id_a) << "\t"
-                  << get_path_name(id_b) << "\t"
-                  << bp_count[id_a] << "\t"
-                  << bp_count[id_b] << "\t"
-                  << intersection << "\t";
-
-        if (emit_distances) {
-            const double euclidian_distance = std::sqrt((double)((bp_count[id_a] + bp_count[id_b] - intersection) - intersection));
-            const uint64_t manhattan_distance = (bp_count[id_a] + bp_count[id_b] - intersection) - intersection;
-            std::cout << (1.0 - jaccard) << "\t"
-                      << (1.0 - cosine) << "\t"
-                      << (1.0 - dice) << "\t"
-                      << (1.0 - estimated_identity) << "\t"
-                      << euclidian_distance << "\t"
-                      << manhattan_distance << std::endl;
-        } else {
-            std::cout << jaccard << "\t"
-                      << cosine << "\t"
-                      << dice << "\t"
-                      << estimated_identity << std::endl;
+    if (show_progress) {
+        progress_meter = std::make_unique<algorithms::progress_meter::ProgressMeter>(
+                group_count, "[odgi::similarity] computing path intersection lengths");
+    }
+    // each group gets its row of intersections in parallel, and the rows are written in order, a block at a time
+    const uint64_t block_size = 1024;
+    std::vector<std::string> lines(block_size);
+    for (uint64_t block = 0; block < group_count; block += block_size) {
+        const uint64_t block_end = std::min(group_count, block + block_size);
+#pragma omp parallel for schedule(dynamic, 1)
+        for (uint64_t a = block; a < block_end; ++a) {
+            std::vector<uint64_t> shared;
+            if (shared_on_gpu) {
+                shared.assign(gpu_shared.begin() + a * group_count, gpu_shared.begin() + (a + 1) * group_count);
+            } else {
+                intersections.intersections_of(a, shared);
+            }
+            // a group shares all of itself with itself
+            shared[a] = bp_count[a];
+            std::ostringstream out;
+            for (uint64_t b = 0; b < group_count; ++b) {
+                if (shared[b] > 0) {
+                    write_pair(out, get_path_name(a), get_path_name(b), bp_count[a], bp_count[b], shared[b]);
+                }
+            }
+            lines[a - block] = out.str();
+            if (show_progress) {
+                progress_meter->increment(1);
+            }
         }
+        for (uint64_t a = block; a < block_end; ++a) {
+            std::cout << lines[a - block];
+            std::string().swap(lines[a - block]);
+        }
+    }
+    std::cout.flush();
+
+    if (show_progress) {
+        progress_meter->finish();
     }
 
     return 0;
@@ -11,7 +11,9 @@
 #include "algorithms/random_order.hpp"
 #include "algorithms/xp.hpp"
 #include "algorithms/path_sgd.hpp"
+#include "algorithms/zipf_zetas.hpp"
 #include "algorithms/groom.hpp"
+#include "algorithms/windowed_sort.hpp"
 
 namespace odgi {
 
@@ -35,9 +37,11 @@ int main_sort(int argc, char** argv) {
     args::ValueFlag<std::string> dg_out_file(mandatory_opts, "FILE", "Write the sorted dynamic succinct variation graph to this file. A file"
                                                              " ending with *.og* is recommended.", {'o', "out"});
     args::Group files_io_opts(parser, "[ Files IO Options ]");
+    args::Flag compress(files_io_opts, "compress", "Deflate the node records of the sorted graph in blocks, compressed and loaded in"
+                                                 " parallel, for graphs read from storage slower than inflating them.", {"compress"});
     args::ValueFlag<std::string> xp_in_file(files_io_opts, "FILE", "Load the succinct variation graph index from this *FILE*. The file name usually ends with *.xp*.", {'X', "path-index"});
     args::ValueFlag<std::string> sort_order_in(files_io_opts, "FILE", "*FILE* containing the sort order. Each line contains one node identifer.", {'s', "sort-order"});
-    args::ValueFlag<std::string> tmp_base(files_io_opts, "PATH", "directory for temporary files", {'C', "temp-dir"});
+    args::ValueFlag<std::string> tmp_base(files_io_opts, "PATH", "directory for temporary files, or a comma-separated list of directories (e.g. on separate drives) to spread them over", {'C', "temp-dir"});
     args::Group topo_sorts_opts(parser, "[ Topological Sort Options ]");
     args::Flag breadth_first(topo_sorts_opts, "breadth_first", "Use a (chunked) breadth first topological sort.", {'b', "breadth-first"});
     args::ValueFlag<uint64_t> breadth_first_chunk(topo_sorts_opts, "N", "Chunk size for breadth first topological sort. Specify how many"
@@ -49,11 +53,18 @@ int main_sort(int argc, char** argv) {
     args::Flag two(topo_sorts_opts, "two", "Use a two-way topological algorithm for sorting. It is a maximum of"
                                            " head-first and tail-first topological sort.", {'w', "two-way"});
     args::Flag no_seeds(topo_sorts_opts, "no-seeds", "Don't use heads or tails to seed the topological sort.", {'n', "no-seeds"});
+    args::Flag parallel_topological(topo_sorts_opts, "parallel-topological", "Run the topological sorts, of the default sort, of *-n, --no-seeds* and of the"
+                                                                              " *s* and *n* pipeline steps, level by level with all threads given by *-t, --threads*."
+                                                                              " On graphs with cycles or inversions the order can differ from the serial sort.", {"parallel-topological"});
     // other sorts
     args::Group random_sort_opts(parser, "[ Random Sort Options ]");
     args::Flag randomize(random_sort_opts, "random", "Randomly sort the graph.", {'r', "random"});
     args::Group dagify_sort_opts(parser, "[ DAGify Sort Options ]");
     args::Flag dagify(dagify_sort_opts, "dagify", "Sort on the basis of a DAGified graph.", {'d', "dagify-sort"});
+    args::ValueFlag<uint64_t> dagify_max_copies(dagify_sort_opts, "N", "Copy each strongly connected component at most *N* times"
+                                                                       " when DAGifying (default: as often as needed).", {"dagify-max-copies"});
+    args::ValueFlag<uint64_t> dagify_max_nodes(dagify_sort_opts, "N", "Keep the DAGified graph within *N* nodes by copying the most repeated"
+                                                                      " strongly connected components fewer times (default: unbounded).", {"dagify-max-nodes"});
     /// path guided linear 1D SGD
     args::Group pg_sgd_opts(parser, "[ Path Guided 1D SGD Sort ]");
     args::Flag p_sgd(pg_sgd_opts, "path-sgd", "Apply the path-guided linear 1D SGD algorithm to organize graph.", {'Y', "path-sgd"});
@@ -85,14 +96,44 @@ int main_sort(int argc, char** argv) {
                                                                      " quantization occurs (default: *100*).", {'I', "path-sgd-zipf-space-max"});
     args::ValueFlag<uint64_t> p_sgd_zipf_space_quantization_step(pg_sgd_opts, "N", "Quantization step size when the maximum space size of the Zipfian"
                                                                                    " distribution is exceeded (default: *100*).", {'l', "path-sgd-zipf-space-quantization-step"});
+    args::ValueFlag<std::string> p_sgd_zipf_cache(pg_sgd_opts, "DIR", "Keep the tables of the Zipfian distributions in this directory, keyed by theta and"
+                                                                      " space parameters, and reuse them in later runs instead of recomputing them.", {"path-sgd-zipf-cache"});
     args::ValueFlag<uint64_t> p_sgd_zipf_max_number_of_distributions(pg_sgd_opts, "N", "Approximate maximum number of Zipfian distributions to calculate (default: *100*).", {'y', "path-sgd-zipf-max-num-distributions"});
-    args::ValueFlag<std::string> p_sgd_seed(pg_sgd_opts, "STRING", "| Set the seed for the deterministic 1-threaded path guided linear 1D SGD model (default: *pangenomic!*).", {'q', "path-sgd-seed"});
-    args::ValueFlag<std::string> p_sgd_snapshot(pg_sgd_opts, "STRING", "Set the prefix to which each snapshot graph of a path guided 1D SGD"
-                                                                       " iteration should be written to. This is turned off per default. This"
+    args::ValueFlag<std::string> p_sgd_seed(pg_sgd_opts, "STRING", "Run the path guided linear 1D SGD model deterministically with this seed: the result is the same for any number of threads (default: *pangenomic!*, non deterministic).", {'q', "path-sgd-seed"});
+    args::ValueFlag<std::string> p_sgd_snapshot(pg_sgd_opts, "STRING", "Set the prefix to which a snapshot of the node positions of each path guided 1D SGD"
+                                                                       " iteration should be written to, as one float32 per node. Render one with"
+                                                                       " *odgi viz --sgd-snapshot* on the graph given to the sort. This is turned off per default. This"
                                                                        " argument only works when *-Y, –path-sgd* was specified. Not applicable"
                                                                        " in a pipeline of sorts.", {'u', "path-sgd-snapshot"});
 	args::ValueFlag<std::string> _p_sgd_target_paths(pg_sgd_opts, "FILE", "Read the paths that should be considered as target paths (references) from this *FILE*. PG-SGD will keep the nodes of the given paths fixed. A path's rank determines it's weight for decision making and is given by its position in the given *FILE*.", {'H', "target-paths"});
+    args::ValueFlag<uint64_t> p_sgd_batch_terms(pg_sgd_opts, "N", "Draw the terms of the path guided linear 1D SGD in batches of N from windows of"
+                                                                  " N steps of a path, and apply each batch sorted by node rank. This cuts cache misses"
+                                                                  " on large graphs (default: *0*, draw each term from all paths).", {"path-sgd-batch-terms"});
+    args::ValueFlag<double> p_sgd_flat_index_mem(pg_sgd_opts, "N", "Read the path steps in the PG-SGD from a flat, uncompressed copy of the path index if it takes at most N GB"
+                                                                   " of RAM. Each lookup is then one load instead of decoding the compact index (default: *0*, always use the compact index).", {"path-sgd-flat-index-mem"});
+    args::ValueFlag<std::string> p_sgd_stress_log(pg_sgd_opts, "FILE", "Write the iteration, learning rate, maximum displacement and the stress of a fixed sample"
+                                                                       " of terms after each iteration of the path guided linear 1D SGD to this FILE, as TSV.", {"path-sgd-stress-log"});
+    args::ValueFlag<double> p_sgd_stress_plateau(pg_sgd_opts, "N", "Stop the path guided linear 1D SGD early when the sampled stress improved by less than"
+                                                                   " this fraction for 3 iterations in a row, e.g. 0.001 (default: *0*, run all iterations).", {"path-sgd-stress-plateau"});
+    args::ValueFlag<std::string> p_sgd_warm_start_paths(pg_sgd_opts, "FILE", "Warm start the path guided linear 1D SGD from the current order, e.g. after injecting"
+                                                                             " or re-aligning a few paths: only the nodes of the paths listed in this FILE, and those up to"
+                                                                             " *--path-sgd-warm-start-radius* edges away, are sampled and moved, with a low learning rate.", {"path-sgd-warm-start-paths"});
+    args::ValueFlag<uint64_t> p_sgd_warm_start_radius(pg_sgd_opts, "N", "Also re-sort the nodes up to N edges away from the nodes of the warm start paths (default: *32*).", {"path-sgd-warm-start-radius"});
+    args::ValueFlag<std::string> p_sgd_window_path(pg_sgd_opts, "STRING", "Cut the graph into overlapping windows along this reference path, sort each window"
+                                                                          " with the path guided linear 1D SGD in parallel, one thread per window, and stitch"
+                                                                          " the orders at the middle of the overlaps. Nodes off the path are sorted with the"
+                                                                          " closest path node. Meant for graphs with a linear backbone, e.g. a chromosome.", {"path-sgd-window-path"});
+    args::ValueFlag<uint64_t> p_sgd_window_size(pg_sgd_opts, "N", "Length in bp of the windows along the reference path (default: *1000000*).", {"path-sgd-window-size"});
+    args::ValueFlag<uint64_t> p_sgd_window_overlap(pg_sgd_opts, "N", "Overlap in bp of consecutive windows (default: *100000*).", {"path-sgd-window-overlap"});
+    args::ValueFlag<uint64_t> p_sgd_window_context(pg_sgd_opts, "N", "Sort nodes up to N edges away from the reference path with their closest path node,"
+                                                                     " the others go at the end of the order (default: *1000*).", {"path-sgd-window-context"});
 	args::ValueFlag<std::string> p_sgd_layout(pg_sgd_opts, "STRING", "write the layout of a sorted, path guided 1D SGD graph to this file, no default", {'e', "path-sgd-layout"});
+    args::ValueFlag<std::string> p_sgd_checkpoint(pg_sgd_opts, "FILE", "Save the node positions, the iteration and the generator states of the path guided"
+                                                                       " linear 1D SGD to this FILE between iterations, so that an interrupted sort can be"
+                                                                       " picked up with *--resume*. The FILE is removed once the SGD completed.", {"checkpoint"});
+    args::ValueFlag<uint64_t> p_sgd_checkpoint_interval(pg_sgd_opts, "N", "Save a checkpoint at most every N seconds (default: *600*).", {"checkpoint-interval"});
+    args::Flag p_sgd_resume(pg_sgd_opts, "resume", "Resume the path guided linear 1D SGD from the *--checkpoint* FILE, if it exists. Give the same"
+                                                   " input and parameters as for the interrupted run.", {"resume"});
 
 	/// pipeline
     args::Group pipeline_sort_opts(parser, "[ Pipeline Sorting Options ]");
@@ -109,8 +150,17 @@ int main_sort(int argc, char** argv) {
     args::Group optimize_opts(parser, "[ Optimize Options ]");
     args::Flag optimize(optimize_opts, "optimize", "Use the MutableHandleGraph::optimize method to compact the node"
                                                    " identifier space.", {'O', "optimize"});
+    args::ValueFlag<uint64_t> p_sgd_sync_interval(pg_sgd_opts, "N", "When run with mpirun on a build with MPI, average the positions of the nodes"
+                                                                  " shared by the paths of several ranks every N iterations (default: *1*).", {"sync-interval"});
     args::Group threading_opts(parser, "[ Threading ]");
     args::ValueFlag<uint64_t> nthreads(threading_opts, "N", "Number of threads to use for parallel operations.", {'t', "threads"});
+    args::Flag numa_pin_threads(threading_opts, "numa-pin-threads", "Pin each PG-SGD worker thread to its own CPU, in the order of the CPUs the process may"
+                                                                    " run on. With more than one thread, the node positions and the path index are spread"
+                                                                    " over the NUMA nodes anyway.", {"numa-pin-threads"});
+#ifdef USE_GPU
+    args::Group gpu_opts(parser, "[ GPU ]");
+    args::Flag gpu_compute(gpu_opts, "gpu", "Run the path guided linear 1D SGD on the GPU.", {"gpu"});
+#endif
     args::Group processing_info_opts(parser, "[ Processing Information ]");
     args::Flag progress(processing_info_opts, "progress", "Write the current progress to stderr.", {'P', "progress"});
     args::Group program_info_opts(parser, "[ Program Information ]");
@@ -149,6 +199,43 @@ int main_sort(int argc, char** argv) {
     }
 
 	const uint64_t num_threads = args::get(nthreads) ? args::get(nthreads) : 1;
+	algorithms::numa::set_pin_threads(args::get(numa_pin_threads));
+	const uint64_t path_sgd_batch_terms = p_sgd_batch_terms ? args::get(p_sgd_batch_terms) : 0;
+	const std::string path_sgd_stress_log = p_sgd_stress_log ? args::get(p_sgd_stress_log) : "";
+	const double path_sgd_stress_plateau = p_sgd_stress_plateau ? args::get(p_sgd_stress_plateau) : 0;
+	const uint64_t path_sgd_flat_index_max_bytes = p_sgd_flat_index_mem ? (uint64_t)(args::get(p_sgd_flat_index_mem) * 1024 * 1024 * 1024) : 0;
+	algorithms::sgd_checkpoint_config_t path_sgd_checkpoint;
+	if (p_sgd_checkpoint) {
+		path_sgd_checkpoint.filename = args::get(p_sgd_checkpoint);
+		path_sgd_checkpoint.interval_seconds = p_sgd_checkpoint_interval ? args::get(p_sgd_checkpoint_interval) : 600;
+		path_sgd_checkpoint.resume = args::get(p_sgd_resume);
+	} else if (p_sgd_resume || p_sgd_checkpoint_interval) {
+		std::cerr << "[odgi::sort] error: --resume and --checkpoint-interval need a --checkpoint FILE." << std::endl;
+		return 1;
+	}
+	if (p_sgd_checkpoint && (p_sgd_window_path
+							 || std::count(args::get(pipeline).begin(), args::get(pipeline).end(), 'Y') > 1)) {
+		std::cerr << "[odgi::sort] error: --checkpoint applies to a single path guided SGD, not to windowed sorts"
+				  << " or to pipelines with more than one *Y* step." << std::endl;
+		return 1;
+	}
+#ifdef USE_GPU
+	const bool gpu = args::get(gpu_compute);
+#else
+	const bool gpu = false;
+#endif
+	if (p_sgd_sync_interval) {
+		if (args::get(p_sgd_sync_interval) == 0) {
+			std::cerr << "[odgi::sort] error: --sync-interval must be at least 1." << std::endl;
+			return 1;
+		}
+		algorithms::distributed::set_sync_interval(args::get(p_sgd_sync_interval));
+	}
+	if (algorithms::distributed::active() && (p_sgd_snapshot || p_sgd_checkpoint || gpu)) {
+		std::cerr << "[odgi::sort] error: --path-sgd-snapshot, --checkpoint and --gpu can not be used in an MPI run"
+				  << " with more than one rank." << std::endl;
+		return 1;
+	}
 
 	graph_t graph;
     assert(argc > 0);
@@ -167,6 +254,13 @@ int main_sort(int argc, char** argv) {
 
     graph.set_number_of_threads(num_threads);
 
+    auto topological_sort_order = [&](bool use_heads) {
+        if (args::get(parallel_topological)) {
+            return algorithms::parallel_topological_order(&graph, num_threads, use_heads, false, args::get(progress));
+        }
+        return algorithms::topological_order(&graph, use_heads, false, args::get(progress));
+    };
+
     /// path guided linear 1D SGD sort helpers
     // TODO beautify this, maybe put into its own file
     std::function<uint64_t(const std::vector<path_handle_t> &,
@@ -199,15 +293,18 @@ int main_sort(int argc, char** argv) {
 
     // default parameters
     std::string path_sgd_seed;
+    const bool path_sgd_deterministic = static_cast<bool>(p_sgd_seed);
     if (p_sgd_seed) {
-        if (num_threads > 1) {
-            std::cerr << "[odgi::sort] error: please only specify a seed for the path guided 1D linear SGD when using 1 thread." << std::endl;
-            return 1;
-        }
         path_sgd_seed = args::get(p_sgd_seed);
     } else {
         path_sgd_seed = "pangenomic!";
     }
+    const uint64_t path_sgd_window_size = p_sgd_window_size ? args::get(p_sgd_window_size) : 1000000;
+    const uint64_t path_sgd_window_overlap = p_sgd_window_overlap ? args::get(p_sgd_window_overlap) : 100000;
+    if (p_sgd_window_path && path_sgd_window_overlap >= path_sgd_window_size) {
+        std::cerr << "[odgi::sort] error: the window overlap given by --path-sgd-window-overlap must be smaller than the window size." << std::endl;
+        return 1;
+    }
     if (p_sgd_min_term_updates_paths && p_sgd_min_term_updates_num_nodes) {
         std::cerr << "[odgi::sort] error: there can only be one argument provided for the minimum number of term updates in the path guided 1D SGD."
                      "Please either use -G=[N], path-sgd-min-term-updates-paths=[N] or -U=[N], path-sgd-min-term-updates-nodes=[N]." << std::endl;
@@ -221,6 +318,9 @@ int main_sort(int argc, char** argv) {
         getcwd(cwd, sizeof(cwd));
         xp::temp_file::set_dir(std::string(cwd));
     }
+    if (p_sgd_zipf_cache) {
+        algorithms::zipf_zetas_cache::set_dir(args::get(p_sgd_zipf_cache));
+    }
 
     // If required, first of all, optimize the graph so that it is optimized for subsequent algorithms (if required)
     if (args::get(optimize)) {
@@ -331,21 +431,27 @@ int main_sort(int argc, char** argv) {
     }
 	std::vector<bool> is_ref;
 	std::vector<path_handle_t> target_paths;
+	// the nodes of the warm start paths and their neighborhood, for the current node ids
+	std::vector<path_handle_t> warm_start_paths;
+	const uint64_t warm_start_radius = p_sgd_warm_start_radius ? args::get(p_sgd_warm_start_radius) : 32;
+	auto get_warm_start_nodes = [&](void) {
+		if (warm_start_paths.empty()) {
+			return std::vector<bool>();
+		}
+		std::vector<bool> changed(graph.get_node_count(), false);
+		for (auto &path : warm_start_paths) {
+			graph.for_each_step_in_path(path, [&](const step_handle_t &step) {
+				changed[graph.get_id(graph.get_handle_of_step(step)) - 1] = true;
+			});
+		}
+		return algorithms::path_linear_sgd_warm_start_nodes(graph, changed, warm_start_radius);
+	};
+	std::vector<bool> warm_start_nodes;
     if (p_sgd || args::get(pipeline).find('Y') != std::string::npos) {
 		if (_p_sgd_target_paths) {
 			target_paths = load_paths(args::get(_p_sgd_target_paths));
 			sort_graph_by_target_paths(graph, target_paths, is_ref);
 		}
-        // take care of path index
-        if (xp_in_file) {
-            std::ifstream in;
-            in.open(args::get(xp_in_file));
-            path_index.load(in);
-            in.close();
-        } else {
-            path_index.from_handle_graph(graph, num_threads);
-        }
-        fresh_path_index = true;
         // do we only want so sample from a subset of paths?
         if (p_sgd_in_file) {
             std::string buf;
@@ -367,7 +473,37 @@ int main_sort(int argc, char** argv) {
                     path_sgd_use_paths.push_back(path);
                 });
         }
+        // take care of path index, which only needs the paths we sample from
+        if (xp_in_file) {
+            std::ifstream in;
+            in.open(args::get(xp_in_file));
+            path_index.load(in);
+            in.close();
+            for (auto &path : path_sgd_use_paths) {
+                if (path_index.get_path_step_count(path) != graph.get_step_count(path)) {
+                    std::cerr << "[odgi::sort] error: the path index given by -X=[FILE], --path-index=[FILE] does not"
+                                 " index the steps of path '" << graph.get_path_name(path) << "'." << std::endl;
+                    return 1;
+                }
+            }
+        } else if (p_sgd_in_file) {
+            path_index.from_handle_graph(graph, path_sgd_use_paths, num_threads);
+        } else {
+            path_index.from_handle_graph(graph, num_threads);
+        }
+        fresh_path_index = true;
         uint64_t sum_path_step_count = get_sum_path_step_count(path_sgd_use_paths, path_index);
+        if (p_sgd_warm_start_paths) {
+            warm_start_paths = load_paths(args::get(p_sgd_warm_start_paths));
+            warm_start_nodes = get_warm_start_nodes();
+            // the term updates scale with the steps to re-sort, not with all steps
+            sum_path_step_count = 0;
+            graph.for_each_handle([&](const handle_t &h) {
+                if (warm_start_nodes[graph.get_id(h) - 1]) {
+                    sum_path_step_count += graph.get_step_count(h);
+                }
+            });
+        }
         if (args::get(p_sgd_min_term_updates_paths)) {
             path_sgd_min_term_updates = args::get(p_sgd_min_term_updates_paths) * sum_path_step_count;
         } else {
@@ -406,23 +542,45 @@ int main_sort(int argc, char** argv) {
         }
 
         path_sgd_max_eta = args::get(p_sgd_eta_max) ? args::get(p_sgd_eta_max) : max_path_step_count * max_path_step_count;
+        if (p_sgd_warm_start_paths && !args::get(p_sgd_eta_max)) {
+            // nodes only have to move within their neighborhood
+            path_sgd_max_eta = std::max((uint64_t) 1, warm_start_radius * warm_start_radius);
+        }
     }
 
     // is it a pipeline of sorts?
     if (!args::get(pipeline).empty()) {
-        // for each sort type, apply it to the graph
+        // each sort gives an order of the handles of the graph as it was last rewritten; that order stays
+        // pending, and the graph is only rewritten once a sort has to walk it in it, and at the end
         std::vector<handle_t> order;
+        auto apply_pending_order = [&](void) {
+            if (!order.empty()) {
+                graph.apply_ordering(order, true);
+                order.clear();
+                fresh_path_index = false;
+            }
+        };
         for (auto c : args::get(pipeline)) {
+            switch (c) {
+                case 'f':
+                case 'r':
+                case 'Y':
+                    break;
+                default:
+                    apply_pending_order();
+                    break;
+            }
             switch (c) {
                 case 's':
-                    order = algorithms::topological_order(&graph, true, false, args::get(progress));
+                    order = topological_sort_order(true);
                     break;
                 case 'n':
-                    order = algorithms::topological_order(&graph, false, false, args::get(progress));
+                    order = topological_sort_order(false);
                     break;
                 case 'd': {
                     graph_t split, into;
-                    order = algorithms::dagify_sort(graph, split, into);
+                    order = algorithms::dagify_sort(graph, split, into, num_threads,
+                                                    args::get(dagify_max_copies), args::get(dagify_max_nodes));
                 }
                     break;
                 case 'c':
@@ -438,16 +596,27 @@ int main_sort(int argc, char** argv) {
                     order = algorithms::two_way_topological_order(&graph);
                     break;
                 case 'r':
-                    order = algorithms::random_order(graph);
+                    order = algorithms::random_order(graph, num_threads);
                     break;
                 case 'Y': {
+					// the layout can start from the pending order on the path index of the unchanged graph,
+					// unless the order flips nodes or the target paths have to be moved to the front first
+					if (_p_sgd_target_paths
+						|| std::any_of(order.begin(), order.end(), [&](const handle_t &h) { return graph.get_is_reverse(h); })) {
+						apply_pending_order();
+					}
 					if (!fresh_path_index) {
 						if (_p_sgd_target_paths) {
 							is_ref = std::vector<bool>();
 							sort_graph_by_target_paths(graph, target_paths, is_ref);
 						}
 						path_index.clean();
-						path_index.from_handle_graph(graph, num_threads);
+						if (p_sgd_in_file) {
+							path_index.from_handle_graph(graph, path_sgd_use_paths, num_threads);
+						} else {
+							path_index.from_handle_graph(graph, num_threads);
+						}
+						warm_start_nodes = get_warm_start_nodes();
 					}
                     order = algorithms::path_linear_sgd_order(graph,
                                                               path_index,
@@ -471,33 +640,42 @@ int main_sort(int argc, char** argv) {
 															  p_sgd_layout,
 															  layout_out,
 															  _p_sgd_target_paths,
-															  is_ref);
+															  is_ref,
+															  gpu,
+															  path_sgd_batch_terms,
+															  path_sgd_flat_index_max_bytes,
+															  path_sgd_deterministic,
+															  path_sgd_stress_log,
+															  path_sgd_stress_plateau,
+															  warm_start_nodes,
+															  order,
+															  path_sgd_checkpoint);
 					// reset is_ref or we will break when we apply it again
                     break;
                 }
                 case 'f':
-                    order.clear();
-                    graph.for_each_handle([&order](const handle_t &handle) {
-                        order.push_back(handle);
-                    });
+                    if (order.empty()) {
+                        graph.for_each_handle([&order](const handle_t &handle) {
+                            order.push_back(handle);
+                        });
+                    }
                     std::reverse(order.begin(), order.end());
                     break;
                 case 'g': {
-                    order = algorithms::groom(graph, progress, target_paths);
+                    order = algorithms::groom(graph, progress, target_paths, true, num_threads);
                     break;
                 }
                 default:
                     break;
             }
-            if (order.size() != graph.get_node_count()) {
+            if (!order.empty() && order.size() != graph.get_node_count()) {
                 std::cerr << "[odgi::sort] error: expected " << graph.get_node_count()
                           << " handles in the order "
                           << "but got " << order.size() << std::endl;
                 assert(false);
             }
-            graph.apply_ordering(order, true);
-            fresh_path_index = false;
         }
+        apply_pending_order();
     } else if (args::get(two)) {
         graph.apply_ordering(algorithms::two_way_topological_order(&graph), true);
     } else if (!args::get(sort_order_in).empty()) {
@@ -510,11 +688,84 @@ int main_sort(int argc, char** argv) {
         graph.apply_ordering(given_order, true);
     } else if (args::get(dagify)) {
         graph_t split, into;
-        graph.apply_ordering(algorithms::dagify_sort(graph, split, into), true);
+        graph.apply_ordering(algorithms::dagify_sort(graph, split, into, num_threads,
+                                                             args::get(dagify_max_copies), args::get(dagify_max_nodes)), true);
     } else if (args::get(cycle_breaking)) {
         graph.apply_ordering(algorithms::cycle_breaking_sort(graph), true);
     } else if (args::get(no_seeds)) {
-        graph.apply_ordering(algorithms::topological_order(&graph, false, false, args::get(progress)), true);
+        graph.apply_ordering(topological_sort_order(false), true);
+    } else if (args::get(p_sgd) && p_sgd_window_path) {
+        if (!graph.has_path(args::get(p_sgd_window_path))) {
+            std::cerr << "[odgi::sort] error: the reference path '" << args::get(p_sgd_window_path)
+                      << "' given by --path-sgd-window-path is not present in the graph." << std::endl;
+            return 1;
+        }
+        // each window gets the default parameters of its own paths, unless they were given
+        auto sort_window = [&](graph_t &window) {
+            xp::XP window_index;
+            // the path index builds on shared temporary files
+#pragma omp critical (window_path_index)
+            window_index.from_handle_graph(window, 1);
+            std::vector<path_handle_t> window_paths;
+            window.for_each_path_handle([&](const path_handle_t &path) {
+                window_paths.push_back(path);
+            });
+            const uint64_t sum_path_step_count = get_sum_path_step_count(window_paths, window_index);
+            const uint64_t max_path_step_count = get_max_path_step_count(window_paths, window_index);
+            uint64_t min_term_updates = sum_path_step_count;
+            if (args::get(p_sgd_min_term_updates_paths)) {
+                min_term_updates = args::get(p_sgd_min_term_updates_paths) * sum_path_step_count;
+            } else if (args::get(p_sgd_min_term_updates_num_nodes)) {
+                min_term_updates = args::get(p_sgd_min_term_updates_num_nodes) * window.get_node_count();
+            }
+            const uint64_t zipf_space = args::get(p_sgd_zipf_space) ? args::get(p_sgd_zipf_space) : std::max((uint64_t) 1, get_max_path_length(window_paths, window_index));
+            uint64_t zipf_space_quantization_step = 100;
+            if (args::get(p_sgd_zipf_space_quantization_step)) {
+                zipf_space_quantization_step = std::max((uint64_t) 2, args::get(p_sgd_zipf_space_quantization_step));
+            } else if (zipf_space > path_sgd_zipf_space_max && path_sgd_zipf_max_number_of_distributions > path_sgd_zipf_space_max) {
+                zipf_space_quantization_step = std::max(
+                        (uint64_t) 2,
+                        (uint64_t) ceil( (double) (zipf_space - path_sgd_zipf_space_max) / (double) (path_sgd_zipf_max_number_of_distributions - path_sgd_zipf_space_max))
+                );
+            }
+            const double max_eta = args::get(p_sgd_eta_max) ? args::get(p_sgd_eta_max) : max_path_step_count * max_path_step_count;
+            std::vector<bool> no_targets;
+            return algorithms::path_linear_sgd_order(window,
+                                                     window_index,
+                                                     window_paths,
+                                                     path_sgd_iter_max,
+                                                     path_sgd_iter_max_learning_rate,
+                                                     min_term_updates,
+                                                     path_sgd_delta,
+                                                     path_sgd_eps,
+                                                     max_eta,
+                                                     path_sgd_zipf_theta,
+                                                     zipf_space,
+                                                     path_sgd_zipf_space_max,
+                                                     zipf_space_quantization_step,
+                                                     path_sgd_cooling,
+                                                     1,
+                                                     false,
+                                                     path_sgd_seed,
+                                                     false,
+                                                     "",
+                                                     false,
+                                                     "",
+                                                     false,
+                                                     no_targets,
+                                                     false,
+                                                     path_sgd_batch_terms,
+                                                     path_sgd_flat_index_max_bytes,
+                                                     path_sgd_deterministic);
+        };
+        graph.apply_ordering(algorithms::windowed_order(graph,
+                                                        graph.get_path_handle(args::get(p_sgd_window_path)),
+                                                        path_sgd_window_size,
+                                                        path_sgd_window_overlap,
+                                                        p_sgd_window_context ? args::get(p_sgd_window_context) : 1000,
+                                                        num_threads,
+                                                        sort_window,
+                                                        progress), true);
     } else if (args::get(p_sgd)) {
         std::vector<handle_t> order =
                 algorithms::path_linear_sgd_order(graph,
@@ -539,37 +790,51 @@ int main_sort(int argc, char** argv) {
 												  p_sgd_layout,
 												  layout_out,
 												  _p_sgd_target_paths,
-												  is_ref);
+												  is_ref,
+												  gpu,
+												  path_sgd_batch_terms,
+												  path_sgd_flat_index_max_bytes,
+												  path_sgd_deterministic,
+												  path_sgd_stress_log,
+												  path_sgd_stress_plateau,
+												  warm_start_nodes,
+												  {},
+												  path_sgd_checkpoint);
         graph.apply_ordering(order, true);
     } else if (args::get(breadth_first)) {
         graph.apply_ordering(algorithms::breadth_first_topological_order(graph, bf_chunk_size), true);
     } else if (args::get(depth_first)) {
         graph.apply_ordering(algorithms::depth_first_topological_order(graph, df_chunk_size), true);
     } else if (args::get(randomize)) {
-        graph.apply_ordering(algorithms::random_order(graph), true);
+        graph.apply_ordering(algorithms::random_order(graph, num_threads), true);
     } else {
         // To be able to only optimize the graph, avoiding the topological sorting if nothing else is requested
         if (!args::get(optimize)) {
-            graph.apply_ordering(algorithms::topological_order(&graph, true, false, args::get(progress)), true);
+            graph.apply_ordering(topological_sort_order(true), true);
         }
     }
     if (args::get(paths_by_min_node_id)) {
         graph.apply_path_ordering(
-                algorithms::prefix_and_id_ordered_paths(graph, args::get(path_delim), false, false));
+                algorithms::prefix_and_id_ordered_paths(graph, args::get(path_delim), false, false, num_threads));
     }
     if (args::get(paths_by_max_node_id)) {
         graph.apply_path_ordering(
-                algorithms::prefix_and_id_ordered_paths(graph, args::get(path_delim), false, true));
+                algorithms::prefix_and_id_ordered_paths(graph, args::get(path_delim), false, true, num_threads));
     }
     if (args::get(paths_by_avg_node_id)) {
         graph.apply_path_ordering(
-                algorithms::prefix_and_id_ordered_paths(graph, args::get(path_delim), true, false));
+                algorithms::prefix_and_id_ordered_paths(graph, args::get(path_delim), true, false, num_threads));
     }
     if (args::get(paths_by_avg_node_id_rev)) {
         graph.apply_path_ordering(
-                algorithms::prefix_and_id_ordered_paths(graph, args::get(path_delim), true, true));
+                algorithms::prefix_and_id_ordered_paths(graph, args::get(path_delim), true, true, num_threads));
+    }
+    if (!algorithms::distributed::is_root()) {
+        // the ranks of an MPI run end up with the same graph, one writes it
+        return 0;
     }
     const std::string outfile = args::get(dg_out_file);
+    graph.set_compressed_serialization(args::get(compress));
     if (outfile == "-") {
         graph.serialize(std::cout);
     } else {
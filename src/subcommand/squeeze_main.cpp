@@ -37,6 +37,10 @@ namespace odgi {
                                           "Add the separator and the input file rank as suffix to the path names\n"
                                           "  (to avoid path name collisions).",
                                           {'s', "rank-suffix"});
+        args::Flag _stream(squeeze_opt, "stream",
+                           "Write the input graphs straight into the output, one at a time, without building the squeezed graph\n"
+                           "  in memory. The input graphs must be in ODGI format.",
+                           {"stream"});
         args::Flag _optimize(parser, "optimize", "Compact the node ID space for each connected component before squeezing.",
                              {'O', "optimize"});
         args::Group threading_opts(parser, "[ Threading ]");
@@ -120,6 +124,60 @@ namespace odgi {
         }
 
 
+        if (args::get(_stream)) {
+            if (optimize) {
+                std::cerr << "[odgi::squeeze] error: please optimize the input graphs beforehand, -O, --optimize can not be used with --stream."
+                          << std::endl;
+                return 1;
+            }
+            // the node and path offsets of each graph follow from the headers of the graphs before it
+            std::vector<std::string> graph_files;
+            std::vector<graph_header_t> headers;
+            std::ifstream file_input_graphs(input_graphs);
+            std::string line;
+            while (std::getline(file_input_graphs, line)) {
+                if (!line.empty()) {
+                    std::ifstream f(line.c_str());
+                    graph_header_t header;
+                    if (!graph_t::read_header(f, header)) {
+                        std::cerr << "[odgi::squeeze] error: the input graph \"" << line
+                                  << "\" is not in ODGI format, which --stream requires." << std::endl;
+                        return 1;
+                    }
+                    if (header.id_increment) {
+                        std::cerr << "[odgi::squeeze] error: the node ids of the input graph \"" << line
+                                  << "\" are incremented, please optimize it before squeezing it with --stream." << std::endl;
+                        return 1;
+                    }
+                    graph_files.push_back(line);
+                    headers.push_back(header);
+                }
+            }
+            file_input_graphs.close();
+
+            const std::string outfile = args::get(dg_out_file);
+            std::ofstream f;
+            if (outfile != "-") {
+                f.open(outfile.c_str());
+            }
+            graph_stream_writer_t writer(outfile == "-" ? std::cout : f, headers, num_threads);
+            for (uint64_t input_graph_rank = 0; input_graph_rank < graph_files.size(); ++input_graph_rank) {
+                graph_t graph;
+                utils::handle_gfa_odgi_input(graph_files[input_graph_rank], "squeeze", args::get(progress), num_threads, graph);
+                writer.append(graph, [&](const std::string &path_name) {
+                    return _add_suffix ? path_name + separator + std::to_string(input_graph_rank) : path_name;
+                });
+                if (debug) {
+                    squeeze_progress->increment(1);
+                }
+            }
+            writer.finish();
+            if (debug) {
+                squeeze_progress->finish();
+            }
+            return 0;
+        }
+
         uint64_t shift_id = 0;
         graph_t squeezed_graph;
 
@@ -6,6 +6,9 @@
 #include <omp.h>
 #include "algorithms/layout.hpp"
 #include "algorithms/weakly_connected_components.hpp"
+#include "algorithms/path_tasks.hpp"
+#include "algorithms/node_rank.hpp"
+#include "algorithms/depth.hpp"
 #include "cover.hpp"
 #include "utils.hpp"
 #include <filesystem>
@@ -17,6 +20,29 @@ namespace odgi {
 
 using namespace odgi::subcommand;
 
+/// What the path-guided metrics accumulate over the links and steps of one path, in a single walk along it
+struct path_metrics_t {
+    // mean links length
+    uint64_t links_node_space = 0;
+    uint64_t links_nt_space = 0;
+    double links_2D_space = 0.0;
+    uint64_t num_links = 0;
+    uint64_t num_gap_links = 0;
+    // sum of path node distances
+    uint64_t dist_node_space = 0;
+    uint64_t dist_nt_space = 0;
+    double dist_2D_space = 0.0;
+    uint64_t len_node_space = 0;
+    uint64_t len_nt_space = 0;
+    uint64_t num_penalties = 0;
+    uint64_t num_penalties_diff_orientation = 0;
+    // weighted feedback arcs and reversing joins
+    uint64_t feedback_arcs = 0;
+    uint64_t reversing_joins = 0;
+    // links length per nucleotide, whose nucleotides are len_nt_space
+    uint64_t links_length = 0;
+};
+
 int main_stats(int argc, char** argv) {
 
     // trick argumentparser to do the right thing with the subcommand
@@ -47,6 +73,8 @@ int main_stats(int argc, char** argv) {
     //args::ValueFlag<std::string> path_bedmulticov(parser, "BED", "for each BED entry, provide a table of path coverage over unique multisets of paths in the graph. Each unique multiset of paths overlapping a given BED interval is described in terms of its length relative to the total interval, the number of path traversals, and unique paths involved in these traversals.", {'B', "bed-multicov"});
     args::ValueFlag<std::string> path_delim(summary_opts, "STRING", "The part of each path name before this delimiter is a group identifier, which when specified will ensure that odgi stats collects the summary information per group and not per path.", {'D', "delim"});
 	args::Flag _file_size(summary_opts, "file-size", "Show the file size in bytes.", {'f', "file-size"});
+	args::Flag _memory(summary_opts, "memory", "Show where the bytes of the graph go, in memory and serialized: in the node records, sequences, edges, path steps, path metadata and hash tables, "
+											  "and for the sequences, edges and steps of the nodes by bucket of node degree and of path depth, each bucket holding the counts from a power of two up to the next one.", {"memory"});
 	args::ValueFlag<std::string> _pangenome_sequence_class_counts(summary_opts, "DELIM,POS", "Show counted pangenome sequence class counts of all samples. "
                                                                                              "Classes are Private (only one sample visiting the node), Core (all samples visiting the node), and Shell (not Core or Private). "
                                                                                              "The given String determines how to find the sample name in the path names: DELIM,POS. "
@@ -72,7 +100,10 @@ int main_stats(int argc, char** argv) {
 	
     args::Flag weighted_feedback_arc(sorting_goodness_evaluation_opts, "weighted_feedback_arc", "Compute the sum of weights of all feedback arcs, i.e. backward pointing edges the statistics (the weight is the number of times the edge is traversed by paths).", {'w', "weighted-feedback-arc"});
 	args::Flag weighted_reversing_join(sorting_goodness_evaluation_opts, "weighted_reversing_join", "Compute the sum of weights of all reversing joins, i.e. edges joining two in- or two out-sides (the weight is the number of times the edge is traversed by paths).", {'j', "weighted-reversing-join"});
+	args::ValueFlag<std::string> edge_depth_index_file(sorting_goodness_evaluation_opts, "FILE", "Weigh the edges for *-w,--weighted-feedback-arc* and *-j,--weighted-reversing-join* by the path depth in the edge depth index in *FILE*, written via *odgi depth --write-edge-depth-index*, instead of counting it from the paths. Not applicable to *-p,--path-statistics*, whose sums per path need a walk along the paths.", {"edge-depth-index"});
 	args::Flag links_length_per_nuc(sorting_goodness_evaluation_opts, "links_length_per_nuc", "Compute the links length per nucleotide, i.e. sum up the links lengths of all paths and divide this value by the nucleotide lengths of all paths. This metric can be used to compare the linearity of different graphs. By default we don't count gap links.", {'q', "links_length_per_nuc"});
+	args::Flag approx(sorting_goodness_evaluation_opts, "approx", "Estimate the mean links length and the sum of path nodes distances of all paths from runs of steps that start at random steps, covering about 1% of the steps, instead of walking all paths. The estimates come with the half width of their 95% confidence interval. Not applicable to *-p,--path-statistics*, *-g,--no-gap-links*, *-w,--weighted-feedback-arc*, *-j,--weighted-reversing-join* and *-q,--links_length_per_nuc*.", {"approx"});
+	args::ValueFlag<double> sample_rate(sorting_goodness_evaluation_opts, "FRACTION", "Cover about this FRACTION of the steps with the runs of *--approx*, which it implies [default: 0.01].", {"sample-rate"});
 
     args::Group io_format_opts(parser, "[ IO Format Options ]");
     args::Flag _multiqc(io_format_opts, "multiqc", "Setting this option prints all! statistics in YAML format instead of pseudo TSV to stdout. This includes *-S,--summarize*, *-W,--weak-connected-components*, *-L,--self-loops*, *-b,--base-content*, *-l,--mean-links-length*, *-g,--no-gap-links*, *-s,--sum-path-nodes-distances*, *-f,--file-size*, and *-d,--penalize-different-orientation*. *-p,path-statistics* is still optional. Not applicable to *-N,--nondeterministic-edges*. Overwrites all other given OPTIONs! The output is perfectly curated for the ODGI MultiQC module.", {'m', "multiqc"});
@@ -141,6 +172,37 @@ int main_stats(int argc, char** argv) {
         }
     }
 
+	const bool sampled = approx || sample_rate;
+	const double rate = sample_rate ? args::get(sample_rate) : 0.01;
+	if (sampled) {
+		if (rate <= 0 || rate > 1) {
+			std::cerr << "[odgi::stats] error: the sample rate must be greater than 0 and at most 1." << std::endl;
+			return 1;
+		}
+		if (!args::get(mean_links_length) && !args::get(sum_of_path_node_distances)) {
+			std::cerr << "[odgi::stats] error: please specify the -l/--mean-links-length and/or the -s/--sum-path-nodes-distances options to use the --approx/--sample-rate options." << std::endl;
+			return 1;
+		}
+		if (args::get(path_statistics) || args::get(dont_penalize_gap_links) || args::get(weighted_feedback_arc)
+			|| args::get(weighted_reversing_join) || args::get(links_length_per_nuc)) {
+			// gap links need the nodes of whole paths, and the other metrics are per path or not ratios
+			std::cerr << "[odgi::stats] error: the --approx/--sample-rate options can not be used together with the -p/--path-statistics, -g/--no-gap-links, "
+						 "-w/--weighted-feedback-arc, -j/--weighted-reversing-join or -q/--links_length_per_nuc options." << std::endl;
+			return 1;
+		}
+	}
+
+	if (edge_depth_index_file) {
+		if (!args::get(weighted_feedback_arc) && !args::get(weighted_reversing_join)) {
+			std::cerr << "[odgi::stats] error: please specify the -w/--weighted-feedback-arc and/or the -j/--weighted-reversing-join options to use the --edge-depth-index option." << std::endl;
+			return 1;
+		}
+		if (args::get(path_statistics)) {
+			std::cerr << "[odgi::stats] error: the --edge-depth-index option can not be used together with the -p/--path-statistics option." << std::endl;
+			return 1;
+		}
+	}
+
 	const std::string pangenome_sequence_class_counts = args::get(_pangenome_sequence_class_counts);
 	std::vector<string> delim_pos = split(pangenome_sequence_class_counts, ',');
     if (_pangenome_sequence_class_counts) {
@@ -165,14 +227,9 @@ int main_stats(int argc, char** argv) {
         }
     }
 
-	const uint64_t shift = number_bool_packing::unpack_number(graph.get_handle(graph.min_node_id()));
+	// the nodes are indexed by their rank in id order, so that the ids need not be compacted
+	const algorithms::node_rank_t node_rank(graph);
 
-    if (args::get(mean_links_length) || args::get(sum_of_path_node_distances)) {
-		if (number_bool_packing::unpack_number(graph.get_handle(graph.max_node_id())) - shift >= graph.get_node_count()){
-			std::cerr << "[odgi::stats] error: the node IDs are not compacted. Please run 'odgi sort' using -O, --optimize to optimize the graph." << std::endl;
-			exit(1);
-		}
-    }
 	if (_multiqc || _yaml) {
     	std::cout << "---" << std::endl;
     }
@@ -184,6 +241,7 @@ int main_stats(int argc, char** argv) {
 			args::get(base_content) ||
 			path_delim ||
 			args::get(_file_size) ||
+			args::get(_memory) ||
 			_pangenome_sequence_class_counts ||
 			args::get(mean_links_length) ||
 			args::get(dont_penalize_gap_links) ||
@@ -196,13 +254,385 @@ int main_stats(int argc, char** argv) {
 			args::get(_multiqc) ||
 			args::get(_yaml));
 
-    if (args::get(_summarize) || _multiqc || no_args) {
-        uint64_t length_in_bp = 0, node_count = 0;
-        graph.for_each_handle([&](const handle_t& h) {
-                length_in_bp += graph.get_length(h);
-                ++node_count;
-            });
+	const bool show_summary = args::get(_summarize) || _multiqc || no_args;
+	const bool show_self_loops = _num_self_loops || _multiqc;
+	const bool show_base_content = args::get(base_content) || _multiqc;
+	const bool show_mean_links_length = args::get(mean_links_length);
+	const bool show_sum_of_path_node_distances = args::get(sum_of_path_node_distances);
+	const bool show_weighted_feedback_arc = args::get(weighted_feedback_arc);
+	const bool show_weighted_reversing_join = args::get(weighted_reversing_join);
+	const bool show_links_length_per_nuc = args::get(links_length_per_nuc);
+	const bool _dont_penalize_gap_links = args::get(dont_penalize_gap_links);
+	const bool _penalize_diff_orientation = args::get(penalize_diff_orientation);
+
+	// All metrics are gathered up front, in one parallel pass over the handles and one over the paths,
+	// each thread accumulating its own share, and the sections below only print them.
+	const bool need_positions = show_mean_links_length || show_sum_of_path_node_distances || show_links_length_per_nuc;
+	const bool need_handle_pass = show_summary || show_self_loops || show_base_content || need_positions;
+	// without the sums per path, the weighted feedback arcs and reversing joins are sums over the edges weighted by their depth
+	const bool weigh_by_edge_depths = (show_weighted_feedback_arc || show_weighted_reversing_join) && !args::get(path_statistics);
+	const bool need_path_pass = need_positions || ((show_weighted_feedback_arc || show_weighted_reversing_join) && !weigh_by_edge_depths);
+
+	// This vector is needed for computing the metrics in 1D and for detecting gap-links:
+	// the pangenomic position of each node, by rank, followed by the length of the graph
+	std::vector<uint64_t> position_map;
+	uint64_t length_in_bp = 0, node_count = 0;
+	uint64_t total_self_loops = 0, unique_self_loops = 0;
+	std::vector<uint64_t> chars(256, 0);
+	if (need_handle_pass) {
+		std::vector<handle_t> handles;
+		handles.reserve(graph.get_node_count());
+		graph.for_each_handle([&](const handle_t& h) {
+			handles.push_back(h);
+		});
+		if (need_positions) {
+			position_map.assign(graph.get_node_count() + 1, 0);
+		}
+		struct handle_counts_t {
+			uint64_t length_in_bp = 0;
+			uint64_t node_count = 0;
+			uint64_t total_self_loops = 0;
+			uint64_t unique_self_loops = 0;
+			std::vector<uint64_t> chars;
+		};
+		std::vector<handle_counts_t> thread_counts(num_threads);
+#pragma omp parallel for schedule(dynamic, 4096) num_threads(num_threads)
+		for (uint64_t k = 0; k < handles.size(); ++k) {
+			const handle_t& h = handles[k];
+			auto& counts = thread_counts[omp_get_thread_num()];
+			const uint64_t hl = graph.get_length(h);
+			counts.length_in_bp += hl;
+			++counts.node_count;
+			if (need_positions) {
+				position_map[node_rank(h)] = hl;
+			}
+			if (show_self_loops) {
+				// the self-loops seen from both sides, each edge once
+				const nid_t id = graph.get_id(h);
+				std::vector<edge_t> loops;
+				graph.follow_edges(h, false, [&](const handle_t& next) {
+					if (graph.get_id(next) == id) {
+						loops.push_back(graph.edge_handle(h, next));
+					}
+				});
+				graph.follow_edges(h, true, [&](const handle_t& prev) {
+					if (graph.get_id(prev) == id) {
+						loops.push_back(graph.edge_handle(prev, h));
+					}
+				});
+				std::sort(loops.begin(), loops.end());
+				loops.erase(std::unique(loops.begin(), loops.end()), loops.end());
+				counts.total_self_loops += loops.size();
+				counts.unique_self_loops += !loops.empty();
+			}
+			if (show_base_content) {
+				if (counts.chars.empty()) {
+					counts.chars.assign(256, 0);
+				}
+				for (auto c : graph.get_sequence(h)) {
+					++counts.chars[(uint8_t)c];
+				}
+			}
+		}
+		for (auto& counts : thread_counts) {
+			length_in_bp += counts.length_in_bp;
+			node_count += counts.node_count;
+			total_self_loops += counts.total_self_loops;
+			unique_self_loops += counts.unique_self_loops;
+			for (uint64_t i = 0; i < counts.chars.size(); ++i) {
+				chars[i] += counts.chars[i];
+			}
+		}
+		if (need_positions) {
+			// the node lengths become their starts, in the order of the handles
+			uint64_t len = 0;
+			for (auto& h : handles) {
+				uint64_t& p = position_map[node_rank(h)];
+				const uint64_t hl = p;
+				p = len;
+				len += hl;
+			}
+			position_map[position_map.size() - 1] = len;
+		}
+	}
+
+	// These vectors are needed for computing the metrics in 2D
+	std::vector<double> X, Y;
+	if ((show_mean_links_length || show_sum_of_path_node_distances) && layout_in_file) {
+		const auto& infile = args::get(layout_in_file);
+		if (!infile.empty()) {
+			algorithms::layout::Layout layout;
+
+			if (infile == "-") {
+				layout.load(std::cin);
+			} else {
+				layout.load(infile);
+			}
+
+			X = layout.get_X();
+			Y = layout.get_Y();
+		}
+	}
+
+	// Put path handles in a vector to work on them in parallel
+	std::vector<path_handle_t> paths;
+	std::vector<path_metrics_t> path_metrics;
+	// what each task measured, which in sampled mode are the samples the confidence intervals come from
+	std::vector<path_metrics_t> task_metrics;
+	if (need_path_pass) {
+		paths.reserve(graph.get_path_count());
+		graph.for_each_path_handle([&](const path_handle_t path) {
+			paths.push_back(path);
+		});
+		path_metrics.resize(paths.size());
+		const bool need_gap_links = (show_mean_links_length && _dont_penalize_gap_links) || show_links_length_per_nuc;
+		// the ranks of the nodes of each path in pangenomic order, to detect gap links
+		std::vector<std::vector<uint64_t>> ordered_unpacked_numbers_in_paths(need_gap_links ? paths.size() : 0);
+		if (need_gap_links) {
+			std::vector<uint64_t> step_counts;
+			for (auto& path : paths) {
+				step_counts.push_back(graph.get_step_count(path));
+			}
+			algorithms::run_tasks(step_counts, num_threads, [&](const uint64_t& k, const uint64_t&) {
+				auto& ordered_unpacked_numbers_in_path = ordered_unpacked_numbers_in_paths[k];
+				graph.for_each_step_in_path(paths[k], [&](const step_handle_t &occ) {
+					ordered_unpacked_numbers_in_path.push_back(node_rank(graph.get_handle_of_step(occ)));
+				});
+				std::sort(ordered_unpacked_numbers_in_path.begin(), ordered_unpacked_numbers_in_path.end());
+				ordered_unpacked_numbers_in_path.erase(std::unique(ordered_unpacked_numbers_in_path.begin(), ordered_unpacked_numbers_in_path.end()),
+													   ordered_unpacked_numbers_in_path.end());
+			});
+		}
+		// the metrics are sums over the links of the paths, so long paths are cut into runs of steps that are
+		// measured in parallel, each starting from the link to the step before it, and summed up per path;
+		// when sampling, the runs start at random steps and the sums of all runs are a ratio estimate
+		const std::vector<algorithms::path_task_t> tasks = sampled
+			? algorithms::sample_path_tasks(graph, paths, rate, num_threads)
+			: algorithms::split_path_tasks(graph, paths, num_threads);
+		task_metrics.resize(tasks.size());
+		algorithms::run_tasks(algorithms::path_task_costs(tasks), num_threads, [&](const uint64_t& t, const uint64_t&) {
+			const algorithms::path_task_t& task = tasks[t];
+			auto& m = task_metrics[t];
+			static const std::vector<uint64_t> no_numbers;
+			const std::vector<uint64_t>& ordered_unpacked_numbers_in_path = need_gap_links
+				? ordered_unpacked_numbers_in_paths[task.path_index] : no_numbers;
+			// a gap link goes to the next node of the path in pangenomic order
+			auto is_gap_link = [&](const uint64_t& unpacked_h, const uint64_t& unpacked_i) {
+				auto f = std::lower_bound(ordered_unpacked_numbers_in_path.begin(), ordered_unpacked_numbers_in_path.end(), unpacked_h);
+				return f + 1 < ordered_unpacked_numbers_in_path.end() && *(f + 1) == unpacked_i;
+			};
+
+			bool has_prev = !task.is_first;
+			handle_t h;
+			if (has_prev) {
+				h = graph.get_handle_of_step(graph.get_previous_step(task.begin));
+			}
+			step_handle_t occ = task.begin;
+			for (uint64_t r = 0; r < task.step_count; ++r, occ = graph.get_next_step(occ)) {
+				const handle_t i = graph.get_handle_of_step(occ);
+				if (has_prev) {
+					const uint64_t unpacked_h = node_rank(h);
+					const uint64_t unpacked_i = node_rank(i);
+					const bool is_rev_h = graph.get_is_reverse(h);
+					const bool is_rev_i = graph.get_is_reverse(i);
+					const bool gap_link = need_gap_links && is_gap_link(unpacked_h, unpacked_i);
+
+					if (show_mean_links_length) {
+						// The position map includes the start and end of the node in successive entries.
+						// Edges leave from the end (or start) of one node (depending on whether they are on the
+						// forward or reverse strand) and go to the start (or end) of the other side of the link.
+						uint64_t _info_a = unpacked_h + !is_rev_h;
+						uint64_t _info_b = unpacked_i + is_rev_i;
+
+						if (!_dont_penalize_gap_links || !gap_link) {
+							if (_info_b < _info_a) {
+								std::swap(_info_a, _info_b);
+							}
+
+							if (layout_in_file) {
+								// 2D metric
+								double dx = X[2 * unpacked_h + is_rev_h] - X[2 * unpacked_i + is_rev_i];
+								double dy = Y[2 * unpacked_h + is_rev_h] - Y[2 * unpacked_i + is_rev_i];
+
+								m.links_2D_space += sqrt(dx * dx + dy * dy);
+							} else {
+								// 1D metric (in node space and in nucleotide space)
+								m.links_node_space += _info_b - _info_a;
+								m.links_nt_space += position_map[_info_b] - position_map[_info_a];
+							}
+						} else {
+							m.num_gap_links++;
+						}
+
+						m.num_links++;
+					}
+
+					if (show_sum_of_path_node_distances) {
+						uint64_t unpacked_a = unpacked_h;
+						uint64_t unpacked_b = unpacked_i;
+
+						double euclidean_distance_2D;
+
+						if (layout_in_file) {
+							// 2D metric
+							double dx = X[2 * unpacked_a + is_rev_h] - X[2 * unpacked_b + is_rev_i];
+							double dy = Y[2 * unpacked_a + is_rev_h] - Y[2 * unpacked_b + is_rev_i];
+
+							euclidean_distance_2D = sqrt(dx * dx + dy * dy);
+							m.dist_2D_space += euclidean_distance_2D;
+						} else {
+							uint8_t weight = 1;
+							if (unpacked_b < unpacked_a) {
+								std::swap(unpacked_a, unpacked_b);
+
+								// When a path goes back in terms of pangenomic order, this is punished
+								weight = 3;
+								m.num_penalties++;
+							}
+
+							m.dist_node_space += weight * (unpacked_b - unpacked_a);
+							m.dist_nt_space += weight * (position_map[unpacked_b] - position_map[unpacked_a]);
+						}
+
+						if (_penalize_diff_orientation && is_rev_h != is_rev_i) {
+							if (layout_in_file) {
+								m.dist_2D_space += 2 * euclidean_distance_2D;
+							} else {
+								m.dist_node_space += 2 * (unpacked_b - unpacked_a);
+								m.dist_nt_space += 2 * (position_map[unpacked_b] - position_map[unpacked_a]);
+							}
+
+							m.num_penalties_diff_orientation++;
+						}
+					}
+
+					// Check if it is a feedback arc (edge joining out-sides with in-sides such that the outside node does not precede the inside node)
+					if (show_weighted_feedback_arc && !weigh_by_edge_depths
+						&& ((!is_rev_h && !is_rev_i && unpacked_h >= unpacked_i) || (is_rev_h && is_rev_i && unpacked_h <= unpacked_i))) {
+						m.feedback_arcs++;
+					}
+
+					// Check if it is a reversing arc (edges joining two in- or two out-sides)
+					if (show_weighted_reversing_join && !weigh_by_edge_depths && is_rev_h != is_rev_i) {
+						m.reversing_joins++;
+					}
+
+					if (show_links_length_per_nuc) {
+						const uint64_t pos_h = position_map[unpacked_h];
+						const uint64_t pos_i = position_map[unpacked_i];
+						const uint64_t len_h = graph.get_length(h);
+						const uint64_t len_i = graph.get_length(i);
+						const uint64_t nid_h = graph.get_id(h);
+						const uint64_t nid_i = graph.get_id(i);
+
+						/// f means forward oriented step, r means reverse oriented step
+
+						/// handle_h: f, handle_i: f
+						if (!is_rev_h && !is_rev_i) {
+							/// nid_h <= nid_i
+							if (nid_h <= nid_i) {
+								/// If we have a gap link, we don't count up
+								if (!gap_link) {
+									m.links_length += pos_i - (pos_h + len_h);
+								}
+								/// nid_h > nid_i
+							} else {
+								m.links_length += pos_h - pos_i + len_h;
+							}
+							/// handle_h: f, handle_i: r
+						} else if (!is_rev_h && is_rev_i) {
+							if (nid_h <= nid_i) {
+								m.links_length += pos_i + len_i - (pos_h + len_h);
+								/// nid_h > nid_i
+							} else {
+								m.links_length += pos_h - pos_i - len_i + len_h;
+							}
+							/// handle_h: r, handle_i: f
+						} else if (is_rev_h && !is_rev_i) {
+							if (nid_h <= nid_i) {
+								m.links_length += pos_i - pos_h;
+								/// nid_h > nid_i
+							} else {
+								m.links_length += pos_h - pos_i + len_h + len_i;
+							}
+							/// handle_h: r, handle_i: r
+						} else {
+							if (nid_h <= nid_i) {
+								m.links_length += pos_i - pos_h + len_h + len_i;
+								/// nid_h > nid_i
+							} else {
+								m.links_length += pos_h - (pos_i + len_i);
+							}
+						}
+					}
+				}
+				m.len_node_space++;
+				m.len_nt_space += graph.get_length(i);
+				h = i;
+				has_prev = true;
+			}
+			if (has_prev && task.is_last) {
+				// add end of path so the best metric equals 1
+				m.dist_node_space++;
+				m.dist_nt_space += graph.get_length(h);
+			}
+		});
+		for (uint64_t t = 0; t < tasks.size(); ++t) {
+			auto& m = path_metrics[tasks[t].path_index];
+			const auto& n = task_metrics[t];
+			m.links_node_space += n.links_node_space;
+			m.links_nt_space += n.links_nt_space;
+			m.links_2D_space += n.links_2D_space;
+			m.num_links += n.num_links;
+			m.num_gap_links += n.num_gap_links;
+			m.dist_node_space += n.dist_node_space;
+			m.dist_nt_space += n.dist_nt_space;
+			m.dist_2D_space += n.dist_2D_space;
+			m.len_node_space += n.len_node_space;
+			m.len_nt_space += n.len_nt_space;
+			m.num_penalties += n.num_penalties;
+			m.num_penalties_diff_orientation += n.num_penalties_diff_orientation;
+			m.feedback_arcs += n.feedback_arcs;
+			m.reversing_joins += n.reversing_joins;
+			m.links_length += n.links_length;
+		}
+	}
+
+	// the same sums from the depth of each edge, read from an index or counted in one pass over the paths
+	uint64_t feedback_arcs_by_edge_depths = 0, reversing_joins_by_edge_depths = 0;
+	if (weigh_by_edge_depths) {
+		algorithms::edge_depth_index_t edge_depths;
+		if (edge_depth_index_file) {
+			std::ifstream in(args::get(edge_depth_index_file), std::ios::binary);
+			if (!in || !edge_depths.load(in) || !edge_depths.is_index_of(graph)) {
+				std::cerr << "[odgi::stats] error: \"" << args::get(edge_depth_index_file) << "\" does not hold an edge depth index of the graph written via odgi depth --write-edge-depth-index." << std::endl;
+				return 1;
+			}
+		} else {
+			edge_depths = algorithms::edge_depth_index_t(graph, num_threads);
+		}
+		std::vector<std::pair<uint64_t, uint64_t>> thread_sums(num_threads, std::make_pair(0, 0));
+		edge_depths.for_each_edge_depth([&](const edge_t& edge, const uint64_t& depth) {
+			// both ways of crossing an edge are feedback arcs or reversing joins, or neither
+			const uint64_t unpacked_h = node_rank(edge.first);
+			const uint64_t unpacked_i = node_rank(edge.second);
+			const bool is_rev_h = graph.get_is_reverse(edge.first);
+			const bool is_rev_i = graph.get_is_reverse(edge.second);
+			auto& sums = thread_sums[omp_get_thread_num()];
+			if ((!is_rev_h && !is_rev_i && unpacked_h >= unpacked_i) || (is_rev_h && is_rev_i && unpacked_h <= unpacked_i)) {
+				sums.first += depth;
+			}
+			if (is_rev_h != is_rev_i) {
+				sums.second += depth;
+			}
+		}, num_threads);
+		for (auto& sums : thread_sums) {
+			feedback_arcs_by_edge_depths += sums.first;
+			reversing_joins_by_edge_depths += sums.second;
+		}
+	}
 
+    if (show_summary) {
         uint64_t edge_count = graph.get_edge_count();
         uint64_t path_count = graph.get_path_count();
 
@@ -224,7 +654,9 @@ int main_stats(int argc, char** argv) {
     }
 
     if (args::get(_weakly_connected_components) || _multiqc) {
-        std::vector<ska::flat_hash_set<handlegraph::nid_t>> weak_components = algorithms::weakly_connected_components(&graph);
+        // the components as labels, their sizes and acyclicity in parallel
+        const algorithms::component_labels_t weak_components = algorithms::weakly_connected_component_labels(&graph, num_threads);
+        const std::vector<uint8_t> component_acyclic = algorithms::nice_and_acyclic_components(graph, weak_components, num_threads);
 		if (_multiqc || _yaml) {
 			std::cout << "num_weakly_connected_components: " << weak_components.size() << std::endl;
 			std::cout << "weakly_connected_components: " << std::endl;
@@ -233,43 +665,33 @@ int main_stats(int argc, char** argv) {
 			std::cout << "#component\tnodes\tis_acyclic" << std::endl;
 		}
         for(uint64_t i = 0; i < weak_components.size(); ++i) {
-            auto& weak_component = weak_components[i];
-
-            ska::flat_hash_set<handlegraph::nid_t> head_nodes = algorithms::is_nice_and_acyclic(graph, weak_components[i]);
-            bool acyclic = !(head_nodes.empty());
+            const bool acyclic = component_acyclic[i];
 			if (_multiqc || _yaml) {
 				std::cout << "  - component:" << std::endl;
 				std::cout << "      id: " << i << std::endl;
-				std::cout << "      nodes: " << weak_components[i].size() << std::endl;
+				std::cout << "      nodes: " << weak_components.component_size(i) << std::endl;
 				std::cout << "      is_acyclic: " << (acyclic ? "'yes'" : "'no'") << std::endl;
 			} else {
-				std::cout << i << "\t" << weak_components[i].size() << "\t" << (acyclic ? "yes" : "no") << std::endl;
+				std::cout << i << "\t" << weak_components.component_size(i) << "\t" << (acyclic ? "yes" : "no") << std::endl;
 			}
         }
     }
 
-    if (_num_self_loops || _multiqc) {
-        uint64_t total_self_loops = 0;
-        std::unordered_set<nid_t> loops;
-        graph.for_each_edge([&](const edge_t& e) {
-            if (graph.get_id(e.first) == graph.get_id(e.second)) {
-                ++total_self_loops;
-                loops.insert(graph.get_id(e.first));
-            }
-        });
 
+    if (show_self_loops) {
         // Should be these always equal?
         if (_multiqc || _yaml) {
         	std::cout << "num_nodes_self_loops:" << std::endl;
         	std::cout << "  total: " << total_self_loops << std::endl;
-        	std::cout << "  unique: " << loops.size() << std::endl;
+        	std::cout << "  unique: " << unique_self_loops << std::endl;
         } else {
 			cout << "#type\tnum" << endl;
 			cout << "total" << "\t" << total_self_loops << endl;
-			cout << "unique" << "\t" << loops.size() << endl;
+			cout << "unique" << "\t" << unique_self_loops << endl;
 		}
     }
 
+
 	/// we don't do this when `-y, --_multiqc` was specified
     if (_show_nondeterministic_edges) {
         // This edges could be compressed in principle
@@ -293,14 +715,8 @@ int main_stats(int argc, char** argv) {
         });
     }
 
-    if (args::get(base_content) || _multiqc) {
-        std::vector<uint64_t> chars(256);
-        graph.for_each_handle([&](const handle_t& h) {
-                std::string seq = graph.get_sequence(h);
-                for (auto c : seq) {
-                    ++chars[c];
-                }
-            });
+
+    if (show_base_content) {
         for (uint64_t i = 0; i < 256; ++i) {
             if (chars[i]) {
             	if (_multiqc || _yaml) {
@@ -312,6 +728,7 @@ int main_stats(int argc, char** argv) {
         }
     }
 
+
 	if (_file_size || _multiqc) {
 		// 1. get the file size with error handling
 		const filesystem::path path_infile = infile;
@@ -329,6 +746,60 @@ int main_stats(int argc, char** argv) {
 		}
 	}
 
+	if (_memory) {
+		graph.set_number_of_threads(num_threads);
+		const graph_t::memory_breakdown_t breakdown = graph.measure_memory();
+		const std::vector<std::pair<std::string, graph_t::memory_breakdown_t::bytes_t>> components = {
+			{"node_records", breakdown.node_records},
+			{"sequences", breakdown.sequences},
+			{"edges", breakdown.edges},
+			{"path_steps", breakdown.path_steps},
+			{"path_metadata", breakdown.path_metadata},
+			{"hash_tables", breakdown.hash_tables},
+			{"total", breakdown.total()}};
+		// the counts a bucket holds, as in 4-7
+		auto bucket_range = [](const uint64_t& b) {
+			if (b < 2) {
+				return std::to_string(b);
+			}
+			return std::to_string((uint64_t)1 << (b - 1)) + "-" + std::to_string(((uint64_t)1 << b) - 1);
+		};
+		auto show_buckets = [&](const std::string& name, const std::vector<graph_t::memory_breakdown_t::bucket_t>& buckets) {
+			if (_multiqc || _yaml) {
+				std::cout << "  by_" << name << ":" << std::endl;
+			} else {
+				std::cout << "#" << name << "\tnodes\tmemory.bytes\tserialized.bytes" << std::endl;
+			}
+			for (uint64_t b = 0; b < buckets.size(); ++b) {
+				if (!buckets[b].nodes) continue;
+				if (_multiqc || _yaml) {
+					std::cout << "    - " << name << ": " << bucket_range(b) << std::endl;
+					std::cout << "      nodes: " << buckets[b].nodes << std::endl;
+					std::cout << "      memory: " << buckets[b].bytes.memory << std::endl;
+					std::cout << "      serialized: " << buckets[b].bytes.serialized << std::endl;
+				} else {
+					std::cout << bucket_range(b) << "\t" << buckets[b].nodes << "\t" << buckets[b].bytes.memory
+							  << "\t" << buckets[b].bytes.serialized << std::endl;
+				}
+			}
+		};
+		if (_multiqc || _yaml) {
+			std::cout << "memory_in_bytes:" << std::endl;
+			for (auto& c : components) {
+				std::cout << "  " << c.first << ":" << std::endl;
+				std::cout << "    memory: " << c.second.memory << std::endl;
+				std::cout << "    serialized: " << c.second.serialized << std::endl;
+			}
+		} else {
+			std::cout << "#component\tmemory.bytes\tserialized.bytes" << std::endl;
+			for (auto& c : components) {
+				std::cout << c.first << "\t" << c.second.memory << "\t" << c.second.serialized << std::endl;
+			}
+		}
+		show_buckets("degree", breakdown.by_degree);
+		show_buckets("depth", breakdown.by_depth);
+	}
+
 	if (_pangenome_sequence_class_counts) {
 		const char delim = delim_pos[0][0];
 		uint64_t sample_pos = std::stoul(delim_pos[1]);
@@ -390,448 +861,305 @@ int main_stats(int argc, char** argv) {
 		// TODO clear all sets?
 	}
 
-    if (args::get(mean_links_length) || args::get(sum_of_path_node_distances)) {
-        // This vector is needed for computing the metrics in 1D and for detecting gap-links
-        std::vector<uint64_t> position_map(graph.get_node_count() + 1);
 
-        // These vectors are needed for computing the metrics in 2D
-        std::vector<double> X, Y;
+    // The half width of the 95% confidence interval of the ratio estimate sum(y) / sum(x) over the sampled
+    // runs, from the linearized variance of the ratio estimator, as the runs are drawn with replacement
+    auto ratio_ci95 = [&](const std::function<double(const path_metrics_t&)>& y,
+                          const std::function<double(const path_metrics_t&)>& x) {
+        const uint64_t n = task_metrics.size();
+        double sum_y = 0, sum_x = 0;
+        for (auto& m : task_metrics) {
+            sum_y += y(m);
+            sum_x += x(m);
+        }
+        if (n < 2 || sum_x == 0) {
+            return 0.0;
+        }
+        const double ratio = sum_y / sum_x;
+        double residuals = 0;
+        for (auto& m : task_metrics) {
+            const double r = y(m) - ratio * x(m);
+            residuals += r * r;
+        }
+        const double mean_x = sum_x / (double)n;
+        return 1.96 * std::sqrt(residuals / (double)(n - 1) / (double)n) / mean_x;
+    };
+    if (sampled && (_multiqc || _yaml)) {
+        std::cout << "sample_rate: " << rate << std::endl;
+        std::cout << "sampled_runs: " << task_metrics.size() << std::endl;
+    }
 
-        if (layout_in_file) {
-            const auto& infile = args::get(layout_in_file);
-            if (!infile.empty()) {
-                algorithms::layout::Layout layout;
+    if (show_mean_links_length) {
+        uint64_t sum_all_node_space = 0;
+        uint64_t sum_all_nt_space = 0;
+        double sum_all_2D_space = 0.0;
+        uint64_t num_all_links = 0;
+        uint64_t num_all_gap_links = 0;
 
-                if (infile == "-") {
-                    layout.load(std::cin);
-                } else {
-                    ifstream f(infile.c_str());
-                    layout.load(f);
-                    f.close();
+        if (_multiqc || _yaml) {
+            std::cout << "mean_links_length:" << std::endl;
+        } else {
+            std::cout << "#mean_links_length" << std::endl;
+            if (layout_in_file) {
+                std::cout << "path\tin_2D_space\tnum_links_considered" << (sampled ? "\tin_2D_space_ci95" : "") << std::endl;
+            }else{
+                std::cout << "path\tin_node_space\tin_nucleotide_space\tnum_links_considered";
+
+                if (dont_penalize_gap_links){
+                    std::cout << "\tnum_gap_links_not_penalized" << std::endl;
+                }else if (sampled) {
+                    std::cout << "\tin_node_space_ci95\tin_nucleotide_space_ci95" << std::endl;
+                }else{
+                    std::cout << std::endl;
                 }
-
-                X = layout.get_X();
-                Y = layout.get_Y();
             }
         }
 
-        {
-            uint64_t len = 0;
-            graph.for_each_handle([&](const handle_t &h) {
-                position_map[number_bool_packing::unpack_number(h) - shift] = len;
-                uint64_t hl = graph.get_length(h);
-                len += hl;
-#ifdef debug_odgi_viz
-                std::cerr << "SEGMENT ID: " << graph.get_id(h) << " - " << as_integer(h) << " - index_in_position_map (" << number_bool_packing::unpack_number(h) << ") = " << len << std::endl;
-#endif
-            });
-            position_map[position_map.size() - 1] = len;
-        }
-
-        if (args::get(mean_links_length)){
-            bool _dont_penalize_gap_links = args::get(dont_penalize_gap_links);
+        for (uint64_t k = 0; k < paths.size(); ++k) {
+            const auto& m = path_metrics[k];
 
-            uint64_t sum_all_node_space = 0;
-            uint64_t sum_all_nt_space = 0;
-            double sum_all_2D_space = 0.0;
-            uint64_t num_all_links = 0;
-            uint64_t num_all_gap_links = 0;
-
-            if (_multiqc || _yaml) {
-            	std::cout << "mean_links_length:" << std::endl;
-            } else {
-				std::cout << "#mean_links_length" << std::endl;
-				if (layout_in_file) {
-					std::cout << "path\tin_2D_space\tnum_links_considered" << std::endl;
-				}else{
-					std::cout << "path\tin_node_space\tin_nucleotide_space\tnum_links_considered";
-
-					if (dont_penalize_gap_links){
-						std::cout << "\tnum_gap_links_not_penalized" << std::endl;
-					}else{
-						std::cout << std::endl;
-					}
-				}
-			}
-
-            // TODO Could we run this in parallel?
-			graph.for_each_path_handle([&](const path_handle_t &path) {
-				std::set<uint64_t> ordered_unpacked_numbers_in_path; // ordered set to retain the positions order
-
-                uint64_t sum_node_space = 0;
-                uint64_t sum_nt_space = 0;
-                double sum_2D_space = 0.0;
-                uint64_t num_links = 0;
-                uint64_t num_gap_links = 0;
-
-                if (_dont_penalize_gap_links){
-                    graph.for_each_step_in_path(path, [&](const step_handle_t &occ) {
-                        ordered_unpacked_numbers_in_path.insert(number_bool_packing::unpack_number(graph.get_handle_of_step(occ)));
-                    });
+            /// this could land in the YAML, but we don't force it, because we don't need it for the MultiQC module
+            if (args::get(path_statistics)) {
+                double ratio_node_space = 0;
+                double ratio_nt_space = 0;
+                double ratio_2D_space = 0;
+                if (m.num_links > 0){
+                    if (layout_in_file) {
+                        ratio_2D_space = m.links_2D_space / (double)m.num_links;
+                    } else{
+                        ratio_node_space = (double)m.links_node_space / (double)m.num_links;
+                        ratio_nt_space = (double)m.links_nt_space / (double)m.num_links;
+                    }
                 }
-
-                graph.for_each_step_in_path(path, [&](const step_handle_t &occ) {
-                    handle_t h = graph.get_handle_of_step(occ);
-
-                    if (graph.has_next_step(occ)){
-                        handle_t i = graph.get_handle_of_step(graph.get_next_step(occ));
-
-                        uint64_t unpacked_h = number_bool_packing::unpack_number(h);
-                        uint64_t unpacked_i = number_bool_packing::unpack_number(i);
-
-                        // The position map includes the start and end of the node in successive entries.
-                        // Edges leave from the end (or start) of one node (depending on whether they are on the
-                        // forward or reverse strand) and go to the start (or end) of the other side of the link.
-                        uint64_t _info_a = unpacked_h + !number_bool_packing::unpack_bit(h);
-                        uint64_t _info_b = unpacked_i + number_bool_packing::unpack_bit(i);
-
-                        if (!dont_penalize_gap_links || next(ordered_unpacked_numbers_in_path.find(unpacked_h)) != ordered_unpacked_numbers_in_path.find(unpacked_i)){
-                            if (_info_b < _info_a){
-                                _info_a = _info_b;
-                                _info_b = unpacked_h + !number_bool_packing::unpack_bit(h);
-                            }
-
-                            if (layout_in_file) {
-                                // 2D metric
-                                double dx = X[2 * (unpacked_h - shift) + number_bool_packing::unpack_bit(h)] - X[2 * (unpacked_i - shift) + number_bool_packing::unpack_bit(i)];
-                                double dy = Y[2 * (unpacked_h - shift) + number_bool_packing::unpack_bit(h)] - Y[2 * (unpacked_i - shift) + number_bool_packing::unpack_bit(i)];
-
-                                sum_2D_space += sqrt(dx * dx + dy * dy);
-                            }else{
-                                // 1D metric (in node space and in nucleotide space)
-                                sum_node_space += _info_b - _info_a;
-                                sum_nt_space += position_map[_info_b - shift] - position_map[_info_a - shift];
-
-#ifdef debug_odgi_stats
-                                std::cerr << _info_b << " - " << _info_a << ": " << position_map[_info_b - shift] - position_map[_info_a - shift] << std::endl;
-#endif
-                            }
-                        }else if (dont_penalize_gap_links){
-                            num_gap_links++;
-                        }
-
-                        num_links++;
+                if (_multiqc || _yaml) {
+                    std::cout << "  - length:" << std::endl;
+                    std::cout << "      path: " << graph.get_path_name(paths[k]) << std::endl;
+                    if (layout_in_file) {
+                        std::cout << "      in_2D_space: " << ratio_2D_space << std::endl;
+                    } else {
+                        std::cout << "      in_node_space: " << ratio_node_space << std::endl;
+                        std::cout << "      in_nucleotide_space: " << ratio_nt_space << std::endl;
                     }
-                });
+                    std::cout << "      num_links_considered: " << m.num_links << std::endl;
+                    if (dont_penalize_gap_links) {
+                        std::cout << "      num_gap_links_not_penalized: " << m.num_gap_links << std::endl;
+                    }
+                } else {
+                    if (layout_in_file) {
+                        std::cout << graph.get_path_name(paths[k]) << "\t" << ratio_2D_space << "\t" << m.num_links << std::endl;
+                    }else{
+                        std::cout << graph.get_path_name(paths[k]) << "\t" << ratio_node_space << "\t" << ratio_nt_space << "\t" << m.num_links;
 
-                /// this could land in the YAML, but we don't force it, because we don't need it for the MultiQC module
-                if (args::get(path_statistics)) {
-                    double ratio_node_space = 0;
-                    double ratio_nt_space = 0;
-                    double ratio_2D_space = 0;
-                    if (num_links > 0){
-                        if (layout_in_file) {
-                            ratio_2D_space = sum_2D_space / (double)num_links;
-                        } else{
-                            ratio_node_space = (double)sum_node_space / (double)num_links;
-                            ratio_nt_space = (double)sum_nt_space / (double)num_links;
+                        if (dont_penalize_gap_links){
+                            std::cout << "\t" << m.num_gap_links << std::endl;
+                        }else{
+                            std::cout << std::endl;
                         }
                     }
-					if (_multiqc || _yaml) {
-						std::cout << "  - length:" << std::endl;
-						std::cout << "      path: " << graph.get_path_name(path) << std::endl;
-						if (layout_in_file) {
-							std::cout << "      in_2D_space: " << ratio_2D_space << std::endl;
-						} else {
-							std::cout << "      in_node_space: " << ratio_node_space << std::endl;
-							std::cout << "      in_nucleotide_space: " << ratio_nt_space << std::endl;
-						}
-						std::cout << "      num_links_considered: " << num_links << std::endl;
-						if (dont_penalize_gap_links) {
-							std::cout << "      num_gap_links_not_penalized: " << num_gap_links << std::endl;
-						}
-					} else {
-						if (layout_in_file) {
-							std::cout << graph.get_path_name(path) << "\t" << ratio_2D_space << "\t" << num_links << std::endl;
-						}else{
-							std::cout << graph.get_path_name(path) << "\t" << ratio_node_space << "\t" << ratio_nt_space << "\t" << num_links;
-
-							if (dont_penalize_gap_links){
-								std::cout << "\t" << num_gap_links << std::endl;
-							}else{
-								std::cout << std::endl;
-							}
-						}
-					}
                 }
+            }
 
-                sum_all_node_space += sum_node_space;
-                sum_all_nt_space += sum_nt_space;
-                sum_all_2D_space += sum_2D_space;
-                num_all_links += num_links;
-                num_all_gap_links += num_gap_links;
-            });
+            sum_all_node_space += m.links_node_space;
+            sum_all_nt_space += m.links_nt_space;
+            sum_all_2D_space += m.links_2D_space;
+            num_all_links += m.num_links;
+            num_all_gap_links += m.num_gap_links;
+        }
 
-            double ratio_node_space = 0;
-            double ratio_nt_space = 0;
-            double ratio_2D_space = 0;
-            if (num_all_links > 0) {
+        const auto num_links = [](const path_metrics_t& m) { return (double)m.num_links; };
+        const double ci_node_space = sampled ? ratio_ci95([](const path_metrics_t& m) { return (double)m.links_node_space; }, num_links) : 0;
+        const double ci_nt_space = sampled ? ratio_ci95([](const path_metrics_t& m) { return (double)m.links_nt_space; }, num_links) : 0;
+        const double ci_2D_space = sampled ? ratio_ci95([](const path_metrics_t& m) { return m.links_2D_space; }, num_links) : 0;
+        double ratio_node_space = 0;
+        double ratio_nt_space = 0;
+        double ratio_2D_space = 0;
+        if (num_all_links > 0) {
+            if (layout_in_file) {
+                ratio_2D_space = sum_all_2D_space / (double)num_all_links;
+            }else{
+                ratio_node_space = (double)sum_all_node_space / (double)num_all_links;
+                ratio_nt_space = (double)sum_all_nt_space / (double)num_all_links;
+            }
+        }
+        if (_multiqc || _yaml) {
+            std::cout << "  - length:" << std::endl;
+            std::cout << "      path: " << "all_paths" << std::endl;
+            if (layout_in_file) {
+                std::cout << "      in_2D_space: " << ratio_2D_space << std::endl;
+            } else {
+                std::cout << "      in_node_space: " << ratio_node_space << std::endl;
+                std::cout << "      in_nucleotide_space: " << ratio_nt_space << std::endl;
+            }
+            std::cout << "      num_links_considered: " << num_all_links << std::endl;
+            if (sampled) {
                 if (layout_in_file) {
-                    ratio_2D_space = sum_all_2D_space / (double)num_all_links;
+                    std::cout << "      in_2D_space_ci95: " << ci_2D_space << std::endl;
+                } else {
+                    std::cout << "      in_node_space_ci95: " << ci_node_space << std::endl;
+                    std::cout << "      in_nucleotide_space_ci95: " << ci_nt_space << std::endl;
+                }
+            }
+            if (dont_penalize_gap_links || _multiqc) {
+                std::cout << "      num_gap_links_not_penalized: " << num_all_gap_links << std::endl;
+            }
+        } else {
+            if (layout_in_file) {
+                std::cout << "all_paths\t" << ratio_2D_space << "\t" << num_all_links;
+                if (sampled) {
+                    std::cout << "\t" << ci_2D_space;
+                }
+                std::cout << std::endl;
+            }else{
+                std::cout << "all_paths\t" << ratio_node_space << "\t" << ratio_nt_space << "\t" << num_all_links;
+
+                if (_dont_penalize_gap_links){
+                    std::cout << "\t" << num_all_gap_links << std::endl;
+                }else if (sampled) {
+                    std::cout << "\t" << ci_node_space << "\t" << ci_nt_space << std::endl;
                 }else{
-                    ratio_node_space = (double)sum_all_node_space / (double)num_all_links;
-                    ratio_nt_space = (double)sum_all_nt_space / (double)num_all_links;
+                    std::cout << std::endl;
                 }
             }
-			if (_multiqc || _yaml) {
-				std::cout << "  - length:" << std::endl;
-				std::cout << "      path: " << "all_paths" << std::endl;
-				if (layout_in_file) {
-					std::cout << "      in_2D_space: " << ratio_2D_space << std::endl;
-				} else {
-					std::cout << "      in_node_space: " << ratio_node_space << std::endl;
-					std::cout << "      in_nucleotide_space: " << ratio_nt_space << std::endl;
-				}
-				std::cout << "      num_links_considered: " << num_all_links << std::endl;
-				if (dont_penalize_gap_links || _multiqc) {
-					std::cout << "      num_gap_links_not_penalized: " << num_all_gap_links << std::endl;
-				}
-			} else {
-				if (layout_in_file) {
-					std::cout << "all_paths\t" << ratio_2D_space << "\t" << num_all_links << std::endl;
-				}else{
-					std::cout << "all_paths\t" << ratio_node_space << "\t" << ratio_nt_space << "\t" << num_all_links;
-
-					if (_dont_penalize_gap_links){
-						std::cout << "\t" << num_all_gap_links << std::endl;
-					}else{
-						std::cout << std::endl;
-					}
-				}
-			}
         }
+    }
 
-        if (args::get(sum_of_path_node_distances)){
-            bool _penalize_diff_orientation = args::get(penalize_diff_orientation);
-
-            uint64_t sum_all_path_node_dist_node_space = 0;
-            uint64_t sum_all_path_node_dist_nt_space = 0;
-            double sum_all_path_node_dist_2D_space = 0.0;
-            uint64_t len_all_path_node_space = 0;
-            uint64_t len_all_path_nt_space = 0;
-            uint64_t num_all_penalties = 0;
-            uint64_t num_all_penalties_diff_orientation = 0;
-
-            if (_multiqc || _yaml) {
-            	std::cout << "sum_of_path_node_distances:" << std::endl;
-            } else {
-				std::cout << "#sum_of_path_node_distances" << std::endl;
-
-				if (layout_in_file) {
-					std::cout << "path\tin_2D_space_by_nodes\tin_2D_space_by_nucleotides\tnodes\tnucleotides";
-				}else{
-					std::cout << "path\tin_node_space\tin_nucleotide_space\tnodes\tnucleotides\tnum_penalties";
-				}
-
-				if (_penalize_diff_orientation){
-					std::cout << "\tnum_penalties_different_orientation" << std::endl;
-				}else{
-					std::cout << std::endl;
-				}
-			}
-
-            // TODO Could we run this in parallel?
-			handle_t last_handle;
-            graph.for_each_path_handle([&](const path_handle_t &path) {
-#ifdef debug_odgi_stats
-                std::cerr << "path_name: " << graph.get_path_name(path) << std::endl;
-#endif
-                uint64_t sum_path_node_dist_node_space = 0;
-                uint64_t sum_path_node_dist_nt_space = 0;
-                double sum_path_node_dist_2D_space = 0.0;
-                uint64_t len_path_node_space = 0;
-                uint64_t len_path_nt_space = 0;
-                uint64_t num_penalties = 0;
-                uint64_t num_penalties_diff_orientation = 0;
-
-                graph.for_each_step_in_path(path, [&](const step_handle_t &occ) {
-                    handle_t h = graph.get_handle_of_step(occ);
-					last_handle = h;
-
-                    if (graph.has_next_step(occ)){
-                        handle_t i = graph.get_handle_of_step(graph.get_next_step(occ));
-						last_handle = i;
-
-                        uint64_t unpacked_a = number_bool_packing::unpack_number(h);
-                        uint64_t unpacked_b = number_bool_packing::unpack_number(i);
-
-                        double euclidean_distance_2D;
-
-                        if (layout_in_file) {
-                            // 2D metric
-                            double dx = X[2 * (unpacked_a - shift) + number_bool_packing::unpack_bit(h)] - X[2 * (unpacked_b - shift) + number_bool_packing::unpack_bit(i)];
-                            double dy = Y[2 * (unpacked_a - shift) + number_bool_packing::unpack_bit(h)] - Y[2 * (unpacked_b - shift) + number_bool_packing::unpack_bit(i)];
+    if (show_sum_of_path_node_distances) {
+        uint64_t sum_all_path_node_dist_node_space = 0;
+        uint64_t sum_all_path_node_dist_nt_space = 0;
+        double sum_all_path_node_dist_2D_space = 0.0;
+        uint64_t len_all_path_node_space = 0;
+        uint64_t len_all_path_nt_space = 0;
+        uint64_t num_all_penalties = 0;
+        uint64_t num_all_penalties_diff_orientation = 0;
 
-                            euclidean_distance_2D = sqrt(dx * dx + dy * dy);
-                            sum_path_node_dist_2D_space += euclidean_distance_2D;
-                        }else{
-                            uint8_t weight = 1;
-                            if (unpacked_b < unpacked_a){
-                                unpacked_a = unpacked_b;
-                                unpacked_b = number_bool_packing::unpack_number(h);
-
-                                // When a path goes back in terms of pangenomic order, this is punished
-                                weight = 3;
-                                num_penalties++;
-                            }
+        if (_multiqc || _yaml) {
+            std::cout << "sum_of_path_node_distances:" << std::endl;
+        } else {
+            std::cout << "#sum_of_path_node_distances" << std::endl;
 
-#ifdef debug_odgi_stats
-                            std::cerr << unpacked_b << " - " << unpacked_a << ": " << position_map[unpacked_b - shift] - position_map[unpacked_a - shift] << " * " << weight << std::endl;
-#endif
+            if (layout_in_file) {
+                std::cout << "path\tin_2D_space_by_nodes\tin_2D_space_by_nucleotides\tnodes\tnucleotides";
+            }else{
+                std::cout << "path\tin_node_space\tin_nucleotide_space\tnodes\tnucleotides\tnum_penalties";
+            }
 
-                            sum_path_node_dist_node_space += weight * (unpacked_b - unpacked_a);
-                            sum_path_node_dist_nt_space += weight * (position_map[unpacked_b - shift] - position_map[unpacked_a - shift]);
-                        }
+            if (_penalize_diff_orientation){
+                std::cout << "\tnum_penalties_different_orientation";
+            }
+            if (sampled) {
+                std::cout << (layout_in_file ? "\tin_2D_space_by_nodes_ci95\tin_2D_space_by_nucleotides_ci95" : "\tin_node_space_ci95\tin_nucleotide_space_ci95");
+            }
+            std::cout << std::endl;
+        }
 
-                        if (_penalize_diff_orientation && (number_bool_packing::unpack_bit(h) != number_bool_packing::unpack_bit(i))){
-                            if (layout_in_file) {
-                                sum_path_node_dist_2D_space += 2 * euclidean_distance_2D;
-                            }else{
-                                sum_path_node_dist_node_space += 2 * (unpacked_b - unpacked_a);
-                                sum_path_node_dist_nt_space += 2 * (position_map[unpacked_b - shift] - position_map[unpacked_a - shift]);
-                            }
+        for (uint64_t k = 0; k < paths.size(); ++k) {
+            const auto& m = path_metrics[k];
+            const std::string path_name = graph.get_path_name(paths[k]);
 
-                            num_penalties_diff_orientation++;
-                        }
+            /// this could land in the YAML, but we don't force it, because we don't need it for the MultiQC module
+            if (args::get(path_statistics)) {
+                if (_multiqc || _yaml) {
+                    std::cout << "  - distance:" << std::endl;
+                    std::cout << "      path: " << path_name << std::endl;
+                    if (layout_in_file) {
+                        std::cout << "      in_2D_space_by_nodes: " << (double)m.dist_2D_space / (double)m.len_node_space << std::endl;
+                        std::cout << "      in_2D_space_by_nucleotides: " << (double)m.dist_2D_space / (double)m.len_nt_space << std::endl;
+                        std::cout << "      nodes: " << m.len_node_space << std::endl;
+                        std::cout << "      nucleotides: " << m.len_nt_space << std::endl;
+                    } else {
+                        std::cout << "      in_node_space: " << (double)m.dist_node_space / (double)m.len_node_space << std::endl;
+                        std::cout << "      in_nucleotide_space: " << (double)m.dist_nt_space / (double)m.len_nt_space << std::endl;
+                        std::cout << "      nodes: " << m.len_node_space << std::endl;
+                        std::cout << "      nucleotides: " << m.len_nt_space << std::endl;
+                        std::cout << "      num_penalties: " << m.num_penalties << std::endl;
+                    }
+                    if (_penalize_diff_orientation || _multiqc) {
+                        std::cout << "      num_penalties_different_orientation: " << m.num_penalties_diff_orientation << std::endl;
+                    }
+                } else {
+                    if (layout_in_file) {
+                        std::cout << path_name << "\t" << (double)m.dist_2D_space / (double)m.len_node_space << "\t" << (double)m.dist_2D_space / (double)m.len_nt_space << "\t" << m.len_node_space << "\t" << m.len_nt_space;
+                    }else{
+                        std::cout << path_name << "\t" << (double)m.dist_node_space / (double)m.len_node_space << "\t" << (double)m.dist_nt_space / (double)m.len_nt_space << "\t" << m.len_node_space << "\t" << m.len_nt_space  << "\t" << m.num_penalties;
                     }
 
-                    len_path_node_space++;
-                    len_path_nt_space += graph.get_length(h);
-                });
-
-				// add end of path so the best metric equals 1
-				sum_path_node_dist_node_space++;
-				sum_path_node_dist_nt_space += graph.get_length(last_handle);
-
-				/// this could land in the YAML, but we don't force it, because we don't need it for the MultiQC module
-                if (args::get(path_statistics)) {
-                	if (_multiqc || _yaml) {
-						std::cout << "  - distance:" << std::endl;
-						std::cout << "      path: " << graph.get_path_name(path) << std::endl;
-						if (layout_in_file) {
-							std::cout << "      in_2D_space_by_nodes: " << (double)sum_path_node_dist_2D_space / (double)len_path_node_space << std::endl;
-							std::cout << "      in_2D_space_by_nucleotides: " << (double)sum_path_node_dist_2D_space / (double)len_path_nt_space << std::endl;
-							std::cout << "      nodes: " << len_path_node_space << std::endl;
-							std::cout << "      nucleotides: " << len_path_nt_space << std::endl;
-						} else {
-							std::cout << "      in_node_space: " << (double)sum_path_node_dist_node_space / (double)len_path_node_space << std::endl;
-							std::cout << "      in_nucleotide_space: " << (double)sum_path_node_dist_nt_space / (double)len_path_nt_space << std::endl;
-							std::cout << "      nodes: " << len_path_node_space << std::endl;
-							std::cout << "      nucleotides: " << len_path_nt_space << std::endl;
-							std::cout << "      num_penalties: " << num_penalties << std::endl;
-						}
-						if (_penalize_diff_orientation || _multiqc) {
-							std::cout << "      num_penalties_different_orientation: " << num_penalties_diff_orientation << std::endl;
-						}
-                	} else {
-						if (layout_in_file) {
-							std::cout << graph.get_path_name(path) << "\t" << (double)sum_path_node_dist_2D_space / (double)len_path_node_space << "\t" << (double)sum_path_node_dist_2D_space / (double)len_path_nt_space << "\t" << len_path_node_space << "\t" << len_path_nt_space;
-						}else{
-							std::cout << graph.get_path_name(path) << "\t" << (double)sum_path_node_dist_node_space / (double)len_path_node_space << "\t" << (double)sum_path_node_dist_nt_space / (double)len_path_nt_space << "\t" << len_path_node_space << "\t" << len_path_nt_space  << "\t" << num_penalties;
-						}
-
-						if (_penalize_diff_orientation){
-							std::cout << "\t" << num_penalties_diff_orientation << std::endl;
-						}else{
-							std::cout << std::endl;
-						}
-					}
+                    if (_penalize_diff_orientation){
+                        std::cout << "\t" << m.num_penalties_diff_orientation << std::endl;
+                    }else{
+                        std::cout << std::endl;
+                    }
                 }
+            }
 
-                sum_all_path_node_dist_node_space += sum_path_node_dist_node_space;
-                sum_all_path_node_dist_nt_space += sum_path_node_dist_nt_space;
-                sum_all_path_node_dist_2D_space += sum_path_node_dist_2D_space;
-                len_all_path_node_space += len_path_node_space;
-                len_all_path_nt_space += len_path_nt_space;
-                num_all_penalties += num_penalties;
-                num_all_penalties_diff_orientation += num_penalties_diff_orientation;
-            });
+            sum_all_path_node_dist_node_space += m.dist_node_space;
+            sum_all_path_node_dist_nt_space += m.dist_nt_space;
+            sum_all_path_node_dist_2D_space += m.dist_2D_space;
+            len_all_path_node_space += m.len_node_space;
+            len_all_path_nt_space += m.len_nt_space;
+            num_all_penalties += m.num_penalties;
+            num_all_penalties_diff_orientation += m.num_penalties_diff_orientation;
+        }
 
-            if (_multiqc || _yaml) {
-				std::cout << "  - distance:" << std::endl;
-				std::cout << "      path: " << "all_paths" << std::endl;
-				if (layout_in_file) {
-					std::cout << "      in_2D_space_by_nodes: " << (double)sum_all_path_node_dist_2D_space / (double)len_all_path_node_space << std::endl;
-					std::cout << "      in_2D_space_by_nucleotides: " << (double)sum_all_path_node_dist_2D_space / (double)len_all_path_nt_space << std::endl;
-					std::cout << "      nodes: " << len_all_path_node_space << std::endl;
-					std::cout << "      nucleotides: " << len_all_path_nt_space << std::endl;
-				} else {
-					std::cout << "      in_node_space: " << (double)sum_all_path_node_dist_node_space / (double)len_all_path_node_space << std::endl;
-					std::cout << "      in_nucleotide_space: " << (double)sum_all_path_node_dist_nt_space / (double)len_all_path_nt_space << std::endl;
-					std::cout << "      nodes: " << len_all_path_node_space << std::endl;
-					std::cout << "      nucleotides: " << len_all_path_nt_space << std::endl;
-					std::cout << "      num_penalties: " << num_all_penalties << std::endl;
-				}
-				if (_penalize_diff_orientation || _multiqc) {
-					std::cout << "      num_penalties_different_orientation: " << num_all_penalties_diff_orientation << std::endl;
-				}
+        // the distances by node and by nucleotide, in 2D or in 1D
+        const auto distance = [&](const path_metrics_t& m, const bool& by_nodes) {
+            return layout_in_file ? m.dist_2D_space : (double)(by_nodes ? m.dist_node_space : m.dist_nt_space);
+        };
+        const double ci_by_nodes = sampled ? ratio_ci95([&](const path_metrics_t& m) { return distance(m, true); },
+                                                        [](const path_metrics_t& m) { return (double)m.len_node_space; }) : 0;
+        const double ci_by_nucleotides = sampled ? ratio_ci95([&](const path_metrics_t& m) { return distance(m, false); },
+                                                              [](const path_metrics_t& m) { return (double)m.len_nt_space; }) : 0;
+        if (_multiqc || _yaml) {
+            std::cout << "  - distance:" << std::endl;
+            std::cout << "      path: " << "all_paths" << std::endl;
+            if (layout_in_file) {
+                std::cout << "      in_2D_space_by_nodes: " << (double)sum_all_path_node_dist_2D_space / (double)len_all_path_node_space << std::endl;
+                std::cout << "      in_2D_space_by_nucleotides: " << (double)sum_all_path_node_dist_2D_space / (double)len_all_path_nt_space << std::endl;
+                std::cout << "      nodes: " << len_all_path_node_space << std::endl;
+                std::cout << "      nucleotides: " << len_all_path_nt_space << std::endl;
             } else {
-				if (layout_in_file) {
-					std::cout << "all_paths\t" << (double)sum_all_path_node_dist_2D_space / (double)len_all_path_node_space << "\t" << (double)sum_all_path_node_dist_2D_space / (double)len_all_path_nt_space << "\t" << len_all_path_node_space << "\t" << len_all_path_nt_space;
-				}else{
-					std::cout << "all_paths\t" << (double)sum_all_path_node_dist_node_space / (double)len_all_path_node_space << "\t" << (double)sum_all_path_node_dist_nt_space / (double)len_all_path_nt_space << "\t" << len_all_path_node_space << "\t" << len_all_path_nt_space << "\t" << num_all_penalties;
-				}
+                std::cout << "      in_node_space: " << (double)sum_all_path_node_dist_node_space / (double)len_all_path_node_space << std::endl;
+                std::cout << "      in_nucleotide_space: " << (double)sum_all_path_node_dist_nt_space / (double)len_all_path_nt_space << std::endl;
+                std::cout << "      nodes: " << len_all_path_node_space << std::endl;
+                std::cout << "      nucleotides: " << len_all_path_nt_space << std::endl;
+                std::cout << "      num_penalties: " << num_all_penalties << std::endl;
+            }
+            if (_penalize_diff_orientation || _multiqc) {
+                std::cout << "      num_penalties_different_orientation: " << num_all_penalties_diff_orientation << std::endl;
+            }
+            if (sampled) {
+                std::cout << (layout_in_file ? "      in_2D_space_by_nodes_ci95: " : "      in_node_space_ci95: ") << ci_by_nodes << std::endl;
+                std::cout << (layout_in_file ? "      in_2D_space_by_nucleotides_ci95: " : "      in_nucleotide_space_ci95: ") << ci_by_nucleotides << std::endl;
+            }
+        } else {
+            if (layout_in_file) {
+                std::cout << "all_paths\t" << (double)sum_all_path_node_dist_2D_space / (double)len_all_path_node_space << "\t" << (double)sum_all_path_node_dist_2D_space / (double)len_all_path_nt_space << "\t" << len_all_path_node_space << "\t" << len_all_path_nt_space;
+            }else{
+                std::cout << "all_paths\t" << (double)sum_all_path_node_dist_node_space / (double)len_all_path_node_space << "\t" << (double)sum_all_path_node_dist_nt_space / (double)len_all_path_nt_space << "\t" << len_all_path_node_space << "\t" << len_all_path_nt_space << "\t" << num_all_penalties;
+            }
 
-				if (_penalize_diff_orientation){
-					std::cout << "\t" << num_all_penalties_diff_orientation << std::endl;
-				}else{
-					std::cout << std::endl;
-				}
-			}
+            if (_penalize_diff_orientation){
+                std::cout << "\t" << num_all_penalties_diff_orientation;
+            }
+            if (sampled) {
+                std::cout << "\t" << ci_by_nodes << "\t" << ci_by_nucleotides;
+            }
+            std::cout << std::endl;
         }
     }
 
-
-    // Put path handles in a vector to work on them in parallel
-    std::vector<path_handle_t> paths;
-    paths.reserve(graph.get_path_count());
-
-    // Check if we are going to use the vector with the path handles
-    if (args::get(weighted_feedback_arc) || args::get(weighted_reversing_join) || args::get(links_length_per_nuc)) {
-        graph.for_each_path_handle([&](const path_handle_t path) {
-            paths.push_back(path);
-        });
-    }
-
-    if (args::get(weighted_feedback_arc)) {
+    if (show_weighted_feedback_arc) {
 		if (_multiqc || _yaml) {
 			std::cout << "weighted_feedback_arc: ";
 		} else {
 			std::cout << "path\tweighted_feedback_arc" << std::endl;
 		}
 
-        uint64_t wfa_all_paths = 0;
-
-#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
-        for (auto& path : paths) {
-            uint64_t wfa_current_path = 0;
-
-            graph.for_each_step_in_path(path, [&](const step_handle_t &occ) {
-                handle_t h = graph.get_handle_of_step(occ);
-
-                if (graph.has_next_step(occ)){
-                    handle_t i = graph.get_handle_of_step(graph.get_next_step(occ));
-
-                    uint64_t unpacked_a = number_bool_packing::unpack_number(h);
-                    uint64_t unpacked_b = number_bool_packing::unpack_number(i);
-
-                    // Check if it is a feedback arc (edge joining out-sides with in-sides such that the outside node does not precede the inside node)
-                    if (
-                        (!graph.get_is_reverse(h) && !graph.get_is_reverse(i) && unpacked_a >= unpacked_b) ||
-                        ( graph.get_is_reverse(h) &&  graph.get_is_reverse(i) && unpacked_a <= unpacked_b)
-                    ) {
-                        wfa_current_path += 1;
-                    }
-                }
-            });
-
+        uint64_t wfa_all_paths = feedback_arcs_by_edge_depths;
+        for (uint64_t k = 0; k < paths.size(); ++k) {
             if (args::get(path_statistics)) {
-#pragma omp critical (cout)
-                std::cout << graph.get_path_name(path) << "\t" << wfa_current_path << std::endl;
+                std::cout << graph.get_path_name(paths[k]) << "\t" << path_metrics[k].feedback_arcs << std::endl;
             }
-
-#pragma omp critical (wfa_all_paths)
-            wfa_all_paths += wfa_current_path;
+            wfa_all_paths += path_metrics[k].feedback_arcs;
         }
 		if (_multiqc || _yaml) {
 			std::cout << wfa_all_paths << std::endl;
@@ -840,42 +1168,19 @@ int main_stats(int argc, char** argv) {
 		}
     }
 
-    if (args::get(weighted_reversing_join)) {
+    if (show_weighted_reversing_join) {
 		if (_multiqc || _yaml) {
 			std::cout << "weighted_reversing_join: ";
 		} else {
 			std::cout << "path\tweighted_reversing_join" << std::endl;
 		}
 
-        uint64_t wrj_all_paths = 0;
-
-#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
-        for (auto& path : paths) {
-            uint64_t wrj_current_path = 0;
-
-            graph.for_each_step_in_path(path, [&](const step_handle_t &occ) {
-                handle_t h = graph.get_handle_of_step(occ);
-
-                if (graph.has_next_step(occ)){
-                    handle_t i = graph.get_handle_of_step(graph.get_next_step(occ));
-
-                    uint64_t unpacked_a = number_bool_packing::unpack_number(h);
-                    uint64_t unpacked_b = number_bool_packing::unpack_number(i);
-
-                    // Check if it is a reversing arc (edges joining two in- or two out-sides)
-                    if (graph.get_is_reverse(h) != graph.get_is_reverse(i)) {
-                        wrj_current_path += 1;
-                    }
-                }
-            });
-
+        uint64_t wrj_all_paths = reversing_joins_by_edge_depths;
+        for (uint64_t k = 0; k < paths.size(); ++k) {
             if (args::get(path_statistics)) {
-#pragma omp critical (cout)
-                std::cout << graph.get_path_name(path) << "\t" << wrj_current_path << std::endl;
+                std::cout << graph.get_path_name(paths[k]) << "\t" << path_metrics[k].reversing_joins << std::endl;
             }
-
-#pragma omp critical (cout)
-            wrj_all_paths += wrj_current_path;
+            wrj_all_paths += path_metrics[k].reversing_joins;
         }
 		if (_multiqc || _yaml) {
 			std::cout << wrj_all_paths << std::endl;
@@ -884,98 +1189,18 @@ int main_stats(int argc, char** argv) {
 		}
     }
 
-	std::atomic<uint64_t> total_links_length = 0;
-	std::atomic<uint64_t> total_num_nuc = 0;
-
-	if (args::get(links_length_per_nuc)) {
+	if (show_links_length_per_nuc) {
 		if (_multiqc || _yaml) {
 			std::cout << "links_length_per_nuc: ";
 		} else {
 			std::cout << "path\tlinks_length_per_nuc" << std::endl;
 		}
-		// TODO maybe combine this with other position_maps?
-		std::vector<uint64_t> pan_pos(graph.get_node_count());
-		uint64_t pos = 0;
-		graph.for_each_handle([&](const handle_t &h) {
-			pan_pos[number_bool_packing::unpack_number(h) - shift] = pos;
-			uint64_t hl = graph.get_length(h);
-			pos += hl;
-#ifdef debug_odgi_viz
-			std::cerr << "SEGMENT ID: " << graph.get_id(h) << " - " << as_integer(h) << " - index_in_position_map (" << number_bool_packing::unpack_number(h) << ") = " << len << std::endl;
-#endif
-		});
-
-#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
-		for (auto& path : paths) {
-			uint64_t links_len_curr_path = 0;
-			uint64_t nuc_curr_path = 0;
-			std::set<uint64_t> ordered_unpacked_numbers_in_path; // ordered set to retain the positions order
-
-			graph.for_each_step_in_path(path, [&](const step_handle_t &occ) {
-				ordered_unpacked_numbers_in_path.insert(number_bool_packing::unpack_number(graph.get_handle_of_step(occ)));
-			});
-
-			graph.for_each_step_in_path(path, [&](const step_handle_t &occ) {
-				handle_t h = graph.get_handle_of_step(occ);
-				nuc_curr_path += graph.get_length(h);
-
-				if (graph.has_next_step(occ)) {
-					handle_t i = graph.get_handle_of_step(graph.get_next_step(occ));
-					uint64_t unpacked_h = number_bool_packing::unpack_number(h);
-					uint64_t unpacked_i = number_bool_packing::unpack_number(i);
-					uint64_t pos_h = pan_pos[unpacked_h - shift];
-					uint64_t pos_i = pan_pos[unpacked_i - shift];
-					uint64_t len_h = graph.get_length(h);
-					uint64_t len_i = graph.get_length(i);
-					uint64_t nid_h = graph.get_id(h);
-					uint64_t nid_i = graph.get_id(i);
-					bool is_rev_h = graph.get_is_reverse(h);
-					bool is_rev_i = graph.get_is_reverse(i);
-
-					/// f means forward oriented step, r means reverse oriented step
-
-					/// handle_h: f, handle_i: f
-					if (!is_rev_h && !is_rev_i) {
-						/// nid_h <= nid_i
-						if (nid_h <= nid_i) {
-							/// If we have a gap link, we don't count up
-							if (next(ordered_unpacked_numbers_in_path.find(unpacked_h)) != ordered_unpacked_numbers_in_path.find(unpacked_i)) {
-								links_len_curr_path += pos_i - (pos_h + len_h);
-							}
-							/// nid_h > nid_i
-						} else {
-							links_len_curr_path += pos_h - pos_i + len_h;
-						}
-						/// handle_h: f, handle_i: r
-					} else if (!is_rev_h && is_rev_i) {
-						if (nid_h <= nid_i) {
-							links_len_curr_path += pos_i + len_i - (pos_h + len_h);
-							/// nid_h > nid_i
-						} else {
-							links_len_curr_path += pos_h - pos_i - len_i + len_h;
-						}
-						/// handle_h: r, handle_i: f
-					} else if (is_rev_h && !is_rev_i) {
-						if (nid_h <= nid_i) {
-							links_len_curr_path += pos_i - pos_h;
-							/// nid_h > nid_i
-						} else {
-							links_len_curr_path += pos_h - pos_i + len_h + len_i;
-						}
-						/// handle_h: r, handle_i: r
-					} else {
-						if (nid_h <= nid_i) {
-							links_len_curr_path += pos_i - pos_h + len_h + len_i;
-							/// nid_h > nid_i
-						} else {
-							links_len_curr_path += pos_h - (pos_i + len_i);
-						}
-					}
-				}
-			});
 
-			total_links_length += links_len_curr_path;
-			total_num_nuc += nuc_curr_path;
+		uint64_t total_links_length = 0;
+		uint64_t total_num_nuc = 0;
+		for (auto& m : path_metrics) {
+			total_links_length += m.links_length;
+			total_num_nuc += m.len_nt_space;
 		}
 
 		double result_links_length_per_nuc = (double)total_links_length / (double) total_num_nuc;
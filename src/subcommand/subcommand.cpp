@@ -1,6 +1,7 @@
 // subcommand.cpp: subcommand registry system implementation
 
 #include "subcommand.hpp"
+#include "algorithms/profile.hpp"
 
 #include <algorithm>
 #include <utility>
@@ -69,6 +70,7 @@ const int& Subcommand::get_priority() const {
 }
 
 const int Subcommand::operator()(int argc, char** argv) const {
+    algorithms::profile::scope_t profile_scope("odgi " + name);
     return main_function(argc, argv);
 }
 
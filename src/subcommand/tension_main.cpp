@@ -4,6 +4,7 @@
 #include "args.hxx"
 #include <omp.h>
 #include "algorithms/layout.hpp"
+#include "algorithms/readahead.hpp"
 #include "algorithms/tension/tension_bed_records_queued_writer.hpp"
 #include <numeric>
 #include "progress.hpp"
@@ -74,7 +75,7 @@ int main_tension(int argc, char **argv) {
         if (infile == "-") {
             graph.deserialize(std::cin);
         } else {
-            ifstream f(infile.c_str());
+            algorithms::readahead_ifstream_t f(infile);
             graph.deserialize(f);
             f.close();
         }
@@ -87,9 +88,7 @@ int main_tension(int argc, char **argv) {
             if (infile == "-") {
                 layout.load(std::cin);
             } else {
-                ifstream f(infile.c_str());
-                layout.load(f);
-                f.close();
+                layout.load(infile);
             }
         }
     }
@@ -109,8 +108,43 @@ int main_tension(int argc, char **argv) {
     graph.for_each_path_handle([&] (const path_handle_t &p) {
        paths.push_back(p);
     });
-
-
+	// the layout decoded once into contiguous coordinates, the start and end point of each node
+	const std::vector<double> X = layout.get_X();
+	const std::vector<double> Y = layout.get_Y();
+	// the layout distances of the steps of a path: within[i] across the node of step i, and link[i]
+	// from the node of the step before it, 0 for the first step unless the path is circular
+	auto step_distances = [&](const path_handle_t& p,
+							  std::vector<handle_t>& handles,
+							  std::vector<double>& within,
+							  std::vector<double>& link) {
+		handles.clear();
+		graph.visit_steps_in_path(p, [&](const step_handle_t &s) {
+			handles.push_back(graph.get_handle_of_step(s));
+		});
+		const uint64_t n = handles.size();
+		const bool circular = n && graph.has_previous_step(graph.path_begin(p));
+		// gather the point pairs, the node ends for within and the exit of the previous node and entry of this one for link
+		std::vector<double> ax(2 * n), ay(2 * n), bx(2 * n), by(2 * n);
+		for (uint64_t i = 0; i < n; ++i) {
+			const handle_t& h = handles[i];
+			const uint64_t start = 2 * number_bool_packing::unpack_number(h);
+			ax[i] = X[start]; ay[i] = Y[start];
+			bx[i] = X[start + 1]; by[i] = Y[start + 1];
+			const uint64_t entry = start + number_bool_packing::unpack_bit(h);
+			uint64_t exit = entry;
+			if (i > 0 || circular) {
+				const handle_t& prev_h = handles[i > 0 ? i - 1 : n - 1];
+				exit = 2 * number_bool_packing::unpack_number(prev_h) + !number_bool_packing::unpack_bit(prev_h);
+			}
+			ax[n + i] = X[exit]; ay[n + i] = Y[exit];
+			bx[n + i] = X[entry]; by[n + i] = Y[entry];
+		}
+		std::vector<double> dists(2 * n);
+		algorithms::layout::coord_dists(ax.data(), ay.data(), bx.data(), by.data(), dists.data(), 2 * n);
+		within.assign(dists.begin(), dists.begin() + n);
+		link.assign(dists.begin() + n, dists.end());
+		return circular;
+	};
 	if (node_sized_windows || window_size) {
 		std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress_meter;
 		if (progress) {
@@ -119,80 +153,26 @@ int main_tension(int argc, char **argv) {
 		}
 		algorithms::bed_records_class bed;
 		bed.open_writer();
-#pragma omp parallel for schedule(static, 1) num_threads(thread_count)
+#pragma omp parallel for schedule(dynamic, 1) num_threads(thread_count)
 		for (auto p: paths) {
 			std::string path_name = graph.get_path_name(p);
 			uint64_t cur_window_start = 1;
 			uint64_t cur_window_end = 0;
 			double path_layout_dist = 0;
 			uint64_t path_nuc_dist = 0;
-			graph.for_each_step_in_path(p, [&](const step_handle_t &s) {
-				handle_t h = graph.get_handle_of_step(s);
-				algorithms::xy_d_t h_coords_start;
-				algorithms::xy_d_t h_coords_end;
-				if (graph.get_is_reverse(h)) {
-					h_coords_start = layout.coords(graph.flip(h));
-					h_coords_end = layout.coords(h);
-				} else {
-					h_coords_start = layout.coords(h);
-					h_coords_end = layout.coords(graph.flip(h));
-				}
-				// TODO refactor into function start
+			std::vector<handle_t> handles;
+			std::vector<double> within, link;
+			const bool circular = step_distances(p, handles, within, link);
+			for (uint64_t i = 0; i < handles.size(); ++i) {
+				const handle_t& h = handles[i];
+				path_layout_dist += within[i];
 				// did we hit the first step?
-				if (graph.has_previous_step(s)) {
-					step_handle_t prev_s = graph.get_previous_step(s);
-					handle_t prev_h = graph.get_handle_of_step(prev_s);
-					algorithms::xy_d_t prev_h_coords_start;
-					algorithms::xy_d_t prev_h_coords_end;
-					if (graph.get_is_reverse(prev_h)) {
-						prev_h_coords_start = layout.coords(graph.flip(prev_h));
-						prev_h_coords_end = layout.coords(prev_h);
-					} else {
-						prev_h_coords_start = layout.coords(prev_h);
-						prev_h_coords_end = layout.coords(graph.flip(prev_h));
-					}
-					double within_node_dist = 0;
-					double from_node_to_node_dist = 0;
-					if (!graph.get_is_reverse(prev_h)) {
-						/// f + f
-						if (!graph.get_is_reverse(h)) {
-							within_node_dist = algorithms::layout::coord_dist(h_coords_start, h_coords_end);
-							from_node_to_node_dist = algorithms::layout::coord_dist(prev_h_coords_end, h_coords_start);
-						} else {
-							/// f + r
-							within_node_dist = algorithms::layout::coord_dist(h_coords_start, h_coords_end);
-							from_node_to_node_dist = algorithms::layout::coord_dist(prev_h_coords_end, h_coords_end);
-						}
-					} else {
-						/// r + r
-						if (graph.get_is_reverse(h)) {
-							within_node_dist = algorithms::layout::coord_dist(h_coords_end, h_coords_start);
-							from_node_to_node_dist = algorithms::layout::coord_dist(prev_h_coords_start, h_coords_end);
-						} else {
-							/// r + f
-							within_node_dist = algorithms::layout::coord_dist(h_coords_end, h_coords_start);
-							from_node_to_node_dist = algorithms::layout::coord_dist(prev_h_coords_start,
-																					h_coords_start);
-						}
-					}
-					path_layout_dist += within_node_dist;
-					path_layout_dist += from_node_to_node_dist;
-					uint64_t nuc_dist = graph.get_length(h);
-					path_nuc_dist += nuc_dist;
-					cur_window_end += nuc_dist;
-				} else {
-					// we only take a look at the current node
-					/// f
-					if (!graph.get_is_reverse(h)) {
-						path_layout_dist += algorithms::layout::coord_dist(h_coords_start, h_coords_end);
-					} else {
-						/// r
-						path_layout_dist += algorithms::layout::coord_dist(h_coords_end, h_coords_start);
-					}
-					uint64_t nuc_dist = graph.get_length(h);
-					path_nuc_dist += nuc_dist;
-					cur_window_end += nuc_dist;
-				} // TODO refactor into function end
+				if (i > 0 || circular) {
+					path_layout_dist += link[i];
+				}
+				uint64_t nuc_dist = graph.get_length(h);
+				path_nuc_dist += nuc_dist;
+				cur_window_end += nuc_dist;
 				// we add a new bed entry for each step
 				if (node_sized_windows) {
 					double path_layout_nuc_dist_ratio = (double) path_layout_dist / (double) path_nuc_dist;
@@ -220,7 +200,7 @@ int main_tension(int argc, char **argv) {
 					path_layout_dist = 0;
 					path_nuc_dist = 0;
 				}
-			});
+			}
 			/// we have to add the last window
 			// we add a new bed entry for each step
 			if (!node_sized_windows) {
@@ -252,86 +232,26 @@ int main_tension(int argc, char **argv) {
 					paths.size(), "[odgi::tension::main] Pangenome Mode Progress:");
 		}
 		// std::cout << "TEST\tPANGENOME\tMODE" << std::endl;
-#pragma omp parallel for schedule(static, 1) num_threads(thread_count) shared(node_tensions)
+#pragma omp parallel for schedule(dynamic, 1) num_threads(thread_count) shared(node_tensions)
 		for (auto p: paths) {
-			double path_layout_dist;
-			uint64_t path_nuc_dist;
-			graph.for_each_step_in_path(p, [&](const step_handle_t &s) {
-				path_layout_dist = 0;
-				path_nuc_dist = 0;
-				handle_t h = graph.get_handle_of_step(s);
-				algorithms::xy_d_t h_coords_start;
-				algorithms::xy_d_t h_coords_end;
-				if (graph.get_is_reverse(h)) {
-					h_coords_start = layout.coords(graph.flip(h));
-					h_coords_end = layout.coords(h);
-				} else {
-					h_coords_start = layout.coords(h);
-					h_coords_end = layout.coords(graph.flip(h));
+			std::vector<handle_t> handles;
+			std::vector<double> within, link;
+			const bool circular = step_distances(p, handles, within, link);
+			for (uint64_t i = 0; i < handles.size(); ++i) {
+				const handle_t& h = handles[i];
+				double path_layout_dist = within[i];
+				if (i > 0 || circular) {
+					path_layout_dist += link[i];
 				}
-				// TODO refactor into function start
-				// did we hit the first step?
-				if (graph.has_previous_step(s)) {
-					step_handle_t prev_s = graph.get_previous_step(s);
-					handle_t prev_h = graph.get_handle_of_step(prev_s);
-					algorithms::xy_d_t prev_h_coords_start;
-					algorithms::xy_d_t prev_h_coords_end;
-					if (graph.get_is_reverse(prev_h)) {
-						prev_h_coords_start = layout.coords(graph.flip(prev_h));
-						prev_h_coords_end = layout.coords(prev_h);
-					} else {
-						prev_h_coords_start = layout.coords(prev_h);
-						prev_h_coords_end = layout.coords(graph.flip(prev_h));
-					}
-					double within_node_dist = 0;
-					double from_node_to_node_dist = 0;
-					if (!graph.get_is_reverse(prev_h)) {
-						/// f + f
-						if (!graph.get_is_reverse(h)) {
-							within_node_dist = algorithms::layout::coord_dist(h_coords_start, h_coords_end);
-							from_node_to_node_dist = algorithms::layout::coord_dist(prev_h_coords_end, h_coords_start);
-						} else {
-							/// f + r
-							within_node_dist = algorithms::layout::coord_dist(h_coords_start, h_coords_end);
-							from_node_to_node_dist = algorithms::layout::coord_dist(prev_h_coords_end, h_coords_end);
-						}
-					} else {
-						/// r + r
-						if (graph.get_is_reverse(h)) {
-							within_node_dist = algorithms::layout::coord_dist(h_coords_end, h_coords_start);
-							from_node_to_node_dist = algorithms::layout::coord_dist(prev_h_coords_start, h_coords_end);
-						} else {
-							/// r + f
-							within_node_dist = algorithms::layout::coord_dist(h_coords_end, h_coords_start);
-							from_node_to_node_dist = algorithms::layout::coord_dist(prev_h_coords_start,
-																					h_coords_start);
-						}
-					}
-					path_layout_dist += within_node_dist;
-					path_layout_dist += from_node_to_node_dist;
-					uint64_t nuc_dist = graph.get_length(h);
-					path_nuc_dist += nuc_dist;
-					// cur_window_end += nuc_dist;
-				} else {
-					// we only take a look at the current node
-					/// f
-					if (!graph.get_is_reverse(h)) {
-						path_layout_dist += algorithms::layout::coord_dist(h_coords_start, h_coords_end);
-					} else {
-						/// r
-						path_layout_dist += algorithms::layout::coord_dist(h_coords_end, h_coords_start);
-					}
-					uint64_t nuc_dist = graph.get_length(h);
-					path_nuc_dist += nuc_dist;
-					// cur_window_end += nuc_dist;
-				} // TODO refactor into function end
+				uint64_t path_nuc_dist = graph.get_length(h);
 				double tension = (double)path_layout_dist / (double)path_nuc_dist;
 				if (tension < 1.0) {
 					tension = 1 / tension;
 				}
-
-				node_tensions[graph.get_id(h)] = node_tensions[graph.get_id(h)] + tension;
-			});
+				// paths over the same node add up from several threads
+#pragma omp atomic
+				node_tensions[graph.get_id(h)] += tension;
+			}
 			if (progress) {
 				progress_meter->increment(1);
 			}
@@ -6,6 +6,7 @@
 #include <random>
 #include <deque>
 #include "utils.hpp"
+#include <atomic_bitvector.hpp>
 
 namespace odgi {
 
@@ -31,7 +32,7 @@ int main_unitig(int argc, char** argv) {
     args::ValueFlag<uint64_t> unitig_plus(unitig_opts, "N", "Continue unitigs with a random walk in the graph by *N* past their natural end.", {'p', "sample-plus"});
     args::ValueFlag<uint64_t> min_begin_node_length(unitig_opts, "N", "Only begin unitigs collection from nodes which have at least length *N*.", {'l', "min-begin-node-length"});
 	args::Group threading(parser, "[ Threading ]");
-	args::ValueFlag<uint64_t> nthreads(threading, "N", "Number of threads to use for parallel operations.", {'t', "threads"});
+	args::ValueFlag<uint64_t> nthreads(threading, "N", "Number of threads to use to discover the unitigs over ranges of nodes. With more than one thread the set of unitigs can depend on which thread first claims their start nodes.", {"threads"});
 	args::Group processing_info_opts(parser, "[ Processing Information ]");
 	args::Flag progress(processing_info_opts, "progress", "Write the current progress to stderr.", {'P', "progress"});
     args::Group program_information(parser, "[ Program Information ]");
@@ -60,6 +61,8 @@ int main_unitig(int argc, char** argv) {
 	const uint64_t num_threads = args::get(nthreads) ? args::get(nthreads) : 1;
 
 	graph_t graph;
+    // the steps are never used here, so they are not even decoded
+    graph.set_path_loading(true);
     assert(argc > 0);
     {
         const std::string infile = args::get(dg_in_file);
@@ -73,137 +76,183 @@ int main_unitig(int argc, char** argv) {
     }
 
     uint64_t max_id = 0;
+    // unitigs are discovered over ranges of the node handles, in iteration order
+    std::vector<handle_t> handles;
+    handles.reserve(graph.get_node_count());
     graph.for_each_handle([&](const handle_t& handle) {
         max_id = std::max((uint64_t)graph.get_id(handle), max_id);
+        handles.push_back(handle);
     });
 
-    std::vector<bool> seen_handles(max_id+1);
+    atomicbitvector::atomic_bv_t seen_handles(max_id+1);
     if (args::get(min_begin_node_length)) {
         const uint64_t min_length = args::get(min_begin_node_length);
-        graph.for_each_handle([&](const handle_t& handle) {
-            if (graph.get_length(handle) < min_length) {
-                seen_handles[graph.get_id(handle)] = true;
+#pragma omp parallel for schedule(static) num_threads(num_threads)
+        for (uint64_t k = 0; k < handles.size(); ++k) {
+            if (graph.get_length(handles[k]) < min_length) {
+                seen_handles.set(graph.get_id(handles[k]));
             }
-        });
+        }
     }
 
     std::random_device rseed;
-    std::mt19937 rgen(rseed()); // mersenne_twister
+    std::vector<std::mt19937> rgens; // mersenne_twister, one per thread
+    for (uint64_t t = 0; t < num_threads; ++t) {
+        rgens.emplace_back(rseed());
+    }
 
-    uint64_t unitig_num = 0;
-    graph.for_each_handle([&](const handle_t& handle) {
-        if (!seen_handles.at(graph.get_id(handle))) {
-            seen_handles[graph.get_id(handle)] = true;
-            std::unordered_set<handle_t> seen_in_unitig;
-            // extend the unitig
-            std::deque<handle_t> unitig;
-            unitig.push_back(handle);
-            handle_t curr = handle;
-            seen_in_unitig.insert(curr);
-            while (graph.get_degree(curr, false) == 1) {
-                graph.follow_edges(curr, false, [&](const handle_t& n) {
-                    curr = n;
-                });
+    uint64_t to_add = 0;
+    if (args::get(unitig_plus)) {
+        to_add = args::get(unitig_plus) * 2; // bi-ended extension
+    }
+    const bool write_fastq = args::get(fake_fastq);
 
-                if (seen_in_unitig.count(curr)) {
-                    break;
-                }
+    // each block of nodes collects the records of the unitigs it starts, minus their
+    // leading ">unitigN", which is numbered when the blocks are written in order
+    struct unitig_block_t {
+        std::string records;
+        std::vector<uint64_t> ends;
+    };
+    const uint64_t block_size = 4096;
+    const uint64_t block_count = (handles.size() + block_size - 1) / block_size;
+    const uint64_t batch_size = 4 * num_threads;
+    std::vector<unitig_block_t> blocks(std::min(batch_size, block_count));
 
-                unitig.push_back(curr);
-                seen_handles[graph.get_id(curr)] = true;
-                seen_in_unitig.insert(curr);
-            }
-            curr = handle;
-            while (graph.get_degree(curr, true) == 1) {
-                graph.follow_edges(curr, true, [&](const handle_t& n) {
-                    curr = n;
-                });
-
-                if (seen_in_unitig.count(curr)) {
-                    break;
-                }
+    auto collect_unitig = [&](const handle_t& handle, std::mt19937& rgen, unitig_block_t& block) {
+        std::unordered_set<handle_t> seen_in_unitig;
+        // extend the unitig
+        std::deque<handle_t> unitig;
+        unitig.push_back(handle);
+        handle_t curr = handle;
+        seen_in_unitig.insert(curr);
+        while (graph.get_degree(curr, false) == 1) {
+            graph.follow_edges(curr, false, [&](const handle_t& n) {
+                curr = n;
+            });
 
-                unitig.push_front(curr);
-                seen_handles[graph.get_id(curr)] = true;
-                seen_in_unitig.insert(curr);
-            }
-            // if we should extend further, do it
-            uint64_t unitig_length = 0;
-            for (auto& h : unitig) {
-                unitig_length += graph.get_length(h);
+            if (seen_in_unitig.count(curr)) {
+                break;
             }
-            uint64_t to_add = 0;
-            if (args::get(unitig_plus)) {
-                to_add = args::get(unitig_plus) * 2; // bi-ended extension
-            }
-            if (args::get(unitig_to) > unitig_length) {
-                to_add = args::get(unitig_to) - unitig_length;
-            }
-            uint64_t added_fwd = 0;
-            curr = unitig.back();
-            uint64_t i = 0;
-            while (added_fwd < to_add/2 && (i = graph.get_degree(curr, false)) > 0) {
-                std::uniform_int_distribution<uint64_t> idist(0,i);
-                uint64_t j = idist(rgen);
-                graph.follow_edges(curr, false, [&](const handle_t& h) {
-                    if (j == 0) {
-                        unitig.push_back(h);
-                        added_fwd += graph.get_length(h);
-                        curr = h;
-                        return false;
-                    } else {
-                        --j;
-                        return true;
-                    }
-                });
-            }
-            curr = unitig.front();
-            uint64_t added_rev = 0;
-            i = 0;
-            while (added_rev < to_add/2 && (i = graph.get_degree(curr, true)) > 0) {
-                std::uniform_int_distribution<uint64_t> idist(0,i);
-                uint64_t j = idist(rgen);
-                graph.follow_edges(curr, true, [&](const handle_t& h) {
-                    if (j == 0) {
-                        unitig.push_front(h);
-                        added_rev += graph.get_length(h);
-                        curr = h;
-                        return false;
-                    } else {
-                        --j;
-                        return true;
-                    }
-                });
-            }
-            unitig_length += added_fwd + added_rev;
-            if (args::get(fake_fastq)) {
-                std::cout << "@";
-            } else {
-                std::cout << ">";
-            }
-            std::cout << "unitig" << ++unitig_num;
-            std::cout << " length=" << unitig_length;
-            std::cout << " path=";
-            for (uint64_t i = 0; i < unitig.size(); ++i) {
-                auto& h = unitig.at(i);
-                std::cout << graph.get_id(h) << (graph.get_is_reverse(h) ? "-" : "+") << (i+1 < unitig.size() ? "," : "");
+
+            unitig.push_back(curr);
+            seen_handles.set(graph.get_id(curr));
+            seen_in_unitig.insert(curr);
+        }
+        curr = handle;
+        while (graph.get_degree(curr, true) == 1) {
+            graph.follow_edges(curr, true, [&](const handle_t& n) {
+                curr = n;
+            });
+
+            if (seen_in_unitig.count(curr)) {
+                break;
             }
-            std::cout << std::endl;
-            for (auto& h : unitig) {
-                std::cout << graph.get_sequence(h);
+
+            unitig.push_front(curr);
+            seen_handles.set(graph.get_id(curr));
+            seen_in_unitig.insert(curr);
+        }
+        // if we should extend further, do it
+        uint64_t unitig_length = 0;
+        for (auto& h : unitig) {
+            unitig_length += graph.get_length(h);
+        }
+        uint64_t to_add_here = to_add;
+        if (args::get(unitig_to) > unitig_length) {
+            to_add_here = args::get(unitig_to) - unitig_length;
+        }
+        uint64_t added_fwd = 0;
+        curr = unitig.back();
+        uint64_t i = 0;
+        while (added_fwd < to_add_here/2 && (i = graph.get_degree(curr, false)) > 0) {
+            std::uniform_int_distribution<uint64_t> idist(0,i);
+            uint64_t j = idist(rgen);
+            graph.follow_edges(curr, false, [&](const handle_t& h) {
+                if (j == 0) {
+                    unitig.push_back(h);
+                    added_fwd += graph.get_length(h);
+                    curr = h;
+                    return false;
+                } else {
+                    --j;
+                    return true;
+                }
+            });
+        }
+        curr = unitig.front();
+        uint64_t added_rev = 0;
+        i = 0;
+        while (added_rev < to_add_here/2 && (i = graph.get_degree(curr, true)) > 0) {
+            std::uniform_int_distribution<uint64_t> idist(0,i);
+            uint64_t j = idist(rgen);
+            graph.follow_edges(curr, true, [&](const handle_t& h) {
+                if (j == 0) {
+                    unitig.push_front(h);
+                    added_rev += graph.get_length(h);
+                    curr = h;
+                    return false;
+                } else {
+                    --j;
+                    return true;
+                }
+            });
+        }
+        unitig_length += added_fwd + added_rev;
+        std::string& out = block.records;
+        out.append(" length=");
+        out.append(std::to_string(unitig_length));
+        out.append(" path=");
+        for (uint64_t i = 0; i < unitig.size(); ++i) {
+            auto& h = unitig.at(i);
+            out.append(std::to_string(graph.get_id(h)));
+            out.push_back(graph.get_is_reverse(h) ? '-' : '+');
+            if (i+1 < unitig.size()) {
+                out.push_back(',');
             }
-            std::cout << std::endl;
-            if (args::get(fake_fastq)) {
-                std::cout << "+" << std::endl;
-                for (auto& h : unitig) {
-                    for (auto& c : graph.get_sequence(h)) {
-                        std::cout << "I";
-                    }
+        }
+        out.push_back('\n');
+        const uint64_t seq_begin = out.size();
+        for (auto& h : unitig) {
+            graph.append_sequence(h, out);
+        }
+        const uint64_t seq_length = out.size() - seq_begin;
+        out.push_back('\n');
+        if (write_fastq) {
+            out.append("+\n");
+            out.append(seq_length, 'I');
+            out.push_back('\n');
+        }
+        block.ends.push_back(out.size());
+    };
+
+    uint64_t unitig_num = 0;
+    for (uint64_t first_block = 0; first_block < block_count; first_block += batch_size) {
+        const uint64_t last_block = std::min(block_count, first_block + batch_size);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+        for (uint64_t b = first_block; b < last_block; ++b) {
+            auto& block = blocks[b - first_block];
+            block.records.clear();
+            block.ends.clear();
+            auto& rgen = rgens[omp_get_thread_num()];
+            const uint64_t end = std::min((uint64_t)handles.size(), (b + 1) * block_size);
+            for (uint64_t k = b * block_size; k < end; ++k) {
+                // claim the start node, unless a unitig already went through it
+                if (!seen_handles.set(graph.get_id(handles[k]))) {
+                    collect_unitig(handles[k], rgen, block);
                 }
-                std::cout << std::endl;
             }
         }
-    });
+        for (uint64_t b = first_block; b < last_block; ++b) {
+            const auto& block = blocks[b - first_block];
+            uint64_t begin = 0;
+            for (auto& end : block.ends) {
+                std::cout << (write_fastq ? "@" : ">") << "unitig" << ++unitig_num;
+                std::cout.write(block.records.data() + begin, end - begin);
+                begin = end;
+            }
+        }
+    }
+    std::cout.flush();
 
     return 0;
 }
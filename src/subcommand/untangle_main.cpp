@@ -58,6 +58,10 @@ int main_untangle(int argc, char **argv) {
                                                                            "When specified, no further starting points will be added.", {'c', "cut-points-input"});
     args::ValueFlag<std::string> output_cut_points(untangling_opts, "FILE", "Emit node identifiers where segment boundaries started (one identifier per row).",
                                                   {'d', "cut-points-output"});
+    args::ValueFlag<std::string> input_self_coverage(untangling_opts, "FILE", "Load the self coverage of the query paths from this FILE, "
+                                                     "as written by --self-coverage-output, instead of computing it.", {"self-coverage-input"});
+    args::ValueFlag<std::string> output_self_coverage(untangling_opts, "FILE", "Write the self coverage of the query paths to this FILE, "
+                                                      "to be reused by later runs on the same graph.", {"self-coverage-output"});
     args::Group debugging_opts(parser, "[ Debugging Options ]");
     args::Flag make_self_dotplot(debugging_opts, "DOTPLOT", "Render a table showing the positional dotplot of the query against itself.",
                                  {'S', "self-dotplot"});
@@ -226,6 +230,8 @@ int main_untangle(int argc, char **argv) {
                                  output_type,
 								 args::get(input_cut_points),
 								 args::get(output_cut_points),
+								 args::get(input_self_coverage),
+								 args::get(output_self_coverage),
 								 num_threads,
 								 progress,
 								 step_index,
@@ -244,6 +250,8 @@ int main_untangle(int argc, char **argv) {
                                  output_type,
 								 args::get(input_cut_points),
 								 args::get(output_cut_points),
+								 args::get(input_self_coverage),
+								 args::get(output_self_coverage),
 								 num_threads,
 								 progress,
 								 step_index,
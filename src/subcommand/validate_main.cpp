@@ -6,6 +6,7 @@
 #include "algorithms/bfs.hpp"
 #include <omp.h>
 #include "utils.hpp"
+#include <atomic>
 
 namespace odgi {
 
@@ -25,6 +26,8 @@ namespace odgi {
                 "Validate a graph checking if the paths are consistent with the graph topology.");
 		args::Group mandatory_opts(parser, "[ MANDATORY OPTIONS ]");
 		args::ValueFlag<std::string> og_file(mandatory_opts, "FILE", "Load the succinct variation graph in ODGI format from this *FILE*. The file name usually ends with *.og*. It also accepts GFAv1, but the on-the-fly conversion to the ODGI format requires additional time!", {'i', "input"});
+        args::Group validate_opts(parser, "[ Validate Options ]");
+        args::Flag early_exit(validate_opts, "early-exit", "Stop at the first inconsistency found and report only that one, instead of reporting all of them.", {'e', "early-exit"});
         args::Group threading(parser, "[ Threading ]");
         args::ValueFlag<uint64_t> nthreads(threading, "N", "Number of threads to use for parallel operations.", {'t', "threads"});
 		args::Group processing_info_opts(parser, "[ Processing Information ]");
@@ -68,35 +71,61 @@ namespace odgi {
 
         omp_set_num_threads(num_threads);
 
-        bool valid_graph = true;
-
         std::vector<path_handle_t> paths;
         paths.reserve(graph.get_path_count());
         graph.for_each_path_handle([&](const path_handle_t &path) {
             paths.push_back(path);
         });
 
+        // the errors of each path, gathered by the thread validating it and reported in path order
+        std::vector<std::vector<std::string>> path_errors(paths.size());
+        std::atomic<bool> found_error(false);
+        const bool stop_early = args::get(early_exit);
+
 #pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
-        for (auto path : paths) {
-            graph.for_each_step_in_path(path, [&](const step_handle_t &step) {
-                if (graph.has_next_step(step)) {
-                    step_handle_t next_step = graph.get_next_step(step);
-                    handle_t h = graph.get_handle_of_step(step);
-                    handle_t next_h = graph.get_handle_of_step(next_step);
-
-                    if (!graph.has_edge(h, next_h)) {
-#pragma omp critical (cout)
-                        std::cerr << "[odgi::validate] error: the path " << graph.get_path_name(path) << " does not "
-                                  << "respect the graph topology: the link "
-                                  << graph.get_id(h) << (graph.get_is_reverse(h) ? "-" : "+")
-                                  << ","
-                                  << graph.get_id(next_h) << (graph.get_is_reverse(next_h) ? "-" : "+")
-                                  << " is missing." << std::endl;
-
-                        valid_graph = false;
-                    }
+        for (uint64_t i = 0; i < paths.size(); ++i) {
+            if (stop_early && found_error.load(std::memory_order_relaxed)) continue;
+            const path_handle_t& path = paths[i];
+            auto& errors = path_errors[i];
+            auto check_link = [&](const handle_t& h, const handle_t& next_h) {
+                if (!graph.has_edge(h, next_h)) {
+                    errors.push_back("[odgi::validate] error: the path " + graph.get_path_name(path) + " does not "
+                                     + "respect the graph topology: the link "
+                                     + std::to_string(graph.get_id(h)) + (graph.get_is_reverse(h) ? "-" : "+")
+                                     + ","
+                                     + std::to_string(graph.get_id(next_h)) + (graph.get_is_reverse(next_h) ? "-" : "+")
+                                     + " is missing.");
+                    found_error.store(true, std::memory_order_relaxed);
                 }
+            };
+            bool has_prev = false;
+            handle_t prev;
+            const bool finished = graph.visit_steps_in_path(path, [&](const step_handle_t &step) {
+                if (stop_early && found_error.load(std::memory_order_relaxed)) return false;
+                const handle_t h = graph.get_handle_of_step(step);
+                if (has_prev) {
+                    check_link(prev, h);
+                }
+                prev = h;
+                has_prev = true;
+                return true;
             });
+            // the link from the end of a circular path back to its start
+            if (finished && has_prev) {
+                const step_handle_t last = graph.path_back(path);
+                if (graph.has_next_step(last)) {
+                    check_link(prev, graph.get_handle_of_step(graph.get_next_step(last)));
+                }
+            }
+        }
+
+        const bool valid_graph = !found_error.load();
+        for (auto& errors : path_errors) {
+            for (auto& error : errors) {
+                std::cerr << error << std::endl;
+                if (stop_early) break;
+            }
+            if (stop_early && !errors.empty()) break;
         }
 
         return (valid_graph ? 0 : 1);
@@ -1,6 +1,7 @@
 #include "subcommand.hpp"
 #include "args.hxx"
 #include "../version.hpp"
+#include "../cpu_dispatch.hpp"
 #include <cstdint>
 
 namespace odgi {
@@ -21,6 +22,7 @@ namespace odgi {
         args::Flag version(parser, "version", "Print only the version (like *v0.4.0-44-g89d022b*).", {'v', "version"});
         args::Flag codename(parser, "codename", "Print only the codename (like *back to old ABI*).", {'c', "codename"});
         args::Flag release(parser, "release", "Print only the release (like *v0.4.0*)", {'r', "release"});
+        args::Flag cpu(parser, "cpu", "Print the instruction set detected on this CPU and, for each kernel built for several, the variant it runs.", {"cpu"});
         args::Group program_information(parser, "[ Program Information ]");
         args::HelpFlag help(program_information, "help", "Print a help message for odgi version.", {'h', "help"});
 
@@ -46,6 +48,15 @@ namespace odgi {
             std::cout << Version::get_codename() << endl;
         } else if (release) {
             std::cout << Version::get_release() << endl;
+        } else if (cpu) {
+            std::cout << "cpu\t" << cpu::isa_name(cpu::detected_isa()) << endl;
+            cpu::for_each_kernel([](const cpu::kernel_info_t& kernel) {
+                std::cout << kernel.name << "\t" << cpu::isa_name(kernel.selected) << "\t";
+                for (uint64_t i = 0; i < kernel.variants.size(); ++i) {
+                    std::cout << (i ? "," : "") << cpu::isa_name(kernel.variants[i]);
+                }
+                std::cout << endl;
+            });
         } else {
             std::cout << Version::get_short() << endl;
         }
@@ -1,5 +1,6 @@
 #include "subcommand.hpp"
 #include "odgi.hpp"
+#include "mmap_graph.hpp"
 #include "args.hxx"
 #include "utils.hpp"
 
@@ -22,7 +23,12 @@ int main_view(int argc, char** argv) {
     args::ValueFlag<std::string> dg_in_file(mandatory_opts, "FILE", "Load the succinct variation graph in ODGI format from this *FILE*. The file name usually ends with *.og*. It also accepts GFAv1, but the on-the-fly conversion to the ODGI format requires additional time!", {'i', "idx"});
     args::Group out_opts(parser, "[ Output Options ]");
     args::Flag to_gfa(out_opts, "to_gfa", "Write the graph in GFAv1 format to standard output.", {'g', "to-gfa"});
+    args::ValueFlag<std::string> to_mmap(out_opts, "FILE", "Write the graph in the read-only, memory-mappable layout to this *FILE*. Commands that only read the graph can map it instead of deserializing it.", {'m', "to-mmap"});
+    args::ValueFlag<std::string> to_shm(out_opts, "NAME", "Freeze the graph in the memory-mappable layout into the POSIX shared memory segment *NAME*. Commands that accept a memory-mapped graph attach it with *-i shm:NAME*, so concurrent jobs on the host share one copy.", {"to-shm"});
+    args::ValueFlag<std::string> unlink_shm(out_opts, "NAME", "Remove the shared memory segment *NAME* written by *--to-shm*. Jobs still attached keep their mapping until they exit.", {"unlink-shm"});
     args::Flag emit_node_annotation(out_opts, "node_annotation", "Emit node annotations for the graph in GFAv1 format.", {'a', "node-annotation"});
+    args::Flag walks(out_opts, "walks", "Write the paths named following PanSN (sample#hap#ctg, optionally with a :start-end range) as GFAv1.1 W lines, the others still as P lines.", {'w', "walks"});
+    args::Flag bgzip(out_opts, "bgzip", "Compress the GFAv1 of *-g, --to-gfa* with BGZF, as bgzip does, in the threads that format it.", {"bgzip"});
     args::Flag display(out_opts, "display", "Show the internal structures of a graph. Print to stderr the maximum"
                                           " node identifier, the minimum node identifier, the nodes vector, the"
                                           " delete nodes bit vector and the path metadata, each in a separate"
@@ -49,6 +55,21 @@ int main_view(int argc, char** argv) {
         return 1;
     }
 
+    if ((args::get(bgzip) || args::get(walks)) && !args::get(to_gfa)) {
+        std::cerr << "[odgi::view] error: -w, --walks and --bgzip only apply to the GFAv1 written with -g, --to-gfa." << std::endl;
+        return 1;
+    }
+
+    if (unlink_shm) {
+        if (!mmap_graph_t::unshare(args::get(unlink_shm))) {
+            std::cerr << "[odgi::view] error: could not remove shared memory segment " << args::get(unlink_shm) << "." << std::endl;
+            return 1;
+        }
+        if (!dg_in_file) {
+            return 0;
+        }
+    }
+
     if (!dg_in_file) {
         std::cerr << "[odgi::view] error: Please specify an input file to load the graph via -i=[FILE], --idx=[FILE]." << std::endl;
         return 1;
@@ -73,7 +94,19 @@ int main_view(int argc, char** argv) {
         graph.display();
     }
     if (args::get(to_gfa)) {
-        graph.to_gfa(std::cout, args::get(emit_node_annotation));
+        graph.to_gfa(std::cout, args::get(emit_node_annotation), num_threads, args::get(bgzip), args::get(walks));
+    }
+    if (to_mmap) {
+        std::ofstream out(args::get(to_mmap), std::ios::binary);
+        if (!out) {
+            std::cerr << "[odgi::view] error: could not open " << args::get(to_mmap) << " for writing." << std::endl;
+            return 1;
+        }
+        mmap_graph_t::freeze(graph, out);
+    }
+
+    if (to_shm) {
+        mmap_graph_t::share(graph, args::get(to_shm));
     }
 
     return 0;
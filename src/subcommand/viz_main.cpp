@@ -2,13 +2,18 @@
 #include "odgi.hpp"
 #include "args.hxx"
 #include "algorithms/bin_path_info.hpp"
+#include "algorithms/bin_index.hpp"
+#include "algorithms/node_rank.hpp"
 #include "algorithms/hash.hpp"
 #include "algorithms/id_ordered_paths.hpp"
 #include "lodepng.h"
 #include <limits>
 #include <regex>
+#include <fstream>
 #include "picosha2.h"
 #include "algorithms/draw.hpp"
+#include "algorithms/sgd_snapshot.hpp"
+#include "algorithms/huge_pages.hpp"
 #include "utils.hpp"
 #include "colorbrewer.hpp"
 #include "split.hpp"
@@ -75,6 +80,7 @@ namespace odgi {
         // TODO
         args::ValueFlag<std::string> _name_prefixes(viz_opts, "FILE", "Merge paths beginning with prefixes listed (one per line) in *FILE*.", {'M', "prefix-merges"});
         args::ValueFlag<std::string> _ignore_prefix(viz_opts, "PREFIX", "Ignore paths starting with the given *PREFIX*.", {'I', "ignore-prefix"});
+        args::ValueFlag<std::string> sgd_snapshot(viz_opts, "FILE", "Order the graph by this path guided 1D SGD snapshot *FILE*, written by *odgi sort -u* on the same graph, before drawing it.", {"sgd-snapshot"});
 
         /// Range selection
         args::Group intervals_opts(parser, "[ Intervals Selection Options ]");
@@ -126,6 +132,11 @@ namespace odgi {
         args::Flag no_grey_depth(bin_opts, "bool", "Use the colorbrewer palette for <0.5x and ~1x coverage bins."
                                  " By default, these bins are light and neutral grey.",
                                  {'G', "no-grey-depth"});
+        args::ValueFlag<std::string> bin_index_file(bin_opts, "FILE", "Take the mean depth and inversion rate of the path bins from this bin index FILE,"
+                                                                      " written for the same graph with odgi bin -x, --write-index, instead of walking"
+                                                                      " the paths, also for the depth of -O, --compressed-mode."
+                                                                      " The bin width must be a multiple of the one of the index.",
+                                                                      {"bin-index"});
 
         /// Gradient mode
         args::Group grad_mode_opts(parser, "[ Gradient Mode Options ]");
@@ -148,6 +159,12 @@ namespace odgi {
 															  " is used. Alternatively, one can enter a colorbrewer palette via "
 															  "-B, --colorbrewer-palette.", {'O', "compressed-mode"});
 
+		args::Group tile_opts(parser, "[ Tiled Output Options ]");
+		args::ValueFlag<std::string> tiles_dir(tile_opts, "DIR", "Write the image as a zoomable pyramid of PNG tiles in *DIR*/zoom/x/y.png,"
+																" from a single tile at zoom 0 up to the full resolution, encoding the tiles"
+																" in parallel. Use it with -o/--out or instead of it.", {"tiles"});
+		args::ValueFlag<uint64_t> tile_size(tile_opts, "N", "The width and height in pixels of each tile (default: 256).", {"tile-size"});
+
 		args::Group threading(parser, "[ Threading ]");
 		args::ValueFlag<uint64_t> nthreads(threading, "N", "Number of threads to use for parallel operations.", {'t', "threads"});
 		args::Group processing_info_opts(parser, "[ Processing Information ]");
@@ -241,10 +258,14 @@ namespace odgi {
 
         //NOTE: this sample will overwrite the file or test.png without warning!
         //const char* filename = argc > 1 ? argv[1] : "test.png";
-        if (args::get(png_out_file).empty()) {
+        if (args::get(png_out_file).empty() && args::get(tiles_dir).empty()) {
             std::cerr << "[odgi::viz] error: output image required" << std::endl;
             return 1;
         }
+        if (tile_size && args::get(tile_size) == 0) {
+            std::cerr << "[odgi::viz] error: --tile-size has to be greater than 0." << std::endl;
+            return 1;
+        }
 
         graph_t graph;
         assert(argc > 0);
@@ -257,20 +278,33 @@ namespace odgi {
             }
         }
 
+        if (sgd_snapshot) {
+            algorithms::sgd_snapshot_t snapshot;
+            try {
+                snapshot = algorithms::read_sgd_snapshot(args::get(sgd_snapshot));
+            } catch (const std::runtime_error& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+            if (!algorithms::sgd_snapshot_matches(snapshot, graph)) {
+                std::cerr << "[odgi::viz] error: the snapshot " << args::get(sgd_snapshot)
+                          << " was not taken on a graph with the nodes of the input graph." << std::endl;
+                return 1;
+            }
+            graph.apply_ordering(algorithms::sgd_snapshot_order(graph, snapshot), true);
+        }
+
         std::vector<uint64_t> position_map(graph.get_node_count() + 1);
-        const uint64_t shift = number_bool_packing::unpack_number(graph.get_handle(graph.min_node_id()));
+        // the nodes are indexed by their rank in id order, so that the ids need not be compacted
+        const algorithms::node_rank_t node_rank(graph);
         uint64_t len = 0;
         {
-            if (number_bool_packing::unpack_number(graph.get_handle(graph.max_node_id())) - shift >= graph.get_node_count()){
-                std::cerr << "[odgi::viz] error: the node IDs are not compacted. Please run 'odgi sort' using -O, --optimize to optimize the graph." << std::endl;
-                exit(1);
-            }
             graph.for_each_handle([&](const handle_t &h) {
-                position_map[number_bool_packing::unpack_number(h) - shift] = len;
+                position_map[node_rank(h)] = len;
                 uint64_t hl = graph.get_length(h);
                 len += hl;
 #ifdef debug_odgi_viz
-                std::cerr << "SEGMENT ID: " << graph.get_id(h) << " - " << as_integer(h) << " - index_in_position_map (" << (number_bool_packing::unpack_number(h) - shift) << ") = " << len << std::endl;
+                std::cerr << "SEGMENT ID: " << graph.get_id(h) << " - " << as_integer(h) << " - index_in_position_map (" << node_rank(h) << ") = " << len << std::endl;
 #endif
             });
             position_map[position_map.size() - 1] = len;
@@ -358,7 +392,7 @@ namespace odgi {
 
                     graph.for_each_step_in_path(path_handle, [&](const step_handle_t &occ) {
                         const handle_t h = graph.get_handle_of_step(occ);
-                        uint64_t h_pan_pos = position_map[number_bool_packing::unpack_number(h) - shift];
+                        uint64_t h_pan_pos = position_map[node_rank(h)];
                         uint64_t h_len = graph.get_length(h);
 
                         //Todo dumb implementation: improve with the math later
@@ -437,6 +471,27 @@ namespace odgi {
             _bin_width = 1;
         }
 
+        algorithms::bin_index_t viz_bin_index;
+        uint64_t bin_index_factor = 0;
+        if (bin_index_file) {
+            std::ifstream f(args::get(bin_index_file), std::ios::binary);
+            if (!f || !viz_bin_index.load(f)) {
+                std::cerr << "[odgi::viz] error: " << args::get(bin_index_file) << " is not a bin index, please write one with odgi bin -x, --write-index." << std::endl;
+                return 1;
+            }
+            if (viz_bin_index.get_pangenome_length() != len) {
+                std::cerr << "[odgi::viz] error: the bin index " << args::get(bin_index_file) << " was not written for this graph." << std::endl;
+                return 1;
+            }
+            const uint64_t index_bin_width = viz_bin_index.get_bin_width();
+            if (_bin_width != std::floor(_bin_width) || ((uint64_t) _bin_width) % index_bin_width != 0) {
+                std::cerr << "[odgi::viz] error: the bin width " << _bin_width << " is not a multiple of the bin width "
+                          << index_bin_width << " of the bin index, please set it via -w, --bin-width." << std::endl;
+                return 1;
+            }
+            bin_index_factor = (uint64_t) _bin_width / index_bin_width;
+        }
+
         /*std::cerr << "real len: " << len << std::endl;
         std::cerr << "pangenomic_start_pos: " << pangenomic_start_pos << "\npangenomic_end_pos: " << pangenomic_end_pos << std::endl;
         std::cerr << "len_to_visualize: " << len_to_visualize << std::endl;*/
@@ -609,14 +664,14 @@ namespace odgi {
             // buffer to record layout bounds
             std::vector<bool> path_layout_buf;
             path_layout_buf.resize(path_count * width);
-            std::vector<path_handle_t> path_order = algorithms::id_ordered_paths(graph);
+            std::vector<path_handle_t> path_order = algorithms::id_ordered_paths(graph, true, false, num_threads);
             for (auto &path : path_order) {
                 // get the block which this path covers
                 uint64_t min_x = len_to_visualize;
                 uint64_t max_x = std::numeric_limits<uint64_t>::min(); // 0
                 graph.for_each_step_in_path(path, [&](const step_handle_t &occ) {
                     handle_t h = graph.get_handle_of_step(occ);
-                    uint64_t p = position_map[number_bool_packing::unpack_number(h) - shift];
+                    uint64_t p = position_map[node_rank(h)];
 
                     if (p >= pangenomic_start_pos && p <= pangenomic_end_pos) {
                         min_x = std::min(min_x, (uint64_t) (p - pangenomic_start_pos));
@@ -645,6 +700,7 @@ namespace odgi {
 
         std::vector<uint8_t> image;
         image.resize(width * (height + path_space) * 4, 255);
+        algorithms::huge_pages::advise(image);
 
         std::vector<uint8_t> image_path_names;
         if (!args::get(hide_path_names) && !args::get(pack_paths) && pix_per_path >= 8) {
@@ -739,8 +795,8 @@ namespace odgi {
 
         auto add_edge_from_handles = [&](const handle_t& h, const handle_t& o) {
             // map into our bins
-            const uint64_t index_h = number_bool_packing::unpack_number(h) + !number_bool_packing::unpack_bit(h) - shift;
-            const uint64_t index_o = number_bool_packing::unpack_number(o) + number_bool_packing::unpack_bit(o) - shift;
+            const uint64_t index_h = node_rank(h) + !number_bool_packing::unpack_bit(h);
+            const uint64_t index_o = node_rank(o) + number_bool_packing::unpack_bit(o);
             const uint64_t h_pos = position_map[index_h] / _bin_width;
             const uint64_t o_pos = position_map[index_o] / _bin_width;
 
@@ -787,7 +843,7 @@ namespace odgi {
             if (_binned_mode){
                 graph.for_each_handle([&](const handle_t &h) {
                     if (!is_a_handle_to_hide(h)){
-                        uint64_t p = position_map[number_bool_packing::unpack_number(h) - shift];
+                        uint64_t p = position_map[node_rank(h)];
                         uint64_t hl = graph.get_length(h);
 
                         int64_t last_bin = 0; // flag meaning "null bin"
@@ -811,7 +867,7 @@ namespace odgi {
             */
             graph.for_each_handle([&](const handle_t &h) {
                 if (!is_a_handle_to_hide(h)){
-                    uint64_t p = position_map[number_bool_packing::unpack_number(h) - shift];
+                    uint64_t p = position_map[node_rank(h)];
                     uint64_t hl = graph.get_length(h);
                     // make contents for the bases in the node
                     for (double i = 0.0; i < hl; i += 1.0 / scale_x) {
@@ -919,18 +975,27 @@ namespace odgi {
 		// Compressed-Mode part starts here :)
 		if (compress) {
 			std::map <uint64_t, algorithms::path_info_t> bins;
-			graph.for_each_path_handle([&](const path_handle_t &path) {
-				graph.for_each_step_in_path(path, [&](const step_handle_t &occ) {
-					handle_t h = graph.get_handle_of_step(occ);
-					uint64_t hl = graph.get_length(h);
-
-					uint64_t p = position_map[number_bool_packing::unpack_number(h) - shift];
-					for (uint64_t k = 0; k < hl; ++k) {
-						int64_t curr_bin = (p + k) / _bin_width + 1;
-						++bins[curr_bin].mean_depth;
-					}
+			if (bin_index_factor) {
+				// the depth of all the paths in each bin is summed up from the bin index, without walking them
+				std::map<uint64_t, uint64_t> depth;
+				viz_bin_index.get_total_depth(bin_index_factor, depth);
+				for (auto &d : depth) {
+					bins[d.first].mean_depth = d.second;
+				}
+			} else {
+				graph.for_each_path_handle([&](const path_handle_t &path) {
+					graph.for_each_step_in_path(path, [&](const step_handle_t &occ) {
+						handle_t h = graph.get_handle_of_step(occ);
+						uint64_t hl = graph.get_length(h);
+
+						uint64_t p = position_map[node_rank(h)];
+						for (uint64_t k = 0; k < hl; ++k) {
+							int64_t curr_bin = (p + k) / _bin_width + 1;
+							++bins[curr_bin].mean_depth;
+						}
+					});
 				});
-			});
+			}
 
 			/// path name part
 
@@ -1024,7 +1089,7 @@ namespace odgi {
 			/// default case:
 		} else {
 
-			graph.for_each_path_handle([&](const path_handle_t &path) {
+			auto draw_path = [&](const path_handle_t &path) {
 				int64_t path_rank = get_path_idx(path);
 				//std::cerr << graph.get_path_name(path) << " -> " << path_rank << std::endl;
 				if (path_rank >= 0 && path_layout_y[path_rank] >= 0) {
@@ -1081,6 +1146,12 @@ namespace odgi {
 							uint64_t hl, p;
 							bool is_rev;
 							uint64_t num_uncalled_bases;
+							// the uncalled bases are not in the bin index
+							const uint64_t path_bin_count = bin_index_factor && !_color_by_uncalled_bases
+								&& (_color_by_mean_depth || _color_by_mean_inversion_rate || _change_darkness)
+								? viz_bin_index.get_path_count() : 0;
+							const uint64_t path_bin_rank = path_bin_count
+								? viz_bin_index.get_path_rank(graph.get_path_name(path)) : 0;
 							graph.for_each_step_in_path(path, [&](const step_handle_t &occ) {
 								h = graph.get_handle_of_step(occ);
 								is_rev = graph.get_is_reverse(h);
@@ -1105,9 +1176,11 @@ namespace odgi {
 									path_len_to_use += hl;
 								}
 
-								if (_binned_mode &&
+								if (_binned_mode && path_bin_rank < path_bin_count) {
+									// the bins come from the bin index
+								} else if (_binned_mode &&
 									(_color_by_mean_depth || _color_by_mean_inversion_rate || _change_darkness)) {
-									p = position_map[number_bool_packing::unpack_number(h) - shift];
+									p = position_map[node_rank(h)];
 									for (uint64_t k = 0; k < hl; ++k) {
 										int64_t curr_bin = (p + k) / _bin_width + 1;
 
@@ -1117,7 +1190,7 @@ namespace odgi {
 										}
 									}
 								} else if (_binned_mode && _color_by_uncalled_bases) {
-									p = position_map[number_bool_packing::unpack_number(h) - shift];
+									p = position_map[node_rank(h)];
 									for (uint64_t k = 0; k < hl; ++k) {
 										int64_t curr_bin = (p + k) / _bin_width + 1;
 
@@ -1127,7 +1200,9 @@ namespace odgi {
 								}
 							});
 
-							if (_binned_mode &&
+							if (_binned_mode && path_bin_rank < path_bin_count) {
+								viz_bin_index.get_path_bins(path_bin_rank, bin_index_factor, bins);
+							} else if (_binned_mode &&
 								(_color_by_mean_depth || _color_by_mean_inversion_rate || _change_darkness)) {
 								for (auto &entry: bins) {
 									auto &v = entry.second;
@@ -1259,7 +1334,7 @@ namespace odgi {
 
 						graph.for_each_step_in_path(path, [&](const step_handle_t &occ) {
 							h = graph.get_handle_of_step(occ);
-							p = position_map[number_bool_packing::unpack_number(h) - shift];
+							p = position_map[node_rank(h)];
 							hl = graph.get_length(h);
 
 							// make contents for the bases in the node
@@ -1322,7 +1397,7 @@ namespace odgi {
 						/// Loop over all the steps along a path, from first through last and draw them
 						graph.for_each_step_in_path(path, [&](const step_handle_t &occ) {
 							handle_t h = graph.get_handle_of_step(occ);
-							uint64_t p = position_map[number_bool_packing::unpack_number(h) - shift];
+							uint64_t p = position_map[node_rank(h)];
 							uint64_t hl = graph.get_length(h);
 							// make contects for the bases in the node
 							uint64_t path_y = path_layout_y[path_rank];
@@ -1360,7 +1435,7 @@ namespace odgi {
 						// In binned mode, the min/max_x values changes based on the bin width; in standard mode, _bin_width is 1, so nothing changes here
 						graph.for_each_step_in_path(path, [&](const step_handle_t &occ) {
 							handle_t h = graph.get_handle_of_step(occ);
-							uint64_t p = position_map[number_bool_packing::unpack_number(h) - shift];
+							uint64_t p = position_map[node_rank(h)];
 							min_x = std::min(min_x, (uint64_t)(p / _bin_width));
 							max_x = std::max(max_x, (uint64_t)((p + graph.get_length(h)) / _bin_width));
 						});
@@ -1373,7 +1448,23 @@ namespace odgi {
 					}
 				}
 				//add_point(curr_bin - 1 - pangenomic_start_pos, 0, RGB_BIN_LINKS, RGB_BIN_LINKS, RGB_BIN_LINKS);
-			});
+			};
+
+			// With one path per row, each path only writes its own stripe of rows, so they can be drawn in parallel.
+			// Packed or merged paths share rows, and are drawn in order so the last one wins as before.
+			if (num_threads > 1 && !args::get(pack_paths) && !group_paths) {
+				std::vector<path_handle_t> paths;
+				paths.reserve(graph.get_path_count());
+				graph.for_each_path_handle([&](const path_handle_t &path) {
+					paths.push_back(path);
+				});
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+				for (uint64_t i = 0; i < paths.size(); ++i) {
+					draw_path(paths[i]);
+				}
+			} else {
+				graph.for_each_path_handle(draw_path);
+			}
 
 		}
 
@@ -1423,20 +1514,37 @@ namespace odgi {
         std::cerr << "crop_width " << crop_width << std::endl;
         std::cerr << "crop_height " << crop_height << std::endl;*/
 
-        std::vector<uint8_t> crop;
-        crop.resize(crop_width * crop_height * 4, 255);
-        for (uint64_t y = 0; y < crop_height; ++y) {
+        // the cropped image is produced row by row, from the path names and the drawing side by side
+        auto fill_crop_row = [&](const uint64_t& y, uint8_t* row) {
             for (uint64_t x = 0; x < crop_width; ++x) {
                 for (uint8_t z = 0; z < 4; z++){
-                    crop[4 * crop_width * y + 4 * x + z] = (char_size >= 8 && x < width_path_names) ?
+                    row[4 * x + z] = (char_size >= 8 && x < width_path_names) ?
                             image_path_names[4 * width_path_names * (y + min_y) + 4 * x + z] :
                             image[4 * width * (y + min_y) + 4 * (x - width_path_names + min_x) + z];
                 }
             }
-        }
+        };
 
-        const char *filename = args::get(png_out_file).c_str();
-        png::encodeOneStep(filename, crop, crop_width, crop_height);
+        if (!args::get(png_out_file).empty()) {
+            // stream the rows to the file, so that no second copy of a wide image is made
+            if (!png::encode_rows(args::get(png_out_file), crop_width, crop_height, fill_crop_row, num_threads)) {
+                return 1;
+            }
+        }
+        if (!args::get(tiles_dir).empty()) {
+            std::vector<uint8_t> crop;
+            crop.resize(crop_width * crop_height * 4, 255);
+#pragma omp parallel for schedule(static) num_threads(num_threads)
+            for (uint64_t y = 0; y < crop_height; ++y) {
+                fill_crop_row(y, &crop[4 * crop_width * y]);
+            }
+            const uint64_t max_zoom = png::encode_tile_pyramid(args::get(tiles_dir), crop, crop_width, crop_height,
+                                                               tile_size ? args::get(tile_size) : 256, num_threads);
+            if (_progress) {
+                std::cerr << "[odgi::viz] wrote tiles for zoom levels 0 to " << max_zoom
+                          << " in " << args::get(tiles_dir) << std::endl;
+            }
+        }
 
         return 0;
     }
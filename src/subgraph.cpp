@@ -1,11 +1,13 @@
 /**
- * \file subgraph.cpp: contains the implementation of SubHandleGraph
+ * \file subgraph.cpp: contains the implementation of SubHandleGraph and SubPathHandleGraph
  */
 
 
 #include "subgraph.hpp"
+#include "algorithms/path_tasks.hpp"
 
 #include <atomic>
+#include <algorithm>
 
 namespace odgi {
 
@@ -110,5 +112,308 @@ nid_t SubHandleGraph::max_node_id() const {
     return max_id;
 }
 
+SubPathHandleGraph::SubPathHandleGraph(const PathHandleGraph* super) : super(super) {
+    // nothing to do
+}
+
+void SubPathHandleGraph::add_handle(const handle_t& handle) {
+    nid_t node_id = super->get_id(handle);
+    if (contents.insert(node_id).second) {
+        min_id = std::min(node_id, min_id);
+        max_id = std::max(node_id, max_id);
+        ordered_ids.push_back(node_id);
+    }
+}
+
+void SubPathHandleGraph::index_paths(const uint64_t& nthreads) {
+    std::sort(ordered_ids.begin(), ordered_ids.end());
+    std::vector<path_handle_t> paths;
+    std::vector<uint64_t> costs;
+    super->for_each_path_handle([&](const path_handle_t& path) {
+        paths.push_back(path);
+        costs.push_back(super->get_step_count(path));
+    });
+    // clip each path on its own, then lay the subpaths out in the order of the super paths
+    std::vector<std::vector<subpath_t>> path_subpaths(paths.size());
+    std::vector<std::vector<handle_t>> path_steps(paths.size());
+    algorithms::run_tasks(costs, nthreads, [&](const uint64_t& i, const uint64_t& tid) {
+        const path_handle_t& path = paths[i];
+        auto& runs = path_subpaths[i];
+        auto& handles = path_steps[i];
+        const std::string path_name = super->get_path_name(path);
+        bool in_run = false;
+        uint64_t offset = 0;
+        uint64_t run_start = 0;
+        auto close_run = [&](void) {
+            runs.back().name = path_name + ":" + std::to_string(run_start) + "-" + std::to_string(offset);
+            in_run = false;
+        };
+        super->for_each_step_in_path(path, [&](const step_handle_t& step) {
+            const handle_t handle = super->get_handle_of_step(step);
+            if (contents.count(super->get_id(handle))) {
+                if (!in_run) {
+                    runs.emplace_back();
+                    runs.back().first_step = handles.size();
+                    run_start = offset;
+                    in_run = true;
+                }
+                handles.push_back(handle);
+            } else if (in_run) {
+                close_run();
+            }
+            offset += super->get_length(handle);
+        });
+        if (in_run) {
+            // a circular path only stays circular if it is whole in the subgraph
+            runs.back().is_circular = run_start == 0 && runs.size() == 1 && super->get_is_circular(path);
+            close_run();
+        }
+    });
+    subpaths.clear();
+    subpath_rank.clear();
+    steps.clear();
+    for (uint64_t i = 0; i < paths.size(); ++i) {
+        for (auto& run : path_subpaths[i]) {
+            run.first_step += steps.size();
+            subpath_rank[run.name] = subpaths.size();
+            subpaths.push_back(std::move(run));
+        }
+        steps.insert(steps.end(), path_steps[i].begin(), path_steps[i].end());
+        std::vector<handle_t>().swap(path_steps[i]);
+    }
+    steps_by_node.clear();
+    steps_by_node.reserve(steps.size());
+    for (uint64_t i = 0; i < subpaths.size(); ++i) {
+        const uint64_t first_step = subpaths[i].first_step;
+        const uint64_t step_count = subpath_step_count(i);
+        for (uint64_t j = 0; j < step_count; ++j) {
+            steps_by_node.emplace_back(super->get_id(steps[first_step + j]), make_step(i, j));
+        }
+    }
+    std::stable_sort(steps_by_node.begin(), steps_by_node.end(),
+                     [](const std::pair<nid_t, step_handle_t>& a, const std::pair<nid_t, step_handle_t>& b) {
+                         return a.first < b.first;
+                     });
+}
+
+void SubPathHandleGraph::to_gfa(std::ostream& out) const {
+    out << "H\tVN:Z:1.0" << std::endl;
+    for_each_handle([&](const handle_t& handle) {
+        out << "S\t" << get_id(handle) << "\t" << get_sequence(handle) << std::endl;
+    });
+    for_each_edge([&](const edge_t& edge) {
+        out << "L\t" << get_id(edge.first) << "\t" << (get_is_reverse(edge.first) ? "-" : "+")
+            << "\t" << get_id(edge.second) << "\t" << (get_is_reverse(edge.second) ? "-" : "+")
+            << "\t0M" << std::endl;
+    });
+    for (uint64_t i = 0; i < subpaths.size(); ++i) {
+        out << "P\t" << subpaths[i].name << "\t";
+        const uint64_t first_step = subpaths[i].first_step;
+        const uint64_t step_count = subpath_step_count(i);
+        for (uint64_t j = 0; j < step_count; ++j) {
+            const handle_t& handle = steps[first_step + j];
+            out << (j ? "," : "") << get_id(handle) << (get_is_reverse(handle) ? "-" : "+");
+        }
+        out << "\t*" << std::endl;
+    }
+}
+
+bool SubPathHandleGraph::has_node(nid_t node_id) const {
+    return contents.count(node_id);
+}
+
+handle_t SubPathHandleGraph::get_handle(const nid_t& node_id, bool is_reverse) const {
+    if (!contents.count(node_id)) {
+        std::cerr << "error:[SubPathHandleGraph] subgraph does not contain node with ID " << node_id << std::endl;
+        exit(1);
+    }
+    return super->get_handle(node_id, is_reverse);
+}
+
+nid_t SubPathHandleGraph::get_id(const handle_t& handle) const {
+    return super->get_id(handle);
 }
 
+bool SubPathHandleGraph::get_is_reverse(const handle_t& handle) const {
+    return super->get_is_reverse(handle);
+}
+
+handle_t SubPathHandleGraph::flip(const handle_t& handle) const {
+    return super->flip(handle);
+}
+
+size_t SubPathHandleGraph::get_length(const handle_t& handle) const {
+    return super->get_length(handle);
+}
+
+std::string SubPathHandleGraph::get_sequence(const handle_t& handle) const {
+    return super->get_sequence(handle);
+}
+
+bool SubPathHandleGraph::follow_edges_impl(const handle_t& handle, bool go_left, const std::function<bool(const handle_t&)>& iteratee) const {
+    bool keep_going = true;
+    super->follow_edges(handle, go_left, [&](const handle_t& handle) {
+            if (contents.count(super->get_id(handle))) {
+                keep_going = iteratee(handle);
+            }
+            return keep_going;
+        });
+    return keep_going;
+}
+
+bool SubPathHandleGraph::for_each_handle_impl(const std::function<bool(const handle_t&)>& iteratee, bool parallel) const {
+    if (parallel) {
+        std::atomic<bool> keep_going(true);
+#pragma omp parallel for schedule(dynamic, 1024)
+        for (uint64_t i = 0; i < ordered_ids.size(); ++i) {
+            if (keep_going && !iteratee(super->get_handle(ordered_ids[i]))) {
+                keep_going = false;
+            }
+        }
+        return keep_going;
+    } else {
+        for (const nid_t& node_id : ordered_ids) {
+            if (!iteratee(super->get_handle(node_id))) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+size_t SubPathHandleGraph::get_node_count() const {
+    return contents.size();
+}
+
+nid_t SubPathHandleGraph::min_node_id() const {
+    return min_id;
+}
+
+nid_t SubPathHandleGraph::max_node_id() const {
+    return max_id;
+}
+
+step_handle_t SubPathHandleGraph::make_step(const uint64_t& subpath, const uint64_t& rank) {
+    step_handle_t step;
+    as_integers(step)[0] = subpath;
+    as_integers(step)[1] = rank;
+    return step;
+}
+
+uint64_t SubPathHandleGraph::subpath_step_count(const uint64_t& subpath) const {
+    return (subpath + 1 < subpaths.size() ? subpaths[subpath + 1].first_step : steps.size())
+        - subpaths[subpath].first_step;
+}
+
+size_t SubPathHandleGraph::get_path_count() const {
+    return subpaths.size();
+}
+
+bool SubPathHandleGraph::has_path(const std::string& path_name) const {
+    return subpath_rank.count(path_name);
+}
+
+path_handle_t SubPathHandleGraph::get_path_handle(const std::string& path_name) const {
+    return as_path_handle(subpath_rank.at(path_name));
+}
+
+std::string SubPathHandleGraph::get_path_name(const path_handle_t& path_handle) const {
+    return subpaths[as_integer(path_handle)].name;
+}
+
+bool SubPathHandleGraph::get_is_circular(const path_handle_t& path_handle) const {
+    return subpaths[as_integer(path_handle)].is_circular;
+}
+
+size_t SubPathHandleGraph::get_step_count(const path_handle_t& path_handle) const {
+    return subpath_step_count(as_integer(path_handle));
+}
+
+size_t SubPathHandleGraph::get_step_count(const handle_t& handle) const {
+    const nid_t node_id = super->get_id(handle);
+    auto range = std::equal_range(steps_by_node.begin(), steps_by_node.end(),
+                                  std::make_pair(node_id, step_handle_t()),
+                                  [](const std::pair<nid_t, step_handle_t>& a, const std::pair<nid_t, step_handle_t>& b) {
+                                      return a.first < b.first;
+                                  });
+    return range.second - range.first;
+}
+
+handle_t SubPathHandleGraph::get_handle_of_step(const step_handle_t& step_handle) const {
+    return steps[subpaths[as_integers(step_handle)[0]].first_step + as_integers(step_handle)[1]];
+}
+
+path_handle_t SubPathHandleGraph::get_path_handle_of_step(const step_handle_t& step_handle) const {
+    return as_path_handle(as_integers(step_handle)[0]);
+}
+
+step_handle_t SubPathHandleGraph::path_begin(const path_handle_t& path_handle) const {
+    return make_step(as_integer(path_handle), 0);
+}
+
+step_handle_t SubPathHandleGraph::path_end(const path_handle_t& path_handle) const {
+    return make_step(as_integer(path_handle), get_step_count(path_handle));
+}
+
+step_handle_t SubPathHandleGraph::path_back(const path_handle_t& path_handle) const {
+    // for an empty path this is its front end
+    return make_step(as_integer(path_handle), get_step_count(path_handle) - 1);
+}
+
+step_handle_t SubPathHandleGraph::path_front_end(const path_handle_t& path_handle) const {
+    return make_step(as_integer(path_handle), std::numeric_limits<uint64_t>::max());
+}
+
+bool SubPathHandleGraph::has_next_step(const step_handle_t& step_handle) const {
+    const uint64_t subpath = as_integers(step_handle)[0];
+    return subpaths[subpath].is_circular || as_integers(step_handle)[1] + 1 < subpath_step_count(subpath);
+}
+
+bool SubPathHandleGraph::has_previous_step(const step_handle_t& step_handle) const {
+    const uint64_t subpath = as_integers(step_handle)[0];
+    return subpaths[subpath].is_circular || as_integers(step_handle)[1] > 0;
+}
+
+step_handle_t SubPathHandleGraph::get_next_step(const step_handle_t& step_handle) const {
+    const uint64_t subpath = as_integers(step_handle)[0];
+    const uint64_t rank = as_integers(step_handle)[1];
+    if (subpaths[subpath].is_circular && rank + 1 == subpath_step_count(subpath)) {
+        return make_step(subpath, 0);
+    }
+    return make_step(subpath, rank + 1);
+}
+
+step_handle_t SubPathHandleGraph::get_previous_step(const step_handle_t& step_handle) const {
+    const uint64_t subpath = as_integers(step_handle)[0];
+    const uint64_t rank = as_integers(step_handle)[1];
+    if (subpaths[subpath].is_circular && rank == 0) {
+        return make_step(subpath, subpath_step_count(subpath) - 1);
+    }
+    // rank 0 steps back onto the front end
+    return make_step(subpath, rank - 1);
+}
+
+bool SubPathHandleGraph::for_each_path_handle_impl(const std::function<bool(const path_handle_t&)>& iteratee) const {
+    for (uint64_t i = 0; i < subpaths.size(); ++i) {
+        if (!iteratee(as_path_handle(i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SubPathHandleGraph::for_each_step_on_handle_impl(const handle_t& handle, const std::function<bool(const step_handle_t&)>& iteratee) const {
+    const nid_t node_id = super->get_id(handle);
+    auto iter = std::lower_bound(steps_by_node.begin(), steps_by_node.end(), node_id,
+                                 [](const std::pair<nid_t, step_handle_t>& a, const nid_t& id) {
+                                     return a.first < id;
+                                 });
+    for ( ; iter != steps_by_node.end() && iter->first == node_id; ++iter) {
+        if (!iteratee(iter->second)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
@@ -1,13 +1,15 @@
 #pragma once
 
 /** \file
- * subgraph.hpp: defines a handle graph implementation of a subgraph
+ * subgraph.hpp: defines handle graph implementations of a subgraph
  */
 
 #include "hash_map.hpp"
 #include <handlegraph/handle_graph.hpp>
+#include <handlegraph/path_handle_graph.hpp>
 #include <handlegraph/util.hpp>
 #include <string>
+#include <vector>
 #include <iostream>
 
 namespace odgi {
@@ -103,4 +105,111 @@ using namespace handlegraph;
             add_handle(*iter);
         }
     }
+
+    /**
+     * A PathHandleGraph implementation that acts as a subgraph of some other PathHandleGraph,
+     * without copying its nodes, sequences or edges. Like SubHandleGraph, it is a subset of the
+     * nodes with all the edges between them. Its paths are the paths of the super graph clipped
+     * to these nodes, cut into their maximal runs of steps on the nodes and named path_name:start-end
+     * with the 0-based start and end offsets of each run in the path, as odgi extract names its
+     * subpaths. Only the handles of each run are kept. Handles are those of the super graph, steps
+     * are not.
+     */
+    class SubPathHandleGraph : public PathHandleGraph {
+    public:
+
+        /// Initialize with a super graph and nodes returned by iterators to handles
+        /// from the super graph
+        template<typename HandleIter>
+        SubPathHandleGraph(const PathHandleGraph* super, HandleIter begin, HandleIter end);
+
+        /// Initialize as empty subgraph of a super graph
+        SubPathHandleGraph(const PathHandleGraph* super);
+
+        /// Add a node from the super graph to the subgraph. Must be a handle to the
+        /// super graph. No effect if the node is already included in the subgraph.
+        void add_handle(const handle_t& handle);
+
+        /// Clip the paths of the super graph to the nodes of the subgraph, walking them on nthreads
+        /// threads. Call it once all nodes are added; the subgraph has no paths before.
+        void index_paths(const uint64_t& nthreads = 1);
+
+        /// Write the subgraph in GFAv1 format, its nodes in the order of their ids
+        void to_gfa(std::ostream& out) const;
+
+        //////////////////////////
+        /// HandleGraph interface
+        //////////////////////////
+
+        virtual bool has_node(nid_t node_id) const;
+        virtual handle_t get_handle(const nid_t& node_id, bool is_reverse = false) const;
+        virtual nid_t get_id(const handle_t& handle) const;
+        virtual bool get_is_reverse(const handle_t& handle) const;
+        virtual handle_t flip(const handle_t& handle) const;
+        virtual size_t get_length(const handle_t& handle) const;
+        virtual std::string get_sequence(const handle_t& handle) const;
+        virtual size_t get_node_count() const;
+        virtual nid_t min_node_id() const;
+        virtual nid_t max_node_id() const;
+
+        //////////////////////////
+        /// PathHandleGraph interface
+        //////////////////////////
+
+        virtual size_t get_path_count() const;
+        virtual bool has_path(const std::string& path_name) const;
+        virtual path_handle_t get_path_handle(const std::string& path_name) const;
+        virtual std::string get_path_name(const path_handle_t& path_handle) const;
+        virtual bool get_is_circular(const path_handle_t& path_handle) const;
+        virtual size_t get_step_count(const path_handle_t& path_handle) const;
+        virtual size_t get_step_count(const handle_t& handle) const;
+        virtual handle_t get_handle_of_step(const step_handle_t& step_handle) const;
+        virtual path_handle_t get_path_handle_of_step(const step_handle_t& step_handle) const;
+        virtual step_handle_t path_begin(const path_handle_t& path_handle) const;
+        virtual step_handle_t path_end(const path_handle_t& path_handle) const;
+        virtual step_handle_t path_back(const path_handle_t& path_handle) const;
+        virtual step_handle_t path_front_end(const path_handle_t& path_handle) const;
+        virtual bool has_next_step(const step_handle_t& step_handle) const;
+        virtual bool has_previous_step(const step_handle_t& step_handle) const;
+        virtual step_handle_t get_next_step(const step_handle_t& step_handle) const;
+        virtual step_handle_t get_previous_step(const step_handle_t& step_handle) const;
+
+    protected:
+
+        virtual bool follow_edges_impl(const handle_t& handle, bool go_left, const std::function<bool(const handle_t&)>& iteratee) const;
+        virtual bool for_each_handle_impl(const std::function<bool(const handle_t&)>& iteratee, bool parallel = false) const;
+        virtual bool for_each_path_handle_impl(const std::function<bool(const path_handle_t&)>& iteratee) const;
+        virtual bool for_each_step_on_handle_impl(const handle_t& handle, const std::function<bool(const step_handle_t&)>& iteratee) const;
+
+    private:
+        struct subpath_t {
+            std::string name;
+            bool is_circular = false;
+            uint64_t first_step = 0; // in steps
+        };
+
+        const PathHandleGraph* super = nullptr;
+        ska::flat_hash_set<nid_t> contents;
+        std::vector<nid_t> ordered_ids;
+        nid_t min_id = std::numeric_limits<nid_t>::max();
+        nid_t max_id = std::numeric_limits<nid_t>::min();
+
+        std::vector<subpath_t> subpaths;
+        ska::flat_hash_map<std::string, uint64_t> subpath_rank;
+        // the handles of all subpaths, one after the other, and the first step of each subpath at its rank
+        std::vector<handle_t> steps;
+        // each step by node id, to find the steps on a node
+        std::vector<std::pair<nid_t, step_handle_t>> steps_by_node;
+
+        /// Step handles are the rank of the subpath and the rank of the step in it
+        static step_handle_t make_step(const uint64_t& subpath, const uint64_t& rank);
+        uint64_t subpath_step_count(const uint64_t& subpath) const;
+    };
+
+    template<typename HandleIter>
+    SubPathHandleGraph::SubPathHandleGraph(const PathHandleGraph* super, HandleIter begin, HandleIter end) : super(super) {
+        for (auto iter = begin; iter != end; ++iter) {
+            add_handle(*iter);
+        }
+    }
 }
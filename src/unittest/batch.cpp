@@ -0,0 +1,126 @@
+/**
+ * \file
+ * unittest/batch.cpp: test cases for running scripts of commands against a graph loaded once.
+ */
+
+#include "catch.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <handlegraph/util.hpp>
+#include "odgi.hpp"
+#include "subcommand/subcommand.hpp"
+#include "algorithms/temp_file.hpp"
+
+namespace odgi {
+    namespace unittest {
+
+        using namespace std;
+        using namespace handlegraph;
+
+        TEST_CASE("A view shared from a graph_t sees its nodes and paths", "[batch]") {
+            graph_t graph;
+            handle_t h1 = graph.create_handle("A");
+            handle_t h2 = graph.create_handle("CG");
+            graph.create_edge(h1, h2);
+            path_handle_t p = graph.create_path_handle("p");
+            graph.append_step(p, h1);
+            step_handle_t last = graph.append_step(p, h2);
+            {
+                graph_t view;
+                view.share(graph);
+                REQUIRE(view.get_node_count() == 2);
+                REQUIRE(view.get_edge_count() == 1);
+                REQUIRE(view.get_sequence(view.get_handle(2)) == "CG");
+                REQUIRE(view.has_path("p"));
+                REQUIRE(view.get_ordinal_rank_of_step(last) == 1);
+            }
+            // the records stay with the graph
+            REQUIRE(graph.get_sequence(h2) == "CG");
+            REQUIRE(graph.get_step_count(p) == 2);
+        }
+
+        /// Run odgi batch on the graph in og_file with the given script
+        static int run_batch(const std::string& og_file, const std::string& script) {
+            const std::string script_file = algorithms::temp_file::create("batch");
+            {
+                std::ofstream out(script_file);
+                out << script;
+            }
+            std::vector<std::string> words = {"odgi", "batch", "-i", og_file, "-s", script_file};
+            std::vector<char*> argv;
+            for (auto& word : words) {
+                argv.push_back((char*)word.c_str());
+            }
+            argv.push_back(nullptr);
+            const auto* batch = subcommand::Subcommand::get(words.size(), argv.data());
+            REQUIRE(batch != nullptr);
+            const int ret = (*batch)(words.size(), argv.data());
+            algorithms::temp_file::remove(script_file);
+            return ret;
+        }
+
+        static bool file_exists(const std::string& filename) {
+            return std::ifstream(filename).good();
+        }
+
+        TEST_CASE("A batch script that edits the shared graph is refused before it runs", "[batch]") {
+            graph_t graph;
+            handle_t n1 = graph.create_handle("ACGT");
+            handle_t n2 = graph.create_handle("GG");
+            graph.create_edge(n1, n2);
+            path_handle_t a = graph.create_path_handle("a");
+            graph.append_step(a, n1);
+            graph.append_step(a, n2);
+            path_handle_t b = graph.create_path_handle("b");
+            graph.append_step(b, n2);
+
+            const std::string og_file = algorithms::temp_file::create("batch");
+            {
+                std::ofstream out(og_file, std::ios::binary);
+                graph.serialize(out);
+            }
+            const std::string drop_file = algorithms::temp_file::create("batch");
+            {
+                std::ofstream out(drop_file);
+                out << "b" << std::endl;
+            }
+            const std::string out_file = algorithms::temp_file::create("batch");
+            const std::string listing_file = algorithms::temp_file::create("batch");
+            algorithms::temp_file::remove(out_file);
+            algorithms::temp_file::remove(listing_file);
+
+            SECTION("Dropping paths in place is refused, and the next line does not run") {
+                REQUIRE(run_batch(og_file, "paths -i " + og_file + " -X " + drop_file + " -o " + out_file + "\n"
+                                           + "stats -i " + og_file + " -S > " + listing_file + "\n") == 1);
+                REQUIRE(!file_exists(out_file));
+                REQUIRE(!file_exists(listing_file));
+            }
+
+            SECTION("Each spelling of an editing option is refused") {
+                for (const std::string& line : {"paths -i " + og_file + " --keep-paths=" + drop_file + " -o " + out_file,
+                                                "paths -i " + og_file + " -X" + drop_file + " -o " + out_file,
+                                                "kmers -i " + og_file + " -k 3 -c -D 2"}) {
+                    REQUIRE(run_batch(og_file, line + "\n") == 1);
+                }
+                REQUIRE(!file_exists(out_file));
+            }
+
+            SECTION("The commands that only read the graph see all of its paths") {
+                REQUIRE(run_batch(og_file, "stats -i " + og_file + " -S > /dev/null\n"
+                                           + "paths -i " + og_file + " -L > " + listing_file + "\n") == 0);
+                std::ifstream in(listing_file);
+                std::stringstream listed;
+                listed << in.rdbuf();
+                REQUIRE(listed.str() == "a\nb\n");
+                algorithms::temp_file::remove(listing_file);
+            }
+
+            algorithms::temp_file::remove(og_file);
+            algorithms::temp_file::remove(drop_file);
+        }
+
+    }
+}
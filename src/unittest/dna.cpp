@@ -0,0 +1,51 @@
+/**
+ * \file
+ * unittest/dna.cpp: test cases for the reverse complement and 2-bit packing of sequences.
+ */
+
+#include "catch.hpp"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+#include "dna.hpp"
+
+namespace odgi {
+    namespace unittest {
+
+        TEST_CASE("The sequence kernels agree with the base by base definitions", "[dna]") {
+            std::mt19937 gen(11);
+            const std::string alphabet = "ACGTACGTACGTacgtNnRY-";
+            std::uniform_int_distribution<uint64_t> base(0, alphabet.size() - 1);
+            for (const uint64_t length : {0, 1, 31, 32, 33, 100, 1000}) {
+                std::string seq;
+                for (uint64_t i = 0; i < length; ++i) {
+                    seq.push_back(alphabet[base(gen)]);
+                }
+                std::string rc;
+                for (auto c = seq.rbegin(); c != seq.rend(); ++c) {
+                    rc.push_back(reverse_complement(*c));
+                }
+                REQUIRE(reverse_complement(seq) == rc);
+                std::string in_place = seq;
+                reverse_complement_in_place(in_place);
+                REQUIRE(in_place == rc);
+                std::string acgt = seq;
+                std::replace_if(acgt.begin(), acgt.end(), [](char c) { return !dna_is_2bit(c); }, 'A');
+                uint64_t first_other = std::find_if(seq.begin(), seq.end(), [](char c) { return !dna_is_2bit(c); }) - seq.begin();
+                REQUIRE(dna_find_non_2bit(seq.data(), seq.size()) == first_other);
+                // pack at an offset that is not word aligned
+                std::vector<uint64_t> words((length + 5) / 32 + 1, 0);
+                const uint64_t others = pack_2bit(seq.data(), seq.size(), words.data(), 5);
+                REQUIRE(others == (uint64_t) std::count_if(seq.begin(), seq.end(), [](char c) { return !dna_is_2bit(c); }));
+                std::string unpacked(length, ' ');
+                unpack_2bit(words.data(), 5, length, &unpacked[0]);
+                for (uint64_t i = 0; i < length; ++i) {
+                    REQUIRE(unpacked[i] == dna_from_2bit(dna_as_2bit(acgt[i])));
+                }
+            }
+        }
+
+    }
+}
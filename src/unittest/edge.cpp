@@ -232,5 +232,51 @@ TEST_CASE( "Follow edges utility works", "[edges]" ) {
     }
 }
 
+TEST_CASE("Batched edge insertion matches single inserts", "[edges]") {
+    graph_t single;
+    graph_t batched;
+    batched.set_number_of_threads(4);
+    for (uint64_t i = 0; i < 50; ++i) {
+        single.create_handle("ACGT");
+        batched.create_handle("ACGT");
+    }
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<uint64_t> pick(0, 49);
+    std::vector<edge_t> edges;
+    for (uint64_t i = 0; i < 500; ++i) {
+        // node 0 is a hub, and some edges repeat in both spellings
+        uint64_t a = (i % 3 == 0) ? 0 : pick(rng);
+        uint64_t b = pick(rng);
+        bool a_rev = rng() % 2;
+        bool b_rev = rng() % 2;
+        single.create_edge(single.get_handle(a + 1, a_rev), single.get_handle(b + 1, b_rev));
+        edges.push_back(std::make_pair(batched.get_handle(a + 1, a_rev), batched.get_handle(b + 1, b_rev)));
+        if (i % 10 == 0) {
+            edges.push_back(std::make_pair(batched.get_handle(b + 1, !b_rev), batched.get_handle(a + 1, !a_rev)));
+        }
+    }
+    // an edge that's already present is ignored
+    batched.create_edge(edges.front());
+    batched.create_edges(edges);
+
+    REQUIRE(batched.get_edge_count() == single.get_edge_count());
+    for (uint64_t i = 1; i <= 50; ++i) {
+        for (bool rev : {false, true}) {
+            for (bool go_left : {false, true}) {
+                std::vector<uint64_t> s_next, b_next;
+                single.follow_edges(single.get_handle(i, rev), go_left, [&](const handle_t& h) {
+                    s_next.push_back(single.get_id(h) * 2 + single.get_is_reverse(h));
+                });
+                batched.follow_edges(batched.get_handle(i, rev), go_left, [&](const handle_t& h) {
+                    b_next.push_back(batched.get_id(h) * 2 + batched.get_is_reverse(h));
+                });
+                std::sort(s_next.begin(), s_next.end());
+                std::sort(b_next.begin(), b_next.end());
+                REQUIRE(s_next == b_next);
+            }
+        }
+    }
+}
+
 }
 }
\ No newline at end of file
@@ -0,0 +1,65 @@
+/**
+ * \file
+ * unittest/gfa.cpp: test cases for writing graphs as GFA and reading them back.
+ */
+
+#include "catch.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <handlegraph/util.hpp>
+#include "odgi.hpp"
+#include "gfa_to_handle.hpp"
+#include "algorithms/temp_file.hpp"
+
+namespace odgi {
+    namespace unittest {
+
+        using namespace std;
+        using namespace handlegraph;
+
+        TEST_CASE("Paths written as GFA W lines are read back under the same names", "[gfa]") {
+            graph_t graph;
+            handle_t n1 = graph.create_handle("ACGT");
+            handle_t n2 = graph.create_handle("GG");
+            graph.create_edge(n1, n2);
+            // without a range, with the range the walk spans, and with a range it does not span
+            const std::vector<std::string> names = {"S#1#chr1", "S#2#chr1:10-16", "S#3#chr1:10-20", "plain"};
+            for (auto& name : names) {
+                path_handle_t p = graph.create_path_handle(name);
+                graph.append_step(p, n1);
+                graph.append_step(p, n2);
+            }
+
+            std::stringstream gfa;
+            graph.to_gfa(gfa, false, 1, false, true);
+            std::vector<std::string> walks;
+            std::string line;
+            while (std::getline(gfa, line)) {
+                if (line[0] == 'W') {
+                    walks.push_back(line);
+                }
+            }
+            REQUIRE(walks.size() == 2);
+            REQUIRE(walks[0] == "W\tS\t1\tchr1\t*\t*\t>1>2");
+            REQUIRE(walks[1] == "W\tS\t2\tchr1\t10\t16\t>1>2");
+
+            const std::string filename = algorithms::temp_file::create("gfa");
+            {
+                std::ofstream out(filename);
+                graph.to_gfa(out, false, 1, false, true);
+            }
+            graph_t loaded;
+            gfa_to_handle(filename, &loaded, false, 1, false);
+            algorithms::temp_file::remove(filename);
+            REQUIRE(loaded.get_path_count() == names.size());
+            for (auto& name : names) {
+                REQUIRE(loaded.has_path(name));
+                REQUIRE(loaded.get_step_count(loaded.get_path_handle(name)) == 2);
+            }
+        }
+
+    }
+}
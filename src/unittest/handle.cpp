@@ -8,14 +8,21 @@
 #include <handlegraph/handle_graph.hpp>
 #include <handlegraph/util.hpp>
 #include "odgi.hpp"
+#include "rle_path_graph.hpp"
+#include "frozen_graph.hpp"
+#include "algorithms/node_rank.hpp"
+#include "algorithms/depth.hpp"
 
 #include <iostream>
+#include <sstream>
 #include <limits>
 #include <algorithm>
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
 #include <random>
+#include <mutex>
+#include <map>
 
 namespace odgi {
 namespace unittest {
@@ -110,6 +117,131 @@ TEST_CASE( "Handle utility functions work", "[handle]" ) {
     
 }
 
+TEST_CASE("Packed node sequences round trip", "[handle][sequence]") {
+
+    graph_t graph;
+    // longer than the inline capacity, with exceptions on both ends
+    const std::string seq = "NACGTACGTTGCAACGTRYACGTACGGTCAGTCAGGTAcgtAAAAACCCCCGGGGGTTTTTN";
+    handle_t h = graph.create_handle(seq);
+    handle_t s = graph.create_handle("GATTACA");
+
+    SECTION("Whole sequences decode in both orientations") {
+        REQUIRE(graph.get_sequence(h) == seq);
+        REQUIRE(graph.get_sequence(graph.flip(h)) == reverse_complement(seq));
+        REQUIRE(graph.get_sequence(s) == "GATTACA");
+        REQUIRE(graph.get_sequence(graph.flip(s)) == "TGTAATC");
+    }
+
+    SECTION("Bases and subsequences decode only the requested range") {
+        for (size_t i = 0; i < seq.size(); ++i) {
+            REQUIRE(graph.get_base(h, i) == seq[i]);
+            REQUIRE(graph.get_base(graph.flip(h), i) == reverse_complement(seq)[i]);
+        }
+        REQUIRE(graph.get_subsequence(h, 15, 10) == seq.substr(15, 10));
+        REQUIRE(graph.get_subsequence(graph.flip(h), 3, 20) == reverse_complement(seq).substr(3, 20));
+        REQUIRE(graph.get_subsequence(h, 50, 100) == seq.substr(50));
+        REQUIRE(graph.get_subsequence(h, 100, 1) == "");
+    }
+
+    SECTION("Sequences append into a shared buffer") {
+        std::string buf = "x";
+        graph.append_sequence(s, buf);
+        graph.append_sequence(graph.flip(h), buf);
+        REQUIRE(buf == "xGATTACA" + reverse_complement(seq));
+    }
+
+    SECTION("Flipping a node keeps its sequence") {
+        handle_t f = graph.apply_orientation(graph.flip(h));
+        REQUIRE(graph.get_sequence(f) == reverse_complement(seq));
+        REQUIRE(graph.get_sequence(graph.flip(f)) == seq);
+    }
+}
+
+TEST_CASE("Node storage reuses released slots and compacts on optimize", "[handle][pool]") {
+
+    graph_t graph;
+    std::vector<handle_t> handles;
+    for (uint64_t i = 0; i < 10; ++i) {
+        handles.push_back(graph.create_handle("ACGT"));
+    }
+    for (uint64_t i = 0; i + 1 < handles.size(); ++i) {
+        graph.create_edge(handles[i], handles[i+1]);
+    }
+    graph.destroy_handle(handles[3]);
+    graph.destroy_handle(handles[5]);
+    handle_t n = graph.create_handle("GGG", 11);
+    REQUIRE(graph.get_sequence(n) == "GGG");
+
+    const auto& stats = graph.get_node_allocation_stats();
+    REQUIRE(stats.allocated == 11);
+    REQUIRE(stats.released == 2);
+    REQUIRE(stats.reused == 1);
+    REQUIRE(stats.live() == 9);
+
+    graph.optimize();
+    REQUIRE(stats.compactions == 1);
+    REQUIRE(stats.live() == graph.get_node_count());
+    REQUIRE(graph.get_node_count() == 9);
+    REQUIRE(graph.get_edge_count() == 5);
+    uint64_t total = 0;
+    graph.for_each_handle([&](const handle_t& h) {
+        total += graph.get_length(h);
+    });
+    REQUIRE(total == 8 * 4 + 3);
+}
+
+TEST_CASE("Bulk path appends match appending step by step", "[handle][path]") {
+    graph_t single;
+    graph_t bulk;
+    for (uint64_t i = 0; i < 6; ++i) {
+        single.create_handle("ACGT");
+        bulk.create_handle("ACGT");
+    }
+    // revisits nodes in both orientations
+    std::vector<std::pair<nid_t, bool>> walk = {
+        {1, false}, {2, false}, {3, true}, {2, false}, {4, false}, {2, true}, {6, false}, {1, false}
+    };
+    path_handle_t s = single.create_path_handle("p");
+    path_handle_t b = bulk.create_path_handle("p");
+    // the first visit goes in on its own, so the bulk append links onto an existing path
+    single.append_step(s, single.get_handle(5, false));
+    bulk.append_step(b, bulk.get_handle(5, false));
+    std::vector<handle_t> handles;
+    for (auto& v : walk) {
+        single.append_step(s, single.get_handle(v.first, v.second));
+        handles.push_back(bulk.get_handle(v.first, v.second));
+    }
+    std::vector<step_handle_t> steps = bulk.append_steps(b, handles);
+    REQUIRE(steps.size() == walk.size());
+    REQUIRE(bulk.get_step_count(b) == single.get_step_count(s));
+    REQUIRE(bulk.get_handle_of_step(bulk.path_back(b)) == handles.back());
+
+    auto forward = [](const graph_t& graph, const path_handle_t& path) {
+        std::vector<std::pair<nid_t, bool>> visits;
+        graph.for_each_step_in_path(path, [&](const step_handle_t& step) {
+            handle_t h = graph.get_handle_of_step(step);
+            visits.emplace_back(graph.get_id(h), graph.get_is_reverse(h));
+        });
+        return visits;
+    };
+    auto backward = [](const graph_t& graph, const path_handle_t& path) {
+        std::vector<std::pair<nid_t, bool>> visits;
+        step_handle_t step = graph.path_back(path);
+        while (true) {
+            handle_t h = graph.get_handle_of_step(step);
+            visits.emplace_back(graph.get_id(h), graph.get_is_reverse(h));
+            if (!graph.has_previous_step(step)) break;
+            step = graph.get_previous_step(step);
+        }
+        return visits;
+    };
+    REQUIRE(forward(bulk, b) == forward(single, s));
+    REQUIRE(backward(bulk, b) == backward(single, s));
+    for (uint64_t i = 1; i <= 6; ++i) {
+        REQUIRE(bulk.get_step_count(bulk.get_handle(i)) == single.get_step_count(single.get_handle(i)));
+    }
+}
+
 TEST_CASE("VG and XG handle implementations are correct", "[handle][vg][xg]") {
     
     // Make a vg graph
@@ -2301,5 +2433,691 @@ TEST_CASE("Deletable handle graphs with mutable paths work", "[handle][packed][h
     
 }
 
+TEST_CASE("Step ranks and positions of graph_t follow edits to the path", "[handle][stepindex]") {
+
+    graph_t graph;
+    std::vector<handle_t> handles;
+    for (uint64_t i = 0; i < 100; ++i) {
+        handles.push_back(graph.create_handle(std::string(i % 3 + 1, 'A')));
+    }
+    path_handle_t p = graph.create_path_handle("p");
+    // visit each node twice, so that steps share nodes
+    for (uint64_t i = 0; i < 200; ++i) {
+        graph.append_step(p, handles[i % handles.size()]);
+    }
+
+    auto check_path = [&](void) {
+        uint64_t rank = 0;
+        uint64_t position = 0;
+        graph.for_each_step_in_path(p, [&](const step_handle_t& step) {
+            REQUIRE(graph.get_ordinal_rank_of_step(step) == rank);
+            REQUIRE(graph.get_position_of_step(step) == position);
+            REQUIRE(graph.get_step_at_rank(p, rank) == step);
+            uint64_t length = graph.get_length(graph.get_handle_of_step(step));
+            for (uint64_t i = 0; i < length; ++i) {
+                REQUIRE(graph.get_step_at_position(p, position + i) == step);
+            }
+            ++rank;
+            position += length;
+        });
+        REQUIRE(graph.get_step_at_rank(p, rank) == graph.path_end(p));
+        REQUIRE(graph.get_step_at_position(p, position) == graph.path_end(p));
+    };
+
+    SECTION("The index matches a walk along the path") {
+        check_path();
+    }
+
+    SECTION("The index is rebuilt after steps are added to either end") {
+        check_path();
+        graph.prepend_step(p, handles[5]);
+        graph.append_steps(p, {handles[7], handles[8], handles[9]});
+        check_path();
+    }
+
+    SECTION("The index is rebuilt after a node is divided") {
+        check_path();
+        graph.divide_handle(handles[2], {1});
+        check_path();
+    }
+}
+
+TEST_CASE("Paths of graph_t are found by name prefix and grouped by PanSN fields", "[handle]") {
+
+    graph_t graph;
+    handle_t h = graph.create_handle("A");
+    for (auto& name : {"B#1#chr1", "A#2#chr1", "A#1#chr2", "A#1#chr1", "C", "B#chr1"}) {
+        graph.append_step(graph.create_path_handle(name), h);
+    }
+
+    std::vector<std::string> names;
+    graph.for_each_path_with_prefix("A#1#", [&](const path_handle_t& p) {
+        names.push_back(graph.get_path_name(p));
+    });
+    REQUIRE(names == std::vector<std::string>({"A#1#chr1", "A#1#chr2"}));
+
+    auto group_names = [&](const uint64_t& fields) {
+        std::vector<std::pair<std::string, uint64_t>> groups;
+        for (auto& group : graph.pansn_path_groups(fields)) {
+            groups.emplace_back(group.first, group.second.size());
+        }
+        return groups;
+    };
+    REQUIRE(group_names(1) == std::vector<std::pair<std::string, uint64_t>>({{"A", 3}, {"B", 2}, {"C", 1}}));
+    REQUIRE(group_names(2) == std::vector<std::pair<std::string, uint64_t>>({{"A#1", 2}, {"A#2", 1}, {"B", 1}, {"B#1", 1}, {"C", 1}}));
+
+    graph.destroy_path(graph.get_path_handle("A#2#chr1"));
+    REQUIRE(group_names(1) == std::vector<std::pair<std::string, uint64_t>>({{"A", 2}, {"B", 2}, {"C", 1}}));
+}
+
+TEST_CASE("graph_t moved into another graph keeps its nodes, edges and paths", "[handle]") {
+
+    graph_t source;
+    handle_t h1 = source.create_handle("GATTACA");
+    handle_t h2 = source.create_handle("CA");
+    handle_t h3 = source.create_handle("T");
+    source.create_edge(h1, h2);
+    source.create_edge(h2, source.flip(h3));
+    path_handle_t dropped = source.create_path_handle("dropped");
+    source.append_step(dropped, h1);
+    path_handle_t kept = source.create_path_handle("kept");
+    source.append_step(kept, h1);
+    source.append_step(kept, h2);
+    source.append_step(kept, source.flip(h3));
+    source.destroy_path(dropped);
+
+    graph_t graph;
+    graph.move_from(source);
+
+    REQUIRE(source.get_node_count() == 0);
+    REQUIRE(source.get_path_count() == 0);
+    REQUIRE(graph.get_node_count() == 3);
+    REQUIRE(graph.get_edge_count() == 2);
+    REQUIRE(graph.get_sequence(graph.get_handle(1)) == "GATTACA");
+    REQUIRE(graph.has_edge(graph.get_handle(2), graph.get_handle(3, true)));
+    REQUIRE(graph.get_path_count() == 1);
+    REQUIRE(graph.has_path("kept"));
+    std::string path_sequence;
+    graph.for_each_step_in_path(graph.get_path_handle("kept"), [&](const step_handle_t& step) {
+        path_sequence += graph.get_sequence(graph.get_handle_of_step(step));
+    });
+    REQUIRE(path_sequence == "GATTACACAA");
+}
+
+
+TEST_CASE("Snapshot of graph_t keeps the graph as it was while the graph is edited", "[handle]") {
+
+    graph_t graph;
+    handle_t h1 = graph.create_handle("GATT");
+    handle_t h2 = graph.create_handle("ACA");
+    graph.create_edge(h1, h2);
+    path_handle_t p = graph.create_path_handle("p");
+    graph.append_step(p, h1);
+    graph.append_step(p, h2);
+
+    auto path_sequence = [](const graph_t& g, const path_handle_t& path) {
+        std::string seq;
+        g.for_each_step_in_path(path, [&](const step_handle_t& step) {
+            seq += g.get_sequence(g.get_handle_of_step(step));
+        });
+        return seq;
+    };
+
+    auto view = graph.snapshot();
+    REQUIRE(view->is_snapshot());
+
+    handle_t h3 = graph.create_handle("T");
+    graph.create_edge(h2, h3);
+    graph.append_step(p, h3);
+    graph.divide_handle(h1, {2});
+    graph.create_path_handle("q");
+
+    REQUIRE(path_sequence(graph, p) == "GATTACAT");
+    REQUIRE(graph.get_node_count() == 4);
+    REQUIRE(view->get_node_count() == 2);
+    REQUIRE(view->get_edge_count() == 1);
+    REQUIRE(view->get_path_count() == 1);
+    REQUIRE(view->get_step_count(view->get_path_handle("p")) == 2);
+    REQUIRE(path_sequence(*view, view->get_path_handle("p")) == "GATTACA");
+    REQUIRE(!view->has_node(3));
+    REQUIRE(view->get_degree(view->get_handle(2), false) == 0);
+
+    // the records kept for the snapshot are given back once it is released
+    auto released = graph.get_node_allocation_stats().released;
+    view.reset();
+    graph.reclaim_snapshot_nodes();
+    REQUIRE(graph.get_node_allocation_stats().released > released);
+    graph.optimize();
+    REQUIRE(path_sequence(graph, p) == "GATTACAT");
+}
+
+
+TEST_CASE("Batch destruction of graph_t handles matches destroying them one by one", "[handle]") {
+    auto build = [](graph_t& graph) {
+        std::vector<handle_t> h;
+        for (auto seq : {"A", "C", "G", "T", "AC"}) {
+            h.push_back(graph.create_handle(seq));
+        }
+        graph.create_edge(h[0], h[1]);
+        graph.create_edge(h[1], h[2]);
+        graph.create_edge(h[1], graph.flip(h[3]));
+        graph.create_edge(h[2], h[3]);
+        graph.create_edge(h[3], h[3]); // self loop
+        graph.create_edge(h[3], h[4]);
+        graph.create_edge(h[0], h[4]);
+        return h;
+    };
+    graph_t one_by_one, batch;
+    auto a = build(one_by_one);
+    auto b = build(batch);
+    one_by_one.destroy_handle(a[2]);
+    one_by_one.destroy_handle(a[3]);
+    batch.destroy_handles({b[3], b[2], b[3]});
+
+    REQUIRE(batch.get_node_count() == one_by_one.get_node_count());
+    REQUIRE(batch.get_edge_count() == one_by_one.get_edge_count());
+    REQUIRE(batch.get_edge_count() == 2);
+    REQUIRE(!batch.has_node(3));
+    REQUIRE(!batch.has_node(4));
+    REQUIRE(batch.has_edge(b[0], b[1]));
+    REQUIRE(batch.has_edge(b[0], b[4]));
+    REQUIRE(batch.get_degree(b[1], false) == 0);
+    REQUIRE(batch.get_degree(b[4], true) == 1);
+    batch.optimize();
+    REQUIRE(batch.get_node_count() == 3);
+    REQUIRE(batch.get_edge_count() == 2);
+}
+
+TEST_CASE("Batch destruction of graph_t edges accepts either orientation of each edge", "[handle]") {
+    graph_t graph;
+    handle_t h1 = graph.create_handle("A");
+    handle_t h2 = graph.create_handle("C");
+    handle_t h3 = graph.create_handle("G");
+    graph.create_edge(h1, h2);
+    graph.create_edge(h2, graph.flip(h3));
+    graph.create_edge(h3, h3);
+    graph.create_edge(h1, graph.flip(h1));
+    graph.create_edge(h1, h3);
+    REQUIRE(graph.get_edge_count() == 5);
+
+    graph.destroy_edges({{graph.flip(h2), graph.flip(h1)}, {h3, graph.flip(h2)}, {h3, h3},
+                         {h1, graph.flip(h1)}, {h1, h2}});
+    REQUIRE(graph.get_edge_count() == 1);
+    REQUIRE(!graph.has_edge(h1, h2));
+    REQUIRE(!graph.has_edge(h2, graph.flip(h3)));
+    REQUIRE(!graph.has_edge(h3, h3));
+    REQUIRE(!graph.has_edge(h1, graph.flip(h1)));
+    REQUIRE(graph.has_edge(h1, h3));
+    REQUIRE(graph.get_degree(h2, false) == 0);
+    REQUIRE(graph.get_degree(h2, true) == 0);
+}
+
+TEST_CASE("Reassigning the node ids of graph_t keeps its sequences, edges and paths", "[handle]") {
+    graph_t graph;
+    handle_t h1 = graph.create_handle("A");
+    handle_t h2 = graph.create_handle("CG");
+    handle_t h3 = graph.create_handle("TTA");
+    graph.create_edge(h1, h2);
+    graph.create_edge(h2, graph.flip(h3));
+    path_handle_t p = graph.create_path_handle("p");
+    graph.append_step(p, h1);
+    graph.append_step(p, h2);
+    graph.append_step(p, graph.flip(h3));
+
+    graph.reassign_node_ids([](const nid_t& id) { return 10 + 2 * id; });
+    REQUIRE(graph.get_node_count() == 3);
+    REQUIRE(graph.min_node_id() == 12);
+    REQUIRE(graph.max_node_id() == 16);
+    REQUIRE(!graph.has_node(1));
+    REQUIRE(!graph.has_node(13));
+    REQUIRE(graph.get_sequence(graph.get_handle(12)) == "A");
+    REQUIRE(graph.get_sequence(graph.get_handle(14)) == "CG");
+    REQUIRE(graph.get_sequence(graph.get_handle(16)) == "TTA");
+    REQUIRE(graph.get_edge_count() == 2);
+    REQUIRE(graph.has_edge(graph.get_handle(12), graph.get_handle(14)));
+    REQUIRE(graph.has_edge(graph.get_handle(14), graph.get_handle(16, true)));
+    std::vector<std::pair<nid_t, bool>> steps;
+    graph.for_each_step_in_path(p, [&](const step_handle_t& step) {
+        const handle_t h = graph.get_handle_of_step(step);
+        steps.emplace_back(graph.get_id(h), graph.get_is_reverse(h));
+    });
+    REQUIRE(steps == std::vector<std::pair<nid_t, bool>>{{12, false}, {14, false}, {16, true}});
+}
+
+TEST_CASE("graph_t loads the topology only or a subset of its paths", "[handle]") {
+    graph_t graph;
+    handle_t h1 = graph.create_handle("A");
+    handle_t h2 = graph.create_handle("CG");
+    handle_t h3 = graph.create_handle("TTA");
+    graph.create_edge(h1, h2);
+    graph.create_edge(h2, h3);
+    graph.create_edge(h1, h3);
+    path_handle_t a = graph.create_path_handle("a");
+    path_handle_t b = graph.create_path_handle("b");
+    path_handle_t c = graph.create_path_handle("c");
+    for (auto& h : {h1, h2, h3}) graph.append_step(a, h);
+    for (auto& h : {h1, h3}) graph.append_step(b, h);
+    for (auto& h : {h3, h2, h1, h3}) graph.append_step(c, h);
+    std::stringstream stored;
+    graph.serialize(stored);
+
+    SECTION("topology only") {
+        graph_t loaded;
+        loaded.set_path_loading(true);
+        loaded.deserialize(stored);
+        REQUIRE(loaded.get_node_count() == 3);
+        REQUIRE(loaded.get_edge_count() == 3);
+        REQUIRE(loaded.get_path_count() == 0);
+        REQUIRE(loaded.get_step_count(loaded.get_handle(3)) == 0);
+    }
+
+    SECTION("a subset of the paths") {
+        graph_t loaded;
+        loaded.set_path_loading(false, [](const std::string_view& name) { return name != "b"; });
+        loaded.deserialize(stored);
+        REQUIRE(loaded.get_path_count() == 2);
+        REQUIRE(!loaded.has_path("b"));
+        REQUIRE(loaded.get_step_count(loaded.get_handle(3)) == 3);
+        auto ids = [&](const path_handle_t& p) {
+            std::vector<nid_t> v;
+            loaded.for_each_step_in_path(p, [&](const step_handle_t& step) {
+                v.push_back(loaded.get_id(loaded.get_handle_of_step(step)));
+            });
+            return v;
+        };
+        REQUIRE(ids(loaded.get_path_handle("a")) == std::vector<nid_t>{1, 2, 3});
+        REQUIRE(ids(loaded.get_path_handle("c")) == std::vector<nid_t>{3, 2, 1, 3});
+    }
+}
+
+TEST_CASE("graph_t serialized with compressed node blocks loads back the same graph", "[handle]") {
+    graph_t graph;
+    graph.set_number_of_threads(2);
+    std::vector<handle_t> handles;
+    for (uint64_t i = 0; i < 100; ++i) {
+        handles.push_back(graph.create_handle(std::string(1 + i % 7, "ACGT"[i % 4])));
+        if (i) graph.create_edge(handles[i-1], handles[i]);
+    }
+    path_handle_t p = graph.create_path_handle("p");
+    for (auto& h : handles) graph.append_step(p, h);
+    graph.set_compressed_serialization(true);
+    std::stringstream stored;
+    graph.serialize(stored);
+
+    graph_t loaded;
+    loaded.set_number_of_threads(2);
+    loaded.deserialize(stored);
+    REQUIRE(loaded.get_node_count() == 100);
+    REQUIRE(loaded.get_edge_count() == 99);
+    REQUIRE(loaded.get_step_count(loaded.get_path_handle("p")) == 100);
+    graph.for_each_handle([&](const handle_t& h) {
+        REQUIRE(loaded.get_sequence(loaded.get_handle(graph.get_id(h))) == graph.get_sequence(h));
+    });
+}
+
+TEST_CASE("graph_t applies the changes written as a delta to its base", "[handle]") {
+    graph_t graph;
+    handle_t h1 = graph.create_handle("A");
+    handle_t h2 = graph.create_handle("CG");
+    handle_t h3 = graph.create_handle("TTA");
+    handle_t h4 = graph.create_handle("G");
+    graph.create_edge(h1, h2);
+    graph.create_edge(h2, h3);
+    path_handle_t a = graph.create_path_handle("a");
+    path_handle_t b = graph.create_path_handle("b");
+    for (auto& h : {h1, h2, h3}) graph.append_step(a, h);
+    for (auto& h : {h1, h2}) graph.append_step(b, h);
+    std::stringstream base;
+    graph.serialize(base);
+
+    graph.track_changes();
+    graph.destroy_path(a);
+    graph.destroy_handle(h4);
+    handle_t h5 = graph.create_handle("CCC", 5);
+    graph.create_edge(h3, h5);
+    path_handle_t c = graph.create_path_handle("c");
+    for (auto& h : {h2, h3, h5}) graph.append_step(c, h);
+    std::stringstream delta;
+    graph.serialize_changes(delta, "base.og");
+
+    std::string base_file;
+    REQUIRE(graph_t::read_delta_base(delta, base_file));
+    REQUIRE(base_file == "base.og");
+    delta.seekg(0);
+    graph_t loaded;
+    loaded.deserialize(base);
+    loaded.apply_changes(delta);
+    REQUIRE(loaded.get_node_count() == 4);
+    REQUIRE(!loaded.has_node(4));
+    REQUIRE(loaded.get_edge_count() == 3);
+    REQUIRE(loaded.get_sequence(loaded.get_handle(5)) == "CCC");
+    REQUIRE(loaded.get_path_count() == 2);
+    REQUIRE(!loaded.has_path("a"));
+    auto ids = [&](const path_handle_t& p) {
+        std::vector<nid_t> v;
+        loaded.for_each_step_in_path(p, [&](const step_handle_t& step) {
+            v.push_back(loaded.get_id(loaded.get_handle_of_step(step)));
+        });
+        return v;
+    };
+    REQUIRE(ids(loaded.get_path_handle("b")) == std::vector<nid_t>{1, 2});
+    REQUIRE(ids(loaded.get_path_handle("c")) == std::vector<nid_t>{2, 3, 5});
+
+    // a delta only applies to the graph it was written over
+    graph_t other;
+    other.create_handle("A");
+    delta.clear();
+    delta.seekg(0);
+    REQUIRE_THROWS(other.apply_changes(delta));
+}
+
+TEST_CASE("RLEPathHandleGraph walks the paths of its source in few runs", "[handle]") {
+    graph_t graph;
+    std::vector<handle_t> h;
+    for (auto& seq : {"A", "C", "G", "T"}) {
+        h.push_back(graph.create_handle(seq));
+    }
+    graph.create_edge(h[0], h[1]);
+    graph.create_edge(h[0], h[2]);
+    graph.create_edge(h[1], h[3]);
+    graph.create_edge(h[2], h[3]);
+    for (uint64_t i = 0; i < 10; ++i) {
+        path_handle_t p = graph.create_path_handle("hap" + std::to_string(i));
+        graph.append_step(p, h[0]);
+        graph.append_step(p, i % 5 == 4 ? h[2] : h[1]);
+        graph.append_step(p, h[3]);
+    }
+    path_handle_t r = graph.create_path_handle("rev");
+    graph.append_step(r, graph.flip(h[3]));
+    graph.append_step(r, graph.flip(h[2]));
+    graph.append_step(r, graph.flip(h[0]));
+    graph.create_path_handle("empty");
+
+    RLEPathHandleGraph rle(&graph);
+    rle.add_paths(graph, 2);
+    REQUIRE(rle.get_path_count() == 12);
+    REQUIRE(rle.get_visit_count() == 33);
+    REQUIRE(rle.get_run_count() < 33);
+    REQUIRE(rle.get_step_count(h[3]) == 11);
+    graph.for_each_path_handle([&](const path_handle_t& p) {
+        const path_handle_t q = rle.get_path_handle(graph.get_path_name(p));
+        REQUIRE(rle.get_step_count(q) == graph.get_step_count(p));
+        std::vector<handle_t> forward;
+        for (step_handle_t s = rle.path_begin(q); s != rle.path_end(q); s = rle.get_next_step(s)) {
+            REQUIRE(rle.get_path_handle_of_step(s) == q);
+            forward.push_back(rle.get_handle_of_step(s));
+        }
+        std::vector<handle_t> backward;
+        for (step_handle_t s = rle.path_back(q); s != rle.path_front_end(q); s = rle.get_previous_step(s)) {
+            backward.push_back(rle.get_handle_of_step(s));
+        }
+        std::reverse(backward.begin(), backward.end());
+        std::vector<handle_t> expected;
+        graph.for_each_step_in_path(p, [&](const step_handle_t& s) {
+            expected.push_back(graph.get_handle_of_step(s));
+        });
+        REQUIRE(forward == expected);
+        REQUIRE(backward == expected);
+    });
+}
+
+TEST_CASE("graph_t saves a path noted as a copy of a run of another path as a reference to it", "[handle]") {
+    graph_t graph;
+    std::vector<handle_t> handles;
+    for (uint64_t i = 0; i < 5; ++i) {
+        handles.push_back(graph.create_handle(std::string(1 + i, "ACGT"[i % 4])));
+        if (i) graph.create_edge(handles[i-1], handles[i]);
+    }
+    path_handle_t q = graph.create_path_handle("q");
+    for (auto& h : handles) graph.append_step(q, h);
+    path_handle_t a = graph.create_path_handle("a");
+    graph.append_steps(a, {handles[1], handles[2], handles[3]});
+    path_handle_t r = graph.create_path_handle("r");
+    graph.append_steps(r, {handles[2], handles[3], handles[4]});
+    std::stringstream full;
+    graph.serialize(full);
+    graph.set_path_copy(a, q, 1);
+    std::stringstream stored;
+    graph.serialize(stored);
+    REQUIRE(stored.str().size() < full.str().size());
+
+    auto steps_of = [](const graph_t& g, const std::string& name) {
+        std::vector<nid_t> ids;
+        g.for_each_step_in_path(g.get_path_handle(name), [&](const step_handle_t& s) {
+            ids.push_back(g.get_id(g.get_handle_of_step(s)));
+        });
+        return ids;
+    };
+    graph_t loaded;
+    loaded.deserialize(stored);
+    REQUIRE(steps_of(loaded, "q") == std::vector<nid_t>({1, 2, 3, 4, 5}));
+    REQUIRE(steps_of(loaded, "a") == std::vector<nid_t>({2, 3, 4}));
+    REQUIRE(steps_of(loaded, "r") == std::vector<nid_t>({3, 4, 5}));
+    REQUIRE(loaded.get_step_count(handles[3]) == 3);
+
+    // the copy is expanded even when its source is not loaded
+    stored.clear();
+    stored.seekg(0);
+    graph_t subset;
+    subset.set_path_loading(false, [](const std::string_view& name) { return name == "a"; });
+    subset.deserialize(stored);
+    REQUIRE(subset.get_path_count() == 1);
+    REQUIRE(steps_of(subset, "a") == std::vector<nid_t>({2, 3, 4}));
+}
+
+TEST_CASE("node_rank_t ranks the nodes of a graph whose ids are not compacted", "[handle]") {
+    graph_t graph;
+    std::vector<handle_t> handles;
+    for (uint64_t i = 0; i < 5; ++i) {
+        handles.push_back(graph.create_handle("ACGT"));
+    }
+    {
+        algorithms::node_rank_t node_rank(graph);
+        REQUIRE(node_rank.is_compact());
+        REQUIRE(node_rank(handles[4]) == 4);
+    }
+    graph.destroy_handle(handles[1]);
+    graph.destroy_handle(handles[3]);
+    algorithms::node_rank_t node_rank(graph);
+    REQUIRE(!node_rank.is_compact());
+    REQUIRE(node_rank(handles[0]) == 0);
+    REQUIRE(node_rank(handles[2]) == 1);
+    REQUIRE(node_rank(graph.flip(handles[4])) == 2);
+}
+
+
+TEST_CASE("A hub node answers degrees and edge lookups from its edge index", "[handle]") {
+    graph_t graph;
+    handle_t hub = graph.create_handle("A");
+    std::vector<handle_t> spokes;
+    for (uint64_t i = 0; i < 2 * HUB_EDGE_COUNT; ++i) {
+        spokes.push_back(graph.create_handle("C"));
+    }
+    for (uint64_t i = 0; i < spokes.size(); ++i) {
+        if (i % 2) {
+            graph.create_edge(hub, i % 4 == 1 ? spokes[i] : graph.flip(spokes[i]));
+        } else {
+            graph.create_edge(spokes[i], hub);
+        }
+    }
+    graph.create_edge(hub, hub);
+    graph.create_edge(graph.flip(hub), hub);
+    auto followed = [&](const handle_t& h, bool go_left) {
+        size_t n = 0;
+        graph.follow_edges(h, go_left, [&](const handle_t& next) { ++n; });
+        return n;
+    };
+    for (const handle_t& h : {hub, graph.flip(hub)}) {
+        for (bool go_left : {false, true}) {
+            REQUIRE(graph.get_degree(h, go_left) == followed(h, go_left));
+        }
+    }
+    REQUIRE(graph.get_degree(hub, false) == HUB_EDGE_COUNT + 1);
+    REQUIRE(graph.has_edge(hub, hub));
+    REQUIRE(graph.has_edge(graph.flip(hub), graph.flip(hub)));
+    REQUIRE(graph.has_edge(graph.flip(hub), hub));
+    REQUIRE(!graph.has_edge(hub, graph.flip(hub)));
+    REQUIRE(graph.has_edge(hub, spokes[1]));
+    REQUIRE(graph.has_edge(hub, graph.flip(spokes[3])));
+    REQUIRE(!graph.has_edge(hub, spokes[3]));
+    REQUIRE(graph.has_edge(graph.flip(hub), graph.flip(spokes[0])));
+    REQUIRE(!graph.has_edge(hub, spokes[0]));
+    graph.destroy_edge(hub, spokes[1]);
+    REQUIRE(!graph.has_edge(hub, spokes[1]));
+    REQUIRE(graph.get_degree(hub, false) == HUB_EDGE_COUNT);
+    REQUIRE(graph.get_degree(hub, false) == followed(hub, false));
+}
+
+TEST_CASE("FrozenHandleGraph follows the edges of its graph in the same order", "[handle]") {
+    graph_t graph;
+    handle_t a = graph.create_handle("A");
+    handle_t b = graph.create_handle("CC");
+    handle_t c = graph.create_handle("GGG");
+    handle_t d = graph.create_handle("T");
+    graph.create_edge(a, b);
+    graph.create_edge(a, graph.flip(c));
+    graph.create_edge(b, d);
+    graph.create_edge(graph.flip(c), d);
+    graph.create_edge(d, d);
+    graph.create_edge(graph.flip(a), a);
+    graph.destroy_handle(b);
+    const FrozenHandleGraph frozen(&graph, 2);
+    REQUIRE(frozen.get_node_count() == graph.get_node_count());
+    graph.for_each_handle([&](const handle_t& h) {
+        for (const handle_t& s : {h, graph.flip(h)}) {
+            for (bool go_left : {false, true}) {
+                std::vector<handle_t> expected, found;
+                graph.follow_edges(s, go_left, [&](const handle_t& next) { expected.push_back(next); });
+                frozen.follow_edges(s, go_left, [&](const handle_t& next) { found.push_back(next); });
+                REQUIRE(found == expected);
+                REQUIRE(frozen.get_degree(s, go_left) == expected.size());
+                for (const handle_t& next : expected) {
+                    REQUIRE(frozen.has_edge(go_left ? next : s, go_left ? s : next));
+                }
+            }
+        }
+    });
+    REQUIRE(!frozen.has_edge(a, c));
+}
+
+TEST_CASE("An edge depth index counts the path crossings of each edge and reads back what it wrote", "[handle]") {
+    graph_t graph;
+    handle_t a = graph.create_handle("A");
+    handle_t b = graph.create_handle("CC");
+    handle_t c = graph.create_handle("GGG");
+    graph.create_edge(a, b);
+    graph.create_edge(b, c);
+    graph.create_edge(a, graph.flip(c));
+    graph.create_edge(c, c);
+    path_handle_t x = graph.create_path_handle("x");
+    graph.append_step(x, a);
+    graph.append_step(x, b);
+    graph.append_step(x, c);
+    graph.append_step(x, c);
+    // the same edges the other way around
+    path_handle_t y = graph.create_path_handle("y");
+    graph.append_step(y, graph.flip(c));
+    graph.append_step(y, graph.flip(b));
+    graph.append_step(y, graph.flip(a));
+    path_handle_t z = graph.create_path_handle("z");
+    graph.append_step(z, a);
+    graph.append_step(z, graph.flip(c));
+    const algorithms::edge_depth_index_t index(graph, 2);
+    REQUIRE(index.get_edge_count() == 4);
+    REQUIRE(index.is_index_of(graph));
+    REQUIRE(index.get_depth(a, b) == 2);
+    REQUIRE(index.get_depth(graph.flip(b), graph.flip(a)) == 2);
+    REQUIRE(index.get_depth(b, c) == 2);
+    REQUIRE(index.get_depth(c, c) == 1);
+    REQUIRE(index.get_depth(a, graph.flip(c)) == 1);
+    std::stringstream ss;
+    index.serialize(ss);
+    algorithms::edge_depth_index_t loaded;
+    REQUIRE(loaded.load(ss));
+    REQUIRE(loaded.is_index_of(graph));
+    graph.for_each_edge([&](const edge_t& e) {
+        REQUIRE(loaded.get_depth(e.first, e.second) == index.get_depth(e.first, e.second));
+    });
+    std::stringstream garbage("not an index");
+    REQUIRE(!loaded.load(garbage));
+}
+
+TEST_CASE("keep_paths drops the steps of the other paths in place", "[handle]") {
+    graph_t graph;
+    handle_t a = graph.create_handle("A");
+    handle_t b = graph.create_handle("CC");
+    handle_t c = graph.create_handle("GGG");
+    graph.create_edge(a, b);
+    graph.create_edge(b, c);
+    graph.create_edge(c, a);
+    std::map<std::string, std::vector<handle_t>> walks = {
+        {"x", {a, b, c, a}},
+        {"y", {b, c, a, b, c}},
+        {"z", {graph.flip(c), graph.flip(b), graph.flip(a)}},
+    };
+    for (const std::string name : {"x", "y", "z"}) {
+        path_handle_t p = graph.create_path_handle(name);
+        for (const handle_t& h : walks[name]) {
+            graph.append_step(p, h);
+        }
+    }
+    graph.keep_paths([&](const path_handle_t& p) {
+        return graph.get_path_name(p) != "y";
+    });
+    REQUIRE(graph.get_path_count() == 2);
+    REQUIRE(!graph.has_path("y"));
+    REQUIRE(as_integer(graph.get_path_handle("x")) == 1);
+    REQUIRE(as_integer(graph.get_path_handle("z")) == 2);
+    REQUIRE(graph.steps_of_handle(b).size() == 2);
+    for (const std::string name : {"x", "z"}) {
+        const path_handle_t p = graph.get_path_handle(name);
+        std::vector<handle_t> forward, backward;
+        graph.for_each_step_in_path(p, [&](const step_handle_t& step) {
+            REQUIRE(graph.get_path_handle_of_step(step) == p);
+            forward.push_back(graph.get_handle_of_step(step));
+        });
+        REQUIRE(forward == walks[name]);
+        for (step_handle_t step = graph.path_back(p); ; step = graph.get_previous_step(step)) {
+            backward.push_back(graph.get_handle_of_step(step));
+            if (!graph.has_previous_step(step)) break;
+        }
+        std::reverse(backward.begin(), backward.end());
+        REQUIRE(backward == walks[name]);
+    }
+}
+
+TEST_CASE("measure_memory accounts for the bytes of each node in its buckets", "[handle]") {
+    graph_t graph;
+    handle_t a = graph.create_handle(std::string(100, 'A'));
+    handle_t b = graph.create_handle("CNC");
+    handle_t c = graph.create_handle("G");
+    graph.create_edge(a, b);
+    graph.create_edge(b, c);
+    graph.create_edge(a, c);
+    path_handle_t p = graph.create_path_handle("p");
+    graph.append_step(p, a);
+    graph.append_step(p, b);
+    graph.append_step(p, c);
+    const graph_t::memory_breakdown_t m = graph.measure_memory();
+    REQUIRE(m.sequences.memory > 0);
+    REQUIRE(m.sequences.serialized >= 104);
+    REQUIRE(m.path_metadata.serialized > 0);
+    for (const auto* buckets : {&m.by_degree, &m.by_depth}) {
+        uint64_t nodes = 0, memory = 0, serialized = 0;
+        for (auto& bucket : *buckets) {
+            nodes += bucket.nodes;
+            memory += bucket.bytes.memory;
+            serialized += bucket.bytes.serialized;
+        }
+        REQUIRE(nodes == 3);
+        REQUIRE(memory == m.sequences.memory + m.edges.memory + m.path_steps.memory);
+        REQUIRE(serialized == m.sequences.serialized + m.edges.serialized + m.path_steps.serialized);
+    }
+    // every node is on the path once
+    REQUIRE(m.by_depth.size() == 2);
+    REQUIRE(m.by_depth[1].nodes == 3);
+    REQUIRE(m.total().memory >= m.sequences.memory + m.edges.memory);
+}
+
 }
 }
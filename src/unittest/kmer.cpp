@@ -0,0 +1,52 @@
+/**
+ * \file
+ * unittest/kmer.cpp: test cases for enumerating and counting the kmers of a graph.
+ */
+
+#include "catch.hpp"
+
+#include <map>
+#include <mutex>
+#include <vector>
+#include <handlegraph/util.hpp>
+#include "odgi.hpp"
+#include "algorithms/kmer.hpp"
+
+namespace odgi {
+    namespace unittest {
+
+        using namespace std;
+        using namespace handlegraph;
+
+        TEST_CASE("count_packed_kmers counts the kmers for_each_packed_kmer reports", "[kmer]") {
+            graph_t graph;
+            handle_t a = graph.create_handle("ACGTACGTAA");
+            handle_t b = graph.create_handle("CCGTA");
+            handle_t c = graph.create_handle("TTACGTN");
+            handle_t d = graph.create_handle("ACGT");
+            graph.create_edge(a, b);
+            graph.create_edge(a, c);
+            graph.create_edge(b, d);
+            graph.create_edge(c, d);
+            for (uint64_t k : {1, 4, 7}) {
+                std::map<uint64_t, uint64_t> expected;
+                std::mutex mutex;
+                algorithms::for_each_packed_kmer(graph, k, 0, [&](const algorithms::packed_kmer_t& kmer) {
+                    std::lock_guard<std::mutex> guard(mutex);
+                    ++expected[kmer.kmer];
+                });
+                const std::vector<algorithms::kmer_count_t> counts = algorithms::count_packed_kmers(graph, k, 0, 4);
+                REQUIRE(counts.size() == expected.size());
+                uint64_t i = 0;
+                for (auto& e : expected) {
+                    REQUIRE(counts[i].kmer == e.first);
+                    REQUIRE(counts[i].count == e.second);
+                    REQUIRE(algorithms::unpack_kmer(counts[i].kmer, k).size() == k);
+                    ++i;
+                }
+            }
+            REQUIRE(algorithms::unpack_kmer(0b00011011, 4) == "ACGT");
+        }
+
+    }
+}
@@ -0,0 +1,118 @@
+/**
+ * \file
+ * unittest/mmap_graph.cpp: test cases for the memory-mapped, read-only graph layout.
+ */
+
+#include "catch.hpp"
+
+#include <fstream>
+#include <handlegraph/util.hpp>
+#include "odgi.hpp"
+#include "mmap_graph.hpp"
+#include "algorithms/temp_file.hpp"
+
+namespace odgi {
+    namespace unittest {
+
+        using namespace std;
+        using namespace handlegraph;
+
+        TEST_CASE("Freezing a graph and mapping it back.", "[mmap]") {
+
+            graph_t graph;
+            handle_t n1 = graph.create_handle("AGGA");
+            handle_t gap = graph.create_handle("C");
+            handle_t n2 = graph.create_handle("A");
+            handle_t n3 = graph.create_handle("TC");
+            handle_t n4 = graph.create_handle("TCNCAGRG");
+            graph.create_edge(n1, n2);
+            graph.create_edge(n2, n3);
+            graph.create_edge(n2, n4);
+            graph.create_edge(n3, n4);
+            graph.create_edge(n4, graph.flip(n3));
+
+            path_handle_t p = graph.create_path_handle("p", false);
+            graph.append_step(p, n1);
+            graph.append_step(p, n2);
+            graph.append_step(p, graph.flip(n3));
+            graph.append_step(p, n4);
+            path_handle_t c = graph.create_path_handle("c", true);
+            graph.append_step(c, n2);
+            graph.append_step(c, n4);
+
+            // leave a gap in the id space
+            const nid_t gap_id = graph.get_id(gap);
+            graph.destroy_handle(gap);
+
+            const std::string filename = algorithms::temp_file::create("mmap");
+            {
+                std::ofstream out(filename, std::ios::binary);
+                mmap_graph_t::freeze(graph, out);
+            }
+            REQUIRE(mmap_graph_t::is_mmap_graph(filename));
+
+            mmap_graph_t frozen;
+            frozen.load(filename);
+
+            SECTION("The nodes and edges mirror the graph") {
+                REQUIRE(frozen.get_node_count() == graph.get_node_count());
+                REQUIRE(frozen.get_edge_count() == graph.get_edge_count());
+                REQUIRE(frozen.min_node_id() == graph.min_node_id());
+                REQUIRE(frozen.max_node_id() == graph.max_node_id());
+                REQUIRE(!frozen.has_node(gap_id));
+                graph.for_each_handle([&](const handle_t& h) {
+                    for (bool rev : {false, true}) {
+                        handle_t g = graph.get_handle(graph.get_id(h), rev);
+                        handle_t f = frozen.get_handle(graph.get_id(h), rev);
+                        REQUIRE(frozen.has_node(graph.get_id(h)));
+                        REQUIRE(frozen.get_id(f) == graph.get_id(g));
+                        REQUIRE(frozen.get_sequence(f) == graph.get_sequence(g));
+                        REQUIRE(frozen.get_subsequence(f, 1, 2) == graph.get_subsequence(g, 1, 2));
+                        for (bool go_left : {false, true}) {
+                            std::vector<nid_t> g_next, f_next;
+                            graph.follow_edges(g, go_left, [&](const handle_t& n) {
+                                g_next.push_back(graph.get_id(n) * 2 + graph.get_is_reverse(n));
+                            });
+                            frozen.follow_edges(f, go_left, [&](const handle_t& n) {
+                                f_next.push_back(frozen.get_id(n) * 2 + frozen.get_is_reverse(n));
+                            });
+                            std::sort(g_next.begin(), g_next.end());
+                            std::sort(f_next.begin(), f_next.end());
+                            REQUIRE(f_next == g_next);
+                            REQUIRE(frozen.get_degree(f, go_left) == graph.get_degree(g, go_left));
+                        }
+                    }
+                });
+            }
+
+            SECTION("The paths mirror the graph") {
+                REQUIRE(frozen.get_path_count() == 2);
+                REQUIRE(frozen.has_path("p"));
+                REQUIRE(frozen.has_path("c"));
+                REQUIRE(!frozen.has_path("q"));
+                path_handle_t fp = frozen.get_path_handle("p");
+                REQUIRE(frozen.get_path_name(fp) == "p");
+                REQUIRE(!frozen.get_is_circular(fp));
+                REQUIRE(frozen.get_is_circular(frozen.get_path_handle("c")));
+                std::vector<nid_t> g_steps, f_steps;
+                graph.for_each_step_in_path(p, [&](const step_handle_t& s) {
+                    g_steps.push_back(graph.get_id(graph.get_handle_of_step(s)));
+                });
+                frozen.for_each_step_in_path(fp, [&](const step_handle_t& s) {
+                    f_steps.push_back(frozen.get_id(frozen.get_handle_of_step(s)));
+                });
+                REQUIRE(f_steps == g_steps);
+                REQUIRE(frozen.get_step_count(fp) == graph.get_step_count(p));
+                uint64_t on_n4 = 0;
+                frozen.for_each_step_on_handle(frozen.get_handle(graph.get_id(n4)), [&](const step_handle_t& s) {
+                    REQUIRE(frozen.get_id(frozen.get_handle_of_step(s)) == graph.get_id(n4));
+                    ++on_n4;
+                });
+                REQUIRE(on_n4 == 2);
+            }
+
+            frozen.unmap();
+            algorithms::temp_file::remove(filename);
+        }
+    }
+}
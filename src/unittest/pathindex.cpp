@@ -158,6 +158,27 @@ namespace odgi {
                 // REQUIRE(path_index.get_pangenome_pos("4", 1) == 0);
             }
 
+            SECTION("The pangenome position table agrees with the path index") {
+                std::vector<std::vector<size_t>> expected;
+                const std::vector<std::string> names = {"5", "5-", "5-m"};
+                for (auto& name : names) {
+                    std::vector<size_t> positions;
+                    const size_t length = path_index.get_path_length(path_index.get_path_handle(name));
+                    for (size_t i = 0; i < length; ++i) {
+                        positions.push_back(path_index.get_pangenome_pos(name, i));
+                    }
+                    expected.push_back(positions);
+                }
+                REQUIRE(!path_index.has_pangenome_pos_table());
+                path_index.build_pangenome_pos_table(1);
+                REQUIRE(path_index.has_pangenome_pos_table());
+                for (size_t j = 0; j < names.size(); ++j) {
+                    for (size_t i = 0; i < expected[j].size(); ++i) {
+                        REQUIRE(path_index.get_pangenome_pos(names[j], i) == expected[j][i]);
+                    }
+                }
+            }
+
             // Write index to temporary file in preparation for the next test section.
             std::string basename = temp_file::create();
             std::ofstream out;
@@ -305,6 +326,24 @@ namespace odgi {
                 // REQUIRE(loaded_path_index.get_pangenome_pos("5", 24) == 0);
                 // REQUIRE(loaded_path_index.get_pangenome_pos("4", 1) == 0);
             }
+
+            SECTION("An index of a subset of the paths only holds their steps") {
+                XP subset_index;
+                subset_index.from_handle_graph(graph, std::vector<path_handle_t>{five, five_m_m}, 1);
+                REQUIRE(subset_index.path_count == graph.get_path_count());
+                REQUIRE(as_integer(subset_index.get_path_handle("5-")) == as_integer(five_m));
+                REQUIRE(subset_index.get_path_step_count(five) == 3);
+                REQUIRE(subset_index.get_path_step_count(five_m) == 0);
+                REQUIRE(subset_index.get_path_step_count(five_m_m) == 3);
+                REQUIRE(subset_index.get_np_bv().size() == 6);
+                const sdsl::int_vector<> &npi_iv = subset_index.get_npi_iv();
+                for (uint64_t i = 0; i < npi_iv.size(); ++i) {
+                    REQUIRE(npi_iv[i] != as_integer(five_m));
+                }
+                for (size_t pos = 0; pos < path_index.get_path_length(five); ++pos) {
+                    REQUIRE(subset_index.get_pangenome_pos("5", pos) == path_index.get_pangenome_pos("5", pos));
+                }
+            }
         }
     }
 }
@@ -0,0 +1,80 @@
+/**
+ * \file
+ * unittest/position.cpp: test cases for finding the nearest reference path step of graph positions.
+ */
+
+#include "catch.hpp"
+
+#include <sstream>
+#include <vector>
+#include <handlegraph/util.hpp>
+#include "odgi.hpp"
+#include "algorithms/nearest_ref.hpp"
+#include "algorithms/node_rank.hpp"
+
+namespace odgi {
+    namespace unittest {
+
+        using namespace std;
+        using namespace handlegraph;
+
+        TEST_CASE("The nearest reference index holds what the search from each node side finds", "[position]") {
+            graph_t graph;
+            // a reference through n1 n2 n4 n5, with n3 and n6 off it
+            handle_t n1 = graph.create_handle("ACGT");
+            handle_t n2 = graph.create_handle("CC");
+            handle_t n3 = graph.create_handle("GGGGG");
+            handle_t n4 = graph.create_handle("T");
+            handle_t n5 = graph.create_handle("AAAA");
+            handle_t n6 = graph.create_handle("TT");
+            graph.create_edge(n1, n2);
+            graph.create_edge(n2, n4);
+            graph.create_edge(n1, n3);
+            graph.create_edge(n3, n4);
+            graph.create_edge(n4, n5);
+            graph.create_edge(n5, graph.flip(n6));
+            path_handle_t ref = graph.create_path_handle("ref");
+            for (auto& h : {n1, n2, n4, n5}) {
+                graph.append_step(ref, h);
+            }
+            path_handle_t alt = graph.create_path_handle("alt");
+            for (auto& h : {n1, n3, n4, n5, graph.flip(n6)}) {
+                graph.append_step(alt, h);
+            }
+            const std::vector<path_handle_t> ref_paths = {ref};
+            algorithms::nearest_ref_index_t index;
+            index.build(graph, ref_paths, 100, 2, false);
+            std::stringstream ss;
+            index.serialize(ss);
+            algorithms::nearest_ref_index_t loaded;
+            REQUIRE(loaded.load(ss));
+            REQUIRE(loaded.is_index_of(graph, ref_paths));
+            REQUIRE(!loaded.is_index_of(graph, {alt}));
+            REQUIRE(loaded.get_search_radius() == 100);
+            algorithms::node_rank_t node_rank(graph);
+            graph.for_each_handle([&](const handle_t& h) {
+                for (const bool is_rev : {false, true}) {
+                    const handle_t start = is_rev ? graph.flip(h) : h;
+                    const algorithms::nearest_ref_t searched = algorithms::find_nearest_ref(
+                        graph, [&](const path_handle_t& p) { return p == ref; }, start, 100);
+                    uint64_t ref_offset = 0;
+                    const algorithms::nearest_ref_t indexed = loaded.get_nearest(node_rank(h), is_rev, ref_offset);
+                    REQUIRE(indexed.found == searched.found);
+                    REQUIRE(indexed.used_bidirectional == searched.used_bidirectional);
+                    REQUIRE(indexed.step == searched.step);
+                    REQUIRE(indexed.handle == searched.handle);
+                    REQUIRE(indexed.walked == searched.walked);
+                    REQUIRE(indexed.depth == searched.depth);
+                    REQUIRE(graph.get_path_handle_of_step(indexed.step) == ref);
+                }
+            });
+            // walking backwards from n3 reaches the start of the reference at n1
+            uint64_t ref_offset = 0;
+            const algorithms::nearest_ref_t hit = loaded.get_nearest(node_rank(n3), false, ref_offset);
+            REQUIRE(hit.walked == graph.get_length(n3));
+            REQUIRE(graph.get_id(graph.get_handle_of_step(hit.step)) == graph.get_id(n1));
+            REQUIRE(ref_offset == 0);
+        }
+
+    }
+}
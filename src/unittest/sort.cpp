@@ -4,6 +4,7 @@
 #include <handlegraph/util.hpp>
 #include "odgi.hpp"
 #include "algorithms/topological_sort.hpp"
+#include "algorithms/strongly_connected_components.hpp"
 
 #include <iostream>
 #include <limits>
@@ -322,5 +323,113 @@ TEST_CASE("Sorting the paths in a graph", "[sort]") {
         REQUIRE(i == 0);
     }
 }
+
+TEST_CASE("Deterministic path-guided SGD does not depend on the number of threads", "[sort]") {
+    graph_t graph;
+    std::vector<handle_t> handles;
+    for (uint64_t i = 0; i < 50; ++i) {
+        handles.push_back(graph.create_handle(std::string(1 + i % 7, "ACGT"[i % 4])));
+    }
+    for (uint64_t i = 0; i + 1 < handles.size(); ++i) {
+        graph.create_edge(handles[i], handles[i + 1]);
+    }
+    // paths that skip a few nodes each, out of the node order
+    for (uint64_t p = 0; p < 4; ++p) {
+        path_handle_t path = graph.create_path_handle("p" + std::to_string(p));
+        for (uint64_t i = 0; i < handles.size(); ++i) {
+            if ((i + p) % 5 != 0) {
+                graph.append_step(path, handles[(i * 7) % handles.size()]);
+            }
+        }
+    }
+
+    std::vector<path_handle_t> paths;
+    uint64_t steps = 0;
+    graph.for_each_path_handle([&](const path_handle_t& path) {
+        paths.push_back(path);
+        steps += graph.get_step_count(path);
+    });
+    xp::XP path_index;
+    path_index.from_handle_graph(graph, 1);
+    std::vector<bool> target_nodes;
+
+    auto layout_with = [&](const uint64_t& nthreads, const std::string& seed) {
+        std::vector<std::string> snapshots;
+        return algorithms::path_linear_sgd(graph, path_index, paths, 30, 0, steps, 0, 0.01, 1600, 0.99,
+                                           40, 1000, 100, 0.5, nthreads, false, false, snapshots,
+                                           false, target_nodes, false, 0, 0, true, seed);
+    };
+
+    std::vector<double> one_thread = layout_with(1, "pangenomic!");
+    REQUIRE(one_thread == layout_with(4, "pangenomic!"));
+    REQUIRE(one_thread == layout_with(1, "pangenomic!"));
+    REQUIRE(one_thread != layout_with(4, "another seed"));
+}
+
+TEST_CASE("Parallel topological sort orders a graph with bubbles", "[sort]") {
+    graph_t graph;
+    // a chain of bubbles, with the nodes created out of order
+    std::vector<handle_t> handles(31);
+    for (uint64_t i = 0; i < handles.size(); ++i) {
+        const uint64_t j = (i * 17) % handles.size();
+        handles[j] = graph.create_handle(std::string(1 + j % 3, "ACGT"[j % 4]));
+    }
+    for (uint64_t i = 0; i + 3 < handles.size(); i += 3) {
+        graph.create_edge(handles[i], handles[i + 1]);
+        graph.create_edge(handles[i], handles[i + 2]);
+        graph.create_edge(handles[i + 1], handles[i + 3]);
+        graph.create_edge(handles[i + 2], handles[i + 3]);
+    }
+    graph.create_edge(handles[29], handles[30]);
+    // a second component that is a cycle
+    handle_t c1 = graph.create_handle("A");
+    handle_t c2 = graph.create_handle("C");
+    graph.create_edge(c1, c2);
+    graph.create_edge(c2, c1);
+
+    for (const uint64_t nthreads : {1, 4}) {
+        std::vector<handle_t> order = algorithms::parallel_topological_order(&graph, nthreads);
+        REQUIRE(order.size() == graph.get_node_count());
+        std::unordered_map<nid_t, uint64_t> position;
+        for (uint64_t i = 0; i < order.size(); ++i) {
+            position[graph.get_id(order[i])] = i;
+        }
+        REQUIRE(position.size() == graph.get_node_count());
+        for (uint64_t i = 0; i + 3 < handles.size(); i += 3) {
+            REQUIRE(position[graph.get_id(handles[i])] < position[graph.get_id(handles[i + 1])]);
+            REQUIRE(position[graph.get_id(handles[i + 2])] < position[graph.get_id(handles[i + 3])]);
+        }
+        REQUIRE(order == algorithms::parallel_topological_order(&graph, nthreads));
+    }
+}
+
+TEST_CASE("Parallel strongly connected components match the serial ones", "[sort]") {
+    graph_t graph;
+    // a chain with two loops, a tail hanging off each end and a self loop
+    std::vector<handle_t> handles;
+    for (uint64_t i = 0; i < 12; ++i) {
+        handles.push_back(graph.create_handle(std::string(1 + i % 3, "ACGT"[i % 4])));
+    }
+    for (uint64_t i = 0; i + 1 < handles.size(); ++i) {
+        graph.create_edge(handles[i], handles[i + 1]);
+    }
+    graph.create_edge(handles[4], handles[2]);
+    graph.create_edge(handles[9], handles[6]);
+    graph.create_edge(handles[11], handles[11]);
+
+    auto sorted_components = [](const std::vector<ska::flat_hash_set<nid_t>>& components) {
+        std::vector<std::vector<nid_t>> sorted;
+        for (auto& component : components) {
+            sorted.emplace_back(component.begin(), component.end());
+            std::sort(sorted.back().begin(), sorted.back().end());
+        }
+        std::sort(sorted.begin(), sorted.end());
+        return sorted;
+    };
+    const std::vector<std::vector<nid_t>> serial = sorted_components(algorithms::strongly_connected_components(&graph));
+    REQUIRE(serial.size() == 7);
+    REQUIRE(sorted_components(algorithms::strongly_connected_components(&graph, 4)) == serial);
+}
+
 }
 }
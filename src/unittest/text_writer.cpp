@@ -0,0 +1,49 @@
+/**
+ * \file
+ * unittest/text_writer.cpp: test cases for formatting numbers as text for the tables and images ODGI writes.
+ */
+
+#include "catch.hpp"
+
+#include <random>
+#include <string>
+#include <vector>
+#include "algorithms/text_writer.hpp"
+
+namespace odgi {
+    namespace unittest {
+
+        TEST_CASE("Layout coordinates are written as text that reads back as the same values", "[text]") {
+            std::mt19937 gen(7);
+            std::uniform_real_distribution<double> dis(-1e7, 1e7);
+            for (uint64_t i = 0; i < 1000; ++i) {
+                const double x = dis(gen);
+                std::string text;
+                algorithms::append_shortest(text, x);
+                REQUIRE(std::stod(text) == x);
+            }
+            std::string text;
+            algorithms::append_shortest(text, 0.1);
+            text += ' ';
+            algorithms::append_fixed(text, -2.5, 3);
+            text += ' ';
+            algorithms::append_integer(text, (uint64_t) 42);
+            REQUIRE(text == "0.1 -2.500 42");
+        }
+
+        TEST_CASE("The shortest text of a value is the same with or without floating point to_chars", "[text]") {
+            // as std::to_chars writes them, which the fallback before GCC 11 has to match
+            const std::vector<std::pair<double, std::string>> expected = {
+                {0.0, "0"}, {100.0, "100"}, {123456.7, "123456.7"}, {1e6, "1e+06"}, {1234567.8, "1.2345678e+06"},
+                {0.0001, "0.0001"}, {1e-5, "1e-05"}, {12.345678901234567, "12.345678901234567"},
+                {1.0 / 3, "0.3333333333333333"}, {-2.5, "-2.5"}, {5e-324, "5e-324"}
+            };
+            for (auto& e : expected) {
+                std::string text;
+                algorithms::append_shortest(text, e.first);
+                REQUIRE(text == e.second);
+            }
+        }
+
+    }
+}
@@ -1,5 +1,6 @@
 #include <string>
 #include <algorithm>
+#include <map>
 #include "utils.hpp"
 
 namespace utils {
@@ -83,13 +84,34 @@ namespace utils {
 		}
 	}
 
+	namespace {
+		/// the graphs loaded once for several jobs, by the canonical path of their file
+		std::map<std::string, const odgi::graph_t*> shared_graphs;
+	}
+
+	void share_loaded_graph(const std::string &infile, const odgi::graph_t* graph) {
+		if (graph) {
+			shared_graphs[std::filesystem::weakly_canonical(infile).string()] = graph;
+		} else {
+			shared_graphs.erase(std::filesystem::weakly_canonical(infile).string());
+		}
+	}
+
 	int handle_gfa_odgi_input(const std::string infile, const std::string subcommmand_name, const bool progress,
 							const uint64_t num_threads, odgi::graph_t &graph) {
 		if (!std::filesystem::exists(infile)) {
 			std::cerr << "[odgi::" << subcommmand_name << "] error: the given file \"" << infile << "\" does not exist. Please specify an existing input file in ODGI format via -i=[FILE], --idx=[FILE]." << std::endl;
 			exit(1);
 		}
-		if (utils::ends_with(infile, "gfa")) {
+		if (!shared_graphs.empty() && graph.loads_all_paths()) {
+			auto f = shared_graphs.find(std::filesystem::weakly_canonical(infile).string());
+			if (f != shared_graphs.end()) {
+				graph.share(*f->second);
+				graph.set_number_of_threads(num_threads);
+				return 0;
+			}
+		}
+		if (utils::ends_with(infile, "gfa") || utils::ends_with(infile, "gfa.gz") || utils::ends_with(infile, "gfa.bgz")) {
 			if (progress) {
 				std::cerr << "[odgi::" << subcommmand_name << "] warning: the given file \"" << infile << "\" is not in ODGI format. "
 																				   "To save time in the future, please use odgi build -i=[FILE], --idx=[FILE] -o=[FILE], --out=[FILE] "
@@ -98,13 +120,53 @@ namespace utils {
 			gfa_to_handle(infile, &graph, false, num_threads, progress);
 			graph.set_number_of_threads(num_threads);
 		} else {
-			ifstream f(infile.c_str());
-			graph.deserialize(f);
+			// the next block of the file is read while the current one is decoded
+			odgi::algorithms::readahead_ifstream_t f(infile);
+			graph.set_number_of_threads(num_threads);
+			std::string base_file;
+			if (odgi::graph_t::read_delta_base(f, base_file)) {
+				// a delta is applied on top of its base, itself possibly a delta, named relative to the delta
+				std::filesystem::path base_path(base_file);
+				if (base_path.is_relative()) {
+					base_path = std::filesystem::path(infile).parent_path() / base_path;
+				}
+				if (progress) {
+					std::cerr << "[odgi::" << subcommmand_name << "] applying the delta \"" << infile << "\" to \"" << base_path.string() << "\"" << std::endl;
+				}
+				// the counts of the base are checked against the delta, so the base is loaded with all its paths
+				graph.set_path_loading(false);
+				handle_gfa_odgi_input(base_path.string(), subcommmand_name, progress, num_threads, graph);
+				f.seekg(0);
+				try {
+					graph.apply_changes(f);
+				} catch (const std::exception& e) {
+					std::cerr << "[odgi::" << subcommmand_name << "] error: cannot apply \"" << infile << "\": " << e.what() << std::endl;
+					exit(1);
+				}
+			} else {
+				f.clear();
+				f.seekg(0);
+				graph.deserialize(f);
+			}
 			f.close();
 		}
 		return 0;
     }
 
+	int write_graph_delta(const odgi::graph_t &graph, const std::string &infile, const std::string &outfile,
+						  const std::string subcommmand_name) {
+		if (infile == "-" || outfile == "-" || utils::ends_with(infile, "gfa") || utils::ends_with(infile, "gfa.gz") || utils::ends_with(infile, "gfa.bgz")) {
+			std::cerr << "[odgi::" << subcommmand_name << "] error: a delta needs its base graph in ODGI format in a file, and an output file." << std::endl;
+			return 1;
+		}
+		const std::filesystem::path out_dir = std::filesystem::absolute(outfile).parent_path();
+		const std::string base_file = std::filesystem::absolute(infile).lexically_relative(out_dir).string();
+		ofstream f(outfile.c_str());
+		graph.serialize_changes(f, base_file);
+		f.close();
+		return 0;
+	}
+
 	uint64_t modulo(const uint64_t n, const uint64_t d) {
 		return (n & (d - 1));
 	}
@@ -1,5 +1,6 @@
 #include "odgi.hpp"
 #include "gfa_to_handle.hpp"
+#include "algorithms/readahead.hpp"
 
 #include <filesystem>
 
@@ -16,6 +17,14 @@ namespace utils {
 	bool ends_with(const std::string &fullString, const std::string &ending);
 	int handle_gfa_odgi_input(const std::string infile, const std::string subcommmand_name, const bool progress,
 							  const uint64_t num_threads, odgi::graph_t &graph);
+	/// Have handle_gfa_odgi_input share graph, loaded from infile, with the later loads of that file that keep
+	/// all paths, rather than loading it again; the graph must outlive those loads and stay unedited. A null
+	/// graph stops the sharing of infile.
+	void share_loaded_graph(const std::string &infile, const odgi::graph_t* graph);
+	/// Write the changes to graph since track_changes as a delta over infile, the file graph was loaded from,
+	/// naming infile relative to outfile so that the two can be moved together
+	int write_graph_delta(const odgi::graph_t &graph, const std::string &infile, const std::string &outfile,
+						  const std::string subcommmand_name);
 	/// this function will return n % d
 	/// it is assumed that d is one of 1, 2, 4, 8, 16, 32, ....
 	uint64_t modulo(const uint64_t n, const uint64_t d);